@@ -11,4 +11,6 @@
 #include "uart_ttl/UARTTTL.hpp"
 //#include "my_music_player/MyMusicPlayer.hpp"
 #include "uart_usb/USB_CDC.hpp"
-#include "power_controller/PowerController.hpp"
\ No newline at end of file
+#include "power_controller/PowerController.hpp"
+#include "system_monitor/SystemMonitor.hpp"
+#include "diagnostics/Diagnostics.hpp"
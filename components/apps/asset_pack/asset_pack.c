@@ -0,0 +1,303 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "lvgl.h"
+#include "asset_pack.h"
+
+/* Layout written by pack_assets.py, all fields little endian */
+#define PACK_MAGIC                  "APK1"
+#define PACK_VERSION                (1)
+#define PACK_NAME_LEN               (32)
+#define PACK_CODEC_RAW              (0)
+#define PACK_CODEC_LZ4              (1)
+#define PACK_CACHE_SIZE             (CONFIG_ASSET_PACK_CACHE_SIZE_KB * 1024)
+
+typedef struct __attribute__((packed)) {
+    char        magic[4];
+    uint16_t    version;
+    uint8_t     color_depth;        /* LV_COLOR_DEPTH the pixels were taken for */
+    uint8_t     color_16_swap;
+    uint32_t    count;
+    uint32_t    reserved;
+} pack_header_t;
+
+typedef struct __attribute__((packed)) {
+    char        name[PACK_NAME_LEN];    /* Sorted, NUL padded */
+    uint32_t    offset;
+    uint32_t    size;               /* Size in the file */
+    uint32_t    raw_size;           /* Size of the decoded pixels */
+    uint16_t    w;
+    uint16_t    h;
+    uint8_t     cf;                 /* lv_img_cf_t */
+    uint8_t     codec;
+    uint16_t    reserved;
+} pack_entry_t;
+
+typedef struct {
+    uint8_t     *data;              /* Decoded pixels, NULL if not cached */
+    uint32_t    last_use;
+    uint16_t    refs;               /* Decoder descriptors LVGL holds open on the data */
+} pack_cache_entry_t;
+
+static const char *TAG = "asset_pack";
+
+static FILE *pack_file = NULL;
+static pack_entry_t *pack_index = NULL;
+static pack_cache_entry_t *pack_cache = NULL;
+static uint32_t pack_count = 0;
+static uint32_t pack_cache_used = 0;
+static uint32_t pack_use_counter = 0;
+
+static int pack_entry_cmp(const void *key, const void *elem)
+{
+    return strncmp((const char *)key, ((const pack_entry_t *)elem)->name, PACK_NAME_LEN);
+}
+
+static int pack_find(const void *src)
+{
+    if (lv_img_src_get_type(src) != LV_IMG_SRC_FILE) {
+        return -1;
+    }
+    const char *path = (const char *)src;
+    if (strncmp(path, ASSET_PACK_PREFIX, sizeof(ASSET_PACK_PREFIX) - 1) != 0) {
+        return -1;
+    }
+
+    const pack_entry_t *entry = bsearch(path + sizeof(ASSET_PACK_PREFIX) - 1, pack_index, pack_count,
+                                        sizeof(pack_entry_t), pack_entry_cmp);
+    return entry ? (int)(entry - pack_index) : -1;
+}
+
+/* LZ4 block format, the output must be filled exactly */
+static bool pack_lz4_decompress(const uint8_t *src, uint32_t src_size, uint8_t *dst, uint32_t dst_size)
+{
+    const uint8_t *src_end = src + src_size;
+    uint8_t *out = dst;
+    uint8_t *out_end = dst + dst_size;
+
+    while (src < src_end) {
+        uint8_t token = *src++;
+        uint32_t len = token >> 4;
+        if (len == 15) {
+            uint8_t b;
+            do {
+                if (src >= src_end) {
+                    return false;
+                }
+                b = *src++;
+                len += b;
+            } while (b == 255);
+        }
+        if ((len > (uint32_t)(src_end - src)) || (len > (uint32_t)(out_end - out))) {
+            return false;
+        }
+        memcpy(out, src, len);
+        src += len;
+        out += len;
+        /* The last sequence has no match */
+        if (src == src_end) {
+            break;
+        }
+
+        if (src_end - src < 2) {
+            return false;
+        }
+        uint32_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        if ((offset == 0) || (offset > (uint32_t)(out - dst))) {
+            return false;
+        }
+        len = token & 0xf;
+        if (len == 15) {
+            uint8_t b;
+            do {
+                if (src >= src_end) {
+                    return false;
+                }
+                b = *src++;
+                len += b;
+            } while (b == 255);
+        }
+        len += 4;
+        if (len > (uint32_t)(out_end - out)) {
+            return false;
+        }
+        /* Byte by byte, the match may overlap what it writes */
+        const uint8_t *match = out - offset;
+        while (len--) {
+            *out++ = *match++;
+        }
+    }
+
+    return out == out_end;
+}
+
+static void pack_cache_evict(uint32_t need)
+{
+    while (pack_cache_used + need > PACK_CACHE_SIZE) {
+        int oldest = -1;
+        for (int i = 0; i < (int)pack_count; i++) {
+            if (pack_cache[i].data && (pack_cache[i].refs == 0) &&
+                    ((oldest < 0) || ((int32_t)(pack_cache[i].last_use - pack_cache[oldest].last_use) < 0))) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            /* Everything cached is on screen, go over the budget rather than fail to draw */
+            return;
+        }
+        ESP_LOGD(TAG, "Evict %.*s", PACK_NAME_LEN, pack_index[oldest].name);
+        heap_caps_free(pack_cache[oldest].data);
+        pack_cache[oldest].data = NULL;
+        pack_cache_used -= pack_index[oldest].raw_size;
+    }
+}
+
+static uint8_t *pack_load(int index)
+{
+    const pack_entry_t *entry = &pack_index[index];
+    esp_err_t ret __attribute__((unused)) = ESP_OK;
+    uint8_t *data = NULL;
+    uint8_t *packed = NULL;
+
+    pack_cache_evict(entry->raw_size);
+    data = heap_caps_malloc(entry->raw_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(data, ESP_ERR_NO_MEM, err, TAG, "Allocate %u bytes for %.*s failed", (unsigned)entry->raw_size,
+                      PACK_NAME_LEN, entry->name);
+    if (entry->codec == PACK_CODEC_LZ4) {
+        packed = heap_caps_malloc(entry->size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        ESP_GOTO_ON_FALSE(packed, ESP_ERR_NO_MEM, err, TAG, "Allocate %u bytes for %.*s failed", (unsigned)entry->size,
+                          PACK_NAME_LEN, entry->name);
+    } else {
+        ESP_GOTO_ON_FALSE(entry->size == entry->raw_size, ESP_ERR_INVALID_SIZE, err, TAG, "Bad size of %.*s",
+                          PACK_NAME_LEN, entry->name);
+    }
+
+    uint8_t *read_buf = packed ? packed : data;
+    ESP_GOTO_ON_FALSE((fseek(pack_file, entry->offset, SEEK_SET) == 0) &&
+                      (fread(read_buf, 1, entry->size, pack_file) == entry->size), ESP_FAIL, err, TAG,
+                      "Read %.*s failed", PACK_NAME_LEN, entry->name);
+    if (packed) {
+        ESP_GOTO_ON_FALSE(pack_lz4_decompress(packed, entry->size, data, entry->raw_size), ESP_ERR_INVALID_RESPONSE, err, TAG,
+                          "Decompress %.*s failed", PACK_NAME_LEN, entry->name);
+        heap_caps_free(packed);
+    }
+    pack_cache_used += entry->raw_size;
+
+    return data;
+
+err:
+    heap_caps_free(packed);
+    heap_caps_free(data);
+    return NULL;
+}
+
+static lv_res_t pack_decoder_info(lv_img_decoder_t *decoder, const void *src, lv_img_header_t *header)
+{
+    int index = pack_find(src);
+
+    if (index < 0) {
+        return LV_RES_INV;
+    }
+    header->always_zero = 0;
+    header->w = pack_index[index].w;
+    header->h = pack_index[index].h;
+    header->cf = pack_index[index].cf;
+
+    return LV_RES_OK;
+}
+
+static lv_res_t pack_decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    int index = pack_find(dsc->src);
+
+    if (index < 0) {
+        return LV_RES_INV;
+    }
+
+    pack_cache_entry_t *cache = &pack_cache[index];
+    if (cache->data == NULL) {
+        cache->data = pack_load(index);
+        if (cache->data == NULL) {
+            return LV_RES_INV;
+        }
+    }
+    cache->refs++;
+    cache->last_use = ++pack_use_counter;
+    dsc->img_data = cache->data;
+    dsc->user_data = cache;
+
+    return LV_RES_OK;
+}
+
+static void pack_decoder_close(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    pack_cache_entry_t *cache = (pack_cache_entry_t *)dsc->user_data;
+
+    /* The data stays cached until the budget needs it */
+    if (cache && (cache->refs > 0)) {
+        cache->refs--;
+    }
+    dsc->user_data = NULL;
+    dsc->img_data = NULL;
+}
+
+esp_err_t asset_pack_init(const char *path)
+{
+    esp_err_t ret = ESP_OK;
+    pack_header_t header;
+
+    ESP_RETURN_ON_FALSE(pack_file == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    pack_file = fopen(path, "rb");
+    ESP_RETURN_ON_FALSE(pack_file, ESP_ERR_NOT_FOUND, TAG, "Open %s failed", path);
+    ESP_GOTO_ON_FALSE(fread(&header, sizeof(header), 1, pack_file) == 1, ESP_ERR_INVALID_VERSION, err, TAG,
+                      "Read header failed");
+    ESP_GOTO_ON_FALSE(!memcmp(header.magic, PACK_MAGIC, sizeof(header.magic)) && (header.version == PACK_VERSION),
+                      ESP_ERR_INVALID_VERSION, err, TAG, "Not an asset pack");
+    ESP_GOTO_ON_FALSE((header.color_depth == LV_COLOR_DEPTH) && (header.color_16_swap == LV_COLOR_16_SWAP),
+                      ESP_ERR_INVALID_VERSION, err, TAG, "Pack is for color depth %d swap %d", header.color_depth,
+                      header.color_16_swap);
+
+    pack_index = heap_caps_malloc(header.count * sizeof(pack_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    pack_cache = heap_caps_calloc(header.count, sizeof(pack_cache_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(pack_index && pack_cache, ESP_ERR_NO_MEM, err, TAG, "Allocate index failed");
+    ESP_GOTO_ON_FALSE(fread(pack_index, sizeof(pack_entry_t), header.count, pack_file) == header.count,
+                      ESP_ERR_INVALID_VERSION, err, TAG, "Read index failed");
+    pack_count = header.count;
+
+    lv_img_decoder_t *decoder = lv_img_decoder_create();
+    ESP_GOTO_ON_FALSE(decoder, ESP_ERR_NO_MEM, err, TAG, "Create decoder failed");
+    lv_img_decoder_set_info_cb(decoder, pack_decoder_info);
+    lv_img_decoder_set_open_cb(decoder, pack_decoder_open);
+    lv_img_decoder_set_close_cb(decoder, pack_decoder_close);
+    ESP_LOGI(TAG, "%u images in %s", (unsigned)pack_count, path);
+
+    return ESP_OK;
+
+err:
+    heap_caps_free(pack_index);
+    heap_caps_free(pack_cache);
+    pack_index = NULL;
+    pack_cache = NULL;
+    pack_count = 0;
+    fclose(pack_file);
+    pack_file = NULL;
+    return ret;
+}
+
+uint32_t asset_pack_get_cache_size(void)
+{
+    return pack_cache_used;
+}
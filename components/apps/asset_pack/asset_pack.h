@@ -0,0 +1,52 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASSET_PACK_PREFIX           "asset:"
+
+/**
+ * @brief LVGL image source of a packed image, the name is the symbol of the C array it was packed from
+ *
+ * Usable everywhere LVGL takes an image source, e.g. `lv_img_set_src(img, ASSET_PACK_SRC("img_app_2048"))`.
+ */
+#define ASSET_PACK_SRC(name)        ASSET_PACK_PREFIX name
+
+/**
+ * @brief Open an asset pack and register its LVGL image decoder
+ *
+ * The pack is built by `pack_assets.py` from LVGL C image arrays. Only its index is loaded, each image is read and
+ * LZ4 decompressed into PSRAM the first time LVGL opens it, and kept in an LRU cache of
+ * `CONFIG_ASSET_PACK_CACHE_SIZE_KB` from which the images LVGL no longer uses are evicted.
+ *
+ * Must be called with the LVGL lock held.
+ *
+ * @param path Path of the pack file, e.g. on the SPIFFS partition
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  A pack is already open
+ *      - ESP_ERR_NOT_FOUND      The file can't be opened
+ *      - ESP_ERR_INVALID_VERSION The pack is corrupt or was built for another LVGL color format
+ *      - ESP_ERR_NO_MEM         Failed to allocate the index
+ */
+esp_err_t asset_pack_init(const char *path);
+
+/**
+ * @brief Get the number of decoded bytes held by the cache
+ */
+uint32_t asset_pack_get_cache_size(void);
+
+#ifdef __cplusplus
+}
+#endif
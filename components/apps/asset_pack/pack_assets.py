@@ -0,0 +1,171 @@
+"""
+Pack LVGL C image arrays into an asset pack read by asset_pack.c.
+
+The C files are the ones generated by the LVGL image converter, holding the pixels for every LV_COLOR_DEPTH. The
+pixels of the configured color format are taken from each file, LZ4 compressed (block format) and written after a
+sorted index, so the firmware looks an image up by the name of its lv_img_dsc_t.
+
+    python pack_assets.py -o ../../../spiffs/assets.pak images/*/*.c
+"""
+
+import argparse
+import re
+import struct
+from pathlib import Path
+
+PACK_MAGIC = b"APK1"
+PACK_VERSION = 1
+PACK_NAME_LEN = 32
+PACK_CODEC_RAW = 0
+PACK_CODEC_LZ4 = 1
+HEADER_FORMAT = "<4sHBBII"
+ENTRY_FORMAT = "<32sIIIHHBBH"
+
+# lv_img_cf_t values of LVGL 8, with the bytes per pixel for 8, 16 and 32 bit color
+COLOR_FORMATS = {
+    "LV_IMG_CF_TRUE_COLOR": (4, {8: 1, 16: 2, 32: 4}),
+    "LV_IMG_CF_TRUE_COLOR_ALPHA": (5, {8: 2, 16: 3, 32: 4}),
+    "LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED": (6, {8: 1, 16: 2, 32: 4}),
+}
+
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5
+LZ4_MATCH_LIMIT = 12
+LZ4_MAX_OFFSET = 0xFFFF
+LZ4_HASH_BITS = 16
+
+
+def depth_condition(depth, swap):
+    if depth == 16:
+        return "LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP {} 0".format("!=" if swap else "==")
+    if depth == 8:
+        return "LV_COLOR_DEPTH == 1 || LV_COLOR_DEPTH == 8"
+    return "LV_COLOR_DEPTH == 32"
+
+
+def parse_image(path, depth, swap):
+    """
+    Return (name, w, h, cf, pixels) of a C image file
+    """
+    text = Path(path).read_text()
+    name = re.search(r"lv_img_dsc_t\s+(\w+)\s*=", text)
+    w = re.search(r"\.header\.w\s*=\s*(\d+)", text)
+    h = re.search(r"\.header\.h\s*=\s*(\d+)", text)
+    cf = re.search(r"\.header\.cf\s*=\s*(\w+)", text)
+    if not (name and w and h and cf) or cf.group(1) not in COLOR_FORMATS:
+        raise RuntimeError("{}: not a true color LVGL image".format(path))
+    name, w, h, cf = name.group(1), int(w.group(1)), int(h.group(1)), cf.group(1)
+    if len(name) >= PACK_NAME_LEN:
+        raise RuntimeError("{}: name {} is too long".format(path, name))
+
+    condition = depth_condition(depth, swap)
+    pixels = bytearray()
+    inside = False
+    for line in text.splitlines():
+        stripped = line.strip()
+        if stripped.startswith("#if LV_COLOR_DEPTH"):
+            inside = stripped[len("#if "):].strip() == condition
+        elif stripped.startswith("#endif"):
+            inside = False
+        elif inside:
+            pixels += bytes(int(v, 16) for v in re.findall(r"0x([0-9a-fA-F]{2})", line))
+
+    cf_value, px_sizes = COLOR_FORMATS[cf]
+    if len(pixels) != w * h * px_sizes[depth]:
+        raise RuntimeError("{}: {} bytes of pixels for {}x{}".format(path, len(pixels), w, h))
+
+    return name, w, h, cf_value, bytes(pixels)
+
+
+def lz4_write_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def lz4_compress(data):
+    """
+    Greedy LZ4 block compressor, any LZ4 block decoder can read its output
+    """
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+    end = len(data)
+    match_end = end - LZ4_MATCH_LIMIT
+
+    while pos < match_end:
+        key = data[pos:pos + LZ4_MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+        if candidate is None or pos - candidate > LZ4_MAX_OFFSET:
+            pos += 1
+            continue
+
+        length = LZ4_MIN_MATCH
+        limit = end - LZ4_LAST_LITERALS
+        while pos + length < limit and data[candidate + length] == data[pos + length]:
+            length += 1
+
+        literals = pos - anchor
+        token_lit = min(literals, 15)
+        token_match = min(length - LZ4_MIN_MATCH, 15)
+        out.append((token_lit << 4) | token_match)
+        if literals >= 15:
+            lz4_write_length(out, literals - 15)
+        out += data[anchor:pos]
+        out += struct.pack("<H", pos - candidate)
+        if length - LZ4_MIN_MATCH >= 15:
+            lz4_write_length(out, length - LZ4_MIN_MATCH - 15)
+
+        pos += length
+        anchor = pos
+
+    literals = end - anchor
+    out.append(min(literals, 15) << 4)
+    if literals >= 15:
+        lz4_write_length(out, literals - 15)
+    out += data[anchor:]
+
+    return bytes(out)
+
+
+def pack_assets(files, out_file, depth, swap):
+    images = sorted((parse_image(f, depth, swap) for f in files), key=lambda image: image[0])
+    names = [image[0] for image in images]
+    if len(set(names)) != len(names):
+        raise RuntimeError("Duplicated image names")
+
+    offset = struct.calcsize(HEADER_FORMAT) + struct.calcsize(ENTRY_FORMAT) * len(images)
+    index = b""
+    blobs = b""
+    raw_total = 0
+    for name, w, h, cf, pixels in images:
+        packed = lz4_compress(pixels)
+        codec = PACK_CODEC_LZ4
+        if len(packed) >= len(pixels):
+            packed = pixels
+            codec = PACK_CODEC_RAW
+        index += struct.pack(ENTRY_FORMAT, name.encode(), offset + len(blobs), len(packed), len(pixels), w, h, cf,
+                             codec, 0)
+        blobs += packed
+        raw_total += len(pixels)
+        print("{:<32} {:4}x{:<4} {:8} -> {:8}".format(name, w, h, len(pixels), len(packed)))
+
+    with open(out_file, "wb") as f:
+        f.write(struct.pack(HEADER_FORMAT, PACK_MAGIC, PACK_VERSION, depth, 1 if swap else 0, len(images), 0))
+        f.write(index)
+        f.write(blobs)
+    print("{} images, {} bytes of pixels packed into {} bytes".format(len(images), raw_total, len(blobs)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Pack LVGL C images into an asset pack")
+    parser.add_argument("files", nargs="+", help="LVGL C image files")
+    parser.add_argument("-o", "--output", default="assets.pak", help="Output pack file")
+    parser.add_argument("--color-depth", type=int, choices=[8, 16, 32], default=16, help="CONFIG_LV_COLOR_DEPTH")
+    parser.add_argument("--color-16-swap", action="store_true", help="CONFIG_LV_COLOR_16_SWAP is set")
+    args = parser.parse_args()
+
+    pack_assets(args.files, args.output, args.color_depth, args.color_16_swap)
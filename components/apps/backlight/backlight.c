@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "driver/ledc.h"
+#include "bsp/display.h"
+#include "backlight.h"
+
+/* Channel and resolution configured by `bsp_display_brightness_init` */
+#define BACKLIGHT_LEDC_MODE         LEDC_LOW_SPEED_MODE
+#define BACKLIGHT_LEDC_CHANNEL      CONFIG_BSP_DISPLAY_BRIGHTNESS_LEDC_CH
+#define BACKLIGHT_DUTY_MAX          ((1 << 10) - 1)
+
+static const char *TAG = "backlight";
+
+static esp_timer_handle_t backlight_timer = NULL;
+static portMUX_TYPE backlight_spinlock = portMUX_INITIALIZER_UNLOCKED;     /* Guards everything below */
+static int backlight_percent = 100;         /* `bsp_display_backlight_on` is the start */
+static uint32_t backlight_fade_ms = 0;
+static bool backlight_pending = false;
+static int64_t backlight_apply_us = 0;      /* Last time a fade was started */
+
+/* Runs in the esp_timer task, the only place the LEDC channel is driven from once initialized */
+static void backlight_timer_cb(void *arg)
+{
+    int percent = 0;
+    uint32_t fade_ms = 0;
+
+    portENTER_CRITICAL(&backlight_spinlock);
+    percent = backlight_percent;
+    fade_ms = backlight_fade_ms;
+    backlight_pending = false;
+    backlight_apply_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&backlight_spinlock);
+
+    uint32_t duty = (BACKLIGHT_DUTY_MAX * percent) / 100;
+    // Retarget from wherever the running fade is
+    ledc_fade_stop(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL);
+    if (fade_ms == 0) {
+        ledc_set_duty(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, duty);
+        ledc_update_duty(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL);
+        return;
+    }
+    if ((ledc_set_fade_with_time(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, duty, fade_ms) != ESP_OK) ||
+            (ledc_fade_start(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, LEDC_FADE_NO_WAIT) != ESP_OK)) {
+        ESP_LOGW(TAG, "Fade to %d%% failed, set it right away", percent);
+        ledc_set_duty(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, duty);
+        ledc_update_duty(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL);
+    }
+}
+
+esp_err_t backlight_init(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(backlight_timer == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    // The fade service may already be installed by another user of LEDC
+    ret = ledc_fade_func_install(0);
+    ESP_RETURN_ON_FALSE((ret == ESP_OK) || (ret == ESP_ERR_INVALID_STATE), ret, TAG, "Install fade failed");
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = backlight_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "backlight",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &backlight_timer), TAG, "Create timer failed");
+
+    return ESP_OK;
+}
+
+esp_err_t backlight_set(int percent, uint32_t fade_ms)
+{
+    bool start = false;
+    uint64_t delay_us = 0;
+
+    percent = (percent < 0) ? 0 : (percent > 100) ? 100 : percent;
+    if (backlight_timer == NULL) {
+        portENTER_CRITICAL(&backlight_spinlock);
+        backlight_percent = percent;
+        portEXIT_CRITICAL(&backlight_spinlock);
+        return bsp_display_brightness_set(percent);
+    }
+
+    portENTER_CRITICAL(&backlight_spinlock);
+    backlight_percent = percent;
+    backlight_fade_ms = fade_ms;
+    if (!backlight_pending) {
+        int64_t elapsed_us = esp_timer_get_time() - backlight_apply_us;
+        // The first change of a burst is applied right away, the next ones once per window
+        delay_us = (elapsed_us >= BACKLIGHT_COALESCE_MS * 1000) ? 0 : (BACKLIGHT_COALESCE_MS * 1000 - elapsed_us);
+        backlight_pending = true;
+        start = true;
+    }
+    portEXIT_CRITICAL(&backlight_spinlock);
+
+    if (start) {
+        esp_err_t ret = esp_timer_start_once(backlight_timer, delay_us);
+        if (ret != ESP_OK) {
+            portENTER_CRITICAL(&backlight_spinlock);
+            backlight_pending = false;
+            portEXIT_CRITICAL(&backlight_spinlock);
+            ESP_RETURN_ON_ERROR(ret, TAG, "Start timer failed");
+        }
+    }
+
+    return ESP_OK;
+}
+
+int backlight_get(void)
+{
+    int percent = 0;
+
+    portENTER_CRITICAL(&backlight_spinlock);
+    percent = backlight_percent;
+    portEXIT_CRITICAL(&backlight_spinlock);
+
+    return percent;
+}
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BACKLIGHT_COALESCE_MS   (20)    /* Changes requested within this window are applied as one fade */
+
+/**
+ * @brief Install the LEDC hardware fade on the backlight channel of the BSP
+ *
+ * Must be called after `bsp_display_start`, which configures the LEDC timer and channel.
+ *
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t backlight_init(void);
+
+/**
+ * @brief Fade the backlight to a brightness, without blocking
+ *
+ * The fade is run by the LEDC hardware. A new request retargets the running fade from its current duty, and the
+ * requests coming within `BACKLIGHT_COALESCE_MS` only keep the last one, so a dragged slider starts a few fades.
+ * Before `backlight_init` the brightness is set by the BSP right away.
+ *
+ * @param percent   Brightness, 0 to 100
+ * @param fade_ms   Duration of the fade, 0 to set it right away
+ *
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t backlight_set(int percent, uint32_t fade_ms);
+
+/**
+ * @brief Get the brightness of the last request, the fade may still be running
+ */
+int backlight_get(void);
+
+#ifdef __cplusplus
+}
+#endif
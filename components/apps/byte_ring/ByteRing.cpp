@@ -0,0 +1,152 @@
+#include "ByteRing.hpp"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+ByteRing::ByteRing() :
+    _buffer(nullptr),
+    _capacity(0),
+    _head(0),
+    _tail(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+ByteRing::~ByteRing()
+{
+    deinit();
+}
+
+bool ByteRing::init(size_t capacity, uint32_t caps)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return false;
+    }
+    deinit();
+
+    _buffer = (uint8_t*)heap_caps_malloc(capacity, caps);
+    if (_buffer == nullptr) {
+        return false;
+    }
+    _capacity = capacity;
+    reset();
+
+    return true;
+}
+
+void ByteRing::deinit(void)
+{
+    if (_buffer) {
+        heap_caps_free(_buffer);
+        _buffer = nullptr;
+    }
+    _capacity = 0;
+}
+
+void ByteRing::reset(void)
+{
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+size_t ByteRing::writeSpan(uint8_t** span)
+{
+    if (_buffer == nullptr) {
+        return 0;
+    }
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    size_t free_len = _capacity - (head - tail);
+    size_t offset = head & (_capacity - 1);
+    size_t contiguous = _capacity - offset;
+
+    *span = _buffer + offset;
+    return (free_len < contiguous) ? free_len : contiguous;
+}
+
+void ByteRing::commitWrite(size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    uint32_t head = _head.load(std::memory_order_relaxed) + len;
+    _head.store(head, std::memory_order_release);
+    _stats.received += len;
+
+    uint32_t used = head - _tail.load(std::memory_order_relaxed);
+    if (used > _stats.high_water) {
+        _stats.high_water = used;
+    }
+}
+
+size_t ByteRing::write(const uint8_t* data, size_t len)
+{
+    size_t written = 0;
+
+    // 回绕时最多分两段拷贝
+    while (written < len) {
+        uint8_t* span = nullptr;
+        size_t span_len = writeSpan(&span);
+        if (span_len == 0) {
+            break;
+        }
+        size_t chunk = (len - written < span_len) ? len - written : span_len;
+        memcpy(span, data + written, chunk);
+        commitWrite(chunk);
+        written += chunk;
+    }
+
+    if (written < len) {
+        _stats.dropped += len - written;
+        _stats.full_events++;
+    }
+    return written;
+}
+
+size_t ByteRing::readSpan(const uint8_t** span)
+{
+    if (_buffer == nullptr) {
+        return 0;
+    }
+
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t head = _head.load(std::memory_order_acquire);
+    size_t used = head - tail;
+    size_t offset = tail & (_capacity - 1);
+    size_t contiguous = _capacity - offset;
+
+    *span = _buffer + offset;
+    return (used < contiguous) ? used : contiguous;
+}
+
+void ByteRing::releaseRead(size_t len)
+{
+    if (len > 0) {
+        _tail.store(_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+}
+
+size_t ByteRing::read(uint8_t* buffer, size_t max_len)
+{
+    size_t copied = 0;
+
+    while (copied < max_len) {
+        const uint8_t* span = nullptr;
+        size_t span_len = readSpan(&span);
+        if (span_len == 0) {
+            break;
+        }
+        size_t chunk = (max_len - copied < span_len) ? max_len - copied : span_len;
+        memcpy(buffer + copied, span, chunk);
+        releaseRead(chunk);
+        copied += chunk;
+    }
+    return copied;
+}
+
+size_t ByteRing::available(void) const
+{
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @class ByteRing
+ * @brief 单生产者单消费者的无锁字节环形缓冲区
+ *
+ * 生产者直接拿到空闲的连续区域写入后提交，消费者直接拿到可读的连续区域处理后释放，
+ * 数据不需要经过中间缓冲区拷贝。读写位置是单调递增的字节计数，容量必须是2的幂。
+ * 一个任务只能做生产者，另一个任务只能做消费者；init/deinit/reset必须在两端都空闲时调用。
+ */
+class ByteRing {
+public:
+    /**
+     * @brief 统计信息
+     */
+    struct Stats {
+        uint32_t received;      // 写入的字节数
+        uint32_t dropped;       // 缓冲满时丢弃的字节数
+        uint32_t full_events;   // 生产者遇到缓冲满的次数
+        uint32_t high_water;    // 缓冲中数据量的最大值
+    };
+
+    ByteRing();
+    ~ByteRing();
+
+    /**
+     * @brief 分配缓冲区
+     * @param capacity 容量（字节），必须是2的幂
+     * @param caps heap_caps_malloc的内存能力，如MALLOC_CAP_INTERNAL或MALLOC_CAP_SPIRAM
+     * @return true 成功，false 容量无效或内存不足
+     */
+    bool init(size_t capacity, uint32_t caps);
+
+    /**
+     * @brief 释放缓冲区
+     */
+    void deinit(void);
+
+    bool isValid(void) const { return _buffer != nullptr; }
+    size_t capacity(void) const { return _capacity; }
+
+    /**
+     * @brief 清空数据和统计
+     */
+    void reset(void);
+
+    // -- 生产者 --
+
+    /**
+     * @brief 获取可写的连续区域
+     * @param span 输出区域起始地址
+     * @return 区域长度，0表示缓冲已满
+     */
+    size_t writeSpan(uint8_t** span);
+
+    /**
+     * @brief 提交写入writeSpan区域的数据
+     * @param len 写入的字节数，不超过writeSpan返回的长度
+     */
+    void commitWrite(size_t len);
+
+    /**
+     * @brief 拷贝写入，放不下的部分被丢弃并计入统计
+     * @return 实际写入的字节数
+     */
+    size_t write(const uint8_t* data, size_t len);
+
+    /**
+     * @brief 记录一次缓冲满，用于生产者主动等待（背压）的情况
+     */
+    void noteFull(void) { _stats.full_events++; }
+
+    // -- 消费者 --
+
+    /**
+     * @brief 获取可读的连续区域，数据在releaseRead之前保持有效
+     * @param span 输出区域起始地址
+     * @return 区域长度，0表示没有数据
+     */
+    size_t readSpan(const uint8_t** span);
+
+    /**
+     * @brief 释放已处理的数据
+     * @param len 字节数，不超过readSpan返回的长度
+     */
+    void releaseRead(size_t len);
+
+    /**
+     * @brief 拷贝读取
+     * @return 实际读取的字节数
+     */
+    size_t read(uint8_t* buffer, size_t max_len);
+
+    /**
+     * @brief 可读的字节数
+     */
+    size_t available(void) const;
+
+    const Stats& getStats(void) const { return _stats; }
+
+private:
+    uint8_t*              _buffer;
+    size_t                _capacity;
+    std::atomic<uint32_t> _head;    // 生产者写入的位置
+    std::atomic<uint32_t> _tail;    // 消费者读取的位置
+    Stats                 _stats;   // 只由生产者修改
+};
@@ -0,0 +1,424 @@
+/**
+ * @file CalcExpr.cpp
+ * @brief 计算器表达式编译器和求值器实现
+ */
+
+#include <math.h>
+#include <string.h>
+#include "CalcExpr.hpp"
+
+// ========== 绑定优先级（Pratt解析） ==========
+
+#define BP_ADD          10     ///< + -
+#define BP_MUL          20     ///< x / mod 和省略的乘号
+#define BP_UNARY        30     ///< 一元正负号、不带括号的函数参数
+#define BP_POW          40     ///< ^，右结合
+#define BP_POSTFIX      50     ///< n! 和 %
+
+CalcExpr::CalcExpr():
+    _src(nullptr), _depth(0), _stack_depth(0), _code_len(0), _const_len(0), _deg(true), _valid(false),
+    _has_var(false)
+{
+    _tok = {TOK_END, OP_CONST, 0};
+}
+
+/**
+ * @brief 读取下一个记号到_tok
+ * @details 数字逐位累加，不经过strtod，避免把"2e3"中的常数e当作科学计数法
+ */
+void CalcExpr::next(void)
+{
+    // 按最长匹配排列，"exp"必须在"e"之前
+    static const struct {
+        const char *name;
+        uint8_t len;
+        TokenType type;
+        Op op;
+        double value;
+    } keywords[] = {
+        {"sqrt", 4, TOK_FUNC, OP_SQRT, 0},
+        {"sin", 3, TOK_FUNC, OP_SIN, 0},
+        {"cos", 3, TOK_FUNC, OP_COS, 0},
+        {"tan", 3, TOK_FUNC, OP_TAN, 0},
+        {"log", 3, TOK_FUNC, OP_LOG, 0},
+        {"exp", 3, TOK_FUNC, OP_EXP, 0},
+        {"mod", 3, TOK_BINARY, OP_MOD, 0},
+        {"ln", 2, TOK_FUNC, OP_LN, 0},
+        {"pi", 2, TOK_NUM, OP_CONST, M_PI},
+        {"e", 1, TOK_NUM, OP_CONST, M_E},
+    };
+    const char *p = _src;
+
+    while (*p == ' ') {
+        p++;
+    }
+    _tok = {TOK_BAD, OP_CONST, 0};
+
+    if (*p == '\0') {
+        _tok.type = TOK_END;
+    } else if ((*p >= '0' && *p <= '9') || *p == '.') {
+        double value = 0;
+        double scale = 1;
+        bool fraction = false;
+        for (; (*p >= '0' && *p <= '9') || (*p == '.' && !fraction); p++) {
+            if (*p == '.') {
+                fraction = true;
+            } else if (fraction) {
+                scale *= 10;
+                value = value * 10 + (*p - '0');
+            } else {
+                value = value * 10 + (*p - '0');
+            }
+        }
+        // 一个数只能有一个小数点，否则"1.2.3"会被拆成1.2和.3再隐式相乘
+        if (*p != '.') {
+            _tok.type = TOK_NUM;
+            _tok.value = value / scale;
+        }
+    } else if (*p >= 'a' && *p <= 'z' && *p != 'x') {
+        for (const auto &kw : keywords) {
+            if (strncmp(p, kw.name, kw.len) == 0) {
+                _tok.type = kw.type;
+                _tok.op = kw.op;
+                _tok.value = kw.value;
+                p += kw.len;
+                break;
+            }
+        }
+    } else {
+        switch (*p++) {
+        case '+': _tok.type = TOK_BINARY; _tok.op = OP_ADD; break;
+        case '-': _tok.type = TOK_BINARY; _tok.op = OP_SUB; break;
+        case 'x':
+        case '*': _tok.type = TOK_BINARY; _tok.op = OP_MUL; break;
+        case '/': _tok.type = TOK_BINARY; _tok.op = OP_DIV; break;
+        case '^': _tok.type = TOK_BINARY; _tok.op = OP_POW; break;
+        case '(': _tok.type = TOK_LPAREN; break;
+        case ')': _tok.type = TOK_RPAREN; break;
+        case 'X': _tok.type = TOK_VAR; break;
+        case '|': _tok.type = TOK_BAR; break;
+        case '!': _tok.type = TOK_BANG; break;
+        case '%': _tok.type = TOK_PERCENT; break;
+        default: break;
+        }
+    }
+
+    _src = p;
+}
+
+bool CalcExpr::emit(Op op)
+{
+    if (_code_len >= CALC_EXPR_CODE_MAX) {
+        return false;
+    }
+    // 二元运算弹出两个压入一个，一元运算不改变栈深度
+    if (op >= OP_ADD && op <= OP_POW) {
+        _stack_depth--;
+    }
+    _code[_code_len++] = {op, 0};
+    return true;
+}
+
+bool CalcExpr::emitConst(double value)
+{
+    if (_code_len >= CALC_EXPR_CODE_MAX || _const_len >= CALC_EXPR_CONST_MAX ||
+        ++_stack_depth > CALC_EXPR_STACK_MAX) {
+        return false;
+    }
+    _consts[_const_len] = value;
+    _code[_code_len++] = {OP_CONST, _const_len++};
+    return true;
+}
+
+bool CalcExpr::emitVar(void)
+{
+    if (_code_len >= CALC_EXPR_CODE_MAX || ++_stack_depth > CALC_EXPR_STACK_MAX) {
+        return false;
+    }
+    _code[_code_len++] = {OP_VAR, 0};
+    _has_var = true;
+    return true;
+}
+
+/**
+ * @brief 解析一个操作数（Pratt解析中的前缀部分）
+ * @details 括号和绝对值在输入末尾时视为自动闭合
+ */
+bool CalcExpr::parseOperand(void)
+{
+    switch (_tok.type) {
+    case TOK_NUM: {
+        double value = _tok.value;
+        next();
+        return emitConst(value);
+    }
+    case TOK_VAR:
+        next();
+        return emitVar();
+    case TOK_LPAREN:
+        next();
+        if (!parse(0) || (_tok.type != TOK_RPAREN && _tok.type != TOK_END)) {
+            return false;
+        }
+        if (_tok.type == TOK_RPAREN) {
+            next();
+        }
+        return true;
+    case TOK_BAR:
+        next();
+        if (!parse(0) || (_tok.type != TOK_BAR && _tok.type != TOK_END)) {
+            return false;
+        }
+        if (_tok.type == TOK_BAR) {
+            next();
+        }
+        return emit(OP_ABS);
+    case TOK_FUNC: {
+        Op op = _tok.op;
+        next();
+        if (_tok.type == TOK_LPAREN) {
+            // 带括号的参数是一个整体：sin(30)^2 = (sin 30)^2
+            next();
+            if (!parse(0) || (_tok.type != TOK_RPAREN && _tok.type != TOK_END)) {
+                return false;
+            }
+            if (_tok.type == TOK_RPAREN) {
+                next();
+            }
+        } else if (!parse(BP_UNARY)) {
+            return false;
+        }
+        return emit(op);
+    }
+    case TOK_BINARY:
+        if (_tok.op == OP_ADD || _tok.op == OP_SUB) {
+            Op op = _tok.op;
+            next();
+            if (!parse(BP_UNARY)) {
+                return false;
+            }
+            return (op == OP_SUB) ? emit(OP_NEG) : true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 解析绑定优先级高于min_bp的表达式
+ * @details 每个运算符在右操作数之后输出，得到后缀形式的字节码
+ */
+bool CalcExpr::parse(int min_bp)
+{
+    if (++_depth > CALC_EXPR_NEST_MAX || !parseOperand()) {
+        return false;
+    }
+
+    while (true) {
+        if (_tok.type == TOK_BINARY) {
+            Op op = _tok.op;
+            int bp = (op == OP_ADD || op == OP_SUB) ? BP_ADD : (op == OP_POW) ? BP_POW : BP_MUL;
+            if (bp <= min_bp) {
+                break;
+            }
+            next();
+            if (!parse(op == OP_POW ? bp - 1 : bp) || !emit(op)) {
+                return false;
+            }
+        } else if (_tok.type == TOK_BANG || _tok.type == TOK_PERCENT) {
+            if (BP_POSTFIX <= min_bp) {
+                break;
+            }
+            Op op = (_tok.type == TOK_BANG) ? OP_FACT : OP_PERCENT;
+            next();
+            if (!emit(op)) {
+                return false;
+            }
+        } else if (_tok.type == TOK_NUM || _tok.type == TOK_VAR || _tok.type == TOK_FUNC ||
+                   _tok.type == TOK_LPAREN) {
+            // 相邻的操作数按乘法处理，如 2pi、3X
+            if (BP_MUL <= min_bp) {
+                break;
+            }
+            if (!parse(BP_MUL) || !emit(OP_MUL)) {
+                return false;
+            }
+        } else {
+            break;
+        }
+    }
+
+    _depth--;
+    return true;
+}
+
+bool CalcExpr::compile(const char *src, bool deg)
+{
+    _src = src;
+    _depth = 0;
+    _stack_depth = 0;
+    _code_len = 0;
+    _const_len = 0;
+    _deg = deg;
+    _has_var = false;
+
+    next();
+    _valid = parse(0) && (_tok.type == TOK_END);
+    return _valid;
+}
+
+double CalcExpr::eval(double x) const
+{
+    double stack[CALC_EXPR_STACK_MAX];
+    int sp = 0;
+    double angle = _deg ? M_PI / 180.0 : 1.0;
+
+    if (!_valid) {
+        return NAN;
+    }
+
+    for (int i = 0; i < _code_len; i++) {
+        const Insn &insn = _code[i];
+        if (insn.op == OP_CONST) {
+            stack[sp++] = _consts[insn.arg];
+            continue;
+        }
+        if (insn.op == OP_VAR) {
+            stack[sp++] = x;
+            continue;
+        }
+        if (insn.op >= OP_ADD && insn.op <= OP_POW) {
+            double b = stack[--sp];
+            double &a = stack[sp - 1];
+            switch (insn.op) {
+            case OP_ADD: a += b; break;
+            case OP_SUB: a -= b; break;
+            case OP_MUL: a *= b; break;
+            case OP_DIV: a /= b; break;
+            case OP_MOD: a = fmod(a, b); break;
+            default: a = pow(a, b); break;
+            }
+            continue;
+        }
+
+        double &v = stack[sp - 1];
+        switch (insn.op) {
+        case OP_NEG: v = -v; break;
+        case OP_PERCENT: v /= 100.0; break;
+        case OP_ABS: v = fabs(v); break;
+        case OP_SIN: v = sin(v * angle); break;
+        case OP_COS: v = cos(v * angle); break;
+        case OP_TAN: v = tan(v * angle); break;
+        case OP_LN: v = log(v); break;
+        case OP_LOG: v = log10(v); break;
+        case OP_SQRT: v = sqrt(v); break;
+        case OP_EXP: v = exp(v); break;
+        case OP_FACT:
+            // 只定义非负整数的阶乘，170!以上超出double范围
+            if (v < 0 || v != floor(v)) {
+                v = NAN;
+            } else if (v > 170) {
+                v = INFINITY;
+            } else {
+                double f = 1;
+                for (int n = 2; n <= (int)v; n++) {
+                    f *= n;
+                }
+                v = f;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return stack[0];
+}
+
+void CalcExpr::evalBatch(const float *x, float *y, int n) const
+{
+    float stack[CALC_EXPR_STACK_MAX][CALC_EXPR_BATCH];
+    float angle = _deg ? (float)(M_PI / 180.0) : 1.0f;
+
+    for (int base = 0; base < n; base += CALC_EXPR_BATCH) {
+        int m = (n - base < CALC_EXPR_BATCH) ? (n - base) : CALC_EXPR_BATCH;
+        int sp = 0;
+
+        if (!_valid) {
+            for (int k = 0; k < m; k++) {
+                y[base + k] = NAN;
+            }
+            continue;
+        }
+
+        for (int i = 0; i < _code_len; i++) {
+            const Insn &insn = _code[i];
+            if (insn.op == OP_CONST) {
+                float c = (float)_consts[insn.arg];
+                for (int k = 0; k < CALC_EXPR_BATCH; k++) {
+                    stack[sp][k] = c;
+                }
+                sp++;
+                continue;
+            }
+            if (insn.op == OP_VAR) {
+                for (int k = 0; k < CALC_EXPR_BATCH; k++) {
+                    stack[sp][k] = (k < m) ? x[base + k] : 0.0f;
+                }
+                sp++;
+                continue;
+            }
+            if (insn.op >= OP_ADD && insn.op <= OP_POW) {
+                const float *b = stack[--sp];
+                float *a = stack[sp - 1];
+                // 不足一组的尾部样本也按整组计算，多出的结果丢弃
+                switch (insn.op) {
+                case OP_ADD: for (int k = 0; k < CALC_EXPR_BATCH; k++) a[k] += b[k]; break;
+                case OP_SUB: for (int k = 0; k < CALC_EXPR_BATCH; k++) a[k] -= b[k]; break;
+                case OP_MUL: for (int k = 0; k < CALC_EXPR_BATCH; k++) a[k] *= b[k]; break;
+                case OP_DIV: for (int k = 0; k < CALC_EXPR_BATCH; k++) a[k] /= b[k]; break;
+                case OP_MOD: for (int k = 0; k < m; k++) a[k] = fmodf(a[k], b[k]); break;
+                default: for (int k = 0; k < m; k++) a[k] = powf(a[k], b[k]); break;
+                }
+                continue;
+            }
+
+            float *v = stack[sp - 1];
+            switch (insn.op) {
+            case OP_NEG: for (int k = 0; k < CALC_EXPR_BATCH; k++) v[k] = -v[k]; break;
+            case OP_PERCENT: for (int k = 0; k < CALC_EXPR_BATCH; k++) v[k] *= 0.01f; break;
+            case OP_ABS: for (int k = 0; k < CALC_EXPR_BATCH; k++) v[k] = fabsf(v[k]); break;
+            case OP_SIN: for (int k = 0; k < m; k++) v[k] = sinf(v[k] * angle); break;
+            case OP_COS: for (int k = 0; k < m; k++) v[k] = cosf(v[k] * angle); break;
+            case OP_TAN: for (int k = 0; k < m; k++) v[k] = tanf(v[k] * angle); break;
+            case OP_LN: for (int k = 0; k < m; k++) v[k] = logf(v[k]); break;
+            case OP_LOG: for (int k = 0; k < m; k++) v[k] = log10f(v[k]); break;
+            case OP_SQRT: for (int k = 0; k < m; k++) v[k] = sqrtf(v[k]); break;
+            case OP_EXP: for (int k = 0; k < m; k++) v[k] = expf(v[k]); break;
+            case OP_FACT:
+                for (int k = 0; k < m; k++) {
+                    if (v[k] < 0 || v[k] != floorf(v[k])) {
+                        v[k] = NAN;
+                    } else if (v[k] > 34) {
+                        // 34!以上超出float范围
+                        v[k] = INFINITY;
+                    } else {
+                        float f = 1;
+                        for (int j = 2; j <= (int)v[k]; j++) {
+                            f *= j;
+                        }
+                        v[k] = f;
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        for (int k = 0; k < m; k++) {
+            y[base + k] = stack[0][k];
+        }
+    }
+}
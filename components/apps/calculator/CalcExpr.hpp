@@ -0,0 +1,136 @@
+/**
+ * @file CalcExpr.hpp
+ * @brief 计算器表达式编译器和求值器
+ * @details 单遍词法分析 + Pratt解析，把公式编译成小型字节码，
+ *          在固定大小的栈上求值，编译和求值都不分配内存
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define CALC_EXPR_CODE_MAX      256    ///< 字节码指令数上限
+#define CALC_EXPR_CONST_MAX     128    ///< 常数池容量
+#define CALC_EXPR_STACK_MAX     32     ///< 求值栈深度上限
+#define CALC_EXPR_NEST_MAX      32     ///< 括号和函数嵌套层数上限
+#define CALC_EXPR_BATCH         8      ///< 批量求值时每组的样本数，决定批量求值栈的大小
+
+/**
+ * @brief 编译后的计算器表达式
+ * @details 支持的语法与键盘输入一致：
+ *          - 数字、百分号（50%）、常数 pi 和 e
+ *          - 运算符 + - x / ^ mod，以及一元正负号、阶乘 n!
+ *          - 函数 sin( cos( tan( ln( log( sqrt( exp( 和绝对值 |x|
+ *          - 省略乘号的相邻操作数（如 2pi、3(1+2)、2sqrt(4)）
+ *          - 自变量 X（大写，小写x是乘号），用于函数绘图
+ *          - 输入末尾未闭合的括号自动补齐，便于输入过程中实时预览结果
+ *          一个对象可以反复编译，每次按键只需重新compile一次
+ */
+class CalcExpr {
+public:
+    CalcExpr();
+
+    /**
+     * @brief 编译表达式
+     * @param src 公式字符串
+     * @param deg 三角函数的参数是否为角度
+     * @return true 编译成功，false 语法错误或超出容量
+     */
+    bool compile(const char *src, bool deg);
+
+    /**
+     * @brief 求值
+     * @details 除零、定义域错误等得到NaN或无穷大，由调用者用isfinite判断
+     * @param x 自变量X的值
+     * @return 计算结果，未编译成功时为NaN
+     */
+    double eval(double x = 0) const;
+
+    /**
+     * @brief 对一组自变量批量求值
+     * @details 按CALC_EXPR_BATCH个样本一组执行字节码，每条指令在整组样本上循环，
+     *          指令分派的开销由整组分摊，内层定长循环便于编译器展开。
+     *          使用单精度，适合绘图等对精度要求不高的场合
+     * @param x 自变量数组
+     * @param y 结果数组，可以与x相同
+     * @param n 样本数
+     */
+    void evalBatch(const float *x, float *y, int n) const;
+
+    bool isValid(void) const { return _valid; }
+
+    /**
+     * @brief 表达式中是否含有自变量X
+     */
+    bool hasVariable(void) const { return _valid && _has_var; }
+
+private:
+    enum Op : uint8_t {
+        OP_CONST,   ///< 压入常数池中的常数
+        OP_VAR,     ///< 压入自变量X
+        OP_NEG,
+        OP_ADD,
+        OP_SUB,
+        OP_MUL,
+        OP_DIV,
+        OP_MOD,
+        OP_POW,
+        OP_FACT,
+        OP_PERCENT,
+        OP_ABS,
+        OP_SIN,
+        OP_COS,
+        OP_TAN,
+        OP_LN,
+        OP_LOG,
+        OP_SQRT,
+        OP_EXP,
+    };
+
+    enum TokenType : uint8_t {
+        TOK_END,
+        TOK_NUM,
+        TOK_VAR,
+        TOK_FUNC,
+        TOK_LPAREN,
+        TOK_RPAREN,
+        TOK_BAR,
+        TOK_BINARY,
+        TOK_BANG,
+        TOK_PERCENT,
+        TOK_BAD,
+    };
+
+    struct Token {
+        TokenType type;
+        Op op;          ///< 函数或运算符对应的指令
+        double value;   ///< 数字或常数的值
+    };
+
+    struct Insn {
+        uint8_t op;
+        uint8_t arg;    ///< OP_CONST的常数池下标
+    };
+
+    void next(void);
+    bool parse(int min_bp);
+    bool parseOperand(void);
+    bool emit(Op op);
+    bool emitConst(double value);
+    bool emitVar(void);
+
+    // 编译状态，只在compile中使用
+    const char *_src;
+    Token _tok;
+    int _depth;
+    int _stack_depth;
+
+    // 编译结果
+    Insn _code[CALC_EXPR_CODE_MAX];
+    double _consts[CALC_EXPR_CONST_MAX];
+    uint16_t _code_len;
+    uint8_t _const_len;
+    bool _deg;
+    bool _valid;
+    bool _has_var;
+};
@@ -0,0 +1,326 @@
+/**
+ * @file CalcGraph.cpp
+ * @brief 计算器函数绘图视图实现
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "esp_heap_caps.h"
+#include "CalcGraph.hpp"
+
+#define GRAPH_X_RANGE           20.0                            ///< 初始横坐标范围 [-10, 10]
+#define GRAPH_ZOOM_STEP         2.0                             ///< 每次缩放的倍数，取2使缩放后一半的列可以复用
+#define GRAPH_GRID_LINES        8                               ///< 横向大约的网格线数量
+#define GRAPH_BG_COLOR          lv_color_white()                ///< 背景颜色
+#define GRAPH_GRID_COLOR        lv_color_make(225, 225, 225)    ///< 网格线颜色
+#define GRAPH_AXIS_COLOR        lv_color_make(120, 120, 120)    ///< 坐标轴颜色
+#define GRAPH_CURVE_COLOR       lv_color_make(0, 0x66, 0xcc)    ///< 曲线颜色
+#define GRAPH_TOOLBAR_W         200                             ///< 工具栏宽度
+#define GRAPH_TOOLBAR_H         50                              ///< 工具栏高度
+
+/**
+ * @brief 绘图工具栏按钮布局：缩小、放大、复位、关闭
+ */
+static const char *graph_toolbar_map[] = {"-", "+", LV_SYMBOL_HOME, LV_SYMBOL_CLOSE, ""};
+
+/**
+ * @brief 计算网格间距
+ * @details 取不小于range/GRAPH_GRID_LINES的1、2、5乘以10的整数次幂
+ */
+static double graph_grid_step(double range)
+{
+    double raw = range / GRAPH_GRID_LINES;
+    double base = pow(10.0, floor(log10(raw)));
+    double n = raw / base;
+
+    return ((n <= 1) ? 1 : (n <= 2) ? 2 : (n <= 5) ? 5 : 10) * base;
+}
+
+CalcGraph::CalcGraph():
+    _panel(nullptr), _canvas(nullptr), _range_label(nullptr), _canvas_buf(nullptr), _samples(nullptr),
+    _samples_next(nullptr), _batch(nullptr), _batch_col(nullptr), _width(0), _height(0), _x0(0), _dx(0),
+    _y_center(0), _dy(0), _has_samples(false)
+{
+}
+
+CalcGraph::~CalcGraph()
+{
+    close();
+}
+
+bool CalcGraph::open(lv_obj_t *parent, int width, int height, const char *formula, bool deg)
+{
+    close();
+
+    if (!_expr.compile(formula, deg)) {
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _canvas_buf = (lv_color_t *)heap_caps_malloc(width * height * sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
+    _samples = (float *)heap_caps_malloc(width * sizeof(float), MALLOC_CAP_INTERNAL);
+    _samples_next = (float *)heap_caps_malloc(width * sizeof(float), MALLOC_CAP_INTERNAL);
+    _batch = (float *)heap_caps_malloc(width * sizeof(float), MALLOC_CAP_INTERNAL);
+    _batch_col = (int16_t *)heap_caps_malloc(width * sizeof(int16_t), MALLOC_CAP_INTERNAL);
+    if (!_canvas_buf || !_samples || !_samples_next || !_batch || !_batch_col) {
+        close();
+        return false;
+    }
+
+    // ========== 视图容器，覆盖整个计算器界面 ==========
+    _panel = lv_obj_create(parent);
+    lv_obj_set_size(_panel, width, height);
+    lv_obj_align(_panel, LV_ALIGN_TOP_MID, 0, 0);
+    lv_obj_set_style_pad_all(_panel, 0, 0);
+    lv_obj_set_style_radius(_panel, 0, 0);
+    lv_obj_set_style_border_width(_panel, 0, 0);
+    lv_obj_clear_flag(_panel, LV_OBJ_FLAG_SCROLLABLE);
+
+    // ========== 绘图画布，拖动平移 ==========
+    _canvas = lv_canvas_create(_panel);
+    lv_canvas_set_buffer(_canvas, _canvas_buf, width, height, LV_IMG_CF_TRUE_COLOR);
+    lv_obj_align(_canvas, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_add_flag(_canvas, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_clear_flag(_canvas, LV_OBJ_FLAG_GESTURE_BUBBLE);
+    lv_obj_add_event_cb(_canvas, canvas_event_cb, LV_EVENT_PRESSING, this);
+
+    // ========== 公式和坐标范围 ==========
+    lv_obj_t *formula_label = lv_label_create(_panel);
+    lv_obj_set_style_text_font(formula_label, &lv_font_montserrat_20, 0);
+    lv_obj_set_style_text_color(formula_label, lv_color_make(30, 30, 30), 0);
+    lv_label_set_text_fmt(formula_label, "y = %s", formula);
+    lv_obj_align(formula_label, LV_ALIGN_TOP_LEFT, 10, 10);
+
+    _range_label = lv_label_create(_panel);
+    lv_obj_set_style_text_font(_range_label, &lv_font_montserrat_16, 0);
+    lv_obj_set_style_text_color(_range_label, GRAPH_AXIS_COLOR, 0);
+    lv_obj_align(_range_label, LV_ALIGN_BOTTOM_LEFT, 10, -10);
+
+    // ========== 工具栏 ==========
+    lv_obj_t *toolbar = lv_btnmatrix_create(_panel);
+    lv_btnmatrix_set_map(toolbar, graph_toolbar_map);
+    lv_obj_set_size(toolbar, GRAPH_TOOLBAR_W, GRAPH_TOOLBAR_H);
+    lv_obj_align(toolbar, LV_ALIGN_TOP_RIGHT, -5, 5);
+    lv_obj_set_style_pad_all(toolbar, 3, 0);
+    lv_obj_set_style_pad_gap(toolbar, 3, 0);
+    lv_obj_set_style_bg_opa(toolbar, LV_OPA_70, 0);
+    lv_obj_set_style_text_font(toolbar, &lv_font_montserrat_20, 0);
+    lv_obj_add_event_cb(toolbar, button_event_cb, LV_EVENT_VALUE_CHANGED, this);
+
+    resetView();
+
+    return true;
+}
+
+void CalcGraph::close(void)
+{
+    if (_panel && lv_obj_is_valid(_panel)) {
+        lv_obj_del(_panel);
+    }
+    _panel = nullptr;
+    _canvas = nullptr;
+    _range_label = nullptr;
+    _has_samples = false;
+
+    heap_caps_free(_canvas_buf);
+    heap_caps_free(_samples);
+    heap_caps_free(_samples_next);
+    heap_caps_free(_batch);
+    heap_caps_free(_batch_col);
+    _canvas_buf = nullptr;
+    _samples = nullptr;
+    _samples_next = nullptr;
+    _batch = nullptr;
+    _batch_col = nullptr;
+}
+
+void CalcGraph::resample(double x0, double dx)
+{
+    int todo = 0;
+
+    for (int i = 0; i < _width; i++) {
+        double x = x0 + i * dx;
+        // 新的列落在旧网格的某一列上时直接复用，平移整数个像素时只有新露出的列需要求值
+        if (_has_samples) {
+            double j = (x - _x0) / _dx;
+            long col = lround(j);
+            if ((col >= 0) && (col < _width) && (fabs(j - col) < 1e-6)) {
+                _samples_next[i] = _samples[col];
+                continue;
+            }
+        }
+        _batch[todo] = (float)x;
+        _batch_col[todo++] = i;
+    }
+
+    _expr.evalBatch(_batch, _batch, todo);
+    for (int k = 0; k < todo; k++) {
+        _samples_next[_batch_col[k]] = _batch[k];
+    }
+
+    float *tmp = _samples;
+    _samples = _samples_next;
+    _samples_next = tmp;
+    _x0 = x0;
+    _dx = dx;
+    _has_samples = true;
+}
+
+void CalcGraph::resetView(void)
+{
+    _has_samples = false;
+    _dy = GRAPH_X_RANGE / _width;
+    _y_center = 0;
+    // 让X=0正好落在一列上，缩放时复用的列才能对齐
+    resample(-(_width / 2) * _dy, _dy);
+    render();
+}
+
+void CalcGraph::zoom(double factor)
+{
+    double dx = _dx * factor;
+    double center = _x0 + (_width / 2) * _dx;
+
+    _dy *= factor;
+    resample(center - (_width / 2) * dx, dx);
+    render();
+}
+
+void CalcGraph::fillRow(int y, lv_color_t color)
+{
+    if ((y < 0) || (y >= _height)) {
+        return;
+    }
+    lv_color_t *p = _canvas_buf + y * _width;
+    for (int x = 0; x < _width; x++) {
+        p[x] = color;
+    }
+}
+
+void CalcGraph::fillColumn(int x, int y0, int y1, lv_color_t color)
+{
+    if (y0 > y1) {
+        int tmp = y0;
+        y0 = y1;
+        y1 = tmp;
+    }
+    if ((x < 0) || (x >= _width) || (y1 < 0) || (y0 >= _height)) {
+        return;
+    }
+    y0 = (y0 < 0) ? 0 : y0;
+    y1 = (y1 >= _height) ? _height - 1 : y1;
+    for (int y = y0; y <= y1; y++) {
+        _canvas_buf[y * _width + x] = color;
+    }
+}
+
+/**
+ * @brief 重新绘制画布
+ * @details 直接写画布缓冲区：背景、网格、坐标轴，再把相邻两列的采样用竖线连起来。
+ *          相邻两点相差超过一屏（如tan的渐近线）时认为曲线不连续，不连线
+ */
+void CalcGraph::render(void)
+{
+    double x1 = _x0 + (_width - 1) * _dx;
+    double y_top = _y_center + (_height / 2) * _dy;
+    double y_bottom = _y_center - (_height / 2) * _dy;
+    double step = graph_grid_step(_width * _dx);
+
+    for (int y = 0; y < _height; y++) {
+        fillRow(y, GRAPH_BG_COLOR);
+    }
+
+    // ========== 网格和坐标轴 ==========
+    for (double gx = ceil(_x0 / step) * step; gx <= x1; gx += step) {
+        fillColumn((int)lround((gx - _x0) / _dx), 0, _height - 1, GRAPH_GRID_COLOR);
+    }
+    step = graph_grid_step(_width * _dy);
+    for (double gy = ceil(y_bottom / step) * step; gy <= y_top; gy += step) {
+        fillRow((int)lround((y_top - gy) / _dy), GRAPH_GRID_COLOR);
+    }
+    if ((_x0 <= 0) && (x1 >= 0)) {
+        fillColumn((int)lround(-_x0 / _dx), 0, _height - 1, GRAPH_AXIS_COLOR);
+    }
+    if ((y_bottom <= 0) && (y_top >= 0)) {
+        fillRow((int)lround(y_top / _dy), GRAPH_AXIS_COLOR);
+    }
+
+    // ========== 曲线 ==========
+    bool has_prev = false;
+    int prev = 0;
+    for (int x = 0; x < _width; x++) {
+        float value = _samples[x];
+        if (!isfinite(value)) {
+            has_prev = false;
+            continue;
+        }
+        // 限制在画布上下各一屏以内，避免极大值转换成int时溢出
+        double py = (y_top - value) / _dy;
+        py = (py < -_height) ? -_height : (py > 2 * _height) ? 2 * _height : py;
+        int cur = (int)lround(py);
+        if (has_prev && (abs(cur - prev) < _height)) {
+            fillColumn(x, prev, cur, GRAPH_CURVE_COLOR);
+        } else {
+            fillColumn(x, cur, cur, GRAPH_CURVE_COLOR);
+        }
+        // 线宽两个像素
+        fillColumn(x, cur - 1, cur, GRAPH_CURVE_COLOR);
+        prev = cur;
+        has_prev = true;
+    }
+
+    lv_label_set_text_fmt(_range_label, "X: %.4g ~ %.4g   Y: %.4g ~ %.4g", _x0, x1, y_bottom, y_top);
+    lv_obj_invalidate(_canvas);
+}
+
+/**
+ * @brief 画布拖动事件：横向平移整数个像素列，纵向平移只重新绘制
+ */
+void CalcGraph::canvas_event_cb(lv_event_t *e)
+{
+    CalcGraph *graph = (CalcGraph *)lv_event_get_user_data(e);
+    lv_point_t vect;
+
+    lv_indev_get_vect(lv_indev_get_act(), &vect);
+    if ((vect.x == 0) && (vect.y == 0)) {
+        return;
+    }
+
+    graph->_y_center += vect.y * graph->_dy;
+    if (vect.x != 0) {
+        graph->resample(graph->_x0 - vect.x * graph->_dx, graph->_dx);
+    }
+    graph->render();
+}
+
+void CalcGraph::close_async_cb(void *user_data)
+{
+    ((CalcGraph *)user_data)->close();
+}
+
+/**
+ * @brief 工具栏按钮事件
+ */
+void CalcGraph::button_event_cb(lv_event_t *e)
+{
+    CalcGraph *graph = (CalcGraph *)lv_event_get_user_data(e);
+    lv_obj_t *toolbar = lv_event_get_target(e);
+
+    switch (lv_btnmatrix_get_selected_btn(toolbar)) {
+    case 0: // - 缩小
+        graph->zoom(GRAPH_ZOOM_STEP);
+        break;
+    case 1: // + 放大
+        graph->zoom(1.0 / GRAPH_ZOOM_STEP);
+        break;
+    case 2: // 复位
+        graph->resetView();
+        break;
+    case 3: // 关闭，不能在工具栏自己的事件中删除它的父对象，推迟到事件处理之后
+        lv_async_call(close_async_cb, graph);
+        break;
+    default:
+        break;
+    }
+}
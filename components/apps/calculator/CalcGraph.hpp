@@ -0,0 +1,77 @@
+/**
+ * @file CalcGraph.hpp
+ * @brief 计算器函数绘图视图
+ * @details 把含自变量X的公式画成 y=f(X) 曲线，支持拖动平移和缩放
+ */
+
+#pragma once
+
+#include "lvgl.h"
+#include "CalcExpr.hpp"
+
+/**
+ * @brief 函数绘图视图
+ * @details 每个画布像素列保存一个采样值。公式只在打开时编译一次，
+ *          平移和缩放时先从已有采样中找出仍落在像素列上的点直接复用，
+ *          只对新露出的列调用CalcExpr::evalBatch批量求值，
+ *          竖直方向的平移和缩放只需要重新绘制，不需要重新求值
+ */
+class CalcGraph {
+public:
+    CalcGraph();
+    ~CalcGraph();
+
+    /**
+     * @brief 打开绘图视图
+     * @param parent 父对象
+     * @param width 视图宽度
+     * @param height 视图高度
+     * @param formula 公式字符串
+     * @param deg 三角函数的参数是否为角度
+     * @return true 打开成功，false 公式无效或内存不足
+     */
+    bool open(lv_obj_t *parent, int width, int height, const char *formula, bool deg);
+
+    /**
+     * @brief 关闭绘图视图并释放画布和采样缓冲区
+     */
+    void close(void);
+
+    bool isOpen(void) const { return _panel != nullptr; }
+
+private:
+    /**
+     * @brief 把采样网格移动到新的横坐标范围
+     * @details 新网格上与旧网格重合的列直接复用旧采样，其余列批量求值
+     * @param x0 第0列的横坐标
+     * @param dx 每个像素对应的横坐标增量
+     */
+    void resample(double x0, double dx);
+
+    void resetView(void);
+    void zoom(double factor);
+    void render(void);
+    void fillRow(int y, lv_color_t color);
+    void fillColumn(int x, int y0, int y1, lv_color_t color);
+
+    static void canvas_event_cb(lv_event_t *e);
+    static void button_event_cb(lv_event_t *e);
+    static void close_async_cb(void *user_data);
+
+    CalcExpr _expr;                ///< 编译后的公式
+    lv_obj_t *_panel;              ///< 视图容器
+    lv_obj_t *_canvas;             ///< 绘图画布
+    lv_obj_t *_range_label;        ///< 坐标范围标签
+    lv_color_t *_canvas_buf;       ///< 画布缓冲区
+    float *_samples;               ///< 每一列的函数值
+    float *_samples_next;          ///< resample时的新采样
+    float *_batch;                 ///< 待求值的横坐标，求值结果原地写回
+    int16_t *_batch_col;           ///< 待求值样本对应的列
+    int _width;
+    int _height;
+    double _x0;                    ///< 第0列的横坐标
+    double _dx;                    ///< 每个像素的横坐标增量
+    double _y_center;              ///< 画布中心的纵坐标
+    double _dy;                    ///< 每个像素的纵坐标增量
+    bool _has_samples;             ///< _samples是否有效
+};
@@ -13,10 +13,10 @@
  */
 
 #include <math.h>      // 数学函数库
-#include <vector>      // STL向量容器
 #include <string>      // STL字符串类
 #include <cstring>     // C字符串处理函数
 #include "Calculator.hpp"
+#include "ui_sound/ui_sound.h"
 
 using namespace std;
 
@@ -40,6 +40,23 @@ LV_IMG_DECLARE(img_app_calculator);
 #define LABEL_COLOR             lv_color_make(100, 100, 100)  ///< 标签文字颜色
 #define LABEL_FORMULA_LEN_MAX   256                            ///< 公式字符串最大长度
 
+// ========== 状态保存相关常量定义 ==========
+
+#define STATE_VERSION           1                              ///< 状态格式版本，格式改变时递增
+#define STATE_HISTORY_LEN_MAX   1024                           ///< 保存的历史记录最大长度（保留最新的记录）
+#define STATE_FLAG_SCIENTIFIC   (1 << 0)                       ///< 科学模式标志
+#define STATE_FLAG_MEMORY       (1 << 1)                       ///< 内存有效标志
+
+/**
+ * @brief 保存的状态头部
+ * @details 其后依次为公式、结果和历史记录三个以'\0'结尾的字符串
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;            ///< 状态格式版本
+    uint8_t flags;              ///< STATE_FLAG_* 标志
+    double memory_value;        ///< 内存中存储的数值
+} calc_state_header_t;
+
 /**
  * @brief 计算器虚拟键盘布局定义
  * @details 定义了8行×5列的按钮布局，包含以下功能分区：
@@ -80,11 +97,12 @@ static const char *keyboard_map[] = {
 
 /**
  * @brief 科学模式计算器虚拟键盘布局定义
- * @details 定义了科学模式下的84×5列的按键布局，包含三角函数和高级函数
+ * @details 定义了科学模式下的84×5列的按键布局，包含三角函数和高级函数，
+ *          以及自变量X：含X的公式按=后打开函数绘图
  */
 static const char *keyboard_map_scientific[] = {
-    // 第1行：内存操作功能区
-    "MC", "MR", "M+", "M-", "MS", "Mv", "\n",
+    // 第1行：内存操作功能区，最后一个键输入绘图用的自变量X
+    "MC", "MR", "M+", "M-", "MS", "X", "\n",
     
     // 第2行：模式切换和清除功能区
     "2nd", "pi", "e", "C", LV_SYMBOL_BACKSPACE, "\n",
@@ -271,6 +289,11 @@ bool Calculator::run(void)
  */
 bool Calculator::back(void)
 {
+    // 正在显示函数图像时先返回计算器界面
+    if (_graph.isOpen()) {
+        _graph.close();
+        return true;
+    }
     notifyCoreClosed();    // 通知系统核心应用已关闭
 
     return true;
@@ -284,7 +307,7 @@ bool Calculator::back(void)
  */
 bool Calculator::close(void)
 {
-    // 目前无需特殊的关闭处理逻辑
+    _graph.close();        // 释放绘图画布和采样缓冲区
     return true;
 }
 
@@ -300,6 +323,83 @@ bool Calculator::init(void)
     return true;
 }
 
+/**
+ * @brief 保存计算器状态
+ * @details 历史记录过长时只保存最新的记录，从完整的一行开始
+ * @param state 输出的状态数据
+ * @return true 保存成功
+ */
+bool Calculator::saveState(std::vector<uint8_t> &state)
+{
+    calc_state_header_t header = {
+        .version = STATE_VERSION,
+        .flags = (uint8_t)((is_scientific_mode ? STATE_FLAG_SCIENTIFIC : 0) | (has_memory ? STATE_FLAG_MEMORY : 0)),
+        .memory_value = memory_value,
+    };
+    const char *formula = lv_label_get_text(formula_label);
+    const char *result = lv_label_get_text(result_label);
+    const char *history = lv_textarea_get_text(history_label);
+    size_t history_len = strlen(history);
+
+    // 只保留最新的历史记录，从换行处截断
+    if (history_len > STATE_HISTORY_LEN_MAX) {
+        const char *start = strchr(history + history_len - STATE_HISTORY_LEN_MAX, '\n');
+        history = (start != NULL) ? start : history + history_len;
+    }
+
+    state.assign((const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+    state.insert(state.end(), formula, formula + strlen(formula) + 1);
+    state.insert(state.end(), result, result + strlen(result) + 1);
+    state.insert(state.end(), history, history + strlen(history) + 1);
+
+    return true;
+}
+
+/**
+ * @brief 恢复计算器状态
+ * @details 检查版本和字符串结尾，任何一项无效时放弃恢复，保持run()创建的初始界面
+ * @param data 状态数据
+ * @param size 状态数据长度
+ * @return true 恢复成功，false 数据无效
+ */
+bool Calculator::restoreState(const uint8_t *data, size_t size)
+{
+    calc_state_header_t header;
+    const char *text[3] = {};                                 // 公式、结果、历史记录
+    const char *end = (const char *)data + size;
+    const char *p = (const char *)data + sizeof(header);
+
+    if ((size <= sizeof(header)) || (data[0] != STATE_VERSION)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    for (int i = 0; i < 3; i++) {
+        const char *str_end = (const char *)memchr(p, '\0', end - p);
+        if (str_end == NULL) {
+            return false;
+        }
+        text[i] = p;
+        p = str_end + 1;
+    }
+    if ((text[0][0] == '\0') || (strlen(text[0]) >= LABEL_FORMULA_LEN_MAX)) {
+        return false;
+    }
+
+    lv_label_set_text(formula_label, text[0]);
+    formula_len = strlen(text[0]);
+    lv_label_set_text(result_label, text[1]);
+    lv_textarea_set_text(history_label, text[2]);
+
+    memory_value = header.memory_value;
+    has_memory = header.flags & STATE_FLAG_MEMORY;
+    lv_label_set_text(memory_label, has_memory ? "M" : "");
+    is_scientific_mode = header.flags & STATE_FLAG_SCIENTIFIC;
+    lv_btnmatrix_set_map(keyboard, is_scientific_mode ? keyboard_map_scientific : keyboard_map);
+    lv_label_set_text(mode_label, is_scientific_mode ? "SCI" : "DEG");
+
+    return true;
+}
+
 /**
  * @brief 检查当前输入是否以无意义的0开头
  * @details 用于判断是否需要删除前导0，避免出现"007"这样的输入
@@ -392,108 +492,6 @@ bool Calculator::isLegalDot(void)
     return true;
 }
 
-/**
- * @brief 基础计算函数
- * @details 使用栈算法计算包含四则运算和百分比的数学表达式
- *          算法流程：
- *          1. 遍历输入字符串，解析数字（包括小数）
- *          2. 遇到运算符时，根据前一个运算符的优先级进行计算
- *          3. 加减法直接入栈，乘除法立即计算
- *          4. 最后将栈中所有数值相加得到结果
- * @param input 输入的数学表达式字符串
- * @return 计算结果
- */
-double Calculator::calculate(const char *input)
-{
-    vector<double> stk;         // 数字栈，用于存储待计算的数值
-    int input_len = strlen(input);  // 输入字符串长度
-    double num = 0;             // 当前解析的数字
-    bool dot_flag = false;      // 小数点标记
-    int dot_len = 0;            // 小数位数计数器
-    char pre_sign = '+';        // 前一个运算符，默认为正号
-
-    // 遍历输入字符串进行解析和计算
-    for (int i = 0; i < input_len; i++) {
-        if (input[i] == '.') {
-            // 遇到小数点，设置小数标记
-            dot_flag = true;
-            dot_len = 0;
-        }
-        else if (isdigit(input[i])) {
-            // 解析数字字符
-            if (!dot_flag) {
-                // 整数部分：num = num * 10 + 当前数字
-                num = num * 10 + input[i] - '0';
-            }
-            else {
-                // 小数部分：累加小数位
-                num += (input[i] - '0') / pow(10.0, ++dot_len);
-            }
-        }
-        else if (input[i] == '%') {
-            // 百分号：将数字除以100
-            num /= 100.0;
-        }
-        else if (i != input_len - 1) {
-            // 遇到运算符（非最后一个字符）
-            dot_flag = false;
-            dot_len = 0;
-            
-            // 根据前一个运算符进行计算
-            switch (pre_sign) {
-                case '+':
-                    stk.push_back(num);     // 加法：直接入栈
-                    break;
-                case '-':
-                    stk.push_back(-num);    // 减法：负数入栈
-                    break;
-                case 'x':
-                    stk.back() *= num;      // 乘法：与栈顶元素相乘
-                    break;
-                default:  // 除法
-                    if (num != 0) {
-                        stk.back() /= num;  // 栈顶元素除以当前数字
-                    }
-                    else {
-                        return 0;           // 除零错误，返回0
-                    }
-            }
-            num = 0;                        // 重置当前数字
-            pre_sign = input[i];            // 更新运算符
-        }
-
-        // 处理最后一个数字
-        if (i == input_len - 1) {
-            switch (pre_sign) {
-                case '+':
-                    stk.push_back(num);
-                    break;
-                case '-':
-                    stk.push_back(-num);
-                    break;
-                case 'x':
-                    stk.back() *= num;
-                    break;
-                default:  // 除法
-                    if (num != 0) {
-                        stk.back() /= num;
-                    }
-                    else {
-                        return 0;
-                    }
-            }
-            num = 0;
-        }
-    }
-
-    // 将栈中所有数值相加得到最终结果
-    for (int i = 0; i < stk.size(); i++) {
-        num += stk.at(i);
-    }
-
-    return num;
-}
-
 /**
  * @brief 角度转弧度
  * @details 将角度制的角度值转换为弧度制，用于三角函数计算
@@ -518,364 +516,23 @@ double Calculator::radToDeg(double rad)
     return rad * 180.0 / M_PI;
 }
 
-/**
- * @brief 应用科学函数计算
- * @details 根据函数名称对给定值执行相应的科学函数运算
- *          支持三角函数、对数函数、指数函数等
- *          三角函数会根据当前角度模式进行角度/弧度转换
- * @param func 函数名称字符串（如"sin", "cos", "ln", "log"等）
- * @param value 输入的数值
- * @return 函数运算结果，如果函数名称不识别则返回原值
- */
-double Calculator::applyFunction(const char *func, double value)
-{
-    // 三角函数 - 根据角度模式进行转换
-    if (strcmp(func, "sin") == 0) {
-        return sin(angle_mode == ANGLE_DEG ? degToRad(value) : value);
-    } else if (strcmp(func, "cos") == 0) {
-        return cos(angle_mode == ANGLE_DEG ? degToRad(value) : value);
-    } else if (strcmp(func, "tan") == 0) {
-        return tan(angle_mode == ANGLE_DEG ? degToRad(value) : value);
-    } 
-    // 对数函数
-    else if (strcmp(func, "ln") == 0) {
-        return log(value);      // 自然对数（以e为底）
-    } else if (strcmp(func, "log") == 0) {
-        return log10(value);    // 常用对数（以10为底）
-    } 
-    // 根式函数
-    else if (strcmp(func, "sqrt") == 0 || strcmp(func, "√") == 0) {
-        return sqrt(value);     // 平方根
-    } 
-    // 指数函数
-    else if (strcmp(func, "exp") == 0) {
-        return exp(value);      // e的x次幂
-    }
-    
-    // 未知函数名称，返回原值
-    return value;
-}
-
 /**
  * @brief 科学计算表达式求值函数
- * @details 处理包含各种科学函数、数学常数、括号和复杂运算符的完整数学表达式
- *          支持复杂表达式如：sqrt(4)+8x2-(3-1)+log(10)+|-1|
- *          支持的功能：
- *          1. 数学常数替换（π、e）
- *          2. 幂运算处理（^）
- *          3. 自然对数和常用对数（ln、log）
- *          4. 三角函数计算（sin、cos、tan，支持角度/弧度模式）
- *          5. 平方根函数（sqrt）
- *          6. 绝对值运算（|x|）
- *          7. 普通括号表达式计算（如 (7-3) * 2）
- *          8. 其他科学函数（exp等）
- *          算法采用多步骤递归下降解析和字符串替换相结合的方式，
- *          按照数学运算优先级依次处理各种函数和运算符
+ * @details 把公式编译成字节码后求值，支持的语法见CalcExpr
+ *          编译和求值都在_expr内部的定长缓冲区中完成，不分配内存，
+ *          因此可以在每次按键时调用以实时预览结果
  * @param input 包含各种科学函数、常数和括号的完整数学表达式字符串
- * @return 计算结果
+ * @return 计算结果，语法错误时为NaN
  */
 double Calculator::evaluateScientific(const char *input)
 {
-    std::string expr = input;
-    
-    // 第一步：替换数学常数
-    size_t pos = 0;
-    // 替换圆周率π
-    while ((pos = expr.find("pi", pos)) != std::string::npos) {
-        expr.replace(pos, 2, std::to_string(M_PI));
-        pos += std::to_string(M_PI).length();
-    }
-    
-    pos = 0;
-    // 替换自然常数e（需要避免与exp函数冲突）
-    while ((pos = expr.find("e", pos)) != std::string::npos) {
-        // 确保不是"exp"函数的一部分
-        if (pos == 0 || (expr[pos-1] != 'x' && (pos < 2 || expr.substr(pos-2, 3) != "exp"))) {
-            expr.replace(pos, 1, std::to_string(M_E));
-            pos += std::to_string(M_E).length();
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第二步：处理幂运算（^）
-    pos = 0;
-    while ((pos = expr.find("^", pos)) != std::string::npos) {
-        // 寻找底数（^号前的数字）
-        size_t start = pos;
-        while (start > 0 && (isdigit(expr[start-1]) || expr[start-1] == '.')) {
-            start--;
-        }
-        
-        // 寻找指数（^号后的数字）
-        size_t end = pos + 1;
-        while (end < expr.length() && (isdigit(expr[end]) || expr[end] == '.')) {
-            end++;
-        }
-        
-        // 如果找到了完整的底数和指数，进行幂运算
-        if (start < pos && end > pos + 1) {
-            double base = std::stod(expr.substr(start, pos - start));       // 底数
-            double exponent = std::stod(expr.substr(pos + 1, end - pos - 1)); // 指数
-            double result = pow(base, exponent);                             // 计算结果
-            
-            // 将幂运算结果替换回原表达式
-            expr.replace(start, end - start, std::to_string(result));
-            pos = start + std::to_string(result).length();
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第三步：处理mod取模运算
-    pos = 0;
-    while ((pos = expr.find("mod", pos)) != std::string::npos) {
-        // 寻找左操作数（mod前的数字）
-        size_t start = pos;
-        while (start > 0 && (isdigit(expr[start-1]) || expr[start-1] == '.')) {
-            start--;
-        }
-        
-        // 寻找右操作数（mod后的数字）
-        size_t end = pos + 3; // "mod"的长度
-        while (end < expr.length() && (isdigit(expr[end]) || expr[end] == '.')) {
-            end++;
-        }
-        
-        // 如果找到了完整的左右操作数，进行取模运算
-        if (start < pos && end > pos + 3) {
-            double left = std::stod(expr.substr(start, pos - start));
-            double right = std::stod(expr.substr(pos + 3, end - pos - 3));
-            if (right != 0) { // 防止除零错误
-                double result = fmod(left, right); // 计算取模结果
-                expr.replace(start, end - start, std::to_string(result));
-                pos = start + std::to_string(result).length();
-            } else {
-                pos++;
-            }
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第四步：处理自然对数函数ln()
-    pos = 0;
-    while ((pos = expr.find("ln(", pos)) != std::string::npos) {
-        size_t paren_count = 1;     // 括号计数器，用于匹配嵌套括号
-        size_t end = pos + 3;       // 从"ln("后开始查找
-        
-        // 找到与左括号匹配的右括号
-        while (end < expr.length() && paren_count > 0) {
-            if (expr[end] == '(') paren_count++;        // 遇到左括号，计数器+1
-            else if (expr[end] == ')') paren_count--;   // 遇到右括号，计数器-1
-            end++;
-        }
-        
-        // 如果找到了匹配的括号对
-        if (paren_count == 0) {
-            // 提取括号内的表达式
-            std::string inner = expr.substr(pos + 3, end - pos - 4);
-            // 递归计算括号内表达式的值
-            double inner_val = evaluateScientific(inner.c_str());
-            // 计算自然对数
-            double result = log(inner_val);
-            // 将整个ln()函数替换为计算结果
-            expr.replace(pos, end - pos, std::to_string(result));
-            pos += std::to_string(result).length();
-        } else {
-            pos++;  // 如果括号不匹配，继续向前查找
-        }
-    }
-    
-    // 第五步：处理常用对数函数log()
-    pos = 0;
-    while ((pos = expr.find("log(", pos)) != std::string::npos) {
-        size_t paren_count = 1;     // 括号计数器
-        size_t end = pos + 4;       // 从"log("后开始查找
-        
-        // 找到与左括号匹配的右括号
-        while (end < expr.length() && paren_count > 0) {
-            if (expr[end] == '(') paren_count++;
-            else if (expr[end] == ')') paren_count--;
-            end++;
-        }
-        
-        // 如果找到了匹配的括号对
-        if (paren_count == 0) {
-            // 提取括号内的表达式
-            std::string inner = expr.substr(pos + 4, end - pos - 5);
-            // 递归计算括号内表达式的值
-            double inner_val = evaluateScientific(inner.c_str());
-            // 计算以10为底的对数
-            double result = log10(inner_val);
-            // 将整个log()函数替换为计算结果
-            expr.replace(pos, end - pos, std::to_string(result));
-            pos += std::to_string(result).length();
-        } else {
-            pos++;  // 如果括号不匹配，继续向前查找
-        }
-    }
-    
-    // 第六步：处理三角函数 sin()、cos()、tan()
-    std::vector<std::string> trig_funcs = {"sin(", "cos(", "tan("};
-    for (const auto& func : trig_funcs) {
-        pos = 0;
-        while ((pos = expr.find(func, pos)) != std::string::npos) {
-            size_t paren_count = 1;
-            size_t end = pos + func.length();
-            
-            while (end < expr.length() && paren_count > 0) {
-                if (expr[end] == '(') paren_count++;
-                else if (expr[end] == ')') paren_count--;
-                end++;
-            }
-            
-            if (paren_count == 0) {
-                std::string inner = expr.substr(pos + func.length(), end - pos - func.length() - 1);
-                double inner_val = evaluateScientific(inner.c_str());
-                double result;
-                
-                if (func == "sin(") {
-                    result = sin(angle_mode == ANGLE_DEG ? degToRad(inner_val) : inner_val);
-                } else if (func == "cos(") {
-                    result = cos(angle_mode == ANGLE_DEG ? degToRad(inner_val) : inner_val);
-                } else { // tan
-                    result = tan(angle_mode == ANGLE_DEG ? degToRad(inner_val) : inner_val);
-                }
-                
-                expr.replace(pos, end - pos, std::to_string(result));
-                pos += std::to_string(result).length();
-            } else {
-                pos++;
-            }
-        }
-    }
-    
-    // 第七步：处理平方根函数 sqrt()
-    pos = 0;
-    while ((pos = expr.find("sqrt(", pos)) != std::string::npos) {
-        size_t paren_count = 1;
-        size_t end = pos + 5; // "sqrt("的长度
-        
-        while (end < expr.length() && paren_count > 0) {
-            if (expr[end] == '(') paren_count++;
-            else if (expr[end] == ')') paren_count--;
-            end++;
-        }
-        
-        if (paren_count == 0) {
-            std::string inner = expr.substr(pos + 5, end - pos - 6);
-            double inner_val = evaluateScientific(inner.c_str());
-            double result = sqrt(inner_val);
-            expr.replace(pos, end - pos, std::to_string(result));
-            pos += std::to_string(result).length();
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第八步：处理绝对值 |x|
-    pos = 0;
-    while ((pos = expr.find("|", pos)) != std::string::npos) {
-        size_t end = pos + 1;
-        // 寻找下一个 |
-        while (end < expr.length() && expr[end] != '|') {
-            end++;
-        }
-        
-        if (end < expr.length()) {
-            std::string inner = expr.substr(pos + 1, end - pos - 1);
-            double inner_val = evaluateScientific(inner.c_str());
-            double result = fabs(inner_val);
-            expr.replace(pos, end - pos + 1, std::to_string(result));
-            pos += std::to_string(result).length();
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第九步：处理阶乘运算 n!
-    pos = 0;
-    while ((pos = expr.find("!", pos)) != std::string::npos) {
-        // 找到!前面的数字
-        size_t start = pos;
-        while (start > 0 && (isdigit(expr[start-1]) || expr[start-1] == '.')) {
-            start--;
-        }
-        
-        if (start < pos) {
-            double num = std::stod(expr.substr(start, pos - start));
-            // 计算阶乘
-            if (num >= 0 && num == floor(num) && num <= 170) {
-                double factorial = 1;
-                for (int i = 2; i <= (int)num; i++) {
-                    factorial *= i;
-                }
-                expr.replace(start, pos - start + 1, std::to_string(factorial));
-                pos = start + std::to_string(factorial).length();
-            } else {
-                pos++;
-            }
-        } else {
-            pos++;
-        }
-    }
-    
-    // 第十步：处理普通括号表达式 ()
-    pos = 0;
-    while ((pos = expr.find("(", pos)) != std::string::npos) {
-        // 确保不是函数调用的括号（如 ln(、log(、sin( 等）
-        bool is_function = false;
-        if (pos >= 2) {
-            std::string before = expr.substr(pos-2, 2);
-            if (before == "ln" || before == "og" || before == "in" || before == "os" || before == "an" || before == "rt") {
-                pos++;
-                continue;
-            }
-        }
-        if (pos >= 3) {
-            std::string before3 = expr.substr(pos-3, 3);
-            if (before3 == "log" || before3 == "sin" || before3 == "cos" || before3 == "tan" || before3 == "exp") {
-                pos++;
-                continue;
-            }
-        }
-        if (pos >= 4) {
-            std::string before4 = expr.substr(pos-4, 4);
-            if (before4 == "sqrt") {
-                pos++;
-                continue;
-            }
-        }
-        
-        size_t paren_count = 1;     // 括号计数器，用于匹配嵌套括号
-        size_t end = pos + 1;       // 从"("后开始查找
-        
-        // 找到与左括号匹配的右括号
-        while (end < expr.length() && paren_count > 0) {
-            if (expr[end] == '(') paren_count++;        // 遇到左括号，计数器+1
-            else if (expr[end] == ')') paren_count--;   // 遇到右括号，计数器-1
-            end++;
-        }
-        
-        // 如果找到了匹配的括号对
-        if (paren_count == 0) {
-            // 提取括号内的表达式
-            std::string inner = expr.substr(pos + 1, end - pos - 2);
-            // 递归计算括号内表达式的值
-            double inner_val = evaluateScientific(inner.c_str());
-            // 将整个括号表达式替换为计算结果
-            expr.replace(pos, end - pos, std::to_string(inner_val));
-            pos += std::to_string(inner_val).length();
-        } else {
-            pos++;  // 如果括号不匹配，继续向前查找
-        }
+    if (!_expr.compile(input, angle_mode == ANGLE_DEG)) {
+        return NAN;
     }
-    
-    // 第十一步：使用基础计算器处理剩余的四则运算
-    return calculate(expr.c_str());
+    return _expr.eval();
 }
 
+
 /**
  * @brief 键盘事件回调函数
  * @details 处理计算器按键矩阵的所有用户交互事件
@@ -929,6 +586,10 @@ void Calculator::keyboard_event_cb(lv_event_t *e)
             }
         }
     } 
+    // 按下时播放按键音，不等到松开
+    else if (code == LV_EVENT_PRESSED) {
+        ui_sound_play(UI_SOUND_KEY);
+    }
     // 处理按键值改变事件 - 执行按键对应的功能
     else if (code == LV_EVENT_VALUE_CHANGED) {
         int btn_id = lv_btnmatrix_get_selected_btn(app->keyboard);  // 获取被按下的按键ID
@@ -966,34 +627,46 @@ void Calculator::keyboard_event_cb(lv_event_t *e)
         case 2: // M+ - 内存加法 (Memory Add)
             if (app->isStartNum()) {
                 // 计算当前表达式的值并加到内存中
-                res_num = app->calculate(lv_label_get_text(app->formula_label));
-                app->memory_value += res_num;
-                app->has_memory = true;
-                lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                res_num = app->evaluateScientific(lv_label_get_text(app->formula_label));
+                if (isfinite(res_num)) {
+                    app->memory_value += res_num;
+                    app->has_memory = true;
+                    lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                }
             }
             break;
             
         case 3: // M- - 内存减法 (Memory Subtract)
             if (app->isStartNum()) {
                 // 计算当前表达式的值并从内存中减去
-                res_num = app->calculate(lv_label_get_text(app->formula_label));
-                app->memory_value -= res_num;
-                app->has_memory = true;
-                lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                res_num = app->evaluateScientific(lv_label_get_text(app->formula_label));
+                if (isfinite(res_num)) {
+                    app->memory_value -= res_num;
+                    app->has_memory = true;
+                    lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                }
             }
             break;
             
         case 4: // MS - 内存存储 (Memory Store)
             if (app->isStartNum()) {
                 // 计算当前表达式的值并存储到内存中
-                res_num = app->calculate(lv_label_get_text(app->formula_label));
-                app->memory_value = res_num;
-                app->has_memory = true;
-                lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                res_num = app->evaluateScientific(lv_label_get_text(app->formula_label));
+                if (isfinite(res_num)) {
+                    app->memory_value = res_num;
+                    app->has_memory = true;
+                    lv_label_set_text(app->memory_label, "M");  // 显示内存指示符
+                }
             }
             break;
             
-        case 5: // Mv - 内存查看 (Memory View) - 当前未使用
+        case 5: // Mv - 内存查看 (Memory View) - 当前未使用；科学模式下为自变量X
+            if (app->is_scientific_mode) {
+                if (app->isStartZero()) {
+                    lv_label_cut_text(app->formula_label, --(app->formula_len), 1);
+                }
+                lv_label_ins_text(app->formula_label, app->formula_len++, "X");
+            }
             break;
             
         // === 科学模式切换按键 ===
@@ -1280,26 +953,44 @@ void Calculator::keyboard_event_cb(lv_event_t *e)
         }
 
         // === 计算结果显示逻辑 ===
-        if (calculate_flag) {
+        // 公式每次变化都重新编译求值，实时预览结果；未输完的公式（如"3+"）保留上一次的预览
+        if (calculate_flag || (btn_id >= 5)) {
             // 设置公式标签为大字体
             lv_obj_set_style_text_font(app->formula_label, LABEL_FONT_BIG, 0);
 
             // 使用科学计算函数进行求值
             res_num = app->evaluateScientific(lv_label_get_text(app->formula_label));
-            
+
+            if (app->_expr.hasVariable()) {
+                // 含自变量的公式没有单一结果，按=时画出函数图像
+                snprintf(res_str, sizeof(res_str) - 1, "f(X)");
+                res_num = 0;
+            }
+            else if (!isfinite(res_num)) {
+                snprintf(res_str, sizeof(res_str) - 1, "Error");
+            }
             // 格式化结果显示：整数显示为整数，小数显示为6位小数
-            if (int(res_num) == res_num && res_num < 1000000) {
+            else if (res_num == floor(res_num) && fabs(res_num) < 1000000) {
                 snprintf(res_str, sizeof(res_str) - 1, "%ld", long(res_num));
             }
             else {
                 snprintf(res_str, sizeof(res_str) - 1, "%.6f", res_num);
             }
-            
+
             // 更新结果标签显示
-            lv_label_set_text_fmt(app->result_label, "= %s", res_str);
+            if (isfinite(res_num) || equal_flag) {
+                lv_label_set_text_fmt(app->result_label, "= %s", res_str);
+            }
             lv_obj_set_style_text_font(app->result_label, LABEL_FONT_SMALL, 0);
         }
 
+        // === 含自变量的公式按等号时打开函数绘图 ===
+        if (equal_flag && app->_expr.hasVariable()) {
+            app->_graph.open(lv_scr_act(), app->_width, app->_height, lv_label_get_text(app->formula_label),
+                             app->angle_mode == ANGLE_DEG);
+            equal_flag = false;
+        }
+
         // === 等号操作的特殊处理 ===
         if (equal_flag) {
             // 切换字体大小：结果显示为大字体
@@ -1313,10 +1004,12 @@ void Calculator::keyboard_event_cb(lv_event_t *e)
             lv_textarea_set_cursor_pos(app->history_label, strlen(lv_textarea_get_text(app->history_label)));
             lv_textarea_add_text(app->history_label, history_str);
 
-            // 将结果设置为新的输入起点，为下次计算做准备
-            lv_label_set_text_fmt(app->formula_label, "%s", res_str);
-            lv_obj_set_style_text_font(app->formula_label, LABEL_FONT_SMALL, 0);  // 公式区域改为小字体
-            app->formula_len = strlen(res_str);                                    // 更新公式长度
+            // 将结果设置为新的输入起点，为下次计算做准备；出错时保留公式以便修改
+            if (isfinite(res_num)) {
+                lv_label_set_text_fmt(app->formula_label, "%s", res_str);
+                lv_obj_set_style_text_font(app->formula_label, LABEL_FONT_SMALL, 0);  // 公式区域改为小字体
+                app->formula_len = strlen(res_str);                                    // 更新公式长度
+            }
         }
     }
 }
@@ -11,6 +11,8 @@
 
 #include "lvgl.h"
 #include "esp_brookesia.hpp"
+#include "CalcExpr.hpp"
+#include "CalcGraph.hpp"
 
 /**
  * @brief 角度模式枚举
@@ -69,6 +71,23 @@ public:
      */
     bool init(void) override;
 
+    /**
+     * @brief 保存计算器状态
+     * @details 关闭时保存公式、结果、历史记录和内存，由系统核心保存到闪存，重启后仍可恢复
+     * @param state 输出的状态数据
+     * @return true 保存成功
+     */
+    bool saveState(std::vector<uint8_t> &state) override;
+
+    /**
+     * @brief 恢复计算器状态
+     * @details 在run()创建界面之后调用，将saveState()保存的状态应用到界面上
+     * @param data 状态数据
+     * @param size 状态数据长度
+     * @return true 恢复成功，false 数据无效
+     */
+    bool restoreState(const uint8_t *data, size_t size) override;
+
     // ========== 输入验证函数 ==========
     
     /**
@@ -101,31 +120,14 @@ public:
 
     // ========== 计算引擎函数 ==========
     
-    /**
-     * @brief 基础计算函数
-     * @details 计算包含基本四则运算和百分比的表达式
-     * @param input 输入的数学表达式字符串
-     * @return 计算结果
-     */
-    double calculate(const char *input);
-    
     /**
      * @brief 科学计算函数
-     * @details 计算包含科学函数、常数等复杂表达式
+     * @details 计算包含科学函数、常数等复杂表达式，不分配内存
      * @param input 输入的科学计算表达式字符串
-     * @return 计算结果
+     * @return 计算结果，语法错误时为NaN
      */
     double evaluateScientific(const char *input);
     
-    /**
-     * @brief 应用科学函数
-     * @details 对给定值应用指定的科学函数（如sin, cos, ln等）
-     * @param func 函数名称字符串
-     * @param value 输入值
-     * @return 函数计算结果
-     */
-    double applyFunction(const char *func, double value);
-    
     /**
      * @brief 角度转弧度
      * @details 将角度值转换为弧度值，用于三角函数计算
@@ -162,6 +164,9 @@ public:
     bool is_scientific_mode;       ///< 是否处于科学模式（显示科学函数键盘）
 
 private:
+    CalcExpr _expr;                ///< 公式编译结果，每次求值时重新编译
+    CalcGraph _graph;              ///< 函数绘图视图
+
     /**
      * @brief 按键事件回调函数
      * @details 处理虚拟键盘上所有按键的点击事件
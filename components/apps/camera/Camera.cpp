@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <algorithm>
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_check.h"
@@ -27,7 +28,41 @@
 #include "app_video.h"
 #include "app_pedestrian_detect.h"
 #include "app_humanface_detect.h"
+#include "app_detect_models.hpp"
 #include "app_camera_pipeline.hpp"
+#include "app_detect_tracker.hpp"
+#include "app_detect_export.hpp"
+#include "app_overlay.hpp"
+#include "app_capture.hpp"
+#include "app_recorder.hpp"
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+#include "app_preview_zoom.hpp"
+#endif
+#if CONFIG_CAMERA_UVC
+#include "app_uvc.hpp"
+#endif
+#include "app_latency_trace.h"
+#include "app_soft_3a.h"
+#include "app_autofocus.h"
+#include "app_isp_tuning.h"
+#include "app_camera_service.h"
+#include "app_motion_gate.h"
+#if CONFIG_CAMERA_FACE_RECOGNITION
+#include "app_face_recognition.hpp"
+#endif
+#if CONFIG_CAMERA_CODE_SCAN
+#include "app_code_scan.hpp"
+#endif
+#if CONFIG_CAMERA_TIMELAPSE
+#include "app_timelapse.hpp"
+#endif
+#if CONFIG_CAMERA_PEOPLE_COUNT
+#include "app_people_count.hpp"
+#endif
+#include "settings_store/settings_store.h"
+#include "media_arena/media_arena.h"
+#include "task_config/task_config.h"
+#include "perf_log/perf_log.h"
 #include "Camera.hpp"
 #include "ui/ui.h"
 
@@ -35,7 +70,33 @@
 
 #define CAMERA_INIT_TASK_WAIT_MS            (1000)
 #define DETECT_NUM_MAX                      (10)
+#define DETECT_RECV_TIMEOUT_MS              (100)
+#define TRACKER_IOU_THRESHOLD               (0.3f)
+#define TRACKER_MAX_MISSED                  (2)
+#define TRACKER_MIN_HITS                    (2)
+#define TRACKER_MAX_EXTRAPOLATE_MS          (300)
+// Each recognized face costs one embedding model run
+#define FACE_RECOGNITION_MAX_FACES          (2)
 #define FPS_PRINT                           (1)
+// One more than the display sink holds: the pending and the shown copy, or only the shown one
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+#define PREVIEW_ZOOM_BUF_NUM                (3)
+#else
+#define PREVIEW_ZOOM_BUF_NUM                (2)
+#endif
+
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+#define DETECT_PRESCALE_DIV                 (CONFIG_CAMERA_DETECT_PPA_PRESCALE_DIV)
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE_RGB888
+#define DETECT_PRESCALE_BYTES_PER_PIXEL     (3)
+#define DETECT_PRESCALE_PPA_CM              (PPA_SRM_COLOR_MODE_RGB888)
+#define DETECT_PRESCALE_PIX_TYPE            (dl::image::DL_IMAGE_PIX_TYPE_RGB888)
+#else
+#define DETECT_PRESCALE_BYTES_PER_PIXEL     (2)
+#define DETECT_PRESCALE_PPA_CM              (PPA_SRM_COLOR_MODE_RGB565)
+#define DETECT_PRESCALE_PIX_TYPE            (dl::image::DL_IMAGE_PIX_TYPE_RGB565)
+#endif
+#endif
 
 using namespace std;
 
@@ -44,41 +105,150 @@ typedef enum {
     CAMERA_EVENT_DELETE = BIT(1),
     CAMERA_EVENT_PED_DETECT = BIT(2),
     CAMERA_EVENT_HUMAN_DETECT = BIT(3),
+    CAMERA_EVENT_CODE_SCAN = BIT(4),
 } camera_event_id_t;
 
+// Modes feeding frames to the detect task
+#define CAMERA_EVENT_DETECT_MODES           (CAMERA_EVENT_PED_DETECT | CAMERA_EVENT_HUMAN_DETECT | CAMERA_EVENT_CODE_SCAN)
+
 LV_IMG_DECLARE(img_app_camera);
 
 static const char *TAG = "Camera";
 
 // AI detection variables
 // static void **detect_buf;
-static vector<vector<int>> detect_bound;
-static vector<vector<int>> detect_keypoints;
-static std::list<dl::detect::result_t> detect_results;
+// Last result received by the frame callback, redrawn until a newer one arrives
+static camera_pipeline_detect_result_t overlay_result;
+#if CONFIG_CAMERA_DETECT_TRACKER
+static app_detect_tracker_t overlay_tracker;
+#endif
+#if CONFIG_CAMERA_PEOPLE_COUNT
+// Only used by the stream task after init, the counts survive closing the app
+static app_people_count_t people_counter;
+#endif
+
+// Inference schedule, written by the UI and read by the stream task
+static volatile uint16_t detect_frame_interval = CONFIG_CAMERA_DETECT_FRAME_INTERVAL;
+static volatile uint16_t detect_min_period_ms = CONFIG_CAMERA_DETECT_MIN_PERIOD_MS;
 static PedestrianDetect *ped_detect = NULL;
 static HumanFaceDetect *hum_detect = NULL;
 static pipeline_handle_t feed_pipeline;
 static pipeline_handle_t detect_pipeline;
+// Both pipelines are SPSC rings: only the detect task may queue feed elements back, so the
+// stream task keeps an element it failed to dispatch here instead of returning it.
+static camera_pipeline_buffer_element *feed_spare_element = NULL;
 
 // Other variables
 static lv_obj_t *btn_label = NULL;
+static lv_obj_t *rec_btn_label = NULL;
+#if CONFIG_CAMERA_TIMELAPSE
+static lv_obj_t *timelapse_btn_label = NULL;
+#endif
 static size_t data_cache_line_size = 0;
 static ppa_client_handle_t ppa_client_srm_handle = NULL;
 static EventGroupHandle_t camera_event_group;
+static bool sensor_probed = false;
+static int sensor_handle = -1;
+// The preview and everything it feeds subscribe as one consumer of the camera service while the app is shown
+static app_camera_service_handle_t camera_subscription = NULL;
+// Unsubscribed while the display is off, subscribed again when it turns on
+static bool camera_display_suspended = false;
+// Set by the shot button, the next frame is handed to the capture service by the stream task
+static bool capture_requested = false;
+
+// Region of the camera frame fed to the detectors, in frame coordinates
+static camera_pipeline_rect_t detect_roi;
+
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+// Motion gate settings, written by the UI and read by the detect task
+static volatile bool motion_gate_enabled = true;
+static volatile uint8_t motion_gate_threshold = CONFIG_CAMERA_DETECT_MOTION_THRESHOLD;
+static volatile uint16_t motion_gate_refresh_ms = CONFIG_CAMERA_DETECT_MOTION_REFRESH_MS;
+// Owned by the detect task
+static app_motion_gate_t motion_gate;
+// Two so a crop can stay in MNP while the next one is written
+static uint16_t *motion_crop_bufs[2] = {NULL, NULL};
+static uint8_t motion_crop_index = 0;
+static EventBits_t motion_gate_mode = 0;
+#endif
+
+#if CONFIG_CAMERA_FACE_RECOGNITION
+// Name to enroll the most confident face of the next face detection as, written by the UI
+static char face_enroll_name[APP_FACE_RECOGNITION_NAME_LEN];
+static volatile bool face_enroll_pending = false;
+static bool face_recognition_ready = false;
+static camera_pipeline_detect_result_t motion_last_result;
+#endif
+
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+#define DISPLAY_SINK_PERIOD_MS              (5)
+
+typedef struct {
+    uint8_t *buf;
+    uint8_t index;              // V4L2 buffer index, or preview buffer index if zoomed
+    bool zoomed;
+    uint32_t frame_seq;
+    uint32_t width;
+    uint32_t height;
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+    camera_pipeline_detect_result_t overlay;
+    bool draw_keypoints;
+#endif
+} camera_display_frame_t;
+
+// `display_pending` is posted by the stream task, `display_current` is owned by the LVGL task
+static portMUX_TYPE display_sink_lock = portMUX_INITIALIZER_UNLOCKED;
+static camera_display_frame_t display_pending;
+static camera_display_frame_t display_current;
+static bool display_sink_enabled = false;
+static lv_timer_t *display_sink_timer = NULL;
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+static app_overlay_layer_t overlay_layer;
+#endif
+#endif
+
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+// Owned by the stream task: detections mapped to the zoomed preview, and the copy the synchronous sink shows
+static camera_pipeline_detect_result_t preview_overlay_result;
+#if !CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+static int preview_shown_index = -1;
+#endif
+#endif
 
 static void camera_video_frame_operation(uint8_t *camera_buf, uint8_t camera_buf_index, 
                                        uint32_t camera_buf_hes, uint32_t camera_buf_ves, 
-                                       size_t camera_buf_len);
+                                       size_t camera_buf_len, void *user_ctx);
+static esp_err_t camera_subscribe(void);
 
 static bool ppa_trans_done_cb(ppa_client_handle_t ppa_client, ppa_event_data_t *event_data, void *user_data);
+static void camera_frame_release_cb(void *user_ctx, uint32_t frame_index);
+static void camera_feed_pipeline_flush(void);
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+static esp_err_t camera_detect_prescale(camera_pipeline_buffer_element *element, uint8_t *camera_buf,
+                                        uint32_t camera_buf_hes, uint32_t camera_buf_ves);
+#endif
+static void camera_detect_store_results(const std::list<dl::detect::result_t> &results, camera_pipeline_detect_result_t *out,
+                                        const dl::image::img_t *img);
+static bool camera_detect_schedule_frame(int64_t now_us);
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+static void camera_display_sink_start(void);
+static void camera_display_sink_stop(void);
+static void camera_display_sink_post(uint8_t *buf, uint8_t index, bool zoomed, uint32_t frame_seq, uint32_t width,
+                                     uint32_t height, const camera_pipeline_detect_result_t *overlay, bool draw_keypoints);
+#endif
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+static bool camera_preview_zoom_render(uint8_t *camera_buf, uint8_t camera_buf_index, uint8_t **buf, uint8_t *index,
+                                       uint32_t *width, uint32_t *height, bool draw_keypoints);
+#endif
 
 Camera::Camera(uint16_t hor_res, uint16_t ver_res):
     ESP_Brookesia_PhoneApp("Camera", &img_app_camera, false),  // auto_resize_visual_area
     _screen_index(SCREEN_CAMERA_SHOT),
     _hor_res(hor_res),
     _ver_res(ver_res),
-    _img_album_dsc_size(hor_res > ver_res ? ver_res : hor_res),
+    _img_album_dsc_size(APP_CAPTURE_THUMB_SIZE),
     _img_album_buffer(NULL),
+    _img_photo_buffer(NULL),
     _camera_init_sem(NULL),
     _camera_ctlr_handle(0)
 {
@@ -95,7 +265,7 @@ bool Camera::run(void)
         _camera_init_sem = xSemaphoreCreateBinary();
         assert(_camera_init_sem != NULL);
 
-        xTaskCreatePinnedToCore((TaskFunction_t)taskCameraInit, "Camera Init", 4096, this, 2, NULL, 0);
+        task_config_create(TASK_CONFIG_CAMERA_INIT, (TaskFunction_t)taskCameraInit, this, NULL);
         if (xSemaphoreTake(_camera_init_sem, pdMS_TO_TICKS(CAMERA_INIT_TASK_WAIT_MS)) != pdTRUE) {
             ESP_LOGE(TAG, "Camera init timeout");
             return false;
@@ -104,13 +274,22 @@ bool Camera::run(void)
         _camera_init_sem = NULL;
     }
 
+    // Instant after the first launch when the models stay resident
+    ESP_ERROR_CHECK(app_detect_models_load());
     ped_detect = get_pedestrian_detect();
-    assert(ped_detect != NULL);
-    
     hum_detect = get_humanface_detect();
-    assert(hum_detect != NULL);
+    if (app_detect_export_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Detection export unavailable");
+    }
 
-    xTaskCreatePinnedToCore((TaskFunction_t)camera_dectect_task, "Camera Detect", 1024 * 8, this, 5, &_detect_task_handle, 1);
+    task_config_create(TASK_CONFIG_CAMERA_DETECT, (TaskFunction_t)camera_dectect_task, this, &_detect_task_handle);
+
+#if CONFIG_CAMERA_AUTOFOCUS
+    // The scene may have changed while the app was closed
+    if (app_autofocus_get_mode() != APP_AUTOFOCUS_MODE_OFF) {
+        app_autofocus_trigger();
+    }
+#endif
 
     xEventGroupSetBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
     xEventGroupClearBits(camera_event_group, CAMERA_EVENT_DELETE);
@@ -118,8 +297,19 @@ bool Camera::run(void)
     // UI initialization
     ui_camera_init();
 
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+    // The canvas gets display sized copies of the frames instead of the V4L2 buffers
+    lv_obj_update_layout(ui_ImageCameraShotImage);
+    if ((app_preview_zoom_init(_hor_res, _ver_res, lv_obj_get_width(ui_ImageCameraShotImage),
+                               lv_obj_get_height(ui_ImageCameraShotImage), PREVIEW_ZOOM_BUF_NUM) != ESP_OK) ||
+            (app_preview_zoom_attach(ui_ImageCameraShotImage) != ESP_OK)) {
+        ESP_LOGW(TAG, "Preview zoom unavailable, showing the full frame");
+    }
+#endif
+
     // The following is the additional UI initialization
-    _img_album_buffer = (uint8_t *)heap_caps_aligned_alloc(128, _img_refresh_dsc.data_size, MALLOC_CAP_SPIRAM);
+    // The album button only shows a thumbnail, shots themselves are kept as JPEG files on the SD card
+    _img_album_buffer = (uint8_t *)media_arena_lend(_img_album_buf_bytes, NULL);
     if (_img_album_buffer == NULL) {
         ESP_LOGE(TAG, "Allocate memory for album buffer failed");
         return false;
@@ -129,8 +319,8 @@ bool Camera::run(void)
             .cf = LV_IMG_CF_TRUE_COLOR,
             .always_zero = 0,
             .reserved = 0,
-            .w = _hor_res,
-            .h = _ver_res,
+            .w = _img_album_dsc_size,
+            .h = _img_album_dsc_size,
         },
         .data_size = _img_album_buf_bytes,
         .data = (const uint8_t *)_img_album_buffer,
@@ -146,14 +336,14 @@ bool Camera::run(void)
     lv_obj_center(_img_album);
     lv_obj_add_event_cb(_img_album, onScreenCameraShotAlbumClick, LV_EVENT_CLICKED, this);
 
+    // The photo is decoded from the last shot when the album is opened
     img_dsc.header.w = _hor_res;
     img_dsc.header.h = _ver_res;
     img_dsc.data_size = _img_refresh_dsc.data_size;
+    img_dsc.data = NULL;
     memcpy(&_img_photo_dsc, &img_dsc, sizeof(lv_img_dsc_t));
-    memcpy(_img_album_buffer, _img_refresh_dsc.data, _img_refresh_dsc.data_size);
     lv_obj_set_width(ui_ImageCameraPhotoImage, _hor_res);
     lv_obj_set_height(ui_ImageCameraPhotoImage, _ver_res);
-    lv_img_set_src(ui_ImageCameraPhotoImage, &_img_photo_dsc);
 
     lv_obj_add_event_cb(ui_ButtonCameraShotBtn, onScreenCameraShotBtnClick, LV_EVENT_CLICKED, this);
 
@@ -179,8 +369,17 @@ bool Camera::run(void)
             lv_obj_add_flag(ui_PanelCameraShotControlBg, LV_OBJ_FLAG_HIDDEN);
             lv_obj_add_flag(camera->_img_album, LV_OBJ_FLAG_HIDDEN);
             camera->_screen_index = SCREEN_CAMERA_AI;
+#if CONFIG_CAMERA_CODE_SCAN
+        } else if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_HUMAN_DETECT) {
+            xEventGroupClearBits(camera_event_group, CAMERA_EVENT_HUMAN_DETECT);
+            xEventGroupSetBits(camera_event_group, CAMERA_EVENT_CODE_SCAN);
+            lv_label_set_text(btn_label, "    Code \n    Scan");
+        } else if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_CODE_SCAN) {
+            xEventGroupClearBits(camera_event_group, CAMERA_EVENT_CODE_SCAN);
+#else
         } else if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_HUMAN_DETECT) {
             xEventGroupClearBits(camera_event_group, CAMERA_EVENT_HUMAN_DETECT);
+#endif
             lv_label_set_text(btn_label, "  Normal \n   Detect");
 
             lv_obj_clear_flag(ui_ButtonCameraShotBtn, LV_OBJ_FLAG_HIDDEN);
@@ -199,12 +398,95 @@ bool Camera::run(void)
 
     }, LV_EVENT_CLICKED, this);
 
+    lv_obj_t *rec_btn = lv_btn_create(ui_ImageCameraShotImage);
+    lv_obj_set_style_bg_color(rec_btn, lv_color_hex(0x808080), LV_PART_MAIN);
+    lv_obj_set_size(rec_btn, 100, 50);
+    rec_btn_label = lv_label_create(rec_btn);
+    lv_obj_set_style_text_font(rec_btn_label, &lv_font_montserrat_16, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_label_set_text(rec_btn_label, "REC");
+    lv_obj_set_style_text_color(rec_btn_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_center(rec_btn_label);
+    lv_obj_align(rec_btn, LV_ALIGN_TOP_RIGHT, -290, 0);
+    lv_obj_add_event_cb(rec_btn, [](lv_event_t *e) {
+        lv_obj_t *btn = lv_event_get_target(e);
+
+        if (app_recorder_is_recording()) {
+            app_recorder_stop(NULL);
+            lv_label_set_text(rec_btn_label, "REC");
+            lv_obj_set_style_bg_color(btn, lv_color_hex(0x808080), LV_PART_MAIN);
+#if CONFIG_CAMERA_TIMELAPSE
+        } else if (app_timelapse_is_running()) {
+            // The stream is off between time-lapse shots
+            ESP_LOGW(TAG, "Stop the time-lapse before recording");
+#endif
+        } else if (app_recorder_start() == ESP_OK) {
+            lv_label_set_text(rec_btn_label, "STOP");
+            lv_obj_set_style_bg_color(btn, lv_color_hex(0xFF0000), LV_PART_MAIN);
+        }
+    }, LV_EVENT_CLICKED, NULL);
+
+#if CONFIG_CAMERA_TIMELAPSE
+    lv_obj_t *timelapse_btn = lv_btn_create(ui_ImageCameraShotImage);
+    lv_obj_set_style_bg_color(timelapse_btn, lv_color_hex(0x808080), LV_PART_MAIN);
+    lv_obj_set_size(timelapse_btn, 100, 50);
+    timelapse_btn_label = lv_label_create(timelapse_btn);
+    lv_obj_set_style_text_font(timelapse_btn_label, &lv_font_montserrat_16, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_label_set_text(timelapse_btn_label, "LAPSE");
+    lv_obj_set_style_text_color(timelapse_btn_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_center(timelapse_btn_label);
+    lv_obj_align(timelapse_btn, LV_ALIGN_TOP_RIGHT, -400, 0);
+    lv_obj_add_event_cb(timelapse_btn, [](lv_event_t *e) {
+        lv_obj_t *btn = lv_event_get_target(e);
+
+        if (app_timelapse_is_running()) {
+            app_timelapse_stop();
+            lv_label_set_text(timelapse_btn_label, "LAPSE");
+            lv_obj_set_style_bg_color(btn, lv_color_hex(0x808080), LV_PART_MAIN);
+        } else if (app_recorder_is_recording()) {
+            ESP_LOGW(TAG, "Stop the recording before the time-lapse");
+        } else if (app_timelapse_start(CONFIG_CAMERA_TIMELAPSE_INTERVAL_S * 1000, CONFIG_CAMERA_TIMELAPSE_SETTLE_FRAMES,
+                                       CONFIG_CAMERA_TIMELAPSE_DIM) == ESP_OK) {
+            lv_label_set_text(timelapse_btn_label, "STOP");
+            lv_obj_set_style_bg_color(btn, lv_color_hex(0xFF0000), LV_PART_MAIN);
+        }
+    }, LV_EVENT_CLICKED, NULL);
+#endif
+
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+    camera_display_sink_start();
+#endif
+
     return true;
 }
 
+// Recording, time-lapse and UVC take their frames from the subscription of the app
+static bool camera_stream_needed_offscreen(void)
+{
+    if (app_recorder_is_recording()) {
+        return true;
+    }
+#if CONFIG_CAMERA_TIMELAPSE
+    if (app_timelapse_is_running()) {
+        return true;
+    }
+#endif
+#if CONFIG_CAMERA_UVC
+    if (app_uvc_is_streaming()) {
+        return true;
+    }
+#endif
+    return false;
+}
+
 bool Camera::pause(void)
 {
+    camera_display_suspended = false;
     xEventGroupClearBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
+    // The stream stops unless another app uses the frames
+    if (camera_subscription) {
+        app_camera_service_unsubscribe(camera_subscription);
+        camera_subscription = NULL;
+    }
     
     return true;
 }
@@ -212,6 +494,27 @@ bool Camera::pause(void)
 bool Camera::resume(void)
 {
     xEventGroupSetBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
+    if (!camera_subscription) {
+        camera_subscribe();
+    }
+
+    return true;
+}
+
+bool Camera::displayStateChanged(ESP_Brookesia_CoreDisplayState_t state)
+{
+    // Paused or closed apps have no subscription, the stream is already stopped unless another app uses it
+    if (state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) {
+        if (camera_subscription && !camera_stream_needed_offscreen()) {
+            ESP_LOGI(TAG, "Display off, stopping the preview");
+            pause();
+            camera_display_suspended = true;
+        }
+    } else if (camera_display_suspended) {
+        ESP_LOGI(TAG, "Display on, restarting the preview");
+        camera_display_suspended = false;
+        resume();
+    }
 
     return true;
 }
@@ -225,29 +528,65 @@ bool Camera::back(void)
 
 bool Camera::close(void)
 {
+    camera_display_suspended = false;
     xEventGroupSetBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
     xEventGroupSetBits(camera_event_group, CAMERA_EVENT_DELETE);
     xEventGroupClearBits(camera_event_group, CAMERA_EVENT_PED_DETECT);
     xEventGroupClearBits(camera_event_group, CAMERA_EVENT_HUMAN_DETECT);
-    
-    app_video_stream_task_stop(_camera_ctlr_handle);
-    app_video_stream_wait_stop();
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_CODE_SCAN);
+
+    if (app_recorder_is_recording()) {
+        app_recorder_stop(NULL);
+    }
+#if CONFIG_CAMERA_TIMELAPSE
+    // Brings the stream back from standby, so it can be stopped below
+    if (app_timelapse_is_running()) {
+        app_timelapse_stop();
+    }
+#endif
+
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+    // Frames held by the display must go back to the driver, or the stream task can't dequeue and stop
+    camera_display_sink_stop();
+#endif
 
-    if (_img_album_buffer) {
-        heap_caps_free(_img_album_buffer);
-        _img_album_buffer = NULL;
+    if (camera_subscription) {
+        app_camera_service_unsubscribe(camera_subscription);
+        camera_subscription = NULL;
     }
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+    // Neither the stream task nor the display sink holds a preview buffer anymore
+    app_preview_zoom_deinit();
+#if !CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+    preview_shown_index = -1;
+#endif
+#endif
+    // Only the stream task publishes
+    app_detect_export_deinit();
+
+    media_arena_return(_img_album_buffer);
+    _img_album_buffer = NULL;
+    media_arena_return(_img_photo_buffer);
+    _img_photo_buffer = NULL;
 
     return true;
 }
 
-bool Camera::init(void)
+size_t Camera::getMemoryFootprint(void) const
 {
-    camera_event_group = xEventGroupCreate();
-    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
-    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_DELETE);
-    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_PED_DETECT);
-    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_HUMAN_DETECT);
+    // The album thumbnail is counted by the core, the last shot is loaded later by the photo task
+    size_t size = ESP_Brookesia_PhoneApp::getMemoryFootprint();
+    if (_img_photo_buffer) {
+        size += _img_photo_dsc.data_size;
+    }
+    return size;
+}
+
+bool Camera::probeSensor(void)
+{
+    if (sensor_probed) {
+        return sensor_handle >= 0;
+    }
 
     i2c_master_bus_handle_t i2c_bus_handle = bsp_i2c_get_handle();
     esp_err_t ret = app_video_main(i2c_bus_handle);
@@ -256,26 +595,55 @@ bool Camera::init(void)
     }
 
     // Open the video device
-    _camera_ctlr_handle = app_video_open(EXAMPLE_CAM_DEV_PATH, APP_VIDEO_FMT_RGB565);
-    if (_camera_ctlr_handle < 0) {
+    sensor_handle = app_video_open(EXAMPLE_CAM_DEV_PATH, APP_VIDEO_FMT_RGB565);
+    if (sensor_handle < 0) {
         ESP_LOGE(TAG, "video cam open failed");
 
-        if (ESP_OK == i2c_master_probe(i2c_bus_handle, ESP_LCD_TOUCH_IO_I2C_GT911_ADDRESS, 100) || ESP_OK == i2c_master_probe(i2c_bus_handle, ESP_LCD_TOUCH_IO_I2C_GT911_ADDRESS_BACKUP, 100)) {
+        // Already diagnosed on the previous boot, don't wait for the touch probe timeouts again
+        if (app_video_sensor_absent_last_boot()) {
+            ESP_LOGW(TAG, "No camera sensor on the previous boot either");
+        } else if (ESP_OK == i2c_master_probe(i2c_bus_handle, ESP_LCD_TOUCH_IO_I2C_GT911_ADDRESS, 100) || ESP_OK == i2c_master_probe(i2c_bus_handle, ESP_LCD_TOUCH_IO_I2C_GT911_ADDRESS_BACKUP, 100)) {
             ESP_LOGI(TAG, "gt911 touch found");
         } else {
             ESP_LOGE(TAG, "Touch not found");
         }
     }
+    sensor_probed = true;
+
+    return sensor_handle >= 0;
+}
+
+bool Camera::init(void)
+{
+    camera_event_group = xEventGroupCreate();
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_DELETE);
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_PED_DETECT);
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_HUMAN_DETECT);
+    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_CODE_SCAN);
+
+    // Probe here unless a boot task already did
+    probeSensor();
+    _camera_ctlr_handle = sensor_handle;
 
     ESP_ERROR_CHECK(esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &data_cache_line_size));
-    for (int i = 0; i < EXAMPLE_CAM_BUF_NUM; i++) {
-        _cam_buffer[i] = (uint8_t *)heap_caps_aligned_alloc(data_cache_line_size, _hor_res * _ver_res * BSP_LCD_BITS_PER_PIXEL / 8, MALLOC_CAP_SPIRAM);
-        _cam_buffer_size[i] = _hor_res * _ver_res * BSP_LCD_BITS_PER_PIXEL / 8;
+    // The V4L2 buffers are allocated when the stream starts, as configured for this product
+    settings_store_set_default(SETTINGS_KEY_CAMERA_BUF_NUM, EXAMPLE_CAM_BUF_NUM);
+    settings_store_set_default(SETTINGS_KEY_CAMERA_BUF_MODE, APP_VIDEO_BUF_USERPTR_SPIRAM);
+
+    // The service owns the stream, this app is one of its consumers
+    if (sensor_handle >= 0) {
+        app_camera_service_config_t service_config = {
+            .video_fd = sensor_handle,
+            .core_id = task_config_get(TASK_CONFIG_CAMERA_STREAM)->core_id,
+            .buf_config = {
+                .buf_num = EXAMPLE_CAM_BUF_NUM,
+                .mode = APP_VIDEO_BUF_USERPTR_SPIRAM,
+            },
+        };
+        ESP_ERROR_CHECK(app_camera_service_init(&service_config));
     }
 
-    // Register the video frame operation callback
-    ESP_ERROR_CHECK(app_video_register_frame_operation_cb(camera_video_frame_operation));
-
     lv_img_dsc_t img_dsc = {
         .header = {
             .cf = LV_IMG_CF_TRUE_COLOR,
@@ -284,14 +652,12 @@ bool Camera::init(void)
             .w = _hor_res,
             .h = _ver_res,
         },
-        .data_size = _cam_buffer_size[0],
-        .data = (const uint8_t *)_cam_buffer[0],
+        .data_size = (uint32_t)(_hor_res * _ver_res * BSP_LCD_BITS_PER_PIXEL / 8),
+        .data = NULL,
     };
 
     memcpy(&_img_refresh_dsc, &img_dsc, sizeof(lv_img_dsc_t));
 
-    size_t detect_buf_size = ALIGN_UP_BY(_hor_res * _ver_res * BSP_LCD_BITS_PER_PIXEL / 8, data_cache_line_size);
-
     ppa_client_config_t srm_config =  {
         .oper_type = PPA_OPERATION_SRM,
     };
@@ -302,22 +668,118 @@ bool Camera::init(void)
     };
     ppa_client_register_event_callbacks(ppa_client_srm_handle, &cbs);
 
+    // Without the capture service the preview still works, shots are just not saved
+    esp_err_t ret = app_capture_init(_hor_res, _ver_res, onCaptureDone, this);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "capture init failed with error 0x%x", ret);
+    }
+    ret = app_recorder_init(_hor_res, _ver_res);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "recorder init failed with error 0x%x", ret);
+    }
+#if CONFIG_CAMERA_UVC
+    ret = app_uvc_init(_hor_res, _ver_res);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "webcam init failed with error 0x%x", ret);
+    }
+#endif
+#if CONFIG_CAMERA_LATENCY_TRACE
+    ESP_ERROR_CHECK(app_latency_trace_init(CONFIG_CAMERA_LATENCY_TRACE_DUMP_INTERVAL_MS));
+#endif
+#if CONFIG_CAMERA_SOFT_3A
+    if (sensor_handle >= 0) {
+        ret = app_soft_3a_init(sensor_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "software 3A init failed with error 0x%x", ret);
+        }
+    }
+#endif
+#if CONFIG_CAMERA_AUTOFOCUS
+    if (sensor_handle >= 0) {
+        ret = app_autofocus_init(sensor_handle);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "autofocus init failed with error 0x%x", ret);
+        }
+    }
+#endif
+#if CONFIG_CAMERA_ISP_TUNING_RELOAD
+    if (sensor_handle >= 0) {
+        ret = app_isp_tuning_init();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "ISP tuning reload init failed with error 0x%x", ret);
+        }
+    }
+#endif
+#if CONFIG_CAMERA_TIMELAPSE
+    if (sensor_handle >= 0) {
+        ret = app_timelapse_init();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "time-lapse init failed with error 0x%x", ret);
+        }
+    }
+#endif
+
+    detect_roi = {0, 0, _hor_res, _ver_res};
+#if CONFIG_CAMERA_DETECT_TRACKER
+    app_detect_tracker_init(&overlay_tracker, TRACKER_IOU_THRESHOLD, TRACKER_MAX_MISSED, TRACKER_MIN_HITS,
+                            TRACKER_MAX_EXTRAPOLATE_MS);
+#endif
+#if CONFIG_CAMERA_PEOPLE_COUNT
+    if (app_people_count_init(&people_counter, _hor_res, _ver_res, CONFIG_CAMERA_PEOPLE_COUNT_LINES,
+                              CONFIG_CAMERA_PEOPLE_COUNT_ZONES) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid people count lists, counting %d lines and %d zones", people_counter.line_num,
+                 people_counter.zone_num);
+    }
+#endif
+
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+    // Feed elements hold the PPA-downscaled detector input, the PPA output must be cache line aligned
+    size_t detect_buf_size = ALIGN_UP_BY((_hor_res / DETECT_PRESCALE_DIV) * (_ver_res / DETECT_PRESCALE_DIV) *
+                                         DETECT_PRESCALE_BYTES_PER_PIXEL, data_cache_line_size);
     camera_pipeline_cfg_t PPA_feed_cfg = {
         .elem_num = 4,
         .elements = NULL,
-        .align_size = 1,
+        .align_size = data_cache_line_size,
         .caps = MALLOC_CAP_SPIRAM,
         .buffer_size = detect_buf_size,
+        .mode = CAMERA_PIPELINE_MODE_SPSC_RING,
+        .drop_policy = CAMERA_PIPELINE_DROP_OLDEST,
+    };
+#else
+    // Feed elements carry reference-counted V4L2 frames, so they need no buffer of their own
+    camera_pipeline_cfg_t PPA_feed_cfg = {
+        .elem_num = 4,
+        .elements = NULL,
+        .align_size = 1,
+        .caps = MALLOC_CAP_SPIRAM,
+        .buffer_size = 0,
+        .mode = CAMERA_PIPELINE_MODE_SPSC_RING,
+        .drop_policy = CAMERA_PIPELINE_DROP_OLDEST,
     };
+#endif
 
     camera_element_pipeline_new(&PPA_feed_cfg, &feed_pipeline);
 
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+    ESP_ERROR_CHECK(app_motion_gate_init(&motion_gate, _hor_res / DETECT_PRESCALE_DIV, _ver_res / DETECT_PRESCALE_DIV));
+    for (int i = 0; i < 2; i++) {
+        motion_crop_bufs[i] = (uint16_t *)heap_caps_malloc(detect_buf_size, MALLOC_CAP_SPIRAM);
+        if (motion_crop_bufs[i] == NULL) {
+            ESP_LOGE(TAG, "Allocate motion crop buffer failed");
+            return false;
+        }
+    }
+#endif
+
+    // Three result buffers: one being written by the detect task, one in flight, one being read
     camera_pipeline_cfg_t detect_feed_cfg = {
-        .elem_num = 4,
+        .elem_num = 3,
         .elements = NULL,
-        .align_size = 1,
+        .align_size = 4,
         .caps = MALLOC_CAP_SPIRAM,
-        .buffer_size = 20 * sizeof(int),
+        .buffer_size = sizeof(camera_pipeline_detect_result_t),
+        .mode = CAMERA_PIPELINE_MODE_SPSC_RING,
+        .drop_policy = CAMERA_PIPELINE_DROP_OLDEST,
     };
     camera_element_pipeline_new(&detect_feed_cfg, &detect_pipeline);
 
@@ -329,23 +791,131 @@ int Camera::get_camera_ctlr_handle(void)
     return _camera_ctlr_handle;
 }
 
+bool Camera::setDetectRoi(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    if ((w == 0) || (h == 0) || (x + w > _hor_res) || (y + h > _ver_res)) {
+        ESP_LOGE(TAG, "Invalid detect ROI (%d, %d, %d, %d)", x, y, w, h);
+        return false;
+    }
+
+    // Applied by the frame callback on the next frame, a torn read only affects a single detection
+    detect_roi = {x, y, w, h};
+
+    return true;
+}
+
+#if CONFIG_CAMERA_FACE_RECOGNITION
+bool Camera::enrollFace(const char *name)
+{
+    if (!name || !name[0]) {
+        ESP_LOGE(TAG, "Invalid face name");
+        return false;
+    }
+
+    // The detect task only reads the name once the flag is set
+    strlcpy(face_enroll_name, name, sizeof(face_enroll_name));
+    face_enroll_pending = true;
+
+    return true;
+}
+#endif
+
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+bool Camera::setMotionGate(bool enable, uint8_t threshold, uint16_t refresh_ms)
+{
+    if (threshold == 0) {
+        ESP_LOGE(TAG, "Invalid motion threshold");
+        return false;
+    }
+
+    motion_gate_threshold = threshold;
+    motion_gate_refresh_ms = refresh_ms;
+    motion_gate_enabled = enable;
+
+    return true;
+}
+#endif
+
+bool Camera::setDetectSchedule(uint16_t frame_interval, uint16_t min_period_ms)
+{
+    if (frame_interval == 0) {
+        ESP_LOGE(TAG, "Invalid detect frame interval");
+        return false;
+    }
+
+    detect_frame_interval = frame_interval;
+    detect_min_period_ms = min_period_ms;
+
+    return true;
+}
+
 void Camera::taskCameraInit(Camera *app)
 {
-    ESP_ERROR_CHECK(app_video_set_bufs(app->_camera_ctlr_handle, EXAMPLE_CAM_BUF_NUM, (const void **)app->_cam_buffer));
+    app_video_buf_config_t buf_config = {
+        .buf_num = (uint32_t)settings_store_get(SETTINGS_KEY_CAMERA_BUF_NUM),
+        .mode = (app_video_buf_mode_t)settings_store_get(SETTINGS_KEY_CAMERA_BUF_MODE),
+    };
+    // Falls back to the service defaults if it doesn't fit this build
+    ESP_ERROR_CHECK(app_camera_service_set_buf_config(&buf_config));
 
     ESP_LOGI(TAG, "Start camera stream task");
-    ESP_ERROR_CHECK(app_video_stream_task_start(app->_camera_ctlr_handle, 0));
+    ESP_ERROR_CHECK(camera_subscribe());
 
     xSemaphoreGive(app->_camera_init_sem);
 
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_CAMERA_INIT, NULL);
 }
 
 void Camera::onScreenCameraShotAlbumClick(lv_event_t *e)
 {
+    Camera *camera = (Camera *)e->user_data;
+
+    if (camera == NULL) {
+        return;
+    }
+
+    if (camera->_img_photo_buffer == NULL) {
+        camera->_img_photo_buffer = (uint8_t *)media_arena_lend(camera->_img_photo_dsc.data_size, NULL);
+        if (camera->_img_photo_buffer == NULL) {
+            ESP_LOGE(TAG, "Allocate memory for photo buffer failed");
+            return;
+        }
+    }
+
+    esp_err_t ret = app_capture_load_last(camera->_img_photo_buffer, camera->_img_photo_dsc.data_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Load last shot failed: %s", esp_err_to_name(ret));
+        return;
+    }
+    camera->_img_photo_dsc.data = camera->_img_photo_buffer;
+    lv_img_set_src(ui_ImageCameraPhotoImage, &camera->_img_photo_dsc);
     lv_obj_invalidate(ui_ImageCameraPhotoImage);
 }
 
+void Camera::onCaptureDone(const char *path, const uint16_t *thumb, esp_err_t result, void *user_ctx)
+{
+    Camera *camera = (Camera *)user_ctx;
+
+#if CONFIG_CAMERA_TIMELAPSE
+    // Lets the sensor go back to standby once a time-lapse shot is on the SD card
+    app_timelapse_shot_done(result);
+#endif
+    if ((result != ESP_OK) || (camera == NULL) || !bsp_display_lock(100)) {
+        return;
+    }
+
+    // The app may have been closed while the shot was being written
+    if (!(xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_DELETE) && camera->_img_album_buffer) {
+        memcpy(camera->_img_album_buffer, thumb, camera->_img_album_buf_bytes);
+        lv_imgbtn_set_src(camera->_img_album, LV_IMGBTN_STATE_RELEASED, NULL, &camera->_img_album_dsc, NULL);
+        lv_imgbtn_set_src(camera->_img_album, LV_IMGBTN_STATE_PRESSED, NULL, &camera->_img_album_dsc, NULL);
+        lv_obj_add_flag(camera->_img_album, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_add_flag(ui_PanelCameraShotAlbum, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_invalidate(camera->_img_album);
+    }
+    bsp_display_unlock();
+}
+
 void Camera::onScreenCameraShotBtnClick(lv_event_t *e)
 {
     Camera *camera = (Camera *)e->user_data;
@@ -354,14 +924,8 @@ void Camera::onScreenCameraShotBtnClick(lv_event_t *e)
         return;
     }
 
-    lv_obj_add_flag(camera->_img_album, LV_OBJ_FLAG_CLICKABLE);
-    lv_obj_add_flag(ui_PanelCameraShotAlbum, LV_OBJ_FLAG_CLICKABLE);
-    lv_img_set_src(camera->_img_album, &camera->_img_album_dsc);
-
-    xEventGroupClearBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
-    memcpy(camera->_img_album_buffer, camera->_img_refresh_dsc.data,
-           camera->_img_refresh_dsc.data_size);
-    xEventGroupSetBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
+    // The album button is updated from `onCaptureDone` once the shot is on the SD card
+    __atomic_store_n(&capture_requested, true, __ATOMIC_RELEASE);
 }
 
 static bool ppa_trans_done_cb(ppa_client_handle_t ppa_client, ppa_event_data_t *event_data, void *user_data)
@@ -374,6 +938,519 @@ static bool ppa_trans_done_cb(ppa_client_handle_t ppa_client, ppa_event_data_t *
     return (xHigherPriorityTaskWoken == pdTRUE);
 }
 
+static void camera_frame_release_cb(void *user_ctx, uint32_t frame_index)
+{
+    app_video_frame_release(frame_index);
+}
+
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+static esp_err_t camera_detect_prescale(camera_pipeline_buffer_element *element, uint8_t *camera_buf,
+                                        uint32_t camera_buf_hes, uint32_t camera_buf_ves)
+{
+    camera_pipeline_rect_t roi = detect_roi;
+    uint32_t out_w = roi.w / DETECT_PRESCALE_DIV;
+    uint32_t out_h = roi.h / DETECT_PRESCALE_DIV;
+
+    ESP_RETURN_ON_FALSE((out_w > 0) && (out_h > 0), ESP_ERR_INVALID_SIZE, TAG, "Detect ROI too small");
+
+    // Snapshot the ROI so the detect task maps results with the geometry this frame was scaled with
+    element->roi = roi;
+
+    ppa_srm_oper_config_t srm_config = {};
+    srm_config.in.buffer = camera_buf;
+    srm_config.in.pic_w = camera_buf_hes;
+    srm_config.in.pic_h = camera_buf_ves;
+    srm_config.in.block_w = out_w * DETECT_PRESCALE_DIV;
+    srm_config.in.block_h = out_h * DETECT_PRESCALE_DIV;
+    srm_config.in.block_offset_x = roi.x;
+    srm_config.in.block_offset_y = roi.y;
+    srm_config.in.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.out.buffer = element->buffer;
+    srm_config.out.buffer_size = element->valid_size;
+    srm_config.out.pic_w = out_w;
+    srm_config.out.pic_h = out_h;
+    srm_config.out.block_offset_x = 0;
+    srm_config.out.block_offset_y = 0;
+    srm_config.out.srm_cm = DETECT_PRESCALE_PPA_CM;
+    srm_config.rotation_angle = PPA_SRM_ROTATION_ANGLE_0;
+    srm_config.scale_x = 1.0f / DETECT_PRESCALE_DIV;
+    srm_config.scale_y = 1.0f / DETECT_PRESCALE_DIV;
+    srm_config.mode = PPA_TRANS_MODE_NON_BLOCKING;
+    srm_config.user_data = element;
+
+    return ppa_do_scale_rotate_mirror(ppa_client_srm_handle, &srm_config);
+}
+
+static void camera_detect_map_results(camera_pipeline_detect_result_t *result, const camera_pipeline_rect_t &roi)
+{
+    // Bring boxes and keypoints from detector input coordinates back to frame coordinates
+    for (uint32_t i = 0; i < result->num; i++) {
+        camera_pipeline_detect_box_t *box = &result->boxes[i];
+
+        for (int j = 0; j < 4; j++) {
+            box->box[j] = box->box[j] * DETECT_PRESCALE_DIV + ((j & 1) ? roi.y : roi.x);
+        }
+        for (int j = 0; j < box->keypoint_num; j++) {
+            box->keypoint[j] = box->keypoint[j] * DETECT_PRESCALE_DIV + ((j & 1) ? roi.y : roi.x);
+        }
+    }
+}
+#endif
+
+static bool camera_detect_schedule_frame(int64_t now_us)
+{
+    static uint32_t frame_count = 0;
+    static int64_t last_dispatch_us = 0;
+
+    if ((frame_count++ % detect_frame_interval) != 0) {
+        return false;
+    }
+    if ((detect_min_period_ms > 0) && (now_us - last_dispatch_us < (int64_t)detect_min_period_ms * 1000)) {
+        // Retry on the next frame instead of waiting for another full interval
+        frame_count = 0;
+        return false;
+    }
+    last_dispatch_us = now_us;
+
+    return true;
+}
+
+#if CONFIG_CAMERA_FACE_RECOGNITION
+static void camera_detect_recognize(const std::list<dl::detect::result_t> &results, camera_pipeline_detect_result_t *out,
+                                    const dl::image::img_t &img)
+{
+    const dl::detect::result_t *best = NULL;
+    app_face_match_t match;
+    int index = 0;
+
+    for (const auto &res : results) {
+        if ((res.keypoint.size() >= 10) && (!best || (res.score > best->score))) {
+            best = &res;
+        }
+    }
+    if (face_enroll_pending && best) {
+        face_enroll_pending = false;
+        app_face_recognition_enroll(img, *best, face_enroll_name, NULL);
+    }
+
+    // Same order and skipping as camera_detect_store_results(), so `index` follows the stored boxes
+    for (const auto &res : results) {
+        if ((res.box.size() < 4) || std::none_of(res.box.begin(), res.box.end(), [](int v) { return v != 0; })) {
+            continue;
+        }
+        if ((index >= out->num) || (index >= FACE_RECOGNITION_MAX_FACES)) {
+            break;
+        }
+        if ((res.keypoint.size() >= 10) && (app_face_recognition_identify(img, res, &match) == ESP_OK)) {
+            out->boxes[index].face_id = match.id;
+        }
+        index++;
+    }
+}
+#endif
+
+static void camera_detect_store_results(const std::list<dl::detect::result_t> &results, camera_pipeline_detect_result_t *out,
+                                        const dl::image::img_t *img)
+{
+    out->num = 0;
+    for (const auto &res : results) {
+        // Skip empty boxes, as the previous list based drawing did
+        if ((res.box.size() < 4) || std::none_of(res.box.begin(), res.box.end(), [](int v) { return v != 0; })) {
+            continue;
+        }
+        if (out->num >= CAMERA_PIPELINE_DETECT_RESULT_MAX) {
+            break;
+        }
+
+        camera_pipeline_detect_box_t *box = &out->boxes[out->num++];
+        box->category = res.category;
+        box->score = res.score;
+        std::copy_n(res.box.begin(), 4, box->box);
+        box->keypoint_num = 0;
+        box->track_id = 0;
+        box->face_id = 0;
+        if (std::any_of(res.keypoint.begin(), res.keypoint.end(), [](int v) { return v != 0; })) {
+            box->keypoint_num = std::min<size_t>(res.keypoint.size(), CAMERA_PIPELINE_DETECT_KEYPOINT_MAX) & ~1U;
+            std::copy_n(res.keypoint.begin(), box->keypoint_num, box->keypoint);
+        }
+    }
+#if CONFIG_CAMERA_FACE_RECOGNITION
+    // Keypoints are still in detector input coordinates here
+    if (img && face_recognition_ready) {
+        camera_detect_recognize(results, out, *img);
+    }
+#else
+    (void)img;
+#endif
+}
+
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+static void camera_display_frame_release(const camera_display_frame_t *frame)
+{
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+    if (frame->zoomed) {
+        app_preview_zoom_release(frame->index);
+        return;
+    }
+#endif
+    app_video_frame_release(frame->index);
+}
+
+static void camera_display_sink_timer_cb(lv_timer_t *timer)
+{
+    camera_display_frame_t frame;
+
+    portENTER_CRITICAL(&display_sink_lock);
+    frame = display_pending;
+    display_pending.buf = NULL;
+    portEXIT_CRITICAL(&display_sink_lock);
+
+    if (!frame.buf) {
+        return;
+    }
+
+    // Only the canvas area gets invalidated, it is redrawn in the regular LVGL refresh
+    if (ui_ImageCameraShotImage) {
+        lv_canvas_set_buffer(ui_ImageCameraShotImage, frame.buf, frame.width, frame.height, LV_IMG_CF_TRUE_COLOR);
+    }
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+    app_overlay_layer_update(&overlay_layer, &frame.overlay, frame.draw_keypoints);
+    app_latency_trace_mark(frame.frame_seq, APP_LATENCY_STAGE_OVERLAY);
+#endif
+    app_latency_trace_mark(frame.frame_seq, APP_LATENCY_STAGE_DISPLAY_FLUSH);
+
+    // No refresh is in progress inside a timer callback, so the previous frame is no longer read
+    if (display_current.buf) {
+        camera_display_frame_release(&display_current);
+    }
+    display_current = frame;
+}
+
+static void camera_display_sink_start(void)
+{
+    portENTER_CRITICAL(&display_sink_lock);
+    display_sink_enabled = true;
+    portEXIT_CRITICAL(&display_sink_lock);
+
+    if (!display_sink_timer) {
+        display_sink_timer = lv_timer_create(camera_display_sink_timer_cb, DISPLAY_SINK_PERIOD_MS, NULL);
+    }
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+    app_overlay_layer_create(&overlay_layer, ui_ImageCameraShotImage);
+#endif
+}
+
+static void camera_display_sink_stop(void)
+{
+    camera_display_frame_t pending;
+
+    portENTER_CRITICAL(&display_sink_lock);
+    display_sink_enabled = false;
+    pending = display_pending;
+    display_pending.buf = NULL;
+    portEXIT_CRITICAL(&display_sink_lock);
+
+    if (display_sink_timer) {
+        lv_timer_del(display_sink_timer);
+        display_sink_timer = NULL;
+    }
+    if (pending.buf) {
+        camera_display_frame_release(&pending);
+    }
+    if (display_current.buf) {
+        camera_display_frame_release(&display_current);
+        display_current.buf = NULL;
+    }
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+    // The objects are children of the preview canvas and go away with the app screens
+    app_overlay_layer_reset(&overlay_layer);
+#endif
+}
+
+static void camera_display_sink_post(uint8_t *buf, uint8_t index, bool zoomed, uint32_t frame_seq, uint32_t width,
+                                     uint32_t height, const camera_pipeline_detect_result_t *overlay, bool draw_keypoints)
+{
+    camera_display_frame_t posted_frame = {};
+    camera_display_frame_t replaced = {};
+    bool posted = false;
+
+    // A zoomed copy comes with its reference, a V4L2 frame is referenced here
+    if (!zoomed && (app_video_frame_acquire(index) != ESP_OK)) {
+        return;
+    }
+    posted_frame.index = index;
+    posted_frame.zoomed = zoomed;
+
+    // Latest frame wins, a frame the LVGL task hasn't picked up yet is dropped
+    portENTER_CRITICAL(&display_sink_lock);
+    if (display_sink_enabled) {
+        replaced = display_pending;
+        display_pending.buf = buf;
+        display_pending.index = index;
+        display_pending.zoomed = zoomed;
+        display_pending.frame_seq = frame_seq;
+        display_pending.width = width;
+        display_pending.height = height;
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+        // Boxes travel with their frame so the layer never shows them on a different one
+        display_pending.overlay = *overlay;
+        display_pending.draw_keypoints = draw_keypoints;
+#endif
+        posted = true;
+    }
+    portEXIT_CRITICAL(&display_sink_lock);
+
+    if (!posted) {
+        camera_display_frame_release(&posted_frame);
+    }
+    if (replaced.buf) {
+        camera_display_frame_release(&replaced);
+    }
+}
+#endif
+
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+static bool camera_preview_zoom_render(uint8_t *camera_buf, uint8_t camera_buf_index, uint8_t **buf, uint8_t *index,
+                                       uint32_t *width, uint32_t *height, bool draw_keypoints)
+{
+    app_preview_zoom_view_t view;
+
+    if (app_preview_zoom_render(camera_buf, buf, index, &view) != ESP_OK) {
+        return false;
+    }
+    *width = view.out_w;
+    *height = view.out_h;
+
+    app_preview_zoom_map_result(&view, &overlay_result, &preview_overlay_result);
+#if !CONFIG_CAMERA_OVERLAY_LVGL_LAYER && !CONFIG_CAMERA_UVC_OVERLAY_BURNED
+    // Drawn at preview resolution, so the lines keep their thickness at any zoom and the frame stays clean
+    app_overlay_draw_result(reinterpret_cast<uint16_t*>(*buf), view.out_w, view.out_h, &preview_overlay_result,
+                            draw_keypoints);
+    app_latency_trace_mark_index(camera_buf_index, APP_LATENCY_STAGE_OVERLAY);
+#endif
+
+    return true;
+}
+#endif
+
+static void camera_feed_pipeline_flush(void)
+{
+    camera_pipeline_buffer_element *p = NULL;
+
+    // Hand back frames that were queued for detection but will never be consumed
+    while ((p = camera_pipeline_recv_element(feed_pipeline, 0)) != NULL) {
+        camera_pipeline_element_release(p);
+        camera_pipeline_queue_element_index(feed_pipeline, p->index);
+    }
+}
+
+typedef struct {
+    camera_pipeline_buffer_element *feed;   // Feed element of the analysed frame
+    uint32_t frame_seq;                     // Latency trace sequence number of the frame
+    camera_pipeline_rect_t roi;             // Region of the camera frame the detector input covers
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+    camera_pipeline_rect_t fresh;           // Region the results cover, boxes of the last run outside it carry over
+#endif
+#if CONFIG_CAMERA_FACE_RECOGNITION
+    dl::image::img_t img;                   // Detector input of a face job, NULL data for other models
+#endif
+} camera_detect_job_t;
+
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+// One job runs MSR while the previous one is still in MNP
+static camera_detect_job_t detect_jobs[2];
+static uint8_t detect_job_slot = 0;
+#endif
+
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+static const std::list<dl::detect::result_t> motion_no_results;
+
+static void camera_detect_carry_results(camera_pipeline_detect_result_t *result, const camera_pipeline_rect_t &fresh)
+{
+    // Objects outside the moving region haven't changed since the run that found them
+    for (uint32_t i = 0; (i < motion_last_result.num) && (result->num < CAMERA_PIPELINE_DETECT_RESULT_MAX); i++) {
+        const int *box = motion_last_result.boxes[i].box;
+        if ((fresh.w > 0) && (box[0] < fresh.x + fresh.w) && (box[2] > fresh.x) &&
+                (box[1] < fresh.y + fresh.h) && (box[3] > fresh.y)) {
+            continue;
+        }
+        result->boxes[result->num++] = motion_last_result.boxes[i];
+    }
+    motion_last_result = *result;
+}
+
+static bool camera_detect_motion_gate(camera_detect_job_t *job, uint16_t **buf, int *w, int *h, EventBits_t mode)
+{
+    static int64_t last_full_us = 0;
+    static camera_pipeline_rect_t last_roi;
+    int64_t now_us = esp_timer_get_time();
+    app_motion_rect_t motion;
+
+    job->fresh = job->roi;
+    // Results of another model or of another region can't be carried over
+    if ((mode != motion_gate_mode) || memcmp(&job->roi, &last_roi, sizeof(last_roi))) {
+        app_motion_gate_reset(&motion_gate);
+        motion_last_result.num = 0;
+        motion_gate_mode = mode;
+        last_roi = job->roi;
+    }
+
+    bool moved = app_motion_gate_process(&motion_gate, *buf, *w, *h, DETECT_PRESCALE_BYTES_PER_PIXEL == 3,
+                                         motion_gate_threshold, &motion);
+    // A periodic full run catches objects that appeared too slowly to count as motion
+    if ((motion_gate_refresh_ms > 0) && (now_us - last_full_us >= (int64_t)motion_gate_refresh_ms * 1000)) {
+        motion = {0, 0, (uint16_t)*w, (uint16_t)*h};
+        moved = true;
+    }
+    if (!moved) {
+        job->fresh = {0, 0, 0, 0};
+        return false;
+    }
+    if ((motion.w == *w) && (motion.h == *h)) {
+        last_full_us = now_us;
+        return true;
+    }
+
+    // The detectors take no line stride, copy the moving region into a compact buffer
+    uint8_t *crop = (uint8_t *)motion_crop_bufs[motion_crop_index];
+    const uint8_t *src = (const uint8_t *)*buf + (motion.y * *w + motion.x) * DETECT_PRESCALE_BYTES_PER_PIXEL;
+    motion_crop_index ^= 1;
+    for (uint16_t y = 0; y < motion.h; y++) {
+        memcpy(crop + y * motion.w * DETECT_PRESCALE_BYTES_PER_PIXEL, src + y * *w * DETECT_PRESCALE_BYTES_PER_PIXEL,
+               motion.w * DETECT_PRESCALE_BYTES_PER_PIXEL);
+    }
+
+    job->roi = {
+        (uint16_t)(job->roi.x + motion.x * DETECT_PRESCALE_DIV),
+        (uint16_t)(job->roi.y + motion.y * DETECT_PRESCALE_DIV),
+        (uint16_t)(motion.w * DETECT_PRESCALE_DIV),
+        (uint16_t)(motion.h * DETECT_PRESCALE_DIV),
+    };
+    job->fresh = job->roi;
+    *buf = (uint16_t *)crop;
+    *w = motion.w;
+    *h = motion.h;
+
+    return true;
+}
+#endif
+
+static void camera_detect_finish(const camera_detect_job_t *job, const std::list<dl::detect::result_t> &results)
+{
+    camera_pipeline_buffer_element *p = job->feed;
+
+    app_latency_trace_mark(job->frame_seq, APP_LATENCY_STAGE_INFER_END);
+#if CONFIG_CAMERA_FACE_RECOGNITION
+    const dl::image::img_t *img = job->img.data ? &job->img : NULL;
+#else
+    const dl::image::img_t *img = NULL;
+#endif
+#if !CONFIG_CAMERA_DETECT_PPA_PRESCALE
+    // Only now may the V4L2 buffer go back to the driver, unless recognition still has to read it
+    if (!img) {
+        camera_pipeline_element_release(p);
+    }
+#endif
+
+    // Results go straight into a preallocated result buffer of the detect pipeline
+    camera_pipeline_buffer_element *element = camera_pipeline_get_queued_element(detect_pipeline);
+    if (element) {
+        camera_detect_store_results(results, element->detect_result, img);
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+        camera_detect_map_results(element->detect_result, job->roi);
+#endif
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+        camera_detect_carry_results(element->detect_result, job->fresh);
+#endif
+        element->detect_result->timestamp_us = p->timestamp_us;
+        element->detect_result->frame_seq = job->frame_seq;
+    }
+#if !CONFIG_CAMERA_DETECT_PPA_PRESCALE
+    if (img) {
+        camera_pipeline_element_release(p);
+    }
+#endif
+    camera_pipeline_queue_element_index(feed_pipeline, p->index);
+
+    if (element) {
+        camera_pipeline_done_element(detect_pipeline, element);
+    }
+}
+
+#if CONFIG_CAMERA_CODE_SCAN
+static void camera_code_scan_finish(const camera_detect_job_t *job, const void *buf, int w, int h, bool rgb888)
+{
+    static app_code_scan_result_t codes;
+    static char last_text[CAMERA_PIPELINE_CODE_MAX][CAMERA_PIPELINE_CODE_TEXT_MAX];
+    camera_pipeline_buffer_element *p = job->feed;
+
+    if (app_code_scan_process(buf, w, h, rgb888, &codes) != ESP_OK) {
+        codes.num = 0;
+    }
+    app_latency_trace_mark(job->frame_seq, APP_LATENCY_STAGE_INFER_END);
+#if !CONFIG_CAMERA_DETECT_PPA_PRESCALE
+    camera_pipeline_element_release(p);
+#endif
+
+    camera_pipeline_buffer_element *element = camera_pipeline_get_queued_element(detect_pipeline);
+    if (element) {
+        camera_pipeline_detect_result_t *result = element->detect_result;
+
+        // A code is a box around its corners, the corners are its keypoints
+        result->num = std::min<uint32_t>(codes.num, CAMERA_PIPELINE_CODE_MAX);
+        for (uint32_t i = 0; i < result->num; i++) {
+            const app_code_scan_code_t *code = &codes.codes[i];
+            camera_pipeline_detect_box_t *box = &result->boxes[i];
+
+            memset(box, 0, sizeof(*box));
+            box->category = code->type;
+            box->score = 1.0f;
+            box->box[0] = box->box[2] = code->corners[0];
+            box->box[1] = box->box[3] = code->corners[1];
+            for (int j = 0; j < 8; j += 2) {
+                box->box[0] = std::min(box->box[0], code->corners[j]);
+                box->box[1] = std::min(box->box[1], code->corners[j + 1]);
+                box->box[2] = std::max(box->box[2], code->corners[j]);
+                box->box[3] = std::max(box->box[3], code->corners[j + 1]);
+                box->keypoint[j] = code->corners[j];
+                box->keypoint[j + 1] = code->corners[j + 1];
+            }
+            box->keypoint_num = 8;
+            strlcpy(result->code_text[i], code->text, CAMERA_PIPELINE_CODE_TEXT_MAX);
+            if (strcmp(last_text[i], result->code_text[i])) {
+                ESP_LOGI(TAG, "Scanned %s: %s", app_code_scan_type_name(code->type), result->code_text[i]);
+                strlcpy(last_text[i], result->code_text[i], CAMERA_PIPELINE_CODE_TEXT_MAX);
+            }
+        }
+        // Logged again once the code left the view and came back
+        for (uint32_t i = result->num; i < CAMERA_PIPELINE_CODE_MAX; i++) {
+            last_text[i][0] = '\0';
+        }
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+        camera_detect_map_results(result, job->roi);
+#endif
+        result->timestamp_us = p->timestamp_us;
+        result->frame_seq = job->frame_seq;
+    }
+    camera_pipeline_queue_element_index(feed_pipeline, p->index);
+
+    if (element) {
+        camera_pipeline_done_element(detect_pipeline, element);
+    }
+}
+#endif
+
+static void camera_detect_drain(void)
+{
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+    void *done_ctx = NULL;
+    std::list<dl::detect::result_t> &detect_results = app_humanface_detect_flush(&done_ctx);
+    if (done_ctx) {
+        camera_detect_finish((camera_detect_job_t *)done_ctx, detect_results);
+    }
+#endif
+}
+
 #if FPS_PRINT
 typedef struct {
     int64_t start;
@@ -402,123 +1479,380 @@ static void perfmon_end(int ctr, int count)
 
     printf("Perf ctr[%d], [%15s][%15s]: %.2f FPS (%.2f ms per operation)\n",
            ctr, perf_counters[ctr].str1, perf_counters[ctr].str2, frequency, time_in_sec * 1000 / count);
+    perf_log_set_camera_fps((uint32_t)(frequency * 10));
 }
 #endif
 
 void Camera::camera_dectect_task(Camera *app)
 {
     int res = 0;
+#if CONFIG_CAMERA_FACE_RECOGNITION
+    // Loaded from the task that runs it, the Camera works without it if the model is missing
+    face_recognition_ready = (app_face_recognition_init() == ESP_OK);
+#endif
+#if CONFIG_CAMERA_CODE_SCAN
+    // Sized for the detector input, scanning finds nothing if this fails
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+    esp_err_t scan_ret = app_code_scan_init(app->_hor_res / DETECT_PRESCALE_DIV, app->_ver_res / DETECT_PRESCALE_DIV);
+#else
+    esp_err_t scan_ret = app_code_scan_init(app->_hor_res, app->_ver_res);
+#endif
+    if (scan_ret != ESP_OK) {
+        ESP_LOGW(TAG, "Code scan unavailable: %s", esp_err_to_name(scan_ret));
+    }
+#endif
     while (1) {
         xEventGroupWaitBits(camera_event_group, CAMERA_EVENT_TASK_RUN, pdFALSE, pdTRUE, portMAX_DELAY);
         
-        if (xEventGroupGetBits(camera_event_group) & (CAMERA_EVENT_PED_DETECT | CAMERA_EVENT_HUMAN_DETECT)) {
-            camera_pipeline_buffer_element *p = camera_pipeline_recv_element(feed_pipeline, portMAX_DELAY);
+        if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_DETECT_MODES) {
+            // Bounded wait so a mode switch or close is noticed without a new frame
+            camera_pipeline_buffer_element *p = camera_pipeline_recv_element(feed_pipeline, pdMS_TO_TICKS(DETECT_RECV_TIMEOUT_MS));
             if (p) {
+                camera_detect_job_t job = {
+                    .feed = p,
+                    // Looked up while the element still references its V4L2 buffer
+                    .frame_seq = app_latency_trace_frame_seq(p->frame_index),
+                    .roi = {0, 0, app->_hor_res, app->_ver_res},
+                };
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+                // The PPA has finished reading the frame, give it back before running the model
+                camera_pipeline_element_release(p);
+
+                job.roi = p->roi;
+                uint16_t *detect_buf = p->buffer;
+                int detect_w = job.roi.w / DETECT_PRESCALE_DIV;
+                int detect_h = job.roi.h / DETECT_PRESCALE_DIV;
+                dl::image::pix_type_t detect_pix_type = DETECT_PRESCALE_PIX_TYPE;
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+                job.fresh = job.roi;
+#endif
+#else
+                uint16_t *detect_buf = p->frame;
+                int detect_w = app->_hor_res;
+                int detect_h = app->_ver_res;
+                dl::image::pix_type_t detect_pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+#endif
+#if CONFIG_CAMERA_CODE_SCAN
+                // Codes are scanned on every scheduled frame, a code held still must stay decoded
+                if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_CODE_SCAN) {
+                    camera_detect_drain();
+                    app_latency_trace_mark(job.frame_seq, APP_LATENCY_STAGE_INFER_START);
+                    camera_code_scan_finish(&job, detect_buf, detect_w, detect_h,
+                                            detect_pix_type == dl::image::DL_IMAGE_PIX_TYPE_RGB888);
+                } else
+#endif
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+                if (motion_gate_enabled &&
+                        !camera_detect_motion_gate(&job, &detect_buf, &detect_w, &detect_h,
+                                                   xEventGroupGetBits(camera_event_group) & (CAMERA_EVENT_PED_DETECT | CAMERA_EVENT_HUMAN_DETECT))) {
+                    // Nothing moved, the last results still hold for this frame
+                    camera_detect_drain();
+                    app_latency_trace_mark(job.frame_seq, APP_LATENCY_STAGE_INFER_START);
+                    camera_detect_finish(&job, motion_no_results);
+                } else
+#endif
                 if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_PED_DETECT) {
-                    detect_results = app_pedestrian_detect((uint16_t *)p->buffer, app->_hor_res, app->_ver_res);
-                }  else {
-                    detect_results = app_humanface_detect((uint16_t *)p->buffer, app->_hor_res, app->_ver_res);
-                }
-
-                camera_pipeline_queue_element_index(feed_pipeline, p->index);
-
-                camera_pipeline_buffer_element *element = camera_pipeline_get_queued_element(detect_pipeline);
-                if (element) {
-                    element->detect_results = &detect_results;
-
-                    camera_pipeline_done_element(detect_pipeline, element);
+                    camera_detect_drain();
+                    app_latency_trace_mark(job.frame_seq, APP_LATENCY_STAGE_INFER_START);
+                    camera_detect_finish(&job, app_pedestrian_detect(detect_buf, detect_w, detect_h, detect_pix_type));
+                } else {
+                    app_latency_trace_mark(job.frame_seq, APP_LATENCY_STAGE_INFER_START);
+#if CONFIG_CAMERA_FACE_RECOGNITION
+                    job.img.data = detect_buf;
+                    job.img.width = detect_w;
+                    job.img.height = detect_h;
+                    job.img.pix_type = detect_pix_type;
+#endif
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+                    // The frame stays referenced by its job until MNP is done with it
+                    camera_detect_job_t *slot = &detect_jobs[detect_job_slot];
+                    detect_job_slot ^= 1;
+                    *slot = job;
+                    void *done_ctx = NULL;
+                    std::list<dl::detect::result_t> &detect_results =
+                        app_humanface_detect_pipelined(detect_buf, detect_w, detect_h, slot, &done_ctx, detect_pix_type);
+                    if (done_ctx) {
+                        camera_detect_finish((camera_detect_job_t *)done_ctx, detect_results);
+                    }
+#else
+                    camera_detect_finish(&job, app_humanface_detect(detect_buf, detect_w, detect_h, detect_pix_type));
+#endif
                 }
+            } else {
+                // Don't sit on the last frame in MNP while the stream is stalled
+                camera_detect_drain();
             }
-            vTaskDelay(pdMS_TO_TICKS(5));
         } else {
+            camera_detect_drain();
+            camera_feed_pipeline_flush();
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+            // Start over with a full run once detection is switched on again
+            motion_gate_mode = 0;
+#endif
             vTaskDelay(pdMS_TO_TICKS(50));
         }
 
         if (xEventGroupGetBits(camera_event_group) & CAMERA_EVENT_DELETE) {
-            delete_pedestrian_detect();
-            delete_humanface_detect();
+            camera_detect_drain();
+            camera_feed_pipeline_flush();
+
+            app_detect_models_unload(false);
+#if CONFIG_CAMERA_FACE_RECOGNITION
+            app_face_recognition_deinit();
+            face_recognition_ready = false;
+#endif
+#if CONFIG_CAMERA_CODE_SCAN
+            app_code_scan_deinit();
+#endif
 
             ESP_LOGI(TAG, "Camera detect task exit");
-            vTaskDelete(NULL);
+            task_config_delete(TASK_CONFIG_CAMERA_DETECT, NULL);
         }
     }
 }
 
+static esp_err_t camera_subscribe(void)
+{
+    app_camera_service_subscriber_config_t config = {
+        .name = "Camera",
+        .frame_cb = camera_video_frame_operation,
+        .user_ctx = NULL,
+        .min_width = 0,
+        .min_height = 0,
+    };
+
+    return app_camera_service_subscribe(&config, &camera_subscription);
+}
+
 static void camera_video_frame_operation(uint8_t *camera_buf, uint8_t camera_buf_index, 
                                        uint32_t camera_buf_hes, uint32_t camera_buf_ves, 
-                                       size_t camera_buf_len)
+                                       size_t camera_buf_len, void *user_ctx)
 {
-    // Wait for task run event
-    xEventGroupWaitBits(camera_event_group, CAMERA_EVENT_TASK_RUN, pdFALSE, pdTRUE, portMAX_DELAY);
+    // Other subscribers wait behind this callback, frames that come in while pausing are just skipped
+    EventBits_t current_bits = xEventGroupGetBits(camera_event_group);
+    if (!(current_bits & CAMERA_EVENT_TASK_RUN)) {
+        return;
+    }
 
     // Check if AI detection is needed
-    EventBits_t current_bits = xEventGroupGetBits(camera_event_group);
-    bool is_detect_mode = current_bits & (CAMERA_EVENT_PED_DETECT | CAMERA_EVENT_HUMAN_DETECT);
+    bool is_detect_mode = current_bits & CAMERA_EVENT_DETECT_MODES;
+
+    // Set once the detector or an encoder references the frame, they read the V4L2 buffer after this callback returns
+    bool frame_shared = false;
+#if CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+    // Boxes never go into the frame with the LVGL layer
+    (void)frame_shared;
+#endif
+
+    // Shots, recordings and the clean webcam stream are encoded straight from the V4L2 buffer, so no overlay may be
+    // drawn into those frames
+    if (__atomic_exchange_n(&capture_requested, false, __ATOMIC_ACQ_REL)) {
+        esp_err_t ret = app_capture_shot(camera_buf, camera_buf_index, camera_buf_hes, camera_buf_ves);
+        if (ret == ESP_OK) {
+            frame_shared = true;
+        } else {
+            ESP_LOGW(TAG, "Shot skipped: %s", esp_err_to_name(ret));
+        }
+    }
+#if CONFIG_CAMERA_TIMELAPSE
+    // Once the exposure settled after a wake up, the shot goes the same way as the shutter button
+    if (app_timelapse_frame()) {
+        esp_err_t ret = app_capture_shot(camera_buf, camera_buf_index, camera_buf_hes, camera_buf_ves);
+        if (ret == ESP_OK) {
+            frame_shared = true;
+        } else {
+            ESP_LOGW(TAG, "Time-lapse shot skipped: %s", esp_err_to_name(ret));
+            app_timelapse_shot_done(ret);
+        }
+    }
+#endif
+    // Frames the encoder or the SD card can't take are dropped and counted by the recorder
+    if (app_recorder_push_frame(camera_buf, camera_buf_index) == ESP_OK) {
+        frame_shared = true;
+    }
+#if CONFIG_CAMERA_UVC && !CONFIG_CAMERA_UVC_OVERLAY_BURNED
+    // The webcam references the same V4L2 buffer, the preview below doesn't wait for the host
+    if (app_uvc_push_frame(camera_buf, camera_buf_index) == ESP_OK) {
+        frame_shared = true;
+    }
+#endif
+    // Measured before any overlay is drawn into the frame
+    app_soft_3a_process_frame(reinterpret_cast<const uint16_t*>(camera_buf), camera_buf_hes, camera_buf_ves);
+    app_autofocus_process_frame(reinterpret_cast<const uint16_t*>(camera_buf), camera_buf_hes, camera_buf_ves);
+    // Parameters staged from the tuning file take effect from the next frame on
+    app_isp_tuning_process_frame();
     
     if (is_detect_mode) {
-        // Process input frame
-        camera_pipeline_buffer_element *input_element = camera_pipeline_get_queued_element(feed_pipeline);
+        int64_t frame_time_us = esp_timer_get_time();
+
+        // Process input frame, only the frames picked by the inference schedule go to the detector
+        // Share the V4L2 buffer with the detector instead of copying it
+        camera_pipeline_buffer_element *input_element = NULL;
+        if (camera_detect_schedule_frame(frame_time_us)) {
+            input_element = feed_spare_element ? feed_spare_element : camera_pipeline_get_queued_element(feed_pipeline);
+            feed_spare_element = NULL;
+        }
         if (input_element) {
-            input_element->buffer = reinterpret_cast<uint16_t*>(camera_buf);
-            camera_pipeline_done_element(feed_pipeline, input_element);
+            input_element->timestamp_us = frame_time_us;
+        }
+        if (input_element && (app_video_frame_acquire(camera_buf_index) == ESP_OK)) {
+            if (camera_pipeline_element_attach_frame(input_element, reinterpret_cast<uint16_t*>(camera_buf), camera_buf_index,
+                                                     camera_frame_release_cb, NULL) == ESP_OK) {
+                app_latency_trace_mark_index(camera_buf_index, APP_LATENCY_STAGE_FEED_ENQUEUE);
+#if CONFIG_CAMERA_DETECT_PPA_PRESCALE
+                // The PPA done callback passes the element on to the detect task
+                if (camera_detect_prescale(input_element, camera_buf, camera_buf_hes, camera_buf_ves) == ESP_OK) {
+                    // The PPA reads the frame in the background until the done callback
+                    frame_shared = true;
+                } else {
+                    camera_pipeline_element_release(input_element);
+                    feed_spare_element = input_element;
+                }
+#else
+                camera_pipeline_done_element(feed_pipeline, input_element);
+                // The detector runs on this very buffer
+                frame_shared = true;
+#endif
+            } else {
+                app_video_frame_release(camera_buf_index);
+                feed_spare_element = input_element;
+            }
+        } else if (input_element) {
+            feed_spare_element = input_element;
         }
 
-        // Get detection results
+        // Get detection results, the element is only borrowed long enough to copy the fixed-size result
         camera_pipeline_buffer_element *detect_element = camera_pipeline_recv_element(detect_pipeline, 0);
         if (detect_element) {
-            // Process detection results
-            detect_keypoints.clear();
-            detect_bound.clear();
-            
-            for (const auto& res : *(detect_element->detect_results)) {
-                const auto& box = res.box;
-                // Check if bounding box is valid
-                if (box.size() >= 4 && std::any_of(box.begin(), box.end(), [](int v) { return v != 0; })) {
-                    detect_bound.push_back(box);
-
-                    // Process keypoints only in face detection mode
-                    if ((current_bits & CAMERA_EVENT_HUMAN_DETECT) && 
-                        res.keypoint.size() >= 10 && 
-                        std::any_of(res.keypoint.begin(), res.keypoint.end(), [](int v) { return v != 0; })) {
-                        detect_keypoints.push_back(res.keypoint);
-                    }
+            app_latency_trace_mark(detect_element->detect_result->frame_seq, APP_LATENCY_STAGE_RESULT_DEQUEUE);
+        }
+#if CONFIG_CAMERA_CODE_SCAN
+        // Codes don't move on their own, they are drawn where they were scanned
+        if (current_bits & CAMERA_EVENT_CODE_SCAN) {
+            if (detect_element) {
+                overlay_result = *detect_element->detect_result;
+                camera_pipeline_queue_element_index(detect_pipeline, detect_element->index);
+                if (overlay_result.num > 0) {
+                    app_detect_export_publish_codes(&overlay_result);
                 }
             }
-
-            camera_pipeline_queue_element_index(detect_pipeline, detect_element->index);
-        }
-
-        // Draw detection results
-        uint16_t *rgb_buf = reinterpret_cast<uint16_t*>(camera_buf);
-        for (size_t i = 0; i < detect_bound.size(); i++) {
-            const auto& bound = detect_bound[i];
-            // Check if current bounding box is valid
-            if (bound.size() >= 4 && std::any_of(bound.begin(), bound.end(), [](int v) { return v != 0; })) {
-                // Draw bounding box
-                draw_rectangle_rgb(rgb_buf, camera_buf_hes, camera_buf_ves,
-                                 bound[0], bound[1], bound[2], bound[3],
-                                 0, 0, 255, 0, 0, 3);
-
-                // Draw keypoints in face detection mode
-                if ((current_bits & CAMERA_EVENT_HUMAN_DETECT) && 
-                    i < detect_keypoints.size() && 
-                    detect_keypoints[i].size() >= 10) {
-                    draw_green_points(rgb_buf, detect_keypoints[i]);
+        } else
+#endif
+        {
+#if CONFIG_CAMERA_DETECT_TRACKER
+            if (detect_element) {
+                app_detect_tracker_update(&overlay_tracker, detect_element->detect_result);
+                camera_pipeline_queue_element_index(detect_pipeline, detect_element->index);
+            }
+            // Move the boxes to where the tracked objects should be on this frame
+            app_detect_tracker_predict(&overlay_tracker, frame_time_us, &overlay_result);
+#else
+            if (detect_element) {
+                overlay_result = *detect_element->detect_result;
+                camera_pipeline_queue_element_index(detect_pipeline, detect_element->index);
+            }
+#endif
+            // One record per detector run, with the track IDs of this frame
+            if (detect_element) {
+                overlay_result.frame_seq = detect_element->detect_result->frame_seq;
+                app_detect_export_publish(&overlay_result, current_bits & CAMERA_EVENT_HUMAN_DETECT);
+#if CONFIG_CAMERA_PEOPLE_COUNT
+                // Counted on the same boxes and track IDs, a closed minute goes out on the same link
+                if (current_bits & CAMERA_EVENT_PED_DETECT) {
+                    const app_people_count_bucket_t *closed = NULL;
+                    app_people_count_update(&people_counter, &overlay_result, &closed);
+                    if (closed) {
+                        app_detect_export_publish_counts(closed, people_counter.line_num, people_counter.zone_num);
+                    }
+                } else {
+                    app_people_count_reset_tracks(&people_counter);
                 }
+#endif
             }
         }
+
+#if !CONFIG_CAMERA_OVERLAY_LVGL_LAYER
+        // A shared frame is shown without boxes rather than handed to the detector or the encoders half drawn
+        bool draw_into_frame = !frame_shared;
+#if CONFIG_CAMERA_PREVIEW_ZOOM && !CONFIG_CAMERA_UVC_OVERLAY_BURNED
+        // Drawn into the zoomed copy instead, the webcam is the only other consumer of burned in boxes
+        draw_into_frame = draw_into_frame && !app_preview_zoom_is_ready();
+#endif
+        if (draw_into_frame) {
+            // Draw detection results, keypoints only for faces and the corners of codes
+            app_overlay_draw_result(reinterpret_cast<uint16_t*>(camera_buf), camera_buf_hes, camera_buf_ves,
+                                    &overlay_result, current_bits & (CAMERA_EVENT_HUMAN_DETECT | CAMERA_EVENT_CODE_SCAN));
+            app_latency_trace_mark_index(camera_buf_index, APP_LATENCY_STAGE_OVERLAY);
+        }
+#endif
+    } else {
+        overlay_result.num = 0;
+#if CONFIG_CAMERA_DETECT_TRACKER
+        app_detect_tracker_reset(&overlay_tracker);
+#endif
+#if CONFIG_CAMERA_PEOPLE_COUNT
+        app_people_count_reset_tracks(&people_counter);
+#endif
     }
+#if CONFIG_CAMERA_UVC_OVERLAY_BURNED
+    app_uvc_push_frame(camera_buf, camera_buf_index);
+#elif CONFIG_CAMERA_UVC_OVERLAY_METADATA
+    // Picked up by the webcam encoder once the frame pushed above is encoded
+    app_uvc_set_result(&overlay_result, current_bits & CAMERA_EVENT_HUMAN_DETECT);
+#endif
 
     // Update display if not in delete state
+    bool draw_keypoints = current_bits & (CAMERA_EVENT_HUMAN_DETECT | CAMERA_EVENT_CODE_SCAN);
+    uint8_t *display_buf = camera_buf;
+    uint32_t display_w = camera_buf_hes;
+    uint32_t display_h = camera_buf_ves;
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+    // Falls back to the full frame until the preview buffers are ready
+    uint8_t zoom_index = 0;
+    bool zoomed = !(current_bits & CAMERA_EVENT_DELETE) &&
+                  camera_preview_zoom_render(camera_buf, camera_buf_index, &display_buf, &zoom_index, &display_w,
+                                             &display_h, draw_keypoints);
+#endif
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+    if (!(current_bits & CAMERA_EVENT_DELETE)) {
+        uint32_t frame_seq = app_latency_trace_frame_seq(camera_buf_index);
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+        if (zoomed) {
+            camera_display_sink_post(display_buf, zoom_index, true, frame_seq, display_w, display_h,
+                                     &preview_overlay_result, draw_keypoints);
+        } else
+#endif
+        camera_display_sink_post(display_buf, camera_buf_index, false, frame_seq, display_w, display_h,
+                                 &overlay_result, draw_keypoints);
+    }
+#else
+    bool shown = false;
     if (!(current_bits & CAMERA_EVENT_DELETE) && bsp_display_lock(100)) {
         if (ui_ImageCameraShotImage) {
-            lv_canvas_set_buffer(ui_ImageCameraShotImage, camera_buf, 
-                               camera_buf_hes, camera_buf_ves, 
+            lv_canvas_set_buffer(ui_ImageCameraShotImage, display_buf, 
+                               display_w, display_h, 
                                LV_IMG_CF_TRUE_COLOR);
         }
         lv_refr_now(NULL);
         bsp_display_unlock();
+        app_latency_trace_mark_index(camera_buf_index, APP_LATENCY_STAGE_DISPLAY_FLUSH);
+        shown = true;
     }
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+    // The canvas no longer reads the copy it showed before
+    if (shown && (preview_shown_index >= 0)) {
+        app_preview_zoom_release(preview_shown_index);
+        preview_shown_index = -1;
+    }
+    if (zoomed) {
+        if (shown) {
+            preview_shown_index = zoom_index;
+        } else {
+            app_preview_zoom_release(zoom_index);
+        }
+    }
+#endif
+#endif
 
 #if FPS_PRINT
     static int count = 0;
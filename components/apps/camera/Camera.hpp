@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "lvgl.h"
@@ -22,15 +23,74 @@ public:
     bool resume(void);
     bool back(void);
     bool close(void);
+    bool displayStateChanged(ESP_Brookesia_CoreDisplayState_t state) override;
+    size_t getMemoryFootprint(void) const override;
 
     bool init(void) override;
 
     int get_camera_ctlr_handle(void);
 
+    /**
+     * @brief Initialize the video driver and open the camera sensor
+     *
+     * Does not use LVGL, so it can run in a boot task while the UI is created. init() then uses the
+     * opened device instead of probing again. Call it at most once, before init().
+     *
+     * @return true if the camera sensor is opened
+     */
+    static bool probeSensor(void);
+
+    /**
+     * @brief Restrict detection to a region of the camera frame
+     *
+     * @param x Left edge of the region in frame pixels
+     * @param y Top edge of the region in frame pixels
+     * @param w Width of the region in frame pixels
+     * @param h Height of the region in frame pixels
+     *
+     * @return true if the region lies within the frame
+     */
+    bool setDetectRoi(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+    /**
+     * @brief Set how often camera frames are offered to the detector
+     *
+     * @param frame_interval Offer every N-th frame, must be at least 1
+     * @param min_period_ms Minimum time between two offered frames, 0 for no limit
+     *
+     * @return true if the schedule is valid
+     */
+    bool setDetectSchedule(uint16_t frame_interval, uint16_t min_period_ms);
+
+#if CONFIG_CAMERA_DETECT_MOTION_GATE
+    /**
+     * @brief Configure the motion gate in front of the detector
+     *
+     * @param enable Skip frames without motion and restrict detection to the moving region
+     * @param threshold Mean absolute luma difference of a moving block, 1-255
+     * @param refresh_ms Run on the full region at least this often, 0 to never force it
+     *
+     * @return true if the settings are valid
+     */
+    bool setMotionGate(bool enable, uint8_t threshold, uint16_t refresh_ms);
+#endif
+
+#if CONFIG_CAMERA_FACE_RECOGNITION
+    /**
+     * @brief Enroll the most confident face of the next face detection run
+     *
+     * @param name Name stored with the face in the gallery
+     *
+     * @return true if the request was queued
+     */
+    bool enrollFace(const char *name);
+#endif
+
 private:
     static void taskCameraInit(Camera *app);
     static void onScreenCameraShotBtnClick(lv_event_t *e);
     static void onScreenCameraShotAlbumClick(lv_event_t *e);
+    static void onCaptureDone(const char *path, const uint16_t *thumb, esp_err_t result, void *user_ctx);
     static void camera_dectect_task(Camera *app);
 
     enum {
@@ -43,6 +103,7 @@ private:
     uint16_t _img_album_dsc_size;
     uint32_t _img_album_buf_bytes;
     uint8_t *_img_album_buffer;
+    uint8_t *_img_photo_buffer;
     SemaphoreHandle_t _camera_init_sem;
     int _camera_ctlr_handle;
     lv_img_dsc_t _img_refresh_dsc;
@@ -50,7 +111,5 @@ private:
     lv_img_dsc_t _img_photo_dsc;
     lv_obj_t *_img_album;
     TaskHandle_t _detect_task_handle;
-    uint8_t *_cam_buffer[EXAMPLE_CAM_BUF_NUM];
-    size_t _cam_buffer_size[EXAMPLE_CAM_BUF_NUM];
 };
 
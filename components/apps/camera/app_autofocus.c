@@ -0,0 +1,342 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "linux/videodev2.h"
+#include "app_autofocus.h"
+
+uint32_t app_autofocus_compute_metric(const uint16_t *frame, uint32_t width, uint32_t height)
+{
+    // Central area of a quarter of the width and height, where the subject usually is
+    uint32_t x0 = width * 3 / 8;
+    uint32_t x1 = width * 5 / 8;
+    uint32_t y0 = height * 3 / 8;
+    uint32_t y1 = height * 5 / 8;
+    uint64_t sum_grad = 0;
+    uint32_t sum_green = 0;
+
+    if ((x1 <= x0 + 1) || (y1 <= y0 + 1)) {
+        return 0;
+    }
+
+    // Green only, it carries most of the detail and needs no color conversion
+    for (uint32_t y = y0; y < y1 - 1; y++) {
+        const uint16_t *line = frame + y * width;
+        const uint16_t *next = line + width;
+        uint32_t line_grad = 0;
+        int32_t g = (line[x0] >> 5) & 0x3f;
+
+        for (uint32_t x = x0; x < x1 - 1; x++) {
+            int32_t g_right = (line[x + 1] >> 5) & 0x3f;
+            int32_t g_down = (next[x] >> 5) & 0x3f;
+            int32_t gx = g_right - g;
+            int32_t gy = g_down - g;
+
+            line_grad += gx * gx + gy * gy;
+            sum_green += g;
+            g = g_right;
+        }
+        sum_grad += line_grad;
+    }
+
+    return (uint32_t)((sum_grad << 8) / (sum_green ? sum_green : 1));
+}
+
+#if CONFIG_CAMERA_AUTOFOCUS
+
+#define AF_SETTLE_FRAMES                    (CONFIG_CAMERA_AUTOFOCUS_SETTLE_FRAMES)
+#define AF_COARSE_STEPS                     (16)    // The sweep crosses the lens range in this many steps
+#define AF_RESCAN_STEPS                     (32)    // Continuous rescans start closer to the locked position
+#define AF_FINE_STEPS                       (256)   // The scan ends once its step is below this fraction of the range
+#define AF_FALL_LIMIT                       (2)     // Consecutive drops that mean the peak was passed
+#define AF_MONITOR_INTERVAL                 (8)     // Frames between two checks of the locked position
+#define AF_MONITOR_CHANGE_PERCENT           (30)
+#define AF_MONITOR_CHANGE_COUNT             (3)     // Consecutive changed checks that start a rescan
+#define AF_FLAT_PERCENT                     (10)    // A rescan this flat is too far from the peak, sweep instead
+
+typedef enum {
+    AF_STATE_IDLE = 0,
+    AF_STATE_SCAN,
+    AF_STATE_LOCKED,
+} af_state_t;
+
+typedef struct {
+    af_state_t state;
+    int32_t min;
+    int32_t max;
+    int32_t fine_step;
+    int32_t pos;                /*!< Last position written */
+    int32_t step;
+    int32_t dir;
+    int32_t best_pos;
+    uint32_t best_metric;
+    uint32_t worst_metric;
+    uint32_t falls;
+    bool sweep;                 /*!< Crossing the whole range, a far-off lens sees no slope to climb */
+    bool reversed;              /*!< The current step size already searched the other direction */
+    uint32_t settle;            /*!< Frames to skip before the lens is at the new position */
+    uint32_t locked_metric;     /*!< Sharpness at the locked position, 0 until measured */
+    uint32_t monitor_count;
+    uint32_t changes;
+} af_ctx_t;
+
+static const char *TAG = "app_autofocus";
+
+static int af_fd = -1;
+static af_ctx_t af;
+static volatile app_autofocus_mode_t af_mode = APP_AUTOFOCUS_MODE_OFF;
+static bool af_scan_requested = false;      // Set by the UI, consumed by the stream task
+
+static esp_err_t af_write_pos(int32_t pos)
+{
+    struct v4l2_ext_control control = {
+        .id = V4L2_CID_FOCUS_ABSOLUTE,
+        .value = pos,
+    };
+    struct v4l2_ext_controls controls = {
+        .ctrl_class = V4L2_CTRL_CLASS_CAMERA,
+        .count = 1,
+        .controls = &control,
+    };
+
+    return (ioctl(af_fd, VIDIOC_S_EXT_CTRLS, &controls) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static void af_move(int32_t pos)
+{
+    if (pos != af.pos) {
+        if (af_write_pos(pos) != ESP_OK) {
+            ESP_LOGD(TAG, "Move lens to %" PRId32 " failed", pos);
+        }
+        af.pos = pos;
+    }
+    af.settle = AF_SETTLE_FRAMES;
+}
+
+static void af_start_scan(int32_t steps, bool sweep)
+{
+    af.step = (af.max - af.min) / steps;
+    if (af.step < af.fine_step) {
+        af.step = af.fine_step;
+    }
+    af.dir = (af.pos < (af.min + af.max) / 2) ? 1 : -1;
+    af.best_metric = 0;
+    af.worst_metric = UINT32_MAX;
+    af.falls = 0;
+    af.sweep = sweep;
+    af.reversed = false;
+    af.state = AF_STATE_SCAN;
+    if (sweep) {
+        // From the nearer end of the range towards the other one
+        af_move((af.dir > 0) ? af.min : af.max);
+    } else {
+        // Climb from where the lens is, measured first
+        af.settle = 0;
+    }
+    af.best_pos = af.pos;
+}
+
+static void af_lock(void)
+{
+    if ((uint64_t)af.best_metric * 100 < (uint64_t)af.worst_metric * (100 + AF_FLAT_PERCENT)) {
+        ESP_LOGD(TAG, "No slope around %" PRId32 ", sweep", af.best_pos);
+        af_start_scan(AF_COARSE_STEPS, true);
+        return;
+    }
+    ESP_LOGD(TAG, "Locked at %" PRId32 ", metric %" PRIu32, af.best_pos, af.best_metric);
+    af_move(af.best_pos);
+    af.locked_metric = 0;
+    af.monitor_count = 0;
+    af.changes = 0;
+    af.state = AF_STATE_LOCKED;
+}
+
+/* After the optional sweep, hill climb: go on while the sharpness rises, search the other side of the best
+ * position once it falls, then halve the step around the best position until the step is fine enough */
+static void af_scan_update(uint32_t metric)
+{
+    int32_t base = af.pos;
+
+    if (metric > af.best_metric) {
+        af.best_metric = metric;
+        af.best_pos = af.pos;
+        af.falls = 0;
+    } else {
+        af.falls++;
+    }
+    if (metric < af.worst_metric) {
+        af.worst_metric = metric;
+    }
+
+    if (af.sweep) {
+        int32_t next = af.pos + af.dir * af.step;
+
+        if ((next >= af.min) && (next <= af.max)) {
+            af_move(next);
+            return;
+        }
+        af.sweep = false;
+        // The sweep itself decides, the climb only refines
+        af.worst_metric = 0;
+        af.step /= 2;
+        af.falls = 0;
+        base = af.best_pos;
+    }
+
+    while (1) {
+        if (af.falls < AF_FALL_LIMIT) {
+            int32_t next = base + af.dir * af.step;
+
+            if ((next >= af.min) && (next <= af.max)) {
+                af_move(next);
+                return;
+            }
+        }
+
+        if (af.reversed) {
+            af.step /= 2;
+            if (af.step < af.fine_step) {
+                af_lock();
+                return;
+            }
+        }
+        af.reversed = !af.reversed;
+        af.dir = -af.dir;
+        af.falls = 0;
+        base = af.best_pos;
+    }
+}
+
+static void af_monitor_update(uint32_t metric)
+{
+    if (af.locked_metric == 0) {
+        af.locked_metric = metric ? metric : 1;
+        return;
+    }
+
+    uint64_t low = (uint64_t)af.locked_metric * (100 - AF_MONITOR_CHANGE_PERCENT);
+    uint64_t high = (uint64_t)af.locked_metric * (100 + AF_MONITOR_CHANGE_PERCENT);
+    uint64_t scaled = (uint64_t)metric * 100;
+
+    // A single changed check is usually something passing in front of the lens
+    af.changes = ((scaled < low) || (scaled > high)) ? (af.changes + 1) : 0;
+    if (af.changes >= AF_MONITOR_CHANGE_COUNT) {
+        ESP_LOGD(TAG, "Sharpness changed from %" PRIu32 " to %" PRIu32 ", rescan", af.locked_metric, metric);
+        af_start_scan(AF_RESCAN_STEPS, false);
+    }
+}
+
+esp_err_t app_autofocus_init(int video_fd)
+{
+    struct v4l2_queryctrl qctrl = {
+        .id = V4L2_CID_FOCUS_ABSOLUTE,
+    };
+    struct v4l2_ext_control control = {
+        .id = V4L2_CID_FOCUS_ABSOLUTE,
+    };
+    struct v4l2_ext_controls controls = {
+        .ctrl_class = V4L2_CTRL_CLASS_CAMERA,
+        .count = 1,
+        .controls = &control,
+    };
+
+    ESP_RETURN_ON_FALSE(video_fd >= 0, ESP_ERR_INVALID_ARG, TAG, "Invalid video fd");
+    if ((ioctl(video_fd, VIDIOC_QUERYCTRL, &qctrl) != 0) || (qctrl.flags & V4L2_CTRL_FLAG_DISABLED) ||
+            (qctrl.maximum <= qctrl.minimum)) {
+        ESP_LOGW(TAG, "No focus motor");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memset(&af, 0, sizeof(af));
+    af.min = qctrl.minimum;
+    af.max = qctrl.maximum;
+    af.fine_step = (af.max - af.min) / AF_FINE_STEPS;
+    if (af.fine_step < qctrl.step) {
+        af.fine_step = qctrl.step;
+    }
+    if (af.fine_step < 1) {
+        af.fine_step = 1;
+    }
+    af.pos = (ioctl(video_fd, VIDIOC_G_EXT_CTRLS, &controls) == 0) ? control.value : qctrl.default_value;
+    af_fd = video_fd;
+    ESP_LOGI(TAG, "Focus range %" PRId32 "-%" PRId32 ", at %" PRId32, af.min, af.max, af.pos);
+
+#if CONFIG_CAMERA_AUTOFOCUS_DEFAULT_CONTINUOUS
+    return app_autofocus_set_mode(APP_AUTOFOCUS_MODE_CONTINUOUS);
+#else
+    return app_autofocus_set_mode(APP_AUTOFOCUS_MODE_ONE_SHOT);
+#endif
+}
+
+esp_err_t app_autofocus_set_mode(app_autofocus_mode_t mode)
+{
+    ESP_RETURN_ON_FALSE(af_fd >= 0, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    af_mode = mode;
+    // The stream task stops or starts the scan on its next frame
+    __atomic_store_n(&af_scan_requested, true, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+app_autofocus_mode_t app_autofocus_get_mode(void)
+{
+    return af_mode;
+}
+
+esp_err_t app_autofocus_trigger(void)
+{
+    ESP_RETURN_ON_FALSE(af_fd >= 0, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(af_mode != APP_AUTOFOCUS_MODE_OFF, ESP_ERR_INVALID_STATE, TAG, "Autofocus is off");
+
+    __atomic_store_n(&af_scan_requested, true, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+void app_autofocus_process_frame(const uint16_t *frame, uint32_t width, uint32_t height)
+{
+    if (af_fd < 0) {
+        return;
+    }
+
+    if (__atomic_exchange_n(&af_scan_requested, false, __ATOMIC_ACQ_REL)) {
+        if (af_mode == APP_AUTOFOCUS_MODE_OFF) {
+            af.state = AF_STATE_IDLE;
+        } else {
+            af_start_scan(AF_COARSE_STEPS, true);
+        }
+    }
+
+    switch (af.state) {
+    case AF_STATE_SCAN:
+        // Frames exposed while the lens was moving would give a wrong sharpness
+        if (af.settle > 0) {
+            af.settle--;
+            break;
+        }
+        af_scan_update(app_autofocus_compute_metric(frame, width, height));
+        break;
+    case AF_STATE_LOCKED:
+        if (af.settle > 0) {
+            af.settle--;
+            break;
+        }
+        if ((af_mode != APP_AUTOFOCUS_MODE_CONTINUOUS) || ((af.monitor_count++ % AF_MONITOR_INTERVAL) != 0)) {
+            break;
+        }
+        af_monitor_update(app_autofocus_compute_metric(frame, width, height));
+        break;
+    default:
+        break;
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_AUTOFOCUS_H
+#define APP_AUTOFOCUS_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Autofocus modes.
+ */
+typedef enum {
+    APP_AUTOFOCUS_MODE_OFF = 0,             /*!< The lens stays where it is. */
+    APP_AUTOFOCUS_MODE_ONE_SHOT,            /*!< Scan once on every trigger, then hold the lens. */
+    APP_AUTOFOCUS_MODE_CONTINUOUS,          /*!< Rescan whenever the sharpness of the locked position drops. */
+} app_autofocus_mode_t;
+
+/**
+ * @brief Compute the sharpness of the center of an RGB565 frame.
+ *
+ * Sum of the squared horizontal and vertical green gradients (Tenengrad) over the center quarter of the
+ * frame, divided by its brightness so exposure changes don't look like focus changes.
+ *
+ * @param frame RGB565 pixels.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ *
+ * @return Focus metric, larger is sharper.
+ */
+uint32_t app_autofocus_compute_metric(const uint16_t *frame, uint32_t width, uint32_t height);
+
+#if CONFIG_CAMERA_AUTOFOCUS
+/**
+ * @brief Take over the focus motor of a video device.
+ *
+ * @param video_fd File descriptor of the opened video device.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the module has no focus motor.
+ */
+esp_err_t app_autofocus_init(int video_fd);
+
+/**
+ * @brief Change the autofocus mode, switching to ONE_SHOT or CONTINUOUS starts a scan.
+ *
+ * @param mode New mode.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized.
+ */
+esp_err_t app_autofocus_set_mode(app_autofocus_mode_t mode);
+
+/**
+ * @brief Get the current autofocus mode.
+ *
+ * @return Current mode.
+ */
+app_autofocus_mode_t app_autofocus_get_mode(void);
+
+/**
+ * @brief Start a new scan in ONE_SHOT or CONTINUOUS mode.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized or the mode is OFF.
+ */
+esp_err_t app_autofocus_trigger(void);
+
+/**
+ * @brief Feed a frame, the lens moves at most once per frame.
+ *
+ * Must be called from the video stream task.
+ *
+ * @param frame RGB565 pixels.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ */
+void app_autofocus_process_frame(const uint16_t *frame, uint32_t width, uint32_t height);
+#else
+static inline esp_err_t app_autofocus_init(int video_fd) { return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t app_autofocus_set_mode(app_autofocus_mode_t mode) { return ESP_ERR_NOT_SUPPORTED; }
+static inline app_autofocus_mode_t app_autofocus_get_mode(void) { return APP_AUTOFOCUS_MODE_OFF; }
+static inline esp_err_t app_autofocus_trigger(void) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void app_autofocus_process_frame(const uint16_t *frame, uint32_t width, uint32_t height) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
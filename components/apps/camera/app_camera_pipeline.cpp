@@ -26,13 +26,75 @@
 
 static const char *TAG = "app_camera_pipeline";
 
+/**
+ * Single-producer/single-consumer ring of element indices. `head` is only written by the producer
+ * and `tail` only by the consumer, so neither side needs a lock or masks interrupts.
+ */
+typedef struct {
+    uint32_t *slots;                        /*!< Element indices, `mask + 1` entries. */
+    uint32_t mask;                          /*!< Ring capacity minus one, capacity is a power of two. */
+    uint32_t head;                          /*!< Next slot to write, owned by the producer. */
+    uint32_t tail;                          /*!< Next slot to read, owned by the consumer. */
+} camera_pipeline_ring_t;
+
+static esp_err_t ring_init(camera_pipeline_ring_t *ring, uint32_t min_size)
+{
+    uint32_t size = 1;
+    while (size < min_size) {
+        size <<= 1;
+    }
+
+    // Accessed from the PPA ISR, keep it out of PSRAM
+    ring->slots = static_cast<uint32_t *>(heap_caps_calloc(size, sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    ESP_RETURN_ON_FALSE(ring->slots, ESP_ERR_NO_MEM, TAG, "Failed to allocate ring slots");
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return ESP_OK;
+}
+
+static inline bool IRAM_ATTR ring_push(camera_pipeline_ring_t *ring, uint32_t index)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail > ring->mask) {
+        return false;
+    }
+    ring->slots[head & ring->mask] = index;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static inline bool IRAM_ATTR ring_pop(camera_pipeline_ring_t *ring, uint32_t *index)
+{
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (tail == head) {
+        return false;
+    }
+    *index = ring->slots[tail & ring->mask];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
 struct camera_pipeline_stream {
     bool started;                           /*!< Indicates whether the video stream has been started. */
     int elem_num;                           /*!< The number of element available for the stream. */
+    camera_pipeline_mode_t mode;            /*!< Queue implementation selected at creation. */
+    camera_pipeline_drop_policy_t drop_policy; /*!< Drop policy of the ring mode. */
+    uint32_t dropped;                       /*!< Number of done elements skipped by the drop policy. */
 
     camera_pipeline_buffer_list_t queued_list; /*!< List of buffer elements that are currently queued for processing. */
     camera_pipeline_buffer_list_t done_list;   /*!< List of buffer elements that have been processed and are done. */
 
+    camera_pipeline_ring_t queued_ring;     /*!< Ring mode counterpart of `queued_list`. */
+    camera_pipeline_ring_t done_ring;       /*!< Ring mode counterpart of `done_list`. */
+
     struct camera_pipeline_buffer_element *element; /*!< Pointer to the array of buffer elements used for storing image data. */
 
     portMUX_TYPE stream_lock;              /*!< Mutex used for synchronizing access to the video stream's data structures. */
@@ -60,6 +122,13 @@ esp_err_t camera_element_pipeline_new(camera_pipeline_cfg_t *cfg, pipeline_handl
     SLIST_INIT(&stream->queued_list);
     SLIST_INIT(&stream->done_list);
 
+    stream->mode = cfg->mode;
+    stream->drop_policy = cfg->drop_policy;
+    if (stream->mode == CAMERA_PIPELINE_MODE_SPSC_RING) {
+        ESP_GOTO_ON_ERROR(ring_init(&stream->queued_ring, cfg->elem_num), err, TAG, "Failed to init queued ring");
+        ESP_GOTO_ON_ERROR(ring_init(&stream->done_ring, cfg->elem_num), err, TAG, "Failed to init done ring");
+    }
+
     portMUX_INITIALIZE(&stream->stream_lock);
 
     stream->ready_sem = xSemaphoreCreateCounting(cfg->elem_num, 0);
@@ -68,7 +137,10 @@ esp_err_t camera_element_pipeline_new(camera_pipeline_cfg_t *cfg, pipeline_handl
     for (int i = 0; i < cfg->elem_num; i++) {
         struct camera_pipeline_buffer_element *element = &stream->element[i];
 
-        if (!cfg->elements || !cfg->elements[i]) {
+        if (cfg->buffer_size == 0) {
+            element->buffer = NULL;
+            element->internal = false;
+        } else if (!cfg->elements || !cfg->elements[i]) {
             uint16_t* elements = static_cast<uint16_t*>(
                 heap_caps_aligned_calloc(cfg->align_size, 1, cfg->buffer_size, cfg->caps)
             );
@@ -82,6 +154,9 @@ esp_err_t camera_element_pipeline_new(camera_pipeline_cfg_t *cfg, pipeline_handl
 
         element->index = i;
         element->valid_size = cfg->buffer_size;
+        if (cfg->buffer_size >= sizeof(camera_pipeline_detect_result_t)) {
+            element->detect_result = reinterpret_cast<camera_pipeline_detect_result_t *>(element->buffer);
+        }
         ELEMENT_SET_FREE(element);
         camera_pipeline_queue_element_index(stream, i);
         stream->elem_num++;
@@ -93,6 +168,10 @@ esp_err_t camera_element_pipeline_new(camera_pipeline_cfg_t *cfg, pipeline_handl
     return ESP_OK;
 
 err:
+    if (!stream) {
+        return ret;
+    }
+
     for (int i = 0; i < stream->elem_num; i++) {
         if (stream->element[i].internal) {
             free(stream->element[i].buffer);
@@ -102,14 +181,13 @@ err:
     if (stream->ready_sem) {
         vSemaphoreDelete(stream->ready_sem);
     }
-    portEXIT_CRITICAL(&stream->stream_lock);
 
+    free(stream->queued_ring.slots);
+    free(stream->done_ring.slots);
     if (stream->element) {
         free(stream->element);
     }
-    if (stream) {
-        free(stream);
-    }
+    free(stream);
     return ret;
 }
 
@@ -127,8 +205,9 @@ esp_err_t camera_element_pipeline_delete(pipeline_handle_t pipeline)
     if (stream->ready_sem) {
         vSemaphoreDelete(stream->ready_sem);
     }
-    portEXIT_CRITICAL(&stream->stream_lock);
 
+    free(stream->queued_ring.slots);
+    free(stream->done_ring.slots);
     free(stream->element);
     free(stream);
 
@@ -142,6 +221,19 @@ esp_err_t camera_pipeline_queue_element(pipeline_handle_t pipline, struct camera
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (stream->mode == CAMERA_PIPELINE_MODE_SPSC_RING) {
+        // The caller owns the element here, no other side can touch its flag
+        if (!ELEMENT_IS_FREE(element)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        ELEMENT_SET_ALLOCATED(element);
+        if (!ring_push(&stream->queued_ring, element->index)) {
+            ELEMENT_SET_FREE(element);
+            return ESP_ERR_NO_MEM;
+        }
+        return ESP_OK;
+    }
+
     portENTER_CRITICAL_SAFE(&stream->stream_lock);
     if (!ELEMENT_IS_FREE(element)) {
         portEXIT_CRITICAL_SAFE(&stream->stream_lock);
@@ -180,6 +272,15 @@ struct camera_pipeline_buffer_element *camera_pipeline_get_queued_element(pipeli
         return NULL;
     }
 
+    if (stream->mode == CAMERA_PIPELINE_MODE_SPSC_RING) {
+        uint32_t index;
+        if (ring_pop(&stream->queued_ring, &index)) {
+            element = ELEMENT_GET_BY_INDEX(stream, index);
+            ELEMENT_SET_FREE(element);
+        }
+        return element;
+    }
+
     portENTER_CRITICAL_SAFE(&stream->stream_lock);
     if (!SLIST_EMPTY(&stream->queued_list)) {
         element = SLIST_FIRST(&stream->queued_list);
@@ -200,6 +301,31 @@ struct camera_pipeline_buffer_element *camera_pipeline_get_done_element(pipeline
         return NULL;
     }
 
+    if (stream->mode == CAMERA_PIPELINE_MODE_SPSC_RING) {
+        uint32_t index;
+        if (!ring_pop(&stream->done_ring, &index)) {
+            return NULL;
+        }
+        element = ELEMENT_GET_BY_INDEX(stream, index);
+        ELEMENT_SET_FREE(element);
+
+        // Latest frame wins: recycle everything older than the newest done element
+        while ((stream->drop_policy == CAMERA_PIPELINE_DROP_OLDEST) && ring_pop(&stream->done_ring, &index)) {
+            struct camera_pipeline_buffer_element *newer = ELEMENT_GET_BY_INDEX(stream, index);
+
+            ELEMENT_SET_FREE(newer);
+            if (__atomic_load_n(&element->ref_count, __ATOMIC_ACQUIRE) != 0) {
+                camera_pipeline_element_release(element);
+            }
+            camera_pipeline_queue_element(stream, element);
+            // Keep the semaphore count in step with the ring
+            xSemaphoreTake(stream->ready_sem, 0);
+            stream->dropped++;
+            element = newer;
+        }
+        return element;
+    }
+
     portENTER_CRITICAL_SAFE(&stream->stream_lock);
     if (!SLIST_EMPTY(&stream->done_list)) {
         element = SLIST_FIRST(&stream->done_list);
@@ -218,16 +344,27 @@ esp_err_t IRAM_ATTR camera_pipeline_done_element(pipeline_handle_t pipline, stru
         return ESP_ERR_INVALID_ARG;
     }
 
-    portENTER_CRITICAL_SAFE(&stream->stream_lock);
-    if (!ELEMENT_IS_FREE(element)) {
+    if (stream->mode == CAMERA_PIPELINE_MODE_SPSC_RING) {
+        if (!ELEMENT_IS_FREE(element)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        ELEMENT_SET_ALLOCATED(element);
+        if (!ring_push(&stream->done_ring, element->index)) {
+            ELEMENT_SET_FREE(element);
+            return ESP_ERR_NO_MEM;
+        }
+    } else {
+        portENTER_CRITICAL_SAFE(&stream->stream_lock);
+        if (!ELEMENT_IS_FREE(element)) {
+            portEXIT_CRITICAL_SAFE(&stream->stream_lock);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        ELEMENT_SET_ALLOCATED(element);
+        SLIST_INSERT_HEAD(&stream->done_list, element, node);
         portEXIT_CRITICAL_SAFE(&stream->stream_lock);
-        return ESP_ERR_INVALID_ARG;
     }
 
-    ELEMENT_SET_ALLOCATED(element);
-    SLIST_INSERT_HEAD(&stream->done_list, element, node);
-    portEXIT_CRITICAL_SAFE(&stream->stream_lock);
-
     if (xPortInIsrContext()) {
         BaseType_t wakeup = pdFALSE;
 
@@ -261,3 +398,76 @@ struct camera_pipeline_buffer_element *camera_pipeline_recv_element(pipeline_han
 
     return element;
 }
+
+
+esp_err_t camera_pipeline_element_attach_frame(struct camera_pipeline_buffer_element *element, uint16_t *frame, uint32_t frame_index,
+                                               camera_pipeline_frame_release_cb_t release_cb, void *release_ctx)
+{
+    ESP_RETURN_ON_FALSE(element && frame, ESP_ERR_INVALID_ARG, TAG, "Invalid element or frame");
+
+    uint32_t expected = 0;
+    // Reserve the element before publishing the frame so a concurrent acquire can't see a half-filled element
+    ESP_RETURN_ON_FALSE(__atomic_compare_exchange_n(&element->ref_count, &expected, UINT32_MAX, false,
+                                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED),
+                        ESP_ERR_INVALID_STATE, TAG, "Element %" PRIu32 " already holds a frame", element->index);
+
+    element->frame = frame;
+    element->frame_index = frame_index;
+    element->release_cb = release_cb;
+    element->release_ctx = release_ctx;
+    __atomic_store_n(&element->ref_count, 1, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+esp_err_t camera_pipeline_element_acquire(struct camera_pipeline_buffer_element *element)
+{
+    ESP_RETURN_ON_FALSE(element, ESP_ERR_INVALID_ARG, TAG, "Invalid element");
+
+    uint32_t count = __atomic_load_n(&element->ref_count, __ATOMIC_RELAXED);
+    do {
+        ESP_RETURN_ON_FALSE((count != 0) && (count != UINT32_MAX), ESP_ERR_INVALID_STATE, TAG,
+                            "Element %" PRIu32 " holds no frame", element->index);
+    } while (!__atomic_compare_exchange_n(&element->ref_count, &count, count + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    return ESP_OK;
+}
+
+esp_err_t camera_pipeline_element_release(struct camera_pipeline_buffer_element *element)
+{
+    ESP_RETURN_ON_FALSE(element, ESP_ERR_INVALID_ARG, TAG, "Invalid element");
+
+    uint32_t count = __atomic_load_n(&element->ref_count, __ATOMIC_RELAXED);
+    do {
+        ESP_RETURN_ON_FALSE((count != 0) && (count != UINT32_MAX), ESP_ERR_INVALID_STATE, TAG,
+                            "Element %" PRIu32 " holds no frame", element->index);
+        // The last holder keeps the element reserved until the frame is detached
+    } while (!__atomic_compare_exchange_n(&element->ref_count, &count, (count == 1) ? UINT32_MAX : count - 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (count == 1) {
+        camera_pipeline_frame_release_cb_t release_cb = element->release_cb;
+        void *release_ctx = element->release_ctx;
+        uint32_t frame_index = element->frame_index;
+
+        element->frame = NULL;
+        element->release_cb = NULL;
+        element->release_ctx = NULL;
+        __atomic_store_n(&element->ref_count, 0, __ATOMIC_RELEASE);
+        if (release_cb) {
+            release_cb(release_ctx, frame_index);
+        }
+    }
+
+    return ESP_OK;
+}
+
+uint32_t camera_pipeline_get_dropped_count(pipeline_handle_t pipline)
+{
+    struct camera_pipeline_stream *stream = (struct camera_pipeline_stream *)pipline;
+    if (!stream) {
+        return 0;
+    }
+
+    return __atomic_load_n(&stream->dropped, __ATOMIC_RELAXED);
+}
\ No newline at end of file
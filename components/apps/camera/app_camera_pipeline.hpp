@@ -1,6 +1,9 @@
+#pragma once
+
 #include <stdint.h>
 #include <stddef.h>
 #include <sys/queue.h>
+#include "sdkconfig.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -22,6 +25,71 @@ typedef SLIST_ENTRY(camera_pipeline_buffer_element) camera_pipeline_buffer_node_
  */
 typedef SLIST_HEAD(camera_pipeline_buffer_list, camera_pipeline_buffer_element) camera_pipeline_buffer_list_t;
 
+/**
+ * @brief Callback invoked when the last reference of a frame attached to an element is released.
+ *
+ * @param user_ctx User context passed to `camera_pipeline_element_attach_frame`.
+ * @param frame_index Index of the frame (e.g. the V4L2 buffer index) attached to the element.
+ */
+typedef void (*camera_pipeline_frame_release_cb_t)(void *user_ctx, uint32_t frame_index);
+
+/**
+ * @brief Rectangle in frame pixel coordinates.
+ */
+typedef struct {
+    uint16_t x;                                       /*!< Left edge. */
+    uint16_t y;                                       /*!< Top edge. */
+    uint16_t w;                                       /*!< Width. */
+    uint16_t h;                                       /*!< Height. */
+} camera_pipeline_rect_t;
+
+#define CAMERA_PIPELINE_DETECT_RESULT_MAX       (10)  /*!< Maximum number of detections kept per frame. */
+#define CAMERA_PIPELINE_DETECT_KEYPOINT_MAX     (10)  /*!< Maximum number of keypoint coordinates per detection (x/y pairs). */
+#define CAMERA_PIPELINE_CODE_MAX                (2)   /*!< Maximum number of scanned codes kept per frame. */
+#define CAMERA_PIPELINE_CODE_TEXT_MAX           (128) /*!< Size of the text of a scanned code, terminator included. */
+
+/**
+ * @brief A single detection in frame pixel coordinates, kept as plain data so it can live in a preallocated buffer.
+ */
+typedef struct {
+    int category;                                     /*!< Detected category. */
+    float score;                                      /*!< Detection score. */
+    int box[4];                                       /*!< Bounding box as x1, y1, x2, y2. */
+    int keypoint[CAMERA_PIPELINE_DETECT_KEYPOINT_MAX]; /*!< Keypoints as x/y pairs. */
+    uint8_t keypoint_num;                             /*!< Number of valid entries in `keypoint`. */
+    uint16_t track_id;                                /*!< ID of the track the box belongs to, 0 if untracked. */
+    uint16_t face_id;                                 /*!< Gallery ID of the recognized face, 0 if unknown. */
+} camera_pipeline_detect_box_t;
+
+/**
+ * @brief Fixed-capacity detection result of one frame.
+ */
+typedef struct {
+    int64_t timestamp_us;                             /*!< Capture time of the analysed frame. */
+    uint32_t frame_seq;                               /*!< Latency trace sequence number of the analysed frame, 0 if untraced. */
+    uint32_t num;                                     /*!< Number of valid entries in `boxes`. */
+    camera_pipeline_detect_box_t boxes[CAMERA_PIPELINE_DETECT_RESULT_MAX]; /*!< Detections. */
+#if CONFIG_CAMERA_CODE_SCAN
+    char code_text[CAMERA_PIPELINE_CODE_MAX][CAMERA_PIPELINE_CODE_TEXT_MAX]; /*!< In code scan mode, text of `boxes[i]`. */
+#endif
+} camera_pipeline_detect_result_t;
+
+/**
+ * @brief Camera Image Recognition (IR) pipeline queue implementation.
+ */
+typedef enum {
+    CAMERA_PIPELINE_MODE_LIST = 0,                    /*!< Spinlock-guarded lists, any number of producers and consumers. */
+    CAMERA_PIPELINE_MODE_SPSC_RING,                   /*!< Lock-free FIFO rings, exactly one producer and one consumer task. */
+} camera_pipeline_mode_t;
+
+/**
+ * @brief Camera Image Recognition (IR) pipeline drop policy, only used by `CAMERA_PIPELINE_MODE_SPSC_RING`.
+ */
+typedef enum {
+    CAMERA_PIPELINE_DROP_NONE = 0,                    /*!< The consumer receives every done element in order. */
+    CAMERA_PIPELINE_DROP_OLDEST,                      /*!< Latest frame wins, the consumer skips stale done elements. */
+} camera_pipeline_drop_policy_t;
+
 /**
  * @brief Camera Image Recognition (IR) configuration structure.
  *
@@ -32,7 +100,9 @@ typedef struct {
     void **elements;                                  /*!< Pointer to an array of elements buffers. */
     uint32_t align_size;                              /*!< Buffer align size in byte */
     uint32_t caps;                                    /*!< Memory allocation capabilities (e.g., SPIRAM, DRAM). */
-    uint32_t buffer_size;                             /*!< Size of each buffer in pixels. */
+    uint32_t buffer_size;                             /*!< Size of each buffer in bytes. 0 means elements only carry attached frames. */
+    camera_pipeline_mode_t mode;                      /*!< Queue implementation, defaults to `CAMERA_PIPELINE_MODE_LIST`. */
+    camera_pipeline_drop_policy_t drop_policy;        /*!< Drop policy of `CAMERA_PIPELINE_MODE_SPSC_RING`. */
 } camera_pipeline_cfg_t;
 
 /**
@@ -49,7 +119,16 @@ struct camera_pipeline_buffer_element {
     uint16_t *buffer;                                  /*!< Pointer to the buffer space used to store data. */
 
     uint32_t valid_size;                              /*!< Valid data size */
-    std::list<dl::detect::result_t> *detect_results;   /*!< List of detection results */
+    camera_pipeline_detect_result_t *detect_result;   /*!< Detection results, points into `buffer` for result pipelines. */
+
+    uint16_t *frame;                                  /*!< Borrowed frame attached to this element, not owned by the pipeline. */
+    uint32_t frame_index;                             /*!< Index of the attached frame, passed back to `release_cb`. */
+    uint32_t ref_count;                               /*!< Number of consumers still holding the attached frame. */
+    camera_pipeline_frame_release_cb_t release_cb;    /*!< Called once `ref_count` drops to zero. */
+    void *release_ctx;                                /*!< User context for `release_cb`. */
+
+    int64_t timestamp_us;                             /*!< Capture time of the attached frame. */
+    camera_pipeline_rect_t roi;                       /*!< Region of the source frame that `buffer` was produced from. */
 };
 
 /**
@@ -150,3 +229,52 @@ struct camera_pipeline_buffer_element *camera_pipeline_get_done_element(pipeline
  * @return Pointer to the received buffer element, or NULL if the timeout expires.
  */
 struct camera_pipeline_buffer_element *camera_pipeline_recv_element(pipeline_handle_t pipline, uint32_t ticks);
+
+/**
+ * @brief Get the number of done elements skipped by the `CAMERA_PIPELINE_DROP_OLDEST` policy.
+ *
+ * @param pipline Handle to the pipeline.
+ *
+ * @return Number of dropped elements since the pipeline was created.
+ */
+uint32_t camera_pipeline_get_dropped_count(pipeline_handle_t pipline);
+
+
+/**
+ * @brief Attach a borrowed frame to a buffer element without copying it.
+ *
+ * The element takes over one reference of the frame. Further consumers call
+ * `camera_pipeline_element_acquire`, and every holder must call `camera_pipeline_element_release`.
+ * When the last reference is released, `release_cb` is invoked so the owner (e.g. the V4L2
+ * stream) can reuse the frame.
+ *
+ * @param element Buffer element, must not have a frame attached.
+ * @param frame Pointer to the frame data.
+ * @param frame_index Index of the frame, passed back to `release_cb`.
+ * @param release_cb Callback invoked when the last reference is released (can be NULL).
+ * @param release_ctx User context for `release_cb`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on invalid arguments, ESP_ERR_INVALID_STATE if a frame is already attached.
+ */
+esp_err_t camera_pipeline_element_attach_frame(struct camera_pipeline_buffer_element *element, uint16_t *frame, uint32_t frame_index,
+                                               camera_pipeline_frame_release_cb_t release_cb, void *release_ctx);
+
+/**
+ * @brief Take an additional reference on the frame attached to a buffer element.
+ *
+ * @param element Buffer element with an attached frame.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on invalid arguments, ESP_ERR_INVALID_STATE if no frame is attached.
+ */
+esp_err_t camera_pipeline_element_acquire(struct camera_pipeline_buffer_element *element);
+
+/**
+ * @brief Drop a reference on the frame attached to a buffer element.
+ *
+ * When the last reference is dropped, the frame is detached and `release_cb` is invoked.
+ *
+ * @param element Buffer element with an attached frame.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on invalid arguments, ESP_ERR_INVALID_STATE if no frame is attached.
+ */
+esp_err_t camera_pipeline_element_release(struct camera_pipeline_buffer_element *element);
@@ -0,0 +1,255 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "linux/videodev2.h"
+#include "app_camera_service.h"
+
+struct app_camera_service_subscriber {
+    app_camera_service_subscriber_config_t config;
+    bool active;
+};
+
+static const char *TAG = "app_camera_service";
+
+static app_camera_service_config_t service_config;
+static app_video_buf_config_t service_buf_config;
+static uint32_t service_width = 0;
+static uint32_t service_height = 0;
+static bool service_initialized = false;
+static bool service_bufs_ready = false;
+// Subscribe, unsubscribe, suspend and resume run one at a time, they may wait for the stream task
+static SemaphoreHandle_t service_ctrl_lock = NULL;
+// Held by the stream task while it calls the subscribers, so an unsubscribed callback is never called again
+static SemaphoreHandle_t service_dispatch_lock = NULL;
+static struct app_camera_service_subscriber service_subscribers[APP_CAMERA_SERVICE_SUBSCRIBER_MAX];
+static uint32_t service_subscriber_num = 0;
+static bool service_suspended = false;
+static bool service_streaming = false;
+
+static void service_dispatch(uint8_t *camera_buf, uint8_t camera_buf_index, uint32_t camera_buf_hes,
+                             uint32_t camera_buf_ves, size_t camera_buf_len)
+{
+    xSemaphoreTake(service_dispatch_lock, portMAX_DELAY);
+    for (int i = 0; i < APP_CAMERA_SERVICE_SUBSCRIBER_MAX; i++) {
+        struct app_camera_service_subscriber *subscriber = &service_subscribers[i];
+
+        if (subscriber->active) {
+            subscriber->config.frame_cb(camera_buf, camera_buf_index, camera_buf_hes, camera_buf_ves, camera_buf_len,
+                                        subscriber->config.user_ctx);
+        }
+    }
+    xSemaphoreGive(service_dispatch_lock);
+}
+
+static esp_err_t service_alloc_bufs(void)
+{
+    if (service_bufs_ready) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = app_video_alloc_bufs(service_config.video_fd, &service_buf_config);
+    // A configuration that doesn't fit this build must not leave the camera without buffers
+    if ((ret == ESP_ERR_INVALID_ARG) || (ret == ESP_ERR_NO_MEM)) {
+        ESP_LOGW(TAG, "%" PRIu32 " buffers in mode %d failed (%s), using the defaults", service_buf_config.buf_num,
+                 service_buf_config.mode, esp_err_to_name(ret));
+        ret = app_video_alloc_bufs(service_config.video_fd, &service_config.buf_config);
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "Allocate video buffers failed");
+    // The driver keeps the buffers across stream restarts
+    service_bufs_ready = true;
+
+    return ESP_OK;
+}
+
+static esp_err_t service_stream_start(void)
+{
+    if (service_streaming || service_suspended || (service_subscriber_num == 0)) {
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(service_alloc_bufs(), TAG, "No buffers to stream into");
+    ESP_RETURN_ON_ERROR(app_video_stream_task_start(service_config.video_fd, service_config.core_id), TAG,
+                        "Start stream failed");
+    service_streaming = true;
+    ESP_LOGI(TAG, "Stream started for %" PRIu32 " subscribers", service_subscriber_num);
+
+    return ESP_OK;
+}
+
+static void service_stream_stop(void)
+{
+    if (!service_streaming) {
+        return;
+    }
+
+    // The stream task switches the stream off once the subscribers are done with the current frame
+    app_video_stream_task_stop(service_config.video_fd);
+    app_video_stream_wait_stop();
+    service_streaming = false;
+}
+
+esp_err_t app_camera_service_init(const app_camera_service_config_t *config)
+{
+    struct v4l2_format format = {
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+    };
+
+    ESP_RETURN_ON_FALSE(config && (config->video_fd >= 0), ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(!service_initialized, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+    ESP_RETURN_ON_FALSE(ioctl(config->video_fd, VIDIOC_G_FMT, &format) == 0, ESP_FAIL, TAG, "Get format failed");
+
+    if (service_ctrl_lock == NULL) {
+        service_ctrl_lock = xSemaphoreCreateMutex();
+        service_dispatch_lock = xSemaphoreCreateMutex();
+    }
+    ESP_RETURN_ON_FALSE(service_ctrl_lock && service_dispatch_lock, ESP_ERR_NO_MEM, TAG, "Create locks failed");
+
+    service_config = *config;
+    service_buf_config = config->buf_config;
+    service_width = format.fmt.pix.width;
+    service_height = format.fmt.pix.height;
+    ESP_RETURN_ON_ERROR(app_video_register_frame_operation_cb(service_dispatch), TAG, "Register frame callback failed");
+    service_initialized = true;
+    ESP_LOGI(TAG, "Serving %" PRIu32 "x%" PRIu32 " frames", service_width, service_height);
+
+    return ESP_OK;
+}
+
+esp_err_t app_camera_service_set_buf_config(const app_video_buf_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(service_initialized, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    xSemaphoreTake(service_ctrl_lock, portMAX_DELAY);
+    if (service_bufs_ready) {
+        ESP_LOGD(TAG, "Buffers already allocated, the new configuration applies after a reboot");
+    }
+    service_buf_config = *config;
+    xSemaphoreGive(service_ctrl_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t app_camera_service_get_format(uint32_t *width, uint32_t *height)
+{
+    ESP_RETURN_ON_FALSE(width && height, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(service_initialized, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    *width = service_width;
+    *height = service_height;
+
+    return ESP_OK;
+}
+
+esp_err_t app_camera_service_subscribe(const app_camera_service_subscriber_config_t *config,
+                                       app_camera_service_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    struct app_camera_service_subscriber *subscriber = NULL;
+
+    ESP_RETURN_ON_FALSE(config && config->frame_cb && handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(service_initialized, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE((config->min_width <= service_width) && (config->min_height <= service_height),
+                        ESP_ERR_NOT_SUPPORTED, TAG, "%s needs %" PRIu32 "x%" PRIu32 ", the sensor gives %" PRIu32 "x%" PRIu32,
+                        config->name ? config->name : "?", config->min_width, config->min_height, service_width,
+                        service_height);
+
+    xSemaphoreTake(service_ctrl_lock, portMAX_DELAY);
+    for (int i = 0; i < APP_CAMERA_SERVICE_SUBSCRIBER_MAX; i++) {
+        if (!service_subscribers[i].active) {
+            subscriber = &service_subscribers[i];
+            break;
+        }
+    }
+    ESP_GOTO_ON_FALSE(subscriber, ESP_ERR_NO_MEM, err, TAG, "No free subscriber slot");
+
+    xSemaphoreTake(service_dispatch_lock, portMAX_DELAY);
+    subscriber->config = *config;
+    subscriber->active = true;
+    xSemaphoreGive(service_dispatch_lock);
+    service_subscriber_num++;
+
+    ret = service_stream_start();
+    if (ret != ESP_OK) {
+        xSemaphoreTake(service_dispatch_lock, portMAX_DELAY);
+        subscriber->active = false;
+        xSemaphoreGive(service_dispatch_lock);
+        service_subscriber_num--;
+        goto err;
+    }
+    ESP_LOGI(TAG, "%s subscribed", config->name ? config->name : "?");
+    *handle = subscriber;
+
+err:
+    xSemaphoreGive(service_ctrl_lock);
+
+    return ret;
+}
+
+esp_err_t app_camera_service_unsubscribe(app_camera_service_handle_t handle)
+{
+    ESP_RETURN_ON_FALSE(service_initialized && handle && handle->active, ESP_ERR_INVALID_ARG, TAG, "Invalid handle");
+
+    xSemaphoreTake(service_ctrl_lock, portMAX_DELAY);
+    xSemaphoreTake(service_dispatch_lock, portMAX_DELAY);
+    handle->active = false;
+    xSemaphoreGive(service_dispatch_lock);
+    service_subscriber_num--;
+    ESP_LOGI(TAG, "%s unsubscribed", handle->config.name ? handle->config.name : "?");
+
+    // Nobody left to give the frames to, the sensor goes to standby
+    if (service_subscriber_num == 0) {
+        service_stream_stop();
+    }
+    xSemaphoreGive(service_ctrl_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t app_camera_service_suspend(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(service_initialized, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    xSemaphoreTake(service_ctrl_lock, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(!service_suspended, ESP_ERR_INVALID_STATE, err, TAG, "Already suspended");
+    service_stream_stop();
+    service_suspended = true;
+
+err:
+    xSemaphoreGive(service_ctrl_lock);
+
+    return ret;
+}
+
+esp_err_t app_camera_service_resume(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(service_initialized, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    xSemaphoreTake(service_ctrl_lock, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(service_suspended, ESP_ERR_INVALID_STATE, err, TAG, "Not suspended");
+    service_suspended = false;
+    ret = service_stream_start();
+
+err:
+    xSemaphoreGive(service_ctrl_lock);
+
+    return ret;
+}
+
+bool app_camera_service_is_streaming(void)
+{
+    return service_streaming;
+}
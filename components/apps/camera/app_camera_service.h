@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_CAMERA_SERVICE_H
+#define APP_CAMERA_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "app_video.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_CAMERA_SERVICE_SUBSCRIBER_MAX   (6)
+
+/**
+ * @brief Called from the video stream task with every frame.
+ *
+ * Runs before the frame goes back to the driver and must not block, other subscribers wait behind it. A subscriber
+ * that keeps the frame longer takes a reference with `app_video_frame_acquire`.
+ *
+ * @param buf Frame pixels, in APP_VIDEO_FMT.
+ * @param buf_index Index of the V4L2 buffer.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param len Valid bytes in the buffer.
+ * @param user_ctx User context of the subscriber.
+ */
+typedef void (*app_camera_service_frame_cb_t)(uint8_t *buf, uint8_t buf_index, uint32_t width, uint32_t height,
+                                              size_t len, void *user_ctx);
+
+typedef struct app_camera_service_subscriber *app_camera_service_handle_t;
+
+typedef struct {
+    int video_fd;                           /*!< Opened video device, see `app_video_open` */
+    int core_id;                            /*!< Core the stream task runs on */
+    app_video_buf_config_t buf_config;      /*!< Buffers used if the ones set with `app_camera_service_set_buf_config` don't fit */
+} app_camera_service_config_t;
+
+typedef struct {
+    const char *name;                       /*!< Shown in the logs */
+    app_camera_service_frame_cb_t frame_cb; /*!< Called with every frame */
+    void *user_ctx;                         /*!< User context for the callback */
+    uint32_t min_width;                     /*!< Smallest frame width the subscriber can use, 0 for any */
+    uint32_t min_height;                    /*!< Smallest frame height the subscriber can use, 0 for any */
+} app_camera_service_subscriber_config_t;
+
+/**
+ * @brief Take over the stream of a video device, nothing is captured until the first subscriber.
+ *
+ * Registers the frame operation callback of app_video, the service dispatches the frames to its subscribers.
+ *
+ * @param config Video device, stream task core and fallback buffers.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if already initialized, ESP_ERR_NO_MEM,
+ *         ESP_FAIL if the format of the device can't be read.
+ */
+esp_err_t app_camera_service_init(const app_camera_service_config_t *config);
+
+/**
+ * @brief Set the V4L2 buffers allocated when the stream starts for the first time.
+ *
+ * @param config Buffer number and mode, the fallback of the service config is used if they don't fit.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG.
+ */
+esp_err_t app_camera_service_set_buf_config(const app_video_buf_config_t *config);
+
+/**
+ * @brief Get the frame size the subscribers receive.
+ *
+ * The sensor mode is fixed when the device is opened, subscribers needing smaller frames scale them.
+ *
+ * @param width Output frame width in pixels.
+ * @param height Output frame height in pixels.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized.
+ */
+esp_err_t app_camera_service_get_format(uint32_t *width, uint32_t *height);
+
+/**
+ * @brief Add a frame consumer, the first one starts the stream.
+ *
+ * Must not be called from a frame callback.
+ *
+ * @param config Callback and smallest usable frame size of the subscriber.
+ * @param handle Output handle for `app_camera_service_unsubscribe`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if not initialized, ESP_ERR_NOT_SUPPORTED if
+ *         the frames are smaller than the subscriber needs, ESP_ERR_NO_MEM if all slots are taken or the buffers
+ *         can't be allocated, ESP_FAIL if the stream can't start.
+ */
+esp_err_t app_camera_service_subscribe(const app_camera_service_subscriber_config_t *config,
+                                       app_camera_service_handle_t *handle);
+
+/**
+ * @brief Remove a frame consumer, the last one stops the stream and the sensor goes to standby.
+ *
+ * Once it returns, the callback of the subscriber is not called anymore. Must not be called from a frame callback.
+ *
+ * @param handle Handle from `app_camera_service_subscribe`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG.
+ */
+esp_err_t app_camera_service_unsubscribe(app_camera_service_handle_t handle);
+
+/**
+ * @brief Stop the stream for all subscribers until `app_camera_service_resume`, e.g. between time-lapse shots.
+ *
+ * Blocks until the stream task is done with the current frame. Must not be called from a frame callback.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized or already suspended.
+ */
+esp_err_t app_camera_service_suspend(void);
+
+/**
+ * @brief Restart the stream stopped by `app_camera_service_suspend`, if anybody is subscribed.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not suspended, ESP_FAIL if the stream can't start.
+ */
+esp_err_t app_camera_service_resume(void);
+
+/**
+ * @brief Check whether the stream task is running.
+ */
+bool app_camera_service_is_streaming(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
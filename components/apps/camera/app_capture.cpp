@@ -0,0 +1,326 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "driver/jpeg_encode.h"
+#include "driver/jpeg_decode.h"
+#include "bsp/esp-bsp.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "task_config/task_config.h"
+#include "app_video.h"
+#include "app_capture.hpp"
+
+#define CAPTURE_DIR                         BSP_SD_MOUNT_POINT "/DCIM"
+#define CAPTURE_FILE_FMT                    CAPTURE_DIR "/IMG_%04lu.jpg"
+#define CAPTURE_JPEG_QUALITY                (CONFIG_CAMERA_CAPTURE_JPEG_QUALITY)
+// Compressed shots stay well below a quarter of the raw RGB565 frame at the supported qualities
+#define CAPTURE_JPEG_BUF_DIV                (4)
+#define CAPTURE_CODEC_TIMEOUT_MS            (100)
+
+typedef struct {
+    uint8_t *frame;             /*!< V4L2 frame buffer, referenced until encoded. */
+    uint8_t frame_index;        /*!< V4L2 buffer index of the frame. */
+} capture_request_t;
+
+static const char *TAG = "app_capture";
+
+static jpeg_encoder_handle_t jpeg_encoder = NULL;
+// The review decode goes through the decoder shared with the other apps
+static bool jpeg_decoder_ready = false;
+static uint8_t *jpeg_buf = NULL;
+static size_t jpeg_buf_size = 0;
+static uint16_t *thumb_buf = NULL;
+static QueueHandle_t capture_queue = NULL;
+// Serializes file accesses between the capture task and `app_capture_load_last`
+static SemaphoreHandle_t capture_file_lock = NULL;
+static uint32_t capture_width = 0;
+static uint32_t capture_height = 0;
+static uint32_t capture_next_index = 0;
+static bool capture_busy = false;
+static char capture_last_path[APP_CAPTURE_PATH_LEN_MAX] = {0};
+static app_capture_done_cb_t capture_done_cb = NULL;
+static void *capture_done_ctx = NULL;
+
+static void capture_scan_dir(void)
+{
+    DIR *dir = opendir(CAPTURE_DIR);
+    if (dir == NULL) {
+        if (mkdir(CAPTURE_DIR, 0775) != 0) {
+            ESP_LOGW(TAG, "Create %s failed, is the SD card mounted?", CAPTURE_DIR);
+        }
+        return;
+    }
+
+    // Continue numbering after the newest shot so nothing gets overwritten after a reboot
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int index = 0;
+        if ((sscanf(entry->d_name, "IMG_%4u", &index) == 1) && (index >= capture_next_index)) {
+            capture_next_index = index + 1;
+            snprintf(capture_last_path, sizeof(capture_last_path), CAPTURE_DIR "/%s", entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+static void capture_make_thumb(const uint16_t *frame)
+{
+    // Nearest-neighbour downscale of the centered square, the album button is square
+    uint32_t side = std::min(capture_width, capture_height);
+    uint32_t x0 = (capture_width - side) / 2;
+    uint32_t y0 = (capture_height - side) / 2;
+    uint16_t *dst = thumb_buf;
+
+    for (uint32_t ty = 0; ty < APP_CAPTURE_THUMB_SIZE; ty++) {
+        const uint16_t *row = frame + (y0 + ty * side / APP_CAPTURE_THUMB_SIZE) * capture_width + x0;
+        for (uint32_t tx = 0; tx < APP_CAPTURE_THUMB_SIZE; tx++) {
+            *dst++ = row[tx * side / APP_CAPTURE_THUMB_SIZE];
+        }
+    }
+}
+
+static esp_err_t capture_encode(const capture_request_t *request, uint32_t *jpeg_size)
+{
+    jpeg_encode_cfg_t encode_cfg = {
+        .height = capture_height,
+        .width = capture_width,
+        .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+        .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+        .image_quality = CAPTURE_JPEG_QUALITY,
+    };
+
+    // The encoder reads the V4L2 buffer through DMA, the thumbnail is taken from the same untouched frame
+    esp_err_t ret = jpeg_encoder_process(jpeg_encoder, &encode_cfg, request->frame, capture_width * capture_height * 2,
+                                         jpeg_buf, jpeg_buf_size, jpeg_size);
+    if (ret == ESP_OK) {
+        capture_make_thumb(reinterpret_cast<const uint16_t *>(request->frame));
+    }
+    app_video_frame_release(request->frame_index);
+
+    return ret;
+}
+
+static esp_err_t capture_write(const char *path, uint32_t jpeg_size)
+{
+    FILE *fp = fopen(path, "wb");
+    ESP_RETURN_ON_FALSE(fp, ESP_FAIL, TAG, "Open %s failed", path);
+
+    size_t written = fwrite(jpeg_buf, 1, jpeg_size, fp);
+    fclose(fp);
+    ESP_RETURN_ON_FALSE(written == jpeg_size, ESP_FAIL, TAG, "Write %s failed", path);
+
+    return ESP_OK;
+}
+
+static void capture_task(void *arg)
+{
+    capture_request_t request;
+    char path[APP_CAPTURE_PATH_LEN_MAX];
+
+    while (1) {
+        if (xQueueReceive(capture_queue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        uint32_t jpeg_size = 0;
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t ret = capture_encode(&request, &jpeg_size);
+        if (ret == ESP_OK) {
+            xSemaphoreTake(capture_file_lock, portMAX_DELAY);
+            snprintf(path, sizeof(path), CAPTURE_FILE_FMT, (unsigned long)capture_next_index);
+            ret = capture_write(path, jpeg_size);
+            if (ret == ESP_OK) {
+                capture_next_index++;
+                strlcpy(capture_last_path, path, sizeof(capture_last_path));
+            }
+            xSemaphoreGive(capture_file_lock);
+        } else {
+            ESP_LOGE(TAG, "Encode failed: %s", esp_err_to_name(ret));
+            path[0] = '\0';
+        }
+
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "Saved %s (%lu bytes) in %lld ms", path, (unsigned long)jpeg_size,
+                     (esp_timer_get_time() - start_us) / 1000);
+        }
+        if (capture_done_cb) {
+            capture_done_cb(path, thumb_buf, ret, capture_done_ctx);
+        }
+        __atomic_store_n(&capture_busy, false, __ATOMIC_RELEASE);
+    }
+}
+
+esp_err_t app_capture_init(uint32_t width, uint32_t height, app_capture_done_cb_t done_cb, void *user_ctx)
+{
+    esp_err_t ret = ESP_OK;
+    jpeg_encode_engine_cfg_t encode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = CAPTURE_CODEC_TIMEOUT_MS,
+    };
+    jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+    };
+
+    ESP_RETURN_ON_FALSE(jpeg_encoder == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+    ESP_RETURN_ON_FALSE((width >= APP_CAPTURE_THUMB_SIZE) && (height >= APP_CAPTURE_THUMB_SIZE), ESP_ERR_INVALID_ARG,
+                        TAG, "Invalid frame size");
+
+    capture_width = width;
+    capture_height = height;
+    capture_done_cb = done_cb;
+    capture_done_ctx = user_ctx;
+
+    ESP_GOTO_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &jpeg_encoder), err, TAG, "Create JPEG encoder failed");
+
+    ESP_GOTO_ON_ERROR(jpeg_dec_service_acquire(), err, TAG, "Acquire JPEG decoder failed");
+    jpeg_decoder_ready = true;
+
+    jpeg_buf = (uint8_t *)jpeg_alloc_encoder_mem(width * height * 2 / CAPTURE_JPEG_BUF_DIV, &out_mem_cfg, &jpeg_buf_size);
+    ESP_GOTO_ON_FALSE(jpeg_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate JPEG buffer failed");
+
+    thumb_buf = (uint16_t *)heap_caps_malloc(APP_CAPTURE_THUMB_SIZE * APP_CAPTURE_THUMB_SIZE * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(thumb_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate thumbnail buffer failed");
+
+    capture_queue = xQueueCreate(1, sizeof(capture_request_t));
+    ESP_GOTO_ON_FALSE(capture_queue, ESP_ERR_NO_MEM, err, TAG, "Create capture queue failed");
+
+    capture_file_lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(capture_file_lock, ESP_ERR_NO_MEM, err, TAG, "Create capture lock failed");
+
+    capture_scan_dir();
+
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_CAPTURE, capture_task, NULL, NULL) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create capture task failed");
+
+    return ESP_OK;
+
+err:
+    if (capture_file_lock) {
+        vSemaphoreDelete(capture_file_lock);
+        capture_file_lock = NULL;
+    }
+    if (capture_queue) {
+        vQueueDelete(capture_queue);
+        capture_queue = NULL;
+    }
+    if (thumb_buf) {
+        heap_caps_free(thumb_buf);
+        thumb_buf = NULL;
+    }
+    if (jpeg_buf) {
+        free(jpeg_buf);
+        jpeg_buf = NULL;
+    }
+    if (jpeg_decoder_ready) {
+        jpeg_dec_service_release();
+        jpeg_decoder_ready = false;
+    }
+    if (jpeg_encoder) {
+        jpeg_del_encoder_engine(jpeg_encoder);
+        jpeg_encoder = NULL;
+    }
+
+    return ret;
+}
+
+esp_err_t app_capture_shot(uint8_t *frame, uint8_t frame_index, uint32_t width, uint32_t height)
+{
+    ESP_RETURN_ON_FALSE(capture_queue, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE((width == capture_width) && (height == capture_height), ESP_ERR_INVALID_ARG, TAG,
+                        "Frame size mismatch");
+
+    // Only one shot in flight, the encoder output buffer is reused for every shot
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&capture_busy, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = app_video_frame_acquire(frame_index);
+    if (ret != ESP_OK) {
+        __atomic_store_n(&capture_busy, false, __ATOMIC_RELEASE);
+        return ret;
+    }
+
+    capture_request_t request = {
+        .frame = frame,
+        .frame_index = frame_index,
+    };
+    if (xQueueSend(capture_queue, &request, 0) != pdTRUE) {
+        app_video_frame_release(frame_index);
+        __atomic_store_n(&capture_busy, false, __ATOMIC_RELEASE);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t app_capture_load_last(uint8_t *out_buf, size_t out_size)
+{
+    esp_err_t ret = ESP_OK;
+    FILE *fp = NULL;
+    uint8_t *in_buf = NULL;
+    size_t in_buf_size = 0;
+    uint32_t out_len = 0;
+    long file_size = 0;
+
+    ESP_RETURN_ON_FALSE(jpeg_decoder_ready && out_buf, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    xSemaphoreTake(capture_file_lock, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(capture_last_path[0] != '\0', ESP_ERR_NOT_FOUND, end, TAG, "No shot yet");
+
+    fp = fopen(capture_last_path, "rb");
+    ESP_GOTO_ON_FALSE(fp, ESP_FAIL, end, TAG, "Open %s failed", capture_last_path);
+    fseek(fp, 0, SEEK_END);
+    file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    ESP_GOTO_ON_FALSE(file_size > 0, ESP_FAIL, end, TAG, "Empty file %s", capture_last_path);
+
+    {
+        in_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_INPUT_BUFFER, file_size, &in_buf_size);
+        ESP_GOTO_ON_FALSE(in_buf, ESP_ERR_NO_MEM, end, TAG, "Allocate input buffer failed");
+        ESP_GOTO_ON_FALSE(fread(in_buf, 1, file_size, fp) == (size_t)file_size, ESP_FAIL, end, TAG,
+                          "Read %s failed", capture_last_path);
+
+        jpeg_decode_picture_info_t info;
+        ESP_GOTO_ON_ERROR(jpeg_decoder_get_info(in_buf, file_size, &info), end, TAG, "Invalid JPEG header");
+        ESP_GOTO_ON_FALSE(info.width * info.height * 2 <= out_size, ESP_ERR_INVALID_SIZE, end, TAG,
+                          "Output buffer too small for %lux%lu", (unsigned long)info.width, (unsigned long)info.height);
+
+        jpeg_decode_cfg_t decode_cfg = {
+            .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
+            .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+        };
+        jpeg_dec_service_job_t job = {
+            .in = in_buf,
+            .in_size = (uint32_t)file_size,
+            .out = out_buf,
+            .out_size = (uint32_t)out_size,
+            .cfg = decode_cfg,
+        };
+        ESP_GOTO_ON_ERROR(jpeg_dec_service_decode(&job, &out_len), end, TAG, "Decode failed");
+    }
+
+end:
+    jpeg_dec_service_buf_put(in_buf);
+    if (fp) {
+        fclose(fp);
+    }
+    xSemaphoreGive(capture_file_lock);
+
+    return ret;
+}
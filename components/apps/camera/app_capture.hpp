@@ -0,0 +1,71 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define APP_CAPTURE_THUMB_SIZE              (100)
+#define APP_CAPTURE_PATH_LEN_MAX            (64)
+
+/**
+ * @brief Called from the capture task once a shot is written (or failed).
+ *
+ * @param path Path of the written JPEG file.
+ * @param thumb RGB565 thumbnail of APP_CAPTURE_THUMB_SIZE x APP_CAPTURE_THUMB_SIZE pixels, only valid during the call.
+ * @param result ESP_OK if the file was written.
+ * @param user_ctx User context passed to `app_capture_init`.
+ */
+typedef void (*app_capture_done_cb_t)(const char *path, const uint16_t *thumb, esp_err_t result, void *user_ctx);
+
+/**
+ * @brief Initialize the capture service.
+ *
+ * Creates the hardware JPEG encoder and decoder, allocates the encoder output buffer for the given frame size
+ * and starts the capture task. Shots are written to the `DCIM` directory of the SD card.
+ *
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param done_cb Callback invoked after each shot, can be NULL.
+ * @param user_ctx User context for the callback.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t app_capture_init(uint32_t width, uint32_t height, app_capture_done_cb_t done_cb, void *user_ctx);
+
+/**
+ * @brief Take a shot of a V4L2 frame.
+ *
+ * A reference to the frame is taken and handed to the capture task, which encodes it straight from the V4L2 buffer
+ * and releases it before writing the file, so no copy of the frame is made. Must be called while the caller holds
+ * a reference on the frame (e.g. from the frame operation callback), and nothing may be drawn into the frame once
+ * the shot is queued.
+ *
+ * @param frame RGB565 frame.
+ * @param frame_index V4L2 buffer index of the frame.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ *
+ * @return
+ *      - ESP_OK: The shot is queued
+ *      - ESP_ERR_INVALID_STATE: The service isn't initialized or a shot is still in progress
+ *      - ESP_ERR_INVALID_ARG: The frame doesn't match the configured size
+ */
+esp_err_t app_capture_shot(uint8_t *frame, uint8_t frame_index, uint32_t width, uint32_t height);
+
+/**
+ * @brief Decode the last written shot into an RGB565 buffer.
+ *
+ * @param out_buf Output buffer, aligned to the cache line size.
+ * @param out_size Size of the output buffer in bytes.
+ *
+ * @return
+ *      - ESP_OK: The shot is decoded
+ *      - ESP_ERR_NOT_FOUND: No shot has been written yet
+ *      - Others: Failed to read or decode the file
+ */
+esp_err_t app_capture_load_last(uint8_t *out_buf, size_t out_size);
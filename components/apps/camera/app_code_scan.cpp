@@ -0,0 +1,1568 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "sdkconfig.h"
+
+#if CONFIG_CAMERA_CODE_SCAN
+
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+#include <algorithm>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "app_code_scan.hpp"
+
+#define SCAN_TILE                           (16)
+// Tiles with a smaller spread of gray levels have no edge to put a threshold on
+#define SCAN_TILE_MIN_RANGE                 (24)
+#define SCAN_FINDER_ROW_STEP                (2)
+#define SCAN_FINDER_MAX                     (16)
+#define SCAN_FINDER_TRIPLE_TRIES            (4)
+#define SCAN_BARCODE_LINES                  (15)
+// The EAN checksum only catches single errors, a code is taken once two scanlines agree
+#define SCAN_EAN_AGREE_LINES                (2)
+#define SCAN_QUIET_MODULES                  (3)
+
+#define QR_VERSION_MAX                      (10)
+#define QR_SIZE_MAX                         (17 + 4 * QR_VERSION_MAX)
+#define QR_CODEWORDS_MAX                    (346)
+#define QR_EC_MAX                           (30)
+#define QR_FORMAT_MASK                      (0x5412)
+
+typedef struct {
+    float x;
+    float y;
+} scan_point_t;
+
+typedef struct {
+    scan_point_t center;
+    float module;
+    int count;
+} scan_finder_t;
+
+typedef struct {
+    uint8_t ec_len;                         // EC codewords per block
+    uint8_t blocks;                         // Number of blocks
+} qr_ec_t;
+
+static const char *TAG = "app_code_scan";
+
+// Indexed by version, then by the EC level of the format bits: M, L, H, Q
+static const uint16_t qr_codewords[QR_VERSION_MAX + 1] = {0, 26, 44, 70, 100, 134, 172, 196, 242, 292, 346};
+static const qr_ec_t qr_ec[QR_VERSION_MAX + 1][4] = {
+    {},
+    {{10, 1}, {7, 1}, {17, 1}, {13, 1}},
+    {{16, 1}, {10, 1}, {28, 1}, {22, 1}},
+    {{26, 1}, {15, 1}, {22, 2}, {18, 2}},
+    {{18, 2}, {20, 1}, {16, 4}, {26, 2}},
+    {{24, 2}, {26, 1}, {22, 4}, {18, 4}},
+    {{16, 4}, {18, 2}, {28, 4}, {24, 4}},
+    {{18, 4}, {20, 2}, {26, 5}, {18, 6}},
+    {{22, 4}, {24, 2}, {26, 6}, {22, 6}},
+    {{22, 5}, {30, 2}, {24, 8}, {20, 8}},
+    {{26, 5}, {18, 4}, {28, 8}, {24, 8}},
+};
+static const uint8_t qr_align_pos[QR_VERSION_MAX + 1][3] = {
+    {}, {}, {6, 18}, {6, 22}, {6, 26}, {6, 30}, {6, 34}, {6, 22, 38}, {6, 24, 42}, {6, 26, 46}, {6, 28, 50},
+};
+static const char qr_alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+// Space, bar, space, bar widths of the left hand odd parity digits, bar first for the right hand digits
+static const uint8_t ean_digits[10][4] = {
+    {3, 2, 1, 1}, {2, 2, 2, 1}, {2, 1, 2, 2}, {1, 4, 1, 1}, {1, 1, 3, 2},
+    {1, 2, 3, 1}, {1, 1, 1, 4}, {1, 3, 1, 2}, {1, 2, 1, 3}, {3, 1, 1, 2},
+};
+// Even parity digits of the left half, by first digit
+static const uint8_t ean_first_digit[10] = {0x00, 0x0b, 0x0d, 0x0e, 0x13, 0x19, 0x1c, 0x15, 0x16, 0x1a};
+
+// Bar, space, bar, space, bar, space widths, the stop symbol has a final 2 module bar
+static const uint8_t code128_symbols[107][6] = {
+    {2, 1, 2, 2, 2, 2}, {2, 2, 2, 1, 2, 2}, {2, 2, 2, 2, 2, 1}, {1, 2, 1, 2, 2, 3}, {1, 2, 1, 3, 2, 2},
+    {1, 3, 1, 2, 2, 2}, {1, 2, 2, 2, 1, 3}, {1, 2, 2, 3, 1, 2}, {1, 3, 2, 2, 1, 2}, {2, 2, 1, 2, 1, 3},
+    {2, 2, 1, 3, 1, 2}, {2, 3, 1, 2, 1, 2}, {1, 1, 2, 2, 3, 2}, {1, 2, 2, 1, 3, 2}, {1, 2, 2, 2, 3, 1},
+    {1, 1, 3, 2, 2, 2}, {1, 2, 3, 1, 2, 2}, {1, 2, 3, 2, 2, 1}, {2, 2, 3, 2, 1, 1}, {2, 2, 1, 1, 3, 2},
+    {2, 2, 1, 2, 3, 1}, {2, 1, 3, 2, 1, 2}, {2, 2, 3, 1, 1, 2}, {3, 1, 2, 1, 3, 1}, {3, 1, 1, 2, 2, 2},
+    {3, 2, 1, 1, 2, 2}, {3, 2, 1, 2, 2, 1}, {3, 1, 2, 2, 1, 2}, {3, 2, 2, 1, 1, 2}, {3, 2, 2, 2, 1, 1},
+    {2, 1, 2, 1, 2, 3}, {2, 1, 2, 3, 2, 1}, {2, 3, 2, 1, 2, 1}, {1, 1, 1, 3, 2, 3}, {1, 3, 1, 1, 2, 3},
+    {1, 3, 1, 3, 2, 1}, {1, 1, 2, 3, 1, 3}, {1, 3, 2, 1, 1, 3}, {1, 3, 2, 3, 1, 1}, {2, 1, 1, 3, 1, 3},
+    {2, 3, 1, 1, 1, 3}, {2, 3, 1, 3, 1, 1}, {1, 1, 2, 1, 3, 3}, {1, 1, 2, 3, 3, 1}, {1, 3, 2, 1, 3, 1},
+    {1, 1, 3, 1, 2, 3}, {1, 1, 3, 3, 2, 1}, {1, 3, 3, 1, 2, 1}, {3, 1, 3, 1, 2, 1}, {2, 1, 1, 3, 3, 1},
+    {2, 3, 1, 1, 3, 1}, {2, 1, 3, 1, 1, 3}, {2, 1, 3, 3, 1, 1}, {2, 1, 3, 1, 3, 1}, {3, 1, 1, 1, 2, 3},
+    {3, 1, 1, 3, 2, 1}, {3, 3, 1, 1, 2, 1}, {3, 1, 2, 1, 1, 3}, {3, 1, 2, 3, 1, 1}, {3, 3, 2, 1, 1, 1},
+    {3, 1, 4, 1, 1, 1}, {2, 2, 1, 4, 1, 1}, {4, 3, 1, 1, 1, 1}, {1, 1, 1, 2, 2, 4}, {1, 1, 1, 4, 2, 2},
+    {1, 2, 1, 1, 2, 4}, {1, 2, 1, 4, 2, 1}, {1, 4, 1, 1, 2, 2}, {1, 4, 1, 2, 2, 1}, {1, 1, 2, 2, 1, 4},
+    {1, 1, 2, 4, 1, 2}, {1, 2, 2, 1, 1, 4}, {1, 2, 2, 4, 1, 1}, {1, 4, 2, 1, 1, 2}, {1, 4, 2, 2, 1, 1},
+    {2, 4, 1, 2, 1, 1}, {2, 2, 1, 1, 1, 4}, {4, 1, 3, 1, 1, 1}, {2, 4, 1, 1, 1, 2}, {1, 3, 4, 1, 1, 1},
+    {1, 1, 1, 2, 4, 2}, {1, 2, 1, 1, 4, 2}, {1, 2, 1, 2, 4, 1}, {1, 1, 4, 2, 1, 2}, {1, 2, 4, 1, 1, 2},
+    {1, 2, 4, 2, 1, 1}, {4, 1, 1, 2, 1, 2}, {4, 2, 1, 1, 1, 2}, {4, 2, 1, 2, 1, 1}, {2, 1, 2, 1, 4, 1},
+    {2, 1, 4, 1, 2, 1}, {4, 1, 2, 1, 2, 1}, {1, 1, 1, 1, 4, 3}, {1, 1, 1, 3, 4, 1}, {1, 3, 1, 1, 4, 1},
+    {1, 1, 4, 1, 1, 3}, {1, 1, 4, 3, 1, 1}, {4, 1, 1, 1, 1, 3}, {4, 1, 1, 3, 1, 1}, {1, 1, 3, 1, 4, 1},
+    {1, 1, 4, 1, 3, 1}, {3, 1, 1, 1, 4, 1}, {4, 1, 1, 1, 3, 1}, {2, 1, 1, 4, 1, 2}, {2, 1, 1, 2, 1, 4},
+    {2, 1, 1, 2, 3, 2}, {2, 3, 3, 1, 1, 1},
+};
+#define CODE128_SHIFT                       (98)
+#define CODE128_CODE_C                      (99)
+#define CODE128_CODE_B                      (100)
+#define CODE128_CODE_A                      (101)
+#define CODE128_FNC1                        (102)
+#define CODE128_START_A                     (103)
+#define CODE128_STOP                        (106)
+
+// Planes of the last image, gray and binarized are biased by 0x80 so they compare as signed bytes
+static uint8_t *scan_gray = NULL;
+static uint8_t *scan_bin = NULL;
+static uint32_t scan_stride = 0;
+static uint32_t scan_max_h = 0;
+static uint32_t scan_w = 0;
+static uint32_t scan_h = 0;
+static uint32_t *tile_sum = NULL;
+static uint8_t *tile_min = NULL;
+static uint8_t *tile_max = NULL;
+static uint8_t *tile_black = NULL;
+static uint8_t *tile_threshold = NULL;
+static uint16_t *scan_runs = NULL;
+static uint16_t *scan_runs_rev = NULL;
+static uint8_t gf_exp[512];
+static uint8_t gf_log[256];
+
+static inline bool scan_dark(int x, int y)
+{
+    return scan_bin[y * scan_stride + x] != 0;
+}
+
+static inline bool scan_inside(int x, int y)
+{
+    return (x >= 0) && (y >= 0) && (x < (int)scan_w) && (y < (int)scan_h);
+}
+
+/* ---------------------------------------------------------------- Binarization */
+
+template <typename load_t>
+static void scan_load_gray(const uint8_t *img, uint32_t w, uint32_t step, uint32_t bytes_per_pixel, load_t load)
+{
+    uint32_t tiles_w = (scan_w + SCAN_TILE - 1) / SCAN_TILE;
+
+    memset(tile_sum, 0, tiles_w * ((scan_h + SCAN_TILE - 1) / SCAN_TILE) * sizeof(uint32_t));
+    for (uint32_t y = 0; y < scan_h; y++) {
+        const uint8_t *src = img + (y * step) * w * bytes_per_pixel;
+        uint8_t *dst = scan_gray + y * scan_stride;
+        uint32_t tile = (y / SCAN_TILE) * tiles_w;
+
+        for (uint32_t tx = 0; tx < tiles_w; tx++, tile++) {
+            uint32_t x_end = std::min(scan_w, (tx + 1) * SCAN_TILE);
+            uint32_t sum = 0;
+            uint8_t lo = 255;
+            uint8_t hi = 0;
+
+            for (uint32_t x = tx * SCAN_TILE; x < x_end; x++) {
+                uint8_t v = load(src + x * step * bytes_per_pixel);
+                dst[x] = v ^ 0x80;
+                sum += v;
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            if ((y % SCAN_TILE) == 0) {
+                tile_min[tile] = lo;
+                tile_max[tile] = hi;
+            } else {
+                tile_min[tile] = std::min(tile_min[tile], lo);
+                tile_max[tile] = std::max(tile_max[tile], hi);
+            }
+            tile_sum[tile] += sum;
+        }
+        // The vector compare reads whole tiles, the padding is never scanned
+        memset(dst + scan_w, dst[scan_w - 1], scan_stride - scan_w);
+    }
+}
+
+static void scan_tile_thresholds(void)
+{
+    int tiles_w = (scan_w + SCAN_TILE - 1) / SCAN_TILE;
+    int tiles_h = (scan_h + SCAN_TILE - 1) / SCAN_TILE;
+
+    for (int ty = 0; ty < tiles_h; ty++) {
+        for (int tx = 0; tx < tiles_w; tx++) {
+            int tile = ty * tiles_w + tx;
+            int pixels = (std::min<int>(scan_w, (tx + 1) * SCAN_TILE) - tx * SCAN_TILE) *
+                         (std::min<int>(scan_h, (ty + 1) * SCAN_TILE) - ty * SCAN_TILE);
+            int black = tile_sum[tile] / pixels;
+
+            if (tile_max[tile] - tile_min[tile] <= SCAN_TILE_MIN_RANGE) {
+                // A flat tile is light unless it is darker than the tiles around it, e.g. inside a large module
+                black = tile_min[tile] / 2;
+                if ((ty > 0) && (tx > 0)) {
+                    int neighbors = (tile_black[tile - tiles_w] + 2 * tile_black[tile - 1] +
+                                     tile_black[tile - tiles_w - 1]) / 4;
+                    if (tile_min[tile] < neighbors) {
+                        black = neighbors;
+                    }
+                }
+            }
+            tile_black[tile] = black;
+        }
+    }
+
+    // Threshold of a tile is the mean of the 3x3 tiles around it, so an edge between tiles gets the same threshold
+    for (int ty = 0; ty < tiles_h; ty++) {
+        for (int tx = 0; tx < tiles_w; tx++) {
+            int sum = 0;
+            int num = 0;
+
+            for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, tiles_h - 1); y++) {
+                for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, tiles_w - 1); x++) {
+                    sum += tile_black[y * tiles_w + x];
+                    num++;
+                }
+            }
+            tile_threshold[ty * tiles_w + tx] = (uint8_t)(sum / num) ^ 0x80;
+        }
+    }
+}
+
+static void scan_binarize_row(const uint8_t *src, uint8_t *dst, const uint8_t *threshold, int tiles)
+{
+#if CONFIG_IDF_TARGET_ESP32P4 && CONFIG_CAMERA_CODE_SCAN_PIE
+    // Broadcast the tile threshold into q1, then compare 16 pixels per instruction, dark pixels become 0xff
+    asm volatile(
+        "1:                                 \n"
+        "esp.vld.128.ip q0, %[src], 16      \n"
+        "esp.vldbc.8.ip q1, %[thr], 1       \n"
+        "esp.vcmp.lt.s8 q2, q0, q1          \n"
+        "esp.vst.128.ip q2, %[dst], 16      \n"
+        "addi %[tiles], %[tiles], -1        \n"
+        "bnez %[tiles], 1b                  \n"
+        : [src] "+r"(src), [dst] "+r"(dst), [thr] "+r"(threshold), [tiles] "+r"(tiles)
+        :
+        : "memory"
+    );
+#else
+    for (int tx = 0; tx < tiles; tx++) {
+        int8_t t = (int8_t)threshold[tx];
+        for (int i = 0; i < SCAN_TILE; i++) {
+            *dst++ = ((int8_t) * src++ < t) ? 0xff : 0;
+        }
+    }
+#endif
+}
+
+static void scan_binarize(void)
+{
+    int tiles_w = (scan_w + SCAN_TILE - 1) / SCAN_TILE;
+
+    scan_tile_thresholds();
+    for (uint32_t y = 0; y < scan_h; y++) {
+        scan_binarize_row(scan_gray + y * scan_stride, scan_bin + y * scan_stride,
+                          tile_threshold + (y / SCAN_TILE) * tiles_w, tiles_w);
+    }
+}
+
+/* ---------------------------------------------------------------- Run lengths */
+
+// Runs alternate light and dark, starting with a light one that may be empty
+static int scan_row_runs(int y, uint16_t *runs)
+{
+    const uint8_t *row = scan_bin + y * scan_stride;
+    int num = 0;
+    bool dark = false;
+    int len = 0;
+
+    for (uint32_t x = 0; x < scan_w; x++) {
+        if ((row[x] != 0) != dark) {
+            runs[num++] = len;
+            dark = !dark;
+            len = 0;
+        }
+        len++;
+    }
+    runs[num++] = len;
+
+    return num;
+}
+
+static int scan_reverse_runs(const uint16_t *runs, int num, uint16_t *out)
+{
+    int n = 0;
+
+    // Keep the first run light
+    if ((num & 1) == 0) {
+        out[n++] = 0;
+    }
+    for (int i = num - 1; i >= 0; i--) {
+        out[n++] = runs[i];
+    }
+
+    return n;
+}
+
+/* ---------------------------------------------------------------- QR finder patterns */
+
+static bool finder_ratio_ok(const int counts[5])
+{
+    int total = counts[0] + counts[1] + counts[2] + counts[3] + counts[4];
+
+    if (total < 7) {
+        return false;
+    }
+    float module = total / 7.0f;
+    float variance = module / 2;
+
+    return (fabsf(module - counts[0]) < variance) && (fabsf(module - counts[1]) < variance) &&
+           (fabsf(3 * module - counts[2]) < 3 * variance) && (fabsf(module - counts[3]) < variance) &&
+           (fabsf(module - counts[4]) < variance);
+}
+
+// Measures the pattern through (x, y) along (dx, dy), `center` in pixels from (x, y)
+static bool finder_cross_check(int x, int y, int dx, int dy, int expect_total, float *center, int *total)
+{
+    int counts[5] = {};
+    int t = 0;
+
+    while (scan_inside(x + t * dx, y + t * dy) && scan_dark(x + t * dx, y + t * dy)) {
+        counts[2]++;
+        t--;
+    }
+    while (scan_inside(x + t * dx, y + t * dy) && !scan_dark(x + t * dx, y + t * dy) && (counts[1] <= expect_total)) {
+        counts[1]++;
+        t--;
+    }
+    while (scan_inside(x + t * dx, y + t * dy) && scan_dark(x + t * dx, y + t * dy) && (counts[0] <= expect_total)) {
+        counts[0]++;
+        t--;
+    }
+    int center_start = -counts[2] + 1;
+
+    t = 1;
+    while (scan_inside(x + t * dx, y + t * dy) && scan_dark(x + t * dx, y + t * dy)) {
+        counts[2]++;
+        t++;
+    }
+    int center_end = t - 1;
+    while (scan_inside(x + t * dx, y + t * dy) && !scan_dark(x + t * dx, y + t * dy) && (counts[3] <= expect_total)) {
+        counts[3]++;
+        t++;
+    }
+    while (scan_inside(x + t * dx, y + t * dy) && scan_dark(x + t * dx, y + t * dy) && (counts[4] <= expect_total)) {
+        counts[4]++;
+        t++;
+    }
+
+    *total = counts[0] + counts[1] + counts[2] + counts[3] + counts[4];
+    // The outer rings are cut by the image border
+    if ((counts[0] == 0) || (counts[4] == 0) || (5 * abs(*total - expect_total) >= 2 * expect_total)) {
+        return false;
+    }
+    if (!finder_ratio_ok(counts)) {
+        return false;
+    }
+    *center = (center_start + center_end + 1) / 2.0f;
+
+    return true;
+}
+
+static void finder_add(scan_finder_t *finders, int *num, float x, float y, float module)
+{
+    for (int i = 0; i < *num; i++) {
+        scan_finder_t *f = &finders[i];
+
+        if ((fabsf(f->center.x - x) <= f->module) && (fabsf(f->center.y - y) <= f->module) &&
+                (module > f->module * 0.6f) && (module < f->module * 1.6f)) {
+            f->center.x = (f->center.x * f->count + x) / (f->count + 1);
+            f->center.y = (f->center.y * f->count + y) / (f->count + 1);
+            f->module = (f->module * f->count + module) / (f->count + 1);
+            f->count++;
+            return;
+        }
+    }
+    if (*num < SCAN_FINDER_MAX) {
+        finders[(*num)++] = {{x, y}, module, 1};
+    }
+}
+
+static int finder_search(scan_finder_t *finders)
+{
+    int num = 0;
+
+    for (uint32_t y = SCAN_FINDER_ROW_STEP / 2; y < scan_h; y += SCAN_FINDER_ROW_STEP) {
+        int runs_num = scan_row_runs(y, scan_runs);
+        int start = scan_runs[0];
+
+        for (int k = 1; k + 4 < runs_num; k += 2) {
+            int counts[5] = {scan_runs[k], scan_runs[k + 1], scan_runs[k + 2], scan_runs[k + 3], scan_runs[k + 4]};
+            int run_start = start;
+
+            start += scan_runs[k] + scan_runs[k + 1];
+            if (!finder_ratio_ok(counts)) {
+                continue;
+            }
+
+            int h_total = counts[0] + counts[1] + counts[2] + counts[3] + counts[4];
+            int cx = run_start + counts[0] + counts[1] + counts[2] / 2;
+            float offset;
+            int v_total;
+            if (!finder_cross_check(cx, y, 0, 1, h_total, &offset, &v_total)) {
+                continue;
+            }
+            float center_y = y + offset;
+            int cy = (int)center_y;
+            if (!finder_cross_check(cx, cy, 1, 0, h_total, &offset, &h_total)) {
+                continue;
+            }
+            finder_add(finders, &num, cx + offset, center_y, (h_total + v_total) / 14.0f);
+        }
+    }
+
+    return num;
+}
+
+/* ---------------------------------------------------------------- QR geometry */
+
+typedef struct {
+    float h[9];
+} scan_transform_t;
+
+static scan_point_t transform_apply(const scan_transform_t *t, float u, float v)
+{
+    float w = t->h[6] * u + t->h[7] * v + t->h[8];
+
+    return {(t->h[0] * u + t->h[1] * v + t->h[2]) / w, (t->h[3] * u + t->h[4] * v + t->h[5]) / w};
+}
+
+static bool transform_from_points(const scan_point_t *grid, const scan_point_t *img, scan_transform_t *t)
+{
+    double m[8][9];
+
+    for (int i = 0; i < 4; i++) {
+        double u = grid[i].x;
+        double v = grid[i].y;
+        double x = img[i].x;
+        double y = img[i].y;
+        double row_x[9] = {u, v, 1, 0, 0, 0, -u * x, -v * x, x};
+        double row_y[9] = {0, 0, 0, u, v, 1, -u * y, -v * y, y};
+        memcpy(m[2 * i], row_x, sizeof(row_x));
+        memcpy(m[2 * i + 1], row_y, sizeof(row_y));
+    }
+
+    // Gauss-Jordan with partial pivoting
+    for (int col = 0; col < 8; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < 8; row++) {
+            if (fabs(m[row][col]) > fabs(m[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(m[pivot][col]) < 1e-9) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int k = 0; k < 9; k++) {
+                std::swap(m[pivot][k], m[col][k]);
+            }
+        }
+        for (int row = 0; row < 8; row++) {
+            if (row == col) {
+                continue;
+            }
+            double f = m[row][col] / m[col][col];
+            for (int k = col; k < 9; k++) {
+                m[row][k] -= f * m[col][k];
+            }
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        t->h[i] = m[i][8] / m[i][i];
+    }
+    t->h[8] = 1;
+
+    return true;
+}
+
+static bool qr_find_alignment(const scan_point_t &predicted, const scan_point_t &ex, const scan_point_t &ey,
+                              float module, scan_point_t *found)
+{
+    int radius = std::max(2, (int)(module * 4));
+    int best = 0;
+    float sum_x = 0;
+    float sum_y = 0;
+    int sum_num = 0;
+
+    for (int py = (int)predicted.y - radius; py <= (int)predicted.y + radius; py++) {
+        for (int px = (int)predicted.x - radius; px <= (int)predicted.x + radius; px++) {
+            int score = 0;
+
+            // Dark center, light ring, dark ring, one module apart
+            for (int j = -2; j <= 2; j++) {
+                for (int i = -2; i <= 2; i++) {
+                    int sx = (int)floorf(px + 0.5f + i * ex.x + j * ey.x);
+                    int sy = (int)floorf(py + 0.5f + i * ex.y + j * ey.y);
+                    bool expect_dark = std::max(abs(i), abs(j)) != 1;
+                    if (scan_inside(sx, sy) && (scan_dark(sx, sy) == expect_dark)) {
+                        score++;
+                    }
+                }
+            }
+            if (score > best) {
+                best = score;
+                sum_x = sum_y = 0;
+                sum_num = 0;
+            }
+            if (score == best) {
+                sum_x += px + 0.5f;
+                sum_y += py + 0.5f;
+                sum_num++;
+            }
+        }
+    }
+    if (best < 23) {
+        return false;
+    }
+    *found = {sum_x / sum_num, sum_y / sum_num};
+
+    return true;
+}
+
+static bool qr_transform(const scan_finder_t *tl, const scan_finder_t *tr, const scan_finder_t *bl, int version,
+                         scan_transform_t *t)
+{
+    int size = 17 + 4 * version;
+    float span = size - 7;
+    scan_point_t ex = {(tr->center.x - tl->center.x) / span, (tr->center.y - tl->center.y) / span};
+    scan_point_t ey = {(bl->center.x - tl->center.x) / span, (bl->center.y - tl->center.y) / span};
+    scan_point_t grid[4] = {{3.5f, 3.5f}, {size - 3.5f, 3.5f}, {3.5f, size - 3.5f}, {size - 6.5f, size - 6.5f}};
+    scan_point_t img[4] = {tl->center, tr->center, bl->center, {}};
+
+    // Skewed codes only line up with the grid once the alignment pattern fixes the fourth corner
+    float module = (tl->module + tr->module + bl->module) / 3;
+    scan_point_t predicted = {tl->center.x + (size - 10) * (ex.x + ey.x), tl->center.y + (size - 10) * (ex.y + ey.y)};
+    if ((version >= 2) && qr_find_alignment(predicted, ex, ey, module, &img[3]) && transform_from_points(grid, img, t)) {
+        return true;
+    }
+
+    t->h[0] = ex.x;
+    t->h[1] = ey.x;
+    t->h[2] = tl->center.x - 3.5f * (ex.x + ey.x);
+    t->h[3] = ex.y;
+    t->h[4] = ey.y;
+    t->h[5] = tl->center.y - 3.5f * (ex.y + ey.y);
+    t->h[6] = 0;
+    t->h[7] = 0;
+    t->h[8] = 1;
+
+    return true;
+}
+
+/* ---------------------------------------------------------------- QR decoding */
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    return (a && b) ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+static inline uint8_t gf_div(uint8_t a, uint8_t b)
+{
+    return a ? gf_exp[gf_log[a] + 255 - gf_log[b]] : 0;
+}
+
+static void gf_init(void)
+{
+    int x = 1;
+
+    for (int i = 0; i < 255; i++) {
+        gf_exp[i] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100) {
+            x ^= 0x11d;
+        }
+    }
+    for (int i = 255; i < 512; i++) {
+        gf_exp[i] = gf_exp[i - 255];
+    }
+}
+
+static uint8_t gf_poly_eval(const uint8_t *poly, int len, uint8_t x)
+{
+    // Coefficient i is the one of x^i
+    uint8_t y = 0;
+
+    for (int i = len - 1; i >= 0; i--) {
+        y = gf_mul(y, x) ^ poly[i];
+    }
+    return y;
+}
+
+// Corrects a block in place, the first codeword is the highest power. Returns the number of errors or -1.
+static int rs_correct(uint8_t *cw, int n, int ec_len)
+{
+    uint8_t synd[QR_EC_MAX] = {};
+    bool error = false;
+
+    for (int j = 0; j < ec_len; j++) {
+        uint8_t s = 0;
+        for (int i = 0; i < n; i++) {
+            s = gf_mul(s, gf_exp[j]) ^ cw[i];
+        }
+        synd[j] = s;
+        error |= (s != 0);
+    }
+    if (!error) {
+        return 0;
+    }
+
+    // Berlekamp-Massey
+    uint8_t lambda[QR_EC_MAX + 1] = {1};
+    uint8_t prev[QR_EC_MAX + 1] = {1};
+    uint8_t prev_d = 1;
+    int len = 0;
+    int shift = 1;
+    for (int r = 0; r < ec_len; r++) {
+        uint8_t d = synd[r];
+        for (int i = 1; i <= len; i++) {
+            d ^= gf_mul(lambda[i], synd[r - i]);
+        }
+        if (d == 0) {
+            shift++;
+            continue;
+        }
+
+        uint8_t saved[QR_EC_MAX + 1];
+        uint8_t coef = gf_div(d, prev_d);
+        memcpy(saved, lambda, sizeof(saved));
+        for (int i = 0; i + shift <= ec_len; i++) {
+            lambda[i + shift] ^= gf_mul(coef, prev[i]);
+        }
+        if (2 * len <= r) {
+            len = r + 1 - len;
+            memcpy(prev, saved, sizeof(prev));
+            prev_d = d;
+            shift = 1;
+        } else {
+            shift++;
+        }
+    }
+    if (2 * len > ec_len) {
+        return -1;
+    }
+
+    // Omega = S * Lambda mod x^ec_len
+    uint8_t omega[QR_EC_MAX] = {};
+    for (int k = 0; k < ec_len; k++) {
+        for (int i = 0; i <= std::min(k, len); i++) {
+            omega[k] ^= gf_mul(lambda[i], synd[k - i]);
+        }
+    }
+
+    // Chien search and Forney, the generator roots start at alpha^0
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+        int power = n - 1 - i;
+        uint8_t x_inv = gf_exp[(255 - power) % 255];
+        if (gf_poly_eval(lambda, len + 1, x_inv) != 0) {
+            continue;
+        }
+
+        uint8_t derivative = 0;
+        uint8_t x_pow = 1;
+        for (int k = 1; k <= len; k += 2) {
+            derivative ^= gf_mul(lambda[k], x_pow);
+            x_pow = gf_mul(x_pow, gf_mul(x_inv, x_inv));
+        }
+        if (derivative == 0) {
+            return -1;
+        }
+        cw[i] ^= gf_mul(gf_exp[power], gf_div(gf_poly_eval(omega, ec_len, x_inv), derivative));
+        found++;
+    }
+
+    return (found == len) ? found : -1;
+}
+
+static void qr_function_mask(int version, uint8_t mask[QR_SIZE_MAX][QR_SIZE_MAX])
+{
+    int size = 17 + 4 * version;
+
+    memset(mask, 0, QR_SIZE_MAX * QR_SIZE_MAX);
+    for (int i = 0; i < size; i++) {
+        mask[6][i] = 1;
+        mask[i][6] = 1;
+    }
+    // Finder patterns with their separators and the format areas
+    for (int y = 0; y < 9; y++) {
+        for (int x = 0; x < 9; x++) {
+            mask[y][x] = 1;
+        }
+    }
+    for (int y = 0; y < 9; y++) {
+        for (int x = size - 8; x < size; x++) {
+            mask[y][x] = 1;
+        }
+    }
+    for (int y = size - 8; y < size; y++) {
+        for (int x = 0; x < 9; x++) {
+            mask[y][x] = 1;
+        }
+    }
+    // Alignment patterns, except where they would overlap a finder
+    int align_num = (version >= 2) ? ((version >= 7) ? 3 : 2) : 0;
+    for (int i = 0; i < align_num; i++) {
+        for (int j = 0; j < align_num; j++) {
+            if ((i == 0 && j == 0) || (i == 0 && j == align_num - 1) || (i == align_num - 1 && j == 0)) {
+                continue;
+            }
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    mask[qr_align_pos[version][i] + dy][qr_align_pos[version][j] + dx] = 1;
+                }
+            }
+        }
+    }
+    if (version >= 7) {
+        for (int i = 0; i < 18; i++) {
+            int a = size - 11 + i % 3;
+            int b = i / 3;
+            mask[b][a] = 1;
+            mask[a][b] = 1;
+        }
+    }
+}
+
+static bool qr_mask_bit(int mask, int x, int y)
+{
+    switch (mask) {
+    case 0: return (x + y) % 2 == 0;
+    case 1: return y % 2 == 0;
+    case 2: return x % 3 == 0;
+    case 3: return (x + y) % 3 == 0;
+    case 4: return (x / 3 + y / 2) % 2 == 0;
+    case 5: return x * y % 2 + x * y % 3 == 0;
+    case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+    default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    }
+}
+
+static int qr_format_distance(int bits, int *format)
+{
+    int best = 15;
+
+    for (int data = 0; data < 32; data++) {
+        int rem = data;
+        for (int i = 0; i < 10; i++) {
+            rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+        }
+        int code = ((data << 10) | rem) ^ QR_FORMAT_MASK;
+        int distance = __builtin_popcount(code ^ bits);
+        if (distance < best) {
+            best = distance;
+            *format = data;
+        }
+    }
+
+    return best;
+}
+
+static bool qr_read_format(const uint8_t grid[QR_SIZE_MAX][QR_SIZE_MAX], int size, int *format)
+{
+    int bits1 = 0;
+    int bits2 = 0;
+
+    for (int i = 0; i <= 5; i++) {
+        bits1 |= grid[i][8] << i;
+    }
+    bits1 |= grid[7][8] << 6;
+    bits1 |= grid[8][8] << 7;
+    bits1 |= grid[8][7] << 8;
+    for (int i = 9; i < 15; i++) {
+        bits1 |= grid[8][14 - i] << i;
+    }
+    for (int i = 0; i < 8; i++) {
+        bits2 |= grid[8][size - 1 - i] << i;
+    }
+    for (int i = 8; i < 15; i++) {
+        bits2 |= grid[size - 15 + i][8] << i;
+    }
+
+    int format1 = 0;
+    int format2 = 0;
+    int distance1 = qr_format_distance(bits1, &format1);
+    int distance2 = qr_format_distance(bits2, &format2);
+    *format = (distance1 <= distance2) ? format1 : format2;
+
+    return std::min(distance1, distance2) <= 3;
+}
+
+typedef struct {
+    const uint8_t *data;
+    int len;
+    int pos;
+} qr_bits_t;
+
+static int qr_bits_read(qr_bits_t *bits, int num)
+{
+    int value = 0;
+
+    if (bits->pos + num > bits->len * 8) {
+        return -1;
+    }
+    for (int i = 0; i < num; i++, bits->pos++) {
+        value = (value << 1) | ((bits->data[bits->pos >> 3] >> (7 - (bits->pos & 7))) & 1);
+    }
+
+    return value;
+}
+
+static void scan_text_put(app_code_scan_code_t *code, char c)
+{
+    if (code->len < APP_CODE_SCAN_TEXT_MAX - 1) {
+        code->text[code->len++] = c;
+    }
+}
+
+static bool qr_parse(const uint8_t *data, int len, int version, app_code_scan_code_t *code)
+{
+    qr_bits_t bits = {data, len, 0};
+    bool large = version >= 10;
+
+    code->len = 0;
+    while (true) {
+        int mode = qr_bits_read(&bits, 4);
+        if (mode <= 0) {
+            break;
+        }
+
+        int count;
+        switch (mode) {
+        case 1:
+            count = qr_bits_read(&bits, large ? 12 : 10);
+            for (; count >= 3; count -= 3) {
+                int v = qr_bits_read(&bits, 10);
+                if ((v < 0) || (v > 999)) {
+                    return false;
+                }
+                scan_text_put(code, '0' + v / 100);
+                scan_text_put(code, '0' + v / 10 % 10);
+                scan_text_put(code, '0' + v % 10);
+            }
+            if (count > 0) {
+                int v = qr_bits_read(&bits, count == 2 ? 7 : 4);
+                if ((v < 0) || (v >= (count == 2 ? 100 : 10))) {
+                    return false;
+                }
+                if (count == 2) {
+                    scan_text_put(code, '0' + v / 10);
+                }
+                scan_text_put(code, '0' + v % 10);
+            }
+            break;
+        case 2:
+            count = qr_bits_read(&bits, large ? 11 : 9);
+            for (; count >= 2; count -= 2) {
+                int v = qr_bits_read(&bits, 11);
+                if ((v < 0) || (v >= 45 * 45)) {
+                    return false;
+                }
+                scan_text_put(code, qr_alnum[v / 45]);
+                scan_text_put(code, qr_alnum[v % 45]);
+            }
+            if (count == 1) {
+                int v = qr_bits_read(&bits, 6);
+                if ((v < 0) || (v >= 45)) {
+                    return false;
+                }
+                scan_text_put(code, qr_alnum[v]);
+            }
+            break;
+        case 4:
+            count = qr_bits_read(&bits, large ? 16 : 8);
+            for (; count > 0; count--) {
+                int v = qr_bits_read(&bits, 8);
+                if (v < 0) {
+                    return false;
+                }
+                scan_text_put(code, v);
+            }
+            break;
+        case 8:
+            // Kanji, left as Shift JIS
+            count = qr_bits_read(&bits, large ? 10 : 8);
+            for (; count > 0; count--) {
+                int v = qr_bits_read(&bits, 13);
+                if (v < 0) {
+                    return false;
+                }
+                int sjis = ((v / 0xc0) << 8) | (v % 0xc0);
+                sjis += (sjis < 0x1f00) ? 0x8140 : 0xc140;
+                scan_text_put(code, sjis >> 8);
+                scan_text_put(code, sjis & 0xff);
+            }
+            break;
+        case 7: {
+            // ECI designator, the payload bytes are passed through
+            int first = qr_bits_read(&bits, 8);
+            if ((first >= 0) && (first & 0x80)) {
+                qr_bits_read(&bits, (first & 0x40) ? 16 : 8);
+            }
+            count = first;
+            break;
+        }
+        case 3:
+            count = qr_bits_read(&bits, 16);
+            break;
+        case 5:
+            count = 0;
+            break;
+        case 9:
+            count = qr_bits_read(&bits, 8);
+            break;
+        default:
+            return false;
+        }
+        if (count < 0) {
+            return false;
+        }
+    }
+    code->text[code->len] = '\0';
+
+    return code->len > 0;
+}
+
+static bool qr_decode_version(const scan_finder_t *tl, const scan_finder_t *tr, const scan_finder_t *bl, int version,
+                              uint32_t step, app_code_scan_code_t *code)
+{
+    static uint8_t grid[QR_SIZE_MAX][QR_SIZE_MAX];
+    static uint8_t function[QR_SIZE_MAX][QR_SIZE_MAX];
+    static uint8_t raw[QR_CODEWORDS_MAX];
+    static uint8_t data[QR_CODEWORDS_MAX];
+    int size = 17 + 4 * version;
+    scan_transform_t t;
+
+    if (!qr_transform(tl, tr, bl, version, &t)) {
+        return false;
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            scan_point_t p = transform_apply(&t, x + 0.5f, y + 0.5f);
+            int px = (int)floorf(p.x);
+            int py = (int)floorf(p.y);
+            if (!scan_inside(px, py)) {
+                return false;
+            }
+            grid[y][x] = scan_dark(px, py);
+        }
+    }
+
+    int format;
+    if (!qr_read_format(grid, size, &format)) {
+        return false;
+    }
+    int level = format >> 3;
+    int mask = format & 7;
+
+    // Zigzag in column pairs from the bottom right, skipping the vertical timing pattern
+    qr_function_mask(version, function);
+    int total = qr_codewords[version];
+    int bit = 0;
+    memset(raw, 0, total);
+    for (int right = size - 1; right >= 1; right -= 2) {
+        if (right == 6) {
+            right = 5;
+        }
+        for (int vert = 0; vert < size; vert++) {
+            for (int j = 0; j < 2; j++) {
+                int x = right - j;
+                bool upward = ((right + 1) & 2) == 0;
+                int y = upward ? size - 1 - vert : vert;
+                if (function[y][x] || (bit >= total * 8)) {
+                    continue;
+                }
+                if (grid[y][x] ^ qr_mask_bit(mask, x, y)) {
+                    raw[bit >> 3] |= 0x80 >> (bit & 7);
+                }
+                bit++;
+            }
+        }
+    }
+
+    // Blocks are interleaved codeword by codeword, the short blocks come first
+    const qr_ec_t *ec = &qr_ec[version][level];
+    int short_len = total / ec->blocks;
+    int short_num = ec->blocks - total % ec->blocks;
+    int short_data = short_len - ec->ec_len;
+    int data_len = 0;
+    for (int b = 0; b < ec->blocks; b++) {
+        uint8_t block[QR_CODEWORDS_MAX];
+        int block_data = short_data + (b >= short_num);
+        int len = block_data + ec->ec_len;
+
+        for (int i = 0; i < block_data; i++) {
+            // Codeword i of every block, short blocks have no codeword `short_data`
+            int index = (i < short_data) ? i * ec->blocks + b : short_data * ec->blocks + (b - short_num);
+            block[i] = raw[index];
+        }
+        int data_total = short_data * ec->blocks + (ec->blocks - short_num);
+        for (int i = 0; i < ec->ec_len; i++) {
+            block[block_data + i] = raw[data_total + i * ec->blocks + b];
+        }
+        if (rs_correct(block, len, ec->ec_len) < 0) {
+            return false;
+        }
+        memcpy(data + data_len, block, block_data);
+        data_len += block_data;
+    }
+
+    if (!qr_parse(data, data_len, version, code)) {
+        return false;
+    }
+    code->type = APP_CODE_SCAN_TYPE_QR;
+    const scan_point_t corners_grid[4] = {{0, 0}, {(float)size, 0}, {(float)size, (float)size}, {0, (float)size}};
+    for (int i = 0; i < 4; i++) {
+        scan_point_t p = transform_apply(&t, corners_grid[i].x, corners_grid[i].y);
+        code->corners[2 * i] = (int)lroundf(p.x * step);
+        code->corners[2 * i + 1] = (int)lroundf(p.y * step);
+    }
+
+    return true;
+}
+
+static bool qr_decode(const scan_finder_t *tl, const scan_finder_t *tr, const scan_finder_t *bl, uint32_t step,
+                      app_code_scan_code_t *code)
+{
+    float module = (tl->module + tr->module + bl->module) / 3;
+    float dist_tr = hypotf(tr->center.x - tl->center.x, tr->center.y - tl->center.y);
+    float dist_bl = hypotf(bl->center.x - tl->center.x, bl->center.y - tl->center.y);
+    float size = (dist_tr + dist_bl) / (2 * module) + 7;
+    int version = (int)lroundf((size - 17) / 4);
+    const int tries[3] = {version, version - 1, version + 1};
+
+    for (int i = 0; i < 3; i++) {
+        if ((tries[i] >= 1) && (tries[i] <= QR_VERSION_MAX) && qr_decode_version(tl, tr, bl, tries[i], step, code)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Three finders of similar size at the corners of an isosceles right triangle, ordered top left, top right, bottom left
+static float qr_triple_score(const scan_finder_t *f[3], int order[3])
+{
+    float d[3];
+
+    for (int i = 0; i < 3; i++) {
+        const scan_finder_t *a = f[(i + 1) % 3];
+        const scan_finder_t *b = f[(i + 2) % 3];
+        d[i] = hypotf(a->center.x - b->center.x, a->center.y - b->center.y);
+        if ((f[i]->module > a->module * 1.4f) || (a->module > f[i]->module * 1.4f)) {
+            return -1;
+        }
+    }
+    // The corner finder is opposite the longest side
+    int corner = (d[0] >= d[1] && d[0] >= d[2]) ? 0 : ((d[1] >= d[2]) ? 1 : 2);
+    const scan_finder_t *tl = f[corner];
+    const scan_finder_t *b = f[(corner + 1) % 3];
+    const scan_finder_t *c = f[(corner + 2) % 3];
+    float ab_x = b->center.x - tl->center.x;
+    float ab_y = b->center.y - tl->center.y;
+    float ac_x = c->center.x - tl->center.x;
+    float ac_y = c->center.y - tl->center.y;
+    float ab = hypotf(ab_x, ab_y);
+    float ac = hypotf(ac_x, ac_y);
+    float module = tl->module;
+    if ((ab < 7 * module) || (ac < 7 * module) || (ab > ac * 1.3f) || (ac > ab * 1.3f)) {
+        return -1;
+    }
+    float cos_angle = (ab_x * ac_x + ab_y * ac_y) / (ab * ac);
+    if (fabsf(cos_angle) > 0.3f) {
+        return -1;
+    }
+
+    // Clockwise in image coordinates, y pointing down
+    bool clockwise = ab_x * ac_y - ab_y * ac_x > 0;
+    order[0] = corner;
+    order[1] = clockwise ? (corner + 1) % 3 : (corner + 2) % 3;
+    order[2] = clockwise ? (corner + 2) % 3 : (corner + 1) % 3;
+
+    return fabsf(cos_angle) + fabsf(ab - ac) / std::max(ab, ac);
+}
+
+static void qr_scan(uint32_t step, app_code_scan_result_t *result)
+{
+    scan_finder_t finders[SCAN_FINDER_MAX];
+    int num = finder_search(finders);
+
+    // Weak candidates were only crossed by a single row
+    int kept = 0;
+    for (int i = 0; i < num; i++) {
+        if (finders[i].count >= 2) {
+            finders[kept++] = finders[i];
+        }
+    }
+    num = std::min(kept, 8);
+    if (num < 3) {
+        return;
+    }
+    std::sort(finders, finders + kept, [](const scan_finder_t &a, const scan_finder_t &b) {
+        return a.count > b.count;
+    });
+
+    bool used[SCAN_FINDER_MAX] = {};
+    while (result->num < APP_CODE_SCAN_CODE_MAX) {
+        struct {
+            float score;
+            int finders[3];
+        } candidates[SCAN_FINDER_TRIPLE_TRIES];
+        int candidates_num = 0;
+
+        for (int i = 0; i < num; i++) {
+            for (int j = i + 1; j < num; j++) {
+                for (int k = j + 1; k < num; k++) {
+                    if (used[i] || used[j] || used[k]) {
+                        continue;
+                    }
+                    const scan_finder_t *triple[3] = {&finders[i], &finders[j], &finders[k]};
+                    const int index[3] = {i, j, k};
+                    int order[3];
+                    float score = qr_triple_score(triple, order);
+                    if (score < 0) {
+                        continue;
+                    }
+
+                    // Keep the best few, lowest score first
+                    int pos = std::min(candidates_num, SCAN_FINDER_TRIPLE_TRIES - 1);
+                    if ((candidates_num == SCAN_FINDER_TRIPLE_TRIES) && (score >= candidates[pos].score)) {
+                        continue;
+                    }
+                    while ((pos > 0) && (candidates[pos - 1].score > score)) {
+                        candidates[pos] = candidates[pos - 1];
+                        pos--;
+                    }
+                    candidates[pos].score = score;
+                    for (int n = 0; n < 3; n++) {
+                        candidates[pos].finders[n] = index[order[n]];
+                    }
+                    candidates_num = std::min(candidates_num + 1, SCAN_FINDER_TRIPLE_TRIES);
+                }
+            }
+        }
+
+        bool decoded = false;
+        for (int c = 0; (c < candidates_num) && !decoded; c++) {
+            const int *f = candidates[c].finders;
+            app_code_scan_code_t *code = &result->codes[result->num];
+            if (qr_decode(&finders[f[0]], &finders[f[1]], &finders[f[2]], step, code)) {
+                used[f[0]] = used[f[1]] = used[f[2]] = true;
+                result->num++;
+                decoded = true;
+            }
+        }
+        if (!decoded) {
+            break;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------- Barcodes */
+
+// Error of runs against a pattern of `modules` modules, each run normalized to the total width
+static float barcode_pattern_error(const uint16_t *runs, const uint8_t *pattern, int len, int modules)
+{
+    int total = 0;
+    float error = 0;
+
+    for (int i = 0; i < len; i++) {
+        total += runs[i];
+    }
+    if (total == 0) {
+        return 1e9f;
+    }
+    for (int i = 0; i < len; i++) {
+        error += fabsf(runs[i] * (float)modules / total - pattern[i]);
+    }
+
+    return error;
+}
+
+static int barcode_match(const uint16_t *runs, const uint8_t (*patterns)[4], int num, float *error)
+{
+    int best = -1;
+
+    *error = 1e9f;
+    for (int i = 0; i < num; i++) {
+        float e = barcode_pattern_error(runs, patterns[i], 4, 7);
+        if (e < *error) {
+            *error = e;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+static bool barcode_guard_ok(const uint16_t *runs, int len, float module)
+{
+    for (int i = 0; i < len; i++) {
+        if ((runs[i] < module * 0.5f) || (runs[i] > module * 1.5f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ean13_decode(const uint16_t *runs, int num, int start, app_code_scan_code_t *code, int *end_run)
+{
+    if (start + 59 > num) {
+        return false;
+    }
+
+    int total = 0;
+    for (int i = 0; i < 59; i++) {
+        total += runs[start + i];
+    }
+    float module = total / 95.0f;
+    if ((runs[start - 1] < SCAN_QUIET_MODULES * module) ||
+            ((start + 59 < num) && (runs[start + 59] < SCAN_QUIET_MODULES * module)) ||
+            !barcode_guard_ok(runs + start, 3, module) || !barcode_guard_ok(runs + start + 27, 5, module) ||
+            !barcode_guard_ok(runs + start + 56, 3, module)) {
+        return false;
+    }
+
+    uint8_t digits[13];
+    int parity = 0;
+    for (int i = 0; i < 12; i++) {
+        const uint16_t *digit_runs = runs + start + 3 + i * 4 + ((i >= 6) ? 5 : 0);
+        float error;
+        int digit = barcode_match(digit_runs, ean_digits, 10, &error);
+
+        if (i < 6) {
+            // Even parity digits of the left half are the odd ones mirrored
+            uint16_t mirrored[4] = {digit_runs[3], digit_runs[2], digit_runs[1], digit_runs[0]};
+            float even_error;
+            int even_digit = barcode_match(mirrored, ean_digits, 10, &even_error);
+            parity <<= 1;
+            if (even_error < error) {
+                digit = even_digit;
+                error = even_error;
+                parity |= 1;
+            }
+        }
+        if (error > 1.5f) {
+            return false;
+        }
+        digits[i + 1] = digit;
+    }
+
+    digits[0] = 10;
+    for (int d = 0; d < 10; d++) {
+        if (ean_first_digit[d] == parity) {
+            digits[0] = d;
+        }
+    }
+    if (digits[0] == 10) {
+        return false;
+    }
+    int sum = 0;
+    for (int i = 0; i < 12; i++) {
+        sum += digits[i] * ((i & 1) ? 3 : 1);
+    }
+    if ((sum + digits[12]) % 10 != 0) {
+        return false;
+    }
+
+    code->type = APP_CODE_SCAN_TYPE_EAN13;
+    code->len = 13;
+    for (int i = 0; i < 13; i++) {
+        code->text[i] = '0' + digits[i];
+    }
+    code->text[13] = '\0';
+    *end_run = start + 59;
+
+    return true;
+}
+
+static int code128_symbol(const uint16_t *runs, float *error)
+{
+    int best = -1;
+
+    *error = 1e9f;
+    for (int i = 0; i < 107; i++) {
+        float e = barcode_pattern_error(runs, code128_symbols[i], 6, 11);
+        if (e < *error) {
+            *error = e;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+static bool code128_decode(const uint16_t *runs, int num, int start, app_code_scan_code_t *code, int *end_run)
+{
+    uint8_t values[APP_CODE_SCAN_TEXT_MAX];
+    int count = 0;
+    float error;
+    int pos = start;
+
+    if (start + 6 > num) {
+        return false;
+    }
+    int first = code128_symbol(runs + pos, &error);
+    if ((first < CODE128_START_A) || (first > CODE128_START_A + 2) || (error > 2.0f)) {
+        return false;
+    }
+    int total = 0;
+    for (int i = 0; i < 6; i++) {
+        total += runs[pos + i];
+    }
+    float module = total / 11.0f;
+    if (runs[start - 1] < SCAN_QUIET_MODULES * module) {
+        return false;
+    }
+
+    // Symbols up to the stop symbol and its final bar
+    values[count++] = first;
+    pos += 6;
+    while (true) {
+        if ((pos + 6 > num) || (count >= (int)sizeof(values))) {
+            return false;
+        }
+        int value = code128_symbol(runs + pos, &error);
+        if ((value < 0) || (error > 2.0f)) {
+            return false;
+        }
+        pos += 6;
+        if (value == CODE128_STOP) {
+            if ((pos >= num) || (runs[pos] < module) || (runs[pos] > module * 3)) {
+                return false;
+            }
+            pos++;
+            break;
+        }
+        values[count++] = value;
+    }
+    // Start, at least one data symbol and the check symbol
+    if (count < 3) {
+        return false;
+    }
+    int sum = values[0];
+    for (int i = 1; i < count - 1; i++) {
+        sum += values[i] * i;
+    }
+    if (sum % 103 != values[count - 1]) {
+        return false;
+    }
+
+    int set = values[0] - CODE128_START_A;    // 0 A, 1 B, 2 C
+    bool shift = false;
+    code->len = 0;
+    for (int i = 1; i < count - 1; i++) {
+        int v = values[i];
+        int current = shift ? (1 - set) : set;
+
+        shift = false;
+        if (current == 2) {
+            if (v < 100) {
+                scan_text_put(code, '0' + v / 10);
+                scan_text_put(code, '0' + v % 10);
+            } else if (v == CODE128_CODE_B) {
+                set = 1;
+            } else if (v == CODE128_CODE_A) {
+                set = 0;
+            }
+            continue;
+        }
+        if (v < 96) {
+            scan_text_put(code, (current == 1 || v < 64) ? v + 32 : v - 64);
+        } else if ((v == CODE128_SHIFT) && (set != 2)) {
+            shift = true;
+        } else if (v == CODE128_CODE_C) {
+            set = 2;
+        } else if ((v == CODE128_CODE_B) && (current == 0)) {
+            set = 1;
+        } else if ((v == CODE128_CODE_A) && (current == 1)) {
+            set = 0;
+        }
+        // FNC1 to FNC4 carry no text
+    }
+    if (code->len == 0) {
+        return false;
+    }
+    code->text[code->len] = '\0';
+    code->type = APP_CODE_SCAN_TYPE_CODE128;
+    *end_run = pos;
+
+    return true;
+}
+
+static bool barcode_known(const app_code_scan_result_t *result, const app_code_scan_code_t *code)
+{
+    for (int i = 0; i < result->num; i++) {
+        if ((result->codes[i].type == code->type) && (result->codes[i].len == code->len) &&
+                !memcmp(result->codes[i].text, code->text, code->len)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void barcode_scan(uint32_t step, app_code_scan_result_t *result)
+{
+    app_code_scan_code_t pending = {};
+    int pending_lines = 0;
+
+    for (int line = 1; (line <= SCAN_BARCODE_LINES) && (result->num < APP_CODE_SCAN_CODE_MAX); line++) {
+        int y = scan_h * line / (SCAN_BARCODE_LINES + 1);
+        int forward_num = scan_row_runs(y, scan_runs);
+        int reverse_num = scan_reverse_runs(scan_runs, forward_num, scan_runs_rev);
+
+        // Codes upside down read left to right in the reversed runs
+        for (int dir = 0; dir < 2; dir++) {
+            const uint16_t *runs = dir ? scan_runs_rev : scan_runs;
+            int num = dir ? reverse_num : forward_num;
+            int x = runs[0];
+
+            for (int k = 1; k < num; k += 2) {
+                app_code_scan_code_t code;
+                int end = 0;
+                bool found = ean13_decode(runs, num, k, &code, &end) || code128_decode(runs, num, k, &code, &end);
+
+                if (found && !barcode_known(result, &code)) {
+                    int x_end = x;
+                    for (int i = k; i < end; i++) {
+                        x_end += runs[i];
+                    }
+                    int x0 = dir ? (int)scan_w - x_end : x;
+                    int x1 = dir ? (int)scan_w - x : x_end;
+                    const int corners[8] = {x0, y, x1, y, x1, y + 1, x0, y + 1};
+                    for (int i = 0; i < 8; i++) {
+                        code.corners[i] = corners[i] * step;
+                    }
+
+                    if (code.type != APP_CODE_SCAN_TYPE_EAN13) {
+                        result->codes[result->num++] = code;
+                    } else if ((pending_lines > 0) && (pending.len == code.len) &&
+                               !memcmp(pending.text, code.text, code.len)) {
+                        if (++pending_lines >= SCAN_EAN_AGREE_LINES) {
+                            result->codes[result->num++] = code;
+                            pending_lines = 0;
+                        }
+                    } else {
+                        pending = code;
+                        pending_lines = 1;
+                    }
+                    if (result->num >= APP_CODE_SCAN_CODE_MAX) {
+                        return;
+                    }
+                }
+                x += runs[k];
+                if (k + 1 < num) {
+                    x += runs[k + 1];
+                }
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------- API */
+
+esp_err_t app_code_scan_init(uint32_t max_w, uint32_t max_h)
+{
+    ESP_RETURN_ON_FALSE((max_w > 0) && (max_h > 0), ESP_ERR_INVALID_ARG, TAG, "Invalid size");
+
+    if (scan_gray) {
+        return ESP_OK;
+    }
+
+    uint32_t width = std::min<uint32_t>(max_w, APP_CODE_SCAN_WIDTH_MAX);
+    scan_stride = (width + SCAN_TILE - 1) / SCAN_TILE * SCAN_TILE;
+    scan_max_h = max_h;
+    uint32_t tiles = (scan_stride / SCAN_TILE) * ((max_h + SCAN_TILE - 1) / SCAN_TILE);
+
+    // The vector loads and stores need 16 byte alignment
+    scan_gray = (uint8_t *)heap_caps_aligned_alloc(16, scan_stride * max_h, MALLOC_CAP_SPIRAM);
+    scan_bin = (uint8_t *)heap_caps_aligned_alloc(16, scan_stride * max_h, MALLOC_CAP_SPIRAM);
+    tile_sum = (uint32_t *)heap_caps_malloc(tiles * sizeof(uint32_t), MALLOC_CAP_DEFAULT);
+    tile_min = (uint8_t *)heap_caps_malloc(tiles, MALLOC_CAP_DEFAULT);
+    tile_max = (uint8_t *)heap_caps_malloc(tiles, MALLOC_CAP_DEFAULT);
+    tile_black = (uint8_t *)heap_caps_malloc(tiles, MALLOC_CAP_DEFAULT);
+    tile_threshold = (uint8_t *)heap_caps_malloc(tiles, MALLOC_CAP_DEFAULT);
+    scan_runs = (uint16_t *)heap_caps_malloc((scan_stride + 2) * sizeof(uint16_t), MALLOC_CAP_DEFAULT);
+    scan_runs_rev = (uint16_t *)heap_caps_malloc((scan_stride + 2) * sizeof(uint16_t), MALLOC_CAP_DEFAULT);
+    if (!scan_gray || !scan_bin || !tile_sum || !tile_min || !tile_max || !tile_black || !tile_threshold ||
+            !scan_runs || !scan_runs_rev) {
+        ESP_LOGE(TAG, "Allocate scan planes failed");
+        app_code_scan_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    gf_init();
+    ESP_LOGI(TAG, "Scanning up to %" PRIu32 "x%" PRIu32, width, max_h);
+
+    return ESP_OK;
+}
+
+void app_code_scan_deinit(void)
+{
+    heap_caps_free(scan_gray);
+    heap_caps_free(scan_bin);
+    heap_caps_free(tile_sum);
+    heap_caps_free(tile_min);
+    heap_caps_free(tile_max);
+    heap_caps_free(tile_black);
+    heap_caps_free(tile_threshold);
+    heap_caps_free(scan_runs);
+    heap_caps_free(scan_runs_rev);
+    scan_gray = scan_bin = NULL;
+    tile_sum = NULL;
+    tile_min = tile_max = tile_black = tile_threshold = NULL;
+    scan_runs = scan_runs_rev = NULL;
+}
+
+esp_err_t app_code_scan_process(const void *img, uint32_t w, uint32_t h, bool rgb888, app_code_scan_result_t *result)
+{
+    ESP_RETURN_ON_FALSE(scan_gray, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(img && result, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    uint32_t step = (w + APP_CODE_SCAN_WIDTH_MAX - 1) / APP_CODE_SCAN_WIDTH_MAX;
+    result->num = 0;
+    scan_w = w / step;
+    scan_h = h / step;
+    ESP_RETURN_ON_FALSE((scan_w >= SCAN_TILE) && (scan_h >= SCAN_TILE) && (scan_w <= scan_stride) &&
+                        (scan_h <= scan_max_h), ESP_ERR_INVALID_SIZE, TAG, "Unsupported size %" PRIu32 "x%" PRIu32, w, h);
+
+    if (rgb888) {
+        // Byte order agnostic, red and blue weigh the same
+        scan_load_gray((const uint8_t *)img, w, step, 3, [](const uint8_t *p) -> uint8_t {
+            return (p[0] + 2 * p[1] + p[2]) >> 2;
+        });
+    } else {
+        scan_load_gray((const uint8_t *)img, w, step, 2, [](const uint8_t *p) -> uint8_t {
+            uint16_t v = p[0] | (p[1] << 8);
+            return ((v >> 11) * 616 + ((v >> 5) & 0x3f) * 600 + (v & 0x1f) * 232) >> 8;
+        });
+    }
+    scan_binarize();
+
+    qr_scan(step, result);
+    if (result->num < APP_CODE_SCAN_CODE_MAX) {
+        barcode_scan(step, result);
+    }
+
+    return ESP_OK;
+}
+
+const char *app_code_scan_type_name(app_code_scan_type_t type)
+{
+    switch (type) {
+    case APP_CODE_SCAN_TYPE_QR:
+        return "qr";
+    case APP_CODE_SCAN_TYPE_EAN13:
+        return "ean13";
+    case APP_CODE_SCAN_TYPE_CODE128:
+        return "code128";
+    default:
+        return "unknown";
+    }
+}
+
+#endif /* CONFIG_CAMERA_CODE_SCAN */
@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define APP_CODE_SCAN_CODE_MAX              (2)     /*!< Maximum number of codes decoded per image */
+#define APP_CODE_SCAN_TEXT_MAX              (128)   /*!< Size of the text of a code, terminator included */
+#define APP_CODE_SCAN_WIDTH_MAX             (640)   /*!< Wider inputs are decimated to this width before scanning */
+
+/**
+ * @brief Symbology of a decoded code.
+ */
+typedef enum {
+    APP_CODE_SCAN_TYPE_QR = 0,              /*!< QR code, model 2, versions 1 to 10. */
+    APP_CODE_SCAN_TYPE_EAN13,               /*!< EAN-13, UPC-A is read as EAN-13 with a leading 0. */
+    APP_CODE_SCAN_TYPE_CODE128,             /*!< Code 128, code sets A, B and C. */
+} app_code_scan_type_t;
+
+/**
+ * @brief A decoded code.
+ */
+typedef struct {
+    app_code_scan_type_t type;              /*!< Symbology. */
+    int corners[8];                         /*!< Corners as x/y pairs in input pixels, clockwise from the top left of
+                                                 the code. A barcode is the scanline it was read on, twice. */
+    uint16_t len;                           /*!< Length of `text`, which may contain NUL bytes for QR byte data. */
+    char text[APP_CODE_SCAN_TEXT_MAX];      /*!< Decoded payload, NUL terminated, truncated if too long. */
+} app_code_scan_code_t;
+
+/**
+ * @brief Codes found in an image.
+ */
+typedef struct {
+    uint8_t num;                                    /*!< Number of valid entries in `codes`. */
+    app_code_scan_code_t codes[APP_CODE_SCAN_CODE_MAX]; /*!< Codes, QR codes first. */
+} app_code_scan_result_t;
+
+/**
+ * @brief Allocate the working planes of the scanner.
+ *
+ * @param max_w Largest input width.
+ * @param max_h Largest input height.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM.
+ */
+esp_err_t app_code_scan_init(uint32_t max_w, uint32_t max_h);
+
+/**
+ * @brief Free the working planes.
+ */
+void app_code_scan_deinit(void);
+
+/**
+ * @brief Find and decode the codes of an image.
+ *
+ * The image is reduced to a grayscale plane, binarized against the local mean of 16x16 tiles (PIE vector compares on
+ * ESP32-P4), and searched for QR finder patterns and barcode guard patterns. Must be called from one task.
+ *
+ * @param img RGB565 or RGB888 image.
+ * @param w Image width, at most the width given to `app_code_scan_init`.
+ * @param h Image height, at most the height given to `app_code_scan_init`.
+ * @param rgb888 Whether the image is RGB888 instead of RGB565.
+ * @param result Output codes, `num` is 0 if none was decoded.
+ *
+ * @return ESP_OK on success, found or not, ESP_ERR_INVALID_STATE if not initialized, or ESP_ERR_INVALID_SIZE.
+ */
+esp_err_t app_code_scan_process(const void *img, uint32_t w, uint32_t h, bool rgb888, app_code_scan_result_t *result);
+
+/**
+ * @brief Get the name of a symbology, e.g. "qr".
+ */
+const char *app_code_scan_type_name(app_code_scan_type_t type);
@@ -0,0 +1,379 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "app_detect_export.hpp"
+#if CONFIG_CAMERA_CODE_SCAN
+#include "app_code_scan.hpp"
+#endif
+#if CONFIG_CAMERA_DETECT_EXPORT_UART
+#include "uart_ttl/UartService.hpp"
+#elif CONFIG_CAMERA_DETECT_EXPORT_USB_CDC
+#include "uart_usb/TinyUsbCdcService.hpp"
+#endif
+
+#if !CONFIG_CAMERA_DETECT_EXPORT_NONE
+#if CONFIG_CAMERA_DETECT_EXPORT_MAX_HZ > 0
+#define EXPORT_MIN_PERIOD_US                (1000000 / CONFIG_CAMERA_DETECT_EXPORT_MAX_HZ)
+#else
+#define EXPORT_MIN_PERIOD_US                (0)
+#endif
+// A full result of the largest detection, keypoints included, in either format
+#define EXPORT_BUF_SIZE                     (128 + CAMERA_PIPELINE_DETECT_RESULT_MAX * (128 + CAMERA_PIPELINE_DETECT_KEYPOINT_MAX * 12))
+#define EXPORT_FLAG_FACE                    (0x01)
+#define EXPORT_FLAG_CODES                   (0x02)
+#define EXPORT_FLAG_COUNTS                  (0x04)
+// Every byte of a code text may be escaped as \u00XX in JSON
+static_assert(EXPORT_BUF_SIZE >= 128 + CAMERA_PIPELINE_CODE_MAX * (64 + CAMERA_PIPELINE_CODE_TEXT_MAX * 6),
+              "Export buffer too small for scanned codes");
+
+static const char *TAG = "app_detect_export";
+
+#if CONFIG_CAMERA_DETECT_EXPORT_UART
+static UartService *export_link = NULL;
+#else
+static TinyUsbCdcService *export_link = NULL;
+#endif
+// Serialized in place, the stream task never allocates per frame
+static uint8_t export_buf[EXPORT_BUF_SIZE];
+static int64_t export_last_us = 0;
+static app_detect_export_stats_t export_stats;
+
+#if CONFIG_CAMERA_DETECT_EXPORT_BINARY
+static uint8_t *export_put(uint8_t *p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        *p++ = (value >> (i * 8)) & 0xff;
+    }
+    return p;
+}
+
+static size_t export_serialize(const camera_pipeline_detect_result_t *result, bool face)
+{
+    uint8_t *p = export_buf;
+
+    p = export_put(p, APP_DETECT_EXPORT_SYNC, 2);
+    p = export_put(p, APP_DETECT_EXPORT_VERSION, 1);
+    p = export_put(p, result->num, 1);
+    p = export_put(p, face ? EXPORT_FLAG_FACE : 0, 1);
+    p = export_put(p, result->frame_seq, 4);
+    p = export_put(p, (uint32_t)result->timestamp_us, 4);
+    p = export_put(p, (uint32_t)((uint64_t)result->timestamp_us >> 32), 4);
+    for (uint32_t i = 0; i < result->num; i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+        p = export_put(p, box->track_id, 2);
+        p = export_put(p, box->face_id, 2);
+        p = export_put(p, box->category, 1);
+        p = export_put(p, (uint32_t)std::clamp(box->score * 255.f + 0.5f, 0.f, 255.f), 1);
+        for (int j = 0; j < 4; j++) {
+            p = export_put(p, (uint16_t)box->box[j], 2);
+        }
+        p = export_put(p, box->keypoint_num, 1);
+        for (int j = 0; j < box->keypoint_num; j++) {
+            p = export_put(p, (uint16_t)box->keypoint[j], 2);
+        }
+    }
+    p = export_put(p, esp_rom_crc16_le(0, export_buf + 2, p - export_buf - 2), 2);
+
+    return p - export_buf;
+}
+
+#if CONFIG_CAMERA_CODE_SCAN
+static size_t export_serialize_codes(const camera_pipeline_detect_result_t *result)
+{
+    uint8_t *p = export_buf;
+    uint32_t num = std::min<uint32_t>(result->num, CAMERA_PIPELINE_CODE_MAX);
+
+    p = export_put(p, APP_DETECT_EXPORT_SYNC, 2);
+    p = export_put(p, APP_DETECT_EXPORT_VERSION, 1);
+    p = export_put(p, num, 1);
+    p = export_put(p, EXPORT_FLAG_CODES, 1);
+    p = export_put(p, result->frame_seq, 4);
+    p = export_put(p, (uint32_t)result->timestamp_us, 4);
+    p = export_put(p, (uint32_t)((uint64_t)result->timestamp_us >> 32), 4);
+    for (uint32_t i = 0; i < num; i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+        size_t len = strnlen(result->code_text[i], CAMERA_PIPELINE_CODE_TEXT_MAX - 1);
+
+        p = export_put(p, box->category, 1);
+        for (int j = 0; j < 4; j++) {
+            p = export_put(p, (uint16_t)box->box[j], 2);
+        }
+        p = export_put(p, len, 1);
+        memcpy(p, result->code_text[i], len);
+        p += len;
+    }
+    p = export_put(p, esp_rom_crc16_le(0, export_buf + 2, p - export_buf - 2), 2);
+
+    return p - export_buf;
+}
+#endif
+
+#if CONFIG_CAMERA_PEOPLE_COUNT
+static size_t export_serialize_counts(const app_people_count_bucket_t *bucket, uint8_t line_num, uint8_t zone_num,
+                                      int64_t now_us)
+{
+    uint8_t *p = export_buf;
+
+    p = export_put(p, APP_DETECT_EXPORT_SYNC, 2);
+    p = export_put(p, APP_DETECT_EXPORT_VERSION, 1);
+    p = export_put(p, line_num, 1);
+    p = export_put(p, EXPORT_FLAG_COUNTS, 1);
+    p = export_put(p, bucket->minute, 4);
+    p = export_put(p, (uint32_t)now_us, 4);
+    p = export_put(p, (uint32_t)((uint64_t)now_us >> 32), 4);
+    p = export_put(p, zone_num, 1);
+    for (int i = 0; i < line_num; i++) {
+        p = export_put(p, bucket->line_in[i], 2);
+        p = export_put(p, bucket->line_out[i], 2);
+    }
+    for (int i = 0; i < zone_num; i++) {
+        p = export_put(p, bucket->zone_enter[i], 2);
+        p = export_put(p, bucket->zone_leave[i], 2);
+        p = export_put(p, bucket->zone_dwell_ms[i], 4);
+        p = export_put(p, bucket->zone_dwell_max_ms[i], 4);
+    }
+    p = export_put(p, esp_rom_crc16_le(0, export_buf + 2, p - export_buf - 2), 2);
+
+    return p - export_buf;
+}
+#endif
+#else
+static size_t export_serialize(const camera_pipeline_detect_result_t *result, bool face)
+{
+    char *buf = (char *)export_buf;
+    size_t size = sizeof(export_buf);
+    int len = snprintf(buf, size, "{\"t\":%" PRId64 ",\"seq\":%" PRIu32 ",\"face\":%d,\"dets\":[",
+                       result->timestamp_us, result->frame_seq, face ? 1 : 0);
+
+    for (uint32_t i = 0; (i < result->num) && (len < (int)size); i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+        len += snprintf(buf + len, size - len, "%s{\"id\":%u,\"face_id\":%u,\"cat\":%d,\"score\":%.2f,\"box\":[%d,%d,%d,%d]",
+                        i ? "," : "", box->track_id, box->face_id, box->category, box->score,
+                        box->box[0], box->box[1], box->box[2], box->box[3]);
+        if (box->keypoint_num && (len < (int)size)) {
+            len += snprintf(buf + len, size - len, ",\"kp\":[");
+            for (int j = 0; (j < box->keypoint_num) && (len < (int)size); j++) {
+                len += snprintf(buf + len, size - len, "%s%d", j ? "," : "", box->keypoint[j]);
+            }
+            if (len < (int)size) {
+                len += snprintf(buf + len, size - len, "]");
+            }
+        }
+        if (len < (int)size) {
+            len += snprintf(buf + len, size - len, "}");
+        }
+    }
+    if (len < (int)size) {
+        len += snprintf(buf + len, size - len, "]}\n");
+    }
+
+    // A truncated line would be misparsed on the host, drop it instead
+    return (len < (int)size) ? len : 0;
+}
+
+#if CONFIG_CAMERA_CODE_SCAN
+static size_t export_serialize_codes(const camera_pipeline_detect_result_t *result)
+{
+    char *buf = (char *)export_buf;
+    size_t size = sizeof(export_buf);
+    uint32_t num = std::min<uint32_t>(result->num, CAMERA_PIPELINE_CODE_MAX);
+    int len = snprintf(buf, size, "{\"t\":%" PRId64 ",\"seq\":%" PRIu32 ",\"codes\":[",
+                       result->timestamp_us, result->frame_seq);
+
+    for (uint32_t i = 0; (i < num) && (len < (int)size); i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+        len += snprintf(buf + len, size - len, "%s{\"type\":\"%s\",\"box\":[%d,%d,%d,%d],\"text\":\"", i ? "," : "",
+                        app_code_scan_type_name((app_code_scan_type_t)box->category),
+                        box->box[0], box->box[1], box->box[2], box->box[3]);
+        // Quotes, backslashes and control bytes are escaped, other bytes are passed through
+        for (const char *c = result->code_text[i]; *c && (len < (int)size); c++) {
+            uint8_t ch = *c;
+            if ((ch == '"') || (ch == '\\')) {
+                len += snprintf(buf + len, size - len, "\\%c", ch);
+            } else if (ch < 0x20) {
+                len += snprintf(buf + len, size - len, "\\u%04x", ch);
+            } else {
+                buf[len++] = ch;
+            }
+        }
+        if (len < (int)size) {
+            len += snprintf(buf + len, size - len, "\"}");
+        }
+    }
+    if (len < (int)size) {
+        len += snprintf(buf + len, size - len, "]}\n");
+    }
+
+    return (len < (int)size) ? len : 0;
+}
+#endif
+
+#if CONFIG_CAMERA_PEOPLE_COUNT
+static size_t export_serialize_counts(const app_people_count_bucket_t *bucket, uint8_t line_num, uint8_t zone_num,
+                                      int64_t now_us)
+{
+    char *buf = (char *)export_buf;
+    size_t size = sizeof(export_buf);
+    int len = snprintf(buf, size, "{\"t\":%" PRId64 ",\"minute\":%" PRIu32 ",\"lines\":[", now_us, bucket->minute);
+
+    for (int i = 0; i < line_num; i++) {
+        len += snprintf(buf + len, size - len, "%s[%u,%u]", i ? "," : "", bucket->line_in[i], bucket->line_out[i]);
+    }
+    len += snprintf(buf + len, size - len, "],\"zones\":[");
+    for (int i = 0; i < zone_num; i++) {
+        len += snprintf(buf + len, size - len, "%s[%u,%u,%" PRIu32 ",%" PRIu32 "]", i ? "," : "",
+                        bucket->zone_enter[i], bucket->zone_leave[i], bucket->zone_dwell_ms[i],
+                        bucket->zone_dwell_max_ms[i]);
+    }
+    len += snprintf(buf + len, size - len, "]}\n");
+
+    // A few hundred bytes at most, far below the buffer sized for detections
+    return (len < (int)size) ? len : 0;
+}
+#endif
+#endif
+
+// Never block the stream task on a slow link, a record is sent whole or not at all
+static bool export_send(size_t len, int64_t now_us)
+{
+    if ((len == 0) || (export_link->txFree() < len)) {
+        export_stats.dropped++;
+        return false;
+    }
+    export_link->write(export_buf, len);
+    export_last_us = now_us;
+    export_stats.published++;
+
+    return true;
+}
+
+static bool export_rate_limited(int64_t now_us)
+{
+    if ((EXPORT_MIN_PERIOD_US > 0) && (export_last_us != 0) && (now_us - export_last_us < EXPORT_MIN_PERIOD_US)) {
+        export_stats.rate_limited++;
+        return true;
+    }
+    return false;
+}
+#endif
+
+esp_err_t app_detect_export_init(void)
+{
+#if CONFIG_CAMERA_DETECT_EXPORT_NONE
+    return ESP_OK;
+#else
+    if (export_link) {
+        return ESP_OK;
+    }
+
+    memset(&export_stats, 0, sizeof(export_stats));
+    export_last_us = 0;
+#if CONFIG_CAMERA_DETECT_EXPORT_UART
+    UartConfig config = {
+        .baud_rate = CONFIG_CAMERA_DETECT_EXPORT_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .dma_capture = false,
+    };
+    export_link = new UartService();
+    export_link->begin(config);
+#else
+    // The device is opened by the scan task once it is plugged in, records are dropped until then
+    export_link = new TinyUsbCdcService();
+    if (!export_link->begin()) {
+        ESP_LOGE(TAG, "Open USB CDC host failed");
+        delete export_link;
+        export_link = NULL;
+        return ESP_FAIL;
+    }
+    export_link->startScan();
+#endif
+    ESP_LOGI(TAG, "Exporting detections at up to %d Hz", CONFIG_CAMERA_DETECT_EXPORT_MAX_HZ);
+
+    return ESP_OK;
+#endif
+}
+
+void app_detect_export_deinit(void)
+{
+#if !CONFIG_CAMERA_DETECT_EXPORT_NONE
+    if (!export_link) {
+        return;
+    }
+
+    export_link->end();
+    delete export_link;
+    export_link = NULL;
+    ESP_LOGI(TAG, "Published %" PRIu32 ", rate limited %" PRIu32 ", dropped %" PRIu32,
+             export_stats.published, export_stats.rate_limited, export_stats.dropped);
+#endif
+}
+
+bool app_detect_export_publish(const camera_pipeline_detect_result_t *result, bool face)
+{
+#if CONFIG_CAMERA_DETECT_EXPORT_NONE
+    return false;
+#else
+    int64_t now_us = esp_timer_get_time();
+
+    if (!export_link || export_rate_limited(now_us)) {
+        return false;
+    }
+
+    return export_send(export_serialize(result, face), now_us);
+#endif
+}
+
+#if CONFIG_CAMERA_CODE_SCAN
+bool app_detect_export_publish_codes(const camera_pipeline_detect_result_t *result)
+{
+#if CONFIG_CAMERA_DETECT_EXPORT_NONE
+    return false;
+#else
+    int64_t now_us = esp_timer_get_time();
+
+    if (!export_link || export_rate_limited(now_us)) {
+        return false;
+    }
+
+    return export_send(export_serialize_codes(result), now_us);
+#endif
+}
+#endif
+
+#if CONFIG_CAMERA_PEOPLE_COUNT
+bool app_detect_export_publish_counts(const app_people_count_bucket_t *bucket, uint8_t line_num, uint8_t zone_num)
+{
+#if CONFIG_CAMERA_DETECT_EXPORT_NONE
+    return false;
+#else
+    int64_t now_us = esp_timer_get_time();
+
+    if (!export_link) {
+        return false;
+    }
+
+    return export_send(export_serialize_counts(bucket, line_num, zone_num, now_us), now_us);
+#endif
+}
+#endif
+
+void app_detect_export_get_stats(app_detect_export_stats_t *stats)
+{
+#if CONFIG_CAMERA_DETECT_EXPORT_NONE
+    memset(stats, 0, sizeof(*stats));
+#else
+    *stats = export_stats;
+#endif
+}
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "app_camera_pipeline.hpp"
+#if CONFIG_CAMERA_PEOPLE_COUNT
+#include "app_people_count.hpp"
+#endif
+
+#define APP_DETECT_EXPORT_SYNC              (0x5aa5)  /*!< First two bytes of a binary record, little endian. */
+#define APP_DETECT_EXPORT_VERSION           (1)       /*!< Version of the record layout. */
+
+/**
+ * @brief Counters of the detection export.
+ */
+typedef struct {
+    uint32_t published;                               /*!< Records handed to the link. */
+    uint32_t rate_limited;                            /*!< Results skipped by the rate limit. */
+    uint32_t dropped;                                 /*!< Records dropped because the link could not take them. */
+} app_detect_export_stats_t;
+
+/**
+ * @brief Open the link detections are exported on, selected in menuconfig.
+ *
+ * @return ESP_OK on success or if the export is disabled, ESP_FAIL if the link could not be opened.
+ */
+esp_err_t app_detect_export_init(void);
+
+/**
+ * @brief Close the link, no record is published afterwards.
+ */
+void app_detect_export_deinit(void);
+
+/**
+ * @brief Serialize the detections of a frame and queue them on the link without blocking.
+ *
+ * Must only be called from one task. A record is skipped if the previous one is more recent than the
+ * rate limit allows, and dropped if the link can't take all of it, so a host never sees a partial record.
+ *
+ * In JSON lines format a record is one line, e.g.
+ * `{"t":123456,"seq":42,"face":1,"dets":[{"id":3,"face_id":0,"cat":0,"score":0.91,"box":[10,20,80,100],"kp":[...]}]}`.
+ * In binary format it is the sync word, the version, the detection count, the flags (bit 0 face mode, bit 1
+ * codes), the frame_seq as u32 and the timestamp as i64, followed per detection by track_id u16, face_id u16,
+ * category u8, score u8 (0-255), box as 4 x i16, keypoint count u8 and the keypoints as i16, and a CRC-16 of
+ * everything after the sync word. Multi-byte fields are little endian.
+ *
+ * @param result Detections, in camera frame coordinates.
+ * @param face Whether the results come from face detection.
+ *
+ * @return true if the record was queued.
+ */
+bool app_detect_export_publish(const camera_pipeline_detect_result_t *result, bool face);
+
+#if CONFIG_CAMERA_CODE_SCAN
+/**
+ * @brief Serialize the codes scanned in a frame and queue them on the link without blocking.
+ *
+ * Same rules as `app_detect_export_publish`. In JSON lines format a record is e.g.
+ * `{"t":123456,"seq":42,"codes":[{"type":"qr","box":[10,20,80,100],"text":"https://example.com"}]}`, the type is
+ * "qr", "ean13" or "code128". In binary format the header is the same with flags bit 1 set and the code count, each
+ * code is its type u8 (`app_code_scan_type_t`), box as 4 x i16, text length u8 and the text bytes.
+ *
+ * @param result Codes in camera frame coordinates, text in `code_text`.
+ *
+ * @return true if the record was queued.
+ */
+bool app_detect_export_publish_codes(const camera_pipeline_detect_result_t *result);
+#endif
+
+#if CONFIG_CAMERA_PEOPLE_COUNT
+/**
+ * @brief Serialize the counts of a closed minute and queue them on the link without blocking.
+ *
+ * Not rate limited, at most one record per minute. In JSON lines format a record is e.g.
+ * `{"t":123456,"minute":42,"lines":[[3,1]],"zones":[[2,2,8400,6100]]}`, each line is its in and out counts and each
+ * zone its enters, leaves, total and longest dwell time of the leaves in ms. In binary format the header is the same
+ * with flags bit 2 set, the line count in place of the detection count and the minute in place of the frame_seq,
+ * followed by the zone count u8, in and out as u16 per line, and enters u16, leaves u16, total dwell u32 and longest
+ * dwell u32 per zone.
+ *
+ * @param bucket Counts of the minute.
+ * @param line_num Number of counting lines.
+ * @param zone_num Number of dwell zones.
+ *
+ * @return true if the record was queued.
+ */
+bool app_detect_export_publish_counts(const app_people_count_bucket_t *bucket, uint8_t line_num, uint8_t zone_num);
+#endif
+
+/**
+ * @brief Get the export counters.
+ *
+ * @param stats Counters since init.
+ */
+void app_detect_export_get_stats(app_detect_export_stats_t *stats);
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "app_pedestrian_detect.h"
+#include "app_humanface_detect.h"
+#include "app_detect_models.hpp"
+
+static const char *TAG = "app_detect_models";
+
+static bool models_loaded = false;
+
+esp_err_t app_detect_models_load(void)
+{
+    if (models_loaded) {
+        return ESP_OK;
+    }
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    int64_t start_us = esp_timer_get_time();
+    if (!get_pedestrian_detect() || !get_humanface_detect()) {
+        ESP_LOGE(TAG, "Create detectors failed");
+        app_detect_models_unload(true);
+        return ESP_ERR_NO_MEM;
+    }
+    models_loaded = true;
+
+    ESP_LOGI(TAG, "Detectors loaded in %lld ms, %u KB PSRAM", (esp_timer_get_time() - start_us) / 1000,
+             (unsigned)((free_before - heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) / 1024));
+
+    return ESP_OK;
+}
+
+void app_detect_models_unload(bool force)
+{
+#if CONFIG_CAMERA_DETECT_MODELS_RESIDENT
+    if (!force) {
+        return;
+    }
+#endif
+    delete_pedestrian_detect();
+    delete_humanface_detect();
+    models_loaded = false;
+}
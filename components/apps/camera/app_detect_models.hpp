@@ -0,0 +1,28 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+/**
+ * @brief Load every detector model the Camera can switch between.
+ *
+ * Models that are already resident are not loaded again, so switching between pedestrian and face
+ * detection never touches flash or the heap.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if a model could not be created.
+ */
+esp_err_t app_detect_models_load(void);
+
+/**
+ * @brief Drop the detector models, they stay resident with CONFIG_CAMERA_DETECT_MODELS_RESIDENT.
+ *
+ * Must be called from the task that runs the detectors, after its last run.
+ *
+ * @param force Free the models even if they are resident.
+ */
+void app_detect_models_unload(bool force);
@@ -0,0 +1,234 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "app_detect_tracker.hpp"
+
+// Measurement noise of a detector coordinate, in pixels squared
+#define TRACKER_KF_MEASURE_VAR              (9.0f)
+// Acceleration noise, in (pixels per millisecond squared) squared
+#define TRACKER_KF_ACCEL_VAR                (1e-4f)
+// Velocity uncertainty of a new track, in (pixels per millisecond) squared
+#define TRACKER_KF_INIT_VEL_VAR             (0.25f)
+// Weight of the newest score in the track confidence, and confidence kept per missed run
+#define TRACKER_CONFIDENCE_ALPHA            (0.5f)
+#define TRACKER_CONFIDENCE_DECAY            (0.6f)
+#define TRACKER_HITS_MAX                    (255)
+
+static void kf_init(app_detect_kf_t *kf, float pos)
+{
+    kf->pos = pos;
+    kf->vel = 0;
+    kf->cov[0] = TRACKER_KF_MEASURE_VAR;
+    kf->cov[1] = 0;
+    kf->cov[2] = TRACKER_KF_INIT_VEL_VAR;
+}
+
+static void kf_predict(app_detect_kf_t *kf, float dt_ms)
+{
+    float dt2 = dt_ms * dt_ms;
+
+    kf->pos += kf->vel * dt_ms;
+    // P = F P F' + Q, white noise acceleration
+    kf->cov[0] += dt_ms * (2 * kf->cov[1] + dt_ms * kf->cov[2]) + TRACKER_KF_ACCEL_VAR * dt2 * dt2 / 4;
+    kf->cov[1] += dt_ms * kf->cov[2] + TRACKER_KF_ACCEL_VAR * dt2 * dt_ms / 2;
+    kf->cov[2] += TRACKER_KF_ACCEL_VAR * dt2;
+}
+
+static void kf_correct(app_detect_kf_t *kf, float measured)
+{
+    float innovation = measured - kf->pos;
+    float s = kf->cov[0] + TRACKER_KF_MEASURE_VAR;
+    float gain_pos = kf->cov[0] / s;
+    float gain_vel = kf->cov[1] / s;
+
+    kf->pos += gain_pos * innovation;
+    kf->vel += gain_vel * innovation;
+    kf->cov[2] -= gain_vel * kf->cov[1];
+    kf->cov[1] *= 1 - gain_pos;
+    kf->cov[0] *= 1 - gain_pos;
+}
+
+static float box_iou(const int *a, const int *b)
+{
+    int x1 = std::max(a[0], b[0]);
+    int y1 = std::max(a[1], b[1]);
+    int x2 = std::min(a[2], b[2]);
+    int y2 = std::min(a[3], b[3]);
+
+    if ((x2 <= x1) || (y2 <= y1)) {
+        return 0;
+    }
+
+    float inter = (float)(x2 - x1) * (y2 - y1);
+    float area_a = (float)(a[2] - a[0]) * (a[3] - a[1]);
+    float area_b = (float)(b[2] - b[0]) * (b[3] - b[1]);
+
+    return inter / (area_a + area_b - inter);
+}
+
+static void track_start(app_detect_tracker_t *tracker, app_detect_track_t *track, const camera_pipeline_detect_box_t *det,
+                        int64_t timestamp_us)
+{
+    memset(track, 0, sizeof(*track));
+    track->active = true;
+    track->hits = 1;
+    track->id = tracker->next_id++;
+    if (tracker->next_id == 0) {
+        tracker->next_id = 1;
+    }
+    track->confidence = det->score;
+    track->box = *det;
+    track->timestamp_us = timestamp_us;
+    for (int i = 0; i < 4; i++) {
+        kf_init(&track->kf_box[i], det->box[i]);
+    }
+    for (int i = 0; i < det->keypoint_num; i++) {
+        kf_init(&track->kf_keypoint[i], det->keypoint[i]);
+    }
+}
+
+static void track_correct(app_detect_track_t *track, const camera_pipeline_detect_box_t *det)
+{
+    for (int i = 0; i < 4; i++) {
+        kf_correct(&track->kf_box[i], det->box[i]);
+    }
+    for (int i = 0; i < det->keypoint_num; i++) {
+        // A detection may come with keypoints the track didn't have yet
+        if (i < track->box.keypoint_num) {
+            kf_correct(&track->kf_keypoint[i], det->keypoint[i]);
+        } else {
+            kf_init(&track->kf_keypoint[i], det->keypoint[i]);
+        }
+    }
+    track->box = *det;
+    track->confidence = TRACKER_CONFIDENCE_ALPHA * det->score + (1 - TRACKER_CONFIDENCE_ALPHA) * track->confidence;
+    track->hits = std::min(track->hits + 1, TRACKER_HITS_MAX);
+    track->missed = 0;
+}
+
+void app_detect_tracker_init(app_detect_tracker_t *tracker, float iou_threshold, uint8_t max_missed, uint8_t min_hits,
+                             uint32_t max_extrapolate_ms)
+{
+    tracker->iou_threshold = iou_threshold;
+    tracker->max_missed = max_missed;
+    tracker->min_hits = min_hits;
+    tracker->max_extrapolate_us = (int64_t)max_extrapolate_ms * 1000;
+    tracker->next_id = 1;
+    app_detect_tracker_reset(tracker);
+}
+
+void app_detect_tracker_reset(app_detect_tracker_t *tracker)
+{
+    memset(tracker->tracks, 0, sizeof(tracker->tracks));
+}
+
+void app_detect_tracker_update(app_detect_tracker_t *tracker, const camera_pipeline_detect_result_t *result)
+{
+    bool matched_track[CAMERA_PIPELINE_DETECT_RESULT_MAX] = {};
+    bool matched_det[CAMERA_PIPELINE_DETECT_RESULT_MAX] = {};
+    int predicted[CAMERA_PIPELINE_DETECT_RESULT_MAX][4];
+
+    // Bring every track to the capture time of the result, so detections are compared with where objects are now
+    for (int t = 0; t < CAMERA_PIPELINE_DETECT_RESULT_MAX; t++) {
+        app_detect_track_t *track = &tracker->tracks[t];
+        if (!track->active) {
+            continue;
+        }
+        float dt_ms = std::max<int64_t>(result->timestamp_us - track->timestamp_us, 0) / 1000.0f;
+        for (int i = 0; i < 4; i++) {
+            kf_predict(&track->kf_box[i], dt_ms);
+            predicted[t][i] = (int)track->kf_box[i].pos;
+        }
+        for (int i = 0; i < track->box.keypoint_num; i++) {
+            kf_predict(&track->kf_keypoint[i], dt_ms);
+        }
+        track->timestamp_us = std::max(track->timestamp_us, result->timestamp_us);
+    }
+
+    // Greedy association, the result lists are short enough that O(n^2) passes are cheapest
+    while (true) {
+        float best_iou = tracker->iou_threshold;
+        int best_track = -1;
+        int best_det = -1;
+
+        for (int t = 0; t < CAMERA_PIPELINE_DETECT_RESULT_MAX; t++) {
+            if (!tracker->tracks[t].active || matched_track[t]) {
+                continue;
+            }
+            for (uint32_t d = 0; d < result->num; d++) {
+                if (matched_det[d] || (result->boxes[d].category != tracker->tracks[t].box.category)) {
+                    continue;
+                }
+                float iou = box_iou(predicted[t], result->boxes[d].box);
+                if (iou > best_iou) {
+                    best_iou = iou;
+                    best_track = t;
+                    best_det = d;
+                }
+            }
+        }
+        if (best_track < 0) {
+            break;
+        }
+
+        track_correct(&tracker->tracks[best_track], &result->boxes[best_det]);
+        matched_track[best_track] = true;
+        matched_det[best_det] = true;
+    }
+
+    for (int t = 0; t < CAMERA_PIPELINE_DETECT_RESULT_MAX; t++) {
+        app_detect_track_t *track = &tracker->tracks[t];
+        if (!track->active || matched_track[t]) {
+            continue;
+        }
+        track->confidence *= TRACKER_CONFIDENCE_DECAY;
+        // A track that was never confirmed is dropped on its first miss
+        if ((++track->missed > tracker->max_missed) || (track->hits < tracker->min_hits)) {
+            track->active = false;
+        }
+    }
+
+    for (uint32_t d = 0; d < result->num; d++) {
+        if (matched_det[d]) {
+            continue;
+        }
+        for (int t = 0; t < CAMERA_PIPELINE_DETECT_RESULT_MAX; t++) {
+            if (!tracker->tracks[t].active) {
+                track_start(tracker, &tracker->tracks[t], &result->boxes[d], result->timestamp_us);
+                break;
+            }
+        }
+    }
+}
+
+void app_detect_tracker_predict(const app_detect_tracker_t *tracker, int64_t timestamp_us, camera_pipeline_detect_result_t *out)
+{
+    out->num = 0;
+    out->timestamp_us = timestamp_us;
+
+    for (int t = 0; t < CAMERA_PIPELINE_DETECT_RESULT_MAX; t++) {
+        const app_detect_track_t *track = &tracker->tracks[t];
+        if (!track->active || (track->hits < tracker->min_hits)) {
+            continue;
+        }
+
+        int64_t age_us = std::min(std::max<int64_t>(timestamp_us - track->timestamp_us, 0), tracker->max_extrapolate_us);
+        float dt_ms = age_us / 1000.0f;
+        camera_pipeline_detect_box_t *box = &out->boxes[out->num++];
+
+        *box = track->box;
+        box->score = track->confidence;
+        box->track_id = track->id;
+        for (int i = 0; i < 4; i++) {
+            box->box[i] = (int)(track->kf_box[i].pos + track->kf_box[i].vel * dt_ms);
+        }
+        for (int i = 0; i < box->keypoint_num; i++) {
+            box->keypoint[i] = (int)(track->kf_keypoint[i].pos + track->kf_keypoint[i].vel * dt_ms);
+        }
+    }
+}
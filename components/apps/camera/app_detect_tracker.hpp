@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "app_camera_pipeline.hpp"
+
+/**
+ * @brief Constant-velocity Kalman filter of one coordinate.
+ */
+typedef struct {
+    float pos;                                        /*!< Estimated position in pixels. */
+    float vel;                                        /*!< Estimated velocity in pixels per millisecond. */
+    float cov[3];                                     /*!< Covariance as pos/pos, pos/vel, vel/vel. */
+} app_detect_kf_t;
+
+/**
+ * @brief State of one tracked detection.
+ */
+typedef struct {
+    bool active;                                      /*!< Whether this slot holds a track. */
+    uint8_t missed;                                   /*!< Consecutive detection runs without a match. */
+    uint8_t hits;                                     /*!< Matched detection runs, saturating. */
+    uint16_t id;                                      /*!< Track ID, stable for the lifetime of the track. */
+    float confidence;                                 /*!< Smoothed detection score, decays while missed. */
+    camera_pipeline_detect_box_t box;                 /*!< Last measured detection. */
+    app_detect_kf_t kf_box[4];                        /*!< Filters of the box coordinates. */
+    app_detect_kf_t kf_keypoint[CAMERA_PIPELINE_DETECT_KEYPOINT_MAX]; /*!< Filters of the keypoint coordinates. */
+    int64_t timestamp_us;                             /*!< Capture time the filters were last advanced to. */
+} app_detect_track_t;
+
+/**
+ * @brief Multi-object tracker with stable IDs, used to smooth and move overlay boxes between detector runs.
+ */
+typedef struct {
+    app_detect_track_t tracks[CAMERA_PIPELINE_DETECT_RESULT_MAX]; /*!< Track slots. */
+    float iou_threshold;                              /*!< Minimum IoU to associate a detection with a track. */
+    uint8_t max_missed;                               /*!< Detection runs a track survives without a match. */
+    uint8_t min_hits;                                 /*!< Matched runs before a track is reported. */
+    uint16_t next_id;                                 /*!< ID of the next new track. */
+    int64_t max_extrapolate_us;                       /*!< Prediction horizon, boxes freeze beyond this age. */
+} app_detect_tracker_t;
+
+/**
+ * @brief Initialize a tracker.
+ *
+ * @param tracker Tracker to initialize.
+ * @param iou_threshold Minimum IoU to associate a detection with an existing track.
+ * @param max_missed Number of detection runs a track survives, and keeps being reported, without being matched.
+ * @param min_hits Number of matched detection runs before a new track is reported.
+ * @param max_extrapolate_ms Maximum age of a measurement that is still extrapolated.
+ */
+void app_detect_tracker_init(app_detect_tracker_t *tracker, float iou_threshold, uint8_t max_missed, uint8_t min_hits,
+                             uint32_t max_extrapolate_ms);
+
+/**
+ * @brief Drop all tracks.
+ *
+ * @param tracker Tracker to reset.
+ */
+void app_detect_tracker_reset(app_detect_tracker_t *tracker);
+
+/**
+ * @brief Feed a new detector result into the tracker.
+ *
+ * The filters of all tracks are advanced to the capture time of the result, then detections are greedily
+ * associated with the predicted boxes by IoU. Matched tracks correct their filters with the measurement,
+ * unmatched detections start new tracks with a new ID.
+ *
+ * @param tracker Tracker to update.
+ * @param result Detector result, `timestamp_us` must be the capture time of the analysed frame.
+ */
+void app_detect_tracker_update(app_detect_tracker_t *tracker, const camera_pipeline_detect_result_t *result);
+
+/**
+ * @brief Predict the tracked boxes at a given time.
+ *
+ * Only tracks with at least `min_hits` matches are reported. The reported `score` is the track confidence
+ * and `track_id` the track ID.
+ *
+ * @param tracker Tracker to query.
+ * @param timestamp_us Capture time of the frame the boxes will be drawn on.
+ * @param out Predicted result.
+ */
+void app_detect_tracker_predict(const app_detect_tracker_t *tracker, int64_t timestamp_us, camera_pipeline_detect_result_t *out);
@@ -0,0 +1,385 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "dl_model_base.hpp"
+#include "dl_image_preprocessor.hpp"
+#include "app_face_recognition.hpp"
+
+#define FACE_MODEL_PATH                     CONFIG_CAMERA_FACE_RECOGNITION_MODEL_PATH
+#define FACE_GALLERY_PATH                   CONFIG_CAMERA_FACE_RECOGNITION_GALLERY_PATH
+#define FACE_GALLERY_MAX                    (CONFIG_CAMERA_FACE_RECOGNITION_GALLERY_MAX)
+#define FACE_MATCH_THRESHOLD                (CONFIG_CAMERA_FACE_RECOGNITION_THRESHOLD / 100.0f)
+#define FACE_GALLERY_MAGIC                  (0x4c414746)    // "FGAL"
+#define FACE_GALLERY_VERSION                (1)
+// Rows are zero padded to this many bytes so they stay aligned for vector loads
+#define FACE_ROW_ALIGN                      (16)
+#define FACE_KEYPOINT_NUM                   (5)
+#define FACE_TEMPLATE_SIZE                  (112.0f)
+// MobileFaceNet style normalization to [-1, 1]
+#define FACE_INPUT_MEAN                     (127.5f)
+#define FACE_INPUT_STD                      (127.5f)
+#define FACE_QUANT_SCALE                    (127)
+
+#define FACE_ALIGN_UP(num, align)           (((num) + ((align) - 1)) & ~((align) - 1))
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t next_id;
+    uint32_t dim;
+    uint32_t count;
+} face_gallery_header_t;
+
+typedef struct {
+    uint16_t id;
+    char name[APP_FACE_RECOGNITION_NAME_LEN];
+} face_entry_t;
+
+static const char *TAG = "app_face_recognition";
+
+// ArcFace landmarks of a 112x112 face, in the MNP keypoint order: left eye, left mouth, nose, right eye, right mouth
+static const float face_template[FACE_KEYPOINT_NUM][2] = {
+    {38.2946f, 51.6963f}, {41.5493f, 92.3655f}, {56.0252f, 71.7366f}, {73.5318f, 51.5014f}, {70.7299f, 92.2041f},
+};
+
+static dl::Model *face_model = NULL;
+static dl::image::ImagePreprocessor *face_preprocessor = NULL;
+static uint8_t *face_aligned = NULL;
+static float *face_values = NULL;
+static int face_input_w = 0;
+static int face_input_h = 0;
+
+static face_entry_t *gallery_entries = NULL;
+static int8_t *gallery_matrix = NULL;
+static int8_t *gallery_query = NULL;
+static uint32_t gallery_count = 0;
+static uint32_t gallery_dim = 0;
+static uint32_t gallery_stride = 0;
+static uint16_t gallery_next_id = 1;
+
+static int32_t face_dot_s8(const int8_t *a, const int8_t *b, uint32_t len)
+{
+    int32_t acc[4] = {0, 0, 0, 0};
+
+    // `len` is a multiple of FACE_ROW_ALIGN, four independent accumulators keep the multiplier busy
+    for (uint32_t i = 0; i < len; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+
+    return acc[0] + acc[1] + acc[2] + acc[3];
+}
+
+static esp_err_t face_align(const dl::image::img_t &img, const std::vector<int> &keypoint)
+{
+    int bpp = (img.pix_type == dl::image::DL_IMAGE_PIX_TYPE_RGB888) ? 3 : 2;
+    float scale_x = face_input_w / FACE_TEMPLATE_SIZE;
+    float scale_y = face_input_h / FACE_TEMPLATE_SIZE;
+    float src_mean[2] = {0, 0};
+    float dst_mean[2] = {0, 0};
+    float num_a = 0, num_b = 0, den = 0;
+
+    ESP_RETURN_ON_FALSE(keypoint.size() >= FACE_KEYPOINT_NUM * 2, ESP_ERR_INVALID_ARG, TAG, "No keypoints");
+
+    for (int i = 0; i < FACE_KEYPOINT_NUM; i++) {
+        src_mean[0] += keypoint[i * 2] / (float)FACE_KEYPOINT_NUM;
+        src_mean[1] += keypoint[i * 2 + 1] / (float)FACE_KEYPOINT_NUM;
+        dst_mean[0] += face_template[i][0] * scale_x / FACE_KEYPOINT_NUM;
+        dst_mean[1] += face_template[i][1] * scale_y / FACE_KEYPOINT_NUM;
+    }
+    // Least squares similarity transform from the keypoints to the template
+    for (int i = 0; i < FACE_KEYPOINT_NUM; i++) {
+        float sx = keypoint[i * 2] - src_mean[0];
+        float sy = keypoint[i * 2 + 1] - src_mean[1];
+        float dx = face_template[i][0] * scale_x - dst_mean[0];
+        float dy = face_template[i][1] * scale_y - dst_mean[1];
+        num_a += sx * dx + sy * dy;
+        num_b += sx * dy - sy * dx;
+        den += sx * sx + sy * sy;
+    }
+    ESP_RETURN_ON_FALSE(den > 0, ESP_ERR_INVALID_ARG, TAG, "Degenerate keypoints");
+    float a = num_a / den;
+    float b = num_b / den;
+    float norm = a * a + b * b;
+    ESP_RETURN_ON_FALSE(norm > 0, ESP_ERR_INVALID_ARG, TAG, "Degenerate keypoints");
+
+    // Sample the inverse transform, whole pixels are copied so the preprocessor sees the camera byte order
+    float inv_a = a / norm;
+    float inv_b = b / norm;
+    for (int v = 0; v < face_input_h; v++) {
+        uint8_t *dst = face_aligned + v * face_input_w * bpp;
+        for (int u = 0; u < face_input_w; u++, dst += bpp) {
+            float du = u - dst_mean[0];
+            float dv = v - dst_mean[1];
+            int x = (int)lroundf(inv_a * du + inv_b * dv + src_mean[0]);
+            int y = (int)lroundf(-inv_b * du + inv_a * dv + src_mean[1]);
+            if ((x < 0) || (y < 0) || (x >= img.width) || (y >= img.height)) {
+                memset(dst, 0, bpp);
+            } else {
+                memcpy(dst, (const uint8_t *)img.data + (y * img.width + x) * bpp, bpp);
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t face_embed(const dl::image::img_t &img, const dl::detect::result_t &face, int8_t *embedding)
+{
+    ESP_RETURN_ON_FALSE(face_model, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_ERROR(face_align(img, face.keypoint), TAG, "Align face failed");
+
+    dl::image::img_t aligned;
+    aligned.data = face_aligned;
+    aligned.width = face_input_w;
+    aligned.height = face_input_h;
+    aligned.pix_type = img.pix_type;
+    face_preprocessor->preprocess(aligned);
+    face_model->run();
+
+    dl::TensorBase *output = face_model->get_outputs().begin()->second;
+    float scale = ldexpf(1.0f, output->exponent);
+    float *values = face_values;
+    float norm = 0;
+    for (uint32_t i = 0; i < gallery_dim; i++) {
+        switch (output->dtype) {
+        case dl::DATA_TYPE_INT8:
+            values[i] = ((const int8_t *)output->data)[i] * scale;
+            break;
+        case dl::DATA_TYPE_INT16:
+            values[i] = ((const int16_t *)output->data)[i] * scale;
+            break;
+        default:
+            values[i] = ((const float *)output->data)[i];
+            break;
+        }
+        norm += values[i] * values[i];
+    }
+    ESP_RETURN_ON_FALSE(norm > 0, ESP_FAIL, TAG, "Empty embedding");
+
+    // Unit length, so a dot product of two rows is their cosine similarity
+    norm = 1.0f / sqrtf(norm);
+    memset(embedding, 0, gallery_stride);
+    for (uint32_t i = 0; i < gallery_dim; i++) {
+        embedding[i] = (int8_t)lroundf(values[i] * norm * FACE_QUANT_SCALE);
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t gallery_save(void)
+{
+    face_gallery_header_t header = {
+        .magic = FACE_GALLERY_MAGIC,
+        .version = FACE_GALLERY_VERSION,
+        .next_id = gallery_next_id,
+        .dim = gallery_dim,
+        .count = gallery_count,
+    };
+    bool ok = true;
+
+    FILE *f = fopen(FACE_GALLERY_PATH, "wb");
+    ESP_RETURN_ON_FALSE(f, ESP_FAIL, TAG, "Open %s failed", FACE_GALLERY_PATH);
+    ok &= fwrite(&header, sizeof(header), 1, f) == 1;
+    ok &= fwrite(gallery_entries, sizeof(face_entry_t), gallery_count, f) == gallery_count;
+    for (uint32_t i = 0; ok && (i < gallery_count); i++) {
+        ok &= fwrite(gallery_matrix + i * gallery_stride, 1, gallery_dim, f) == gallery_dim;
+    }
+    ok &= fclose(f) == 0;
+
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+static void gallery_load(void)
+{
+    face_gallery_header_t header;
+    bool ok = true;
+
+    FILE *f = fopen(FACE_GALLERY_PATH, "rb");
+    if (!f) {
+        ESP_LOGI(TAG, "No gallery, starting empty");
+        return;
+    }
+    if ((fread(&header, sizeof(header), 1, f) != 1) || (header.magic != FACE_GALLERY_MAGIC) ||
+            (header.version != FACE_GALLERY_VERSION) || (header.dim != gallery_dim) || (header.count > FACE_GALLERY_MAX)) {
+        // Embeddings of another model can't be compared, the faces have to be enrolled again
+        ESP_LOGW(TAG, "Gallery doesn't match the model, ignored");
+        fclose(f);
+        return;
+    }
+    ok &= fread(gallery_entries, sizeof(face_entry_t), header.count, f) == header.count;
+    for (uint32_t i = 0; ok && (i < header.count); i++) {
+        ok &= fread(gallery_matrix + i * gallery_stride, 1, gallery_dim, f) == gallery_dim;
+    }
+    fclose(f);
+
+    if (ok) {
+        gallery_count = header.count;
+        gallery_next_id = header.next_id ? header.next_id : 1;
+        ESP_LOGI(TAG, "Loaded %" PRIu32 " faces", gallery_count);
+    } else {
+        ESP_LOGW(TAG, "Gallery truncated, ignored");
+    }
+}
+
+esp_err_t app_face_recognition_init(void)
+{
+    esp_err_t ret = ESP_OK;
+    struct stat st;
+
+    ESP_RETURN_ON_FALSE(face_model == NULL, ESP_OK, TAG, "Already initialized");
+    ESP_RETURN_ON_FALSE(stat(FACE_MODEL_PATH, &st) == 0, ESP_ERR_NOT_FOUND, TAG, "%s not found", FACE_MODEL_PATH);
+
+    face_model = new dl::Model(FACE_MODEL_PATH, fbs::MODEL_LOCATION_IN_SDCARD);
+#if CONFIG_IDF_TARGET_ESP32P4
+    // Same input convention as the detectors, the aligned crop keeps the camera byte order
+    face_preprocessor = new dl::image::ImagePreprocessor(face_model, {FACE_INPUT_MEAN, FACE_INPUT_MEAN, FACE_INPUT_MEAN},
+                                                         {FACE_INPUT_STD, FACE_INPUT_STD, FACE_INPUT_STD},
+                                                         DL_IMAGE_CAP_RGB_SWAP | DL_IMAGE_CAP_RGB565_BIG_ENDIAN);
+#else
+    face_preprocessor = new dl::image::ImagePreprocessor(face_model, {FACE_INPUT_MEAN, FACE_INPUT_MEAN, FACE_INPUT_MEAN},
+                                                         {FACE_INPUT_STD, FACE_INPUT_STD, FACE_INPUT_STD},
+                                                         DL_IMAGE_CAP_RGB_SWAP);
+#endif
+
+    // NHWC input, NC output
+    dl::TensorBase *input = face_model->get_inputs().begin()->second;
+    face_input_h = input->shape[1];
+    face_input_w = input->shape[2];
+    gallery_dim = face_model->get_outputs().begin()->second->get_size();
+    gallery_stride = FACE_ALIGN_UP(gallery_dim, FACE_ROW_ALIGN);
+
+    face_aligned = (uint8_t *)heap_caps_malloc(face_input_w * face_input_h * 3, MALLOC_CAP_SPIRAM);
+    face_values = (float *)heap_caps_malloc(gallery_dim * sizeof(float), MALLOC_CAP_INTERNAL);
+    gallery_entries = (face_entry_t *)heap_caps_calloc(FACE_GALLERY_MAX, sizeof(face_entry_t), MALLOC_CAP_SPIRAM);
+    // The query row is compared against every gallery row, keep it in internal RAM
+    gallery_query = (int8_t *)heap_caps_aligned_alloc(FACE_ROW_ALIGN, gallery_stride, MALLOC_CAP_INTERNAL);
+    gallery_matrix = (int8_t *)heap_caps_aligned_alloc(FACE_ROW_ALIGN, FACE_GALLERY_MAX * gallery_stride, MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(face_aligned && face_values && gallery_entries && gallery_query && gallery_matrix, ESP_ERR_NO_MEM, err, TAG,
+                      "Allocate gallery failed");
+
+    gallery_count = 0;
+    gallery_next_id = 1;
+    gallery_load();
+    ESP_LOGI(TAG, "Model input %dx%d, %" PRIu32 " dimensional embeddings", face_input_w, face_input_h, gallery_dim);
+
+    return ESP_OK;
+
+err:
+    app_face_recognition_deinit();
+    return ret;
+}
+
+void app_face_recognition_deinit(void)
+{
+    if (face_preprocessor) {
+        delete face_preprocessor;
+        face_preprocessor = NULL;
+    }
+    if (face_model) {
+        delete face_model;
+        face_model = NULL;
+    }
+    free(face_aligned);
+    face_aligned = NULL;
+    free(face_values);
+    face_values = NULL;
+    free(gallery_entries);
+    gallery_entries = NULL;
+    free(gallery_query);
+    gallery_query = NULL;
+    free(gallery_matrix);
+    gallery_matrix = NULL;
+    gallery_count = 0;
+}
+
+esp_err_t app_face_recognition_identify(const dl::image::img_t &img, const dl::detect::result_t &face, app_face_match_t *match)
+{
+    int32_t best = INT32_MIN;
+    int best_index = -1;
+
+    match->id = 0;
+    match->similarity = -1;
+    match->name = NULL;
+    ESP_RETURN_ON_ERROR(face_embed(img, face, gallery_query), TAG, "Embed face failed");
+
+    for (uint32_t i = 0; i < gallery_count; i++) {
+        int32_t dot = face_dot_s8(gallery_query, gallery_matrix + i * gallery_stride, gallery_stride);
+        if (dot > best) {
+            best = dot;
+            best_index = i;
+        }
+    }
+    if (best_index < 0) {
+        return ESP_OK;
+    }
+
+    match->similarity = (float)best / (FACE_QUANT_SCALE * FACE_QUANT_SCALE);
+    if (match->similarity >= FACE_MATCH_THRESHOLD) {
+        match->id = gallery_entries[best_index].id;
+        match->name = gallery_entries[best_index].name;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t app_face_recognition_enroll(const dl::image::img_t &img, const dl::detect::result_t &face, const char *name,
+                                      uint16_t *id)
+{
+    ESP_RETURN_ON_FALSE(face_model, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(gallery_count < FACE_GALLERY_MAX, ESP_ERR_NO_MEM, TAG, "Gallery full");
+    ESP_RETURN_ON_ERROR(face_embed(img, face, gallery_matrix + gallery_count * gallery_stride), TAG, "Embed face failed");
+
+    face_entry_t *entry = &gallery_entries[gallery_count++];
+    entry->id = gallery_next_id++;
+    if (gallery_next_id == 0) {
+        gallery_next_id = 1;
+    }
+    strlcpy(entry->name, name, sizeof(entry->name));
+    if (id) {
+        *id = entry->id;
+    }
+    ESP_LOGI(TAG, "Enrolled %s as %u", entry->name, entry->id);
+
+    return gallery_save();
+}
+
+esp_err_t app_face_recognition_remove(uint16_t id)
+{
+    ESP_RETURN_ON_FALSE(face_model, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    if (id == 0) {
+        gallery_count = 0;
+        return gallery_save();
+    }
+    for (uint32_t i = 0; i < gallery_count; i++) {
+        if (gallery_entries[i].id != id) {
+            continue;
+        }
+        // Move the last entry into the hole, the gallery order doesn't matter
+        gallery_count--;
+        gallery_entries[i] = gallery_entries[gallery_count];
+        memcpy(gallery_matrix + i * gallery_stride, gallery_matrix + gallery_count * gallery_stride, gallery_stride);
+        return gallery_save();
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+uint32_t app_face_recognition_count(void)
+{
+    return gallery_count;
+}
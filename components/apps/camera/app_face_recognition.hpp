@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "dl_detect_define.hpp"
+#include "dl_image_define.hpp"
+
+#define APP_FACE_RECOGNITION_NAME_LEN       (32)    /*!< Name capacity of a gallery entry, terminator included. */
+
+/**
+ * @brief Best gallery match of a face.
+ */
+typedef struct {
+    uint16_t id;                                      /*!< Gallery ID of the match, 0 if no entry is similar enough. */
+    float similarity;                                 /*!< Cosine similarity with the match, -1 to 1. */
+    const char *name;                                 /*!< Name of the match, valid until the gallery changes. */
+} app_face_match_t;
+
+/**
+ * @brief Load the embedding model and the gallery from the SD card.
+ *
+ * Must be called from the task that runs the detectors. A missing gallery file starts an empty gallery.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the model is missing, ESP_ERR_NO_MEM if allocation failed.
+ */
+esp_err_t app_face_recognition_init(void);
+
+/**
+ * @brief Free the model and the gallery, the gallery file is kept.
+ */
+void app_face_recognition_deinit(void);
+
+/**
+ * @brief Compute the embedding of a face and look it up in the gallery.
+ *
+ * @param img Image the face was detected in.
+ * @param face Detection with the 5 MNP keypoints, in `img` coordinates.
+ * @param match Best match.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the face has no keypoints, ESP_ERR_INVALID_STATE if not initialized.
+ */
+esp_err_t app_face_recognition_identify(const dl::image::img_t &img, const dl::detect::result_t &face, app_face_match_t *match);
+
+/**
+ * @brief Add a face to the gallery and save the gallery to the SD card.
+ *
+ * @param img Image the face was detected in.
+ * @param face Detection with the 5 MNP keypoints, in `img` coordinates.
+ * @param name Name of the person, truncated to APP_FACE_RECOGNITION_NAME_LEN - 1 characters.
+ * @param id Gallery ID of the new entry, may be NULL.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the gallery is full, ESP_FAIL if it could not be saved.
+ */
+esp_err_t app_face_recognition_enroll(const dl::image::img_t &img, const dl::detect::result_t &face, const char *name,
+                                      uint16_t *id);
+
+/**
+ * @brief Remove an entry from the gallery and save the gallery, 0 removes all entries.
+ *
+ * @param id Gallery ID.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such entry.
+ */
+esp_err_t app_face_recognition_remove(uint16_t id);
+
+/**
+ * @brief Get the number of gallery entries.
+ *
+ * @return Number of enrolled faces.
+ */
+uint32_t app_face_recognition_count(void);
@@ -6,29 +6,159 @@
 
 #include "esp_log.h"
 #include "iostream"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "human_face_detect.hpp"
 #include "dl_tool.hpp"
+#include "task_config/task_config.h"
 #include "app_humanface_detect.h"
 
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+typedef struct {
+    dl::image::img_t img;                           /*!< Frame the candidates were found in, valid until flushed. */
+    std::list<dl::detect::result_t> candidates;     /*!< MSR output, copied since MSR reuses its list. */
+    std::list<dl::detect::result_t> results;        /*!< MNP output, written by the worker. */
+    void *user_ctx;                                 /*!< Caller context of the frame. */
+} mnp_job_t;
+
+static const char *TAG = "app_humanface_detect";
+
+static TaskHandle_t mnp_task_handle = NULL;
+static SemaphoreHandle_t mnp_start_sem = NULL;
+static SemaphoreHandle_t mnp_done_sem = NULL;
+static volatile bool mnp_exit = false;
+static bool mnp_busy = false;
+static mnp_job_t mnp_job;
+static std::list<dl::detect::result_t> mnp_results;
+#endif
+
 static HumanFaceDetect *detect = NULL;
 
-std::list<dl::detect::result_t> app_humanface_detect(uint16_t *frame, int width, int height)
+std::list<dl::detect::result_t> &app_humanface_detect(uint16_t *frame, int width, int height, dl::image::pix_type_t pix_type)
 {
     dl::image::img_t img;
     img.data = frame;
     img.width = width;
     img.height = height;
-    img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+    img.pix_type = pix_type;
     
-    auto &detect_results = detect->run(img);
+    // The result list is owned by the detector and reused by the next run
+    return detect->run(img);
+}
+
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+static void mnp_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(mnp_start_sem, portMAX_DELAY);
+        if (mnp_exit) {
+            break;
+        }
+        mnp_job.results = detect->get_msrmnp()->run_mnp(mnp_job.img, mnp_job.candidates);
+        xSemaphoreGive(mnp_done_sem);
+    }
+
+    xSemaphoreGive(mnp_done_sem);
+    task_config_delete(TASK_CONFIG_CAMERA_FACE_MNP, NULL);
+}
+
+static void mnp_worker_start(void)
+{
+    mnp_start_sem = xSemaphoreCreateBinary();
+    mnp_done_sem = xSemaphoreCreateBinary();
+    mnp_exit = false;
+    if (mnp_start_sem && mnp_done_sem &&
+        task_config_create(TASK_CONFIG_CAMERA_FACE_MNP, mnp_task, NULL, &mnp_task_handle) == pdPASS) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "Create MNP worker failed, face detection stays on one core");
+    mnp_task_handle = NULL;
+    if (mnp_start_sem) {
+        vSemaphoreDelete(mnp_start_sem);
+        mnp_start_sem = NULL;
+    }
+    if (mnp_done_sem) {
+        vSemaphoreDelete(mnp_done_sem);
+        mnp_done_sem = NULL;
+    }
+}
+
+static void mnp_worker_stop(void)
+{
+    if (!mnp_task_handle) {
+        return;
+    }
+
+    void *done_ctx = NULL;
+    app_humanface_detect_flush(&done_ctx);
 
-    return detect_results;
+    mnp_exit = true;
+    xSemaphoreGive(mnp_start_sem);
+    xSemaphoreTake(mnp_done_sem, portMAX_DELAY);
+    mnp_task_handle = NULL;
+    vSemaphoreDelete(mnp_start_sem);
+    mnp_start_sem = NULL;
+    vSemaphoreDelete(mnp_done_sem);
+    mnp_done_sem = NULL;
+    mnp_job.candidates.clear();
+    mnp_job.results.clear();
+    mnp_results.clear();
 }
 
+std::list<dl::detect::result_t> &app_humanface_detect_pipelined(uint16_t *frame, int width, int height, void *user_ctx,
+                                                                void **done_ctx, dl::image::pix_type_t pix_type)
+{
+    dl::image::img_t img;
+    img.data = frame;
+    img.width = width;
+    img.height = height;
+    img.pix_type = pix_type;
+
+    if (!mnp_task_handle) {
+        *done_ctx = user_ctx;
+        return detect->run(img);
+    }
+
+    // MSR of this frame overlaps MNP of the previous one on the other core
+    std::list<dl::detect::result_t> &candidates = detect->get_msrmnp()->run_msr(img);
+    std::list<dl::detect::result_t> &results = app_humanface_detect_flush(done_ctx);
+
+    mnp_job.img = img;
+    mnp_job.candidates = candidates;
+    mnp_job.user_ctx = user_ctx;
+    mnp_busy = true;
+    xSemaphoreGive(mnp_start_sem);
+
+    return results;
+}
+
+std::list<dl::detect::result_t> &app_humanface_detect_flush(void **done_ctx)
+{
+    *done_ctx = NULL;
+    if (!mnp_busy) {
+        mnp_results.clear();
+        return mnp_results;
+    }
+
+    xSemaphoreTake(mnp_done_sem, portMAX_DELAY);
+    mnp_busy = false;
+    // The worker writes the next frame into the job while the caller reads these
+    mnp_results.swap(mnp_job.results);
+    *done_ctx = mnp_job.user_ctx;
+
+    return mnp_results;
+}
+#endif
+
 HumanFaceDetect *get_humanface_detect()
 {
     if (detect == NULL) {
         detect = new HumanFaceDetect();
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+        mnp_worker_start();
+#endif
     }
 
     return detect;
@@ -37,7 +167,10 @@ HumanFaceDetect *get_humanface_detect()
 void delete_humanface_detect()
 {
     if (detect) {
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+        mnp_worker_stop();
+#endif
         delete detect;
         detect = NULL;
     }
-}
\ No newline at end of file
+}
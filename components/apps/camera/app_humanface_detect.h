@@ -5,9 +5,37 @@
  */
 #pragma once
 
+#include "sdkconfig.h"
 #include "human_face_detect.hpp"
 
-std::list<dl::detect::result_t> app_humanface_detect(uint16_t *frame, int width, int height);
+std::list<dl::detect::result_t> &app_humanface_detect(uint16_t *frame, int width, int height,
+                                                      dl::image::pix_type_t pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565);
+
+#if CONFIG_CAMERA_FACE_DETECT_DUAL_CORE
+/**
+ * @brief Run MSR on a frame while MNP refines the previous frame on core 0.
+ *
+ * The frame must stay valid until the next call or app_humanface_detect_flush(). Falls back to a
+ * synchronous run of the frame if the MNP worker could not be created.
+ *
+ * @param user_ctx Context handed back with the results of this frame.
+ * @param done_ctx Set to the context of the frame the returned results belong to, NULL if none finished.
+ *
+ * @return Results of the previous frame, valid until the next call.
+ */
+std::list<dl::detect::result_t> &app_humanface_detect_pipelined(uint16_t *frame, int width, int height, void *user_ctx,
+                                                                void **done_ctx,
+                                                                dl::image::pix_type_t pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565);
+
+/**
+ * @brief Wait for the frame still in MNP.
+ *
+ * @param done_ctx Set to the context of that frame, NULL if none was in flight.
+ *
+ * @return Its results, valid until the next call.
+ */
+std::list<dl::detect::result_t> &app_humanface_detect_flush(void **done_ctx);
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,399 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "sdkconfig.h"
+
+#if CONFIG_CAMERA_ISP_TUNING_RELOAD
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+#include "linux/videodev2.h"
+#include "esp_video_device.h"
+#include "esp_video_isp_ioctl.h"
+#include "task_config/task_config.h"
+#include "app_isp_tuning.h"
+
+#define ISP_TUNING_PATH                     CONFIG_CAMERA_ISP_TUNING_PATH
+#define ISP_TUNING_POLL_MS                  CONFIG_CAMERA_ISP_TUNING_POLL_MS
+#define ISP_TUNING_FILE_MAX                 (64 * 1024)
+#define ISP_TUNING_SHARPEN_DECIMAL_ONE      (32)    // The sharpen coefficients have 5 fractional bits
+
+typedef enum {
+    ISP_TUNING_CCM = BIT(0),
+    ISP_TUNING_SATURATION = BIT(1),
+    ISP_TUNING_BF = BIT(2),
+    ISP_TUNING_DEMOSAIC = BIT(3),
+    ISP_TUNING_SHARPEN = BIT(4),
+    ISP_TUNING_CONTRAST = BIT(5),
+    ISP_TUNING_GAMMA = BIT(6),
+} isp_tuning_module_t;
+
+// Zeroed before parsing, so the padding doesn't make equal modules compare different
+typedef struct {
+    uint32_t valid;                         /*!< Modules found in the file */
+    esp_video_isp_ccm_t ccm;
+    esp_video_isp_bf_t bf;
+    esp_video_isp_demosaic_t demosaic;
+    esp_video_isp_sharpen_t sharpen;
+    esp_video_isp_gamma_t gamma;
+    int32_t saturation;
+    int32_t contrast;
+} isp_tuning_params_t;
+
+static const char *TAG = "app_isp_tuning";
+
+static int isp_tuning_fd = -1;
+static TaskHandle_t isp_tuning_task_handle = NULL;
+// The watch task stages, the stream task applies
+static portMUX_TYPE isp_tuning_lock = portMUX_INITIALIZER_UNLOCKED;
+static isp_tuning_params_t isp_tuning_staged;
+static uint32_t isp_tuning_pending = 0;
+// Only used by the watch task
+static isp_tuning_params_t isp_tuning_loaded;
+static isp_tuning_params_t isp_tuning_parsed;
+// Only used by the stream task
+static isp_tuning_params_t isp_tuning_apply;
+
+static const cJSON *isp_tuning_get(const cJSON *obj, const char *path)
+{
+    char key[32];
+
+    while (obj && *path) {
+        size_t len = strcspn(path, ".");
+
+        if (len >= sizeof(key)) {
+            return NULL;
+        }
+        memcpy(key, path, len);
+        key[len] = '\0';
+        obj = cJSON_GetObjectItemCaseSensitive(obj, key);
+        path += (path[len] == '.') ? len + 1 : len;
+    }
+
+    return obj;
+}
+
+static bool isp_tuning_get_number(const cJSON *obj, const char *path, double *value)
+{
+    const cJSON *item = isp_tuning_get(obj, path);
+
+    if (!cJSON_IsNumber(item)) {
+        return false;
+    }
+    *value = item->valuedouble;
+
+    return true;
+}
+
+static bool isp_tuning_get_numbers(const cJSON *obj, const char *path, double *values, int count)
+{
+    const cJSON *array = isp_tuning_get(obj, path);
+
+    if (!cJSON_IsArray(array) || (cJSON_GetArraySize(array) != count)) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        const cJSON *item = cJSON_GetArrayItem(array, i);
+
+        if (!cJSON_IsNumber(item)) {
+            return false;
+        }
+        values[i] = item->valuedouble;
+    }
+
+    return true;
+}
+
+// Tables are sorted by gain or color temperature, the first entry is the one for good light
+static const cJSON *isp_tuning_get_first(const cJSON *obj, const char *path)
+{
+    const cJSON *array = isp_tuning_get(obj, path);
+
+    return cJSON_IsArray(array) ? cJSON_GetArrayItem(array, 0) : NULL;
+}
+
+static uint8_t isp_tuning_to_u8(double value)
+{
+    return (uint8_t)fmin(fmax(lround(value), 0), UINT8_MAX);
+}
+
+static void isp_tuning_parse_acc(const cJSON *sensor, isp_tuning_params_t *params)
+{
+    const cJSON *entry = isp_tuning_get_first(sensor, "acc.ccm.table");
+    double values[ISP_CCM_DIMENSION * ISP_CCM_DIMENSION];
+    double value;
+
+    if (isp_tuning_get_numbers(entry, "matrix", values, ISP_CCM_DIMENSION * ISP_CCM_DIMENSION)) {
+        params->ccm.enable = true;
+        for (int i = 0; i < ISP_CCM_DIMENSION * ISP_CCM_DIMENSION; i++) {
+            params->ccm.matrix[i / ISP_CCM_DIMENSION][i % ISP_CCM_DIMENSION] = values[i];
+        }
+        params->valid |= ISP_TUNING_CCM;
+    }
+
+    entry = isp_tuning_get_first(sensor, "acc.saturation");
+    if (isp_tuning_get_number(entry, "value", &value)) {
+        params->saturation = isp_tuning_to_u8(value);
+        params->valid |= ISP_TUNING_SATURATION;
+    }
+}
+
+static void isp_tuning_parse_adn(const cJSON *sensor, isp_tuning_params_t *params)
+{
+    const cJSON *entry = isp_tuning_get_first(sensor, "adn.bf");
+    double values[ISP_BF_TEMPLATE_X_NUMS * ISP_BF_TEMPLATE_Y_NUMS];
+    double value;
+
+    if (isp_tuning_get_number(entry, "param.level", &value) &&
+            isp_tuning_get_numbers(entry, "param.matrix", values, ISP_BF_TEMPLATE_X_NUMS * ISP_BF_TEMPLATE_Y_NUMS)) {
+        params->bf.enable = true;
+        params->bf.level = isp_tuning_to_u8(value);
+        for (int i = 0; i < ISP_BF_TEMPLATE_X_NUMS * ISP_BF_TEMPLATE_Y_NUMS; i++) {
+            params->bf.matrix[i / ISP_BF_TEMPLATE_Y_NUMS][i % ISP_BF_TEMPLATE_Y_NUMS] = isp_tuning_to_u8(values[i]);
+        }
+        params->valid |= ISP_TUNING_BF;
+    }
+
+    entry = isp_tuning_get_first(sensor, "adn.demosaic");
+    if (isp_tuning_get_number(entry, "gradient_ratio", &value)) {
+        params->demosaic.enable = true;
+        params->demosaic.gradient_ratio = value;
+        params->valid |= ISP_TUNING_DEMOSAIC;
+    }
+}
+
+static void isp_tuning_parse_aen(const cJSON *sensor, isp_tuning_params_t *params)
+{
+    const cJSON *entry = isp_tuning_get_first(sensor, "aen.sharpen");
+    double values[ISP_SHARPEN_TEMPLATE_X_NUMS * ISP_SHARPEN_TEMPLATE_Y_NUMS];
+    double h_thresh, l_thresh, h_coeff, m_coeff;
+    double value;
+
+    if (isp_tuning_get_number(entry, "param.h_thresh", &h_thresh) &&
+            isp_tuning_get_number(entry, "param.l_thresh", &l_thresh) &&
+            isp_tuning_get_number(entry, "param.h_coeff", &h_coeff) &&
+            isp_tuning_get_number(entry, "param.m_coeff", &m_coeff) &&
+            isp_tuning_get_numbers(entry, "param.matrix", values,
+                                   ISP_SHARPEN_TEMPLATE_X_NUMS * ISP_SHARPEN_TEMPLATE_Y_NUMS)) {
+        long h_fixed = lround(fmax(h_coeff, 0) * ISP_TUNING_SHARPEN_DECIMAL_ONE);
+        long m_fixed = lround(fmax(m_coeff, 0) * ISP_TUNING_SHARPEN_DECIMAL_ONE);
+
+        params->sharpen.enable = true;
+        params->sharpen.h_thresh = isp_tuning_to_u8(h_thresh);
+        params->sharpen.l_thresh = isp_tuning_to_u8(l_thresh);
+        params->sharpen.h_coeff.integer = h_fixed / ISP_TUNING_SHARPEN_DECIMAL_ONE;
+        params->sharpen.h_coeff.decimal = h_fixed % ISP_TUNING_SHARPEN_DECIMAL_ONE;
+        params->sharpen.m_coeff.integer = m_fixed / ISP_TUNING_SHARPEN_DECIMAL_ONE;
+        params->sharpen.m_coeff.decimal = m_fixed % ISP_TUNING_SHARPEN_DECIMAL_ONE;
+        for (int i = 0; i < ISP_SHARPEN_TEMPLATE_X_NUMS * ISP_SHARPEN_TEMPLATE_Y_NUMS; i++) {
+            params->sharpen.matrix[i / ISP_SHARPEN_TEMPLATE_Y_NUMS][i % ISP_SHARPEN_TEMPLATE_Y_NUMS] =
+                isp_tuning_to_u8(values[i]);
+        }
+        params->valid |= ISP_TUNING_SHARPEN;
+    }
+
+    entry = isp_tuning_get_first(sensor, "aen.contrast");
+    if (isp_tuning_get_number(entry, "value", &value)) {
+        params->contrast = isp_tuning_to_u8(value);
+        params->valid |= ISP_TUNING_CONTRAST;
+    }
+
+    // Curves given as points instead of a gamma_param are left to the IPA
+    entry = isp_tuning_get_first(sensor, "aen.gamma.table");
+    if (cJSON_IsTrue(isp_tuning_get(sensor, "aen.gamma.use_gamma_param")) &&
+            isp_tuning_get_number(entry, "gamma_param", &value) && (value > 0)) {
+        params->gamma.enable = true;
+        // Evenly spaced points, the last one on the white level
+        for (int i = 0; i < ISP_GAMMA_CURVE_POINTS_NUM; i++) {
+            uint32_t x = MIN((i + 1) * (256 / ISP_GAMMA_CURVE_POINTS_NUM), 255);
+
+            params->gamma.points[i].x = x;
+            params->gamma.points[i].y = isp_tuning_to_u8(255.0 * pow(x / 255.0, value));
+        }
+        params->valid |= ISP_TUNING_GAMMA;
+    }
+}
+
+static esp_err_t isp_tuning_parse_file(isp_tuning_params_t *params)
+{
+    esp_err_t ret = ESP_OK;
+    char *text = NULL;
+    cJSON *root = NULL;
+    const cJSON *sensor = NULL;
+    FILE *file = fopen(ISP_TUNING_PATH, "r");
+    struct stat st;
+
+    ESP_RETURN_ON_FALSE(file, ESP_ERR_NOT_FOUND, TAG, "Open %s failed", ISP_TUNING_PATH);
+    ESP_GOTO_ON_FALSE((fstat(fileno(file), &st) == 0) && (st.st_size > 0) && (st.st_size <= ISP_TUNING_FILE_MAX),
+                      ESP_ERR_INVALID_SIZE, err, TAG, "Tuning file empty or too large");
+    text = heap_caps_malloc(st.st_size, MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(text, ESP_ERR_NO_MEM, err, TAG, "No memory for the tuning file");
+    ESP_GOTO_ON_FALSE(fread(text, 1, st.st_size, file) == (size_t)st.st_size, ESP_FAIL, err, TAG, "Read tuning file failed");
+
+    root = cJSON_ParseWithLength(text, st.st_size);
+    ESP_GOTO_ON_FALSE(root, ESP_ERR_INVALID_ARG, err, TAG, "Tuning file is not valid JSON");
+    // The parameters are in the object named after the sensor, next to the version
+    cJSON_ArrayForEach(sensor, root) {
+        if (cJSON_IsObject(sensor)) {
+            break;
+        }
+    }
+    ESP_GOTO_ON_FALSE(sensor, ESP_ERR_INVALID_ARG, err, TAG, "No sensor object in the tuning file");
+
+    memset(params, 0, sizeof(*params));
+    isp_tuning_parse_acc(sensor, params);
+    isp_tuning_parse_adn(sensor, params);
+    isp_tuning_parse_aen(sensor, params);
+
+err:
+    cJSON_Delete(root);
+    free(text);
+    fclose(file);
+
+    return ret;
+}
+
+static void isp_tuning_reload(void)
+{
+    uint32_t changed = 0;
+
+    if (isp_tuning_parse_file(&isp_tuning_parsed) != ESP_OK) {
+        return;
+    }
+
+#define ISP_TUNING_CHANGED(module, field) \
+    if ((isp_tuning_parsed.valid & (module)) && (!(isp_tuning_loaded.valid & (module)) || \
+            memcmp(&isp_tuning_parsed.field, &isp_tuning_loaded.field, sizeof(isp_tuning_parsed.field)))) { \
+        changed |= (module); \
+    }
+    ISP_TUNING_CHANGED(ISP_TUNING_CCM, ccm);
+    ISP_TUNING_CHANGED(ISP_TUNING_SATURATION, saturation);
+    ISP_TUNING_CHANGED(ISP_TUNING_BF, bf);
+    ISP_TUNING_CHANGED(ISP_TUNING_DEMOSAIC, demosaic);
+    ISP_TUNING_CHANGED(ISP_TUNING_SHARPEN, sharpen);
+    ISP_TUNING_CHANGED(ISP_TUNING_CONTRAST, contrast);
+    ISP_TUNING_CHANGED(ISP_TUNING_GAMMA, gamma);
+#undef ISP_TUNING_CHANGED
+
+    // Modules left out of the file keep their last values
+    isp_tuning_parsed.valid |= isp_tuning_loaded.valid;
+    isp_tuning_loaded = isp_tuning_parsed;
+    if (!changed) {
+        ESP_LOGI(TAG, "Tuning file saved without changes");
+        return;
+    }
+
+    portENTER_CRITICAL(&isp_tuning_lock);
+    isp_tuning_staged = isp_tuning_loaded;
+    isp_tuning_pending |= changed;
+    portEXIT_CRITICAL(&isp_tuning_lock);
+    ESP_LOGI(TAG, "Staged modules 0x%02" PRIx32, changed);
+}
+
+static void isp_tuning_task(void *arg)
+{
+    time_t last_mtime = 0;
+    off_t last_size = -1;
+
+    while (1) {
+        struct stat st;
+
+        // FAT keeps the modification time to 2 s, the size tells apart most saves within that
+        if ((stat(ISP_TUNING_PATH, &st) == 0) && ((st.st_mtime != last_mtime) || (st.st_size != last_size))) {
+            last_mtime = st.st_mtime;
+            last_size = st.st_size;
+            isp_tuning_reload();
+        }
+        vTaskDelay(pdMS_TO_TICKS(ISP_TUNING_POLL_MS));
+    }
+}
+
+static esp_err_t isp_tuning_set_ctrl(uint32_t id, int32_t value, void *data, uint32_t size)
+{
+    struct v4l2_ext_control control = {
+        .id = id,
+        .size = size,
+    };
+    struct v4l2_ext_controls controls = {
+        .ctrl_class = V4L2_CTRL_ID2CLASS(id),
+        .count = 1,
+        .controls = &control,
+    };
+
+    if (data) {
+        control.p_u8 = data;
+    } else {
+        control.value = value;
+    }
+
+    return (ioctl(isp_tuning_fd, VIDIOC_S_EXT_CTRLS, &controls) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t app_isp_tuning_init(void)
+{
+    if (isp_tuning_task_handle) {
+        return ESP_OK;
+    }
+
+    isp_tuning_fd = open(ESP_VIDEO_ISP1_DEVICE_NAME, O_RDWR);
+    ESP_RETURN_ON_FALSE(isp_tuning_fd >= 0, ESP_FAIL, TAG, "Open %s failed", ESP_VIDEO_ISP1_DEVICE_NAME);
+    if (task_config_create(TASK_CONFIG_CAMERA_ISP_TUNING, isp_tuning_task, NULL, &isp_tuning_task_handle) != pdPASS) {
+        close(isp_tuning_fd);
+        isp_tuning_fd = -1;
+        ESP_LOGE(TAG, "Create task failed");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Watching %s", ISP_TUNING_PATH);
+
+    return ESP_OK;
+}
+
+void app_isp_tuning_process_frame(void)
+{
+    uint32_t pending;
+    uint32_t failed = 0;
+
+    if (!__atomic_load_n(&isp_tuning_pending, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    portENTER_CRITICAL(&isp_tuning_lock);
+    pending = isp_tuning_pending;
+    isp_tuning_pending = 0;
+    isp_tuning_apply = isp_tuning_staged;
+    portEXIT_CRITICAL(&isp_tuning_lock);
+
+#define ISP_TUNING_APPLY(module, id, value, data) \
+    if ((pending & (module)) && (isp_tuning_set_ctrl((id), (value), (data), (data) ? sizeof(*(data)) : 0) != ESP_OK)) { \
+        failed |= (module); \
+    }
+    ISP_TUNING_APPLY(ISP_TUNING_CCM, V4L2_CID_USER_ESP_ISP_CCM, 0, &isp_tuning_apply.ccm);
+    ISP_TUNING_APPLY(ISP_TUNING_SATURATION, V4L2_CID_SATURATION, isp_tuning_apply.saturation, (uint8_t *)NULL);
+    ISP_TUNING_APPLY(ISP_TUNING_BF, V4L2_CID_USER_ESP_ISP_BF, 0, &isp_tuning_apply.bf);
+    ISP_TUNING_APPLY(ISP_TUNING_DEMOSAIC, V4L2_CID_USER_ESP_ISP_DEMOSAIC, 0, &isp_tuning_apply.demosaic);
+    ISP_TUNING_APPLY(ISP_TUNING_SHARPEN, V4L2_CID_USER_ESP_ISP_SHARPEN, 0, &isp_tuning_apply.sharpen);
+    ISP_TUNING_APPLY(ISP_TUNING_CONTRAST, V4L2_CID_CONTRAST, isp_tuning_apply.contrast, (uint8_t *)NULL);
+    ISP_TUNING_APPLY(ISP_TUNING_GAMMA, V4L2_CID_USER_ESP_ISP_GAMMA, 0, &isp_tuning_apply.gamma);
+#undef ISP_TUNING_APPLY
+
+    if (failed) {
+        ESP_LOGW(TAG, "Applied modules 0x%02" PRIx32 ", the ISP refused 0x%02" PRIx32, pending & ~failed, failed);
+    } else {
+        ESP_LOGI(TAG, "Applied modules 0x%02" PRIx32, pending);
+    }
+}
+#endif /* CONFIG_CAMERA_ISP_TUNING_RELOAD */
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_ISP_TUNING_H
+#define APP_ISP_TUNING_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_CAMERA_ISP_TUNING_RELOAD
+/**
+ * @brief Open the ISP device and start watching the tuning file on the SD card.
+ *
+ * The file has the layout of the IPA JSON configuration (e.g. sc2336_custom.json). Whenever it changes, it is parsed
+ * off the stream task and the ISP modules whose values changed are staged: the color correction matrix
+ * (acc.ccm.table), saturation (acc.saturation), bayer filter (adn.bf), demosaic (adn.demosaic), sharpen
+ * (aen.sharpen), contrast (aen.contrast) and the gamma curve (aen.gamma.table with gamma_param). Of the tables
+ * indexed by gain or color temperature the first entry is used. The AGC, AWB and IAN parameters only configure the
+ * IPA algorithms at init and are not reloaded, and modules the IPA adjusts keep the reloaded values until it
+ * adjusts them again.
+ *
+ * @return ESP_OK on success or if already initialized, ESP_FAIL if the ISP device can't be opened, ESP_ERR_NO_MEM.
+ */
+esp_err_t app_isp_tuning_init(void);
+
+/**
+ * @brief Apply the staged ISP parameters, if any, between two frames.
+ *
+ * Must be called from the video stream task, frames without staged parameters cost an atomic load.
+ */
+void app_isp_tuning_process_frame(void);
+#else
+static inline esp_err_t app_isp_tuning_init(void) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void app_isp_tuning_process_frame(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "app_latency_trace.h"
+
+#if CONFIG_CAMERA_LATENCY_TRACE
+
+#define TRACE_RING_SIZE                     (CONFIG_CAMERA_LATENCY_TRACE_RING_SIZE)
+#define TRACE_BUF_INDEX_MAX                 (16)
+
+typedef struct {
+    uint32_t seq;                               /*!< Sequence number of the frame, 0 for an empty record. */
+    int64_t stamp_us[APP_LATENCY_STAGE_MAX];    /*!< Time of each stage, 0 if not reached. */
+} trace_record_t;
+
+static const char *TAG = "app_latency";
+
+static const char *stage_names[APP_LATENCY_STAGE_MAX] = {
+    "dqbuf",
+    "feed_enqueue",
+    "infer_start",
+    "infer_end",
+    "result_dequeue",
+    "overlay",
+    "display_flush",
+    "qbuf",
+};
+
+static trace_record_t trace_ring[TRACE_RING_SIZE];
+static uint32_t frame_seq[TRACE_BUF_INDEX_MAX];
+static uint32_t next_seq = 1;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t dump_timer = NULL;
+
+static void trace_dump_timer_cb(void *arg)
+{
+    app_latency_trace_dump();
+}
+
+static int trace_cmp_u32(const void *a, const void *b)
+{
+    uint32_t va = *(const uint32_t *)a;
+    uint32_t vb = *(const uint32_t *)b;
+
+    return (va > vb) - (va < vb);
+}
+
+esp_err_t app_latency_trace_init(uint32_t dump_interval_ms)
+{
+    app_latency_trace_reset();
+
+    if ((dump_interval_ms == 0) || dump_timer) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = trace_dump_timer_cb,
+        .name = "latency_dump",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &dump_timer), TAG, "Create dump timer failed");
+
+    return esp_timer_start_periodic(dump_timer, (uint64_t)dump_interval_ms * 1000);
+}
+
+void app_latency_trace_begin(uint8_t buf_index)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (buf_index >= TRACE_BUF_INDEX_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    uint32_t seq = next_seq++;
+    if (next_seq == 0) {
+        next_seq = 1;
+    }
+    // The oldest frame of the ring is overwritten
+    trace_record_t *record = &trace_ring[seq % TRACE_RING_SIZE];
+    memset(record, 0, sizeof(*record));
+    record->seq = seq;
+    record->stamp_us[APP_LATENCY_STAGE_DQBUF] = now;
+    frame_seq[buf_index] = seq;
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+}
+
+uint32_t app_latency_trace_frame_seq(uint8_t buf_index)
+{
+    uint32_t seq = 0;
+
+    if (buf_index < TRACE_BUF_INDEX_MAX) {
+        portENTER_CRITICAL_SAFE(&trace_lock);
+        seq = frame_seq[buf_index];
+        portEXIT_CRITICAL_SAFE(&trace_lock);
+    }
+
+    return seq;
+}
+
+void app_latency_trace_mark(uint32_t seq, app_latency_stage_t stage)
+{
+    int64_t now = esp_timer_get_time();
+
+    if ((seq == 0) || (stage >= APP_LATENCY_STAGE_MAX)) {
+        return;
+    }
+
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    trace_record_t *record = &trace_ring[seq % TRACE_RING_SIZE];
+    if ((record->seq == seq) && (record->stamp_us[stage] == 0)) {
+        record->stamp_us[stage] = now;
+    }
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+}
+
+void app_latency_trace_mark_index(uint8_t buf_index, app_latency_stage_t stage)
+{
+    app_latency_trace_mark(app_latency_trace_frame_seq(buf_index), stage);
+}
+
+esp_err_t app_latency_trace_get_summary(app_latency_stage_t stage, app_latency_summary_t *summary)
+{
+    uint32_t samples[TRACE_RING_SIZE];
+    uint32_t count = 0;
+
+    ESP_RETURN_ON_FALSE((stage < APP_LATENCY_STAGE_MAX) && summary, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    // Records are copied one by one so the lock is never held for long
+    for (int i = 0; i < TRACE_RING_SIZE; i++) {
+        portENTER_CRITICAL(&trace_lock);
+        uint32_t seq = trace_ring[i].seq;
+        int64_t start = trace_ring[i].stamp_us[APP_LATENCY_STAGE_DQBUF];
+        int64_t stamp = trace_ring[i].stamp_us[stage];
+        portEXIT_CRITICAL(&trace_lock);
+        if ((seq != 0) && (start != 0) && (stamp >= start)) {
+            samples[count++] = (uint32_t)(stamp - start);
+        }
+    }
+
+    memset(summary, 0, sizeof(*summary));
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    qsort(samples, count, sizeof(samples[0]), trace_cmp_u32);
+    summary->count = count;
+    summary->p50_us = samples[(count - 1) * 50 / 100];
+    summary->p95_us = samples[(count - 1) * 95 / 100];
+    summary->p99_us = samples[(count - 1) * 99 / 100];
+    summary->max_us = samples[count - 1];
+
+    return ESP_OK;
+}
+
+void app_latency_trace_dump(void)
+{
+    app_latency_summary_t summary;
+
+    printf("Latency from DQBUF over the last %d frames (us):\n", TRACE_RING_SIZE);
+    printf("%-16s %6s %8s %8s %8s %8s\n", "stage", "count", "p50", "p95", "p99", "max");
+    for (int stage = APP_LATENCY_STAGE_FEED_ENQUEUE; stage < APP_LATENCY_STAGE_MAX; stage++) {
+        if (app_latency_trace_get_summary((app_latency_stage_t)stage, &summary) != ESP_OK) {
+            continue;
+        }
+        printf("%-16s %6lu %8lu %8lu %8lu %8lu\n", stage_names[stage], (unsigned long)summary.count,
+               (unsigned long)summary.p50_us, (unsigned long)summary.p95_us, (unsigned long)summary.p99_us,
+               (unsigned long)summary.max_us);
+    }
+}
+
+void app_latency_trace_reset(void)
+{
+    portENTER_CRITICAL_SAFE(&trace_lock);
+    memset(trace_ring, 0, sizeof(trace_ring));
+    memset(frame_seq, 0, sizeof(frame_seq));
+    portEXIT_CRITICAL_SAFE(&trace_lock);
+}
+
+#endif
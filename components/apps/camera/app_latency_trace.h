@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_LATENCY_TRACE_H
+#define APP_LATENCY_TRACE_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Pipeline stages timestamped for every traced frame.
+ */
+typedef enum {
+    APP_LATENCY_STAGE_DQBUF = 0,        /*!< Frame dequeued from the V4L2 driver, the reference of all other stages. */
+    APP_LATENCY_STAGE_FEED_ENQUEUE,     /*!< Frame handed to the detect feed pipeline. */
+    APP_LATENCY_STAGE_INFER_START,      /*!< Detector started on the frame. */
+    APP_LATENCY_STAGE_INFER_END,        /*!< Detector finished the frame. */
+    APP_LATENCY_STAGE_RESULT_DEQUEUE,   /*!< Result of the frame picked up by the stream task. */
+    APP_LATENCY_STAGE_OVERLAY,          /*!< Overlay drawn on the frame. */
+    APP_LATENCY_STAGE_DISPLAY_FLUSH,    /*!< Frame handed to the display. */
+    APP_LATENCY_STAGE_QBUF,             /*!< Frame queued back to the V4L2 driver. */
+    APP_LATENCY_STAGE_MAX,
+} app_latency_stage_t;
+
+/**
+ * @brief Latency of one stage relative to DQBUF, over the frames kept in the trace ring.
+ */
+typedef struct {
+    uint32_t count;                     /*!< Number of frames that reached the stage. */
+    uint32_t p50_us;                    /*!< Median latency. */
+    uint32_t p95_us;                    /*!< 95th percentile latency. */
+    uint32_t p99_us;                    /*!< 99th percentile latency. */
+    uint32_t max_us;                    /*!< Maximum latency. */
+} app_latency_summary_t;
+
+#if CONFIG_CAMERA_LATENCY_TRACE
+/**
+ * @brief Initialize the latency trace.
+ *
+ * @param dump_interval_ms Period of the automatic dump to the console, 0 to disable.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t app_latency_trace_init(uint32_t dump_interval_ms);
+
+/**
+ * @brief Start tracing a frame, stamps the DQBUF stage.
+ *
+ * @param buf_index V4L2 buffer index of the dequeued frame.
+ */
+void app_latency_trace_begin(uint8_t buf_index);
+
+/**
+ * @brief Get the trace sequence number of the frame currently held in a V4L2 buffer.
+ *
+ * @param buf_index V4L2 buffer index.
+ *
+ * @return Sequence number, 0 if none.
+ */
+uint32_t app_latency_trace_frame_seq(uint8_t buf_index);
+
+/**
+ * @brief Stamp a stage of a traced frame, ISR safe.
+ *
+ * Only the first stamp of each stage is kept. Frames that already left the trace ring are ignored.
+ *
+ * @param seq Sequence number of the frame.
+ * @param stage Stage to stamp.
+ */
+void app_latency_trace_mark(uint32_t seq, app_latency_stage_t stage);
+
+/**
+ * @brief Stamp a stage of the frame currently held in a V4L2 buffer.
+ *
+ * @param buf_index V4L2 buffer index.
+ * @param stage Stage to stamp.
+ */
+void app_latency_trace_mark_index(uint8_t buf_index, app_latency_stage_t stage);
+
+/**
+ * @brief Compute the latency percentiles of a stage.
+ *
+ * @param stage Stage to summarize.
+ * @param summary Output summary.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an invalid stage or NULL summary.
+ */
+esp_err_t app_latency_trace_get_summary(app_latency_stage_t stage, app_latency_summary_t *summary);
+
+/**
+ * @brief Print the summary of every stage to the console.
+ */
+void app_latency_trace_dump(void);
+
+/**
+ * @brief Drop all traced frames.
+ */
+void app_latency_trace_reset(void);
+#else
+static inline esp_err_t app_latency_trace_init(uint32_t dump_interval_ms) { return ESP_OK; }
+static inline void app_latency_trace_begin(uint8_t buf_index) {}
+static inline uint32_t app_latency_trace_frame_seq(uint8_t buf_index) { return 0; }
+static inline void app_latency_trace_mark(uint32_t seq, app_latency_stage_t stage) {}
+static inline void app_latency_trace_mark_index(uint8_t buf_index, app_latency_stage_t stage) {}
+static inline esp_err_t app_latency_trace_get_summary(app_latency_stage_t stage, app_latency_summary_t *summary) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void app_latency_trace_dump(void) {}
+static inline void app_latency_trace_reset(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
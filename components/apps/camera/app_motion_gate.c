@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "esp_heap_caps.h"
+#include "app_motion_gate.h"
+
+#define MOTION_GATE_STEP                    (2)     // Luma is sampled on every second pixel of every second line
+#define MOTION_GATE_BLOCK                   (8)     // Block side in luma samples
+#define MOTION_GATE_MARGIN                  (1)     // Blocks added around the moving region
+
+static uint8_t motion_gate_luma(const uint8_t *line, uint32_t x, bool rgb888)
+{
+    uint32_t r, g, b;
+
+    if (rgb888) {
+        const uint8_t *pixel = line + x * 3;
+        b = pixel[0];
+        g = pixel[1];
+        r = pixel[2];
+    } else {
+        uint16_t pixel = ((const uint16_t *)line)[x];
+        r = (pixel >> 11) & 0x1f;
+        g = (pixel >> 5) & 0x3f;
+        b = pixel & 0x1f;
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+    }
+
+    return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+esp_err_t app_motion_gate_init(app_motion_gate_t *gate, uint32_t max_width, uint32_t max_height)
+{
+    memset(gate, 0, sizeof(*gate));
+    gate->luma_size = (max_width / MOTION_GATE_STEP) * (max_height / MOTION_GATE_STEP);
+    // Read and written once per analysed frame, keep it out of PSRAM
+    gate->luma = (uint8_t *)heap_caps_malloc(gate->luma_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!gate->luma) {
+        gate->luma = (uint8_t *)heap_caps_malloc(gate->luma_size, MALLOC_CAP_SPIRAM);
+    }
+
+    return gate->luma ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void app_motion_gate_deinit(app_motion_gate_t *gate)
+{
+    free(gate->luma);
+    memset(gate, 0, sizeof(*gate));
+}
+
+void app_motion_gate_reset(app_motion_gate_t *gate)
+{
+    gate->luma_w = 0;
+    gate->luma_h = 0;
+}
+
+bool app_motion_gate_process(app_motion_gate_t *gate, const void *frame, uint32_t width, uint32_t height, bool rgb888,
+                             uint8_t threshold, app_motion_rect_t *roi)
+{
+    uint32_t luma_w = width / MOTION_GATE_STEP;
+    uint32_t luma_h = height / MOTION_GATE_STEP;
+    size_t line_bytes = width * (rgb888 ? 3 : 2);
+    bool fresh = (gate->luma_w != luma_w) || (gate->luma_h != luma_h);
+    int min_bx = -1, max_bx = -1, min_by = -1, max_by = -1;
+
+    if (luma_w * luma_h > gate->luma_size) {
+        fresh = true;
+        luma_h = gate->luma_size / (luma_w ? luma_w : 1);
+    }
+
+    for (uint32_t by = 0; by * MOTION_GATE_BLOCK < luma_h; by++) {
+        uint32_t y_end = (by + 1) * MOTION_GATE_BLOCK;
+        y_end = (y_end < luma_h) ? y_end : luma_h;
+
+        for (uint32_t bx = 0; bx * MOTION_GATE_BLOCK < luma_w; bx++) {
+            uint32_t x_end = (bx + 1) * MOTION_GATE_BLOCK;
+            x_end = (x_end < luma_w) ? x_end : luma_w;
+            uint32_t sad = 0;
+            uint32_t samples = 0;
+
+            for (uint32_t ly = by * MOTION_GATE_BLOCK; ly < y_end; ly++) {
+                const uint8_t *line = (const uint8_t *)frame + ly * MOTION_GATE_STEP * line_bytes;
+                uint8_t *ref = gate->luma + ly * luma_w;
+
+                for (uint32_t lx = bx * MOTION_GATE_BLOCK; lx < x_end; lx++) {
+                    uint8_t luma = motion_gate_luma(line, lx * MOTION_GATE_STEP, rgb888);
+                    sad += abs((int)luma - ref[lx]);
+                    ref[lx] = luma;
+                    samples++;
+                }
+            }
+
+            if (sad > threshold * samples) {
+                min_bx = (min_bx < 0) ? (int)bx : min_bx;
+                max_bx = ((int)bx > max_bx) ? (int)bx : max_bx;
+                min_by = (min_by < 0) ? (int)by : min_by;
+                max_by = (int)by;
+            }
+        }
+    }
+
+    gate->luma_w = luma_w;
+    gate->luma_h = luma_h;
+    if (fresh) {
+        *roi = (app_motion_rect_t){0, 0, width, height};
+        return true;
+    }
+    if (min_bx < 0) {
+        return false;
+    }
+
+    // Back from blocks to frame pixels, with a margin so objects entering the region aren't cut
+    const int block_px = MOTION_GATE_BLOCK * MOTION_GATE_STEP;
+    int x0 = (min_bx - MOTION_GATE_MARGIN) * block_px;
+    int y0 = (min_by - MOTION_GATE_MARGIN) * block_px;
+    int x1 = (max_bx + 1 + MOTION_GATE_MARGIN) * block_px;
+    int y1 = (max_by + 1 + MOTION_GATE_MARGIN) * block_px;
+    x0 = (x0 > 0) ? x0 : 0;
+    y0 = (y0 > 0) ? y0 : 0;
+    x1 = (x1 < (int)width) ? x1 : (int)width;
+    y1 = (y1 < (int)height) ? y1 : (int)height;
+    *roi = (app_motion_rect_t){x0, y0, x1 - x0, y1 - y0};
+
+    return true;
+}
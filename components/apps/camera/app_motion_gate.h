@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_MOTION_GATE_H
+#define APP_MOTION_GATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Rectangle in pixels of the frames passed to the gate.
+ */
+typedef struct {
+    uint16_t x;                     /*!< Left edge. */
+    uint16_t y;                     /*!< Top edge. */
+    uint16_t w;                     /*!< Width. */
+    uint16_t h;                     /*!< Height. */
+} app_motion_rect_t;
+
+/**
+ * @brief Motion gate state, compares each frame with the previous one.
+ */
+typedef struct {
+    uint8_t *luma;                  /*!< Subsampled luma plane of the previous frame. */
+    uint32_t luma_size;             /*!< Capacity of `luma`. */
+    uint16_t luma_w;                /*!< Width of the stored plane, 0 if there is none. */
+    uint16_t luma_h;                /*!< Height of the stored plane. */
+} app_motion_gate_t;
+
+/**
+ * @brief Initialize a gate for frames up to the given size.
+ *
+ * @param gate Gate to initialize.
+ * @param max_width Largest frame width that will be processed.
+ * @param max_height Largest frame height that will be processed.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the luma plane could not be allocated.
+ */
+esp_err_t app_motion_gate_init(app_motion_gate_t *gate, uint32_t max_width, uint32_t max_height);
+
+/**
+ * @brief Free the luma plane of a gate.
+ *
+ * @param gate Gate to deinitialize.
+ */
+void app_motion_gate_deinit(app_motion_gate_t *gate);
+
+/**
+ * @brief Forget the previous frame, the next one counts as motion over the whole frame.
+ *
+ * @param gate Gate to reset.
+ */
+void app_motion_gate_reset(app_motion_gate_t *gate);
+
+/**
+ * @brief Compare a frame with the previous one block by block.
+ *
+ * A block moved if the mean absolute luma difference (SAD divided by the samples) exceeds the threshold.
+ * The frame becomes the reference of the next call.
+ *
+ * @param gate Gate.
+ * @param frame RGB565 or RGB888 pixels.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param rgb888 Whether the frame is RGB888 instead of RGB565.
+ * @param threshold Mean absolute luma difference of a moving block, 0-255.
+ * @param roi Set to the bounding box of the moving blocks plus a block of margin, or to the whole frame
+ *            if there is no previous frame of the same size.
+ *
+ * @return true if anything moved.
+ */
+bool app_motion_gate_process(app_motion_gate_t *gate, const void *frame, uint32_t width, uint32_t height, bool rgb888,
+                             uint8_t threshold, app_motion_rect_t *roi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "sdkconfig.h"
+#include "app_overlay.hpp"
+
+#define OVERLAY_BOX_COLOR                   (0xF800)
+#define OVERLAY_POINT_COLOR                 (0x07E0)
+#define OVERLAY_BOX_THICKNESS               (3)
+
+static void fill_span(uint16_t *dst, int len, uint16_t color)
+{
+    // Head until the destination is 16-byte aligned
+    while ((len > 0) && ((uintptr_t)dst & 0xF)) {
+        *dst++ = color;
+        len--;
+    }
+
+#if CONFIG_IDF_TARGET_ESP32P4 && CONFIG_CAMERA_OVERLAY_PIE
+    int blocks = len >> 3;
+    if (blocks > 0) {
+        // Broadcast the color into q0, then store 8 pixels per instruction
+        asm volatile(
+            "esp.vldbc.16.ip q0, %[color], 0    \n"
+            "1:                                 \n"
+            "esp.vst.128.ip q0, %[dst], 16      \n"
+            "addi %[blocks], %[blocks], -1      \n"
+            "bnez %[blocks], 1b                 \n"
+            : [dst] "+r"(dst), [blocks] "+r"(blocks)
+            : [color] "r"(&color)
+            : "memory"
+        );
+        len &= 7;
+    }
+#else
+    uint32_t pattern32 = ((uint32_t)color << 16) | color;
+    uint64_t pattern = ((uint64_t)pattern32 << 32) | pattern32;
+    uint64_t *dst64 = (uint64_t *)dst;
+    for (int blocks = len >> 2; blocks > 0; blocks--) {
+        *dst64++ = pattern;
+    }
+    dst = (uint16_t *)dst64;
+    len &= 3;
+#endif
+
+    while (len-- > 0) {
+        *dst++ = color;
+    }
+}
+
+static void fill_rect_clipped(uint16_t *buffer, int width, int x1, int y1, int x2, int y2, uint16_t color)
+{
+    int len = x2 - x1 + 1;
+    uint16_t *row = buffer + y1 * width + x1;
+
+    for (int y = y1; y <= y2; y++, row += width) {
+        fill_span(row, len, color);
+    }
+}
+
+static void fill_rect(uint16_t *buffer, int width, int height, int x1, int y1, int x2, int y2, uint16_t color)
+{
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, width - 1);
+    y2 = std::min(y2, height - 1);
+    if ((x1 > x2) || (y1 > y2)) {
+        return;
+    }
+    fill_rect_clipped(buffer, width, x1, y1, x2, y2, color);
+}
+
+void app_overlay_draw_rect(uint16_t *buffer, int width, int height, int x1, int y1, int x2, int y2, uint16_t color, int thickness)
+{
+    if ((x1 > x2) || (y1 > y2) || (thickness <= 0)) {
+        return;
+    }
+
+    // Top, bottom, then the left and right edges between them
+    fill_rect(buffer, width, height, x1, y1, x2, std::min(y1 + thickness - 1, y2), color);
+    fill_rect(buffer, width, height, x1, std::max(y2 - thickness + 1, y1), x2, y2, color);
+    if (y2 - y1 + 1 > 2 * thickness) {
+        fill_rect(buffer, width, height, x1, y1 + thickness, std::min(x1 + thickness - 1, x2), y2 - thickness, color);
+        fill_rect(buffer, width, height, std::max(x2 - thickness + 1, x1), y1 + thickness, x2, y2 - thickness, color);
+    }
+}
+
+void app_overlay_draw_points(uint16_t *buffer, int width, int height, const int *points, int point_num, uint16_t color, int radius)
+{
+    for (int i = 0; i < point_num; i++) {
+        int x = points[2 * i];
+        int y = points[2 * i + 1];
+
+        fill_rect(buffer, width, height, x - radius, y - radius, x + radius, y + radius, color);
+    }
+}
+
+void app_overlay_draw_result(uint16_t *buffer, int width, int height, const camera_pipeline_detect_result_t *result, bool draw_keypoints)
+{
+    for (uint32_t i = 0; i < result->num; i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+
+        app_overlay_draw_rect(buffer, width, height, box->box[0], box->box[1], box->box[2], box->box[3],
+                              OVERLAY_BOX_COLOR, OVERLAY_BOX_THICKNESS);
+        if (draw_keypoints) {
+            app_overlay_draw_points(buffer, width, height, box->keypoint, box->keypoint_num / 2,
+                                    OVERLAY_POINT_COLOR, APP_OVERLAY_KEYPOINT_RADIUS);
+        }
+    }
+}
+
+void app_overlay_layer_create(app_overlay_layer_t *layer, lv_obj_t *parent)
+{
+    for (int i = 0; i < CAMERA_PIPELINE_DETECT_RESULT_MAX; i++) {
+        lv_obj_t *box = lv_obj_create(parent);
+        lv_obj_remove_style_all(box);
+        lv_obj_set_style_border_color(box, lv_color_hex(0xFF0000), 0);
+        lv_obj_set_style_border_width(box, OVERLAY_BOX_THICKNESS, 0);
+        lv_obj_set_style_border_opa(box, LV_OPA_COVER, 0);
+        lv_obj_clear_flag(box, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+        lv_obj_add_flag(box, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_IGNORE_LAYOUT);
+        layer->boxes[i] = box;
+
+        for (int j = 0; j < CAMERA_PIPELINE_DETECT_KEYPOINT_MAX / 2; j++) {
+            lv_obj_t *point = lv_obj_create(parent);
+            lv_obj_remove_style_all(point);
+            lv_obj_set_size(point, APP_OVERLAY_KEYPOINT_RADIUS * 2 + 1, APP_OVERLAY_KEYPOINT_RADIUS * 2 + 1);
+            lv_obj_set_style_bg_color(point, lv_color_hex(0x00FF00), 0);
+            lv_obj_set_style_bg_opa(point, LV_OPA_COVER, 0);
+            lv_obj_clear_flag(point, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+            lv_obj_add_flag(point, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_IGNORE_LAYOUT);
+            layer->points[i][j] = point;
+        }
+    }
+}
+
+void app_overlay_layer_update(app_overlay_layer_t *layer, const camera_pipeline_detect_result_t *result, bool draw_keypoints)
+{
+    uint32_t num = result ? result->num : 0;
+
+    for (uint32_t i = 0; i < CAMERA_PIPELINE_DETECT_RESULT_MAX; i++) {
+        if (!layer->boxes[i]) {
+            return;
+        }
+
+        int point_num = 0;
+        if (i < num) {
+            const camera_pipeline_detect_box_t *box = &result->boxes[i];
+
+            lv_obj_set_pos(layer->boxes[i], box->box[0], box->box[1]);
+            lv_obj_set_size(layer->boxes[i], box->box[2] - box->box[0] + 1, box->box[3] - box->box[1] + 1);
+            lv_obj_clear_flag(layer->boxes[i], LV_OBJ_FLAG_HIDDEN);
+
+            point_num = draw_keypoints ? box->keypoint_num / 2 : 0;
+            for (int j = 0; j < point_num; j++) {
+                lv_obj_set_pos(layer->points[i][j], box->keypoint[2 * j] - APP_OVERLAY_KEYPOINT_RADIUS,
+                               box->keypoint[2 * j + 1] - APP_OVERLAY_KEYPOINT_RADIUS);
+                lv_obj_clear_flag(layer->points[i][j], LV_OBJ_FLAG_HIDDEN);
+            }
+        } else {
+            lv_obj_add_flag(layer->boxes[i], LV_OBJ_FLAG_HIDDEN);
+        }
+
+        for (int j = point_num; j < CAMERA_PIPELINE_DETECT_KEYPOINT_MAX / 2; j++) {
+            lv_obj_add_flag(layer->points[i][j], LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+}
+
+void app_overlay_layer_reset(app_overlay_layer_t *layer)
+{
+    memset(layer, 0, sizeof(*layer));
+}
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "lvgl.h"
+#include "app_camera_pipeline.hpp"
+
+#define APP_OVERLAY_KEYPOINT_RADIUS         (3)
+
+/**
+ * @brief Draw a rectangle outline into an RGB565 frame.
+ *
+ * The rectangle is clipped against the frame once, then every row is filled as a horizontal span
+ * (128-bit PIE stores on ESP32-P4), so the cost only depends on the clipped perimeter.
+ *
+ * @param buffer RGB565 frame.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param x1 Left edge.
+ * @param y1 Top edge.
+ * @param x2 Right edge (inclusive).
+ * @param y2 Bottom edge (inclusive).
+ * @param color RGB565 color.
+ * @param thickness Outline thickness in pixels.
+ */
+void app_overlay_draw_rect(uint16_t *buffer, int width, int height, int x1, int y1, int x2, int y2, uint16_t color, int thickness);
+
+/**
+ * @brief Draw filled square points into an RGB565 frame.
+ *
+ * @param buffer RGB565 frame.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param points Point coordinates as x/y pairs.
+ * @param point_num Number of points.
+ * @param color RGB565 color.
+ * @param radius Half side of each point in pixels.
+ */
+void app_overlay_draw_points(uint16_t *buffer, int width, int height, const int *points, int point_num, uint16_t color, int radius);
+
+/**
+ * @brief Draw a detection result into an RGB565 frame.
+ *
+ * @param buffer RGB565 frame.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param result Detections to draw.
+ * @param draw_keypoints Whether to draw the keypoints of each detection.
+ */
+void app_overlay_draw_result(uint16_t *buffer, int width, int height, const camera_pipeline_detect_result_t *result, bool draw_keypoints);
+
+/**
+ * @brief Overlay layer rendering detections with LVGL objects on top of the preview, leaving the frame untouched.
+ */
+typedef struct {
+    lv_obj_t *boxes[CAMERA_PIPELINE_DETECT_RESULT_MAX];                                           /*!< Box outline objects. */
+    lv_obj_t *points[CAMERA_PIPELINE_DETECT_RESULT_MAX][CAMERA_PIPELINE_DETECT_KEYPOINT_MAX / 2]; /*!< Keypoint objects. */
+} app_overlay_layer_t;
+
+/**
+ * @brief Create the overlay objects, all hidden.
+ *
+ * Must be called from the LVGL task. Coordinates passed to `app_overlay_layer_update` are relative to `parent`.
+ *
+ * @param layer Layer to create.
+ * @param parent Object the overlay is drawn on, usually the preview canvas.
+ */
+void app_overlay_layer_create(app_overlay_layer_t *layer, lv_obj_t *parent);
+
+/**
+ * @brief Show a detection result, hiding unused objects.
+ *
+ * Must be called from the LVGL task.
+ *
+ * @param layer Layer to update.
+ * @param result Detections to show, NULL hides everything.
+ * @param draw_keypoints Whether to show the keypoints of each detection.
+ */
+void app_overlay_layer_update(app_overlay_layer_t *layer, const camera_pipeline_detect_result_t *result, bool draw_keypoints);
+
+/**
+ * @brief Forget the overlay objects. They are owned by their parent and deleted with it.
+ *
+ * @param layer Layer to reset.
+ */
+void app_overlay_layer_reset(app_overlay_layer_t *layer);
@@ -10,7 +10,8 @@
 #define EXAMPLE_DETECT_RES                   (224)
 #define EXAMPLE_DETECT_PX_FORMAT             (24)
 
-std::list<dl::detect::result_t> app_pedestrian_detect(uint16_t *frame, int width, int height);
+std::list<dl::detect::result_t> &app_pedestrian_detect(uint16_t *frame, int width, int height,
+                                                        dl::image::pix_type_t pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565);
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +24,8 @@ void draw_rectangle_rgb(uint16_t *buffer, int width, int height, int x1, int y1,
 
 void draw_green_points(uint16_t *buffer, const std::vector<int> &landmarks);
 
+void draw_green_points_array(uint16_t *buffer, const int *landmarks, int landmark_num);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,259 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "app_people_count.hpp"
+
+// Detector runs a centroid survives without a match, longer than the tracker so a track ID coming back is kept
+#define PEOPLE_COUNT_MAX_MISSED             (5)
+#define PEOPLE_COUNT_MINUTE_US              (60 * 1000 * 1000LL)
+
+// Parse up to `max` entries of `x1 y1 x2 y2` in percent, scaled to the frame
+static esp_err_t parse_list(const char *list, uint32_t frame_w, uint32_t frame_h, int16_t (*out)[4], int max,
+                            uint8_t *num)
+{
+    const char *p = list ? list : "";
+
+    *num = 0;
+    while (*p) {
+        long value[4];
+        char *end = NULL;
+
+        for (int i = 0; i < 4; i++) {
+            value[i] = strtol(p, &end, 10);
+            if ((end == p) || (value[i] < 0) || (value[i] > 100)) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            p = end;
+        }
+        p += strspn(p, " ");
+        if ((*p != ';') && (*p != '\0')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (*p == ';') {
+            p++;
+        }
+        if (*num == max) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int i = 0; i < 4; i++) {
+            out[*num][i] = value[i] * (int32_t)((i % 2) ? frame_h : frame_w) / 100;
+        }
+        (*num)++;
+        p += strspn(p, " ");
+    }
+
+    return ESP_OK;
+}
+
+// Sign of the side of a line a point is on, > 0 is the side the in direction starts from
+static int64_t line_side(const app_people_count_line_t *line, int32_t x, int32_t y)
+{
+    return (int64_t)(line->x2 - line->x1) * (y - line->y1) - (int64_t)(line->y2 - line->y1) * (x - line->x1);
+}
+
+static void count_lines(app_people_count_t *counter, const app_people_count_track_t *track, int32_t x, int32_t y)
+{
+    for (int i = 0; i < counter->line_num; i++) {
+        const app_people_count_line_t *line = &counter->lines[i];
+        bool from = line_side(line, track->x, track->y) > 0;
+        bool to = line_side(line, x, y) > 0;
+        if (from == to) {
+            continue;
+        }
+        // The move crosses the infinite line, it crosses the segment if the ends are on both sides of the move
+        int64_t move_x = x - track->x;
+        int64_t move_y = y - track->y;
+        int64_t end1 = move_x * (line->y1 - track->y) - move_y * (line->x1 - track->x);
+        int64_t end2 = move_x * (line->y2 - track->y) - move_y * (line->x2 - track->x);
+        if ((end1 > 0) == (end2 > 0)) {
+            continue;
+        }
+        if (from) {
+            counter->current.line_in[i]++;
+            counter->total_in[i]++;
+        } else {
+            counter->current.line_out[i]++;
+            counter->total_out[i]++;
+        }
+    }
+}
+
+static void zone_leave(app_people_count_t *counter, app_people_count_track_t *track, int zone, int64_t timestamp_us)
+{
+    uint32_t dwell_ms = std::max<int64_t>(timestamp_us - track->zone_enter_us[zone], 0) / 1000;
+
+    track->zones &= ~(1 << zone);
+    counter->current.zone_leave[zone]++;
+    counter->current.zone_dwell_ms[zone] += dwell_ms;
+    counter->current.zone_dwell_max_ms[zone] = std::max(counter->current.zone_dwell_max_ms[zone], dwell_ms);
+}
+
+static void count_zones(app_people_count_t *counter, app_people_count_track_t *track, int64_t timestamp_us)
+{
+    for (int i = 0; i < counter->zone_num; i++) {
+        const app_people_count_zone_t *zone = &counter->zones[i];
+        bool inside = (track->x >= zone->x1) && (track->x < zone->x2) && (track->y >= zone->y1) && (track->y < zone->y2);
+        bool was_inside = track->zones & (1 << i);
+        if (inside && !was_inside) {
+            track->zones |= (1 << i);
+            track->zone_enter_us[i] = timestamp_us;
+            counter->current.zone_enter[i]++;
+        } else if (!inside && was_inside) {
+            zone_leave(counter, track, i, timestamp_us);
+        }
+    }
+}
+
+// A lost centroid leaves its zones when it was last seen, not when it is given up on
+static void track_drop(app_people_count_t *counter, app_people_count_track_t *track)
+{
+    for (int i = 0; i < counter->zone_num; i++) {
+        if (track->zones & (1 << i)) {
+            zone_leave(counter, track, i, track->seen_us);
+        }
+    }
+    track->active = false;
+}
+
+static app_people_count_track_t *track_match(app_people_count_t *counter, const camera_pipeline_detect_box_t *det,
+                                             int32_t x, int32_t y, uint32_t matched)
+{
+    app_people_count_track_t *best = NULL;
+    int64_t best_dist = 0;
+
+    for (int i = 0; i < APP_PEOPLE_COUNT_TRACK_MAX; i++) {
+        app_people_count_track_t *track = &counter->tracks[i];
+        if (!track->active || (matched & (1 << i))) {
+            continue;
+        }
+        // The tracker already associated the boxes, its ID is trusted over the distance
+        if (det->track_id != 0) {
+            if (track->track_id == det->track_id) {
+                return track;
+            }
+            continue;
+        }
+        int64_t dist = (int64_t)(x - track->x) * (x - track->x) + (int64_t)(y - track->y) * (y - track->y);
+        if ((dist <= (int64_t)track->gate * track->gate) && (!best || (dist < best_dist))) {
+            best = track;
+            best_dist = dist;
+        }
+    }
+
+    return best;
+}
+
+static void bucket_close(app_people_count_t *counter, const app_people_count_bucket_t **closed)
+{
+    counter->ring[counter->ring_head] = counter->current;
+    *closed = &counter->ring[counter->ring_head];
+    counter->ring_head = (counter->ring_head + 1) % CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS;
+    counter->ring_num = std::min<uint32_t>(counter->ring_num + 1, CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS);
+}
+
+esp_err_t app_people_count_init(app_people_count_t *counter, uint32_t frame_w, uint32_t frame_h, const char *lines,
+                                const char *zones)
+{
+    int16_t values[std::max(APP_PEOPLE_COUNT_LINE_MAX, APP_PEOPLE_COUNT_ZONE_MAX)][4];
+    esp_err_t ret = ESP_OK;
+
+    memset(counter, 0, sizeof(*counter));
+    ret = parse_list(lines, frame_w, frame_h, values, APP_PEOPLE_COUNT_LINE_MAX, &counter->line_num);
+    for (int i = 0; i < counter->line_num; i++) {
+        counter->lines[i] = {values[i][0], values[i][1], values[i][2], values[i][3]};
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = parse_list(zones, frame_w, frame_h, values, APP_PEOPLE_COUNT_ZONE_MAX, &counter->zone_num);
+    for (int i = 0; i < counter->zone_num; i++) {
+        counter->zones[i] = {
+            std::min(values[i][0], values[i][2]), std::min(values[i][1], values[i][3]),
+            std::max(values[i][0], values[i][2]), std::max(values[i][1], values[i][3]),
+        };
+    }
+
+    return ret;
+}
+
+void app_people_count_reset_tracks(app_people_count_t *counter)
+{
+    for (int i = 0; i < APP_PEOPLE_COUNT_TRACK_MAX; i++) {
+        if (counter->tracks[i].active) {
+            track_drop(counter, &counter->tracks[i]);
+        }
+    }
+}
+
+void app_people_count_update(app_people_count_t *counter, const camera_pipeline_detect_result_t *result,
+                             const app_people_count_bucket_t **closed)
+{
+    uint32_t minute = result->timestamp_us / PEOPLE_COUNT_MINUTE_US;
+    uint32_t matched = 0;
+
+    *closed = NULL;
+    if (counter->current_valid && (counter->current.minute != minute)) {
+        bucket_close(counter, closed);
+        counter->current_valid = false;
+    }
+    if (!counter->current_valid) {
+        memset(&counter->current, 0, sizeof(counter->current));
+        counter->current.minute = minute;
+        counter->current_valid = true;
+    }
+
+    for (uint32_t i = 0; i < result->num; i++) {
+        const camera_pipeline_detect_box_t *det = &result->boxes[i];
+        // The feet would be better for a high camera, the center keeps lines and zones independent of the viewpoint
+        int32_t x = (det->box[0] + det->box[2]) / 2;
+        int32_t y = (det->box[1] + det->box[3]) / 2;
+        app_people_count_track_t *track = track_match(counter, det, x, y, matched);
+
+        if (track) {
+            count_lines(counter, track, x, y);
+        } else {
+            // A new object, it crosses nothing before it is seen twice
+            for (int j = 0; (j < APP_PEOPLE_COUNT_TRACK_MAX) && !track; j++) {
+                if (!counter->tracks[j].active) {
+                    track = &counter->tracks[j];
+                }
+            }
+            if (!track) {
+                continue;
+            }
+            memset(track, 0, sizeof(*track));
+            track->active = true;
+            track->track_id = det->track_id;
+        }
+        track->x = x;
+        track->y = y;
+        track->gate = std::max(det->box[2] - det->box[0], det->box[3] - det->box[1]);
+        track->missed = 0;
+        track->seen_us = result->timestamp_us;
+        matched |= 1 << (track - counter->tracks);
+        count_zones(counter, track, result->timestamp_us);
+    }
+
+    for (int i = 0; i < APP_PEOPLE_COUNT_TRACK_MAX; i++) {
+        app_people_count_track_t *track = &counter->tracks[i];
+        if (track->active && !(matched & (1 << i)) && (++track->missed > PEOPLE_COUNT_MAX_MISSED)) {
+            track_drop(counter, track);
+        }
+    }
+}
+
+const app_people_count_bucket_t *app_people_count_get_bucket(const app_people_count_t *counter, uint32_t age)
+{
+    if (age >= counter->ring_num) {
+        return NULL;
+    }
+
+    return &counter->ring[(counter->ring_head + CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS - 1 - age) %
+                          CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS];
+}
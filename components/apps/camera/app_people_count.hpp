@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "app_camera_pipeline.hpp"
+
+#define APP_PEOPLE_COUNT_LINE_MAX           (4)       /*!< Maximum number of counting lines. */
+#define APP_PEOPLE_COUNT_ZONE_MAX           (4)       /*!< Maximum number of dwell zones. */
+#define APP_PEOPLE_COUNT_TRACK_MAX          (2 * CAMERA_PIPELINE_DETECT_RESULT_MAX) /*!< Centroids followed at once. */
+
+#ifndef CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS
+#define CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS  (1)
+#endif
+
+/**
+ * @brief Counting line, a segment in frame pixel coordinates.
+ */
+typedef struct {
+    int16_t x1;                                       /*!< First point. */
+    int16_t y1;
+    int16_t x2;                                       /*!< Second point. */
+    int16_t y2;
+} app_people_count_line_t;
+
+/**
+ * @brief Dwell zone, a rectangle in frame pixel coordinates.
+ */
+typedef struct {
+    int16_t x1;                                       /*!< Left edge. */
+    int16_t y1;                                       /*!< Top edge. */
+    int16_t x2;                                       /*!< Right edge, excluded. */
+    int16_t y2;                                       /*!< Bottom edge, excluded. */
+} app_people_count_zone_t;
+
+/**
+ * @brief Counts of one minute.
+ */
+typedef struct {
+    uint32_t minute;                                  /*!< Minutes since boot of the capture times counted. */
+    uint16_t line_in[APP_PEOPLE_COUNT_LINE_MAX];      /*!< Crossings of each line in its in direction. */
+    uint16_t line_out[APP_PEOPLE_COUNT_LINE_MAX];     /*!< Crossings of each line in the other direction. */
+    uint16_t zone_enter[APP_PEOPLE_COUNT_ZONE_MAX];   /*!< Centroids that entered each zone. */
+    uint16_t zone_leave[APP_PEOPLE_COUNT_ZONE_MAX];   /*!< Centroids that left each zone or were lost in it. */
+    uint32_t zone_dwell_ms[APP_PEOPLE_COUNT_ZONE_MAX]; /*!< Sum of the dwell times of the leaves. */
+    uint32_t zone_dwell_max_ms[APP_PEOPLE_COUNT_ZONE_MAX]; /*!< Longest dwell time of the leaves. */
+} app_people_count_bucket_t;
+
+/**
+ * @brief Centroid followed across detector runs.
+ */
+typedef struct {
+    bool active;                                      /*!< Whether this slot holds a centroid. */
+    uint8_t missed;                                   /*!< Consecutive detector runs without a match. */
+    uint8_t zones;                                    /*!< Bit per zone the centroid is in. */
+    uint16_t track_id;                                /*!< Track ID of the detector results, 0 if untracked. */
+    int16_t x;                                        /*!< Last centroid. */
+    int16_t y;
+    int16_t gate;                                     /*!< Distance within which an untracked box is the same object. */
+    int64_t seen_us;                                  /*!< Capture time of the last match. */
+    int64_t zone_enter_us[APP_PEOPLE_COUNT_ZONE_MAX]; /*!< Capture time the centroid entered each zone. */
+} app_people_count_track_t;
+
+/**
+ * @brief Line crossing and zone dwell counter of the pedestrian detections.
+ */
+typedef struct {
+    app_people_count_line_t lines[APP_PEOPLE_COUNT_LINE_MAX]; /*!< Counting lines. */
+    app_people_count_zone_t zones[APP_PEOPLE_COUNT_ZONE_MAX]; /*!< Dwell zones. */
+    uint8_t line_num;                                 /*!< Number of valid entries in `lines`. */
+    uint8_t zone_num;                                 /*!< Number of valid entries in `zones`. */
+    app_people_count_track_t tracks[APP_PEOPLE_COUNT_TRACK_MAX]; /*!< Centroid slots. */
+    app_people_count_bucket_t current;                /*!< Minute being counted. */
+    bool current_valid;                               /*!< Whether `current` has seen a detector run. */
+    app_people_count_bucket_t ring[CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS]; /*!< Closed minutes, oldest overwritten. */
+    uint32_t ring_head;                               /*!< Index of the next bucket to write. */
+    uint32_t ring_num;                                /*!< Number of valid entries in `ring`. */
+    uint32_t total_in[APP_PEOPLE_COUNT_LINE_MAX];     /*!< Crossings since init, per line. */
+    uint32_t total_out[APP_PEOPLE_COUNT_LINE_MAX];
+} app_people_count_t;
+
+/**
+ * @brief Initialize a counter from the line and zone lists of menuconfig.
+ *
+ * A list holds up to four entries separated by `;`, each four numbers `x1 y1 x2 y2` in percent of the frame, e.g.
+ * `50 0 50 100` for a vertical line in the middle. A line is a segment from its first to its second point, a zone a
+ * rectangle between two corners. The in direction of a line drawn downwards is from its left to its right, and of a
+ * line drawn to the right from below to above: swapping the points of a line swaps its in and out counts.
+ *
+ * @param counter Counter to initialize.
+ * @param frame_w Width of the frame the detections are in.
+ * @param frame_h Height of the frame the detections are in.
+ * @param lines List of counting lines, can be empty.
+ * @param zones List of dwell zones, can be empty.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if a list is malformed, the entries before the error are kept.
+ */
+esp_err_t app_people_count_init(app_people_count_t *counter, uint32_t frame_w, uint32_t frame_h, const char *lines,
+                                const char *zones);
+
+/**
+ * @brief Forget the followed centroids, e.g. when the detector stops. Counts and buckets are kept.
+ *
+ * Centroids still in a zone leave it at the capture time they were last seen.
+ *
+ * @param counter Counter.
+ */
+void app_people_count_reset_tracks(app_people_count_t *counter);
+
+/**
+ * @brief Count the detections of one detector run.
+ *
+ * The centroid of each box is matched with a followed centroid by its track ID if the result is tracked, otherwise
+ * with the nearest one within the size of the box. A line is crossed when the segment between the previous and the
+ * new centroid intersects it, and a zone is dwelt in from the run the centroid enters it to the run it leaves it or
+ * is last seen in it. The work is linear in the boxes of the result, the lines, zones and followed centroids being bounded.
+ *
+ * Must only be called from one task, with results in increasing capture time.
+ *
+ * @param counter Counter.
+ * @param result Detections of the run, in the frame coordinates given to `app_people_count_init`.
+ * @param closed Minute closed by this run, valid until the next call. NULL if the minute did not change.
+ */
+void app_people_count_update(app_people_count_t *counter, const camera_pipeline_detect_result_t *result,
+                             const app_people_count_bucket_t **closed);
+
+/**
+ * @brief Get a closed minute.
+ *
+ * Minutes without any detector run have no bucket.
+ *
+ * @param counter Counter.
+ * @param age 0 for the latest closed minute, up to `CONFIG_CAMERA_PEOPLE_COUNT_BUCKETS - 1`.
+ *
+ * @return The bucket, NULL if there is none that old.
+ */
+const app_people_count_bucket_t *app_people_count_get_bucket(const app_people_count_t *counter, uint32_t age);
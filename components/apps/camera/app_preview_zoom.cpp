@@ -0,0 +1,346 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_CAMERA_PREVIEW_ZOOM
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "driver/ppa.h"
+#include "media_arena/media_arena.h"
+#include "touch_points/touch_points.h"
+#include "app_preview_zoom.hpp"
+
+#define ZOOM_STEP                           (APP_PREVIEW_ZOOM_STEP)
+#define ZOOM_SCALE_MAX                      (CONFIG_CAMERA_PREVIEW_ZOOM_MAX * ZOOM_STEP)
+#define ZOOM_BUF_NUM_MAX                    (3)
+// Closer fingers give a distance too noisy to zoom with
+#define ZOOM_PINCH_DIST_MIN                 (40)
+
+static const char *TAG = "app_preview_zoom";
+
+static ppa_client_handle_t zoom_ppa = NULL;
+static uint8_t *zoom_bufs[ZOOM_BUF_NUM_MAX];
+static size_t zoom_buf_size = 0;
+static uint8_t zoom_buf_num = 0;
+static uint32_t frame_width = 0;
+static uint32_t frame_height = 0;
+static uint32_t out_width = 0;
+static uint32_t out_height = 0;
+static bool zoom_ready = false;
+
+// The view is written by the LVGL task and read by the stream task for every frame
+static portMUX_TYPE zoom_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool zoom_buf_held[ZOOM_BUF_NUM_MAX];
+static uint16_t zoom_scale = ZOOM_STEP;
+static float zoom_center_x = 0;
+static float zoom_center_y = 0;
+
+// Owned by the LVGL task, the touch panel is read from it too
+static lv_obj_t *zoom_obj = NULL;
+static bool zoom_touch_hooked = false;
+static uint16_t touch_x[TOUCH_POINTS_NUM];
+static uint16_t touch_y[TOUCH_POINTS_NUM];
+static bool pinch_active = false;
+static float pinch_dist = 0;
+static uint16_t pinch_scale = ZOOM_STEP;
+static float pinch_focus_x = 0;
+static float pinch_focus_y = 0;
+
+static void zoom_compute_view(uint16_t scale, float center_x, float center_y, app_preview_zoom_view_t *view)
+{
+    // Rounded down, the PPA fails when the scaled block doesn't fit the output
+    uint16_t w = std::min<uint32_t>(out_width * ZOOM_STEP / scale, frame_width);
+    uint16_t h = std::min<uint32_t>(out_height * ZOOM_STEP / scale, frame_height);
+    float x = std::clamp(center_x - w / 2.0f, 0.0f, (float)(frame_width - w));
+    float y = std::clamp(center_y - h / 2.0f, 0.0f, (float)(frame_height - h));
+
+    view->crop = {(uint16_t)x, (uint16_t)y, w, h};
+    view->scale = scale;
+    view->out_w = out_width;
+    view->out_h = out_height;
+}
+
+static void zoom_store(uint16_t scale, float center_x, float center_y)
+{
+    app_preview_zoom_view_t view;
+
+    scale = std::clamp<uint16_t>(scale, ZOOM_STEP, ZOOM_SCALE_MAX);
+    // Keep the center of the clamped view, so a pan past the edge doesn't have to be undone first
+    zoom_compute_view(scale, center_x, center_y, &view);
+
+    portENTER_CRITICAL(&zoom_lock);
+    zoom_scale = scale;
+    zoom_center_x = view.crop.x + view.crop.w / 2.0f;
+    zoom_center_y = view.crop.y + view.crop.h / 2.0f;
+    portEXIT_CRITICAL(&zoom_lock);
+}
+
+static void zoom_load(app_preview_zoom_view_t *view)
+{
+    portENTER_CRITICAL(&zoom_lock);
+    uint16_t scale = zoom_scale;
+    float center_x = zoom_center_x;
+    float center_y = zoom_center_y;
+    portEXIT_CRITICAL(&zoom_lock);
+
+    zoom_compute_view(scale, center_x, center_y, view);
+}
+
+static void zoom_pinch(const lv_area_t *coords)
+{
+    app_preview_zoom_view_t view;
+    float dx = (float)touch_x[1] - touch_x[0];
+    float dy = (float)touch_y[1] - touch_y[0];
+    float dist = sqrtf(dx * dx + dy * dy);
+    // Touch panel coordinates, the display isn't rotated
+    float mid_x = (touch_x[0] + touch_x[1]) / 2.0f - coords->x1;
+    float mid_y = (touch_y[0] + touch_y[1]) / 2.0f - coords->y1;
+
+    if (dist < ZOOM_PINCH_DIST_MIN) {
+        return;
+    }
+
+    zoom_load(&view);
+    if (!pinch_active) {
+        // The frame point between the fingers stays between them while zooming
+        pinch_active = true;
+        pinch_dist = dist;
+        pinch_scale = view.scale;
+        pinch_focus_x = view.crop.x + mid_x * ZOOM_STEP / view.scale;
+        pinch_focus_y = view.crop.y + mid_y * ZOOM_STEP / view.scale;
+        return;
+    }
+
+    uint16_t scale = std::clamp<long>(lroundf(pinch_scale * dist / pinch_dist), ZOOM_STEP, ZOOM_SCALE_MAX);
+    float w = (float)out_width * ZOOM_STEP / scale;
+    float h = (float)out_height * ZOOM_STEP / scale;
+    zoom_store(scale, pinch_focus_x - mid_x * ZOOM_STEP / scale + w / 2, pinch_focus_y - mid_y * ZOOM_STEP / scale + h / 2);
+}
+
+static void zoom_pan(void)
+{
+    app_preview_zoom_view_t view;
+    lv_point_t vect;
+
+    lv_indev_get_vect(lv_indev_get_act(), &vect);
+    if ((vect.x == 0) && (vect.y == 0)) {
+        return;
+    }
+
+    // The content follows the finger
+    zoom_load(&view);
+    zoom_store(view.scale, view.crop.x + view.crop.w / 2.0f - (float)vect.x * ZOOM_STEP / view.scale,
+               view.crop.y + view.crop.h / 2.0f - (float)vect.y * ZOOM_STEP / view.scale);
+}
+
+static void zoom_event_cb(lv_event_t *e)
+{
+    lv_area_t coords;
+
+    if (zoom_obj == NULL) {
+        return;
+    }
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_PRESSED:
+        pinch_active = false;
+        break;
+    case LV_EVENT_PRESSING:
+        lv_obj_get_coords(zoom_obj, &coords);
+        if (touch_points_get(touch_x, touch_y) >= 2) {
+            zoom_pinch(&coords);
+        } else if (!pinch_active) {
+            // The fingers of a pinch never lift together, don't pan with the one left
+            zoom_pan();
+        }
+        break;
+    case LV_EVENT_RELEASED:
+    case LV_EVENT_PRESS_LOST:
+        pinch_active = false;
+        break;
+    default:
+        break;
+    }
+}
+
+esp_err_t app_preview_zoom_init(uint32_t frame_w, uint32_t frame_h, uint32_t out_w, uint32_t out_h, uint8_t buf_num)
+{
+    esp_err_t ret = ESP_OK;
+    ppa_client_config_t ppa_config = {};
+
+    ESP_RETURN_ON_FALSE(frame_w && frame_h && out_w && out_h && buf_num && (buf_num <= ZOOM_BUF_NUM_MAX),
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    ESP_RETURN_ON_FALSE(zoom_buf_num == 0, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    frame_width = frame_w;
+    frame_height = frame_h;
+    out_width = out_w;
+    out_height = out_h;
+    zoom_store(ZOOM_STEP, frame_w / 2.0f, frame_h / 2.0f);
+
+    ppa_config.oper_type = PPA_OPERATION_SRM;
+    ESP_GOTO_ON_ERROR(ppa_register_client(&ppa_config, &zoom_ppa), err, TAG, "Register PPA client failed");
+
+    for (uint8_t i = 0; i < buf_num; i++) {
+        // Aligned to the cache line, the PPA writes it by DMA
+        zoom_bufs[i] = (uint8_t *)media_arena_lend(out_w * out_h * 2, &zoom_buf_size);
+        ESP_GOTO_ON_FALSE(zoom_bufs[i], ESP_ERR_NO_MEM, err, TAG, "Allocate preview buffer %d failed", i);
+        // The view may not cover the last columns and rows
+        memset(zoom_bufs[i], 0, zoom_buf_size);
+        zoom_buf_held[i] = false;
+        zoom_buf_num = i + 1;
+    }
+    __atomic_store_n(&zoom_ready, true, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+
+err:
+    app_preview_zoom_deinit();
+
+    return ret;
+}
+
+void app_preview_zoom_deinit(void)
+{
+    __atomic_store_n(&zoom_ready, false, __ATOMIC_RELEASE);
+    if (zoom_touch_hooked) {
+        touch_points_unhook();
+        zoom_touch_hooked = false;
+    }
+    zoom_obj = NULL;
+    pinch_active = false;
+
+    for (uint8_t i = 0; i < zoom_buf_num; i++) {
+        media_arena_return(zoom_bufs[i]);
+        zoom_bufs[i] = NULL;
+    }
+    zoom_buf_num = 0;
+    if (zoom_ppa) {
+        ppa_unregister_client(zoom_ppa);
+        zoom_ppa = NULL;
+    }
+}
+
+esp_err_t app_preview_zoom_attach(lv_obj_t *obj)
+{
+    ESP_RETURN_ON_FALSE(obj, ESP_ERR_INVALID_ARG, TAG, "Invalid object");
+    ESP_RETURN_ON_FALSE(zoom_buf_num > 0, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    if (!zoom_touch_hooked) {
+        // Without the points of the touch panel, the preview can only be panned
+        zoom_touch_hooked = (touch_points_hook(lv_obj_get_disp(obj)) == ESP_OK);
+    }
+    zoom_obj = obj;
+    lv_obj_add_flag(obj, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(obj, zoom_event_cb, LV_EVENT_ALL, NULL);
+
+    return ESP_OK;
+}
+
+bool app_preview_zoom_is_ready(void)
+{
+    return __atomic_load_n(&zoom_ready, __ATOMIC_ACQUIRE);
+}
+
+esp_err_t app_preview_zoom_render(const uint8_t *frame, uint8_t **buf, uint8_t *buf_index, app_preview_zoom_view_t *view)
+{
+    int index = -1;
+    ppa_srm_oper_config_t srm_config = {};
+
+    if (!__atomic_load_n(&zoom_ready, __ATOMIC_ACQUIRE)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    zoom_load(view);
+    portENTER_CRITICAL(&zoom_lock);
+    for (uint8_t i = 0; i < zoom_buf_num; i++) {
+        if (!zoom_buf_held[i]) {
+            zoom_buf_held[i] = true;
+            index = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&zoom_lock);
+    if (index < 0) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    srm_config.in.buffer = frame;
+    srm_config.in.pic_w = frame_width;
+    srm_config.in.pic_h = frame_height;
+    srm_config.in.block_w = view->crop.w;
+    srm_config.in.block_h = view->crop.h;
+    srm_config.in.block_offset_x = view->crop.x;
+    srm_config.in.block_offset_y = view->crop.y;
+    srm_config.in.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.out.buffer = zoom_bufs[index];
+    srm_config.out.buffer_size = zoom_buf_size;
+    srm_config.out.pic_w = out_width;
+    srm_config.out.pic_h = out_height;
+    srm_config.out.block_offset_x = 0;
+    srm_config.out.block_offset_y = 0;
+    srm_config.out.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.rotation_angle = PPA_SRM_ROTATION_ANGLE_0;
+    // Exact, the scale is a multiple of the PPA step
+    srm_config.scale_x = (float)view->scale / ZOOM_STEP;
+    srm_config.scale_y = (float)view->scale / ZOOM_STEP;
+    srm_config.mode = PPA_TRANS_MODE_BLOCKING;
+
+    esp_err_t ret = ppa_do_scale_rotate_mirror(zoom_ppa, &srm_config);
+    if (ret != ESP_OK) {
+        app_preview_zoom_release(index);
+        return ret;
+    }
+    *buf = zoom_bufs[index];
+    *buf_index = index;
+
+    return ESP_OK;
+}
+
+void app_preview_zoom_release(uint8_t buf_index)
+{
+    if (buf_index >= ZOOM_BUF_NUM_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&zoom_lock);
+    zoom_buf_held[buf_index] = false;
+    portEXIT_CRITICAL(&zoom_lock);
+}
+
+void app_preview_zoom_map_result(const app_preview_zoom_view_t *view, const camera_pipeline_detect_result_t *in,
+                                 camera_pipeline_detect_result_t *out)
+{
+    const camera_pipeline_rect_t &crop = view->crop;
+
+    out->timestamp_us = in->timestamp_us;
+    out->frame_seq = in->frame_seq;
+    out->num = 0;
+    for (uint32_t i = 0; i < in->num; i++) {
+        const camera_pipeline_detect_box_t *src = &in->boxes[i];
+
+        if ((src->box[2] < crop.x) || (src->box[0] >= crop.x + crop.w) ||
+                (src->box[3] < crop.y) || (src->box[1] >= crop.y + crop.h)) {
+            continue;
+        }
+
+        camera_pipeline_detect_box_t *dst = &out->boxes[out->num++];
+        *dst = *src;
+        for (int j = 0; j < 4; j++) {
+            dst->box[j] = (src->box[j] - ((j & 1) ? crop.y : crop.x)) * view->scale / ZOOM_STEP;
+        }
+        for (int j = 0; j < src->keypoint_num; j++) {
+            dst->keypoint[j] = (src->keypoint[j] - ((j & 1) ? crop.y : crop.x)) * view->scale / ZOOM_STEP;
+        }
+    }
+}
+
+#endif /* CONFIG_CAMERA_PREVIEW_ZOOM */
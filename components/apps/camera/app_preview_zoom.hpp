@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "lvgl.h"
+#include "app_camera_pipeline.hpp"
+
+#define APP_PREVIEW_ZOOM_STEP               (16)    /*!< Zoom factors are multiples of 1/16, the PPA scaling step */
+
+/**
+ * @brief Part of the frame a preview buffer shows.
+ */
+typedef struct {
+    camera_pipeline_rect_t crop;            /*!< Region of the frame, in frame pixels. */
+    uint16_t scale;                         /*!< Zoom factor in 1/`APP_PREVIEW_ZOOM_STEP`. */
+    uint16_t out_w;                         /*!< Width of the preview buffer. */
+    uint16_t out_h;                         /*!< Height of the preview buffer. */
+} app_preview_zoom_view_t;
+
+/**
+ * @brief Allocate the display sized preview buffers.
+ *
+ * The crop of the frame picked by the zoom and pan is scaled by the PPA into one of them for every frame, so the
+ * canvas never needs a sensor sized buffer. Starts without zoom, centered. Can be called while frames are rendered,
+ * `app_preview_zoom_render` fails until the buffers are ready.
+ *
+ * @param frame_w Frame width in pixels.
+ * @param frame_h Frame height in pixels.
+ * @param out_w Preview width, the canvas width.
+ * @param out_h Preview height, the canvas height.
+ * @param buf_num Preview buffers, one more than the display holds at the same time, at most 3.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if already initialized, or ESP_ERR_NO_MEM.
+ */
+esp_err_t app_preview_zoom_init(uint32_t frame_w, uint32_t frame_h, uint32_t out_w, uint32_t out_h, uint8_t buf_num);
+
+/**
+ * @brief Detach the gestures and free the preview buffers. Must be called with the LVGL lock held, once no frame is
+ *        rendered anymore and no buffer is referenced.
+ */
+void app_preview_zoom_deinit(void);
+
+/**
+ * @brief Zoom and pan the preview with gestures on an object, usually the preview canvas.
+ *
+ * Pinch with two fingers to zoom around the fingers, drag with one finger to pan. LVGL only tracks one touch point,
+ * the second one is taken from the touch panel driver of the pointer device of the display. Without it, the preview
+ * can only be panned. Must be called with the LVGL lock held.
+ *
+ * @param obj Object receiving the touches, made clickable.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized.
+ */
+esp_err_t app_preview_zoom_attach(lv_obj_t *obj);
+
+/**
+ * @brief Check whether the preview buffers are ready.
+ */
+bool app_preview_zoom_is_ready(void);
+
+/**
+ * @brief Render the current view of a frame into a free preview buffer.
+ *
+ * Called from the stream task. The buffer is referenced until `app_preview_zoom_release`.
+ *
+ * @param frame RGB565 frame of the size given to `app_preview_zoom_init`.
+ * @param buf Output preview buffer, RGB565 of the preview size.
+ * @param buf_index Output index of the buffer.
+ * @param view Output view the buffer shows.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized, ESP_ERR_NOT_FINISHED if every buffer is
+ *         referenced, or the PPA error.
+ */
+esp_err_t app_preview_zoom_render(const uint8_t *frame, uint8_t **buf, uint8_t *buf_index, app_preview_zoom_view_t *view);
+
+/**
+ * @brief Give back a buffer from `app_preview_zoom_render`.
+ *
+ * @param buf_index Index of the buffer.
+ */
+void app_preview_zoom_release(uint8_t buf_index);
+
+/**
+ * @brief Bring detections from frame coordinates to the coordinates of a preview buffer.
+ *
+ * Detections outside the view are left out.
+ *
+ * @param view View of the preview buffer.
+ * @param in Detections in frame pixels.
+ * @param out Detections in preview pixels, can't be `in`.
+ */
+void app_preview_zoom_map_result(const app_preview_zoom_view_t *view, const camera_pipeline_detect_result_t *in,
+                                 camera_pipeline_detect_result_t *out);
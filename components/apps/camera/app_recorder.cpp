@@ -0,0 +1,1115 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <dirent.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_cache.h"
+#include "esp_private/esp_cache_private.h"
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+#include "driver/ppa.h"
+#include "esp_h264_enc_single.h"
+#include "esp_h264_enc_single_hw.h"
+#else
+#include "driver/jpeg_encode.h"
+#endif
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
+#include "app_video.h"
+#include "app_recorder.hpp"
+
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+#define RECORDER_FILE_FMT                   BSP_SD_MOUNT_POINT "/VID_%04lu.mp4"
+#else
+#define RECORDER_FILE_FMT                   BSP_SD_MOUNT_POINT "/VID_%04lu.avi"
+#define RECORDER_JPEG_QUALITY               (CONFIG_CAMERA_RECORDER_JPEG_QUALITY)
+#endif
+#define RECORDER_PATH_LEN_MAX               (64)
+#define RECORDER_SLOT_NUM                   (CONFIG_CAMERA_RECORDER_SLOT_NUM)
+#define RECORDER_WRITE_BUF_SIZE             (CONFIG_CAMERA_RECORDER_WRITE_BUF_KB * 1024)
+// Encoded frames stay well below a quarter of the raw RGB565 frame at the supported qualities
+#define RECORDER_JPEG_BUF_DIV               (4)
+#define RECORDER_ENCODE_TIMEOUT_MS          (100)
+#define RECORDER_STOP_WAIT_MS               (500)
+#define RECORDER_INDEX_GROW                 (1024)
+#define RECORDER_DEFAULT_US_PER_FRAME       (33333)
+#define RECORDER_STOP_SLOT                  (0xFF)
+#define RECORDER_ALIGN_UP(x, a)             ((((x) + (a) - 1) / (a)) * (a))
+
+// The AVI header is padded with a JUNK chunk so the frame data starts sector aligned
+#define AVI_HEADER_SIZE                     (512)
+#define AVI_MOVI_LIST_OFFSET                (AVI_HEADER_SIZE - 12)
+#define AVI_MOVI_OFFSET                     (AVI_HEADER_SIZE - 4)
+#define AVI_HDRL_SIZE                       (192)
+#define AVI_STRL_SIZE                       (116)
+#define AVIF_HASINDEX                       (0x00000010)
+#define AVIIF_KEYFRAME                      (0x00000010)
+
+// The hardware H.264 encoder works on whole 16x16 macroblocks
+#define H264_MB_SIZE                        (16)
+#define H264_FPS                            (30)
+#define H264_QP_MIN                         (20)
+#define H264_QP_MAX                         (38)
+// IDR frames are the largest, they stay below a quarter of the YUV420 frame at the supported bitrates
+#define H264_BUF_DIV                        (4)
+#define H264_NAL_TYPE_MASK                  (0x1F)
+#define H264_NAL_TYPE_SPS                   (7)
+#define H264_NAL_TYPE_PPS                   (8)
+#define H264_PARAM_SET_SIZE_MAX             (64)
+#define H264_SAMPLE_NUM_MAX                 (CONFIG_CAMERA_RECORDER_H264_MAX_MINUTES * 60 * H264_FPS)
+
+// Like the AVI header, `ftyp` and a `free` box pad the `mdat` header so the samples start sector aligned.
+// The `moov` box follows the samples, its tables are the arrays filled while recording.
+#define MP4_HEADER_SIZE                     (512)
+#define MP4_FTYP_SIZE                       (24)
+#define MP4_MDAT_OFFSET                     (MP4_HEADER_SIZE - 8)
+#define MP4_MOVIE_TIMESCALE                 (1000)
+#define MP4_MEDIA_TIMESCALE                 (90000)
+
+typedef struct {
+    uint8_t *frame;             /*!< V4L2 frame buffer, referenced until encoded. */
+    uint8_t frame_index;        /*!< V4L2 buffer index of the frame. */
+} recorder_request_t;
+
+typedef struct {
+    uint8_t *buf;               /*!< Encoder output buffer. */
+    size_t buf_size;            /*!< Size of the encoder output buffer. */
+    uint32_t size;              /*!< Size of the encoded frame. */
+    bool key_frame;             /*!< The frame can be decoded on its own. */
+} recorder_slot_t;
+
+typedef struct {
+    uint8_t ckid[4];            /*!< Chunk id of the frame. */
+    uint32_t flags;             /*!< AVIIF_* flags. */
+    uint32_t offset;            /*!< Chunk offset from the `movi` fourcc. */
+    uint32_t size;              /*!< Chunk payload size. */
+} recorder_index_entry_t;
+
+static const char *TAG = "app_recorder";
+
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+static esp_h264_enc_handle_t h264_encoder = NULL;
+static ppa_client_handle_t yuv_ppa = NULL;
+static uint8_t *yuv_buf = NULL;
+static size_t yuv_buf_size = 0;
+static uint32_t encode_width = 0;
+static uint32_t encode_height = 0;
+#else
+static jpeg_encoder_handle_t jpeg_encoder = NULL;
+#endif
+static recorder_slot_t slots[RECORDER_SLOT_NUM];
+static QueueHandle_t encode_queue = NULL;
+static QueueHandle_t free_queue = NULL;
+static QueueHandle_t write_queue = NULL;
+static SemaphoreHandle_t stop_done_sem = NULL;
+static uint32_t record_width = 0;
+static uint32_t record_height = 0;
+
+// Owned by the writer task while recording
+static FILE *record_fp = NULL;
+static uint8_t *write_buf = NULL;
+static size_t write_len = 0;
+static bool write_failed = false;
+static int64_t record_start_us = 0;
+static int64_t record_stop_us = 0;
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+// Preallocated MP4 sample tables, nothing is allocated while recording
+static uint32_t *sample_sizes = NULL;
+static uint32_t *sample_offsets = NULL;
+static uint32_t *sync_samples = NULL;
+static uint32_t sync_cap = 0;
+static uint32_t sample_num = 0;
+static uint32_t sync_num = 0;
+static uint32_t mdat_pos = 0;
+static uint8_t sps[H264_PARAM_SET_SIZE_MAX];
+static uint8_t pps[H264_PARAM_SET_SIZE_MAX];
+static size_t sps_len = 0;
+static size_t pps_len = 0;
+#else
+static recorder_index_entry_t *index_entries = NULL;
+static uint32_t index_num = 0;
+static uint32_t index_cap = 0;
+static uint32_t movi_pos = 0;
+static uint32_t max_chunk_size = 0;
+#endif
+
+static bool recording = false;
+static bool encode_busy = false;
+static app_recorder_stats_t record_stats;
+
+static esp_err_t recorder_flush(void)
+{
+    if ((write_len == 0) || write_failed) {
+        write_len = 0;
+        return write_failed ? ESP_FAIL : ESP_OK;
+    }
+
+    size_t written = fwrite(write_buf, 1, write_len, record_fp);
+    record_stats.bytes_written += written;
+    if (written != write_len) {
+        ESP_LOGE(TAG, "Write failed, SD card full or removed?");
+        write_failed = true;
+    }
+    write_len = 0;
+
+    return write_failed ? ESP_FAIL : ESP_OK;
+}
+
+static esp_err_t recorder_write_bytes(const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+
+    // The file only ever sees full, aligned buffers except for the final flush
+    while (len > 0) {
+        size_t chunk = std::min(len, (size_t)RECORDER_WRITE_BUF_SIZE - write_len);
+        memcpy(write_buf + write_len, src, chunk);
+        write_len += chunk;
+        src += chunk;
+        len -= chunk;
+        if (write_len == RECORDER_WRITE_BUF_SIZE) {
+            ESP_RETURN_ON_ERROR(recorder_flush(), TAG, "Flush failed");
+        }
+    }
+
+    return ESP_OK;
+}
+
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+static uint8_t *mp4_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+    return p + 2;
+}
+
+static uint8_t *mp4_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+    return p + 4;
+}
+
+static uint8_t *mp4_put_fourcc(uint8_t *p, const char *fourcc)
+{
+    memcpy(p, fourcc, 4);
+    return p + 4;
+}
+
+static uint8_t *mp4_put_zero(uint8_t *p, size_t len)
+{
+    memset(p, 0, len);
+    return p + len;
+}
+
+static uint8_t *mp4_put_box(uint8_t *p, uint32_t size, const char *type)
+{
+    return mp4_put_fourcc(mp4_put_u32(p, size), type);
+}
+
+static uint8_t *mp4_put_full_box(uint8_t *p, uint32_t size, const char *type, uint32_t flags)
+{
+    // Version 0 in the top byte
+    return mp4_put_u32(mp4_put_box(p, size, type), flags & 0xFFFFFF);
+}
+
+static uint8_t *mp4_put_matrix(uint8_t *p)
+{
+    static const uint32_t unity[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+    for (int i = 0; i < 9; i++) {
+        p = mp4_put_u32(p, unity[i]);
+    }
+    return p;
+}
+
+static void mp4_build_header(uint8_t *hdr, uint32_t mdat_size)
+{
+    uint8_t *p = hdr;
+
+    memset(hdr, 0, MP4_HEADER_SIZE);
+    p = mp4_put_box(p, MP4_FTYP_SIZE, "ftyp");
+    p = mp4_put_fourcc(p, "isom");
+    p = mp4_put_u32(p, 0x200);
+    p = mp4_put_fourcc(p, "isom");
+    mp4_put_fourcc(p, "avc1");
+
+    mp4_put_box(hdr + MP4_FTYP_SIZE, MP4_MDAT_OFFSET - MP4_FTYP_SIZE, "free");
+    mp4_put_box(hdr + MP4_MDAT_OFFSET, mdat_size, "mdat");
+}
+
+static const uint8_t *h264_find_start_code(const uint8_t *p, const uint8_t *end)
+{
+    for (; p + 3 <= end; p++) {
+        if ((p[0] == 0) && (p[1] == 0) && (p[2] == 1)) {
+            return p;
+        }
+    }
+    return end;
+}
+
+static const uint8_t *h264_next_nal(const uint8_t **pos, const uint8_t *end, size_t *len)
+{
+    const uint8_t *start = h264_find_start_code(*pos, end);
+
+    if (start == end) {
+        return NULL;
+    }
+    start += 3;
+
+    // The zero in front of a 4 byte start code belongs to the start code, not to the NAL unit
+    const uint8_t *next = h264_find_start_code(start, end);
+    const uint8_t *stop = next;
+    while ((stop > start) && (stop[-1] == 0)) {
+        stop--;
+    }
+    *pos = next;
+    *len = stop - start;
+
+    return start;
+}
+
+static void h264_save_param_set(uint8_t *dst, size_t *dst_len, const uint8_t *nal, size_t len)
+{
+    // The encoder repeats the parameter sets before every IDR frame, they never change within a recording
+    if ((*dst_len == 0) && (len <= H264_PARAM_SET_SIZE_MAX)) {
+        memcpy(dst, nal, len);
+        *dst_len = len;
+    }
+}
+
+static esp_err_t recorder_write_frame(const recorder_slot_t *slot)
+{
+    const uint8_t *pos = slot->buf;
+    const uint8_t *end = slot->buf + slot->size;
+    const uint8_t *nal = NULL;
+    size_t nal_len = 0;
+    uint32_t sample_size = 0;
+    uint8_t nal_header[4];
+
+    ESP_RETURN_ON_FALSE(!write_failed, ESP_FAIL, TAG, "Writer failed");
+    // Counted as an error by the caller, the tables are never grown while recording
+    if (sample_num == H264_SAMPLE_NUM_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // MP4 samples hold length prefixed NAL units, the parameter sets only go to the `avcC` box
+    while ((nal = h264_next_nal(&pos, end, &nal_len)) != NULL) {
+        if (nal_len == 0) {
+            continue;
+        }
+        switch (nal[0] & H264_NAL_TYPE_MASK) {
+        case H264_NAL_TYPE_SPS:
+            h264_save_param_set(sps, &sps_len, nal, nal_len);
+            break;
+        case H264_NAL_TYPE_PPS:
+            h264_save_param_set(pps, &pps_len, nal, nal_len);
+            break;
+        default:
+            mp4_put_u32(nal_header, nal_len);
+            ESP_RETURN_ON_ERROR(recorder_write_bytes(nal_header, sizeof(nal_header)), TAG, "Write NAL header failed");
+            ESP_RETURN_ON_ERROR(recorder_write_bytes(nal, nal_len), TAG, "Write NAL failed");
+            sample_size += sizeof(nal_header) + nal_len;
+            break;
+        }
+    }
+    ESP_RETURN_ON_FALSE(sample_size > 0, ESP_ERR_INVALID_SIZE, TAG, "No picture in the encoded frame");
+
+    if (slot->key_frame && (sync_num < sync_cap)) {
+        sync_samples[sync_num++] = sample_num + 1;
+    }
+    sample_sizes[sample_num] = sample_size;
+    sample_offsets[sample_num] = mdat_pos;
+    sample_num++;
+    mdat_pos += sample_size;
+    record_stats.frames_written++;
+
+    return ESP_OK;
+}
+
+static esp_err_t mp4_write_table(uint32_t *table, uint32_t num)
+{
+    // Swapped in place, the next recording overwrites the tables anyway
+    for (uint32_t i = 0; i < num; i++) {
+        table[i] = __builtin_bswap32(table[i]);
+    }
+    return recorder_write_bytes(table, num * sizeof(uint32_t));
+}
+
+static esp_err_t mp4_write_moov(uint32_t sample_delta)
+{
+    static uint8_t box[512];
+    uint8_t *p = box;
+    uint32_t duration = sample_delta * sample_num;
+    uint32_t movie_duration = (uint32_t)((uint64_t)duration * MP4_MOVIE_TIMESCALE / MP4_MEDIA_TIMESCALE);
+
+    // The tables are written straight from the sample arrays, so every box size is computed up front
+    uint32_t avcc_size = 19 + sps_len + pps_len;
+    uint32_t stsd_size = 16 + 86 + avcc_size;
+    uint32_t stts_size = 24;
+    uint32_t stss_size = 16 + 4 * sync_num;
+    uint32_t stsc_size = 28;
+    uint32_t stsz_size = 20 + 4 * sample_num;
+    uint32_t stco_size = 16 + 4 * sample_num;
+    uint32_t stbl_size = 8 + stsd_size + stts_size + stss_size + stsc_size + stsz_size + stco_size;
+    uint32_t minf_size = 8 + 20 + 36 + stbl_size;
+    uint32_t mdia_size = 8 + 32 + 45 + minf_size;
+    uint32_t trak_size = 8 + 92 + mdia_size;
+    uint32_t moov_size = 8 + 108 + trak_size;
+
+    p = mp4_put_box(p, moov_size, "moov");
+
+    p = mp4_put_full_box(p, 108, "mvhd", 0);
+    p = mp4_put_zero(p, 8);
+    p = mp4_put_u32(p, MP4_MOVIE_TIMESCALE);
+    p = mp4_put_u32(p, movie_duration);
+    p = mp4_put_u32(p, 0x00010000);
+    p = mp4_put_u16(p, 0x0100);
+    p = mp4_put_zero(p, 10);
+    p = mp4_put_matrix(p);
+    p = mp4_put_zero(p, 24);
+    p = mp4_put_u32(p, 2);
+
+    p = mp4_put_box(p, trak_size, "trak");
+    // Track enabled and in the movie
+    p = mp4_put_full_box(p, 92, "tkhd", 0x000003);
+    p = mp4_put_zero(p, 8);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_zero(p, 4);
+    p = mp4_put_u32(p, movie_duration);
+    p = mp4_put_zero(p, 16);
+    p = mp4_put_matrix(p);
+    p = mp4_put_u32(p, encode_width << 16);
+    p = mp4_put_u32(p, encode_height << 16);
+
+    p = mp4_put_box(p, mdia_size, "mdia");
+    p = mp4_put_full_box(p, 32, "mdhd", 0);
+    p = mp4_put_zero(p, 8);
+    p = mp4_put_u32(p, MP4_MEDIA_TIMESCALE);
+    p = mp4_put_u32(p, duration);
+    // Language `und`
+    p = mp4_put_u16(p, 0x55C4);
+    p = mp4_put_u16(p, 0);
+
+    p = mp4_put_full_box(p, 45, "hdlr", 0);
+    p = mp4_put_zero(p, 4);
+    p = mp4_put_fourcc(p, "vide");
+    p = mp4_put_zero(p, 12);
+    memcpy(p, "VideoHandler", 13);
+    p += 13;
+
+    p = mp4_put_box(p, minf_size, "minf");
+    p = mp4_put_full_box(p, 20, "vmhd", 0x000001);
+    p = mp4_put_zero(p, 8);
+    p = mp4_put_box(p, 36, "dinf");
+    p = mp4_put_full_box(p, 28, "dref", 0);
+    p = mp4_put_u32(p, 1);
+    // The samples are in this file
+    p = mp4_put_full_box(p, 12, "url ", 0x000001);
+
+    p = mp4_put_box(p, stbl_size, "stbl");
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(box, p - box), TAG, "Write movie box failed");
+    p = box;
+
+    p = mp4_put_full_box(p, stsd_size, "stsd", 0);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_box(p, 86 + avcc_size, "avc1");
+    p = mp4_put_zero(p, 6);
+    p = mp4_put_u16(p, 1);
+    p = mp4_put_zero(p, 16);
+    p = mp4_put_u16(p, encode_width);
+    p = mp4_put_u16(p, encode_height);
+    p = mp4_put_u32(p, 0x00480000);
+    p = mp4_put_u32(p, 0x00480000);
+    p = mp4_put_zero(p, 4);
+    p = mp4_put_u16(p, 1);
+    p = mp4_put_zero(p, 32);
+    p = mp4_put_u16(p, 0x0018);
+    p = mp4_put_u16(p, 0xFFFF);
+
+    // Profile, compatibility and level are copied from the SPS, NAL unit lengths are 4 bytes
+    p = mp4_put_box(p, avcc_size, "avcC");
+    *p++ = 1;
+    *p++ = sps[1];
+    *p++ = sps[2];
+    *p++ = sps[3];
+    *p++ = 0xFF;
+    *p++ = 0xE1;
+    p = mp4_put_u16(p, sps_len);
+    memcpy(p, sps, sps_len);
+    p += sps_len;
+    *p++ = 1;
+    p = mp4_put_u16(p, pps_len);
+    memcpy(p, pps, pps_len);
+    p += pps_len;
+
+    // One constant sample duration, the measured frame rate like the AVI header
+    p = mp4_put_full_box(p, stts_size, "stts", 0);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_u32(p, sample_num);
+    p = mp4_put_u32(p, sample_delta);
+
+    p = mp4_put_full_box(p, stss_size, "stss", 0);
+    p = mp4_put_u32(p, sync_num);
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(box, p - box), TAG, "Write sample description failed");
+    ESP_RETURN_ON_ERROR(mp4_write_table(sync_samples, sync_num), TAG, "Write sync samples failed");
+    p = box;
+
+    // One sample per chunk, so the chunk offsets are the sample offsets
+    p = mp4_put_full_box(p, stsc_size, "stsc", 0);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_u32(p, 1);
+    p = mp4_put_u32(p, 1);
+
+    p = mp4_put_full_box(p, stsz_size, "stsz", 0);
+    p = mp4_put_u32(p, 0);
+    p = mp4_put_u32(p, sample_num);
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(box, p - box), TAG, "Write sample sizes failed");
+    ESP_RETURN_ON_ERROR(mp4_write_table(sample_sizes, sample_num), TAG, "Write sample sizes failed");
+    p = box;
+
+    p = mp4_put_full_box(p, stco_size, "stco", 0);
+    p = mp4_put_u32(p, sample_num);
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(box, p - box), TAG, "Write chunk offsets failed");
+    ESP_RETURN_ON_ERROR(mp4_write_table(sample_offsets, sample_num), TAG, "Write chunk offsets failed");
+
+    return ESP_OK;
+}
+
+static void recorder_finalize(void)
+{
+    uint32_t mdat_size = mdat_pos - MP4_MDAT_OFFSET;
+    uint32_t sample_delta = MP4_MEDIA_TIMESCALE / H264_FPS;
+
+    if (sample_num > 0) {
+        sample_delta = (uint32_t)((record_stop_us - record_start_us) * MP4_MEDIA_TIMESCALE / 1000000 / sample_num);
+    }
+    if ((sps_len < 4) || (pps_len == 0)) {
+        ESP_LOGE(TAG, "No parameter sets from the encoder, the file can't be played");
+        recorder_flush();
+    } else if (mp4_write_moov(sample_delta) == ESP_OK) {
+        recorder_flush();
+    }
+
+    // Rewrite the `mdat` size now that all the samples are written
+    if (!write_failed) {
+        mp4_build_header(write_buf, mdat_size);
+        if ((fseek(record_fp, 0, SEEK_SET) != 0) || (fwrite(write_buf, 1, MP4_HEADER_SIZE, record_fp) != MP4_HEADER_SIZE)) {
+            ESP_LOGE(TAG, "Rewrite header failed");
+        }
+    }
+    fclose(record_fp);
+    record_fp = NULL;
+
+    sample_num = 0;
+    sync_num = 0;
+}
+
+static esp_err_t recorder_encode(const recorder_request_t *request, recorder_slot_t *slot)
+{
+    ppa_srm_oper_config_t srm_config = {};
+    esp_h264_enc_in_frame_t in_frame = {};
+    esp_h264_enc_out_frame_t out_frame = {};
+
+    // Centered crop to whole macroblocks, converted to the YUV420 layout the encoder reads
+    srm_config.in.buffer = request->frame;
+    srm_config.in.pic_w = record_width;
+    srm_config.in.pic_h = record_height;
+    srm_config.in.block_w = encode_width;
+    srm_config.in.block_h = encode_height;
+    srm_config.in.block_offset_x = (record_width - encode_width) / 2;
+    srm_config.in.block_offset_y = (record_height - encode_height) / 2;
+    srm_config.in.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.out.buffer = yuv_buf;
+    srm_config.out.buffer_size = yuv_buf_size;
+    srm_config.out.pic_w = encode_width;
+    srm_config.out.pic_h = encode_height;
+    srm_config.out.srm_cm = PPA_SRM_COLOR_MODE_YUV420;
+    srm_config.out.yuv_range = PPA_COLOR_RANGE_LIMIT;
+    srm_config.out.yuv_std = PPA_COLOR_CONV_STD_RGB_YUV_BT601;
+    srm_config.rotation_angle = PPA_SRM_ROTATION_ANGLE_0;
+    srm_config.scale_x = 1;
+    srm_config.scale_y = 1;
+    srm_config.mode = PPA_TRANS_MODE_BLOCKING;
+
+    esp_err_t ret = ppa_do_scale_rotate_mirror(yuv_ppa, &srm_config);
+    // The camera gets the frame back while the encoder works on the copy
+    app_video_frame_release(request->frame_index);
+    ESP_RETURN_ON_ERROR(ret, TAG, "Convert frame failed");
+
+    in_frame.raw_data.buffer = yuv_buf;
+    in_frame.raw_data.len = encode_width * encode_height * 3 / 2;
+    in_frame.pts = (uint32_t)((esp_timer_get_time() - record_start_us) / 1000);
+    out_frame.raw_data.buffer = slot->buf;
+    out_frame.raw_data.len = slot->buf_size;
+    ESP_RETURN_ON_FALSE(esp_h264_enc_process(h264_encoder, &in_frame, &out_frame) == ESP_H264_ERR_OK, ESP_FAIL, TAG,
+                        "Encode frame failed");
+    slot->size = out_frame.length;
+    slot->key_frame = (out_frame.frame_type == ESP_H264_FRAME_TYPE_IDR) || (out_frame.frame_type == ESP_H264_FRAME_TYPE_I);
+
+    return ESP_OK;
+}
+
+static esp_err_t recorder_codec_init(size_t align)
+{
+    esp_h264_enc_cfg_hw_t h264_cfg = {};
+    ppa_client_config_t ppa_config = {};
+
+    encode_width = record_width & ~(H264_MB_SIZE - 1);
+    encode_height = record_height & ~(H264_MB_SIZE - 1);
+    ESP_RETURN_ON_FALSE(encode_width && encode_height, ESP_ERR_INVALID_SIZE, TAG, "Frame smaller than a macroblock");
+
+    h264_cfg.pic_type = ESP_H264_RAW_FMT_O_UYY_E_VYY;
+    h264_cfg.gop = CONFIG_CAMERA_RECORDER_H264_GOP;
+    h264_cfg.fps = H264_FPS;
+    h264_cfg.res.width = encode_width;
+    h264_cfg.res.height = encode_height;
+    h264_cfg.rc.bitrate = CONFIG_CAMERA_RECORDER_H264_BITRATE_KBPS * 1000;
+    h264_cfg.rc.qp_min = H264_QP_MIN;
+    h264_cfg.rc.qp_max = H264_QP_MAX;
+    ESP_RETURN_ON_FALSE(esp_h264_enc_hw_new(&h264_cfg, &h264_encoder) == ESP_H264_ERR_OK, ESP_FAIL, TAG,
+                        "Create H.264 encoder failed");
+
+    ppa_config.oper_type = PPA_OPERATION_SRM;
+    ESP_RETURN_ON_ERROR(ppa_register_client(&ppa_config, &yuv_ppa), TAG, "Register PPA client failed");
+
+    // Written by the PPA and the encoder through DMA, whole cache lines keep the cache sync exact
+    yuv_buf_size = RECORDER_ALIGN_UP(encode_width * encode_height * 3 / 2, align);
+    yuv_buf = (uint8_t *)heap_caps_aligned_calloc(align, 1, yuv_buf_size, MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(yuv_buf, ESP_ERR_NO_MEM, TAG, "Allocate YUV buffer failed");
+
+    for (int i = 0; i < RECORDER_SLOT_NUM; i++) {
+        slots[i].buf_size = RECORDER_ALIGN_UP(yuv_buf_size / H264_BUF_DIV, align);
+        slots[i].buf = (uint8_t *)heap_caps_aligned_calloc(align, 1, slots[i].buf_size, MALLOC_CAP_SPIRAM);
+        ESP_RETURN_ON_FALSE(slots[i].buf, ESP_ERR_NO_MEM, TAG, "Allocate slot %d failed", i);
+    }
+
+    sync_cap = H264_SAMPLE_NUM_MAX / CONFIG_CAMERA_RECORDER_H264_GOP + 1;
+    sample_sizes = (uint32_t *)heap_caps_malloc(H264_SAMPLE_NUM_MAX * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    sample_offsets = (uint32_t *)heap_caps_malloc(H264_SAMPLE_NUM_MAX * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    sync_samples = (uint32_t *)heap_caps_malloc(sync_cap * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(sample_sizes && sample_offsets && sync_samples, ESP_ERR_NO_MEM, TAG,
+                        "Allocate sample tables failed");
+
+    ESP_LOGI(TAG, "H.264 %lux%lu at %d kbit/s, up to %d frames", (unsigned long)encode_width,
+             (unsigned long)encode_height, CONFIG_CAMERA_RECORDER_H264_BITRATE_KBPS, H264_SAMPLE_NUM_MAX);
+
+    return ESP_OK;
+}
+
+static void recorder_codec_deinit(void)
+{
+    heap_caps_free(sync_samples);
+    sync_samples = NULL;
+    heap_caps_free(sample_offsets);
+    sample_offsets = NULL;
+    heap_caps_free(sample_sizes);
+    sample_sizes = NULL;
+    for (int i = 0; i < RECORDER_SLOT_NUM; i++) {
+        if (slots[i].buf) {
+            free(slots[i].buf);
+            slots[i].buf = NULL;
+        }
+    }
+    if (yuv_buf) {
+        heap_caps_free(yuv_buf);
+        yuv_buf = NULL;
+    }
+    if (yuv_ppa) {
+        ppa_unregister_client(yuv_ppa);
+        yuv_ppa = NULL;
+    }
+    if (h264_encoder) {
+        esp_h264_enc_del(h264_encoder);
+        h264_encoder = NULL;
+    }
+}
+#else
+
+static uint8_t *avi_put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *avi_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+static uint8_t *avi_put_fourcc(uint8_t *p, const char *fourcc)
+{
+    memcpy(p, fourcc, 4);
+    return p + 4;
+}
+
+static void avi_build_header(uint8_t *hdr, uint32_t frames, uint32_t us_per_frame, uint32_t movi_size, uint32_t riff_size)
+{
+    uint8_t *p = hdr;
+    uint32_t max_bytes_per_sec = us_per_frame ? (uint32_t)((uint64_t)max_chunk_size * 1000000 / us_per_frame) : 0;
+
+    memset(hdr, 0, AVI_HEADER_SIZE);
+    p = avi_put_fourcc(p, "RIFF");
+    p = avi_put_u32(p, riff_size);
+    p = avi_put_fourcc(p, "AVI ");
+
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put_u32(p, AVI_HDRL_SIZE);
+    p = avi_put_fourcc(p, "hdrl");
+
+    // Main AVI header
+    p = avi_put_fourcc(p, "avih");
+    p = avi_put_u32(p, 56);
+    p = avi_put_u32(p, us_per_frame);
+    p = avi_put_u32(p, max_bytes_per_sec);
+    p = avi_put_u32(p, 0);
+    p = avi_put_u32(p, AVIF_HASINDEX);
+    p = avi_put_u32(p, frames);
+    p = avi_put_u32(p, 0);
+    p = avi_put_u32(p, 1);
+    p = avi_put_u32(p, max_chunk_size);
+    p = avi_put_u32(p, record_width);
+    p = avi_put_u32(p, record_height);
+    p += 16;
+
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put_u32(p, AVI_STRL_SIZE);
+    p = avi_put_fourcc(p, "strl");
+
+    // Stream header, the rate is us_per_frame/1000000 so the measured frame rate needs no rounding
+    p = avi_put_fourcc(p, "strh");
+    p = avi_put_u32(p, 56);
+    p = avi_put_fourcc(p, "vids");
+    p = avi_put_fourcc(p, "MJPG");
+    p = avi_put_u32(p, 0);
+    p = avi_put_u16(p, 0);
+    p = avi_put_u16(p, 0);
+    p = avi_put_u32(p, 0);
+    p = avi_put_u32(p, us_per_frame);
+    p = avi_put_u32(p, 1000000);
+    p = avi_put_u32(p, 0);
+    p = avi_put_u32(p, frames);
+    p = avi_put_u32(p, max_chunk_size);
+    p = avi_put_u32(p, 0xFFFFFFFF);
+    p = avi_put_u32(p, 0);
+    p = avi_put_u16(p, 0);
+    p = avi_put_u16(p, 0);
+    p = avi_put_u16(p, record_width);
+    p = avi_put_u16(p, record_height);
+
+    // Stream format, a BITMAPINFOHEADER
+    p = avi_put_fourcc(p, "strf");
+    p = avi_put_u32(p, 40);
+    p = avi_put_u32(p, 40);
+    p = avi_put_u32(p, record_width);
+    p = avi_put_u32(p, record_height);
+    p = avi_put_u16(p, 1);
+    p = avi_put_u16(p, 24);
+    p = avi_put_fourcc(p, "MJPG");
+    p = avi_put_u32(p, record_width * record_height * 3);
+    p += 16;
+
+    p = avi_put_fourcc(p, "JUNK");
+    p = avi_put_u32(p, AVI_MOVI_LIST_OFFSET - (p - hdr) - 4);
+
+    p = hdr + AVI_MOVI_LIST_OFFSET;
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put_u32(p, movi_size);
+    avi_put_fourcc(p, "movi");
+}
+
+static esp_err_t recorder_write_frame(const recorder_slot_t *slot)
+{
+    static const uint8_t pad = 0;
+    uint8_t chunk_header[8];
+
+    ESP_RETURN_ON_FALSE(!write_failed, ESP_FAIL, TAG, "Writer failed");
+
+    if (index_num == index_cap) {
+        recorder_index_entry_t *entries = (recorder_index_entry_t *)heap_caps_realloc(index_entries,
+                                           (index_cap + RECORDER_INDEX_GROW) * sizeof(recorder_index_entry_t), MALLOC_CAP_SPIRAM);
+        ESP_RETURN_ON_FALSE(entries, ESP_ERR_NO_MEM, TAG, "Grow index failed");
+        index_entries = entries;
+        index_cap += RECORDER_INDEX_GROW;
+    }
+
+    avi_put_u32(avi_put_fourcc(chunk_header, "00dc"), slot->size);
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(chunk_header, sizeof(chunk_header)), TAG, "Write chunk header failed");
+    ESP_RETURN_ON_ERROR(recorder_write_bytes(slot->buf, slot->size), TAG, "Write frame failed");
+    if (slot->size & 1) {
+        ESP_RETURN_ON_ERROR(recorder_write_bytes(&pad, 1), TAG, "Write pad failed");
+    }
+
+    recorder_index_entry_t *entry = &index_entries[index_num++];
+    memcpy(entry->ckid, "00dc", 4);
+    entry->flags = AVIIF_KEYFRAME;
+    entry->offset = movi_pos - AVI_MOVI_OFFSET;
+    entry->size = slot->size;
+
+    movi_pos += sizeof(chunk_header) + slot->size + (slot->size & 1);
+    max_chunk_size = std::max(max_chunk_size, slot->size);
+    record_stats.frames_written++;
+
+    return ESP_OK;
+}
+
+static void recorder_finalize(void)
+{
+    uint8_t idx1_header[8];
+    uint32_t idx1_size = index_num * sizeof(recorder_index_entry_t);
+    uint32_t movi_size = movi_pos - AVI_MOVI_OFFSET;
+    uint32_t us_per_frame = RECORDER_DEFAULT_US_PER_FRAME;
+
+    avi_put_u32(avi_put_fourcc(idx1_header, "idx1"), idx1_size);
+    if ((recorder_write_bytes(idx1_header, sizeof(idx1_header)) == ESP_OK) &&
+            (recorder_write_bytes(index_entries, idx1_size) == ESP_OK)) {
+        recorder_flush();
+    }
+
+    // Rewrite the header now that the frame count and the measured frame rate are known
+    if (!write_failed) {
+        if (index_num > 0) {
+            us_per_frame = (uint32_t)((record_stop_us - record_start_us) / index_num);
+        }
+        avi_build_header(write_buf, index_num, us_per_frame, movi_size, movi_pos + sizeof(idx1_header) + idx1_size - 8);
+        if ((fseek(record_fp, 0, SEEK_SET) != 0) || (fwrite(write_buf, 1, AVI_HEADER_SIZE, record_fp) != AVI_HEADER_SIZE)) {
+            ESP_LOGE(TAG, "Rewrite header failed");
+        }
+    }
+    fclose(record_fp);
+    record_fp = NULL;
+
+    heap_caps_free(index_entries);
+    index_entries = NULL;
+    index_num = 0;
+    index_cap = 0;
+}
+
+static esp_err_t recorder_encode(const recorder_request_t *request, recorder_slot_t *slot)
+{
+    jpeg_encode_cfg_t encode_cfg = {
+        .height = record_height,
+        .width = record_width,
+        .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+        .sub_sample = JPEG_DOWN_SAMPLING_YUV420,
+        .image_quality = RECORDER_JPEG_QUALITY,
+    };
+
+    esp_err_t ret = jpeg_encoder_process(jpeg_encoder, &encode_cfg, request->frame, record_width * record_height * 2,
+                                         slot->buf, slot->buf_size, &slot->size);
+    app_video_frame_release(request->frame_index);
+    slot->key_frame = true;
+
+    return ret;
+}
+
+static esp_err_t recorder_codec_init(size_t align)
+{
+    jpeg_encode_engine_cfg_t encode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = RECORDER_ENCODE_TIMEOUT_MS,
+    };
+    jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+    };
+
+    ESP_RETURN_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &jpeg_encoder), TAG, "Create JPEG encoder failed");
+
+    for (int i = 0; i < RECORDER_SLOT_NUM; i++) {
+        slots[i].buf = (uint8_t *)jpeg_alloc_encoder_mem(record_width * record_height * 2 / RECORDER_JPEG_BUF_DIV,
+                                                         &out_mem_cfg, &slots[i].buf_size);
+        ESP_RETURN_ON_FALSE(slots[i].buf, ESP_ERR_NO_MEM, TAG, "Allocate slot %d failed", i);
+    }
+
+    return ESP_OK;
+}
+
+static void recorder_codec_deinit(void)
+{
+    for (int i = 0; i < RECORDER_SLOT_NUM; i++) {
+        if (slots[i].buf) {
+            free(slots[i].buf);
+            slots[i].buf = NULL;
+        }
+    }
+    if (jpeg_encoder) {
+        jpeg_del_encoder_engine(jpeg_encoder);
+        jpeg_encoder = NULL;
+    }
+}
+#endif
+
+static void recorder_encode_task(void *arg)
+{
+    recorder_request_t request;
+    uint8_t slot_index;
+
+    while (1) {
+        if (xQueueReceive(encode_queue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // `app_recorder_push_frame` made sure a slot is free before queueing the request
+        xQueueReceive(free_queue, &slot_index, portMAX_DELAY);
+
+        // Releases the V4L2 frame
+        if (recorder_encode(&request, &slots[slot_index]) == ESP_OK) {
+            xQueueSend(write_queue, &slot_index, portMAX_DELAY);
+        } else {
+            __atomic_fetch_add(&record_stats.dropped_error, 1, __ATOMIC_RELAXED);
+            xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+        }
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void recorder_write_task(void *arg)
+{
+    uint8_t slot_index;
+
+    while (1) {
+        if (xQueueReceive(write_queue, &slot_index, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (slot_index == RECORDER_STOP_SLOT) {
+            recorder_finalize();
+            xSemaphoreGive(stop_done_sem);
+            continue;
+        }
+
+        if (recorder_write_frame(&slots[slot_index]) != ESP_OK) {
+            __atomic_fetch_add(&record_stats.dropped_error, 1, __ATOMIC_RELAXED);
+        }
+        xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+    }
+}
+
+static uint32_t recorder_next_file_index(void)
+{
+    uint32_t next = 0;
+    DIR *dir = opendir(BSP_SD_MOUNT_POINT);
+
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int index = 0;
+        if ((sscanf(entry->d_name, "VID_%4u", &index) == 1) && (index >= next)) {
+            next = index + 1;
+        }
+    }
+    closedir(dir);
+
+    return next;
+}
+
+esp_err_t app_recorder_init(uint32_t width, uint32_t height)
+{
+    esp_err_t ret = ESP_OK;
+    size_t cache_line_size = 0;
+
+    ESP_RETURN_ON_FALSE(write_buf == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    record_width = width;
+    record_height = height;
+
+    ESP_GOTO_ON_ERROR(esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &cache_line_size), err, TAG, "Get cache alignment failed");
+    cache_line_size = std::max(cache_line_size, (size_t)4);
+    ESP_GOTO_ON_ERROR(recorder_codec_init(cache_line_size), err, TAG, "Init encoder failed");
+
+    encode_queue = xQueueCreate(1, sizeof(recorder_request_t));
+    free_queue = xQueueCreate(RECORDER_SLOT_NUM, sizeof(uint8_t));
+    write_queue = xQueueCreate(RECORDER_SLOT_NUM + 1, sizeof(uint8_t));
+    stop_done_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(encode_queue && free_queue && write_queue && stop_done_sem, ESP_ERR_NO_MEM, err, TAG,
+                      "Create queues failed");
+
+    for (uint8_t i = 0; i < RECORDER_SLOT_NUM; i++) {
+        xQueueSend(free_queue, &i, 0);
+    }
+
+    // Full, cache aligned writes let the SD driver DMA straight from the buffer
+    write_buf = (uint8_t *)heap_caps_aligned_alloc(cache_line_size, RECORDER_WRITE_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(write_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate write buffer failed");
+
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_RECORDER_ENCODE, recorder_encode_task, NULL, NULL) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create encode task failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_RECORDER_WRITE, recorder_write_task, NULL, NULL) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create write task failed");
+
+    return ESP_OK;
+
+err:
+    // Tasks are created last, nothing references the resources below yet
+    if (write_buf) {
+        heap_caps_free(write_buf);
+        write_buf = NULL;
+    }
+    if (stop_done_sem) {
+        vSemaphoreDelete(stop_done_sem);
+        stop_done_sem = NULL;
+    }
+    if (write_queue) {
+        vQueueDelete(write_queue);
+        write_queue = NULL;
+    }
+    if (free_queue) {
+        vQueueDelete(free_queue);
+        free_queue = NULL;
+    }
+    if (encode_queue) {
+        vQueueDelete(encode_queue);
+        encode_queue = NULL;
+    }
+    recorder_codec_deinit();
+
+    return ret;
+}
+
+esp_err_t app_recorder_start(void)
+{
+    char path[RECORDER_PATH_LEN_MAX];
+
+    ESP_RETURN_ON_FALSE(write_buf, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(!__atomic_load_n(&recording, __ATOMIC_SEQ_CST), ESP_ERR_INVALID_STATE, TAG, "Already recording");
+
+    snprintf(path, sizeof(path), RECORDER_FILE_FMT, (unsigned long)recorder_next_file_index());
+    record_fp = fopen(path, "wb");
+    ESP_RETURN_ON_FALSE(record_fp, ESP_FAIL, TAG, "Open %s failed", path);
+    // Writes are already buffered in large aligned blocks
+    setvbuf(record_fp, NULL, _IONBF, 0);
+
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+    // Every recording starts with an IDR frame and its parameter sets
+    if (esp_h264_enc_open(h264_encoder) != ESP_H264_ERR_OK) {
+        ESP_LOGE(TAG, "Open H.264 encoder failed");
+        fclose(record_fp);
+        record_fp = NULL;
+        return ESP_FAIL;
+    }
+#endif
+
+    memset(&record_stats, 0, sizeof(record_stats));
+    write_failed = false;
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+    sps_len = 0;
+    pps_len = 0;
+    mdat_pos = MP4_HEADER_SIZE;
+    mp4_build_header(write_buf, 8);
+    write_len = MP4_HEADER_SIZE;
+#else
+    max_chunk_size = 0;
+    movi_pos = AVI_HEADER_SIZE;
+    avi_build_header(write_buf, 0, RECORDER_DEFAULT_US_PER_FRAME, 4, 0);
+    write_len = AVI_HEADER_SIZE;
+#endif
+    record_start_us = esp_timer_get_time();
+
+    __atomic_store_n(&recording, true, __ATOMIC_SEQ_CST);
+    ESP_LOGI(TAG, "Recording to %s", path);
+
+    return ESP_OK;
+}
+
+esp_err_t app_recorder_stop(app_recorder_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(__atomic_load_n(&recording, __ATOMIC_SEQ_CST), ESP_ERR_INVALID_STATE, TAG, "Not recording");
+
+    __atomic_store_n(&recording, false, __ATOMIC_SEQ_CST);
+    record_stop_us = esp_timer_get_time();
+
+    // Let the frame being encoded reach the writer queue, the stop marker must come after it
+    TickType_t wait_ticks = pdMS_TO_TICKS(RECORDER_STOP_WAIT_MS);
+    while ((wait_ticks-- > 0) && __atomic_load_n(&encode_busy, __ATOMIC_SEQ_CST)) {
+        vTaskDelay(1);
+    }
+
+    uint8_t stop = RECORDER_STOP_SLOT;
+    xQueueSend(write_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(stop_done_sem, portMAX_DELAY);
+#if CONFIG_CAMERA_RECORDER_FORMAT_H264
+    esp_h264_enc_close(h264_encoder);
+#endif
+
+    ESP_LOGI(TAG, "Recorded %lu frames (%llu bytes), dropped %lu busy, %lu writer full, %lu errors",
+             (unsigned long)record_stats.frames_written, record_stats.bytes_written,
+             (unsigned long)record_stats.dropped_encoder_busy, (unsigned long)record_stats.dropped_writer_full,
+             (unsigned long)record_stats.dropped_error);
+    if (stats) {
+        *stats = record_stats;
+    }
+
+    return ESP_OK;
+}
+
+bool app_recorder_is_recording(void)
+{
+    return __atomic_load_n(&recording, __ATOMIC_SEQ_CST);
+}
+
+esp_err_t app_recorder_push_frame(uint8_t *frame, uint8_t frame_index)
+{
+    bool expected = false;
+
+    if (!__atomic_load_n(&recording, __ATOMIC_SEQ_CST)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!__atomic_compare_exchange_n(&encode_busy, &expected, true, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        record_stats.dropped_encoder_busy++;
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    // Checked again after claiming the encoder, so `app_recorder_stop` never misses an in-flight frame
+    if (!__atomic_load_n(&recording, __ATOMIC_SEQ_CST)) {
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (uxQueueMessagesWaiting(free_queue) == 0) {
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+        record_stats.dropped_writer_full++;
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    if (app_video_frame_acquire(frame_index) != ESP_OK) {
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    recorder_request_t request = {
+        .frame = frame,
+        .frame_index = frame_index,
+    };
+    xQueueSend(encode_queue, &request, 0);
+
+    return ESP_OK;
+}
+
+void app_recorder_get_stats(app_recorder_stats_t *stats)
+{
+    if (stats) {
+        *stats = record_stats;
+    }
+}
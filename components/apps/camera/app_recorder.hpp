@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Recording statistics, reset by every `app_recorder_start`.
+ */
+typedef struct {
+    uint32_t frames_written;        /*!< Frames stored in the file. */
+    uint32_t dropped_encoder_busy;  /*!< Frames dropped because the previous frame was still being encoded. */
+    uint32_t dropped_writer_full;   /*!< Frames dropped because the SD card writer fell behind. */
+    uint32_t dropped_error;         /*!< Frames lost to encoder or write errors. */
+    uint64_t bytes_written;         /*!< Bytes written to the file, headers included. */
+} app_recorder_stats_t;
+
+/**
+ * @brief Initialize the recorder.
+ *
+ * Creates the hardware encoder, the encoded frame slots, the aligned write buffer and the encoder and writer tasks.
+ * Recordings are files in the root of the SD card: AVI/MJPEG by default, where the video player finds them, or
+ * MP4/H.264 with `CONFIG_CAMERA_RECORDER_FORMAT_H264`. H.264 frames are converted to YUV420 by the PPA and cropped
+ * to a multiple of 16 pixels, the MP4 sample tables are allocated here for `CONFIG_CAMERA_RECORDER_H264_MAX_MINUTES`.
+ *
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t app_recorder_init(uint32_t width, uint32_t height);
+
+/**
+ * @brief Start a new recording.
+ *
+ * @return
+ *      - ESP_OK: Recording started
+ *      - ESP_ERR_INVALID_STATE: Not initialized or already recording
+ *      - ESP_FAIL: Failed to create the file
+ */
+esp_err_t app_recorder_start(void);
+
+/**
+ * @brief Stop the current recording and finalize the file.
+ *
+ * Blocks until the pending frames, the index and the header are written.
+ *
+ * @param stats Statistics of the finished recording, can be NULL.
+ *
+ * @return
+ *      - ESP_OK: Recording stopped
+ *      - ESP_ERR_INVALID_STATE: Not recording
+ */
+esp_err_t app_recorder_stop(app_recorder_stats_t *stats);
+
+/**
+ * @brief Check whether a recording is in progress.
+ */
+bool app_recorder_is_recording(void);
+
+/**
+ * @brief Offer a V4L2 frame to the recorder.
+ *
+ * Never blocks: the frame is referenced and handed to the encoder task, or dropped and counted when the encoder or
+ * the SD card can't keep up. Must be called while the caller holds a reference on the frame, and nothing may be
+ * drawn into a queued frame.
+ *
+ * @param frame RGB565 frame.
+ * @param frame_index V4L2 buffer index of the frame.
+ *
+ * @return ESP_OK if the frame was queued, ESP_ERR_INVALID_STATE if not recording, ESP_ERR_NOT_FINISHED if dropped.
+ */
+esp_err_t app_recorder_push_frame(uint8_t *frame, uint8_t frame_index);
+
+/**
+ * @brief Get the statistics of the current or last recording.
+ *
+ * @param stats Output statistics.
+ */
+void app_recorder_get_stats(app_recorder_stats_t *stats);
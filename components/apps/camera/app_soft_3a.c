@@ -0,0 +1,298 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "linux/videodev2.h"
+#include "app_soft_3a.h"
+
+#define SOFT_3A_GRID_W                      (64)
+#define SOFT_3A_GRID_H                      (48)
+#define SOFT_3A_LUMA_SHADOW                 (16)    // Samples darker or brighter than these don't tell the color of the light
+#define SOFT_3A_LUMA_HIGHLIGHT              (235)
+
+void app_soft_3a_compute_stats(const uint16_t *frame, uint32_t width, uint32_t height, app_soft_3a_stats_t *stats)
+{
+    uint32_t step_x = (width > SOFT_3A_GRID_W) ? (width / SOFT_3A_GRID_W) : 1;
+    uint32_t step_y = (height > SOFT_3A_GRID_H) ? (height / SOFT_3A_GRID_H) : 1;
+    uint32_t sum_luma = 0;
+
+    memset(stats, 0, sizeof(*stats));
+
+    // Start half a step in, so the samples are centered in their cells
+    for (uint32_t y = step_y / 2; y < height; y += step_y) {
+        const uint16_t *line = frame + y * width;
+
+        for (uint32_t x = step_x / 2; x < width; x += step_x) {
+            uint16_t pixel = line[x];
+            uint32_t r = (pixel >> 11) & 0x1f;
+            uint32_t g = (pixel >> 5) & 0x3f;
+            uint32_t b = pixel & 0x1f;
+
+            r = (r << 3) | (r >> 2);
+            g = (g << 2) | (g >> 4);
+            b = (b << 3) | (b >> 2);
+
+            uint32_t luma = (77 * r + 150 * g + 29 * b) >> 8;
+
+            stats->hist[luma * APP_SOFT_3A_HIST_BINS / 256]++;
+            sum_luma += luma;
+            if ((luma >= SOFT_3A_LUMA_SHADOW) && (luma <= SOFT_3A_LUMA_HIGHLIGHT)) {
+                stats->sum_r += r;
+                stats->sum_g += g;
+                stats->sum_b += b;
+            }
+            stats->samples++;
+        }
+    }
+
+    if (stats->samples) {
+        stats->mean_luma = sum_luma / stats->samples;
+        stats->clipped = stats->hist[APP_SOFT_3A_HIST_BINS - 1];
+    }
+}
+
+#if CONFIG_CAMERA_SOFT_3A
+
+#define SOFT_3A_FRAME_INTERVAL              (CONFIG_CAMERA_SOFT_3A_FRAME_INTERVAL)
+#define SOFT_3A_TARGET_LUMA                 (CONFIG_CAMERA_SOFT_3A_TARGET_LUMA)
+#define SOFT_3A_CLIP_PERCENT                (5)     // Don't brighten once this share of the frame is saturated
+#define SOFT_3A_GAIN_STEPS                  (32)    // Smallest gain move is this fraction of the gain range
+#define SOFT_3A_RATIO_ONE                   (256)
+
+typedef enum {
+    SOFT_3A_CTRL_EXPOSURE = 0,
+    SOFT_3A_CTRL_GAIN,
+    SOFT_3A_CTRL_RED_BALANCE,
+    SOFT_3A_CTRL_BLUE_BALANCE,
+    SOFT_3A_CTRL_MAX,
+} soft_3a_ctrl_index_t;
+
+typedef struct {
+    uint32_t id;
+    bool valid;         /*!< The sensor driver exposes the control. */
+    int32_t min;
+    int32_t max;
+    int32_t step;
+    int32_t value;      /*!< Last value written, the loop is the only writer */
+} soft_3a_ctrl_t;
+
+static const char *TAG = "app_soft_3a";
+
+static soft_3a_ctrl_t soft_3a_ctrls[SOFT_3A_CTRL_MAX] = {
+    [SOFT_3A_CTRL_EXPOSURE]     = { .id = V4L2_CID_EXPOSURE_ABSOLUTE },
+    [SOFT_3A_CTRL_GAIN]         = { .id = V4L2_CID_GAIN },
+    [SOFT_3A_CTRL_RED_BALANCE]  = { .id = V4L2_CID_RED_BALANCE },
+    [SOFT_3A_CTRL_BLUE_BALANCE] = { .id = V4L2_CID_BLUE_BALANCE },
+};
+static int soft_3a_fd = -1;
+static uint32_t soft_3a_frame_count = 0;
+
+static esp_err_t soft_3a_write_ctrl(uint32_t id, int32_t value)
+{
+    struct v4l2_ext_control control = {
+        .id = id,
+        .value = value,
+    };
+    struct v4l2_ext_controls controls = {
+        .ctrl_class = V4L2_CTRL_ID2CLASS(id),
+        .count = 1,
+        .controls = &control,
+    };
+
+    return (ioctl(soft_3a_fd, VIDIOC_S_EXT_CTRLS, &controls) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static void soft_3a_probe_ctrl(soft_3a_ctrl_t *ctrl)
+{
+    struct v4l2_queryctrl qctrl = {
+        .id = ctrl->id,
+    };
+
+    if ((ioctl(soft_3a_fd, VIDIOC_QUERYCTRL, &qctrl) != 0) || (qctrl.flags & V4L2_CTRL_FLAG_DISABLED) ||
+            (qctrl.maximum <= qctrl.minimum)) {
+        return;
+    }
+
+    struct v4l2_ext_control control = {
+        .id = ctrl->id,
+    };
+    struct v4l2_ext_controls controls = {
+        .ctrl_class = V4L2_CTRL_ID2CLASS(ctrl->id),
+        .count = 1,
+        .controls = &control,
+    };
+
+    ctrl->min = qctrl.minimum;
+    ctrl->max = qctrl.maximum;
+    ctrl->step = (qctrl.step > 0) ? qctrl.step : 1;
+    ctrl->value = (ioctl(soft_3a_fd, VIDIOC_G_EXT_CTRLS, &controls) == 0) ? control.value : qctrl.default_value;
+    ctrl->valid = true;
+}
+
+static void soft_3a_set_ctrl(soft_3a_ctrl_t *ctrl, int32_t value)
+{
+    if (value < ctrl->min) {
+        value = ctrl->min;
+    } else if (value > ctrl->max) {
+        value = ctrl->max;
+    }
+    if (value == ctrl->value) {
+        return;
+    }
+
+    // The sensor drivers keep their registers shadowed, a write costs no read back
+    if (soft_3a_write_ctrl(ctrl->id, value) == ESP_OK) {
+        ctrl->value = value;
+    } else {
+        ESP_LOGD(TAG, "Set control 0x%" PRIx32 " to %" PRId32 " failed", ctrl->id, value);
+    }
+}
+
+/* Scale a control by a ratio in 1/256, moving it at least one step */
+static void soft_3a_scale_ctrl(soft_3a_ctrl_t *ctrl, int32_t ratio)
+{
+    int32_t value = (int32_t)(((int64_t)ctrl->value * ratio) / SOFT_3A_RATIO_ONE);
+
+    if ((ratio > SOFT_3A_RATIO_ONE) && (value < ctrl->value + ctrl->step)) {
+        value = ctrl->value + ctrl->step;
+    } else if ((ratio < SOFT_3A_RATIO_ONE) && (value > ctrl->value - ctrl->step)) {
+        value = ctrl->value - ctrl->step;
+    }
+    soft_3a_set_ctrl(ctrl, value);
+}
+
+/* Half of the measured correction per run, so the loop settles in a few runs without oscillating */
+static int32_t soft_3a_damped_ratio(uint32_t target, uint32_t measured)
+{
+    int32_t ratio = (int32_t)(((uint64_t)target * SOFT_3A_RATIO_ONE) / (measured ? measured : 1));
+
+    if (ratio < SOFT_3A_RATIO_ONE / 2) {
+        ratio = SOFT_3A_RATIO_ONE / 2;
+    } else if (ratio > SOFT_3A_RATIO_ONE * 2) {
+        ratio = SOFT_3A_RATIO_ONE * 2;
+    }
+
+    return (SOFT_3A_RATIO_ONE + ratio) / 2;
+}
+
+static void soft_3a_run_ae(const app_soft_3a_stats_t *stats)
+{
+    soft_3a_ctrl_t *exposure = &soft_3a_ctrls[SOFT_3A_CTRL_EXPOSURE];
+    soft_3a_ctrl_t *gain = &soft_3a_ctrls[SOFT_3A_CTRL_GAIN];
+    int32_t error = (int32_t)stats->mean_luma - SOFT_3A_TARGET_LUMA;
+    int32_t gain_step = 0;
+
+    if (abs(error) * 8 <= SOFT_3A_TARGET_LUMA) {
+        return;
+    }
+
+    int32_t ratio = soft_3a_damped_ratio(SOFT_3A_TARGET_LUMA, stats->mean_luma);
+
+    if (gain->valid) {
+        gain_step = (gain->max - gain->min) / SOFT_3A_GAIN_STEPS;
+        gain_step = (gain_step > gain->step) ? gain_step : gain->step;
+    }
+
+    // Exposure is raised first and gain lowered first, gain only adds noise
+    if (error < 0) {
+        if (stats->clipped * 100 > stats->samples * SOFT_3A_CLIP_PERCENT) {
+            return;
+        }
+        if (exposure->valid && (exposure->value < exposure->max)) {
+            soft_3a_scale_ctrl(exposure, ratio);
+        } else if (gain->valid) {
+            soft_3a_set_ctrl(gain, gain->value + gain_step);
+        }
+    } else {
+        if (gain->valid && (gain->value > gain->min)) {
+            soft_3a_set_ctrl(gain, gain->value - gain_step);
+        } else if (exposure->valid) {
+            soft_3a_scale_ctrl(exposure, ratio);
+        }
+    }
+}
+
+static void soft_3a_run_awb_channel(soft_3a_ctrl_t *ctrl, uint32_t sum_g, uint32_t sum_c)
+{
+    if (!ctrl->valid || (sum_c == 0)) {
+        return;
+    }
+
+    // Gray world, a 3% cast is left alone
+    int32_t ratio = soft_3a_damped_ratio(sum_g, sum_c);
+    if (abs(ratio - SOFT_3A_RATIO_ONE) * 64 <= SOFT_3A_RATIO_ONE) {
+        return;
+    }
+    soft_3a_scale_ctrl(ctrl, ratio);
+}
+
+static void soft_3a_run_awb(const app_soft_3a_stats_t *stats)
+{
+    if (stats->sum_g == 0) {
+        return;
+    }
+
+    soft_3a_run_awb_channel(&soft_3a_ctrls[SOFT_3A_CTRL_RED_BALANCE], stats->sum_g, stats->sum_r);
+    soft_3a_run_awb_channel(&soft_3a_ctrls[SOFT_3A_CTRL_BLUE_BALANCE], stats->sum_g, stats->sum_b);
+}
+
+esp_err_t app_soft_3a_init(int video_fd)
+{
+    ESP_RETURN_ON_FALSE(video_fd >= 0, ESP_ERR_INVALID_ARG, TAG, "Invalid video fd");
+
+    soft_3a_fd = video_fd;
+    soft_3a_frame_count = 0;
+    for (int i = 0; i < SOFT_3A_CTRL_MAX; i++) {
+        soft_3a_ctrls[i].valid = false;
+        soft_3a_probe_ctrl(&soft_3a_ctrls[i]);
+    }
+
+    bool has_ae = soft_3a_ctrls[SOFT_3A_CTRL_EXPOSURE].valid || soft_3a_ctrls[SOFT_3A_CTRL_GAIN].valid;
+    bool has_awb = soft_3a_ctrls[SOFT_3A_CTRL_RED_BALANCE].valid || soft_3a_ctrls[SOFT_3A_CTRL_BLUE_BALANCE].valid;
+    if (!has_ae && !has_awb) {
+        soft_3a_fd = -1;
+        ESP_LOGW(TAG, "Sensor has no exposure or white balance controls");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Not every sensor has them, a failure just means there is nothing to turn off
+    if (has_ae) {
+        soft_3a_write_ctrl(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL);
+        soft_3a_write_ctrl(V4L2_CID_AUTOGAIN, 0);
+    }
+    if (has_awb) {
+        soft_3a_write_ctrl(V4L2_CID_AUTO_WHITE_BALANCE, 0);
+    }
+    ESP_LOGI(TAG, "Software 3A started, AE %s, AWB %s", has_ae ? "on" : "off", has_awb ? "on" : "off");
+
+    return ESP_OK;
+}
+
+void app_soft_3a_process_frame(const uint16_t *frame, uint32_t width, uint32_t height)
+{
+    app_soft_3a_stats_t stats;
+
+    if ((soft_3a_fd < 0) || (soft_3a_frame_count++ % SOFT_3A_FRAME_INTERVAL) != 0) {
+        return;
+    }
+
+    app_soft_3a_compute_stats(frame, width, height, &stats);
+    if (stats.samples == 0) {
+        return;
+    }
+    soft_3a_run_ae(&stats);
+    soft_3a_run_awb(&stats);
+    ESP_LOGD(TAG, "luma %" PRIu32 ", clipped %" PRIu32 "/%" PRIu32 ", exposure %" PRId32 ", gain %" PRId32,
+             stats.mean_luma, stats.clipped, stats.samples, soft_3a_ctrls[SOFT_3A_CTRL_EXPOSURE].value,
+             soft_3a_ctrls[SOFT_3A_CTRL_GAIN].value);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef APP_SOFT_3A_H
+#define APP_SOFT_3A_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_SOFT_3A_HIST_BINS               (64)    /*!< Luminance histogram bins, 4 levels each. */
+
+/**
+ * @brief Statistics of one subsampled RGB565 frame.
+ */
+typedef struct {
+    uint32_t hist[APP_SOFT_3A_HIST_BINS];   /*!< Luminance histogram of all samples. */
+    uint32_t samples;                       /*!< Number of sampled pixels. */
+    uint32_t mean_luma;                     /*!< Mean luminance of all samples, 0-255. */
+    uint32_t clipped;                       /*!< Samples in the top histogram bin. */
+    uint32_t sum_r;                         /*!< Sum of the 8-bit red values of the mid-tone samples. */
+    uint32_t sum_g;                         /*!< Sum of the 8-bit green values of the mid-tone samples. */
+    uint32_t sum_b;                         /*!< Sum of the 8-bit blue values of the mid-tone samples. */
+} app_soft_3a_stats_t;
+
+/**
+ * @brief Compute the statistics of an RGB565 frame on a grid of at most 64x48 samples.
+ *
+ * @param frame RGB565 pixels.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param stats Output statistics.
+ */
+void app_soft_3a_compute_stats(const uint16_t *frame, uint32_t width, uint32_t height, app_soft_3a_stats_t *stats);
+
+#if CONFIG_CAMERA_SOFT_3A
+/**
+ * @brief Take over exposure, gain and white balance of the sensor behind a video device.
+ *
+ * Only the controls the sensor driver exposes are used, the automatic modes of the sensor are turned off.
+ *
+ * @param video_fd File descriptor of the opened video device.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the sensor has neither exposure nor white balance controls.
+ */
+esp_err_t app_soft_3a_init(int video_fd);
+
+/**
+ * @brief Feed a frame, every CONFIG_CAMERA_SOFT_3A_FRAME_INTERVAL frames the statistics are updated and the sensor adjusted.
+ *
+ * Must be called from the video stream task.
+ *
+ * @param frame RGB565 pixels.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ */
+void app_soft_3a_process_frame(const uint16_t *frame, uint32_t width, uint32_t height);
+#else
+static inline esp_err_t app_soft_3a_init(int video_fd) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void app_soft_3a_process_frame(const uint16_t *frame, uint32_t width, uint32_t height) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
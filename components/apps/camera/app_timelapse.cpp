@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "sdkconfig.h"
+
+#if CONFIG_CAMERA_TIMELAPSE
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "backlight/backlight.h"
+#include "settings_store/settings_store.h"
+#include "task_config/task_config.h"
+#include "app_camera_service.h"
+#include "app_timelapse.hpp"
+
+#define TIMELAPSE_INTERVAL_MIN_MS           (1000)
+#define TIMELAPSE_SHOT_TIMEOUT_MS           (5000)  // A shot that never reports back doesn't keep the sensor on
+#define TIMELAPSE_DIM_BRIGHTNESS            (5)
+#define TIMELAPSE_FADE_MS                   (300)
+
+typedef enum {
+    TIMELAPSE_STATE_IDLE = 0,
+    TIMELAPSE_STATE_SETTLING,               // Streaming, frames are counted until the exposure settled
+    TIMELAPSE_STATE_CAPTURING,              // The shot is with the capture service
+    TIMELAPSE_STATE_STANDBY,                // Stream off, waiting for the timer
+} timelapse_state_t;
+
+typedef enum {
+    TIMELAPSE_EVENT_WAKE = BIT(0),
+    TIMELAPSE_EVENT_SHOT_DONE = BIT(1),
+    TIMELAPSE_EVENT_STOP = BIT(2),
+    TIMELAPSE_EVENT_STOPPED = BIT(3),
+} timelapse_event_t;
+
+static const char *TAG = "app_timelapse";
+
+static TaskHandle_t timelapse_task_handle = NULL;
+static EventGroupHandle_t timelapse_events = NULL;
+static esp_timer_handle_t timelapse_timer = NULL;
+// The state and the frames left are shared with the stream task and the capture task
+static portMUX_TYPE timelapse_lock = portMUX_INITIALIZER_UNLOCKED;
+static timelapse_state_t timelapse_state = TIMELAPSE_STATE_IDLE;
+static uint32_t timelapse_settle_left = 0;
+// Only used by the time-lapse task once started
+static uint32_t timelapse_interval_ms = 0;
+static uint8_t timelapse_settle_frames = 0;
+static int timelapse_dim_level = -1;        // Brightness set while dimmed, -1 if not dimmed
+static int64_t timelapse_cycle_us = 0;      // Wake up time of the current shot
+static int64_t timelapse_state_us = 0;      // Start of the current streaming or standby period
+static app_timelapse_stats_t timelapse_stats;
+
+static timelapse_state_t timelapse_get_state(void)
+{
+    portENTER_CRITICAL(&timelapse_lock);
+    timelapse_state_t state = timelapse_state;
+    portEXIT_CRITICAL(&timelapse_lock);
+
+    return state;
+}
+
+static void timelapse_set_state(timelapse_state_t state, uint32_t settle_frames)
+{
+    portENTER_CRITICAL(&timelapse_lock);
+    timelapse_state = state;
+    timelapse_settle_left = settle_frames;
+    portEXIT_CRITICAL(&timelapse_lock);
+}
+
+static void timelapse_timer_cb(void *arg)
+{
+    xEventGroupSetBits(timelapse_events, TIMELAPSE_EVENT_WAKE);
+}
+
+static void timelapse_standby(void)
+{
+    // The stream goes off for all subscribers once they are done with the current frame, the sensor goes to standby
+    app_camera_service_suspend();
+
+    int64_t now_us = esp_timer_get_time();
+    timelapse_stats.streaming_us += now_us - timelapse_state_us;
+    timelapse_state_us = now_us;
+    timelapse_set_state(TIMELAPSE_STATE_STANDBY, 0);
+
+    // Late shots are taken right away, the interval is kept from wake up to wake up
+    int64_t delay_us = timelapse_cycle_us + (int64_t)timelapse_interval_ms * 1000 - now_us;
+    esp_timer_start_once(timelapse_timer, std::max<int64_t>(delay_us, 1));
+}
+
+static void timelapse_wake(void)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    timelapse_stats.standby_us += now_us - timelapse_state_us;
+    timelapse_state_us = now_us;
+    timelapse_cycle_us = now_us;
+    // Counted from the first frame, the state must be set before the stream task runs
+    timelapse_set_state(TIMELAPSE_STATE_SETTLING, timelapse_settle_frames);
+    if (app_camera_service_resume() != ESP_OK) {
+        ESP_LOGE(TAG, "Restart stream failed");
+    }
+}
+
+static void timelapse_finish(void)
+{
+    esp_timer_stop(timelapse_timer);
+    if (timelapse_get_state() == TIMELAPSE_STATE_STANDBY) {
+        timelapse_wake();
+    }
+    timelapse_stats.streaming_us += esp_timer_get_time() - timelapse_state_us;
+    timelapse_set_state(TIMELAPSE_STATE_IDLE, 0);
+
+    // Left alone if the screen saver changed the backlight meanwhile
+    if ((timelapse_dim_level >= 0) && (backlight_get() == timelapse_dim_level)) {
+        backlight_set(settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS), TIMELAPSE_FADE_MS);
+    }
+    timelapse_dim_level = -1;
+
+    uint64_t total_us = std::max<uint64_t>(timelapse_stats.standby_us + timelapse_stats.streaming_us, 1);
+    ESP_LOGI(TAG, "Stopped after %" PRIu32 " shots (%" PRIu32 " failed), sensor in standby %" PRIu64 "%% of the time",
+             timelapse_stats.shots, timelapse_stats.failed, timelapse_stats.standby_us * 100 / total_us);
+}
+
+static void timelapse_task(void *arg)
+{
+    int64_t capture_us = 0;
+
+    while (1) {
+        EventBits_t bits = xEventGroupWaitBits(timelapse_events,
+                                               TIMELAPSE_EVENT_WAKE | TIMELAPSE_EVENT_SHOT_DONE | TIMELAPSE_EVENT_STOP,
+                                               pdTRUE, pdFALSE, pdMS_TO_TICKS(TIMELAPSE_SHOT_TIMEOUT_MS / 2));
+        timelapse_state_t state = timelapse_get_state();
+
+        if (bits & TIMELAPSE_EVENT_STOP) {
+            if (state != TIMELAPSE_STATE_IDLE) {
+                timelapse_finish();
+            }
+            capture_us = 0;
+            xEventGroupSetBits(timelapse_events, TIMELAPSE_EVENT_STOPPED);
+            continue;
+        }
+
+        if (state == TIMELAPSE_STATE_CAPTURING) {
+            if (capture_us == 0) {
+                capture_us = esp_timer_get_time();
+            }
+            if (!(bits & TIMELAPSE_EVENT_SHOT_DONE) &&
+                    (esp_timer_get_time() - capture_us < TIMELAPSE_SHOT_TIMEOUT_MS * 1000)) {
+                continue;
+            }
+            if (!(bits & TIMELAPSE_EVENT_SHOT_DONE)) {
+                ESP_LOGW(TAG, "Shot timed out");
+                timelapse_stats.failed++;
+            }
+            capture_us = 0;
+            timelapse_standby();
+        } else if ((state == TIMELAPSE_STATE_STANDBY) && (bits & TIMELAPSE_EVENT_WAKE)) {
+            timelapse_wake();
+        }
+    }
+}
+
+esp_err_t app_timelapse_init(void)
+{
+    if (timelapse_task_handle) {
+        return ESP_OK;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = timelapse_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "timelapse",
+        .skip_unhandled_events = true,
+    };
+    timelapse_events = xEventGroupCreate();
+    ESP_RETURN_ON_FALSE(timelapse_events, ESP_ERR_NO_MEM, TAG, "Create event group failed");
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &timelapse_timer), TAG, "Create timer failed");
+
+    if (task_config_create(TASK_CONFIG_CAMERA_TIMELAPSE, timelapse_task, NULL, &timelapse_task_handle) != pdPASS) {
+        esp_timer_delete(timelapse_timer);
+        timelapse_timer = NULL;
+        ESP_LOGE(TAG, "Create task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t app_timelapse_start(uint32_t interval_ms, uint8_t settle_frames, bool dim_display)
+{
+    ESP_RETURN_ON_FALSE(timelapse_task_handle, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(interval_ms >= TIMELAPSE_INTERVAL_MIN_MS, ESP_ERR_INVALID_ARG, TAG, "Interval too short");
+    ESP_RETURN_ON_FALSE(timelapse_get_state() == TIMELAPSE_STATE_IDLE, ESP_ERR_INVALID_STATE, TAG, "Already running");
+
+    memset(&timelapse_stats, 0, sizeof(timelapse_stats));
+    timelapse_interval_ms = interval_ms;
+    timelapse_settle_frames = settle_frames;
+    timelapse_cycle_us = esp_timer_get_time();
+    timelapse_state_us = timelapse_cycle_us;
+    xEventGroupClearBits(timelapse_events, TIMELAPSE_EVENT_WAKE | TIMELAPSE_EVENT_SHOT_DONE | TIMELAPSE_EVENT_STOPPED);
+    if (dim_display) {
+        timelapse_dim_level = std::min(backlight_get(), TIMELAPSE_DIM_BRIGHTNESS);
+        backlight_set(timelapse_dim_level, TIMELAPSE_FADE_MS);
+    }
+    // The stream is already running, the first shot is taken once it settled
+    timelapse_set_state(TIMELAPSE_STATE_SETTLING, settle_frames);
+    ESP_LOGI(TAG, "Started, a shot every %" PRIu32 " ms after %d frames", interval_ms, settle_frames);
+
+    return ESP_OK;
+}
+
+esp_err_t app_timelapse_stop(void)
+{
+    ESP_RETURN_ON_FALSE(timelapse_task_handle && (timelapse_get_state() != TIMELAPSE_STATE_IDLE), ESP_ERR_INVALID_STATE,
+                        TAG, "Not running");
+
+    xEventGroupSetBits(timelapse_events, TIMELAPSE_EVENT_STOP);
+    xEventGroupWaitBits(timelapse_events, TIMELAPSE_EVENT_STOPPED, pdTRUE, pdTRUE, portMAX_DELAY);
+
+    return ESP_OK;
+}
+
+bool app_timelapse_is_running(void)
+{
+    return timelapse_get_state() != TIMELAPSE_STATE_IDLE;
+}
+
+bool app_timelapse_frame(void)
+{
+    bool shot = false;
+
+    portENTER_CRITICAL(&timelapse_lock);
+    if (timelapse_state == TIMELAPSE_STATE_SETTLING) {
+        if (timelapse_settle_left > 0) {
+            timelapse_settle_left--;
+        } else {
+            timelapse_state = TIMELAPSE_STATE_CAPTURING;
+            shot = true;
+        }
+    }
+    portEXIT_CRITICAL(&timelapse_lock);
+
+    return shot;
+}
+
+void app_timelapse_shot_done(esp_err_t result)
+{
+    // Shots of the shutter button report here too
+    if (timelapse_get_state() != TIMELAPSE_STATE_CAPTURING) {
+        return;
+    }
+
+    if (result == ESP_OK) {
+        timelapse_stats.shots++;
+    } else {
+        timelapse_stats.failed++;
+    }
+    xEventGroupSetBits(timelapse_events, TIMELAPSE_EVENT_SHOT_DONE);
+}
+
+void app_timelapse_get_stats(app_timelapse_stats_t *stats)
+{
+    *stats = timelapse_stats;
+}
+#endif /* CONFIG_CAMERA_TIMELAPSE */
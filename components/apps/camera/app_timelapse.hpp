@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Counters of the current or last time-lapse.
+ */
+typedef struct {
+    uint32_t shots;                         /*!< Shots written to the SD card. */
+    uint32_t failed;                        /*!< Shots that could not be encoded or written. */
+    uint64_t standby_us;                    /*!< Time the sensor spent in standby. */
+    uint64_t streaming_us;                  /*!< Time the sensor spent streaming. */
+} app_timelapse_stats_t;
+
+/**
+ * @brief Create the time-lapse task, the stream is stopped and restarted through the camera service.
+ *
+ * @return ESP_OK on success or if already initialized, ESP_ERR_NO_MEM.
+ */
+esp_err_t app_timelapse_init(void);
+
+/**
+ * @brief Start taking a shot at a fixed interval.
+ *
+ * Between shots the camera service suspends the stream, which puts the sensor in standby, and an esp_timer wakes it
+ * up for the next shot. After a wake up `settle_frames` frames go by for the exposure to settle, the next one is
+ * handed to the capture service, JPEG encoded and written to the SD card, then the sensor goes back to standby. The
+ * preview shows the last frame in between. No subscriber of the camera service gets frames in standby.
+ *
+ * @param interval_ms Time between two shots, at least the time it takes to settle and write one.
+ * @param settle_frames Frames skipped after each wake up.
+ * @param dim_display Whether to dim the backlight until `app_timelapse_stop`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not initialized or already running, ESP_ERR_INVALID_ARG.
+ */
+esp_err_t app_timelapse_start(uint32_t interval_ms, uint8_t settle_frames, bool dim_display);
+
+/**
+ * @brief Stop the time-lapse and leave the sensor streaming.
+ *
+ * Blocks until the stream runs again. Must not be called from the stream task.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not running.
+ */
+esp_err_t app_timelapse_stop(void);
+
+/**
+ * @brief Check whether a time-lapse is running.
+ */
+bool app_timelapse_is_running(void);
+
+/**
+ * @brief Count a frame of the stream, called from the frame operation callback.
+ *
+ * @return true if the frame is the shot and must be handed to `app_capture_shot`.
+ */
+bool app_timelapse_frame(void);
+
+/**
+ * @brief Report the outcome of the shot, from the capture done callback or when `app_capture_shot` failed.
+ *
+ * @param result Result of the shot.
+ */
+void app_timelapse_shot_done(esp_err_t result);
+
+/**
+ * @brief Get the counters of the current or last time-lapse.
+ *
+ * @param stats Output counters.
+ */
+void app_timelapse_get_stats(app_timelapse_stats_t *stats);
@@ -0,0 +1,508 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_CAMERA_UVC
+#include <string.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_cache.h"
+#include "esp_private/esp_cache_private.h"
+#include "driver/jpeg_encode.h"
+#include "tinyusb.h"
+#include "task_config/task_config.h"
+#include "app_video.h"
+#include "app_uvc.hpp"
+
+#define UVC_JPEG_QUALITY                    (CONFIG_CAMERA_UVC_JPEG_QUALITY)
+#define UVC_SLOT_NUM                        (CONFIG_CAMERA_UVC_SLOT_NUM)
+#define UVC_FPS                             (CONFIG_CAMERA_UVC_FPS)
+// Same bound as the recorder, encoded frames stay well below a quarter of the raw RGB565 frame
+#define UVC_JPEG_BUF_DIV                    (4)
+#define UVC_ENCODE_TIMEOUT_MS               (100)
+// How often a sender waiting for the host checks that the stream is still the same
+#define UVC_XFER_POLL_MS                    (200)
+#define UVC_CTL_IDX                         (0)
+#define UVC_STM_IDX                         (0)
+#define UVC_EP_IN                           (0x81)
+#define UVC_EP_SIZE_FS                      (64)
+#define UVC_EP_SIZE_HS                      (512)
+#define UVC_CLOCK_FREQ                      (27000000)
+#define UVC_ENTITY_INPUT_TERMINAL           (0x01)
+#define UVC_ENTITY_OUTPUT_TERMINAL          (0x02)
+#define UVC_VID                             (0x303A)    /* Espressif */
+#define UVC_PID                             (0x4003)
+#if CONFIG_CAMERA_UVC_PORT_HS
+#define UVC_PORT_NAME                       "high speed"
+#else
+#define UVC_PORT_NAME                       "full speed"
+#endif
+
+// SOI, the APP4 marker and length, then the payload described in app_uvc.hpp
+#define UVC_META_BOX_SIZE                   (14)
+#define UVC_META_PAYLOAD_MAX                (sizeof(APP_UVC_META_ID) + 3 + 4 + 8 + \
+                                             CAMERA_PIPELINE_DETECT_RESULT_MAX * UVC_META_BOX_SIZE)
+#define UVC_META_HEADER_MAX                 (6 + UVC_META_PAYLOAD_MAX)
+// Room left in front of the encoder output for the segment, rounded up to the cache line at init
+#define UVC_META_RESERVED                   (256)
+
+#define UVC_DESC_VS_LEN                     (TUD_VIDEO_DESC_CS_VS_FMT_MJPEG_LEN + \
+                                             TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT_LEN + \
+                                             TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING_LEN)
+// The +1 are the interface list of the VC header and the format controls of the VS input header
+#define UVC_CONFIG_TOTAL_LEN                (TUD_CONFIG_DESC_LEN + TUD_VIDEO_DESC_IAD_LEN + TUD_VIDEO_DESC_STD_VC_LEN + \
+                                             TUD_VIDEO_DESC_CS_VC_LEN + 1 + TUD_VIDEO_DESC_CAMERA_TERM_LEN + \
+                                             TUD_VIDEO_DESC_OUTPUT_TERM_LEN + TUD_VIDEO_DESC_STD_VS_LEN + \
+                                             TUD_VIDEO_DESC_CS_VS_IN_LEN + 1 + UVC_DESC_VS_LEN + \
+                                             TUD_VIDEO_DESC_EP_BULK_LEN)
+
+static_assert(UVC_META_HEADER_MAX <= UVC_META_RESERVED + 2, "APP4 segment doesn't fit in front of the frame");
+
+enum {
+    UVC_ITF_NUM_VC = 0,
+    UVC_ITF_NUM_VS,
+    UVC_ITF_TOTAL,
+};
+
+enum {
+    UVC_STR_LANG = 0,
+    UVC_STR_MANUFACTURER,
+    UVC_STR_PRODUCT,
+    UVC_STR_SERIAL,
+    UVC_STR_INTERFACE,
+    UVC_STR_NUM,
+};
+
+typedef struct {
+    uint8_t *frame;             /*!< V4L2 frame buffer, referenced until encoded. */
+    uint8_t frame_index;        /*!< V4L2 buffer index of the frame. */
+} uvc_request_t;
+
+typedef struct {
+    uint8_t *buf;               /*!< Slot buffer, the encoder writes `meta_reserved` bytes into it. */
+    size_t buf_size;            /*!< Size of the slot buffer. */
+    uint8_t *data;              /*!< Start of the frame handed to TinyUSB. */
+    uint32_t size;              /*!< Size of the frame handed to TinyUSB. */
+} uvc_slot_t;
+
+static const char *TAG = "app_uvc";
+
+static const tusb_desc_device_t uvc_device_desc = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    // The video function is grouped by an IAD
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = UVC_VID,
+    .idProduct = UVC_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = UVC_STR_MANUFACTURER,
+    .iProduct = UVC_STR_PRODUCT,
+    .iSerialNumber = UVC_STR_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+#if CONFIG_CAMERA_UVC_PORT_HS
+static const tusb_desc_device_qualifier_t uvc_qualifier_desc = {
+    .bLength = sizeof(tusb_desc_device_qualifier_t),
+    .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .bNumConfigurations = 1,
+    .bReserved = 0,
+};
+static uint8_t uvc_hs_config_desc[UVC_CONFIG_TOTAL_LEN];
+#endif
+// The frame size is only known at init
+static uint8_t uvc_fs_config_desc[UVC_CONFIG_TOTAL_LEN];
+
+static const char *uvc_string_desc[UVC_STR_NUM] = {
+    "\x09\x04",  /* English */
+    "Espressif",
+    "ESP32-P4 Camera",
+    "000001",
+    "Camera",
+};
+
+static jpeg_encoder_handle_t jpeg_encoder = NULL;
+static uvc_slot_t slots[UVC_SLOT_NUM];
+static QueueHandle_t encode_queue = NULL;
+static QueueHandle_t free_queue = NULL;
+static QueueHandle_t send_queue = NULL;
+static TaskHandle_t send_task = NULL;
+static uint32_t uvc_width = 0;
+static uint32_t uvc_height = 0;
+static size_t meta_reserved = 0;
+
+static bool encode_busy = false;
+// Bumped by every commit of the host, a sender waiting on an older stream gives its slot back
+static volatile uint32_t stream_generation = 0;
+static app_uvc_stats_t uvc_stats;
+
+#if CONFIG_CAMERA_UVC_OVERLAY_METADATA
+static portMUX_TYPE meta_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t meta_payload[UVC_META_PAYLOAD_MAX];
+static size_t meta_len = 0;
+#endif
+
+static void uvc_build_config_desc(uint8_t *desc, uint16_t ep_size)
+{
+    const uint32_t interval = 10000000 / UVC_FPS;
+    const uint32_t max_frame_size = slots[0].buf_size - meta_reserved + UVC_META_HEADER_MAX;
+    const uint8_t config[] = {
+        TUD_CONFIG_DESCRIPTOR(1, UVC_ITF_TOTAL, 0, UVC_CONFIG_TOTAL_LEN, 0, 500),
+        TUD_VIDEO_DESC_IAD(UVC_ITF_NUM_VC, UVC_ITF_TOTAL, UVC_STR_INTERFACE),
+        TUD_VIDEO_DESC_STD_VC(UVC_ITF_NUM_VC, 0, UVC_STR_INTERFACE),
+        TUD_VIDEO_DESC_CS_VC(0x0150, TUD_VIDEO_DESC_CAMERA_TERM_LEN + TUD_VIDEO_DESC_OUTPUT_TERM_LEN, UVC_CLOCK_FREQ,
+                             UVC_ITF_NUM_VS),
+        TUD_VIDEO_DESC_CAMERA_TERM(UVC_ENTITY_INPUT_TERMINAL, 0, 0, 0, 0, 0, 0),
+        TUD_VIDEO_DESC_OUTPUT_TERM(UVC_ENTITY_OUTPUT_TERMINAL, VIDEO_TT_STREAMING, 0, UVC_ENTITY_INPUT_TERMINAL, 0),
+        // Bulk streaming, the single alternate setting has the endpoint
+        TUD_VIDEO_DESC_STD_VS(UVC_ITF_NUM_VS, 0, 1, UVC_STR_INTERFACE),
+        TUD_VIDEO_DESC_CS_VS_INPUT(1, UVC_DESC_VS_LEN, UVC_EP_IN, 0, UVC_ENTITY_OUTPUT_TERMINAL, 0, 0, 0, 0),
+        TUD_VIDEO_DESC_CS_VS_FMT_MJPEG(1, 1, 0, 1, 0, 0, 0, 0),
+        TUD_VIDEO_DESC_CS_VS_FRM_MJPEG_CONT(1, 0, uvc_width, uvc_height, max_frame_size * 8,
+                                            max_frame_size * 8 * UVC_FPS, max_frame_size,
+                                            interval, interval, interval, 0),
+        TUD_VIDEO_DESC_CS_VS_COLOR_MATCHING(VIDEO_COLOR_PRIMARIES_BT709, VIDEO_COLOR_XFER_CH_BT709,
+                                            VIDEO_COLOR_COEF_SMPTE170M),
+        TUD_VIDEO_DESC_EP_BULK(UVC_EP_IN, ep_size, 1),
+    };
+
+    static_assert(sizeof(config) == UVC_CONFIG_TOTAL_LEN, "Wrong configuration descriptor length");
+    memcpy(desc, config, sizeof(config));
+}
+
+#if CONFIG_CAMERA_UVC_OVERLAY_METADATA
+static uint8_t *uvc_put(uint8_t *p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        *p++ = (value >> (i * 8)) & 0xff;
+    }
+    return p;
+}
+
+// Writes SOI and the APP4 segment so that they end where the frame of the encoder leaves its SOI
+static void uvc_insert_meta(uvc_slot_t *slot, uint8_t *jpeg, uint32_t jpeg_size)
+{
+    uint8_t payload[UVC_META_PAYLOAD_MAX];
+    size_t payload_len;
+
+    if ((jpeg_size < 2) || (jpeg[0] != 0xFF) || (jpeg[1] != 0xD8)) {
+        return;
+    }
+
+    portENTER_CRITICAL(&meta_lock);
+    payload_len = meta_len;
+    memcpy(payload, meta_payload, payload_len);
+    portEXIT_CRITICAL(&meta_lock);
+    if (payload_len == 0) {
+        return;
+    }
+
+    // The segment length is big endian and counts itself
+    uint8_t *p = jpeg + 2 - (6 + payload_len);
+    slot->data = p;
+    slot->size = jpeg_size - 2 + 6 + payload_len;
+    *p++ = 0xFF;
+    *p++ = 0xD8;
+    *p++ = 0xFF;
+    *p++ = APP_UVC_META_MARKER;
+    *p++ = (payload_len + 2) >> 8;
+    *p++ = (payload_len + 2) & 0xFF;
+    memcpy(p, payload, payload_len);
+}
+#endif
+
+static void uvc_encode_task(void *arg)
+{
+    uvc_request_t request;
+    uint8_t slot_index;
+    jpeg_encode_cfg_t encode_cfg = {
+        .height = uvc_height,
+        .width = uvc_width,
+        .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+        .sub_sample = JPEG_DOWN_SAMPLING_YUV420,
+        .image_quality = UVC_JPEG_QUALITY,
+    };
+
+    while (1) {
+        if (xQueueReceive(encode_queue, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // `app_uvc_push_frame` made sure a slot is free before queueing the request
+        xQueueReceive(free_queue, &slot_index, portMAX_DELAY);
+
+        // TinyUSB reads the frame straight from the encoder output, there is no staging copy
+        uvc_slot_t *slot = &slots[slot_index];
+        uint8_t *jpeg = slot->buf + meta_reserved;
+        uint32_t jpeg_size = 0;
+        esp_err_t ret = jpeg_encoder_process(jpeg_encoder, &encode_cfg, request.frame, uvc_width * uvc_height * 2,
+                                             jpeg, slot->buf_size - meta_reserved, &jpeg_size);
+        app_video_frame_release(request.frame_index);
+
+        if (ret == ESP_OK) {
+            slot->data = jpeg;
+            slot->size = jpeg_size;
+#if CONFIG_CAMERA_UVC_OVERLAY_METADATA
+            uvc_insert_meta(slot, jpeg, jpeg_size);
+#endif
+            xQueueSend(send_queue, &slot_index, portMAX_DELAY);
+        } else {
+            __atomic_fetch_add(&uvc_stats.dropped_error, 1, __ATOMIC_RELAXED);
+            xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+        }
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void uvc_send_task(void *arg)
+{
+    uint8_t slot_index;
+    uint8_t newer_index;
+
+    while (1) {
+        if (xQueueReceive(send_queue, &slot_index, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        // A host that fell behind only gets the latest frame
+        while (xQueueReceive(send_queue, &newer_index, 0) == pdTRUE) {
+            xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+            __atomic_fetch_add(&uvc_stats.dropped_host_slow, 1, __ATOMIC_RELAXED);
+            slot_index = newer_index;
+        }
+
+        uvc_slot_t *slot = &slots[slot_index];
+        uint32_t generation = stream_generation;
+        ulTaskNotifyTake(pdTRUE, 0);
+        if (!tud_video_n_frame_xfer(UVC_CTL_IDX, UVC_STM_IDX, slot->data, slot->size)) {
+            // The host stopped the stream meanwhile
+            xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+            continue;
+        }
+
+        // The TinyUSB task copies from the slot into the endpoint buffer until the host took the last payload
+        bool done = false;
+        while (!done) {
+            done = (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UVC_XFER_POLL_MS)) > 0);
+            if (!done && (!tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX) || (generation != stream_generation))) {
+                break;
+            }
+        }
+        if (done) {
+            __atomic_fetch_add(&uvc_stats.frames_sent, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&uvc_stats.dropped_error, 1, __ATOMIC_RELAXED);
+        }
+        xQueueSend(free_queue, &slot_index, portMAX_DELAY);
+    }
+}
+
+extern "C" void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
+{
+    if (send_task) {
+        xTaskNotifyGive(send_task);
+    }
+}
+
+extern "C" int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
+                                   video_probe_and_commit_control_t const *parameters)
+{
+    // There is a single format and frame size, any commit starts a new stream
+    memset(&uvc_stats, 0, sizeof(uvc_stats));
+    stream_generation++;
+    ESP_LOGI(TAG, "Host started streaming");
+
+    return VIDEO_ERROR_NONE;
+}
+
+esp_err_t app_uvc_init(uint32_t width, uint32_t height)
+{
+    esp_err_t ret = ESP_OK;
+    const task_config_t *usb_task = task_config_get(TASK_CONFIG_CAMERA_UVC_TINYUSB);
+    jpeg_encode_engine_cfg_t encode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = UVC_ENCODE_TIMEOUT_MS,
+    };
+    jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+    };
+    tinyusb_config_t usb_config = TINYUSB_DEFAULT_CONFIG();
+
+    ESP_RETURN_ON_FALSE(jpeg_encoder == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    uvc_width = width;
+    uvc_height = height;
+
+#if CONFIG_CAMERA_UVC_OVERLAY_METADATA
+    // The encoder output must stay cache aligned behind the room of the segment
+    size_t cache_line_size = 0;
+    ESP_RETURN_ON_ERROR(esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &cache_line_size), TAG, "Get cache alignment failed");
+    cache_line_size = std::max(cache_line_size, (size_t)4);
+    meta_reserved = (UVC_META_RESERVED + cache_line_size - 1) / cache_line_size * cache_line_size;
+#endif
+
+    ESP_GOTO_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &jpeg_encoder), err, TAG, "Create JPEG encoder failed");
+
+    encode_queue = xQueueCreate(1, sizeof(uvc_request_t));
+    free_queue = xQueueCreate(UVC_SLOT_NUM, sizeof(uint8_t));
+    send_queue = xQueueCreate(UVC_SLOT_NUM, sizeof(uint8_t));
+    ESP_GOTO_ON_FALSE(encode_queue && free_queue && send_queue, ESP_ERR_NO_MEM, err, TAG, "Create queues failed");
+
+    for (uint8_t i = 0; i < UVC_SLOT_NUM; i++) {
+        slots[i].buf = (uint8_t *)jpeg_alloc_encoder_mem(meta_reserved + width * height * 2 / UVC_JPEG_BUF_DIV,
+                                                         &out_mem_cfg, &slots[i].buf_size);
+        ESP_GOTO_ON_FALSE(slots[i].buf, ESP_ERR_NO_MEM, err, TAG, "Allocate slot %d failed", i);
+        xQueueSend(free_queue, &i, 0);
+    }
+
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_UVC_ENCODE, uvc_encode_task, NULL, NULL) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create encode task failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_UVC_SEND, uvc_send_task, NULL, &send_task) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create send task failed");
+
+    uvc_build_config_desc(uvc_fs_config_desc, UVC_EP_SIZE_FS);
+#if CONFIG_CAMERA_UVC_PORT_HS
+    uvc_build_config_desc(uvc_hs_config_desc, UVC_EP_SIZE_HS);
+    usb_config.port = TINYUSB_PORT_HIGH_SPEED_0;
+    usb_config.descriptor.high_speed_config = uvc_hs_config_desc;
+    usb_config.descriptor.qualifier = &uvc_qualifier_desc;
+#else
+    usb_config.port = TINYUSB_PORT_FULL_SPEED_0;
+#endif
+    usb_config.task.size = usb_task->stack_size;
+    usb_config.task.priority = usb_task->priority;
+    usb_config.task.xCoreID = usb_task->core_id;
+    usb_config.descriptor.device = &uvc_device_desc;
+    usb_config.descriptor.full_speed_config = uvc_fs_config_desc;
+    usb_config.descriptor.string = uvc_string_desc;
+    usb_config.descriptor.string_count = UVC_STR_NUM;
+    // Nothing else refers to the tasks and buffers yet if this fails, they are kept for a later attempt
+    ESP_RETURN_ON_ERROR(tinyusb_driver_install(&usb_config), TAG, "Install TinyUSB driver failed");
+
+    ESP_LOGI(TAG, "Webcam %lux%lu MJPEG on the %s port", (unsigned long)width, (unsigned long)height, UVC_PORT_NAME);
+
+    return ESP_OK;
+
+err:
+    // Tasks are created last, nothing references the resources below yet
+    for (int i = 0; i < UVC_SLOT_NUM; i++) {
+        if (slots[i].buf) {
+            free(slots[i].buf);
+            slots[i].buf = NULL;
+        }
+    }
+    if (send_queue) {
+        vQueueDelete(send_queue);
+        send_queue = NULL;
+    }
+    if (free_queue) {
+        vQueueDelete(free_queue);
+        free_queue = NULL;
+    }
+    if (encode_queue) {
+        vQueueDelete(encode_queue);
+        encode_queue = NULL;
+    }
+    if (jpeg_encoder) {
+        jpeg_del_encoder_engine(jpeg_encoder);
+        jpeg_encoder = NULL;
+    }
+
+    return ret;
+}
+
+bool app_uvc_is_streaming(void)
+{
+    return (send_task != NULL) && tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX);
+}
+
+esp_err_t app_uvc_push_frame(uint8_t *frame, uint8_t frame_index)
+{
+    bool expected = false;
+
+    if (!app_uvc_is_streaming()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!__atomic_compare_exchange_n(&encode_busy, &expected, true, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        uvc_stats.dropped_encoder_busy++;
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    if (uxQueueMessagesWaiting(free_queue) == 0) {
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+        uvc_stats.dropped_host_slow++;
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    if (app_video_frame_acquire(frame_index) != ESP_OK) {
+        __atomic_store_n(&encode_busy, false, __ATOMIC_SEQ_CST);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uvc_request_t request = {
+        .frame = frame,
+        .frame_index = frame_index,
+    };
+    xQueueSend(encode_queue, &request, 0);
+
+    return ESP_OK;
+}
+
+void app_uvc_set_result(const camera_pipeline_detect_result_t *result, bool face)
+{
+#if CONFIG_CAMERA_UVC_OVERLAY_METADATA
+    uint8_t payload[UVC_META_PAYLOAD_MAX];
+    uint8_t *p = payload;
+
+    memcpy(p, APP_UVC_META_ID, sizeof(APP_UVC_META_ID));
+    p += sizeof(APP_UVC_META_ID);
+    p = uvc_put(p, APP_UVC_META_VERSION, 1);
+    p = uvc_put(p, result->num, 1);
+    p = uvc_put(p, face ? 1 : 0, 1);
+    p = uvc_put(p, result->frame_seq, 4);
+    p = uvc_put(p, (uint32_t)result->timestamp_us, 4);
+    p = uvc_put(p, (uint32_t)((uint64_t)result->timestamp_us >> 32), 4);
+    for (uint32_t i = 0; i < result->num; i++) {
+        const camera_pipeline_detect_box_t *box = &result->boxes[i];
+        p = uvc_put(p, box->track_id, 2);
+        p = uvc_put(p, box->face_id, 2);
+        p = uvc_put(p, box->category, 1);
+        p = uvc_put(p, (uint32_t)std::clamp(box->score * 255.f + 0.5f, 0.f, 255.f), 1);
+        for (int j = 0; j < 4; j++) {
+            p = uvc_put(p, (uint16_t)box->box[j], 2);
+        }
+    }
+
+    // Serialized here so the encoder task only copies a few bytes under the lock
+    portENTER_CRITICAL(&meta_lock);
+    meta_len = p - payload;
+    memcpy(meta_payload, payload, meta_len);
+    portEXIT_CRITICAL(&meta_lock);
+#endif
+}
+
+void app_uvc_get_stats(app_uvc_stats_t *stats)
+{
+    if (stats) {
+        *stats = uvc_stats;
+    }
+}
+
+#endif /* CONFIG_CAMERA_UVC */
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "app_camera_pipeline.hpp"
+
+#define APP_UVC_META_MARKER                 (0xE4)      /*!< JPEG APP4, carries the detections of the metadata mode. */
+#define APP_UVC_META_ID                     "ESPDET"    /*!< Identifier at the start of the APP4 payload, NUL included. */
+#define APP_UVC_META_VERSION                (1)         /*!< Version of the APP4 payload layout. */
+
+/**
+ * @brief Webcam statistics, reset by every stream start of the host.
+ */
+typedef struct {
+    uint32_t frames_sent;           /*!< Frames fully taken by the host. */
+    uint32_t dropped_encoder_busy;  /*!< Frames dropped because the previous frame was still being encoded. */
+    uint32_t dropped_host_slow;     /*!< Encoded frames replaced by a newer one before the host took them. */
+    uint32_t dropped_error;         /*!< Frames lost to encoder or USB errors. */
+} app_uvc_stats_t;
+
+/**
+ * @brief Initialize the webcam.
+ *
+ * Creates the hardware JPEG encoder, the encoded frame slots, the encoder and sender tasks and installs TinyUSB with
+ * a single MJPEG format of the frame size on the port chosen by `CONFIG_CAMERA_UVC_PORT_HS` or
+ * `CONFIG_CAMERA_UVC_PORT_FS`. The host streams what `app_uvc_push_frame` is given, nothing while the Camera app is
+ * closed.
+ *
+ * In the `CONFIG_CAMERA_UVC_OVERLAY_METADATA` mode every frame starts with an APP4 segment right after SOI, whose
+ * payload is `APP_UVC_META_ID`, the version u8, the detection count u8, the flags u8 (bit 0 face mode), the
+ * frame_seq as u32 and the timestamp as i64 of the latest detector run, followed per detection by track_id u16,
+ * face_id u16, category u8, score u8 (0-255) and the box as 4 x i16 in frame coordinates. Multi-byte fields are
+ * little endian.
+ *
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already initialized, or the errors of the encoder, the
+ *         allocations or the TinyUSB driver.
+ */
+esp_err_t app_uvc_init(uint32_t width, uint32_t height);
+
+/**
+ * @brief Check whether a host is streaming.
+ */
+bool app_uvc_is_streaming(void);
+
+/**
+ * @brief Offer a V4L2 frame to the webcam.
+ *
+ * Never blocks: the frame is referenced and handed to the encoder task, or dropped and counted when the encoder is
+ * busy or all the slots are waiting for the host. Must be called while the caller holds a reference on the frame,
+ * and nothing may be drawn into a queued frame.
+ *
+ * @param frame RGB565 frame.
+ * @param frame_index V4L2 buffer index of the frame.
+ *
+ * @return ESP_OK if the frame was queued, ESP_ERR_INVALID_STATE if no host is streaming, ESP_ERR_NOT_FINISHED if
+ *         dropped.
+ */
+esp_err_t app_uvc_push_frame(uint8_t *frame, uint8_t frame_index);
+
+/**
+ * @brief Set the detections written into the following frames in the metadata mode, no effect otherwise.
+ *
+ * @param result Detections of the latest detector run, in camera frame coordinates.
+ * @param face Whether the results come from face detection.
+ */
+void app_uvc_set_result(const camera_pipeline_detect_result_t *result, bool face);
+
+/**
+ * @brief Get the statistics of the current or last stream.
+ *
+ * @param stats Output statistics.
+ */
+void app_uvc_get_stats(app_uvc_stats_t *stats);
@@ -15,34 +15,210 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "linux/videodev2.h"
+#include "esp_check.h"
+#include "esp_cache.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_video_init.h"
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+#include "freertos/queue.h"
+#include "driver/ppa.h"
+#include "driver/jpeg_encode.h"
+#endif
+#if CONFIG_CAMERA_SENSOR_PROBE_CACHE
+#include "nvs.h"
+#include "esp_cam_sensor_detect.h"
+#endif
+#include "media_arena/media_arena.h"
+#include "pm_policy/pm_policy.h"
+#include "task_config/task_config.h"
 #include "app_video.h"
+#include "app_latency_trace.h"
 
 static const char *TAG = "app_video";
 
-#define MAX_BUFFER_COUNT                (6)
-#define MIN_BUFFER_COUNT                (2)
-#define VIDEO_TASK_STACK_SIZE           (4 * 1024)
-#define VIDEO_TASK_PRIORITY             (3)
+#define MAX_BUFFER_COUNT                (APP_VIDEO_BUF_NUM_MAX)
+#define MIN_BUFFER_COUNT                (APP_VIDEO_BUF_NUM_MIN)
 
 typedef enum {
     VIDEO_TASK_DELETE = BIT(0),
     VIDEO_TASK_DELETE_DONE = BIT(1),
 } video_event_id_t;
 
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+#define STILL_BUF_NUM_MAX               (2)
+// Compressed stills stay well below a quarter of the raw frame at the supported qualities
+#define STILL_JPEG_BUF_DIV              (4)
+#define STILL_CODEC_TIMEOUT_MS          (100)
+
+#if APP_VIDEO_FMT == APP_VIDEO_FMT_RGB565
+#define VIDEO_BYTES_PER_PIXEL           (2)
+#define VIDEO_PPA_COLOR_MODE            (PPA_SRM_COLOR_MODE_RGB565)
+#define VIDEO_JPEG_IN_FORMAT            (JPEG_ENCODE_IN_FORMAT_RGB565)
+#else
+#define VIDEO_BYTES_PER_PIXEL           (3)
+#define VIDEO_PPA_COLOR_MODE            (PPA_SRM_COLOR_MODE_RGB888)
+#define VIDEO_JPEG_IN_FORMAT            (JPEG_ENCODE_IN_FORMAT_RGB888)
+#endif
+
+typedef struct {
+    bool enabled;
+    uint8_t *buffer[MAX_BUFFER_COUNT];
+    uint32_t ref_count[MAX_BUFFER_COUNT];   // Protected by frame_ref_lock
+    uint32_t buf_num;
+    size_t buf_size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t dropped;                       // Frames skipped because every preview buffer was still referenced
+    ppa_client_handle_t ppa_handle;
+} video_preview_stream_t;
+
+typedef struct {
+    uint8_t v4l2_index;                     // Captured frame, referenced until converted
+    uint8_t still_index;                    // Still buffer reserved for it
+} video_still_job_t;
+
+typedef struct {
+    bool enabled;
+    bool requested;
+    app_video_still_config_t config;
+    uint8_t *buffer[STILL_BUF_NUM_MAX];
+    bool busy[STILL_BUF_NUM_MAX];           // Protected by frame_ref_lock
+    size_t buf_size;
+    QueueHandle_t queue;
+    TaskHandle_t task_handle;
+    ppa_client_handle_t ppa_handle;
+    jpeg_encoder_handle_t jpeg_handle;
+} video_still_stream_t;
+#endif
+
 typedef struct {
     uint8_t *camera_buffer[MAX_BUFFER_COUNT];
     size_t camera_buf_size;
     uint32_t camera_buf_hes;
     uint32_t camera_buf_ves;
     struct v4l2_buffer v4l2_buf;
+    struct v4l2_buffer held_v4l2_buf[MAX_BUFFER_COUNT];
+    uint32_t frame_ref_count[MAX_BUFFER_COUNT];
+    int video_fd;
     uint8_t camera_mem_mode;
+    bool camera_buf_allocated;          // Set once `app_video_alloc_bufs` succeeded
+    uint32_t queued_num;                // Buffers with the driver, protected by frame_ref_lock
+    int64_t starve_begin_us;            // When the driver was left without a buffer, 0 if it has one
+    app_video_buf_stats_t buf_stats;    // Protected by frame_ref_lock
     app_video_frame_operation_cb_t user_camera_video_frame_operation_cb;
     TaskHandle_t video_stream_task_handle;
     EventGroupHandle_t video_event_group;
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+    video_preview_stream_t preview;
+    video_still_stream_t still;
+    // References taken with `app_video_frame_acquire` and the pool they were taken from, protected by frame_ref_lock
+    uint32_t acquired_num[MAX_BUFFER_COUNT];
+    bool acquired_preview[MAX_BUFFER_COUNT];
+#endif
 } app_video_t;
 
 static app_video_t app_camera_video;
+static portMUX_TYPE frame_ref_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_CAMERA_SENSOR_PROBE_CACHE
+#define SENSOR_CACHE_NAMESPACE      "cam_probe"
+#define SENSOR_CACHE_KEY            "sensor"
+
+typedef struct {
+    uint8_t found;                  // 0 if the previous boot detected no sensor
+    uint8_t port;
+    uint16_t sccb_addr;
+    uint16_t pid;
+} app_video_sensor_cache_t;
+
+static bool sensor_absent_last_boot;
+
+static esp_err_t video_sensor_cache_load(app_video_sensor_cache_t *cache)
+{
+    esp_err_t ret = ESP_OK;
+    nvs_handle_t handle = 0;
+    size_t size = sizeof(*cache);
+
+    ret = nvs_open(SENSOR_CACHE_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ret = nvs_get_blob(handle, SENSOR_CACHE_KEY, cache, &size);
+    nvs_close(handle);
+    if ((ret != ESP_OK) || (size != sizeof(*cache))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return ESP_OK;
+}
+
+static void video_sensor_cache_save(const app_video_sensor_cache_t *cache)
+{
+    nvs_handle_t handle = 0;
+
+    if (nvs_open(SENSOR_CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Open NVS failed, sensor not cached");
+        return;
+    }
+    if ((nvs_set_blob(handle, SENSOR_CACHE_KEY, cache, sizeof(*cache)) != ESP_OK) || (nvs_commit(handle) != ESP_OK)) {
+        ESP_LOGW(TAG, "Write sensor cache failed");
+    }
+    nvs_close(handle);
+}
+
+static esp_err_t video_init_with_cache(const esp_video_init_config_t *cam_config, bool can_retry)
+{
+    app_video_sensor_cache_t saved = { 0 };
+    app_video_sensor_cache_t detected = { 0 };
+    esp_cam_sensor_detect_hint_t result = { 0 };
+    bool loaded = (video_sensor_cache_load(&saved) == ESP_OK);
+    bool hinted = loaded && saved.found;
+    esp_err_t ret = ESP_OK;
+
+    sensor_absent_last_boot = loaded && !saved.found;
+    if (hinted) {
+        esp_cam_sensor_detect_hint_t hint = {
+            .port = (esp_cam_sensor_port_t)saved.port,
+            .sccb_addr = saved.sccb_addr,
+            .pid = saved.pid,
+        };
+        esp_cam_sensor_detect_set_hint(&hint);
+    } else {
+        esp_cam_sensor_detect_set_hint(NULL);
+    }
+
+    ret = esp_video_init(cam_config);
+    // A second init would create the SCCB bus again, only retry on a bus owned by the caller
+    if (hinted && can_retry && (esp_cam_sensor_detect_get_result(&result) != ESP_OK)) {
+        ESP_LOGW(TAG, "Cached sensor 0x%x not found, detecting all sensors", saved.sccb_addr);
+        esp_cam_sensor_detect_set_hint(NULL);
+        ret = esp_video_init(cam_config);
+    }
+
+    if (esp_cam_sensor_detect_get_result(&result) == ESP_OK) {
+        detected.found = 1;
+        detected.port = (uint8_t)result.port;
+        detected.sccb_addr = result.sccb_addr;
+        detected.pid = result.pid;
+    }
+    // Same sensor as last boot is the usual case, it must not wear the flash
+    if (!loaded || (memcmp(&saved, &detected, sizeof(saved)) != 0)) {
+        video_sensor_cache_save(&detected);
+    }
+
+    return ret;
+}
+#endif
+
+bool app_video_sensor_absent_last_boot(void)
+{
+#if CONFIG_CAMERA_SENSOR_PROBE_CACHE
+    return sensor_absent_last_boot;
+#else
+    return false;
+#endif
+}
 
 esp_err_t app_video_main(i2c_master_bus_handle_t i2c_bus_handle)
 {
@@ -75,7 +251,11 @@ esp_err_t app_video_main(i2c_master_bus_handle_t i2c_bus_handle)
 #endif
     };
 
+#if CONFIG_CAMERA_SENSOR_PROBE_CACHE
+    return video_init_with_cache(&cam_config, i2c_bus_handle != NULL);
+#else
     return esp_video_init(&cam_config);
+#endif
 }
 
 int app_video_open(char *dev, video_fmt_t init_fmt)
@@ -184,6 +364,7 @@ esp_err_t app_video_set_bufs(int video_fd, uint32_t fb_num, const void **fb)
         ESP_LOGE(TAG, "req bufs failed");
         goto errout_req_bufs;
     }
+    app_camera_video.video_fd = video_fd;
     for (int i = 0; i < fb_num; i++) {
         struct v4l2_buffer buf;
         memset(&buf, 0, sizeof(buf));
@@ -212,6 +393,7 @@ esp_err_t app_video_set_bufs(int video_fd, uint32_t fb_num, const void **fb)
         }
 
         app_camera_video.camera_buf_size = buf.length;
+        app_camera_video.frame_ref_count[i] = 0;
 
         if (ioctl(video_fd, VIDIOC_QBUF, &buf) != 0) {
             ESP_LOGE(TAG, "queue frame buffer failed");
@@ -219,6 +401,13 @@ esp_err_t app_video_set_bufs(int video_fd, uint32_t fb_num, const void **fb)
         }
     }
 
+    portENTER_CRITICAL(&frame_ref_lock);
+    app_camera_video.queued_num = fb_num;
+    app_camera_video.starve_begin_us = 0;
+    memset(&app_camera_video.buf_stats, 0, sizeof(app_camera_video.buf_stats));
+    app_camera_video.buf_stats.min_queued = fb_num;
+    portEXIT_CRITICAL(&frame_ref_lock);
+
     return ESP_OK;
 
 errout_req_bufs:
@@ -226,6 +415,109 @@ errout_req_bufs:
     return ESP_FAIL;
 }
 
+esp_err_t app_video_alloc_bufs(int video_fd, const app_video_buf_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    void *fb[MAX_BUFFER_COUNT] = { 0 };
+    uint32_t caps = MALLOC_CAP_SPIRAM;
+    size_t align = 0;
+    size_t size = 0;
+
+    ESP_RETURN_ON_FALSE(config && (config->buf_num >= MIN_BUFFER_COUNT) && (config->buf_num <= MAX_BUFFER_COUNT) &&
+                        ((unsigned)config->mode < APP_VIDEO_BUF_MODE_MAX), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid buffer configuration");
+    ESP_RETURN_ON_FALSE(!app_camera_video.camera_buf_allocated, ESP_ERR_INVALID_STATE, TAG, "Buffers already allocated");
+
+    if (config->mode == APP_VIDEO_BUF_MMAP) {
+        ESP_RETURN_ON_ERROR(app_video_set_bufs(video_fd, config->buf_num, NULL), TAG, "Set MMAP buffers failed");
+        app_camera_video.camera_buf_allocated = true;
+        ESP_LOGI(TAG, "%" PRIu32 " MMAP buffers of %u bytes", config->buf_num, app_camera_video.camera_buf_size);
+        return ESP_OK;
+    }
+
+    if (config->mode == APP_VIDEO_BUF_USERPTR_INTERNAL) {
+        caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    size = app_video_get_buf_size();
+    ESP_RETURN_ON_FALSE(size, ESP_ERR_INVALID_STATE, TAG, "Video device not opened");
+    ESP_RETURN_ON_ERROR(esp_cache_get_alignment(caps, &align), TAG, "Get cache alignment failed");
+    // The driver writes whole cache lines
+    size = (size + align - 1) / align * align;
+
+    for (int i = 0; i < config->buf_num; i++) {
+        // PSRAM frames come from the slabs reserved at boot, they don't depend on what the other apps left
+        fb[i] = (caps == MALLOC_CAP_SPIRAM) ? media_arena_lend(size, NULL) : heap_caps_aligned_calloc(align, 1, size, caps);
+        ESP_GOTO_ON_FALSE(fb[i], ESP_ERR_NO_MEM, err, TAG, "Allocate %u bytes for buffer %d failed", size, i);
+    }
+    // The device is closed on failure, nothing can use the buffers any more
+    ESP_GOTO_ON_ERROR(app_video_set_bufs(video_fd, config->buf_num, (const void **)fb), err, TAG, "Set USERPTR buffers failed");
+    app_camera_video.camera_buf_allocated = true;
+    ESP_LOGI(TAG, "%" PRIu32 " USERPTR buffers of %u bytes in %s", config->buf_num, size,
+             (config->mode == APP_VIDEO_BUF_USERPTR_INTERNAL) ? "internal RAM" : "PSRAM");
+
+    return ESP_OK;
+
+err:
+    for (int i = 0; i < config->buf_num; i++) {
+        media_arena_return(fb[i]);
+    }
+
+    return ret;
+}
+
+esp_err_t app_video_get_buf_stats(app_video_buf_stats_t *stats, bool reset)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    *stats = app_camera_video.buf_stats;
+    // A starvation still going on counts up to now
+    if (app_camera_video.starve_begin_us) {
+        stats->starved_us += esp_timer_get_time() - app_camera_video.starve_begin_us;
+    }
+    if (reset) {
+        memset(&app_camera_video.buf_stats, 0, sizeof(app_camera_video.buf_stats));
+        app_camera_video.buf_stats.min_queued = app_camera_video.queued_num;
+        if (app_camera_video.starve_begin_us) {
+            app_camera_video.starve_begin_us = esp_timer_get_time();
+        }
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    return ESP_OK;
+}
+
+static void video_buf_dequeued(void)
+{
+    app_video_buf_stats_t *stats = &app_camera_video.buf_stats;
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.queued_num > 0) {
+        app_camera_video.queued_num--;
+    }
+    stats->frames++;
+    if (app_camera_video.queued_num < stats->min_queued) {
+        stats->min_queued = app_camera_video.queued_num;
+    }
+    // The next sensor frame has nowhere to go until a consumer gives a buffer back
+    if (app_camera_video.queued_num == 0) {
+        stats->starved++;
+        app_camera_video.starve_begin_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+}
+
+static void video_buf_queued(void)
+{
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.starve_begin_us) {
+        app_camera_video.buf_stats.starved_us += esp_timer_get_time() - app_camera_video.starve_begin_us;
+        app_camera_video.starve_begin_us = 0;
+    }
+    app_camera_video.queued_num++;
+    portEXIT_CRITICAL(&frame_ref_lock);
+}
+
 esp_err_t app_video_get_bufs(int fb_num, void **fb)
 {
     if (fb_num > MAX_BUFFER_COUNT) {
@@ -266,6 +558,8 @@ static inline esp_err_t video_receive_video_frame(int video_fd)
         ESP_LOGE(TAG, "failed to receive video frame");
         goto errout;
     }
+    video_buf_dequeued();
+    app_latency_trace_begin(app_camera_video.v4l2_buf.index);
 
     return ESP_OK;
 
@@ -273,6 +567,266 @@ errout:
     return ESP_FAIL;
 }
 
+static esp_err_t video_v4l2_buf_acquire(uint8_t buf_index)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (buf_index >= MAX_BUFFER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.frame_ref_count[buf_index] == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.frame_ref_count[buf_index]++;
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    return ret;
+}
+
+static esp_err_t video_v4l2_buf_release(uint8_t buf_index)
+{
+    bool requeue = false;
+    struct v4l2_buffer buf;
+
+    if (buf_index >= MAX_BUFFER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.frame_ref_count[buf_index] == 0) {
+        portEXIT_CRITICAL(&frame_ref_lock);
+        ESP_LOGE(TAG, "frame %d released without reference", buf_index);
+        return ESP_ERR_INVALID_STATE;
+    }
+    requeue = (--app_camera_video.frame_ref_count[buf_index] == 0);
+    buf = app_camera_video.held_v4l2_buf[buf_index];
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    if (requeue) {
+        app_latency_trace_mark_index(buf_index, APP_LATENCY_STAGE_QBUF);
+    }
+    if (requeue && (ioctl(app_camera_video.video_fd, VIDIOC_QBUF, &buf) != 0)) {
+        ESP_LOGE(TAG, "failed to free video frame");
+        return ESP_FAIL;
+    }
+    if (requeue) {
+        video_buf_queued();
+    }
+
+    return ESP_OK;
+}
+
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+static esp_err_t video_preview_buf_acquire(uint8_t buf_index)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (buf_index >= app_camera_video.preview.buf_num) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.preview.ref_count[buf_index] == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.preview.ref_count[buf_index]++;
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    return ret;
+}
+
+static esp_err_t video_preview_buf_release(uint8_t buf_index)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (buf_index >= app_camera_video.preview.buf_num) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Preview buffers never go back to the driver, a free one is simply picked again by the next frame
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.preview.ref_count[buf_index] == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.preview.ref_count[buf_index]--;
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "preview %d released without reference", buf_index);
+    }
+
+    return ret;
+}
+
+static void video_preview_frame(uint8_t v4l2_index)
+{
+    video_preview_stream_t *preview = &app_camera_video.preview;
+    int index = -1;
+
+    // Consumers may still hold older previews, any free buffer will do
+    portENTER_CRITICAL(&frame_ref_lock);
+    for (int i = 0; i < preview->buf_num; i++) {
+        if (preview->ref_count[i] == 0) {
+            preview->ref_count[i] = 1;
+            index = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    if (index < 0) {
+        preview->dropped++;
+        ESP_LOGD(TAG, "no free preview buffer, %" PRIu32 " frames dropped", preview->dropped);
+        return;
+    }
+
+    ppa_srm_oper_config_t srm_config = {
+        .in.buffer = app_camera_video.camera_buffer[v4l2_index],
+        .in.pic_w = app_camera_video.camera_buf_hes,
+        .in.pic_h = app_camera_video.camera_buf_ves,
+        .in.block_w = app_camera_video.camera_buf_hes,
+        .in.block_h = app_camera_video.camera_buf_ves,
+        .in.block_offset_x = 0,
+        .in.block_offset_y = 0,
+        .in.srm_cm = VIDEO_PPA_COLOR_MODE,
+        .out.buffer = preview->buffer[index],
+        .out.buffer_size = preview->buf_size,
+        .out.pic_w = preview->width,
+        .out.pic_h = preview->height,
+        .out.block_offset_x = 0,
+        .out.block_offset_y = 0,
+        .out.srm_cm = VIDEO_PPA_COLOR_MODE,
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        // The PPA rounds the factors down to 1/16 steps, so the result always fits the preview
+        .scale_x = (float)preview->width / app_camera_video.camera_buf_hes,
+        .scale_y = (float)preview->height / app_camera_video.camera_buf_ves,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    if (ppa_do_scale_rotate_mirror(preview->ppa_handle, &srm_config) != ESP_OK) {
+        ESP_LOGW(TAG, "failed to scale preview frame");
+        video_preview_buf_release(index);
+        return;
+    }
+
+    // The stream task owns the first reference until the callback returns
+    app_camera_video.user_camera_video_frame_operation_cb(preview->buffer[index], index, preview->width, preview->height,
+                                                          preview->buf_size);
+    video_preview_buf_release(index);
+}
+
+static void video_still_take(uint8_t v4l2_index)
+{
+    video_still_stream_t *still = &app_camera_video.still;
+    video_still_job_t job = {
+        .v4l2_index = v4l2_index,
+        .still_index = STILL_BUF_NUM_MAX,
+    };
+
+    if (!still->enabled || !__atomic_load_n(&still->requested, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    // Without a free still buffer the request stays pending for the next frame
+    portENTER_CRITICAL(&frame_ref_lock);
+    for (int i = 0; i < still->config.buf_num; i++) {
+        if (!still->busy[i]) {
+            still->busy[i] = true;
+            job.still_index = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    if (job.still_index == STILL_BUF_NUM_MAX) {
+        return;
+    }
+    __atomic_store_n(&still->requested, false, __ATOMIC_RELEASE);
+
+    // Converted by the still task straight from the captured frame, the preview goes on meanwhile
+    video_v4l2_buf_acquire(v4l2_index);
+    if (xQueueSend(still->queue, &job, 0) != pdTRUE) {
+        video_v4l2_buf_release(v4l2_index);
+        app_video_still_release(job.still_index);
+    }
+}
+
+static esp_err_t video_still_convert(const video_still_job_t *job, size_t *len)
+{
+    video_still_stream_t *still = &app_camera_video.still;
+    uint8_t *frame = app_camera_video.camera_buffer[job->v4l2_index];
+    uint8_t *out = still->buffer[job->still_index];
+    uint32_t width = app_camera_video.camera_buf_hes;
+    uint32_t height = app_camera_video.camera_buf_ves;
+
+    if (still->config.fmt == APP_VIDEO_STILL_FMT_JPEG) {
+        jpeg_encode_cfg_t encode_cfg = {
+            .height = height,
+            .width = width,
+            .src_type = VIDEO_JPEG_IN_FORMAT,
+            .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+            .image_quality = still->config.jpeg_quality,
+        };
+        uint32_t jpeg_size = 0;
+
+        ESP_RETURN_ON_ERROR(jpeg_encoder_process(still->jpeg_handle, &encode_cfg, frame, width * height * VIDEO_BYTES_PER_PIXEL,
+                                                 out, still->buf_size, &jpeg_size), TAG, "Encode still failed");
+        *len = jpeg_size;
+
+        return ESP_OK;
+    }
+
+    // A scale of one is a DMA copy, the CPU stays free for the preview
+    ppa_srm_oper_config_t srm_config = {
+        .in.buffer = frame,
+        .in.pic_w = width,
+        .in.pic_h = height,
+        .in.block_w = width,
+        .in.block_h = height,
+        .in.srm_cm = VIDEO_PPA_COLOR_MODE,
+        .out.buffer = out,
+        .out.buffer_size = still->buf_size,
+        .out.pic_w = width,
+        .out.pic_h = height,
+        .out.srm_cm = VIDEO_PPA_COLOR_MODE,
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = 1.0f,
+        .scale_y = 1.0f,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    ESP_RETURN_ON_ERROR(ppa_do_scale_rotate_mirror(still->ppa_handle, &srm_config), TAG, "Copy still failed");
+    *len = width * height * VIDEO_BYTES_PER_PIXEL;
+
+    return ESP_OK;
+}
+
+static void video_still_task(void *arg)
+{
+    video_still_stream_t *still = &app_camera_video.still;
+    video_still_job_t job;
+
+    while (1) {
+        if (xQueueReceive(still->queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        size_t len = 0;
+        esp_err_t ret = video_still_convert(&job, &len);
+        video_v4l2_buf_release(job.v4l2_index);
+        if (ret != ESP_OK) {
+            app_video_still_release(job.still_index);
+            continue;
+        }
+        still->config.cb(still->buffer[job.still_index], job.still_index, app_camera_video.camera_buf_hes,
+                         app_camera_video.camera_buf_ves, len, still->config.user_ctx);
+    }
+}
+#endif
+
 static inline void video_operation_video_frame(int video_fd)
 {
     app_camera_video.v4l2_buf.m.userptr = (unsigned long)app_camera_video.camera_buffer[app_camera_video.v4l2_buf.index];
@@ -280,6 +834,21 @@ static inline void video_operation_video_frame(int video_fd)
 
     uint8_t buf_index = app_camera_video.v4l2_buf.index;
 
+    // The stream task owns the first reference until the callback returns
+    portENTER_CRITICAL(&frame_ref_lock);
+    app_camera_video.held_v4l2_buf[buf_index] = app_camera_video.v4l2_buf;
+    app_camera_video.frame_ref_count[buf_index] = 1;
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+    // Taken before the callback can draw anything into the frame
+    video_still_take(buf_index);
+    if (app_camera_video.preview.enabled) {
+        video_preview_frame(buf_index);
+        return;
+    }
+#endif
+
     app_camera_video.user_camera_video_frame_operation_cb(
                         app_camera_video.camera_buffer[buf_index],
                         buf_index,
@@ -291,21 +860,82 @@ static inline void video_operation_video_frame(int video_fd)
 
 static inline esp_err_t video_free_video_frame(int video_fd)
 {
-    if (ioctl(video_fd, VIDIOC_QBUF, &(app_camera_video.v4l2_buf)) != 0) {
-        ESP_LOGE(TAG, "failed to free video frame");
-        goto errout;
+    return video_v4l2_buf_release(app_camera_video.v4l2_buf.index);
+}
+
+esp_err_t app_video_frame_acquire(uint8_t buf_index)
+{
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+    esp_err_t ret = ESP_OK;
+    bool preview = app_camera_video.preview.enabled;
+
+    if (buf_index >= MAX_BUFFER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    return ESP_OK;
+    // Releases go to the pool of the acquire, an index can't be held in both pools as it would be ambiguous
+    portENTER_CRITICAL(&frame_ref_lock);
+    if ((app_camera_video.acquired_num[buf_index] > 0) && (app_camera_video.acquired_preview[buf_index] != preview)) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.acquired_preview[buf_index] = preview;
+        app_camera_video.acquired_num[buf_index]++;
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
-errout:
-    return ESP_FAIL;
+    ret = preview ? video_preview_buf_acquire(buf_index) : video_v4l2_buf_acquire(buf_index);
+    if (ret != ESP_OK) {
+        portENTER_CRITICAL(&frame_ref_lock);
+        app_camera_video.acquired_num[buf_index]--;
+        portEXIT_CRITICAL(&frame_ref_lock);
+    }
+
+    return ret;
+#else
+    return video_v4l2_buf_acquire(buf_index);
+#endif
+}
+
+esp_err_t app_video_frame_release(uint8_t buf_index)
+{
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+    esp_err_t ret = ESP_OK;
+    bool preview = false;
+
+    if (buf_index >= MAX_BUFFER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Not the current mode, the preview stream may have been enabled since the reference was taken
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (app_camera_video.acquired_num[buf_index] == 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.acquired_num[buf_index]--;
+        preview = app_camera_video.acquired_preview[buf_index];
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "frame %d released without acquire", buf_index);
+        return ret;
+    }
+
+    return preview ? video_preview_buf_release(buf_index) : video_v4l2_buf_release(buf_index);
+#else
+    return video_v4l2_buf_release(buf_index);
+#endif
 }
 
 static inline esp_err_t video_stream_start(int video_fd)
 {
     ESP_LOGI(TAG, "Video Stream Start");
 
+    // Every start is followed by a stop, which releases it even if the stream didn't start
+    pm_policy_acquire(PM_POLICY_CLIENT_CAMERA);
+
     int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (ioctl(video_fd, VIDIOC_STREAMON, &type)) {
         ESP_LOGE(TAG, "failed to start stream");
@@ -329,12 +959,19 @@ static inline esp_err_t video_stream_stop(int video_fd)
 {
     ESP_LOGI(TAG, "Video Stream Stop");
 
+    pm_policy_release(PM_POLICY_CLIENT_CAMERA);
+
     int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (ioctl(video_fd, VIDIOC_STREAMOFF, &type)) {
         ESP_LOGE(TAG, "failed to stop stream");
         goto errout;
     }
 
+    app_video_buf_stats_t stats;
+    app_video_get_buf_stats(&stats, true);
+    ESP_LOGI(TAG, "%" PRIu32 " frames, starved %" PRIu32 " times for %llu ms, at least %" PRIu32 " buffers queued",
+             stats.frames, stats.starved, stats.starved_us / 1000, stats.min_queued);
+
     xEventGroupSetBits(app_camera_video.video_event_group, VIDEO_TASK_DELETE_DONE);
 
     return ESP_OK;
@@ -357,10 +994,10 @@ static void video_stream_task(void *arg)
         if(xEventGroupGetBits(app_camera_video.video_event_group) & VIDEO_TASK_DELETE) {
             xEventGroupClearBits(app_camera_video.video_event_group, VIDEO_TASK_DELETE);
             ESP_ERROR_CHECK(video_stream_stop(video_fd));
-            vTaskDelete(NULL);
+            task_config_delete(TASK_CONFIG_CAMERA_STREAM, NULL);
         }
     }
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_CAMERA_STREAM, NULL);
 }
 
 esp_err_t app_video_stream_task_start(int video_fd, int core_id)
@@ -372,7 +1009,10 @@ esp_err_t app_video_stream_task_start(int video_fd, int core_id)
 
     video_stream_start(video_fd);
 
-    BaseType_t result = xTaskCreatePinnedToCore(video_stream_task, "video stream task", VIDEO_TASK_STACK_SIZE, &video_fd, VIDEO_TASK_PRIORITY, &app_camera_video.video_stream_task_handle, core_id);
+    // The task reads the descriptor once it runs, it can't point into this stack frame
+    app_camera_video.video_fd = video_fd;
+    BaseType_t result = task_config_create_on_core(TASK_CONFIG_CAMERA_STREAM, video_stream_task, &app_camera_video.video_fd,
+                                                   &app_camera_video.video_stream_task_handle, core_id);
 
     if (result != pdPASS) {
         ESP_LOGE(TAG, "failed to create video stream task");
@@ -407,4 +1047,164 @@ esp_err_t app_video_stream_wait_stop(void)
     ESP_LOGI(TAG, "Video Stream Task Stopped Done");
 
     return ESP_OK;
-}
\ No newline at end of file
+}
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+static void video_free_pool(uint8_t **buffer, uint32_t num)
+{
+    for (int i = 0; i < num; i++) {
+        // Also frees the JPEG encoder buffers, they are not slabs
+        media_arena_return(buffer[i]);
+        buffer[i] = NULL;
+    }
+}
+
+esp_err_t app_video_preview_stream_init(const app_video_preview_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    video_preview_stream_t *preview = &app_camera_video.preview;
+    size_t align = 0;
+    ppa_client_config_t srm_config = {
+        .oper_type = PPA_OPERATION_SRM,
+    };
+
+    ESP_RETURN_ON_FALSE(config && (config->buf_num >= MIN_BUFFER_COUNT) && (config->buf_num <= MAX_BUFFER_COUNT),
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(!preview->enabled, ESP_ERR_INVALID_STATE, TAG, "Preview stream already initialized");
+    ESP_RETURN_ON_FALSE(app_camera_video.camera_buf_hes && app_camera_video.camera_buf_ves, ESP_ERR_INVALID_STATE, TAG,
+                        "Video device not opened");
+    ESP_RETURN_ON_FALSE(config->width && config->height && (config->width <= app_camera_video.camera_buf_hes) &&
+                        (config->height <= app_camera_video.camera_buf_ves), ESP_ERR_INVALID_SIZE, TAG,
+                        "Preview must not be larger than the capture");
+    ESP_RETURN_ON_ERROR(esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &align), TAG, "Get cache alignment failed");
+
+    // The PPA writes whole cache lines
+    preview->buf_size = (config->width * config->height * VIDEO_BYTES_PER_PIXEL + align - 1) / align * align;
+    for (int i = 0; i < config->buf_num; i++) {
+        preview->buffer[i] = media_arena_lend(preview->buf_size, NULL);
+        ESP_GOTO_ON_FALSE(preview->buffer[i], ESP_ERR_NO_MEM, err, TAG, "Allocate preview buffer failed");
+        preview->ref_count[i] = 0;
+    }
+    ESP_GOTO_ON_ERROR(ppa_register_client(&srm_config, &preview->ppa_handle), err, TAG, "Register PPA client failed");
+
+    preview->buf_num = config->buf_num;
+    preview->width = config->width;
+    preview->height = config->height;
+    preview->dropped = 0;
+    preview->enabled = true;
+    ESP_LOGI(TAG, "Preview stream %" PRIu32 "x%" PRIu32 " from %" PRIu32 "x%" PRIu32 ", %" PRIu32 " buffers", preview->width,
+             preview->height, app_camera_video.camera_buf_hes, app_camera_video.camera_buf_ves, preview->buf_num);
+
+    return ESP_OK;
+
+err:
+    video_free_pool(preview->buffer, config->buf_num);
+
+    return ret;
+}
+
+esp_err_t app_video_still_stream_init(const app_video_still_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    video_still_stream_t *still = &app_camera_video.still;
+    uint32_t width = app_camera_video.camera_buf_hes;
+    uint32_t height = app_camera_video.camera_buf_ves;
+    size_t align = 0;
+
+    ESP_RETURN_ON_FALSE(config && config->cb && (config->buf_num > 0) && (config->buf_num <= STILL_BUF_NUM_MAX),
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE((config->fmt != APP_VIDEO_STILL_FMT_JPEG) ||
+                        ((config->jpeg_quality > 0) && (config->jpeg_quality <= 100)), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid JPEG quality");
+    ESP_RETURN_ON_FALSE(!still->enabled, ESP_ERR_INVALID_STATE, TAG, "Still stream already initialized");
+    ESP_RETURN_ON_FALSE(width && height, ESP_ERR_INVALID_STATE, TAG, "Video device not opened");
+    ESP_RETURN_ON_ERROR(esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &align), TAG, "Get cache alignment failed");
+
+    still->config = *config;
+    if (config->fmt == APP_VIDEO_STILL_FMT_JPEG) {
+        jpeg_encode_engine_cfg_t encode_eng_cfg = {
+            .intr_priority = 0,
+            .timeout_ms = STILL_CODEC_TIMEOUT_MS,
+        };
+        jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+            .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+        };
+
+        ESP_GOTO_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &still->jpeg_handle), err, TAG, "Create JPEG encoder failed");
+        for (int i = 0; i < config->buf_num; i++) {
+            still->buffer[i] = jpeg_alloc_encoder_mem(width * height * VIDEO_BYTES_PER_PIXEL / STILL_JPEG_BUF_DIV, &out_mem_cfg,
+                                                      &still->buf_size);
+            ESP_GOTO_ON_FALSE(still->buffer[i], ESP_ERR_NO_MEM, err, TAG, "Allocate still buffer failed");
+        }
+    } else {
+        ppa_client_config_t srm_config = {
+            .oper_type = PPA_OPERATION_SRM,
+        };
+
+        ESP_GOTO_ON_ERROR(ppa_register_client(&srm_config, &still->ppa_handle), err, TAG, "Register PPA client failed");
+        still->buf_size = (width * height * VIDEO_BYTES_PER_PIXEL + align - 1) / align * align;
+        for (int i = 0; i < config->buf_num; i++) {
+            still->buffer[i] = media_arena_lend(still->buf_size, NULL);
+            ESP_GOTO_ON_FALSE(still->buffer[i], ESP_ERR_NO_MEM, err, TAG, "Allocate still buffer failed");
+        }
+    }
+    for (int i = 0; i < config->buf_num; i++) {
+        still->busy[i] = false;
+    }
+
+    still->queue = xQueueCreate(STILL_BUF_NUM_MAX, sizeof(video_still_job_t));
+    ESP_GOTO_ON_FALSE(still->queue, ESP_ERR_NO_MEM, err, TAG, "Create still queue failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_CAMERA_STILL, video_still_task, NULL, &still->task_handle) == pdPASS, ESP_ERR_NO_MEM, err, TAG, "Create still task failed");
+
+    still->requested = false;
+    still->enabled = true;
+    ESP_LOGI(TAG, "Still stream %" PRIu32 "x%" PRIu32 " %s, %" PRIu32 " buffers", width, height,
+             (config->fmt == APP_VIDEO_STILL_FMT_JPEG) ? "JPEG" : "raw", config->buf_num);
+
+    return ESP_OK;
+
+err:
+    if (still->queue) {
+        vQueueDelete(still->queue);
+        still->queue = NULL;
+    }
+    video_free_pool(still->buffer, config->buf_num);
+    if (still->jpeg_handle) {
+        jpeg_del_encoder_engine(still->jpeg_handle);
+        still->jpeg_handle = NULL;
+    }
+    if (still->ppa_handle) {
+        ppa_unregister_client(still->ppa_handle);
+        still->ppa_handle = NULL;
+    }
+
+    return ret;
+}
+
+esp_err_t app_video_still_request(void)
+{
+    ESP_RETURN_ON_FALSE(app_camera_video.still.enabled, ESP_ERR_INVALID_STATE, TAG, "Still stream not initialized");
+
+    __atomic_store_n(&app_camera_video.still.requested, true, __ATOMIC_RELEASE);
+
+    return ESP_OK;
+}
+
+esp_err_t app_video_still_release(uint8_t buf_index)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (buf_index >= app_camera_video.still.config.buf_num) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&frame_ref_lock);
+    if (!app_camera_video.still.busy[buf_index]) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        app_camera_video.still.busy[buf_index] = false;
+    }
+    portEXIT_CRITICAL(&frame_ref_lock);
+
+    return ret;
+}
+#endif
@@ -26,7 +26,14 @@ typedef enum {
 } video_fmt_t;
 
 #define EXAMPLE_CAM_DEV_PATH                (ESP_VIDEO_MIPI_CSI_DEVICE_NAME)
-#define EXAMPLE_CAM_BUF_NUM                 (2)
+#define APP_VIDEO_BUF_NUM_MAX               (6)
+#define APP_VIDEO_BUF_NUM_MIN               (2)
+#if CONFIG_CAMERA_DISPLAY_SINK_ASYNC
+// The display and the detector may each hold a frame while the driver still needs two
+#define EXAMPLE_CAM_BUF_NUM                 (4)
+#else
+#define EXAMPLE_CAM_BUF_NUM                 (3)
+#endif
 
 #if CONFIG_BSP_LCD_COLOR_FORMAT_RGB565
 #define APP_VIDEO_FMT              (APP_VIDEO_FMT_RGB565)
@@ -36,6 +43,60 @@ typedef enum {
 
 typedef void (*app_video_frame_operation_cb_t)(uint8_t *camera_buf, uint8_t camera_buf_index, uint32_t camera_buf_hes, uint32_t camera_buf_ves, size_t camera_buf_len);
 
+typedef enum {
+    APP_VIDEO_BUF_USERPTR_SPIRAM = 0,       /*!< Buffers allocated by app_video in PSRAM */
+    APP_VIDEO_BUF_USERPTR_INTERNAL,         /*!< Buffers allocated by app_video in internal RAM */
+    APP_VIDEO_BUF_MMAP,                     /*!< Buffers allocated by the video driver */
+    APP_VIDEO_BUF_MODE_MAX,
+} app_video_buf_mode_t;
+
+typedef struct {
+    uint32_t buf_num;                       /*!< V4L2 buffers, APP_VIDEO_BUF_NUM_MIN to APP_VIDEO_BUF_NUM_MAX */
+    app_video_buf_mode_t mode;              /*!< Memory mode and placement of the buffers */
+} app_video_buf_config_t;
+
+typedef struct {
+    uint32_t frames;                        /*!< Frames dequeued */
+    uint32_t starved;                       /*!< Dequeues that left the driver without a buffer to capture into */
+    uint64_t starved_us;                    /*!< Total time the driver had no buffer */
+    uint32_t min_queued;                    /*!< Fewest buffers left with the driver after a dequeue */
+} app_video_buf_stats_t;
+
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+typedef enum {
+    APP_VIDEO_STILL_FMT_RAW = 0,            /*!< Copy of the captured frame, in APP_VIDEO_FMT */
+    APP_VIDEO_STILL_FMT_JPEG,               /*!< JPEG encoded by the hardware encoder */
+} app_video_still_fmt_t;
+
+/**
+ * @brief Called from the still task with a full resolution frame.
+ *
+ * The buffer stays valid until it is handed back with `app_video_still_release`.
+ *
+ * @param buf Still buffer.
+ * @param buf_index Index of the still buffer.
+ * @param width Frame width in pixels.
+ * @param height Frame height in pixels.
+ * @param len Valid bytes in the buffer.
+ * @param user_ctx User context of the still stream.
+ */
+typedef void (*app_video_still_cb_t)(uint8_t *buf, uint8_t buf_index, uint32_t width, uint32_t height, size_t len, void *user_ctx);
+
+typedef struct {
+    uint32_t width;                         /*!< Preview width, at most the capture width */
+    uint32_t height;                        /*!< Preview height, at most the capture height */
+    uint32_t buf_num;                       /*!< Preview buffers, the consumers may hold all but one */
+} app_video_preview_config_t;
+
+typedef struct {
+    app_video_still_fmt_t fmt;              /*!< Format of the stills */
+    uint32_t buf_num;                       /*!< Still buffers, 1 or 2 */
+    uint8_t jpeg_quality;                   /*!< JPEG quality 1-100, only used for APP_VIDEO_STILL_FMT_JPEG */
+    app_video_still_cb_t cb;                /*!< Called for every still */
+    void *user_ctx;                         /*!< User context for the callback */
+} app_video_still_config_t;
+#endif
+
 /**
  * @brief Initialize the video camera.
  *
@@ -47,6 +108,15 @@ typedef void (*app_video_frame_operation_cb_t)(uint8_t *camera_buf, uint8_t came
  */
 esp_err_t app_video_main(i2c_master_bus_handle_t i2c_bus_handle);
 
+/**
+ * @brief Check whether the previous boot detected no camera sensor.
+ *
+ * Only known with CONFIG_CAMERA_SENSOR_PROBE_CACHE, valid after `app_video_main`.
+ *
+ * @return true if the sensor cache records a boot without a sensor, false otherwise.
+ */
+bool app_video_sensor_absent_last_boot(void);
+
 /**
  * @brief Opens a specified video capture device and configures its format.
  *
@@ -77,6 +147,30 @@ int app_video_open(char *dev, video_fmt_t init_fmt);
  */
 esp_err_t app_video_set_bufs(int video_fd, uint32_t fb_num, const void **fb);
 
+/**
+ * @brief Allocate the video capture buffers and queue them to the driver.
+ *
+ * USERPTR buffers are allocated here, aligned to the cache line, and kept for the lifetime of the application.
+ * Unlike `app_video_set_bufs` the device stays open when the buffers can't be allocated, so the caller can
+ * retry with a smaller configuration.
+ *
+ * @param video_fd File descriptor for the video device.
+ * @param config Number, memory mode and placement of the buffers.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad configuration, ESP_ERR_INVALID_STATE if
+ *         buffers were already allocated, ESP_ERR_NO_MEM if they don't fit, or ESP_FAIL if the driver
+ *         rejected them (the device is closed then).
+ */
+esp_err_t app_video_alloc_bufs(int video_fd, const app_video_buf_config_t *config);
+
+/**
+ * @brief Get the buffer starvation statistics of the stream.
+ *
+ * @param stats Output statistics.
+ * @param reset Start counting again after reading.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if stats is NULL.
+ */
+esp_err_t app_video_get_buf_stats(app_video_buf_stats_t *stats, bool reset);
+
 /**
  * @brief Retrieve video capture buffers.
  *
@@ -135,6 +229,83 @@ esp_err_t app_video_stream_task_stop(int video_fd);
  */
 esp_err_t app_video_register_frame_operation_cb(app_video_frame_operation_cb_t operation_cb);
 
+/**
+ * @brief Take an additional reference on a dequeued video frame.
+ *
+ * Every frame handed to the frame operation callback holds one reference owned by the
+ * video stream task, which is dropped when the callback returns. Consumers that keep
+ * using the frame after the callback (e.g. a detector running on another core) must
+ * take their own reference here and drop it with `app_video_frame_release`. With
+ * `CONFIG_CAMERA_VIDEO_MULTI_STREAM` the reference belongs to the pool the frame came from,
+ * preview or V4L2, and is released there even if the preview stream is enabled meanwhile.
+ *
+ * @param buf_index Index of the frame buffer, as passed to the frame operation callback.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the index is out of range,
+ *         or ESP_ERR_INVALID_STATE if the frame is not currently dequeued or the same index
+ *         is still referenced from the other pool.
+ */
+esp_err_t app_video_frame_acquire(uint8_t buf_index);
+
+/**
+ * @brief Drop a reference on a dequeued video frame.
+ *
+ * The frame buffer is queued back to the driver (VIDIOC_QBUF) once the last reference
+ * has been released, so the driver never overwrites a frame that is still in use.
+ *
+ * @param buf_index Index of the frame buffer, as passed to the frame operation callback.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the index is out of range,
+ *         ESP_ERR_INVALID_STATE if the frame holds no reference, or ESP_FAIL if queuing fails.
+ */
+esp_err_t app_video_frame_release(uint8_t buf_index);
+
+#if CONFIG_CAMERA_VIDEO_MULTI_STREAM
+/**
+ * @brief Deliver a downscaled preview stream instead of the captured frames.
+ *
+ * Every captured frame is scaled by the PPA into a free buffer of the preview pool and the V4L2 buffer goes back
+ * to the driver right away. The frame operation callback, `app_video_frame_acquire` and `app_video_frame_release`
+ * then work on preview buffers. A frame is dropped when every preview buffer is still referenced.
+ *
+ * Must be called after `app_video_open` and before the stream starts.
+ *
+ * @param config Preview size and number of buffers.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_SIZE for a bad configuration,
+ *         ESP_ERR_INVALID_STATE if the device isn't opened or the stream already exists, ESP_ERR_NO_MEM otherwise.
+ */
+esp_err_t app_video_preview_stream_init(const app_video_preview_config_t *config);
+
+/**
+ * @brief Create the on-demand still stream at the capture resolution.
+ *
+ * A still is taken from the first captured frame after `app_video_still_request` for which a still buffer is free,
+ * and converted by its own task while the preview goes on. Without a preview stream the frame operation callback
+ * runs on the same frame meanwhile, so it must not draw into it.
+ *
+ * Must be called after `app_video_open` and before the stream starts.
+ *
+ * @param config Format, number of buffers and callback of the stills.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad configuration,
+ *         ESP_ERR_INVALID_STATE if the device isn't opened or the stream already exists, or an allocation error.
+ */
+esp_err_t app_video_still_stream_init(const app_video_still_config_t *config);
+
+/**
+ * @brief Request a still from one of the next captured frames.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the still stream isn't initialized.
+ */
+esp_err_t app_video_still_request(void);
+
+/**
+ * @brief Hand a still buffer back to the still stream.
+ *
+ * @param buf_index Index of the still buffer, as passed to the still callback.
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the index is out of range,
+ *         or ESP_ERR_INVALID_STATE if the buffer isn't in use.
+ */
+esp_err_t app_video_still_release(uint8_t buf_index);
+#endif
+
 /**
  * @brief Wait for the video stream to stop.
  *
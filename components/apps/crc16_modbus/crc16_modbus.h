@@ -0,0 +1,43 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC16_MODBUS_INIT           (0xFFFF)    /*!< Initial value of a Modbus CRC */
+
+/**
+ * @brief Continue a CRC16/Modbus over more data
+ *
+ * Lets decoders check a frame while it is received. Start with `CRC16_MODBUS_INIT`.
+ *
+ * @param crc   CRC of the previous data
+ * @param data  Data
+ * @param len   Bytes of `data`
+ *
+ * @return CRC including `data`
+ */
+uint16_t crc16_modbus_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Compute the CRC16/Modbus of a buffer, one table lookup per byte
+ *
+ * @param data  Data
+ * @param len   Bytes of `data`
+ *
+ * @return CRC, sent low byte first on the bus
+ */
+uint16_t crc16_modbus(const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
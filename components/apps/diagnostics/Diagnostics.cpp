@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <cinttypes>
+#include "esp_log.h"
+#include "Diagnostics.hpp"
+
+#define RECORD_ROWS             (40)
+#define REFRESH_PERIOD_MS       (5000)
+#define TABLE_FONT              &lv_font_montserrat_14
+#define TITLE_FONT              &lv_font_montserrat_16
+
+using namespace std;
+
+static const char *TAG = "Diagnostics";
+
+Diagnostics::Diagnostics():
+    ESP_Brookesia_PhoneApp("Diagnostics", nullptr, true),
+    _timer(nullptr),
+    _summary_label(nullptr),
+    _table(nullptr)
+{
+}
+
+Diagnostics::~Diagnostics()
+{
+}
+
+bool Diagnostics::run(void)
+{
+    lv_area_t area = getVisualArea();
+    lv_coord_t width = area.x2 - area.x1;
+    lv_obj_t *screen = lv_scr_act();
+
+    lv_obj_set_flex_flow(screen, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_style_pad_all(screen, 6, 0);
+    lv_obj_set_style_pad_row(screen, 6, 0);
+
+    lv_obj_t *header = lv_obj_create(screen);
+    lv_obj_remove_style_all(header);
+    lv_obj_set_size(header, LV_PCT(100), LV_SIZE_CONTENT);
+    lv_obj_set_flex_flow(header, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(header, LV_FLEX_ALIGN_SPACE_BETWEEN, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+
+    _summary_label = lv_label_create(header);
+    lv_obj_set_flex_grow(_summary_label, 1);
+    lv_obj_set_style_text_font(_summary_label, TITLE_FONT, 0);
+    lv_label_set_long_mode(_summary_label, LV_LABEL_LONG_WRAP);
+    lv_label_set_text(_summary_label, "Reading...");
+
+    lv_obj_t *clear_btn = lv_btn_create(header);
+    lv_obj_add_event_cb(clear_btn, clear_event_cb, LV_EVENT_CLICKED, this);
+    lv_obj_t *clear_label = lv_label_create(clear_btn);
+    lv_label_set_text(clear_label, "Clear");
+
+    _table = lv_table_create(screen);
+    lv_obj_set_width(_table, LV_PCT(100));
+    lv_obj_set_flex_grow(_table, 1);
+    lv_obj_set_style_text_font(_table, TABLE_FONT, LV_PART_ITEMS);
+    lv_obj_set_style_pad_ver(_table, 4, LV_PART_ITEMS);
+    lv_table_set_col_cnt(_table, 4);
+    lv_table_set_row_cnt(_table, 1);
+    const char *titles[] = {"Boot", "Uptime", "Event", "Details"};
+    lv_table_set_col_width(_table, 0, (width - 20) / 8);
+    lv_table_set_col_width(_table, 1, (width - 20) / 6);
+    lv_table_set_col_width(_table, 2, (width - 20) / 6);
+    lv_table_set_col_width(_table, 3, (width - 20) - (width - 20) / 8 - (width - 20) / 6 * 2);
+    for (int i = 0; i < 4; i++) {
+        lv_table_set_cell_value(_table, 0, i, titles[i]);
+    }
+
+    _records.resize(RECORD_ROWS);
+    // Samples are appended at most every few seconds, the records are read again at that pace
+    _timer = lv_timer_create(refresh_timer_cb, REFRESH_PERIOD_MS, this);
+    refresh();
+
+    return true;
+}
+
+bool Diagnostics::back(void)
+{
+    notifyCoreClosed();
+
+    return true;
+}
+
+bool Diagnostics::close(void)
+{
+    if (_timer) {
+        lv_timer_del(_timer);
+        _timer = nullptr;
+    }
+    // The screen is deleted by the core
+    _summary_label = nullptr;
+    _table = nullptr;
+    vector<perf_log_record_t>().swap(_records);
+
+    return true;
+}
+
+bool Diagnostics::pause(void)
+{
+    if (_timer) {
+        lv_timer_pause(_timer);
+    }
+
+    return true;
+}
+
+bool Diagnostics::resume(void)
+{
+    if (_timer) {
+        lv_timer_resume(_timer);
+    }
+
+    return true;
+}
+
+void Diagnostics::refresh(void)
+{
+    size_t count = 0;
+    esp_err_t ret = perf_log_read(_records.data(), _records.size(), &count);
+
+    if (ret == ESP_ERR_INVALID_STATE) {
+        lv_label_set_text(_summary_label, "The log is not open, check the perflog partition");
+        lv_table_set_row_cnt(_table, 1);
+        return;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Read the log failed: %s", esp_err_to_name(ret));
+    }
+    updateSummary(count);
+    updateTable(count);
+}
+
+void Diagnostics::updateSummary(size_t count)
+{
+    const perf_log_record_t *last_boot = nullptr;
+    const perf_log_record_t *last_panic = nullptr;
+
+    // Newest first
+    for (size_t i = 0; i < count; i++) {
+        if ((_records[i].type == PERF_LOG_RECORD_BOOT) && (last_boot == nullptr)) {
+            last_boot = &_records[i];
+        } else if ((_records[i].type == PERF_LOG_RECORD_PANIC) && (last_panic == nullptr)) {
+            last_panic = &_records[i];
+        }
+    }
+
+    if (last_boot == nullptr) {
+        lv_label_set_text(_summary_label, "No boot recorded");
+    } else if (last_panic == nullptr) {
+        lv_label_set_text_fmt(_summary_label, "Boot %u, reset by %s, no panic in the last %u records",
+                              (unsigned)last_boot->boot, perf_log_reset_reason_str(last_boot->reset.reason),
+                              (unsigned)count);
+    } else {
+        lv_label_set_text_fmt(_summary_label, "Boot %u, reset by %s, last panic in boot %u, task %s",
+                              (unsigned)last_boot->boot, perf_log_reset_reason_str(last_boot->reset.reason),
+                              (unsigned)last_panic->boot, last_panic->panic.task);
+    }
+}
+
+void Diagnostics::updateTable(size_t count)
+{
+    char buf[96];
+
+    lv_table_set_row_cnt(_table, 1 + count);
+    for (size_t i = 0; i < count; i++) {
+        const perf_log_record_t &record = _records[i];
+        uint16_t row = i + 1;
+
+        lv_table_set_cell_value_fmt(_table, row, 0, "%u", (unsigned)record.boot);
+        lv_table_set_cell_value_fmt(_table, row, 1, "%" PRIu32 ":%02" PRIu32 ":%02" PRIu32, record.uptime_s / 3600,
+                                    (record.uptime_s / 60) % 60, record.uptime_s % 60);
+        switch (record.type) {
+        case PERF_LOG_RECORD_BOOT:
+            lv_table_set_cell_value(_table, row, 2, "Boot");
+            snprintf(buf, sizeof(buf), "Reset by %s", perf_log_reset_reason_str(record.reset.reason));
+            break;
+        case PERF_LOG_RECORD_PANIC:
+            lv_table_set_cell_value(_table, row, 2, "Panic");
+            snprintf(buf, sizeof(buf), "%s PC 0x%08" PRIx32 " RA 0x%08" PRIx32 " SP 0x%08" PRIx32 " cause %" PRIu32,
+                     record.panic.task, record.panic.pc, record.panic.ra, record.panic.sp, record.panic.cause);
+            break;
+        case PERF_LOG_RECORD_SAMPLE:
+            lv_table_set_cell_value(_table, row, 2, "Sample");
+            snprintf(buf, sizeof(buf),
+                     "Cam %u.%u FPS, %u frames avg %u max %u ms, min SRAM %" PRIu32 " KB PSRAM %" PRIu32 " KB",
+                     record.sample.camera_fps_x10 / 10, record.sample.camera_fps_x10 % 10,
+                     record.sample.frame_num, record.sample.frame_avg_ms, record.sample.frame_max_ms,
+                     record.sample.internal_min_free / 1024, record.sample.psram_min_free / 1024);
+            break;
+        default:
+            lv_table_set_cell_value(_table, row, 2, "?");
+            buf[0] = '\0';
+            break;
+        }
+        lv_table_set_cell_value(_table, row, 3, buf);
+    }
+}
+
+void Diagnostics::refresh_timer_cb(lv_timer_t *t)
+{
+    Diagnostics *app = (Diagnostics *)t->user_data;
+
+    app->refresh();
+}
+
+void Diagnostics::clear_event_cb(lv_event_t *e)
+{
+    Diagnostics *app = (Diagnostics *)lv_event_get_user_data(e);
+
+    if (perf_log_clear() != ESP_OK) {
+        ESP_LOGW(TAG, "Clear the log failed");
+    }
+    app->refresh();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include "lvgl.h"
+#include "esp_brookesia.hpp"
+#include "perf_log/perf_log.h"
+
+/**
+ * @brief Newest records of the crash and performance log in flash: reset reasons, panic summaries and the
+ *        periodic samples, so regressions of the units in the field can be read back without a serial cable
+ */
+class Diagnostics: public ESP_Brookesia_PhoneApp
+{
+public:
+    Diagnostics();
+    ~Diagnostics();
+
+    bool run(void) override;
+    bool back(void) override;
+    bool close(void) override;
+    bool pause(void) override;
+    bool resume(void) override;
+
+private:
+    void refresh(void);
+    void updateSummary(size_t count);
+    void updateTable(size_t count);
+
+    static void refresh_timer_cb(lv_timer_t *t);
+    static void clear_event_cb(lv_event_t *e);
+
+    lv_timer_t *_timer;
+    lv_obj_t *_summary_label;
+    lv_obj_t *_table;
+    std::vector<perf_log_record_t> _records;
+};
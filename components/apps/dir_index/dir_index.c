@@ -0,0 +1,444 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "dir_index.h"
+
+#define INDEX_FILE_NAME             ".dir_index"
+#define INDEX_MAGIC                 (0x31584944)    /* "DIX1" */
+#define INDEX_VERSION               (1)
+#define INDEX_NAME_MAX              (255)
+#define INDEX_PATH_LEN              (320)
+#define INDEX_PAGE_SIZE             (32)    /* Names read from the index file at once */
+#define INDEX_PAGE_NUM              (4)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t dir_mtime;
+    uint32_t record_num;
+    uint32_t names_size;
+} index_file_header_t;
+
+/* Followed in the file by the names, NUL terminated and in record order */
+typedef struct {
+    uint32_t name_offset;
+    uint32_t size;
+    uint32_t mtime;
+} index_record_t;
+
+typedef struct {
+    int page;                   /* -1 if unused */
+    uint32_t last_use;
+    char *names;                /* Names of the page, from the name of its first record */
+} index_page_t;
+
+typedef struct {
+    const char *name;
+    index_record_t rec;
+} index_scan_entry_t;
+
+struct dir_index_t {
+    char *dir;
+    int num;
+    index_record_t *records;
+    uint32_t names_size;
+    char *names;                /* All names, kept when the index file can't be used to page them */
+    FILE *fp;                   /* Index file the names are paged from */
+    uint32_t names_offset;      /* Offset of the names in the index file */
+    index_page_t pages[INDEX_PAGE_NUM];
+    uint32_t use_counter;
+    SemaphoreHandle_t lock;     /* Guards the pages and the index file */
+};
+
+static const char *TAG = "dir_index";
+
+static bool index_is_listed(const struct dirent *entry)
+{
+    return (entry->d_type == DT_REG) && (entry->d_name[0] != '.');
+}
+
+static uint32_t index_dir_mtime(const char *dir)
+{
+    struct stat st;
+
+    // SPIFFS has no directories, the listing is then only checked by its file count
+    return (stat(dir, &st) == 0) ? (uint32_t)st.st_mtime : 0;
+}
+
+#if CONFIG_DIR_INDEX_VERIFY_COUNT
+static int index_count_files(const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    int num = 0;
+
+    if (d == NULL) {
+        return -1;
+    }
+    while ((entry = readdir(d)) != NULL) {
+        num += index_is_listed(entry);
+    }
+    closedir(d);
+
+    return num;
+}
+#endif
+
+static bool index_load(dir_index_handle_t handle, uint32_t dir_mtime)
+{
+    char path[INDEX_PATH_LEN];
+    index_file_header_t header;
+    FILE *fp = NULL;
+
+    snprintf(path, sizeof(path), "%s/" INDEX_FILE_NAME, handle->dir);
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ESP_LOGI(TAG, "No index in %s, scan it", handle->dir);
+        return false;
+    }
+    if ((fread(&header, sizeof(header), 1, fp) != 1) || (header.magic != INDEX_MAGIC) ||
+            (header.version != INDEX_VERSION) || (header.record_size != sizeof(index_record_t))) {
+        ESP_LOGW(TAG, "Index in %s is invalid, rescan it", handle->dir);
+        goto err;
+    }
+    if (header.dir_mtime != dir_mtime) {
+        ESP_LOGI(TAG, "%s changed, rescan it", handle->dir);
+        goto err;
+    }
+#if CONFIG_DIR_INDEX_VERIFY_COUNT
+    // FAT keeps the time of a directory when files are added to it by a PC
+    if (index_count_files(handle->dir) != (int)header.record_num) {
+        ESP_LOGI(TAG, "Files of %s changed, rescan it", handle->dir);
+        goto err;
+    }
+#endif
+
+    // A file cut short by a power off is found by its size
+    uint32_t names_offset = sizeof(header) + header.record_num * sizeof(index_record_t);
+    if ((fseek(fp, 0, SEEK_END) != 0) || (ftell(fp) != (long)(names_offset + header.names_size)) ||
+            (fseek(fp, sizeof(header), SEEK_SET) != 0)) {
+        ESP_LOGW(TAG, "Index in %s is truncated, rescan it", handle->dir);
+        goto err;
+    }
+    handle->records = heap_caps_malloc((header.record_num > 0 ? header.record_num : 1) * sizeof(index_record_t),
+                                       MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if ((handle->records == NULL) ||
+            (fread(handle->records, sizeof(index_record_t), header.record_num, fp) != header.record_num)) {
+        ESP_LOGW(TAG, "Read index of %s failed, rescan it", handle->dir);
+        heap_caps_free(handle->records);
+        handle->records = NULL;
+        goto err;
+    }
+    handle->num = header.record_num;
+    handle->names_size = header.names_size;
+    handle->names_offset = names_offset;
+    handle->fp = fp;
+    ESP_LOGI(TAG, "Loaded %d files of %s", handle->num, handle->dir);
+
+    return true;
+
+err:
+    fclose(fp);
+    return false;
+}
+
+static int index_scan_cmp(const void *a, const void *b)
+{
+    return strcasecmp(((const index_scan_entry_t *)a)->name, ((const index_scan_entry_t *)b)->name);
+}
+
+static esp_err_t index_scan(dir_index_handle_t handle)
+{
+    esp_err_t ret = ESP_OK;
+    char path[INDEX_PATH_LEN];
+    index_scan_entry_t *entries = NULL;
+    char *names = NULL;
+    int num = 0;
+    int max_num = 0;
+    DIR *d = NULL;
+    struct dirent *entry;
+    struct stat st;
+
+    d = opendir(handle->dir);
+    ESP_RETURN_ON_FALSE(d, ESP_ERR_NOT_FOUND, TAG, "Open %s failed", handle->dir);
+    while ((entry = readdir(d)) != NULL) {
+        if (!index_is_listed(entry)) {
+            continue;
+        }
+        if (num == max_num) {
+            max_num = (max_num > 0) ? max_num * 2 : 64;
+            index_scan_entry_t *grown = heap_caps_realloc(entries, max_num * sizeof(index_scan_entry_t),
+                                                          MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            ESP_GOTO_ON_FALSE(grown, ESP_ERR_NO_MEM, err, TAG, "Alloc %d entries failed", max_num);
+            entries = grown;
+        }
+        index_scan_entry_t *scanned = &entries[num];
+        scanned->name = strndup(entry->d_name, INDEX_NAME_MAX);
+        ESP_GOTO_ON_FALSE(scanned->name, ESP_ERR_NO_MEM, err, TAG, "Alloc name failed");
+        num++;
+        snprintf(path, sizeof(path), "%s/%s", handle->dir, scanned->name);
+        if (stat(path, &st) == 0) {
+            scanned->rec.size = st.st_size;
+            scanned->rec.mtime = st.st_mtime;
+        } else {
+            scanned->rec.size = 0;
+            scanned->rec.mtime = 0;
+        }
+    }
+    closedir(d);
+    d = NULL;
+
+    qsort(entries, num, sizeof(index_scan_entry_t), index_scan_cmp);
+
+    // The names are laid out in sorted order, so the names of a page are contiguous
+    uint32_t names_size = 0;
+    for (int i = 0; i < num; i++) {
+        names_size += strlen(entries[i].name) + 1;
+    }
+    handle->records = heap_caps_malloc((num > 0 ? num : 1) * sizeof(index_record_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    names = heap_caps_malloc(names_size > 0 ? names_size : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(handle->records && names, ESP_ERR_NO_MEM, err, TAG, "Alloc index failed");
+    names_size = 0;
+    for (int i = 0; i < num; i++) {
+        size_t len = strlen(entries[i].name) + 1;
+        handle->records[i] = entries[i].rec;
+        handle->records[i].name_offset = names_size;
+        memcpy(names + names_size, entries[i].name, len);
+        names_size += len;
+    }
+    handle->num = num;
+    handle->names = names;
+    handle->names_size = names_size;
+    names = NULL;
+    ESP_LOGI(TAG, "Scanned %d files of %s", num, handle->dir);
+
+err:
+    if (d) {
+        closedir(d);
+    }
+    for (int i = 0; i < num; i++) {
+        free((void *)entries[i].name);
+    }
+    heap_caps_free(entries);
+    heap_caps_free(names);
+    if ((ret != ESP_OK) && handle->records) {
+        heap_caps_free(handle->records);
+        handle->records = NULL;
+    }
+
+    return ret;
+}
+
+static bool index_save(dir_index_handle_t handle, uint32_t dir_mtime)
+{
+    char path[INDEX_PATH_LEN];
+    char tmp_path[INDEX_PATH_LEN];
+    index_file_header_t header = {
+        .magic = INDEX_MAGIC,
+        .version = INDEX_VERSION,
+        .record_size = sizeof(index_record_t),
+        .dir_mtime = dir_mtime,
+        .record_num = handle->num,
+        .names_size = handle->names_size,
+    };
+    FILE *fp = NULL;
+    bool ok = true;
+
+    snprintf(path, sizeof(path), "%s/" INDEX_FILE_NAME, handle->dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/" INDEX_FILE_NAME ".tmp", handle->dir);
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        ESP_LOGW(TAG, "Create %s failed", tmp_path);
+        return false;
+    }
+    ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+         (fwrite(handle->records, sizeof(index_record_t), handle->num, fp) == (size_t)handle->num) &&
+         (fwrite(handle->names, 1, handle->names_size, fp) == handle->names_size);
+    ok = (fclose(fp) == 0) && ok;
+
+    // FAT can't rename over an existing file
+    if (ok) {
+        remove(path);
+        ok = (rename(tmp_path, path) == 0);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "Save %s failed", path);
+        remove(tmp_path);
+        return false;
+    }
+
+    // From now on the names are paged from the file
+    fp = fopen(path, "r+b");
+    if (fp == NULL) {
+        return false;
+    }
+    // Where creating the file changes the time of the directory, the index must be valid for the new time
+    header.dir_mtime = index_dir_mtime(handle->dir);
+    if (header.dir_mtime != dir_mtime) {
+        fseek(fp, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, fp);
+        fflush(fp);
+    }
+    handle->fp = fp;
+    handle->names_offset = sizeof(header) + handle->num * sizeof(index_record_t);
+    heap_caps_free(handle->names);
+    handle->names = NULL;
+    ESP_LOGD(TAG, "Saved %d files to %s", handle->num, path);
+
+    return true;
+}
+
+/* Called with the lock held */
+static const char *index_page_name(dir_index_handle_t handle, int index)
+{
+    int page = index / INDEX_PAGE_SIZE;
+    index_page_t *slot = NULL;
+
+    for (int i = 0; i < INDEX_PAGE_NUM; i++) {
+        index_page_t *cur = &handle->pages[i];
+        if (cur->page == page) {
+            slot = cur;
+            break;
+        }
+        if ((slot == NULL) || (cur->page < 0) ||
+                ((slot->page >= 0) && ((int32_t)(cur->last_use - slot->last_use) < 0))) {
+            slot = cur;
+        }
+    }
+
+    int first = page * INDEX_PAGE_SIZE;
+    if (slot->page != page) {
+        int last = first + INDEX_PAGE_SIZE;
+        uint32_t start = handle->records[first].name_offset;
+        uint32_t end = (last < handle->num) ? handle->records[last].name_offset : handle->names_size;
+
+        heap_caps_free(slot->names);
+        slot->page = -1;
+        slot->names = heap_caps_malloc(end - start, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if ((slot->names == NULL) || (fseek(handle->fp, handle->names_offset + start, SEEK_SET) != 0) ||
+                (fread(slot->names, 1, end - start, handle->fp) != end - start) || (slot->names[end - start - 1] != '\0')) {
+            ESP_LOGE(TAG, "Read names of page %d failed", page);
+            heap_caps_free(slot->names);
+            slot->names = NULL;
+            return NULL;
+        }
+        slot->page = page;
+    }
+    slot->last_use = ++handle->use_counter;
+
+    return slot->names + (handle->records[index].name_offset - handle->records[first].name_offset);
+}
+
+esp_err_t dir_index_open(const char *dir, dir_index_handle_t *ret_handle)
+{
+    esp_err_t ret = ESP_OK;
+    dir_index_handle_t handle = NULL;
+
+    ESP_RETURN_ON_FALSE(dir && ret_handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    handle = heap_caps_calloc(1, sizeof(struct dir_index_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "Alloc handle failed");
+    for (int i = 0; i < INDEX_PAGE_NUM; i++) {
+        handle->pages[i].page = -1;
+    }
+    handle->dir = strdup(dir);
+    handle->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(handle->dir && handle->lock, ESP_ERR_NO_MEM, err, TAG, "Alloc handle failed");
+
+    uint32_t dir_mtime = index_dir_mtime(dir);
+    if (!index_load(handle, dir_mtime)) {
+        ESP_GOTO_ON_ERROR(index_scan(handle), err, TAG, "Scan %s failed", dir);
+        // Without a saved index, e.g. on a read-only card, the names stay in memory
+        index_save(handle, dir_mtime);
+    }
+    *ret_handle = handle;
+
+    return ESP_OK;
+
+err:
+    if (handle->lock) {
+        vSemaphoreDelete(handle->lock);
+    }
+    free(handle->dir);
+    heap_caps_free(handle);
+
+    return ret;
+}
+
+void dir_index_close(dir_index_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+
+    if (handle->fp) {
+        fclose(handle->fp);
+    }
+    for (int i = 0; i < INDEX_PAGE_NUM; i++) {
+        heap_caps_free(handle->pages[i].names);
+    }
+    vSemaphoreDelete(handle->lock);
+    heap_caps_free(handle->names);
+    heap_caps_free(handle->records);
+    free(handle->dir);
+    heap_caps_free(handle);
+}
+
+int dir_index_get_count(dir_index_handle_t handle)
+{
+    return (handle != NULL) ? handle->num : 0;
+}
+
+esp_err_t dir_index_get_name(dir_index_handle_t handle, int index, char *name, size_t len)
+{
+    const char *src = NULL;
+
+    ESP_RETURN_ON_FALSE(handle && (index >= 0) && (index < handle->num) && name && len, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    src = handle->names ? (handle->names + handle->records[index].name_offset) : index_page_name(handle, index);
+    if (src) {
+        strlcpy(name, src, len);
+    }
+    xSemaphoreGive(handle->lock);
+
+    return src ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t dir_index_get_path(dir_index_handle_t handle, int index, char *path, size_t len)
+{
+    ESP_RETURN_ON_FALSE(handle && path && (len > strlen(handle->dir) + 1), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+
+    int dir_len = snprintf(path, len, "%s/", handle->dir);
+
+    return dir_index_get_name(handle, index, path + dir_len, len - dir_len);
+}
+
+esp_err_t dir_index_get_info(dir_index_handle_t handle, int index, dir_index_info_t *info)
+{
+    ESP_RETURN_ON_FALSE(handle && (index >= 0) && (index < handle->num) && info, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+
+    info->size = handle->records[index].size;
+    info->mtime = handle->records[index].mtime;
+
+    return ESP_OK;
+}
@@ -0,0 +1,95 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Size and time of one file
+ */
+typedef struct {
+    uint32_t size;                      /*!< Size in bytes */
+    uint32_t mtime;                     /*!< Modification time, seconds since the epoch */
+} dir_index_info_t;
+
+typedef struct dir_index_t *dir_index_handle_t;
+
+/**
+ * @brief Open the sorted listing of the files of a directory.
+ *
+ * The listing saved in `<dir>/.dir_index` is used as long as the time of the directory has not changed (and, with
+ * `CONFIG_DIR_INDEX_VERIFY_COUNT`, the directory still has as many files), so only the file sizes and times are
+ * loaded and the names are read from the index file a page at a time when asked for. Otherwise the directory is
+ * scanned, the files are sorted by name, case-insensitive, and the listing is saved again.
+ *
+ * Hidden files, whose name starts with '.', and subdirectories are not listed.
+ *
+ * @param dir Directory, without the trailing '/'.
+ * @param ret_handle Filled with the handle of the listing.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the directory can't be read, or an error code on failure.
+ */
+esp_err_t dir_index_open(const char *dir, dir_index_handle_t *ret_handle);
+
+/**
+ * @brief Close the listing and free the handle.
+ *
+ * @param handle Handle of the listing, can be NULL.
+ */
+void dir_index_close(dir_index_handle_t handle);
+
+/**
+ * @brief Get the number of files.
+ *
+ * @param handle Handle of the listing, can be NULL.
+ */
+int dir_index_get_count(dir_index_handle_t handle);
+
+/**
+ * @brief Get the name of a file, can be called from any task.
+ *
+ * @param handle Handle of the listing.
+ * @param index Index of the file in sorted order.
+ * @param name Filled with the name, cut to fit.
+ * @param len Size of `name`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index, or ESP_FAIL if the index file can't be read.
+ */
+esp_err_t dir_index_get_name(dir_index_handle_t handle, int index, char *name, size_t len);
+
+/**
+ * @brief Get the path of a file, the directory followed by the name, can be called from any task.
+ *
+ * @param handle Handle of the listing.
+ * @param index Index of the file in sorted order.
+ * @param path Filled with the path, cut to fit.
+ * @param len Size of `path`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index, or ESP_FAIL if the index file can't be read.
+ */
+esp_err_t dir_index_get_path(dir_index_handle_t handle, int index, char *path, size_t len);
+
+/**
+ * @brief Get the size and time of a file, does not touch the storage.
+ *
+ * @param handle Handle of the listing.
+ * @param index Index of the file in sorted order.
+ * @param info Filled with the size and time.
+ *
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG for a bad index.
+ */
+esp_err_t dir_index_get_info(dir_index_handle_t handle, int index, dir_index_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
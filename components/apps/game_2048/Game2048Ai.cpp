@@ -0,0 +1,327 @@
+#include <math.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "task_config/task_config.h"
+#include "Game2048Ai.hpp"
+
+#define AI_TT_BITS              (14)
+#define AI_TT_SIZE              (1 << AI_TT_BITS)
+// Chance branches less likely than this are scored without searching deeper
+#define AI_CPROB_MIN            (0.0001f)
+#define AI_SPAWN_4_PROB         (0.1f)
+
+// Heuristic weights, tiles are scored by weight (log2 of the value)
+#define HEUR_LOST_PENALTY       (200000.0f)
+#define HEUR_MONOTONICITY_POWER (4.0f)
+#define HEUR_MONOTONICITY_WEIGHT (47.0f)
+#define HEUR_SUM_POWER          (3.5f)
+#define HEUR_SUM_WEIGHT         (11.0f)
+#define HEUR_MERGES_WEIGHT      (700.0f)
+#define HEUR_EMPTY_WEIGHT       (270.0f)
+
+typedef Game2048Board::board_t board_t;
+
+static const char *TAG = "Game2048Ai";
+
+/**
+ * @brief Score of a single row: empty cells, pending merges and monotonic rows are good, large scattered
+ *        tiles are bad. A board is the sum of its rows and of its columns.
+ */
+static float ai_row_heuristic(uint32_t row)
+{
+    int weight[4];
+    float sum = 0;
+    int empty = 0;
+    int merges = 0;
+    int prev = 0;
+    int counter = 0;
+    float mono_left = 0;
+    float mono_right = 0;
+
+    for (int i = 0; i < 4; i++) {
+        weight[i] = (row >> (4 * i)) & 0xf;
+        sum += powf(weight[i], HEUR_SUM_POWER);
+        if (weight[i] == 0) {
+            empty++;
+        } else {
+            if (prev == weight[i]) {
+                counter++;
+            } else if (counter > 0) {
+                merges += 1 + counter;
+                counter = 0;
+            }
+            prev = weight[i];
+        }
+    }
+    if (counter > 0) {
+        merges += 1 + counter;
+    }
+
+    for (int i = 1; i < 4; i++) {
+        if (weight[i - 1] > weight[i]) {
+            mono_left += powf(weight[i - 1], HEUR_MONOTONICITY_POWER) - powf(weight[i], HEUR_MONOTONICITY_POWER);
+        } else {
+            mono_right += powf(weight[i], HEUR_MONOTONICITY_POWER) - powf(weight[i - 1], HEUR_MONOTONICITY_POWER);
+        }
+    }
+
+    return HEUR_LOST_PENALTY + HEUR_EMPTY_WEIGHT * empty + HEUR_MERGES_WEIGHT * merges -
+           HEUR_MONOTONICITY_WEIGHT * fminf(mono_left, mono_right) - HEUR_SUM_WEIGHT * sum;
+}
+
+Game2048Ai::Game2048Ai():
+    _task(NULL),
+    _done(NULL),
+    _lock(portMUX_INITIALIZER_UNLOCKED),
+    _row_heuristic(NULL),
+    _tt(NULL),
+    _generation(0),
+    _stop(false),
+    _request_board(0),
+    _search_generation(0),
+    _nodes(0),
+    _result({}),
+    _result_new(false)
+{
+}
+
+Game2048Ai::~Game2048Ai()
+{
+    end();
+}
+
+bool Game2048Ai::begin(void)
+{
+    if (_task) {
+        return true;
+    }
+
+    _row_heuristic = (float *)heap_caps_malloc(65536 * sizeof(float), MALLOC_CAP_SPIRAM);
+    _tt = (tt_entry_t *)heap_caps_calloc(AI_TT_SIZE, sizeof(tt_entry_t), MALLOC_CAP_SPIRAM);
+    _done = xSemaphoreCreateBinary();
+    if (!_row_heuristic || !_tt || !_done) {
+        ESP_LOGE(TAG, "No memory for the search tables");
+        end();
+        return false;
+    }
+    _stop = false;
+    _result_new = false;
+    if (task_config_create(TASK_CONFIG_GAME_2048_AI, task, this, &_task) != pdPASS) {
+        ESP_LOGE(TAG, "Create search task failed");
+        _task = NULL;
+        end();
+        return false;
+    }
+
+    return true;
+}
+
+void Game2048Ai::end(void)
+{
+    if (_task) {
+        _stop = true;
+        _generation++;
+        xTaskNotifyGive(_task);
+        // The task only gives the semaphore once it's out of the search and never touches LVGL, so this
+        // doesn't wait long and can't deadlock with the display lock
+        xSemaphoreTake(_done, portMAX_DELAY);
+        _task = NULL;
+    }
+    if (_done) {
+        vSemaphoreDelete(_done);
+        _done = NULL;
+    }
+    heap_caps_free(_row_heuristic);
+    heap_caps_free(_tt);
+    _row_heuristic = NULL;
+    _tt = NULL;
+}
+
+void Game2048Ai::request(board_t board)
+{
+    if (!_task) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    _request_board = board;
+    _generation++;
+    _result_new = false;
+    taskEXIT_CRITICAL(&_lock);
+    xTaskNotifyGive(_task);
+}
+
+void Game2048Ai::cancel(void)
+{
+    taskENTER_CRITICAL(&_lock);
+    _generation++;
+    _result_new = false;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+bool Game2048Ai::takeResult(result_t *result)
+{
+    bool ret;
+
+    taskENTER_CRITICAL(&_lock);
+    ret = _result_new;
+    if (ret) {
+        *result = _result;
+        _result_new = false;
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    return ret;
+}
+
+void Game2048Ai::publish(const result_t &result, uint32_t generation)
+{
+    taskENTER_CRITICAL(&_lock);
+    // A request or cancel since the search started makes the result stale
+    if (generation == _generation) {
+        _result = result;
+        _result_new = true;
+    }
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void Game2048Ai::task(void *arg)
+{
+    Game2048Ai *ai = (Game2048Ai *)arg;
+    uint32_t searched = ai->_generation;
+
+    // Built here rather than in begin() to keep the UI responsive, requests made meanwhile stay pending
+    for (uint32_t row = 0; row < 65536; row++) {
+        ai->_row_heuristic[row] = ai_row_heuristic(row);
+    }
+
+    while (!ai->_stop) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        taskENTER_CRITICAL(&ai->_lock);
+        uint32_t generation = ai->_generation;
+        board_t board = ai->_request_board;
+        taskEXIT_CRITICAL(&ai->_lock);
+
+        // Cancels also notify, only new requests are searched
+        if (!ai->_stop && (generation != searched)) {
+            searched = generation;
+            ai->search(board, generation);
+        }
+    }
+
+    xSemaphoreGive(ai->_done);
+    task_config_delete(TASK_CONFIG_GAME_2048_AI, NULL);
+}
+
+float Game2048Ai::heuristic(board_t board) const
+{
+    board_t transposed = Game2048Board::transpose(board);
+    float score = 0;
+
+    for (int i = 0; i < 4; i++) {
+        score += _row_heuristic[(board >> (16 * i)) & 0xffff];
+        score += _row_heuristic[(transposed >> (16 * i)) & 0xffff];
+    }
+
+    return score;
+}
+
+float Game2048Ai::evalMove(board_t board, float cprob, int depth)
+{
+    float best = 0;
+
+    for (int dir = 0; dir < Game2048Board::DIR_MAX; dir++) {
+        board_t moved = Game2048Board::move(board, (Game2048Board::Direction)dir, NULL);
+        if (moved != board) {
+            best = fmaxf(best, evalChance(moved, cprob, depth - 1));
+        }
+    }
+
+    return best;
+}
+
+float Game2048Ai::evalChance(board_t board, float cprob, int depth)
+{
+    if (_generation != _search_generation) {
+        return 0;
+    }
+    _nodes++;
+    if ((depth <= 0) || (cprob < AI_CPROB_MIN)) {
+        return heuristic(board);
+    }
+
+    tt_entry_t *entry = &_tt[((board ^ (board >> 27)) * 0x9E3779B97F4A7C15ULL) >> (64 - AI_TT_BITS)];
+    if ((entry->board == board) && (entry->depth >= depth)) {
+        return entry->value;
+    }
+
+    int empty = Game2048Board::countEmpty(board);
+    float sum = 0;
+    cprob /= empty;
+    for (int i = 0; i < empty; i++) {
+        sum += (1.0f - AI_SPAWN_4_PROB) *
+               evalMove(Game2048Board::spawn(board, i, 1, NULL), cprob * (1.0f - AI_SPAWN_4_PROB), depth);
+        sum += AI_SPAWN_4_PROB * evalMove(Game2048Board::spawn(board, i, 2, NULL), cprob * AI_SPAWN_4_PROB, depth);
+    }
+    sum /= empty;
+
+    if (_generation == _search_generation) {
+        entry->board = board;
+        entry->value = sum;
+        entry->depth = depth;
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Iterative deepening search, the best move of every finished depth is published.
+ */
+void Game2048Ai::search(board_t board, uint32_t generation)
+{
+    result_t result = {
+        .board = board,
+        .dir = Game2048Board::DIR_LEFT,
+        .depth = 0,
+        .final = false,
+    };
+    int64_t start_us = esp_timer_get_time();
+
+    _search_generation = generation;
+    _nodes = 0;
+    for (int depth = 1; depth <= CONFIG_GAME_2048_AI_DEPTH; depth++) {
+        float best = -1;
+        int best_dir = -1;
+        for (int dir = 0; dir < Game2048Board::DIR_MAX; dir++) {
+            board_t moved = Game2048Board::move(board, (Game2048Board::Direction)dir, NULL);
+            if (moved == board) {
+                continue;
+            }
+            float value = evalChance(moved, 1.0f, depth - 1);
+            if (value > best) {
+                best = value;
+                best_dir = dir;
+            }
+        }
+        if (_generation != generation) {
+            return;
+        }
+        if (best_dir < 0) {
+            // Game over, nothing to suggest
+            return;
+        }
+        result.dir = (Game2048Board::Direction)best_dir;
+        result.depth = depth;
+        result.final = (depth == CONFIG_GAME_2048_AI_DEPTH);
+        publish(result, generation);
+    }
+
+    int64_t time_us = esp_timer_get_time() - start_us;
+    ESP_LOGI(TAG, "Depth %d: %" PRIu32 " nodes in %" PRId64 " us, %" PRIu32 " nodes/s", CONFIG_GAME_2048_AI_DEPTH,
+             _nodes, time_us, (uint32_t)(_nodes * 1000000LL / (time_us > 0 ? time_us : 1)));
+}
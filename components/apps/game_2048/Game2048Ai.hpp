@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "Game2048Board.hpp"
+
+/**
+ * @brief Expectimax player for the 2048 game, searching on its own low-priority task.
+ *
+ * A search is started with request() and deepens one move at a time up to CONFIG_GAME_2048_AI_DEPTH, every
+ * finished depth replaces the result read by takeResult(), so a caller polling the result sees the best move
+ * improve while the search runs. A new request or cancel() aborts the running search. Chance nodes spawn a
+ * 2 or a 4 on every empty cell, boards are scored with precomputed per-row heuristics and chance nodes already
+ * evaluated at the same depth are looked up in a transposition table.
+ *
+ * The search never touches LVGL, the UI polls takeResult() from its own timer.
+ */
+class Game2048Ai {
+public:
+    typedef struct {
+        Game2048Board::board_t board;                 // Board the move was searched for
+        Game2048Board::Direction dir;
+        int depth;                                    // Depth of the search that gave the move
+        bool final;                                   // The search is finished, no better move will come
+    } result_t;
+
+    Game2048Ai();
+    ~Game2048Ai();
+
+    /**
+     * @brief Allocate the tables and start the search task.
+     */
+    bool begin(void);
+
+    /**
+     * @brief Stop the search task and free the tables.
+     */
+    void end(void);
+
+    /**
+     * @brief Search the best move for a board, aborting the running search.
+     */
+    void request(Game2048Board::board_t board);
+
+    /**
+     * @brief Abort the running search and drop its result.
+     */
+    void cancel(void);
+
+    /**
+     * @brief Get the newest result if there is one the caller hasn't taken yet.
+     */
+    bool takeResult(result_t *result);
+
+private:
+    typedef struct {
+        Game2048Board::board_t board;
+        float value;
+        uint8_t depth;
+    } tt_entry_t;
+
+    static void task(void *arg);
+    void search(Game2048Board::board_t board, uint32_t generation);
+    float evalMove(Game2048Board::board_t board, float cprob, int depth);
+    float evalChance(Game2048Board::board_t board, float cprob, int depth);
+    float heuristic(Game2048Board::board_t board) const;
+    void publish(const result_t &result, uint32_t generation);
+
+    TaskHandle_t _task;
+    SemaphoreHandle_t _done;
+    portMUX_TYPE _lock;
+    float *_row_heuristic;
+    tt_entry_t *_tt;
+    volatile uint32_t _generation;                    // Bumped by every request and cancel
+    volatile bool _stop;
+    Game2048Board::board_t _request_board;
+    uint32_t _search_generation;                      // Generation the running search was started for
+    uint32_t _nodes;
+    result_t _result;
+    bool _result_new;
+};
@@ -0,0 +1,184 @@
+#include "Game2048Board.hpp"
+
+typedef Game2048Board::board_t board_t;
+
+#define ROW_COUNT               (65536)
+#define ROW_MASK                ((board_t)0xffff)
+
+/*
+ * Entry of the row table for a move towards column 0:
+ *   bits  0-15 row after the move
+ *   bits 16-23 2-bit target column of the tile in each source column
+ *   bits 24-27 columns that received a merge
+ */
+#define ENTRY_ROW(e)            ((e) & 0xffff)
+#define ENTRY_TARGET(e, col)    (((e) >> (16 + 2 * (col))) & 0x3)
+#define ENTRY_MERGED(e)         (((e) >> 24) & 0xf)
+
+struct RowTables {
+    uint32_t entry[ROW_COUNT];
+    // Sum of the merged values divided by 4, the smallest merged value, so it fits in 16 bits
+    uint16_t score[ROW_COUNT];
+};
+
+static constexpr RowTables makeRowTables()
+{
+    RowTables tables = {};
+
+    for (uint32_t row = 0; row < ROW_COUNT; row++) {
+        int result[4] = {};
+        uint32_t target = 0;
+        uint32_t merged = 0;
+        uint32_t score = 0;
+        int out = -1;
+        bool can_merge = false;
+
+        for (int col = 0; col < 4; col++) {
+            int weight = (row >> (4 * col)) & 0xf;
+            if (weight == 0) {
+                target |= col << (2 * col);
+                continue;
+            }
+            // A tile merges at most once per move, and the weight can't grow beyond a nibble
+            if (can_merge && (result[out] == weight) && (weight < Game2048Board::WEIGHT_MAX)) {
+                result[out]++;
+                merged |= 1 << out;
+                score += (1 << result[out]) >> 2;
+                can_merge = false;
+            } else {
+                result[++out] = weight;
+                can_merge = true;
+            }
+            target |= out << (2 * col);
+        }
+
+        tables.entry[row] = (result[0] | (result[1] << 4) | (result[2] << 8) | (result[3] << 12)) |
+                            (target << 16) | (merged << 24);
+        tables.score[row] = score;
+    }
+
+    return tables;
+}
+
+static constexpr RowTables row_tables = makeRowTables();
+
+static inline uint32_t reverseRow(uint32_t row)
+{
+    return ((row & 0xf) << 12) | ((row & 0xf0) << 4) | ((row >> 4) & 0xf0) | (row >> 12);
+}
+
+static inline uint32_t reverseBits4(uint32_t bits)
+{
+    return ((bits & 1) << 3) | ((bits & 2) << 1) | ((bits & 4) >> 1) | ((bits & 8) >> 3);
+}
+
+board_t Game2048Board::transpose(board_t board)
+{
+    board_t a1 = board & 0xF0F00F0FF0F00F0FULL;
+    board_t a2 = board & 0x0000F0F00000F0F0ULL;
+    board_t a3 = board & 0x0F0F00000F0F0000ULL;
+    board_t a = a1 | (a2 << 12) | (a3 >> 12);
+    board_t b1 = a & 0xFF00FF0000FF00FFULL;
+    board_t b2 = a & 0x00FF00FF00000000ULL;
+    board_t b3 = a & 0x00000000FF00FF00ULL;
+
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+board_t Game2048Board::move(board_t board, Direction dir, int *score, int8_t target[CELLS], uint16_t *merged)
+{
+    bool reverse = (dir == DIR_RIGHT) || (dir == DIR_DOWN);
+    bool vertical = (dir == DIR_UP) || (dir == DIR_DOWN);
+    board_t rows = vertical ? transpose(board) : board;
+    board_t result = 0;
+    int total = 0;
+
+    if (merged) {
+        *merged = 0;
+    }
+
+    // Moving right is moving the mirrored row left, then mirroring back
+    for (int r = 0; r < 4; r++) {
+        uint32_t row = (rows >> (16 * r)) & ROW_MASK;
+        uint32_t key = reverse ? reverseRow(row) : row;
+        uint32_t entry = row_tables.entry[key];
+        uint32_t moved = reverse ? reverseRow(ENTRY_ROW(entry)) : ENTRY_ROW(entry);
+        uint32_t merged_cols = reverse ? reverseBits4(ENTRY_MERGED(entry)) : ENTRY_MERGED(entry);
+
+        result |= (board_t)moved << (16 * r);
+        total += row_tables.score[key] << 2;
+        if (!target && !merged) {
+            continue;
+        }
+        for (int c = 0; c < 4; c++) {
+            // Back to board coordinates, row/column swapped for a vertical move
+            int dst = reverse ? (3 - ENTRY_TARGET(entry, 3 - c)) : ENTRY_TARGET(entry, c);
+            int src_cell = vertical ? (4 * c + r) : (4 * r + c);
+            int dst_cell = vertical ? (4 * dst + r) : (4 * r + dst);
+            if (target) {
+                target[src_cell] = dst_cell;
+            }
+            if (merged && (merged_cols & (1 << c))) {
+                *merged |= 1 << (vertical ? (4 * c + r) : (4 * r + c));
+            }
+        }
+    }
+
+    if (score) {
+        *score = total;
+    }
+
+    return vertical ? transpose(result) : result;
+}
+
+board_t Game2048Board::move(board_t board, Direction dir, int *score)
+{
+    return move(board, dir, score, nullptr, nullptr);
+}
+
+int Game2048Board::countEmpty(board_t board)
+{
+    // Fold each nibble to one bit set if the cell is occupied
+    board |= (board >> 2);
+    board |= (board >> 1);
+    board &= 0x1111111111111111ULL;
+
+    return CELLS - __builtin_popcountll(board);
+}
+
+board_t Game2048Board::spawn(board_t board, int nth, int weight, int *cell)
+{
+    for (int i = 0; i < CELLS; i++) {
+        if (((board >> (4 * i)) & 0xf) == 0) {
+            if (nth-- == 0) {
+                if (cell) {
+                    *cell = i;
+                }
+                return board | ((board_t)weight << (4 * i));
+            }
+        }
+    }
+
+    return board;
+}
+
+int Game2048Board::maxWeight(board_t board)
+{
+    int max = 0;
+
+    for (int i = 0; i < CELLS; i++) {
+        int weight = (board >> (4 * i)) & 0xf;
+        max = (weight > max) ? weight : max;
+    }
+
+    return max;
+}
+
+bool Game2048Board::canMove(board_t board)
+{
+    if (countEmpty(board) > 0) {
+        return true;
+    }
+    // A full board can only move if two neighbours merge, which a left and an up move cover
+    return (move(board, DIR_LEFT, nullptr) != board) || (move(board, DIR_UP, nullptr) != board);
+}
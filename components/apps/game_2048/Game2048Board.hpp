@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief 64-bit bitboard core of the 2048 game.
+ *
+ * Each cell is a 4-bit nibble holding the weight of its tile (value = 2^weight, 0 for empty), cell (row, col)
+ * at bits [4 * (4 * row + col), +4), so a row is one 16-bit word with column 0 in the low nibble. Rows are moved
+ * with precomputed 65536-entry tables, columns by transposing the board, so a move is eight table lookups and
+ * needs no LVGL object, the same core is used for the game UI and for simulations.
+ */
+class Game2048Board {
+public:
+    typedef uint64_t board_t;
+
+    enum Direction {
+        DIR_LEFT = 0,
+        DIR_RIGHT,
+        DIR_UP,
+        DIR_DOWN,
+        DIR_MAX,
+    };
+
+    static const int CELLS = 16;
+    static const int WEIGHT_MAX = 15;
+
+    static inline int get(board_t board, int row, int col)
+    {
+        return (board >> (4 * (4 * row + col))) & 0xf;
+    }
+
+    static inline board_t set(board_t board, int row, int col, int weight)
+    {
+        int shift = 4 * (4 * row + col);
+        return (board & ~((board_t)0xf << shift)) | ((board_t)weight << shift);
+    }
+
+    static board_t transpose(board_t board);
+
+    /**
+     * @brief Move all tiles of a board.
+     *
+     * @param board Board before the move.
+     * @param dir Direction.
+     * @param score Set to the sum of the values of the merged tiles, may be NULL.
+     *
+     * @return The board after the move, equal to `board` if nothing moved.
+     */
+    static board_t move(board_t board, Direction dir, int *score);
+
+    /**
+     * @brief Move all tiles of a board and report where each tile went, to animate the move.
+     *
+     * @param board Board before the move.
+     * @param dir Direction.
+     * @param score Set to the sum of the values of the merged tiles, may be NULL.
+     * @param target Set to the cell index (4 * row + col) each tile moves to, the index itself for empty cells.
+     * @param merged Bit n set if two tiles were merged into cell n.
+     *
+     * @return The board after the move, equal to `board` if nothing moved.
+     */
+    static board_t move(board_t board, Direction dir, int *score, int8_t target[CELLS], uint16_t *merged);
+
+    static int countEmpty(board_t board);
+
+    /**
+     * @brief Put a tile on an empty cell.
+     *
+     * @param board Board with at least one empty cell.
+     * @param nth Index of the empty cell to use, in cell order, must be below countEmpty().
+     * @param weight Weight of the new tile.
+     * @param cell Set to the cell index the tile was put on, may be NULL.
+     *
+     * @return The new board.
+     */
+    static board_t spawn(board_t board, int nth, int weight, int *cell);
+
+    static int maxWeight(board_t board);
+    static bool canMove(board_t board);
+};
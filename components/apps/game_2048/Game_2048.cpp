@@ -1,9 +1,12 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include "bsp/esp-bsp.h"
 #include "Game_2048.hpp"
 #include "esp_log.h"
+#include "asset_pack/asset_pack.h"
+#include "ui_sound/ui_sound.h"
 
 #define ENABLE_CELL_DEBUG       (0)
 
@@ -27,6 +30,9 @@
 #define CELL_OPA_2				LV_OPA_COVER
 
 #define ANIM_PERIOD				200
+#define AI_POLL_PERIOD			100
+
+#define SAVED_STATE_VERSION     (1)
 
 #define EMOJI_SCORE_NORMAL		8
 #define EMOJI_SCORE_GOOD		64
@@ -49,12 +55,12 @@ static bool anim_running_flag = false;
 static bool generate_cell_flag = false;
 
 LV_IMG_DECLARE(img_app_2048);
-LV_IMG_DECLARE(img_game2048_excellent);
-LV_IMG_DECLARE(img_game2048_fail);
-LV_IMG_DECLARE(img_game2048_good);
-LV_IMG_DECLARE(img_game2048_normal);
-LV_IMG_DECLARE(img_game2048_week);
-LV_IMG_DECLARE(img_game2048_hello);
+
+/* On the press rather than the click, the sound follows the touch instead of the release */
+static void button_press_event_cb(lv_event_t *e)
+{
+    ui_sound_play(UI_SOUND_CLICK);
+}
 
 Game2048::Game2048():
     ESP_Brookesia_PhoneApp("2048 Game", &img_app_2048, true),
@@ -65,21 +71,27 @@ Game2048::Game2048():
     best_score(0),
     _weight_max(0),
     nvs_handle(NULL),
+    _board(0),
     _file_iterator(NULL),
     _cur_score_label(NULL),
     _best_score_label(NULL),
     _background_cells({}),
     _emoji_imgs({}),
     _emoji_label(NULL),
-    _foreground_grid(NULL)
+    _foreground_grid(NULL),
+    _tile_free(0),
+    _tile_anim_num(0),
+    _ai_mode(AI_OFF),
+    _ai_timer(NULL),
+    _ai_btn_label(NULL),
+    _hint_label(NULL)
 {
     best_score = 0;
     for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].weight = 0;
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
         _foreground_cells[i/4][i%4] = NULL;
         _remove_ready_cells[i/4][i%4] = NULL;
+        _tile_pool[i] = NULL;
+        _tile_weight[i] = 0;
     }
     _cell_colors[0] = CELL_BG_COLOR;
     // Yellow
@@ -133,13 +145,13 @@ bool Game2048::run(void)
     lv_label_set_text(title, "2048");
     lv_obj_align(title, LV_ALIGN_TOP_LEFT, 20, 20);
 
-    const lv_img_dsc_t *imgs[] = {
-        &img_game2048_hello,
-        &img_game2048_week,
-        &img_game2048_normal,
-        &img_game2048_good,
-        &img_game2048_excellent,
-        &img_game2048_fail
+    const char *imgs[] = {
+        ASSET_PACK_SRC("img_game2048_hello"),
+        ASSET_PACK_SRC("img_game2048_week"),
+        ASSET_PACK_SRC("img_game2048_normal"),
+        ASSET_PACK_SRC("img_game2048_good"),
+        ASSET_PACK_SRC("img_game2048_excellent"),
+        ASSET_PACK_SRC("img_game2048_fail")
     };
     for (int i = 0; i < 6; i++) {
         _emoji_imgs[i] = lv_img_create(board);
@@ -210,6 +222,7 @@ bool Game2048::run(void)
     lv_obj_set_style_bg_color(btn, GRID_BG_COLOR, 0);
     // Others
     lv_obj_add_event_cb(btn, new_game_event_cb, LV_EVENT_CLICKED, this);
+    lv_obj_add_event_cb(btn, button_press_event_cb, LV_EVENT_PRESSED, NULL);
 
     title = lv_label_create(btn);
     lv_obj_set_style_text_font(title, SCORE_TITLE_FONT, 0);
@@ -217,6 +230,28 @@ bool Game2048::run(void)
     lv_label_set_text(title, "New Game");
     lv_obj_align(title, LV_ALIGN_CENTER, 0, 0);
 
+    /* Hint and autoplay, each click switches to the next mode */
+    btn = lv_btn_create(board);
+    lv_obj_set_size(btn, 150, 70);
+    lv_obj_align(btn, LV_ALIGN_BOTTOM_RIGHT, -10, -10);
+    lv_obj_set_style_radius(btn, CELL_RADIUS, 0);
+    lv_obj_set_style_border_width(btn, 0, 0);
+    lv_obj_set_style_pad_all(btn, 10, 0);
+    lv_obj_set_style_bg_color(btn, GRID_BG_COLOR, 0);
+    lv_obj_add_event_cb(btn, ai_button_event_cb, LV_EVENT_CLICKED, this);
+    lv_obj_add_event_cb(btn, button_press_event_cb, LV_EVENT_PRESSED, NULL);
+
+    _ai_btn_label = lv_label_create(btn);
+    lv_obj_set_style_text_font(_ai_btn_label, SCORE_TITLE_FONT, 0);
+    lv_obj_set_style_text_color(_ai_btn_label, SCORE_TITLE_COLOR, 0);
+    lv_obj_align(_ai_btn_label, LV_ALIGN_CENTER, 0, 0);
+
+    _hint_label = lv_label_create(board);
+    lv_obj_set_style_text_font(_hint_label, SCORE_TITLE_FONT, 0);
+    lv_obj_set_style_text_color(_hint_label, BOARD_TITLE_COLOR, 0);
+    lv_label_set_text(_hint_label, "");
+    lv_obj_align(_hint_label, LV_ALIGN_TOP_RIGHT, -20, 25);
+
     /* Setup grid */
     static lv_coord_t col_dsc[] = {CELL_SIZE, CELL_SIZE, CELL_SIZE, CELL_SIZE, LV_GRID_TEMPLATE_LAST};
     static lv_coord_t row_dsc[] = {CELL_SIZE, CELL_SIZE, CELL_SIZE, CELL_SIZE, LV_GRID_TEMPLATE_LAST};
@@ -266,6 +301,29 @@ bool Game2048::run(void)
     // Others
     lv_obj_add_flag(_foreground_grid, LV_OBJ_FLAG_CLICKABLE);
 
+    /* A board never shows more than 16 tiles, they are created once and hidden while unused */
+    for (int i = 0; i < 16; i++) {
+        lv_obj_t *tile = lv_obj_create(_foreground_grid);
+        _tile_pool[i] = tile;
+        // Size
+        lv_obj_set_size(tile, CELL_SIZE, CELL_SIZE);
+        // Shape
+        lv_obj_set_style_radius(tile, CELL_RADIUS, 0);
+        lv_obj_set_style_border_width(tile, 0, 0);
+        lv_obj_set_style_pad_all(tile, 0, 0);
+        // Background
+        lv_obj_set_style_bg_color(tile, CELL_BG_COLOR, 0);
+        lv_obj_set_style_opa(tile, CELL_OPA_2, 0);
+        // Others
+        lv_obj_clear_flag(tile, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_add_flag(tile, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_user_data(tile, (void *)(intptr_t)i);
+
+        lv_obj_t *label = lv_label_create(tile);
+        lv_obj_center(label);
+    }
+    _tile_free = 0xffff;
+
     _emoji_label = lv_label_create(board);
     lv_obj_set_style_text_font(_emoji_label, SCORE_TITLE_FONT, 0);
     lv_obj_align(_emoji_label, LV_ALIGN_BOTTOM_LEFT, 10, -40);
@@ -276,6 +334,9 @@ bool Game2048::run(void)
     lv_obj_add_event_cb(_gesture->getEventObj(), motion_event_cb, _gesture->getReleaseEventCode(), this);
 
     _is_paused = false;
+    _ai_mode = AI_OFF;
+    _ai_timer = lv_timer_create(ai_timer_cb, AI_POLL_PERIOD, this);
+    updateAiButton();
 
     newGame();
 
@@ -298,6 +359,11 @@ bool Game2048::back(void)
 bool Game2048::close(void)
 {
     lv_obj_remove_event_cb(_gesture->getEventObj(), motion_event_cb);
+    if (_ai_timer) {
+        lv_timer_del(_ai_timer);
+        _ai_timer = NULL;
+    }
+    _ai.end();
 
     return true;
 }
@@ -350,6 +416,7 @@ bool Game2048::init(void)
 bool Game2048::pause(void)
 {
     _is_paused = true;
+    _ai.cancel();
 
     return true;
 }
@@ -357,6 +424,57 @@ bool Game2048::pause(void)
 bool Game2048::resume(void)
 {
     _is_paused = false;
+    requestAi();
+
+    return true;
+}
+
+/**
+ * @brief Keep the game on close, so it goes on where it was left after a restart as well.
+ */
+bool Game2048::saveState(std::vector<uint8_t> &state)
+{
+    saved_state_t saved = {
+        .version = SAVED_STATE_VERSION,
+        .spawn_pending = (uint8_t)(anim_running_flag && generate_cell_flag),
+        .score = current_score,
+        .board = _board,
+    };
+
+    // A game over is not worth coming back to
+    if (isGameOver()) {
+        return true;
+    }
+    state.assign((const uint8_t *)&saved, (const uint8_t *)&saved + sizeof(saved));
+
+    return true;
+}
+
+/**
+ * @brief Called after run(), which started a new game, put the saved board in its place.
+ */
+bool Game2048::restoreState(const uint8_t *data, size_t size)
+{
+    saved_state_t saved;
+
+    if ((size != sizeof(saved)) || (data[0] != SAVED_STATE_VERSION)) {
+        ESP_LOGW(TAG, "Ignore saved game(%d bytes)", (int)size);
+        return false;
+    }
+    memcpy(&saved, data, sizeof(saved));
+    if ((saved.board == 0) || !Game2048Board::canMove(saved.board)) {
+        return false;
+    }
+
+    _ai.cancel();
+    current_score = saved.score;
+    updateCurrentScore(current_score);
+    placeBoard(saved.board);
+    if (saved.spawn_pending) {
+        generateForegroundCell();
+    }
+    requestAi();
+    ESP_LOGI(TAG, "Restore game, score: %d", current_score);
 
     return true;
 }
@@ -429,7 +547,7 @@ void Game2048::debugCells(void)
 #if ENABLE_CELL_DEBUG
     debugCells(_foreground_cells);
     debugCells(_background_cells);
-    debugCells(_cells_weight);
+    debugCells(_board);
 #endif
 }
 
@@ -454,16 +572,14 @@ void Game2048::debugCells(lv_obj_t *cell[4][4])
 #endif
 }
 
-void Game2048::debugCells(cell_weight_t cell[4][4])
+void Game2048::debugCells(Game2048Board::board_t board)
 {
 #if ENABLE_CELL_DEBUG
     for (int i = 0; i < 4; i++) {
         printf(
-            "\t(%d,%d,%d)\t(%d,%d,%d)\t(%d,%d,%d)\t(%d,%d,%d)\n",
-            cell[i][0].x, cell[i][0].y, cell[i][0].weight,
-            cell[i][1].x, cell[i][1].y, cell[i][1].weight,
-            cell[i][2].x, cell[i][2].y, cell[i][2].weight,
-            cell[i][3].x, cell[i][3].y, cell[i][3].weight
+            "\t%d\t%d\t%d\t%d\n",
+            Game2048Board::get(board, i, 0), Game2048Board::get(board, i, 1),
+            Game2048Board::get(board, i, 2), Game2048Board::get(board, i, 3)
         );
     }
     printf("\n");
@@ -482,18 +598,55 @@ void Game2048::debugCells(lv_obj_t *cell[4])
 
 void Game2048::cleanForegroundCells(void)
 {
-    lv_obj_t *child = lv_obj_get_child(_foreground_grid, 0);
+    // A new game can be started while the tiles of the last move are still sliding
+    lv_anim_del(this, tile_anim_exec_cb);
+    _tile_anim_num = 0;
+    anim_running_flag = false;
+    generate_cell_flag = false;
 
-    while (child) {
-        lv_obj_del(child);
-        child = lv_obj_get_child(_foreground_grid, 0);
-    }
     for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].weight = 0;
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
+        releaseTile(_tile_pool[i]);
         _foreground_cells[i/4][i%4] = NULL;
+        _remove_ready_cells[i/4][i%4] = NULL;
     }
+    _board = 0;
+}
+
+lv_obj_t *Game2048::acquireTile(void)
+{
+    if (_tile_free == 0) {
+        return NULL;
+    }
+
+    int index = __builtin_ctz(_tile_free);
+    _tile_free &= ~(1 << index);
+    lv_obj_clear_flag(_tile_pool[index], LV_OBJ_FLAG_HIDDEN);
+
+    return _tile_pool[index];
+}
+
+void Game2048::releaseTile(lv_obj_t *tile)
+{
+    int index = (intptr_t)lv_obj_get_user_data(tile);
+
+    lv_obj_add_flag(tile, LV_OBJ_FLAG_HIDDEN);
+    _tile_free |= 1 << index;
+    _tile_weight[index] = 0;
+}
+
+/**
+ * @brief Show the value and color of a weight on a tile, only touching LVGL if the tile showed another weight.
+ */
+void Game2048::restyleTile(lv_obj_t *tile, int weight)
+{
+    int index = (intptr_t)lv_obj_get_user_data(tile);
+
+    if (_tile_weight[index] == weight) {
+        return;
+    }
+    _tile_weight[index] = weight;
+    lv_label_set_text_fmt(lv_obj_get_child(tile, 0), "%d", (int)lv_pow(2, weight));
+    lv_obj_set_style_bg_color(tile, _cell_colors[LV_MIN(weight, 11) - 1], 0);
 }
 
 void Game2048::newGame(void)
@@ -504,8 +657,32 @@ void Game2048::newGame(void)
     cleanForegroundCells();
     generateForegroundCell();
     generateForegroundCell();
-    updateCellsStyle();
     showEmojiHello();
+    requestAi();
+}
+
+/**
+ * @brief Show a whole board at once, without animation.
+ */
+void Game2048::placeBoard(Game2048Board::board_t board)
+{
+    cleanForegroundCells();
+    _board = board;
+    _weight_max = Game2048Board::maxWeight(_board);
+
+    for (int i = 0; i < 16; i++) {
+        int weight = Game2048Board::get(_board, i/4, i%4);
+        if (weight == 0) {
+            continue;
+        }
+        lv_obj_t *cell = acquireTile();
+        if (cell == NULL) {
+            return;
+        }
+        _foreground_cells[i/4][i%4] = cell;
+        lv_obj_set_pos(cell, lv_obj_get_x(_background_cells[i/4][i%4]), lv_obj_get_y(_background_cells[i/4][i%4]));
+        restyleTile(cell, weight);
+    }
 }
 
 lv_obj_t *Game2048::addBackgroundCell(lv_obj_t *parent)
@@ -524,7 +701,7 @@ lv_obj_t *Game2048::addBackgroundCell(lv_obj_t *parent)
 
 void Game2048::generateForegroundCell(void)
 {
-    int zero_amount = 0, zero_index = 0;
+    int zero_amount = Game2048Board::countEmpty(_board);
     int target = 0;
     int target_i = 0;
     int target_j = 0;
@@ -533,54 +710,27 @@ void Game2048::generateForegroundCell(void)
     _weight_max = (target_weight > _weight_max) ?
                    target_weight : _weight_max;
 
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            if (_cells_weight[i][j].weight == 0) {
-                zero_amount++;
-            }
-        }
-    }
     if (zero_amount == 0) {
         return;
     }
 
-    target = randint_between(0, zero_amount);
+    _board = Game2048Board::spawn(_board, randint_between(0, zero_amount), target_weight, &target);
+    target_i = target / 4;
+    target_j = target % 4;
 
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            if ((_cells_weight[i][j].weight == 0) &&
-                (zero_index++ == target)) {
-                    target_i = i;
-                    target_j = j;
-                    _cells_weight[i][j].weight = target_weight;
-            }
-        }
+    /* Take a free tile of the pool */
+    lv_obj_t *cell = acquireTile();
+    if (cell == NULL) {
+        return;
     }
-
-    /* Add a new object of cell */
-    lv_obj_t *cell = lv_obj_create(_foreground_grid);
     _foreground_cells[target_i][target_j] = cell;
-    // Size
-    lv_obj_set_size(cell, CELL_SIZE, CELL_SIZE);
     // Position
     lv_obj_set_pos(
         cell,
         lv_obj_get_x(_background_cells[target_i][target_j]),
         lv_obj_get_y(_background_cells[target_i][target_j])
     );
-    // Shape
-    lv_obj_set_style_radius(cell, CELL_RADIUS, 0);
-    lv_obj_set_style_border_width(cell, 0, 0);
-    lv_obj_set_style_pad_all(cell, 0, 0);
-    // Background
-    lv_obj_set_style_bg_color(cell, CELL_BG_COLOR, 0);
-    lv_obj_set_style_opa(cell, CELL_OPA_2, 0);
-    // Others
-    lv_obj_clear_flag(cell, LV_OBJ_FLAG_CLICKABLE);
-
-    lv_obj_t *label = lv_label_create(cell);
-    lv_label_set_text_fmt(label, "%d", (int)lv_pow(2, target_weight));
-    lv_obj_center(label);
+    restyleTile(cell, target_weight);
 
     debugCells();
 }
@@ -607,52 +757,67 @@ void Game2048::cleanRemoveReadyCell(void)
 {
     for (int i = 0; i < 16; i++) {
         if (_remove_ready_cells[i/4][i%4] != NULL) {
-            lv_obj_del(_remove_ready_cells[i/4][i%4]);
+            releaseTile(_remove_ready_cells[i/4][i%4]);
             _remove_ready_cells[i/4][i%4] = NULL;
         }
     }
 }
 
-void Game2048::startAnimationX(lv_obj_t *target, int x, int time)
+void Game2048::addTileAnimation(lv_obj_t *tile, bool vertical, int to)
 {
-    lv_anim_t a;
+    tile_anim_t *anim = &_tile_anims[_tile_anim_num++];
 
-    anim_running_flag = true;
-    lv_anim_init(&a);
-    lv_anim_set_var(&a, target);
-    lv_anim_set_user_data(&a, this);
-    lv_obj_update_layout(target);
-    lv_anim_set_values(&a, lv_obj_get_x(target), x);
-    lv_anim_set_time(&a, time);
-    lv_anim_set_exec_cb(&a, (lv_anim_exec_xcb_t)lv_obj_set_x);
-    lv_anim_set_path_cb(&a, lv_anim_path_linear);
-    lv_anim_set_ready_cb(&a, anim_finish_cb);
-    lv_anim_start(&a);
+    anim->tile = tile;
+    anim->vertical = vertical;
+    lv_obj_update_layout(tile);
+    anim->from = vertical ? lv_obj_get_y(tile) : lv_obj_get_x(tile);
+    anim->to = to;
 }
 
-void Game2048::startAnimationY(lv_obj_t *target, int y, int time)
+/**
+ * @brief Slide all tiles of a move with a single animation, so each frame moves every tile once and the
+ *        move ends with a single call of anim_finish_cb.
+ */
+void Game2048::startTileAnimations(void)
 {
     lv_anim_t a;
 
+    if (_tile_anim_num == 0) {
+        return;
+    }
+
     anim_running_flag = true;
     lv_anim_init(&a);
-    lv_anim_set_var(&a, target);
+    lv_anim_set_var(&a, this);
     lv_anim_set_user_data(&a, this);
-    lv_obj_update_layout(target);
-    lv_anim_set_values(&a, lv_obj_get_y(target), y);
-    lv_anim_set_time(&a, time);
-    lv_anim_set_exec_cb(&a, (lv_anim_exec_xcb_t)lv_obj_set_y);
+    lv_anim_set_values(&a, 0, ANIM_PERIOD);
+    lv_anim_set_time(&a, ANIM_PERIOD);
+    lv_anim_set_exec_cb(&a, tile_anim_exec_cb);
     lv_anim_set_path_cb(&a, lv_anim_path_linear);
     lv_anim_set_ready_cb(&a, anim_finish_cb);
     lv_anim_start(&a);
 }
 
+void Game2048::tile_anim_exec_cb(void *var, int32_t value)
+{
+    Game2048 *app = (Game2048 *)var;
+
+    for (int i = 0; i < app->_tile_anim_num; i++) {
+        tile_anim_t *anim = &app->_tile_anims[i];
+        int pos = anim->from + (anim->to - anim->from) * value / ANIM_PERIOD;
+        if (anim->vertical) {
+            lv_obj_set_y(anim->tile, pos);
+        } else {
+            lv_obj_set_x(anim->tile, pos);
+        }
+    }
+}
+
 void Game2048::updateCellValue(void)
 {
     for (int i = 0; i < 16; i++) {
         if (_foreground_cells[i/4][i%4] != NULL) {
-            lv_obj_t *label = lv_obj_get_child(_foreground_cells[i/4][i%4], 0);
-            lv_label_set_text_fmt(label, "%d", lv_pow(2, _cells_weight[i/4][i%4].weight));
+            restyleTile(_foreground_cells[i/4][i%4], Game2048Board::get(_board, i/4, i%4));
         }
     }
 }
@@ -674,17 +839,8 @@ void Game2048::updateBestScore(int score)
 
 void Game2048::updateCellsStyle(void)
 {
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            if (_foreground_cells[i][j] != NULL) {
-                lv_obj_set_style_bg_color(
-                    _foreground_cells[i][j],
-                    _cell_colors[_cells_weight[i][j].weight - 1],
-                    0
-                );
-            }
-        }
-    }
+    // Value and color are set together, only tiles whose weight changed are touched
+    updateCellValue();
 }
 
 int Game2048::maxWeight(void)
@@ -694,409 +850,187 @@ int Game2048::maxWeight(void)
 
 int Game2048::moveLeft(void)
 {
-    int target_cells[4][4];
-    int score = -1;
-
-    for (int i = 0; i < 16; i++) {
-        target_cells[i/4][i%4] = i%4;
-    }
-
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-
-    for (int i = 0; i < 4; i++) {
-        for (int j = 1; j < 4; j++) {
-            if (_cells_weight[i][j].weight != 0) {
-                int merge_flag = false;
-                int cur_j = j;
-                while (cur_j != 0) {
-                    if ((_cells_weight[i][cur_j-1].weight == _cells_weight[i][cur_j].weight) &&
-                        (!merge_flag)) {
-                        merge_flag = true;
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j].y & (1 << k);
-                            if (target_flag) {
-                                target_cells[i][k] = cur_j - 1;
-                            }
-                        }
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j-1].y & (1 << k);
-                            if (target_flag) {
-                                addRemoveReadyCell(_foreground_cells[i][k]);
-                            }
-                        }
-
-                        _cells_weight[i][cur_j-1].y += _cells_weight[i][cur_j].y;
-                        _cells_weight[i][cur_j-1].weight++;
-                        _cells_weight[i][cur_j].weight = 0;
-                        _weight_max = (_cells_weight[i][cur_j-1].weight > _weight_max) ?
-                                       _cells_weight[i][cur_j-1].weight : _weight_max;
-
-                        score = (score < 0) ? 0 : score;
-                        score += lv_pow(2, _cells_weight[i][cur_j-1].weight);
-                    }
-                    else if (_cells_weight[i][cur_j-1].weight == 0) {
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j].y & (1 << k);
-                            if (target_flag) {
-                                target_cells[i][k] = cur_j - 1;
-                            }
-                        }
-
-                        score = (score < 0) ? 0 : score;
-                        _cells_weight[i][cur_j-1] = _cells_weight[i][cur_j];
-                        _cells_weight[i][cur_j].weight = 0;
-                    }
-                    else {
-                        break;
-                    }
-                    cur_j--;
-                }
-            }
-        }
-    }
-
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-    debugCells(_remove_ready_cells);
-    debugCells(_foreground_cells);
-
-    for (int i = 0; i < 4; i++) {
-        for (int j = 1; j < 4; j++) {
-            int target_j = target_cells[i][j];
-            if ((_foreground_cells[i][j] != NULL) && (j != target_j)) {
-                // printf(NULL, "i,j: %d,%d", i, j);
-                int target_x = lv_obj_get_x(_background_cells[i][target_j]);
-                startAnimationX(_foreground_cells[i][j], target_x, ANIM_PERIOD);
-                _foreground_cells[i][target_j] = _foreground_cells[i][j];
-                _foreground_cells[i][j] = NULL;
-            }
-        }
-    }
+    return move(Game2048Board::DIR_LEFT);
+}
 
-    debugCells(_foreground_cells);
+int Game2048::moveRight(void)
+{
+    return move(Game2048Board::DIR_RIGHT);
+}
 
-    // Reset x,y of weight
-    for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
-    }
+int Game2048::moveUp(void)
+{
+    return move(Game2048Board::DIR_UP);
+}
 
-    return score;
+int Game2048::moveDown(void)
+{
+    return move(Game2048Board::DIR_DOWN);
 }
 
-int Game2048::moveRight(void)
+/**
+ * @brief Move the board and animate each foreground cell to the cell the board core moved its tile to.
+ *
+ * When two tiles merge, the first one to arrive keeps the cell and the other one is deleted once the
+ * animation has finished.
+ *
+ * @return The score of the move, -1 if nothing moved.
+ */
+int Game2048::move(Game2048Board::Direction dir)
 {
-    int target_cells[4][4];
-    int score = -1;
+    lv_obj_t *moved_cells[4][4] = {};
+    int8_t target[Game2048Board::CELLS];
+    uint16_t merged = 0;
+    int score = 0;
+    bool vertical = (dir == Game2048Board::DIR_UP) || (dir == Game2048Board::DIR_DOWN);
 
-    for (int i = 0; i < 16; i++) {
-        target_cells[i/4][i%4] = i%4;
+    debugCells(_board);
+
+    Game2048Board::board_t board = Game2048Board::move(_board, dir, &score, target, &merged);
+    if (board == _board) {
+        return -1;
     }
 
-    debugCells(_cells_weight);
-    debugCells(target_cells);
+    _tile_anim_num = 0;
 
-    for (int i = 0; i < 4; i++) {
-        for (int j = 2; j >= 0; j--) {
-            if (_cells_weight[i][j].weight != 0) {
-                int merge_flag = false;
-                int cur_j = j;
-                while (cur_j != 3) {
-                    if ((_cells_weight[i][cur_j+1].weight == _cells_weight[i][cur_j].weight) &&
-                        (!merge_flag)) {
-                        merge_flag = true;
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j].y & (1 << k);
-                            if (target_flag) {
-                                target_cells[i][k] = cur_j + 1;
-                            }
-                        }
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j+1].y & (1 << k);
-                            if (target_flag) {
-                                addRemoveReadyCell(_foreground_cells[i][k]);
-                            }
-                        }
-
-                        _cells_weight[i][cur_j+1].y += _cells_weight[i][cur_j].y;
-                        _cells_weight[i][cur_j+1].weight++;
-                        _cells_weight[i][cur_j].weight = 0;
-                        _weight_max = (_cells_weight[i][cur_j+1].weight > _weight_max) ?
-                                       _cells_weight[i][cur_j+1].weight : _weight_max;
-
-                        score = (score < 0) ? 0 : score;
-                        score += lv_pow(2, _cells_weight[i][cur_j+1].weight);
-                    }
-                    else if (_cells_weight[i][cur_j+1].weight == 0) {
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[i][cur_j].y & (1 << k);
-                            if (target_flag) {
-                                target_cells[i][k] = cur_j + 1;
-                            }
-                        }
-
-                        score = (score < 0) ? 0 : score;
-                        _cells_weight[i][cur_j+1] = _cells_weight[i][cur_j];
-                        _cells_weight[i][cur_j].weight = 0;
-                    }
-                    else {
-                        break;
-                    }
-                    cur_j++;
-                }
-            }
+    for (int i = 0; i < 16; i++) {
+        lv_obj_t *cell = _foreground_cells[i/4][i%4];
+        int dst = target[i];
+        if (cell == NULL) {
+            continue;
+        }
+        if (moved_cells[dst/4][dst%4] == NULL) {
+            moved_cells[dst/4][dst%4] = cell;
+        } else {
+            addRemoveReadyCell(cell);
+        }
+        if (dst == i) {
+            continue;
         }
+        addTileAnimation(cell, vertical, vertical ? lv_obj_get_y(_background_cells[dst/4][dst%4]) :
+                                                    lv_obj_get_x(_background_cells[dst/4][dst%4]));
     }
+    memcpy(_foreground_cells, moved_cells, sizeof(_foreground_cells));
+    startTileAnimations();
 
-    debugCells(_cells_weight);
-    debugCells(target_cells);
+    _board = board;
+    _weight_max = Game2048Board::maxWeight(_board);
+
+    debugCells(_board);
     debugCells(_remove_ready_cells);
     debugCells(_foreground_cells);
 
-    for (int i = 0; i < 4; i++) {
-        for (int j = 2; j >= 0; j--) {
-            int target_j = target_cells[i][j];
-            if ((_foreground_cells[i][j] != NULL) && (j != target_j)) {
-                // printf(NULL, "i,j: %d,%d", i, j);
-                int target_x = lv_obj_get_x(_background_cells[i][target_j]);
-                startAnimationX(_foreground_cells[i][j], target_x, ANIM_PERIOD);
-                _foreground_cells[i][target_j] = _foreground_cells[i][j];
-                _foreground_cells[i][j] = NULL;
-            }
-        }
-    }
+    return score;
+}
 
-    debugCells(_foreground_cells);
+bool Game2048::isGameOver(void)
+{
+    return !Game2048Board::canMove(_board);
+}
 
-    // Reset x,y of weight
-    for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
-    }
+void Game2048::new_game_event_cb(lv_event_t *e)
+{
+    Game2048 *app= (Game2048 *)lv_event_get_user_data(e);
 
-    return score;
+    app->newGame();
 }
 
-int Game2048::moveUp(void)
+/**
+ * @brief Apply a move from a gesture or from the autoplay.
+ */
+void Game2048::handleMove(Game2048Board::Direction dir)
 {
-    int target_cells[4][4];
-    int score = -1;
+    int score;
 
-    for (int i = 0; i < 16; i++) {
-        target_cells[i/4][i%4] = i/4;
+    if (anim_running_flag) {
+        return;
     }
 
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-
-    for (int j = 0; j < 4; j++) {
-        for (int i = 1; i < 4; i++) {
-            if (_cells_weight[i][j].weight != 0) {
-                int merge_flag = false;
-                int cur_i = i;
-                while (cur_i != 0) {
-                    if ((_cells_weight[cur_i-1][j].weight == _cells_weight[cur_i][j].weight) &&
-                        (!merge_flag)) {
-                        merge_flag = true;
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i][j].x & (1 << k);
-                            if (target_flag) {
-                                target_cells[k][j] = cur_i - 1;
-                            }
-                        }
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i-1][j].x & (1 << k);
-                            if (target_flag) {
-                                addRemoveReadyCell(_foreground_cells[k][j]);
-                            }
-                        }
-
-                        _cells_weight[cur_i-1][j].x += _cells_weight[cur_i][j].x;
-                        _cells_weight[cur_i-1][j].weight++;
-                        _cells_weight[cur_i][j].weight = 0;
-                        _weight_max = (_cells_weight[cur_i-1][j].weight > _weight_max) ?
-                                       _cells_weight[cur_i-1][j].weight : _weight_max;
-
-                        score = (score < 0) ? 0 : score;
-                        score += lv_pow(2, _cells_weight[cur_i-1][j].weight);
-                    }
-                    else if (_cells_weight[cur_i-1][j].weight == 0) {
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i][j].x & (1 << k);
-                            if (target_flag) {
-                                target_cells[k][j] = cur_i - 1;
-                            }
-                        }
-
-                        score = (score < 0) ? 0 : score;
-                        _cells_weight[cur_i-1][j] = _cells_weight[cur_i][j];
-                        _cells_weight[cur_i][j].weight = 0;
-                    }
-                    else {
-                        break;
-                    }
-                    cur_i--;
-                }
-            }
+    // The board is about to change, whatever the search finds now is useless
+    _ai.cancel();
+    lv_label_set_text(_hint_label, "");
+
+    score = move(dir);
+    printf("score: %d\n", score);
+
+    if (score >= 0) {
+        ui_sound_play(UI_SOUND_MOVE);
+        generate_cell_flag = true;
+        showEmojiScore(score);
+        current_score += score;
+        updateCurrentScore(current_score);
+        if (current_score > best_score) {
+            best_score = current_score;
+            updateBestScore(best_score);
         }
     }
-
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-    debugCells(_remove_ready_cells);
-    debugCells(_foreground_cells);
-
-    for (int j = 0; j < 4; j++) {
-        for (int i = 1; i < 4; i++) {
-            int target_i = target_cells[i][j];
-            if ((_foreground_cells[i][j] != NULL) && (i != target_i)) {
-                // printf(NULL, "i,j: %d,%d", i, j);
-                int target_y = lv_obj_get_y(_background_cells[target_i][j]);
-                startAnimationY(_foreground_cells[i][j], target_y, ANIM_PERIOD);
-                _foreground_cells[target_i][j] = _foreground_cells[i][j];
-                _foreground_cells[i][j] = NULL;
-            }
-        }
+    if (maxWeight() == 2048) {
+        printf("Congratualation! You win!\n");
+        ui_sound_play(UI_SOUND_NOTIFY);
+        newGame();
     }
-
-    debugCells(_foreground_cells);
-
-    // Reset x,y of weight
-    for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
+    if (isGameOver()) {
+        printf("Game Over\n");
+        showEmojiGameOver();
     }
-
-    return score;
 }
 
-int Game2048::moveDown(void)
+void Game2048::requestAi(void)
 {
-    int target_cells[4][4];
-    int score = -1;
-
-    for (int i = 0; i < 16; i++) {
-        target_cells[i/4][i%4] = i/4;
+    if ((_ai_mode != AI_OFF) && !_is_paused && !isGameOver()) {
+        _ai.request(_board);
     }
+}
 
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-
-    for (int j = 0; j < 4; j++) {
-        for (int i = 2; i >= 0; i--) {
-            if (_cells_weight[i][j].weight != 0) {
-                int merge_flag = false;
-                int cur_i = i;
-                while (cur_i != 3) {
-                    if ((_cells_weight[cur_i+1][j].weight == _cells_weight[cur_i][j].weight) &&
-                        (!merge_flag)) {
-                        merge_flag = true;
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i][j].x & (1 << k);
-                            if (target_flag) {
-                                target_cells[k][j] = cur_i + 1;
-                            }
-                        }
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i+1][j].x & (1 << k);
-                            if (target_flag) {
-                                addRemoveReadyCell(_foreground_cells[k][j]);
-                            }
-                        }
-
-                        _cells_weight[cur_i+1][j].x += _cells_weight[cur_i][j].x;
-                        _cells_weight[cur_i+1][j].weight++;
-                        _cells_weight[cur_i][j].weight = 0;
-                        _weight_max = (_cells_weight[cur_i+1][j].weight > _weight_max) ?
-                                       _cells_weight[cur_i+1][j].weight : _weight_max;
-
-                        score = (score < 0) ? 0 : score;
-                        score += lv_pow(2, _cells_weight[cur_i+1][j].weight);
-                    }
-                    else if (_cells_weight[cur_i+1][j].weight == 0) {
-
-                        for (int k = 0; k < 4; k++) {
-                            int target_flag = _cells_weight[cur_i][j].x & (1 << k);
-                            if (target_flag) {
-                                target_cells[k][j] = cur_i + 1;
-                            }
-                        }
-
-                        score = (score < 0) ? 0 : score;
-                        _cells_weight[cur_i+1][j] = _cells_weight[cur_i][j];
-                        _cells_weight[cur_i][j].weight = 0;
-                    }
-                    else {
-                        break;
-                    }
-                    cur_i++;
-                }
-            }
-        }
-    }
-
-    debugCells(_cells_weight);
-    debugCells(target_cells);
-    debugCells(_remove_ready_cells);
-    debugCells(_foreground_cells);
-
-    for (int j = 0; j < 4; j++) {
-        for (int i = 2; i >= 0; i--) {
-            int target_i = target_cells[i][j];
-            if ((_foreground_cells[i][j] != NULL) && (i != target_i)) {
-                // printf(NULL, "i,j: %d,%d", i, j);
-                int target_y = lv_obj_get_y(_background_cells[target_i][j]);
-                startAnimationY(_foreground_cells[i][j], target_y, ANIM_PERIOD);
-                _foreground_cells[target_i][j] = _foreground_cells[i][j];
-                _foreground_cells[i][j] = NULL;
-            }
-        }
-    }
-
-    debugCells(_foreground_cells);
-
-    // Reset x,y of weight
-    for (int i = 0; i < 16; i++) {
-        _cells_weight[i/4][i%4].x = 1 << (i/4);
-        _cells_weight[i/4][i%4].y = 1 << (i%4);
-    }
+void Game2048::updateAiButton(void)
+{
+    static const char *texts[AI_MODE_MAX] = {"Hint: Off", "Hint: On", "Autoplay"};
 
-    return score;
+    lv_label_set_text(_ai_btn_label, texts[_ai_mode]);
+    lv_label_set_text(_hint_label, "");
 }
 
-bool Game2048::isGameOver(void)
+void Game2048::ai_button_event_cb(lv_event_t *e)
 {
-    for (int i = 0; i < 4; i++) {
-        for (int j = 1; j < 4; j++) {
-            if ((_cells_weight[i][j].weight == _cells_weight[i][j-1].weight) ||
-                (_cells_weight[j][i].weight == _cells_weight[j-1][i].weight) ||
-                (_cells_weight[i][j].weight == 0)) {
-                    return false;
-            }
-        }
-    }
+    Game2048 *app= (Game2048 *)lv_event_get_user_data(e);
 
-    return true;
+    app->_ai_mode = (AiMode)((app->_ai_mode + 1) % AI_MODE_MAX);
+    if (app->_ai_mode == AI_OFF) {
+        app->_ai.end();
+    } else if (!app->_ai.begin()) {
+        app->_ai_mode = AI_OFF;
+    }
+    app->updateAiButton();
+    app->requestAi();
 }
 
-void Game2048::new_game_event_cb(lv_event_t *e)
+/**
+ * @brief Poll the search, show the best move found so far and play it in autoplay once the search is finished.
+ */
+void Game2048::ai_timer_cb(lv_timer_t *t)
 {
-    Game2048 *app= (Game2048 *)lv_event_get_user_data(e);
+    static const char *dir_names[Game2048Board::DIR_MAX] = {
+        LV_SYMBOL_LEFT, LV_SYMBOL_RIGHT, LV_SYMBOL_UP, LV_SYMBOL_DOWN
+    };
+    Game2048 *app = (Game2048 *)t->user_data;
+    Game2048Ai::result_t result;
 
-    app->newGame();
+    if ((app->_ai_mode == AI_OFF) || app->_is_paused || !app->_ai.takeResult(&result)) {
+        return;
+    }
+    // Results for an older board can still arrive right after a move
+    if (result.board != app->_board) {
+        return;
+    }
+
+    lv_label_set_text_fmt(app->_hint_label, "%s %d", dir_names[result.dir], result.depth);
+    if ((app->_ai_mode == AI_AUTO) && result.final) {
+        app->handleMove(result.dir);
+    }
 }
 
 void Game2048::motion_event_cb(lv_event_t *e)
 {
-    int score;
     ESP_Brookesia_GestureInfo_t *type = (ESP_Brookesia_GestureInfo_t *)lv_event_get_param(e);
     Game2048 *app= (Game2048 *)lv_event_get_user_data(e);
 
@@ -1104,48 +1038,21 @@ void Game2048::motion_event_cb(lv_event_t *e)
         return;
     }
 
-    if (!anim_running_flag) {
-        switch (type->direction) {
-            case ESP_BROOKESIA_GESTURE_DIR_UP:
-                // printf(NULL, "up");
-                score = app->moveUp();
-                break;
-            case ESP_BROOKESIA_GESTURE_DIR_DOWN:
-                // printf(NULL, "down");
-                score = app->moveDown();
-                break;
-            case ESP_BROOKESIA_GESTURE_DIR_LEFT:
-                // printf(NULL, "left");
-                score = app->moveLeft();
-                break;
-            case ESP_BROOKESIA_GESTURE_DIR_RIGHT:
-                // printf(NULL, "right");
-                score = app->moveRight();
-                break;
-            default:
-                return;
-        }
-
-        printf("score: %d\n", score);
-
-        if (score >= 0) {
-            generate_cell_flag = true;
-            app->showEmojiScore(score);
-            app->current_score += score;
-            app->updateCurrentScore(app->current_score);
-            if (app->current_score > app->best_score) {
-                app->best_score = app->current_score;
-                app->updateBestScore(app->best_score);
-            }
-        }
-        if (app->maxWeight() == 2048) {
-            printf("Congratualation! You win!\n");
-            app->newGame();
-        }
-        if (app->isGameOver()) {
-            printf("Game Over\n");
-            app->showEmojiGameOver();
-        }
+    switch (type->direction) {
+        case ESP_BROOKESIA_GESTURE_DIR_UP:
+            app->handleMove(Game2048Board::DIR_UP);
+            break;
+        case ESP_BROOKESIA_GESTURE_DIR_DOWN:
+            app->handleMove(Game2048Board::DIR_DOWN);
+            break;
+        case ESP_BROOKESIA_GESTURE_DIR_LEFT:
+            app->handleMove(Game2048Board::DIR_LEFT);
+            break;
+        case ESP_BROOKESIA_GESTURE_DIR_RIGHT:
+            app->handleMove(Game2048Board::DIR_RIGHT);
+            break;
+        default:
+            return;
     }
 }
 
@@ -1153,12 +1060,13 @@ void Game2048::anim_finish_cb(struct _lv_anim_t *a)
 {
     Game2048 *app= (Game2048 *)lv_anim_get_user_data(a);
 
+    app->_tile_anim_num = 0;
     app->cleanRemoveReadyCell();
     app->updateCellValue();
     if (generate_cell_flag) {
         generate_cell_flag = false;
         app->generateForegroundCell();
-        app->updateCellsStyle();
+        app->requestAi();
     }
     if (anim_running_flag) {
         anim_running_flag = false;
@@ -4,14 +4,8 @@
 #include "lvgl.h"
 #include "bsp_board_extra.h"
 #include "esp_brookesia.hpp"
-
-typedef struct {
-	// Index of row
-	int x;
-	// Index of column
-	int y;
-	int weight;
-} cell_weight_t;
+#include "Game2048Board.hpp"
+#include "Game2048Ai.hpp"
 
 class Game2048: public ESP_Brookesia_PhoneApp
 {
@@ -26,6 +20,8 @@ public:
     bool init(void) override;
     bool pause(void) override;
     bool resume(void) override;
+    bool saveState(std::vector<uint8_t> &state) override;
+    bool restoreState(const uint8_t *data, size_t size) override;
 
     void showEmojiHello(void);
     void showEmojiScore(int score);
@@ -33,7 +29,7 @@ public:
     void debugCells(void);
     void debugCells(int cell[4][4]);
     void debugCells(lv_obj_t *cell[4][4]);
-    void debugCells(cell_weight_t cell[4][4]);
+    void debugCells(Game2048Board::board_t board);
     void debugCells(lv_obj_t *cell[4]);
     void cleanForegroundCells(void);
     void generateForegroundCell(void);
@@ -52,13 +48,46 @@ public:
     bool isGameOver(void);
 
 private:
+    typedef struct {
+        lv_obj_t *tile;
+        int from;                                     // Position on the moving axis
+        int to;
+        bool vertical;
+    } tile_anim_t;
+
+    // Kept by the core across closes and restarts, bump the version when the layout changes
+    typedef struct __attribute__((packed)) {
+        uint8_t version;
+        uint8_t spawn_pending;                        // Closed during a move, before its new tile appeared
+        uint16_t score;
+        uint64_t board;
+    } saved_state_t;
+
     lv_obj_t *addBackgroundCell(lv_obj_t *parent);
-    void startAnimationX(lv_obj_t *target, int x, int time);
-    void startAnimationY(lv_obj_t *target, int y, int time);
+    void placeBoard(Game2048Board::board_t board);
+    int move(Game2048Board::Direction dir);
+    void handleMove(Game2048Board::Direction dir);
+    void requestAi(void);
+    void updateAiButton(void);
+    lv_obj_t *acquireTile(void);
+    void releaseTile(lv_obj_t *tile);
+    void restyleTile(lv_obj_t *tile, int weight);
+    void addTileAnimation(lv_obj_t *tile, bool vertical, int to);
+    void startTileAnimations(void);
 
     static void new_game_event_cb(lv_event_t *e);
     static void motion_event_cb(lv_event_t *e);
     static void anim_finish_cb(struct _lv_anim_t *a);
+    static void tile_anim_exec_cb(void *var, int32_t value);
+    static void ai_button_event_cb(lv_event_t *e);
+    static void ai_timer_cb(lv_timer_t *t);
+
+    enum AiMode {
+        AI_OFF = 0,
+        AI_HINT,
+        AI_AUTO,
+        AI_MODE_MAX,
+    };
 
     bool _is_paused;
     uint16_t _height;
@@ -68,14 +97,25 @@ private:
     uint16_t _weight_max;
     nvs_handle_t nvs_handle;
     file_iterator_instance_t *_file_iterator;
-    cell_weight_t _cells_weight[4][4];
+    Game2048Board::board_t _board;
     lv_obj_t *_cur_score_label, *_best_score_label;
     lv_obj_t *_background_cells[4][4];
     lv_obj_t *_foreground_cells[4][4];
     lv_obj_t *_emoji_imgs[6];
     lv_obj_t *_emoji_label;
     lv_obj_t *_remove_ready_cells[4][4];
+    // Foreground tiles, shown and restyled instead of created and deleted
+    lv_obj_t *_tile_pool[16];
+    uint8_t _tile_weight[16];
+    uint16_t _tile_free;
+    tile_anim_t _tile_anims[16];
+    int _tile_anim_num;
     lv_obj_t *_foreground_grid;
     lv_color_t  _cell_colors[11];
     const ESP_Brookesia_Gesture *_gesture;
+    Game2048Ai _ai;
+    AiMode _ai_mode;
+    lv_timer_t *_ai_timer;
+    lv_obj_t *_ai_btn_label;
+    lv_obj_t *_hint_label;
 };
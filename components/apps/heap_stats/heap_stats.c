@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "heap_stats.h"
+
+static const char *TAG = "heap_stats";
+
+static const uint32_t region_caps[HEAP_STATS_REGION_NUM] = {
+    [HEAP_STATS_REGION_INTERNAL] = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    [HEAP_STATS_REGION_DMA] = MALLOC_CAP_DMA,
+    [HEAP_STATS_REGION_PSRAM] = MALLOC_CAP_SPIRAM,
+};
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static heap_stats_t stats_cache;
+/* Free sizes at the last bump of `seq` */
+static size_t stats_reported_free[HEAP_STATS_REGION_NUM];
+
+static bool stats_moved(const heap_stats_t *sample)
+{
+    const size_t threshold = (size_t)CONFIG_HEAP_STATS_CHANGE_KB * 1024;
+
+    for (int i = 0; i < HEAP_STATS_REGION_NUM; i++) {
+        size_t free = sample->regions[i].free;
+        size_t reported = stats_reported_free[i];
+        if (((free > reported) ? (free - reported) : (reported - free)) >= threshold) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+esp_err_t heap_stats_get(heap_stats_t *stats)
+{
+    heap_stats_t sample = { 0 };
+    multi_heap_info_t info;
+    int64_t now_us = esp_timer_get_time();
+
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid stats");
+
+    taskENTER_CRITICAL(&stats_lock);
+    if ((stats_cache.seq != 0) && (now_us - stats_cache.time_us < (int64_t)CONFIG_HEAP_STATS_MIN_PERIOD_MS * 1000)) {
+        *stats = stats_cache;
+        taskEXIT_CRITICAL(&stats_lock);
+        return ESP_OK;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+
+    /* One walk per region gives all its values, callers racing here sample twice at worst */
+    for (int i = 0; i < HEAP_STATS_REGION_NUM; i++) {
+        heap_caps_get_info(&info, region_caps[i]);
+        sample.regions[i] = (heap_stats_info_t) {
+            .free = info.total_free_bytes,
+            .total = info.total_free_bytes + info.total_allocated_bytes,
+            .minimum_free = info.minimum_free_bytes,
+            .largest_free_block = info.largest_free_block,
+        };
+    }
+    sample.time_us = now_us;
+
+    taskENTER_CRITICAL(&stats_lock);
+    sample.seq = stats_cache.seq;
+    if ((sample.seq == 0) || stats_moved(&sample)) {
+        sample.seq++;
+        for (int i = 0; i < HEAP_STATS_REGION_NUM; i++) {
+            stats_reported_free[i] = sample.regions[i].free;
+        }
+    }
+    stats_cache = sample;
+    *stats = sample;
+    taskEXIT_CRITICAL(&stats_lock);
+
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sampled heap regions
+ */
+typedef enum {
+    HEAP_STATS_REGION_INTERNAL,     /*!< `MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT` */
+    HEAP_STATS_REGION_DMA,          /*!< `MALLOC_CAP_DMA` */
+    HEAP_STATS_REGION_PSRAM,        /*!< `MALLOC_CAP_SPIRAM` */
+    HEAP_STATS_REGION_NUM,
+} heap_stats_region_t;
+
+/**
+ * @brief Statistics of a heap region, in bytes
+ */
+typedef struct {
+    size_t free;                    /*!< Free size */
+    size_t total;                   /*!< Total size */
+    size_t minimum_free;            /*!< Lowest free size since boot */
+    size_t largest_free_block;      /*!< Largest block that can be allocated */
+} heap_stats_info_t;
+
+/**
+ * @brief Statistics of all the regions
+ */
+typedef struct {
+    heap_stats_info_t regions[HEAP_STATS_REGION_NUM];
+    uint32_t seq;                   /*!< Bumped when the free size of a region moved by `CONFIG_HEAP_STATS_CHANGE_KB`
+                                         or more since the previous bump, 0 before the first sample */
+    int64_t time_us;                /*!< Time of the sample */
+} heap_stats_t;
+
+/**
+ * @brief Get the heap statistics.
+ *
+ * The heaps are walked at most once per `CONFIG_HEAP_STATS_MIN_PERIOD_MS` for all the callers, the cached sample is
+ * returned in between. Callers that only show the values compare `seq` with the one they last showed to skip small
+ * changes. Can be called from any task.
+ *
+ * @param stats Output statistics.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if `stats` is NULL.
+ */
+esp_err_t heap_stats_get(heap_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
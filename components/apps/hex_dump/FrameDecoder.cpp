@@ -0,0 +1,160 @@
+#include "FrameDecoder.hpp"
+#include "crc16_modbus/crc16_modbus.h"
+#include <stdio.h>
+
+// SLIP特殊字符
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+
+FrameDecoder::FrameDecoder() :
+    _len(0),
+    _total(0),
+    _complete(false)
+{
+}
+
+void FrameDecoder::reset(void)
+{
+    _len = 0;
+    _total = 0;
+    _complete = false;
+}
+
+void FrameDecoder::beginFrame(void)
+{
+    if (_complete) {
+        _len = 0;
+        _total = 0;
+        _complete = false;
+    }
+}
+
+void FrameDecoder::pushByte(uint8_t byte)
+{
+    if (_len < MAX_FRAME) {
+        _frame[_len++] = byte;
+    }
+    _total++;
+}
+
+SlipDecoder::SlipDecoder() :
+    _escape(false),
+    _bad_escape(false)
+{
+}
+
+void SlipDecoder::reset(void)
+{
+    FrameDecoder::reset();
+    _escape = false;
+    _bad_escape = false;
+}
+
+bool SlipDecoder::feed(uint8_t byte)
+{
+    if (_complete) {
+        beginFrame();
+        _bad_escape = false;
+    }
+
+    if (byte == SLIP_END) {
+        // 连续的END只是帧间填充
+        _escape = false;
+        if (_total == 0) {
+            return false;
+        }
+        _complete = true;
+        return true;
+    }
+
+    if (_escape) {
+        _escape = false;
+        if (byte == SLIP_ESC_END) {
+            byte = SLIP_END;
+        } else if (byte == SLIP_ESC_ESC) {
+            byte = SLIP_ESC;
+        } else {
+            // 无效转义，保留原字节
+            _bad_escape = true;
+        }
+        pushByte(byte);
+    } else if (byte == SLIP_ESC) {
+        _escape = true;
+    } else {
+        pushByte(byte);
+    }
+
+    return false;
+}
+
+size_t SlipDecoder::describe(char* out, size_t size) const
+{
+    int n = snprintf(out, size, "[SLIP] %u bytes%s%s", (unsigned int)_total,
+                     _bad_escape ? ", bad escape" : "",
+                     (_total > _len) ? ", truncated" : "");
+    return (n < 0) ? 0 : ((size_t)n < size ? (size_t)n : size - 1);
+}
+
+ModbusRtuDecoder::ModbusRtuDecoder() :
+    _crc(CRC16_MODBUS_INIT),
+    _crc_ok(false)
+{
+}
+
+void ModbusRtuDecoder::reset(void)
+{
+    FrameDecoder::reset();
+    _crc = CRC16_MODBUS_INIT;
+    _crc_ok = false;
+}
+
+bool ModbusRtuDecoder::feed(uint8_t byte)
+{
+    if (_complete) {
+        beginFrame();
+        _crc = CRC16_MODBUS_INIT;
+    }
+
+    pushByte(byte);
+    _crc = crc16_modbus_update(_crc, &byte, 1);
+
+    // 截断的帧只能等空闲时结束
+    if (_crc == 0 && _total >= MIN_FRAME && _total == _len) {
+        _crc_ok = true;
+        _complete = true;
+        return true;
+    }
+
+    return false;
+}
+
+bool ModbusRtuDecoder::idle(void)
+{
+    if (_complete || _total == 0) {
+        return false;
+    }
+
+    _crc_ok = false;
+    _complete = true;
+    return true;
+}
+
+size_t ModbusRtuDecoder::describe(char* out, size_t size) const
+{
+    int n;
+
+    if (_len < 2) {
+        n = snprintf(out, size, "[Modbus] %u bytes, too short", (unsigned int)_total);
+    } else if (_frame[1] & 0x80) {
+        n = snprintf(out, size, "[Modbus] addr %u fn 0x%02X exception %u, %u bytes, CRC %s",
+                     _frame[0], _frame[1] & 0x7F, (_len > 2) ? _frame[2] : 0, (unsigned int)_total,
+                     _crc_ok ? "OK" : "BAD");
+    } else {
+        n = snprintf(out, size, "[Modbus] addr %u fn 0x%02X, %u bytes, CRC %s",
+                     _frame[0], _frame[1], (unsigned int)_total, _crc_ok ? "OK" : "BAD");
+    }
+
+    return (n < 0) ? 0 : ((size_t)n < size ? (size_t)n : size - 1);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class FrameDecoder
+ * @brief 十六进制视图的协议分帧接口
+ *
+ * 逐字节输入接收数据，一帧结束时feed或idle返回true，HexDump随即读取frame()并显示，
+ * 下一次输入时自动开始新的一帧。帧缓冲是固定大小的成员数组，不在运行中分配内存。
+ */
+class FrameDecoder {
+public:
+    static const size_t MAX_FRAME = 512;                // 单帧最大长度，超出部分截断
+
+    FrameDecoder();
+    virtual ~FrameDecoder() {}
+
+    /**
+     * @brief 丢弃未完成的帧
+     */
+    virtual void reset(void);
+
+    /**
+     * @brief 输入一个字节
+     * @return true 一帧结束
+     */
+    virtual bool feed(uint8_t byte) = 0;
+
+    /**
+     * @brief 线路空闲（一个UI周期内没有新数据）
+     * @return true 已积累的数据作为一帧结束
+     */
+    virtual bool idle(void) = 0;
+
+    /**
+     * @brief 帧摘要，如"[Modbus] addr 1 fn 0x03, 8 bytes, CRC OK"
+     * @return 写入的字符数
+     */
+    virtual size_t describe(char* out, size_t size) const = 0;
+
+    const uint8_t* frame(void) const { return _frame; }
+    size_t frameLength(void) const { return _len; }
+
+protected:
+    // 开始新的一帧之前调用，上一帧已被读取
+    void beginFrame(void);
+    void pushByte(uint8_t byte);
+
+    uint8_t _frame[MAX_FRAME];
+    size_t  _len;
+    size_t  _total;                 // 帧的实际长度，含截断的部分
+    bool    _complete;              // 上一帧已结束，下一个字节开始新帧
+};
+
+/**
+ * @class SlipDecoder
+ * @brief RFC 1055 SLIP分帧，输出去转义后的数据
+ */
+class SlipDecoder : public FrameDecoder {
+public:
+    SlipDecoder();
+
+    void reset(void) override;
+    bool feed(uint8_t byte) override;
+    bool idle(void) override { return false; }
+    size_t describe(char* out, size_t size) const override;
+
+private:
+    bool _escape;                   // 上一个字节是ESC
+    bool _bad_escape;               // 帧内出现无效的转义序列
+};
+
+/**
+ * @class ModbusRtuDecoder
+ * @brief Modbus RTU分帧
+ *
+ * UI周期远大于3.5个字符的帧间隔，无法按时间分帧。接收时持续计算CRC，
+ * 连同CRC字节计算的结果为0时即为一帧结束，背靠背的请求和应答也能分开；
+ * 空闲时剩余的数据作为CRC错误的帧输出。
+ */
+class ModbusRtuDecoder : public FrameDecoder {
+public:
+    static const size_t MIN_FRAME = 4;                  // 地址+功能码+CRC
+
+    ModbusRtuDecoder();
+
+    void reset(void) override;
+    bool feed(uint8_t byte) override;
+    bool idle(void) override;
+    size_t describe(char* out, size_t size) const override;
+
+private:
+    uint16_t _crc;
+    bool     _crc_ok;
+};
@@ -0,0 +1,135 @@
+#include "HexDump.hpp"
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+HexDump::HexDump() :
+    _terminal(nullptr),
+    _decoder(nullptr),
+    _row_len(0),
+    _offset(0)
+{
+}
+
+void HexDump::setDecoder(FrameDecoder* decoder)
+{
+    _decoder = decoder;
+    reset();
+}
+
+void HexDump::reset(void)
+{
+    _row_len = 0;
+    _offset = 0;
+    if (_decoder) {
+        _decoder->reset();
+    }
+}
+
+void HexDump::feed(const uint8_t* data, size_t len)
+{
+    if (_decoder) {
+        for (size_t i = 0; i < len; i++) {
+            if (_decoder->feed(data[i])) {
+                emitFrame();
+            }
+        }
+        return;
+    }
+
+    while (len > 0) {
+        size_t chunk = BYTES_PER_ROW - _row_len;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        // 整行直接从接收缓冲区格式化，不满的行才暂存
+        if (_row_len == 0 && chunk == BYTES_PER_ROW) {
+            emitRow(_offset, data, BYTES_PER_ROW);
+            _offset += BYTES_PER_ROW;
+        } else {
+            memcpy(_row + _row_len, data, chunk);
+            _row_len += chunk;
+            if (_row_len == BYTES_PER_ROW) {
+                emitRow(_offset, _row, BYTES_PER_ROW);
+                _offset += BYTES_PER_ROW;
+                _row_len = 0;
+            }
+        }
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void HexDump::idle(void)
+{
+    if (_decoder) {
+        if (_decoder->idle()) {
+            emitFrame();
+        }
+        return;
+    }
+
+    if (_row_len > 0) {
+        emitRow(_offset, _row, _row_len);
+        _offset += _row_len;
+        _row_len = 0;
+    }
+}
+
+void HexDump::emitRow(uint32_t offset, const uint8_t* data, size_t len)
+{
+    if (_terminal == nullptr) {
+        return;
+    }
+
+    char* p = _line;
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *p++ = HEX_DIGITS[(offset >> shift) & 0x0F];
+    }
+    *p++ = ' ';
+    *p++ = ' ';
+
+    // 不满的行用空格补齐，字符列保持对齐
+    for (size_t i = 0; i < BYTES_PER_ROW; i++) {
+        if (i < len) {
+            *p++ = HEX_DIGITS[data[i] >> 4];
+            *p++ = HEX_DIGITS[data[i] & 0x0F];
+        } else {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+        if (i == BYTES_PER_ROW / 2 - 1) {
+            *p++ = ' ';
+        }
+    }
+    *p++ = ' ';
+
+    *p++ = '|';
+    for (size_t i = 0; i < len; i++) {
+        *p++ = (data[i] >= 32 && data[i] <= 126) ? (char)data[i] : '.';
+    }
+    *p++ = '|';
+    *p++ = '\n';
+
+    _terminal->append(_line, p - _line);
+}
+
+void HexDump::emitFrame(void)
+{
+    if (_terminal == nullptr) {
+        return;
+    }
+
+    size_t n = _decoder->describe(_line, sizeof(_line) - 1);
+    _line[n++] = '\n';
+    _terminal->append(_line, n);
+
+    const uint8_t* frame = _decoder->frame();
+    size_t len = _decoder->frameLength();
+    for (size_t pos = 0; pos < len; pos += BYTES_PER_ROW) {
+        size_t row_len = (len - pos < BYTES_PER_ROW) ? len - pos : BYTES_PER_ROW;
+        emitRow(pos, frame + pos, row_len);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "terminal_view/TerminalView.hpp"
+#include "FrameDecoder.hpp"
+
+/**
+ * @class HexDump
+ * @brief 把接收的原始字节格式化为十六进制行追加到终端
+ *
+ * 每行16字节："00000010  48 65 6C 6C 6F 0D 0A ...  |Hello..|"。满一行立即输出，
+ * 线路空闲时输出不满的行，下一批数据从新的一行开始。设置了分帧解码器时按帧输出，
+ * 每帧先输出一行摘要，偏移从帧首开始计。行缓冲是成员数组，格式化过程不分配内存。
+ * 所有方法都只能在LVGL上下文中调用。
+ */
+class HexDump {
+public:
+    static const size_t BYTES_PER_ROW = 16;
+
+    HexDump();
+
+    /**
+     * @brief 设置输出终端
+     */
+    void attach(TerminalView* terminal) { _terminal = terminal; }
+
+    /**
+     * @brief 设置分帧解码器
+     * @param decoder 解码器，nullptr按原始字节流显示；未完成的行或帧被丢弃
+     */
+    void setDecoder(FrameDecoder* decoder);
+
+    /**
+     * @brief 输入接收的数据
+     */
+    void feed(const uint8_t* data, size_t len);
+
+    /**
+     * @brief 一个UI周期没有新数据时调用，输出不满的行或结束当前帧
+     */
+    void idle(void);
+
+    /**
+     * @brief 偏移归零，丢弃未完成的行和帧
+     */
+    void reset(void);
+
+private:
+    // 偏移(8) + 16组"XX "(48) + 2个分隔空格 + 两侧'|'和16个字符 + 换行
+    static const size_t LINE_SIZE = 8 + 2 + BYTES_PER_ROW * 3 + 2 + BYTES_PER_ROW + 3;
+
+    void emitRow(uint32_t offset, const uint8_t* data, size_t len);
+    void emitFrame(void);
+
+    TerminalView*  _terminal;
+    FrameDecoder*  _decoder;
+    uint8_t        _row[BYTES_PER_ROW];    // 未输出的字节
+    size_t         _row_len;
+    uint32_t       _offset;                // _row首字节在数据流中的偏移
+    char           _line[LINE_SIZE + 1];
+};
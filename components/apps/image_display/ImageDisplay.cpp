@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <algorithm>
 #include <fcntl.h>
 #include <dirent.h>
@@ -7,9 +9,18 @@
 #include "freertos/semphr.h"
 #include "esp_check.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "bsp/esp-bsp.h"
 #include "bsp_board_extra.h"
 #include "driver/jpeg_decode.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "task_config/task_config.h"
+#include "media_arena/media_arena.h"
+#include "touch_points/touch_points.h"
+#include "image_cache.h"
+#include "image_decode.h"
+#include "image_thumb.h"
+#include "image_tiles.h"
 #include "ImageDisplay.hpp"
 #include "app_gui/app_image_display.h"
 
@@ -17,52 +28,79 @@
 #define IMAGE_DIR   BSP_SPIFFS_MOUNT_POINT "/image"
 #define APP_IMAGE_FRAME_BUF_SIZE   (800 * 1280 * 2)
 #define APP_CACHE_BUF_SIZE         (64 * 1024)
-
-typedef enum {
-    IMAGE_EVENT_TASK_RUN = BIT(0),
-    IMAGE_EVENT_DELETE = BIT(1),
-    IMAGE_EVENT_DIR = BIT(2),
-} image_event_id_t;
-
-static void image_change_display(file_iterator_instance_t *ft,int index);
+#define APP_IMAGE_CACHE_BUDGET     (CONFIG_IMAGE_DISPLAY_CACHE_BUDGET_KB * 1024)
+#define APP_IMAGE_SHOW_PERIOD_MS   (20)
+// Images larger than the canvas are scaled down to it
+#define APP_IMAGE_FIT_WIDTH        (480)
+#define APP_IMAGE_FIT_HEIGHT       (800)
+#define APP_SLIDESHOW_INTERVAL_MS  (CONFIG_IMAGE_DISPLAY_SLIDESHOW_INTERVAL_MS)
+#define APP_SLIDESHOW_FADE_MS      (CONFIG_IMAGE_DISPLAY_SLIDESHOW_FADE_MS)
+#define APP_ZOOM_TILE_BUDGET       (CONFIG_IMAGE_DISPLAY_TILE_BUDGET_KB * 1024)
+#define APP_ZOOM_MAX               (CONFIG_IMAGE_DISPLAY_ZOOM_MAX)
+// Closer fingers give a distance too noisy to zoom with
+#define APP_ZOOM_PINCH_DIST_MIN    (40)
+// Pinched back this close to the whole image, the zoom is left on release
+#define APP_ZOOM_EXIT_RATIO        (1.05f)
+
+static void image_change_display(int index);
+static void zoom_stop(void);
 
 static int image_count = 0;
 static int count_now = 0;
 
-static jpeg_decoder_handle_t jpgd_handle;
-
-static jpeg_decode_engine_cfg_t decode_eng_cfg = {
-        .timeout_ms = 40,
-};
-
-static jpeg_decode_cfg_t decode_cfg_rgb = {
-    .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
-    .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
-};
-
-
-static jpeg_decode_memory_alloc_cfg_t rx_mem_cfg = {
-    .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
-};
-
-static jpeg_decode_memory_alloc_cfg_t tx_mem_cfg = {
-    .buffer_direction = JPEG_DEC_ALLOC_INPUT_BUFFER,
-};
-
 using namespace std;
 
 static const char *TAG = "AppImageDisplay";
 
-static EventGroupHandle_t image_event_group;
-static uint8_t *output_buf[2];
-static size_t output_buf_size[2];
+// Images are decoded by the cache task, the canvas is only pointed at them from LVGL context
+static lv_timer_t *image_show_timer = NULL;
+static int image_shown = -1;
+static int image_pending = -1;
+static bool image_ready = false;
+static image_frame_t image_shown_frame;
+
+// The zoom draws the shown image into a screen sized buffer, the canvas points at it while zoomed. LVGL context
+// only, but `zoom_tiles_ready` set by the tiles task.
+static dir_index_handle_t zoom_images = NULL;
+static bool zoom_supported = false;
+static bool zoom_touch_hooked = false;
+static bool zoom_active = false;
+static bool zoom_dirty = false;
+static bool zoom_tiles_ready = false;
+static uint8_t *zoom_buf = NULL;
+static size_t zoom_buf_size = 0;
+static float zoom_factor = 0;               // Screen pixels per image pixel
+static float zoom_center_x = 0;             // Image point at the center of the screen
+static float zoom_center_y = 0;
+static bool pinch_active = false;
+static float pinch_dist = 0;
+static float pinch_factor = 0;
+static float pinch_focus_x = 0;
+static float pinch_focus_y = 0;
+
+// The slideshow timer only raises a flag, the image is switched by the show timer in LVGL context
+static esp_timer_handle_t slide_timer = NULL;
+static bool slide_due = false;
+static bool slide_fade = false;
+
+// The grid shows one page of thumbnails, so its memory does not grow with the number of images
+static bool thumb_grid_open = false;
+static int thumb_page = 0;
+static uint32_t thumb_gen = 0;
+static uint32_t thumb_ready_gen[APP_IMAGE_GRID_NUM];
+static bool thumb_shown[APP_IMAGE_GRID_NUM];
+static uint8_t *thumb_bufs[APP_IMAGE_GRID_NUM];
+static lv_img_dsc_t thumb_dscs[APP_IMAGE_GRID_NUM];
+static bool thumb_exit = false;
+static TaskHandle_t thumb_task_handle = NULL;
+static SemaphoreHandle_t thumb_idle = NULL;
 
 LV_IMG_DECLARE(img_app_img_display);
 
 AppImageDisplay::AppImageDisplay():
     ESP_Brookesia_PhoneApp("Image", &img_app_img_display, true),
     _image_name(NULL),
-    _image_file_iterator(NULL)
+    _image_index(NULL)
 {
 }
 
@@ -75,24 +113,52 @@ bool AppImageDisplay::run(void)
     app_image_display_init();
 
     lv_obj_add_event_cb(lv_scr_act(),image_change_cb,LV_EVENT_GESTURE,this);
-    xEventGroupClearBits(image_event_group, IMAGE_EVENT_DELETE);
-    xEventGroupSetBits(image_event_group, IMAGE_EVENT_TASK_RUN);
+    lv_obj_add_event_cb(lv_scr_act(), zoom_event_cb, LV_EVENT_ALL, this);
 
-    for(int i=0;i<2;i++)
-    {
-        output_buf_size[i] = 0;
-         output_buf[i] = (uint8_t*)jpeg_alloc_decoder_mem(800 * 480 *2 , &rx_mem_cfg, &output_buf_size[i]);
+    // The decoder engine is shared with the other apps and kept while the app runs
+    if (jpeg_dec_service_acquire() != ESP_OK) {
+        ESP_LOGE(TAG, "Acquire JPEG decoder failed");
+        return false;
+    }
+    if (image_decode_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Init image scaling failed");
+        jpeg_dec_service_release();
+        return false;
+    }
+    if (image_cache_init(_image_index, APP_IMAGE_CACHE_BUDGET, APP_IMAGE_FIT_WIDTH, APP_IMAGE_FIT_HEIGHT,
+                         image_ready_cb, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Start image cache failed");
+        image_decode_deinit();
+        jpeg_dec_service_release();
+        return false;
+    }
+    image_shown = -1;
+    image_pending = -1;
+    image_show_timer = lv_timer_create(image_show_timer_cb, APP_IMAGE_SHOW_PERIOD_MS, NULL);
+
+    // Without tiles or the second touch point the images can't be zoomed, the viewer works as before
+    zoom_images = _image_index;
+    zoom_supported = (image_tiles_init(APP_ZOOM_TILE_BUDGET, zoom_tiles_ready_cb, NULL) == ESP_OK);
+    if (zoom_supported) {
+        zoom_touch_hooked = (touch_points_hook(lv_obj_get_disp(app_image_screen)) == ESP_OK);
     }
-   
 
-    image_count = file_iterator_get_count(_image_file_iterator);
-    ESP_LOGI(TAG,"image file count = %d",image_count);
 
-    xTaskCreatePinnedToCore((TaskFunction_t)image_delay_change, "Image Init", 2048, this, 3, NULL, 0);
+    image_count = dir_index_get_count(_image_index);
+    ESP_LOGI(TAG,"image file count = %d",image_count);
 
-    // image_change_display(_image_file_iterator,count_now);
+    app_image_display_grid_init(IMAGE_THUMB_SIZE, thumb_click_cb, this);
+    if (thumb_grid_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Start thumbnail grid failed");
+    }
 
-    xEventGroupSetBits(image_event_group, IMAGE_EVENT_TASK_RUN);
+    if (image_count > 0) {
+        if (count_now >= image_count) {
+            count_now = 0;
+        }
+        image_change_display(count_now);
+        slideshow_restart();
+    }
 
     return true;
 }
@@ -100,7 +166,12 @@ bool AppImageDisplay::run(void)
 bool AppImageDisplay::pause(void)
 {
     // app_image_display_pause();
-    xEventGroupClearBits(image_event_group, IMAGE_EVENT_TASK_RUN);
+    // Nothing wakes up while the app is in the background, the zoom gives its memory back
+    slideshow_stop();
+    zoom_stop();
+    if (image_show_timer) {
+        lv_timer_pause(image_show_timer);
+    }
 
     return true;
 }
@@ -108,8 +179,12 @@ bool AppImageDisplay::pause(void)
 bool AppImageDisplay::resume(void)
 {
     // app_image_display_resume();
-    xEventGroupSetBits(image_event_group, IMAGE_EVENT_DIR);
-    xEventGroupSetBits(image_event_group, IMAGE_EVENT_TASK_RUN);
+    if (image_show_timer) {
+        lv_timer_resume(image_show_timer);
+    }
+    if (!thumb_grid_open) {
+        slideshow_restart();
+    }
     return true;
 }
 
@@ -121,118 +196,480 @@ bool AppImageDisplay::back(void)
 bool AppImageDisplay::close(void)
 {
     // app_image_display_close();
-    xEventGroupSetBits(image_event_group, IMAGE_EVENT_DELETE);
-    for(int i=0;i<2;i++)
-    {
-        free(output_buf[i]);
+    slideshow_stop();
+    if (image_show_timer) {
+        lv_timer_del(image_show_timer);
+        image_show_timer = NULL;
+    }
+    thumb_grid_stop();
+    zoom_stop();
+    if (zoom_touch_hooked) {
+        touch_points_unhook();
+        zoom_touch_hooked = false;
     }
+    image_tiles_deinit();
+    zoom_supported = false;
+    image_cache_deinit();
+    image_decode_deinit();
+    image_shown = -1;
+    image_pending = -1;
+    jpeg_dec_service_release();
     return true;
 }
 
 bool AppImageDisplay::init(void)
 {
-    image_event_group = xEventGroupCreate();
-     xEventGroupClearBits(image_event_group, IMAGE_EVENT_TASK_RUN);
-     xEventGroupClearBits(image_event_group, IMAGE_EVENT_DELETE);
-     xEventGroupClearBits(image_event_group, IMAGE_EVENT_DIR);
+    if (APP_SLIDESHOW_INTERVAL_MS > 0) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = slide_timer_cb,
+            .name = "image_slide",
+        };
+        if (esp_timer_create(&timer_args, &slide_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Create slideshow timer failed");
+        }
+    }
 
-    if (bsp_extra_file_instance_init(IMAGE_DIR, &_image_file_iterator) != ESP_OK) {
-        ESP_LOGE(TAG, "bsp_extra_file_instance_init failed");
+    // The sorted listing is saved in the folder, later boots only scan it again if it changed
+    if (dir_index_open(IMAGE_DIR, &_image_index) != ESP_OK) {
+        ESP_LOGE(TAG, "dir_index_open failed");
         return false;
     }
 
     return true;
 }
-static int img_cnt =0;
+// Called from LVGL context, never blocks on the storage
+static void image_change_display(int index)
+{
+    image_frame_t frame;
+
+    zoom_stop();
+    image_cache_set_focus(index);
+    esp_err_t ret = image_cache_acquire(index, &frame);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        // Shown by the timer once the cache task has decoded it
+        image_pending = index;
+        return;
+    }
+    image_pending = -1;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "image %d cannot be shown", index);
+        return;
+    }
+    ESP_LOGI(TAG,"index = %d, image width = %d,image hight = %d",index,(int)frame.width,(int)frame.height);
 
-static void image_change_display(file_iterator_instance_t *ft,int index)
+    lv_canvas_set_buffer(app_image_mian, frame.buf, frame.width, frame.height, LV_IMG_CF_TRUE_COLOR);
+    if (slide_fade && (APP_SLIDESHOW_FADE_MS > 0)) {
+        lv_obj_fade_in(app_image_mian, APP_SLIDESHOW_FADE_MS, 0);
+    }
+    slide_fade = false;
+    // Scaled images can be smaller than the screen, the layout centers them
+    lv_obj_set_size(app_image_mian, frame.width, frame.height);
+    // The previous frame can be evicted once the canvas no longer points at it
+    if (image_shown >= 0) {
+        image_cache_release(image_shown);
+    }
+    image_shown = index;
+    image_shown_frame = frame;
+}
+
+static float zoom_min_factor(void)
+{
+    return (float)image_shown_frame.width / image_shown_frame.src_width;
+}
+
+// A narrower image is centered, a wider one always covers the screen
+static int32_t zoom_origin(float *center, float factor, uint32_t scaled_len, uint32_t out_len)
 {
-    if(xEventGroupGetBits(image_event_group) & IMAGE_EVENT_DIR)
-    {
-        xEventGroupClearBits(image_event_group,IMAGE_EVENT_DIR);
-        vTaskDelay(pdMS_TO_TICKS(2000));
-    }
-    ESP_ERROR_CHECK(jpeg_new_decoder_engine(&decode_eng_cfg, &jpgd_handle));
-    if(img_cnt == 0)
-        img_cnt = 1;
-    else
-        img_cnt = 0;
-
-    jpeg_decode_picture_info_t image_info;
-
-    const char *image_name = file_iterator_get_name_from_index(ft,index);
-    ESP_LOGI(TAG,"image name = %s",image_name);
-
-    static char image_path[256];
-    file_iterator_get_full_path_from_index(ft,index,image_path,256);
-    ESP_LOGI(TAG,"index = %d",index);
-    ESP_LOGI(TAG,"image path = %s",image_path);
-
-    FILE *image_fp = fopen(image_path,"rb");
-    if(image_fp == NULL)
-    {
-        ESP_LOGE(TAG,"fopen file failed");
+    if (scaled_len <= out_len) {
+        return -(int32_t)(out_len - scaled_len) / 2;
+    }
+
+    int32_t origin = std::clamp<int32_t>(lroundf(*center * factor) - out_len / 2, 0, scaled_len - out_len);
+    // Keep the center of the clamped view, so a pan past the edge doesn't have to be undone first
+    *center = (origin + out_len / 2.0f) / factor;
+
+    return origin;
+}
+
+static void zoom_get_view(image_tiles_view_t *view)
+{
+    image_region_scale_from(zoom_factor, &view->scale);
+    float factor = (float)view->scale.num / (IMAGE_REGION_SCALE_STEP << view->scale.shift);
+
+    view->x = zoom_origin(&zoom_center_x, factor, image_region_scaled(image_shown_frame.src_width, &view->scale),
+                          APP_IMAGE_FIT_WIDTH);
+    view->y = zoom_origin(&zoom_center_y, factor, image_region_scaled(image_shown_frame.src_height, &view->scale),
+                          APP_IMAGE_FIT_HEIGHT);
+}
+
+static void zoom_render(void)
+{
+    image_tiles_view_t view;
+
+    zoom_get_view(&view);
+    image_tiles_render(&view, &image_shown_frame, zoom_buf, zoom_buf_size, APP_IMAGE_FIT_WIDTH, APP_IMAGE_FIT_HEIGHT);
+    lv_obj_invalidate(app_image_mian);
+    zoom_dirty = false;
+}
+
+// Starts from the whole image, as it was shown
+static bool zoom_start(void)
+{
+    if (!zoom_supported || (image_shown < 0) || (image_shown_frame.buf == NULL) || (image_shown_frame.src_width == 0)) {
+        return false;
+    }
+
+    // Aligned to the cache line, the PPA writes it by DMA
+    zoom_buf = (uint8_t *)media_arena_lend(APP_IMAGE_FIT_WIDTH * APP_IMAGE_FIT_HEIGHT * 2, &zoom_buf_size);
+    if (zoom_buf == NULL) {
+        ESP_LOGE(TAG, "Allocate zoom buffer failed");
+        return false;
+    }
+    zoom_factor = zoom_min_factor();
+    zoom_center_x = image_shown_frame.src_width / 2.0f;
+    zoom_center_y = image_shown_frame.src_height / 2.0f;
+    zoom_active = true;
+    __atomic_store_n(&zoom_tiles_ready, false, __ATOMIC_RELAXED);
+    // The tiles of the image get decoded in the background, the first view is its frame scaled up
+    image_tiles_set_image(zoom_images, image_shown);
+    zoom_render();
+
+    lv_canvas_set_buffer(app_image_mian, zoom_buf, APP_IMAGE_FIT_WIDTH, APP_IMAGE_FIT_HEIGHT, LV_IMG_CF_TRUE_COLOR);
+    lv_obj_set_size(app_image_mian, APP_IMAGE_FIT_WIDTH, APP_IMAGE_FIT_HEIGHT);
+
+    return true;
+}
+
+static void zoom_stop(void)
+{
+    if (!zoom_active) {
+        return;
+    }
+
+    zoom_active = false;
+    pinch_active = false;
+    image_tiles_set_image(NULL, -1);
+    lv_canvas_set_buffer(app_image_mian, image_shown_frame.buf, image_shown_frame.width, image_shown_frame.height,
+                         LV_IMG_CF_TRUE_COLOR);
+    lv_obj_set_size(app_image_mian, image_shown_frame.width, image_shown_frame.height);
+    media_arena_return(zoom_buf);
+    zoom_buf = NULL;
+}
+
+static void zoom_pinch(const uint16_t *x, const uint16_t *y)
+{
+    lv_area_t coords;
+    float dx = (float)x[1] - x[0];
+    float dy = (float)y[1] - y[0];
+    float dist = sqrtf(dx * dx + dy * dy);
+
+    if (dist < APP_ZOOM_PINCH_DIST_MIN) {
         return;
     }
+    if (!zoom_active && !zoom_start()) {
+        return;
+    }
+
+    // Touch panel coordinates, the display isn't rotated
+    lv_obj_get_coords(app_image_mian, &coords);
+    float mid_x = (x[0] + x[1]) / 2.0f - coords.x1;
+    float mid_y = (y[0] + y[1]) / 2.0f - coords.y1;
+
+    if (!pinch_active) {
+        image_tiles_view_t view;
+
+        // The image point between the fingers stays between them while zooming
+        zoom_get_view(&view);
+        float factor = (float)view.scale.num / (IMAGE_REGION_SCALE_STEP << view.scale.shift);
+        pinch_active = true;
+        pinch_dist = dist;
+        pinch_factor = zoom_factor;
+        pinch_focus_x = (view.x + mid_x) / factor;
+        pinch_focus_y = (view.y + mid_y) / factor;
+        return;
+    }
+
+    float min_factor = zoom_min_factor();
+    zoom_factor = std::clamp(pinch_factor * dist / pinch_dist, min_factor, std::max<float>(APP_ZOOM_MAX, min_factor));
+    zoom_center_x = pinch_focus_x - (mid_x - APP_IMAGE_FIT_WIDTH / 2.0f) / zoom_factor;
+    zoom_center_y = pinch_focus_y - (mid_y - APP_IMAGE_FIT_HEIGHT / 2.0f) / zoom_factor;
+    zoom_dirty = true;
+}
+
+static void zoom_pan(void)
+{
+    lv_point_t vect;
+
+    lv_indev_get_vect(lv_indev_get_act(), &vect);
+    if ((vect.x == 0) && (vect.y == 0)) {
+        return;
+    }
+
+    // The image follows the finger
+    zoom_center_x -= vect.x / zoom_factor;
+    zoom_center_y -= vect.y / zoom_factor;
+    zoom_dirty = true;
+}
+
+static void thumb_task(void *arg)
+{
+    dir_index_handle_t images = (dir_index_handle_t)arg;
+    char path[256];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (thumb_exit) {
+            break;
+        }
+
+        uint32_t gen = __atomic_load_n(&thumb_gen, __ATOMIC_ACQUIRE);
+        int first = __atomic_load_n(&thumb_page, __ATOMIC_RELAXED) * APP_IMAGE_GRID_NUM;
+        // A page change restarts the loading, the slots of the old page are not shown anymore
+        for (int i = 0; (i < APP_IMAGE_GRID_NUM) && (first + i < image_count); i++) {
+            if (thumb_exit || (__atomic_load_n(&thumb_gen, __ATOMIC_ACQUIRE) != gen)) {
+                break;
+            }
+            if ((dir_index_get_path(images, first + i, path, sizeof(path)) != ESP_OK) ||
+                    (image_thumb_load(path, thumb_bufs[i]) != ESP_OK)) {
+                memset(thumb_bufs[i], 0, IMAGE_THUMB_BUF_SIZE);
+            }
+            if (__atomic_load_n(&thumb_gen, __ATOMIC_ACQUIRE) == gen) {
+                __atomic_store_n(&thumb_ready_gen[i], gen, __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    xSemaphoreGive(thumb_idle);
+    task_config_delete(TASK_CONFIG_IMAGE_THUMB, NULL);
+}
+
+esp_err_t AppImageDisplay::thumb_grid_start(void)
+{
+    for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+        thumb_bufs[i] = (uint8_t *)heap_caps_calloc(1, IMAGE_THUMB_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        if (thumb_bufs[i] == NULL) {
+            thumb_grid_stop();
+            return ESP_ERR_NO_MEM;
+        }
+        thumb_dscs[i].header.cf = LV_IMG_CF_TRUE_COLOR;
+        thumb_dscs[i].header.w = IMAGE_THUMB_SIZE;
+        thumb_dscs[i].header.h = IMAGE_THUMB_SIZE;
+        thumb_dscs[i].data_size = IMAGE_THUMB_BUF_SIZE;
+        thumb_dscs[i].data = thumb_bufs[i];
+        thumb_ready_gen[i] = 0;
+        thumb_shown[i] = false;
+    }
+    thumb_grid_open = false;
+    thumb_exit = false;
+    thumb_idle = xSemaphoreCreateBinary();
+    if ((thumb_idle == NULL) ||
+            (task_config_create(TASK_CONFIG_IMAGE_THUMB, thumb_task, _image_index, &thumb_task_handle) != pdPASS)) {
+        thumb_task_handle = NULL;
+        thumb_grid_stop();
+        return ESP_ERR_NO_MEM;
+    }
 
-    fseek(image_fp,0,SEEK_END);
-    int image_size_fp = ftell(image_fp);
-    fseek(image_fp,0,SEEK_SET);
+    return ESP_OK;
+}
 
-    size_t input_buffer_size_image = 0;
-    uint8_t *input_buf =  (uint8_t*)jpeg_alloc_decoder_mem(image_size_fp, &tx_mem_cfg, &input_buffer_size_image);
-    if(input_buf == NULL)
-    {
-        ESP_LOGE(TAG,"alloc input buf failed");
+void AppImageDisplay::thumb_grid_stop(void)
+{
+    if (thumb_task_handle) {
+        thumb_exit = true;
+        xTaskNotifyGive(thumb_task_handle);
+        xSemaphoreTake(thumb_idle, portMAX_DELAY);
+        thumb_task_handle = NULL;
+    }
+    if (thumb_idle) {
+        vSemaphoreDelete(thumb_idle);
+        thumb_idle = NULL;
+    }
+    for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+        if (thumb_bufs[i]) {
+            heap_caps_free(thumb_bufs[i]);
+            thumb_bufs[i] = NULL;
+        }
+    }
+    thumb_grid_open = false;
+}
+
+// Called from LVGL context
+static void thumb_grid_show_page(int page)
+{
+    for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+        lv_img_set_src(app_image_thumbs[i], NULL);
+        thumb_shown[i] = false;
+    }
+    __atomic_store_n(&thumb_page, page, __ATOMIC_RELAXED);
+    // No slot is drawn from here on, the thumbnail task may refill the buffers
+    __atomic_add_fetch(&thumb_gen, 1, __ATOMIC_RELEASE);
+    if (thumb_task_handle) {
+        xTaskNotifyGive(thumb_task_handle);
+    }
+}
+
+static void thumb_grid_set_open(bool open)
+{
+    thumb_grid_open = open;
+    if (open) {
+        lv_obj_clear_flag(app_image_grid, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_move_foreground(app_image_grid);
+        thumb_grid_show_page(count_now / APP_IMAGE_GRID_NUM);
+    } else {
+        lv_obj_add_flag(app_image_grid, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+void AppImageDisplay::thumb_click_cb(lv_event_t *e)
+{
+    lv_obj_t *target = lv_event_get_target(e);
+
+    for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+        int index = thumb_page * APP_IMAGE_GRID_NUM + i;
+        if ((app_image_thumbs[i] == target) && (index < image_count)) {
+            thumb_grid_set_open(false);
+            count_now = index;
+            image_change_display(count_now);
+            slideshow_restart();
+            break;
+        }
+    }
+}
+
+void AppImageDisplay::slide_timer_cb(void *arg)
+{
+    __atomic_store_n(&slide_due, true, __ATOMIC_RELEASE);
+}
+
+void AppImageDisplay::slideshow_restart(void)
+{
+    if (slide_timer == NULL) {
         return;
     }
-    fread(input_buf,1,input_buffer_size_image,image_fp);
-    fclose(image_fp);
-    ESP_ERROR_CHECK(jpeg_decoder_get_info(input_buf,input_buffer_size_image,&image_info));
-    ESP_LOGI(TAG,"image width = %d,image hight = %d",image_info.width,image_info.height);
+    esp_timer_stop(slide_timer);
+    __atomic_store_n(&slide_due, false, __ATOMIC_RELEASE);
+    esp_timer_start_periodic(slide_timer, (uint64_t)APP_SLIDESHOW_INTERVAL_MS * 1000);
+}
 
-   
-    if(output_buf[img_cnt] == NULL)
-    {
-        ESP_LOGE(TAG,"alloc output buf failed");
+void AppImageDisplay::slideshow_stop(void)
+{
+    if (slide_timer) {
+        esp_timer_stop(slide_timer);
+    }
+    __atomic_store_n(&slide_due, false, __ATOMIC_RELEASE);
+}
+
+void AppImageDisplay::image_ready_cb(int index, void *user_ctx)
+{
+    __atomic_store_n(&image_ready, true, __ATOMIC_RELEASE);
+}
+
+void AppImageDisplay::zoom_tiles_ready_cb(void *user_ctx)
+{
+    __atomic_store_n(&zoom_tiles_ready, true, __ATOMIC_RELEASE);
+}
+
+void AppImageDisplay::zoom_event_cb(lv_event_t *e)
+{
+    uint16_t x[TOUCH_POINTS_NUM];
+    uint16_t y[TOUCH_POINTS_NUM];
+
+    if (thumb_grid_open) {
         return;
     }
-    uint32_t out_size_image = 0;
-    
-    ESP_ERROR_CHECK(jpeg_decoder_process(jpgd_handle, &decode_cfg_rgb, input_buf, input_buffer_size_image, output_buf[img_cnt], output_buf_size[img_cnt], &out_size_image));
-
-    bsp_display_lock(0);
-    // lv_img_dsc_t img_dsc = {
-    //     .header ={
-    //         .cf = LV_IMG_CF_TRUE_COLOR,
-    //         .always_zero = 0,
-    //         .reserved = 0,
-    //         .w = image_info.width,
-    //         .h = image_info.height,
-    //     },
-    //     .data_size = out_size_image,
-    //     .data = output_buf,
-    // };
-
-    // lv_img_set_src(app_image_mian,&img_dsc);
-    
-    lv_canvas_set_buffer(app_image_mian, output_buf[img_cnt], image_info.width, image_info.height, LV_IMG_CF_TRUE_COLOR);
-    // lv_refr_now(NULL);
-    bsp_display_unlock();
-
-    free(input_buf);
-    // free(output_buf);
-    ESP_ERROR_CHECK(jpeg_del_decoder_engine(jpgd_handle));
 
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_PRESSED:
+        pinch_active = false;
+        break;
+    case LV_EVENT_PRESSING:
+        if (touch_points_get(x, y) >= 2) {
+            bool was_active = zoom_active;
+
+            zoom_pinch(x, y);
+            if (!was_active && zoom_active) {
+                slideshow_stop();
+            }
+        } else if (zoom_active && !pinch_active) {
+            // The fingers of a pinch never lift together, don't pan with the one left
+            zoom_pan();
+        }
+        break;
+    case LV_EVENT_RELEASED:
+    case LV_EVENT_PRESS_LOST:
+        pinch_active = false;
+        if (zoom_active && (zoom_factor <= zoom_min_factor() * APP_ZOOM_EXIT_RATIO)) {
+            zoom_stop();
+            slideshow_restart();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void AppImageDisplay::image_show_timer_cb(lv_timer_t *timer)
+{
+    if (__atomic_exchange_n(&image_ready, false, __ATOMIC_ACQUIRE) && (image_pending >= 0)) {
+        image_change_display(image_pending);
+    }
+
+    // The next image was prefetched when the current one was shown, the switch does not wait for the storage
+    if (__atomic_exchange_n(&slide_due, false, __ATOMIC_ACQUIRE) && !thumb_grid_open && (image_count > 0)) {
+        count_now = (count_now + 1) % image_count;
+        slide_fade = true;
+        image_change_display(count_now);
+    }
+
+    // Drawn at the pace of the timer, not of the touch events
+    if (zoom_active && (zoom_dirty || __atomic_exchange_n(&zoom_tiles_ready, false, __ATOMIC_ACQUIRE))) {
+        zoom_render();
+    }
+
+    if (thumb_grid_open) {
+        uint32_t gen = __atomic_load_n(&thumb_gen, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+            if (!thumb_shown[i] && (__atomic_load_n(&thumb_ready_gen[i], __ATOMIC_ACQUIRE) == gen)) {
+                // The descriptor is reused for every page, LVGL must not keep the previous content
+                lv_img_cache_invalidate_src(&thumb_dscs[i]);
+                lv_img_set_src(app_image_thumbs[i], &thumb_dscs[i]);
+                thumb_shown[i] = true;
+            }
+        }
+    }
 }
 
 void AppImageDisplay::image_change_cb(lv_event_t *e)
 {
     AppImageDisplay *img_dis = (AppImageDisplay *)e ->user_data;
     lv_event_code_t event = lv_event_get_code(e);
+    // A zoomed image is panned, not swiped away
+    if (zoom_active || pinch_active) {
+        return;
+    }
     if(event == LV_EVENT_GESTURE) {
         lv_indev_wait_release(lv_indev_get_act());
         lv_dir_t dir = lv_indev_get_gesture_dir(lv_indev_get_act());
+        if (thumb_grid_open) {
+            int page_num = (image_count + APP_IMAGE_GRID_NUM - 1) / APP_IMAGE_GRID_NUM;
+            if ((dir == LV_DIR_LEFT) && (thumb_page + 1 < page_num)) {
+                thumb_grid_show_page(thumb_page + 1);
+            } else if ((dir == LV_DIR_RIGHT) && (thumb_page > 0)) {
+                thumb_grid_show_page(thumb_page - 1);
+            } else if (dir == LV_DIR_TOP) {
+                thumb_grid_set_open(false);
+                slideshow_restart();
+            }
+            return;
+        }
+        if (dir == LV_DIR_BOTTOM) {
+            // Swiping down opens the thumbnails around the current image
+            if (thumb_task_handle) {
+                slideshow_stop();
+                thumb_grid_set_open(true);
+            }
+            return;
+        }
         switch(dir){
         case LV_DIR_LEFT:
         count_now ++;
@@ -248,39 +685,8 @@ void AppImageDisplay::image_change_cb(lv_event_t *e)
         printf("to right\n");
             break;
         }
-        image_change_display(img_dis ->_image_file_iterator,count_now);
+        image_change_display(count_now);
+        // A swiped image gets a full interval
+        slideshow_restart();
     }
 }
-
-void AppImageDisplay::image_delay_change(AppImageDisplay *app)
-{
-    xEventGroupWaitBits(image_event_group, IMAGE_EVENT_TASK_RUN, pdFALSE, pdTRUE, portMAX_DELAY);
-
-    while (1)
-    {
-        if(xEventGroupGetBits(image_event_group) & IMAGE_EVENT_DIR)
-        {
-            xEventGroupClearBits(image_event_group,IMAGE_EVENT_DIR);
-            vTaskDelay(pdMS_TO_TICKS(2000));
-        }
-        count_now ++;
-        if(count_now > image_count-1)
-            count_now = 0;
-        
-        image_change_display(app ->_image_file_iterator,count_now);
-        
-        vTaskDelay(pdMS_TO_TICKS(5000));
-        if (xEventGroupGetBits(image_event_group) & IMAGE_EVENT_DELETE) {
-
-            ESP_LOGI(TAG, "Image Display detect task exit");
-            break;
-        }
-        xEventGroupWaitBits(image_event_group, IMAGE_EVENT_TASK_RUN, pdFALSE, pdTRUE, portMAX_DELAY);
-        
-    }
-    ESP_LOGI(TAG, "Image Display detect task exit");
-
-    vTaskDelete(NULL);
-}
-
-
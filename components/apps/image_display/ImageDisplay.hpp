@@ -3,17 +3,26 @@
 #include <vector>
 #include "lvgl.h"
 #include "esp_brookesia.hpp"
-#include "file_iterator.h"
+#include "dir_index/dir_index.h"
 
 class AppImageDisplay: public ESP_Brookesia_PhoneApp
 {
 private:
 
     static void image_change_cb(lv_event_t *e);
-    static void image_delay_change(AppImageDisplay *app);
+    static void slide_timer_cb(void *arg);
+    static void slideshow_restart(void);
+    static void slideshow_stop(void);
+    static void image_ready_cb(int index, void *user_ctx);
+    static void image_show_timer_cb(lv_timer_t *timer);
+    static void zoom_tiles_ready_cb(void *user_ctx);
+    static void zoom_event_cb(lv_event_t *e);
+    static void thumb_click_cb(lv_event_t *e);
+    esp_err_t thumb_grid_start(void);
+    static void thumb_grid_stop(void);
     char _image_path[256];
     const char *_image_name;
-    file_iterator_instance_t *_image_file_iterator;
+    dir_index_handle_t _image_index;
 
 public:
     AppImageDisplay(/* args */);
@@ -6,6 +6,8 @@ lv_obj_t *app_image_screen;
 lv_obj_t *app_image_screen1;
 lv_obj_t *app_image_mian;
 lv_timer_t *app_image_timer;
+lv_obj_t *app_image_grid;
+lv_obj_t *app_image_thumbs[APP_IMAGE_GRID_NUM];
 
 
 void app_image_display_init(void)
@@ -14,7 +16,7 @@ void app_image_display_init(void)
     lv_obj_set_size(app_image_screen,480,800);
     lv_obj_clear_flag( app_image_screen, LV_OBJ_FLAG_SCROLLABLE );    /// Flags
     lv_obj_set_flex_flow(app_image_screen,LV_FLEX_FLOW_COLUMN);
-    lv_obj_set_flex_align(app_image_screen, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_flex_align(app_image_screen, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
     lv_obj_set_style_bg_color(app_image_screen, lv_color_hex(0x000000), LV_PART_MAIN | LV_STATE_DEFAULT );
     lv_obj_set_style_bg_opa(app_image_screen, 255, LV_PART_MAIN| LV_STATE_DEFAULT);
     lv_obj_set_style_pad_left(app_image_screen, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
@@ -33,3 +35,26 @@ void app_image_display_init(void)
     lv_scr_load(app_image_screen);
 }
 
+void app_image_display_grid_init(lv_coord_t thumb_size, lv_event_cb_t thumb_click_cb, void *user_data)
+{
+    app_image_grid = lv_obj_create(app_image_screen);
+    lv_obj_set_size(app_image_grid,480,800);
+    lv_obj_add_flag( app_image_grid, LV_OBJ_FLAG_FLOATING | LV_OBJ_FLAG_HIDDEN );   /// Flags
+    lv_obj_clear_flag( app_image_grid, LV_OBJ_FLAG_SCROLLABLE );    /// Flags
+    lv_obj_set_flex_flow(app_image_grid,LV_FLEX_FLOW_ROW_WRAP);
+    lv_obj_set_flex_align(app_image_grid, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
+    lv_obj_set_style_bg_color(app_image_grid, lv_color_hex(0x000000), LV_PART_MAIN | LV_STATE_DEFAULT );
+    lv_obj_set_style_bg_opa(app_image_grid, 255, LV_PART_MAIN| LV_STATE_DEFAULT);
+    lv_obj_set_style_border_width(app_image_grid, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
+    lv_obj_set_style_radius(app_image_grid, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
+    lv_obj_set_style_pad_all(app_image_grid, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
+    lv_obj_set_style_pad_row(app_image_grid, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
+    lv_obj_set_style_pad_column(app_image_grid, 0, LV_PART_MAIN| LV_STATE_DEFAULT);
+
+    for (int i = 0; i < APP_IMAGE_GRID_NUM; i++) {
+        app_image_thumbs[i] = lv_img_create(app_image_grid);
+        lv_obj_set_size(app_image_thumbs[i], thumb_size, thumb_size);
+        lv_obj_add_flag( app_image_thumbs[i], LV_OBJ_FLAG_CLICKABLE );   /// Flags
+        lv_obj_add_event_cb(app_image_thumbs[i], thumb_click_cb, LV_EVENT_CLICKED, user_data);
+    }
+}
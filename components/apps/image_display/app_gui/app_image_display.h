@@ -2,20 +2,26 @@
 #define __APP_IAMGE_DISPLAY_H
 
 #include "lvgl.h"
-#include "file_iterator.h"
 
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define APP_IMAGE_GRID_COLS     (4)
+#define APP_IMAGE_GRID_ROWS     (6)
+#define APP_IMAGE_GRID_NUM      (APP_IMAGE_GRID_COLS * APP_IMAGE_GRID_ROWS)
+
 extern lv_obj_t *app_image_screen;
 extern lv_obj_t *app_image_screen1;
 extern lv_obj_t *app_image_mian;
 extern lv_timer_t *app_image_timer;
+extern lv_obj_t *app_image_grid;
+extern lv_obj_t *app_image_thumbs[APP_IMAGE_GRID_NUM];
 
 
 void app_image_display_init(void);
+void app_image_display_grid_init(lv_coord_t thumb_size, lv_event_cb_t thumb_click_cb, void *user_data);
 void app_image_display_pause(void);
 void app_image_display_resume(void);
 void app_image_display_close(void);
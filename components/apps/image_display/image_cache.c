@@ -0,0 +1,316 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "task_config/task_config.h"
+#include "image_cache.h"
+
+#define CACHE_ENTRY_NUM             (8)
+#define CACHE_WANTED_NUM            (3)
+#define CACHE_PATH_MAX              (256)
+
+typedef struct {
+    bool                used;       /*!< Slot holds an image */
+    bool                failed;     /*!< Decoding failed, kept so it is not retried on every focus change */
+    int                 index;      /*!< File index of the image */
+    image_frame_t       frame;      /*!< Decoded image, `buf` is NULL for a failed one */
+    size_t              buf_size;   /*!< Bytes charged to the budget */
+    uint8_t             pins;       /*!< Number of `image_cache_acquire` not released yet */
+    uint32_t            last_use;   /*!< Tick of the last insertion or acquisition */
+} cache_entry_t;
+
+static const char *TAG = "image_cache";
+
+static dir_index_handle_t cache_images = NULL;
+static int cache_count = 0;
+static size_t cache_budget = 0;
+static size_t cache_used = 0;
+static uint32_t cache_fit_width = 0;
+static uint32_t cache_fit_height = 0;
+static image_cache_ready_cb_t cache_ready_cb = NULL;
+static void *cache_ready_ctx = NULL;
+static cache_entry_t cache_entries[CACHE_ENTRY_NUM];
+static uint32_t cache_tick = 0;
+static int cache_focus = -1;
+static bool cache_exit = false;
+static TaskHandle_t cache_task_handle = NULL;
+static SemaphoreHandle_t cache_lock = NULL;     /* Guards the entries and the focus */
+static SemaphoreHandle_t cache_idle = NULL;     /* Given by the task when it exits */
+
+static cache_entry_t *cache_find(int index)
+{
+    for (int i = 0; i < CACHE_ENTRY_NUM; i++) {
+        if (cache_entries[i].used && (cache_entries[i].index == index)) {
+            return &cache_entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void cache_drop(cache_entry_t *entry)
+{
+    jpeg_dec_service_buf_put(entry->frame.buf);
+    cache_used -= entry->buf_size;
+    memset(entry, 0, sizeof(cache_entry_t));
+}
+
+static void cache_get_wanted(int focus, int *wanted)
+{
+    wanted[0] = focus;
+    wanted[1] = (focus + 1) % cache_count;
+    wanted[2] = (focus + cache_count - 1) % cache_count;
+}
+
+static bool cache_is_wanted(int index, const int *wanted)
+{
+    for (int i = 0; i < CACHE_WANTED_NUM; i++) {
+        if (wanted[i] == index) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Must be called with `cache_lock` held, returns a free slot once `size` fits in the budget */
+static cache_entry_t *cache_reserve(size_t size, const int *wanted)
+{
+    while (1) {
+        cache_entry_t *empty = NULL;
+        cache_entry_t *victim = NULL;
+
+        for (int i = 0; i < CACHE_ENTRY_NUM; i++) {
+            cache_entry_t *entry = &cache_entries[i];
+            if (!entry->used) {
+                empty = empty ? empty : entry;
+            } else if ((entry->pins == 0) && !cache_is_wanted(entry->index, wanted) &&
+                       ((victim == NULL) || (entry->last_use < victim->last_use))) {
+                victim = entry;
+            }
+        }
+        if (empty && (cache_used + size <= cache_budget)) {
+            return empty;
+        }
+        if (victim == NULL) {
+            return NULL;
+        }
+        ESP_LOGD(TAG, "Evict image %d", victim->index);
+        cache_drop(victim);
+    }
+}
+
+static esp_err_t cache_decode(int index, const int *wanted)
+{
+    char path[CACHE_PATH_MAX];
+    image_frame_t frame = {0};
+    size_t buf_size = 0;
+    cache_entry_t *entry = NULL;
+
+    /* An unreadable name is cached as a failed image */
+    esp_err_t ret = dir_index_get_path(cache_images, index, path, sizeof(path));
+    if (ret == ESP_OK) {
+        ret = image_decode_file(path, cache_fit_width, cache_fit_height, &frame, &buf_size);
+    }
+    if (ret == ESP_ERR_NO_MEM) {
+        /* Retried on the next focus change, memory may be back by then */
+        return ret;
+    }
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    entry = cache_reserve((ret == ESP_OK) ? buf_size : 0, wanted);
+    if (entry == NULL) {
+        /* Every frame in the budget is pinned or wanted */
+        xSemaphoreGive(cache_lock);
+        jpeg_dec_service_buf_put(frame.buf);
+        ESP_LOGW(TAG, "No room for image %d", index);
+        return ESP_ERR_NO_MEM;
+    }
+    entry->used = true;
+    entry->index = index;
+    entry->last_use = ++cache_tick;
+    if (ret == ESP_OK) {
+        entry->frame = frame;
+        entry->buf_size = buf_size;
+        cache_used += buf_size;
+    } else {
+        entry->failed = true;
+    }
+    xSemaphoreGive(cache_lock);
+
+    return ret;
+}
+
+/* Returns the first wanted image that is not cached yet, -1 if there is none */
+static int cache_next_missing(int *wanted)
+{
+    int index = -1;
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    if (cache_focus >= 0) {
+        cache_get_wanted(cache_focus, wanted);
+        for (int i = 0; i < CACHE_WANTED_NUM; i++) {
+            if (cache_find(wanted[i]) == NULL) {
+                index = wanted[i];
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(cache_lock);
+
+    return index;
+}
+
+static void cache_task(void *arg)
+{
+    int wanted[CACHE_WANTED_NUM];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* The focus is read again after each decode, a swipe during a decode is served next */
+        int index = -1;
+        while (!cache_exit && ((index = cache_next_missing(wanted)) >= 0)) {
+            if (cache_decode(index, wanted) == ESP_ERR_NO_MEM) {
+                break;
+            }
+            if (cache_ready_cb) {
+                cache_ready_cb(index, cache_ready_ctx);
+            }
+        }
+        if (cache_exit) {
+            break;
+        }
+    }
+
+    xSemaphoreGive(cache_idle);
+    task_config_delete(TASK_CONFIG_IMAGE_CACHE, NULL);
+}
+
+esp_err_t image_cache_init(dir_index_handle_t images, size_t budget, uint32_t fit_width, uint32_t fit_height,
+                           image_cache_ready_cb_t ready_cb, void *user_ctx)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(images && budget && fit_width && fit_height, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(cache_task_handle == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    cache_images = images;
+    cache_count = dir_index_get_count(images);
+    cache_budget = budget;
+    cache_used = 0;
+    cache_fit_width = fit_width;
+    cache_fit_height = fit_height;
+    cache_ready_cb = ready_cb;
+    cache_ready_ctx = user_ctx;
+    cache_tick = 0;
+    cache_focus = -1;
+    cache_exit = false;
+    memset(cache_entries, 0, sizeof(cache_entries));
+
+    cache_lock = xSemaphoreCreateMutex();
+    cache_idle = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(cache_lock && cache_idle, ESP_ERR_NO_MEM, err, TAG, "Create lock failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_IMAGE_CACHE, cache_task, NULL, &cache_task_handle) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+
+    return ESP_OK;
+
+err:
+    if (cache_idle) {
+        vSemaphoreDelete(cache_idle);
+        cache_idle = NULL;
+    }
+    if (cache_lock) {
+        vSemaphoreDelete(cache_lock);
+        cache_lock = NULL;
+    }
+    cache_task_handle = NULL;
+
+    return ret;
+}
+
+void image_cache_deinit(void)
+{
+    if (cache_task_handle == NULL) {
+        return;
+    }
+
+    cache_exit = true;
+    xTaskNotifyGive(cache_task_handle);
+    xSemaphoreTake(cache_idle, portMAX_DELAY);
+    cache_task_handle = NULL;
+
+    for (int i = 0; i < CACHE_ENTRY_NUM; i++) {
+        if (cache_entries[i].used) {
+            cache_drop(&cache_entries[i]);
+        }
+    }
+    vSemaphoreDelete(cache_idle);
+    cache_idle = NULL;
+    vSemaphoreDelete(cache_lock);
+    cache_lock = NULL;
+    cache_images = NULL;
+}
+
+void image_cache_set_focus(int index)
+{
+    if ((cache_task_handle == NULL) || (index < 0) || (index >= cache_count)) {
+        return;
+    }
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    cache_focus = index;
+    xSemaphoreGive(cache_lock);
+    xTaskNotifyGive(cache_task_handle);
+}
+
+esp_err_t image_cache_acquire(int index, image_frame_t *frame)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(frame, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    if (cache_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    cache_entry_t *entry = cache_find(index);
+    if (entry == NULL) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else if (entry->failed) {
+        ret = ESP_FAIL;
+    } else {
+        entry->pins++;
+        entry->last_use = ++cache_tick;
+        *frame = entry->frame;
+    }
+    xSemaphoreGive(cache_lock);
+
+    return ret;
+}
+
+void image_cache_release(int index)
+{
+    if (cache_task_handle == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    cache_entry_t *entry = cache_find(index);
+    if (entry && (entry->pins > 0)) {
+        entry->pins--;
+    }
+    xSemaphoreGive(cache_lock);
+}
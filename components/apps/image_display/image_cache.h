@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "dir_index/dir_index.h"
+#include "image_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called from the cache task each time an image has been decoded
+ *
+ * @param index     File index of the image
+ * @param user_ctx  Context given to `image_cache_init`
+ */
+typedef void (*image_cache_ready_cb_t)(int index, void *user_ctx);
+
+/**
+ * @brief Start the cache and its prefetch task
+ *
+ * The shared JPEG decoder must be acquired and `image_decode_init` called by the caller for the lifetime of the
+ * cache.
+ *
+ * @param images        Images to decode, indexed in listing order
+ * @param budget        Bytes of decoded frames kept at most
+ * @param fit_width     Larger images are scaled down to this width
+ * @param fit_height    Larger images are scaled down to this height
+ * @param ready_cb      Decode notification, can be NULL
+ * @param user_ctx      Context passed to `ready_cb`
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Already started
+ *      - ESP_ERR_NO_MEM         Failed to create the task
+ */
+esp_err_t image_cache_init(dir_index_handle_t images, size_t budget, uint32_t fit_width, uint32_t fit_height,
+                           image_cache_ready_cb_t ready_cb, void *user_ctx);
+
+/**
+ * @brief Stop the prefetch task and free the decoded frames
+ *
+ * Frames still acquired are freed as well, the caller must not use them anymore.
+ */
+void image_cache_deinit(void);
+
+/**
+ * @brief Set the image shown now
+ *
+ * The task decodes it first if needed, then its next and previous neighbours. Frames of other images are kept
+ * until the budget runs out.
+ *
+ * @param index File index of the image
+ */
+void image_cache_set_focus(int index);
+
+/**
+ * @brief Get a decoded image without blocking
+ *
+ * The frame is pinned, it is not evicted until `image_cache_release` is called for the same index.
+ *
+ * @param index File index of the image
+ * @param frame Decoded image
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NOT_FOUND      Not decoded yet
+ *      - ESP_ERR_INVALID_STATE  Cache not started
+ */
+esp_err_t image_cache_acquire(int index, image_frame_t *frame);
+
+/**
+ * @brief Unpin an image got with `image_cache_acquire`
+ */
+void image_cache_release(int index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,402 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_cache.h"
+#include "driver/ppa.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "sd_io/sd_io.h"
+#include "image_png.h"
+#include "image_region.h"
+#include "image_exif.h"
+#include "image_decode.h"
+
+#define ALIGN_UP(num, align)        (((num) + ((align) - 1)) & ~((align) - 1))
+
+/* The full size frame is decoded before scaling, larger images would not fit in PSRAM next to the rest and are
+ * decoded in regions */
+#define DECODE_MAX_PIXELS           (8 * 1024 * 1024)
+/* PPA scaling factors have a 1/16 precision */
+#define DECODE_SCALE_STEP           (16)
+
+static const jpeg_decode_cfg_t decode_cfg = {
+    .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
+    .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+};
+
+static const char *TAG = "image_decode";
+
+static ppa_client_handle_t decode_ppa = NULL;
+
+static esp_err_t decode_read_file(const char *path, uint8_t **buf, uint32_t *size)
+{
+    esp_err_t ret = ESP_OK;
+    long file_size = 0;
+    struct stat st;
+    // Read in one go from the card into the aligned decoder buffer, without going through stdio
+    int fd = sd_io_open(path);
+
+    ESP_RETURN_ON_FALSE(fd >= 0, ESP_FAIL, TAG, "Open %s failed", path);
+    file_size = (fstat(fd, &st) == 0) ? st.st_size : 0;
+    ESP_GOTO_ON_FALSE(file_size > 0, ESP_FAIL, end, TAG, "Empty file %s", path);
+
+    *buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_INPUT_BUFFER, file_size, NULL);
+    ESP_GOTO_ON_FALSE(*buf, ESP_ERR_NO_MEM, end, TAG, "Allocate input buffer failed");
+    if (sd_io_read(fd, *buf, file_size) != file_size) {
+        ESP_LOGE(TAG, "Read %s failed", path);
+        jpeg_dec_service_buf_put(*buf);
+        *buf = NULL;
+        ret = ESP_FAIL;
+    }
+    *size = file_size;
+
+end:
+    close(fd);
+
+    return ret;
+}
+
+esp_err_t image_decode_init(void)
+{
+    ppa_client_config_t srm_config = {
+        .oper_type = PPA_OPERATION_SRM,
+    };
+
+    if (decode_ppa) {
+        return ESP_OK;
+    }
+
+    return ppa_register_client(&srm_config, &decode_ppa);
+}
+
+void image_decode_deinit(void)
+{
+    if (decode_ppa) {
+        ppa_unregister_client(decode_ppa);
+        decode_ppa = NULL;
+    }
+}
+
+/* Rotation of the PPA is counter-clockwise, its mirror applies after the rotation */
+static void decode_orient(image_orientation_t orientation, ppa_srm_oper_config_t *srm_config)
+{
+    switch (orientation) {
+    case IMAGE_ORIENTATION_MIRROR_H:
+        srm_config->mirror_x = true;
+        break;
+    case IMAGE_ORIENTATION_ROTATE_180:
+        srm_config->rotation_angle = PPA_SRM_ROTATION_ANGLE_180;
+        break;
+    case IMAGE_ORIENTATION_MIRROR_V:
+        srm_config->mirror_y = true;
+        break;
+    case IMAGE_ORIENTATION_TRANSPOSE:
+        srm_config->rotation_angle = PPA_SRM_ROTATION_ANGLE_270;
+        srm_config->mirror_x = true;
+        break;
+    case IMAGE_ORIENTATION_ROTATE_90:
+        srm_config->rotation_angle = PPA_SRM_ROTATION_ANGLE_270;
+        break;
+    case IMAGE_ORIENTATION_TRANSVERSE:
+        srm_config->rotation_angle = PPA_SRM_ROTATION_ANGLE_90;
+        srm_config->mirror_x = true;
+        break;
+    case IMAGE_ORIENTATION_ROTATE_270:
+        srm_config->rotation_angle = PPA_SRM_ROTATION_ANGLE_90;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Takes over `dec_buf`, the frame is repacked, scaled or turned upright by the PPA when it does not fit as is */
+static esp_err_t decode_fit(uint8_t *dec_buf, size_t dec_buf_size, uint32_t pic_w, uint32_t pic_h, uint32_t width,
+                            uint32_t height, image_orientation_t orientation, uint32_t max_width,
+                            uint32_t max_height, image_frame_t *frame, size_t *buf_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *out_buf = NULL;
+    size_t out_buf_size = 0;
+    bool swap = image_orientation_swaps(orientation);
+
+    /* Sizes of the frame are the upright ones, the box is turned to the stored image instead */
+    frame->src_width = swap ? height : width;
+    frame->src_height = swap ? width : height;
+    if (swap) {
+        uint32_t tmp = max_width;
+        max_width = max_height;
+        max_height = tmp;
+    }
+    if ((width <= max_width) && (height <= max_height) && (pic_w == width) &&
+            (orientation == IMAGE_ORIENTATION_NORMAL)) {
+        frame->buf = dec_buf;
+        frame->width = width;
+        frame->height = height;
+        if (buf_size) {
+            *buf_size = dec_buf_size;
+        }
+        return ESP_OK;
+    }
+
+    /* Largest scale that fits the box, never enlarged */
+    float scale = MIN(1.0f, MIN((float)max_width / width, (float)max_height / height));
+    scale = (float)((int)(scale * DECODE_SCALE_STEP)) / DECODE_SCALE_STEP;
+    ESP_GOTO_ON_FALSE(scale > 0, ESP_ERR_NOT_SUPPORTED, end, TAG, "Image too large to scale");
+
+    uint32_t out_w = (uint32_t)(width * scale);
+    uint32_t out_h = (uint32_t)(height * scale);
+    out_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, out_w * out_h * 2, &out_buf_size);
+    ESP_GOTO_ON_FALSE(out_buf, ESP_ERR_NO_MEM, end, TAG, "Allocate scaled buffer failed");
+
+    ppa_srm_oper_config_t srm_config = {
+        .in = {
+            .buffer = dec_buf,
+            .pic_w = pic_w,
+            .pic_h = pic_h,
+            .block_w = width,
+            .block_h = height,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .out = {
+            .buffer = out_buf,
+            .buffer_size = out_buf_size,
+            .pic_w = swap ? out_h : out_w,
+            .pic_h = swap ? out_w : out_h,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = scale,
+        .scale_y = scale,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    /* Turned upright in the same pass, the CPU never touches the pixels */
+    decode_orient(orientation, &srm_config);
+    ESP_GOTO_ON_ERROR(ppa_do_scale_rotate_mirror(decode_ppa, &srm_config), end, TAG, "Scale failed");
+    ESP_LOGD(TAG, "Scaled from %lux%lu to %lux%lu, orientation %d", (unsigned long)width, (unsigned long)height,
+             (unsigned long)out_w, (unsigned long)out_h, orientation);
+
+    frame->buf = out_buf;
+    frame->width = srm_config.out.pic_w;
+    frame->height = srm_config.out.pic_h;
+    if (buf_size) {
+        *buf_size = out_buf_size;
+    }
+    out_buf = NULL;
+
+end:
+    jpeg_dec_service_buf_put(out_buf);
+    jpeg_dec_service_buf_put(dec_buf);
+    if (dec_buf_size > max_width * max_height * 2) {
+        /* The full size frame is not worth keeping in the pool */
+        jpeg_dec_service_buf_trim();
+    }
+
+    return ret;
+}
+
+/* The hardware decoder only handles baseline JPEGs */
+static bool decode_jpeg_is_progressive(const uint8_t *buf, uint32_t len)
+{
+    uint32_t pos = 2;
+
+    while (pos + 4 <= len) {
+        if (buf[pos] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = buf[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if ((marker == 0xC2) || (marker == 0xC6) || (marker == 0xCA) || (marker == 0xCE)) {
+            return true;
+        }
+        if ((marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC)) {
+            return false;
+        }
+        pos += 2 + ((buf[pos + 2] << 8) | buf[pos + 3]);
+    }
+
+    return false;
+}
+
+/* Decoded straight at the fitting size, strip after strip, then turned upright by another pass when needed */
+static esp_err_t decode_jpeg_region(const char *path, uint32_t max_width, uint32_t max_height, image_frame_t *frame,
+                                    size_t *buf_size)
+{
+    esp_err_t ret = ESP_OK;
+    image_region_handle_t region = NULL;
+    image_region_scale_t scale;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t *out_buf = NULL;
+    size_t out_buf_size = 0;
+
+    ESP_RETURN_ON_ERROR(image_region_open(path, &region), TAG, "%s is above the decode limit", path);
+    image_region_get_size(region, &width, &height);
+    image_orientation_t orientation = image_region_get_orientation(region);
+    bool swap = image_orientation_swaps(orientation);
+    uint32_t box_w = swap ? max_height : max_width;
+    uint32_t box_h = swap ? max_width : max_height;
+    image_region_scale_from(MIN(1.0f, MIN((float)box_w / width, (float)box_h / height)), &scale);
+
+    uint32_t out_w = image_region_scaled(width, &scale);
+    uint32_t out_h = image_region_scaled(height, &scale);
+    ESP_GOTO_ON_FALSE(out_w && out_h, ESP_ERR_NOT_SUPPORTED, end, TAG, "Image too large to scale");
+    out_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, out_w * out_h * 2, &out_buf_size);
+    ESP_GOTO_ON_FALSE(out_buf, ESP_ERR_NO_MEM, end, TAG, "Allocate scaled buffer failed");
+
+    image_region_rect_t rect = {
+        .w = width,
+        .h = height,
+    };
+    ESP_GOTO_ON_ERROR(image_region_decode(region, decode_ppa, &rect, &scale, out_buf, out_buf_size, out_w, out_h, 0,
+                                          0), end, TAG, "Decode %s failed", path);
+    ESP_LOGD(TAG, "Decoded %lux%lu in regions to %lux%lu", (unsigned long)width, (unsigned long)height,
+             (unsigned long)out_w, (unsigned long)out_h);
+
+    if (orientation != IMAGE_ORIENTATION_NORMAL) {
+        /* Already fits, only turned */
+        ret = decode_fit(out_buf, out_buf_size, out_w, out_h, out_w, out_h, orientation, max_width, max_height,
+                         frame, buf_size);
+        out_buf = NULL;
+        ESP_GOTO_ON_ERROR(ret, end, TAG, "Turn %s upright failed", path);
+    } else {
+        frame->buf = out_buf;
+        frame->width = out_w;
+        frame->height = out_h;
+        if (buf_size) {
+            *buf_size = out_buf_size;
+        }
+        out_buf = NULL;
+    }
+    frame->src_width = swap ? height : width;
+    frame->src_height = swap ? width : height;
+
+end:
+    jpeg_dec_service_buf_put(out_buf);
+    image_region_close(region);
+    /* The strip buffers are not worth keeping in the pool */
+    jpeg_dec_service_buf_trim();
+
+    return ret;
+}
+
+static esp_err_t decode_jpeg(const char *path, uint32_t max_width, uint32_t max_height, image_frame_t *frame,
+                             size_t *buf_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *in_buf = NULL;
+    uint32_t in_size = 0;
+    uint8_t *dec_buf = NULL;
+    size_t dec_buf_size = 0;
+    uint32_t out_len = 0;
+    jpeg_decode_picture_info_t info = {0};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    image_orientation_t orientation = IMAGE_ORIENTATION_NORMAL;
+
+    /* Told from the header alone, the file of a large image is not loaded */
+    if ((image_region_get_info(path, &width, &height, &orientation) == ESP_OK) &&
+            (width * height > DECODE_MAX_PIXELS)) {
+        return decode_jpeg_region(path, max_width, max_height, frame, buf_size);
+    }
+
+    ESP_RETURN_ON_ERROR(decode_read_file(path, &in_buf, &in_size), TAG, "Load %s failed", path);
+    ESP_GOTO_ON_FALSE(!decode_jpeg_is_progressive(in_buf, in_size), ESP_ERR_NOT_SUPPORTED, err, TAG,
+                      "%s is a progressive JPEG", path);
+    ESP_GOTO_ON_ERROR(jpeg_decoder_get_info(in_buf, in_size, &info), err, TAG, "Invalid JPEG header in %s", path);
+    ESP_GOTO_ON_FALSE(info.width * info.height <= DECODE_MAX_PIXELS, ESP_ERR_NOT_SUPPORTED, err, TAG,
+                      "%s is too large (%lux%lu)", path, (unsigned long)info.width, (unsigned long)info.height);
+
+    /* The decoder writes whole MCUs, rows are padded to 16 pixels */
+    uint32_t dec_w = ALIGN_UP(info.width, 16);
+    uint32_t dec_h = ALIGN_UP(info.height, 16);
+    dec_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, dec_w * dec_h * 2, &dec_buf_size);
+    ESP_GOTO_ON_FALSE(dec_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate output buffer failed");
+
+    jpeg_dec_service_job_t job = {
+        .in = in_buf,
+        .in_size = in_size,
+        .out = dec_buf,
+        .out_size = (uint32_t)dec_buf_size,
+        .cfg = decode_cfg,
+    };
+    ESP_GOTO_ON_ERROR(jpeg_dec_service_decode(&job, &out_len), err, TAG, "Decode %s failed", path);
+    jpeg_dec_service_buf_put(in_buf);
+
+    return decode_fit(dec_buf, dec_buf_size, dec_w, dec_h, info.width, info.height, orientation, max_width,
+                      max_height, frame, buf_size);
+
+err:
+    jpeg_dec_service_buf_put(in_buf);
+    jpeg_dec_service_buf_put(dec_buf);
+
+    return ret;
+}
+
+/* Streamed from the file, the compressed data is never loaded whole */
+static esp_err_t decode_png(const char *path, uint32_t max_width, uint32_t max_height, image_frame_t *frame,
+                            size_t *buf_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *dec_buf = NULL;
+    size_t dec_buf_size = 0;
+    /* Too large for the stack of the tasks decoding images */
+    image_png_t *png = (image_png_t *)heap_caps_calloc(1, sizeof(image_png_t), MALLOC_CAP_SPIRAM);
+
+    ESP_RETURN_ON_FALSE(png, ESP_ERR_NO_MEM, TAG, "Allocate PNG failed");
+    ESP_GOTO_ON_ERROR(image_png_open(png, path), end, TAG, "Open PNG %s failed", path);
+    ESP_GOTO_ON_FALSE(png->width * png->height <= DECODE_MAX_PIXELS, ESP_ERR_NOT_SUPPORTED, end, TAG,
+                      "%s is too large (%lux%lu)", path, (unsigned long)png->width, (unsigned long)png->height);
+
+    /* A decoder buffer so the PPA can read it */
+    dec_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, png->width * png->height * 2, &dec_buf_size);
+    ESP_GOTO_ON_FALSE(dec_buf, ESP_ERR_NO_MEM, end, TAG, "Allocate output buffer failed");
+    ESP_GOTO_ON_ERROR(image_png_decode(png, dec_buf, png->width), end, TAG, "Decode %s failed", path);
+    /* The CPU wrote the pixels, the PPA reads them from memory */
+    esp_cache_msync(dec_buf, dec_buf_size, ESP_CACHE_MSYNC_FLAG_DIR_C2M);
+
+    ret = decode_fit(dec_buf, dec_buf_size, png->width, png->height, png->width, png->height,
+                     IMAGE_ORIENTATION_NORMAL, max_width, max_height, frame, buf_size);
+    dec_buf = NULL;
+
+end:
+    jpeg_dec_service_buf_put(dec_buf);
+    image_png_close(png);
+    free(png);
+
+    return ret;
+}
+
+esp_err_t image_decode_file(const char *path, uint32_t max_width, uint32_t max_height, image_frame_t *frame,
+                            size_t *buf_size)
+{
+    uint8_t head[8] = {0};
+
+    ESP_RETURN_ON_FALSE(path && frame && max_width && max_height, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(decode_ppa, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    /* The format is told by the content, not by the file name */
+    FILE *fp = fopen(path, "rb");
+    ESP_RETURN_ON_FALSE(fp, ESP_FAIL, TAG, "Open %s failed", path);
+    size_t len = fread(head, 1, sizeof(head), fp);
+    fclose(fp);
+
+    if (image_png_check(head, len)) {
+        return decode_png(path, max_width, max_height, frame, buf_size);
+    }
+
+    return decode_jpeg(path, max_width, max_height, frame, buf_size);
+}
@@ -0,0 +1,75 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decoded RGB565 image
+ */
+typedef struct {
+    uint8_t     *buf;       /*!< Pixels, rows are `width` pixels long */
+    uint32_t    width;      /*!< Image width */
+    uint32_t    height;     /*!< Image height */
+    uint32_t    src_width;  /*!< Width of the image in the file, before scaling, upright */
+    uint32_t    src_height; /*!< Height of the image in the file, before scaling, upright */
+} image_frame_t;
+
+/**
+ * @brief Register the PPA client used to scale the decoded images
+ *
+ * The shared JPEG decoder must be acquired by the caller as long as images are decoded.
+ *
+ * @return ESP_OK on success, or the error of the PPA driver
+ */
+esp_err_t image_decode_init(void);
+
+/**
+ * @brief Unregister the PPA client
+ */
+void image_decode_deinit(void);
+
+/**
+ * @brief Decode a JPEG or PNG file and scale it down to fit a box
+ *
+ * Baseline JPEGs are decoded at full size by the hardware decoder, PNGs are streamed from the file through the
+ * software decoder of `image_png.h`. The frame is then scaled by the PPA in 1/16 steps so that it fits in
+ * `max_width` x `max_height` with its aspect ratio kept. Images that already fit are only repacked when the decoder
+ * padded their rows. The output buffer comes from the shared decoder pool.
+ *
+ * JPEGs with an EXIF orientation are turned upright by the PPA in the same pass, the box applies to the upright
+ * image.
+ *
+ * JPEGs above the decode limit are decoded in strips from their restart intervals with `image_region.h`, and
+ * scaled in finer steps, the full size frame is never held.
+ *
+ * @param path          JPEG or PNG file, told apart by their content
+ * @param max_width     Box width
+ * @param max_height    Box height
+ * @param frame         Decoded image, `frame->buf` goes back with `jpeg_dec_service_buf_put`
+ * @param buf_size      Real size of `frame->buf`, can be NULL
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NO_MEM         Out of decoder buffers
+ *      - ESP_ERR_NOT_SUPPORTED  Progressive JPEG, interlaced PNG, image above the decode limit without restart
+ *                               intervals, or too large to scale
+ *      - ESP_FAIL               Failed to read the file
+ *      - Others                 Invalid image data
+ */
+esp_err_t image_decode_file(const char *path, uint32_t max_width, uint32_t max_height, image_frame_t *frame,
+                            size_t *buf_size);
+
+#ifdef __cplusplus
+}
+#endif
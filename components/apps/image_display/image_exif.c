@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "image_exif.h"
+
+#define EXIF_HEADER_LEN             (6)
+#define EXIF_TIFF_HEADER_LEN        (8)
+#define EXIF_IFD_ENTRY_LEN          (12)
+#define EXIF_TAG_ORIENTATION        (0x0112)
+#define EXIF_TYPE_SHORT             (3)
+
+static uint16_t exif_u16(const uint8_t *p, bool le)
+{
+    return le ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+}
+
+static uint32_t exif_u32(const uint8_t *p, bool le)
+{
+    return le ? (exif_u16(p, le) | ((uint32_t)exif_u16(p + 2, le) << 16)) :
+           (((uint32_t)exif_u16(p, le) << 16) | exif_u16(p + 2, le));
+}
+
+image_orientation_t image_exif_get_orientation(const uint8_t *app1, uint32_t len)
+{
+    bool le = false;
+
+    if ((len < EXIF_HEADER_LEN + EXIF_TIFF_HEADER_LEN) || (memcmp(app1, "Exif\0\0", EXIF_HEADER_LEN) != 0)) {
+        return IMAGE_ORIENTATION_NORMAL;
+    }
+
+    /* The offsets of the TIFF structure count from its header */
+    const uint8_t *tiff = app1 + EXIF_HEADER_LEN;
+    uint32_t tiff_len = len - EXIF_HEADER_LEN;
+    if ((tiff[0] == 'I') && (tiff[1] == 'I')) {
+        le = true;
+    } else if ((tiff[0] != 'M') || (tiff[1] != 'M')) {
+        return IMAGE_ORIENTATION_NORMAL;
+    }
+    if (exif_u16(tiff + 2, le) != 42) {
+        return IMAGE_ORIENTATION_NORMAL;
+    }
+
+    uint32_t ifd = exif_u32(tiff + 4, le);
+    if ((ifd < EXIF_TIFF_HEADER_LEN) || (ifd > tiff_len - 2)) {
+        return IMAGE_ORIENTATION_NORMAL;
+    }
+    uint16_t entry_num = exif_u16(tiff + ifd, le);
+    for (uint32_t i = 0, pos = ifd + 2; (i < entry_num) && (pos + EXIF_IFD_ENTRY_LEN <= tiff_len);
+            i++, pos += EXIF_IFD_ENTRY_LEN) {
+        if (exif_u16(tiff + pos, le) != EXIF_TAG_ORIENTATION) {
+            continue;
+        }
+        /* A single short, stored in the first half of the value field */
+        uint16_t value = exif_u16(tiff + pos + 8, le);
+        if ((exif_u16(tiff + pos + 2, le) != EXIF_TYPE_SHORT) || (value < IMAGE_ORIENTATION_NORMAL) ||
+                (value > IMAGE_ORIENTATION_ROTATE_270)) {
+            return IMAGE_ORIENTATION_NORMAL;
+        }
+        return (image_orientation_t)value;
+    }
+
+    return IMAGE_ORIENTATION_NORMAL;
+}
@@ -0,0 +1,52 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief EXIF orientation, the transform that shows the stored image upright
+ */
+typedef enum {
+    IMAGE_ORIENTATION_NORMAL = 1,       /*!< Shown as stored */
+    IMAGE_ORIENTATION_MIRROR_H,         /*!< Mirror left to right */
+    IMAGE_ORIENTATION_ROTATE_180,       /*!< Rotate 180 degrees */
+    IMAGE_ORIENTATION_MIRROR_V,         /*!< Mirror top to bottom */
+    IMAGE_ORIENTATION_TRANSPOSE,        /*!< Mirror left to right, then rotate 270 degrees clockwise */
+    IMAGE_ORIENTATION_ROTATE_90,        /*!< Rotate 90 degrees clockwise */
+    IMAGE_ORIENTATION_TRANSVERSE,       /*!< Mirror left to right, then rotate 90 degrees clockwise */
+    IMAGE_ORIENTATION_ROTATE_270,       /*!< Rotate 270 degrees clockwise */
+} image_orientation_t;
+
+/**
+ * @brief Read the orientation tag of an EXIF APP1 segment
+ *
+ * Only the TIFF header and the first IFD are looked at, the orientation of cameras is always there.
+ *
+ * @param app1  Segment data, after its length field
+ * @param len   Available bytes of the segment
+ *
+ * @return Orientation of the image, `IMAGE_ORIENTATION_NORMAL` if the segment has none
+ */
+image_orientation_t image_exif_get_orientation(const uint8_t *app1, uint32_t len);
+
+/**
+ * @brief Whether the upright image has the width and height of the stored one swapped
+ */
+static inline bool image_orientation_swaps(image_orientation_t orientation)
+{
+    return orientation >= IMAGE_ORIENTATION_TRANSPOSE;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,645 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "image_png.h"
+
+/* The inflate part follows the structure of zlib's puff.c, reading the IDAT chunks as one stream */
+
+#define PNG_CHUNK_IHDR              (0x49484452)
+#define PNG_CHUNK_PLTE              (0x504C5445)
+#define PNG_CHUNK_TRNS              (0x74524E53)
+#define PNG_CHUNK_IDAT              (0x49444154)
+#define PNG_CHUNK_IEND              (0x49454E44)
+
+#define PNG_COLOR_GRAY              (0)
+#define PNG_COLOR_RGB               (2)
+#define PNG_COLOR_PALETTE           (3)
+#define PNG_COLOR_GRAY_ALPHA        (4)
+#define PNG_COLOR_RGBA              (6)
+
+#define INFLATE_WINDOW_SIZE         (32 * 1024)
+#define INFLATE_MAX_BITS            (15)
+#define INFLATE_MAX_LCODES          (286)
+#define INFLATE_MAX_DCODES          (30)
+#define INFLATE_FIX_LCODES          (288)
+#define STREAM_IN_BUF_SIZE          (1024)
+
+typedef struct {
+    int16_t count[INFLATE_MAX_BITS + 1];    /*!< Number of symbols of each length */
+    int16_t *symbol;                        /*!< Symbols ordered by code */
+} png_huffman_t;
+
+typedef struct {
+    image_png_t     *png;
+    esp_err_t       err;                    /*!< First error met, the decode stops on it */
+    /* Compressed input */
+    uint8_t         in[STREAM_IN_BUF_SIZE];
+    size_t          in_pos;
+    size_t          in_len;
+    uint32_t        bit_buf;
+    int             bit_cnt;
+    /* Inflate state */
+    uint8_t         *window;
+    uint32_t        out_cnt;
+    int16_t         len_symbol[INFLATE_FIX_LCODES];
+    int16_t         dist_symbol[INFLATE_MAX_DCODES];
+    png_huffman_t   len_code;
+    png_huffman_t   dist_code;
+    /* Rows of raw samples, the filter byte first */
+    uint8_t         *row;
+    uint8_t         *prev;
+    uint32_t        row_bytes;
+    uint32_t        row_pos;
+    uint32_t        y;
+    uint8_t         bpp;
+    uint8_t         channels;
+    uint8_t         *out;
+    uint32_t        stride;
+} png_stream_t;
+
+static const char *TAG = "image_png";
+
+static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static const int16_t inflate_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int16_t inflate_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const int16_t inflate_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+    6145, 8193, 12289, 16385, 24577
+};
+static const int16_t inflate_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t inflate_cl_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static uint32_t png_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static esp_err_t png_read_chunk_header(FILE *fp, uint32_t *len, uint32_t *type)
+{
+    uint8_t header[8];
+
+    ESP_RETURN_ON_FALSE(fread(header, 1, sizeof(header), fp) == sizeof(header), ESP_FAIL, TAG, "Read chunk failed");
+    *len = png_be32(header);
+    *type = png_be32(header + 4);
+
+    return ESP_OK;
+}
+
+/* ---------- Compressed stream ---------- */
+
+static int stream_byte(png_stream_t *s)
+{
+    image_png_t *png = s->png;
+
+    if (s->in_pos == s->in_len) {
+        /* Consecutive IDAT chunks form a single zlib stream */
+        while (png->idat_left == 0) {
+            uint32_t len = 0;
+            uint32_t type = 0;
+            if ((fseek(png->fp, 4, SEEK_CUR) != 0) || (png_read_chunk_header(png->fp, &len, &type) != ESP_OK)) {
+                s->err = ESP_FAIL;
+                return -1;
+            }
+            if (type != PNG_CHUNK_IDAT) {
+                s->err = ESP_ERR_INVALID_RESPONSE;
+                return -1;
+            }
+            png->idat_left = len;
+        }
+        size_t n = (png->idat_left < sizeof(s->in)) ? png->idat_left : sizeof(s->in);
+        if (fread(s->in, 1, n, png->fp) != n) {
+            s->err = ESP_FAIL;
+            return -1;
+        }
+        png->idat_left -= n;
+        s->in_pos = 0;
+        s->in_len = n;
+    }
+
+    return s->in[s->in_pos++];
+}
+
+static int stream_bits(png_stream_t *s, int need)
+{
+    while (s->bit_cnt < need) {
+        int byte = stream_byte(s);
+        if (byte < 0) {
+            return -1;
+        }
+        s->bit_buf |= (uint32_t)byte << s->bit_cnt;
+        s->bit_cnt += 8;
+    }
+
+    int val = (int)(s->bit_buf & ((1UL << need) - 1));
+    s->bit_buf >>= need;
+    s->bit_cnt -= need;
+
+    return val;
+}
+
+/* ---------- Rows ---------- */
+
+static uint8_t png_paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = (int)a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if ((pa <= pb) && (pa <= pc)) {
+        return a;
+    }
+    return (pb <= pc) ? b : c;
+}
+
+static uint8_t png_sample(const png_stream_t *s, const uint8_t *data, uint32_t x, int c)
+{
+    uint8_t depth = s->png->bit_depth;
+
+    if (depth == 8) {
+        return data[x * s->channels + c];
+    }
+    if (depth == 16) {
+        /* Only the most significant byte is kept */
+        return data[(x * s->channels + c) * 2];
+    }
+
+    /* Sub-byte samples only exist for single channel images */
+    uint32_t bit = x * depth;
+    uint8_t val = (data[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+
+    return (s->png->color_type == PNG_COLOR_PALETTE) ? val : (uint8_t)(val * 255 / ((1 << depth) - 1));
+}
+
+static void png_finish_row(png_stream_t *s)
+{
+    uint8_t *data = s->row + 1;
+    const uint8_t *prev = s->prev + 1;
+    uint32_t len = s->row_bytes - 1;
+    uint8_t bpp = s->bpp;
+
+    switch (s->row[0]) {
+    case 0:
+        break;
+    case 1:
+        for (uint32_t i = bpp; i < len; i++) {
+            data[i] += data[i - bpp];
+        }
+        break;
+    case 2:
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] += prev[i];
+        }
+        break;
+    case 3:
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] += ((i >= bpp ? data[i - bpp] : 0) + prev[i]) >> 1;
+        }
+        break;
+    case 4:
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] += png_paeth(i >= bpp ? data[i - bpp] : 0, prev[i], i >= bpp ? prev[i - bpp] : 0);
+        }
+        break;
+    default:
+        s->err = ESP_ERR_INVALID_RESPONSE;
+        return;
+    }
+
+    uint16_t *out = (uint16_t *)(s->out + (size_t)s->y * s->stride * 2);
+    for (uint32_t x = 0; x < s->png->width; x++) {
+        uint8_t r, g, b;
+        uint8_t a = 255;
+        switch (s->png->color_type) {
+        case PNG_COLOR_GRAY:
+            r = g = b = png_sample(s, data, x, 0);
+            break;
+        case PNG_COLOR_GRAY_ALPHA:
+            r = g = b = png_sample(s, data, x, 0);
+            a = png_sample(s, data, x, 1);
+            break;
+        case PNG_COLOR_PALETTE: {
+            const uint8_t *entry = s->png->palette[png_sample(s, data, x, 0)];
+            r = entry[0];
+            g = entry[1];
+            b = entry[2];
+            a = entry[3];
+            break;
+        }
+        case PNG_COLOR_RGBA:
+            a = png_sample(s, data, x, 3);
+        /* fall through */
+        default:
+            r = png_sample(s, data, x, 0);
+            g = png_sample(s, data, x, 1);
+            b = png_sample(s, data, x, 2);
+            break;
+        }
+        if (a != 255) {
+            r = r * a / 255;
+            g = g * a / 255;
+            b = b * a / 255;
+        }
+        out[x] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    uint8_t *tmp = s->prev;
+    s->prev = s->row;
+    s->row = tmp;
+    s->row_pos = 0;
+    s->y++;
+}
+
+static void stream_put(png_stream_t *s, uint8_t byte)
+{
+    s->window[s->out_cnt++ & (INFLATE_WINDOW_SIZE - 1)] = byte;
+    if (s->y >= s->png->height) {
+        /* Trailing data after the last row is ignored */
+        return;
+    }
+    s->row[s->row_pos++] = byte;
+    if (s->row_pos == s->row_bytes) {
+        png_finish_row(s);
+    }
+}
+
+/* ---------- Inflate ---------- */
+
+static int inflate_decode(png_stream_t *s, const png_huffman_t *h)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        int bit = stream_bits(s, 1);
+        if (bit < 0) {
+            return -1;
+        }
+        code |= bit;
+        int count = h->count[len];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    s->err = ESP_ERR_INVALID_RESPONSE;
+
+    return -1;
+}
+
+/* Returns 0 for a complete code, negative for an over-subscribed one and positive for an incomplete one */
+static int inflate_construct(png_huffman_t *h, const int16_t *length, int n)
+{
+    int16_t offs[INFLATE_MAX_BITS + 1];
+    int left = 1;
+
+    memset(h->count, 0, sizeof(h->count));
+    for (int symbol = 0; symbol < n; symbol++) {
+        h->count[length[symbol]]++;
+    }
+    if (h->count[0] == n) {
+        return 0;
+    }
+    for (int len = 1; len <= INFLATE_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+    offs[1] = 0;
+    for (int len = 1; len < INFLATE_MAX_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (length[symbol] != 0) {
+            h->symbol[offs[length[symbol]]++] = symbol;
+        }
+    }
+
+    return left;
+}
+
+static esp_err_t inflate_codes(png_stream_t *s)
+{
+    while (1) {
+        int symbol = inflate_decode(s, &s->len_code);
+        if (symbol < 0) {
+            return s->err;
+        }
+        if (symbol < 256) {
+            stream_put(s, (uint8_t)symbol);
+        } else if (symbol == 256) {
+            return ESP_OK;
+        } else {
+            symbol -= 257;
+            ESP_RETURN_ON_FALSE(symbol < 29, ESP_ERR_INVALID_RESPONSE, TAG, "Invalid length code");
+            int extra = stream_bits(s, inflate_len_extra[symbol]);
+            int dist_symbol = (extra < 0) ? -1 : inflate_decode(s, &s->dist_code);
+            ESP_RETURN_ON_FALSE((extra >= 0) && (dist_symbol >= 0), s->err, TAG, "Truncated data");
+            ESP_RETURN_ON_FALSE(dist_symbol < 30, ESP_ERR_INVALID_RESPONSE, TAG, "Invalid distance code");
+            int len = inflate_len_base[symbol] + extra;
+            int dist_extra = stream_bits(s, inflate_dist_extra[dist_symbol]);
+            ESP_RETURN_ON_FALSE(dist_extra >= 0, s->err, TAG, "Truncated data");
+            uint32_t dist = inflate_dist_base[dist_symbol] + dist_extra;
+            ESP_RETURN_ON_FALSE(dist <= s->out_cnt, ESP_ERR_INVALID_RESPONSE, TAG, "Distance too far back");
+            while (len-- > 0) {
+                stream_put(s, s->window[(s->out_cnt - dist) & (INFLATE_WINDOW_SIZE - 1)]);
+            }
+        }
+        if (s->err != ESP_OK) {
+            return s->err;
+        }
+    }
+}
+
+static esp_err_t inflate_stored(png_stream_t *s)
+{
+    int bytes[4];
+
+    /* The block starts on a byte boundary, the bits left belong to the current byte */
+    s->bit_buf = 0;
+    s->bit_cnt = 0;
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = stream_byte(s);
+        ESP_RETURN_ON_FALSE(bytes[i] >= 0, s->err, TAG, "Truncated data");
+    }
+    uint32_t len = bytes[0] | (bytes[1] << 8);
+    ESP_RETURN_ON_FALSE(len == ((~(bytes[2] | (bytes[3] << 8))) & 0xFFFF), ESP_ERR_INVALID_RESPONSE, TAG,
+                        "Invalid stored block");
+    while (len-- > 0) {
+        int byte = stream_byte(s);
+        ESP_RETURN_ON_FALSE(byte >= 0, s->err, TAG, "Truncated data");
+        stream_put(s, (uint8_t)byte);
+    }
+
+    return s->err;
+}
+
+static esp_err_t inflate_fixed(png_stream_t *s)
+{
+    int16_t lengths[INFLATE_FIX_LCODES];
+    int symbol = 0;
+
+    for (; symbol < 144; symbol++) {
+        lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+        lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+        lengths[symbol] = 7;
+    }
+    for (; symbol < INFLATE_FIX_LCODES; symbol++) {
+        lengths[symbol] = 8;
+    }
+    inflate_construct(&s->len_code, lengths, INFLATE_FIX_LCODES);
+    for (symbol = 0; symbol < INFLATE_MAX_DCODES; symbol++) {
+        lengths[symbol] = 5;
+    }
+    inflate_construct(&s->dist_code, lengths, INFLATE_MAX_DCODES);
+
+    return inflate_codes(s);
+}
+
+static esp_err_t inflate_dynamic(png_stream_t *s)
+{
+    int16_t lengths[INFLATE_MAX_LCODES + INFLATE_MAX_DCODES];
+    int nlen = stream_bits(s, 5);
+    int ndist = stream_bits(s, 5);
+    int ncode = stream_bits(s, 4);
+
+    ESP_RETURN_ON_FALSE((nlen >= 0) && (ndist >= 0) && (ncode >= 0), s->err, TAG, "Truncated data");
+    nlen += 257;
+    ndist += 1;
+    ncode += 4;
+    ESP_RETURN_ON_FALSE((nlen <= INFLATE_MAX_LCODES) && (ndist <= INFLATE_MAX_DCODES), ESP_ERR_INVALID_RESPONSE,
+                        TAG, "Invalid code counts");
+
+    int index = 0;
+    for (; index < ncode; index++) {
+        int len = stream_bits(s, 3);
+        ESP_RETURN_ON_FALSE(len >= 0, s->err, TAG, "Truncated data");
+        lengths[inflate_cl_order[index]] = len;
+    }
+    for (; index < 19; index++) {
+        lengths[inflate_cl_order[index]] = 0;
+    }
+    /* The code length code reuses the length tables */
+    ESP_RETURN_ON_FALSE(inflate_construct(&s->len_code, lengths, 19) == 0, ESP_ERR_INVALID_RESPONSE, TAG,
+                        "Invalid code length code");
+
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = inflate_decode(s, &s->len_code);
+        ESP_RETURN_ON_FALSE(symbol >= 0, s->err, TAG, "Invalid code lengths");
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        int16_t len = 0;
+        int repeat = 0;
+        if (symbol == 16) {
+            ESP_RETURN_ON_FALSE(index > 0, ESP_ERR_INVALID_RESPONSE, TAG, "Repeat without length");
+            len = lengths[index - 1];
+            repeat = stream_bits(s, 2);
+            repeat = (repeat < 0) ? -1 : repeat + 3;
+        } else if (symbol == 17) {
+            repeat = stream_bits(s, 3);
+            repeat = (repeat < 0) ? -1 : repeat + 3;
+        } else {
+            repeat = stream_bits(s, 7);
+            repeat = (repeat < 0) ? -1 : repeat + 11;
+        }
+        ESP_RETURN_ON_FALSE(repeat >= 0, s->err, TAG, "Truncated data");
+        ESP_RETURN_ON_FALSE(index + repeat <= nlen + ndist, ESP_ERR_INVALID_RESPONSE, TAG, "Too many lengths");
+        while (repeat-- > 0) {
+            lengths[index++] = len;
+        }
+    }
+    ESP_RETURN_ON_FALSE(lengths[256] != 0, ESP_ERR_INVALID_RESPONSE, TAG, "No end of block code");
+
+    int err = inflate_construct(&s->len_code, lengths, nlen);
+    ESP_RETURN_ON_FALSE((err >= 0) && ((err == 0) || (nlen - s->len_code.count[0] == 1)), ESP_ERR_INVALID_RESPONSE,
+                        TAG, "Incomplete length code");
+    err = inflate_construct(&s->dist_code, lengths + nlen, ndist);
+    ESP_RETURN_ON_FALSE((err >= 0) && ((err == 0) || (ndist - s->dist_code.count[0] == 1)), ESP_ERR_INVALID_RESPONSE,
+                        TAG, "Incomplete distance code");
+
+    return inflate_codes(s);
+}
+
+static esp_err_t inflate_stream(png_stream_t *s)
+{
+    int cmf = stream_byte(s);
+    int flg = stream_byte(s);
+
+    ESP_RETURN_ON_FALSE((cmf >= 0) && (flg >= 0), s->err, TAG, "Truncated data");
+    ESP_RETURN_ON_FALSE(((cmf & 0x0F) == 8) && (((cmf << 8) | flg) % 31 == 0) && !(flg & 0x20),
+                        ESP_ERR_INVALID_RESPONSE, TAG, "Invalid zlib header");
+
+    int last = 0;
+    while (!last && (s->y < s->png->height)) {
+        last = stream_bits(s, 1);
+        int type = stream_bits(s, 2);
+        ESP_RETURN_ON_FALSE((last >= 0) && (type >= 0), s->err, TAG, "Truncated data");
+
+        esp_err_t ret = ESP_OK;
+        switch (type) {
+        case 0:
+            ret = inflate_stored(s);
+            break;
+        case 1:
+            ret = inflate_fixed(s);
+            break;
+        case 2:
+            ret = inflate_dynamic(s);
+            break;
+        default:
+            ret = ESP_ERR_INVALID_RESPONSE;
+            break;
+        }
+        ESP_RETURN_ON_ERROR(ret, TAG, "Inflate failed");
+    }
+    ESP_RETURN_ON_FALSE(s->y == s->png->height, ESP_ERR_INVALID_RESPONSE, TAG, "Image data ends early");
+
+    return ESP_OK;
+}
+
+/* ---------- Public ---------- */
+
+bool image_png_check(const uint8_t *head, size_t len)
+{
+    return (len >= sizeof(png_signature)) && (memcmp(head, png_signature, sizeof(png_signature)) == 0);
+}
+
+esp_err_t image_png_open(image_png_t *png, const char *path)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t buf[13];
+    uint32_t len = 0;
+    uint32_t type = 0;
+    bool has_header = false;
+
+    ESP_RETURN_ON_FALSE(png && path, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    memset(png, 0, sizeof(image_png_t));
+    png->fp = fopen(path, "rb");
+    ESP_RETURN_ON_FALSE(png->fp, ESP_FAIL, TAG, "Open %s failed", path);
+    ESP_GOTO_ON_FALSE((fread(buf, 1, sizeof(png_signature), png->fp) == sizeof(png_signature)) &&
+                      image_png_check(buf, sizeof(png_signature)), ESP_ERR_INVALID_RESPONSE, err, TAG,
+                      "%s is not a PNG", path);
+
+    while (1) {
+        ESP_GOTO_ON_ERROR(png_read_chunk_header(png->fp, &len, &type), err, TAG, "Truncated %s", path);
+        if (type == PNG_CHUNK_IDAT) {
+            ESP_GOTO_ON_FALSE(has_header, ESP_ERR_INVALID_RESPONSE, err, TAG, "No header in %s", path);
+            png->idat_left = len;
+            return ESP_OK;
+        }
+        ESP_GOTO_ON_FALSE(type != PNG_CHUNK_IEND, ESP_ERR_INVALID_RESPONSE, err, TAG, "No image data in %s", path);
+
+        if (type == PNG_CHUNK_IHDR) {
+            ESP_GOTO_ON_FALSE((len == 13) && (fread(buf, 1, 13, png->fp) == 13), ESP_ERR_INVALID_RESPONSE, err, TAG,
+                              "Invalid header in %s", path);
+            png->width = png_be32(buf);
+            png->height = png_be32(buf + 4);
+            png->bit_depth = buf[8];
+            png->color_type = buf[9];
+            ESP_GOTO_ON_FALSE(buf[12] == 0, ESP_ERR_NOT_SUPPORTED, err, TAG, "Interlaced %s", path);
+            bool depth_ok = (png->bit_depth == 8) || ((png->bit_depth == 16) && (png->color_type != PNG_COLOR_PALETTE)) ||
+                            ((png->bit_depth < 8) && ((png->bit_depth & (png->bit_depth - 1)) == 0) &&
+                             ((png->color_type == PNG_COLOR_GRAY) || (png->color_type == PNG_COLOR_PALETTE)));
+            ESP_GOTO_ON_FALSE(png->width && png->height && depth_ok && (png->color_type <= PNG_COLOR_RGBA) &&
+                              (png->color_type != 1) && (png->color_type != 5) && (buf[10] == 0) && (buf[11] == 0),
+                              ESP_ERR_INVALID_RESPONSE, err, TAG, "Unsupported format in %s", path);
+            has_header = true;
+        } else if (type == PNG_CHUNK_PLTE) {
+            ESP_GOTO_ON_FALSE((len % 3 == 0) && (len <= 256 * 3), ESP_ERR_INVALID_RESPONSE, err, TAG,
+                              "Invalid palette in %s", path);
+            png->palette_num = len / 3;
+            for (int i = 0; i < png->palette_num; i++) {
+                ESP_GOTO_ON_FALSE(fread(png->palette[i], 1, 3, png->fp) == 3, ESP_FAIL, err, TAG, "Truncated %s", path);
+                png->palette[i][3] = 255;
+            }
+        } else if ((type == PNG_CHUNK_TRNS) && (png->color_type == PNG_COLOR_PALETTE)) {
+            ESP_GOTO_ON_FALSE(len <= png->palette_num, ESP_ERR_INVALID_RESPONSE, err, TAG, "Invalid tRNS in %s", path);
+            for (uint32_t i = 0; i < len; i++) {
+                ESP_GOTO_ON_FALSE(fread(&png->palette[i][3], 1, 1, png->fp) == 1, ESP_FAIL, err, TAG, "Truncated %s",
+                                  path);
+            }
+        } else {
+            /* Ancillary chunks are skipped */
+            ESP_GOTO_ON_FALSE(fseek(png->fp, len, SEEK_CUR) == 0, ESP_FAIL, err, TAG, "Truncated %s", path);
+        }
+        /* CRC */
+        ESP_GOTO_ON_FALSE(fseek(png->fp, 4, SEEK_CUR) == 0, ESP_FAIL, err, TAG, "Truncated %s", path);
+    }
+
+err:
+    image_png_close(png);
+
+    return ret;
+}
+
+esp_err_t image_png_decode(image_png_t *png, uint8_t *out, uint32_t stride)
+{
+    esp_err_t ret = ESP_OK;
+    static const uint8_t channels[] = {1, 0, 3, 1, 2, 0, 4};
+
+    ESP_RETURN_ON_FALSE(png && png->fp && out && (stride >= png->width), ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE((png->color_type != PNG_COLOR_PALETTE) || png->palette_num, ESP_ERR_INVALID_RESPONSE, TAG,
+                        "No palette");
+
+    png_stream_t *s = (png_stream_t *)heap_caps_calloc(1, sizeof(png_stream_t), MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(s, ESP_ERR_NO_MEM, TAG, "Allocate stream failed");
+    s->png = png;
+    s->out = out;
+    s->stride = stride;
+    s->channels = channels[png->color_type];
+    s->bpp = (s->channels * png->bit_depth + 7) / 8;
+    s->row_bytes = 1 + (png->width * s->channels * png->bit_depth + 7) / 8;
+    s->len_code.symbol = s->len_symbol;
+    s->dist_code.symbol = s->dist_symbol;
+    s->window = (uint8_t *)heap_caps_malloc(INFLATE_WINDOW_SIZE, MALLOC_CAP_SPIRAM);
+    s->row = (uint8_t *)heap_caps_malloc(s->row_bytes, MALLOC_CAP_SPIRAM);
+    s->prev = (uint8_t *)heap_caps_calloc(1, s->row_bytes, MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(s->window && s->row && s->prev, ESP_ERR_NO_MEM, end, TAG, "Allocate rows failed");
+
+    ret = inflate_stream(s);
+
+end:
+    free(s->prev);
+    free(s->row);
+    free(s->window);
+    free(s);
+
+    return ret;
+}
+
+void image_png_close(image_png_t *png)
+{
+    if (png && png->fp) {
+        fclose(png->fp);
+        png->fp = NULL;
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief PNG file opened for decoding
+ */
+typedef struct {
+    FILE        *fp;                /*!< File, positioned in the image data */
+    uint32_t    width;              /*!< Image width */
+    uint32_t    height;             /*!< Image height */
+    uint8_t     bit_depth;          /*!< Bits per sample */
+    uint8_t     color_type;         /*!< PNG color type */
+    uint32_t    idat_left;          /*!< Bytes left in the current IDAT chunk */
+    uint16_t    palette_num;        /*!< Entries of `palette` */
+    uint8_t     palette[256][4];    /*!< RGBA palette of indexed images */
+} image_png_t;
+
+/**
+ * @brief Check the PNG signature
+ *
+ * @param head  First bytes of the file
+ * @param len   Available bytes
+ *
+ * @return true if the data starts with the PNG signature
+ */
+bool image_png_check(const uint8_t *head, size_t len);
+
+/**
+ * @brief Open a PNG file and read its header, palette and transparency
+ *
+ * @param png   PNG to fill, closed with `image_png_close`
+ * @param path  PNG file
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NOT_SUPPORTED  Interlaced image
+ *      - ESP_ERR_INVALID_RESPONSE Corrupted header
+ *      - ESP_FAIL               Failed to read the file
+ */
+esp_err_t image_png_open(image_png_t *png, const char *path);
+
+/**
+ * @brief Decode the image to RGB565, row by row
+ *
+ * The compressed data is streamed from the file through a 32 KB window, only two rows of raw samples are held. Alpha
+ * is blended over black.
+ *
+ * @param png       Opened PNG
+ * @param out       Output of `width` x `height` pixels
+ * @param stride    Pixels between the start of two output rows, at least `width`
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NO_MEM         Failed to allocate the window or the rows
+ *      - ESP_ERR_INVALID_RESPONSE Corrupted image data
+ *      - ESP_FAIL               Failed to read the file
+ */
+esp_err_t image_png_decode(image_png_t *png, uint8_t *out, uint32_t stride);
+
+/**
+ * @brief Close the file of a PNG
+ */
+void image_png_close(image_png_t *png);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,514 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "sd_io/sd_io.h"
+#include "image_region.h"
+
+#define ALIGN_UP(num, align)        (((num) + ((align) - 1)) & ~((align) - 1))
+#define DIV_UP(num, div)            (((num) + (div) - 1) / (div))
+
+/* DQT, DHT, SOF, DRI and SOS, the application segments are left out of the region JPEGs */
+#define REGION_HEADER_MAX           (2048)
+/* Start of the EXIF segment read for its orientation, in the unused end of the header */
+#define REGION_EXIF_READ_MAX        (512)
+#define REGION_SCAN_CHUNK           (32 * 1024)
+/* Taller intervals make every strip decode that many rows more */
+#define REGION_SEG_H_MAX            (64)
+/* Rows of the region decoded at once, a multiple of 16 times the halvings so every strip scales exactly */
+#define REGION_STRIP_MIN_ROWS       (64)
+
+#define MARKER_SOI                  (0xD8)
+#define MARKER_EOI                  (0xD9)
+#define MARKER_SOS                  (0xDA)
+#define MARKER_DQT                  (0xDB)
+#define MARKER_DRI                  (0xDD)
+#define MARKER_DHT                  (0xC4)
+#define MARKER_RST0                 (0xD0)
+#define MARKER_APP1                 (0xE1)
+
+struct image_region {
+    int         fd;
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    seg_w;              /* Pixels covered by a restart interval */
+    uint32_t    seg_h;
+    uint32_t    segs_x;             /* Intervals across and down the image */
+    uint32_t    segs_y;
+    uint32_t    interval_num;
+    uint32_t    *starts;            /* Offset of each interval, the last entry is right after the EOI marker */
+    uint32_t    entropy_offset;
+    uint16_t    restart_interval;   /* MCUs per interval */
+    uint8_t     mcu_w;
+    uint8_t     mcu_h;
+    image_orientation_t orientation;
+    uint32_t    sof_pos;            /* Frame header in `header`, patched with the size of each region */
+    uint32_t    header_len;
+    uint8_t     header[REGION_HEADER_MAX];
+};
+
+static const jpeg_decode_cfg_t region_decode_cfg = {
+    .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
+    .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+};
+
+static const char *TAG = "image_region";
+
+static esp_err_t region_read(int fd, uint32_t offset, void *buf, size_t len)
+{
+    return (sd_io_read_at(fd, offset, buf, len) == (ssize_t)len) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t region_parse_sof(image_region_handle_t region, const uint8_t *body, uint32_t len)
+{
+    uint8_t h_max = 1;
+    uint8_t v_max = 1;
+
+    ESP_RETURN_ON_FALSE((len >= 6) && (body[0] == 8), ESP_ERR_NOT_SUPPORTED, TAG, "Only 8 bit samples");
+    region->height = (body[1] << 8) | body[2];
+    region->width = (body[3] << 8) | body[4];
+    uint8_t comp_num = body[5];
+    ESP_RETURN_ON_FALSE(region->width && region->height && comp_num && (len >= 6 + comp_num * 3U), ESP_FAIL, TAG,
+                        "Invalid frame header");
+    for (int i = 0; i < comp_num; i++) {
+        h_max = MAX(h_max, body[6 + i * 3 + 1] >> 4);
+        v_max = MAX(v_max, body[6 + i * 3 + 1] & 0x0F);
+    }
+    /* A single component scan is not interleaved, its MCU is one block */
+    region->mcu_w = (comp_num == 1) ? 8 : 8 * h_max;
+    region->mcu_h = (comp_num == 1) ? 8 : 8 * v_max;
+
+    return ESP_OK;
+}
+
+/* Keeps the tables and headers a region JPEG needs, until the frame header only when `info_only` */
+static esp_err_t region_parse_header(image_region_handle_t region, bool info_only)
+{
+    uint8_t seg[4];
+    uint32_t pos = 2;
+    bool sof_found = false;
+
+    ESP_RETURN_ON_ERROR(region_read(region->fd, 0, seg, 2), TAG, "Read header failed");
+    ESP_RETURN_ON_FALSE((seg[0] == 0xFF) && (seg[1] == MARKER_SOI), ESP_ERR_NOT_SUPPORTED, TAG, "Not a JPEG");
+    region->header[0] = 0xFF;
+    region->header[1] = MARKER_SOI;
+    region->header_len = 2;
+    region->orientation = IMAGE_ORIENTATION_NORMAL;
+
+    while (1) {
+        ESP_RETURN_ON_ERROR(region_read(region->fd, pos, seg, sizeof(seg)), TAG, "Truncated header");
+        ESP_RETURN_ON_FALSE(seg[0] == 0xFF, ESP_FAIL, TAG, "Invalid marker at %lu", (unsigned long)pos);
+        if (seg[1] == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        uint8_t marker = seg[1];
+        uint32_t len = (seg[2] << 8) | seg[3];
+        bool is_sof = (marker == 0xC0) || (marker == 0xC1);
+        bool keep = is_sof || (marker == MARKER_DQT) || (marker == MARKER_DHT) || (marker == MARKER_DRI) ||
+                    (marker == MARKER_SOS);
+
+        ESP_RETURN_ON_FALSE(len >= 2, ESP_FAIL, TAG, "Invalid segment length");
+        ESP_RETURN_ON_FALSE(is_sof || (marker < 0xC0) || (marker > 0xCF) || (marker == MARKER_DHT) ||
+                            (marker == 0xC8) || (marker == 0xCC), ESP_ERR_NOT_SUPPORTED, TAG,
+                            "Not a baseline JPEG");
+        ESP_RETURN_ON_FALSE((marker != MARKER_SOS) || sof_found, ESP_FAIL, TAG, "Scan before the frame header");
+        if ((marker == MARKER_APP1) && (region->orientation == IMAGE_ORIENTATION_NORMAL) &&
+                (region->header_len <= REGION_HEADER_MAX - REGION_EXIF_READ_MAX)) {
+            uint8_t *exif = region->header + REGION_HEADER_MAX - REGION_EXIF_READ_MAX;
+            uint32_t exif_len = MIN(len - 2, REGION_EXIF_READ_MAX);
+            if (region_read(region->fd, pos + 4, exif, exif_len) == ESP_OK) {
+                region->orientation = image_exif_get_orientation(exif, exif_len);
+            }
+        }
+        if (keep) {
+            ESP_RETURN_ON_FALSE(region->header_len + 2 + len <= REGION_HEADER_MAX, ESP_ERR_NOT_SUPPORTED, TAG,
+                                "Tables too large");
+            uint8_t *dst = region->header + region->header_len;
+            dst[0] = 0xFF;
+            dst[1] = marker;
+            ESP_RETURN_ON_ERROR(region_read(region->fd, pos + 2, dst + 2, len), TAG, "Truncated header");
+            if (is_sof) {
+                ESP_RETURN_ON_ERROR(region_parse_sof(region, dst + 4, len - 2), TAG, "Parse frame header failed");
+                region->sof_pos = region->header_len;
+                sof_found = true;
+            } else if ((marker == MARKER_DRI) && (len >= 4)) {
+                region->restart_interval = (dst[4] << 8) | dst[5];
+            }
+            region->header_len += 2 + len;
+        }
+        pos += 2 + len;
+
+        if (is_sof && info_only) {
+            return ESP_OK;
+        }
+        if (marker == MARKER_SOS) {
+            /* Interleaved scans only, a baseline image with one scan per component cannot be cut in regions */
+            uint8_t scan_comp_num = region->header[region->header_len - len + 2];
+            uint8_t frame_comp_num = region->header[region->sof_pos + 9];
+            ESP_RETURN_ON_FALSE(scan_comp_num == frame_comp_num, ESP_ERR_NOT_SUPPORTED, TAG, "Not interleaved");
+            region->entropy_offset = pos;
+            return ESP_OK;
+        }
+    }
+}
+
+/* Every restart marker starts an interval, the predictions of the decoder start over there */
+static esp_err_t region_scan_intervals(image_region_handle_t region)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t found = 1;
+    uint32_t base = region->entropy_offset;
+    bool after_ff = false;
+    bool done = false;
+    uint8_t *chunk = sd_io_buf_alloc(REGION_SCAN_CHUNK, false);
+
+    ESP_RETURN_ON_FALSE(chunk, ESP_ERR_NO_MEM, TAG, "Allocate scan buffer failed");
+    region->starts[0] = region->entropy_offset;
+    ESP_GOTO_ON_FALSE(lseek(region->fd, base, SEEK_SET) == base, ESP_FAIL, end, TAG, "Seek failed");
+
+    while (!done) {
+        ssize_t len = sd_io_read(region->fd, chunk, REGION_SCAN_CHUNK);
+        ESP_GOTO_ON_FALSE(len > 0, ESP_FAIL, end, TAG, "No end of image");
+
+        for (ssize_t i = 0; i < len; i++) {
+            uint8_t byte = chunk[i];
+
+            if (!after_ff) {
+                after_ff = (byte == 0xFF);
+                continue;
+            }
+            /* Fill bytes */
+            if (byte == 0xFF) {
+                continue;
+            }
+            after_ff = false;
+            /* Stuffed 0xFF of the entropy coded data */
+            if (byte == 0x00) {
+                continue;
+            }
+            if ((byte & 0xF8) == MARKER_RST0) {
+                ESP_GOTO_ON_FALSE(found < region->interval_num, ESP_ERR_NOT_SUPPORTED, end, TAG,
+                                  "More restart markers than intervals");
+                ESP_GOTO_ON_FALSE((byte & 0x07) == ((found - 1) & 0x07), ESP_FAIL, end, TAG,
+                                  "Restart marker %lu out of order", (unsigned long)found);
+                region->starts[found++] = base + i + 1;
+            } else if (byte == MARKER_EOI) {
+                region->starts[region->interval_num] = base + i + 1;
+                done = true;
+                break;
+            } else {
+                ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, end, TAG, "Marker 0x%02X in the scan", byte);
+            }
+        }
+        base += len;
+    }
+    ESP_GOTO_ON_FALSE(found == region->interval_num, ESP_ERR_NOT_SUPPORTED, end, TAG,
+                      "%lu restart markers for %lu intervals", (unsigned long)(found - 1),
+                      (unsigned long)region->interval_num);
+
+end:
+    heap_caps_free(chunk);
+
+    return ret;
+}
+
+static esp_err_t region_layout(image_region_handle_t region)
+{
+    uint32_t mcus_x = DIV_UP(region->width, region->mcu_w);
+    uint32_t mcus_y = DIV_UP(region->height, region->mcu_h);
+    uint32_t ri = region->restart_interval;
+
+    ESP_RETURN_ON_FALSE(ri > 0, ESP_ERR_NOT_SUPPORTED, TAG, "No restart markers");
+    if (mcus_x % ri == 0) {
+        /* Several intervals per MCU row, regions can be cut across as well */
+        region->seg_w = ri * region->mcu_w;
+        region->seg_h = region->mcu_h;
+    } else if (ri % mcus_x == 0) {
+        region->seg_w = mcus_x * region->mcu_w;
+        region->seg_h = (ri / mcus_x) * region->mcu_h;
+    } else {
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, TAG, "Restart interval %lu does not fit %lu MCUs rows",
+                            (unsigned long)ri, (unsigned long)mcus_x);
+    }
+    ESP_RETURN_ON_FALSE(region->seg_h <= REGION_SEG_H_MAX, ESP_ERR_NOT_SUPPORTED, TAG, "Restart interval too long");
+    region->segs_x = DIV_UP(region->width, region->seg_w);
+    region->segs_y = DIV_UP(region->height, region->seg_h);
+    region->interval_num = DIV_UP(mcus_x * mcus_y, ri);
+
+    return ESP_OK;
+}
+
+esp_err_t image_region_open(const char *path, image_region_handle_t *ret_handle)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(path && ret_handle, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    image_region_handle_t region = heap_caps_calloc(1, sizeof(struct image_region), MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(region, ESP_ERR_NO_MEM, TAG, "Allocate region failed");
+    region->fd = sd_io_open(path);
+    ESP_GOTO_ON_FALSE(region->fd >= 0, ESP_FAIL, err, TAG, "Open %s failed", path);
+
+    ESP_GOTO_ON_ERROR(region_parse_header(region, false), err, TAG, "Parse %s failed", path);
+    ESP_GOTO_ON_ERROR(region_layout(region), err, TAG, "%s cannot be decoded in regions", path);
+    region->starts = heap_caps_malloc((region->interval_num + 1) * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(region->starts, ESP_ERR_NO_MEM, err, TAG, "Allocate %lu intervals failed",
+                      (unsigned long)region->interval_num);
+    ESP_GOTO_ON_ERROR(region_scan_intervals(region), err, TAG, "Index %s failed", path);
+    ESP_LOGI(TAG, "%s: %lux%lu, %lu intervals of %lux%lu", path, (unsigned long)region->width,
+             (unsigned long)region->height, (unsigned long)region->interval_num, (unsigned long)region->seg_w,
+             (unsigned long)region->seg_h);
+    *ret_handle = region;
+
+    return ESP_OK;
+
+err:
+    image_region_close(region);
+
+    return ret;
+}
+
+void image_region_close(image_region_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+
+    if (handle->fd >= 0) {
+        close(handle->fd);
+    }
+    heap_caps_free(handle->starts);
+    heap_caps_free(handle);
+}
+
+esp_err_t image_region_get_info(const char *path, uint32_t *width, uint32_t *height,
+                                image_orientation_t *orientation)
+{
+    ESP_RETURN_ON_FALSE(path && width && height, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    image_region_handle_t region = heap_caps_calloc(1, sizeof(struct image_region), MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(region, ESP_ERR_NO_MEM, TAG, "Allocate region failed");
+
+    region->fd = sd_io_open(path);
+    esp_err_t ret = (region->fd >= 0) ? region_parse_header(region, true) : ESP_FAIL;
+    *width = region->width;
+    *height = region->height;
+    if (orientation) {
+        *orientation = region->orientation;
+    }
+    image_region_close(region);
+
+    return ret;
+}
+
+void image_region_get_size(image_region_handle_t handle, uint32_t *width, uint32_t *height)
+{
+    *width = handle->width;
+    *height = handle->height;
+}
+
+image_orientation_t image_region_get_orientation(image_region_handle_t handle)
+{
+    return handle->orientation;
+}
+
+void image_region_scale_from(float factor, image_region_scale_t *scale)
+{
+    uint8_t shift = 0;
+
+    /* Halved while a reduction is left, the 1/16 steps of what remains are as fine as they get */
+    while ((shift < IMAGE_REGION_SHIFT_MAX) && (factor * (2 << shift) <= 1.0f)) {
+        shift++;
+    }
+    scale->num = (uint16_t)MAX(1.0f, floorf(factor * (IMAGE_REGION_SCALE_STEP << shift) + 0.001f));
+    scale->shift = shift;
+}
+
+/* A small JPEG of the intervals under rows [sr0, sr1) and columns [sc0, sc1) of intervals */
+static esp_err_t region_decode_strip(image_region_handle_t region, uint32_t sr0, uint32_t sr1, uint32_t sc0,
+                                     uint32_t sc1, uint8_t **dec_buf, uint32_t *pic_w, uint32_t *pic_h)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t width = MIN(sc1 * region->seg_w, region->width) - sc0 * region->seg_w;
+    uint32_t height = MIN(sr1 * region->seg_h, region->height) - sr0 * region->seg_h;
+    size_t in_size = region->header_len + 2;
+    size_t dec_size = 0;
+    uint32_t out_len = 0;
+    uint32_t seq = 0;
+
+    for (uint32_t row = sr0; row < sr1; row++) {
+        in_size += region->starts[row * region->segs_x + sc1] - region->starts[row * region->segs_x + sc0];
+    }
+    uint8_t *in = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_INPUT_BUFFER, in_size, NULL);
+    ESP_RETURN_ON_FALSE(in, ESP_ERR_NO_MEM, TAG, "Allocate input buffer failed");
+
+    memcpy(in, region->header, region->header_len);
+    uint8_t *sof = in + region->sof_pos;
+    sof[5] = height >> 8;
+    sof[6] = height & 0xFF;
+    sof[7] = width >> 8;
+    sof[8] = width & 0xFF;
+
+    uint8_t *pos = in + region->header_len;
+    for (uint32_t row = sr0; row < sr1; row++) {
+        uint32_t first = row * region->segs_x + sc0;
+        uint32_t last = row * region->segs_x + sc1 - 1;
+        uint32_t from = region->starts[first];
+        uint32_t to = region->starts[last + 1] - 2;
+
+        /* The intervals of a row are contiguous, only their restart markers are numbered again */
+        ESP_GOTO_ON_ERROR(region_read(region->fd, from, pos, to - from), end, TAG, "Read intervals failed");
+        for (uint32_t i = first + 1; i <= last; i++) {
+            pos[region->starts[i] - 1 - from] = MARKER_RST0 | (seq++ & 0x07);
+        }
+        pos += to - from;
+        if (row + 1 < sr1) {
+            *pos++ = 0xFF;
+            *pos++ = MARKER_RST0 | (seq++ & 0x07);
+        }
+    }
+    *pos++ = 0xFF;
+    *pos++ = MARKER_EOI;
+
+    /* The decoder writes whole MCUs, rows are padded to 16 pixels */
+    *pic_w = ALIGN_UP(width, 16);
+    *pic_h = ALIGN_UP(height, 16);
+    *dec_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, *pic_w * *pic_h * 2, &dec_size);
+    ESP_GOTO_ON_FALSE(*dec_buf, ESP_ERR_NO_MEM, end, TAG, "Allocate output buffer failed");
+
+    jpeg_dec_service_job_t job = {
+        .in = in,
+        .in_size = (uint32_t)(pos - in),
+        .out = *dec_buf,
+        .out_size = (uint32_t)dec_size,
+        .cfg = region_decode_cfg,
+    };
+    ret = jpeg_dec_service_decode(&job, &out_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Decode rows %lu to %lu failed", (unsigned long)sr0, (unsigned long)sr1);
+        jpeg_dec_service_buf_put(*dec_buf);
+        *dec_buf = NULL;
+    }
+
+end:
+    jpeg_dec_service_buf_put(in);
+
+    return ret;
+}
+
+esp_err_t image_region_decode(image_region_handle_t handle, ppa_client_handle_t ppa, const image_region_rect_t *rect,
+                              const image_region_scale_t *scale, uint8_t *out, size_t out_size, uint32_t out_w,
+                              uint32_t out_h, uint32_t out_x, uint32_t out_y)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t *tmp_buf = NULL;
+    size_t tmp_size = 0;
+
+    ESP_RETURN_ON_FALSE(handle && ppa && rect && scale && out && scale->num && (scale->shift <= IMAGE_REGION_SHIFT_MAX),
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(rect->w && rect->h && (rect->x + rect->w <= handle->width) &&
+                        (rect->y + rect->h <= handle->height), ESP_ERR_INVALID_ARG, TAG, "Region outside the image");
+    ESP_RETURN_ON_FALSE(image_region_scaled(rect->w, scale) && ((rect->w >> scale->shift) > 0), ESP_ERR_INVALID_ARG,
+                        TAG, "Region too small for the scale");
+    ESP_RETURN_ON_FALSE((out_x + image_region_scaled(rect->w, scale) <= out_w) &&
+                        (out_y + image_region_scaled(rect->h, scale) <= out_h), ESP_ERR_INVALID_ARG, TAG,
+                        "Region outside the picture");
+
+    /* Halved and scaled at once when the factor allows it, otherwise halved into a strip buffer first */
+    bool direct = (scale->num % (1 << scale->shift)) == 0;
+    uint32_t strip_rows = MAX(REGION_STRIP_MIN_ROWS, IMAGE_REGION_SCALE_STEP << scale->shift);
+    uint32_t tmp_w = rect->w >> scale->shift;
+    if (!direct) {
+        tmp_buf = jpeg_dec_service_buf_get(JPEG_DEC_ALLOC_OUTPUT_BUFFER, tmp_w * (strip_rows >> scale->shift) * 2,
+                                           &tmp_size);
+        ESP_RETURN_ON_FALSE(tmp_buf, ESP_ERR_NO_MEM, TAG, "Allocate strip buffer failed");
+    }
+
+    ppa_srm_oper_config_t srm_config = {
+        .in.srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        .out = {
+            .buffer = out,
+            .buffer_size = out_size,
+            .pic_w = out_w,
+            .pic_h = out_h,
+            .block_offset_x = out_x,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+
+    for (uint32_t strip_y = rect->y; strip_y < rect->y + rect->h; strip_y += strip_rows) {
+        uint32_t rows = MIN(strip_rows, rect->y + rect->h - strip_y);
+        uint32_t sr0 = strip_y / handle->seg_h;
+        uint32_t sc0 = rect->x / handle->seg_w;
+        uint8_t *dec_buf = NULL;
+        uint32_t pic_w = 0;
+        uint32_t pic_h = 0;
+
+        /* The last rows of the region can be too few to give a row once scaled */
+        if (image_region_scaled(rows, scale) == 0) {
+            break;
+        }
+        ESP_GOTO_ON_ERROR(region_decode_strip(handle, sr0, DIV_UP(strip_y + rows, handle->seg_h), sc0,
+                                              DIV_UP(rect->x + rect->w, handle->seg_w), &dec_buf, &pic_w, &pic_h),
+                          end, TAG, "Decode strip failed");
+
+        srm_config.in.buffer = dec_buf;
+        srm_config.in.pic_w = pic_w;
+        srm_config.in.pic_h = pic_h;
+        srm_config.in.block_w = rect->w;
+        srm_config.in.block_h = rows;
+        srm_config.in.block_offset_x = rect->x - sc0 * handle->seg_w;
+        srm_config.in.block_offset_y = strip_y - sr0 * handle->seg_h;
+        srm_config.out.block_offset_y = out_y + image_region_scaled(strip_y - rect->y, scale);
+        if (direct) {
+            srm_config.scale_x = (float)(scale->num >> scale->shift) / IMAGE_REGION_SCALE_STEP;
+            srm_config.scale_y = srm_config.scale_x;
+            ret = ppa_do_scale_rotate_mirror(ppa, &srm_config);
+        } else {
+            ppa_srm_oper_config_t half_config = srm_config;
+
+            half_config.out.buffer = tmp_buf;
+            half_config.out.buffer_size = tmp_size;
+            half_config.out.pic_w = tmp_w;
+            half_config.out.pic_h = rows >> scale->shift;
+            half_config.out.block_offset_x = 0;
+            half_config.out.block_offset_y = 0;
+            half_config.scale_x = 1.0f / (1 << scale->shift);
+            half_config.scale_y = half_config.scale_x;
+            ret = ppa_do_scale_rotate_mirror(ppa, &half_config);
+            if (ret == ESP_OK) {
+                srm_config.in.buffer = tmp_buf;
+                srm_config.in.pic_w = tmp_w;
+                srm_config.in.pic_h = rows >> scale->shift;
+                srm_config.in.block_w = tmp_w;
+                srm_config.in.block_h = rows >> scale->shift;
+                srm_config.in.block_offset_x = 0;
+                srm_config.in.block_offset_y = 0;
+                srm_config.scale_x = (float)scale->num / IMAGE_REGION_SCALE_STEP;
+                srm_config.scale_y = srm_config.scale_x;
+                ret = ppa_do_scale_rotate_mirror(ppa, &srm_config);
+            }
+        }
+        jpeg_dec_service_buf_put(dec_buf);
+        ESP_GOTO_ON_ERROR(ret, end, TAG, "Scale strip failed");
+    }
+
+end:
+    jpeg_dec_service_buf_put(tmp_buf);
+
+    return ret;
+}
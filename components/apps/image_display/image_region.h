@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/ppa.h"
+#include "image_exif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_REGION_SCALE_STEP     (16)    /*!< PPA scaling factors have a 1/16 precision */
+#define IMAGE_REGION_SHIFT_MAX      (4)     /*!< Halvings that are still exact in 1/16 steps */
+
+typedef struct image_region *image_region_handle_t;
+
+/**
+ * @brief Scaling factor of a region, `num / (IMAGE_REGION_SCALE_STEP << shift)`
+ *
+ * The region is halved `shift` times first, then scaled by `num` 1/16 steps, so small factors keep their precision.
+ */
+typedef struct {
+    uint16_t    num;        /*!< Factor of the halved region, in 1/`IMAGE_REGION_SCALE_STEP` */
+    uint8_t     shift;      /*!< Halvings, at most `IMAGE_REGION_SHIFT_MAX` */
+} image_region_scale_t;
+
+/**
+ * @brief Rectangle of the image, in image pixels
+ */
+typedef struct {
+    uint32_t    x;
+    uint32_t    y;
+    uint32_t    w;
+    uint32_t    h;
+} image_region_rect_t;
+
+/**
+ * @brief Index the restart intervals of a baseline JPEG
+ *
+ * The file is scanned once for its restart markers, the compressed data stays on the storage. Only the intervals
+ * under a region are read to decode it, as a small JPEG the hardware decoder takes whole. The intervals must cover
+ * whole MCU rows or split them evenly, and be at most a few MCU rows high.
+ *
+ * @param path          JPEG file
+ * @param ret_handle    Output handle
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NO_MEM         Out of memory
+ *      - ESP_ERR_NOT_SUPPORTED  Not a baseline JPEG, no restart markers or intervals that don't fit the MCU rows
+ *      - ESP_FAIL               Failed to read the file, or invalid image data
+ */
+esp_err_t image_region_open(const char *path, image_region_handle_t *ret_handle);
+
+/**
+ * @brief Close the file and free the index
+ */
+void image_region_close(image_region_handle_t handle);
+
+/**
+ * @brief Read the size and the EXIF orientation of a JPEG from its header, without indexing it
+ *
+ * @param path          JPEG file
+ * @param width         Stored width
+ * @param height        Stored height
+ * @param orientation   Orientation from the EXIF segment before the frame header, can be NULL
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if no baseline frame header is found, or ESP_FAIL
+ */
+esp_err_t image_region_get_info(const char *path, uint32_t *width, uint32_t *height,
+                                image_orientation_t *orientation);
+
+/**
+ * @brief Get the stored size of the indexed image
+ */
+void image_region_get_size(image_region_handle_t handle, uint32_t *width, uint32_t *height);
+
+/**
+ * @brief Get the EXIF orientation of the indexed image, the regions are decoded as stored
+ */
+image_orientation_t image_region_get_orientation(image_region_handle_t handle);
+
+/**
+ * @brief Largest scale that does not exceed a factor
+ *
+ * @param factor    Wanted factor, from 1/256 up
+ * @param scale     Output scale
+ */
+void image_region_scale_from(float factor, image_region_scale_t *scale);
+
+/**
+ * @brief Apply a scale to a length, rounded down like the PPA does
+ */
+static inline uint32_t image_region_scaled(uint32_t len, const image_region_scale_t *scale)
+{
+    return (uint32_t)(((uint64_t)len * scale->num) / ((uint32_t)IMAGE_REGION_SCALE_STEP << scale->shift));
+}
+
+/**
+ * @brief Decode a region of the image, scaled, into an RGB565 picture
+ *
+ * The region is decoded in strips by the shared JPEG decoder, each strip is scaled by the PPA into its rows of the
+ * picture, so the decoder buffers stay a few rows of the region high. The shared decoder must be acquired by the
+ * caller. Blocks until the region is written.
+ *
+ * @param handle        Indexed image
+ * @param ppa           SRM client of the caller
+ * @param rect          Region, inside the image
+ * @param scale         Scale of the region
+ * @param out           Output picture, DMA capable and aligned to the cache line
+ * @param out_size      Size of `out`
+ * @param out_w         Width of the output picture
+ * @param out_h         Height of the output picture
+ * @param out_x         Column of the region in the output picture
+ * @param out_y         Row of the region in the output picture
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_ARG    Region outside the image, or the scaled region outside the picture
+ *      - ESP_ERR_NO_MEM         Out of decoder buffers
+ *      - ESP_FAIL               Failed to read the file
+ *      - Others                 Error of the decoder or of the PPA
+ */
+esp_err_t image_region_decode(image_region_handle_t handle, ppa_client_handle_t ppa, const image_region_rect_t *rect,
+                              const image_region_scale_t *scale, uint8_t *out, size_t out_size, uint32_t out_w,
+                              uint32_t out_h, uint32_t out_x, uint32_t out_y);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "bsp/esp-bsp.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "image_decode.h"
+#include "image_thumb.h"
+
+#define THUMB_DIR                   BSP_SD_MOUNT_POINT "/.thumbs"
+#define THUMB_PATH_MAX              (256)
+#define THUMB_MAGIC                 (0x424D4854)    /* "THMB" */
+#define THUMB_VERSION               (1)
+
+/* Compared as a whole with memcmp, the fields leave no padding */
+typedef struct {
+    int64_t     src_mtime;      /*!< Modification time of the image */
+    uint32_t    magic;          /*!< THUMB_MAGIC */
+    uint16_t    version;        /*!< THUMB_VERSION */
+    uint16_t    size;           /*!< IMAGE_THUMB_SIZE when generated */
+    uint32_t    src_size;       /*!< Size of the image */
+    uint32_t    reserved;       /*!< Always 0 */
+} thumb_header_t;
+
+static const char *TAG = "image_thumb";
+
+static void thumb_cache_path(const char *path, char *cache_path, size_t size)
+{
+    const char *name = strrchr(path, '/');
+
+    snprintf(cache_path, size, THUMB_DIR "/%s.thm", name ? name + 1 : path);
+}
+
+static bool thumb_cache_read(const char *cache_path, const thumb_header_t *expected, uint8_t *thumb)
+{
+    thumb_header_t header;
+    bool valid = false;
+    FILE *fp = fopen(cache_path, "rb");
+
+    if (fp == NULL) {
+        return false;
+    }
+    if ((fread(&header, 1, sizeof(header), fp) == sizeof(header)) &&
+            (memcmp(&header, expected, sizeof(header)) == 0)) {
+        valid = (fread(thumb, 1, IMAGE_THUMB_BUF_SIZE, fp) == IMAGE_THUMB_BUF_SIZE);
+    }
+    fclose(fp);
+
+    return valid;
+}
+
+static void thumb_cache_write(const char *cache_path, const thumb_header_t *header, const uint8_t *thumb)
+{
+    if ((mkdir(THUMB_DIR, 0775) != 0) && (errno != EEXIST)) {
+        ESP_LOGD(TAG, "No thumbnail cache on the SD card");
+        return;
+    }
+
+    FILE *fp = fopen(cache_path, "wb");
+    if (fp == NULL) {
+        ESP_LOGW(TAG, "Create %s failed", cache_path);
+        return;
+    }
+    bool written = (fwrite(header, 1, sizeof(thumb_header_t), fp) == sizeof(thumb_header_t)) &&
+                   (fwrite(thumb, 1, IMAGE_THUMB_BUF_SIZE, fp) == IMAGE_THUMB_BUF_SIZE);
+    fclose(fp);
+    if (!written) {
+        /* A truncated file fails validation anyway, it is removed to free the space */
+        ESP_LOGW(TAG, "Write %s failed", cache_path);
+        remove(cache_path);
+    }
+}
+
+esp_err_t image_thumb_load(const char *path, uint8_t *thumb)
+{
+    char cache_path[THUMB_PATH_MAX];
+    struct stat st;
+    image_frame_t frame = {0};
+
+    ESP_RETURN_ON_FALSE(path && thumb, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(stat(path, &st) == 0, ESP_FAIL, TAG, "Stat %s failed", path);
+
+    thumb_header_t header = {
+        .src_mtime = (int64_t)st.st_mtime,
+        .magic = THUMB_MAGIC,
+        .version = THUMB_VERSION,
+        .size = IMAGE_THUMB_SIZE,
+        .src_size = (uint32_t)st.st_size,
+    };
+    thumb_cache_path(path, cache_path, sizeof(cache_path));
+    if (thumb_cache_read(cache_path, &header, thumb)) {
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(image_decode_file(path, IMAGE_THUMB_SIZE, IMAGE_THUMB_SIZE, &frame, NULL), TAG,
+                        "Decode %s failed", path);
+
+    /* Centered on black, the scaled image keeps its aspect ratio */
+    uint32_t off_x = (IMAGE_THUMB_SIZE - frame.width) / 2;
+    uint32_t off_y = (IMAGE_THUMB_SIZE - frame.height) / 2;
+    memset(thumb, 0, IMAGE_THUMB_BUF_SIZE);
+    for (uint32_t y = 0; y < frame.height; y++) {
+        memcpy(thumb + ((off_y + y) * IMAGE_THUMB_SIZE + off_x) * 2, frame.buf + y * frame.width * 2,
+               frame.width * 2);
+    }
+    jpeg_dec_service_buf_put(frame.buf);
+
+    thumb_cache_write(cache_path, &header, thumb);
+
+    return ESP_OK;
+}
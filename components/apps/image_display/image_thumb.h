@@ -0,0 +1,35 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_THUMB_SIZE            (120)   /*!< Width and height of a thumbnail */
+#define IMAGE_THUMB_BUF_SIZE        (IMAGE_THUMB_SIZE * IMAGE_THUMB_SIZE * 2)   /*!< Bytes of an RGB565 thumbnail */
+
+/**
+ * @brief Get the thumbnail of an image file
+ *
+ * Thumbnails are kept on the SD card (`.thumbs` at its root) and checked against the size and the modification time
+ * of the image. A missing or stale one is generated with `image_decode_file` and saved, so the image is decoded only
+ * once. Without SD card the thumbnail is generated on every call.
+ *
+ * @param path  JPEG or PNG file
+ * @param thumb RGB565 buffer of `IMAGE_THUMB_BUF_SIZE` bytes, the image is centered on black
+ *
+ * @return ESP_OK on success, or the error of `image_decode_file`
+ */
+esp_err_t image_thumb_load(const char *path, uint8_t *thumb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,556 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "driver/ppa.h"
+#include "media_arena/media_arena.h"
+#include "task_config/task_config.h"
+#include "image_tiles.h"
+
+#define DIV_UP(num, div)            (((num) + (div) - 1) / (div))
+
+#define TILES_NUM_MIN               (4)
+#define TILES_NUM_MAX               (64)
+#define TILE_BUF_SIZE               (IMAGE_TILES_SIZE * IMAGE_TILES_SIZE * 2)
+#define TILES_PATH_MAX              (256)
+
+typedef enum {
+    TILE_FREE = 0,
+    TILE_DECODING,                  /*!< Written by the task, not drawn */
+    TILE_READY,
+} tile_state_t;
+
+typedef struct {
+    uint8_t     level;              /*!< Halvings of the image */
+    uint16_t    x;                  /*!< Column of the tile in its level */
+    uint16_t    y;                  /*!< Row of the tile in its level */
+} tile_key_t;
+
+typedef struct {
+    tile_state_t state;
+    tile_key_t  key;
+    uint32_t    gen;                /*!< Image the tile was decoded for */
+    uint16_t    width;              /*!< Pixels of the tile inside the image, smaller on the last row and column */
+    uint16_t    height;
+    uint32_t    drawn;              /*!< Last view that drew it, the tiles of the last view are never evicted */
+    uint8_t     *buf;
+} tile_t;
+
+static const char *TAG = "image_tiles";
+
+static image_tiles_ready_cb_t tiles_ready_cb = NULL;
+static void *tiles_ready_ctx = NULL;
+static uint32_t tiles_num = 0;
+static tile_t tiles[TILES_NUM_MAX];
+static uint8_t *tiles_pool = NULL;          /* Owned by the task, `tiles_num` tiles while an image is set */
+/* The task and the LVGL task scale with their own client, a client serves one transaction at a time */
+static ppa_client_handle_t tiles_decode_ppa = NULL;
+static ppa_client_handle_t tiles_render_ppa = NULL;
+static ppa_client_handle_t tiles_fill_ppa = NULL;
+static bool tiles_exit = false;
+static TaskHandle_t tiles_task_handle = NULL;
+static SemaphoreHandle_t tiles_idle = NULL; /* Given by the task when it exits */
+
+/* Guarded by the lock, shared by the task and the LVGL task */
+static SemaphoreHandle_t tiles_lock = NULL;
+static dir_index_handle_t tiles_images = NULL;
+static int tiles_index = -1;
+static bool tiles_index_changed = false;
+static uint32_t tiles_gen = 0;              /* Counts the image changes */
+static bool tiles_ready = false;            /* The image is indexed and the tiles allocated */
+static uint32_t tiles_width = 0;
+static uint32_t tiles_height = 0;
+static uint32_t tiles_view = 0;             /* Counts the views drawn */
+static tile_key_t tiles_wanted[TILES_NUM_MAX];
+static uint32_t tiles_wanted_num = 0;
+
+/* Owned by the task */
+static image_region_handle_t tiles_region = NULL;
+
+static bool tile_key_equal(const tile_key_t *a, const tile_key_t *b)
+{
+    return (a->level == b->level) && (a->x == b->x) && (a->y == b->y);
+}
+
+static tile_t *tile_find(const tile_key_t *key)
+{
+    for (uint32_t i = 0; i < tiles_num; i++) {
+        if ((tiles[i].state != TILE_FREE) && tile_key_equal(&tiles[i].key, key)) {
+            return &tiles[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* A free tile, or the one drawn the longest ago, never one of the last view */
+static tile_t *tile_reserve(void)
+{
+    tile_t *victim = NULL;
+
+    for (uint32_t i = 0; i < tiles_num; i++) {
+        tile_t *tile = &tiles[i];
+
+        if (tile->state == TILE_FREE) {
+            return tile;
+        }
+        if ((tile->state == TILE_READY) && (tile->drawn != tiles_view) &&
+                ((victim == NULL) || ((int32_t)(tile->drawn - victim->drawn) < 0))) {
+            victim = tile;
+        }
+    }
+
+    return victim;
+}
+
+static void tiles_release_pool(void)
+{
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    memset(tiles, 0, sizeof(tiles));
+    tiles_num = 0;
+    xSemaphoreGive(tiles_lock);
+
+    media_arena_return(tiles_pool);
+    tiles_pool = NULL;
+}
+
+/* Indexes the new image, the tiles of the previous one are all dropped */
+static void tiles_switch(dir_index_handle_t images, int index, uint32_t gen, size_t budget)
+{
+    char path[TILES_PATH_MAX];
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    image_region_close(tiles_region);
+    tiles_region = NULL;
+    if (index < 0) {
+        tiles_release_pool();
+        return;
+    }
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    for (uint32_t i = 0; i < tiles_num; i++) {
+        tiles[i].state = TILE_FREE;
+    }
+    xSemaphoreGive(tiles_lock);
+
+    if ((dir_index_get_path(images, index, path, sizeof(path)) != ESP_OK) ||
+            (image_region_open(path, &tiles_region) != ESP_OK)) {
+        /* The views of the image only show its preview */
+        ESP_LOGI(TAG, "Image %d has no tiles", index);
+        return;
+    }
+    if (image_region_get_orientation(tiles_region) != IMAGE_ORIENTATION_NORMAL) {
+        /* Tiles are decoded as stored, the preview is upright */
+        ESP_LOGI(TAG, "Image %d is turned, no tiles", index);
+        image_region_close(tiles_region);
+        tiles_region = NULL;
+        return;
+    }
+    image_region_get_size(tiles_region, &width, &height);
+
+    if (tiles_pool == NULL) {
+        uint32_t num = MIN(budget / TILE_BUF_SIZE, TILES_NUM_MAX);
+
+        tiles_pool = (uint8_t *)media_arena_lend(num * TILE_BUF_SIZE, NULL);
+        if (tiles_pool == NULL) {
+            ESP_LOGE(TAG, "Allocate %lu tiles failed", (unsigned long)num);
+            image_region_close(tiles_region);
+            tiles_region = NULL;
+            return;
+        }
+        xSemaphoreTake(tiles_lock, portMAX_DELAY);
+        for (uint32_t i = 0; i < num; i++) {
+            tiles[i].buf = tiles_pool + i * TILE_BUF_SIZE;
+        }
+        tiles_num = num;
+        xSemaphoreGive(tiles_lock);
+    }
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    if (tiles_gen == gen) {
+        tiles_width = width;
+        tiles_height = height;
+        tiles_ready = true;
+    }
+    xSemaphoreGive(tiles_lock);
+}
+
+static void tiles_decode(tile_t *tile)
+{
+    uint32_t size = IMAGE_TILES_SIZE << tile->key.level;
+    image_region_rect_t rect = {
+        .x = tile->key.x * size,
+        .y = tile->key.y * size,
+    };
+    image_region_scale_t scale = {
+        .num = IMAGE_REGION_SCALE_STEP,
+        .shift = tile->key.level,
+    };
+
+    rect.w = MIN(size, tiles_width - rect.x);
+    rect.h = MIN(size, tiles_height - rect.y);
+    esp_err_t ret = image_region_decode(tiles_region, tiles_decode_ppa, &rect, &scale, tile->buf, TILE_BUF_SIZE,
+                                        IMAGE_TILES_SIZE, IMAGE_TILES_SIZE, 0, 0);
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    if ((ret == ESP_OK) && (tile->gen == tiles_gen)) {
+        tile->width = image_region_scaled(rect.w, &scale);
+        tile->height = image_region_scaled(rect.h, &scale);
+        tile->state = TILE_READY;
+    } else {
+        tile->state = TILE_FREE;
+    }
+    /* A failed tile is not asked for again until the next view */
+    for (uint32_t i = 0; i < tiles_wanted_num; i++) {
+        if (tile_key_equal(&tiles_wanted[i], &tile->key)) {
+            tiles_wanted_num--;
+            memmove(&tiles_wanted[i], &tiles_wanted[i + 1], (tiles_wanted_num - i) * sizeof(tile_key_t));
+            break;
+        }
+    }
+    xSemaphoreGive(tiles_lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Tile %u,%u of level %u failed", tile->key.x, tile->key.y, tile->key.level);
+    } else if (tiles_ready_cb) {
+        tiles_ready_cb(tiles_ready_ctx);
+    }
+}
+
+/* Returns false when there is nothing left to do */
+static bool tiles_work(size_t budget)
+{
+    tile_t *tile = NULL;
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    if (tiles_index_changed) {
+        dir_index_handle_t images = tiles_images;
+        int index = tiles_index;
+        uint32_t gen = tiles_gen;
+
+        tiles_index_changed = false;
+        xSemaphoreGive(tiles_lock);
+        tiles_switch(images, index, gen, budget);
+        if (tiles_region && tiles_ready_cb) {
+            tiles_ready_cb(tiles_ready_ctx);
+        }
+        return true;
+    }
+
+    /* Wanted from the center of the view out */
+    for (uint32_t i = 0; tiles_ready && (i < tiles_wanted_num); i++) {
+        if (tile_find(&tiles_wanted[i])) {
+            continue;
+        }
+        tile = tile_reserve();
+        if (tile) {
+            tile->state = TILE_DECODING;
+            tile->key = tiles_wanted[i];
+            tile->gen = tiles_gen;
+        }
+        break;
+    }
+    xSemaphoreGive(tiles_lock);
+
+    if (tile == NULL) {
+        return false;
+    }
+    tiles_decode(tile);
+
+    return true;
+}
+
+static void tiles_task(void *arg)
+{
+    size_t budget = (size_t)arg;
+
+    while (!tiles_exit) {
+        if (!tiles_work(budget)) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+
+    image_region_close(tiles_region);
+    tiles_region = NULL;
+    tiles_release_pool();
+    xSemaphoreGive(tiles_idle);
+    task_config_delete(TASK_CONFIG_IMAGE_TILES, NULL);
+}
+
+esp_err_t image_tiles_init(size_t budget, image_tiles_ready_cb_t ready_cb, void *user_ctx)
+{
+    esp_err_t ret = ESP_OK;
+    ppa_client_config_t srm_config = {
+        .oper_type = PPA_OPERATION_SRM,
+    };
+    ppa_client_config_t fill_config = {
+        .oper_type = PPA_OPERATION_FILL,
+    };
+
+    ESP_RETURN_ON_FALSE(budget >= TILES_NUM_MIN * TILE_BUF_SIZE, ESP_ERR_INVALID_ARG, TAG, "Budget too small");
+    ESP_RETURN_ON_FALSE(tiles_task_handle == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    tiles_ready_cb = ready_cb;
+    tiles_ready_ctx = user_ctx;
+    tiles_exit = false;
+    tiles_images = NULL;
+    tiles_index = -1;
+    tiles_index_changed = false;
+    tiles_ready = false;
+    tiles_wanted_num = 0;
+    memset(tiles, 0, sizeof(tiles));
+    tiles_num = 0;
+
+    ESP_GOTO_ON_ERROR(ppa_register_client(&srm_config, &tiles_decode_ppa), err, TAG, "Register PPA client failed");
+    ESP_GOTO_ON_ERROR(ppa_register_client(&srm_config, &tiles_render_ppa), err, TAG, "Register PPA client failed");
+    ESP_GOTO_ON_ERROR(ppa_register_client(&fill_config, &tiles_fill_ppa), err, TAG, "Register PPA client failed");
+    tiles_lock = xSemaphoreCreateMutex();
+    tiles_idle = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(tiles_lock && tiles_idle, ESP_ERR_NO_MEM, err, TAG, "Create lock failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_IMAGE_TILES, tiles_task, (void *)budget,
+                                         &tiles_task_handle) == pdPASS, ESP_ERR_NO_MEM, err, TAG,
+                      "Create task failed");
+
+    return ESP_OK;
+
+err:
+    tiles_task_handle = NULL;
+    image_tiles_deinit();
+
+    return ret;
+}
+
+void image_tiles_deinit(void)
+{
+    if (tiles_task_handle) {
+        tiles_exit = true;
+        xTaskNotifyGive(tiles_task_handle);
+        xSemaphoreTake(tiles_idle, portMAX_DELAY);
+        tiles_task_handle = NULL;
+    }
+    if (tiles_idle) {
+        vSemaphoreDelete(tiles_idle);
+        tiles_idle = NULL;
+    }
+    if (tiles_lock) {
+        vSemaphoreDelete(tiles_lock);
+        tiles_lock = NULL;
+    }
+    ppa_client_handle_t *clients[] = {&tiles_decode_ppa, &tiles_render_ppa, &tiles_fill_ppa};
+    for (int i = 0; i < sizeof(clients) / sizeof(clients[0]); i++) {
+        if (*clients[i]) {
+            ppa_unregister_client(*clients[i]);
+            *clients[i] = NULL;
+        }
+    }
+    tiles_ready = false;
+}
+
+void image_tiles_set_image(dir_index_handle_t images, int index)
+{
+    if (tiles_task_handle == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    if ((index == tiles_index) && (images == tiles_images)) {
+        xSemaphoreGive(tiles_lock);
+        return;
+    }
+    tiles_images = images;
+    tiles_index = index;
+    tiles_index_changed = true;
+    tiles_gen++;
+    /* No tile is drawn from here on, the task may reuse them all */
+    tiles_ready = false;
+    tiles_wanted_num = 0;
+    xSemaphoreGive(tiles_lock);
+    xTaskNotifyGive(tiles_task_handle);
+}
+
+/* Part of a scaled picture that lands inside the output, [start, end) in picture pixels at `pos` on the output */
+static bool render_clip(int32_t origin, uint32_t len, float factor, uint32_t out_len, uint32_t *start, uint32_t *end,
+                        uint32_t *pos)
+{
+    uint32_t first = (origin < 0) ? (uint32_t)ceilf(-origin / factor - 0.001f) : 0;
+    uint32_t last = MIN(len, (uint32_t)MAX(0.0f, floorf(((int32_t)out_len - origin) / factor + 0.001f)));
+
+    if (last <= first) {
+        return false;
+    }
+    *pos = (uint32_t)MAX(0, origin + (int32_t)floorf(first * factor + 0.001f));
+    /* What lands past the output once rounded is left out */
+    last = MIN(last, first + (uint32_t)floorf((out_len - *pos) / factor + 0.001f));
+    *start = first;
+    *end = last;
+
+    return last > first;
+}
+
+/* Draws a picture scaled by `factor` with its top left corner at `x`, `y` of the output */
+static void render_blit(const uint8_t *buf, uint32_t pic_w, uint32_t pic_h, uint32_t w, uint32_t h, int32_t x,
+                        int32_t y, float factor, uint8_t *out, size_t out_size, uint32_t out_w, uint32_t out_h)
+{
+    uint32_t x0, x1, y0, y1, out_x, out_y;
+
+    if (!render_clip(x, w, factor, out_w, &x0, &x1, &out_x) || !render_clip(y, h, factor, out_h, &y0, &y1, &out_y)) {
+        return;
+    }
+    ppa_srm_oper_config_t srm_config = {
+        .in = {
+            .buffer = buf,
+            .pic_w = pic_w,
+            .pic_h = pic_h,
+            .block_w = x1 - x0,
+            .block_h = y1 - y0,
+            .block_offset_x = x0,
+            .block_offset_y = y0,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .out = {
+            .buffer = out,
+            .buffer_size = out_size,
+            .pic_w = out_w,
+            .pic_h = out_h,
+            .block_offset_x = out_x,
+            .block_offset_y = out_y,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = factor,
+        .scale_y = factor,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    if (ppa_do_scale_rotate_mirror(tiles_render_ppa, &srm_config) != ESP_OK) {
+        ESP_LOGD(TAG, "Draw %lux%lu at %ld,%ld failed", (unsigned long)w, (unsigned long)h, (long)x, (long)y);
+    }
+}
+
+/* Stands in for the tiles being decoded, blurry but in place */
+static void render_preview(const image_tiles_view_t *view, const image_frame_t *preview, uint8_t *out,
+                           size_t out_size, uint32_t out_w, uint32_t out_h)
+{
+    float factor = (float)image_region_scaled(preview->src_width * IMAGE_REGION_SCALE_STEP, &view->scale) /
+                   IMAGE_REGION_SCALE_STEP / preview->width;
+    float steps = roundf(factor * IMAGE_REGION_SCALE_STEP);
+
+    /* PPA factors go from 1/16 to 255 in 1/16 steps */
+    if ((preview->buf == NULL) || (steps < 1) || (steps >= 256 * IMAGE_REGION_SCALE_STEP)) {
+        return;
+    }
+    render_blit(preview->buf, preview->width, preview->height, preview->width, preview->height, -view->x, -view->y,
+                steps / IMAGE_REGION_SCALE_STEP, out, out_size, out_w, out_h);
+}
+
+bool image_tiles_render(const image_tiles_view_t *view, const image_frame_t *preview, uint8_t *out, size_t out_size,
+                        uint32_t out_w, uint32_t out_h)
+{
+    tile_t *drawn[TILES_NUM_MAX];
+    uint32_t drawn_num = 0;
+    uint32_t missing = 0;
+
+    ESP_RETURN_ON_FALSE(view && preview && out && view->scale.num, true, TAG, "Invalid argument");
+    if (tiles_task_handle == NULL) {
+        return true;
+    }
+
+    ppa_fill_oper_config_t fill_config = {
+        .out = {
+            .buffer = out,
+            .buffer_size = out_size,
+            .pic_w = out_w,
+            .pic_h = out_h,
+            .fill_cm = PPA_FILL_COLOR_MODE_RGB565,
+        },
+        .fill_block_w = out_w,
+        .fill_block_h = out_h,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    ppa_do_fill(tiles_fill_ppa, &fill_config);
+    render_preview(view, preview, out, out_size, out_w, out_h);
+
+    uint8_t level = view->scale.shift;
+    /* Tiles are drawn from their level, where a tile is exactly `num` 1/16 steps of its size */
+    int32_t tile_len = IMAGE_TILES_SIZE * view->scale.num / IMAGE_REGION_SCALE_STEP;
+    float factor = (float)view->scale.num / IMAGE_REGION_SCALE_STEP;
+
+    xSemaphoreTake(tiles_lock, portMAX_DELAY);
+    tiles_view++;
+    if (tiles_ready) {
+        /* The last image column and row may be less than a pixel of the level */
+        uint32_t tiles_x = DIV_UP(tiles_width >> level, IMAGE_TILES_SIZE);
+        uint32_t tiles_y = DIV_UP(tiles_height >> level, IMAGE_TILES_SIZE);
+        uint32_t tx0 = MAX(view->x, 0) / tile_len;
+        uint32_t ty0 = MAX(view->y, 0) / tile_len;
+        uint32_t tx1 = MIN(tiles_x, (uint32_t)DIV_UP(MAX(view->x + (int32_t)out_w, 0), tile_len));
+        uint32_t ty1 = MIN(tiles_y, (uint32_t)DIV_UP(MAX(view->y + (int32_t)out_h, 0), tile_len));
+        int32_t center_x = (view->x + (int32_t)out_w / 2) / tile_len;
+        int32_t center_y = (view->y + (int32_t)out_h / 2) / tile_len;
+
+        tiles_wanted_num = 0;
+        /* Zoomed out too far for the budget, the preview is shown alone */
+        if ((tx1 > tx0) && (ty1 > ty0) && ((tx1 - tx0) * (ty1 - ty0) <= tiles_num)) {
+            for (uint32_t ty = ty0; ty < ty1; ty++) {
+                for (uint32_t tx = tx0; tx < tx1; tx++) {
+                    tile_key_t key = {
+                        .level = level,
+                        .x = tx,
+                        .y = ty,
+                    };
+                    tile_t *tile = tile_find(&key);
+
+                    if (tile && (tile->state == TILE_READY)) {
+                        tile->drawn = tiles_view;
+                        drawn[drawn_num++] = tile;
+                        continue;
+                    }
+                    missing++;
+                    if (tile == NULL) {
+                        tiles_wanted[tiles_wanted_num++] = key;
+                    }
+                }
+            }
+        }
+        /* Closest to the center first, the view is filled from where the eye is */
+        for (uint32_t i = 1; i < tiles_wanted_num; i++) {
+            tile_key_t key = tiles_wanted[i];
+            int32_t dist = abs(key.x - center_x) + abs(key.y - center_y);
+            uint32_t j = i;
+
+            while ((j > 0) && (abs(tiles_wanted[j - 1].x - center_x) + abs(tiles_wanted[j - 1].y - center_y) > dist)) {
+                tiles_wanted[j] = tiles_wanted[j - 1];
+                j--;
+            }
+            tiles_wanted[j] = key;
+        }
+    }
+    bool wake = (tiles_wanted_num > 0);
+    xSemaphoreGive(tiles_lock);
+    if (wake) {
+        xTaskNotifyGive(tiles_task_handle);
+    }
+
+    /* The tiles of this view are not evicted before the next one is drawn */
+    for (uint32_t i = 0; i < drawn_num; i++) {
+        const tile_t *tile = drawn[i];
+
+        render_blit(tile->buf, IMAGE_TILES_SIZE, IMAGE_TILES_SIZE, tile->width, tile->height,
+                    tile->key.x * tile_len - view->x, tile->key.y * tile_len - view->y, factor, out, out_size, out_w,
+                    out_h);
+    }
+
+    return missing == 0;
+}
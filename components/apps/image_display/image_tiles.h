@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "dir_index/dir_index.h"
+#include "image_decode.h"
+#include "image_region.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_TILES_SIZE            (256)   /*!< Tiles are square, in pixels of their level */
+
+/**
+ * @brief Called from the tiles task each time a tile has been decoded, or the image is ready for tiles
+ *
+ * @param user_ctx  Context given to `image_tiles_init`
+ */
+typedef void (*image_tiles_ready_cb_t)(void *user_ctx);
+
+/**
+ * @brief Part of the image shown on the output
+ */
+typedef struct {
+    image_region_scale_t scale;     /*!< Output pixels per image pixel */
+    int32_t x;                      /*!< Column of the scaled image at the left edge of the output, negative when a
+                                         narrower image is centered */
+    int32_t y;                      /*!< Row of the scaled image at the top edge of the output */
+} image_tiles_view_t;
+
+/**
+ * @brief Start the tiles task
+ *
+ * The image is cut in levels halving its size, each level in tiles decoded from the restart intervals under them
+ * with `image_region.h`. A view only needs the tiles of the level right above its scale, the budget holds them and
+ * keeps the tiles seen last. The shared JPEG decoder must be acquired by the caller for the lifetime of the tiles.
+ *
+ * @param budget        Bytes of tiles kept at most, allocated only while an image is set
+ * @param ready_cb      Decode notification, can be NULL
+ * @param user_ctx      Context passed to `ready_cb`
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_ARG    Budget below a few tiles
+ *      - ESP_ERR_INVALID_STATE  Already started
+ *      - ESP_ERR_NO_MEM         Failed to create the task
+ *      - Others                 Error of the PPA driver
+ */
+esp_err_t image_tiles_init(size_t budget, image_tiles_ready_cb_t ready_cb, void *user_ctx);
+
+/**
+ * @brief Stop the tiles task and free the tiles
+ */
+void image_tiles_deinit(void);
+
+/**
+ * @brief Set the image decoded in tiles
+ *
+ * Returns at once, the task indexes the image and allocates the tiles, then calls `ready_cb`. Images that can't be
+ * decoded in regions, like PNGs, JPEGs without restart markers or with an EXIF orientation, have no tiles and their
+ * views only show the preview. Must be called from LVGL context.
+ *
+ * @param images    Listing of the image
+ * @param index     Index of the image in the listing, -1 to drop the tiles and their memory
+ */
+void image_tiles_set_image(dir_index_handle_t images, int index);
+
+/**
+ * @brief Draw a view of the image into an RGB565 output
+ *
+ * The preview, a small frame of the whole image, is scaled under the view first, then the tiles of the view that
+ * are decoded are drawn over it. The missing ones are decoded by the task, from the center of the output out. Tiles
+ * of an older view may be evicted once a view doesn't draw them. Must be called from LVGL context.
+ *
+ * @param view      View to draw
+ * @param preview   Whole image scaled down, from `image_decode_file`
+ * @param out       Output picture, DMA capable and aligned to the cache line
+ * @param out_size  Size of `out`
+ * @param out_w     Output width
+ * @param out_h     Output height
+ *
+ * @return true if every tile of the view was drawn, false if some are still to be decoded
+ */
+bool image_tiles_render(const image_tiles_view_t *view, const image_frame_t *preview, uint8_t *out, size_t out_size,
+                        uint32_t out_w, uint32_t out_h);
+
+#ifdef __cplusplus
+}
+#endif
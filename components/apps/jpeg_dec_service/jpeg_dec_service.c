@@ -0,0 +1,296 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "media_arena/media_arena.h"
+#include "task_config/task_config.h"
+#include "jpeg_dec_service.h"
+
+#define SERVICE_POOL_SIZE           (12)
+#define SERVICE_QUEUE_LEN           (4)
+#define SERVICE_TIMEOUT_MS          (1000)
+
+typedef struct {
+    uint8_t                             *buf;
+    size_t                              size;
+    jpeg_dec_buffer_alloc_direction_t   direction;
+    bool                                in_use;
+} service_pool_entry_t;
+
+static const char *TAG = "jpeg_dec_service";
+
+static jpeg_decoder_handle_t service_engine = NULL;
+static QueueHandle_t service_queue = NULL;
+static SemaphoreHandle_t service_lock = NULL;     /* Serializes the engine between the task and sync callers */
+static SemaphoreHandle_t service_idle = NULL;     /* Given by the task when it exits */
+static SemaphoreHandle_t service_ref_lock = NULL;    /* Guards the reference count, created on first use */
+static uint32_t service_refs = 0;
+static service_pool_entry_t service_pool[SERVICE_POOL_SIZE];
+static portMUX_TYPE service_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static void service_ref_lock_take(void)
+{
+    SemaphoreHandle_t lock = __atomic_load_n(&service_ref_lock, __ATOMIC_ACQUIRE);
+
+    if (lock == NULL) {
+        SemaphoreHandle_t expected = NULL;
+        lock = xSemaphoreCreateMutex();
+        assert(lock);
+        /* Apps may acquire concurrently, only one mutex is kept */
+        if (!__atomic_compare_exchange_n(&service_ref_lock, &expected, lock, false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE)) {
+            vSemaphoreDelete(lock);
+            lock = expected;
+        }
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+}
+
+static esp_err_t service_run(const jpeg_dec_service_job_t *job, uint32_t *out_len)
+{
+    uint32_t len = 0;
+
+    xSemaphoreTake(service_lock, portMAX_DELAY);
+    esp_err_t ret = jpeg_decoder_process(service_engine, &job->cfg, job->in, job->in_size, job->out, job->out_size, &len);
+    xSemaphoreGive(service_lock);
+    if (out_len) {
+        *out_len = len;
+    }
+
+    return ret;
+}
+
+static void service_task(void *arg)
+{
+    jpeg_dec_service_job_t job;
+
+    while (1) {
+        xQueueReceive(service_queue, &job, portMAX_DELAY);
+        /* A job without input is the exit request of the last release */
+        if (job.in == NULL) {
+            break;
+        }
+
+        uint32_t out_len = 0;
+        esp_err_t ret = service_run(&job, &out_len);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Decode failed (%s)", esp_err_to_name(ret));
+        }
+        if (job.done_cb) {
+            job.done_cb(ret, out_len, job.user_ctx);
+        }
+    }
+
+    xSemaphoreGive(service_idle);
+    task_config_delete(TASK_CONFIG_JPEG_DECODE, NULL);
+}
+
+esp_err_t jpeg_dec_service_acquire(void)
+{
+    esp_err_t ret = ESP_OK;
+    jpeg_decode_engine_cfg_t engine_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = SERVICE_TIMEOUT_MS,
+    };
+
+    service_ref_lock_take();
+    if (service_refs++ > 0) {
+        xSemaphoreGive(service_ref_lock);
+        return ESP_OK;
+    }
+
+    service_lock = xSemaphoreCreateMutex();
+    service_idle = xSemaphoreCreateBinary();
+    service_queue = xQueueCreate(SERVICE_QUEUE_LEN, sizeof(jpeg_dec_service_job_t));
+    ESP_GOTO_ON_FALSE(service_lock && service_idle && service_queue, ESP_ERR_NO_MEM, err, TAG, "Create queue failed");
+    ESP_GOTO_ON_ERROR(jpeg_new_decoder_engine(&engine_cfg, &service_engine), err, TAG, "Create decoder engine failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_JPEG_DECODE, service_task, NULL, NULL) == pdPASS, ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+    ESP_LOGI(TAG, "Decoder engine created");
+    xSemaphoreGive(service_ref_lock);
+
+    return ESP_OK;
+
+err:
+    if (service_engine) {
+        jpeg_del_decoder_engine(service_engine);
+        service_engine = NULL;
+    }
+    if (service_queue) {
+        vQueueDelete(service_queue);
+        service_queue = NULL;
+    }
+    if (service_idle) {
+        vSemaphoreDelete(service_idle);
+        service_idle = NULL;
+    }
+    if (service_lock) {
+        vSemaphoreDelete(service_lock);
+        service_lock = NULL;
+    }
+    service_refs = 0;
+    xSemaphoreGive(service_ref_lock);
+
+    return ret;
+}
+
+void jpeg_dec_service_release(void)
+{
+    jpeg_dec_service_job_t exit_job = {0};
+
+    service_ref_lock_take();
+    if ((service_refs == 0) || (--service_refs > 0)) {
+        xSemaphoreGive(service_ref_lock);
+        return;
+    }
+
+    /* Queued behind the pending jobs, so all of them complete first */
+    xQueueSend(service_queue, &exit_job, portMAX_DELAY);
+    xSemaphoreTake(service_idle, portMAX_DELAY);
+
+    jpeg_del_decoder_engine(service_engine);
+    service_engine = NULL;
+    vQueueDelete(service_queue);
+    service_queue = NULL;
+    vSemaphoreDelete(service_idle);
+    service_idle = NULL;
+    vSemaphoreDelete(service_lock);
+    service_lock = NULL;
+    jpeg_dec_service_buf_trim();
+    ESP_LOGI(TAG, "Decoder engine deleted");
+    xSemaphoreGive(service_ref_lock);
+}
+
+esp_err_t jpeg_dec_service_decode(const jpeg_dec_service_job_t *job, uint32_t *out_len)
+{
+    ESP_RETURN_ON_FALSE(job && job->in && job->out, ESP_ERR_INVALID_ARG, TAG, "Invalid job");
+    ESP_RETURN_ON_FALSE(service_engine, ESP_ERR_INVALID_STATE, TAG, "Not acquired");
+
+    return service_run(job, out_len);
+}
+
+esp_err_t jpeg_dec_service_submit(const jpeg_dec_service_job_t *job, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(job && job->in && job->out, ESP_ERR_INVALID_ARG, TAG, "Invalid job");
+    ESP_RETURN_ON_FALSE(service_queue, ESP_ERR_INVALID_STATE, TAG, "Not acquired");
+
+    if (xQueueSend(service_queue, job, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+uint8_t *jpeg_dec_service_buf_get(jpeg_dec_buffer_alloc_direction_t direction, size_t size, size_t *actual_size)
+{
+    service_pool_entry_t *best = NULL;
+    service_pool_entry_t *empty = NULL;
+
+    /* The smallest free buffer that fits is reused */
+    portENTER_CRITICAL(&service_spinlock);
+    for (int i = 0; i < SERVICE_POOL_SIZE; i++) {
+        service_pool_entry_t *entry = &service_pool[i];
+        if (entry->buf == NULL) {
+            empty = empty ? empty : entry;
+        } else if (!entry->in_use && (entry->direction == direction) && (entry->size >= size) &&
+                   ((best == NULL) || (entry->size < best->size))) {
+            best = entry;
+        }
+    }
+    if (best) {
+        best->in_use = true;
+    } else if (empty) {
+        /* Reserved while the allocation runs outside the critical section */
+        empty->in_use = true;
+        empty->buf = (uint8_t *)1;
+    }
+    portEXIT_CRITICAL(&service_spinlock);
+
+    if (best) {
+        if (actual_size) {
+            *actual_size = best->size;
+        }
+        return best->buf;
+    }
+    ESP_RETURN_ON_FALSE(empty, NULL, TAG, "Buffer pool full");
+
+    size_t alloc_size = 0;
+#if CONFIG_MEDIA_ARENA
+    /* Slabs are aligned like the decoder memory */
+    uint8_t *buf = (uint8_t *)media_arena_lend(size, &alloc_size);
+#else
+    jpeg_decode_memory_alloc_cfg_t mem_cfg = {
+        .buffer_direction = direction,
+    };
+    uint8_t *buf = (uint8_t *)jpeg_alloc_decoder_mem(size, &mem_cfg, &alloc_size);
+#endif
+
+    portENTER_CRITICAL(&service_spinlock);
+    empty->buf = buf;
+    empty->size = alloc_size;
+    empty->direction = direction;
+    empty->in_use = (buf != NULL);
+    portEXIT_CRITICAL(&service_spinlock);
+    ESP_RETURN_ON_FALSE(buf, NULL, TAG, "Allocate %u bytes failed", (unsigned)size);
+
+    if (actual_size) {
+        *actual_size = alloc_size;
+    }
+
+    return buf;
+}
+
+void jpeg_dec_service_buf_put(uint8_t *buf)
+{
+    if (buf == NULL) {
+        return;
+    }
+
+    /* Slabs go back to the arena at once, the other apps may need them */
+    bool is_slab = media_arena_owns(buf);
+
+    portENTER_CRITICAL(&service_spinlock);
+    for (int i = 0; i < SERVICE_POOL_SIZE; i++) {
+        if (service_pool[i].buf == buf) {
+            if (is_slab) {
+                memset(&service_pool[i], 0, sizeof(service_pool_entry_t));
+            } else {
+                service_pool[i].in_use = false;
+            }
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&service_spinlock);
+
+    if (is_slab) {
+        media_arena_return(buf);
+    }
+}
+
+void jpeg_dec_service_buf_trim(void)
+{
+    for (int i = 0; i < SERVICE_POOL_SIZE; i++) {
+        uint8_t *buf = NULL;
+
+        portENTER_CRITICAL(&service_spinlock);
+        if (service_pool[i].buf && !service_pool[i].in_use) {
+            buf = service_pool[i].buf;
+            memset(&service_pool[i], 0, sizeof(service_pool_entry_t));
+        }
+        portEXIT_CRITICAL(&service_spinlock);
+
+        /* Pool buffers are never slabs, this frees them to the heap */
+        media_arena_return(buf);
+    }
+}
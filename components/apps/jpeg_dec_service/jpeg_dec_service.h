@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/jpeg_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Completion callback of an asynchronous decode, called from the service task
+ *
+ * @param result    ESP_OK or the error of the decoder
+ * @param out_len   Bytes written to the output buffer
+ * @param user_ctx  Context given with the job
+ */
+typedef void (*jpeg_dec_service_done_cb_t)(esp_err_t result, uint32_t out_len, void *user_ctx);
+
+/**
+ * @brief Decode job
+ */
+typedef struct {
+    const uint8_t               *in;        /*!< JPEG data, from `jpeg_dec_service_buf_get` or `jpeg_alloc_decoder_mem` */
+    uint32_t                    in_size;    /*!< Size of the JPEG data */
+    uint8_t                     *out;       /*!< Output buffer, from `jpeg_dec_service_buf_get` or `jpeg_alloc_decoder_mem` */
+    uint32_t                    out_size;   /*!< Size of the output buffer */
+    jpeg_decode_cfg_t           cfg;        /*!< Output format of the decoder */
+    jpeg_dec_service_done_cb_t  done_cb;    /*!< Completion callback, can be NULL */
+    void                        *user_ctx;  /*!< Context passed to `done_cb` */
+} jpeg_dec_service_job_t;
+
+/**
+ * @brief Take a reference on the shared decoder
+ *
+ * The first reference creates the hardware decoder engine and the service task, both persist until the last
+ * reference is dropped.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NO_MEM         Failed to create the task or its queue
+ *      - Others                 Failed to create the decoder engine
+ */
+esp_err_t jpeg_dec_service_acquire(void);
+
+/**
+ * @brief Drop a reference on the shared decoder
+ *
+ * The last reference waits for the queued jobs and frees the engine and the unused pool buffers.
+ */
+void jpeg_dec_service_release(void);
+
+/**
+ * @brief Decode and wait for the result
+ *
+ * @param job   Job to run, `done_cb` is ignored
+ * @param out_len Bytes written to the output buffer, can be NULL
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE without a reference, or the error of the decoder
+ */
+esp_err_t jpeg_dec_service_decode(const jpeg_dec_service_job_t *job, uint32_t *out_len);
+
+/**
+ * @brief Queue a decode, `done_cb` is called from the service task when it is done
+ *
+ * @param job       Job to run, copied. Its buffers must stay valid until `done_cb`
+ * @param timeout_ms Time to wait for room in the queue
+ *
+ * @return ESP_OK if queued, ESP_ERR_TIMEOUT if the queue stayed full
+ */
+esp_err_t jpeg_dec_service_submit(const jpeg_dec_service_job_t *job, uint32_t timeout_ms);
+
+/**
+ * @brief Get a DMA-capable buffer from the shared pool
+ *
+ * A free pool buffer of the same direction and at least `size` bytes is reused, otherwise a new one is allocated
+ * with `jpeg_alloc_decoder_mem` and kept in the pool. With `CONFIG_MEDIA_ARENA` new buffers are lent by the media
+ * arena instead, and slabs go back to the arena when put instead of staying in the pool.
+ *
+ * @param direction     Decoder input or output buffer
+ * @param size          Requested size
+ * @param actual_size   Real size of the buffer, can be NULL
+ *
+ * @return Buffer, NULL if the pool is full or out of memory
+ */
+uint8_t *jpeg_dec_service_buf_get(jpeg_dec_buffer_alloc_direction_t direction, size_t size, size_t *actual_size);
+
+/**
+ * @brief Give a buffer back to the pool
+ */
+void jpeg_dec_service_buf_put(uint8_t *buf);
+
+/**
+ * @brief Free the pool buffers nobody holds
+ */
+void jpeg_dec_service_buf_trim(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "task_config/task_config.h"
+#include "lvgl_draw_offload.h"
+
+#if CONFIG_LVGL_DRAW_OFFLOAD
+static const char *TAG = "lvgl_draw_offload";
+
+typedef void (*offload_blend_cb_t)(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+
+typedef enum {
+    OFFLOAD_BAND_IDLE,
+    OFFLOAD_BAND_POSTED,            /* Waiting for the helper, the LVGL task may take it back */
+    OFFLOAD_BAND_CLAIMED,           /* Blended by the helper, which gives `done` after it */
+} offload_band_state_t;
+
+static struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+    offload_blend_cb_t blend;       /* Blend of the software renderer, run on both bands */
+    /* Band of the helper, written by the LVGL task before `start` is given */
+    lv_draw_ctx_t band_ctx;
+    lv_area_t band_clip;
+    const lv_draw_sw_blend_dsc_t *band_dsc;
+    atomic_int band_state;
+    /* Only written by the LVGL task */
+    lvgl_draw_offload_stats_t stats;
+} s_offload;
+
+static bool offload_is_split(const lv_draw_sw_blend_dsc_t *dsc, const lv_area_t *area)
+{
+    if ((lv_area_get_height(area) < 2) || (lv_area_get_size(area) < CONFIG_LVGL_DRAW_OFFLOAD_MIN_PIXELS)) {
+        return false;
+    }
+    if ((dsc->mask_buf != NULL) && (dsc->mask_res == LV_DRAW_MASK_RES_TRANSP)) {
+        return false;
+    }
+    /* An opaque fill is a memset of the buffer, a second core only shares the same bandwidth */
+    bool masked = (dsc->mask_buf != NULL) && (dsc->mask_res != LV_DRAW_MASK_RES_FULL_COVER);
+    if ((dsc->src_buf == NULL) && !masked && (dsc->opa >= LV_OPA_MAX) && (dsc->blend_mode == LV_BLEND_MODE_NORMAL)) {
+        return false;
+    }
+
+    return true;
+}
+
+static void offload_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc)
+{
+    lv_area_t area;
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+
+    /* `set_px_cb` of the driver is not known to be reentrant */
+    if (!_lv_area_intersect(&area, dsc->blend_area, draw_ctx->clip_area) || (disp == NULL) ||
+            (disp->driver->set_px_cb != NULL) || !offload_is_split(dsc, &area)) {
+        s_offload.stats.inline_num++;
+        s_offload.blend(draw_ctx, dsc);
+        return;
+    }
+
+    /* The blend clips to `clip_area` and offsets the source and mask buffers by itself, each band only needs its
+     * own clip. Both bands write distinct lines of the draw buffer */
+    lv_coord_t mid = area.y1 + lv_area_get_height(&area) / 2;
+    lv_area_t top_clip = area;
+    top_clip.y2 = mid - 1;
+    lv_draw_ctx_t top_ctx = *draw_ctx;
+    top_ctx.clip_area = &top_clip;
+
+    s_offload.band_clip = area;
+    s_offload.band_clip.y1 = mid;
+    s_offload.band_ctx = *draw_ctx;
+    s_offload.band_ctx.clip_area = &s_offload.band_clip;
+    s_offload.band_dsc = dsc;
+    atomic_store(&s_offload.band_state, OFFLOAD_BAND_POSTED);
+    xSemaphoreGive(s_offload.start);
+
+    s_offload.blend(&top_ctx, dsc);
+
+    /* A helper kept from its core by a higher priority task (the detection in the vision profile) must not hold
+     * the UI back, its band is taken back if it didn't start it yet */
+    int state = OFFLOAD_BAND_POSTED;
+    if (atomic_compare_exchange_strong(&s_offload.band_state, &state, OFFLOAD_BAND_IDLE)) {
+        s_offload.blend(&s_offload.band_ctx, dsc);
+        s_offload.stats.taken_back++;
+    } else {
+        /* The masks and the source are in buffers of the LVGL task, released once this returns */
+        xSemaphoreTake(s_offload.done, portMAX_DELAY);
+    }
+    s_offload.stats.split++;
+    s_offload.stats.split_pixels += lv_area_get_size(&area);
+}
+
+static void offload_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(s_offload.start, portMAX_DELAY);
+        /* Woken for a band the LVGL task took back */
+        int state = OFFLOAD_BAND_POSTED;
+        if (!atomic_compare_exchange_strong(&s_offload.band_state, &state, OFFLOAD_BAND_CLAIMED)) {
+            continue;
+        }
+        s_offload.blend(&s_offload.band_ctx, s_offload.band_dsc);
+        atomic_store(&s_offload.band_state, OFFLOAD_BAND_IDLE);
+        xSemaphoreGive(s_offload.done);
+    }
+}
+#endif
+
+esp_err_t lvgl_draw_offload_init(lv_disp_t *disp)
+{
+#if CONFIG_LVGL_DRAW_OFFLOAD
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(disp != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid display");
+    ESP_RETURN_ON_FALSE(s_offload.task == NULL, ESP_ERR_INVALID_STATE, TAG, "Already started");
+
+    /* Only the software renderer has a blend of its own, other draw contexts keep theirs */
+    lv_disp_drv_t *drv = disp->driver;
+    ESP_RETURN_ON_FALSE((drv->draw_ctx != NULL) && (drv->draw_ctx_init == lv_draw_sw_init_ctx) &&
+                        (drv->set_px_cb == NULL), ESP_ERR_NOT_SUPPORTED, TAG, "Not drawn by the software renderer");
+    lv_draw_sw_ctx_t *sw_ctx = (lv_draw_sw_ctx_t *)drv->draw_ctx;
+    ESP_RETURN_ON_FALSE(sw_ctx->blend == lv_draw_sw_blend_basic, ESP_ERR_NOT_SUPPORTED, TAG, "Blend is hooked");
+
+    s_offload.start = xSemaphoreCreateBinary();
+    s_offload.done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(s_offload.start && s_offload.done, ESP_ERR_NO_MEM, err, TAG, "No memory for the semaphores");
+    s_offload.blend = sw_ctx->blend;
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_LVGL_DRAW_OFFLOAD, offload_task, NULL, &s_offload.task) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create offload task failed");
+    sw_ctx->blend = offload_blend;
+    ESP_LOGI(TAG, "Blends of %d pixels and more are split with core %d",
+             CONFIG_LVGL_DRAW_OFFLOAD_MIN_PIXELS, task_config_get(TASK_CONFIG_LVGL_DRAW_OFFLOAD)->core_id);
+
+    return ESP_OK;
+
+err:
+    if (s_offload.start) {
+        vSemaphoreDelete(s_offload.start);
+        s_offload.start = NULL;
+    }
+    if (s_offload.done) {
+        vSemaphoreDelete(s_offload.done);
+        s_offload.done = NULL;
+    }
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void lvgl_draw_offload_get_stats(lvgl_draw_offload_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+#if CONFIG_LVGL_DRAW_OFFLOAD
+    /* Read without the LVGL lock, may miss the blend in progress */
+    *stats = s_offload.stats;
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
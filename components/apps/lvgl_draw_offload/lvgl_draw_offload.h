@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Core the LVGL task is pinned to when the offload is enabled, the helper task runs on the other one
+ */
+#define LVGL_DRAW_OFFLOAD_LVGL_CORE     (0)
+
+/**
+ * @brief Counters of the offloaded blends
+ */
+typedef struct {
+    uint32_t split;                 /*!< Blends split between the LVGL task and the helper */
+    uint32_t inline_num;            /*!< Blends run by the LVGL task alone, too small or memory bound */
+    uint32_t taken_back;            /*!< Split blends whose bottom band was blended by the LVGL task, the helper
+                                         hadn't started it */
+    uint64_t split_pixels;          /*!< Pixels of the split blends */
+} lvgl_draw_offload_stats_t;
+
+/**
+ * @brief Render the big blends of a display on both cores.
+ *
+ * Every draw of the software renderer (images, rectangles with their shadows and borders, text) ends in blends
+ * of an area of the draw buffer with a color or a source image, through a mask for the rounded and anti-aliased
+ * edges. The masks, the shadows, the decoded images and the glyphs are made in buffers LVGL shares without a lock,
+ * so they stay in the LVGL task, but the blend itself only reads its inputs and writes its own pixels. A blend of
+ * at least `CONFIG_LVGL_DRAW_OFFLOAD_MIN_PIXELS` is split in two horizontal bands: the bottom one is blended by a
+ * helper task on the other core while the LVGL task blends the top one, and the LVGL task waits for the helper
+ * before it draws on, or blends the bottom band too if the helper hasn't started it. Opaque fills without a mask
+ * are bound by the memory bandwidth and are not split.
+ *
+ * Must be called once with the LVGL lock held, after the display is started with the LVGL task pinned to
+ * `LVGL_DRAW_OFFLOAD_LVGL_CORE`.
+ *
+ * @param disp Display whose software renderer is split
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_ARG    disp is NULL
+ *      - ESP_ERR_INVALID_STATE  Already started
+ *      - ESP_ERR_NOT_SUPPORTED  The offload is disabled, or the display doesn't blend with the software renderer
+ *      - ESP_ERR_NO_MEM         Failed to create the helper task
+ */
+esp_err_t lvgl_draw_offload_init(lv_disp_t *disp);
+
+/**
+ * @brief Read the counters of the offloaded blends.
+ *
+ * @param stats Output counters, zeroed if the offload is not started
+ */
+void lvgl_draw_offload_get_stats(lvgl_draw_offload_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
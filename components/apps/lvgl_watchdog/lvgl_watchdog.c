@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "lvgl.h"
+#include "task_config/task_config.h"
+#include "lvgl_watchdog.h"
+
+#define WATCHDOG_QUEUE_LEN          (4)
+#define WATCHDOG_APP_NAME_LEN       (24)
+
+typedef enum {
+    WATCHDOG_REPORT_STALLED,        /* Pass still running past the threshold */
+    WATCHDOG_REPORT_SLOW_PASS,      /* Pass that ended past the threshold */
+} watchdog_report_type_t;
+
+typedef struct {
+    watchdog_report_type_t type;
+    uint32_t pass;
+    uint32_t pass_ms;
+    lv_timer_t *timer;              /* Longest timer of the pass, NULL if none ran */
+    lv_timer_cb_t timer_cb;
+    void *timer_user_data;
+    uint32_t timer_ms;
+    lv_obj_t *event_obj;            /* Longest event of the pass, or the event the stalled pass is in */
+    lv_event_code_t event_code;
+    uint32_t event_ms;
+    int app_id;
+    char app_name[WATCHDOG_APP_NAME_LEN];
+} watchdog_report_t;
+
+#if CONFIG_LVGL_WATCHDOG
+static const char *TAG = "lvgl_watchdog";
+
+uint32_t __real_lv_timer_handler(void);
+lv_res_t __real_lv_event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param);
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct {
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    /* Guarded by `s_lock`, written by the LVGL task and read by the watchdog task */
+    int64_t pass_start_us;          /* 0 between passes */
+    uint32_t pass;
+    lv_obj_t *event_obj;            /* Outer event being sent, NULL when none */
+    lv_event_code_t event_code;
+    int64_t event_start_us;
+    int app_id;
+    char app_name[WATCHDOG_APP_NAME_LEN];
+    /* Only used by the LVGL task */
+    uint32_t event_depth;
+    lv_obj_t *slow_event_obj;       /* Longest outer event of the pass */
+    lv_event_code_t slow_event_code;
+    uint32_t slow_event_ms;
+} s_wd = {
+    .app_id = -1,
+};
+
+static void watchdog_fill_app(watchdog_report_t *report)
+{
+    taskENTER_CRITICAL(&s_lock);
+    report->app_id = s_wd.app_id;
+    memcpy(report->app_name, s_wd.app_name, sizeof(report->app_name));
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/* Runs in the LVGL task right after the pass, the timer list can't change meanwhile */
+static void watchdog_find_timer(watchdog_report_t *report, uint32_t tick_start)
+{
+    uint32_t pass_ticks = lv_tick_elaps(tick_start);
+    lv_timer_t *prev = NULL;
+
+    /* Timers run in list order, each one until the next one that ran in the pass started. A timer deleted by its
+     * own callback is gone from the list, its time goes to the timer that ran before it */
+    for (lv_timer_t *timer = lv_timer_get_next(NULL); timer != NULL; timer = lv_timer_get_next(timer)) {
+        if (lv_tick_elaps(timer->last_run) > pass_ticks) {
+            continue;
+        }
+        if (prev != NULL) {
+            uint32_t ms = timer->last_run - prev->last_run;
+            if ((report->timer == NULL) || (ms > report->timer_ms)) {
+                report->timer = prev;
+                report->timer_ms = ms;
+            }
+        }
+        prev = timer;
+    }
+    if (prev != NULL) {
+        uint32_t ms = lv_tick_elaps(prev->last_run);
+        if ((report->timer == NULL) || (ms > report->timer_ms)) {
+            report->timer = prev;
+            report->timer_ms = ms;
+        }
+    }
+    if (report->timer != NULL) {
+        report->timer_cb = report->timer->timer_cb;
+        report->timer_user_data = report->timer->user_data;
+    }
+}
+
+uint32_t __wrap_lv_timer_handler(void)
+{
+    int64_t start_us = esp_timer_get_time();
+    uint32_t tick_start = lv_tick_get();
+
+    taskENTER_CRITICAL(&s_lock);
+    s_wd.pass_start_us = start_us;
+    s_wd.pass++;
+    taskEXIT_CRITICAL(&s_lock);
+    s_wd.slow_event_obj = NULL;
+    s_wd.slow_event_ms = 0;
+
+    uint32_t ret = __real_lv_timer_handler();
+
+    uint32_t pass_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    taskENTER_CRITICAL(&s_lock);
+    s_wd.pass_start_us = 0;
+    taskEXIT_CRITICAL(&s_lock);
+
+    if ((pass_ms >= CONFIG_LVGL_WATCHDOG_THRESHOLD_MS) && (s_wd.queue != NULL)) {
+        watchdog_report_t report = {
+            .type = WATCHDOG_REPORT_SLOW_PASS,
+            .pass = s_wd.pass,
+            .pass_ms = pass_ms,
+            .event_obj = s_wd.slow_event_obj,
+            .event_code = s_wd.slow_event_code,
+            .event_ms = s_wd.slow_event_ms,
+        };
+        watchdog_find_timer(&report, tick_start);
+        watchdog_fill_app(&report);
+        xQueueSend(s_wd.queue, &report, 0);
+    }
+
+    return ret;
+}
+
+lv_res_t __wrap_lv_event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param)
+{
+    /* Events sent from the callbacks of an event are part of it */
+    if (s_wd.event_depth > 0) {
+        s_wd.event_depth++;
+        lv_res_t res = __real_lv_event_send(obj, event_code, param);
+        s_wd.event_depth--;
+        return res;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    s_wd.event_obj = obj;
+    s_wd.event_code = event_code;
+    s_wd.event_start_us = start_us;
+    taskEXIT_CRITICAL(&s_lock);
+    s_wd.event_depth = 1;
+
+    lv_res_t res = __real_lv_event_send(obj, event_code, param);
+
+    s_wd.event_depth = 0;
+    taskENTER_CRITICAL(&s_lock);
+    s_wd.event_obj = NULL;
+    taskEXIT_CRITICAL(&s_lock);
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (ms > s_wd.slow_event_ms) {
+        /* Only the address is kept, the object may be deleted by its own callback */
+        s_wd.slow_event_obj = obj;
+        s_wd.slow_event_code = event_code;
+        s_wd.slow_event_ms = ms;
+    }
+
+    return res;
+}
+
+static void watchdog_print(const watchdog_report_t *report)
+{
+    if (report->type == WATCHDOG_REPORT_STALLED) {
+        ESP_LOGW(TAG, "UI stalled for %" PRIu32 " ms in pass %" PRIu32 ", app %d (%s)", report->pass_ms,
+                 report->pass, report->app_id, report->app_name);
+    } else {
+        ESP_LOGW(TAG, "Slow pass %" PRIu32 ": %" PRIu32 " ms, app %d (%s)", report->pass, report->pass_ms,
+                 report->app_id, report->app_name);
+        if (report->timer != NULL) {
+            ESP_LOGW(TAG, "  timer %p cb %p user_data %p: %" PRIu32 " ms", report->timer, report->timer_cb,
+                     report->timer_user_data, report->timer_ms);
+        }
+    }
+    if (report->event_obj != NULL) {
+        ESP_LOGW(TAG, "  event %d on obj %p: %" PRIu32 " ms%s", (int)report->event_code, report->event_obj,
+                 report->event_ms, (report->type == WATCHDOG_REPORT_STALLED) ? " so far" : "");
+    }
+}
+
+static void watchdog_task(void *arg)
+{
+    const TickType_t poll_ticks = pdMS_TO_TICKS(LV_MAX(CONFIG_LVGL_WATCHDOG_THRESHOLD_MS / 2, 10));
+    uint32_t reported_pass = 0;
+    watchdog_report_t report;
+
+    while (1) {
+        if (xQueueReceive(s_wd.queue, &report, poll_ticks) == pdTRUE) {
+            watchdog_print(&report);
+            continue;
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        taskENTER_CRITICAL(&s_lock);
+        int64_t start_us = s_wd.pass_start_us;
+        uint32_t pass = s_wd.pass;
+        lv_obj_t *event_obj = s_wd.event_obj;
+        lv_event_code_t event_code = s_wd.event_code;
+        int64_t event_start_us = s_wd.event_start_us;
+        taskEXIT_CRITICAL(&s_lock);
+
+        if ((start_us == 0) || (pass == reported_pass) ||
+                (now_us - start_us < (int64_t)CONFIG_LVGL_WATCHDOG_THRESHOLD_MS * 1000)) {
+            continue;
+        }
+        reported_pass = pass;
+        report = (watchdog_report_t) {
+            .type = WATCHDOG_REPORT_STALLED,
+            .pass = pass,
+            .pass_ms = (uint32_t)((now_us - start_us) / 1000),
+            .event_obj = event_obj,
+            .event_code = event_code,
+            .event_ms = event_obj ? (uint32_t)((now_us - event_start_us) / 1000) : 0,
+        };
+        watchdog_fill_app(&report);
+        watchdog_print(&report);
+    }
+}
+#endif
+
+esp_err_t lvgl_watchdog_init(void)
+{
+#if CONFIG_LVGL_WATCHDOG
+    ESP_RETURN_ON_FALSE(s_wd.queue == NULL, ESP_ERR_INVALID_STATE, TAG, "Already started");
+
+    s_wd.queue = xQueueCreate(WATCHDOG_QUEUE_LEN, sizeof(watchdog_report_t));
+    ESP_RETURN_ON_FALSE(s_wd.queue, ESP_ERR_NO_MEM, TAG, "No memory for the queue");
+    if (task_config_create(TASK_CONFIG_LVGL_WATCHDOG, watchdog_task, NULL, &s_wd.task) != pdPASS) {
+        /* The wrappers stop reporting before the queue goes */
+        QueueHandle_t queue = s_wd.queue;
+        s_wd.queue = NULL;
+        vQueueDelete(queue);
+        ESP_LOGE(TAG, "Create watchdog task failed");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Reporting LVGL passes over %d ms", CONFIG_LVGL_WATCHDOG_THRESHOLD_MS);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void lvgl_watchdog_set_app(int app_id, const char *name)
+{
+#if CONFIG_LVGL_WATCHDOG
+    taskENTER_CRITICAL(&s_lock);
+    s_wd.app_id = app_id;
+    strlcpy(s_wd.app_name, name ? name : "", sizeof(s_wd.app_name));
+    taskEXIT_CRITICAL(&s_lock);
+#endif
+}
@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Watch the LVGL task for stalls and report what caused them.
+ *
+ * `lv_timer_handler` and `lv_event_send` are wrapped at link time to time every pass of the LVGL port loop and
+ * every event sent from outside LVGL's event code, nested sends are part of the outer one. A pass longer than
+ * `CONFIG_LVGL_WATCHDOG_THRESHOLD_MS` is attributed once it ends: each timer run in the pass lasted until the next
+ * one started, LVGL sets `last_run` before calling the callback, and the longest one is reported with its
+ * callback address and user data, with the longest event of the pass and the app in the foreground. A task above
+ * the LVGL task prints the reports, and also reports a pass still running past the threshold, so a UI that never
+ * comes back still names the event it is stuck in.
+ *
+ * Call once after the display is started.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Already started
+ *      - ESP_ERR_NOT_SUPPORTED  The watchdog is disabled
+ *      - ESP_ERR_NO_MEM         Failed to create the task or its queue
+ */
+esp_err_t lvgl_watchdog_init(void);
+
+/**
+ * @brief Name the app in the foreground in the next reports.
+ *
+ * @param app_id    Id of the app in the core manager, -1 for the home screen
+ * @param name      Name of the app, copied, can be NULL
+ */
+void lvgl_watchdog_set_app(int app_id, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
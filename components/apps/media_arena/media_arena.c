@@ -0,0 +1,213 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_cache.h"
+#include "media_arena.h"
+
+#define MEDIA_ARENA_ALIGN_MIN       (64)
+#define MEDIA_ARENA_SLAB_NUM_MAX    (32)    /* Slabs of a class are tracked in one bit mask */
+#define MEDIA_ARENA_LEND_SIZE_MIN   (32 * 1024)     /* Smaller buffers don't fragment the heap, they don't get a slab */
+
+typedef struct {
+    size_t slab_size;
+    uint32_t slab_num;
+    uint8_t *base;
+    uint32_t used_mask;
+    uint32_t peak_num;
+} media_arena_class_t;
+
+static const char *TAG = "media_arena";
+
+static portMUX_TYPE arena_lock = portMUX_INITIALIZER_UNLOCKED;
+static media_arena_class_t arena_classes[MEDIA_ARENA_CLASS_NUM];
+static bool arena_inited = false;
+static uint32_t arena_fallback_num = 0;
+static uint32_t arena_fallback_fail_num = 0;
+
+static size_t arena_get_align(void)
+{
+    size_t align = 0;
+
+    esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &align);
+
+    return (align > MEDIA_ARENA_ALIGN_MIN) ? align : MEDIA_ARENA_ALIGN_MIN;
+}
+
+static size_t arena_round_size(size_t size)
+{
+    size_t align = arena_get_align();
+
+    return (size + align - 1) / align * align;
+}
+
+/* Must be called with `arena_lock` held */
+static media_arena_class_t *arena_find_class(const void *buf)
+{
+    for (int i = 0; i < MEDIA_ARENA_CLASS_NUM; i++) {
+        media_arena_class_t *cls = &arena_classes[i];
+        if (cls->base && ((const uint8_t *)buf >= cls->base) &&
+                ((const uint8_t *)buf < cls->base + cls->slab_size * cls->slab_num)) {
+            return cls;
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t media_arena_init(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(!arena_inited, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+    arena_inited = true;
+#if CONFIG_MEDIA_ARENA
+    const size_t sizes_kb[MEDIA_ARENA_CLASS_NUM] = {
+        CONFIG_MEDIA_ARENA_SMALL_KB, CONFIG_MEDIA_ARENA_FRAME_KB, CONFIG_MEDIA_ARENA_LARGE_KB
+    };
+    const uint32_t nums[MEDIA_ARENA_CLASS_NUM] = {
+        CONFIG_MEDIA_ARENA_SMALL_NUM, CONFIG_MEDIA_ARENA_FRAME_NUM, CONFIG_MEDIA_ARENA_LARGE_NUM
+    };
+    size_t align = arena_get_align();
+    size_t total = 0;
+
+    // Sorted by slab size, lends take the first class that fits
+    for (int i = 0; i < MEDIA_ARENA_CLASS_NUM; i++) {
+        media_arena_class_t cls = {
+            .slab_size = arena_round_size(sizes_kb[i] * 1024),
+            .slab_num = (nums[i] > MEDIA_ARENA_SLAB_NUM_MAX) ? MEDIA_ARENA_SLAB_NUM_MAX : nums[i],
+        };
+        int j = i;
+        for (; (j > 0) && (arena_classes[j - 1].slab_size > cls.slab_size); j--) {
+            arena_classes[j] = arena_classes[j - 1];
+        }
+        arena_classes[j] = cls;
+    }
+    for (int i = 0; i < MEDIA_ARENA_CLASS_NUM; i++) {
+        media_arena_class_t *cls = &arena_classes[i];
+        if (cls->slab_num == 0) {
+            continue;
+        }
+        uint8_t *base = (uint8_t *)heap_caps_aligned_alloc(align, cls->slab_size * cls->slab_num, MALLOC_CAP_SPIRAM);
+        if (base == NULL) {
+            ESP_LOGE(TAG, "Reserve %u x %u KB failed", (unsigned)cls->slab_num, (unsigned)(cls->slab_size / 1024));
+            cls->slab_num = 0;
+            ret = ESP_ERR_NO_MEM;
+            continue;
+        }
+        portENTER_CRITICAL(&arena_lock);
+        cls->base = base;
+        portEXIT_CRITICAL(&arena_lock);
+        total += cls->slab_size * cls->slab_num;
+        ESP_LOGI(TAG, "Reserved %u slabs of %u KB", (unsigned)cls->slab_num, (unsigned)(cls->slab_size / 1024));
+    }
+    ESP_LOGI(TAG, "%u KB reserved, largest free PSRAM block now %u KB", (unsigned)(total / 1024),
+             (unsigned)(heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM) / 1024));
+#endif
+
+    return ret;
+}
+
+void *media_arena_lend(size_t size, size_t *actual_size)
+{
+    uint8_t *buf = NULL;
+    size_t buf_size = 0;
+
+    if (size == 0) {
+        return NULL;
+    }
+
+    portENTER_CRITICAL(&arena_lock);
+    for (int i = 0; (size >= MEDIA_ARENA_LEND_SIZE_MIN) && (i < MEDIA_ARENA_CLASS_NUM); i++) {
+        media_arena_class_t *cls = &arena_classes[i];
+        uint32_t full_mask = (cls->slab_num >= 32) ? UINT32_MAX : ((1UL << cls->slab_num) - 1);
+        if ((cls->base == NULL) || (cls->slab_size < size) || (cls->used_mask == full_mask)) {
+            continue;
+        }
+        int index = __builtin_ctz(~cls->used_mask);
+        cls->used_mask |= 1UL << index;
+        uint32_t used_num = __builtin_popcount(cls->used_mask);
+        cls->peak_num = (used_num > cls->peak_num) ? used_num : cls->peak_num;
+        buf = cls->base + cls->slab_size * index;
+        buf_size = cls->slab_size;
+        break;
+    }
+    if ((buf == NULL) && (size >= MEDIA_ARENA_LEND_SIZE_MIN)) {
+        arena_fallback_num++;
+    }
+    portEXIT_CRITICAL(&arena_lock);
+
+    if (buf == NULL) {
+        buf_size = arena_round_size(size);
+        buf = (uint8_t *)heap_caps_aligned_alloc(arena_get_align(), buf_size, MALLOC_CAP_SPIRAM);
+        if (buf == NULL) {
+            portENTER_CRITICAL(&arena_lock);
+            arena_fallback_fail_num++;
+            portEXIT_CRITICAL(&arena_lock);
+            ESP_LOGE(TAG, "No slab or heap block for %u bytes", (unsigned)size);
+            return NULL;
+        }
+        ESP_LOGD(TAG, "%u bytes allocated from the heap", (unsigned)size);
+    }
+    if (actual_size) {
+        *actual_size = buf_size;
+    }
+
+    return buf;
+}
+
+void media_arena_return(void *buf)
+{
+    if (buf == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&arena_lock);
+    media_arena_class_t *cls = arena_find_class(buf);
+    if (cls) {
+        uint32_t index = ((uint8_t *)buf - cls->base) / cls->slab_size;
+        cls->used_mask &= ~(1UL << index);
+    }
+    portEXIT_CRITICAL(&arena_lock);
+
+    if (cls == NULL) {
+        heap_caps_free(buf);
+    }
+}
+
+bool media_arena_owns(const void *buf)
+{
+    portENTER_CRITICAL(&arena_lock);
+    bool owned = (buf != NULL) && (arena_find_class(buf) != NULL);
+    portEXIT_CRITICAL(&arena_lock);
+
+    return owned;
+}
+
+void media_arena_get_stats(media_arena_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&arena_lock);
+    for (int i = 0; i < MEDIA_ARENA_CLASS_NUM; i++) {
+        const media_arena_class_t *cls = &arena_classes[i];
+        stats->classes[i] = (media_arena_class_stats_t) {
+            .slab_size = cls->base ? cls->slab_size : 0,
+            .slab_num = cls->base ? cls->slab_num : 0,
+            .used_num = (uint32_t)__builtin_popcount(cls->used_mask),
+            .peak_num = cls->peak_num,
+        };
+    }
+    stats->fallback_num = arena_fallback_num;
+    stats->fallback_fail_num = arena_fallback_fail_num;
+    portEXIT_CRITICAL(&arena_lock);
+}
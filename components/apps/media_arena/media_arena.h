@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_ARENA_CLASS_NUM       (3)
+
+/**
+ * @brief Use of a size class of the arena
+ */
+typedef struct {
+    size_t slab_size;           /*!< Size of each slab, 0 if the class has no slab */
+    uint32_t slab_num;          /*!< Number of reserved slabs */
+    uint32_t used_num;          /*!< Slabs lent out now */
+    uint32_t peak_num;          /*!< Most slabs lent out at once since boot */
+} media_arena_class_stats_t;
+
+/**
+ * @brief Use of the arena since boot
+ */
+typedef struct {
+    media_arena_class_stats_t classes[MEDIA_ARENA_CLASS_NUM];   /*!< Classes from the smallest slab to the largest */
+    uint32_t fallback_num;      /*!< Lends served from the heap because no free slab was large enough */
+    uint32_t fallback_fail_num; /*!< Lends the heap couldn't serve either */
+} media_arena_stats_t;
+
+/**
+ * @brief Reserve the slabs of `CONFIG_MEDIA_ARENA` in PSRAM, one block per size class.
+ *
+ * Call it at boot before the apps run, while the largest free block is still large. Does nothing if the arena is
+ * disabled.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if called twice, or ESP_ERR_NO_MEM if a class couldn't be
+ *         reserved, in which case the classes already reserved are kept.
+ */
+esp_err_t media_arena_init(void);
+
+/**
+ * @brief Lend a PSRAM buffer of at least `size` bytes.
+ *
+ * From 32 KB the buffer is the first free slab of the smallest class that fits, otherwise it is allocated from the
+ * heap. It is aligned to the PSRAM cache line with a length rounded up to it, so the DMA of the JPEG codec, the
+ * PPA, the camera and the SD card can use it. It is not cleared. Can be called from any task.
+ *
+ * @param size Size in bytes.
+ * @param actual_size Filled with the usable size of the buffer, can be NULL.
+ *
+ * @return The buffer, to be given back with `media_arena_return`, or NULL.
+ */
+void *media_arena_lend(size_t size, size_t *actual_size);
+
+/**
+ * @brief Give back a buffer from `media_arena_lend`. Slabs go back to the arena, other buffers to the heap.
+ *
+ * @param buf Buffer, can be NULL.
+ */
+void media_arena_return(void *buf);
+
+/**
+ * @brief Check if a buffer is a slab of the arena.
+ */
+bool media_arena_owns(const void *buf);
+
+/**
+ * @brief Get the use of the arena.
+ */
+void media_arena_get_stats(media_arena_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,775 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "task_config/task_config.h"
+#include "media_index.h"
+
+static const char *TAG = "media_index";
+
+#if CONFIG_MEDIA_INDEX
+#define INDEX_FILE_NAME             ".media_index"
+#define INDEX_MAGIC                 (0x5844494D)    /* "MIDX" */
+#define INDEX_VERSION               (1)
+#define INDEX_NAME_LEN              (128)
+#define INDEX_DIR_LEN               (64)
+#define INDEX_PATH_LEN              (INDEX_DIR_LEN + INDEX_NAME_LEN + 16)
+#define INDEX_SCAN_SIZE             (2048)  /* Bytes searched for the first MP3 frame, also the parse buffer */
+#define INDEX_TEXT_READ_MAX         (256)   /* Longest part of a text frame read */
+#define INDEX_SAVE_EVERY            (32)    /* Files indexed between two saves, bounds the work lost at power off */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t record_num;
+} index_file_header_t;
+
+typedef struct {
+    char name[INDEX_NAME_LEN];
+    uint32_t size;
+    uint32_t mtime;
+    media_index_info_t info;
+} index_record_t;
+
+typedef struct {
+    index_record_t rec;
+    bool indexed;
+} index_entry_t;
+
+struct media_index_t {
+    char dir[INDEX_DIR_LEN];
+    int num;
+    index_entry_t *entries;
+    uint8_t *scan_buf;
+    SemaphoreHandle_t lock;     /* Guards `entries`, held briefly by the task */
+    SemaphoreHandle_t done;     /* Given by the task when it exits */
+    TaskHandle_t task;
+    volatile bool stop;
+    atomic_uint version;
+};
+
+static const uint16_t mp3_bitrates[2][15] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },   /* MPEG 1 layer III */
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },       /* MPEG 2/2.5 layer III */
+};
+static const uint16_t mp3_sample_rates[3] = { 44100, 48000, 32000 };
+
+static inline uint32_t index_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t index_le32(const uint8_t *p)
+{
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static inline uint32_t index_syncsafe32(const uint8_t *p)
+{
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) | ((uint32_t)(p[2] & 0x7F) << 7) |
+           (p[3] & 0x7F);
+}
+
+static size_t index_read_at(FILE *fp, uint32_t offset, void *buf, size_t len)
+{
+    if (fseek(fp, offset, SEEK_SET) != 0) {
+        return 0;
+    }
+
+    return fread(buf, 1, len, fp);
+}
+
+static void index_trim(char *dst)
+{
+    size_t len = strlen(dst);
+
+    while ((len > 0) && (dst[len - 1] == ' ')) {
+        dst[--len] = '\0';
+    }
+}
+
+static size_t index_put_utf8(char *dst, size_t pos, size_t dst_size, uint32_t cp)
+{
+    uint8_t seq[4];
+    size_t len = 0;
+
+    if (cp < 0x80) {
+        seq[len++] = cp;
+    } else if (cp < 0x800) {
+        seq[len++] = 0xC0 | (cp >> 6);
+        seq[len++] = 0x80 | (cp & 0x3F);
+    } else if (cp < 0x10000) {
+        seq[len++] = 0xE0 | (cp >> 12);
+        seq[len++] = 0x80 | ((cp >> 6) & 0x3F);
+        seq[len++] = 0x80 | (cp & 0x3F);
+    } else {
+        seq[len++] = 0xF0 | (cp >> 18);
+        seq[len++] = 0x80 | ((cp >> 12) & 0x3F);
+        seq[len++] = 0x80 | ((cp >> 6) & 0x3F);
+        seq[len++] = 0x80 | (cp & 0x3F);
+    }
+    // Only whole characters, the string may be cut short
+    if (pos + len >= dst_size) {
+        return 0;
+    }
+    memcpy(dst + pos, seq, len);
+
+    return len;
+}
+
+/* ISO-8859-1 text with non-ASCII bytes is nearly always in a local code page (GBK...), it is dropped then */
+static bool index_copy_latin1(const uint8_t *src, size_t len, char *dst, size_t dst_size)
+{
+    size_t pos = 0;
+
+    for (size_t i = 0; (i < len) && (src[i] != '\0'); i++) {
+        if (src[i] >= 0x80) {
+            dst[0] = '\0';
+            return false;
+        }
+        if (pos + 1 >= dst_size) {
+            break;
+        }
+        dst[pos++] = src[i];
+    }
+    dst[pos] = '\0';
+    index_trim(dst);
+
+    return dst[0] != '\0';
+}
+
+/* Decodes an ID3v2 text frame, the first byte is the encoding */
+static bool index_copy_text(const uint8_t *src, size_t len, char *dst, size_t dst_size)
+{
+    uint8_t enc = 0;
+    size_t pos = 0;
+    size_t n = 0;
+    bool big_endian = true;
+
+    if (len < 2) {
+        return false;
+    }
+    enc = src[0];
+    src++;
+    len--;
+
+    switch (enc) {
+    case 0:
+        return index_copy_latin1(src, len, dst, dst_size);
+    case 3:
+        for (size_t i = 0; (i < len) && (src[i] != '\0') && (pos + 1 < dst_size); i++) {
+            dst[pos++] = src[i];
+        }
+        // Don't leave a partial character at the end
+        if (pos + 1 >= dst_size) {
+            size_t lead = pos;
+            while ((lead > 0) && ((dst[lead - 1] & 0xC0) == 0x80)) {
+                lead--;
+            }
+            if ((lead > 0) && ((uint8_t)dst[lead - 1] >= 0xC0)) {
+                uint8_t c = dst[lead - 1];
+                size_t need = (c >= 0xF0) ? 4 : ((c >= 0xE0) ? 3 : 2);
+                if (lead - 1 + need > pos) {
+                    pos = lead - 1;
+                }
+            }
+        }
+        break;
+    case 1:
+    case 2:
+        if ((enc == 1) && (len >= 2)) {
+            if ((src[0] == 0xFF) && (src[1] == 0xFE)) {
+                big_endian = false;
+                src += 2;
+                len -= 2;
+            } else if ((src[0] == 0xFE) && (src[1] == 0xFF)) {
+                src += 2;
+                len -= 2;
+            }
+        }
+        for (size_t i = 0; i + 1 < len; i += 2) {
+            uint32_t cp = big_endian ? ((src[i] << 8) | src[i + 1]) : ((src[i + 1] << 8) | src[i]);
+            if (cp == 0) {
+                break;
+            }
+            if ((cp >= 0xD800) && (cp < 0xDC00) && (i + 3 < len)) {
+                uint32_t low = big_endian ? ((src[i + 2] << 8) | src[i + 3]) : ((src[i + 3] << 8) | src[i + 2]);
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+            n = index_put_utf8(dst, pos, dst_size, cp);
+            if (n == 0) {
+                break;
+            }
+            pos += n;
+        }
+        break;
+    default:
+        return false;
+    }
+    dst[pos] = '\0';
+    index_trim(dst);
+
+    return dst[0] != '\0';
+}
+
+/* Finds the start of the picture data of an APIC frame */
+static void index_parse_apic(const uint8_t *data, size_t len, uint32_t offset, uint32_t size, media_index_info_t *info)
+{
+    uint8_t enc = 0;
+    uint8_t type = 0;
+    size_t pos = 1;
+
+    if (len < 4) {
+        return;
+    }
+    enc = data[0];
+    // MIME type, always ISO-8859-1
+    while ((pos < len) && (data[pos] != '\0')) {
+        pos++;
+    }
+    pos++;
+    if (pos >= len) {
+        return;
+    }
+    type = data[pos++];
+    // Description, with a two byte terminator in UTF-16
+    if ((enc == 1) || (enc == 2)) {
+        while ((pos + 1 < len) && ((data[pos] != '\0') || (data[pos + 1] != '\0'))) {
+            pos += 2;
+        }
+        pos += 2;
+    } else {
+        while ((pos < len) && (data[pos] != '\0')) {
+            pos++;
+        }
+        pos++;
+    }
+    if (pos >= len) {
+        return;
+    }
+    // Keep the first picture, unless a front cover comes later
+    if ((info->art_offset == 0) || (type == 3)) {
+        info->art_offset = offset + pos;
+        info->art_size = size - pos;
+    }
+}
+
+/**
+ * @brief Parse the ID3v2 tag at the start of a file.
+ *
+ * @return Offset of the audio data after the tag, 0 if there is no tag.
+ */
+static uint32_t index_parse_id3v2(FILE *fp, uint8_t *buf, media_index_info_t *info, uint32_t *tlen_ms)
+{
+    uint8_t hdr[10];
+    uint32_t tag_end = 0;
+    uint32_t frames_end = 0;
+    uint32_t pos = 10;
+    uint8_t ver = 0;
+
+    if ((index_read_at(fp, 0, hdr, sizeof(hdr)) != sizeof(hdr)) || (memcmp(hdr, "ID3", 3) != 0)) {
+        return 0;
+    }
+    ver = hdr[3];
+    frames_end = 10 + index_syncsafe32(hdr + 6);
+    tag_end = frames_end + (((ver == 4) && (hdr[5] & 0x10)) ? 10 : 0);
+    // Version 2.2 uses other frame ids, and 2.3 frames can't be read in place once the whole tag is unsynchronised
+    if (((ver != 3) && (ver != 4)) || ((ver == 3) && (hdr[5] & 0x80))) {
+        return tag_end;
+    }
+    if (hdr[5] & 0x40) {
+        uint8_t ext[4];
+        if (index_read_at(fp, pos, ext, sizeof(ext)) != sizeof(ext)) {
+            return tag_end;
+        }
+        pos += (ver == 4) ? index_syncsafe32(ext) : (4 + index_be32(ext));
+    }
+
+    while (pos + 10 <= frames_end) {
+        uint8_t fh[10];
+        if (index_read_at(fp, pos, fh, sizeof(fh)) != sizeof(fh) || (fh[0] == '\0')) {
+            break;  // Padding
+        }
+        uint32_t size = (ver == 4) ? index_syncsafe32(fh + 4) : index_be32(fh + 4);
+        uint32_t data = pos + 10;
+        if ((size == 0) || (data + size > frames_end)) {
+            break;
+        }
+        pos = data + size;
+
+        // Compressed, encrypted, grouped or unsynchronised frames are skipped
+        uint8_t format = fh[9];
+        if ((ver == 4) && (format & 0x01)) {
+            if (size <= 4) {
+                continue;
+            }
+            data += 4;
+            size -= 4;
+        }
+        if (((ver == 3) && (format & 0xE0)) || ((ver == 4) && (format & 0x4E))) {
+            continue;
+        }
+
+        size_t len = (size < INDEX_TEXT_READ_MAX) ? size : INDEX_TEXT_READ_MAX;
+        char *dst = NULL;
+        if (memcmp(fh, "TIT2", 4) == 0) {
+            dst = info->title;
+        } else if (memcmp(fh, "TPE1", 4) == 0) {
+            dst = info->artist;
+        } else if (memcmp(fh, "TALB", 4) == 0) {
+            dst = info->album;
+        } else if (memcmp(fh, "TLEN", 4) == 0) {
+            char text[16];
+            if ((index_read_at(fp, data, buf, len) == len) && index_copy_text(buf, len, text, sizeof(text))) {
+                *tlen_ms = strtoul(text, NULL, 10);
+            }
+            continue;
+        } else if (memcmp(fh, "APIC", 4) == 0) {
+            if (index_read_at(fp, data, buf, len) == len) {
+                index_parse_apic(buf, len, data, size, info);
+            }
+            continue;
+        } else {
+            continue;
+        }
+        if (index_read_at(fp, data, buf, len) == len) {
+            index_copy_text(buf, len, dst, MEDIA_INDEX_TEXT_LEN);
+        }
+    }
+
+    return tag_end;
+}
+
+/**
+ * @brief Fill the fields still empty from the ID3v1 tag at the end of a file.
+ *
+ * @return true if the file has an ID3v1 tag.
+ */
+static bool index_parse_id3v1(FILE *fp, uint32_t file_size, media_index_info_t *info)
+{
+    uint8_t tag[128];
+
+    if ((file_size < sizeof(tag)) || (index_read_at(fp, file_size - sizeof(tag), tag, sizeof(tag)) != sizeof(tag)) ||
+            (memcmp(tag, "TAG", 3) != 0)) {
+        return false;
+    }
+    if (info->title[0] == '\0') {
+        index_copy_latin1(tag + 3, 30, info->title, MEDIA_INDEX_TEXT_LEN);
+    }
+    if (info->artist[0] == '\0') {
+        index_copy_latin1(tag + 33, 30, info->artist, MEDIA_INDEX_TEXT_LEN);
+    }
+    if (info->album[0] == '\0') {
+        index_copy_latin1(tag + 63, 30, info->album, MEDIA_INDEX_TEXT_LEN);
+    }
+
+    return true;
+}
+
+/* Duration from the Xing/Info or VBRI header of the first frame, or from the bitrate of a CBR stream */
+static uint32_t index_mp3_duration_ms(FILE *fp, uint8_t *buf, uint32_t start, uint32_t end)
+{
+    size_t len = index_read_at(fp, start, buf, INDEX_SCAN_SIZE);
+
+    for (size_t i = 0; i + 4 <= len; i++) {
+        if ((buf[i] != 0xFF) || ((buf[i + 1] & 0xE0) != 0xE0)) {
+            continue;
+        }
+        uint8_t version = (buf[i + 1] >> 3) & 0x03;     /* 0: MPEG 2.5, 2: MPEG 2, 3: MPEG 1 */
+        uint8_t layer = (buf[i + 1] >> 1) & 0x03;       /* 1: layer III */
+        uint8_t bitrate_idx = buf[i + 2] >> 4;
+        uint8_t rate_idx = (buf[i + 2] >> 2) & 0x03;
+        if ((version == 1) || (layer != 1) || (bitrate_idx == 0) || (bitrate_idx == 15) || (rate_idx == 3)) {
+            continue;
+        }
+
+        bool mpeg1 = (version == 3);
+        bool mono = ((buf[i + 3] >> 6) == 3);
+        uint32_t sample_rate = mp3_sample_rates[rate_idx] >> (mpeg1 ? 0 : ((version == 2) ? 1 : 2));
+        uint32_t samples = mpeg1 ? 1152 : 576;
+        size_t xing = i + 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+        size_t vbri = i + 4 + 32;
+        uint32_t frames = 0;
+
+        if ((xing + 12 <= len) && ((memcmp(buf + xing, "Xing", 4) == 0) || (memcmp(buf + xing, "Info", 4) == 0)) &&
+                (index_be32(buf + xing + 4) & 0x01)) {
+            frames = index_be32(buf + xing + 8);
+        } else if ((vbri + 18 <= len) && (memcmp(buf + vbri, "VBRI", 4) == 0)) {
+            frames = index_be32(buf + vbri + 14);
+        }
+        if (frames > 0) {
+            return (uint64_t)frames * samples * 1000 / sample_rate;
+        }
+
+        // Bytes * 8 / kbit/s gives milliseconds
+        uint32_t kbps = mp3_bitrates[mpeg1 ? 0 : 1][bitrate_idx];
+        return (uint64_t)(end - start - i) * 8 / kbps;
+    }
+
+    return 0;
+}
+
+/* Duration of WAV and AVI files from their headers */
+static void index_parse_riff(FILE *fp, uint8_t *buf, media_index_info_t *info)
+{
+    uint8_t chunk[8];
+    uint32_t byte_rate = 0;
+    uint32_t pos = 12;
+
+    if (index_read_at(fp, 0, buf, 56) != 56) {
+        return;
+    }
+    if ((memcmp(buf + 8, "AVI ", 4) == 0) && (memcmp(buf + 12, "LIST", 4) == 0) &&
+            (memcmp(buf + 20, "hdrl", 4) == 0) && (memcmp(buf + 24, "avih", 4) == 0)) {
+        // MainAVIHeader: microseconds per frame, then the total frames at offset 16
+        info->duration_ms = (uint64_t)index_le32(buf + 48) * index_le32(buf + 32) / 1000;
+        return;
+    }
+    if (memcmp(buf + 8, "WAVE", 4) != 0) {
+        return;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (index_read_at(fp, pos, chunk, sizeof(chunk)) != sizeof(chunk)) {
+            return;
+        }
+        uint32_t size = index_le32(chunk + 4);
+        if ((memcmp(chunk, "fmt ", 4) == 0) && (size >= 16)) {
+            if (index_read_at(fp, pos + 8, buf, 16) != 16) {
+                return;
+            }
+            byte_rate = index_le32(buf + 8);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (byte_rate > 0) {
+                info->duration_ms = (uint64_t)size * 1000 / byte_rate;
+            }
+            return;
+        }
+        pos += 8 + size + (size & 1);
+    }
+}
+
+static void index_parse_file(FILE *fp, uint8_t *buf, uint32_t file_size, media_index_info_t *info)
+{
+    uint8_t magic[4];
+    uint32_t tlen_ms = 0;
+    uint32_t audio_start = 0;
+    uint32_t audio_end = file_size;
+
+    memset(info, 0, sizeof(*info));
+    if (index_read_at(fp, 0, magic, sizeof(magic)) != sizeof(magic)) {
+        return;
+    }
+    if (memcmp(magic, "RIFF", 4) == 0) {
+        index_parse_riff(fp, buf, info);
+        return;
+    }
+
+    // Anything else is handled as MP3, a file without a frame just gets no duration
+    audio_start = index_parse_id3v2(fp, buf, info, &tlen_ms);
+    if (index_parse_id3v1(fp, file_size, info)) {
+        audio_end -= 128;
+    }
+    if (tlen_ms > 0) {
+        info->duration_ms = tlen_ms;
+    } else if (audio_start < audio_end) {
+        info->duration_ms = index_mp3_duration_ms(fp, buf, audio_start, audio_end);
+    }
+}
+
+static void index_load(media_index_handle_t handle)
+{
+    char path[INDEX_PATH_LEN];
+    index_file_header_t header;
+    index_record_t rec;
+    FILE *fp = NULL;
+    int loaded = 0;
+
+    snprintf(path, sizeof(path), "%s/" INDEX_FILE_NAME, handle->dir);
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ESP_LOGI(TAG, "No index in %s, build it", handle->dir);
+        return;
+    }
+    if ((fread(&header, sizeof(header), 1, fp) != 1) || (header.magic != INDEX_MAGIC) ||
+            (header.version != INDEX_VERSION) || (header.record_size != sizeof(index_record_t))) {
+        ESP_LOGW(TAG, "Index in %s is invalid, rebuild it", handle->dir);
+        fclose(fp);
+        return;
+    }
+    for (uint32_t i = 0; (i < header.record_num) && (fread(&rec, sizeof(rec), 1, fp) == 1); i++) {
+        rec.name[INDEX_NAME_LEN - 1] = '\0';
+        for (int j = 0; j < handle->num; j++) {
+            index_entry_t *entry = &handle->entries[j];
+            if (!entry->indexed && (strcmp(entry->rec.name, rec.name) == 0)) {
+                entry->rec = rec;
+                entry->indexed = true;
+                loaded++;
+                break;
+            }
+        }
+    }
+    fclose(fp);
+    ESP_LOGI(TAG, "Loaded %d/%d entries of %s", loaded, handle->num, handle->dir);
+}
+
+static void index_save(media_index_handle_t handle)
+{
+    char path[INDEX_PATH_LEN];
+    char tmp_path[INDEX_PATH_LEN];
+    index_file_header_t header = {
+        .magic = INDEX_MAGIC,
+        .version = INDEX_VERSION,
+        .record_size = sizeof(index_record_t),
+        .record_num = 0,
+    };
+    index_record_t rec;
+    FILE *fp = NULL;
+    bool ok = true;
+
+    snprintf(path, sizeof(path), "%s/" INDEX_FILE_NAME, handle->dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/" INDEX_FILE_NAME ".tmp", handle->dir);
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        ESP_LOGW(TAG, "Create %s failed", tmp_path);
+        return;
+    }
+
+    // The record count is written again once known
+    ok = (fwrite(&header, sizeof(header), 1, fp) == 1);
+    for (int i = 0; ok && (i < handle->num); i++) {
+        xSemaphoreTake(handle->lock, portMAX_DELAY);
+        bool indexed = handle->entries[i].indexed;
+        rec = handle->entries[i].rec;
+        xSemaphoreGive(handle->lock);
+        // Names too long for the record are indexed again at each boot
+        if (indexed && (strlen(rec.name) < INDEX_NAME_LEN - 1)) {
+            ok = (fwrite(&rec, sizeof(rec), 1, fp) == 1);
+            header.record_num++;
+        }
+    }
+    ok = ok && (fseek(fp, 0, SEEK_SET) == 0) && (fwrite(&header, sizeof(header), 1, fp) == 1);
+    ok = (fclose(fp) == 0) && ok;
+
+    // FAT can't rename over an existing file
+    if (ok) {
+        remove(path);
+        ok = (rename(tmp_path, path) == 0);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "Save %s failed", path);
+        remove(tmp_path);
+        return;
+    }
+    ESP_LOGD(TAG, "Saved %d entries to %s", (int)header.record_num, path);
+}
+
+static void index_task(void *arg)
+{
+    media_index_handle_t handle = (media_index_handle_t)arg;
+    char path[INDEX_PATH_LEN];
+    media_index_info_t info;
+    struct stat st;
+    int updated = 0;
+    int unsaved = 0;
+
+    for (int i = 0; (i < handle->num) && !handle->stop; i++) {
+        index_entry_t *entry = &handle->entries[i];
+
+        snprintf(path, sizeof(path), "%s/%s", handle->dir, entry->rec.name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        // Only this task writes the entries, they can be read without the lock here
+        if (entry->indexed && (entry->rec.size == (uint32_t)st.st_size) && (entry->rec.mtime == (uint32_t)st.st_mtime)) {
+            continue;
+        }
+
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+            continue;
+        }
+        index_parse_file(fp, handle->scan_buf, st.st_size, &info);
+        fclose(fp);
+
+        xSemaphoreTake(handle->lock, portMAX_DELAY);
+        entry->rec.size = st.st_size;
+        entry->rec.mtime = st.st_mtime;
+        entry->rec.info = info;
+        entry->indexed = true;
+        xSemaphoreGive(handle->lock);
+        atomic_fetch_add(&handle->version, 1);
+        ESP_LOGD(TAG, "Indexed %s: \"%s\" - \"%s\", %d ms", entry->rec.name, info.title, info.artist,
+                 (int)info.duration_ms);
+
+        updated++;
+        if (++unsaved >= INDEX_SAVE_EVERY) {
+            index_save(handle);
+            unsaved = 0;
+        }
+    }
+    if (unsaved > 0) {
+        index_save(handle);
+    }
+    ESP_LOGI(TAG, "Indexed %d new files of %s", updated, handle->dir);
+
+    xSemaphoreGive(handle->done);
+    task_config_delete(TASK_CONFIG_MEDIA_INDEX, NULL);
+}
+
+esp_err_t media_index_open(const char *dir, const char *const *names, int num, media_index_handle_t *ret_handle)
+{
+    esp_err_t ret = ESP_OK;
+    media_index_handle_t handle = NULL;
+
+    ESP_RETURN_ON_FALSE(dir && (names || (num == 0)) && (num >= 0) && ret_handle, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    ESP_RETURN_ON_FALSE(strlen(dir) < INDEX_DIR_LEN, ESP_ERR_INVALID_ARG, TAG, "Directory name too long");
+
+    handle = heap_caps_calloc(1, sizeof(struct media_index_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "Alloc handle failed");
+    strcpy(handle->dir, dir);
+    handle->num = num;
+    atomic_init(&handle->version, 0);
+
+    handle->entries = heap_caps_calloc((num > 0) ? num : 1, sizeof(index_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    handle->scan_buf = heap_caps_malloc(INDEX_SCAN_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(handle->entries && handle->scan_buf, ESP_ERR_NO_MEM, err, TAG, "Alloc entries failed");
+    for (int i = 0; i < num; i++) {
+        strlcpy(handle->entries[i].rec.name, names[i], INDEX_NAME_LEN);
+    }
+
+    handle->lock = xSemaphoreCreateMutex();
+    handle->done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(handle->lock && handle->done, ESP_ERR_NO_MEM, err, TAG, "Create semaphore failed");
+
+    index_load(handle);
+
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_MEDIA_INDEX, index_task, handle, &handle->task) == pdPASS, ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+    *ret_handle = handle;
+
+    return ESP_OK;
+
+err:
+    if (handle->done) {
+        vSemaphoreDelete(handle->done);
+    }
+    if (handle->lock) {
+        vSemaphoreDelete(handle->lock);
+    }
+    heap_caps_free(handle->scan_buf);
+    heap_caps_free(handle->entries);
+    heap_caps_free(handle);
+
+    return ret;
+}
+
+void media_index_close(media_index_handle_t handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+
+    // The task stops after the file it is parsing, and saves what it indexed
+    handle->stop = true;
+    xSemaphoreTake(handle->done, portMAX_DELAY);
+
+    vSemaphoreDelete(handle->done);
+    vSemaphoreDelete(handle->lock);
+    heap_caps_free(handle->scan_buf);
+    heap_caps_free(handle->entries);
+    heap_caps_free(handle);
+}
+
+bool media_index_get(media_index_handle_t handle, int index, media_index_info_t *info)
+{
+    bool indexed = false;
+
+    if ((handle == NULL) || (index < 0) || (index >= handle->num) || (info == NULL)) {
+        return false;
+    }
+
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    indexed = handle->entries[index].indexed;
+    if (indexed) {
+        *info = handle->entries[index].rec.info;
+    }
+    xSemaphoreGive(handle->lock);
+
+    return indexed;
+}
+
+uint32_t media_index_get_version(media_index_handle_t handle)
+{
+    return (handle != NULL) ? atomic_load(&handle->version) : 0;
+}
+
+static const char *index_sort_key(const index_entry_t *entry)
+{
+    return (entry->indexed && (entry->rec.info.title[0] != '\0')) ? entry->rec.info.title : entry->rec.name;
+}
+
+esp_err_t media_index_sort(media_index_handle_t handle, int *order)
+{
+    ESP_RETURN_ON_FALSE(handle && order, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    // Insertion sort, stable and lists are short
+    xSemaphoreTake(handle->lock, portMAX_DELAY);
+    for (int i = 0; i < handle->num; i++) {
+        const char *key = index_sort_key(&handle->entries[i]);
+        int j = i;
+        while ((j > 0) && (strcasecmp(index_sort_key(&handle->entries[order[j - 1]]), key) > 0)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    xSemaphoreGive(handle->lock);
+
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t media_index_open(const char *dir, const char *const *names, int num, media_index_handle_t *ret_handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void media_index_close(media_index_handle_t handle)
+{
+}
+
+bool media_index_get(media_index_handle_t handle, int index, media_index_info_t *info)
+{
+    return false;
+}
+
+uint32_t media_index_get_version(media_index_handle_t handle)
+{
+    return 0;
+}
+
+esp_err_t media_index_sort(media_index_handle_t handle, int *order)
+{
+    ESP_LOGD(TAG, "Media index disabled");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_MEDIA_INDEX */
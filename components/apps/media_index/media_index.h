@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEDIA_INDEX_TEXT_LEN        (64)    /* Tag strings are UTF-8, cut on a character boundary */
+
+/**
+ * @brief Metadata of one media file
+ */
+typedef struct {
+    char title[MEDIA_INDEX_TEXT_LEN];   /*!< Empty if the file has no usable title tag */
+    char artist[MEDIA_INDEX_TEXT_LEN];  /*!< Empty if unknown */
+    char album[MEDIA_INDEX_TEXT_LEN];   /*!< Empty if unknown */
+    uint32_t duration_ms;               /*!< 0 if unknown */
+    uint32_t art_offset;                /*!< Offset of the embedded picture data in the file, 0 if none */
+    uint32_t art_size;                  /*!< Size of the embedded picture data */
+} media_index_info_t;
+
+typedef struct media_index_t *media_index_handle_t;
+
+/**
+ * @brief Open the index of some files of a directory.
+ *
+ * The entries saved in `<dir>/.media_index` are loaded right away, so the files indexed before are known as soon as
+ * this returns. A low priority task then checks the size and time of every file, parses the tags of the new or
+ * changed ones (ID3v2/ID3v1 and the Xing/VBRI header of MP3, WAV and AVI headers) and saves the index again when it
+ * is done. The task exits when all files are indexed.
+ *
+ * @param dir Directory of the files, without the trailing '/'.
+ * @param names File names in `dir`, copied. The index of a name in this array identifies it in the other calls.
+ * @param num Number of names.
+ * @param ret_handle Filled with the handle of the index.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if `CONFIG_MEDIA_INDEX` is disabled, or an error code on failure.
+ */
+esp_err_t media_index_open(const char *dir, const char *const *names, int num, media_index_handle_t *ret_handle);
+
+/**
+ * @brief Close the index, waits for the task to save what it indexed so far and frees the handle.
+ *
+ * @param handle Handle of the index, can be NULL.
+ */
+void media_index_close(media_index_handle_t handle);
+
+/**
+ * @brief Get the metadata of a file, does not touch the SD card and can be called from the LVGL task.
+ *
+ * @param handle Handle of the index, can be NULL.
+ * @param index Index of the file name given to `media_index_open`.
+ * @param info Filled with the metadata.
+ *
+ * @return true if the file is indexed, false if it is not yet or can't be, `info` is left untouched then.
+ */
+bool media_index_get(media_index_handle_t handle, int index, media_index_info_t *info);
+
+/**
+ * @brief Get a counter increased each time a file is indexed, to know when the metadata shown must be refreshed.
+ *
+ * @param handle Handle of the index, can be NULL.
+ */
+uint32_t media_index_get_version(media_index_handle_t handle);
+
+/**
+ * @brief Sort the files by title, case-insensitive, the file name is used for files without a title.
+ *
+ * @param handle Handle of the index.
+ * @param order Array of `num` entries filled with the file indexes in sorted order.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t media_index_sort(media_index_handle_t handle, int *order);
+
+#ifdef __cplusplus
+}
+#endif
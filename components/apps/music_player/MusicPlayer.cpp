@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <vector>
+#include <string>
 #include "esp_check.h"
 #include "sdkconfig.h"
 #include "bsp/esp-bsp.h"
@@ -11,6 +13,9 @@
 
 #include "gui_music/lv_demo_music.h"
 #include "gui_music/lv_demo_music_main.h"
+#include "music_eq.h"
+#include "music_spectrum.h"
+#include "music_queue.h"
 #include "MusicPlayer.hpp"
 
 #define MUSIC_DIR   BSP_SD_MOUNT_POINT "/music"
@@ -23,7 +28,9 @@ static const char *TAG = "MusicPlayer";
 
 MusicPlayer::MusicPlayer():
     ESP_Brookesia_PhoneApp("Music Player", &img_app_music_player, true), // auto_resize_visual_area
-    _file_iterator(NULL)
+    _tracks(NULL),
+    _media_index(NULL),
+    _is_running(false)
 {
 }
 
@@ -33,7 +40,21 @@ MusicPlayer::~MusicPlayer()
 
 bool MusicPlayer::run(void)
 {
-    lv_demo_music(lv_scr_act(), _file_iterator);
+    // 电脑正在使用SD卡
+    if (usb_msc_host_owns_card()) {
+        ESP_LOGW(TAG, "SD card is used by the USB host");
+        return false;
+    }
+    _is_running = true;
+
+    // 频谱显示分析实际播放的音频，失败时使用内置的频谱数据
+    esp_err_t ret = music_spectrum_start();
+    if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+        ESP_LOGW(TAG, "music_spectrum_start failed, use canned spectrum");
+    }
+
+    music_queue_start();
+    lv_demo_music(lv_scr_act(), _tracks, _media_index);
 
     return true;
 }
@@ -45,6 +66,21 @@ bool MusicPlayer::pause(void)
     return true;
 }
 
+bool MusicPlayer::displayStateChanged(ESP_Brookesia_CoreDisplayState_t state)
+{
+    // 屏幕关闭后只保留播放，频谱分析没人看，打开屏幕后再启动
+    if (state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) {
+        music_spectrum_stop();
+    } else {
+        esp_err_t ret = music_spectrum_start();
+        if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+            ESP_LOGW(TAG, "music_spectrum_start failed, use canned spectrum");
+        }
+    }
+
+    return true;
+}
+
 bool MusicPlayer::back(void)
 {
     notifyCoreClosed();
@@ -54,6 +90,10 @@ bool MusicPlayer::back(void)
 
 bool MusicPlayer::close(void)
 {
+    _is_running = false;
+    music_spectrum_stop();
+    music_queue_stop();
+
     if (audio_player_pause() != ESP_OK) {
         ESP_LOGE(TAG, "audio_player_pause failed");
         return false;
@@ -69,10 +109,51 @@ bool MusicPlayer::init(void)
         return false;
     }
 
-    if (bsp_extra_file_instance_init(MUSIC_DIR, &_file_iterator) != ESP_OK) {
-        ESP_LOGE(TAG, "bsp_extra_file_instance_init failed");
+    // 排序后的曲目列表保存在目录中，目录未变化时开机不再扫描
+    if (dir_index_open(MUSIC_DIR, &_tracks) != ESP_OK) {
+        ESP_LOGE(TAG, "dir_index_open failed");
         return false;
     }
 
+    // 均衡器预设从设置中读取，未启用时直接输出
+    music_eq_init();
+
+    // 队列初始化失败时仍可逐首播放
+    if (music_queue_init(_tracks) != ESP_OK) {
+        ESP_LOGW(TAG, "music_queue_init failed, tracks are opened on demand");
+    }
+
+    // 开机后在后台建立曲目索引，打开应用时即可显示标签信息，失败时显示文件名
+    vector<string> files;
+    vector<const char *> names;
+    char name[256];
+    for (int i = 0; i < dir_index_get_count(_tracks); i++) {
+        files.push_back((dir_index_get_name(_tracks, i, name, sizeof(name)) == ESP_OK) ? name : "");
+    }
+    for (const string &file : files) {
+        names.push_back(file.c_str());
+    }
+    esp_err_t ret = media_index_open(MUSIC_DIR, names.data(), names.size(), &_media_index);
+    if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+        ESP_LOGW(TAG, "media_index_open failed, show file names");
+    }
+
+    ret = usb_msc_add_listener(onCardOwnerChanged, this);
+    if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+        ESP_LOGW(TAG, "usb_msc_add_listener failed, the card may be taken while playing");
+    }
+
     return true;
 }
+
+void MusicPlayer::onCardOwnerChanged(usb_msc_event_t event, void *user_ctx)
+{
+    MusicPlayer *app = (MusicPlayer *)user_ctx;
+
+    // 在后台播放时也关闭，交给电脑之前关闭所有曲目文件。曲目列表和索引仍是开机时的
+    if ((event == USB_MSC_EVENT_HOST_ATTACHED) && app->_is_running) {
+        bsp_display_lock(0);
+        app->notifyCoreClosed();
+        bsp_display_unlock();
+    }
+}
@@ -6,7 +6,9 @@
 #pragma once
 
 #include "lvgl.h"
-#include "file_iterator.h"
+#include "media_index/media_index.h"
+#include "dir_index/dir_index.h"
+#include "usb_msc/usb_msc.h"
 #include "esp_brookesia.hpp"
 
 class MusicPlayer: public ESP_Brookesia_PhoneApp {
@@ -20,7 +22,12 @@ public:
 
     bool init(void) override;
     bool pause(void) override;
+    bool displayStateChanged(ESP_Brookesia_CoreDisplayState_t state) override;
 
 private:
-    file_iterator_instance_t *_file_iterator;
+    static void onCardOwnerChanged(usb_msc_event_t event, void *user_ctx);
+
+    dir_index_handle_t _tracks;
+    media_index_handle_t _media_index;
+    bool _is_running;
 };
@@ -12,6 +12,7 @@
 
 #include "lv_demo_music_main.h"
 #include "lv_demo_music_list.h"
+#include "lv_demo_music_eq.h"
 #include <stdio.h>   // 添加stdio.h用于printf
 #include <string.h>  // 添加string.h用于strlen
 
@@ -26,6 +27,7 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void index_timer_cb(lv_timer_t * t);
 #if APP_DEMO_MUSIC_AUTO_PLAY
     static void auto_step_cb(lv_timer_t * timer);
 #endif
@@ -97,9 +99,12 @@ static const uint32_t time_list[] = {
 #endif
 
 static lv_color_t original_screen_bg_color;
+static lv_timer_t * index_timer;
+static uint32_t index_version;
 
 uint32_t active_track_cnt = 5;  // 去掉static，使其成为全局变量
-static file_iterator_instance_t *_file_iterator = NULL;
+static dir_index_handle_t _tracks = NULL;
+static media_index_handle_t _media_index = NULL;
 static const char * artist_list_name = "Unknown Artist";
 static const char * genre_list_name = "Unknown Genre";
 static const uint32_t time_list_num = 3 * 60 + 30;  // 3分30秒
@@ -112,17 +117,25 @@ static const uint32_t time_list_num = 3 * 60 + 30;  // 3分30秒
  *   GLOBAL FUNCTIONS
  **********************/
 
-void lv_demo_music(lv_obj_t *parent, file_iterator_instance_t *file_iterator)
+void lv_demo_music(lv_obj_t *parent, dir_index_handle_t tracks, media_index_handle_t media_index)
 {
-    _file_iterator = file_iterator;
+    _tracks = tracks;
+    _media_index = media_index;
+    index_version = media_index_get_version(_media_index);
 
-    active_track_cnt = file_iterator_get_count(_file_iterator);
+    active_track_cnt = dir_index_get_count(_tracks);
 
     original_screen_bg_color = lv_obj_get_style_bg_color(parent, 0);
     lv_obj_set_style_bg_color(parent, lv_color_hex(0x343247), 0);
 
     list = _lv_demo_music_list_create(parent);
-    ctrl = _lv_demo_music_main_create(parent, file_iterator);
+    ctrl = _lv_demo_music_main_create(parent);
+#if CONFIG_MUSIC_PLAYER_EQ
+    _lv_demo_music_eq_create(parent);
+#endif
+
+    // 后台索引到新的曲目信息时刷新显示
+    index_timer = lv_timer_create(index_timer_cb, 1000, NULL);
 
 #if APP_DEMO_MUSIC_AUTO_PLAY
     auto_step_timer = lv_timer_create(auto_step_cb, 1000, NULL);
@@ -137,8 +150,12 @@ void lv_demo_music_close(void)
 #if APP_DEMO_MUSIC_AUTO_PLAY
     lv_timer_del(auto_step_timer);
 #endif
+    lv_timer_del(index_timer);
     _lv_demo_music_list_close();
     _lv_demo_music_main_close();
+#if CONFIG_MUSIC_PLAYER_EQ
+    _lv_demo_music_eq_close();
+#endif
 
     lv_obj_clean(lv_scr_act());
 
@@ -159,14 +176,23 @@ static bool contains_non_ascii(const char* str) {
 
 const char * _lv_demo_music_get_title(uint32_t track_id)
 {
-    if (_file_iterator == NULL) {
+    static char title[MEDIA_INDEX_TEXT_LEN];
+    media_index_info_t info;
+
+    if (_tracks == NULL) {
         return NULL;
     }
 
     if (track_id < active_track_cnt) {
-        const char *filename = file_iterator_get_name_from_index(_file_iterator, track_id);
-        
-        if (filename != NULL) {
+        // 优先使用标签中的标题
+        if (media_index_get(_media_index, track_id, &info) && (info.title[0] != '\0')) {
+            strcpy(title, info.title);
+            return title;
+        }
+
+        char filename[256];
+
+        if (dir_index_get_name(_tracks, track_id, filename, sizeof(filename)) == ESP_OK) {
             // 检查是否包含非ASCII字符（乱码）
             if (contains_non_ascii(filename)) {
                 // 为乱码文件名生成友好的显示名称
@@ -195,25 +221,34 @@ const char * _lv_demo_music_get_title(uint32_t track_id)
 
 const char * _lv_demo_music_get_artist(uint32_t track_id)
 {
-    if (_file_iterator == NULL) {
+    static char artist[MEDIA_INDEX_TEXT_LEN];
+    media_index_info_t info;
+
+    if (_tracks == NULL) {
         return artist_list_name;
     }
 
-    if (track_id < active_track_cnt) {
-        return artist_list_name;
+    if ((track_id < active_track_cnt) && media_index_get(_media_index, track_id, &info) && (info.artist[0] != '\0')) {
+        strcpy(artist, info.artist);
+        return artist;
     }
 
     return artist_list_name;
 }
 
+// 没有流派标签，显示专辑名
 const char * _lv_demo_music_get_genre(uint32_t track_id)
 {
-    if (_file_iterator == NULL) {
+    static char album[MEDIA_INDEX_TEXT_LEN];
+    media_index_info_t info;
+
+    if (_tracks == NULL) {
         return genre_list_name;
     }
 
-    if (track_id < active_track_cnt) {
-        return genre_list_name;
+    if ((track_id < active_track_cnt) && media_index_get(_media_index, track_id, &info) && (info.album[0] != '\0')) {
+        strcpy(album, info.album);
+        return album;
     }
 
     return genre_list_name;
@@ -221,12 +256,15 @@ const char * _lv_demo_music_get_genre(uint32_t track_id)
 
 uint32_t _lv_demo_music_get_track_length(uint32_t track_id)
 {
-    if (_file_iterator == NULL) {
+    media_index_info_t info;
+
+    if (_tracks == NULL) {
         return time_list_num;
     }
 
-    if (track_id < active_track_cnt) {
-        return time_list_num;
+    // 时长未知时使用默认值
+    if ((track_id < active_track_cnt) && media_index_get(_media_index, track_id, &info) && (info.duration_ms > 0)) {
+        return (info.duration_ms + 999) / 1000;
     }
 
     return time_list_num;
@@ -236,6 +274,18 @@ uint32_t _lv_demo_music_get_track_length(uint32_t track_id)
  *   STATIC FUNCTIONS
  **********************/
 
+static void index_timer_cb(lv_timer_t * t)
+{
+    uint32_t version = media_index_get_version(_media_index);
+
+    if (version == index_version) {
+        return;
+    }
+    index_version = version;
+    _lv_demo_music_list_refresh();
+    _lv_demo_music_main_refresh_info();
+}
+
 #if APP_DEMO_MUSIC_AUTO_PLAY
 static void auto_step_cb(lv_timer_t * t)
 {
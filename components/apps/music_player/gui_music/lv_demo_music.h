@@ -15,6 +15,8 @@ extern "C" {
  *********************/
 #include "lvgl.h"
 #include "bsp_board_extra.h"
+#include "media_index/media_index.h"
+#include "dir_index/dir_index.h"
 
 #define APP_DEMO_MUSIC_ENABLE       1
 #define APP_DEMO_MUSIC_LARGE        0
@@ -39,7 +41,7 @@ extern "C" {
  * GLOBAL PROTOTYPES
  **********************/
 
-void lv_demo_music(lv_obj_t *parent, file_iterator_instance_t *file_iterator);
+void lv_demo_music(lv_obj_t *parent, dir_index_handle_t tracks, media_index_handle_t media_index);
 void lv_demo_music_close(void);
 
 const char * _lv_demo_music_get_title(uint32_t track_id);
@@ -0,0 +1,211 @@
+/**
+ * @file lv_demo_music_eq.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_demo_music_eq.h"
+#if APP_DEMO_MUSIC_ENABLE
+
+#include <string.h>
+#include "lv_demo_music.h"
+#include "../music_eq.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define STATS_PERIOD_MS     1000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void sliders_update(void);
+static void preset_event_cb(lv_event_t * e);
+static void slider_event_cb(lv_event_t * e);
+static void close_event_cb(lv_event_t * e);
+static void stats_timer_cb(lv_timer_t * t);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_obj_t * panel;
+static lv_obj_t * preset_dd;
+static lv_obj_t * stats_label;
+static lv_obj_t * sliders[MUSIC_EQ_BAND_NUM];
+static lv_obj_t * gain_labels[MUSIC_EQ_BAND_NUM];
+static lv_timer_t * stats_timer;
+static const lv_font_t * font_small;
+static const lv_font_t * font_medium;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+lv_obj_t * _lv_demo_music_eq_create(lv_obj_t * parent)
+{
+#if APP_DEMO_MUSIC_LARGE
+    font_small = &lv_font_montserrat_16;
+    font_medium = &lv_font_montserrat_22;
+#else
+    font_small = &lv_font_montserrat_12;
+    font_medium = &lv_font_montserrat_16;
+#endif
+
+    /*A hidden panel over the lower part of the player, shown from the EQ button*/
+    panel = lv_obj_create(parent);
+    lv_obj_set_size(panel, LV_HOR_RES, LV_VER_RES * 2 / 3);
+    lv_obj_align(panel, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_bg_color(panel, lv_color_hex(0x4c4965), 0);
+    lv_obj_set_style_border_width(panel, 0, 0);
+    lv_obj_set_style_text_color(panel, lv_color_hex(0xffffff), 0);
+    lv_obj_set_style_text_font(panel, font_small, 0);
+    lv_obj_clear_flag(panel, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(panel, LV_OBJ_FLAG_HIDDEN);
+
+    static const lv_coord_t grid_cols[] = {LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_TEMPLATE_LAST};
+    static const lv_coord_t grid_rows[] = {LV_GRID_CONTENT, LV_GRID_CONTENT, LV_GRID_FR(1), LV_GRID_CONTENT, LV_GRID_TEMPLATE_LAST};
+    lv_obj_set_grid_dsc_array(panel, grid_cols, grid_rows);
+
+    char options[128] = "";
+    for(int i = 0; i < MUSIC_EQ_PRESET_NUM; i++) {
+        if(i > 0) strcat(options, "\n");
+        strcat(options, music_eq_get_preset_name((music_eq_preset_t)i));
+    }
+    preset_dd = lv_dropdown_create(panel);
+    lv_dropdown_set_options(preset_dd, options);
+    lv_obj_set_style_text_font(preset_dd, font_medium, 0);
+    lv_obj_set_grid_cell(preset_dd, LV_GRID_ALIGN_STRETCH, 0, 2, LV_GRID_ALIGN_CENTER, 0, 1);
+    lv_obj_add_event_cb(preset_dd, preset_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    stats_label = lv_label_create(panel);
+    lv_label_set_text(stats_label, "");
+    lv_obj_set_style_text_color(stats_label, lv_color_hex(0xb1b0be), 0);
+    lv_obj_set_grid_cell(stats_label, LV_GRID_ALIGN_CENTER, 2, 3, LV_GRID_ALIGN_CENTER, 0, 1);
+
+    lv_obj_t * close_btn = lv_btn_create(panel);
+    lv_obj_t * close_label = lv_label_create(close_btn);
+    lv_label_set_text(close_label, LV_SYMBOL_CLOSE);
+    lv_obj_set_grid_cell(close_btn, LV_GRID_ALIGN_END, 5, 1, LV_GRID_ALIGN_CENTER, 0, 1);
+    lv_obj_add_event_cb(close_btn, close_event_cb, LV_EVENT_CLICKED, NULL);
+
+    /*One vertical slider per band, with its gain above and its frequency below*/
+    for(int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+        gain_labels[b] = lv_label_create(panel);
+        lv_obj_set_grid_cell(gain_labels[b], LV_GRID_ALIGN_CENTER, b, 1, LV_GRID_ALIGN_CENTER, 1, 1);
+
+        sliders[b] = lv_slider_create(panel);
+        lv_slider_set_range(sliders[b], MUSIC_EQ_GAIN_MIN_DB, MUSIC_EQ_GAIN_MAX_DB);
+#if APP_DEMO_MUSIC_LARGE
+        lv_obj_set_width(sliders[b], 12);
+#else
+        lv_obj_set_width(sliders[b], 6);
+#endif
+        lv_obj_set_style_bg_color(sliders[b], lv_color_hex(0x569af8), LV_PART_INDICATOR);
+        lv_obj_set_style_bg_color(sliders[b], lv_color_hex(0xa666f1), LV_PART_KNOB);
+        lv_obj_set_grid_cell(sliders[b], LV_GRID_ALIGN_CENTER, b, 1, LV_GRID_ALIGN_STRETCH, 2, 1);
+        lv_obj_add_event_cb(sliders[b], slider_event_cb, LV_EVENT_VALUE_CHANGED, (void *)(intptr_t)b);
+
+        uint16_t hz = music_eq_get_band_hz(b);
+        lv_obj_t * hz_label = lv_label_create(panel);
+        if(hz >= 1000) lv_label_set_text_fmt(hz_label, "%d.%dk", hz / 1000, (hz % 1000) / 100);
+        else lv_label_set_text_fmt(hz_label, "%d", hz);
+        lv_obj_set_style_text_color(hz_label, lv_color_hex(0xb1b0be), 0);
+        lv_obj_set_grid_cell(hz_label, LV_GRID_ALIGN_CENTER, b, 1, LV_GRID_ALIGN_CENTER, 3, 1);
+    }
+
+    stats_timer = lv_timer_create(stats_timer_cb, STATS_PERIOD_MS, NULL);
+    lv_timer_pause(stats_timer);
+
+    return panel;
+}
+
+void _lv_demo_music_eq_close(void)
+{
+    lv_timer_del(stats_timer);
+    stats_timer = NULL;
+}
+
+void _lv_demo_music_eq_show(bool show)
+{
+    if(show) {
+        lv_dropdown_set_selected(preset_dd, music_eq_get_preset());
+        sliders_update();
+        stats_timer_cb(NULL);
+        lv_obj_clear_flag(panel, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_move_foreground(panel);
+        lv_timer_resume(stats_timer);
+    }
+    else {
+        lv_obj_add_flag(panel, LV_OBJ_FLAG_HIDDEN);
+        lv_timer_pause(stats_timer);
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static void sliders_update(void)
+{
+    int8_t gains[MUSIC_EQ_BAND_NUM];
+
+    music_eq_get_gains(music_eq_get_preset(), gains);
+    for(int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+        lv_slider_set_value(sliders[b], gains[b], LV_ANIM_OFF);
+        lv_label_set_text_fmt(gain_labels[b], "%+d", gains[b]);
+    }
+}
+
+static void preset_event_cb(lv_event_t * e)
+{
+    music_eq_set_preset((music_eq_preset_t)lv_dropdown_get_selected(lv_event_get_target(e)));
+    sliders_update();
+}
+
+static void slider_event_cb(lv_event_t * e)
+{
+    int band = (int)(intptr_t)lv_event_get_user_data(e);
+    int gain = lv_slider_get_value(lv_event_get_target(e));
+
+    // 编辑预设的某个频段时，以该预设为起点切换到自定义
+    music_eq_preset_t preset = music_eq_get_preset();
+    if(preset != MUSIC_EQ_PRESET_CUSTOM) {
+        int8_t gains[MUSIC_EQ_BAND_NUM];
+        music_eq_get_gains(preset, gains);
+        for(int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+            music_eq_set_custom_gain(b, gains[b]);
+        }
+        music_eq_set_preset(MUSIC_EQ_PRESET_CUSTOM);
+        lv_dropdown_set_selected(preset_dd, MUSIC_EQ_PRESET_CUSTOM);
+    }
+    music_eq_set_custom_gain(band, gain);
+    lv_label_set_text_fmt(gain_labels[band], "%+d", gain);
+}
+
+static void close_event_cb(lv_event_t * e)
+{
+    LV_UNUSED(e);
+    _lv_demo_music_eq_show(false);
+}
+
+static void stats_timer_cb(lv_timer_t * t)
+{
+    LV_UNUSED(t);
+    music_eq_stats_t stats;
+
+    music_eq_get_stats(&stats);
+    lv_label_set_text_fmt(stats_label, "DSP %d.%d%%  Limiter -%d dB", stats.load_permille / 10,
+                          stats.load_permille % 10, stats.limiter_db);
+}
+
+#endif /*APP_DEMO_MUSIC_ENABLE*/
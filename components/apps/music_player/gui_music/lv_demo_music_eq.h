@@ -0,0 +1,45 @@
+/**
+ * @file lv_demo_music_eq.h
+ *
+ */
+
+#ifndef APP_DEMO_MUSIC_EQ_H
+#define APP_DEMO_MUSIC_EQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_demo_music.h"
+#if APP_DEMO_MUSIC_ENABLE
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+lv_obj_t * _lv_demo_music_eq_create(lv_obj_t * parent);
+void _lv_demo_music_eq_close(void);
+
+void _lv_demo_music_eq_show(bool show);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*APP_DEMO_MUSIC_ENABLE*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*APP_DEMO_MUSIC_EQ_H*/
@@ -160,6 +160,22 @@ void _lv_demo_music_list_btn_check(uint32_t track_id, bool state)
     }
 }
 
+void _lv_demo_music_list_refresh(void)
+{
+    uint32_t cnt = lv_obj_get_child_cnt(list);
+
+    // 按钮的子对象依次为图标、标题、艺术家、时长
+    for(uint32_t track_id = 0; track_id < cnt; track_id++) {
+        lv_obj_t * btn = lv_obj_get_child(list, track_id);
+        uint32_t t = _lv_demo_music_get_track_length(track_id);
+        char time[32];
+        lv_snprintf(time, sizeof(time), "%"LV_PRIu32":%02"LV_PRIu32, t / 60, t % 60);
+        lv_label_set_text(lv_obj_get_child(btn, 1), _lv_demo_music_get_title(track_id));
+        lv_label_set_text(lv_obj_get_child(btn, 2), _lv_demo_music_get_artist(track_id));
+        lv_label_set_text(lv_obj_get_child(btn, 3), time);
+    }
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -31,6 +31,7 @@ lv_obj_t * _lv_demo_music_list_create(lv_obj_t * parent);
 void _lv_demo_music_list_close(void);
 
 void _lv_demo_music_list_btn_check(uint32_t track_id, bool state);
+void _lv_demo_music_list_refresh(void);
 
 /**********************
  *      MACROS
@@ -10,6 +10,7 @@
 #if APP_DEMO_MUSIC_ENABLE
 
 #include "lv_demo_music_list.h"
+#include "lv_demo_music_eq.h"
 #include "assets/spectrum_1.h"
 #include "assets/spectrum_2.h"
 #include "assets/spectrum_3.h"
@@ -18,6 +19,9 @@
 #include "esp_log.h"
 #include "bsp_board_extra.h"
 #include "audio_player.h"
+#include "../music_spectrum.h"
+#include "../music_queue.h"
+#include "asset_pack/asset_pack.h"
 
 /*********************
  *      DEFINES
@@ -39,6 +43,10 @@
 #define BAND_CNT            4
 #define BAR_PER_BAND_CNT    (BAR_CNT / BAND_CNT)
 
+#if MUSIC_SPECTRUM_BAND_NUM != BAND_CNT
+    #error "The audio spectrum must have one value per band"
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -55,6 +63,7 @@ static lv_obj_t * create_ctrl_box(lv_obj_t * parent);
 static lv_obj_t * create_handle(lv_obj_t * parent);
 
 static void spectrum_anim_cb(void * a, int32_t v);
+static void spectrum_update(void);
 static void start_anim_cb(void * a, int32_t v);
 static void spectrum_draw_event_cb(lv_event_t * e);
 static lv_obj_t * album_img_create(lv_obj_t * parent);
@@ -62,10 +71,17 @@ static void album_gesture_event_cb(lv_event_t * e);
 static void play_event_click_cb(lv_event_t * e);
 static void prev_click_event_cb(lv_event_t * e);
 static void next_click_event_cb(lv_event_t * e);
+#if CONFIG_MUSIC_PLAYER_EQ
+static void eq_click_event_cb(lv_event_t * e);
+#endif
 static void timer_cb(lv_timer_t * t);
+static void queue_timer_cb(lv_timer_t * t);
+static void play_anim_start(void);
 static void track_load(uint32_t id);
 static void stop_start_anim_timer_cb(lv_timer_t * t);
+#if !CONFIG_MUSIC_PLAYER_GAPLESS
 static void spectrum_end_cb(lv_anim_t * a);
+#endif
 static void album_fade_anim_cb(void * var, int32_t v);
 static int32_t get_cos(int32_t deg, int32_t a);
 static int32_t get_sin(int32_t deg, int32_t a);
@@ -88,6 +104,7 @@ static uint32_t spectrum_lane_ofs_start = 0;
 static uint32_t bar_rot = 0;
 static uint32_t time_act;
 static lv_timer_t  * sec_counter_timer;
+static lv_timer_t * queue_timer;
 static lv_timer_t * stop_start_anim_timer;
 static const lv_font_t * font_small;
 static const lv_font_t * font_large;
@@ -98,9 +115,9 @@ static lv_coord_t start_anim_values[40];
 static lv_obj_t * play_obj;
 static const uint16_t (* spectrum)[4];
 static uint32_t spectrum_len;
+static uint16_t spectrum_cur[BAND_CNT];   /*Bands drawn now, from the audio or from `spectrum`*/
 static const uint16_t rnd_array[30] = {994, 285, 553, 11, 792, 707, 966, 641, 852, 827, 44, 352, 146, 581, 490, 80, 729, 58, 695, 940, 724, 561, 124, 653, 27, 292, 557, 506, 382, 199};
 
-static file_iterator_instance_t *file_iterator;
 static bool pause = false;
 static bool pause_exit = false;
 
@@ -130,9 +147,8 @@ static void _obj_set_x_anim_cb(void * obj, int32_t x)
     lv_obj_set_x((lv_obj_t *)obj, (lv_coord_t)x);
 }
 
-lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent, file_iterator_instance_t *iterator)
+lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent)
 {
-    file_iterator = iterator;
     pause = false;
     playing = false;
     spectrum_i = 0;
@@ -144,6 +160,7 @@ lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent, file_iterator_instance_
     track_id = 0;
     start_anim = false;
     spectrum_len = 0;
+    lv_memset_00(spectrum_cur, sizeof(spectrum_cur));
 
 #if APP_DEMO_MUSIC_LARGE
     font_small = &lv_font_montserrat_22;
@@ -248,6 +265,7 @@ lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent, file_iterator_instance_
 
     sec_counter_timer = lv_timer_create(timer_cb, 1000, NULL);
     lv_timer_pause(sec_counter_timer);
+    queue_timer = lv_timer_create(queue_timer_cb, 100, NULL);
 
     /*Animate in the content after the intro time*/
     lv_anim_t a;
@@ -318,6 +336,7 @@ void _lv_demo_music_main_close(void)
 {
     if(stop_start_anim_timer) lv_timer_del(stop_start_anim_timer);
     lv_timer_del(sec_counter_timer);
+    lv_timer_del(queue_timer);
 }
 
 void _lv_demo_music_album_next(bool next)
@@ -346,13 +365,7 @@ void _lv_demo_music_album_next(bool next)
 
 void _lv_demo_music_play(uint32_t id)
 {
-    uint8_t current = file_iterator_get_index(file_iterator);
-    LV_LOG_USER("play:%d, current:%d", id, current);
-    if (current != id) {
-        file_iterator_set_index(file_iterator, id);
-        //play_index(id);
-        LV_LOG_USER("audio_play actual:%d", id);
-    }
+    LV_LOG_USER("play:%d", id);
 
     track_load(id);
 
@@ -364,31 +377,15 @@ void _lv_demo_music_resume(void)
     spectrum_i = spectrum_i_pause;
     LV_LOG_USER("resume, [%d-%d]", spectrum_i, spectrum_len);
 
-    lv_anim_t a;
-    lv_anim_init(&a);
-    lv_anim_set_values(&a, spectrum_i, spectrum_len - 1);
-    lv_anim_set_exec_cb(&a, spectrum_anim_cb);
-    lv_anim_set_var(&a, spectrum_obj);
-    // 修改：使用音乐的实际长度而不是频谱数据长度来计算动画时长
-    uint32_t track_length = _lv_demo_music_get_track_length(track_id);
-    uint32_t remaining_time = track_length - time_act;
-    lv_anim_set_time(&a, remaining_time * 1000);  // 转换为毫秒
-    lv_anim_set_playback_time(&a, 0);
-    lv_anim_set_ready_cb(&a, spectrum_end_cb);
-    lv_anim_start(&a);
+    play_anim_start();
 
-    lv_timer_resume(sec_counter_timer);
-    lv_slider_set_range(slider_obj, 0, track_length);
-
-    lv_obj_add_state(play_obj, LV_STATE_CHECKED);
-
-    if (!pause_exit && pause && bsp_extra_player_is_playing_by_index(file_iterator, track_id)) {
+    if (!pause_exit && pause && music_queue_is_current(track_id)) {
         LV_LOG_USER("Resume music");
         audio_player_resume();
     } else {
         pause_exit = false;
         LV_LOG_USER("Music is not playing. Start playing.");
-        bsp_extra_player_play_index(file_iterator, track_id);
+        music_queue_play(track_id);
     }
 
     playing = true;
@@ -403,6 +400,7 @@ void _lv_demo_music_pause(void)
     pause = true;
     spectrum_i_pause = spectrum_i;
     spectrum_i = 0;
+    lv_memset_00(spectrum_cur, sizeof(spectrum_cur));
     lv_anim_del(spectrum_obj, spectrum_anim_cb);
     lv_obj_invalidate(spectrum_obj);
     lv_img_set_zoom(album_img_obj, LV_IMG_ZOOM_NONE);
@@ -417,10 +415,44 @@ void _lv_demo_music_exit_pause(void)
     pause_exit = true;
 }
 
+void _lv_demo_music_main_refresh_info(void)
+{
+    lv_label_set_text(title_label, _lv_demo_music_get_title(track_id));
+    lv_label_set_text(artist_label, _lv_demo_music_get_artist(track_id));
+    lv_label_set_text(genre_label, _lv_demo_music_get_genre(track_id));
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+static void play_anim_start(void)
+{
+    lv_anim_t a;
+    lv_anim_init(&a);
+    lv_anim_set_values(&a, spectrum_i, spectrum_len - 1);
+    lv_anim_set_exec_cb(&a, spectrum_anim_cb);
+    lv_anim_set_var(&a, spectrum_obj);
+    // 修改：使用音乐的实际长度而不是频谱数据长度来计算动画时长
+    uint32_t track_length = _lv_demo_music_get_track_length(track_id);
+    uint32_t remaining_time = track_length - time_act;
+    lv_anim_set_time(&a, remaining_time * 1000);  // 转换为毫秒
+    lv_anim_set_playback_time(&a, 0);
+#if CONFIG_MUSIC_PLAYER_GAPLESS
+    // 播放队列在音频真正结束时切歌，动画一直循环到那时
+    if(remaining_time == 0) lv_anim_set_time(&a, 1000);
+    lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+#else
+    lv_anim_set_ready_cb(&a, spectrum_end_cb);
+#endif
+    lv_anim_start(&a);
+
+    lv_timer_resume(sec_counter_timer);
+    lv_slider_set_range(slider_obj, 0, track_length);
+
+    lv_obj_add_state(play_obj, LV_STATE_CHECKED);
+}
+
 static lv_obj_t * create_cont(lv_obj_t * parent)
 {
     /*A transparent container in which the player section will be scrolled*/
@@ -650,6 +682,17 @@ static lv_obj_t * create_ctrl_box(lv_obj_t * parent)
     lv_obj_add_event_cb(icon, next_click_event_cb, LV_EVENT_CLICKED, NULL);
     lv_obj_add_flag(icon, LV_OBJ_FLAG_CLICKABLE);
 
+#if CONFIG_MUSIC_PLAYER_EQ
+    lv_obj_t * eq_label = lv_label_create(cont);
+    lv_obj_set_style_text_font(eq_label, font_small, 0);
+    lv_obj_set_style_text_color(eq_label, lv_color_hex(0x8a86b8), 0);
+    lv_label_set_text(eq_label, "EQ");
+    lv_obj_set_grid_cell(eq_label, LV_GRID_ALIGN_CENTER, 6, 1, LV_GRID_ALIGN_CENTER, 0, 1);
+    lv_obj_add_event_cb(eq_label, eq_click_event_cb, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_flag(eq_label, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_ext_click_area(eq_label, 10);
+#endif
+
     LV_IMG_DECLARE(img_lv_demo_music_slider_knob);
     slider_obj = lv_slider_create(cont);
     lv_obj_set_style_anim_time(slider_obj, 100, 0);
@@ -711,6 +754,7 @@ static lv_obj_t * create_handle(lv_obj_t * parent)
 static void track_load(uint32_t id)
 {
     spectrum_i = 0;
+    lv_memset_00(spectrum_cur, sizeof(spectrum_cur));
     time_act = 0;
     spectrum_i_pause = 0;
     lv_slider_set_value(slider_obj, 0, LV_ANIM_OFF);
@@ -869,7 +913,7 @@ static void spectrum_draw_event_cb(lv_event_t * e)
 
             /* Add "side bars" with cosine characteristic.*/
             for(f = 0; f < band_w; f++) {
-                uint32_t ampl_main = spectrum[spectrum_i][s];
+                uint32_t ampl_main = spectrum_cur[s];
                 int32_t ampl_mod = get_cos(f * 360 / band_w + 180, 180) + 180;
                 int32_t t = BAR_PER_BAND_CNT * s - band_w / 2 + f;
                 if(t < 0) t = BAR_CNT + t;
@@ -940,12 +984,13 @@ static void spectrum_anim_cb(void * a, int32_t v)
     }
 
     spectrum_i = v;
+    spectrum_update();
     lv_obj_invalidate(obj);
 
     static uint32_t bass_cnt = 0;
     static int32_t last_bass = -1000;
     static int32_t dir = 1;
-    if(spectrum[spectrum_i][0] > 12) {
+    if(spectrum_cur[0] > 12) {
         if(spectrum_i - last_bass > 5) {
             bass_cnt++;
             last_bass = spectrum_i;
@@ -956,9 +1001,17 @@ static void spectrum_anim_cb(void * a, int32_t v)
             }
         }
     }
-    if(spectrum[spectrum_i][0] < 4) bar_rot += dir;
+    if(spectrum_cur[0] < 4) bar_rot += dir;
 
-    lv_img_set_zoom(album_img_obj, LV_IMG_ZOOM_NONE + spectrum[spectrum_i][0]);
+    lv_img_set_zoom(album_img_obj, LV_IMG_ZOOM_NONE + spectrum_cur[0]);
+}
+
+static void spectrum_update(void)
+{
+    /*Show the spectrum of the audio being played, or the canned one of the cover if it can't be analyzed*/
+    if(!music_spectrum_get(spectrum_cur)) {
+        lv_memcpy(spectrum_cur, spectrum[spectrum_i], sizeof(spectrum_cur));
+    }
 }
 
 static void start_anim_cb(void * a, int32_t v)
@@ -970,26 +1023,22 @@ static void start_anim_cb(void * a, int32_t v)
 
 static lv_obj_t * album_img_create(lv_obj_t * parent)
 {
-    LV_IMG_DECLARE(img_lv_demo_music_cover_1);
-    LV_IMG_DECLARE(img_lv_demo_music_cover_2);
-    LV_IMG_DECLARE(img_lv_demo_music_cover_3);
-
     lv_obj_t * img;
     img = lv_img_create(parent);
 
     switch(track_id % 3) {
         case 0:
-            lv_img_set_src(img, &img_lv_demo_music_cover_1);
+            lv_img_set_src(img, ASSET_PACK_SRC("img_lv_demo_music_cover_1"));
             spectrum = spectrum_1;
             spectrum_len = sizeof(spectrum_1) / sizeof(spectrum_1[0]);
             break;
         case 1:
-            lv_img_set_src(img, &img_lv_demo_music_cover_2);
+            lv_img_set_src(img, ASSET_PACK_SRC("img_lv_demo_music_cover_2"));
             spectrum = spectrum_2;
             spectrum_len = sizeof(spectrum_2) / sizeof(spectrum_2[0]);
             break;
         default:
-            lv_img_set_src(img, &img_lv_demo_music_cover_3);
+            lv_img_set_src(img, ASSET_PACK_SRC("img_lv_demo_music_cover_3"));
             spectrum = spectrum_3;
             spectrum_len = sizeof(spectrum_3) / sizeof(spectrum_3[0]);
             break;
@@ -1036,6 +1085,14 @@ static void next_click_event_cb(lv_event_t * e)
     }
 }
 
+#if CONFIG_MUSIC_PLAYER_EQ
+static void eq_click_event_cb(lv_event_t * e)
+{
+    LV_UNUSED(e);
+    _lv_demo_music_eq_show(true);
+}
+#endif
+
 static void timer_cb(lv_timer_t * t)
 {
     LV_UNUSED(t);
@@ -1045,7 +1102,10 @@ static void timer_cb(lv_timer_t * t)
     if (time_act >= track_length) {
         // 歌曲结束，停止计时器并切换到下一首
         lv_timer_pause(sec_counter_timer);
+        // 无缝播放时由播放队列在音频真正结束时切歌
+#if !CONFIG_MUSIC_PLAYER_GAPLESS
         _lv_demo_music_album_next(true);
+#endif
         return;
     }
     
@@ -1054,11 +1114,24 @@ static void timer_cb(lv_timer_t * t)
     lv_slider_set_value(slider_obj, time_act, LV_ANIM_ON);
 }
 
+static void queue_timer_cb(lv_timer_t * t)
+{
+    LV_UNUSED(t);
+    int id;
+
+    // 播放队列已经自动开始播放下一首，这里只更新界面
+    if(!music_queue_take_advance(&id)) return;
+    track_load(id);
+    if(playing) play_anim_start();
+}
+
+#if !CONFIG_MUSIC_PLAYER_GAPLESS
 static void spectrum_end_cb(lv_anim_t * a)
 {
     LV_UNUSED(a);
     _lv_demo_music_album_next(true);
 }
+#endif
 
 static void stop_start_anim_timer_cb(lv_timer_t * t)
 {
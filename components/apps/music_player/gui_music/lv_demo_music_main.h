@@ -29,7 +29,7 @@ extern uint32_t active_track_cnt;
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
-lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent, file_iterator_instance_t *iterator);
+lv_obj_t * _lv_demo_music_main_create(lv_obj_t * parent);
 void _lv_demo_music_main_close(void);
 
 void _lv_demo_music_play(uint32_t id);
@@ -37,6 +37,7 @@ void _lv_demo_music_resume(void);
 void _lv_demo_music_pause(void);
 void _lv_demo_music_exit_pause(void);
 void _lv_demo_music_album_next(bool next);
+void _lv_demo_music_main_refresh_info(void);
 
 /**********************
  *      MACROS
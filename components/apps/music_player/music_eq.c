@@ -0,0 +1,379 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "music_eq.h"
+
+#if CONFIG_MUSIC_PLAYER_EQ
+#include "esp_timer.h"
+#include "esp_dsp.h"
+#include "settings_store/settings_store.h"
+
+#define EQ_PEAK_Q                   (1.0f)
+#define EQ_SHELF_Q                  (0.707f)
+#define EQ_MAX_HZ_RATIO             (0.45f)     /* Bands above this fraction of the sample rate are skipped */
+#define EQ_LIMIT_LEVEL              (0.966f)    /* -0.3 dBFS */
+#define EQ_LIMIT_RELEASE_MS         (100)
+#define EQ_CUSTOM_BITS              (5)         /* Bits of a custom gain in `SETTINGS_KEY_MUSIC_EQ_CUSTOM` */
+#define EQ_CUSTOM_MASK              ((1 << EQ_CUSTOM_BITS) - 1)
+
+static const char *TAG = "music_eq";
+
+static const uint16_t eq_band_hz[MUSIC_EQ_BAND_NUM] = {60, 170, 500, 1400, 4000, 12000};
+
+static const int8_t eq_preset_gains[MUSIC_EQ_PRESET_CUSTOM][MUSIC_EQ_BAND_NUM] = {
+    [MUSIC_EQ_PRESET_FLAT]      = {0, 0, 0, 0, 0, 0},
+    [MUSIC_EQ_PRESET_BASS]      = {6, 4, 1, 0, 0, 0},
+    [MUSIC_EQ_PRESET_VOCAL]     = {-2, -1, 2, 4, 2, 0},
+    [MUSIC_EQ_PRESET_TREBLE]    = {0, 0, 0, 1, 4, 6},
+    [MUSIC_EQ_PRESET_LOUDNESS]  = {6, 3, 0, -1, 2, 5},
+};
+
+static const char *const eq_preset_names[MUSIC_EQ_PRESET_NUM] = {
+    [MUSIC_EQ_PRESET_FLAT]      = "Flat",
+    [MUSIC_EQ_PRESET_BASS]      = "Bass",
+    [MUSIC_EQ_PRESET_VOCAL]     = "Vocal",
+    [MUSIC_EQ_PRESET_TREBLE]    = "Treble",
+    [MUSIC_EQ_PRESET_LOUDNESS]  = "Loudness",
+    [MUSIC_EQ_PRESET_CUSTOM]    = "Custom",
+};
+
+static portMUX_TYPE eq_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct {
+    /* Guarded by `eq_lock`, set from the UI and read by the audio player task */
+    music_eq_preset_t preset;
+    int8_t custom[MUSIC_EQ_BAND_NUM];
+    uint32_t generation;
+    music_eq_stats_t stats;
+    /* Only used by the audio player task */
+    uint32_t applied_generation;
+    uint32_t applied_rate;
+    int band_num;                               /* Bands with a gain below the Nyquist limit, 0 to bypass */
+    float coef[MUSIC_EQ_BAND_NUM][5];           /* b0, b1, b2, a1, a2 of the esp-dsp biquads */
+    float w[2][MUSIC_EQ_BAND_NUM][2];           /* Delay lines of each channel */
+    float env;
+    float release;
+    float min_gain;
+    int64_t busy_us;
+    uint32_t frames;
+} eq = {
+    .generation = 1,
+};
+
+/* Two buffers per channel, the biquads of the bands go back and forth between them */
+static float eq_buf[2][2][MUSIC_EQ_BLOCK_FRAMES] __attribute__((aligned(16)));
+static int32_t eq_out[MUSIC_EQ_BLOCK_FRAMES * 2];
+
+/* Audio EQ Cookbook (R. Bristow-Johnson), normalized by a0 */
+static void eq_gen_coef(float *coef, bool low_shelf, bool high_shelf, float gain_db, float freq, float sample_rate)
+{
+    float a = powf(10, gain_db / 40);
+    float w0 = 2 * M_PI * freq / sample_rate;
+    float c = cosf(w0);
+    float alpha = sinf(w0) / (2 * ((low_shelf || high_shelf) ? EQ_SHELF_Q : EQ_PEAK_Q));
+    float b0, b1, b2, a0, a1, a2;
+
+    if (low_shelf || high_shelf) {
+        float sign = low_shelf ? 1 : -1;
+        float k = 2 * sqrtf(a) * alpha;
+        b0 = a * ((a + 1) - sign * (a - 1) * c + k);
+        b1 = sign * 2 * a * ((a - 1) - sign * (a + 1) * c);
+        b2 = a * ((a + 1) - sign * (a - 1) * c - k);
+        a0 = (a + 1) + sign * (a - 1) * c + k;
+        a1 = -sign * 2 * ((a - 1) + sign * (a + 1) * c);
+        a2 = (a + 1) + sign * (a - 1) * c - k;
+    } else {
+        b0 = 1 + alpha * a;
+        b1 = -2 * c;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * c;
+        a2 = 1 - alpha / a;
+    }
+    coef[0] = b0 / a0;
+    coef[1] = b1 / a0;
+    coef[2] = b2 / a0;
+    coef[3] = a1 / a0;
+    coef[4] = a2 / a0;
+}
+
+static void eq_copy_gains(music_eq_preset_t preset, const int8_t *custom, int8_t *gains)
+{
+    if (preset == MUSIC_EQ_PRESET_CUSTOM) {
+        memcpy(gains, custom, MUSIC_EQ_BAND_NUM);
+    } else if (preset < MUSIC_EQ_PRESET_CUSTOM) {
+        memcpy(gains, eq_preset_gains[preset], MUSIC_EQ_BAND_NUM);
+    } else {
+        memset(gains, 0, MUSIC_EQ_BAND_NUM);
+    }
+}
+
+static void eq_apply(uint32_t sample_rate)
+{
+    int8_t gains[MUSIC_EQ_BAND_NUM];
+
+    taskENTER_CRITICAL(&eq_lock);
+    eq_copy_gains(eq.preset, eq.custom, gains);
+    eq.applied_generation = eq.generation;
+    taskEXIT_CRITICAL(&eq_lock);
+
+    // The delay lines are kept on a gain change, it fades in with the music instead of clicking
+    if (sample_rate != eq.applied_rate) {
+        memset(eq.w, 0, sizeof(eq.w));
+        eq.env = 0;
+        eq.release = expf(-1000.0f / (EQ_LIMIT_RELEASE_MS * (float)sample_rate));
+        eq.applied_rate = sample_rate;
+    }
+
+    int band_num = 0;
+    for (int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+        if ((gains[b] == 0) || (eq_band_hz[b] >= EQ_MAX_HZ_RATIO * sample_rate)) {
+            continue;
+        }
+        // Bands are packed to the front, so are their delay lines
+        if (band_num != b) {
+            memcpy(eq.w[0][band_num], eq.w[0][b], sizeof(eq.w[0][b]));
+            memcpy(eq.w[1][band_num], eq.w[1][b], sizeof(eq.w[1][b]));
+        }
+        eq_gen_coef(eq.coef[band_num], b == 0, b == MUSIC_EQ_BAND_NUM - 1, gains[b], eq_band_hz[b], sample_rate);
+        band_num++;
+    }
+    eq.band_num = band_num;
+    if (band_num == 0) {
+        eq.busy_us = 0;
+        eq.frames = 0;
+        taskENTER_CRITICAL(&eq_lock);
+        memset(&eq.stats, 0, sizeof(eq.stats));
+        taskEXIT_CRITICAL(&eq_lock);
+    }
+    ESP_LOGD(TAG, "%d bands at %" PRIu32 " Hz", band_num, sample_rate);
+}
+
+static void eq_count(int frames, uint32_t sample_rate, int64_t busy_us)
+{
+    eq.busy_us += busy_us;
+    eq.frames += frames;
+    if (eq.frames < sample_rate) {
+        return;
+    }
+
+    int64_t audio_us = (int64_t)eq.frames * 1000000 / sample_rate;
+    music_eq_stats_t stats = {
+        .load_permille = (uint16_t)(eq.busy_us * 1000 / audio_us),
+        .limiter_db = (eq.min_gain < 1) ? (uint8_t)(0.5f - 20 * log10f(eq.min_gain)) : 0,
+    };
+    taskENTER_CRITICAL(&eq_lock);
+    eq.stats = stats;
+    taskEXIT_CRITICAL(&eq_lock);
+    eq.busy_us = 0;
+    eq.frames = 0;
+    eq.min_gain = 1;
+}
+#endif
+
+esp_err_t music_eq_init(void)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    int32_t preset = settings_store_get(SETTINGS_KEY_MUSIC_EQ_PRESET);
+    uint32_t packed = (uint32_t)settings_store_get(SETTINGS_KEY_MUSIC_EQ_CUSTOM);
+    int8_t custom[MUSIC_EQ_BAND_NUM];
+
+    for (int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+        int value = (packed >> (b * EQ_CUSTOM_BITS)) & EQ_CUSTOM_MASK;
+        value = (value > (EQ_CUSTOM_MASK >> 1)) ? (value - (EQ_CUSTOM_MASK + 1)) : value;
+        custom[b] = (int8_t)((value < MUSIC_EQ_GAIN_MIN_DB) ? MUSIC_EQ_GAIN_MIN_DB :
+                             (value > MUSIC_EQ_GAIN_MAX_DB) ? MUSIC_EQ_GAIN_MAX_DB : value);
+    }
+
+    taskENTER_CRITICAL(&eq_lock);
+    eq.preset = ((preset >= 0) && (preset < MUSIC_EQ_PRESET_NUM)) ? (music_eq_preset_t)preset : MUSIC_EQ_PRESET_FLAT;
+    memcpy(eq.custom, custom, sizeof(eq.custom));
+    eq.generation++;
+    taskEXIT_CRITICAL(&eq_lock);
+    ESP_LOGI(TAG, "Preset %s", eq_preset_names[eq.preset]);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t music_eq_set_preset(music_eq_preset_t preset)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    ESP_RETURN_ON_FALSE(preset < MUSIC_EQ_PRESET_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid preset");
+
+    taskENTER_CRITICAL(&eq_lock);
+    eq.preset = preset;
+    eq.generation++;
+    taskEXIT_CRITICAL(&eq_lock);
+
+    return settings_store_set(SETTINGS_KEY_MUSIC_EQ_PRESET, preset);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+music_eq_preset_t music_eq_get_preset(void)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    return eq.preset;
+#else
+    return MUSIC_EQ_PRESET_FLAT;
+#endif
+}
+
+const char *music_eq_get_preset_name(music_eq_preset_t preset)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    return (preset < MUSIC_EQ_PRESET_NUM) ? eq_preset_names[preset] : "";
+#else
+    return (preset == MUSIC_EQ_PRESET_FLAT) ? "Flat" : "";
+#endif
+}
+
+esp_err_t music_eq_set_custom_gain(int band, int gain_db)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    ESP_RETURN_ON_FALSE((band >= 0) && (band < MUSIC_EQ_BAND_NUM), ESP_ERR_INVALID_ARG, TAG, "Invalid band");
+
+    gain_db = (gain_db < MUSIC_EQ_GAIN_MIN_DB) ? MUSIC_EQ_GAIN_MIN_DB :
+              (gain_db > MUSIC_EQ_GAIN_MAX_DB) ? MUSIC_EQ_GAIN_MAX_DB : gain_db;
+    uint32_t packed = 0;
+    taskENTER_CRITICAL(&eq_lock);
+    eq.custom[band] = (int8_t)gain_db;
+    for (int b = 0; b < MUSIC_EQ_BAND_NUM; b++) {
+        packed |= ((uint32_t)eq.custom[b] & EQ_CUSTOM_MASK) << (b * EQ_CUSTOM_BITS);
+    }
+    eq.generation++;
+    taskEXIT_CRITICAL(&eq_lock);
+
+    return settings_store_set(SETTINGS_KEY_MUSIC_EQ_CUSTOM, (int32_t)packed);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void music_eq_get_gains(music_eq_preset_t preset, int8_t *gains)
+{
+    if (gains == NULL) {
+        return;
+    }
+#if CONFIG_MUSIC_PLAYER_EQ
+    taskENTER_CRITICAL(&eq_lock);
+    eq_copy_gains(preset, eq.custom, gains);
+    taskEXIT_CRITICAL(&eq_lock);
+#else
+    memset(gains, 0, MUSIC_EQ_BAND_NUM);
+#endif
+}
+
+uint16_t music_eq_get_band_hz(int band)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    return ((band >= 0) && (band < MUSIC_EQ_BAND_NUM)) ? eq_band_hz[band] : 0;
+#else
+    return 0;
+#endif
+}
+
+int music_eq_process(const void *data, int len, uint8_t bits_per_sample, uint8_t channel, uint32_t sample_rate,
+                     const void **out)
+{
+#if CONFIG_MUSIC_PLAYER_EQ
+    if ((data == NULL) || (out == NULL) || (channel == 0) || (channel > 2) || (sample_rate == 0) ||
+            ((bits_per_sample != 16) && (bits_per_sample != 32))) {
+        return 0;
+    }
+    if ((eq.applied_generation != eq.generation) || (eq.applied_rate != sample_rate)) {
+        eq_apply(sample_rate);
+    }
+    if (eq.band_num == 0) {
+        return 0;
+    }
+
+    int frame_size = (bits_per_sample / 8) * channel;
+    int frames = len / frame_size;
+    frames = (frames > MUSIC_EQ_BLOCK_FRAMES) ? MUSIC_EQ_BLOCK_FRAMES : frames;
+    if (frames == 0) {
+        return 0;
+    }
+    int64_t start_us = esp_timer_get_time();
+
+    // Deinterleave to float, full scale is 1
+    const float in_scale = (bits_per_sample == 16) ? (1.0f / 32768) : (1.0f / 2147483648.0f);
+    for (int c = 0; c < channel; c++) {
+        float *dst = eq_buf[c][0];
+        if (bits_per_sample == 16) {
+            const int16_t *src = (const int16_t *)data + c;
+            for (int i = 0; i < frames; i++) {
+                dst[i] = src[i * channel] * in_scale;
+            }
+        } else {
+            const int32_t *src = (const int32_t *)data + c;
+            for (int i = 0; i < frames; i++) {
+                dst[i] = src[i * channel] * in_scale;
+            }
+        }
+    }
+
+    int cur = 0;
+    for (int b = 0; b < eq.band_num; b++) {
+        for (int c = 0; c < channel; c++) {
+            dsps_biquad_f32(eq_buf[c][cur], eq_buf[c][!cur], frames, eq.coef[b], eq.w[c][b]);
+        }
+        cur = !cur;
+    }
+
+    // Instant attack on the louder channel: the envelope is never under the sample, so the output never clips
+    const float *left = eq_buf[0][cur];
+    const float *right = eq_buf[channel - 1][cur];
+    const float out_scale = (bits_per_sample == 16) ? 32767.0f : 2147483520.0f;
+    float env = eq.env;
+    float min_gain = (eq.frames == 0) ? 1 : eq.min_gain;
+    for (int i = 0; i < frames; i++) {
+        float peak = fmaxf(fabsf(left[i]), fabsf(right[i]));
+        env = (peak > env) ? peak : env * eq.release;
+        float gain = (env > EQ_LIMIT_LEVEL) ? (EQ_LIMIT_LEVEL / env) : 1;
+        min_gain = fminf(min_gain, gain);
+        for (int c = 0; c < channel; c++) {
+            float sample = eq_buf[c][cur][i] * gain * out_scale;
+            if (bits_per_sample == 16) {
+                ((int16_t *)eq_out)[i * channel + c] = (int16_t)lrintf(sample);
+            } else {
+                eq_out[i * channel + c] = (int32_t)lrintf(sample);
+            }
+        }
+    }
+    eq.env = env;
+    eq.min_gain = min_gain;
+
+    eq_count(frames, sample_rate, esp_timer_get_time() - start_us);
+    *out = eq_out;
+
+    return frames * frame_size;
+#else
+    return 0;
+#endif
+}
+
+void music_eq_get_stats(music_eq_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+#if CONFIG_MUSIC_PLAYER_EQ
+    taskENTER_CRITICAL(&eq_lock);
+    *stats = eq.stats;
+    taskEXIT_CRITICAL(&eq_lock);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
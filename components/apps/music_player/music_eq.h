@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MUSIC_EQ_BAND_NUM           (6)
+#define MUSIC_EQ_GAIN_MIN_DB        (-12)
+#define MUSIC_EQ_GAIN_MAX_DB        (12)
+#define MUSIC_EQ_BLOCK_FRAMES       (256)   /* Frames filtered per block, a codec write is split in such blocks */
+
+typedef enum {
+    MUSIC_EQ_PRESET_FLAT = 0,               /*!< No processing, the PCM data goes to the codec untouched */
+    MUSIC_EQ_PRESET_BASS,
+    MUSIC_EQ_PRESET_VOCAL,
+    MUSIC_EQ_PRESET_TREBLE,
+    MUSIC_EQ_PRESET_LOUDNESS,
+    MUSIC_EQ_PRESET_CUSTOM,                 /*!< Gains set with `music_eq_set_custom_gain()` */
+    MUSIC_EQ_PRESET_NUM,
+} music_eq_preset_t;
+
+typedef struct {
+    uint16_t load_permille;                 /*!< Processing time over the audio time of the last second, in 0.1 % */
+    uint8_t limiter_db;                     /*!< Deepest gain reduction of the limiter in the last second */
+} music_eq_stats_t;
+
+/**
+ * @brief Load the preset and the custom gains from the settings store.
+ *
+ * The preset is saved as `SETTINGS_KEY_MUSIC_EQ_PRESET` and the custom gains, 5 bits per band, as
+ * `SETTINGS_KEY_MUSIC_EQ_CUSTOM`.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if `CONFIG_MUSIC_PLAYER_EQ` is disabled
+ */
+esp_err_t music_eq_init(void);
+
+/**
+ * @brief Select and save a preset, applied from the next block written to the codec.
+ *
+ * @param preset Preset
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an invalid preset, ESP_ERR_NOT_SUPPORTED if the EQ is disabled
+ */
+esp_err_t music_eq_set_preset(music_eq_preset_t preset);
+
+/**
+ * @brief Get the selected preset.
+ */
+music_eq_preset_t music_eq_get_preset(void);
+
+/**
+ * @brief Get the name of a preset, "" for an invalid one.
+ */
+const char *music_eq_get_preset_name(music_eq_preset_t preset);
+
+/**
+ * @brief Set and save the gain of a band of the custom preset, applied right away if it is selected.
+ *
+ * @param band    Band, 0 to `MUSIC_EQ_BAND_NUM - 1`
+ * @param gain_db Gain, clamped to `MUSIC_EQ_GAIN_MIN_DB` to `MUSIC_EQ_GAIN_MAX_DB`
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for an invalid band, ESP_ERR_NOT_SUPPORTED if the EQ is disabled
+ */
+esp_err_t music_eq_set_custom_gain(int band, int gain_db);
+
+/**
+ * @brief Get the band gains of a preset.
+ *
+ * @param preset Preset
+ * @param gains  Array of `MUSIC_EQ_BAND_NUM` gains in dB to fill, zeroed for an invalid preset
+ */
+void music_eq_get_gains(music_eq_preset_t preset, int8_t *gains);
+
+/**
+ * @brief Get the center frequency of a band in Hz, the first and the last band are shelves.
+ */
+uint16_t music_eq_get_band_hz(int band);
+
+/**
+ * @brief Filter a block of the PCM data written to the codec, called by the codec tap of the audio player task.
+ *
+ * The samples (16 or 32 bit, mono or interleaved stereo) go through the biquads (esp-dsp) of the bands with a gain
+ * and a stereo linked peak limiter that keeps them under full scale.
+ *
+ * @param data            PCM data
+ * @param len             Length of `data` in bytes
+ * @param bits_per_sample Sample size of the codec
+ * @param channel         Channels of the codec
+ * @param sample_rate     Sample rate of the codec
+ * @param out             Filtered data, in a buffer of the EQ valid until the next call
+ *
+ * @return Bytes of `data` filtered into `out`, at most `MUSIC_EQ_BLOCK_FRAMES` frames. 0 if the data must go to the
+ *         codec untouched: flat preset, unsupported format or EQ disabled.
+ */
+int music_eq_process(const void *data, int len, uint8_t bits_per_sample, uint8_t channel, uint32_t sample_rate,
+                     const void **out);
+
+/**
+ * @brief Get the processing load and the limiter activity.
+ *
+ * @param stats Output stats, zeroed if the EQ is disabled or has not run
+ */
+void music_eq_get_stats(music_eq_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,357 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "bsp_board_extra.h"
+#include "task_config/task_config.h"
+#include "pm_policy/pm_policy.h"
+#include "audio_player.h"
+#include "music_source.h"
+#include "music_queue.h"
+
+#define QUEUE_PATH_MAX              (256)
+#define QUEUE_EVENT_NUM             (8)
+#define QUEUE_FAIL_PLAY_MS          (1000)  /* A track that ends this soon is counted as failed */
+
+static const char *TAG = "music_queue";
+
+static dir_index_handle_t queue_tracks = NULL;
+
+/* Used without the queue task, the BSP player opens the file itself */
+static esp_err_t queue_play_file(int index)
+{
+    char path[QUEUE_PATH_MAX];
+
+    ESP_RETURN_ON_ERROR(dir_index_get_path(queue_tracks, index, path, sizeof(path)), TAG, "No track %d", index);
+
+    return bsp_extra_player_play_file(path);
+}
+
+static bool queue_is_playing_file(int index)
+{
+    char path[QUEUE_PATH_MAX];
+
+    return (dir_index_get_path(queue_tracks, index, path, sizeof(path)) == ESP_OK) &&
+           bsp_extra_player_is_playing_by_path(path);
+}
+
+#if CONFIG_MUSIC_PLAYER_GAPLESS
+typedef enum {
+    QUEUE_EVENT_PLAYING,
+    QUEUE_EVENT_IDLE,
+} queue_event_t;
+
+static int queue_count = 0;
+static QueueHandle_t queue_events = NULL;
+static SemaphoreHandle_t queue_lock = NULL;     /* Guards everything below */
+static TaskHandle_t queue_task_handle = NULL;
+static bool queue_started = false;
+static int queue_current = -1;                  /* Track loaded in the player */
+static bool queue_play_pending = false;         /* Play requested, waiting for the PLAYING event */
+static TickType_t queue_play_tick = 0;
+static int queue_fail_num = 0;
+static FILE *queue_next_fp = NULL;              /* Next track, opened ahead */
+static int queue_next_index = -1;
+static atomic_int queue_advanced = -1;
+
+static void queue_drop_next(void)
+{
+    if (queue_next_fp) {
+        fclose(queue_next_fp);
+    }
+    queue_next_fp = NULL;
+    queue_next_index = -1;
+}
+
+/* The file source starts reading the track ahead as soon as it is opened */
+static FILE *queue_open(int index)
+{
+    char path[QUEUE_PATH_MAX];
+    FILE *fp = NULL;
+
+    if (dir_index_get_path(queue_tracks, index, path, sizeof(path)) != ESP_OK) {
+        return NULL;
+    }
+    fp = music_source_open(path);
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "Open %s failed", path);
+    }
+
+    return fp;
+}
+
+static esp_err_t queue_play_locked(int index)
+{
+    FILE *fp = NULL;
+
+    if ((queue_next_fp != NULL) && (queue_next_index == index)) {
+        fp = queue_next_fp;
+        queue_next_fp = NULL;
+        queue_next_index = -1;
+    } else {
+        queue_drop_next();
+        fp = queue_open(index);
+        ESP_RETURN_ON_FALSE(fp, ESP_FAIL, TAG, "Open track %d failed", index);
+    }
+
+    queue_current = index;
+    queue_play_pending = true;
+    queue_play_tick = xTaskGetTickCount();
+
+    esp_err_t ret = audio_player_play(fp);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Play track %d failed", index);
+        fclose(fp);
+        queue_current = -1;
+        queue_play_pending = false;
+    }
+
+    return ret;
+}
+
+static void queue_preopen_locked(void)
+{
+    int next = (queue_current + 1) % queue_count;
+
+    if ((queue_current < 0) || ((queue_next_fp != NULL) && (queue_next_index == next))) {
+        return;
+    }
+    queue_drop_next();
+    queue_next_fp = queue_open(next);
+    queue_next_index = (queue_next_fp != NULL) ? next : -1;
+}
+
+static void queue_advance_locked(void)
+{
+    if ((xTaskGetTickCount() - queue_play_tick) < pdMS_TO_TICKS(QUEUE_FAIL_PLAY_MS)) {
+        if (++queue_fail_num >= queue_count) {
+            ESP_LOGW(TAG, "No track can be played, stop");
+            queue_fail_num = 0;
+            queue_current = -1;
+            return;
+        }
+    } else {
+        queue_fail_num = 0;
+    }
+
+    int next = (queue_current + 1) % queue_count;
+    if (queue_play_locked(next) == ESP_OK) {
+        atomic_store(&queue_advanced, next);
+    }
+}
+
+static void queue_task(void *arg)
+{
+    queue_event_t event;
+
+    while (1) {
+        xQueueReceive(queue_events, &event, portMAX_DELAY);
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        switch (event) {
+        case QUEUE_EVENT_PLAYING:
+            queue_play_pending = false;
+            if (queue_started) {
+                queue_preopen_locked();
+            }
+            break;
+        case QUEUE_EVENT_IDLE:
+            // Also sent when the player is stopped, it only counts as the end of the track if nothing else is queued
+            if (queue_started && !queue_play_pending && (queue_current >= 0) &&
+                    (audio_player_get_state() == AUDIO_PLAYER_STATE_IDLE)) {
+                queue_advance_locked();
+            }
+            break;
+        default:
+            break;
+        }
+        xSemaphoreGive(queue_lock);
+    }
+}
+
+/* Only called from the player task */
+static void queue_update_pm(audio_player_callback_event_t audio_event)
+{
+    static bool pm_held = false;
+    bool playing = (audio_event == AUDIO_PLAYER_CALLBACK_EVENT_PLAYING);
+
+    if (playing == pm_held) {
+        return;
+    }
+    /* Other events (next track, unknown file) don't change what the I2S output does */
+    if (playing) {
+        pm_policy_acquire(PM_POLICY_CLIENT_AUDIO);
+    } else if ((audio_event == AUDIO_PLAYER_CALLBACK_EVENT_IDLE) || (audio_event == AUDIO_PLAYER_CALLBACK_EVENT_PAUSE) ||
+               (audio_event == AUDIO_PLAYER_CALLBACK_EVENT_SHUTDOWN)) {
+        pm_policy_release(PM_POLICY_CLIENT_AUDIO);
+    } else {
+        return;
+    }
+    pm_held = playing;
+}
+
+static void queue_player_cb(audio_player_cb_ctx_t *ctx)
+{
+    queue_event_t event;
+
+    queue_update_pm(ctx->audio_event);
+    switch (ctx->audio_event) {
+    case AUDIO_PLAYER_CALLBACK_EVENT_PLAYING:
+        event = QUEUE_EVENT_PLAYING;
+        break;
+    case AUDIO_PLAYER_CALLBACK_EVENT_IDLE:
+        event = QUEUE_EVENT_IDLE;
+        break;
+    default:
+        return;
+    }
+    // Handled in the queue task, the player can't be driven from its own callback
+    if (xQueueSend(queue_events, &event, 0) != pdPASS) {
+        ESP_LOGW(TAG, "Player event %d dropped", event);
+    }
+}
+
+esp_err_t music_queue_init(dir_index_handle_t tracks)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(tracks, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(queue_task_handle == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    queue_tracks = tracks;
+    queue_count = dir_index_get_count(tracks);
+
+    queue_events = xQueueCreate(QUEUE_EVENT_NUM, sizeof(queue_event_t));
+    queue_lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(queue_events && queue_lock, ESP_ERR_NO_MEM, err, TAG, "Create queue failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_MUSIC_QUEUE, queue_task, NULL, &queue_task_handle) == pdPASS, ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+
+    return ESP_OK;
+
+err:
+    if (queue_lock) {
+        vSemaphoreDelete(queue_lock);
+        queue_lock = NULL;
+    }
+    if (queue_events) {
+        vQueueDelete(queue_events);
+        queue_events = NULL;
+    }
+    queue_task_handle = NULL;
+
+    return ret;
+}
+
+void music_queue_start(void)
+{
+    if (queue_task_handle == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    queue_started = true;
+    queue_fail_num = 0;
+    xSemaphoreGive(queue_lock);
+    // Other apps register their own callback while they use the player
+    bsp_extra_player_register_callback(queue_player_cb, NULL);
+}
+
+void music_queue_stop(void)
+{
+    if (queue_task_handle == NULL) {
+        return;
+    }
+
+    bsp_extra_player_register_callback(NULL, NULL);
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    queue_started = false;
+    queue_drop_next();
+    xSemaphoreGive(queue_lock);
+}
+
+esp_err_t music_queue_play(int index)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (queue_task_handle == NULL) {
+        return queue_play_file(index);
+    }
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    ret = queue_play_locked(index);
+    xSemaphoreGive(queue_lock);
+
+    return ret;
+}
+
+bool music_queue_is_current(int index)
+{
+    bool is_current = false;
+
+    if (queue_task_handle == NULL) {
+        return queue_is_playing_file(index);
+    }
+
+    xSemaphoreTake(queue_lock, portMAX_DELAY);
+    is_current = (queue_current == index) && (audio_player_get_state() != AUDIO_PLAYER_STATE_IDLE);
+    xSemaphoreGive(queue_lock);
+
+    return is_current;
+}
+
+bool music_queue_take_advance(int *index)
+{
+    int advanced = atomic_exchange(&queue_advanced, -1);
+
+    if ((index == NULL) || (advanced < 0)) {
+        return false;
+    }
+    *index = advanced;
+
+    return true;
+}
+
+#else
+
+esp_err_t music_queue_init(dir_index_handle_t tracks)
+{
+    ESP_RETURN_ON_FALSE(tracks, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    queue_tracks = tracks;
+
+    return ESP_OK;
+}
+
+void music_queue_start(void)
+{
+}
+
+void music_queue_stop(void)
+{
+}
+
+esp_err_t music_queue_play(int index)
+{
+    return queue_play_file(index);
+}
+
+bool music_queue_is_current(int index)
+{
+    return queue_is_playing_file(index);
+}
+
+bool music_queue_take_advance(int *index)
+{
+    return false;
+}
+
+#endif /* CONFIG_MUSIC_PLAYER_GAPLESS */
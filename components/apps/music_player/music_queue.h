@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "dir_index/dir_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the play queue, call it once after `bsp_extra_player_init`.
+ *
+ * With `CONFIG_MUSIC_PLAYER_GAPLESS`, the queue keeps the next file of the listing open with its beginning read
+ * ahead by `music_source_open`, and starts it as soon as the player reaches the end of the current one.
+ *
+ * @param tracks Tracks to play, in listing order.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t music_queue_init(dir_index_handle_t tracks);
+
+/**
+ * @brief Follow the player events, call it when the music app is opened.
+ */
+void music_queue_start(void);
+
+/**
+ * @brief Stop following the player events and close the file opened ahead, call it when the music app is closed.
+ */
+void music_queue_stop(void);
+
+/**
+ * @brief Play a track from its beginning.
+ *
+ * @param index File index of the track.
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t music_queue_play(int index);
+
+/**
+ * @brief Check if a track is the one loaded in the player, playing or paused.
+ *
+ * @param index File index of the track.
+ */
+bool music_queue_is_current(int index);
+
+/**
+ * @brief Get the track the queue moved to by itself at the end of the previous one, once per change.
+ *
+ * @param index Filled with the file index of the new track.
+ *
+ * @return true if the track changed since the last call.
+ */
+bool music_queue_take_advance(int *index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,365 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define _GNU_SOURCE     /* fopencookie */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "sd_io/sd_io.h"
+#include "task_config/task_config.h"
+#include "music_source.h"
+
+#define SOURCE_BLOCK_SIZE           (16 * 1024)
+#define SOURCE_NUM_MAX              (4)     /* Playing, waiting to be closed by the player, and opened ahead */
+#define SOURCE_WAIT_MS              (1000)  /* A read gives up after this long without data */
+
+static const char *TAG = "music_source";
+
+static music_source_stats_t source_stats;
+
+#if CONFIG_MUSIC_PLAYER_READ_AHEAD
+#define SOURCE_RING_SIZE            ((CONFIG_MUSIC_PLAYER_READ_AHEAD_KB * 1024) / SOURCE_BLOCK_SIZE * SOURCE_BLOCK_SIZE)
+
+/**
+ * The ring holds the bytes [base, end) of the file at their offset modulo the ring size. `end` only moves by whole
+ * blocks from a block aligned offset, so a block never wraps and card reads stay aligned. One block before the read
+ * position is kept for the short backward seeks of the decoder.
+ */
+typedef struct {
+    bool used;
+    bool closed;                /* Closed by the player, freed by the I/O task */
+    bool eof;
+    bool error;
+    bool started;               /* First block read, waits before that are not underruns */
+    int fd;                     /* Only used by the I/O task */
+    long size;
+    uint8_t *ring;
+    long base;
+    long end;
+    long pos;                   /* Read position of the player */
+    uint32_t gen;               /* Changed by a seek outside the ring, drops the block being read */
+    uint32_t underrun_num;
+    SemaphoreHandle_t data_sem; /* Given by the I/O task after each block */
+} source_t;
+
+static source_t source_slots[SOURCE_NUM_MAX];
+static SemaphoreHandle_t source_lock = NULL;    /* Guards the slots */
+static TaskHandle_t source_task_handle = NULL;
+
+static void source_free_locked(source_t *src)
+{
+    if (src->fd >= 0) {
+        close(src->fd);
+    }
+    heap_caps_free(src->ring);
+    vSemaphoreDelete(src->data_sem);
+    memset(src, 0, sizeof(*src));
+}
+
+/* Picks the open file whose ring has the least data ahead of the player */
+static source_t *source_pick_locked(void)
+{
+    source_t *pick = NULL;
+
+    for (int i = 0; i < SOURCE_NUM_MAX; i++) {
+        source_t *src = &source_slots[i];
+        if (!src->used) {
+            continue;
+        }
+        if (src->closed) {
+            source_free_locked(src);
+            continue;
+        }
+        if (src->eof || src->error || (src->end + SOURCE_BLOCK_SIZE - src->base > SOURCE_RING_SIZE)) {
+            continue;
+        }
+        if ((pick == NULL) || ((src->end - src->pos) < (pick->end - pick->pos))) {
+            pick = src;
+        }
+    }
+
+    return pick;
+}
+
+static void source_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(source_lock, portMAX_DELAY);
+        source_t *src = source_pick_locked();
+        if (src == NULL) {
+            xSemaphoreGive(source_lock);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        long offset = src->end;
+        uint32_t gen = src->gen;
+        uint8_t *dst = src->ring + (offset % SOURCE_RING_SIZE);
+        xSemaphoreGive(source_lock);
+
+        // The block is past the data the player can read, and the slot is only freed by this task
+        ssize_t n = sd_io_read_at(src->fd, offset, dst, SOURCE_BLOCK_SIZE);
+        size_t len = (n > 0) ? n : 0;
+
+        xSemaphoreTake(source_lock, portMAX_DELAY);
+        if (gen == src->gen) {
+            src->end += len;
+            src->started = true;
+            if (len < SOURCE_BLOCK_SIZE) {
+                src->eof = (src->end >= src->size);
+                src->error = !src->eof;
+                if (src->error) {
+                    ESP_LOGE(TAG, "Read at %ld failed", offset);
+                }
+            }
+            source_stats.read_bytes += len;
+        }
+        xSemaphoreGive(source_lock);
+        xSemaphoreGive(src->data_sem);
+    }
+}
+
+static ssize_t source_read(void *cookie, char *buf, size_t size)
+{
+    source_t *src = (source_t *)cookie;
+    size_t done = 0;
+    bool underrun = false;
+    TickType_t wait_start = 0;
+
+    xSemaphoreTake(source_lock, portMAX_DELAY);
+    while ((done < size) && (src->pos < src->size)) {
+        if (src->pos >= src->end) {
+            if (src->error) {
+                break;
+            }
+            // Underrun, wait for the I/O task. The first block of a file is not counted, it is read ahead when the
+            // file is opened ahead.
+            if (!underrun && src->started) {
+                underrun = true;
+                wait_start = xTaskGetTickCount();
+            }
+            xSemaphoreGive(source_lock);
+            xTaskNotifyGive(source_task_handle);
+            bool got = (xSemaphoreTake(src->data_sem, pdMS_TO_TICKS(SOURCE_WAIT_MS)) == pdTRUE);
+            xSemaphoreTake(source_lock, portMAX_DELAY);
+            if (!got) {
+                ESP_LOGW(TAG, "No data for %d ms at %ld", SOURCE_WAIT_MS, src->pos);
+                break;
+            }
+            continue;
+        }
+
+        long index = src->pos % SOURCE_RING_SIZE;
+        size_t len = src->end - src->pos;
+        if (len > SOURCE_RING_SIZE - index) {
+            len = SOURCE_RING_SIZE - index;
+        }
+        if (len > size - done) {
+            len = size - done;
+        }
+        memcpy(buf + done, src->ring + index, len);
+        done += len;
+        src->pos += len;
+        if (src->pos - src->base > SOURCE_BLOCK_SIZE) {
+            src->base = src->pos - SOURCE_BLOCK_SIZE;
+        }
+    }
+    if (underrun) {
+        uint32_t wait_ms = pdTICKS_TO_MS(xTaskGetTickCount() - wait_start);
+        src->underrun_num++;
+        source_stats.underrun_num++;
+        source_stats.underrun_ms += wait_ms;
+        if (wait_ms > source_stats.underrun_max_ms) {
+            source_stats.underrun_max_ms = wait_ms;
+        }
+    }
+    xSemaphoreGive(source_lock);
+
+    // Room for the next block
+    xTaskNotifyGive(source_task_handle);
+
+    return ((done == 0) && src->error) ? -1 : done;
+}
+
+static int source_seek(void *cookie, off_t *offset, int whence)
+{
+    source_t *src = (source_t *)cookie;
+    long target = 0;
+
+    xSemaphoreTake(source_lock, portMAX_DELAY);
+    switch (whence) {
+    case SEEK_SET:
+        target = *offset;
+        break;
+    case SEEK_CUR:
+        target = src->pos + *offset;
+        break;
+    case SEEK_END:
+        target = src->size + *offset;
+        break;
+    default:
+        target = -1;
+        break;
+    }
+    if ((target < 0) || (target > src->size)) {
+        xSemaphoreGive(source_lock);
+        return -1;
+    }
+
+    if ((target < src->base) || (target > src->end)) {
+        // Outside the ring, start again from the block holding the target
+        src->gen++;
+        src->base = target / SOURCE_BLOCK_SIZE * SOURCE_BLOCK_SIZE;
+        src->end = src->base;
+        src->eof = false;
+        src->error = false;
+        src->started = false;
+    }
+    src->pos = target;
+    if (src->pos - src->base > SOURCE_BLOCK_SIZE) {
+        src->base = src->pos - SOURCE_BLOCK_SIZE;
+    }
+    *offset = target;
+    xSemaphoreGive(source_lock);
+    xTaskNotifyGive(source_task_handle);
+
+    return 0;
+}
+
+static int source_close(void *cookie)
+{
+    source_t *src = (source_t *)cookie;
+
+    xSemaphoreTake(source_lock, portMAX_DELAY);
+    if (src->underrun_num > 0) {
+        ESP_LOGW(TAG, "Closed with %d underruns, %d in total", (int)src->underrun_num, (int)source_stats.underrun_num);
+    }
+    src->closed = true;
+    xSemaphoreGive(source_lock);
+    xTaskNotifyGive(source_task_handle);
+
+    return 0;
+}
+
+static esp_err_t source_init(void)
+{
+    if (source_task_handle) {
+        return ESP_OK;
+    }
+
+    source_lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(source_lock, ESP_ERR_NO_MEM, TAG, "Create lock failed");
+    if (task_config_create(TASK_CONFIG_MUSIC_SOURCE, source_task, NULL, &source_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Create task failed");
+        vSemaphoreDelete(source_lock);
+        source_lock = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+FILE *music_source_open(const char *path)
+{
+    esp_err_t ret = ESP_OK;
+    source_t *src = NULL;
+    int fd = -1;
+    FILE *cookie_fp = NULL;
+    uint8_t *ring = NULL;
+    SemaphoreHandle_t data_sem = NULL;
+    struct stat st;
+    const cookie_io_functions_t funcs = {
+        .read = source_read,
+        .write = NULL,
+        .seek = source_seek,
+        .close = source_close,
+    };
+
+    ESP_RETURN_ON_FALSE(path, NULL, TAG, "Invalid argument");
+
+    fd = sd_io_open(path);
+    ESP_RETURN_ON_FALSE(fd >= 0, NULL, TAG, "Open %s failed", path);
+    // Calls from the player task only, the I/O task is created once
+    ESP_GOTO_ON_FALSE((source_init() == ESP_OK) && (fstat(fd, &st) == 0), ESP_FAIL, plain, TAG, "Init failed");
+
+    // The card driver transfers aligned blocks straight into the ring
+    ring = sd_io_buf_alloc(SOURCE_RING_SIZE, false);
+    data_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(ring && data_sem, ESP_ERR_NO_MEM, plain, TAG, "Alloc ring failed");
+
+    xSemaphoreTake(source_lock, portMAX_DELAY);
+    for (int i = 0; i < SOURCE_NUM_MAX; i++) {
+        if (!source_slots[i].used) {
+            src = &source_slots[i];
+            break;
+        }
+    }
+    if (src != NULL) {
+        memset(src, 0, sizeof(*src));
+        src->used = true;
+        src->fd = fd;
+        src->size = st.st_size;
+        src->ring = ring;
+        src->data_sem = data_sem;
+        cookie_fp = fopencookie(src, "rb", funcs);
+        if (cookie_fp == NULL) {
+            memset(src, 0, sizeof(*src));
+        }
+    }
+    xSemaphoreGive(source_lock);
+    ESP_GOTO_ON_FALSE(cookie_fp, ESP_ERR_NO_MEM, plain, TAG, "No free source");
+    xTaskNotifyGive(source_task_handle);
+
+    return cookie_fp;
+
+plain:
+    ESP_LOGW(TAG, "Play %s without read-ahead (%s)", path, esp_err_to_name(ret));
+    if (data_sem) {
+        vSemaphoreDelete(data_sem);
+    }
+    heap_caps_free(ring);
+    close(fd);
+
+    return fopen(path, "rb");
+}
+
+void music_source_get_stats(music_source_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    if (source_lock) {
+        xSemaphoreTake(source_lock, portMAX_DELAY);
+    }
+    *stats = source_stats;
+    if (source_lock) {
+        xSemaphoreGive(source_lock);
+    }
+}
+
+#else
+
+FILE *music_source_open(const char *path)
+{
+    ESP_RETURN_ON_FALSE(path, NULL, TAG, "Invalid argument");
+
+    return fopen(path, "rb");
+}
+
+void music_source_get_stats(music_source_stats_t *stats)
+{
+    if (stats) {
+        *stats = source_stats;
+    }
+}
+
+#endif /* CONFIG_MUSIC_PLAYER_READ_AHEAD */
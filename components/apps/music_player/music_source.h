@@ -0,0 +1,51 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Read statistics of all the files opened with `music_source_open`
+ */
+typedef struct {
+    uint32_t underrun_num;      /*!< Reads that had to wait for the SD card */
+    uint32_t underrun_ms;       /*!< Total time spent waiting */
+    uint32_t underrun_max_ms;   /*!< Longest wait */
+    uint64_t read_bytes;        /*!< Bytes read from the SD card */
+} music_source_stats_t;
+
+/**
+ * @brief Open a music file for the audio player.
+ *
+ * With `CONFIG_MUSIC_PLAYER_READ_AHEAD`, the file is read by a low priority I/O task into a ring of
+ * `CONFIG_MUSIC_PLAYER_READ_AHEAD_KB` in PSRAM, in aligned 16 KB blocks straight from the card, and the player reads
+ * from the ring. Reads that have to wait for the card are counted as underruns. The ring starts filling as soon as
+ * the file is opened, so a file opened ahead is ready to play. Without it, or if the ring can't be allocated, the
+ * file is opened with `fopen`.
+ *
+ * @param path Path of the file.
+ *
+ * @return The file, to be closed with `fclose` (the audio player does it), or NULL on failure.
+ */
+FILE *music_source_open(const char *path);
+
+/**
+ * @brief Get the read statistics since boot.
+ *
+ * @param stats Filled with the statistics.
+ */
+void music_source_get_stats(music_source_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
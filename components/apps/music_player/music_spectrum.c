@@ -0,0 +1,332 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_codec_dev.h"
+#include "esp_dsp.h"
+#include "task_config/task_config.h"
+#include "ui_sound/ui_sound.h"
+#include "music_eq.h"
+#include "music_spectrum.h"
+
+#define SPECTRUM_FFT_SIZE           (2048)
+#define SPECTRUM_RING_SIZE          (2 * SPECTRUM_FFT_SIZE)     /* Power of 2 */
+#define SPECTRUM_PERIOD_MS          (33)                        /* Rate of the spectrum tables of the music demo */
+#define SPECTRUM_CODEC_NUM          (4)
+#define SPECTRUM_VALUE_MAX          (100)
+
+typedef struct {
+    esp_codec_dev_handle_t codec;
+    uint8_t bits_per_sample;
+    uint8_t channel;
+    uint32_t sample_rate;
+} spectrum_codec_fs_t;
+
+static const char *TAG = "music_spectrum";
+
+#if CONFIG_MUSIC_PLAYER_SPECTRUM_FFT || CONFIG_MUSIC_PLAYER_EQ || CONFIG_UI_SOUND
+static spectrum_codec_fs_t spectrum_codec_fs[SPECTRUM_CODEC_NUM];
+
+int __real_esp_codec_dev_open(esp_codec_dev_handle_t codec, esp_codec_dev_sample_info_t *fs);
+int __real_esp_codec_dev_write(esp_codec_dev_handle_t codec, void *data, int len);
+#endif
+
+#if CONFIG_MUSIC_PLAYER_SPECTRUM_FFT
+/* Upper edge of each band in Hz, the same as the bins summed by `assets/spectrum.py` */
+static const uint16_t spectrum_band_edges[MUSIC_SPECTRUM_BAND_NUM + 1] = {0, 60, 340, 2250, 4500};
+
+/* Written by the audio player task through the codec tap, read by the spectrum task */
+static int16_t spectrum_ring[SPECTRUM_RING_SIZE];
+static atomic_uint spectrum_ring_wr = 0;
+static atomic_uint spectrum_sample_rate = 0;
+static atomic_bool spectrum_running = false;
+
+/* Double buffer of the band magnitudes, the spectrum task fills the back one and then publishes it */
+static uint16_t spectrum_bands[2][MUSIC_SPECTRUM_BAND_NUM];
+static atomic_int spectrum_bands_front = 0;
+static atomic_bool spectrum_valid = false;
+
+static int16_t *spectrum_fft_buf = NULL;
+static int16_t *spectrum_window = NULL;
+static bool spectrum_exit = false;
+static TaskHandle_t spectrum_task_handle = NULL;
+static SemaphoreHandle_t spectrum_idle = NULL;  /* Given by the task when it exits */
+
+static void spectrum_tap(const spectrum_codec_fs_t *fs, const void *data, int len)
+{
+    if ((fs->channel == 0) || ((fs->bits_per_sample != 16) && (fs->bits_per_sample != 32))) {
+        return;
+    }
+
+    // Down-mix to mono, 32 bit samples keep their high half
+    int sample_size = fs->bits_per_sample / 8;
+    int frame_num = len / (sample_size * fs->channel);
+    int mix_num = (fs->channel > 1) ? 2 : 1;
+    unsigned int wr = atomic_load_explicit(&spectrum_ring_wr, memory_order_relaxed);
+    for (int i = 0; i < frame_num; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < mix_num; c++) {
+            int index = i * fs->channel + c;
+            sum += (sample_size == 2) ? ((const int16_t *)data)[index] : (((const int32_t *)data)[index] >> 16);
+        }
+        spectrum_ring[wr++ & (SPECTRUM_RING_SIZE - 1)] = (int16_t)(sum / mix_num);
+    }
+    atomic_store_explicit(&spectrum_sample_rate, fs->sample_rate, memory_order_relaxed);
+    atomic_store_explicit(&spectrum_ring_wr, wr, memory_order_release);
+    atomic_store_explicit(&spectrum_valid, true, memory_order_relaxed);
+}
+
+static void spectrum_analyze(unsigned int wr, uint32_t sample_rate, uint16_t *bands)
+{
+    // The ring may be written while it is copied, at worst the oldest samples of this window are newer ones
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        int16_t sample = spectrum_ring[(wr - SPECTRUM_FFT_SIZE + i) & (SPECTRUM_RING_SIZE - 1)];
+        spectrum_fft_buf[2 * i] = (int16_t)(((int32_t)sample * spectrum_window[i]) >> 15);
+        spectrum_fft_buf[2 * i + 1] = 0;
+    }
+    dsps_fft2r_sc16(spectrum_fft_buf, SPECTRUM_FFT_SIZE);
+    dsps_bit_rev_sc16_ansi(spectrum_fft_buf, SPECTRUM_FFT_SIZE);
+
+    // The fixed-point FFT halves the data at every stage, a full scale sine gives 8192 in its bin. The tables were
+    // made from 7.5 Hz bins 16 times smaller, hence the scale that keeps the sum of a band for a given spectral
+    // density.
+    float bin_hz = (float)sample_rate / SPECTRUM_FFT_SIZE;
+    for (int b = 0; b < MUSIC_SPECTRUM_BAND_NUM; b++) {
+        int start = (int)ceilf(spectrum_band_edges[b] / bin_hz);
+        int end = (int)ceilf(spectrum_band_edges[b + 1] / bin_hz);
+        start = (start < 1) ? 1 : start;
+        end = (end > SPECTRUM_FFT_SIZE / 2) ? SPECTRUM_FFT_SIZE / 2 : end;
+
+        float sum = 0;
+        for (int k = start; k < end; k++) {
+            int32_t re = spectrum_fft_buf[2 * k];
+            int32_t im = spectrum_fft_buf[2 * k + 1];
+            sum += sqrtf((float)(re * re + im * im));
+        }
+        float value = sum * bin_hz / (16 * 30 * 7.5f);
+        bands[b] = (value > SPECTRUM_VALUE_MAX) ? SPECTRUM_VALUE_MAX : (uint16_t)value;
+    }
+}
+
+static void spectrum_task(void *arg)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    unsigned int last_wr = atomic_load(&spectrum_ring_wr);
+
+    while (!spectrum_exit) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SPECTRUM_PERIOD_MS));
+
+        unsigned int wr = atomic_load_explicit(&spectrum_ring_wr, memory_order_acquire);
+        uint32_t sample_rate = atomic_load_explicit(&spectrum_sample_rate, memory_order_relaxed);
+        uint16_t bands[MUSIC_SPECTRUM_BAND_NUM] = {0};
+        if ((wr != last_wr) && (sample_rate > 0)) {
+            spectrum_analyze(wr, sample_rate, bands);
+        }
+        last_wr = wr;
+
+        // Bars fall back smoothly when the audio stops or gets quieter
+        int front = atomic_load_explicit(&spectrum_bands_front, memory_order_relaxed);
+        uint16_t *back = spectrum_bands[!front];
+        for (int b = 0; b < MUSIC_SPECTRUM_BAND_NUM; b++) {
+            uint16_t fall = spectrum_bands[front][b] - spectrum_bands[front][b] / 4;
+            back[b] = (bands[b] > fall) ? bands[b] : fall;
+        }
+        atomic_store_explicit(&spectrum_bands_front, !front, memory_order_release);
+    }
+
+    xSemaphoreGive(spectrum_idle);
+    task_config_delete(TASK_CONFIG_MUSIC_SPECTRUM, NULL);
+}
+
+esp_err_t music_spectrum_start(void)
+{
+    esp_err_t ret = ESP_OK;
+    bool fft_init = false;
+
+    ESP_RETURN_ON_FALSE(spectrum_task_handle == NULL, ESP_OK, TAG, "Already started");
+
+    spectrum_fft_buf = heap_caps_aligned_alloc(16, SPECTRUM_FFT_SIZE * 2 * sizeof(int16_t),
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    spectrum_window = heap_caps_aligned_alloc(16, SPECTRUM_FFT_SIZE * sizeof(int16_t),
+                                              MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    spectrum_idle = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(spectrum_fft_buf && spectrum_window && spectrum_idle, ESP_ERR_NO_MEM, err, TAG, "No memory");
+
+    ret = dsps_fft2r_init_sc16(NULL, SPECTRUM_FFT_SIZE);
+    ESP_GOTO_ON_FALSE((ret == ESP_OK) || (ret == ESP_ERR_DSP_REINITIALIZED), ret, err, TAG, "Init FFT failed");
+    fft_init = true;
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        spectrum_window[i] = (int16_t)(16383.5f * (1 - cosf(2 * M_PI * i / (SPECTRUM_FFT_SIZE - 1))));
+    }
+
+    memset(spectrum_bands, 0, sizeof(spectrum_bands));
+    atomic_store(&spectrum_valid, false);
+    spectrum_exit = false;
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_MUSIC_SPECTRUM, spectrum_task, NULL, &spectrum_task_handle) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+    atomic_store(&spectrum_running, true);
+
+    return ESP_OK;
+
+err:
+    if (fft_init) {
+        dsps_fft2r_deinit_sc16();
+    }
+    if (spectrum_idle) {
+        vSemaphoreDelete(spectrum_idle);
+        spectrum_idle = NULL;
+    }
+    heap_caps_free(spectrum_window);
+    spectrum_window = NULL;
+    heap_caps_free(spectrum_fft_buf);
+    spectrum_fft_buf = NULL;
+    spectrum_task_handle = NULL;
+
+    return ret;
+}
+
+void music_spectrum_stop(void)
+{
+    if (spectrum_task_handle == NULL) {
+        return;
+    }
+
+    atomic_store(&spectrum_running, false);
+    atomic_store(&spectrum_valid, false);
+    spectrum_exit = true;
+    xSemaphoreTake(spectrum_idle, portMAX_DELAY);
+    spectrum_task_handle = NULL;
+
+    dsps_fft2r_deinit_sc16();
+    vSemaphoreDelete(spectrum_idle);
+    spectrum_idle = NULL;
+    heap_caps_free(spectrum_window);
+    spectrum_window = NULL;
+    heap_caps_free(spectrum_fft_buf);
+    spectrum_fft_buf = NULL;
+}
+
+bool music_spectrum_get(uint16_t *bands)
+{
+    if ((bands == NULL) || !atomic_load_explicit(&spectrum_valid, memory_order_relaxed)) {
+        return false;
+    }
+
+    // The task publishes every 33 ms and the copy is short, so the front buffer is not rewritten while it is read
+    int front = atomic_load_explicit(&spectrum_bands_front, memory_order_acquire);
+    memcpy(bands, spectrum_bands[front], sizeof(spectrum_bands[front]));
+
+    return true;
+}
+
+#endif /* CONFIG_MUSIC_PLAYER_SPECTRUM_FFT */
+
+#if CONFIG_MUSIC_PLAYER_SPECTRUM_FFT || CONFIG_MUSIC_PLAYER_EQ || CONFIG_UI_SOUND
+/* The codec calls are wrapped at link time (see CMakeLists.txt), the BSP player writes its PCM data through them */
+int __wrap_esp_codec_dev_open(esp_codec_dev_handle_t codec, esp_codec_dev_sample_info_t *fs)
+{
+    int ret = __real_esp_codec_dev_open(codec, fs);
+
+    if ((ret == ESP_CODEC_DEV_OK) && (fs != NULL)) {
+        spectrum_codec_fs_t *slot = &spectrum_codec_fs[0];
+        for (int i = 0; i < SPECTRUM_CODEC_NUM; i++) {
+            if ((spectrum_codec_fs[i].codec == codec) || (spectrum_codec_fs[i].codec == NULL)) {
+                slot = &spectrum_codec_fs[i];
+                break;
+            }
+        }
+        slot->bits_per_sample = fs->bits_per_sample;
+        slot->channel = fs->channel;
+        slot->sample_rate = fs->sample_rate;
+        slot->codec = codec;
+    }
+
+    return ret;
+}
+
+static const spectrum_codec_fs_t *spectrum_find_fs(esp_codec_dev_handle_t codec)
+{
+    for (int i = 0; i < SPECTRUM_CODEC_NUM; i++) {
+        if (spectrum_codec_fs[i].codec == codec) {
+            return &spectrum_codec_fs[i];
+        }
+    }
+
+    return NULL;
+}
+
+int __wrap_esp_codec_dev_write(esp_codec_dev_handle_t codec, void *data, int len)
+{
+    const spectrum_codec_fs_t *fs = spectrum_find_fs(codec);
+
+    if ((fs == NULL) || (data == NULL) || (len <= 0)) {
+        return __real_esp_codec_dev_write(codec, data, len);
+    }
+
+    // The EQ filters the data block by block and the UI sounds are mixed over it, the spectrum is taken from what
+    // goes to the codec
+    int ret = ESP_CODEC_DEV_OK;
+    uint8_t *in = data;
+    while ((len > 0) && (ret == ESP_CODEC_DEV_OK)) {
+        int block_len = len;
+#if CONFIG_UI_SOUND
+        // An effect started during a write waits at most one short block, not the whole decode buffer
+        int frame_size = (fs->bits_per_sample / 8) * fs->channel;
+        if ((frame_size > 0) && (len > UI_SOUND_BLOCK_FRAMES * frame_size)) {
+            block_len = UI_SOUND_BLOCK_FRAMES * frame_size;
+        }
+#endif
+        const void *out = in;
+        int used = music_eq_process(in, block_len, fs->bits_per_sample, fs->channel, fs->sample_rate, &out);
+        int out_len = used;
+        if (used == 0) {
+            used = block_len;
+            out_len = block_len;
+            out = in;
+        }
+        // `out` is the EQ buffer or the data of the caller, both writable
+        ui_sound_mix((void *)out, out_len, fs->bits_per_sample, fs->channel, fs->sample_rate);
+#if CONFIG_MUSIC_PLAYER_SPECTRUM_FFT
+        if (atomic_load_explicit(&spectrum_running, memory_order_relaxed)) {
+            spectrum_tap(fs, out, out_len);
+        }
+#endif
+        ret = __real_esp_codec_dev_write(codec, (void *)out, out_len);
+        in += used;
+        len -= used;
+    }
+
+    return ret;
+}
+#endif
+
+#if !CONFIG_MUSIC_PLAYER_SPECTRUM_FFT
+
+esp_err_t music_spectrum_start(void)
+{
+    ESP_LOGD(TAG, "Spectrum analysis is disabled");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void music_spectrum_stop(void)
+{
+}
+
+bool music_spectrum_get(uint16_t *bands)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MUSIC_SPECTRUM_BAND_NUM     (4)
+
+/**
+ * @brief Start analyzing the audio written to the codec.
+ *
+ * The PCM data written by the audio player is copied into a ring and a low priority task runs a fixed-point FFT on
+ * the latest samples about 30 times per second. The bands are 0-60 Hz, 60-340 Hz, 340-2250 Hz and 2250-4500 Hz,
+ * scaled like the spectrum tables of the music demo.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if `CONFIG_MUSIC_PLAYER_SPECTRUM_FFT` is disabled, or an error
+ *         code on failure.
+ */
+esp_err_t music_spectrum_start(void);
+
+/**
+ * @brief Stop the analysis and free its buffers, waits for the task to exit.
+ */
+void music_spectrum_stop(void);
+
+/**
+ * @brief Get the latest band magnitudes, does not block and can be called from the LVGL task.
+ *
+ * @param bands Array of `MUSIC_SPECTRUM_BAND_NUM` magnitudes to fill.
+ *
+ * @return true if audio was analyzed recently, false if nothing is playing or the analysis is stopped, `bands` is
+ *         left untouched then.
+ */
+bool music_spectrum_get(uint16_t *bands);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,362 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_app_format.h"
+#include "esp_app_desc.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_http_client.h"
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+#if CONFIG_OTA_UPDATE_DELTA
+#include "esp_delta_ota.h"
+#endif
+#include "sd_io/sd_io.h"
+#include "task_config/task_config.h"
+#include "ota_update.h"
+
+#if CONFIG_OTA_UPDATE
+#define OTA_CHUNK_SIZE              (CONFIG_OTA_UPDATE_CHUNK_KB * 1024)
+#else
+#define OTA_CHUNK_SIZE              (16 * 1024)
+#endif
+#define OTA_SOURCE_LEN_MAX          (256)
+#define OTA_HTTP_TIMEOUT_MS         (10 * 1000)
+/* The app description follows the image header and the header of the first segment */
+#define OTA_APP_DESC_OFFSET         (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t))
+/* Header put before the patch by the esp_delta_ota generator: magic, then the SHA-256 of the base image */
+#define OTA_PATCH_MAGIC             (0xfccdde10)
+#define OTA_PATCH_DIGEST_OFFSET     (4)
+#define OTA_PATCH_HEADER_SIZE       (64)
+#define OTA_SHA256_SIZE             (32)
+
+typedef struct {
+    esp_http_client_handle_t client;
+    int fd;
+} ota_source_t;
+
+static const char *TAG = "ota_update";
+
+static portMUX_TYPE ota_lock = portMUX_INITIALIZER_UNLOCKED;
+static ota_update_status_t ota_status = {
+    .state = OTA_UPDATE_STATE_IDLE,
+    .total = -1,
+};
+static char ota_source[OTA_SOURCE_LEN_MAX];
+static bool ota_source_is_url = false;
+
+static void status_add(uint32_t received, uint32_t written)
+{
+    portENTER_CRITICAL(&ota_lock);
+    ota_status.received += received;
+    ota_status.written += written;
+    portEXIT_CRITICAL(&ota_lock);
+}
+
+static void status_finish(ota_update_state_t state, esp_err_t error)
+{
+    portENTER_CRITICAL(&ota_lock);
+    ota_status.state = state;
+    ota_status.error = error;
+    portEXIT_CRITICAL(&ota_lock);
+}
+
+static esp_err_t source_open(ota_source_t *src, int32_t *total)
+{
+    if (!ota_source_is_url) {
+        struct stat st;
+
+        src->fd = sd_io_open(ota_source);
+        ESP_RETURN_ON_FALSE(src->fd >= 0, ESP_ERR_NOT_FOUND, TAG, "Open %s failed", ota_source);
+        *total = (fstat(src->fd, &st) == 0) ? (int32_t)st.st_size : -1;
+
+        return ESP_OK;
+    }
+
+    esp_http_client_config_t config = {
+        .url = ota_source,
+        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
+        .keep_alive_enable = true,
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+    };
+    src->client = esp_http_client_init(&config);
+    ESP_RETURN_ON_FALSE(src->client, ESP_ERR_NO_MEM, TAG, "Create HTTP client failed");
+    ESP_RETURN_ON_ERROR(esp_http_client_open(src->client, 0), TAG, "Connect to %s failed", ota_source);
+
+    int64_t length = esp_http_client_fetch_headers(src->client);
+    int status_code = esp_http_client_get_status_code(src->client);
+    ESP_RETURN_ON_FALSE(status_code == HttpStatus_Ok, ESP_ERR_NOT_FOUND, TAG, "HTTP status %d", status_code);
+    *total = (length > 0) ? (int32_t)length : -1;
+
+    return ESP_OK;
+}
+
+static void source_close(ota_source_t *src)
+{
+    if (src->client) {
+        esp_http_client_close(src->client);
+        esp_http_client_cleanup(src->client);
+        src->client = NULL;
+    }
+    if (src->fd >= 0) {
+        close(src->fd);
+        src->fd = -1;
+    }
+}
+
+/* Fills `buf` unless the source ends, so the file reads stay multiples of the SD sector */
+static int source_read(ota_source_t *src, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+
+    while (got < len) {
+        int n = src->client ? esp_http_client_read(src->client, (char *)buf + got, len - got) :
+                sd_io_read(src->fd, buf + got, len - got);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += n;
+    }
+
+    return got;
+}
+
+static esp_err_t image_write(esp_ota_handle_t ota, const uint8_t *buf, size_t len)
+{
+    esp_err_t ret = esp_ota_write(ota, buf, len);
+
+    if (ret == ESP_OK) {
+        status_add(0, len);
+    }
+
+    return ret;
+}
+
+#if CONFIG_OTA_UPDATE_DELTA
+static esp_err_t patch_read_base(uint8_t *buf, size_t size, int src_offset)
+{
+    return esp_partition_read(esp_ota_get_running_partition(), src_offset, buf, size);
+}
+
+static esp_err_t patch_write(const uint8_t *buf, size_t size, void *user_data)
+{
+    return image_write(*(esp_ota_handle_t *)user_data, buf, size);
+}
+#endif
+
+static void ota_task(void *arg)
+{
+    esp_err_t ret = ESP_OK;
+    ota_update_state_t result = OTA_UPDATE_STATE_DONE;
+    ota_source_t src = {
+        .client = NULL,
+        .fd = -1,
+    };
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    const esp_app_desc_t *running_desc = esp_app_get_description();
+    esp_ota_handle_t ota = 0;
+    bool ota_begun = false;
+    bool delta = false;
+#if CONFIG_OTA_UPDATE_DELTA
+    esp_delta_ota_handle_t patch = NULL;
+#endif
+    uint8_t *buf = (uint8_t *)sd_io_buf_alloc(OTA_CHUNK_SIZE, false);
+    int32_t total = -1;
+    uint32_t magic = 0;
+    size_t offset = 0;
+    int len = 0;
+
+    ESP_GOTO_ON_FALSE(buf, ESP_ERR_NO_MEM, end, TAG, "Allocate chunk failed");
+    ESP_GOTO_ON_ERROR(source_open(&src, &total), end, TAG, "Open source failed");
+    portENTER_CRITICAL(&ota_lock);
+    ota_status.total = total;
+    portEXIT_CRITICAL(&ota_lock);
+
+    len = source_read(&src, buf, OTA_CHUNK_SIZE);
+    ESP_GOTO_ON_FALSE(len >= (int)sizeof(magic), ESP_ERR_INVALID_SIZE, end, TAG, "Read %s failed", ota_source);
+    status_add(len, 0);
+    memcpy(&magic, buf, sizeof(magic));
+    if (magic == OTA_PATCH_MAGIC) {
+#if CONFIG_OTA_UPDATE_DELTA
+        uint8_t digest[OTA_SHA256_SIZE];
+
+        ESP_GOTO_ON_FALSE(len >= OTA_PATCH_HEADER_SIZE, ESP_ERR_INVALID_SIZE, end, TAG, "Patch header truncated");
+        ESP_GOTO_ON_ERROR(esp_partition_get_sha256(esp_ota_get_running_partition(), digest), end, TAG,
+                          "Hash running image failed");
+        ESP_GOTO_ON_FALSE(memcmp(digest, buf + OTA_PATCH_DIGEST_OFFSET, sizeof(digest)) == 0, ESP_ERR_INVALID_VERSION,
+                          end, TAG, "The patch is not for the running image %s", running_desc->version);
+        delta = true;
+        offset = OTA_PATCH_HEADER_SIZE;
+        ESP_LOGI(TAG, "Patching %s from %s", running_desc->version, ota_source);
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, end, TAG, "Delta updates are disabled");
+#endif
+    } else {
+        const esp_app_desc_t *desc = (const esp_app_desc_t *)(buf + OTA_APP_DESC_OFFSET);
+
+        ESP_GOTO_ON_FALSE((len >= (int)(OTA_APP_DESC_OFFSET + sizeof(esp_app_desc_t))) &&
+                          (buf[0] == ESP_IMAGE_HEADER_MAGIC) && (desc->magic_word == ESP_APP_DESC_MAGIC_WORD),
+                          ESP_ERR_OTA_VALIDATE_FAILED, end, TAG, "%s is not an app image", ota_source);
+        if (memcmp(desc->app_elf_sha256, running_desc->app_elf_sha256, sizeof(desc->app_elf_sha256)) == 0) {
+            ESP_LOGI(TAG, "%s is the running image", desc->version);
+            result = OTA_UPDATE_STATE_UP_TO_DATE;
+            goto end;
+        }
+        ESP_LOGI(TAG, "Updating %s to %s from %s", running_desc->version, desc->version, ota_source);
+    }
+    portENTER_CRITICAL(&ota_lock);
+    ota_status.delta = delta;
+    portEXIT_CRITICAL(&ota_lock);
+
+    // Sectors are erased as they are reached instead of the whole slot up front
+    ESP_GOTO_ON_ERROR(esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &ota), end, TAG, "Begin %s failed",
+                      update->label);
+    ota_begun = true;
+#if CONFIG_OTA_UPDATE_DELTA
+    if (delta) {
+        esp_delta_ota_cfg_t cfg = {
+            .user_data = &ota,
+            .read_cb = patch_read_base,
+            .write_cb_with_user_data = patch_write,
+        };
+        patch = esp_delta_ota_init(&cfg);
+        ESP_GOTO_ON_FALSE(patch, ESP_ERR_NO_MEM, end, TAG, "Create patch decoder failed");
+    }
+#endif
+
+    while (len > 0) {
+#if CONFIG_OTA_UPDATE_DELTA
+        if (patch) {
+            ret = esp_delta_ota_feed_patch(patch, buf + offset, len - offset);
+        } else
+#endif
+        {
+            ret = image_write(ota, buf + offset, len - offset);
+        }
+        ESP_GOTO_ON_ERROR(ret, end, TAG, "Write %s failed", update->label);
+        offset = 0;
+
+        len = source_read(&src, buf, OTA_CHUNK_SIZE);
+        ESP_GOTO_ON_FALSE(len >= 0, ESP_FAIL, end, TAG, "Read %s failed", ota_source);
+        status_add(len, 0);
+    }
+    ESP_GOTO_ON_FALSE((total < 0) || (ota_status.received == (uint32_t)total), ESP_ERR_INVALID_SIZE, end, TAG,
+                      "Source ended at %u of %d bytes", (unsigned)ota_status.received, (int)total);
+#if CONFIG_OTA_UPDATE_DELTA
+    if (patch) {
+        ESP_GOTO_ON_ERROR(esp_delta_ota_finalize(patch), end, TAG, "Finalize patch failed");
+    }
+#endif
+
+    ota_begun = false;
+    ESP_GOTO_ON_ERROR(esp_ota_end(ota), end, TAG, "Written image is invalid");
+    ESP_GOTO_ON_ERROR(esp_ota_set_boot_partition(update), end, TAG, "Set boot partition failed");
+    ESP_LOGI(TAG, "%u bytes written to %s, the new image boots on the next restart", (unsigned)ota_status.written,
+             update->label);
+
+end:
+#if CONFIG_OTA_UPDATE_DELTA
+    if (patch) {
+        esp_delta_ota_deinit(patch);
+    }
+#endif
+    if (ota_begun) {
+        esp_ota_abort(ota);
+    }
+    source_close(&src);
+    if (buf) {
+        heap_caps_free(buf);
+    }
+    status_finish((ret == ESP_OK) ? result : OTA_UPDATE_STATE_FAILED, ret);
+
+    task_config_delete(TASK_CONFIG_OTA_UPDATE, NULL);
+}
+
+static esp_err_t ota_start(const char *source, bool is_url)
+{
+    bool busy = false;
+
+    ESP_RETURN_ON_FALSE(source && (strlen(source) < sizeof(ota_source)), ESP_ERR_INVALID_ARG, TAG, "Invalid source");
+    ESP_RETURN_ON_FALSE(esp_ota_get_next_update_partition(NULL), ESP_ERR_NOT_FOUND, TAG,
+                        "No OTA slot in the partition table");
+
+    portENTER_CRITICAL(&ota_lock);
+    busy = (ota_status.state == OTA_UPDATE_STATE_RUNNING) || (ota_status.state == OTA_UPDATE_STATE_DONE);
+    if (!busy) {
+        ota_status = (ota_update_status_t) {
+            .state = OTA_UPDATE_STATE_RUNNING,
+            .total = -1,
+        };
+    }
+    portEXIT_CRITICAL(&ota_lock);
+    ESP_RETURN_ON_FALSE(!busy, ESP_ERR_INVALID_STATE, TAG, "An update is running or waits for the restart");
+
+    // Only the task reads the source until it is done, and no other start gets here before that
+    strlcpy(ota_source, source, sizeof(ota_source));
+    ota_source_is_url = is_url;
+    if (task_config_create(TASK_CONFIG_OTA_UPDATE, ota_task, NULL, NULL) != pdPASS) {
+        status_finish(OTA_UPDATE_STATE_FAILED, ESP_ERR_NO_MEM);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ota_update_start_http(const char *url)
+{
+    return ota_start(url, true);
+}
+
+esp_err_t ota_update_start_file(const char *path)
+{
+    struct stat st;
+
+    // No file is the usual case, not an error
+    if ((path == NULL) || (stat(path, &st) != 0)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    return ota_start(path, false);
+}
+
+void ota_update_get_status(ota_update_status_t *status)
+{
+    if (status == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&ota_lock);
+    *status = ota_status;
+    portEXIT_CRITICAL(&ota_lock);
+}
+
+esp_err_t ota_update_confirm(void)
+{
+    esp_ota_img_states_t state = ESP_OTA_IMG_UNDEFINED;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+
+    if ((esp_ota_get_state_partition(running, &state) != ESP_OK) || (state != ESP_OTA_IMG_PENDING_VERIFY)) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "First boot of %s, keep it", esp_app_get_description()->version);
+
+    return esp_ota_mark_app_valid_cancel_rollback();
+}
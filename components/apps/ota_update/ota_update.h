@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief State of the update
+ */
+typedef enum {
+    OTA_UPDATE_STATE_IDLE,          /*!< No update started since boot */
+    OTA_UPDATE_STATE_RUNNING,       /*!< Downloading and writing the other OTA slot */
+    OTA_UPDATE_STATE_UP_TO_DATE,    /*!< The image is the running one, nothing was written */
+    OTA_UPDATE_STATE_DONE,          /*!< The new image boots on the next restart */
+    OTA_UPDATE_STATE_FAILED,        /*!< The update stopped, the running image still boots */
+} ota_update_state_t;
+
+/**
+ * @brief Progress of the update
+ */
+typedef struct {
+    ota_update_state_t state;
+    bool delta;                     /*!< The source is a patch against the running image */
+    uint32_t received;              /*!< Bytes read from the source */
+    int32_t total;                  /*!< Size of the source, -1 if the server didn't send it */
+    uint32_t written;               /*!< Bytes written to the OTA slot */
+    esp_err_t error;                /*!< Error of a failed update */
+} ota_update_status_t;
+
+/**
+ * @brief Start updating from an HTTP or HTTPS URL in the background.
+ *
+ * The image is streamed into the other OTA slot one `CONFIG_OTA_UPDATE_CHUNK_KB` chunk at a time from a low priority
+ * task, so the UI keeps running and the RAM used doesn't depend on the image size. Full images and, with
+ * `CONFIG_OTA_UPDATE_DELTA`, esp_delta_ota patches of the running image are told apart from their header. A full
+ * image whose ELF is the running one is not written.
+ *
+ * @param url URL of the image or of the patch, copied.
+ *
+ * @return ESP_OK if the task was started, ESP_ERR_INVALID_STATE if an update is running or waits for the restart,
+ *         ESP_ERR_NOT_FOUND if there is no OTA slot to write, or ESP_ERR_NO_MEM.
+ */
+esp_err_t ota_update_start_http(const char *url);
+
+/**
+ * @brief Start updating from a file in the background, see `ota_update_start_http`.
+ *
+ * @param path Path of the image or of the patch, usually on the SD card, copied.
+ *
+ * @return ESP_OK if the task was started, ESP_ERR_NOT_FOUND if the file or the OTA slot doesn't exist, or the errors
+ *         of `ota_update_start_http`.
+ */
+esp_err_t ota_update_start_file(const char *path);
+
+/**
+ * @brief Get the progress of the update.
+ *
+ * @param status Filled with the progress.
+ */
+void ota_update_get_status(ota_update_status_t *status);
+
+/**
+ * @brief Keep the running image after an update, call it once the firmware started correctly.
+ *
+ * With `CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE` a new image that restarts before this call is rolled back to the
+ * previous one. Does nothing for an image that was already confirmed.
+ *
+ * @return ESP_OK on success, or the error of `esp_ota_mark_app_valid_cancel_rollback`.
+ */
+esp_err_t ota_update_confirm(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "panel_power.h"
+
+#if CONFIG_PANEL_POWER_SLEEP
+#include "esp_lcd_mipi_dsi.h"
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_commands.h"
+
+static const char *TAG = "panel_power";
+
+static struct {
+    esp_lcd_panel_io_handle_t io;   /* DBI interface of the panel, the first one created */
+    panel_power_state_t state;
+} s_panel;
+
+esp_err_t __real_esp_lcd_new_panel_io_dbi(esp_lcd_dsi_bus_handle_t bus, const esp_lcd_dbi_io_config_t *io_config,
+                                          esp_lcd_panel_io_handle_t *ret_io);
+
+// The BSP keeps the handles of the panel to itself, its DBI interface is caught at link time
+// (`-Wl,--wrap=esp_lcd_new_panel_io_dbi`)
+esp_err_t __wrap_esp_lcd_new_panel_io_dbi(esp_lcd_dsi_bus_handle_t bus, const esp_lcd_dbi_io_config_t *io_config,
+                                          esp_lcd_panel_io_handle_t *ret_io)
+{
+    esp_err_t ret = __real_esp_lcd_new_panel_io_dbi(bus, io_config, ret_io);
+
+    if ((ret == ESP_OK) && (s_panel.io == NULL)) {
+        s_panel.io = *ret_io;
+    }
+
+    return ret;
+}
+
+static esp_err_t panel_send(int cmd)
+{
+    return esp_lcd_panel_io_tx_param(s_panel.io, cmd, NULL, 0);
+}
+#endif
+
+esp_err_t panel_power_set(panel_power_state_t state)
+{
+#if CONFIG_PANEL_POWER_SLEEP
+    ESP_RETURN_ON_FALSE(state <= PANEL_POWER_SLEEP, ESP_ERR_INVALID_ARG, TAG, "Invalid state");
+    ESP_RETURN_ON_FALSE(s_panel.io != NULL, ESP_ERR_INVALID_STATE, TAG, "Panel not created");
+
+    if (state == s_panel.state) {
+        return ESP_OK;
+    }
+
+    // Out of the sleep mode first, the panel takes no other command until it has woken up
+    if (s_panel.state == PANEL_POWER_SLEEP) {
+        ESP_RETURN_ON_ERROR(panel_send(LCD_CMD_SLPOUT), TAG, "Wake up panel failed");
+        vTaskDelay(pdMS_TO_TICKS(PANEL_POWER_WAKE_MS));
+        s_panel.state = PANEL_POWER_OFF;
+    }
+    if ((state == PANEL_POWER_ON) && (s_panel.state != PANEL_POWER_ON)) {
+        ESP_RETURN_ON_ERROR(panel_send(LCD_CMD_DISPON), TAG, "Turn on panel failed");
+    } else if ((state >= PANEL_POWER_OFF) && (s_panel.state == PANEL_POWER_ON)) {
+        ESP_RETURN_ON_ERROR(panel_send(LCD_CMD_DISPOFF), TAG, "Turn off panel failed");
+    }
+    if (state == PANEL_POWER_SLEEP) {
+        ESP_RETURN_ON_ERROR(panel_send(LCD_CMD_SLPIN), TAG, "Put panel to sleep failed");
+    }
+    ESP_LOGI(TAG, "Panel %s", (state == PANEL_POWER_ON) ? "on" : (state == PANEL_POWER_OFF) ? "off" : "asleep");
+    s_panel.state = state;
+
+    return ESP_OK;
+#else
+    (void)state;
+
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+panel_power_state_t panel_power_get(void)
+{
+#if CONFIG_PANEL_POWER_SLEEP
+    return s_panel.state;
+#else
+    return PANEL_POWER_ON;
+#endif
+}
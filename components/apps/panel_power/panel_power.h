@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Power states of the MIPI DSI panel, in the order the screen saver goes through them
+ */
+typedef enum {
+    PANEL_POWER_ON = 0,
+    PANEL_POWER_OFF,                /*!< Output blanked (DISPOFF), back on at once */
+    PANEL_POWER_SLEEP,              /*!< Panel in sleep mode (SLPIN), takes `PANEL_POWER_WAKE_MS` to come back */
+} panel_power_state_t;
+
+/**
+ * @brief Time the panel needs after it leaves the sleep mode, before it can be turned on (MIPI DCS)
+ */
+#define PANEL_POWER_WAKE_MS         (120)
+
+/**
+ * @brief Move the panel to a power state.
+ *
+ * The commands go over the DBI interface the BSP created for the panel, caught when it is created. The DPI video
+ * stream of the DSI host keeps running, the IDF driver has no way to stop it short of deleting the panel, but the
+ * panel no longer drives its pixels and LVGL sends no frames while the display is off.
+ *
+ * Leaving `PANEL_POWER_SLEEP` blocks for `PANEL_POWER_WAKE_MS`. Calls must be serialized by the caller.
+ *
+ * @param state New power state
+ *
+ * @return
+ *      - ESP_OK                 On success, or if the panel is already in the state
+ *      - ESP_ERR_INVALID_ARG    Invalid state
+ *      - ESP_ERR_INVALID_STATE  The panel interface was not created yet
+ *      - ESP_ERR_NOT_SUPPORTED  The panel sleep is disabled
+ *      - Others                 Error of the command transfer
+ */
+esp_err_t panel_power_set(panel_power_state_t state);
+
+/**
+ * @brief Get the power state of the panel set by the last successful `panel_power_set()`
+ */
+panel_power_state_t panel_power_get(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,198 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+"""
+Turn the PC samples of a profiling run into the linker fragment placing the hottest flash functions in IRAM.
+
+The samples are the `PC_PROFILE ` lines pc_profile_dump() prints on the console, the functions are the `.text.*`
+input sections the linker map of the same build placed in flash. See README.md for the whole flow.
+
+usage: gen_iram_lf.py --log <console log> --map build_profile/esp_brookesia_demo.map [--top 64] [--budget-kb 32]
+"""
+import argparse
+import bisect
+import collections
+import json
+import os
+import re
+import sys
+from typing import Dict, List, NamedTuple, Optional, Tuple
+
+LINE_PREFIX = 'PC_PROFILE '
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'profile_iram.lf')
+# Output section of the code run through the flash cache, the rest is in IRAM already
+FLASH_TEXT_SECTION = '.flash.text'
+PLACEMENT_OPTION = 'PC_PROFILE_IRAM_PLACEMENT'
+
+INPUT_SECTION_RE = re.compile(r'^ (\.\S+)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*))?$')
+WRAPPED_RE = re.compile(r'^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*)$')
+OUTPUT_SECTION_RE = re.compile(r'^(\.\S+)')
+ARCHIVE_RE = re.compile(r'([^/\\(]+\.a)\(([^)]+)\)$')
+
+
+class Function(NamedTuple):
+    start: int
+    size: int
+    symbol: Optional[str]   # None for a plain `.text` section, which can't be placed on its own
+    archive: str
+    obj: str
+
+
+def parse_log(path: str) -> Tuple[collections.Counter, Dict]:
+    counts: collections.Counter = collections.Counter()
+    summary: Dict = {}
+
+    with open(path, errors='replace') as f:
+        for line in f:
+            start = line.find(LINE_PREFIX)
+            if start < 0:
+                continue
+            body = line[start + len(LINE_PREFIX):].strip()
+            if body.startswith('{'):
+                summary = json.loads(body)
+                continue
+            fields = body.split()
+            if len(fields) == 2:
+                counts[int(fields[0], 16)] += int(fields[1])
+
+    return counts, summary
+
+
+def parse_map(path: str) -> List[Function]:
+    functions: List[Function] = []
+    output_section = None
+    pending = None
+
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            match = OUTPUT_SECTION_RE.match(line)
+            if match:
+                output_section = match.group(1)
+                pending = None
+                continue
+            if output_section != FLASH_TEXT_SECTION:
+                continue
+
+            fields = None
+            match = INPUT_SECTION_RE.match(line)
+            if match:
+                if match.group(2) is None:
+                    # A long section name, the address, size and file are on the next line
+                    pending = match.group(1)
+                    continue
+                fields = match.groups()
+            elif pending:
+                wrapped = WRAPPED_RE.match(line)
+                if wrapped:
+                    fields = (pending,) + wrapped.groups()
+            pending = None
+            if not fields:
+                continue
+
+            name, start, size, source = fields
+            archive = ARCHIVE_RE.search(source)
+            if not archive or not (name == '.text' or name.startswith('.text.')) or int(size, 16) == 0:
+                continue
+            symbol = name[len('.text.'):] if name.startswith('.text.') else None
+            functions.append(Function(int(start, 16), int(size, 16), symbol, archive.group(1), archive.group(2)))
+
+    functions.sort(key=lambda function: function.start)
+    return functions
+
+
+def attribute(counts: collections.Counter, functions: List[Function]) -> Tuple[collections.Counter, int]:
+    starts = [function.start for function in functions]
+    hits: collections.Counter = collections.Counter()
+    in_flash = 0
+
+    for pc, count in counts.items():
+        i = bisect.bisect_right(starts, pc) - 1
+        if (i >= 0) and (pc < functions[i].start + functions[i].size):
+            hits[functions[i]] += count
+            in_flash += count
+
+    return hits, in_flash
+
+
+def select(hits: collections.Counter, total: int, top: int, budget: int, min_share: float) -> List[Function]:
+    selected: List[Function] = []
+    used = 0
+
+    for function, count in hits.most_common():
+        if len(selected) >= top or count * 100.0 / total < min_share:
+            break
+        if function.symbol is None:
+            print(f'skip {function.archive}({function.obj}): {count} samples in a plain .text section',
+                  file=sys.stderr)
+            continue
+        if used + function.size > budget:
+            continue
+        selected.append(function)
+        used += function.size
+
+    return selected
+
+
+def object_name(obj: str) -> str:
+    # ldgen matches `lv_draw_sw_blend` against `lv_draw_sw_blend.c.obj`
+    return obj.split('.', 1)[0]
+
+
+def write_fragment(path: str, selected: List[Function], hits: collections.Counter, summary: Dict, total: int,
+                   in_flash: int) -> None:
+    archives: Dict[str, List[Function]] = collections.defaultdict(list)
+    for function in selected:
+        archives[function.archive].append(function)
+    placed = sum(hits[function] for function in selected)
+
+    with open(path, 'w') as f:
+        f.write(f'# Generated by gen_iram_lf.py from {total} samples at {summary.get("rate_hz", "?")} Hz, '
+                'do not edit, see README.md.\n')
+        f.write(f'# {len(selected)} functions, {sum(function.size for function in selected)} bytes of IRAM, '
+                f'{placed * 100.0 / total:.1f}% of the samples of the {in_flash * 100.0 / total:.1f}% in flash.\n')
+        for archive in sorted(archives):
+            name = re.sub(r'\W', '_', re.sub(r'^lib|\.a$', '', archive))
+            f.write(f'\n[mapping:pc_profile_{name}]\n')
+            f.write(f'archive: {archive}\n')
+            f.write('entries:\n')
+            f.write(f'    if {PLACEMENT_OPTION} = y:\n')
+            for function in sorted(archives[archive], key=lambda function: (function.obj, function.symbol)):
+                f.write(f'        {object_name(function.obj)}:{function.symbol} (noflash)\n')
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--log', required=True, help='console log holding the output of pc_profile_dump()')
+    parser.add_argument('--map', required=True, help='linker map of the profiled build')
+    parser.add_argument('--out', default=DEFAULT_OUT, help='fragment to write, default %(default)s')
+    parser.add_argument('--top', type=int, default=64, help='most functions to place, default %(default)s')
+    parser.add_argument('--budget-kb', type=int, default=32, help='most IRAM to use, default %(default)s')
+    parser.add_argument('--min-share', type=float, default=0.1,
+                        help='fewest samples of a placed function in percent, default %(default)s')
+    args = parser.parse_args()
+
+    counts, summary = parse_log(args.log)
+    total = sum(counts.values())
+    if total == 0:
+        sys.exit(f'No {LINE_PREFIX.strip()} samples in {args.log}')
+    functions = parse_map(args.map)
+    if not functions:
+        sys.exit(f'No {FLASH_TEXT_SECTION} functions in {args.map}')
+
+    hits, in_flash = attribute(counts, functions)
+    selected = select(hits, total, args.top, args.budget_kb * 1024, args.min_share)
+    if not selected:
+        sys.exit('No flash function above the thresholds, nothing to place')
+    if summary.get('dropped'):
+        print(f'warning: {summary["dropped"]} samples were dropped, raise CONFIG_PC_PROFILE_SAMPLES', file=sys.stderr)
+
+    for function in selected:
+        print(f'{hits[function] * 100.0 / total:6.2f}% {function.size:6d} {function.archive}({function.obj}) '
+              f'{function.symbol}')
+    write_fragment(args.out, selected, hits, summary, total, in_flash)
+    print(f'Wrote {args.out}')
+
+
+if __name__ == '__main__':
+    main()
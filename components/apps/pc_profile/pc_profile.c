@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "driver/gptimer.h"
+#include "pc_profile.h"
+
+#if CONFIG_PC_PROFILE
+#include "riscv/rvruntime-frames.h"
+#if CONFIG_FREERTOS_NUMBER_OF_CORES > 1
+#include "esp_ipc.h"
+#endif
+
+#define PROFILE_TIMER_RESOLUTION_HZ     (1000000)
+#define PROFILE_CORE_NUM                (CONFIG_FREERTOS_NUMBER_OF_CORES)
+
+static const char *TAG = "pc_profile";
+
+typedef struct {
+    gptimer_handle_t timer;
+    uint32_t *samples;
+    uint32_t num;
+    uint32_t dropped;
+    esp_err_t err;
+} profile_core_t;
+
+static profile_core_t s_cores[PROFILE_CORE_NUM];
+static uint32_t *s_samples = NULL;
+static bool s_running = false;
+static bool s_sampled = false;
+
+static bool IRAM_ATTR profile_on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *user_ctx)
+{
+    profile_core_t *core = (profile_core_t *)user_ctx;
+    // The interrupt entry saved the task frame at pxTopOfStack, the first member of the TCB, mepc is the task PC
+    const RvExcFrame *frame = *(const RvExcFrame **)xTaskGetCurrentTaskHandleForCore(esp_cpu_get_core_id());
+
+    if (core->num < CONFIG_PC_PROFILE_SAMPLES) {
+        core->samples[core->num++] = frame->mepc;
+    } else {
+        core->dropped++;
+    }
+
+    return false;
+}
+
+// The interrupt of a timer is allocated on the core registering its callbacks
+static void profile_register_on_core(void *arg)
+{
+    profile_core_t *core = (profile_core_t *)arg;
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = profile_on_alarm,
+    };
+
+    core->err = gptimer_register_event_callbacks(core->timer, &callbacks, core);
+}
+
+static void profile_stop_core(profile_core_t *core)
+{
+    if (!core->timer) {
+        return;
+    }
+
+    gptimer_stop(core->timer);
+    gptimer_disable(core->timer);
+    gptimer_del_timer(core->timer);
+    core->timer = NULL;
+}
+
+static esp_err_t profile_start_core(int core_id)
+{
+    esp_err_t ret = ESP_OK;
+    profile_core_t *core = &s_cores[core_id];
+    gptimer_config_t timer_config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = PROFILE_TIMER_RESOLUTION_HZ,
+    };
+    gptimer_alarm_config_t alarm_config = {
+        .alarm_count = PROFILE_TIMER_RESOLUTION_HZ / CONFIG_PC_PROFILE_RATE_HZ,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+
+    ESP_RETURN_ON_ERROR(gptimer_new_timer(&timer_config, &core->timer), TAG, "Create timer failed");
+#if PROFILE_CORE_NUM > 1
+    ESP_GOTO_ON_ERROR(esp_ipc_call_blocking(core_id, profile_register_on_core, core), err, TAG, "Call core %d failed",
+                      core_id);
+#else
+    profile_register_on_core(core);
+#endif
+    ESP_GOTO_ON_ERROR(core->err, err, TAG, "Register callbacks failed");
+    ESP_GOTO_ON_ERROR(gptimer_set_alarm_action(core->timer, &alarm_config), err, TAG, "Set alarm failed");
+    ESP_GOTO_ON_ERROR(gptimer_enable(core->timer), err, TAG, "Enable timer failed");
+    ESP_GOTO_ON_ERROR(gptimer_start(core->timer), err, TAG, "Start timer failed");
+
+    return ESP_OK;
+
+err:
+    // Stopping a timer that never started only fails harmlessly
+    profile_stop_core(core);
+    return ret;
+}
+
+static int profile_compare_pc(const void *a, const void *b)
+{
+    uint32_t pc_a = *(const uint32_t *)a;
+    uint32_t pc_b = *(const uint32_t *)b;
+
+    return (pc_a > pc_b) - (pc_a < pc_b);
+}
+#endif
+
+esp_err_t pc_profile_start(void)
+{
+#if CONFIG_PC_PROFILE
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(!s_running, ESP_ERR_INVALID_STATE, TAG, "Already sampling");
+    if (!s_samples) {
+        // Kept once allocated, a profiling build runs the profiler again and again
+        s_samples = (uint32_t *)heap_caps_malloc(sizeof(uint32_t) * CONFIG_PC_PROFILE_SAMPLES * PROFILE_CORE_NUM,
+                                                 MALLOC_CAP_SPIRAM);
+        ESP_RETURN_ON_FALSE(s_samples, ESP_ERR_NO_MEM, TAG, "Allocate samples failed");
+    }
+
+    memset(s_cores, 0, sizeof(s_cores));
+    for (int i = 0; i < PROFILE_CORE_NUM; i++) {
+        s_cores[i].samples = s_samples + i * CONFIG_PC_PROFILE_SAMPLES;
+    }
+    s_sampled = false;
+    for (int i = 0; i < PROFILE_CORE_NUM; i++) {
+        ESP_GOTO_ON_ERROR(profile_start_core(i), err, TAG, "Start sampling core %d failed", i);
+    }
+    s_running = true;
+    ESP_LOGI(TAG, "Sampling %d cores at %d Hz", PROFILE_CORE_NUM, CONFIG_PC_PROFILE_RATE_HZ);
+
+    return ESP_OK;
+
+err:
+    for (int i = 0; i < PROFILE_CORE_NUM; i++) {
+        profile_stop_core(&s_cores[i]);
+    }
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t pc_profile_stop(void)
+{
+#if CONFIG_PC_PROFILE
+    uint32_t samples = 0;
+    uint32_t dropped = 0;
+
+    ESP_RETURN_ON_FALSE(s_running, ESP_ERR_INVALID_STATE, TAG, "Not sampling");
+    for (int i = 0; i < PROFILE_CORE_NUM; i++) {
+        profile_stop_core(&s_cores[i]);
+        samples += s_cores[i].num;
+        dropped += s_cores[i].dropped;
+    }
+    s_running = false;
+    s_sampled = true;
+    ESP_LOGI(TAG, "Stopped, %" PRIu32 " samples, %" PRIu32 " dropped", samples, dropped);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t pc_profile_dump(void)
+{
+#if CONFIG_PC_PROFILE
+    uint32_t total = 0;
+    uint32_t dropped = 0;
+
+    ESP_RETURN_ON_FALSE(!s_running && s_sampled, ESP_ERR_INVALID_STATE, TAG, "No samples");
+
+    // Pack the samples of every core behind the ones of the first core, a later dump finds them there
+    for (int i = 0; i < PROFILE_CORE_NUM; i++) {
+        if (s_cores[i].samples != s_samples + total) {
+            memmove(s_samples + total, s_cores[i].samples, s_cores[i].num * sizeof(uint32_t));
+            s_cores[i].samples = s_samples + total;
+        }
+        total += s_cores[i].num;
+        dropped += s_cores[i].dropped;
+    }
+    qsort(s_samples, total, sizeof(uint32_t), profile_compare_pc);
+
+    for (uint32_t i = 0; i < total;) {
+        uint32_t pc = s_samples[i];
+        uint32_t count = 0;
+
+        while ((i < total) && (s_samples[i] == pc)) {
+            count++;
+            i++;
+        }
+        printf(PC_PROFILE_LINE_PREFIX "%08" PRIx32 " %" PRIu32 "\n", pc, count);
+    }
+    printf(PC_PROFILE_LINE_PREFIX "{\"rate_hz\":%d,\"cores\":%d,\"samples\":%" PRIu32 ",\"dropped\":%" PRIu32 "}\n",
+           CONFIG_PC_PROFILE_RATE_HZ, PROFILE_CORE_NUM, total, dropped);
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+bool pc_profile_is_running(void)
+{
+#if CONFIG_PC_PROFILE
+    return s_running;
+#else
+    return false;
+#endif
+}
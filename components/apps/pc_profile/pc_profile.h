@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PC_PROFILE_LINE_PREFIX          "PC_PROFILE "   /*!< Start of the console lines of a dump */
+
+/**
+ * @brief Start sampling the program counter of every core.
+ *
+ * A timer interrupt per core fires `CONFIG_PC_PROFILE_RATE_HZ` times a second and records the PC of the task it
+ * interrupted, read from the frame the interrupt entry saved on the task stack. Samples taken while another interrupt
+ * runs are attributed to the task it interrupted. The samples are kept in PSRAM, up to `CONFIG_PC_PROFILE_SAMPLES`
+ * per core, the later ones are counted as dropped. Starting again discards the previous samples.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Already sampling
+ *      - ESP_ERR_NOT_SUPPORTED  The profiler is disabled
+ *      - ESP_ERR_NO_MEM         Failed to allocate the samples
+ *      - Others                 Errors of the timers
+ */
+esp_err_t pc_profile_start(void);
+
+/**
+ * @brief Stop sampling, the samples are kept until the next start.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Not sampling
+ *      - ESP_ERR_NOT_SUPPORTED  The profiler is disabled
+ */
+esp_err_t pc_profile_stop(void);
+
+/**
+ * @brief Print the samples of the last run on the console, for `gen_iram_lf.py`.
+ *
+ * One `PC_PROFILE_LINE_PREFIX` line per distinct PC as `<pc hex> <count>`, sorted by PC, then a
+ * `PC_PROFILE_LINE_PREFIX` line holding a JSON summary of the sample rate, the samples and the dropped samples. Sorts
+ * the samples in place and blocks while printing.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Still sampling or nothing sampled yet
+ *      - ESP_ERR_NOT_SUPPORTED  The profiler is disabled
+ */
+esp_err_t pc_profile_dump(void);
+
+/**
+ * @brief Check if the program counter is being sampled.
+ */
+bool pc_profile_is_running(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,391 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH && CONFIG_ESP_COREDUMP_DATA_FORMAT_ELF
+#include "esp_core_dump.h"
+#endif
+#include "task_config/task_config.h"
+#include "perf_log.h"
+
+#define LOG_SLOT_SIZE               (64)
+#define LOG_SLOT_MAGIC              (0x474C5050)    /* "PPLG" */
+#define LOG_SLOT_ERASED             (0xFFFFFFFF)
+#define LOG_CAMERA_FPS_STALE_US     (3 * 1000 * 1000)
+
+typedef void (*log_monitor_cb_t)(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px);
+
+/* One record in flash, the CRC covers the record */
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;
+    perf_log_record_t record;
+    uint8_t reserved[LOG_SLOT_SIZE - 8 - sizeof(perf_log_record_t)];
+} log_slot_t;
+
+_Static_assert(sizeof(log_slot_t) == LOG_SLOT_SIZE, "Record doesn't fit its slot");
+
+static const char *TAG = "perf_log";
+
+static struct {
+    const esp_partition_t *partition;
+    SemaphoreHandle_t lock;         /* Guards the flash and the fields below */
+    uint32_t slot_num;
+    uint32_t slots_per_sector;
+    uint32_t write_slot;            /* Next slot written */
+    uint32_t next_seq;
+    uint16_t boot;
+    TaskHandle_t task;
+    log_monitor_cb_t monitor_cb;
+} s_log;
+
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct {
+    uint32_t frame_num;
+    uint32_t frame_sum_ms;
+    uint32_t frame_max_ms;
+    uint32_t camera_fps_x10;
+    int64_t camera_fps_time_us;
+} s_stats;                          /* Guarded by `s_stats_lock` */
+
+static bool log_slot_valid(const log_slot_t *slot)
+{
+    return (slot->magic == LOG_SLOT_MAGIC) &&
+           (slot->crc == esp_rom_crc32_le(0, (const uint8_t *)&slot->record, sizeof(slot->record)));
+}
+
+static esp_err_t log_read_slot(uint32_t index, log_slot_t *slot)
+{
+    return esp_partition_read(s_log.partition, (size_t)index * LOG_SLOT_SIZE, slot, sizeof(*slot));
+}
+
+/* Finds the slot after the newest valid record, called once at init */
+static esp_err_t log_scan(void)
+{
+    log_slot_t slot;
+    uint32_t sector_num = s_log.slot_num / s_log.slots_per_sector;
+    int32_t newest_sector = -1;
+    uint32_t newest_seq = 0;
+
+    /* Sectors are always written from their first slot, the newest one has the highest first record */
+    for (uint32_t sector = 0; sector < sector_num; sector++) {
+        ESP_RETURN_ON_ERROR(log_read_slot(sector * s_log.slots_per_sector, &slot), TAG, "Read failed");
+        if (log_slot_valid(&slot) && ((newest_sector < 0) || (slot.record.seq > newest_seq))) {
+            newest_sector = sector;
+            newest_seq = slot.record.seq;
+        }
+    }
+    if (newest_sector < 0) {
+        s_log.write_slot = 0;
+        s_log.next_seq = 0;
+        s_log.boot = 1;
+        return ESP_OK;
+    }
+
+    uint32_t first = newest_sector * s_log.slots_per_sector;
+    uint32_t index = first;
+    s_log.next_seq = newest_seq + 1;
+    s_log.boot = 1;
+    for (; index < first + s_log.slots_per_sector; index++) {
+        ESP_RETURN_ON_ERROR(log_read_slot(index, &slot), TAG, "Read failed");
+        if (slot.magic == LOG_SLOT_ERASED) {
+            break;
+        }
+        /* A record cut by a reset keeps its slot, the next record goes after it */
+        if (log_slot_valid(&slot)) {
+            s_log.next_seq = slot.record.seq + 1;
+            s_log.boot = slot.record.boot + 1;
+        }
+    }
+    s_log.write_slot = index % s_log.slot_num;
+
+    return ESP_OK;
+}
+
+/* Called with the lock held */
+static esp_err_t log_append(perf_log_record_t *record)
+{
+    log_slot_t slot;
+
+    /* Entering a sector drops its old records, the only erase of the ring */
+    if ((s_log.write_slot % s_log.slots_per_sector) == 0) {
+        ESP_RETURN_ON_ERROR(esp_partition_erase_range(s_log.partition, (size_t)s_log.write_slot * LOG_SLOT_SIZE,
+                                                      s_log.partition->erase_size), TAG, "Erase failed");
+    }
+
+    record->seq = s_log.next_seq;
+    record->boot = s_log.boot;
+    record->uptime_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    memset(&slot, 0xFF, sizeof(slot));
+    slot.magic = LOG_SLOT_MAGIC;
+    slot.record = *record;
+    slot.crc = esp_rom_crc32_le(0, (const uint8_t *)&slot.record, sizeof(slot.record));
+    esp_err_t ret = esp_partition_write(s_log.partition, (size_t)s_log.write_slot * LOG_SLOT_SIZE, &slot,
+                                        sizeof(slot));
+    /* A failed write leaves the slot used, the next record skips it as well */
+    s_log.write_slot = (s_log.write_slot + 1) % s_log.slot_num;
+    s_log.next_seq++;
+    ESP_RETURN_ON_ERROR(ret, TAG, "Write failed");
+
+    return ESP_OK;
+}
+
+static void log_write(perf_log_record_t *record)
+{
+    xSemaphoreTake(s_log.lock, portMAX_DELAY);
+    esp_err_t ret = log_append(record);
+    xSemaphoreGive(s_log.lock);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Record %d lost: %s", record->type, esp_err_to_name(ret));
+    }
+}
+
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH && CONFIG_ESP_COREDUMP_DATA_FORMAT_ELF
+/* The core dump is only read here, it is erased once recorded */
+static void log_record_panic(void)
+{
+    if (esp_core_dump_image_check() != ESP_OK) {
+        return;
+    }
+
+    esp_core_dump_summary_t *summary = calloc(1, sizeof(esp_core_dump_summary_t));
+    if (summary == NULL) {
+        ESP_LOGW(TAG, "No memory for the core dump summary");
+        return;
+    }
+    if (esp_core_dump_get_summary(summary) == ESP_OK) {
+        perf_log_record_t record = {
+            .type = PERF_LOG_RECORD_PANIC,
+        };
+        strlcpy(record.panic.task, summary->exc_task, sizeof(record.panic.task));
+        record.panic.pc = summary->exc_pc;
+#if CONFIG_IDF_TARGET_ARCH_RISCV
+        record.panic.ra = summary->ex_info.ra;
+        record.panic.sp = summary->ex_info.sp;
+        record.panic.cause = summary->ex_info.mcause;
+#endif
+        log_write(&record);
+        ESP_LOGW(TAG, "Panic in %s at 0x%08" PRIx32 " recorded", record.panic.task, record.panic.pc);
+    }
+    free(summary);
+    esp_core_dump_image_erase();
+}
+#endif
+
+static void log_on_monitor(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px)
+{
+    if (px > 0) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.frame_num++;
+        s_stats.frame_sum_ms += time;
+        if (time > s_stats.frame_max_ms) {
+            s_stats.frame_max_ms = time;
+        }
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+    if (s_log.monitor_cb) {
+        s_log.monitor_cb(disp_drv, time, px);
+    }
+}
+
+static void log_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_PERF_LOG_PERIOD_S * 1000));
+
+        perf_log_record_t record = {
+            .type = PERF_LOG_RECORD_SAMPLE,
+        };
+        int64_t now_us = esp_timer_get_time();
+        portENTER_CRITICAL(&s_stats_lock);
+        uint32_t frame_num = s_stats.frame_num;
+        uint32_t frame_sum_ms = s_stats.frame_sum_ms;
+        record.sample.frame_max_ms = (uint16_t)MIN(s_stats.frame_max_ms, UINT16_MAX);
+        if (now_us - s_stats.camera_fps_time_us < LOG_CAMERA_FPS_STALE_US) {
+            record.sample.camera_fps_x10 = (uint16_t)MIN(s_stats.camera_fps_x10, UINT16_MAX);
+        }
+        s_stats.frame_num = 0;
+        s_stats.frame_sum_ms = 0;
+        s_stats.frame_max_ms = 0;
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        record.sample.frame_num = (uint16_t)MIN(frame_num, UINT16_MAX);
+        record.sample.frame_avg_ms = frame_num ? (uint16_t)MIN(frame_sum_ms / frame_num, UINT16_MAX) : 0;
+        record.sample.internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        record.sample.psram_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+        log_write(&record);
+    }
+}
+
+esp_err_t perf_log_init(void)
+{
+#if CONFIG_PERF_LOG
+    ESP_RETURN_ON_FALSE(s_log.partition == NULL, ESP_ERR_INVALID_STATE, TAG, "Already started");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                                PERF_LOG_PARTITION_LABEL);
+    ESP_RETURN_ON_FALSE(partition, ESP_ERR_NOT_FOUND, TAG, "No %s partition", PERF_LOG_PARTITION_LABEL);
+    ESP_RETURN_ON_FALSE(partition->size >= 2 * partition->erase_size, ESP_ERR_INVALID_SIZE, TAG,
+                        "Partition below two sectors");
+
+    s_log.lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_log.lock, ESP_ERR_NO_MEM, TAG, "No memory for the lock");
+    s_log.partition = partition;
+    s_log.slots_per_sector = partition->erase_size / LOG_SLOT_SIZE;
+    s_log.slot_num = (partition->size / partition->erase_size) * s_log.slots_per_sector;
+    esp_err_t ret = log_scan();
+    if (ret != ESP_OK) {
+        /* Unreadable partition, start over at its first sector */
+        s_log.write_slot = 0;
+        s_log.next_seq = 0;
+        s_log.boot = 1;
+    }
+
+    perf_log_record_t record = {
+        .type = PERF_LOG_RECORD_BOOT,
+        .reset = {
+            .reason = (uint32_t)esp_reset_reason(),
+        },
+    };
+    log_write(&record);
+    ESP_LOGI(TAG, "Boot %u, reset reason %s, %" PRIu32 " records", s_log.boot,
+             perf_log_reset_reason_str(record.reset.reason), s_log.next_seq);
+#if CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH && CONFIG_ESP_COREDUMP_DATA_FORMAT_ELF
+    log_record_panic();
+#endif
+
+    if (task_config_create(TASK_CONFIG_PERF_LOG, log_task, NULL, &s_log.task) != pdPASS) {
+        ESP_LOGE(TAG, "Create log task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void perf_log_attach_display(lv_disp_t *disp)
+{
+    if ((disp == NULL) || (disp->driver->monitor_cb == log_on_monitor)) {
+        return;
+    }
+    s_log.monitor_cb = disp->driver->monitor_cb;
+    disp->driver->monitor_cb = log_on_monitor;
+}
+
+void perf_log_set_camera_fps(uint32_t fps_x10)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.camera_fps_x10 = fps_x10;
+    s_stats.camera_fps_time_us = now_us;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+esp_err_t perf_log_read(perf_log_record_t *records, size_t max, size_t *count)
+{
+    esp_err_t ret = ESP_OK;
+    log_slot_t slot;
+
+    ESP_RETURN_ON_FALSE(records && count, ESP_ERR_INVALID_ARG, TAG, "Invalid args");
+    ESP_RETURN_ON_FALSE(s_log.partition, ESP_ERR_INVALID_STATE, TAG, "Not started");
+
+    *count = 0;
+    xSemaphoreTake(s_log.lock, portMAX_DELAY);
+    uint32_t index = s_log.write_slot;
+    uint32_t prev_seq = s_log.next_seq;
+    for (uint32_t i = 0; (i < s_log.slot_num) && (*count < max); i++) {
+        index = (index + s_log.slot_num - 1) % s_log.slot_num;
+        ret = log_read_slot(index, &slot);
+        if (ret != ESP_OK) {
+            break;
+        }
+        /* Back to the unwritten tail of the ring */
+        if (slot.magic == LOG_SLOT_ERASED) {
+            break;
+        }
+        if (!log_slot_valid(&slot)) {
+            continue;
+        }
+        /* Older than the ring, left from a previous turn or a previous layout */
+        if (slot.record.seq >= prev_seq) {
+            break;
+        }
+        prev_seq = slot.record.seq;
+        records[(*count)++] = slot.record;
+    }
+    xSemaphoreGive(s_log.lock);
+
+    return ret;
+}
+
+esp_err_t perf_log_clear(void)
+{
+    ESP_RETURN_ON_FALSE(s_log.partition, ESP_ERR_INVALID_STATE, TAG, "Not started");
+
+    xSemaphoreTake(s_log.lock, portMAX_DELAY);
+    esp_err_t ret = esp_partition_erase_range(s_log.partition, 0, s_log.partition->size);
+    s_log.write_slot = 0;
+    s_log.next_seq = 0;
+    if (ret == ESP_OK) {
+        perf_log_record_t record = {
+            .type = PERF_LOG_RECORD_BOOT,
+            .reset = {
+                .reason = (uint32_t)esp_reset_reason(),
+            },
+        };
+        ret = log_append(&record);
+    }
+    xSemaphoreGive(s_log.lock);
+    ESP_RETURN_ON_ERROR(ret, TAG, "Clear failed");
+
+    return ESP_OK;
+}
+
+const char *perf_log_reset_reason_str(uint32_t reset_reason)
+{
+    switch ((esp_reset_reason_t)reset_reason) {
+    case ESP_RST_POWERON:
+        return "power on";
+    case ESP_RST_EXT:
+        return "external pin";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+        return "interrupt watchdog";
+    case ESP_RST_TASK_WDT:
+        return "task watchdog";
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_DEEPSLEEP:
+        return "deep sleep";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    case ESP_RST_USB:
+        return "USB";
+    case ESP_RST_JTAG:
+        return "JTAG";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_LOG_PARTITION_LABEL    "perflog"   /*!< Data partition holding the records */
+#define PERF_LOG_TASK_NAME_LEN      (16)        /*!< Name of the panicked task, with its terminator */
+
+/**
+ * @brief Kinds of records
+ */
+typedef enum {
+    PERF_LOG_RECORD_BOOT = 1,       /*!< Written once per boot, with the reset reason */
+    PERF_LOG_RECORD_PANIC,          /*!< Summary of the core dump left by the previous boot */
+    PERF_LOG_RECORD_SAMPLE,         /*!< Performance sample, once per `CONFIG_PERF_LOG_PERIOD_S` */
+} perf_log_record_type_t;
+
+/**
+ * @brief Record read back from the partition
+ */
+typedef struct {
+    uint32_t seq;                   /*!< Number of the record since the partition was erased */
+    uint16_t boot;                  /*!< Number of the boot that wrote it */
+    uint8_t type;                   /*!< `perf_log_record_type_t` */
+    uint32_t uptime_s;              /*!< Time since the boot that wrote it */
+    union {
+        struct {
+            uint32_t reason;        /*!< `esp_reset_reason_t` */
+        } reset;                    /*!< `PERF_LOG_RECORD_BOOT` */
+        struct {
+            char task[PERF_LOG_TASK_NAME_LEN];  /*!< Task that crashed */
+            uint32_t pc;            /*!< Program counter of the exception */
+            uint32_t ra;            /*!< Return address, 0 on Xtensa targets */
+            uint32_t sp;            /*!< Stack pointer, 0 on Xtensa targets */
+            uint32_t cause;         /*!< `mcause` on RISC-V, `EXCCAUSE` is not saved on Xtensa */
+        } panic;                    /*!< `PERF_LOG_RECORD_PANIC` */
+        struct {
+            uint16_t camera_fps_x10;        /*!< Camera preview rate over the period, in 0.1 FPS, 0 if stopped */
+            uint16_t frame_avg_ms;          /*!< Average LVGL render and flush time over the period */
+            uint16_t frame_max_ms;          /*!< Longest LVGL render and flush time over the period */
+            uint16_t frame_num;             /*!< LVGL refreshes over the period */
+            uint32_t internal_min_free;     /*!< Lowest free internal heap since boot, in bytes */
+            uint32_t psram_min_free;        /*!< Lowest free PSRAM heap since boot, in bytes */
+        } sample;                   /*!< `PERF_LOG_RECORD_SAMPLE` */
+    };
+} perf_log_record_t;
+
+/**
+ * @brief Open the log, record the boot and start sampling.
+ *
+ * The partition is a ring of flash sectors written in fixed size records, each one appended once after the last
+ * and never rewritten. Only the oldest sector is erased when the ring wraps, so every sector is erased once per
+ * turn of the ring. A record cut by a reset fails its CRC and is skipped. Writes a boot record with the reset
+ * reason and, when `CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH` is set, a panic record from the summary of the core dump
+ * in flash, which is then erased so it is only recorded once. A task then writes a sample every
+ * `CONFIG_PERF_LOG_PERIOD_S`.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Already started
+ *      - ESP_ERR_NOT_FOUND      No `PERF_LOG_PARTITION_LABEL` partition
+ *      - ESP_ERR_INVALID_SIZE   Partition below two flash sectors
+ *      - ESP_ERR_NOT_SUPPORTED  The log is disabled
+ *      - ESP_ERR_NO_MEM         Failed to create the task
+ */
+esp_err_t perf_log_init(void);
+
+/**
+ * @brief Time the LVGL refreshes of a display into the samples.
+ *
+ * Chains the `monitor_cb` of the display. Must be called once with the LVGL lock held.
+ *
+ * @param disp Measured display
+ */
+void perf_log_attach_display(lv_disp_t *disp);
+
+/**
+ * @brief Report the camera preview rate, kept until the next report.
+ *
+ * @param fps_x10 Rate in 0.1 FPS, a rate not reported again for a few seconds counts as stopped
+ */
+void perf_log_set_camera_fps(uint32_t fps_x10);
+
+/**
+ * @brief Read the newest records, newest first.
+ *
+ * @param records   Output records
+ * @param max       Size of `records`
+ * @param count     Number of records read
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if the log is not open, or the error of
+ *         the flash read.
+ */
+esp_err_t perf_log_read(perf_log_record_t *records, size_t max, size_t *count);
+
+/**
+ * @brief Erase all the records and write a new boot record.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if the log is not open, or the error of the flash erase.
+ */
+esp_err_t perf_log_clear(void);
+
+/**
+ * @brief Short name of a reset reason, for display.
+ */
+const char *perf_log_reset_reason_str(uint32_t reset_reason);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,519 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
+#include "screen_capture/screen_capture.h"
+#include "pc_profile/pc_profile.h"
+#include "perf_runner.h"
+
+static const char *TAG = "perf_runner";
+
+#if CONFIG_PERF_RUNNER
+#define RUNNER_SECTION_NUM_MAX      (16)
+#define RUNNER_LAUNCH_NUM_MAX       (24)
+#define RUNNER_NAME_LEN_MAX         (32)
+#define RUNNER_LINE_LEN_MAX         (128)
+#define RUNNER_HIST_MS_MAX          (128)   /* Longer frames are counted in the last bucket, their maximum is kept */
+#define RUNNER_TAP_MS               (3 * CONFIG_LV_INDEV_DEF_READ_PERIOD)
+#define RUNNER_MOVE_STEP_MS         (10)
+#define RUNNER_LAUNCH_TIMEOUT_MS    (5000)
+#define RUNNER_REPORT_LEN_MAX       (4096)
+
+typedef void (*runner_monitor_cb_t)(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px);
+typedef void (*runner_read_cb_t)(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
+
+typedef struct {
+    char name[RUNNER_NAME_LEN_MAX];
+    int64_t start_us;
+    int64_t end_us;
+    uint32_t frame_num;
+    uint32_t frame_max_ms;
+    uint16_t frame_hist[RUNNER_HIST_MS_MAX + 1];    /* Frames per rendering time in ms, saturated */
+} runner_section_t;
+
+typedef struct {
+    char name[RUNNER_NAME_LEN_MAX];
+    bool ok;
+    int64_t start_us;
+    uint32_t run_ms;            /* Time the launch callback took */
+    int32_t first_frame_ms;     /* Until the first refresh after the callback, -1 if none came */
+} runner_launch_t;
+
+static struct {
+    perf_runner_config_t config;
+    TaskHandle_t task;
+    runner_monitor_cb_t monitor_cb;
+    runner_read_cb_t read_cb;
+    lv_indev_t *touch;
+    uint16_t width;
+    uint16_t height;
+    portMUX_TYPE lock;              /* Guards the touch fields, the others are guarded by the LVGL lock */
+    lv_point_t touch_point;
+    bool touch_pressed;
+    bool touch_active;              /* The last read reported the injected touch */
+    runner_section_t *sections;
+    int section_num;
+    runner_section_t *section;      /* Measured section, NULL between sections */
+    runner_launch_t launches[RUNNER_LAUNCH_NUM_MAX];
+    int launch_num;
+    runner_launch_t *launch;        /* Launch waiting for its first frame */
+    int error_num;
+} s_runner = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static void runner_on_monitor(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px)
+{
+    if (px > 0) {
+        runner_section_t *section = s_runner.section;
+        if (section) {
+            uint16_t *bucket = &section->frame_hist[LV_MIN(time, RUNNER_HIST_MS_MAX)];
+            if (*bucket < UINT16_MAX) {
+                (*bucket)++;
+            }
+            section->frame_num++;
+            section->frame_max_ms = LV_MAX(section->frame_max_ms, time);
+        }
+        if (s_runner.launch) {
+            s_runner.launch->first_frame_ms = (int32_t)((esp_timer_get_time() - s_runner.launch->start_us) / 1000);
+            s_runner.launch = NULL;
+        }
+    }
+    if (s_runner.monitor_cb) {
+        s_runner.monitor_cb(disp_drv, time, px);
+    }
+}
+
+static void runner_on_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+{
+    if (s_runner.read_cb) {
+        s_runner.read_cb(indev_drv, data);
+        // The panel wins while it is touched
+        if (data->state == LV_INDEV_STATE_PRESSED) {
+            return;
+        }
+    }
+
+    portENTER_CRITICAL(&s_runner.lock);
+    if (s_runner.touch_pressed) {
+        data->point = s_runner.touch_point;
+        data->state = LV_INDEV_STATE_PRESSED;
+        s_runner.touch_active = true;
+    } else if (s_runner.touch_active) {
+        data->point = s_runner.touch_point;
+        data->state = LV_INDEV_STATE_RELEASED;
+        s_runner.touch_active = false;
+    }
+    portEXIT_CRITICAL(&s_runner.lock);
+}
+
+static void runner_set_touch(lv_coord_t x, lv_coord_t y, bool pressed)
+{
+    portENTER_CRITICAL(&s_runner.lock);
+    s_runner.touch_point.x = x;
+    s_runner.touch_point.y = y;
+    s_runner.touch_pressed = pressed;
+    portEXIT_CRITICAL(&s_runner.lock);
+}
+
+static void runner_tap(lv_coord_t x, lv_coord_t y)
+{
+    runner_set_touch(x, y, true);
+    vTaskDelay(pdMS_TO_TICKS(RUNNER_TAP_MS));
+    runner_set_touch(x, y, false);
+    vTaskDelay(pdMS_TO_TICKS(RUNNER_TAP_MS));
+}
+
+static void runner_swipe(lv_coord_t x0, lv_coord_t y0, lv_coord_t x1, lv_coord_t y1, uint32_t duration_ms)
+{
+    int step_num = LV_MAX(duration_ms / RUNNER_MOVE_STEP_MS, 1);
+
+    runner_set_touch(x0, y0, true);
+    vTaskDelay(pdMS_TO_TICKS(RUNNER_TAP_MS));
+    for (int i = 1; i <= step_num; i++) {
+        runner_set_touch(x0 + (x1 - x0) * i / step_num, y0 + (y1 - y0) * i / step_num, true);
+        vTaskDelay(pdMS_TO_TICKS(RUNNER_MOVE_STEP_MS));
+    }
+    runner_set_touch(x1, y1, false);
+    vTaskDelay(pdMS_TO_TICKS(RUNNER_TAP_MS));
+}
+
+static void runner_copy_name(char *name, const char *src)
+{
+    size_t len = strnlen(src, RUNNER_NAME_LEN_MAX - 1);
+
+    // Names end up in the JSON report
+    for (size_t i = 0; i < len; i++) {
+        name[i] = ((src[i] == '"') || (src[i] == '\\') || iscntrl((unsigned char)src[i])) ? '_' : src[i];
+    }
+    name[len] = '\0';
+}
+
+static void runner_end_section(void)
+{
+    if (s_runner.section) {
+        s_runner.section->end_us = esp_timer_get_time();
+        s_runner.section = NULL;
+    }
+}
+
+static bool runner_begin_section(const char *name)
+{
+    bool ret = false;
+
+    bsp_display_lock(0);
+    runner_end_section();
+    if (s_runner.section_num < RUNNER_SECTION_NUM_MAX) {
+        runner_section_t *section = &s_runner.sections[s_runner.section_num++];
+        runner_copy_name(section->name, name);
+        section->start_us = esp_timer_get_time();
+        s_runner.section = section;
+        ret = true;
+    }
+    bsp_display_unlock();
+
+    return ret;
+}
+
+static bool runner_launch(const char *name)
+{
+    runner_launch_t *launch = NULL;
+
+    if (s_runner.launch_num >= RUNNER_LAUNCH_NUM_MAX) {
+        return false;
+    }
+    launch = &s_runner.launches[s_runner.launch_num++];
+    runner_copy_name(launch->name, name);
+    launch->first_frame_ms = -1;
+
+    bsp_display_lock(0);
+    launch->start_us = esp_timer_get_time();
+    launch->ok = s_runner.config.launch(name, s_runner.config.user_ctx);
+    launch->run_ms = (uint32_t)((esp_timer_get_time() - launch->start_us) / 1000);
+    if (launch->ok) {
+        s_runner.launch = launch;
+    }
+    bsp_display_unlock();
+    if (!launch->ok) {
+        return false;
+    }
+
+    for (int waited_ms = 0; waited_ms < RUNNER_LAUNCH_TIMEOUT_MS; waited_ms += RUNNER_MOVE_STEP_MS) {
+        vTaskDelay(pdMS_TO_TICKS(RUNNER_MOVE_STEP_MS));
+        if (launch->first_frame_ms >= 0) {
+            return true;
+        }
+    }
+    bsp_display_lock(0);
+    s_runner.launch = NULL;
+    bsp_display_unlock();
+    ESP_LOGW(TAG, "No frame after %s was launched", launch->name);
+
+    return false;
+}
+
+static bool runner_navigate(perf_runner_navigate_t navigate)
+{
+    bool ret = false;
+
+    bsp_display_lock(0);
+    ret = s_runner.config.navigate(navigate, s_runner.config.user_ctx);
+    bsp_display_unlock();
+
+    return ret;
+}
+
+// Pixels, or percent of `size` with a `%` suffix
+static bool runner_parse_coord(char **args, uint16_t size, lv_coord_t *coord)
+{
+    char *end = NULL;
+    long value = strtol(*args, &end, 10);
+
+    if (end == *args) {
+        return false;
+    }
+    if (*end == '%') {
+        value = value * size / 100;
+        end++;
+    }
+    *args = end;
+    *coord = (lv_coord_t)LV_CLAMP(0, value, size - 1);
+
+    return true;
+}
+
+static bool runner_parse_int(char **args, long *value)
+{
+    char *end = NULL;
+
+    *value = strtol(*args, &end, 10);
+    if ((end == *args) || (*value < 0)) {
+        return false;
+    }
+    *args = end;
+
+    return true;
+}
+
+static bool runner_run_step(char *line)
+{
+    char *args = line;
+    char *cmd = NULL;
+    lv_coord_t x0 = 0;
+    lv_coord_t y0 = 0;
+    lv_coord_t x1 = 0;
+    lv_coord_t y1 = 0;
+    long value = 0;
+
+    cmd = strsep(&args, " \t");
+    args = (args != NULL) ? args + strspn(args, " \t") : line + strlen(line);
+
+    if (strcmp(cmd, "section") == 0) {
+        return (*args != '\0') && runner_begin_section(args);
+    } else if (strcmp(cmd, "wait") == 0) {
+        if (!runner_parse_int(&args, &value)) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(value));
+        return true;
+    } else if (strcmp(cmd, "tap") == 0) {
+        if (!runner_parse_coord(&args, s_runner.width, &x0) || !runner_parse_coord(&args, s_runner.height, &y0)) {
+            return false;
+        }
+        runner_tap(x0, y0);
+        return true;
+    } else if (strcmp(cmd, "swipe") == 0) {
+        if (!runner_parse_coord(&args, s_runner.width, &x0) || !runner_parse_coord(&args, s_runner.height, &y0) ||
+                !runner_parse_coord(&args, s_runner.width, &x1) || !runner_parse_coord(&args, s_runner.height, &y1) ||
+                !runner_parse_int(&args, &value)) {
+            return false;
+        }
+        runner_swipe(x0, y0, x1, y1, value);
+        return true;
+    } else if (strcmp(cmd, "launch") == 0) {
+        return (*args != '\0') && runner_launch(args);
+    } else if (strcmp(cmd, "home") == 0) {
+        return runner_navigate(PERF_RUNNER_NAVIGATE_HOME);
+    } else if (strcmp(cmd, "back") == 0) {
+        return runner_navigate(PERF_RUNNER_NAVIGATE_BACK);
+    } else if (strcmp(cmd, "recents") == 0) {
+        return runner_navigate(PERF_RUNNER_NAVIGATE_RECENTS);
+    } else if (strcmp(cmd, "screenshot") == 0) {
+        return screen_capture_shot(NULL, 0) == ESP_OK;
+    } else if (strcmp(cmd, "profile_start") == 0) {
+        return pc_profile_start() == ESP_OK;
+    } else if (strcmp(cmd, "profile_stop") == 0) {
+        return (pc_profile_stop() == ESP_OK) && (pc_profile_dump() == ESP_OK);
+    }
+
+    return false;
+}
+
+static void runner_run_script(const char *path)
+{
+    char line[RUNNER_LINE_LEN_MAX];
+    int line_num = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Open %s failed", path);
+        s_runner.error_num++;
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *step = line + strspn(line, " \t");
+        line_num++;
+        step[strcspn(step, "#\r\n")] = '\0';
+        for (char *end = step + strlen(step); (end > step) && isspace((unsigned char)end[-1]); end--) {
+            end[-1] = '\0';
+        }
+        if (*step == '\0') {
+            continue;
+        }
+
+        ESP_LOGD(TAG, "%d: %s", line_num, step);
+        if (!runner_run_step(step)) {
+            ESP_LOGW(TAG, "Step %d failed: %s", line_num, step);
+            s_runner.error_num++;
+        }
+    }
+    fclose(file);
+}
+
+static void runner_append(char *report, size_t *len, const char *format, ...)
+{
+    va_list args;
+
+    if (*len >= RUNNER_REPORT_LEN_MAX) {
+        return;
+    }
+    va_start(args, format);
+    *len += vsnprintf(report + *len, RUNNER_REPORT_LEN_MAX - *len, format, args);
+    va_end(args);
+}
+
+// Rendering time under which `percent` of the frames were drawn
+static uint32_t runner_get_percentile(const runner_section_t *section, uint32_t percent)
+{
+    uint32_t counted = 0;
+    uint32_t total = 0;
+
+    for (int i = 0; i <= RUNNER_HIST_MS_MAX; i++) {
+        total += section->frame_hist[i];
+    }
+    for (int i = 0; i < RUNNER_HIST_MS_MAX; i++) {
+        counted += section->frame_hist[i];
+        if (counted * 100 >= total * percent) {
+            return i;
+        }
+    }
+
+    return section->frame_max_ms;
+}
+
+static void runner_print_report(void)
+{
+    size_t len = 0;
+    char *report = heap_caps_malloc(RUNNER_REPORT_LEN_MAX, MALLOC_CAP_SPIRAM);
+
+    if (report == NULL) {
+        ESP_LOGE(TAG, "No memory for the report");
+        return;
+    }
+
+    runner_append(report, &len, "{\"version\":%d,\"boot_ms\":%lld,\"errors\":%d,", PERF_RUNNER_REPORT_VERSION,
+                  s_runner.config.boot_time_us / 1000, s_runner.error_num);
+    runner_append(report, &len, "\"heap\":{\"internal_free_kb\":%u,\"internal_min_free_kb\":%u,"
+                  "\"psram_free_kb\":%u,\"psram_min_free_kb\":%u},",
+                  heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024,
+                  heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL) / 1024,
+                  heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024,
+                  heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM) / 1024);
+
+    runner_append(report, &len, "\"sections\":[");
+    for (int i = 0; i < s_runner.section_num; i++) {
+        const runner_section_t *section = &s_runner.sections[i];
+        int64_t duration_us = LV_MAX(section->end_us - section->start_us, 1);
+        runner_append(report, &len, "%s{\"name\":\"%s\",\"duration_ms\":%lld,\"frames\":%lu,\"fps\":%.1f,"
+                      "\"frame_ms\":{\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}}", (i > 0) ? "," : "",
+                      section->name, duration_us / 1000, section->frame_num,
+                      section->frame_num * 1000000.0 / duration_us, runner_get_percentile(section, 50),
+                      runner_get_percentile(section, 90), runner_get_percentile(section, 99), section->frame_max_ms);
+    }
+
+    runner_append(report, &len, "],\"launches\":[");
+    for (int i = 0; i < s_runner.launch_num; i++) {
+        const runner_launch_t *launch = &s_runner.launches[i];
+        runner_append(report, &len, "%s{\"app\":\"%s\",\"ok\":%s,\"run_ms\":%lu,\"first_frame_ms\":%ld}",
+                      (i > 0) ? "," : "", launch->name, launch->ok ? "true" : "false", launch->run_ms,
+                      launch->first_frame_ms);
+    }
+    runner_append(report, &len, "]}");
+
+    if (len >= RUNNER_REPORT_LEN_MAX) {
+        ESP_LOGE(TAG, "Report truncated, shorten the script");
+    } else {
+        // One write, so the log of the other tasks can't cut the line
+        printf(PERF_RUNNER_REPORT_PREFIX "%s\n", report);
+    }
+    free(report);
+}
+
+static void runner_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_PERF_RUNNER_START_DELAY_MS));
+
+    ESP_LOGI(TAG, "Run %s", CONFIG_PERF_RUNNER_SCRIPT);
+    runner_run_script(BSP_SPIFFS_MOUNT_POINT "/" CONFIG_PERF_RUNNER_SCRIPT);
+    runner_set_touch(0, 0, false);
+
+    bsp_display_lock(0);
+    runner_end_section();
+    s_runner.launch = NULL;
+    bsp_display_unlock();
+
+    runner_print_report();
+    ESP_LOGI(TAG, "Done, %d step(s) failed", s_runner.error_num);
+
+    s_runner.task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t perf_runner_start(const perf_runner_config_t *config)
+{
+    static lv_indev_drv_t indev_drv;
+    lv_disp_t *disp = NULL;
+    lv_indev_t *indev = NULL;
+
+    ESP_RETURN_ON_FALSE(config && config->disp && config->launch && config->navigate, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid config");
+    ESP_RETURN_ON_FALSE(s_runner.sections == NULL, ESP_ERR_INVALID_STATE, TAG, "Already started");
+
+    s_runner.config = *config;
+    if (s_runner.config.boot_time_us < 0) {
+        s_runner.config.boot_time_us = esp_timer_get_time();
+    }
+    s_runner.sections = heap_caps_calloc(RUNNER_SECTION_NUM_MAX, sizeof(runner_section_t), MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(s_runner.sections, ESP_ERR_NO_MEM, TAG, "No memory for the sections");
+    // The task waits for the start delay, the hooks below are in place long before it reads them
+    if (task_config_create(TASK_CONFIG_PERF_RUNNER, runner_task, NULL, &s_runner.task) != pdPASS) {
+        free(s_runner.sections);
+        s_runner.sections = NULL;
+        ESP_LOGE(TAG, "Create runner task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    disp = config->disp;
+    s_runner.width = lv_disp_get_hor_res(disp);
+    s_runner.height = lv_disp_get_ver_res(disp);
+    s_runner.monitor_cb = disp->driver->monitor_cb;
+    disp->driver->monitor_cb = runner_on_monitor;
+
+    indev = lv_indev_get_next(NULL);
+    while ((indev != NULL) && ((lv_indev_get_type(indev) != LV_INDEV_TYPE_POINTER) || (indev->driver->disp != disp))) {
+        indev = lv_indev_get_next(indev);
+    }
+    if ((indev != NULL) && (indev->driver->read_cb != NULL)) {
+        s_runner.read_cb = indev->driver->read_cb;
+        indev->driver->read_cb = runner_on_read;
+    } else {
+        ESP_LOGW(TAG, "No touch panel, register a pointer device for the script");
+        lv_indev_drv_init(&indev_drv);
+        indev_drv.type = LV_INDEV_TYPE_POINTER;
+        indev_drv.disp = disp;
+        indev_drv.read_cb = runner_on_read;
+        indev = lv_indev_drv_register(&indev_drv);
+    }
+    s_runner.touch = indev;
+
+    ESP_LOGI(TAG, "Script starts in %d ms", CONFIG_PERF_RUNNER_START_DELAY_MS);
+
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t perf_runner_start(const perf_runner_config_t *config)
+{
+    ESP_LOGD(TAG, "Performance runner disabled");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_PERF_RUNNER */
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_RUNNER_REPORT_PREFIX       "PERF_REPORT "  /*!< Start of the UART line carrying the JSON report */
+#define PERF_RUNNER_REPORT_VERSION      (1)             /*!< Version of the report layout */
+
+/**
+ * @brief Navigation steps of the script
+ */
+typedef enum {
+    PERF_RUNNER_NAVIGATE_HOME,      /*!< `home` */
+    PERF_RUNNER_NAVIGATE_BACK,      /*!< `back` */
+    PERF_RUNNER_NAVIGATE_RECENTS,   /*!< `recents` */
+} perf_runner_navigate_t;
+
+/**
+ * @brief Start an installed app, called by the runner task with the LVGL lock held
+ *
+ * @param app_name Name the app was installed with.
+ * @param user_ctx `user_ctx` of the config.
+ *
+ * @return true if the app was started.
+ */
+typedef bool (*perf_runner_launch_cb_t)(const char *app_name, void *user_ctx);
+
+/**
+ * @brief Navigate the system, called by the runner task with the LVGL lock held
+ *
+ * @param navigate Navigation step.
+ * @param user_ctx `user_ctx` of the config.
+ *
+ * @return true on success.
+ */
+typedef bool (*perf_runner_navigate_cb_t)(perf_runner_navigate_t navigate, void *user_ctx);
+
+/**
+ * @brief Configuration of the runner
+ */
+typedef struct {
+    lv_disp_t *disp;                        /*!< Measured display */
+    int64_t boot_time_us;                   /*!< Reported boot time, -1 for the time of `perf_runner_start` */
+    perf_runner_launch_cb_t launch;         /*!< Starts the apps of the `launch` steps */
+    perf_runner_navigate_cb_t navigate;     /*!< Runs the `home`, `back` and `recents` steps */
+    void *user_ctx;                         /*!< Passed to the callbacks */
+} perf_runner_config_t;
+
+/**
+ * @brief Run the performance script once the firmware is up and print the report on the console.
+ *
+ * Chains the `monitor_cb` of the display to record every refresh and the `read_cb` of its pointer input device to
+ * inject the touches of the script, a pointer device is registered if the display has none. The panel wins while
+ * it is touched. After `CONFIG_PERF_RUNNER_START_DELAY_MS` the task runs `CONFIG_PERF_RUNNER_SCRIPT` from the
+ * storage partition, one step per line, `#` starts a comment:
+ *
+ * - `section <name>`: ends the current section and starts measuring a new one
+ * - `wait <ms>`
+ * - `tap <x> <y>`
+ * - `swipe <x0> <y0> <x1> <y1> <ms>`
+ * - `launch <app name>`: starts the app through the launch callback and times it until its first frame
+ * - `home`, `back`, `recents`: through the navigate callback
+ * - `screenshot`: saves the screen with `screen_capture_shot`, needs `CONFIG_SCREEN_CAPTURE`
+ * - `profile_start`, `profile_stop`: sample the PCs between the two steps, the stop prints them with
+ *   `pc_profile_dump`, needs `CONFIG_PC_PROFILE`
+ *
+ * Coordinates are in pixels, or in percent of the screen when they end with `%`. The report is one line starting
+ * with `PERF_RUNNER_REPORT_PREFIX` followed by a JSON object holding the boot time, the lowest free heap since boot,
+ * the frame count, FPS and frame time percentiles of every section and the time of every launch. The frame time is
+ * the time LVGL took to render and flush a refresh, in 1 ms steps.
+ *
+ * Must be called once with the LVGL lock held.
+ *
+ * @param config Configuration, copied.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM, or
+ *         ESP_ERR_NOT_SUPPORTED if the runner is disabled.
+ */
+esp_err_t perf_runner_start(const perf_runner_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "pm_policy.h"
+
+#if CONFIG_PM_POLICY
+#include "esp_pm.h"
+
+#define POLICY_LOCK_CPU             (1 << 0)    /* Keep the CPU at its maximum frequency */
+#define POLICY_LOCK_AWAKE           (1 << 1)    /* Keep the chip out of light sleep */
+
+typedef struct {
+    const char *name;
+    uint8_t locks;
+} policy_client_config_t;
+
+static const char *TAG = "pm_policy";
+
+/* A task blocked on its peripheral (a camera frame, an I2S buffer, a USB transfer) lets the idle task run, which
+ * would slow the clock under the peripheral or sleep through its interrupts */
+static const policy_client_config_t s_clients[PM_POLICY_CLIENT_NUM] = {
+    [PM_POLICY_CLIENT_DISPLAY] = { "pm_display", POLICY_LOCK_AWAKE },
+    [PM_POLICY_CLIENT_RENDER]  = { "pm_render",  POLICY_LOCK_CPU },
+    [PM_POLICY_CLIENT_TOUCH]   = { "pm_touch",   POLICY_LOCK_CPU },
+    [PM_POLICY_CLIENT_CAMERA]  = { "pm_camera",  POLICY_LOCK_CPU | POLICY_LOCK_AWAKE },
+    [PM_POLICY_CLIENT_AUDIO]   = { "pm_audio",   POLICY_LOCK_CPU | POLICY_LOCK_AWAKE },
+    [PM_POLICY_CLIENT_USB]     = { "pm_usb",     POLICY_LOCK_CPU | POLICY_LOCK_AWAKE },
+};
+
+static struct {
+    bool ready;
+    SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutex_buf;
+    esp_pm_lock_handle_t cpu[PM_POLICY_CLIENT_NUM];
+    esp_pm_lock_handle_t awake[PM_POLICY_CLIENT_NUM];
+    /* Guarded by `mutex` */
+    uint32_t count[PM_POLICY_CLIENT_NUM];
+    /* Only used by the LVGL task */
+    lv_timer_cb_t refr_cb;
+} s_policy;
+
+static void policy_set_locks(pm_policy_client_t client, bool acquire)
+{
+    esp_err_t (*op)(esp_pm_lock_handle_t) = acquire ? esp_pm_lock_acquire : esp_pm_lock_release;
+
+    if (s_policy.cpu[client] != NULL) {
+        op(s_policy.cpu[client]);
+    }
+    if (s_policy.awake[client] != NULL) {
+        op(s_policy.awake[client]);
+    }
+}
+
+static void policy_refr_timer_cb(lv_timer_t *timer)
+{
+    pm_policy_acquire(PM_POLICY_CLIENT_RENDER);
+    s_policy.refr_cb(timer);
+    pm_policy_release(PM_POLICY_CLIENT_RENDER);
+}
+
+static void policy_delete_locks(void)
+{
+    for (int i = 0; i < PM_POLICY_CLIENT_NUM; i++) {
+        if (s_policy.cpu[i] != NULL) {
+            esp_pm_lock_delete(s_policy.cpu[i]);
+            s_policy.cpu[i] = NULL;
+        }
+        if (s_policy.awake[i] != NULL) {
+            esp_pm_lock_delete(s_policy.awake[i]);
+            s_policy.awake[i] = NULL;
+        }
+    }
+}
+#endif
+
+esp_err_t pm_policy_init(void)
+{
+#if CONFIG_PM_POLICY
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(!s_policy.ready, ESP_ERR_INVALID_STATE, TAG, "Already started");
+
+    s_policy.mutex = xSemaphoreCreateMutexStatic(&s_policy.mutex_buf);
+
+    for (int i = 0; i < PM_POLICY_CLIENT_NUM; i++) {
+        if (s_clients[i].locks & POLICY_LOCK_CPU) {
+            ESP_GOTO_ON_ERROR(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, s_clients[i].name, &s_policy.cpu[i]), err,
+                              TAG, "Create CPU lock of %s failed", s_clients[i].name);
+        }
+        if (s_clients[i].locks & POLICY_LOCK_AWAKE) {
+            ESP_GOTO_ON_ERROR(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, s_clients[i].name, &s_policy.awake[i]),
+                              err, TAG, "Create sleep lock of %s failed", s_clients[i].name);
+        }
+    }
+
+    /* Every lock is known before the light sleep is allowed */
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_PM_POLICY_MIN_FREQ_MHZ,
+#if CONFIG_PM_POLICY_LIGHT_SLEEP
+        .light_sleep_enable = true,
+#endif
+    };
+    ESP_GOTO_ON_ERROR(esp_pm_configure(&pm_config), err, TAG, "Configure power management failed");
+    s_policy.ready = true;
+    ESP_LOGI(TAG, "CPU at %d-%d MHz, light sleep %s", CONFIG_PM_POLICY_MIN_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             pm_config.light_sleep_enable ? "on" : "off");
+
+    return ESP_OK;
+
+err:
+    policy_delete_locks();
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void pm_policy_acquire(pm_policy_client_t client)
+{
+#if CONFIG_PM_POLICY
+    if (!s_policy.ready || (client >= PM_POLICY_CLIENT_NUM)) {
+        return;
+    }
+
+    /* A frequency switch can't run in a critical section, the mutex keeps the first acquire of a client ahead of
+     * its last release */
+    xSemaphoreTake(s_policy.mutex, portMAX_DELAY);
+    if (s_policy.count[client]++ == 0) {
+        policy_set_locks(client, true);
+    }
+    xSemaphoreGive(s_policy.mutex);
+#else
+    (void)client;
+#endif
+}
+
+void pm_policy_release(pm_policy_client_t client)
+{
+#if CONFIG_PM_POLICY
+    if (!s_policy.ready || (client >= PM_POLICY_CLIENT_NUM)) {
+        return;
+    }
+
+    xSemaphoreTake(s_policy.mutex, portMAX_DELAY);
+    if ((s_policy.count[client] > 0) && (--s_policy.count[client] == 0)) {
+        policy_set_locks(client, false);
+    }
+    xSemaphoreGive(s_policy.mutex);
+#else
+    (void)client;
+#endif
+}
+
+void pm_policy_attach_display(lv_disp_t *disp)
+{
+#if CONFIG_PM_POLICY
+    if ((disp == NULL) || (disp->refr_timer == NULL) || (s_policy.refr_cb != NULL)) {
+        return;
+    }
+
+    /* LVGL pauses the refresh timer while nothing is invalidated, an idle UI leaves the CPU to the scaling */
+    s_policy.refr_cb = disp->refr_timer->timer_cb;
+    disp->refr_timer->timer_cb = policy_refr_timer_cb;
+#else
+    (void)disp;
+#endif
+}
@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Activities that need the chip awake, each holds the power management locks of its row in `pm_policy.c`
+ */
+typedef enum {
+    PM_POLICY_CLIENT_DISPLAY,       /*!< Panel on, its scan out stops in light sleep */
+    PM_POLICY_CLIENT_RENDER,        /*!< LVGL refresh of the display */
+    PM_POLICY_CLIENT_TOUCH,         /*!< Touch pressed, thrown scroll, and a short while after the last press */
+    PM_POLICY_CLIENT_CAMERA,        /*!< Camera stream running */
+    PM_POLICY_CLIENT_AUDIO,         /*!< Music playing */
+    PM_POLICY_CLIENT_USB,           /*!< USB host installed, or the device attached to a host */
+    PM_POLICY_CLIENT_NUM,
+} pm_policy_client_t;
+
+/**
+ * @brief Set up the frequency scaling and the automatic light sleep.
+ *
+ * The CPU runs between `CONFIG_PM_POLICY_MIN_FREQ_MHZ` and `CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ`, at the maximum as long
+ * as a client needing it is active. Light sleep is entered by the idle task when `CONFIG_PM_POLICY_LIGHT_SLEEP` is
+ * set and no client keeping the chip awake is active. Call once at boot, before the clients.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Already set up
+ *      - ESP_ERR_NOT_SUPPORTED  The policy or `CONFIG_PM_ENABLE` is disabled
+ *      - Others                 Error of `esp_pm_configure()` or of the lock creation
+ */
+esp_err_t pm_policy_init(void);
+
+/**
+ * @brief Count an activity of a client, its locks are taken by the first one.
+ *
+ * Can be called from any task, not from an ISR. Before `pm_policy_init()` or with the policy disabled it does
+ * nothing.
+ *
+ * @param client Client starting an activity
+ */
+void pm_policy_acquire(pm_policy_client_t client);
+
+/**
+ * @brief End an activity counted by `pm_policy_acquire()`, the locks are released with the last one.
+ *
+ * A release without an activity counted is ignored.
+ *
+ * @param client Client ending an activity
+ */
+void pm_policy_release(pm_policy_client_t client);
+
+/**
+ * @brief Hold `PM_POLICY_CLIENT_RENDER` during each LVGL refresh of a display.
+ *
+ * Wraps the refresh timer of the display, which LVGL pauses while nothing is invalidated. Must be called once with
+ * the LVGL lock held.
+ *
+ * @param disp Display
+ */
+void pm_policy_attach_display(lv_disp_t *disp);
+
+#ifdef __cplusplus
+}
+#endif
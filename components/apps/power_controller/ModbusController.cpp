@@ -8,14 +8,50 @@
  */
 
 #include "ModbusController.hpp"
+#include "crc16_modbus/crc16_modbus.h"
 #include "esp_timer.h"
+#include "nvs.h"
+#include "task_config/task_config.h"
 #include <string.h>
 
 const char* ModbusController::TAG = "ModbusController";
+const char* ModbusController::BAUD_NVS_NAMESPACE = "modbus";
+const char* ModbusController::BAUD_NVS_KEY = "baud";
+
+// XY6506S手册中REG_BAUDRATE_L的取值，最高为出厂默认的115200
+const ModbusController::BaudRate ModbusController::BAUD_RATES[] = {
+    {9600, 0}, {14400, 1}, {19200, 2}, {38400, 3}, {56000, 4}, {57600, 5}, {115200, 6},
+};
+const size_t ModbusController::BAUD_RATE_COUNT = sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]);
+
+// 115200波特率下完整的轮询响应约6ms，区间在此附近较密
+const uint32_t ModbusController::LINK_HIST_EDGES_US[ModbusLinkStats::HIST_BINS - 1] = {
+    1000, 2000, 4000, 6000, 8000, 12000, 16000, 32000, 64000,
+};
+
+const uint16_t ModbusController::POLL_REGISTERS[] = {
+    REG_V_SET, REG_I_SET, REG_VOUT, REG_IOUT, REG_POWER, REG_UIN,
+    REG_LOCK, REG_ONOFF, REG_SLEEP, REG_BUZZER,
+};
 
 ModbusController::ModbusController() 
-    : modbus_mutex(nullptr), last_communication_ms(0), is_initialized(false) {
-    memset(&device_data, 0, sizeof(device_data));
+    : modbus_mutex(nullptr), uart_queue(nullptr), last_communication_ms(0), is_initialized(false),
+      baud_rate(UART_BAUD_RATE), baud_negotiation_pending(false), poll_block_count(0),
+      write_seq(0), discovery_active(false), discovery_next(0), discovery_last(0), discovery_found(0),
+      discovery_done(nullptr), sample_cb(nullptr), sample_ctx(nullptr), sample_interval_ms(0), link_tx_start_us(0),
+      link_first_byte_us(0), link_rx_bytes(0), link_overflow(false), worker_task(nullptr), worker_exit(nullptr), worker_running(false) {
+    memset(devices, 0, sizeof(devices));
+    memset(pending_writes, 0, sizeof(pending_writes));
+    memset(&link_stats, 0, sizeof(link_stats));
+    portMUX_INITIALIZE(&request_lock);
+    portMUX_INITIALIZE(&stats_lock);
+    buildPollPlan();
+    
+    // 默认的从机始终在devices[0]，单机接口都作用于它
+    devices[0].used = true;
+    devices[0].address = DEVICE_ADDRESS;
+    devices[0].online = true;
+    devices[0].interval_ms = POLL_INTERVAL_MIN_MS;
 }
 
 ModbusController::~ModbusController() {
@@ -35,9 +71,10 @@ bool ModbusController::initialize() {
         return false;
     }
     
-    // 配置UART
+    // 配置UART，从上次协商的波特率开始
+    baud_rate = loadBaudRate();
     uart_config_t uart_config = {
-        .baud_rate = UART_BAUD_RATE,
+        .baud_rate = (int)baud_rate,
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
@@ -46,7 +83,7 @@ bool ModbusController::initialize() {
     };
     
     // 安装UART驱动
-    esp_err_t err = uart_driver_install(UART_PORT, UART_BUF_SIZE, UART_BUF_SIZE, 0, NULL, 0);
+    esp_err_t err = uart_driver_install(UART_PORT, UART_BUF_SIZE, UART_BUF_SIZE, UART_EVENT_QUEUE_SIZE, &uart_queue, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to install UART driver: %s", esp_err_to_name(err));
         vSemaphoreDelete(modbus_mutex);
@@ -71,10 +108,46 @@ bool ModbusController::initialize() {
         return false;
     }
     
+    // 线路静默t3.5后产生接收超时事件，响应在帧结束时立即交付
+    err = uart_set_rx_timeout(UART_PORT, frameGapSymbols());
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set UART RX timeout: %s", esp_err_to_name(err));
+        uart_driver_delete(UART_PORT);
+        vSemaphoreDelete(modbus_mutex);
+        return false;
+    }
+    
     is_initialized = true;
+    
+    // 工作任务执行排队的事务，UI只需提交请求
+    worker_exit = xSemaphoreCreateBinary();
+    discovery_done = xSemaphoreCreateBinary();
+    worker_running = true;
+    if (worker_exit == nullptr || discovery_done == nullptr ||
+        task_config_create(TASK_CONFIG_MODBUS_WORKER, workerTask, this, &worker_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create Modbus worker task");
+        worker_running = false;
+        worker_task = nullptr;
+        if (worker_exit != nullptr) {
+            vSemaphoreDelete(worker_exit);
+            worker_exit = nullptr;
+        }
+        if (discovery_done != nullptr) {
+            vSemaphoreDelete(discovery_done);
+            discovery_done = nullptr;
+        }
+        is_initialized = false;
+        uart_driver_delete(UART_PORT);
+        vSemaphoreDelete(modbus_mutex);
+        modbus_mutex = nullptr;
+        return false;
+    }
+    
     ESP_LOGI(TAG, "Modbus controller initialized successfully");
     ESP_LOGI(TAG, "UART Port: %d, TX: GPIO%d, RX: GPIO%d, Baud: %d", 
-             UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_BAUD_RATE);
+             UART_PORT, UART_TX_PIN, UART_RX_PIN, (int)baud_rate);
+    // 确认波特率，从机被设为较低的波特率时升高到最高
+    startBaudNegotiation();
     
     return true;
 }
@@ -84,7 +157,28 @@ void ModbusController::deinitialize() {
         return;
     }
     
+    // 先停止工作任务，正在进行的事务完成后退出
+    if (worker_task != nullptr) {
+        worker_running = false;
+        xTaskNotifyGive(worker_task);
+        if (xSemaphoreTake(worker_exit, pdMS_TO_TICKS(WORKER_EXIT_TIMEOUT_MS)) != pdTRUE) {
+            ESP_LOGW(TAG, "Modbus worker did not exit in time");
+        }
+        worker_task = nullptr;
+    }
+    if (worker_exit != nullptr) {
+        vSemaphoreDelete(worker_exit);
+        worker_exit = nullptr;
+    }
+    if (discovery_done != nullptr) {
+        vSemaphoreDelete(discovery_done);
+        discovery_done = nullptr;
+    }
+    discovery_active = false;
+    failPendingRequests();
+    
     uart_driver_delete(UART_PORT);
+    uart_queue = nullptr;
     
     if (modbus_mutex != nullptr) {
         vSemaphoreDelete(modbus_mutex);
@@ -95,21 +189,42 @@ void ModbusController::deinitialize() {
     ESP_LOGI(TAG, "Modbus controller deinitialized");
 }
 
-uint16_t ModbusController::calculateCRC(const uint8_t* data, size_t length) {
-    uint16_t crc = 0xFFFF;
+uint8_t ModbusController::frameGapSymbols() const {
+    // 8N1，每个字符10位
+    uint32_t char_us = 10 * 1000000 / baud_rate;
+    uint32_t gap_us = (char_us * 7 + 1) / 2;
+    if (gap_us < FRAME_GAP_MIN_US) {
+        gap_us = FRAME_GAP_MIN_US;
+    }
+    
+    return (gap_us + char_us - 1) / char_us;
+}
+
+size_t ModbusController::expectedResponseLength(const uint8_t* frame, size_t received) {
+    if (received < 2) {
+        return 0;
+    }
     
-    for (size_t i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x0001) {
-                crc = (crc >> 1) ^ 0xA001;
-            } else {
-                crc = crc >> 1;
-            }
-        }
+    // 异常响应：地址+功能码+异常码+CRC
+    if (frame[1] & 0x80) {
+        return 5;
     }
     
-    return crc;
+    switch (frame[1]) {
+    case 0x03:
+    case 0x04:
+        // 地址+功能码+长度字节+数据+CRC
+        return (received >= 3) ? (size_t)(3 + frame[2] + 2) : 0;
+    case 0x05:
+    case 0x06:
+    case 0x0F:
+    case 0x10:
+        // 回显地址和值（或数量）
+        return 8;
+    default:
+        // 未知长度，等待帧间隔
+        return 0;
+    }
 }
 
 void ModbusController::ensureFrameInterval() {
@@ -130,8 +245,9 @@ bool ModbusController::sendModbusFrame(const uint8_t* frame, size_t length) {
     
     ensureFrameInterval();
     
-    // 清空接收缓冲区
+    // 清空接收缓冲区，以及其中数据对应的事件
     uart_flush_input(UART_PORT);
+    xQueueReset(uart_queue);
     
     // 记录发送的帧（用于调试）
     ESP_LOGD(TAG, "📤 Sending Modbus frame (%d bytes): %02X %02X %02X %02X %02X %02X %02X %02X", 
@@ -139,7 +255,11 @@ bool ModbusController::sendModbusFrame(const uint8_t* frame, size_t length) {
              length > 4 ? frame[4] : 0, length > 5 ? frame[5] : 0,
              length > 6 ? frame[6] : 0, length > 7 ? frame[7] : 0);
     
-    // 发送数据
+    // 发送数据，事务的延迟从这里计时
+    link_tx_start_us = esp_timer_get_time();
+    link_first_byte_us = 0;
+    link_rx_bytes = 0;
+    link_overflow = false;
     int written = uart_write_bytes(UART_PORT, frame, length);
     if (written != length) {
         ESP_LOGE(TAG, "Failed to write complete frame, written: %d, expected: %d", written, (int)length);
@@ -164,72 +284,89 @@ bool ModbusController::receiveModbusFrame(uint8_t* frame, size_t* length, uint32
     }
     
     size_t received = 0;
-    uint32_t start_time = esp_timer_get_time() / 1000;
-    size_t expected_length = 0;  // 动态确定期望的响应长度
-    bool header_received = false;
-    
-    while (true) {
-        uint32_t current_time = esp_timer_get_time() / 1000;
-        if (current_time - start_time > timeout_ms) {
-            if (received > 0) {
-                ESP_LOGD(TAG, "📥 Received %d bytes before timeout: %02X %02X %02X %02X %02X %02X %02X %02X %02X", 
-                         (int)received,
-                         received > 0 ? frame[0] : 0, received > 1 ? frame[1] : 0,
-                         received > 2 ? frame[2] : 0, received > 3 ? frame[3] : 0,
-                         received > 4 ? frame[4] : 0, received > 5 ? frame[5] : 0,
-                         received > 6 ? frame[6] : 0, received > 7 ? frame[7] : 0,
-                         received > 8 ? frame[8] : 0);
-                *length = received;
-                return true;  // 返回已接收的数据
-            } else {
-                ESP_LOGW(TAG, "Receive timeout, no data received");
-                break;
-            }
+    bool frame_end = false;
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    
+    while (received < *length) {
+        // 长度已知时收齐即交付，不等帧间隔
+        size_t expected_length = expectedResponseLength(frame, received);
+        if (expected_length > 0 && received >= expected_length) {
+            ESP_LOGD(TAG, "📥 Complete frame received: %d bytes", (int)received);
+            break;
         }
-        
-        int available = 0;
-        esp_err_t err = uart_get_buffered_data_len(UART_PORT, (size_t*)&available);
-        if (err != ESP_OK || available == 0) {
-            vTaskDelay(pdMS_TO_TICKS(1));
-            continue;
+        if (frame_end) {
+            ESP_LOGD(TAG, "📥 Frame ended after %d bytes", (int)received);
+            break;
         }
         
-        // 读取可用数据，但不超过缓冲区大小
-        size_t max_to_read = *length - received;
-        size_t to_read = (max_to_read < available) ? max_to_read : available;
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        if (left_us <= 0) {
+            break;
+        }
         
-        int read_bytes = uart_read_bytes(UART_PORT, frame + received, to_read, pdMS_TO_TICKS(10));
+        uart_event_t event;
+        if (xQueueReceive(uart_queue, &event, pdMS_TO_TICKS((left_us + 999) / 1000) + 1) != pdTRUE) {
+            break;
+        }
         
-        if (read_bytes > 0) {
-            received += read_bytes;
-            
-            // 如果我们有足够的头部信息，计算期望的总长度
-            if (!header_received && received >= 3) {
-                if (frame[1] == 0x03) {  // 读保持寄存器响应
-                    expected_length = 3 + frame[2] + 2;  // 地址+功能码+长度字节+数据+CRC
-                    header_received = true;
-                    ESP_LOGD(TAG, "📏 Expected response length: %d bytes", (int)expected_length);
+        switch (event.type) {
+        case UART_DATA: {
+            size_t available = 0;
+            uart_get_buffered_data_len(UART_PORT, &available);
+            size_t max_to_read = *length - received;
+            size_t to_read = (max_to_read < available) ? max_to_read : available;
+            if (to_read > 0) {
+                int read_bytes = uart_read_bytes(UART_PORT, frame + received, to_read, 0);
+                if (read_bytes > 0) {
+                    // 数据事件在FIFO达到阈值或接收超时时产生，首字节时间最多偏晚t3.5
+                    if (received == 0) {
+                        link_first_byte_us = esp_timer_get_time();
+                    }
+                    received += read_bytes;
+                    link_rx_bytes += read_bytes;
                 }
             }
-            
-            // 如果我们知道期望长度并且已经收到足够数据，就完成
-            if (header_received && received >= expected_length) {
-                ESP_LOGD(TAG, "📥 Complete frame received: %d bytes", (int)received);
-                break;
+            // 接收超时事件表示线路已静默t3.5
+            if (event.timeout_flag && received > 0) {
+                frame_end = true;
             }
+            break;
         }
-        
-        // 防止无限循环
-        if (received >= *length) {
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            ESP_LOGW(TAG, "UART RX overflow, frame dropped");
+            link_overflow = true;
+            uart_flush_input(UART_PORT);
+            xQueueReset(uart_queue);
+            *length = 0;
+            return false;
+        default:
             break;
         }
     }
     
+    if (received == 0) {
+        ESP_LOGW(TAG, "Receive timeout, no data received");
+    } else if (!frame_end && received < expectedResponseLength(frame, received)) {
+        ESP_LOGD(TAG, "📥 Received %d bytes before timeout: %02X %02X %02X %02X %02X %02X %02X %02X %02X", 
+                 (int)received,
+                 received > 0 ? frame[0] : 0, received > 1 ? frame[1] : 0,
+                 received > 2 ? frame[2] : 0, received > 3 ? frame[3] : 0,
+                 received > 4 ? frame[4] : 0, received > 5 ? frame[5] : 0,
+                 received > 6 ? frame[6] : 0, received > 7 ? frame[7] : 0,
+                 received > 8 ? frame[8] : 0);
+    }
+    
     *length = received;
     return received > 0;
 }
 
 bool ModbusController::readHoldingRegisters(uint16_t start_addr, uint16_t count, uint16_t* data) {
+    return readRegisters(DEVICE_ADDRESS, start_addr, count, data, RESPONSE_TIMEOUT_MS);
+}
+
+bool ModbusController::readRegisters(uint8_t slave, uint16_t start_addr, uint16_t count, uint16_t* data,
+                                     uint32_t timeout_ms) {
     if (!is_initialized) {
         ESP_LOGE(TAG, "Not initialized");
         return false;
@@ -242,10 +379,11 @@ bool ModbusController::readHoldingRegisters(uint16_t start_addr, uint16_t count,
     }
     
     bool success = false;
+    LinkResult result = LINK_TX_ERROR;
     
     // 构建Modbus RTU请求帧
     uint8_t request[8];
-    request[0] = DEVICE_ADDRESS;        // 设备地址
+    request[0] = slave;                 // 设备地址
     request[1] = 0x03;                  // 功能码：读保持寄存器
     request[2] = (start_addr >> 8) & 0xFF;  // 起始地址高字节
     request[3] = start_addr & 0xFF;         // 起始地址低字节
@@ -253,7 +391,7 @@ bool ModbusController::readHoldingRegisters(uint16_t start_addr, uint16_t count,
     request[5] = count & 0xFF;              // 寄存器数量低字节
     
     // 计算并添加CRC
-    uint16_t crc = calculateCRC(request, 6);
+    uint16_t crc = crc16_modbus(request, 6);
     request[6] = crc & 0xFF;            // CRC低字节
     request[7] = (crc >> 8) & 0xFF;     // CRC高字节
     
@@ -263,16 +401,16 @@ bool ModbusController::readHoldingRegisters(uint16_t start_addr, uint16_t count,
         uint8_t response[256];
         size_t response_len = sizeof(response);
         
-        if (receiveModbusFrame(response, &response_len, RESPONSE_TIMEOUT_MS)) {
+        if (receiveModbusFrame(response, &response_len, timeout_ms)) {
             // 验证响应
             if (response_len >= 5 && 
-                response[0] == DEVICE_ADDRESS && 
+                response[0] == slave && 
                 response[1] == 0x03 && 
                 response[2] == count * 2) {
                 
                 // 验证CRC
                 uint16_t received_crc = (response[response_len - 1] << 8) | response[response_len - 2];
-                uint16_t calculated_crc = calculateCRC(response, response_len - 2);
+                uint16_t calculated_crc = crc16_modbus(response, response_len - 2);
                 
                 if (received_crc == calculated_crc) {
                     // 提取数据
@@ -280,22 +418,31 @@ bool ModbusController::readHoldingRegisters(uint16_t start_addr, uint16_t count,
                         data[i] = (response[3 + i * 2] << 8) | response[4 + i * 2];
                     }
                     success = true;
+                    result = LINK_OK;
                 } else {
                     ESP_LOGE(TAG, "CRC mismatch in response");
+                    result = LINK_CRC_ERROR;
                 }
             } else {
                 ESP_LOGE(TAG, "Invalid response format");
+                result = LINK_INVALID_FRAME;
             }
         } else {
-            ESP_LOGE(TAG, "No response received");
+            ESP_LOGE(TAG, "No response received from slave %d", slave);
+            result = link_overflow ? LINK_OVERFLOW : LINK_TIMEOUT;
         }
     }
+    recordTransaction(result, sizeof(request));
     
     xSemaphoreGive(modbus_mutex);
     return success;
 }
 
 bool ModbusController::writeSingleRegister(uint16_t addr, uint16_t value) {
+    return writeRegister(DEVICE_ADDRESS, addr, value);
+}
+
+bool ModbusController::writeRegister(uint8_t slave, uint16_t addr, uint16_t value) {
     if (!is_initialized) {
         ESP_LOGE(TAG, "Not initialized");
         return false;
@@ -308,10 +455,11 @@ bool ModbusController::writeSingleRegister(uint16_t addr, uint16_t value) {
     }
     
     bool success = false;
+    LinkResult result = LINK_TX_ERROR;
     
     // 构建Modbus RTU请求帧
     uint8_t request[8];
-    request[0] = DEVICE_ADDRESS;        // 设备地址
+    request[0] = slave;                 // 设备地址
     request[1] = 0x06;                  // 功能码：写单个寄存器
     request[2] = (addr >> 8) & 0xFF;    // 寄存器地址高字节
     request[3] = addr & 0xFF;           // 寄存器地址低字节
@@ -319,7 +467,7 @@ bool ModbusController::writeSingleRegister(uint16_t addr, uint16_t value) {
     request[5] = value & 0xFF;          // 寄存器值低字节
     
     // 计算并添加CRC
-    uint16_t crc = calculateCRC(request, 6);
+    uint16_t crc = crc16_modbus(request, 6);
     request[6] = crc & 0xFF;            // CRC低字节
     request[7] = (crc >> 8) & 0xFF;     // CRC高字节
     
@@ -333,69 +481,600 @@ bool ModbusController::writeSingleRegister(uint16_t addr, uint16_t value) {
             // 验证响应（写单个寄存器的响应应该是请求的回显）
             if (response_len == 8 && memcmp(request, response, 8) == 0) {
                 success = true;
+                result = LINK_OK;
+            } else if (response_len == 8 &&
+                       crc16_modbus(response, 6) != ((response[7] << 8) | response[6])) {
+                ESP_LOGE(TAG, "CRC mismatch in write response");
+                result = LINK_CRC_ERROR;
             } else {
                 ESP_LOGE(TAG, "Invalid write response");
+                result = LINK_INVALID_FRAME;
             }
         } else {
-            ESP_LOGE(TAG, "No write response received");
+            ESP_LOGE(TAG, "No write response received from slave %d", slave);
+            result = link_overflow ? LINK_OVERFLOW : LINK_TIMEOUT;
         }
     }
+    recordTransaction(result, sizeof(request));
     
     xSemaphoreGive(modbus_mutex);
     return success;
 }
 
-bool ModbusController::readAllDeviceData() {
-    // 读取所有测量值寄存器 (0x0000-0x0005)
-    uint16_t reg_data[6];
-    if (!readHoldingRegisters(REG_V_SET, 6, reg_data)) {
-        ESP_LOGE(TAG, "Failed to read measurement registers");
-        device_data.data_valid = false;
+bool ModbusController::writeMultipleRegisters(uint16_t addr, const uint16_t* values, uint16_t count) {
+    return writeRegisters(DEVICE_ADDRESS, addr, values, count);
+}
+
+bool ModbusController::writeRegisters(uint8_t slave, uint16_t addr, const uint16_t* values, uint16_t count) {
+    if (!is_initialized) {
+        ESP_LOGE(TAG, "Not initialized");
+        return false;
+    }
+    if (count == 0 || count > MAX_WRITE_REGISTERS) {
         return false;
     }
     
-    // 转换测量值 (根据XY6506S手册寄存器映射)
-    device_data.set_voltage = reg_data[0] / 100.0f;     // 0x0000: V-SET
-    device_data.set_current = reg_data[1] / 1000.0f;    // 0x0001: I-SET  
-    device_data.output_voltage = reg_data[2] / 100.0f;  // 0x0002: VOUT
-    device_data.output_current = reg_data[3] / 1000.0f; // 0x0003: IOUT
-    device_data.output_power = reg_data[4] / 100.0f;    // 0x0004: POWER
-    device_data.input_voltage = reg_data[5] / 100.0f;   // 0x0005: UIN
-    
-    // 读取控制状态寄存器
-    uint16_t key_lock, sleep_mode, output_switch, beep_switch;
-    
-    bool all_ok = true;
-    all_ok &= readHoldingRegisters(REG_LOCK, 1, &key_lock);
-    all_ok &= readHoldingRegisters(REG_SLEEP, 1, &sleep_mode);
-    all_ok &= readHoldingRegisters(REG_ONOFF, 1, &output_switch);
-    all_ok &= readHoldingRegisters(REG_BUZZER, 1, &beep_switch);
-    
-    if (all_ok) {
-        device_data.key_lock = (key_lock != 0);
-        device_data.sleep_mode = (sleep_mode != 0);
-        device_data.output_switch = (output_switch != 0);
-        device_data.beep_switch = (beep_switch != 0);
+    // 快速互斥锁等待时间，避免异步任务阻塞
+    if (xSemaphoreTake(modbus_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+        ESP_LOGD(TAG, "Mutex busy, skipping this write cycle");
+        return false;
+    }
+    
+    bool success = false;
+    LinkResult result = LINK_TX_ERROR;
+    
+    // 构建Modbus RTU请求帧
+    uint8_t request[9 + MAX_WRITE_REGISTERS * 2];
+    request[0] = slave;                 // 设备地址
+    request[1] = 0x10;                  // 功能码：写多个寄存器
+    request[2] = (addr >> 8) & 0xFF;    // 起始地址高字节
+    request[3] = addr & 0xFF;           // 起始地址低字节
+    request[4] = (count >> 8) & 0xFF;   // 寄存器数量高字节
+    request[5] = count & 0xFF;          // 寄存器数量低字节
+    request[6] = count * 2;             // 数据字节数
+    for (uint16_t i = 0; i < count; i++) {
+        request[7 + i * 2] = (values[i] >> 8) & 0xFF;
+        request[8 + i * 2] = values[i] & 0xFF;
+    }
+    
+    // 计算并添加CRC
+    size_t request_len = 7 + count * 2;
+    uint16_t crc = crc16_modbus(request, request_len);
+    request[request_len++] = crc & 0xFF;            // CRC低字节
+    request[request_len++] = (crc >> 8) & 0xFF;     // CRC高字节
+    
+    // 发送请求
+    if (sendModbusFrame(request, request_len)) {
+        // 接收响应
+        uint8_t response[8];
+        size_t response_len = sizeof(response);
+        
+        if (receiveModbusFrame(response, &response_len, RESPONSE_TIMEOUT_MS)) {
+            // 验证响应（回显地址、起始地址和数量）
+            bool crc_ok = response_len == 8 && crc16_modbus(response, 6) == ((response[7] << 8) | response[6]);
+            if (crc_ok && memcmp(request, response, 6) == 0) {
+                success = true;
+                result = LINK_OK;
+            } else if (response_len == 8 && !crc_ok) {
+                ESP_LOGE(TAG, "CRC mismatch in write response");
+                result = LINK_CRC_ERROR;
+            } else {
+                ESP_LOGE(TAG, "Invalid write response");
+                result = LINK_INVALID_FRAME;
+            }
+        } else {
+            ESP_LOGE(TAG, "No write response received from slave %d", slave);
+            result = link_overflow ? LINK_OVERFLOW : LINK_TIMEOUT;
+        }
+    }
+    recordTransaction(result, request_len);
+    
+    xSemaphoreGive(modbus_mutex);
+    return success;
+}
+
+bool ModbusWriteTransaction::set(uint16_t addr, uint16_t value) {
+    uint8_t pos = 0;
+    
+    while (pos < count && addrs[pos] < addr) {
+        pos++;
+    }
+    if (pos < count && addrs[pos] == addr) {
+        values[pos] = value;
+        return true;
+    }
+    if (count >= MAX_REGISTERS) {
+        return false;
+    }
+    
+    // 按地址插入，发出时相邻的寄存器才能合并
+    memmove(&addrs[pos + 1], &addrs[pos], (count - pos) * sizeof(uint16_t));
+    memmove(&values[pos + 1], &values[pos], (count - pos) * sizeof(uint16_t));
+    addrs[pos] = addr;
+    values[pos] = value;
+    count++;
+    
+    return true;
+}
+
+bool ModbusController::writeTransaction(uint8_t slave, const ModbusWriteTransaction& transaction) {
+    bool success = true;
+    
+    // 每段相邻的寄存器一帧，比逐个0x06写入少了往返和帧间隔
+    for (uint8_t i = 0; i < transaction.count && success;) {
+        uint8_t run = 1;
+        while (i + run < transaction.count && transaction.addrs[i + run] == transaction.addrs[i] + run) {
+            run++;
+        }
+        if (run == 1) {
+            success = writeRegister(slave, transaction.addrs[i], transaction.values[i]);
+        } else {
+            success = writeRegisters(slave, transaction.addrs[i], &transaction.values[i], run);
+        }
+        i += run;
+    }
+    
+    return success;
+}
+
+bool ModbusController::submitWrite(uint8_t slave, const ModbusWriteTransaction& transaction, ModbusDoneCallback cb,
+                                   void* user_ctx) {
+    if (!is_initialized || worker_task == nullptr) {
+        ESP_LOGE(TAG, "Not initialized");
+        return false;
+    }
+    if (transaction.count == 0) {
+        return false;
+    }
+    
+    bool queued = false;
+    size_t addrs_size = transaction.count * sizeof(uint16_t);
+    taskENTER_CRITICAL(&request_lock);
+    // 同一组寄存器的写请求还未发出时只更新写入值，设备只需写一次最新值
+    for (size_t i = 0; i < MAX_PENDING_WRITES; i++) {
+        PendingWrite &write = pending_writes[i];
+        if (write.used && write.slave == slave && write.registers.count == transaction.count &&
+            memcmp(write.registers.addrs, transaction.addrs, addrs_size) == 0 &&
+            (write.cb == nullptr || (write.cb == cb && write.user_ctx == user_ctx))) {
+            write.registers = transaction;
+            write.cb = cb;
+            write.user_ctx = user_ctx;
+            queued = true;
+            break;
+        }
+    }
+    for (size_t i = 0; !queued && i < MAX_PENDING_WRITES; i++) {
+        PendingWrite &write = pending_writes[i];
+        if (!write.used) {
+            write.used = true;
+            write.seq = write_seq++;
+            write.slave = slave;
+            write.registers = transaction;
+            write.cb = cb;
+            write.user_ctx = user_ctx;
+            queued = true;
+        }
+    }
+    taskEXIT_CRITICAL(&request_lock);
+    
+    if (!queued) {
+        ESP_LOGW(TAG, "Write queue full, register 0x%04X of slave %d dropped", transaction.addrs[0], slave);
+        return false;
+    }
+    xTaskNotifyGive(worker_task);
+    
+    return true;
+}
+
+bool ModbusController::takeNextWrite(PendingWrite* write) {
+    PendingWrite *oldest = nullptr;
+    
+    taskENTER_CRITICAL(&request_lock);
+    for (size_t i = 0; i < MAX_PENDING_WRITES; i++) {
+        PendingWrite &pending = pending_writes[i];
+        if (pending.used && (oldest == nullptr || (int32_t)(pending.seq - oldest->seq) < 0)) {
+            oldest = &pending;
+        }
+    }
+    if (oldest != nullptr) {
+        *write = *oldest;
+        oldest->used = false;
+    }
+    taskEXIT_CRITICAL(&request_lock);
+    
+    return oldest != nullptr;
+}
+
+void ModbusController::failPendingRequests() {
+    PendingWrite write;
+    while (takeNextWrite(&write)) {
+        if (write.cb) {
+            write.cb(false, write.user_ctx);
+        }
+    }
+    
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        taskENTER_CRITICAL(&request_lock);
+        ModbusDoneCallback cb = devices[i].poll_cb;
+        void* ctx = devices[i].poll_ctx;
+        devices[i].poll_cb = nullptr;
+        devices[i].poll_ctx = nullptr;
+        taskEXIT_CRITICAL(&request_lock);
         
-        device_data.data_valid = true;
-        device_data.last_update_ms = esp_timer_get_time() / 1000;
+        if (cb) {
+            cb(false, ctx);
+        }
+    }
+}
+
+ModbusController::ModbusDevice* ModbusController::findDevice(uint8_t address) {
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i].used && devices[i].address == address) {
+            return &devices[i];
+        }
+    }
+    
+    return nullptr;
+}
+
+void ModbusController::schedulePoll(ModbusDevice* device, bool success, bool changed) {
+    uint32_t interval = device->interval_ms;
+    
+    if (success) {
+        device->fail_count = 0;
+        device->online = true;
+        // 数据变化时保持最快，不变时逐步放慢，把总线留给变化的从机
+        interval = changed ? POLL_INTERVAL_MIN_MS : interval * 2;
+        if (interval > POLL_INTERVAL_MAX_MS) {
+            interval = POLL_INTERVAL_MAX_MS;
+        }
+    } else {
+        if (device->fail_count < 0xFF) {
+            device->fail_count++;
+        }
+        if (device->fail_count >= OFFLINE_FAIL_COUNT) {
+            if (device->online) {
+                ESP_LOGW(TAG, "Slave %d is offline", device->address);
+            }
+            device->online = false;
+        }
+        // 离线的从机每次超时都占用总线，指数退避
+        interval = interval * 2;
+        if (interval > OFFLINE_RETRY_MAX_MS) {
+            interval = OFFLINE_RETRY_MAX_MS;
+        }
+    }
+    if (interval < POLL_INTERVAL_MIN_MS) {
+        interval = POLL_INTERVAL_MIN_MS;
+    }
+    
+    taskENTER_CRITICAL(&request_lock);
+    // 记录采样时在线的从机按固定间隔轮询
+    if (success && sample_interval_ms != 0) {
+        interval = sample_interval_ms;
+    }
+    device->interval_ms = interval;
+    // 轮询期间有新的请求时保留立即轮询
+    if (device->next_poll_us != 0) {
+        device->next_poll_us = esp_timer_get_time() + (int64_t)interval * 1000;
+    }
+    taskEXIT_CRITICAL(&request_lock);
+}
+
+uint32_t ModbusController::runTransactions() {
+    while (worker_running) {
+        // 协商期间其他波特率下的事务都会失败，先于所有请求完成
+        if (baud_negotiation_pending) {
+            baud_negotiation_pending = false;
+            negotiateBaudRate();
+            continue;
+        }
         
-        ESP_LOGD(TAG, "📊 Device data: V=%.2fV, I=%.3fA, P=%.2fW, Vin=%.2fV, Vset=%.2fV, Iset=%.3fA", 
-                 device_data.output_voltage, device_data.output_current, device_data.output_power,
-                 device_data.input_voltage, device_data.set_voltage, device_data.set_current);
+        // 每个事务之前都先检查写请求，用户操作不必等待轮询
+        PendingWrite write;
+        if (takeNextWrite(&write)) {
+            bool success = writeTransaction(write.slave, write.registers);
+            // 写入后尽快回读，界面显示设备的实际值
+            ModbusDevice* device = findDevice(write.slave);
+            if (device) {
+                taskENTER_CRITICAL(&request_lock);
+                device->interval_ms = POLL_INTERVAL_MIN_MS;
+                device->next_poll_us = esp_timer_get_time();
+                taskEXIT_CRITICAL(&request_lock);
+            }
+            if (write.cb) {
+                write.cb(success, write.user_ctx);
+            }
+            continue;
+        }
         
-        ESP_LOGD(TAG, "🎛️ Switch states from device: Power=%s, Beep=%s, KeyLock=%s, Sleep=%s",
-                 device_data.output_switch ? "ON" : "OFF",
-                 device_data.beep_switch ? "ON" : "OFF", 
-                 device_data.key_lock ? "LOCKED" : "UNLOCKED",
-                 device_data.sleep_mode ? "ON" : "OFF");
+        // 到期的从机中最早的一个，各从机依次轮到
+        int64_t now = esp_timer_get_time();
+        ModbusDevice* due = nullptr;
+        int64_t next_us = INT64_MAX;
+        ModbusDoneCallback cb = nullptr;
+        void* ctx = nullptr;
+        ModbusSampleCallback sample = nullptr;
+        void* sample_user_ctx = nullptr;
+        taskENTER_CRITICAL(&request_lock);
+        for (size_t i = 0; i < MAX_DEVICES; i++) {
+            ModbusDevice &device = devices[i];
+            if (!device.used) {
+                continue;
+            }
+            if (device.next_poll_us <= now && (due == nullptr || device.next_poll_us < due->next_poll_us)) {
+                due = &device;
+            }
+            if (device.next_poll_us < next_us) {
+                next_us = device.next_poll_us;
+            }
+        }
+        if (due) {
+            cb = due->poll_cb;
+            ctx = due->poll_ctx;
+            due->poll_cb = nullptr;
+            due->poll_ctx = nullptr;
+            due->next_poll_us = now + (int64_t)due->interval_ms * 1000;
+            sample = sample_cb;
+            sample_user_ctx = sample_ctx;
+        }
+        taskEXIT_CRITICAL(&request_lock);
+        
+        if (due) {
+            if (due->fail_count > 0) {
+                taskENTER_CRITICAL(&stats_lock);
+                link_stats.retries++;
+                taskEXIT_CRITICAL(&stats_lock);
+            }
+            uint16_t previous[REG_BUZZER + 1];
+            memcpy(previous, due->register_image, sizeof(previous));
+            bool success = readDeviceData(due);
+            schedulePoll(due, success, memcmp(previous, due->register_image, sizeof(previous)) != 0);
+            if (success && sample) {
+                sample(due->address, due->data, sample_user_ctx);
+            }
+            if (cb) {
+                cb(success, ctx);
+            }
+            continue;
+        }
+        
+        // 空闲时探测一个地址，发现过程不会推迟已知从机的轮询
+        if (discovery_active) {
+            uint8_t address = discovery_next++;
+            if (findDevice(address) == nullptr && probeDevice(address)) {
+                addDevice(address);
+                discovery_found++;
+            }
+            if (address >= discovery_last) {
+                discovery_active = false;
+                ESP_LOGI(TAG, "Discovery completed, %d new slave(s)", discovery_found);
+                xSemaphoreGive(discovery_done);
+            }
+            continue;
+        }
         
+        int64_t wait_us = next_us - now;
+        if (wait_us < 1000) {
+            return 1;
+        }
+        return (uint32_t)((wait_us + 999) / 1000);
+    }
+    
+    return 0;
+}
+
+void ModbusController::workerTask(void* arg) {
+    ModbusController* controller = (ModbusController*)arg;
+    
+    while (controller->worker_running) {
+        uint32_t wait_ms = controller->runTransactions();
+        // 睡到下一台从机到期，新的请求会提前唤醒
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms) + 1);
+    }
+    
+    ESP_LOGI(TAG, "Modbus worker exit");
+    xSemaphoreGive(controller->worker_exit);
+    task_config_delete(TASK_CONFIG_MODBUS_WORKER, NULL);
+}
+
+bool ModbusController::requestPoll(ModbusDoneCallback cb, void* user_ctx, uint8_t slave) {
+    if (!is_initialized || worker_task == nullptr) {
+        return false;
+    }
+    
+    ModbusDevice* device = findDevice(slave);
+    if (device == nullptr) {
+        return false;
+    }
+    
+    taskENTER_CRITICAL(&request_lock);
+    device->next_poll_us = 0;
+    device->poll_cb = cb;
+    device->poll_ctx = user_ctx;
+    taskEXIT_CRITICAL(&request_lock);
+    xTaskNotifyGive(worker_task);
+    
+    return true;
+}
+
+void ModbusController::setSampleSink(ModbusSampleCallback cb, void* user_ctx, uint32_t interval_ms) {
+    taskENTER_CRITICAL(&request_lock);
+    sample_cb = cb;
+    sample_ctx = user_ctx;
+    sample_interval_ms = interval_ms;
+    taskEXIT_CRITICAL(&request_lock);
+    if (worker_task) {
+        xTaskNotifyGive(worker_task);
+    }
+}
+
+bool ModbusController::addDevice(uint8_t address) {
+    if (address < 1 || address > 247) {
+        return false;
+    }
+    if (findDevice(address) != nullptr) {
         return true;
-    } else {
-        ESP_LOGE(TAG, "Failed to read control registers");
-        device_data.data_valid = false;
+    }
+    
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        ModbusDevice &device = devices[i];
+        if (!device.used) {
+            memset(&device, 0, sizeof(device));
+            device.address = address;
+            device.online = true;
+            device.interval_ms = POLL_INTERVAL_MIN_MS;
+            // 新从机立即轮询一次
+            device.next_poll_us = esp_timer_get_time();
+            device.used = true;
+            ESP_LOGI(TAG, "Slave %d added to polling", address);
+            if (worker_task) {
+                xTaskNotifyGive(worker_task);
+            }
+            return true;
+        }
+    }
+    
+    ESP_LOGW(TAG, "No room for slave %d", address);
+    return false;
+}
+
+bool ModbusController::startDiscovery(uint8_t first_addr, uint8_t last_addr) {
+    if (!is_initialized || worker_task == nullptr || first_addr < 1 || last_addr > 247 || first_addr > last_addr) {
         return false;
     }
+    if (discovery_active) {
+        return true;
+    }
+    
+    xSemaphoreTake(discovery_done, 0);
+    discovery_next = first_addr;
+    discovery_last = last_addr;
+    discovery_found = 0;
+    discovery_active = true;
+    xTaskNotifyGive(worker_task);
+    
+    return true;
+}
+
+size_t ModbusController::getDeviceCount() const {
+    size_t count = 0;
+    
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i].used) {
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+const PowerDeviceData* ModbusController::getDeviceDataByAddress(uint8_t address) const {
+    for (size_t i = 0; i < MAX_DEVICES; i++) {
+        if (devices[i].used && devices[i].address == address) {
+            return &devices[i].data;
+        }
+    }
+    
+    return nullptr;
+}
+
+bool ModbusController::addVoltageAndCurrent(ModbusWriteTransaction* transaction, float voltage, float current,
+                                            uint8_t slave) const {
+    const PowerDeviceData* data = getDeviceDataByAddress(slave);
+    if (data == nullptr) {
+        ESP_LOGE(TAG, "Slave %d not added", slave);
+        return false;
+    }
+    // 电压上限取决于该从机的输入电压
+    bool voltage_ok = (voltage >= 0.0f && voltage <= data->input_voltage && data->input_voltage > 0.0f);
+    if (!voltage_ok || !validateCurrent(current)) {
+        ESP_LOGE(TAG, "Invalid voltage (%.2fV) or current (%.3fA) value", voltage, current);
+        return false;
+    }
+    
+    // REG_V_SET和REG_I_SET相邻，发出时合并为一帧0x10写入
+    // 四舍五入，3.3V等值乘100后可能略小于整数
+    ModbusWriteTransaction added = *transaction;
+    if (!added.set(REG_V_SET, (uint16_t)(voltage * 100 + 0.5f)) ||
+        !added.set(REG_I_SET, (uint16_t)(current * 1000 + 0.5f))) {
+        return false;
+    }
+    *transaction = added;
+    
+    return true;
+}
+
+bool ModbusController::submitTransaction(const ModbusWriteTransaction& transaction, ModbusDoneCallback cb,
+                                         void* user_ctx, uint8_t slave) {
+    return submitWrite(slave, transaction, cb, user_ctx);
+}
+
+bool ModbusController::setVoltageAndCurrentAsync(float voltage, float current, ModbusDoneCallback cb,
+                                                 void* user_ctx, uint8_t slave) {
+    ModbusWriteTransaction transaction = {};
+    if (!addVoltageAndCurrent(&transaction, voltage, current, slave)) {
+        return false;
+    }
+    
+    return submitWrite(slave, transaction, cb, user_ctx);
+}
+
+bool ModbusController::setSwitchAsync(uint16_t reg, bool enable, ModbusDoneCallback cb, void* user_ctx,
+                                      uint8_t slave) {
+    ModbusWriteTransaction transaction = {};
+    transaction.set(reg, enable ? 1 : 0);
+    return submitWrite(slave, transaction, cb, user_ctx);
+}
+
+bool ModbusController::readAllDeviceData() {
+    return readDeviceData(&devices[0]);
+}
+
+bool ModbusController::readDeviceData(ModbusDevice* device) {
+    PowerDeviceData &device_data = device->data;
+    uint16_t *register_image = device->register_image;
+    
+    // 按轮询计划读取，XY6506S只需一次0x0000-0x001C的读取
+    for (size_t i = 0; i < poll_block_count; i++) {
+        const PollBlock &block = poll_blocks[i];
+        if (!readRegisters(device->address, block.start, block.count, &register_image[block.start],
+                           RESPONSE_TIMEOUT_MS)) {
+            ESP_LOGE(TAG, "Failed to read registers 0x%04X-0x%04X of slave %d", block.start,
+                     block.start + block.count - 1, device->address);
+            device_data.data_valid = false;
+            return false;
+        }
+    }
+    
+    // 转换测量值 (根据XY6506S手册寄存器映射)
+    device_data.set_voltage = register_image[REG_V_SET] / 100.0f;
+    device_data.set_current = register_image[REG_I_SET] / 1000.0f;
+    device_data.output_voltage = register_image[REG_VOUT] / 100.0f;
+    device_data.output_current = register_image[REG_IOUT] / 1000.0f;
+    device_data.output_power = register_image[REG_POWER] / 100.0f;
+    device_data.input_voltage = register_image[REG_UIN] / 100.0f;
+    
+    // 控制状态寄存器
+    device_data.key_lock = (register_image[REG_LOCK] != 0);
+    device_data.sleep_mode = (register_image[REG_SLEEP] != 0);
+    device_data.output_switch = (register_image[REG_ONOFF] != 0);
+    device_data.beep_switch = (register_image[REG_BUZZER] != 0);
+    
+    device_data.data_valid = true;
+    device_data.last_update_ms = esp_timer_get_time() / 1000;
+    
+    ESP_LOGD(TAG, "📊 Slave %d data: V=%.2fV, I=%.3fA, P=%.2fW, Vin=%.2fV, Vset=%.2fV, Iset=%.3fA", 
+             device->address, device_data.output_voltage, device_data.output_current, device_data.output_power,
+             device_data.input_voltage, device_data.set_voltage, device_data.set_current);
+    
+    ESP_LOGD(TAG, "🎛️ Switch states from device: Power=%s, Beep=%s, KeyLock=%s, Sleep=%s",
+             device_data.output_switch ? "ON" : "OFF",
+             device_data.beep_switch ? "ON" : "OFF", 
+             device_data.key_lock ? "LOCKED" : "UNLOCKED",
+             device_data.sleep_mode ? "ON" : "OFF");
+    
+    return true;
 }
 
 bool ModbusController::setVoltageAndCurrent(float voltage, float current) {
@@ -405,14 +1084,12 @@ bool ModbusController::setVoltageAndCurrent(float voltage, float current) {
     }
     
     // 转换为寄存器值
-    uint16_t voltage_reg = (uint16_t)(voltage * 100);
-    uint16_t current_reg = (uint16_t)(current * 1000);
+    uint16_t voltage_reg = (uint16_t)(voltage * 100 + 0.5f);
+    uint16_t current_reg = (uint16_t)(current * 1000 + 0.5f);
     
-    // 先写电压，再写电流
-    bool success = writeSingleRegister(REG_V_SET, voltage_reg);
-    if (success) {
-        success = writeSingleRegister(REG_I_SET, current_reg);
-    }
+    // REG_V_SET和REG_I_SET相邻，一帧0x10写入
+    uint16_t values[2] = {voltage_reg, current_reg};
+    bool success = writeMultipleRegisters(REG_V_SET, values, 2);
     
     if (success) {
         ESP_LOGI(TAG, "Set voltage: %.2fV, current: %.3fA", voltage, current);
@@ -468,6 +1145,7 @@ bool ModbusController::setSleepMode(bool enable) {
 }
 
 bool ModbusController::validateVoltage(float voltage) const {
+    const PowerDeviceData &device_data = devices[0].data;
     return (voltage >= 0.0f && voltage <= device_data.input_voltage && device_data.input_voltage > 0.0f);
 }
 
@@ -476,62 +1154,337 @@ bool ModbusController::validateCurrent(float current) const {
 }
 
 bool ModbusController::isCommunicationOk() const {
+    const PowerDeviceData &device_data = devices[0].data;
     uint32_t current_ms = esp_timer_get_time() / 1000;
     return device_data.data_valid && (current_ms - device_data.last_update_ms < 5000);
 }
 
-bool ModbusController::scanForDevices() {
-    ESP_LOGI(TAG, "🔍 Scanning for Modbus devices...");
+size_t ModbusController::linkHistogramBin(uint32_t us) {
+    size_t bin = 0;
     
-    if (!is_initialized) {
-        ESP_LOGE(TAG, "Not initialized");
+    while (bin < ModbusLinkStats::HIST_BINS - 1 && us >= LINK_HIST_EDGES_US[bin]) {
+        bin++;
+    }
+    
+    return bin;
+}
+
+void ModbusController::recordTransaction(LinkResult result, size_t tx_bytes) {
+    int64_t now = esp_timer_get_time();
+    uint32_t complete_us = (uint32_t)(now - link_tx_start_us);
+    uint32_t first_byte_us = link_first_byte_us ? (uint32_t)(link_first_byte_us - link_tx_start_us) : 0;
+    
+    taskENTER_CRITICAL(&stats_lock);
+    ModbusLinkStats &stats = link_stats;
+    stats.transactions++;
+    stats.tx_bytes += (result == LINK_TX_ERROR) ? 0 : tx_bytes;
+    stats.rx_bytes += link_rx_bytes;
+    switch (result) {
+    case LINK_OK:
+        stats.ok++;
+        // 只有成功的事务计入延迟，超时的耗时就是超时时间
+        stats.complete_hist[linkHistogramBin(complete_us)]++;
+        if (complete_us > stats.complete_max_us) {
+            stats.complete_max_us = complete_us;
+        }
+        break;
+    case LINK_TIMEOUT:
+        stats.timeouts++;
+        break;
+    case LINK_CRC_ERROR:
+        stats.crc_errors++;
+        break;
+    case LINK_INVALID_FRAME:
+        stats.invalid_frames++;
+        break;
+    case LINK_OVERFLOW:
+        stats.overflows++;
+        break;
+    case LINK_TX_ERROR:
+        stats.tx_errors++;
+        break;
+    }
+    if (link_first_byte_us) {
+        stats.first_byte_hist[linkHistogramBin(first_byte_us)]++;
+        if (first_byte_us > stats.first_byte_max_us) {
+            stats.first_byte_max_us = first_byte_us;
+        }
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void ModbusController::getLinkStats(ModbusLinkStats* stats) const {
+    taskENTER_CRITICAL(&stats_lock);
+    *stats = link_stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void ModbusController::resetLinkStats() {
+    taskENTER_CRITICAL(&stats_lock);
+    memset(&link_stats, 0, sizeof(link_stats));
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+uint32_t ModbusController::linkPercentileUs(const uint32_t* hist, uint32_t percent) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < ModbusLinkStats::HIST_BINS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    
+    // 第一个累计数达到目标的区间
+    uint64_t target = (total * percent + 99) / 100;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < ModbusLinkStats::HIST_BINS - 1; i++) {
+        sum += hist[i];
+        if (sum >= target) {
+            return LINK_HIST_EDGES_US[i];
+        }
+    }
+    
+    return UINT32_MAX;
+}
+
+bool ModbusController::probeDevice(uint8_t address) {
+    if (xSemaphoreTake(modbus_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
         return false;
     }
     
     bool found = false;
     
-    // 扫描常见的设备地址 1-10
-    for (uint8_t addr = 1; addr <= 10; addr++) {
-        ESP_LOGI(TAG, "Trying device address: 0x%02X (%d)", addr, addr);
+    // 构建测试请求 - 读取寄存器0x0000
+    uint8_t request[8];
+    request[0] = address;                   // 设备地址
+    request[1] = 0x03;                      // 功能码：读保持寄存器
+    request[2] = 0x00; request[3] = 0x00;   // 起始地址0x0000
+    request[4] = 0x00; request[5] = 0x01;   // 读取1个寄存器
+    
+    uint16_t crc = crc16_modbus(request, 6);
+    request[6] = crc & 0xFF;
+    request[7] = (crc >> 8) & 0xFF;
+    
+    if (sendModbusFrame(request, 8)) {
+        uint8_t response[8];
+        size_t response_len = sizeof(response);
         
-        // 构建测试请求 - 读取寄存器0x0000
-        uint8_t request[8];
-        request[0] = addr;                      // 设备地址
-        request[1] = 0x03;                      // 功能码：读保持寄存器
-        request[2] = 0x00; request[3] = 0x00;   // 起始地址0x0000
-        request[4] = 0x00; request[5] = 0x01;   // 读取1个寄存器
+        // 从机在几毫秒内响应，短超时让空地址不拖慢发现
+        if (receiveModbusFrame(response, &response_len, DISCOVERY_TIMEOUT_MS) && response_len == 7 &&
+            response[0] == address && response[1] == 0x03 &&
+            crc16_modbus(response, 5) == ((response[6] << 8) | response[5])) {
+            uint16_t reg_value = (response[3] << 8) | response[4];
+            ESP_LOGI(TAG, "✅ Device found at address %d (0x%02X), register 0x0000 = 0x%04X (%d)", 
+                     address, address, reg_value, reg_value);
+            found = true;
+        } else {
+            ESP_LOGD(TAG, "❌ No response from address 0x%02X (%d)", address, address);
+        }
+    }
+    
+    xSemaphoreGive(modbus_mutex);
+    return found;
+}
+
+bool ModbusController::probeLink(uint8_t slave) {
+    const uint16_t count = REG_BUZZER + 1;
+    
+    // 完整的寄存器块，长帧比单个寄存器更容易暴露位错误
+    uint8_t request[8];
+    request[0] = slave;
+    request[1] = 0x03;
+    request[2] = 0x00; request[3] = 0x00;
+    request[4] = (count >> 8) & 0xFF;
+    request[5] = count & 0xFF;
+    uint16_t crc = crc16_modbus(request, 6);
+    request[6] = crc & 0xFF;
+    request[7] = (crc >> 8) & 0xFF;
+    
+    for (uint8_t round = 0; round < BAUD_PROBE_ROUNDS; round++) {
+        if (xSemaphoreTake(modbus_mutex, pdMS_TO_TICKS(50)) != pdTRUE) {
+            return false;
+        }
         
-        uint16_t crc = calculateCRC(request, 6);
-        request[6] = crc & 0xFF;
-        request[7] = (crc >> 8) & 0xFF;
+        bool ok = false;
+        uint8_t response[5 + count * 2];
+        size_t response_len = sizeof(response);
+        if (sendModbusFrame(request, sizeof(request)) &&
+            receiveModbusFrame(response, &response_len, RESPONSE_TIMEOUT_MS) && response_len == sizeof(response) &&
+            response[0] == slave && response[1] == 0x03 && response[2] == count * 2 &&
+            crc16_modbus(response, response_len - 2) ==
+            ((response[response_len - 1] << 8) | response[response_len - 2])) {
+            ok = true;
+        }
         
-        if (sendModbusFrame(request, 8)) {
-            uint8_t response[256];
-            size_t response_len = sizeof(response);
-            
-            if (receiveModbusFrame(response, &response_len, 300)) {  // 300ms超时
-                if (response_len >= 5 && response[0] == addr && response[1] == 0x03) {
-                    uint16_t reg_value = (response[3] << 8) | response[4];
-                    ESP_LOGI(TAG, "✅ Device found at address %d (0x%02X), register 0x0000 = 0x%04X (%d)", 
-                             addr, addr, reg_value, reg_value);
-                    found = true;
-                } else {
-                    ESP_LOGD(TAG, "Invalid response format from address %d", addr);
-                }
-            } else {
-                ESP_LOGD(TAG, "❌ No response from address 0x%02X (%d)", addr, addr);
-            }
+        xSemaphoreGive(modbus_mutex);
+        if (!ok) {
+            ESP_LOGD(TAG, "Link probe %d failed at %d baud", round, (int)baud_rate);
+            return false;
         }
+    }
+    
+    return true;
+}
+
+bool ModbusController::applyBaudRate(uint32_t rate) {
+    // 不能打断正在进行的事务
+    if (xSemaphoreTake(modbus_mutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    
+    bool ok = (uart_set_baudrate(UART_PORT, rate) == ESP_OK);
+    if (ok) {
+        baud_rate = rate;
+        // t3.5随波特率变化，切换前残留的字节按旧波特率采样，丢弃
+        uart_set_rx_timeout(UART_PORT, frameGapSymbols());
+        uart_flush_input(UART_PORT);
+        xQueueReset(uart_queue);
+    }
+    
+    xSemaphoreGive(modbus_mutex);
+    return ok;
+}
+
+int ModbusController::findBaudRate(uint8_t slave) {
+    // 从高到低，从机多半在出厂默认的最高波特率
+    for (int i = BAUD_RATE_COUNT - 1; i >= 0; i--) {
+        if (applyBaudRate(BAUD_RATES[i].rate) && probeLink(slave)) {
+            ESP_LOGI(TAG, "Slave %d answers at %d baud", slave, (int)BAUD_RATES[i].rate);
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+void ModbusController::negotiateBaudRate() {
+    const uint8_t slave = DEVICE_ADDRESS;
+    int current = baudRateIndex(baud_rate);
+    
+    if (current < 0 || !probeLink(slave)) {
+        ESP_LOGW(TAG, "No link at %d baud, searching", (int)baud_rate);
+        current = findBaudRate(slave);
+        if (current < 0) {
+            ESP_LOGE(TAG, "Slave %d does not answer at any baud rate", slave);
+            applyBaudRate(UART_BAUD_RATE);
+            return;
+        }
+    }
+    
+    // 逐级升高，每一级都要通过探测
+    for (int next = current + 1; next < (int)BAUD_RATE_COUNT; next++) {
+        const BaudRate &from = BAUD_RATES[current];
+        const BaudRate &to = BAUD_RATES[next];
         
-        // 等待一小段时间再试下一个地址
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // 从机可能先切换再响应，写入的结果不作判断，以新波特率下的探测为准
+        writeRegister(slave, REG_BAUDRATE_L, to.code);
+        applyBaudRate(to.rate);
+        vTaskDelay(pdMS_TO_TICKS(BAUD_SETTLE_MS));
+        if (probeLink(slave)) {
+            current = next;
+            continue;
+        }
+        
+        // 退回上一级：新波特率下还能写入时让从机切回，没有切换的从机仍在原波特率
+        ESP_LOGW(TAG, "Link failed at %d baud, falling back to %d", (int)to.rate, (int)from.rate);
+        writeRegister(slave, REG_BAUDRATE_L, from.code);
+        applyBaudRate(from.rate);
+        vTaskDelay(pdMS_TO_TICKS(BAUD_SETTLE_MS));
+        if (!probeLink(slave)) {
+            current = findBaudRate(slave);
+            if (current < 0) {
+                ESP_LOGE(TAG, "Slave %d lost during baud negotiation", slave);
+                applyBaudRate(UART_BAUD_RATE);
+                return;
+            }
+        }
+        break;
+    }
+    
+    ESP_LOGI(TAG, "Baud rate negotiated: %d", (int)BAUD_RATES[current].rate);
+    saveBaudRate(BAUD_RATES[current].rate);
+}
+
+bool ModbusController::startBaudNegotiation() {
+    if (!is_initialized || worker_task == nullptr) {
+        return false;
     }
     
+    baud_negotiation_pending = true;
+    xTaskNotifyGive(worker_task);
+    
+    return true;
+}
+
+int ModbusController::baudRateIndex(uint32_t rate) {
+    for (size_t i = 0; i < BAUD_RATE_COUNT; i++) {
+        if (BAUD_RATES[i].rate == rate) {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+uint32_t ModbusController::loadBaudRate() {
+    nvs_handle_t handle;
+    uint32_t rate = UART_BAUD_RATE;
+    
+    if (nvs_open(BAUD_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        if (nvs_get_u32(handle, BAUD_NVS_KEY, &rate) != ESP_OK || baudRateIndex(rate) < 0) {
+            rate = UART_BAUD_RATE;
+        }
+        nvs_close(handle);
+    }
+    
+    return rate;
+}
+
+void ModbusController::saveBaudRate(uint32_t rate) {
+    nvs_handle_t handle;
+    uint32_t saved = 0;
+    
+    if (nvs_open(BAUD_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open NVS, baud rate not saved");
+        return;
+    }
+    // 每次启动都会协商，没有变化时不写flash
+    if (nvs_get_u32(handle, BAUD_NVS_KEY, &saved) != ESP_OK || saved != rate) {
+        if (nvs_set_u32(handle, BAUD_NVS_KEY, rate) != ESP_OK || nvs_commit(handle) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to save baud rate");
+        }
+    }
+    nvs_close(handle);
+}
+
+bool ModbusController::scanForDevices() {
+    ESP_LOGI(TAG, "🔍 Scanning for Modbus devices...");
+    
+    if (!is_initialized) {
+        ESP_LOGE(TAG, "Not initialized");
+        return false;
+    }
+    
+    // 扫描常见的设备地址 1-10，由工作任务穿插在轮询之间完成
+    const uint8_t first_addr = 1;
+    const uint8_t last_addr = 10;
+    if (!startDiscovery(first_addr, last_addr)) {
+        return false;
+    }
+    
+    // 每个地址最多一个探测超时，加上轮询占用的时间
+    uint32_t budget_ms = (last_addr - first_addr + 1) * (DISCOVERY_TIMEOUT_MS + RESPONSE_TIMEOUT_MS);
+    if (xSemaphoreTake(discovery_done, pdMS_TO_TICKS(budget_ms)) != pdTRUE) {
+        ESP_LOGW(TAG, "⚠️ Device scan still running after %d ms", (int)budget_ms);
+    }
+    
+    // 默认从机不在探测范围内，以它的轮询结果为准
+    bool found = (getDeviceCount() > 1) || devices[0].data.data_valid;
     if (found) {
-        ESP_LOGI(TAG, "🎉 Device scan completed - found one or more devices");
+        ESP_LOGI(TAG, "🎉 Device scan completed - %d device(s) on the bus", (int)getDeviceCount());
     } else {
         ESP_LOGW(TAG, "⚠️ Device scan completed - no devices found");
     }
     
     return found;
-}
\ No newline at end of file
+}
@@ -17,6 +17,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 
 /**
@@ -90,6 +91,60 @@ struct PowerDeviceData {
     uint32_t last_update_ms;   // 最后更新时间戳
 };
 
+/**
+ * @brief 异步事务完成回调，在Modbus工作任务中调用，不能直接操作LVGL
+ * @param success 事务是否成功
+ * @param user_ctx 提交时传入的上下文
+ */
+typedef void (*ModbusDoneCallback)(bool success, void* user_ctx);
+
+/**
+ * @brief 轮询数据回调，每次成功读取一台从机后在Modbus工作任务中调用，不能阻塞
+ * @param slave 从机地址
+ * @param data 读取的数据
+ * @param user_ctx 设置时传入的上下文
+ */
+typedef void (*ModbusSampleCallback)(uint8_t slave, const PowerDeviceData& data, void* user_ctx);
+
+/**
+ * @brief 一组寄存器写入，作为一个写事务提交
+ * @details 发出时地址相邻的寄存器合并为一帧0x10写入，单独的寄存器用0x06写入
+ */
+struct ModbusWriteTransaction {
+    static const uint8_t MAX_REGISTERS = 8;
+    uint8_t count;                          // 寄存器数量，清零后使用
+    uint16_t addrs[MAX_REGISTERS];          // 寄存器地址（升序）
+    uint16_t values[MAX_REGISTERS];         // 写入值
+    
+    /**
+     * @brief 加入一个寄存器，已加入的寄存器更新为新值
+     * @return true 已加入，false 寄存器已满
+     */
+    bool set(uint16_t addr, uint16_t value);
+};
+
+/**
+ * @brief 总线统计，只统计读写事务，不含发现从机时的探测
+ * @details 延迟从开始发送请求计时，直方图的区间上限见ModbusController::LINK_HIST_EDGES_US
+ */
+struct ModbusLinkStats {
+    static const size_t HIST_BINS = 10;
+    uint32_t transactions;              // 事务总数
+    uint32_t ok;                        // 成功
+    uint32_t timeouts;                  // 没有收到任何字节
+    uint32_t crc_errors;                // CRC错误
+    uint32_t invalid_frames;            // 地址、功能码或长度不符，含异常响应
+    uint32_t overflows;                 // 接收溢出
+    uint32_t tx_errors;                 // 发送失败
+    uint32_t retries;                   // 上一次失败后对同一从机的重试
+    uint64_t tx_bytes;                  // 发送的字节
+    uint64_t rx_bytes;                  // 接收的字节
+    uint32_t first_byte_hist[HIST_BINS];    // 请求到第一个字节
+    uint32_t complete_hist[HIST_BINS];      // 请求到响应完整
+    uint32_t first_byte_max_us;
+    uint32_t complete_max_us;
+};
+
 /**
  * @brief Modbus-RTU通信控制器类
  */
@@ -101,25 +156,160 @@ private:
     static const uart_port_t UART_PORT = UART_NUM_2;
     static const int UART_TX_PIN = 51;  // GPIO51 作为TX
     static const int UART_RX_PIN = 52;  // GPIO52 作为RX
-    static const int UART_BAUD_RATE = 115200;  // XY6506S出厂默认115200
+    static const int UART_BAUD_RATE = 115200;  // XY6506S出厂默认115200，协商前和NVS中没有记录时使用
     static const int UART_BUF_SIZE = 256;
+    static const int UART_EVENT_QUEUE_SIZE = 16;
+    static const uint32_t FRAME_GAP_MIN_US = 1750;  // 波特率高于19200时t3.5固定为1.75ms（Modbus规范）
     
     // Modbus配置
     static const uint8_t DEVICE_ADDRESS = 0x01;  // 设备地址
     static const uint32_t RESPONSE_TIMEOUT_MS = 200;   // 响应超时优化为200ms（快速响应）
     static const uint32_t MIN_FRAME_INTERVAL_MS = 1;   // 最小帧间隔优化为1ms（高速通信）
     
+    /**
+     * @brief 一次事务的结果
+     */
+    enum LinkResult {
+        LINK_OK = 0,
+        LINK_TIMEOUT,
+        LINK_CRC_ERROR,
+        LINK_INVALID_FRAME,
+        LINK_OVERFLOW,
+        LINK_TX_ERROR,
+    };
+    
+    // 轮询配置：一次请求的开销远大于多读几个寄存器，相近的寄存器合并为一次0x03读取
+    static const uint16_t POLL_REGISTERS[];            // readAllDeviceData需要的寄存器（地址升序）
+    static const uint16_t POLL_MAX_GAP = 16;           // 间隔不超过此数的寄存器合并到同一次读取
+    static const uint16_t MAX_READ_REGISTERS = 125;    // 功能码0x03单次最多读取的寄存器数
+    static const size_t MAX_POLL_BLOCKS = 8;           // 最多的读取块数
+    
+    /**
+     * @brief 一次连续读取的寄存器块
+     */
+    struct PollBlock {
+        uint16_t start;         // 起始地址
+        uint16_t count;         // 寄存器数量
+    };
+    
+    // 异步事务：写请求排在轮询之前，同一组寄存器的重复写入合并为最新值
+    static const size_t MAX_PENDING_WRITES = 8;        // 最多排队的写请求
+    static const uint16_t MAX_WRITE_REGISTERS = 123;   // 功能码0x10单次最多写入的寄存器数
+    static const uint32_t WORKER_EXIT_TIMEOUT_MS = 1000;
+    
+    /**
+     * @brief 排队的写请求
+     */
+    struct PendingWrite {
+        bool used;                          // 槽位是否占用
+        uint32_t seq;                       // 提交顺序
+        uint8_t slave;                      // 从机地址
+        ModbusWriteTransaction registers;   // 写入的寄存器
+        ModbusDoneCallback cb;              // 完成回调
+        void* user_ctx;                     // 回调上下文
+    };
+    
+    // 波特率协商：从机和UART逐级升高到通过探测的最高波特率，结果保存在NVS
+    static const uint8_t BAUD_PROBE_ROUNDS = 8;         // 每一级波特率连续读取完整寄存器块的次数
+    static const uint32_t BAUD_SETTLE_MS = 50;          // 切换波特率后等待从机生效
+    static const char* BAUD_NVS_NAMESPACE;
+    static const char* BAUD_NVS_KEY;
+    
+    /**
+     * @brief 从机支持的一级波特率
+     */
+    struct BaudRate {
+        uint32_t rate;          // 波特率
+        uint16_t code;          // REG_BAUDRATE_L的取值
+    };
+    static const BaudRate BAUD_RATES[];                 // 波特率升序
+    static const size_t BAUD_RATE_COUNT;
+    
+    // 多机总线：各从机轮流轮询，数据不变时逐步放慢，离线的从机退避重试
+    static const size_t MAX_DEVICES = 8;                // 总线上最多的从机
+    static const uint32_t POLL_INTERVAL_MIN_MS = 300;   // 数据变化时的轮询间隔
+    static const uint32_t POLL_INTERVAL_MAX_MS = 2000;  // 数据长时间不变时的轮询间隔
+    static const uint32_t OFFLINE_RETRY_MAX_MS = 10000; // 离线从机的最长重试间隔
+    static const uint8_t OFFLINE_FAIL_COUNT = 3;        // 连续失败多少次视为离线
+    static const uint32_t DISCOVERY_TIMEOUT_MS = 20;    // 发现从机时每个地址的响应超时
+    
+    /**
+     * @brief 总线上一台从机的状态
+     */
+    struct ModbusDevice {
+        bool used;                          // 槽位是否占用
+        uint8_t address;                    // 从机地址
+        bool online;                        // 最近是否有响应
+        uint8_t fail_count;                 // 连续失败次数
+        uint32_t interval_ms;               // 当前轮询间隔
+        int64_t next_poll_us;               // 下次轮询时间
+        ModbusDoneCallback poll_cb;         // 请求轮询的回调
+        void* poll_ctx;                     // 回调上下文
+        PowerDeviceData data;               // 最近一次的数据
+        uint16_t register_image[REG_BUZZER + 1];    // 按地址存放的最近一次轮询结果
+    };
+    
     // 数据成员
-    PowerDeviceData device_data;
+    ModbusDevice devices[MAX_DEVICES];          // devices[0]固定为DEVICE_ADDRESS
     SemaphoreHandle_t modbus_mutex;
+    QueueHandle_t uart_queue;                   // UART驱动事件队列，接收超时即帧结束
     uint32_t last_communication_ms;
     bool is_initialized;
+    uint32_t baud_rate;                         // UART当前的波特率
+    volatile bool baud_negotiation_pending;
+    PollBlock poll_blocks[MAX_POLL_BLOCKS];
+    size_t poll_block_count;
+    PendingWrite pending_writes[MAX_PENDING_WRITES];
+    uint32_t write_seq;
+    portMUX_TYPE request_lock;                  // 保护排队的请求和轮询时间
+    bool discovery_active;
+    uint8_t discovery_next;
+    uint8_t discovery_last;
+    uint8_t discovery_found;
+    SemaphoreHandle_t discovery_done;
+    ModbusSampleCallback sample_cb;
+    void* sample_ctx;
+    uint32_t sample_interval_ms;                // 非0时所有从机按此间隔固定轮询
+    ModbusLinkStats link_stats;
+    mutable portMUX_TYPE stats_lock;            // 保护link_stats
+    int64_t link_tx_start_us;                   // 当前事务开始发送的时间
+    int64_t link_first_byte_us;                 // 当前事务收到第一个字节的时间，0为未收到
+    size_t link_rx_bytes;                       // 当前事务接收的字节
+    bool link_overflow;                         // 当前事务接收溢出
+    TaskHandle_t worker_task;
+    SemaphoreHandle_t worker_exit;
+    volatile bool worker_running;
     
     // 私有方法
-    uint16_t calculateCRC(const uint8_t* data, size_t length);
     bool sendModbusFrame(const uint8_t* frame, size_t length);
     bool receiveModbusFrame(uint8_t* frame, size_t* length, uint32_t timeout_ms);
     void ensureFrameInterval();
+    uint8_t frameGapSymbols() const;
+    static size_t expectedResponseLength(const uint8_t* frame, size_t received);
+    bool readRegisters(uint8_t slave, uint16_t start_addr, uint16_t count, uint16_t* data, uint32_t timeout_ms);
+    bool writeRegister(uint8_t slave, uint16_t addr, uint16_t value);
+    bool writeRegisters(uint8_t slave, uint16_t addr, const uint16_t* values, uint16_t count);
+    bool writeTransaction(uint8_t slave, const ModbusWriteTransaction& transaction);
+    ModbusDevice* findDevice(uint8_t address);
+    bool readDeviceData(ModbusDevice* device);
+    bool probeDevice(uint8_t address);
+    bool probeLink(uint8_t slave);
+    bool applyBaudRate(uint32_t rate);
+    int findBaudRate(uint8_t slave);
+    void negotiateBaudRate();
+    static int baudRateIndex(uint32_t rate);
+    static uint32_t loadBaudRate();
+    static void saveBaudRate(uint32_t rate);
+    void schedulePoll(ModbusDevice* device, bool success, bool changed);
+    uint32_t runTransactions();
+    bool submitWrite(uint8_t slave, const ModbusWriteTransaction& transaction, ModbusDoneCallback cb,
+                     void* user_ctx);
+    bool takeNextWrite(PendingWrite* write);
+    void failPendingRequests();
+    static void workerTask(void* arg);
+    void buildPollPlan();
+    void recordTransaction(LinkResult result, size_t tx_bytes);
+    static size_t linkHistogramBin(uint32_t us);
     
     // 调试和扫描方法
     bool scanDeviceAddress(uint8_t start_addr = 1, uint8_t end_addr = 10);
@@ -163,6 +353,15 @@ public:
      */
     bool writeSingleRegister(uint16_t addr, uint16_t value);
     
+    /**
+     * @brief 用功能码0x10写入连续的寄存器，一次请求和响应
+     * @param addr 起始地址
+     * @param values 写入的值
+     * @param count 寄存器数量 (1-123)
+     * @return true 写入成功，false 写入失败
+     */
+    bool writeMultipleRegisters(uint16_t addr, const uint16_t* values, uint16_t count);
+    
     /**
      * @brief 读取所有设备数据
      * @return true 读取成功，false 读取失败
@@ -170,10 +369,117 @@ public:
     bool readAllDeviceData();
     
     /**
-     * @brief 获取设备数据
+     * @brief 请求立即轮询一台从机，立即返回
+     * @details 已有轮询在排队时合并为一次，回调以最后一次请求为准。不请求时从机也会按自适应间隔轮流轮询
+     * @param cb 完成回调，可为nullptr
+     * @param user_ctx 回调上下文
+     * @param slave 从机地址
+     * @return true 已排队，false 未初始化或从机未添加
+     */
+    bool requestPoll(ModbusDoneCallback cb = nullptr, void* user_ctx = nullptr, uint8_t slave = DEVICE_ADDRESS);
+    
+    /**
+     * @brief 设置轮询数据回调，用于记录每一次采样
+     * @param cb 回调，nullptr取消
+     * @param user_ctx 回调上下文
+     * @param interval_ms 非0时关闭自适应间隔，所有从机按此间隔固定轮询
+     */
+    void setSampleSink(ModbusSampleCallback cb, void* user_ctx, uint32_t interval_ms = 0);
+    
+    /**
+     * @brief 添加一台从机到轮询
+     * @param address 从机地址 (1-247)
+     * @return true 添加成功或已存在，false 地址无效或从机已满
+     */
+    bool addDevice(uint8_t address);
+    
+    /**
+     * @brief 在后台发现从机，探测穿插在轮询之间，不会打断已知从机的更新
+     * @details 每个地址最多等待DISCOVERY_TIMEOUT_MS，总耗时有上限。找到的从机自动加入轮询
+     * @param first_addr 起始地址
+     * @param last_addr 结束地址
+     * @return true 已开始，false 未初始化或参数无效
+     */
+    bool startDiscovery(uint8_t first_addr, uint8_t last_addr);
+    
+    /**
+     * @brief 在后台协商波特率，立即返回
+     * @details 工作任务先确认当前波特率下的连接，找不到从机时依次尝试各级波特率。然后逐级写入
+     *          REG_BAUDRATE_L并切换UART，每一级连续读取BAUD_PROBE_ROUNDS次完整的寄存器块，全部CRC正确才继续升高，
+     *          失败时退回上一级。结果保存在NVS，下次启动直接使用。初始化时自动执行一次
+     * @return true 已开始，false 未初始化
+     */
+    bool startBaudNegotiation();
+    
+    /**
+     * @brief 获取UART当前的波特率
+     */
+    uint32_t getBaudRate() const { return baud_rate; }
+    
+    /**
+     * @brief 获取已添加的从机数量
+     */
+    size_t getDeviceCount() const;
+    
+    /**
+     * @brief 获取指定从机的数据
+     * @param address 从机地址
+     * @return 数据指针，从机未添加时为nullptr
+     */
+    const PowerDeviceData* getDeviceDataByAddress(uint8_t address) const;
+    
+    /**
+     * @brief 异步设置输出电压和电流，立即返回
+     * @param voltage 电压值 (V)
+     * @param current 电流值 (A)
+     * @param cb 完成回调，可为nullptr
+     * @param user_ctx 回调上下文
+     * @param slave 从机地址
+     * @return true 已排队，false 参数无效或队列已满
+     */
+    bool setVoltageAndCurrentAsync(float voltage, float current, ModbusDoneCallback cb = nullptr,
+                                   void* user_ctx = nullptr, uint8_t slave = DEVICE_ADDRESS);
+    
+    /**
+     * @brief 把电压和电流设定加入写事务，检查范围
+     * @param transaction 写事务
+     * @param voltage 电压值 (V)，上限为该从机的输入电压
+     * @param current 电流值 (A)
+     * @param slave 从机地址
+     * @return true 已加入，false 从机未添加、参数无效或事务已满
+     */
+    bool addVoltageAndCurrent(ModbusWriteTransaction* transaction, float voltage, float current,
+                              uint8_t slave = DEVICE_ADDRESS) const;
+    
+    /**
+     * @brief 异步提交一个写事务，立即返回
+     * @details 事务内的寄存器依次写入，遇到失败即停止。同一组寄存器的事务还未发出时只更新写入值
+     * @param transaction 写事务
+     * @param cb 完成回调，可为nullptr
+     * @param user_ctx 回调上下文
+     * @param slave 从机地址
+     * @return true 已排队，false 事务为空或队列已满
+     */
+    bool submitTransaction(const ModbusWriteTransaction& transaction, ModbusDoneCallback cb = nullptr,
+                           void* user_ctx = nullptr, uint8_t slave = DEVICE_ADDRESS);
+    
+    /**
+     * @brief 异步设置开关类寄存器（REG_ONOFF、REG_BUZZER、REG_LOCK、REG_SLEEP），立即返回
+     * @param reg 寄存器地址
+     * @param enable 开关状态
+     * @param cb 完成回调，可为nullptr
+     * @param user_ctx 回调上下文
+     * @param slave 从机地址
+     * @return true 已排队，false 队列已满
+     */
+    bool setSwitchAsync(uint16_t reg, bool enable, ModbusDoneCallback cb = nullptr, void* user_ctx = nullptr,
+                        uint8_t slave = DEVICE_ADDRESS);
+    
+    /**
+     * @brief 获取设备数据（DEVICE_ADDRESS从机）
      * @return 设备数据结构的引用
      */
-    const PowerDeviceData& getDeviceData() const { return device_data; }
+    const PowerDeviceData& getDeviceData() const { return devices[0].data; }
     
     /**
      * @brief 设置输出电压和电流
@@ -212,7 +518,7 @@ public:
     bool setSleepMode(bool enable);
     
     /**
-     * @brief 扫描Modbus设备地址
+     * @brief 扫描Modbus设备地址1-10并等待完成，找到的从机加入轮询
      * @return true 找到设备，false 未找到设备
      */
     bool scanForDevices();
@@ -236,6 +542,30 @@ public:
      * @return true 通信正常，false 通信异常
      */
     bool isCommunicationOk() const;
+    
+    /**
+     * @brief 直方图各区间的上限 (us)，最后一个区间没有上限
+     */
+    static const uint32_t LINK_HIST_EDGES_US[ModbusLinkStats::HIST_BINS - 1];
+    
+    /**
+     * @brief 获取总线统计
+     * @param stats 输出
+     */
+    void getLinkStats(ModbusLinkStats* stats) const;
+    
+    /**
+     * @brief 清零总线统计
+     */
+    void resetLinkStats();
+    
+    /**
+     * @brief 按直方图估算百分位延迟
+     * @param hist 直方图
+     * @param percent 百分位 (1-100)
+     * @return 所在区间的上限 (us)，落在最后一个区间时为UINT32_MAX，没有数据时为0
+     */
+    static uint32_t linkPercentileUs(const uint32_t* hist, uint32_t percent);
 };
 
 #endif // MODBUS_CONTROLLER_HPP
\ No newline at end of file
@@ -4,6 +4,7 @@
  */
 
 #include "ModbusTest.hpp"
+#include "crc16_modbus/crc16_modbus.h"
 #include "esp_timer.h"
 #include <string.h>
 
@@ -246,6 +247,57 @@ void ModbusTest::testDifferentBaudRates() {
     uart_param_config(uart_port, &uart_config);
 }
 
+// 原逐位实现，作为基准
+static uint16_t crc16_bitwise(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            if (crc & 0x0001) {
+                crc = (crc >> 1) ^ 0xA001;
+            } else {
+                crc = crc >> 1;
+            }
+        }
+    }
+    
+    return crc;
+}
+
+void ModbusTest::benchmarkCRC() {
+    ESP_LOGI(TAG, "=== CRC16性能测试 ===");
+    
+    const int iterations = 1000;
+    // 最长的0x03响应（125个寄存器）去掉CRC
+    uint8_t frame[253];
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)(i * 31 + 7);
+    }
+    
+    const size_t lengths[] = {6, 61, sizeof(frame)};
+    for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++) {
+        size_t len = lengths[n];
+        volatile uint16_t sink = 0;
+        
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < iterations; i++) {
+            sink ^= crc16_bitwise(frame, len);
+        }
+        int64_t bitwise_us = esp_timer_get_time() - start;
+        
+        start = esp_timer_get_time();
+        for (int i = 0; i < iterations; i++) {
+            sink ^= crc16_modbus(frame, len);
+        }
+        int64_t table_us = esp_timer_get_time() - start;
+        
+        bool match = (crc16_bitwise(frame, len) == crc16_modbus(frame, len));
+        ESP_LOGI(TAG, "%d字节 x %d次: 逐位 %lld us, 查表 %lld us, 结果%s", (int)len, iterations,
+                 bitwise_us, table_us, match ? "一致" : "不一致");
+    }
+}
+
 void ModbusTest::runFullDiagnostic() {
     ESP_LOGI(TAG, "\n");
     ESP_LOGI(TAG, "🔧 ===== 开始Modbus通信诊断 =====");
@@ -271,6 +323,9 @@ void ModbusTest::runFullDiagnostic() {
     // 4. 测试不同波特率
     testDifferentBaudRates();
     
+    // 5. CRC性能
+    benchmarkCRC();
+    
     ESP_LOGI(TAG, "\n");
     ESP_LOGI(TAG, "🏁 ===== 诊断完成 =====");
     ESP_LOGI(TAG, "\n");
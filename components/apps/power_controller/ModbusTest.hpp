@@ -44,6 +44,11 @@ public:
      */
     void testDifferentBaudRates();
     
+    /**
+     * @brief 对比查表CRC与逐位CRC的耗时
+     */
+    void benchmarkCRC();
+    
     /**
      * @brief 运行完整诊断
      */
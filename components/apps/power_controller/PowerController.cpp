@@ -11,12 +11,18 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "ui/ui.h"
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 static const char *TAG = "PowerController";
 
+// 长按应用按钮时加载的设定值曲线
+#define PROFILE_PATH    BSP_SD_MOUNT_POINT "/PROFILE.TXT"
+
 // 预设值定义
 const PowerController::PresetValue PowerController::PRESET_VALUES[] = {
     {3.3f, 3.0f},   // 3V3 3A
@@ -29,6 +35,23 @@ const PowerController::PresetValue PowerController::PRESET_VALUES[] = {
 
 const int PowerController::PRESET_COUNT = sizeof(PRESET_VALUES) / sizeof(PRESET_VALUES[0]);
 
+// 显示字段定义
+const PowerController::DisplayFieldInfo PowerController::DISPLAY_FIELDS[FIELD_NUM] = {
+    {&ui_LabelVoltageValue,      &PowerDeviceData::output_voltage, 100.0f,  "%.2f"},
+    {&ui_LabelCurrentValue,      &PowerDeviceData::output_current, 1000.0f, "%.3f"},
+    {&ui_LabelPowerValue,        &PowerDeviceData::output_power,   100.0f,  "%.2f"},
+    {&ui_LabelVoltageSetValue,   &PowerDeviceData::set_voltage,    100.0f,  "%.2f"},
+    {&ui_LabelCurrentSetValue,   &PowerDeviceData::set_current,    1000.0f, "%.3f"},
+    {&ui_LabelVoltageInputValue, &PowerDeviceData::input_voltage,  100.0f,  "%.2f"},
+};
+
+const PowerController::DisplaySwitchInfo PowerController::DISPLAY_SWITCHES[SWITCH_NUM] = {
+    {&ui_SwitchPower,   &PowerDeviceData::output_switch},
+    {&ui_SwitchBeep,    &PowerDeviceData::beep_switch},
+    {&ui_SwitchKeyLock, &PowerDeviceData::key_lock},
+    {&ui_SwitchSleep,   &PowerDeviceData::sleep_mode},
+};
+
 /**
  * @brief 构造函数
  * @details 初始化电源控制器应用，设置应用名称和图标
@@ -36,8 +59,12 @@ const int PowerController::PRESET_COUNT = sizeof(PRESET_VALUES) / sizeof(PRESET_
 PowerController::PowerController()
     : ESP_Brookesia_PhoneApp("Power Control", nullptr, true),
       modbus_controller(nullptr), update_timer(nullptr), update_task_handle(nullptr),
-      is_running(false), update_requested(false)
+      is_running(false), update_requested(false), telemetry(nullptr), logger(nullptr), publisher(nullptr), http_api(nullptr), profile(nullptr),
+      chart_panel(nullptr), chart_title(nullptr),
+      chart(nullptr), chart_voltage(nullptr), chart_current(nullptr), chart_tier(TELEMETRY_TIER_RAW), chart_total(0),
+      link_panel(nullptr), link_label(nullptr), link_refresh_ms(0)
 {
+    invalidateRendered();
     ESP_LOGI(TAG, "PowerController created");
 }
 
@@ -59,16 +86,46 @@ PowerController::~PowerController()
     
     // 停止更新任务
     if (update_task_handle != nullptr) {
-        vTaskDelete(update_task_handle);
+        task_config_delete(TASK_CONFIG_POWER_UPDATE, update_task_handle);
         update_task_handle = nullptr;
     }
     
+    // 曲线任务会提交写入，先于Modbus控制器删除
+    if (profile != nullptr) {
+        delete profile;
+        profile = nullptr;
+    }
+    
+    // HTTP接口会提交写入，先于Modbus控制器关闭，工作任务退出后再删除
+    if (http_api != nullptr) {
+        http_api->stop();
+    }
+    
     // 清理Modbus控制器
     if (modbus_controller != nullptr) {
         delete modbus_controller;
         modbus_controller = nullptr;
     }
     
+    if (telemetry != nullptr) {
+        delete telemetry;
+        telemetry = nullptr;
+    }
+    
+    // Modbus工作任务已退出，不会再有采样
+    if (logger != nullptr) {
+        delete logger;
+        logger = nullptr;
+    }
+    if (publisher != nullptr) {
+        delete publisher;
+        publisher = nullptr;
+    }
+    if (http_api != nullptr) {
+        delete http_api;
+        http_api = nullptr;
+    }
+    
     ESP_LOGI(TAG, "PowerController destroyed");
 }
 
@@ -121,6 +178,33 @@ bool PowerController::init(void)
     }
     */
     
+    // 遥测数据占用固定内存，应用关闭后继续保留
+    telemetry = new PowerTelemetry();
+    if (telemetry == nullptr) {
+        ESP_LOGW(TAG, "Failed to create telemetry store, trend chart disabled");
+    }
+    
+#if CONFIG_POWER_CONTROLLER_LOG
+    startLogging();
+#endif
+#if CONFIG_POWER_CONTROLLER_MQTT
+    startPublishing();
+#endif
+#if CONFIG_POWER_CONTROLLER_HTTP_API
+    startHttpApi();
+#endif
+    // 记录、上报和WebSocket推送共用Modbus工作任务的采样回调，记录时按固定间隔轮询
+    if (modbus_controller && (logger || publisher || http_api)) {
+#if CONFIG_POWER_CONTROLLER_LOG
+        uint32_t sample_interval_ms = logger ? CONFIG_POWER_CONTROLLER_LOG_INTERVAL_MS : 0;
+#else
+        uint32_t sample_interval_ms = 0;
+#endif
+        modbus_controller->setSampleSink(onSample, this, sample_interval_ms);
+    }
+    
+    profile = new PowerProfile(modbus_controller);
+    
     // 通信正常，启用完整功能定时器
     update_timer = xTimerCreate(
         "PowerUpdate",                          // 定时器名称
@@ -147,14 +231,7 @@ bool PowerController::init(void)
     is_running = true;
     
     // 创建持久更新任务
-    BaseType_t task_result = xTaskCreate(
-        updateTask,                    // 任务函数
-        "PowerUpdate",                 // 任务名称
-        4096,                          // 堆栈大小
-        this,                          // 传递this指针
-        5,                             // 优先级
-        &update_task_handle           // 任务句柄
-    );
+    BaseType_t task_result = task_config_create(TASK_CONFIG_POWER_UPDATE, updateTask, this, &update_task_handle);
     
     if (task_result != pdPASS) {
         ESP_LOGE(TAG, "Failed to create update task");
@@ -188,6 +265,8 @@ bool PowerController::run(void)
     
     // 设置UI事件处理
     setupUIEvents();
+    createTrendChart();
+    createLinkPanel();
     
     // 获取需要对齐的UI元素
     extern lv_obj_t * ui_LabelVoltageValue;
@@ -255,14 +334,7 @@ bool PowerController::run(void)
     // 检查更新任务是否还存在，如果不存在则重新创建
     if (update_task_handle == nullptr) {
         ESP_LOGI(TAG, "Update task not found, recreating...");
-        BaseType_t task_result = xTaskCreate(
-            updateTask,                    // 任务函数
-            "PowerUpdate",                 // 任务名称
-            4096,                          // 堆栈大小
-            this,                          // 传递this指针
-            5,                             // 优先级
-            &update_task_handle           // 任务句柄
-        );
+        BaseType_t task_result = task_config_create(TASK_CONFIG_POWER_UPDATE, updateTask, this, &update_task_handle);
         
         if (task_result != pdPASS) {
             ESP_LOGE(TAG, "Failed to recreate update task");
@@ -288,9 +360,6 @@ bool PowerController::run(void)
     // 快速显示默认值，然后异步更新
     updateDisplayValuesQuick();
     
-    // 立即触发一次数据更新来测试通信
-    ESP_LOGI(TAG, "Starting async display update");
-    updateDisplayValuesAsync();
     
     ESP_LOGI(TAG, "PowerController started successfully");
     return true;
@@ -324,6 +393,15 @@ bool PowerController::close(void)
         xTimerStop(update_timer, pdMS_TO_TICKS(100)); // 减少等待时间
     }
     
+    // 界面随应用关闭删除
+    chart_panel = nullptr;
+    chart_title = nullptr;
+    chart = nullptr;
+    chart_voltage = nullptr;
+    chart_current = nullptr;
+    link_panel = nullptr;
+    link_label = nullptr;
+    
     // 通知更新任务停止
     if (update_task_handle) {
         xTaskNotifyGive(update_task_handle);
@@ -432,7 +510,9 @@ void PowerController::setupUIEvents(void)
     
     // 设置应用按钮事件
     if (ui_ButtonADJApply) {
-        lv_obj_add_event_cb(ui_ButtonADJApply, onApplyButtonClick, LV_EVENT_CLICKED, this);
+        // 长按时LVGL仍会发送CLICKED，短按才应用设置
+        lv_obj_add_event_cb(ui_ButtonADJApply, onApplyButtonClick, LV_EVENT_SHORT_CLICKED, this);
+        lv_obj_add_event_cb(ui_ButtonADJApply, onApplyButtonLongPress, LV_EVENT_LONG_PRESSED, this);
     }
     
     // 设置开关事件
@@ -474,16 +554,12 @@ void PowerController::updateDisplayValuesQuick(void)
     if (ui_LabelVoltageSetValue) lv_label_set_text(ui_LabelVoltageSetValue, "0.00");
     if (ui_LabelCurrentSetValue) lv_label_set_text(ui_LabelCurrentSetValue, "0.000");
     if (ui_LabelVoltageInputValue) lv_label_set_text(ui_LabelVoltageInputValue, "0.00");
+    invalidateRendered();
     
     ESP_LOGI(TAG, "Quick display values initialized");
     
-    // 异步启动实际数据更新
-    xTaskCreate([](void* param) {
-        PowerController* controller = (PowerController*)param;
-        vTaskDelay(pdMS_TO_TICKS(100)); // 短暂延迟让UI稳定
-        controller->updateDisplayValuesAsync();
-        vTaskDelete(NULL);
-    }, "AsyncUpdate", 4096, this, 5, NULL);
+    // 实际数据由Modbus工作任务读取
+    updateDisplayValuesAsync();
 }
 
 // 异步更新显示值，避免阻塞UI
@@ -493,153 +569,154 @@ void PowerController::updateDisplayValuesAsync(void)
         return;
     }
     
-    ESP_LOGI(TAG, "Starting async display update");
+    // 只提交轮询请求，读取完成后由onPollDone通知更新任务刷新界面
+    if (!modbus_controller->requestPoll(onPollDone, this)) {
+        ESP_LOGW(TAG, "⚠️ Async display update not queued, will retry in next cycle");
+    }
+}
+
+void PowerController::onPollDone(bool success, void* user_ctx)
+{
+    PowerController* controller = (PowerController*)user_ctx;
     
-    // 读取设备数据，使用短超时
-    if (modbus_controller->readAllDeviceData()) {
-        updateDisplayValues();
-        ESP_LOGI(TAG, "✅ Async display update completed successfully");
-    } else {
+    if (!success) {
         ESP_LOGW(TAG, "⚠️ Async display update failed, will retry in next cycle");
+    } else if (controller->telemetry && controller->modbus_controller) {
+        controller->telemetry->addSample(controller->modbus_controller->getDeviceData(),
+                                         esp_timer_get_time() / 1000);
+    }
+    // 失败时也通知，总线统计面板照常刷新，数值没有变化不会重绘
+    if (controller->is_running && controller->update_task_handle) {
+        controller->update_requested = true;
+        xTaskNotifyGive(controller->update_task_handle);
     }
 }
 
-void PowerController::updateDisplayValues(void)
+void PowerController::onWriteDone(bool success, void* user_ctx)
 {
-    // 增加安全检查，避免在定时器中栈溢出
-    if (!is_running || !modbus_controller) {
-        return;
-    }
+    PowerController* controller = (PowerController*)user_ctx;
     
-    // 添加额外的互斥锁保护，防止并发访问
-    static bool updating = false;
-    if (updating) {
-        ESP_LOGD(TAG, "Update already in progress, skipping");
-        return;
+    if (!success) {
+        // 重新读取设备状态，让界面回到设备的实际值
+        ESP_LOGE(TAG, "Failed to write settings to device");
+        controller->updateDisplayValuesAsync();
     }
-    updating = true;
-    
-    // 读取XY6506S实时数据 - 使用超时保护
-    ESP_LOGD(TAG, "Reading device data...");
-    if (!modbus_controller->readAllDeviceData()) {
-        ESP_LOGW(TAG, "Failed to read device data");
-        updating = false;
+}
+
+void PowerController::invalidateRendered(void)
+{
+    for (int i = 0; i < FIELD_NUM; i++) {
+        rendered_values[i] = RENDERED_NONE;
+    }
+    for (int i = 0; i < SWITCH_NUM; i++) {
+        rendered_switches[i] = -1;
+    }
+}
+
+void PowerController::refreshDisplay(void)
+{
+    // 增加安全检查，避免在定时器中栈溢出
+    if (!is_running || !modbus_controller) {
         return;
     }
     
-    const PowerDeviceData& data = modbus_controller->getDeviceData();
+    // 复制工作任务最近一次读取的数据
+    const PowerDeviceData data = modbus_controller->getDeviceData();
+    bool link_pending = linkPanelPending();
     if (!data.data_valid) {
         ESP_LOGW(TAG, "Device data is not valid");
-        updating = false;
+        // 总线统计在没有数据时最有用
+        if (link_pending && bsp_display_lock(0)) {
+            updateLinkPanel();
+            bsp_display_unlock();
+        }
         return;
     }
     
-    // 获取UI标签
-    extern lv_obj_t * ui_LabelVoltageValue;
-    extern lv_obj_t * ui_LabelCurrentValue; 
-    extern lv_obj_t * ui_LabelPowerValue;
-    extern lv_obj_t * ui_LabelVoltageSetValue;
-    extern lv_obj_t * ui_LabelCurrentSetValue;
-    extern lv_obj_t * ui_LabelVoltageInputValue;
-    
-    char text_buffer[32];
-    
-    // 更新输出电压
-    if (ui_LabelVoltageValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.2f", data.output_voltage);
-        lv_label_set_text(ui_LabelVoltageValue, text_buffer);
+    // 按显示精度取整后比较，数值没有变化的控件不再重设文本
+    int32_t values[FIELD_NUM];
+    uint32_t changed_values = 0;
+    for (int i = 0; i < FIELD_NUM; i++) {
+        values[i] = (int32_t)lroundf(data.*DISPLAY_FIELDS[i].value * DISPLAY_FIELDS[i].scale);
+        if (values[i] != rendered_values[i]) {
+            changed_values |= 1 << i;
+        }
     }
     
-    // 更新输出电流
-    if (ui_LabelCurrentValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.3f", data.output_current);
-        lv_label_set_text(ui_LabelCurrentValue, text_buffer);
+    int8_t states[SWITCH_NUM];
+    uint32_t changed_switches = 0;
+    for (int i = 0; i < SWITCH_NUM; i++) {
+        states[i] = data.*DISPLAY_SWITCHES[i].value ? 1 : 0;
+        if (states[i] != rendered_switches[i]) {
+            changed_switches |= 1 << i;
+        }
     }
     
-    // 更新输出功率
-    if (ui_LabelPowerValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.2f", data.output_power);
-        lv_label_set_text(ui_LabelPowerValue, text_buffer);
+    // 稳定状态下不获取显示锁，界面事件这时改写的控件在下次轮询时补上
+    if (!changed_values && !changed_switches && !trendChartPending() && !link_pending) {
+        return;
     }
     
-    // 更新设定电压
-    if (ui_LabelVoltageSetValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.2f", data.set_voltage);
-        lv_label_set_text(ui_LabelVoltageSetValue, text_buffer);
+    if (!bsp_display_lock(0)) {
+        return;
     }
-    
-    // 更新设定电流
-    if (ui_LabelCurrentSetValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.3f", data.set_current);
-        lv_label_set_text(ui_LabelCurrentSetValue, text_buffer);
+    updateDisplayValues(values, changed_values);
+    updateSwitchStates(states, changed_switches);
+    feedTrendChart();
+    if (link_pending) {
+        updateLinkPanel();
     }
+    bsp_display_unlock();
+}
+
+void PowerController::updateDisplayValues(const int32_t* values, uint32_t changed)
+{
+    char text_buffer[32];
     
-    // 更新输入电压
-    if (ui_LabelVoltageInputValue) {
-        snprintf(text_buffer, sizeof(text_buffer), "%.2f", data.input_voltage);
-        lv_label_set_text(ui_LabelVoltageInputValue, text_buffer);
+    for (int i = 0; i < FIELD_NUM; i++) {
+        if (!(changed & (1 << i))) {
+            continue;
+        }
+        lv_obj_t* label = *DISPLAY_FIELDS[i].label;
+        if (label) {
+            snprintf(text_buffer, sizeof(text_buffer), DISPLAY_FIELDS[i].format,
+                     values[i] / DISPLAY_FIELDS[i].scale);
+            lv_label_set_text(label, text_buffer);
+        }
+        rendered_values[i] = values[i];
     }
     
-    // 重置更新标志
-    updating = false;
-    ESP_LOGD(TAG, "Display values updated successfully");
+    if (changed) {
+        ESP_LOGD(TAG, "Display values updated (mask 0x%02lx)", (unsigned long)changed);
+    }
 }
 
-void PowerController::updateSwitchStates(void)
+void PowerController::updateSwitchStates(const int8_t* states, uint32_t changed)
 {
-    if (!modbus_controller || !is_running) {
-        return;
-    }
-    
-    const PowerDeviceData& data = modbus_controller->getDeviceData();
-    if (!data.data_valid) {
+    if (!changed) {
         return;
     }
     
     // 添加调试日志显示从机状态
     ESP_LOGI(TAG, "🔄 Updating switch states - Power:%s, Beep:%s, KeyLock:%s, Sleep:%s", 
-             data.output_switch ? "ON" : "OFF",
-             data.beep_switch ? "ON" : "OFF", 
-             data.key_lock ? "LOCKED" : "UNLOCKED",
-             data.sleep_mode ? "ON" : "OFF");
+             states[SWITCH_POWER] ? "ON" : "OFF",
+             states[SWITCH_BEEP] ? "ON" : "OFF", 
+             states[SWITCH_KEY_LOCK] ? "LOCKED" : "UNLOCKED",
+             states[SWITCH_SLEEP] ? "ON" : "OFF");
     
-    // 获取UI开关
-    extern lv_obj_t * ui_SwitchPower;
-    extern lv_obj_t * ui_SwitchBeep;
-    extern lv_obj_t * ui_SwitchKeyLock;
-    extern lv_obj_t * ui_SwitchSleep;
-    
-    // 更新开关状态
-    if (ui_SwitchPower) {
-        if (data.output_switch) {
-            lv_obj_add_state(ui_SwitchPower, LV_STATE_CHECKED);
-        } else {
-            lv_obj_clear_state(ui_SwitchPower, LV_STATE_CHECKED);
-        }
-    }
-    
-    if (ui_SwitchBeep) {
-        if (data.beep_switch) {
-            lv_obj_add_state(ui_SwitchBeep, LV_STATE_CHECKED);
-        } else {
-            lv_obj_clear_state(ui_SwitchBeep, LV_STATE_CHECKED);
-        }
-    }
-    
-    if (ui_SwitchKeyLock) {
-        if (data.key_lock) {
-            lv_obj_add_state(ui_SwitchKeyLock, LV_STATE_CHECKED);
-        } else {
-            lv_obj_clear_state(ui_SwitchKeyLock, LV_STATE_CHECKED);
+    for (int i = 0; i < SWITCH_NUM; i++) {
+        if (!(changed & (1 << i))) {
+            continue;
         }
-    }
-    
-    if (ui_SwitchSleep) {
-        if (data.sleep_mode) {
-            lv_obj_add_state(ui_SwitchSleep, LV_STATE_CHECKED);
-        } else {
-            lv_obj_clear_state(ui_SwitchSleep, LV_STATE_CHECKED);
+        lv_obj_t* sw = *DISPLAY_SWITCHES[i].sw;
+        if (sw) {
+            if (states[i]) {
+                lv_obj_add_state(sw, LV_STATE_CHECKED);
+            } else {
+                lv_obj_clear_state(sw, LV_STATE_CHECKED);
+            }
         }
+        rendered_switches[i] = states[i];
     }
 }
 
@@ -686,25 +763,32 @@ bool PowerController::applyVoltageCurrentSettings(void)
         return false;
     }
     
-    // 发送设置命令到XY6506S
+    // 手动设置优先于正在执行的曲线
+    if (profile && profile->isRunning()) {
+        profile->stop();
+    }
+    
+    // 提交设置命令到XY6506S，写入失败时onWriteDone会重新同步界面
     ESP_LOGI(TAG, "Applying settings to XY6506S: %.2fV/%.3fA", voltage, current);
-    if (!modbus_controller->setVoltageAndCurrent(voltage, current)) {
-        ESP_LOGE(TAG, "Failed to set voltage/current on device");
+    if (!modbus_controller->setVoltageAndCurrentAsync(voltage, current, onWriteDone, this)) {
+        ESP_LOGE(TAG, "Failed to queue voltage/current settings");
         return false;
     }
     
-    // 更新UI显示
+    // 更新UI显示，设备确认相同的值后不再重绘
     char buffer[16];
     if (ui_LabelVoltageSetValue) {
         snprintf(buffer, sizeof(buffer), "%.2f", voltage);
         lv_label_set_text(ui_LabelVoltageSetValue, buffer);
+        rendered_values[FIELD_SET_VOLTAGE] = (int32_t)lroundf(voltage * DISPLAY_FIELDS[FIELD_SET_VOLTAGE].scale);
     }
     if (ui_LabelCurrentSetValue) {
         snprintf(buffer, sizeof(buffer), "%.3f", current);
         lv_label_set_text(ui_LabelCurrentSetValue, buffer);
+        rendered_values[FIELD_SET_CURRENT] = (int32_t)lroundf(current * DISPLAY_FIELDS[FIELD_SET_CURRENT].scale);
     }
     
-    ESP_LOGI(TAG, "Successfully applied settings: %.2fV/%.3fA", voltage, current);
+    ESP_LOGI(TAG, "Settings queued: %.2fV/%.3fA", voltage, current);
     return true;
     
     /*
@@ -742,10 +826,9 @@ void PowerController::updateTimerCallback(TimerHandle_t timer)
 {
     PowerController* controller = (PowerController*)pvTimerGetTimerID(timer);
     if (controller && controller->is_running && controller->update_task_handle) {
-        // 通知持久更新任务进行更新
-        ESP_LOGD("PowerController", "🔔 Timer callback triggered - notifying update task");
-        controller->update_requested = true;
-        xTaskNotifyGive(controller->update_task_handle);
+        // 提交轮询，读取完成后再通知更新任务，定时器任务不会被总线阻塞
+        ESP_LOGD("PowerController", "🔔 Timer callback triggered - requesting poll");
+        controller->updateDisplayValuesAsync();
     } else {
         ESP_LOGW("PowerController", "⚠️ Timer callback skipped - controller=%p, running=%d, task=%p", 
                 controller, controller ? controller->is_running : 0, 
@@ -786,6 +869,9 @@ void PowerController::onPresetButtonClick(lv_event_t* e)
             snprintf(buffer, sizeof(buffer), "%.1f", preset.current);
             lv_label_set_text(ui_LabelCurrentSetValue, buffer);
         }
+        // 预设值未写入设备，下次轮询时恢复为设备的设定值
+        controller->rendered_values[FIELD_SET_VOLTAGE] = RENDERED_NONE;
+        controller->rendered_values[FIELD_SET_CURRENT] = RENDERED_NONE;
         if (ui_TextAreaADJVoltage) {
             snprintf(buffer, sizeof(buffer), "%.1f", preset.voltage);
             lv_textarea_set_text(ui_TextAreaADJVoltage, buffer);
@@ -808,6 +894,27 @@ void PowerController::onApplyButtonClick(lv_event_t* e)
     }
 }
 
+void PowerController::onApplyButtonLongPress(lv_event_t* e)
+{
+    PowerController* controller = (PowerController*)lv_event_get_user_data(e);
+    
+    if (!controller || !controller->profile) {
+        return;
+    }
+    
+    // 长按开始或停止SD卡上的曲线
+    PowerProfile* profile = controller->profile;
+    if (profile->isRunning()) {
+        profile->stop();
+        return;
+    }
+    if (profile->loadFile(PROFILE_PATH) && profile->start()) {
+        ESP_LOGI(TAG, "▶️ Profile %s started", PROFILE_PATH);
+    } else {
+        ESP_LOGW(TAG, "⚠️ Failed to start profile %s", PROFILE_PATH);
+    }
+}
+
 void PowerController::onSwitchChanged(lv_event_t* e)
 {
     PowerController* controller = (PowerController*)lv_event_get_user_data(e);
@@ -819,33 +926,384 @@ void PowerController::onSwitchChanged(lv_event_t* e)
     
     bool is_checked = lv_obj_has_state(obj, LV_STATE_CHECKED);
     
+    // 开关已显示用户选择的状态，设备状态不同时下次刷新会改回
+    for (int i = 0; i < SWITCH_NUM; i++) {
+        if (*DISPLAY_SWITCHES[i].sw == obj) {
+            controller->rendered_switches[i] = is_checked ? 1 : 0;
+        }
+    }
+    
     // 获取UI开关
     extern lv_obj_t * ui_SwitchPower;
     extern lv_obj_t * ui_SwitchBeep;
     extern lv_obj_t * ui_SwitchKeyLock;
     extern lv_obj_t * ui_SwitchSleep;
     
-    // 发送真实的Modbus开关控制命令到XY6506S
+    // 发送真实的Modbus开关控制命令到XY6506S，事件回调立即返回
     if (controller && controller->modbus_controller) {
+        ModbusController* modbus = controller->modbus_controller;
         if (obj == ui_SwitchPower) {
             ESP_LOGI(TAG, "Setting output switch: %s", is_checked ? "ON" : "OFF");
-            controller->modbus_controller->setOutputSwitch(is_checked);
+            modbus->setSwitchAsync(REG_ONOFF, is_checked, onWriteDone, controller);
         }
         else if (obj == ui_SwitchBeep) {
             ESP_LOGI(TAG, "Setting beep switch: %s", is_checked ? "ON" : "OFF");
-            controller->modbus_controller->setBeepSwitch(is_checked);
+            modbus->setSwitchAsync(REG_BUZZER, is_checked, onWriteDone, controller);
         }
         else if (obj == ui_SwitchKeyLock) {
             ESP_LOGI(TAG, "Setting key lock: %s", is_checked ? "LOCKED" : "UNLOCKED");
-            controller->modbus_controller->setKeyLock(is_checked);
+            modbus->setSwitchAsync(REG_LOCK, is_checked, onWriteDone, controller);
         }
         else if (obj == ui_SwitchSleep) {
             ESP_LOGI(TAG, "Setting sleep mode: %s", is_checked ? "SLEEP" : "NORMAL");
-            controller->modbus_controller->setSleepMode(is_checked);
+            modbus->setSwitchAsync(REG_SLEEP, is_checked, onWriteDone, controller);
         }
     }
 }
 
+void PowerController::createTrendChart(void)
+{
+    extern lv_obj_t * ui_PowerController;
+    extern lv_obj_t * ui_PanelVoltageValue;
+    extern lv_obj_t * ui_PanelCurrentValue;
+    extern lv_obj_t * ui_PanelPowerValue;
+    
+    if (!telemetry || !ui_PowerController) {
+        return;
+    }
+    
+    // 覆盖在测量值上方，默认隐藏
+    chart_panel = lv_obj_create(ui_PowerController);
+    lv_obj_set_size(chart_panel, 470, 200);
+    lv_obj_align(chart_panel, LV_ALIGN_TOP_MID, 0, 20);
+    lv_obj_set_style_pad_all(chart_panel, 6, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_clear_flag(chart_panel, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(chart_panel, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_event_cb(chart_panel, onChartClick, LV_EVENT_CLICKED, this);
+    
+    chart_title = lv_label_create(chart_panel);
+    lv_obj_align(chart_title, LV_ALIGN_TOP_LEFT, 0, 0);
+    
+    chart = lv_chart_create(chart_panel);
+    lv_obj_set_size(chart, lv_pct(100), 160);
+    lv_obj_align(chart, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_clear_flag(chart, LV_OBJ_FLAG_CLICKABLE);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(chart, CHART_POINTS);
+    // 循环模式下追加一个点只重绘该点附近，移位模式会重绘整个图
+    lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_CIRCULAR);
+    lv_chart_set_div_line_count(chart, 5, 7);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);
+    chart_voltage = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
+    chart_current = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_SECONDARY_Y);
+    
+    // 点击任一测量值打开趋势图
+    lv_obj_t* readings[] = {ui_PanelVoltageValue, ui_PanelCurrentValue, ui_PanelPowerValue};
+    for (size_t i = 0; i < sizeof(readings) / sizeof(readings[0]); i++) {
+        if (readings[i]) {
+            lv_obj_add_flag(readings[i], LV_OBJ_FLAG_CLICKABLE);
+            // 长按功率值打开总线统计，短按才打开趋势图
+            lv_obj_add_event_cb(readings[i], onReadingClick, LV_EVENT_SHORT_CLICKED, this);
+        }
+    }
+}
+
+void PowerController::reloadTrendChart(void)
+{
+    static const char* titles[TELEMETRY_TIER_NUM] = {
+        "Trend: every poll",
+        "Trend: 1 min average",
+        "Trend: 1 h average",
+    };
+    
+    if (!chart || !telemetry) {
+        return;
+    }
+    
+    // 量程按当前输入电压和设定电流，只在重新填充时调整
+    const PowerDeviceData& data = modbus_controller ? modbus_controller->getDeviceData() : PowerDeviceData{};
+    lv_coord_t voltage_max = (lv_coord_t)(((int)(data.input_voltage / 5.0f) + 1) * 500);
+    lv_coord_t current_max = (lv_coord_t)(((int)data.set_current + 1) * 1000);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, voltage_max);
+    lv_chart_set_range(chart, LV_CHART_AXIS_SECONDARY_Y, 0, current_max);
+    lv_label_set_text(chart_title, titles[chart_tier]);
+    
+    lv_chart_set_all_value(chart, chart_voltage, LV_CHART_POINT_NONE);
+    lv_chart_set_all_value(chart, chart_current, LV_CHART_POINT_NONE);
+    
+    chart_total = telemetry->getTotal(chart_tier);
+    size_t count = telemetry->getCount(chart_tier);
+    size_t first = (count > CHART_POINTS) ? count - CHART_POINTS : 0;
+    for (size_t i = first; i < count; i++) {
+        TelemetryPoint voltage, current;
+        if (telemetry->getPoint(chart_tier, TELEMETRY_VOUT, i, &voltage) &&
+            telemetry->getPoint(chart_tier, TELEMETRY_IOUT, i, &current)) {
+            lv_chart_set_next_value(chart, chart_voltage, voltage.avg);
+            lv_chart_set_next_value(chart, chart_current, current.avg);
+        }
+    }
+}
+
+bool PowerController::trendChartPending(void)
+{
+    if (!chart || !telemetry || !chart_panel || lv_obj_has_flag(chart_panel, LV_OBJ_FLAG_HIDDEN)) {
+        return false;
+    }
+    
+    return telemetry->getTotal(chart_tier) != chart_total;
+}
+
+void PowerController::feedTrendChart(void)
+{
+    if (!trendChartPending()) {
+        return;
+    }
+    
+    uint32_t total = telemetry->getTotal(chart_tier);
+    uint32_t added = total - chart_total;
+    size_t count = telemetry->getCount(chart_tier);
+    
+    if (added > CHART_POINTS || added > count) {
+        // 落后太多，整体重新填充
+        reloadTrendChart();
+        return;
+    }
+    
+    // 只追加新的点
+    for (size_t i = count - added; i < count; i++) {
+        TelemetryPoint voltage, current;
+        if (telemetry->getPoint(chart_tier, TELEMETRY_VOUT, i, &voltage) &&
+            telemetry->getPoint(chart_tier, TELEMETRY_IOUT, i, &current)) {
+            lv_chart_set_next_value(chart, chart_voltage, voltage.avg);
+            lv_chart_set_next_value(chart, chart_current, current.avg);
+        }
+    }
+    chart_total = total;
+}
+
+void PowerController::createLinkPanel(void)
+{
+    extern lv_obj_t * ui_PowerController;
+    extern lv_obj_t * ui_PanelPowerValue;
+    
+    if (!modbus_controller || !ui_PowerController) {
+        return;
+    }
+    
+    link_panel = lv_obj_create(ui_PowerController);
+    lv_obj_set_size(link_panel, 470, 200);
+    lv_obj_align(link_panel, LV_ALIGN_TOP_MID, 0, 20);
+    lv_obj_set_style_pad_all(link_panel, 6, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_clear_flag(link_panel, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(link_panel, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_event_cb(link_panel, onLinkPanelClick, LV_EVENT_CLICKED, this);
+    
+    link_label = lv_label_create(link_panel);
+    lv_obj_set_width(link_label, lv_pct(100));
+    lv_obj_align(link_label, LV_ALIGN_TOP_LEFT, 0, 0);
+    
+    if (ui_PanelPowerValue) {
+        lv_obj_add_event_cb(ui_PanelPowerValue, onPowerLongPress, LV_EVENT_LONG_PRESSED, this);
+    }
+}
+
+bool PowerController::linkPanelPending(void)
+{
+    if (!link_panel || lv_obj_has_flag(link_panel, LV_OBJ_FLAG_HIDDEN)) {
+        return false;
+    }
+    
+    return (uint32_t)(esp_timer_get_time() / 1000) - link_refresh_ms >= LINK_PANEL_REFRESH_MS;
+}
+
+void PowerController::updateLinkPanel(void)
+{
+    if (!link_label || !modbus_controller) {
+        return;
+    }
+    
+    ModbusLinkStats stats;
+    modbus_controller->getLinkStats(&stats);
+    link_refresh_ms = esp_timer_get_time() / 1000;
+    
+    // 百分位按直方图区间上限估算
+    uint32_t p50 = ModbusController::linkPercentileUs(stats.complete_hist, 50);
+    uint32_t p95 = ModbusController::linkPercentileUs(stats.complete_hist, 95);
+    uint32_t p99 = ModbusController::linkPercentileUs(stats.complete_hist, 99);
+    uint32_t first_p50 = ModbusController::linkPercentileUs(stats.first_byte_hist, 50);
+    uint32_t first_p95 = ModbusController::linkPercentileUs(stats.first_byte_hist, 95);
+    
+    char text[512];
+    int len = snprintf(text, sizeof(text),
+        "Modbus link (tap to close)\n"
+        "Transactions %lu, ok %lu, retries %lu\n"
+        "Timeout %lu  CRC %lu  Invalid %lu  Overflow %lu  TX %lu\n"
+        "TX %llu B  RX %llu B\n"
+        "Complete p50 <%lu  p95 <%lu  p99 <%lu  max %lu us\n"
+        "First byte p50 <%lu  p95 <%lu  max %lu us\n"
+        "Complete histogram (ms):",
+        (unsigned long)stats.transactions, (unsigned long)stats.ok, (unsigned long)stats.retries,
+        (unsigned long)stats.timeouts, (unsigned long)stats.crc_errors, (unsigned long)stats.invalid_frames,
+        (unsigned long)stats.overflows, (unsigned long)stats.tx_errors,
+        (unsigned long long)stats.tx_bytes, (unsigned long long)stats.rx_bytes,
+        (unsigned long)p50, (unsigned long)p95, (unsigned long)p99, (unsigned long)stats.complete_max_us,
+        (unsigned long)first_p50, (unsigned long)first_p95, (unsigned long)stats.first_byte_max_us);
+    for (size_t i = 0; i < ModbusLinkStats::HIST_BINS && len > 0 && len < (int)sizeof(text); i++) {
+        if (i < ModbusLinkStats::HIST_BINS - 1) {
+            len += snprintf(text + len, sizeof(text) - len, " <%lu:%lu",
+                            (unsigned long)(ModbusController::LINK_HIST_EDGES_US[i] / 1000),
+                            (unsigned long)stats.complete_hist[i]);
+        } else {
+            len += snprintf(text + len, sizeof(text) - len, " more:%lu", (unsigned long)stats.complete_hist[i]);
+        }
+    }
+    lv_label_set_text(link_label, text);
+}
+
+void PowerController::onPowerLongPress(lv_event_t* e)
+{
+    PowerController* controller = (PowerController*)lv_event_get_user_data(e);
+    
+    if (!controller || !controller->link_panel) {
+        return;
+    }
+    
+    controller->updateLinkPanel();
+    lv_obj_clear_flag(controller->link_panel, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_move_foreground(controller->link_panel);
+}
+
+void PowerController::onLinkPanelClick(lv_event_t* e)
+{
+    PowerController* controller = (PowerController*)lv_event_get_user_data(e);
+    
+    if (controller && controller->link_panel) {
+        lv_obj_add_flag(controller->link_panel, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+void PowerController::onReadingClick(lv_event_t* e)
+{
+    PowerController* controller = (PowerController*)lv_event_get_user_data(e);
+    
+    if (!controller || !controller->chart_panel) {
+        return;
+    }
+    
+    controller->chart_tier = TELEMETRY_TIER_RAW;
+    controller->reloadTrendChart();
+    lv_obj_clear_flag(controller->chart_panel, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_move_foreground(controller->chart_panel);
+}
+
+void PowerController::onChartClick(lv_event_t* e)
+{
+    PowerController* controller = (PowerController*)lv_event_get_user_data(e);
+    
+    if (!controller || !controller->chart_panel) {
+        return;
+    }
+    
+    // 每次点击换到更长的时间范围，最后一次关闭
+    if (controller->chart_tier + 1 >= TELEMETRY_TIER_NUM) {
+        lv_obj_add_flag(controller->chart_panel, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    controller->chart_tier = (TelemetryTier)(controller->chart_tier + 1);
+    controller->reloadTrendChart();
+}
+
+void PowerController::startLogging(void)
+{
+#if CONFIG_POWER_CONTROLLER_LOG
+    if (!modbus_controller) {
+        return;
+    }
+    
+    logger = new PowerLogger();
+    if (logger == nullptr) {
+        ESP_LOGW(TAG, "Failed to create logger");
+        return;
+    }
+    
+#if CONFIG_POWER_CONTROLLER_LOG_EXPORT_CSV
+    // 新文件开始之前导出上一次的记录，同名的.CSV
+    char bin_path[48];
+    if (PowerLogger::findLatest(bin_path, sizeof(bin_path))) {
+        char csv_path[48];
+        snprintf(csv_path, sizeof(csv_path), "%.*s.CSV", (int)(strlen(bin_path) - 4), bin_path);
+        PowerLogger::exportCsv(bin_path, csv_path);
+    }
+#endif
+    
+    if (!logger->start(CONFIG_POWER_CONTROLLER_LOG_FLUSH_MS)) {
+        ESP_LOGW(TAG, "⚠️ SD card logging not started");
+        delete logger;
+        logger = nullptr;
+    }
+#endif
+}
+
+void PowerController::startPublishing(void)
+{
+#if CONFIG_POWER_CONTROLLER_MQTT
+    if (!modbus_controller || CONFIG_POWER_CONTROLLER_MQTT_URI[0] == '\0') {
+        return;
+    }
+    
+    publisher = new PowerMqtt();
+    if (publisher == nullptr) {
+        ESP_LOGW(TAG, "Failed to create MQTT publisher");
+        return;
+    }
+    
+    // 没有网络时也能启动，客户端连上后补发SD卡上暂存的批次
+    if (!publisher->start(CONFIG_POWER_CONTROLLER_MQTT_URI, CONFIG_POWER_CONTROLLER_MQTT_TOPIC)) {
+        ESP_LOGW(TAG, "⚠️ MQTT publishing not started");
+        delete publisher;
+        publisher = nullptr;
+    }
+#endif
+}
+
+void PowerController::startHttpApi(void)
+{
+#if CONFIG_POWER_CONTROLLER_HTTP_API
+    if (!modbus_controller) {
+        return;
+    }
+    
+    http_api = new PowerHttpApi(modbus_controller, telemetry);
+    if (http_api == nullptr) {
+        ESP_LOGW(TAG, "Failed to create HTTP API");
+        return;
+    }
+    
+    // 监听所有地址，Wi-Fi连上后即可访问
+    if (!http_api->start(CONFIG_POWER_CONTROLLER_HTTP_API_PORT)) {
+        ESP_LOGW(TAG, "⚠️ HTTP API not started");
+        delete http_api;
+        http_api = nullptr;
+    }
+#endif
+}
+
+void PowerController::onSample(uint8_t slave, const PowerDeviceData& data, void* user_ctx)
+{
+    PowerController* controller = (PowerController*)user_ctx;
+    uint32_t time_ms = esp_timer_get_time() / 1000;
+    
+    if (controller->logger) {
+        controller->logger->addSample(slave, data, time_ms);
+    }
+    if (controller->publisher) {
+        controller->publisher->addSample(slave, data, time_ms);
+    }
+    if (controller->http_api) {
+        controller->http_api->addSample(slave, data);
+    }
+}
+
 void PowerController::runModbusDiagnostic() {
     ESP_LOGI(TAG, "启动Modbus诊断模式...");
     
@@ -903,7 +1361,7 @@ void PowerController::updateTask(void* parameter)
     PowerController* controller = (PowerController*)parameter;
     if (!controller) {
         ESP_LOGE(TAG, "Invalid controller in update task");
-        vTaskDelete(NULL);
+        task_config_delete(TASK_CONFIG_POWER_UPDATE, NULL);
         return;
     }
     
@@ -929,9 +1387,8 @@ void PowerController::updateTask(void* parameter)
         ESP_LOGD(TAG, "🔄 Executing scheduled update...");
         
         if (controller->modbus_controller) {
-            ESP_LOGD(TAG, "📡 Reading device data from XY6506S...");
-            controller->updateDisplayValuesAsync();
-            controller->updateSwitchStates();
+            // 数据已由Modbus工作任务读取，这里只刷新有变化的控件
+            controller->refreshDisplay();
             ESP_LOGD(TAG, "✅ Device data update completed");
         } else {
             ESP_LOGW(TAG, "⚠️ No Modbus controller available for update");
@@ -939,5 +1396,5 @@ void PowerController::updateTask(void* parameter)
     }
     
     ESP_LOGI(TAG, "Update task ending");
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_POWER_UPDATE, NULL);
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "esp_brookesia.hpp"
 #include "ModbusController.hpp"
 #include "ModbusTest.hpp"
+#include "PowerTelemetry.hpp"
+#include "PowerLogger.hpp"
+#include "PowerMqtt.hpp"
+#include "PowerHttpApi.hpp"
+#include "PowerProfile.hpp"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
@@ -42,21 +47,83 @@ private:
     bool is_running;                        // 应用运行状态
     bool update_requested;                  // 更新请求标志
     
+    // 趋势图：点击测量值打开，点击趋势图切换分辨率，显示的点只追加新的
+    static const uint16_t CHART_POINTS = 120;         // 趋势图显示的点数
+    PowerTelemetry* telemetry;              // 遥测时间序列
+    PowerLogger* logger;                    // SD卡记录，未启用时为nullptr
+    PowerMqtt* publisher;                   // MQTT上报，未启用时为nullptr
+    PowerHttpApi* http_api;                 // HTTP远程控制，未启用时为nullptr
+    PowerProfile* profile;                  // 设定值曲线，长按应用按钮从SD卡加载执行
+    lv_obj_t* chart_panel;
+    lv_obj_t* chart_title;
+    lv_obj_t* chart;
+    lv_chart_series_t* chart_voltage;       // 输出电压，主Y轴 (0.01V)
+    lv_chart_series_t* chart_current;       // 输出电流，副Y轴 (mA)
+    TelemetryTier chart_tier;               // 显示的分辨率
+    uint32_t chart_total;                   // 已显示到的总点数
+    
+    // 总线统计面板：长按功率值打开，点击关闭
+    static const uint32_t LINK_PANEL_REFRESH_MS = 1000;
+    lv_obj_t* link_panel;
+    lv_obj_t* link_label;
+    uint32_t link_refresh_ms;               // 上次刷新的时间
+    
+    // 界面刷新：与上次显示的值按显示精度比较，只刷新变化的控件
+    enum DisplayField {
+        FIELD_OUTPUT_VOLTAGE = 0,
+        FIELD_OUTPUT_CURRENT,
+        FIELD_OUTPUT_POWER,
+        FIELD_SET_VOLTAGE,
+        FIELD_SET_CURRENT,
+        FIELD_INPUT_VOLTAGE,
+        FIELD_NUM,
+    };
+    enum DisplaySwitch {
+        SWITCH_POWER = 0,
+        SWITCH_BEEP,
+        SWITCH_KEY_LOCK,
+        SWITCH_SLEEP,
+        SWITCH_NUM,
+    };
+    static const int32_t RENDERED_NONE = INT32_MIN;   // 控件未按设备数据显示过
+    int32_t rendered_values[FIELD_NUM];     // 显示的值，按显示精度换算为整数
+    int8_t rendered_switches[SWITCH_NUM];   // 显示的开关状态，-1为未显示
+    
     // 私有方法
     void setupUIEvents();                   // 设置UI事件处理
-    void updateDisplayValues();             // 更新显示值（完整更新）
+    void refreshDisplay();                  // 有变化时在一次显示锁内刷新界面
+    void invalidateRendered();              // 下次刷新时重写所有控件
+    void updateDisplayValues(const int32_t* values, uint32_t changed);    // 刷新变化的数值，需持有显示锁
     void updateDisplayValuesQuick();        // 快速显示默认值
-    void updateDisplayValuesAsync();        // 异步更新显示值
-    void updateSwitchStates();              // 更新开关状态
+    void updateDisplayValuesAsync();        // 提交一次异步轮询
+    void updateSwitchStates(const int8_t* states, uint32_t changed);      // 刷新变化的开关，需持有显示锁
     bool applyVoltageCurrentSettings();     // 应用电压电流设置
     void runModbusDiagnostic();             // 运行Modbus诊断
+    void startLogging();                    // 开始SD卡记录
+    void startPublishing();                 // 开始MQTT上报
+    void startHttpApi();                    // 启动HTTP远程控制接口
+    void createTrendChart();                // 创建趋势图
+    void reloadTrendChart();                // 重新填充趋势图
+    bool trendChartPending();               // 趋势图是否有新的点
+    void feedTrendChart();                  // 追加新的点，需持有显示锁
+    void createLinkPanel();                 // 创建总线统计面板
+    bool linkPanelPending();                // 总线统计面板是否需要刷新
+    void updateLinkPanel();                 // 刷新总线统计，需持有显示锁
     static void updateTask(void* parameter);// 持久更新任务
     
     // 静态回调函数
     static void updateTimerCallback(TimerHandle_t timer);
     static void onPresetButtonClick(lv_event_t* e);
     static void onApplyButtonClick(lv_event_t* e);
+    static void onApplyButtonLongPress(lv_event_t* e);
     static void onSwitchChanged(lv_event_t* e);
+    static void onReadingClick(lv_event_t* e);
+    static void onChartClick(lv_event_t* e);
+    static void onPowerLongPress(lv_event_t* e);
+    static void onLinkPanelClick(lv_event_t* e);
+    static void onPollDone(bool success, void* user_ctx);     // Modbus工作任务中调用
+    static void onWriteDone(bool success, void* user_ctx);    // Modbus工作任务中调用
+    static void onSample(uint8_t slave, const PowerDeviceData& data, void* user_ctx);     // Modbus工作任务中调用
     
     // 预设值定义
     struct PresetValue {
@@ -66,4 +133,19 @@ private:
     
     static const PresetValue PRESET_VALUES[];
     static const int PRESET_COUNT;
+    
+    // 显示字段定义，按DisplayField/DisplaySwitch顺序
+    struct DisplayFieldInfo {
+        lv_obj_t** label;
+        float PowerDeviceData::* value;
+        float scale;                        // 显示精度的倒数
+        const char* format;
+    };
+    struct DisplaySwitchInfo {
+        lv_obj_t** sw;
+        bool PowerDeviceData::* value;
+    };
+    
+    static const DisplayFieldInfo DISPLAY_FIELDS[FIELD_NUM];
+    static const DisplaySwitchInfo DISPLAY_SWITCHES[SWITCH_NUM];
 };
\ No newline at end of file
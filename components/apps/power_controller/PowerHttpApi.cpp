@@ -0,0 +1,460 @@
+/**
+ * @file PowerHttpApi.cpp
+ * @brief 电源的HTTP/WebSocket远程控制接口实现
+ */
+
+#include "PowerHttpApi.hpp"
+#include "esp_log.h"
+#include "task_config/task_config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/param.h>
+
+static const char *TAG = "PowerHttpApi";
+
+static const uint8_t DEFAULT_SLAVE = 0x01;             // 与ModbusController的默认从机相同
+static const size_t TELEMETRY_CHUNK = 1024;         // 遥测响应每块的大小
+static const size_t TELEMETRY_POINT_LEN = 96;       // 一个点的JSON最长的字节数
+static const char* const TIER_NAMES[TELEMETRY_TIER_NUM] = {"raw", "minute", "hour"};
+
+PowerHttpApi::PowerHttpApi(ModbusController* modbus, const PowerTelemetry* telemetry)
+    : modbus(modbus), telemetry(telemetry), server(nullptr), running(false), stopping(false), push_task(nullptr),
+      push_exit(nullptr) {
+    memset(slots, 0, sizeof(slots));
+    portMUX_INITIALIZE(&lock);
+}
+
+PowerHttpApi::~PowerHttpApi() {
+    stop();
+}
+
+bool PowerHttpApi::start(uint16_t port) {
+    if (running) {
+        ESP_LOGW(TAG, "Already running");
+        return false;
+    }
+
+    push_exit = xSemaphoreCreateBinary();
+    if (push_exit == nullptr) {
+        ESP_LOGE(TAG, "Failed to create semaphore");
+        return false;
+    }
+
+    const task_config_t* httpd_task = task_config_get(TASK_CONFIG_POWER_HTTPD);
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    // 可能与屏幕镜像的服务器同时运行
+    config.ctrl_port = ESP_HTTPD_DEF_CTRL_PORT + 1;
+    config.task_priority = httpd_task->priority;
+    config.stack_size = httpd_task->stack_size;
+    config.core_id = httpd_task->core_id;
+    config.max_open_sockets = MAX_CLIENTS;
+    config.lru_purge_enable = true;
+    // 一个不读数据的客户端最多让推送等待1秒
+    config.send_wait_timeout = 1;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start server on port %u", port);
+        server = nullptr;
+        vSemaphoreDelete(push_exit);
+        push_exit = nullptr;
+        return false;
+    }
+
+    const httpd_uri_t uris[] = {
+        {.uri = "/api/devices", .method = HTTP_GET, .handler = handleDevices, .user_ctx = this},
+        {.uri = "/api/power", .method = HTTP_GET, .handler = handlePowerGet, .user_ctx = this},
+        {.uri = "/api/power", .method = HTTP_POST, .handler = handlePowerPost, .user_ctx = this},
+        {.uri = "/api/telemetry", .method = HTTP_GET, .handler = handleTelemetry, .user_ctx = this},
+        {.uri = "/api/ws", .method = HTTP_GET, .handler = handleWebSocket, .user_ctx = this, .is_websocket = true},
+    };
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        httpd_register_uri_handler(server, &uris[i]);
+    }
+
+    taskENTER_CRITICAL(&lock);
+    memset(slots, 0, sizeof(slots));
+    stopping = false;
+    taskEXIT_CRITICAL(&lock);
+    running = true;
+
+    // 低于Modbus工作任务，客户端的网络延迟不会影响轮询
+    if (task_config_create(TASK_CONFIG_POWER_HTTP, pushTask, this, &push_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create push task");
+        running = false;
+        httpd_stop(server);
+        server = nullptr;
+        vSemaphoreDelete(push_exit);
+        push_exit = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "HTTP API on port %u", port);
+    return true;
+}
+
+void PowerHttpApi::stop() {
+    if (!running) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&lock);
+    stopping = true;
+    taskEXIT_CRITICAL(&lock);
+    xTaskNotifyGive(push_task);
+    if (xSemaphoreTake(push_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+        // 推送任务仍在使用服务器，不能关闭
+        ESP_LOGE(TAG, "Push task did not exit");
+        return;
+    }
+
+    httpd_stop(server);
+    server = nullptr;
+    vSemaphoreDelete(push_exit);
+    push_exit = nullptr;
+    push_task = nullptr;
+    running = false;
+
+    ESP_LOGI(TAG, "HTTP API stopped");
+}
+
+void PowerHttpApi::addSample(uint8_t slave, const PowerDeviceData& data) {
+    if (!running) {
+        return;
+    }
+
+    bool stored = false;
+
+    taskENTER_CRITICAL(&lock);
+    if (!stopping) {
+        // 同一从机未推送的采样被新的覆盖
+        PushSlot* free_slot = nullptr;
+        for (size_t i = 0; i < PUSH_SLOTS; i++) {
+            if (slots[i].used && slots[i].slave == slave) {
+                free_slot = &slots[i];
+                break;
+            }
+            if (!slots[i].used && free_slot == nullptr) {
+                free_slot = &slots[i];
+            }
+        }
+        if (free_slot) {
+            free_slot->used = true;
+            free_slot->dirty = true;
+            free_slot->slave = slave;
+            free_slot->data = data;
+            stored = true;
+        }
+    }
+    taskEXIT_CRITICAL(&lock);
+
+    if (stored) {
+        xTaskNotifyGive(push_task);
+    }
+}
+
+int PowerHttpApi::formatData(char* json, size_t size, uint8_t slave, const PowerDeviceData& data) {
+    return snprintf(json, size,
+                    "{\"slave\":%u,\"valid\":%s,\"voltage\":%.2f,\"current\":%.3f,\"power\":%.2f,\"input\":%.2f,"
+                    "\"set_voltage\":%.2f,\"set_current\":%.3f,\"output\":%s,\"beep\":%s,\"lock\":%s,"
+                    "\"sleep\":%s,\"updated_ms\":%lu}",
+                    slave, data.data_valid ? "true" : "false", data.output_voltage, data.output_current,
+                    data.output_power, data.input_voltage, data.set_voltage, data.set_current,
+                    data.output_switch ? "true" : "false", data.beep_switch ? "true" : "false",
+                    data.key_lock ? "true" : "false", data.sleep_mode ? "true" : "false",
+                    (unsigned long)data.last_update_ms);
+}
+
+bool PowerHttpApi::readParams(httpd_req_t* req, char* params, size_t size) {
+    params[0] = '\0';
+    // 有正文时只用正文，否则用查询串
+    if (req->content_len == 0) {
+        if (httpd_req_get_url_query_len(req) > 0) {
+            httpd_req_get_url_query_str(req, params, size);
+        }
+        return true;
+    }
+    if (req->content_len >= size) {
+        return false;
+    }
+
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, params + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        received += ret;
+    }
+    params[received] = '\0';
+    return true;
+}
+
+uint8_t PowerHttpApi::paramSlave(httpd_req_t* req, const char* params) {
+    char query[PARAMS_LEN] = "";
+    char value[8];
+    // 正文中没有时再找查询串
+    if (httpd_query_key_value(params, "slave", value, sizeof(value)) != ESP_OK &&
+        (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+         httpd_query_key_value(query, "slave", value, sizeof(value)) != ESP_OK)) {
+        return DEFAULT_SLAVE;
+    }
+    int slave = atoi(value);
+    return (slave > 0 && slave <= 247) ? slave : 0;
+}
+
+esp_err_t PowerHttpApi::sendJson(httpd_req_t* req, const char* status, const char* json) {
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, json);
+}
+
+esp_err_t PowerHttpApi::handleDevices(httpd_req_t* req) {
+    PowerHttpApi* api = (PowerHttpApi*)req->user_ctx;
+    char json[JSON_LEN];
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send_chunk(req, "[", 1);
+    bool first = true;
+    size_t remaining = api->modbus->getDeviceCount();
+    for (int slave = 1; slave <= 247 && remaining > 0; slave++) {
+        const PowerDeviceData* device = api->modbus->getDeviceDataByAddress(slave);
+        if (device == nullptr) {
+            continue;
+        }
+        remaining--;
+        // 复制一份，工作任务可能同时在更新
+        PowerDeviceData data = *device;
+        int length = formatData(json + 1, sizeof(json) - 1, slave, data);
+        json[0] = ',';
+        if (httpd_resp_send_chunk(req, first ? json + 1 : json, first ? length : length + 1) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        first = false;
+    }
+    httpd_resp_send_chunk(req, "]", 1);
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
+esp_err_t PowerHttpApi::handlePowerGet(httpd_req_t* req) {
+    PowerHttpApi* api = (PowerHttpApi*)req->user_ctx;
+    char params[PARAMS_LEN] = "";
+    char json[JSON_LEN];
+
+    if (httpd_req_get_url_query_len(req) > 0) {
+        httpd_req_get_url_query_str(req, params, sizeof(params));
+    }
+    uint8_t slave = paramSlave(req, params);
+    const PowerDeviceData* device = api->modbus->getDeviceDataByAddress(slave);
+    if (device == nullptr) {
+        return sendJson(req, "404 Not Found", "{\"error\":\"unknown slave\"}");
+    }
+
+    PowerDeviceData data = *device;
+    formatData(json, sizeof(json), slave, data);
+    return sendJson(req, HTTPD_200, json);
+}
+
+esp_err_t PowerHttpApi::handlePowerPost(httpd_req_t* req) {
+    PowerHttpApi* api = (PowerHttpApi*)req->user_ctx;
+    char params[PARAMS_LEN];
+    char value[16];
+
+    if (!readParams(req, params, sizeof(params))) {
+        return sendJson(req, "400 Bad Request", "{\"error\":\"bad body\"}");
+    }
+    uint8_t slave = paramSlave(req, params);
+    const PowerDeviceData* device = api->modbus->getDeviceDataByAddress(slave);
+    if (device == nullptr) {
+        return sendJson(req, "404 Not Found", "{\"error\":\"unknown slave\"}");
+    }
+    PowerDeviceData data = *device;
+
+    // 只给出电压或电流时，另一个保持当前的设定值
+    bool has_voltage = (httpd_query_key_value(params, "voltage", value, sizeof(value)) == ESP_OK);
+    float voltage = has_voltage ? strtof(value, nullptr) : data.set_voltage;
+    bool has_current = (httpd_query_key_value(params, "current", value, sizeof(value)) == ESP_OK);
+    float current = has_current ? strtof(value, nullptr) : data.set_current;
+    bool has_output = (httpd_query_key_value(params, "output", value, sizeof(value)) == ESP_OK);
+    bool output = false;
+    if (has_output) {
+        if (strcmp(value, "toggle") == 0) {
+            output = !data.output_switch;
+        } else if (strcmp(value, "1") == 0 || strcmp(value, "0") == 0) {
+            output = (value[0] == '1');
+        } else {
+            return sendJson(req, "400 Bad Request", "{\"error\":\"output must be 0, 1 or toggle\"}");
+        }
+    }
+    if (!has_voltage && !has_current && !has_output) {
+        return sendJson(req, "400 Bad Request", "{\"error\":\"nothing to set\"}");
+    }
+    if ((has_voltage || has_current) &&
+        (voltage < 0.0f || voltage > data.input_voltage || !api->modbus->validateCurrent(current))) {
+        return sendJson(req, "400 Bad Request", "{\"error\":\"voltage or current out of range\"}");
+    }
+
+    // 一个写事务，设定和输出开关依次发出。不带回调，工作任务发出前同一组寄存器的多次写入只保留最新值
+    ModbusWriteTransaction transaction = {};
+    if ((has_voltage || has_current) && !api->modbus->addVoltageAndCurrent(&transaction, voltage, current, slave)) {
+        return sendJson(req, "400 Bad Request", "{\"error\":\"voltage or current out of range\"}");
+    }
+    if (has_output) {
+        transaction.set(REG_ONOFF, output ? 1 : 0);
+    }
+    if (!api->modbus->submitTransaction(transaction, nullptr, nullptr, slave)) {
+        return sendJson(req, "503 Service Unavailable", "{\"error\":\"write queue full\"}");
+    }
+
+    return sendJson(req, "202 Accepted", "{\"queued\":true}");
+}
+
+esp_err_t PowerHttpApi::handleTelemetry(httpd_req_t* req) {
+    PowerHttpApi* api = (PowerHttpApi*)req->user_ctx;
+    char params[PARAMS_LEN] = "";
+    char value[16];
+
+    if (api->telemetry == nullptr) {
+        return sendJson(req, "503 Service Unavailable", "{\"error\":\"no telemetry\"}");
+    }
+    if (httpd_req_get_url_query_len(req) > 0) {
+        httpd_req_get_url_query_str(req, params, sizeof(params));
+    }
+    TelemetryTier tier = TELEMETRY_TIER_RAW;
+    if (httpd_query_key_value(params, "tier", value, sizeof(value)) == ESP_OK) {
+        int i = 0;
+        while (i < TELEMETRY_TIER_NUM && strcmp(value, TIER_NAMES[i]) != 0) {
+            i++;
+        }
+        if (i == TELEMETRY_TIER_NUM) {
+            return sendJson(req, "400 Bad Request", "{\"error\":\"tier must be raw, minute or hour\"}");
+        }
+        tier = (TelemetryTier)i;
+    }
+
+    // since之后写入的点中仍在环形缓冲里的部分
+    uint32_t total = api->telemetry->getTotal(tier);
+    size_t count = api->telemetry->getCount(tier);
+    size_t first = 0;
+    if (httpd_query_key_value(params, "since", value, sizeof(value)) == ESP_OK) {
+        uint32_t since = strtoul(value, nullptr, 10);
+        uint32_t fresh = (since < total) ? total - since : 0;
+        first = count - MIN((size_t)fresh, count);
+    }
+
+    char* chunk = (char*)malloc(TELEMETRY_CHUNK);
+    if (chunk == nullptr) {
+        return sendJson(req, "503 Service Unavailable", "{\"error\":\"no memory\"}");
+    }
+    httpd_resp_set_type(req, "application/json");
+    size_t length = snprintf(chunk, TELEMETRY_CHUNK, "{\"tier\":\"%s\",\"total\":%lu,\"points\":[",
+                             TIER_NAMES[tier], (unsigned long)total);
+    esp_err_t ret = ESP_OK;
+    for (size_t i = first; i < count && ret == ESP_OK; i++) {
+        TelemetryPoint points[TELEMETRY_CHANNEL_NUM];
+        bool valid = true;
+        for (int channel = 0; channel < TELEMETRY_CHANNEL_NUM && valid; channel++) {
+            valid = api->telemetry->getPoint(tier, (TelemetryChannel)channel, i, &points[channel]);
+        }
+        if (!valid) {
+            // 读取期间点数减少，只在清空时发生
+            break;
+        }
+        length += snprintf(chunk + length, TELEMETRY_CHUNK - length, "%s[", (i == first) ? "" : ",");
+        for (int channel = 0; channel < TELEMETRY_CHANNEL_NUM; channel++) {
+            length += snprintf(chunk + length, TELEMETRY_CHUNK - length, "%s%u,%u,%u", channel ? "," : "",
+                               points[channel].min, points[channel].max, points[channel].avg);
+        }
+        length += snprintf(chunk + length, TELEMETRY_CHUNK - length, "]");
+        if (length + TELEMETRY_POINT_LEN > TELEMETRY_CHUNK) {
+            ret = httpd_resp_send_chunk(req, chunk, length);
+            length = 0;
+        }
+    }
+    if (ret == ESP_OK) {
+        length += snprintf(chunk + length, TELEMETRY_CHUNK - length, "]}");
+        ret = httpd_resp_send_chunk(req, chunk, length);
+    }
+    free(chunk);
+    if (ret != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
+esp_err_t PowerHttpApi::handleWebSocket(httpd_req_t* req) {
+    if (req->method == HTTP_GET) {
+        ESP_LOGI(TAG, "WebSocket client %d connected", httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    // 客户端发来的消息没有用途，读出后丢弃
+    uint8_t buffer[32];
+    httpd_ws_frame_t frame = {};
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (frame.len > sizeof(buffer)) {
+        return ESP_FAIL;
+    }
+    frame.payload = buffer;
+    return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+void PowerHttpApi::broadcast(const char* json, size_t length) {
+    int fds[MAX_CLIENTS];
+    size_t fd_count = MAX_CLIENTS;
+    if (httpd_get_client_list(server, &fd_count, fds) != ESP_OK) {
+        return;
+    }
+
+    httpd_ws_frame_t frame = {};
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_TEXT;
+    frame.payload = (uint8_t*)json;
+    frame.len = length;
+    for (size_t i = 0; i < fd_count; i++) {
+        if (httpd_ws_get_fd_info(server, fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            continue;
+        }
+        if (httpd_ws_send_frame_async(server, fds[i], &frame) != ESP_OK) {
+            ESP_LOGW(TAG, "WebSocket client %d not responding, closing", fds[i]);
+            httpd_sess_trigger_close(server, fds[i]);
+        }
+    }
+}
+
+void PowerHttpApi::pushTask(void* arg) {
+    PowerHttpApi* api = (PowerHttpApi*)arg;
+    char json[JSON_LEN];
+
+    while (!api->stopping) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // 逐个取出有新采样的从机，推送期间到达的采样只保留最新的
+        for (size_t i = 0; i < PUSH_SLOTS && !api->stopping; i++) {
+            uint8_t slave = 0;
+            PowerDeviceData data;
+            taskENTER_CRITICAL(&api->lock);
+            bool dirty = api->slots[i].used && api->slots[i].dirty;
+            if (dirty) {
+                api->slots[i].dirty = false;
+                slave = api->slots[i].slave;
+                data = api->slots[i].data;
+            }
+            taskEXIT_CRITICAL(&api->lock);
+            if (!dirty) {
+                continue;
+            }
+
+            int length = formatData(json, sizeof(json), slave, data);
+            api->broadcast(json, MIN((size_t)length, sizeof(json) - 1));
+        }
+    }
+
+    xSemaphoreGive(api->push_exit);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file PowerHttpApi.hpp
+ * @brief 电源的HTTP/WebSocket远程控制接口
+ * @details 供实验室自动化脚本使用，写请求进入Modbus异步队列后立即返回，测量值按轮询节奏通过WebSocket推送
+ */
+
+#ifndef POWER_HTTP_API_HPP
+#define POWER_HTTP_API_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_http_server.h"
+#include "ModbusController.hpp"
+#include "PowerTelemetry.hpp"
+
+/**
+ * @brief 电源HTTP接口
+ * @details 接口列表，数值单位为V、A、W，slave省略时为1：
+ *          - GET  /api/devices                           所有从机的测量值，JSON数组
+ *          - GET  /api/power?slave=1                     一台从机的测量值
+ *          - POST /api/power?slave=1                     参数voltage、current、output (0、1或toggle)，可放在查询串
+ *                                                        或x-www-form-urlencoded正文中。立即返回202，尚未发出的
+ *                                                        同一寄存器的写入合并为最新值
+ *          - GET  /api/telemetry?tier=raw&since=N        地址1从机的遥测点，tier为raw、minute或hour，
+ *                                                        since为上次返回的total，只取之后的点
+ *          - GET  /api/ws                                WebSocket，每次轮询到一台从机后推送与/api/power相同的JSON，
+ *                                                        客户端跟不上时只推送最新的值
+ */
+class PowerHttpApi {
+public:
+    /**
+     * @param modbus Modbus控制器，生命周期长于本对象
+     * @param telemetry 遥测时间序列，可为nullptr
+     */
+    PowerHttpApi(ModbusController* modbus, const PowerTelemetry* telemetry);
+    ~PowerHttpApi();
+
+    /**
+     * @brief 启动服务器和推送任务
+     * @param port 端口
+     * @return true 已开始，false 已在运行、端口被占用或内存不足
+     */
+    bool start(uint16_t port);
+
+    /**
+     * @brief 关闭服务器，等待推送任务结束
+     */
+    void stop();
+
+    /**
+     * @brief 提交一次采样给WebSocket推送，不会阻塞，可在Modbus工作任务中调用
+     * @param slave 从机地址
+     * @param data 设备数据
+     */
+    void addSample(uint8_t slave, const PowerDeviceData& data);
+
+private:
+    static const size_t PUSH_SLOTS = 8;                 // 与总线上最多的从机相同
+    static const size_t MAX_CLIENTS = 8;                // 同时连接的客户端
+    static const size_t PARAMS_LEN = 128;
+    static const size_t JSON_LEN = 320;
+    static const uint32_t STOP_WAIT_MS = 2000;
+
+    /**
+     * @brief 一台从机最新的采样，推送任务只取最新值
+     */
+    struct PushSlot {
+        bool used;
+        bool dirty;                 // 有未推送的采样
+        uint8_t slave;
+        PowerDeviceData data;
+    };
+
+    static int formatData(char* json, size_t size, uint8_t slave, const PowerDeviceData& data);
+    static bool readParams(httpd_req_t* req, char* params, size_t size);
+    static uint8_t paramSlave(httpd_req_t* req, const char* params);
+    static esp_err_t sendJson(httpd_req_t* req, const char* status, const char* json);
+    static esp_err_t handleDevices(httpd_req_t* req);
+    static esp_err_t handlePowerGet(httpd_req_t* req);
+    static esp_err_t handlePowerPost(httpd_req_t* req);
+    static esp_err_t handleTelemetry(httpd_req_t* req);
+    static esp_err_t handleWebSocket(httpd_req_t* req);
+    static void pushTask(void* arg);
+    void broadcast(const char* json, size_t length);
+
+    ModbusController* modbus;
+    const PowerTelemetry* telemetry;
+    httpd_handle_t server;
+    PushSlot slots[PUSH_SLOTS];
+    volatile bool running;
+    volatile bool stopping;
+    TaskHandle_t push_task;
+    SemaphoreHandle_t push_exit;
+    portMUX_TYPE lock;              // 保护slots
+};
+
+#endif // POWER_HTTP_API_HPP
@@ -0,0 +1,367 @@
+/**
+ * @file PowerLogger.cpp
+ * @brief 电源测量值的SD卡记录实现
+ */
+
+#include "PowerLogger.hpp"
+#include "crc16_modbus/crc16_modbus.h"
+#include "bsp/esp-bsp.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "task_config/task_config.h"
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define LOG_FILE_FMT    BSP_SD_MOUNT_POINT "/PWR_%04u.BIN"
+
+static const char *TAG = "PowerLogger";
+
+// 文件格式，数据块内的记录不跨越块边界
+static_assert(sizeof(PowerLogRecord) == 16, "PowerLogRecord is part of the file format");
+static_assert(sizeof(PowerLogBlockHeader) == 16, "PowerLogBlockHeader is part of the file format");
+
+static uint16_t toRegister(float value, float scale) {
+    float reg = roundf(value * scale);
+    if (reg < 0.0f) {
+        return 0;
+    }
+    if (reg > 65535.0f) {
+        return 65535;
+    }
+    return (uint16_t)reg;
+}
+
+// 编号最大的记录文件，没有时返回false
+static bool latestFileIndex(unsigned int* latest) {
+    bool found = false;
+    DIR *dir = opendir(BSP_SD_MOUNT_POINT);
+
+    if (dir == NULL) {
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int index = 0;
+        if ((sscanf(entry->d_name, "PWR_%4u", &index) == 1) && (!found || index > *latest)) {
+            *latest = index;
+            found = true;
+        }
+    }
+    closedir(dir);
+
+    return found;
+}
+
+PowerLogger::PowerLogger()
+    : active(0), active_count(0), sealed(-1), sequence(0), flush_ms(0), fp(nullptr), logging(false),
+      stopping(false), write_failed(false), writer_task(nullptr), writer_exit(nullptr) {
+    buffers[0] = nullptr;
+    buffers[1] = nullptr;
+    path[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+    portMUX_INITIALIZE(&lock);
+}
+
+PowerLogger::~PowerLogger() {
+    stop();
+}
+
+bool PowerLogger::start(uint32_t flush_ms) {
+    if (logging) {
+        ESP_LOGW(TAG, "Already logging to %s", path);
+        return false;
+    }
+
+    // SD卡直接DMA读写这两块缓冲，不经过FATFS的中转
+    for (int i = 0; i < 2; i++) {
+        buffers[i] = (uint8_t*)heap_caps_aligned_alloc(4, BLOCK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        if (buffers[i] == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate block buffers");
+            free(buffers[0]);
+            buffers[0] = nullptr;
+            return false;
+        }
+    }
+
+    unsigned int index = 0;
+    if (latestFileIndex(&index)) {
+        index++;
+    }
+    snprintf(path, sizeof(path), LOG_FILE_FMT, index);
+    fp = fopen(path, "wb");
+    if (fp == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", path);
+        goto err;
+    }
+    // 每次写入都是完整的数据块，不需要stdio缓冲
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    writer_exit = xSemaphoreCreateBinary();
+    if (writer_exit == nullptr) {
+        goto err;
+    }
+
+    this->flush_ms = flush_ms;
+    active = 0;
+    active_count = 0;
+    sealed = -1;
+    sequence = 0;
+    write_failed = false;
+    stopping = false;
+    memset(&stats, 0, sizeof(stats));
+    logging = true;
+
+    // 低于Modbus工作任务，文件系统的延迟不会影响轮询
+    if (task_config_create(TASK_CONFIG_POWER_LOG, writerTask, this, &writer_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        logging = false;
+        goto err;
+    }
+
+    ESP_LOGI(TAG, "Logging to %s", path);
+    return true;
+
+err:
+    if (writer_exit) {
+        vSemaphoreDelete(writer_exit);
+        writer_exit = nullptr;
+    }
+    if (fp) {
+        fclose(fp);
+        fp = nullptr;
+    }
+    for (int i = 0; i < 2; i++) {
+        free(buffers[i]);
+        buffers[i] = nullptr;
+    }
+    return false;
+}
+
+void PowerLogger::stop() {
+    if (!logging) {
+        return;
+    }
+
+    // 此后的采样直接丢弃，写入任务写完剩余的记录后退出
+    taskENTER_CRITICAL(&lock);
+    stopping = true;
+    taskEXIT_CRITICAL(&lock);
+    xTaskNotifyGive(writer_task);
+    if (xSemaphoreTake(writer_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+        // 写入任务仍在使用缓冲，不能释放
+        ESP_LOGE(TAG, "Writer task did not exit");
+        return;
+    }
+
+    vSemaphoreDelete(writer_exit);
+    writer_exit = nullptr;
+    writer_task = nullptr;
+    for (int i = 0; i < 2; i++) {
+        free(buffers[i]);
+        buffers[i] = nullptr;
+    }
+    logging = false;
+
+    ESP_LOGI(TAG, "Logging stopped: %lu records in %lu blocks, %lu dropped", (unsigned long)stats.records,
+             (unsigned long)stats.blocks, (unsigned long)stats.dropped);
+}
+
+void PowerLogger::addSample(uint8_t slave, const PowerDeviceData& data, uint32_t time_ms) {
+    if (!logging) {
+        return;
+    }
+
+    PowerLogRecord record = {
+        .time_ms = time_ms,
+        .output_voltage = toRegister(data.output_voltage, 100.0f),
+        .output_current = toRegister(data.output_current, 1000.0f),
+        .output_power = toRegister(data.output_power, 100.0f),
+        .input_voltage = toRegister(data.input_voltage, 100.0f),
+        .slave = slave,
+        .flags = (uint8_t)((data.output_switch ? FLAG_OUTPUT_ON : 0) | (data.sleep_mode ? FLAG_SLEEP : 0)),
+        .reserved = 0,
+    };
+    bool notify = false;
+
+    taskENTER_CRITICAL(&lock);
+    if (stopping) {
+        taskEXIT_CRITICAL(&lock);
+        return;
+    }
+    if (write_failed || active_count >= RECORDS_PER_BLOCK) {
+        // 两块缓冲都满了，SD卡跟不上
+        stats.dropped++;
+        taskEXIT_CRITICAL(&lock);
+        return;
+    }
+    memcpy(buffers[active] + sizeof(PowerLogBlockHeader) + active_count * sizeof(PowerLogRecord), &record,
+           sizeof(record));
+    active_count++;
+    if (active_count == RECORDS_PER_BLOCK && sealed < 0) {
+        sealActive();
+        notify = true;
+    }
+    taskEXIT_CRITICAL(&lock);
+
+    if (notify) {
+        xTaskNotifyGive(writer_task);
+    }
+}
+
+void PowerLogger::getStats(Stats* stats) const {
+    taskENTER_CRITICAL(&lock);
+    *stats = this->stats;
+    taskEXIT_CRITICAL(&lock);
+}
+
+// 调用者持有lock，把正在填充的缓冲交给写入任务
+void PowerLogger::sealActive() {
+    ((PowerLogBlockHeader*)buffers[active])->count = active_count;
+    sealed = active;
+    active ^= 1;
+    active_count = 0;
+}
+
+void PowerLogger::writeBlock(uint8_t* block) {
+    PowerLogBlockHeader* header = (PowerLogBlockHeader*)block;
+    uint8_t* records = block + sizeof(PowerLogBlockHeader);
+    size_t records_size = header->count * sizeof(PowerLogRecord);
+
+    header->magic = BLOCK_MAGIC;
+    header->sequence = sequence;
+    header->first_time_ms = ((const PowerLogRecord*)records)->time_ms;
+    header->crc = crc16_modbus(records, records_size);
+    memset(records + records_size, 0, BLOCK_SIZE - sizeof(PowerLogBlockHeader) - records_size);
+
+    bool success = !write_failed && fwrite(block, 1, BLOCK_SIZE, fp) == BLOCK_SIZE;
+    if (success && (sequence + 1) % FSYNC_BLOCKS == 0) {
+        success = fsync(fileno(fp)) == 0;
+    }
+    if (!success && !write_failed) {
+        ESP_LOGE(TAG, "Failed to write %s, logging stopped", path);
+    }
+
+    taskENTER_CRITICAL(&lock);
+    if (success) {
+        stats.records += header->count;
+        stats.blocks++;
+    } else {
+        stats.dropped += header->count;
+        write_failed = true;
+    }
+    taskEXIT_CRITICAL(&lock);
+    sequence++;
+}
+
+void PowerLogger::writerTask(void* arg) {
+    PowerLogger* logger = (PowerLogger*)arg;
+
+    while (true) {
+        // 数据块写满时被通知，采样稀疏时等到超时把不满的块也写入
+        uint32_t notified = logger->stopping ? 1 : ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(logger->flush_ms));
+
+        taskENTER_CRITICAL(&logger->lock);
+        bool stopping = logger->stopping;
+        if (logger->sealed < 0 && logger->active_count > 0 && (notified == 0 || stopping)) {
+            logger->sealActive();
+        }
+        int8_t block = logger->sealed;
+        taskEXIT_CRITICAL(&logger->lock);
+
+        if (block >= 0) {
+            logger->writeBlock(logger->buffers[block]);
+
+            taskENTER_CRITICAL(&logger->lock);
+            logger->sealed = -1;
+            // 写入期间另一块缓冲已经填满
+            bool full = logger->active_count == RECORDS_PER_BLOCK;
+            if (full) {
+                logger->sealActive();
+            }
+            taskEXIT_CRITICAL(&logger->lock);
+            if (full) {
+                xTaskNotifyGive(logger->writer_task);
+            }
+            continue;
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    fsync(fileno(logger->fp));
+    fclose(logger->fp);
+    logger->fp = nullptr;
+    xSemaphoreGive(logger->writer_exit);
+    task_config_delete(TASK_CONFIG_POWER_LOG, NULL);
+}
+
+bool PowerLogger::findLatest(char* bin_path, size_t size) {
+    unsigned int index = 0;
+
+    if (!latestFileIndex(&index)) {
+        return false;
+    }
+    snprintf(bin_path, size, LOG_FILE_FMT, index);
+
+    return true;
+}
+
+bool PowerLogger::exportCsv(const char* bin_path, const char* csv_path) {
+    bool success = false;
+    uint32_t rows = 0;
+    uint32_t bad_blocks = 0;
+    FILE* out = nullptr;
+    FILE* in = fopen(bin_path, "rb");
+    uint8_t* block = (uint8_t*)malloc(BLOCK_SIZE);
+
+    if (in == nullptr || block == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", bin_path);
+        goto end;
+    }
+    out = fopen(csv_path, "w");
+    if (out == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", csv_path);
+        goto end;
+    }
+
+    fprintf(out, "time_s,slave,output_voltage_v,output_current_a,output_power_w,input_voltage_v,output_on\n");
+    while (fread(block, 1, BLOCK_SIZE, in) == BLOCK_SIZE) {
+        const PowerLogBlockHeader* header = (const PowerLogBlockHeader*)block;
+        const PowerLogRecord* records = (const PowerLogRecord*)(block + sizeof(PowerLogBlockHeader));
+
+        // 掉电时写了一半的块
+        if (header->magic != BLOCK_MAGIC || header->count > RECORDS_PER_BLOCK ||
+            header->crc != crc16_modbus((const uint8_t*)records, header->count * sizeof(PowerLogRecord))) {
+            bad_blocks++;
+            continue;
+        }
+        for (uint16_t i = 0; i < header->count; i++) {
+            const PowerLogRecord& r = records[i];
+            fprintf(out, "%lu.%03lu,%u,%u.%02u,%u.%03u,%u.%02u,%u.%02u,%u\n",
+                    (unsigned long)(r.time_ms / 1000), (unsigned long)(r.time_ms % 1000), r.slave,
+                    r.output_voltage / 100, r.output_voltage % 100, r.output_current / 1000,
+                    r.output_current % 1000, r.output_power / 100, r.output_power % 100,
+                    r.input_voltage / 100, r.input_voltage % 100, (r.flags & FLAG_OUTPUT_ON) ? 1 : 0);
+            rows++;
+        }
+    }
+    success = ferror(in) == 0 && ferror(out) == 0;
+    ESP_LOGI(TAG, "Exported %lu rows to %s, %lu bad blocks skipped", (unsigned long)rows, csv_path,
+             (unsigned long)bad_blocks);
+
+end:
+    if (out) {
+        success = (fclose(out) == 0) && success;
+    }
+    if (in) {
+        fclose(in);
+    }
+    free(block);
+
+    return success;
+}
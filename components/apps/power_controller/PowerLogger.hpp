@@ -0,0 +1,140 @@
+/**
+ * @file PowerLogger.hpp
+ * @brief 电源测量值的SD卡记录
+ * @details 采样写入双缓冲的定长数据块，由单独的任务写入SD卡，Modbus工作任务从不等待文件操作
+ */
+
+#ifndef POWER_LOGGER_HPP
+#define POWER_LOGGER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "ModbusController.hpp"
+
+/**
+ * @brief 一条记录，数值与寄存器单位一致，小端
+ */
+struct __attribute__((packed)) PowerLogRecord {
+    uint32_t time_ms;           // 开机后的时间
+    uint16_t output_voltage;    // ÷100 = V
+    uint16_t output_current;    // ÷1000 = A
+    uint16_t output_power;      // ÷100 = W
+    uint16_t input_voltage;     // ÷100 = V
+    uint8_t slave;              // 从机地址
+    uint8_t flags;              // PowerLogger::FLAG_*
+    uint16_t reserved;
+};
+
+/**
+ * @brief 数据块头，每个数据块BLOCK_SIZE字节，按块号和起始时间即可定位
+ */
+struct __attribute__((packed)) PowerLogBlockHeader {
+    uint32_t magic;             // PowerLogger::BLOCK_MAGIC
+    uint32_t sequence;          // 文件内的块号，从0开始
+    uint32_t first_time_ms;     // 第一条记录的时间
+    uint16_t count;             // 有效记录数，定时刷新的块不满
+    uint16_t crc;               // 有效记录的CRC16/Modbus
+};
+
+/**
+ * @brief 电源测量值记录器
+ * @details 文件为BSP_SD_MOUNT_POINT下的PWR_xxxx.BIN，由连续的定长数据块组成
+ */
+class PowerLogger {
+public:
+    static const size_t BLOCK_SIZE = 4096;              // 与SD卡簇对齐
+    static const size_t RECORDS_PER_BLOCK = (BLOCK_SIZE - sizeof(PowerLogBlockHeader)) / sizeof(PowerLogRecord);
+    static const uint32_t BLOCK_MAGIC = 0x474C5750;     // "PWLG"
+    static const uint8_t FLAG_OUTPUT_ON = 0x01;
+    static const uint8_t FLAG_SLEEP = 0x02;
+
+    /**
+     * @brief 记录统计
+     */
+    struct Stats {
+        uint32_t records;           // 已写入的记录
+        uint32_t blocks;            // 已写入的数据块
+        uint32_t dropped;           // 写入跟不上或出错时丢弃的记录
+    };
+
+    PowerLogger();
+    ~PowerLogger();
+
+    /**
+     * @brief 创建新的记录文件并启动写入任务
+     * @param flush_ms 不满的数据块最长等待多久写入，限制掉电时丢失的数据
+     * @return true 已开始，false 已在记录、没有SD卡或内存不足
+     */
+    bool start(uint32_t flush_ms);
+
+    /**
+     * @brief 写入剩余的记录并关闭文件，等待写入任务结束
+     */
+    void stop();
+
+    bool isLogging() const { return logging; }
+
+    /**
+     * @brief 记录一次采样，不会阻塞，可在Modbus工作任务中调用
+     * @param slave 从机地址
+     * @param data 设备数据
+     * @param time_ms 采样时间
+     */
+    void addSample(uint8_t slave, const PowerDeviceData& data, uint32_t time_ms);
+
+    /**
+     * @brief 获取当前或上一次记录的统计
+     */
+    void getStats(Stats* stats) const;
+
+    /**
+     * @brief 获取当前或上一次记录的文件
+     */
+    const char* getPath() const { return path; }
+
+    /**
+     * @brief 把记录文件导出为CSV，CRC错误的数据块被跳过
+     * @param bin_path 记录文件
+     * @param csv_path CSV文件
+     * @return true 导出成功，false 文件无法打开或写入失败
+     */
+    static bool exportCsv(const char* bin_path, const char* csv_path);
+
+    /**
+     * @brief 查找编号最大的记录文件
+     * @param bin_path 输出路径
+     * @param size bin_path的大小
+     * @return true 找到，false SD卡上没有记录文件
+     */
+    static bool findLatest(char* bin_path, size_t size);
+
+private:
+    static const uint32_t FSYNC_BLOCKS = 8;             // 每写入多少块同步一次文件系统
+    static const uint32_t STOP_WAIT_MS = 2000;
+
+    void sealActive();
+    void writeBlock(uint8_t* block);
+    static void writerTask(void* arg);
+
+    uint8_t* buffers[2];
+    uint8_t active;                 // 正在填充的缓冲
+    uint16_t active_count;          // 正在填充的缓冲中的记录数
+    int8_t sealed;                  // 交给写入任务的缓冲，-1为没有
+    uint32_t sequence;
+    uint32_t flush_ms;
+    FILE* fp;
+    char path[48];
+    Stats stats;
+    volatile bool logging;
+    volatile bool stopping;
+    bool write_failed;
+    TaskHandle_t writer_task;
+    SemaphoreHandle_t writer_exit;
+    mutable portMUX_TYPE lock;      // 保护缓冲状态和统计
+};
+
+#endif // POWER_LOGGER_HPP
@@ -0,0 +1,428 @@
+/**
+ * @file PowerMqtt.cpp
+ * @brief 电源测量值和系统状态的MQTT上报实现
+ */
+
+#include "PowerMqtt.hpp"
+#include "bsp/esp-bsp.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_wifi.h"
+#include "task_config/task_config.h"
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+
+#define SPOOL_PATH      BSP_SD_MOUNT_POINT "/MQTT.SPL"
+
+static const char *TAG = "PowerMqtt";
+
+// CBOR主类型 (RFC 8949)
+static const uint8_t CBOR_UINT = 0;
+static const uint8_t CBOR_NEGINT = 1;
+static const uint8_t CBOR_TEXT = 3;
+static const uint8_t CBOR_ARRAY = 4;
+static const uint8_t CBOR_MAP = 5;
+static const uint8_t SAMPLE_FIELDS = 7;
+static const time_t TIME_VALID_MIN = 1600000000;    // 早于此时间说明还没有对时
+static const size_t SPOOL_LENGTH_SIZE = 2;          // 暂存文件中每批前的小端长度
+
+static uint16_t toRegister(float value, float scale) {
+    float reg = roundf(value * scale);
+    if (reg < 0.0f) {
+        return 0;
+    }
+    if (reg > 65535.0f) {
+        return 65535;
+    }
+    return (uint16_t)reg;
+}
+
+// 最短的头部编码，整数按大端
+static uint8_t* cborHead(uint8_t* p, uint8_t major, uint32_t value) {
+    major <<= 5;
+    if (value < 24) {
+        *p++ = major | value;
+    } else if (value <= 0xff) {
+        *p++ = major | 24;
+        *p++ = value;
+    } else if (value <= 0xffff) {
+        *p++ = major | 25;
+        *p++ = value >> 8;
+        *p++ = value;
+    } else {
+        *p++ = major | 26;
+        *p++ = value >> 24;
+        *p++ = value >> 16;
+        *p++ = value >> 8;
+        *p++ = value;
+    }
+    return p;
+}
+
+static uint8_t* cborInt(uint8_t* p, int32_t value) {
+    return (value >= 0) ? cborHead(p, CBOR_UINT, value) : cborHead(p, CBOR_NEGINT, (uint32_t)(-1 - value));
+}
+
+// 键都是单个字符
+static uint8_t* cborKey(uint8_t* p, char key) {
+    p = cborHead(p, CBOR_TEXT, 1);
+    *p++ = key;
+    return p;
+}
+
+PowerMqtt::PowerMqtt()
+    : queue(nullptr), queue_head(0), queue_count(0), batch(nullptr), payload(nullptr), payload_size(0),
+      client(nullptr), spool_pending(false), spool_read_pos(0), running(false), connected(false), stopping(false),
+      publisher_task(nullptr), publisher_exit(nullptr) {
+    topic[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+    portMUX_INITIALIZE(&lock);
+}
+
+PowerMqtt::~PowerMqtt() {
+    stop();
+}
+
+bool PowerMqtt::start(const char* uri, const char* topic) {
+    if (running) {
+        ESP_LOGW(TAG, "Already publishing to %s", this->topic);
+        return false;
+    }
+
+    // 队列和批次只由CPU访问，放在PSRAM
+    queue = (PowerLogRecord*)heap_caps_malloc(CONFIG_POWER_CONTROLLER_MQTT_QUEUE * sizeof(PowerLogRecord),
+                                              MALLOC_CAP_SPIRAM);
+    batch = (PowerLogRecord*)heap_caps_malloc(CONFIG_POWER_CONTROLLER_MQTT_BATCH * sizeof(PowerLogRecord),
+                                              MALLOC_CAP_SPIRAM);
+    payload_size = HEADER_SIZE_MAX + CONFIG_POWER_CONTROLLER_MQTT_BATCH * SAMPLE_SIZE_MAX;
+    payload = (uint8_t*)heap_caps_malloc(payload_size, MALLOC_CAP_SPIRAM);
+    publisher_exit = xSemaphoreCreateBinary();
+    if (queue == nullptr || batch == nullptr || payload == nullptr || publisher_exit == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate the queue");
+        goto err;
+    }
+
+    {
+        const task_config_t* client_task = task_config_get(TASK_CONFIG_POWER_MQTT_CLIENT);
+        esp_mqtt_client_config_t config = {};
+        config.broker.address.uri = uri;
+        config.task.priority = client_task->priority;
+        config.task.stack_size = client_task->stack_size;
+        client = esp_mqtt_client_init(&config);
+    }
+    if (client == nullptr) {
+        ESP_LOGE(TAG, "Failed to create the client for %s", uri);
+        goto err;
+    }
+    esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, onMqttEvent, this);
+
+    strlcpy(this->topic, topic, sizeof(this->topic));
+    queue_head = 0;
+    queue_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    // 上次开机断线时暂存的批次也会补发
+    struct stat st;
+    spool_pending = (stat(SPOOL_PATH, &st) == 0);
+    spool_read_pos = 0;
+    connected = false;
+    stopping = false;
+    running = true;
+
+    // 低于Modbus工作任务，网络和文件系统的延迟不会影响轮询
+    if (task_config_create(TASK_CONFIG_POWER_MQTT, publisherTask, this, &publisher_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create publisher task");
+        running = false;
+        goto err;
+    }
+    if (esp_mqtt_client_start(client) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the client");
+        stop();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Publishing to %s on %s", this->topic, uri);
+    return true;
+
+err:
+    if (client) {
+        esp_mqtt_client_destroy(client);
+        client = nullptr;
+    }
+    if (publisher_exit) {
+        vSemaphoreDelete(publisher_exit);
+        publisher_exit = nullptr;
+    }
+    heap_caps_free(payload);
+    payload = nullptr;
+    heap_caps_free(batch);
+    batch = nullptr;
+    heap_caps_free(queue);
+    queue = nullptr;
+    return false;
+}
+
+void PowerMqtt::stop() {
+    if (!running) {
+        return;
+    }
+
+    // 此后的采样直接丢弃，发布任务发完队列中的采样后退出，断线时写入SD卡
+    taskENTER_CRITICAL(&lock);
+    stopping = true;
+    taskEXIT_CRITICAL(&lock);
+    xTaskNotifyGive(publisher_task);
+    if (xSemaphoreTake(publisher_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+        // 发布任务仍在使用缓冲，不能释放
+        ESP_LOGE(TAG, "Publisher task did not exit");
+        return;
+    }
+
+    esp_mqtt_client_destroy(client);
+    client = nullptr;
+    vSemaphoreDelete(publisher_exit);
+    publisher_exit = nullptr;
+    publisher_task = nullptr;
+    heap_caps_free(payload);
+    payload = nullptr;
+    heap_caps_free(batch);
+    batch = nullptr;
+    heap_caps_free(queue);
+    queue = nullptr;
+    connected = false;
+    running = false;
+
+    ESP_LOGI(TAG, "Publishing stopped: %lu batches published, %lu spooled, %lu replayed, %lu samples dropped",
+             (unsigned long)stats.published, (unsigned long)stats.spooled, (unsigned long)stats.replayed,
+             (unsigned long)stats.dropped);
+}
+
+void PowerMqtt::addSample(uint8_t slave, const PowerDeviceData& data, uint32_t time_ms) {
+    if (!running) {
+        return;
+    }
+
+    PowerLogRecord record = {
+        .time_ms = time_ms,
+        .output_voltage = toRegister(data.output_voltage, 100.0f),
+        .output_current = toRegister(data.output_current, 1000.0f),
+        .output_power = toRegister(data.output_power, 100.0f),
+        .input_voltage = toRegister(data.input_voltage, 100.0f),
+        .slave = slave,
+        .flags = (uint8_t)((data.output_switch ? PowerLogger::FLAG_OUTPUT_ON : 0) |
+                           (data.sleep_mode ? PowerLogger::FLAG_SLEEP : 0)),
+        .reserved = 0,
+    };
+    bool notify = false;
+
+    taskENTER_CRITICAL(&lock);
+    if (stopping) {
+        taskEXIT_CRITICAL(&lock);
+        return;
+    }
+    if (queue_count >= CONFIG_POWER_CONTROLLER_MQTT_QUEUE) {
+        // 发布任务跟不上
+        stats.dropped++;
+        taskEXIT_CRITICAL(&lock);
+        return;
+    }
+    queue[(queue_head + queue_count) % CONFIG_POWER_CONTROLLER_MQTT_QUEUE] = record;
+    queue_count++;
+    notify = (queue_count == CONFIG_POWER_CONTROLLER_MQTT_BATCH);
+    taskEXIT_CRITICAL(&lock);
+
+    if (notify) {
+        xTaskNotifyGive(publisher_task);
+    }
+}
+
+void PowerMqtt::getStats(Stats* stats) const {
+    taskENTER_CRITICAL(&lock);
+    *stats = this->stats;
+    taskEXIT_CRITICAL(&lock);
+}
+
+size_t PowerMqtt::encodeBatch(const PowerLogRecord* records, size_t count) {
+    uint8_t* p = payload;
+    wifi_ap_record_t ap = {};
+    int32_t rssi = (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) ? ap.rssi : 0;
+    time_t now = time(NULL);
+
+    p = cborHead(p, CBOR_MAP, 4);
+    p = cborKey(p, 't');
+    p = cborHead(p, CBOR_UINT, records[0].time_ms);
+    p = cborKey(p, 'w');
+    p = cborHead(p, CBOR_UINT, (now >= TIME_VALID_MIN) ? (uint32_t)now : 0);
+    p = cborKey(p, 'h');
+    p = cborHead(p, CBOR_ARRAY, 4);
+    p = cborHead(p, CBOR_UINT, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    p = cborHead(p, CBOR_UINT, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    p = cborHead(p, CBOR_UINT, heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    p = cborInt(p, rssi);
+    p = cborKey(p, 's');
+    p = cborHead(p, CBOR_ARRAY, count);
+    for (size_t i = 0; i < count; i++) {
+        const PowerLogRecord& r = records[i];
+        p = cborHead(p, CBOR_ARRAY, SAMPLE_FIELDS);
+        p = cborHead(p, CBOR_UINT, r.time_ms - records[0].time_ms);
+        p = cborHead(p, CBOR_UINT, r.slave);
+        p = cborHead(p, CBOR_UINT, r.output_voltage);
+        p = cborHead(p, CBOR_UINT, r.output_current);
+        p = cborHead(p, CBOR_UINT, r.output_power);
+        p = cborHead(p, CBOR_UINT, r.input_voltage);
+        p = cborHead(p, CBOR_UINT, r.flags);
+    }
+
+    return p - payload;
+}
+
+bool PowerMqtt::publish(const uint8_t* payload, size_t size) {
+    // QoS 1，连接断开时未确认的批次由客户端重发
+    if (esp_mqtt_client_publish(client, topic, (const char*)payload, size, 1, 0) < 0) {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&lock);
+    stats.published++;
+    taskEXIT_CRITICAL(&lock);
+    return true;
+}
+
+void PowerMqtt::spool(const uint8_t* payload, size_t size, size_t count) {
+    bool success = false;
+    struct stat st;
+    size_t spool_size = (stat(SPOOL_PATH, &st) == 0) ? st.st_size : 0;
+
+    // 超过上限后丢弃新的批次，保留断线开始时的数据
+    if (spool_size + SPOOL_LENGTH_SIZE + size <= CONFIG_POWER_CONTROLLER_MQTT_SPOOL_KB * 1024) {
+        FILE* fp = fopen(SPOOL_PATH, "ab");
+        if (fp) {
+            uint8_t length[SPOOL_LENGTH_SIZE] = {(uint8_t)(size & 0xff), (uint8_t)(size >> 8)};
+            success = fwrite(length, 1, sizeof(length), fp) == sizeof(length) && fwrite(payload, 1, size, fp) == size;
+            success = (fclose(fp) == 0) && success;
+        }
+    }
+
+    taskENTER_CRITICAL(&lock);
+    if (success) {
+        stats.spooled++;
+    } else {
+        stats.dropped += count;
+    }
+    taskEXIT_CRITICAL(&lock);
+    spool_pending = spool_pending || success;
+}
+
+void PowerMqtt::replay() {
+    bool done = true;
+    FILE* fp = fopen(SPOOL_PATH, "rb");
+
+    if (fp == nullptr) {
+        spool_pending = false;
+        return;
+    }
+
+    if (fseek(fp, spool_read_pos, SEEK_SET) == 0) {
+        for (uint32_t i = 0; i < REPLAY_BATCHES; i++) {
+            uint8_t length[SPOOL_LENGTH_SIZE];
+            if (fread(length, 1, sizeof(length), fp) != sizeof(length)) {
+                break;
+            }
+            // 掉电时写了一半的批次，之后的内容不可信
+            size_t size = length[0] | (length[1] << 8);
+            if (size > payload_size || fread(payload, 1, size, fp) != size) {
+                ESP_LOGW(TAG, "Truncated batch in %s, rest of the spool dropped", SPOOL_PATH);
+                break;
+            }
+            if (!connected || !publish(payload, size)) {
+                done = false;
+                break;
+            }
+            spool_read_pos = ftell(fp);
+            taskENTER_CRITICAL(&lock);
+            stats.replayed++;
+            taskEXIT_CRITICAL(&lock);
+            // 留给新的采样，剩下的下一批之前再补发
+            done = (i + 1 < REPLAY_BATCHES);
+        }
+    }
+    fclose(fp);
+
+    if (done) {
+        remove(SPOOL_PATH);
+        spool_read_pos = 0;
+        spool_pending = false;
+    }
+}
+
+void PowerMqtt::publisherTask(void* arg) {
+    PowerMqtt* mqtt = (PowerMqtt*)arg;
+
+    while (true) {
+        // 攒够一批时被通知，采样稀疏时等到超时把不满的一批也发出
+        uint32_t notified = mqtt->stopping ? 1 :
+                            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_POWER_CONTROLLER_MQTT_BATCH_MS));
+        bool stopping = mqtt->stopping;
+
+        // 先补发断线期间的批次，服务器按时间顺序收到
+        if (mqtt->connected && mqtt->spool_pending) {
+            mqtt->replay();
+        }
+
+        size_t count = 0;
+        bool more = false;
+        taskENTER_CRITICAL(&mqtt->lock);
+        if (mqtt->queue_count >= CONFIG_POWER_CONTROLLER_MQTT_BATCH || notified == 0 || stopping) {
+            count = MIN(mqtt->queue_count, (size_t)CONFIG_POWER_CONTROLLER_MQTT_BATCH);
+            for (size_t i = 0; i < count; i++) {
+                mqtt->batch[i] = mqtt->queue[(mqtt->queue_head + i) % CONFIG_POWER_CONTROLLER_MQTT_QUEUE];
+            }
+            mqtt->queue_head = (mqtt->queue_head + count) % CONFIG_POWER_CONTROLLER_MQTT_QUEUE;
+            mqtt->queue_count -= count;
+            more = mqtt->queue_count >= CONFIG_POWER_CONTROLLER_MQTT_BATCH;
+        }
+        taskEXIT_CRITICAL(&mqtt->lock);
+
+        if (count > 0) {
+            size_t size = mqtt->encodeBatch(mqtt->batch, count);
+            if (!mqtt->connected || !mqtt->publish(mqtt->payload, size)) {
+                mqtt->spool(mqtt->payload, size, count);
+            }
+            // 发布期间又攒够了一批
+            if (more) {
+                xTaskNotifyGive(mqtt->publisher_task);
+            }
+            continue;
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    xSemaphoreGive(mqtt->publisher_exit);
+    task_config_delete(TASK_CONFIG_POWER_MQTT, NULL);
+}
+
+void PowerMqtt::onMqttEvent(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data) {
+    PowerMqtt* mqtt = (PowerMqtt*)handler_args;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "Connected");
+        mqtt->connected = true;
+        // 不必等到下一批，马上开始补发
+        xTaskNotifyGive(mqtt->publisher_task);
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        if (mqtt->connected) {
+            ESP_LOGW(TAG, "Disconnected, batches are spooled to the SD card");
+        }
+        mqtt->connected = false;
+        break;
+    default:
+        break;
+    }
+}
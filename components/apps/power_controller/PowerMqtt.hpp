@@ -0,0 +1,104 @@
+/**
+ * @file PowerMqtt.hpp
+ * @brief 电源测量值和系统状态的MQTT上报
+ * @details 采样进入定长队列，由单独的任务按批编码为CBOR发布，断线期间的批次暂存到SD卡，Modbus工作任务从不等待网络
+ */
+
+#ifndef POWER_MQTT_HPP
+#define POWER_MQTT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "mqtt_client.h"
+#include "ModbusController.hpp"
+#include "PowerLogger.hpp"
+
+/**
+ * @brief 电源测量值的MQTT发布器
+ * @details 每条消息是一个CBOR映射：
+ *          - "t": 第一条采样的开机时间 (ms)
+ *          - "w": 编码时的Unix时间 (s)，未对时为0
+ *          - "h": [内部RAM空闲, PSRAM空闲, 内部RAM最低空闲, Wi-Fi RSSI]，RSSI未连接时为0
+ *          - "s": 采样数组，每条为[相对"t"的时间 (ms), 从机地址, 输出电压, 输出电流, 输出功率, 输入电压, 标志]，
+ *            数值与寄存器单位一致，标志同PowerLogger::FLAG_*
+ */
+class PowerMqtt {
+public:
+    /**
+     * @brief 上报统计
+     */
+    struct Stats {
+        uint32_t published;         // 已发布的批次
+        uint32_t spooled;           // 断线时写入SD卡的批次
+        uint32_t replayed;          // 重新连接后从SD卡补发的批次
+        uint32_t dropped;           // 队列满或暂存失败时丢弃的采样
+    };
+
+    PowerMqtt();
+    ~PowerMqtt();
+
+    /**
+     * @brief 连接服务器并启动发布任务，断线后自动重连
+     * @param uri 服务器地址，如mqtt://192.168.1.2
+     * @param topic 发布的主题
+     * @return true 已开始，false 已在运行或内存不足
+     */
+    bool start(const char* uri, const char* topic);
+
+    /**
+     * @brief 发布队列中剩余的采样并断开连接，等待发布任务结束
+     */
+    void stop();
+
+    bool isConnected() const { return connected; }
+
+    /**
+     * @brief 加入一次采样，不会阻塞，可在Modbus工作任务中调用
+     * @param slave 从机地址
+     * @param data 设备数据
+     * @param time_ms 采样时间
+     */
+    void addSample(uint8_t slave, const PowerDeviceData& data, uint32_t time_ms);
+
+    /**
+     * @brief 获取上报统计
+     */
+    void getStats(Stats* stats) const;
+
+private:
+    static const size_t SAMPLE_SIZE_MAX = 24;           // 一条采样编码后最长的字节数
+    static const size_t HEADER_SIZE_MAX = 48;           // 映射、时间和系统状态最长的字节数
+    static const uint32_t REPLAY_BATCHES = 8;           // 每批新数据之前最多补发的暂存批次
+    static const uint32_t STOP_WAIT_MS = 5000;
+
+    size_t encodeBatch(const PowerLogRecord* records, size_t count);
+    bool publish(const uint8_t* payload, size_t size);
+    void spool(const uint8_t* payload, size_t size, size_t count);
+    void replay();
+    static void publisherTask(void* arg);
+    static void onMqttEvent(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
+
+    PowerLogRecord* queue;          // 环形队列，CONFIG_POWER_CONTROLLER_MQTT_QUEUE条
+    size_t queue_head;              // 最早的采样
+    size_t queue_count;
+    PowerLogRecord* batch;          // 发布任务取出的一批
+    uint8_t* payload;               // 编码缓冲，补发时也用于读取暂存的批次
+    size_t payload_size;
+    char topic[64];
+    esp_mqtt_client_handle_t client;
+    bool spool_pending;             // SD卡上有未补发的批次
+    long spool_read_pos;            // 暂存文件中下一个要补发的批次
+    Stats stats;
+    volatile bool running;
+    volatile bool connected;
+    volatile bool stopping;
+    TaskHandle_t publisher_task;
+    SemaphoreHandle_t publisher_exit;
+    mutable portMUX_TYPE lock;      // 保护队列和统计
+};
+
+#endif // POWER_MQTT_HPP
@@ -0,0 +1,349 @@
+/**
+ * @file PowerProfile.cpp
+ * @brief 设定值曲线执行器实现
+ */
+
+#include "PowerProfile.hpp"
+#include "esp_log.h"
+#include "task_config/task_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static const char *TAG = "PowerProfile";
+
+PowerProfile::PowerProfile(ModbusController* modbus)
+    : modbus(modbus), segment_count(0), repeat(false), segment(0), segment_start_us(0), from_voltage(0.0f),
+      from_current(0.0f), sent_voltage(-1), sent_current(-1), verify_retries(0), submit_seq(0), done_seq(0),
+      verified_seq(0), done_ms(0), resend(false), running(false), timer(nullptr), task(nullptr) {
+    memset(segments, 0, sizeof(segments));
+    memset(&status, 0, sizeof(status));
+    portMUX_INITIALIZE(&lock);
+}
+
+PowerProfile::~PowerProfile() {
+    stop();
+    if (timer) {
+        esp_timer_delete(timer);
+        timer = nullptr;
+    }
+    if (task) {
+        task_config_delete(TASK_CONFIG_POWER_PROFILE, task);
+        task = nullptr;
+    }
+}
+
+bool PowerProfile::load(const ProfileSegment* segments, size_t count, bool repeat) {
+    if (running || segments == nullptr || count == 0 || count > MAX_SEGMENTS) {
+        return false;
+    }
+
+    uint64_t total_ms = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].type != PROFILE_HOLD && (segments[i].voltage < 0.0f || segments[i].current < 0.0f)) {
+            ESP_LOGE(TAG, "Segment %d has a negative setpoint", (int)i);
+            return false;
+        }
+        total_ms += segments[i].duration_ms;
+    }
+    // 循环的曲线总时长为0时执行任务会一直在段之间打转
+    if (repeat && total_ms == 0) {
+        ESP_LOGE(TAG, "Repeating profile has no duration");
+        return false;
+    }
+
+    memcpy(this->segments, segments, count * sizeof(ProfileSegment));
+    segment_count = count;
+    this->repeat = repeat;
+    ESP_LOGI(TAG, "Profile loaded: %d segments, %llu ms%s", (int)count, (unsigned long long)total_ms,
+             repeat ? ", repeating" : "");
+
+    return true;
+}
+
+bool PowerProfile::loadFile(const char* path) {
+    ProfileSegment parsed[MAX_SEGMENTS];
+    size_t count = 0;
+    bool loop = false;
+    bool valid = true;
+    char line[64];
+    int line_no = 0;
+
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        ESP_LOGW(TAG, "Failed to open %s", path);
+        return false;
+    }
+
+    while (valid && fgets(line, sizeof(line), fp) != nullptr) {
+        char type[8];
+        ProfileSegment seg = {};
+        unsigned long duration = 0;
+
+        line_no++;
+        if (sscanf(line, "%7s", type) != 1 || type[0] == '#') {
+            continue;
+        }
+        if (strcmp(type, "repeat") == 0) {
+            loop = true;
+            continue;
+        }
+        if (count >= MAX_SEGMENTS) {
+            ESP_LOGE(TAG, "%s: more than %d segments", path, (int)MAX_SEGMENTS);
+            valid = false;
+        } else if (strcmp(type, "step") == 0 || strcmp(type, "ramp") == 0) {
+            seg.type = (type[0] == 's') ? PROFILE_STEP : PROFILE_RAMP;
+            valid = sscanf(line, "%*s %f %f %lu", &seg.voltage, &seg.current, &duration) == 3;
+        } else if (strcmp(type, "hold") == 0) {
+            seg.type = PROFILE_HOLD;
+            valid = sscanf(line, "%*s %lu", &duration) == 1;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            ESP_LOGE(TAG, "%s:%d: invalid segment", path, line_no);
+            break;
+        }
+        seg.duration_ms = duration;
+        parsed[count++] = seg;
+    }
+    fclose(fp);
+
+    return valid && load(parsed, count, loop);
+}
+
+bool PowerProfile::init() {
+    if (task == nullptr &&
+        task_config_create(TASK_CONFIG_POWER_PROFILE, profileTask, this, &task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create profile task");
+        task = nullptr;
+        return false;
+    }
+
+    if (timer == nullptr) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = timerCallback,
+            .arg = this,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "power_profile",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&timer_args, &timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create profile timer");
+            timer = nullptr;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool PowerProfile::start() {
+    if (running || segment_count == 0 || modbus == nullptr) {
+        return false;
+    }
+    if (!init()) {
+        return false;
+    }
+
+    // 第一段从设备当前的设定值开始
+    const PowerDeviceData data = modbus->getDeviceData();
+    if (!data.data_valid) {
+        ESP_LOGW(TAG, "Device data not valid, profile not started");
+        return false;
+    }
+    from_voltage = data.set_voltage;
+    from_current = data.set_current;
+    segment = 0;
+    sent_voltage = -1;
+    sent_current = -1;
+    verify_retries = 0;
+    resend = false;
+    verified_seq = submit_seq;
+    done_seq = submit_seq;
+
+    taskENTER_CRITICAL(&lock);
+    memset(&status, 0, sizeof(status));
+    status.running = true;
+    taskEXIT_CRITICAL(&lock);
+
+    segment_start_us = esp_timer_get_time();
+    running = true;
+    if (esp_timer_start_periodic(timer, CADENCE_MS * 1000) != ESP_OK) {
+        running = false;
+        return false;
+    }
+    xTaskNotifyGive(task);
+    ESP_LOGI(TAG, "Profile started from %.2fV/%.3fA", from_voltage, from_current);
+
+    return true;
+}
+
+void PowerProfile::stop() {
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    if (timer) {
+        esp_timer_stop(timer);
+    }
+    taskENTER_CRITICAL(&lock);
+    status.running = false;
+    taskEXIT_CRITICAL(&lock);
+    ESP_LOGI(TAG, "Profile stopped");
+}
+
+void PowerProfile::getStatus(Status* status) const {
+    taskENTER_CRITICAL(&lock);
+    *status = this->status;
+    taskEXIT_CRITICAL(&lock);
+}
+
+void PowerProfile::writeSetpoint(float voltage, float current, bool force) {
+    int32_t voltage_reg = (int32_t)lroundf(voltage * 100.0f);
+    int32_t current_reg = (int32_t)lroundf(current * 1000.0f);
+
+    // 斜坡很慢时多个节拍的值相同，不重复写入
+    if (!force && voltage_reg == sent_voltage && current_reg == sent_current) {
+        return;
+    }
+
+    float v = voltage_reg / 100.0f;
+    float i = current_reg / 1000.0f;
+    if (!modbus->validateVoltage(v) || !modbus->validateCurrent(i)) {
+        ESP_LOGE(TAG, "Setpoint %.2fV/%.3fA out of range, profile stopped", v, i);
+        stop();
+        return;
+    }
+
+    // 先计数再提交，完成回调看到的序号包含这次写入
+    submit_seq = submit_seq + 1;
+    if (!modbus->setVoltageAndCurrentAsync(v, i, onWriteDone, this)) {
+        // 写队列已满，下个节拍再写
+        submit_seq = submit_seq - 1;
+        resend = true;
+        return;
+    }
+    sent_voltage = voltage_reg;
+    sent_current = current_reg;
+    resend = false;
+
+    taskENTER_CRITICAL(&lock);
+    status.voltage = v;
+    status.current = i;
+    status.writes++;
+    taskEXIT_CRITICAL(&lock);
+}
+
+void PowerProfile::verifyReadback() {
+    uint32_t seq = submit_seq;
+
+    // 工作任务先处理完排队的写入再轮询，最后一次写入完成后的轮询结果应与之相同
+    if (seq == verified_seq || done_seq != seq) {
+        return;
+    }
+    const PowerDeviceData data = modbus->getDeviceData();
+    if (!data.data_valid || data.last_update_ms <= done_ms) {
+        return;
+    }
+    verified_seq = seq;
+
+    if (lroundf(data.set_voltage * 100.0f) == sent_voltage && lroundf(data.set_current * 1000.0f) == sent_current) {
+        verify_retries = 0;
+        return;
+    }
+
+    ESP_LOGW(TAG, "Readback %.2fV/%.3fA differs from setpoint %.2fV/%.3fA", data.set_voltage, data.set_current,
+             sent_voltage / 100.0f, sent_current / 1000.0f);
+    taskENTER_CRITICAL(&lock);
+    status.mismatches++;
+    taskEXIT_CRITICAL(&lock);
+    if (++verify_retries >= VERIFY_RETRY_MAX) {
+        ESP_LOGE(TAG, "Setpoint not accepted by the device, profile stopped");
+        stop();
+        return;
+    }
+    resend = true;
+}
+
+void PowerProfile::tick() {
+    verifyReadback();
+    if (!running) {
+        return;
+    }
+
+    // 设定值按开始时间的绝对时间计算，节拍延迟不会累积
+    int64_t now = esp_timer_get_time();
+    while (now - segment_start_us >= (int64_t)segments[segment].duration_ms * 1000) {
+        const ProfileSegment& done = segments[segment];
+        if (done.type != PROFILE_HOLD) {
+            from_voltage = done.voltage;
+            from_current = done.current;
+        }
+        segment_start_us += (int64_t)done.duration_ms * 1000;
+        segment++;
+        if (segment < segment_count) {
+            continue;
+        }
+        if (!repeat) {
+            // 最后一段的终点，写入后结束
+            writeSetpoint(from_voltage, from_current, resend);
+            ESP_LOGI(TAG, "Profile completed");
+            stop();
+            return;
+        }
+        segment = 0;
+        taskENTER_CRITICAL(&lock);
+        status.loops++;
+        taskEXIT_CRITICAL(&lock);
+    }
+
+    const ProfileSegment& seg = segments[segment];
+    float voltage = from_voltage;
+    float current = from_current;
+    if (seg.type == PROFILE_STEP) {
+        voltage = seg.voltage;
+        current = seg.current;
+    } else if (seg.type == PROFILE_RAMP) {
+        float t = (float)(now - segment_start_us) / ((float)seg.duration_ms * 1000.0f);
+        voltage = from_voltage + (seg.voltage - from_voltage) * t;
+        current = from_current + (seg.current - from_current) * t;
+    }
+    writeSetpoint(voltage, current, resend);
+
+    taskENTER_CRITICAL(&lock);
+    status.segment = segment;
+    taskEXIT_CRITICAL(&lock);
+}
+
+void PowerProfile::timerCallback(void* arg) {
+    PowerProfile* profile = (PowerProfile*)arg;
+    xTaskNotifyGive(profile->task);
+}
+
+void PowerProfile::profileTask(void* arg) {
+    PowerProfile* profile = (PowerProfile*)arg;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (profile->running) {
+            profile->tick();
+        }
+    }
+}
+
+void PowerProfile::onWriteDone(bool success, void* user_ctx) {
+    PowerProfile* profile = (PowerProfile*)user_ctx;
+
+    if (success) {
+        profile->done_ms = esp_timer_get_time() / 1000;
+        profile->done_seq = profile->submit_seq;
+        return;
+    }
+
+    profile->resend = true;
+    taskENTER_CRITICAL(&profile->lock);
+    profile->status.write_failures++;
+    taskEXIT_CRITICAL(&profile->lock);
+}
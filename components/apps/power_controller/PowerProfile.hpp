@@ -0,0 +1,132 @@
+/**
+ * @file PowerProfile.hpp
+ * @brief 设定值曲线：按时间执行的斜坡、阶跃和保持
+ * @details 由定时器驱动的高优先级任务按固定节拍计算设定值并写入，用回读的设定值校验
+ */
+
+#ifndef POWER_PROFILE_HPP
+#define POWER_PROFILE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "ModbusController.hpp"
+
+/**
+ * @brief 曲线段类型
+ */
+enum ProfileSegmentType {
+    PROFILE_STEP = 0,           // 立即设为目标值并保持duration_ms
+    PROFILE_RAMP,               // 在duration_ms内从上一段的值线性变化到目标值
+    PROFILE_HOLD,               // 保持上一段的值duration_ms，目标值不使用
+};
+
+/**
+ * @brief 曲线段
+ */
+struct ProfileSegment {
+    ProfileSegmentType type;
+    float voltage;              // 目标电压 (V)
+    float current;              // 目标电流 (A)
+    uint32_t duration_ms;
+};
+
+/**
+ * @brief 设定值曲线执行器
+ */
+class PowerProfile {
+public:
+    static const size_t MAX_SEGMENTS = 64;
+    static const uint32_t CADENCE_MS = 100;             // 计算和写入设定值的节拍
+
+    /**
+     * @brief 执行状态
+     */
+    struct Status {
+        bool running;
+        size_t segment;             // 当前段
+        uint32_t loops;             // 已完成的循环次数
+        float voltage;              // 最近写入的电压 (V)
+        float current;              // 最近写入的电流 (A)
+        uint32_t writes;            // 提交的写入
+        uint32_t write_failures;    // 写入失败
+        uint32_t mismatches;        // 回读与写入不一致
+    };
+
+    explicit PowerProfile(ModbusController* modbus);
+    ~PowerProfile();
+
+    /**
+     * @brief 加载曲线，执行中不能加载
+     * @param segments 曲线段
+     * @param count 段数，不超过MAX_SEGMENTS
+     * @param repeat 结束后是否从头循环
+     * @return true 成功，false 参数无效或正在执行
+     */
+    bool load(const ProfileSegment* segments, size_t count, bool repeat);
+
+    /**
+     * @brief 从文本文件加载曲线
+     * @details 每行一段："step V A ms"、"ramp V A ms"、"hold ms"，"repeat"表示循环，#开头为注释
+     * @param path 文件路径
+     * @return true 成功，false 文件无法打开、格式错误或正在执行
+     */
+    bool loadFile(const char* path);
+
+    /**
+     * @brief 从设备当前的设定值开始执行
+     * @return true 已开始，false 没有曲线、设备数据无效或资源不足
+     */
+    bool start();
+
+    /**
+     * @brief 停止执行，设备保持最后写入的设定值
+     */
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    void getStatus(Status* status) const;
+
+private:
+    static const uint32_t VERIFY_RETRY_MAX = 3;         // 连续不一致多少次后停止执行
+
+    bool init();
+    void tick();
+    void writeSetpoint(float voltage, float current, bool force);
+    void verifyReadback();
+    static void timerCallback(void* arg);
+    static void profileTask(void* arg);
+    static void onWriteDone(bool success, void* user_ctx);
+
+    ModbusController* modbus;
+    ProfileSegment segments[MAX_SEGMENTS];
+    size_t segment_count;
+    bool repeat;
+
+    // 执行状态，只在执行任务中修改
+    size_t segment;
+    int64_t segment_start_us;
+    float from_voltage;             // 当前段开始时的值
+    float from_current;
+    int32_t sent_voltage;           // 最近提交的值 (0.01V)
+    int32_t sent_current;           // (0.001A)
+    uint8_t verify_retries;
+
+    // 写入完成回调和执行任务共用
+    volatile uint32_t submit_seq;   // 已提交的写入
+    volatile uint32_t done_seq;     // 完成回调时已提交的写入
+    volatile uint32_t verified_seq; // 已校验的写入
+    volatile uint32_t done_ms;      // 最近一次写入完成的时间
+    volatile bool resend;           // 写入失败，下个节拍重写
+
+    Status status;
+    volatile bool running;
+    esp_timer_handle_t timer;
+    TaskHandle_t task;
+    mutable portMUX_TYPE lock;      // 保护status
+};
+
+#endif // POWER_PROFILE_HPP
@@ -0,0 +1,160 @@
+/**
+ * @file PowerTelemetry.cpp
+ * @brief 电源遥测数据的定长时间序列存储实现
+ */
+
+#include "PowerTelemetry.hpp"
+#include <string.h>
+#include <math.h>
+
+static const uint32_t MINUTE_MS = 60 * 1000;
+static const uint32_t HOUR_MS = 60 * MINUTE_MS;
+
+static uint16_t toRegister(float value, float scale) {
+    float reg = roundf(value * scale);
+    if (reg < 0.0f) {
+        return 0;
+    }
+    if (reg > 65535.0f) {
+        return 65535;
+    }
+    return (uint16_t)reg;
+}
+
+PowerTelemetry::PowerTelemetry() {
+    portMUX_INITIALIZE(&lock);
+    rings[TELEMETRY_TIER_RAW].points = &raw_points[0][0];
+    rings[TELEMETRY_TIER_RAW].capacity = RAW_POINTS;
+    rings[TELEMETRY_TIER_MINUTE].points = &minute_points[0][0];
+    rings[TELEMETRY_TIER_MINUTE].capacity = MINUTE_POINTS;
+    rings[TELEMETRY_TIER_HOUR].points = &hour_points[0][0];
+    rings[TELEMETRY_TIER_HOUR].capacity = HOUR_POINTS;
+    clear();
+}
+
+void PowerTelemetry::clear() {
+    taskENTER_CRITICAL(&lock);
+    for (int i = 0; i < TELEMETRY_TIER_NUM; i++) {
+        rings[i].head = 0;
+        rings[i].count = 0;
+        rings[i].total = 0;
+    }
+    memset(&minute_bucket, 0, sizeof(minute_bucket));
+    memset(&hour_bucket, 0, sizeof(hour_bucket));
+    taskEXIT_CRITICAL(&lock);
+}
+
+void PowerTelemetry::ringPush(Ring* ring, const TelemetryPoint* points) {
+    memcpy(&ring->points[ring->head * TELEMETRY_CHANNEL_NUM], points, sizeof(TelemetryPoint) * TELEMETRY_CHANNEL_NUM);
+    ring->head = (ring->head + 1) % ring->capacity;
+    if (ring->count < ring->capacity) {
+        ring->count++;
+    }
+    ring->total++;
+}
+
+void PowerTelemetry::bucketAdd(Bucket* bucket, const TelemetryPoint* points, uint32_t weight) {
+    for (int i = 0; i < TELEMETRY_CHANNEL_NUM; i++) {
+        if (bucket->count == 0 || points[i].min < bucket->min[i]) {
+            bucket->min[i] = points[i].min;
+        }
+        if (bucket->count == 0 || points[i].max > bucket->max[i]) {
+            bucket->max[i] = points[i].max;
+        }
+        bucket->sum[i] += (uint32_t)points[i].avg * weight;
+    }
+    bucket->count += weight;
+}
+
+void PowerTelemetry::bucketClose(Bucket* bucket, TelemetryPoint* points) {
+    for (int i = 0; i < TELEMETRY_CHANNEL_NUM; i++) {
+        points[i].min = bucket->min[i];
+        points[i].max = bucket->max[i];
+        points[i].avg = (uint16_t)((bucket->sum[i] + bucket->count / 2) / bucket->count);
+    }
+    memset(bucket, 0, sizeof(*bucket));
+}
+
+uint32_t PowerTelemetry::addSample(const PowerDeviceData& data, uint32_t time_ms) {
+    TelemetryPoint sample[TELEMETRY_CHANNEL_NUM];
+    uint16_t values[TELEMETRY_CHANNEL_NUM] = {
+        toRegister(data.output_voltage, 100.0f),
+        toRegister(data.output_current, 1000.0f),
+        toRegister(data.output_power, 100.0f),
+        toRegister(data.input_voltage, 100.0f),
+    };
+    for (int i = 0; i < TELEMETRY_CHANNEL_NUM; i++) {
+        sample[i].min = values[i];
+        sample[i].max = values[i];
+        sample[i].avg = values[i];
+    }
+
+    uint32_t updated = 1 << TELEMETRY_TIER_RAW;
+    TelemetryPoint closed[TELEMETRY_CHANNEL_NUM];
+
+    taskENTER_CRITICAL(&lock);
+    ringPush(&rings[TELEMETRY_TIER_RAW], sample);
+
+    // 采样进入新的一分钟时结束上一分钟，分钟点再按同样方式汇总为小时点
+    uint32_t minute = time_ms / MINUTE_MS;
+    if (minute_bucket.open && minute_bucket.index != minute) {
+        uint32_t weight = minute_bucket.count;
+        uint32_t hour = minute_bucket.index / (HOUR_MS / MINUTE_MS);
+        bucketClose(&minute_bucket, closed);
+        ringPush(&rings[TELEMETRY_TIER_MINUTE], closed);
+        updated |= 1 << TELEMETRY_TIER_MINUTE;
+
+        // 结束的分钟属于新的一小时，上一小时到此为止
+        if (hour_bucket.open && hour_bucket.index != hour) {
+            TelemetryPoint hour_closed[TELEMETRY_CHANNEL_NUM];
+            bucketClose(&hour_bucket, hour_closed);
+            ringPush(&rings[TELEMETRY_TIER_HOUR], hour_closed);
+            updated |= 1 << TELEMETRY_TIER_HOUR;
+        }
+        if (!hour_bucket.open) {
+            hour_bucket.open = true;
+            hour_bucket.index = hour;
+        }
+        bucketAdd(&hour_bucket, closed, weight);
+    }
+    if (!minute_bucket.open) {
+        minute_bucket.open = true;
+        minute_bucket.index = minute;
+    }
+    bucketAdd(&minute_bucket, sample, 1);
+    taskEXIT_CRITICAL(&lock);
+
+    return updated;
+}
+
+size_t PowerTelemetry::getCount(TelemetryTier tier) const {
+    taskENTER_CRITICAL(&lock);
+    size_t count = rings[tier].count;
+    taskEXIT_CRITICAL(&lock);
+
+    return count;
+}
+
+uint32_t PowerTelemetry::getTotal(TelemetryTier tier) const {
+    taskENTER_CRITICAL(&lock);
+    uint32_t total = rings[tier].total;
+    taskEXIT_CRITICAL(&lock);
+
+    return total;
+}
+
+bool PowerTelemetry::getPoint(TelemetryTier tier, TelemetryChannel channel, size_t index,
+                              TelemetryPoint* point) const {
+    bool found = false;
+
+    taskENTER_CRITICAL(&lock);
+    const Ring &ring = rings[tier];
+    if (index < ring.count) {
+        size_t pos = (ring.head + ring.capacity - ring.count + index) % ring.capacity;
+        *point = ring.points[pos * TELEMETRY_CHANNEL_NUM + channel];
+        found = true;
+    }
+    taskEXIT_CRITICAL(&lock);
+
+    return found;
+}
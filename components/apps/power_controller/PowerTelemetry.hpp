@@ -0,0 +1,127 @@
+/**
+ * @file PowerTelemetry.hpp
+ * @brief 电源遥测数据的定长时间序列存储
+ * @details 原始采样环形缓冲，以及按分钟、小时降采样的最小/最大/平均值，内存占用固定
+ */
+
+#ifndef POWER_TELEMETRY_HPP
+#define POWER_TELEMETRY_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "ModbusController.hpp"
+
+/**
+ * @brief 记录的通道，数值与寄存器单位一致
+ */
+enum TelemetryChannel {
+    TELEMETRY_VOUT = 0,         // 输出电压 (÷100 = V)
+    TELEMETRY_IOUT,             // 输出电流 (÷1000 = A)
+    TELEMETRY_POWER,            // 输出功率 (÷100 = W)
+    TELEMETRY_UIN,              // 输入电压 (÷100 = V)
+    TELEMETRY_CHANNEL_NUM,
+};
+
+/**
+ * @brief 时间分辨率
+ */
+enum TelemetryTier {
+    TELEMETRY_TIER_RAW = 0,     // 每次轮询一个点
+    TELEMETRY_TIER_MINUTE,      // 每分钟一个点
+    TELEMETRY_TIER_HOUR,        // 每小时一个点
+    TELEMETRY_TIER_NUM,
+};
+
+/**
+ * @brief 一个时间点，原始采样的三个值相同
+ */
+struct TelemetryPoint {
+    uint16_t min;
+    uint16_t max;
+    uint16_t avg;
+};
+
+/**
+ * @brief 电源遥测时间序列
+ * @details 可在一个任务中写入、另一个任务中读取
+ */
+class PowerTelemetry {
+public:
+    static const size_t RAW_POINTS = 600;       // 300ms轮询约3分钟
+    static const size_t MINUTE_POINTS = 240;    // 4小时
+    static const size_t HOUR_POINTS = 168;      // 7天
+
+    PowerTelemetry();
+
+    /**
+     * @brief 记录一次采样
+     * @param data 设备数据
+     * @param time_ms 采样时间
+     * @return 产生了新点的分辨率，按(1 << TelemetryTier)组合
+     */
+    uint32_t addSample(const PowerDeviceData& data, uint32_t time_ms);
+
+    /**
+     * @brief 获取保存的点数
+     */
+    size_t getCount(TelemetryTier tier) const;
+
+    /**
+     * @brief 获取写入过的总点数，包括已被覆盖的，用于增量读取
+     */
+    uint32_t getTotal(TelemetryTier tier) const;
+
+    /**
+     * @brief 获取一个点
+     * @param tier 分辨率
+     * @param channel 通道
+     * @param index 0为最早的点
+     * @param point 输出
+     * @return true 成功，false 下标超出范围
+     */
+    bool getPoint(TelemetryTier tier, TelemetryChannel channel, size_t index, TelemetryPoint* point) const;
+
+    /**
+     * @brief 清空所有数据
+     */
+    void clear();
+
+private:
+    /**
+     * @brief 定长环形缓冲，写满后覆盖最早的点
+     */
+    struct Ring {
+        TelemetryPoint* points;     // capacity x TELEMETRY_CHANNEL_NUM
+        size_t capacity;
+        size_t head;                // 下一个写入位置
+        size_t count;
+        uint32_t total;
+    };
+
+    /**
+     * @brief 正在累积的降采样区间
+     */
+    struct Bucket {
+        bool open;
+        uint32_t index;             // 区间编号 (time / 区间长度)
+        uint32_t count;
+        uint32_t sum[TELEMETRY_CHANNEL_NUM];
+        uint16_t min[TELEMETRY_CHANNEL_NUM];
+        uint16_t max[TELEMETRY_CHANNEL_NUM];
+    };
+
+    static void ringPush(Ring* ring, const TelemetryPoint* points);
+    static void bucketAdd(Bucket* bucket, const TelemetryPoint* points, uint32_t weight);
+    static void bucketClose(Bucket* bucket, TelemetryPoint* points);
+
+    TelemetryPoint raw_points[RAW_POINTS][TELEMETRY_CHANNEL_NUM];
+    TelemetryPoint minute_points[MINUTE_POINTS][TELEMETRY_CHANNEL_NUM];
+    TelemetryPoint hour_points[HOUR_POINTS][TELEMETRY_CHANNEL_NUM];
+    Ring rings[TELEMETRY_TIER_NUM];
+    Bucket minute_bucket;
+    Bucket hour_bucket;
+    mutable portMUX_TYPE lock;
+};
+
+#endif // POWER_TELEMETRY_HPP
@@ -0,0 +1,101 @@
+#include "RxPacer.hpp"
+
+RxPacer::RxPacer() :
+    _timer(nullptr),
+    _config(),
+    _period(0),
+    _budget(0),
+    _last_data(0),
+    _background(false)
+{
+}
+
+void RxPacer::begin(lv_timer_t* timer, const Config& config)
+{
+    _timer = timer;
+    _config = config;
+    _budget = config.batch;
+    _last_data = lv_tick_get();
+    _background = false;
+    _period = 0;
+    setPeriod(config.period_ms);
+}
+
+size_t RxPacer::skipCount(size_t backlog) const
+{
+    if (_config.skip_threshold == 0 || _budget < _config.max_batch || backlog <= _config.skip_threshold) {
+        return 0;
+    }
+
+    // 保留最新的一部分，本次就能显示完
+    size_t keep = _config.skip_threshold / 2;
+    if (keep > _budget) {
+        keep = _budget;
+    }
+    return backlog - keep;
+}
+
+void RxPacer::endTick(size_t read)
+{
+    if (_background) {
+        // 没人看，按最大预算读空缓冲区，周期保持空闲周期
+        if (read > 0) {
+            _last_data = lv_tick_get();
+        }
+        return;
+    }
+    if (read == 0) {
+        _budget = _config.batch;
+        if (lv_tick_elaps(_last_data) >= IDLE_AFTER_MS) {
+            setPeriod(_config.idle_period_ms);
+        } else if (_period == _config.burst_period_ms) {
+            setPeriod(_config.period_ms);
+        }
+        return;
+    }
+    _last_data = lv_tick_get();
+
+    // 读满预算说明还有积压，加倍；读得少时减半，回到正常预算后恢复正常周期
+    if (read >= _budget) {
+        _budget = (_budget * 2 < _config.max_batch) ? _budget * 2 : _config.max_batch;
+    } else if (read < _budget / 2 && _budget > _config.batch) {
+        _budget = (_budget / 2 > _config.batch) ? _budget / 2 : _config.batch;
+    }
+    setPeriod(_budget > _config.batch ? _config.burst_period_ms : _config.period_ms);
+}
+
+void RxPacer::setBackground(bool background)
+{
+    if (background == _background) {
+        return;
+    }
+    _background = background;
+    if (background) {
+        _budget = _config.max_batch;
+        setPeriod(_config.idle_period_ms);
+    } else {
+        // 回到正常状态，下次回调按读取量重新调整
+        _budget = _config.batch;
+        setPeriod(_config.period_ms);
+    }
+}
+
+void RxPacer::setPeriod(uint32_t period)
+{
+    if (period == _period || _timer == nullptr) {
+        return;
+    }
+    _period = period;
+    lv_timer_set_period(_timer, period);
+}
+
+uint32_t RxLagReport::take()
+{
+    if (_pending == 0 || lv_tick_elaps(_last_report) < REPORT_INTERVAL_MS) {
+        return 0;
+    }
+    uint32_t skipped = _pending;
+    _pending = 0;
+    _last_report = lv_tick_get();
+    return skipped;
+}
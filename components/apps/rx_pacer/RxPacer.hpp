@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lvgl.h"
+
+/**
+ * @class RxPacer
+ * @brief 串口应用UI定时器的刷新节奏和每次读取量
+ *
+ * 一直没有数据时把定时器周期放长到空闲周期，减少空闲时的唤醒；收到数据后恢复正常周期。
+ * 一次读满预算（后面还有积压）时加倍预算并放慢定时器，少刷新几次、每次显示更多数据，
+ * 积压读完后逐步恢复。预算已到最大仍积压超过阈值时，UI跳过最旧的数据只显示最新的部分，
+ * 让接收缓冲区尽快空出来，SD卡记录在接收路径上进行，不受影响；跳过的字节数由RxLagReport汇总显示。
+ * 屏幕关闭后进入后台状态，一直使用空闲周期和最大预算，接收缓冲区照常读空，只是很少唤醒。
+ * 所有方法都只能在LVGL任务中调用。
+ */
+class RxPacer {
+public:
+    struct Config {
+        uint32_t period_ms;         // 正常刷新周期
+        uint32_t idle_period_ms;    // 空闲时的刷新周期
+        uint32_t burst_period_ms;   // 积压时的刷新周期
+        size_t   batch;             // 正常时每次最多读取的字节数
+        size_t   max_batch;         // 积压时每次最多读取的字节数
+        size_t   skip_threshold;    // 积压超过它时跳过旧数据，0表示从不跳过
+    };
+
+    static const uint32_t IDLE_AFTER_MS = 1000;     // 没有数据多久后进入空闲周期
+
+    RxPacer();
+
+    /**
+     * @brief 绑定定时器并恢复正常状态，定时器周期设为正常周期
+     */
+    void begin(lv_timer_t* timer, const Config& config);
+
+    /**
+     * @brief 改变跳过阈值，如接收模式切换后
+     */
+    void setSkipThreshold(size_t threshold) { _config.skip_threshold = threshold; }
+
+    /**
+     * @brief 本次定时器回调每个数据源最多读取的字节数
+     */
+    size_t budget() const { return _budget; }
+
+    /**
+     * @brief 读取前调用，返回应跳过的旧数据字节数
+     * @param backlog 数据源中待读取的字节数
+     */
+    size_t skipCount(size_t backlog) const;
+
+    /**
+     * @brief 每次定时器回调结束时调用，调整下次的预算和周期
+     * @param read 本次读取最多的数据源读取的字节数
+     */
+    void endTick(size_t read);
+
+    /**
+     * @brief 屏幕关闭时进入后台状态，打开后恢复正常状态
+     */
+    void setBackground(bool background);
+
+    bool isIdle() const { return _period == _config.idle_period_ms; }
+
+private:
+    void setPeriod(uint32_t period);
+
+    lv_timer_t* _timer;
+    Config      _config;
+    uint32_t    _period;            // 当前定时器周期
+    size_t      _budget;
+    uint32_t    _last_data;         // 最后一次读到数据的时间
+    bool        _background;        // 屏幕已关闭
+};
+
+/**
+ * @class RxLagReport
+ * @brief 汇总UI跳过的字节数，最多每REPORT_INTERVAL_MS提示一次
+ */
+class RxLagReport {
+public:
+    static const uint32_t REPORT_INTERVAL_MS = 1000;
+
+    RxLagReport() : _pending(0), _total(0), _last_report(0) {}
+
+    void reset() { _pending = 0; _total = 0; }
+    void add(size_t skipped) { _pending += skipped; _total += skipped; }
+
+    /**
+     * @brief 到了提示时间时取出尚未提示的字节数
+     * @return 0 没有要提示的
+     */
+    uint32_t take();
+
+    uint32_t getTotal() const { return _total; }
+
+private:
+    uint32_t _pending;
+    uint32_t _total;
+    uint32_t _last_report;
+};
@@ -0,0 +1,468 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
+#include "screen_capture.h"
+
+static const char *TAG = "screen_capture";
+
+#if CONFIG_SCREEN_CAPTURE
+#include "driver/jpeg_encode.h"
+#include "usb_msc/usb_msc.h"
+#if CONFIG_SCREEN_CAPTURE_GESTURE
+#include "core/esp_brookesia_core_touch_hook.h"
+#include "touch_points/touch_points.h"
+#endif
+
+#define CAPTURE_DIR                 BSP_SD_MOUNT_POINT "/screenshots"
+#define CAPTURE_JPEG_BUF_DIV        (2)     /* A JPEG of the UI is far smaller than half of its RGB565 pixels */
+#define CAPTURE_CODEC_TIMEOUT_MS    (200)
+#define CAPTURE_CLOCK_YEAR_MIN      (2024)  /* Older dates mean the clock was never set */
+#define CAPTURE_GESTURE_SLOP        (24)    /* Pixels a finger may drift while held still */
+
+#define CAPTURE_NOTIFY_SHOT         BIT(0)
+#define CAPTURE_NOTIFY_RECORD       BIT(1)  /* `recording` changed */
+#define CAPTURE_NOTIFY_TOGGLE       BIT(2)  /* Start or stop the recording, from the gesture */
+
+typedef void (*capture_flush_cb_t)(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+
+static struct {
+    lv_disp_t *disp;
+    capture_flush_cb_t flush_cb;
+    TaskHandle_t task;
+    SemaphoreHandle_t lock;         /* Guards the session and the recording file */
+    volatile bool dirty;            /* The display flushed since the last render */
+    volatile bool recording;        /* Requested state, the task opens and closes the file */
+    // Session, allocated while a shot is taken or a recording runs
+    lv_color_t *frame_buf;
+    size_t frame_buf_size;
+    uint8_t *jpeg_buf;
+    size_t jpeg_buf_size;
+    uint32_t jpeg_size;             /* Size of the last JPEG in `jpeg_buf`, 0 if there is none */
+    jpeg_encoder_handle_t encoder;
+    // Recording
+    FILE *record_file;
+    uint32_t frame_num;
+    uint32_t encode_num;
+    uint64_t byte_num;
+    int64_t start_us;
+#if CONFIG_SCREEN_CAPTURE_GESTURE
+    // Only used by the LVGL task
+    int64_t hold_start_us;          /* 0 while two fingers aren't held down */
+    uint16_t hold_x[TOUCH_POINTS_NUM];
+    uint16_t hold_y[TOUCH_POINTS_NUM];
+    uint8_t hold_stage;
+#endif
+} s_capture;
+
+static void capture_on_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    s_capture.dirty = true;
+    s_capture.flush_cb(disp_drv, area, color_p);
+}
+
+static void capture_make_path(char *path, size_t len, const char *prefix, const char *ext)
+{
+    time_t now = time(NULL);
+    struct tm tm_info = { 0 };
+
+    localtime_r(&now, &tm_info);
+    if (tm_info.tm_year + 1900 >= CAPTURE_CLOCK_YEAR_MIN) {
+        snprintf(path, len, CAPTURE_DIR "/%s_%04d%02d%02d_%02d%02d%02d.%s", prefix, tm_info.tm_year + 1900,
+                 tm_info.tm_mon + 1, tm_info.tm_mday, tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec, ext);
+    } else {
+        snprintf(path, len, CAPTURE_DIR "/%s_%lld.%s", prefix, esp_timer_get_time() / 1000, ext);
+    }
+}
+
+/* Called with `lock` held */
+static void capture_session_free(void)
+{
+    if (s_capture.encoder) {
+        jpeg_del_encoder_engine(s_capture.encoder);
+        s_capture.encoder = NULL;
+    }
+    if (s_capture.jpeg_buf) {
+        free(s_capture.jpeg_buf);
+        s_capture.jpeg_buf = NULL;
+    }
+    if (s_capture.frame_buf) {
+        free(s_capture.frame_buf);
+        s_capture.frame_buf = NULL;
+    }
+    s_capture.jpeg_size = 0;
+}
+
+/* Called with `lock` held */
+static esp_err_t capture_session_begin(void)
+{
+    esp_err_t ret = ESP_OK;
+    size_t frame_size = s_capture.disp->driver->hor_res * s_capture.disp->driver->ver_res * sizeof(lv_color_t);
+    jpeg_encode_engine_cfg_t encode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = CAPTURE_CODEC_TIMEOUT_MS,
+    };
+    jpeg_encode_memory_alloc_cfg_t in_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_INPUT_BUFFER,
+    };
+    jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+    };
+
+    if (s_capture.encoder) {
+        return ESP_OK;
+    }
+    ESP_GOTO_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &s_capture.encoder), err, TAG,
+                      "Create JPEG encoder failed");
+    // The snapshot is rendered straight into the input buffer of the encoder, the same size whatever the rotation
+    s_capture.frame_buf = (lv_color_t *)jpeg_alloc_encoder_mem(frame_size, &in_mem_cfg, &s_capture.frame_buf_size);
+    ESP_GOTO_ON_FALSE(s_capture.frame_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate frame buffer failed");
+    s_capture.jpeg_buf = (uint8_t *)jpeg_alloc_encoder_mem(frame_size / CAPTURE_JPEG_BUF_DIV, &out_mem_cfg,
+                                                           &s_capture.jpeg_buf_size);
+    ESP_GOTO_ON_FALSE(s_capture.jpeg_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate JPEG buffer failed");
+
+    return ESP_OK;
+
+err:
+    capture_session_free();
+
+    return ret;
+}
+
+/* Render the active screen and encode it into `jpeg_buf`, called with `lock` held */
+static esp_err_t capture_encode(void)
+{
+    lv_img_dsc_t dsc = { 0 };
+    lv_res_t res = LV_RES_INV;
+
+    bsp_display_lock(0);
+    // Flushes after this point are in the next frame
+    s_capture.dirty = false;
+    res = lv_snapshot_take_to_buf(lv_disp_get_scr_act(s_capture.disp), LV_IMG_CF_TRUE_COLOR, &dsc,
+                                  s_capture.frame_buf, s_capture.frame_buf_size);
+    bsp_display_unlock();
+    ESP_RETURN_ON_FALSE(res == LV_RES_OK, ESP_FAIL, TAG, "Snapshot failed");
+
+    jpeg_encode_cfg_t encode_cfg = {
+        .height = dsc.header.h,
+        .width = dsc.header.w,
+        .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+        .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+        .image_quality = CONFIG_SCREEN_CAPTURE_JPEG_QUALITY,
+    };
+    s_capture.jpeg_size = 0;
+    ESP_RETURN_ON_ERROR(jpeg_encoder_process(s_capture.encoder, &encode_cfg, (const uint8_t *)s_capture.frame_buf,
+                                             dsc.data_size, s_capture.jpeg_buf, s_capture.jpeg_buf_size,
+                                             &s_capture.jpeg_size), TAG, "Encode failed");
+
+    return ESP_OK;
+}
+
+/* Called with `lock` held */
+static void capture_record_close(void)
+{
+    int64_t time_ms = (esp_timer_get_time() - s_capture.start_us) / 1000;
+
+    if (s_capture.record_file == NULL) {
+        return;
+    }
+    fclose(s_capture.record_file);
+    s_capture.record_file = NULL;
+    capture_session_free();
+    ESP_LOGI(TAG, "Recording stopped, %lu frames, %lu encoded, %llu KB in %lld ms", (unsigned long)s_capture.frame_num,
+             (unsigned long)s_capture.encode_num, s_capture.byte_num / 1024, time_ms);
+}
+
+/* Called with `lock` held */
+static esp_err_t capture_record_open(void)
+{
+    esp_err_t ret = ESP_OK;
+    char path[SCREEN_CAPTURE_PATH_LEN_MAX];
+
+    ESP_RETURN_ON_FALSE(!usb_msc_host_owns_card(), ESP_ERR_INVALID_STATE, TAG, "The SD card is used by USB");
+    ESP_RETURN_ON_ERROR(capture_session_begin(), TAG, "Begin session failed");
+    mkdir(CAPTURE_DIR, 0775);
+    capture_make_path(path, sizeof(path), "rec", "mjpeg");
+    s_capture.record_file = fopen(path, "wb");
+    ESP_GOTO_ON_FALSE(s_capture.record_file, ESP_FAIL, err, TAG, "Open %s failed", path);
+
+    // The first frame is always encoded
+    s_capture.jpeg_size = 0;
+    s_capture.frame_num = 0;
+    s_capture.encode_num = 0;
+    s_capture.byte_num = 0;
+    s_capture.start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Recording to %s", path);
+
+    return ESP_OK;
+
+err:
+    capture_session_free();
+
+    return ret;
+}
+
+/* Called with `lock` held */
+static esp_err_t capture_record_frame(void)
+{
+    // An unchanged screen costs a copy of the last JPEG only, the file keeps one frame per period
+    if (s_capture.dirty || (s_capture.jpeg_size == 0)) {
+        ESP_RETURN_ON_ERROR(capture_encode(), TAG, "Encode frame failed");
+        s_capture.encode_num++;
+    }
+    ESP_RETURN_ON_FALSE(fwrite(s_capture.jpeg_buf, 1, s_capture.jpeg_size, s_capture.record_file) ==
+                        s_capture.jpeg_size, ESP_FAIL, TAG, "Write frame failed");
+    s_capture.frame_num++;
+    s_capture.byte_num += s_capture.jpeg_size;
+
+    return ESP_OK;
+}
+
+static void capture_on_card_owner(usb_msc_event_t event, void *user_ctx)
+{
+    if (event != USB_MSC_EVENT_HOST_ATTACHED) {
+        return;
+    }
+    // The file must be closed before returning, the task only checks `recording` between two frames
+    xSemaphoreTake(s_capture.lock, portMAX_DELAY);
+    s_capture.recording = false;
+    capture_record_close();
+    xSemaphoreGive(s_capture.lock);
+}
+
+#if CONFIG_SCREEN_CAPTURE_GESTURE
+static void capture_on_touch(const ESP_Brookesia_TouchSample_t *sample, void *user_data)
+{
+    uint16_t x[TOUCH_POINTS_NUM];
+    uint16_t y[TOUCH_POINTS_NUM];
+    uint8_t num = (sample->state == LV_INDEV_STATE_PRESSED) ? touch_points_get(x, y) : 0;
+    int64_t now_us = esp_timer_get_time();
+    int64_t held_ms = 0;
+    bool moved = false;
+
+    if (num < TOUCH_POINTS_NUM) {
+        s_capture.hold_start_us = 0;
+        return;
+    }
+    for (int i = 0; i < TOUCH_POINTS_NUM; i++) {
+        moved |= (abs(x[i] - s_capture.hold_x[i]) > CAPTURE_GESTURE_SLOP) ||
+                 (abs(y[i] - s_capture.hold_y[i]) > CAPTURE_GESTURE_SLOP);
+    }
+    // A pinch or a two finger swipe is not a hold, start over from where the fingers are
+    if ((s_capture.hold_start_us == 0) || moved) {
+        memcpy(s_capture.hold_x, x, sizeof(x));
+        memcpy(s_capture.hold_y, y, sizeof(y));
+        s_capture.hold_start_us = now_us;
+        s_capture.hold_stage = 0;
+        return;
+    }
+
+    held_ms = (now_us - s_capture.hold_start_us) / 1000;
+    if ((s_capture.hold_stage == 0) && (held_ms >= CONFIG_SCREEN_CAPTURE_GESTURE_HOLD_MS)) {
+        s_capture.hold_stage = 1;
+        xTaskNotify(s_capture.task, CAPTURE_NOTIFY_SHOT, eSetBits);
+    } else if ((s_capture.hold_stage == 1) && (held_ms >= 3 * CONFIG_SCREEN_CAPTURE_GESTURE_HOLD_MS)) {
+        s_capture.hold_stage = 2;
+        xTaskNotify(s_capture.task, CAPTURE_NOTIFY_TOGGLE, eSetBits);
+    }
+}
+
+static void capture_hook_gesture(lv_disp_t *disp)
+{
+    lv_indev_t *indev = lv_indev_get_next(NULL);
+
+    while ((indev != NULL) && ((lv_indev_get_type(indev) != LV_INDEV_TYPE_POINTER) || (indev->driver->disp != disp))) {
+        indev = lv_indev_get_next(indev);
+    }
+    if ((indev == NULL) || (touch_points_hook(disp) != ESP_OK)) {
+        ESP_LOGW(TAG, "No multi-touch panel, the capture gesture is off");
+        return;
+    }
+    if (!esp_brookesia_core_touch_hook_add(indev, capture_on_touch, NULL)) {
+        touch_points_unhook();
+        ESP_LOGW(TAG, "Add touch hook failed, the capture gesture is off");
+    }
+}
+#endif
+
+static void capture_task(void *arg)
+{
+    const TickType_t frame_ticks = MAX(pdMS_TO_TICKS(1000 / CONFIG_SCREEN_CAPTURE_RECORD_FPS), 1);
+    TickType_t next_tick = 0;
+    TickType_t wait_ticks = portMAX_DELAY;
+    uint32_t bits = 0;
+    char path[SCREEN_CAPTURE_PATH_LEN_MAX];
+
+    while (1) {
+        bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait_ticks);
+        if (bits & CAPTURE_NOTIFY_SHOT) {
+            if (screen_capture_shot(path, sizeof(path)) == ESP_OK) {
+                ESP_LOGI(TAG, "Saved %s", path);
+            }
+        }
+        if (bits & CAPTURE_NOTIFY_TOGGLE) {
+            s_capture.recording = !s_capture.recording;
+        }
+
+        xSemaphoreTake(s_capture.lock, portMAX_DELAY);
+        if (s_capture.recording && (s_capture.record_file == NULL)) {
+            if (capture_record_open() == ESP_OK) {
+                next_tick = xTaskGetTickCount();
+            } else {
+                s_capture.recording = false;
+            }
+        } else if (!s_capture.recording) {
+            capture_record_close();
+        }
+        if ((s_capture.record_file != NULL) && ((int32_t)(xTaskGetTickCount() - next_tick) >= 0)) {
+            if (capture_record_frame() == ESP_OK) {
+                // Frames missed by a slow card are caught up with copies of the last one, cheap to write
+                next_tick += frame_ticks;
+            } else {
+                s_capture.recording = false;
+                capture_record_close();
+            }
+        }
+        if (s_capture.record_file != NULL) {
+            TickType_t now_tick = xTaskGetTickCount();
+            wait_ticks = ((int32_t)(next_tick - now_tick) > 0) ? (next_tick - now_tick) : 0;
+        } else {
+            wait_ticks = portMAX_DELAY;
+        }
+        xSemaphoreGive(s_capture.lock);
+    }
+}
+
+esp_err_t screen_capture_init(lv_disp_t *disp)
+{
+    ESP_RETURN_ON_FALSE(disp && disp->driver && disp->driver->flush_cb, ESP_ERR_INVALID_ARG, TAG, "Invalid display");
+    ESP_RETURN_ON_FALSE(s_capture.disp == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    s_capture.lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_capture.lock, ESP_ERR_NO_MEM, TAG, "Create lock failed");
+    if (task_config_create(TASK_CONFIG_SCREEN_CAPTURE, capture_task, NULL, &s_capture.task) != pdPASS) {
+        vSemaphoreDelete(s_capture.lock);
+        s_capture.lock = NULL;
+        ESP_LOGE(TAG, "Create capture task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_capture.disp = disp;
+    s_capture.flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = capture_on_flush;
+
+    if (usb_msc_add_listener(capture_on_card_owner, NULL) == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "usb_msc_add_listener failed, a recording may be cut by the USB host");
+    }
+#if CONFIG_SCREEN_CAPTURE_GESTURE
+    capture_hook_gesture(disp);
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t screen_capture_shot(char *path, size_t path_len)
+{
+    esp_err_t ret = ESP_OK;
+    char shot_path[SCREEN_CAPTURE_PATH_LEN_MAX];
+    FILE *fp = NULL;
+    size_t written = 0;
+
+    ESP_RETURN_ON_FALSE(s_capture.disp, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    xSemaphoreTake(s_capture.lock, portMAX_DELAY);
+    ESP_GOTO_ON_FALSE(!usb_msc_host_owns_card(), ESP_ERR_INVALID_STATE, end, TAG, "The SD card is used by USB");
+    ESP_GOTO_ON_ERROR(capture_session_begin(), end, TAG, "Begin session failed");
+    ESP_GOTO_ON_ERROR(capture_encode(), end, TAG, "Encode shot failed");
+
+    mkdir(CAPTURE_DIR, 0775);
+    capture_make_path(shot_path, sizeof(shot_path), "shot", "jpg");
+    fp = fopen(shot_path, "wb");
+    ESP_GOTO_ON_FALSE(fp, ESP_FAIL, end, TAG, "Open %s failed, is the SD card mounted?", shot_path);
+    written = fwrite(s_capture.jpeg_buf, 1, s_capture.jpeg_size, fp);
+    fclose(fp);
+    ESP_GOTO_ON_FALSE(written == s_capture.jpeg_size, ESP_FAIL, end, TAG, "Write %s failed", shot_path);
+    if (path && (path_len > 0)) {
+        strlcpy(path, shot_path, path_len);
+    }
+
+end:
+    // A recording keeps the session, the shot is its latest frame
+    if (s_capture.record_file == NULL) {
+        capture_session_free();
+    }
+    xSemaphoreGive(s_capture.lock);
+
+    return ret;
+}
+
+esp_err_t screen_capture_record_start(void)
+{
+    ESP_RETURN_ON_FALSE(s_capture.disp, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    s_capture.recording = true;
+    xTaskNotify(s_capture.task, CAPTURE_NOTIFY_RECORD, eSetBits);
+
+    return ESP_OK;
+}
+
+esp_err_t screen_capture_record_stop(void)
+{
+    ESP_RETURN_ON_FALSE(s_capture.disp, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    s_capture.recording = false;
+    xTaskNotify(s_capture.task, CAPTURE_NOTIFY_RECORD, eSetBits);
+
+    return ESP_OK;
+}
+
+bool screen_capture_is_recording(void)
+{
+    return s_capture.recording;
+}
+
+#else
+
+esp_err_t screen_capture_init(lv_disp_t *disp)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t screen_capture_shot(char *path, size_t path_len)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t screen_capture_record_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t screen_capture_record_stop(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool screen_capture_is_recording(void)
+{
+    return false;
+}
+
+#endif /* CONFIG_SCREEN_CAPTURE */
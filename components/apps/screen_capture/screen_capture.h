@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCREEN_CAPTURE_PATH_LEN_MAX     (64)
+
+/**
+ * @brief Hook a display for the screenshots and the recordings.
+ *
+ * Must be called once with the LVGL lock held. The flush of the display is chained to know when the screen changed,
+ * and with `CONFIG_SCREEN_CAPTURE_GESTURE` two fingers held still on its touch panel for
+ * `CONFIG_SCREEN_CAPTURE_GESTURE_HOLD_MS` take a screenshot, holding them three times as long starts or stops a
+ * recording. The buffers and the JPEG encoder are only allocated while capturing.
+ *
+ * @param disp Display to capture
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if called twice, ESP_ERR_NO_MEM, or
+ *         ESP_ERR_NOT_SUPPORTED if the capture is disabled.
+ */
+esp_err_t screen_capture_init(lv_disp_t *disp);
+
+/**
+ * @brief Take a screenshot of the active screen and save it to `BSP_SD_MOUNT_POINT "/screenshots"`.
+ *
+ * The screen is rendered by `lv_snapshot` into a buffer of the hardware JPEG encoder, then encoded and written to
+ * `shot_YYYYMMDD_HHMMSS.jpg`, or `shot_<uptime in ms>.jpg` while the clock isn't set. The top and system layers are
+ * not part of the shot. Also works while recording. Blocks for the render, the encode and the write, must not be
+ * called from the LVGL task or with the LVGL lock held.
+ *
+ * @param path     Output path of the file, can be NULL
+ * @param path_len Size of `path`, `SCREEN_CAPTURE_PATH_LEN_MAX` is enough
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before `screen_capture_init` or while a USB host has the SD card,
+ *         ESP_ERR_NO_MEM, ESP_FAIL if the file can't be written, the errors of the encoder, or ESP_ERR_NOT_SUPPORTED if
+ *         the capture is disabled.
+ */
+esp_err_t screen_capture_shot(char *path, size_t path_len);
+
+/**
+ * @brief Start recording the screen to `BSP_SD_MOUNT_POINT "/screenshots/rec_YYYYMMDD_HHMMSS.mjpeg"`.
+ *
+ * The file is a raw Motion JPEG stream at `CONFIG_SCREEN_CAPTURE_RECORD_FPS`, playable with
+ * `ffplay -f mjpeg -framerate <fps>`. A frame is rendered and encoded only if the display flushed since the previous
+ * one, otherwise the previous JPEG is written again so the stream keeps the timing. The recording stops when a USB
+ * host takes the SD card or the file can't be written.
+ *
+ * @return ESP_OK on success or if already recording, ESP_ERR_INVALID_STATE before `screen_capture_init`, or
+ *         ESP_ERR_NOT_SUPPORTED if the capture is disabled.
+ */
+esp_err_t screen_capture_record_start(void);
+
+/**
+ * @brief Stop the recording, the file is closed by the capture task after the current frame.
+ *
+ * @return ESP_OK on success or if not recording, ESP_ERR_INVALID_STATE before `screen_capture_init`, or
+ *         ESP_ERR_NOT_SUPPORTED if the capture is disabled.
+ */
+esp_err_t screen_capture_record_stop(void);
+
+/**
+ * @brief Check if the screen is being recorded.
+ */
+bool screen_capture_is_recording(void);
+
+#ifdef __cplusplus
+}
+#endif
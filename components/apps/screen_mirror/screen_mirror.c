@@ -0,0 +1,566 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
+#include "screen_mirror.h"
+
+static const char *TAG = "screen_mirror";
+
+#if CONFIG_SCREEN_MIRROR
+#include "esp_http_server.h"
+#include "driver/jpeg_encode.h"
+
+#define MIRROR_WS_URI               "/mirror"
+#define MIRROR_BAND_NUM_MAX         (4)     /* Bands of rows kept apart, more are merged into one */
+#define MIRROR_BAND_ALIGN           (8)     /* Rows of a JPEG MCU with 4:2:2 sampling */
+#define MIRROR_HEADER_SIZE          (8)
+#define MIRROR_TOUCH_SIZE           (5)
+#define MIRROR_HELLO_LEN_MAX        (48)
+#define MIRROR_JPEG_BUF_DIV         (2)     /* A JPEG band is far smaller than half of its RGB565 pixels */
+#define MIRROR_CODEC_TIMEOUT_MS     (100)
+#define MIRROR_NO_CLIENT            (-1)
+
+#define ALIGN_UP(num, align)        (((num) + ((align) - 1)) / (align) * (align))
+#define ALIGN_DOWN(num, align)      ((num) / (align) * (align))
+
+typedef void (*mirror_flush_cb_t)(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+typedef void (*mirror_read_cb_t)(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
+
+typedef struct {
+    uint16_t y1;                /* First row */
+    uint16_t y2;                /* Row after the last one */
+} mirror_band_t;
+
+static struct {
+    lv_disp_t *disp;
+    lv_indev_t *touch;
+    mirror_flush_cb_t flush_cb;
+    mirror_read_cb_t read_cb;
+    uint16_t width;
+    uint16_t height;
+    httpd_handle_t server;
+    TaskHandle_t task;
+    SemaphoreHandle_t shadow_lock;  /* Held by a flush while it copies, and while the session buffers are freed */
+    portMUX_TYPE lock;              /* Guards the fields below */
+    int client_fd;
+    volatile bool streaming;
+    mirror_band_t bands[MIRROR_BAND_NUM_MAX];
+    int band_num;
+    lv_point_t touch_point;
+    bool touch_pressed;
+    bool touch_press_pending;       /* A press not read yet, so a tap shorter than the read period still clicks */
+    bool touch_active;              /* The last read reported the remote touch */
+    // Session, only used by the mirror task apart from `shadow` being written by the flush
+    lv_color_t *shadow;
+    uint8_t *jpeg_buf;
+    size_t jpeg_buf_size;
+    jpeg_encoder_handle_t encoder;
+    uint32_t frame_num;
+    uint64_t byte_num;
+    int64_t start_us;
+} s_mirror = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+    .client_fd = MIRROR_NO_CLIENT,
+};
+
+static const char MIRROR_PAGE[] =
+    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width\"><title>Screen mirror</title>"
+    "</head><body style=\"margin:0;background:#222\">"
+    "<canvas id=\"c\" style=\"touch-action:none;max-width:100vw;max-height:100vh\"></canvas><script>"
+    "const c=document.getElementById('c'),g=c.getContext('2d');"
+    "const ws=new WebSocket('ws://'+location.host+'" MIRROR_WS_URI "');ws.binaryType='arraybuffer';"
+    "let q=Promise.resolve(),down=false;"
+    "ws.onmessage=e=>{if(typeof e.data==='string'){const s=JSON.parse(e.data);c.width=s.width;c.height=s.height;return;}"
+    "const h=new DataView(e.data),p=createImageBitmap(new Blob([e.data.slice(8)],{type:'image/jpeg'}));"
+    "q=q.then(()=>p).then(b=>g.drawImage(b,h.getUint16(0,true),h.getUint16(2,true))).catch(()=>{});};"
+    "function send(e,p){if(ws.readyState!==1)return;const r=c.getBoundingClientRect(),d=new DataView(new ArrayBuffer(5));"
+    "d.setUint8(0,p);d.setUint16(1,Math.max(0,(e.clientX-r.left)*c.width/r.width),true);"
+    "d.setUint16(3,Math.max(0,(e.clientY-r.top)*c.height/r.height),true);ws.send(d.buffer);}"
+    "c.onpointerdown=e=>{down=true;c.setPointerCapture(e.pointerId);send(e,1);};"
+    "c.onpointermove=e=>{if(down)send(e,1);};"
+    "c.onpointerup=c.onpointercancel=e=>{if(down){down=false;send(e,0);}};"
+    "</script></body></html>";
+
+/* Called with `lock` held */
+static void mirror_add_band(int32_t y1, int32_t y2)
+{
+    int i = 0;
+
+    y1 = ALIGN_DOWN(y1, MIRROR_BAND_ALIGN);
+    y2 = MIN(ALIGN_UP(y2, MIRROR_BAND_ALIGN), s_mirror.height);
+    // Merge the bands the new one touches, and all of them once there are too many
+    while (i < s_mirror.band_num) {
+        mirror_band_t *band = &s_mirror.bands[i];
+        if (((band->y1 <= y2) && (y1 <= band->y2)) || (s_mirror.band_num == MIRROR_BAND_NUM_MAX)) {
+            y1 = MIN(y1, band->y1);
+            y2 = MAX(y2, band->y2);
+            *band = s_mirror.bands[--s_mirror.band_num];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    s_mirror.bands[s_mirror.band_num++] = (mirror_band_t) {
+        .y1 = y1, .y2 = y2,
+    };
+}
+
+static void mirror_copy_area(const lv_disp_drv_t *disp_drv, const lv_area_t *area, const lv_color_t *color_p)
+{
+    lv_area_t clip = {
+        .x1 = MAX(area->x1, 0), .y1 = MAX(area->y1, 0),
+        .x2 = MIN(area->x2, s_mirror.width - 1), .y2 = MIN(area->y2, s_mirror.height - 1),
+    };
+    int32_t width = lv_area_get_width(&clip);
+    int32_t src_stride = lv_area_get_width(area);
+    const lv_color_t *src = color_p;
+    lv_color_t *dst = s_mirror.shadow + clip.y1 * s_mirror.width + clip.x1;
+
+    if ((width <= 0) || (clip.y2 < clip.y1)) {
+        return;
+    }
+    // Partial buffers hold the area only, direct mode and full refresh buffers are the whole screen
+    if (disp_drv->direct_mode || disp_drv->full_refresh) {
+        src_stride = disp_drv->hor_res;
+        src += clip.y1 * src_stride + clip.x1;
+    } else {
+        src += (clip.y1 - area->y1) * src_stride + (clip.x1 - area->x1);
+    }
+    for (int32_t y = clip.y1; y <= clip.y2; y++) {
+        memcpy(dst, src, width * sizeof(lv_color_t));
+        dst += s_mirror.width;
+        src += src_stride;
+    }
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    mirror_add_band(clip.y1, clip.y2 + 1);
+    portEXIT_CRITICAL(&s_mirror.lock);
+    xTaskNotifyGive(s_mirror.task);
+}
+
+static void mirror_on_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    // LVGL doesn't draw into the buffer before the flush is done, copy it before the panel gets it. The lock is only
+    // missed while a session is being torn down.
+    if (s_mirror.streaming && (xSemaphoreTake(s_mirror.shadow_lock, 0) == pdTRUE)) {
+        if (s_mirror.streaming) {
+            mirror_copy_area(disp_drv, area, color_p);
+        }
+        xSemaphoreGive(s_mirror.shadow_lock);
+    }
+    s_mirror.flush_cb(disp_drv, area, color_p);
+}
+
+#if CONFIG_SCREEN_MIRROR_TOUCH
+static void mirror_on_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+{
+    s_mirror.read_cb(indev_drv, data);
+    // The panel wins while it is touched
+    if (data->state == LV_INDEV_STATE_PRESSED) {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    if (s_mirror.touch_pressed || s_mirror.touch_press_pending) {
+        data->point = s_mirror.touch_point;
+        data->state = LV_INDEV_STATE_PRESSED;
+        s_mirror.touch_press_pending = false;
+        s_mirror.touch_active = true;
+    } else if (s_mirror.touch_active) {
+        data->point = s_mirror.touch_point;
+        s_mirror.touch_active = false;
+    }
+    portEXIT_CRITICAL(&s_mirror.lock);
+}
+#endif
+
+static void mirror_session_free(void)
+{
+    if (s_mirror.encoder) {
+        jpeg_del_encoder_engine(s_mirror.encoder);
+        s_mirror.encoder = NULL;
+    }
+    if (s_mirror.jpeg_buf) {
+        free(s_mirror.jpeg_buf);
+        s_mirror.jpeg_buf = NULL;
+    }
+    if (s_mirror.shadow) {
+        free(s_mirror.shadow);
+        s_mirror.shadow = NULL;
+    }
+}
+
+static esp_err_t mirror_session_begin(int fd)
+{
+    esp_err_t ret = ESP_OK;
+    size_t shadow_size = 0;
+    size_t frame_size = s_mirror.width * s_mirror.height * sizeof(lv_color_t);
+    char hello[MIRROR_HELLO_LEN_MAX];
+    jpeg_encode_engine_cfg_t encode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = MIRROR_CODEC_TIMEOUT_MS,
+    };
+    jpeg_encode_memory_alloc_cfg_t in_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_INPUT_BUFFER,
+    };
+    jpeg_encode_memory_alloc_cfg_t out_mem_cfg = {
+        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+    };
+    httpd_ws_frame_t frame = {
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)hello,
+    };
+
+    ESP_GOTO_ON_ERROR(jpeg_new_encoder_engine(&encode_eng_cfg, &s_mirror.encoder), err, TAG,
+                      "Create JPEG encoder failed");
+    // The encoder reads the bands straight from the copy of the screen
+    s_mirror.shadow = (lv_color_t *)jpeg_alloc_encoder_mem(frame_size, &in_mem_cfg, &shadow_size);
+    ESP_GOTO_ON_FALSE(s_mirror.shadow, ESP_ERR_NO_MEM, err, TAG, "Allocate screen copy failed");
+    s_mirror.jpeg_buf = (uint8_t *)jpeg_alloc_encoder_mem(frame_size / MIRROR_JPEG_BUF_DIV, &out_mem_cfg,
+                                                          &s_mirror.jpeg_buf_size);
+    ESP_GOTO_ON_FALSE(s_mirror.jpeg_buf, ESP_ERR_NO_MEM, err, TAG, "Allocate JPEG buffer failed");
+
+    frame.len = snprintf(hello, sizeof(hello), "{\"width\":%u,\"height\":%u}", s_mirror.width, s_mirror.height);
+    ESP_GOTO_ON_ERROR(httpd_ws_send_frame_async(s_mirror.server, fd, &frame), err, TAG, "Send size failed");
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    s_mirror.band_num = 0;
+    s_mirror.streaming = true;
+    portEXIT_CRITICAL(&s_mirror.lock);
+    s_mirror.frame_num = 0;
+    s_mirror.byte_num = 0;
+    s_mirror.start_us = esp_timer_get_time();
+
+    // The copy starts empty, redraw the whole screen once so the viewer gets a full frame
+    bsp_display_lock(0);
+    lv_obj_invalidate(lv_disp_get_scr_act(s_mirror.disp));
+    bsp_display_unlock();
+    ESP_LOGI(TAG, "Streaming %ux%u", s_mirror.width, s_mirror.height);
+
+    return ESP_OK;
+
+err:
+    mirror_session_free();
+
+    return ret;
+}
+
+static void mirror_session_end(void)
+{
+    int64_t time_ms = (esp_timer_get_time() - s_mirror.start_us) / 1000;
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    s_mirror.streaming = false;
+    portEXIT_CRITICAL(&s_mirror.lock);
+    // Wait for a flush still copying into the screen copy
+    xSemaphoreTake(s_mirror.shadow_lock, portMAX_DELAY);
+    mirror_session_free();
+    xSemaphoreGive(s_mirror.shadow_lock);
+
+    ESP_LOGI(TAG, "Session ended, %lu frames, %llu KB in %lld ms", (unsigned long)s_mirror.frame_num,
+             s_mirror.byte_num / 1024, time_ms);
+}
+
+/* Forget a viewer the task gave up on, a new connection still replaces it */
+static void mirror_drop_client(int fd)
+{
+    portENTER_CRITICAL(&s_mirror.lock);
+    if (s_mirror.client_fd == fd) {
+        s_mirror.client_fd = MIRROR_NO_CLIENT;
+        s_mirror.touch_pressed = false;
+    }
+    portEXIT_CRITICAL(&s_mirror.lock);
+    httpd_sess_trigger_close(s_mirror.server, fd);
+}
+
+static esp_err_t mirror_send_band(int fd, const mirror_band_t *band)
+{
+    uint32_t jpeg_size = 0;
+    uint16_t rows = band->y2 - band->y1;
+    uint8_t header[MIRROR_HEADER_SIZE] = {
+        0, 0, band->y1 & 0xff, band->y1 >> 8, s_mirror.width & 0xff, s_mirror.width >> 8, rows & 0xff, rows >> 8,
+    };
+    jpeg_encode_cfg_t encode_cfg = {
+        .height = rows,
+        .width = s_mirror.width,
+        .src_type = JPEG_ENCODE_IN_FORMAT_RGB565,
+        .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+        .image_quality = CONFIG_SCREEN_MIRROR_JPEG_QUALITY,
+    };
+    // Bands are whole rows, so they are contiguous in the copy and need no staging buffer
+    const lv_color_t *src = s_mirror.shadow + band->y1 * s_mirror.width;
+    // The header and the JPEG are two fragments of one message, the JPEG stays in the aligned encoder buffer
+    httpd_ws_frame_t head_frame = {
+        .final = false,
+        .fragmented = true,
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = header,
+        .len = sizeof(header),
+    };
+    httpd_ws_frame_t jpeg_frame = {
+        .final = true,
+        .fragmented = true,
+        .type = HTTPD_WS_TYPE_CONTINUE,
+        .payload = s_mirror.jpeg_buf,
+    };
+
+    // Rows drawn during the encode are in a newer band, the viewer gets them with the next frame
+    ESP_RETURN_ON_ERROR(jpeg_encoder_process(s_mirror.encoder, &encode_cfg, (const uint8_t *)src,
+                                             s_mirror.width * rows * sizeof(lv_color_t), s_mirror.jpeg_buf,
+                                             s_mirror.jpeg_buf_size, &jpeg_size), TAG, "Encode failed");
+    jpeg_frame.len = jpeg_size;
+
+    // Blocks while the socket is full, this is the backpressure of a slow viewer
+    ESP_RETURN_ON_ERROR(httpd_ws_send_frame_async(s_mirror.server, fd, &head_frame), TAG, "Send failed");
+    ESP_RETURN_ON_ERROR(httpd_ws_send_frame_async(s_mirror.server, fd, &jpeg_frame), TAG, "Send failed");
+    s_mirror.byte_num += jpeg_size + sizeof(header);
+
+    return ESP_OK;
+}
+
+static esp_err_t mirror_send_frame(int fd)
+{
+    mirror_band_t bands[MIRROR_BAND_NUM_MAX];
+    int band_num = 0;
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    band_num = s_mirror.band_num;
+    memcpy(bands, s_mirror.bands, band_num * sizeof(bands[0]));
+    s_mirror.band_num = 0;
+    portEXIT_CRITICAL(&s_mirror.lock);
+
+    for (int i = 0; i < band_num; i++) {
+        ESP_RETURN_ON_ERROR(mirror_send_band(fd, &bands[i]), TAG, "Send band failed");
+    }
+    s_mirror.frame_num += (band_num > 0) ? 1 : 0;
+
+    return ESP_OK;
+}
+
+static void mirror_task(void *arg)
+{
+    const TickType_t frame_ticks = MAX(pdMS_TO_TICKS(1000 / CONFIG_SCREEN_MIRROR_FPS_MAX), 1);
+    int session_fd = MIRROR_NO_CLIENT;
+    int client_fd = MIRROR_NO_CLIENT;
+
+    while (1) {
+        // Woken by each flush of a session, and when a viewer connects or leaves
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&s_mirror.lock);
+        client_fd = s_mirror.client_fd;
+        portEXIT_CRITICAL(&s_mirror.lock);
+        if (client_fd != session_fd) {
+            if (session_fd != MIRROR_NO_CLIENT) {
+                mirror_session_end();
+                session_fd = MIRROR_NO_CLIENT;
+            }
+            if (client_fd != MIRROR_NO_CLIENT) {
+                if (mirror_session_begin(client_fd) == ESP_OK) {
+                    session_fd = client_fd;
+                } else {
+                    mirror_drop_client(client_fd);
+                }
+            }
+            continue;
+        }
+        if (session_fd == MIRROR_NO_CLIENT) {
+            continue;
+        }
+
+        TickType_t start_tick = xTaskGetTickCount();
+        if (mirror_send_frame(session_fd) != ESP_OK) {
+            mirror_session_end();
+            mirror_drop_client(session_fd);
+            session_fd = MIRROR_NO_CLIENT;
+            continue;
+        }
+        // Flushes during the wait are merged into the next frame
+        TickType_t spent_ticks = xTaskGetTickCount() - start_tick;
+        if (spent_ticks < frame_ticks) {
+            vTaskDelay(frame_ticks - spent_ticks);
+        }
+    }
+}
+
+#if CONFIG_SCREEN_MIRROR_TOUCH
+static void mirror_set_touch(const uint8_t *payload)
+{
+    bool pressed = (payload[0] != 0);
+    lv_point_t point = {
+        .x = MIN(payload[1] | (payload[2] << 8), s_mirror.width - 1),
+        .y = MIN(payload[3] | (payload[4] << 8), s_mirror.height - 1),
+    };
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    s_mirror.touch_point = point;
+    s_mirror.touch_press_pending |= (pressed && !s_mirror.touch_pressed);
+    s_mirror.touch_pressed = pressed;
+    portEXIT_CRITICAL(&s_mirror.lock);
+}
+#endif
+
+static esp_err_t mirror_ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    int old_fd = MIRROR_NO_CLIENT;
+    uint8_t payload[MIRROR_TOUCH_SIZE];
+    httpd_ws_frame_t frame = { 0 };
+
+    if (req->method == HTTP_GET) {
+        // The handshake is done, a new viewer replaces the previous one
+        portENTER_CRITICAL(&s_mirror.lock);
+        old_fd = s_mirror.client_fd;
+        s_mirror.client_fd = fd;
+        s_mirror.touch_pressed = false;
+        portEXIT_CRITICAL(&s_mirror.lock);
+        if (old_fd != MIRROR_NO_CLIENT) {
+            httpd_sess_trigger_close(req->handle, old_fd);
+        }
+        xTaskNotifyGive(s_mirror.task);
+        ESP_LOGI(TAG, "Viewer connected");
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(httpd_ws_recv_frame(req, &frame, 0), TAG, "Receive frame length failed");
+    ESP_RETURN_ON_FALSE(frame.len <= sizeof(payload), ESP_ERR_INVALID_SIZE, TAG, "Frame too long");
+    frame.payload = payload;
+    ESP_RETURN_ON_ERROR(httpd_ws_recv_frame(req, &frame, frame.len), TAG, "Receive frame failed");
+
+#if CONFIG_SCREEN_MIRROR_TOUCH
+    if ((frame.type == HTTPD_WS_TYPE_BINARY) && (frame.len == MIRROR_TOUCH_SIZE) && (fd == s_mirror.client_fd)) {
+        mirror_set_touch(payload);
+    }
+#endif
+
+    return ESP_OK;
+}
+
+static esp_err_t mirror_page_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+
+    return httpd_resp_send(req, MIRROR_PAGE, sizeof(MIRROR_PAGE) - 1);
+}
+
+static void mirror_on_close(httpd_handle_t hd, int sockfd)
+{
+    bool is_client = false;
+
+    portENTER_CRITICAL(&s_mirror.lock);
+    if (s_mirror.client_fd == sockfd) {
+        s_mirror.client_fd = MIRROR_NO_CLIENT;
+        s_mirror.touch_pressed = false;
+        is_client = true;
+    }
+    portEXIT_CRITICAL(&s_mirror.lock);
+    if (is_client) {
+        xTaskNotifyGive(s_mirror.task);
+        ESP_LOGI(TAG, "Viewer left");
+    }
+    close(sockfd);
+}
+
+esp_err_t screen_mirror_init(lv_disp_t *disp)
+{
+    ESP_RETURN_ON_FALSE(disp && disp->driver && disp->driver->flush_cb, ESP_ERR_INVALID_ARG, TAG, "Invalid display");
+    ESP_RETURN_ON_FALSE(s_mirror.disp == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    s_mirror.shadow_lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_mirror.shadow_lock, ESP_ERR_NO_MEM, TAG, "Create lock failed");
+    if (task_config_create(TASK_CONFIG_SCREEN_MIRROR, mirror_task, NULL, &s_mirror.task) != pdPASS) {
+        vSemaphoreDelete(s_mirror.shadow_lock);
+        s_mirror.shadow_lock = NULL;
+        ESP_LOGE(TAG, "Create mirror task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Buffers are in the orientation of the panel
+    s_mirror.disp = disp;
+    s_mirror.width = disp->driver->hor_res;
+    s_mirror.height = disp->driver->ver_res;
+    s_mirror.flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = mirror_on_flush;
+
+#if CONFIG_SCREEN_MIRROR_TOUCH
+    lv_indev_t *indev = lv_indev_get_next(NULL);
+    while ((indev != NULL) && ((lv_indev_get_type(indev) != LV_INDEV_TYPE_POINTER) || (indev->driver->disp != disp))) {
+        indev = lv_indev_get_next(indev);
+    }
+    if ((indev != NULL) && (indev->driver->read_cb != NULL)) {
+        s_mirror.touch = indev;
+        s_mirror.read_cb = indev->driver->read_cb;
+        indev->driver->read_cb = mirror_on_read;
+    } else {
+        ESP_LOGW(TAG, "No touch panel, remote touches are ignored");
+    }
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t screen_mirror_start(void)
+{
+    const task_config_t *task = task_config_get(TASK_CONFIG_SCREEN_MIRROR_HTTPD);
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    httpd_uri_t page_uri = {
+        .uri = "/",
+        .method = HTTP_GET,
+        .handler = mirror_page_handler,
+    };
+    httpd_uri_t ws_uri = {
+        .uri = MIRROR_WS_URI,
+        .method = HTTP_GET,
+        .handler = mirror_ws_handler,
+        .is_websocket = true,
+    };
+
+    ESP_RETURN_ON_FALSE(s_mirror.disp, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    if (s_mirror.server) {
+        return ESP_OK;
+    }
+
+    config.server_port = CONFIG_SCREEN_MIRROR_PORT;
+    config.task_priority = task->priority;
+    config.stack_size = task->stack_size;
+    config.core_id = task->core_id;
+    config.close_fn = mirror_on_close;
+    config.lru_purge_enable = true;
+    ESP_RETURN_ON_ERROR(httpd_start(&s_mirror.server, &config), TAG, "Start server failed");
+    httpd_register_uri_handler(s_mirror.server, &page_uri);
+    httpd_register_uri_handler(s_mirror.server, &ws_uri);
+    ESP_LOGI(TAG, "Mirror server on port %d", config.server_port);
+
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t screen_mirror_init(lv_disp_t *disp)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t screen_mirror_start(void)
+{
+    ESP_LOGD(TAG, "Screen mirror disabled");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif /* CONFIG_SCREEN_MIRROR */
@@ -0,0 +1,49 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Hook the flush of a display and the read of its touch panel for mirroring.
+ *
+ * Must be called with the LVGL lock held, once. The hooks only test a flag until a viewer connects to the server of
+ * `screen_mirror_start`. While one is connected, each flushed area is copied into a PSRAM copy of the screen, and the
+ * rows changed since the last frame are JPEG encoded by the hardware encoder and sent from a low priority task, at
+ * most `CONFIG_SCREEN_MIRROR_FPS_MAX` times per second. Areas drawn while a frame is being sent are merged into the
+ * next one, so a slow link lowers the mirror frame rate, not the local one.
+ *
+ * @param disp Display to mirror. Its pointer input device, if any, gets the remote touches with
+ *             `CONFIG_SCREEN_MIRROR_TOUCH`.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if called twice, ESP_ERR_NO_MEM, or ESP_ERR_NOT_SUPPORTED if
+ *         mirroring is disabled.
+ */
+esp_err_t screen_mirror_init(lv_disp_t *disp);
+
+/**
+ * @brief Start the mirror server on `CONFIG_SCREEN_MIRROR_PORT`, call it once the network is up.
+ *
+ * The page at `/` shows the screen and sends the pointer of the browser back as touches. The screen is streamed over
+ * the WebSocket at `/mirror`: a text message `{"width":W,"height":H}`, then one binary message per band of rows, an
+ * 8 bytes header of little endian `uint16_t` x, y, width and height followed by the JPEG. Touches are binary messages
+ * of 5 bytes, 1 if pressed or 0, then little endian `uint16_t` x and y. A new viewer replaces the previous one.
+ *
+ * @return ESP_OK on success or if the server already runs, ESP_ERR_INVALID_STATE before `screen_mirror_init`, the
+ *         errors of `httpd_start`, or ESP_ERR_NOT_SUPPORTED if mirroring is disabled.
+ */
+esp_err_t screen_mirror_start(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,193 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_cache.h"
+#include "esp_memory_utils.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdmmc_host.h"
+#include "bsp/esp-bsp.h"
+#include "sd_io.h"
+
+#define SD_IO_ALIGN_MIN             (64)
+
+static const char *TAG = "sd_io";
+
+static portMUX_TYPE sd_io_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static sd_io_stats_t sd_io_stats;
+
+static size_t sd_io_get_align(bool internal)
+{
+    size_t align = 0;
+
+    esp_cache_get_alignment(internal ? MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA : MALLOC_CAP_SPIRAM, &align);
+
+    return (align > SD_IO_ALIGN_MIN) ? align : SD_IO_ALIGN_MIN;
+}
+
+#if CONFIG_SD_IO_HIGH_SPEED
+static void sd_io_get_config(sdmmc_host_t *host, sdmmc_slot_config_t *slot)
+{
+    bsp_sdcard_get_sdmmc_host(SDMMC_HOST_SLOT_0, host);
+    bsp_sdcard_sdmmc_get_slot(SDMMC_HOST_SLOT_0, slot);
+    host->max_freq_khz = SDMMC_FREQ_HIGHSPEED;
+    slot->width = 4;
+}
+#endif
+
+esp_err_t sd_io_mount(void)
+{
+#if CONFIG_SD_IO_HIGH_SPEED
+    sdmmc_host_t host;
+    sdmmc_slot_config_t slot;
+    const esp_vfs_fat_sdmmc_mount_config_t mount = {
+#ifdef CONFIG_BSP_SD_FORMAT_ON_MOUNT_FAIL
+        .format_if_mount_failed = true,
+#else
+        .format_if_mount_failed = false,
+#endif
+        .max_files = SD_IO_MAX_FILES,
+        .allocation_unit_size = SD_IO_ALLOC_UNIT_SIZE,
+    };
+    bsp_sdcard_cfg_t cfg = {
+        .mount = &mount,
+        .host = &host,
+        .slot.sdmmc = &slot,
+    };
+
+    sd_io_get_config(&host, &slot);
+    if (bsp_sdcard_sdmmc_mount(&cfg) == ESP_OK) {
+        sdmmc_card_t *card = bsp_sdcard_get_handle();
+        ESP_LOGI(TAG, "Mounted at %d kHz, %d-bit bus", card->real_freq_khz, 1 << card->log_bus_width);
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "High speed mount failed, using the defaults");
+#endif
+
+    return bsp_sdcard_mount();
+}
+
+esp_err_t sd_io_card_init(sdmmc_card_t *card)
+{
+    esp_err_t ret = ESP_OK;
+    sdmmc_host_t host;
+    sdmmc_slot_config_t slot;
+
+    ESP_RETURN_ON_FALSE(card, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+#if CONFIG_SD_IO_HIGH_SPEED
+    sd_io_get_config(&host, &slot);
+#else
+    bsp_sdcard_get_sdmmc_host(SDMMC_HOST_SLOT_0, &host);
+    bsp_sdcard_sdmmc_get_slot(SDMMC_HOST_SLOT_0, &slot);
+#endif
+    ESP_RETURN_ON_ERROR(sdmmc_host_init(), TAG, "Init host failed");
+    ESP_GOTO_ON_ERROR(sdmmc_host_init_slot(host.slot, &slot), err, TAG, "Init slot failed");
+    ret = sdmmc_card_init(&host, card);
+#if CONFIG_SD_IO_HIGH_SPEED
+    if (ret != ESP_OK) {
+        // Same fallback as sd_io_mount, the BSP defaults
+        ESP_LOGW(TAG, "High speed init failed, using the defaults");
+        bsp_sdcard_get_sdmmc_host(SDMMC_HOST_SLOT_0, &host);
+        bsp_sdcard_sdmmc_get_slot(SDMMC_HOST_SLOT_0, &slot);
+        sdmmc_host_deinit();
+        ESP_RETURN_ON_ERROR(sdmmc_host_init(), TAG, "Init host failed");
+        ESP_GOTO_ON_ERROR(sdmmc_host_init_slot(host.slot, &slot), err, TAG, "Init slot failed");
+        ret = sdmmc_card_init(&host, card);
+    }
+#endif
+    ESP_GOTO_ON_ERROR(ret, err, TAG, "Init card failed");
+    ESP_LOGI(TAG, "Card at %d kHz, %d-bit bus", card->real_freq_khz, 1 << card->log_bus_width);
+
+    return ESP_OK;
+
+err:
+    sdmmc_host_deinit();
+    return ret;
+}
+
+void *sd_io_buf_alloc(size_t size, bool internal)
+{
+    size_t align = sd_io_get_align(internal);
+    uint32_t caps = internal ? MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT : MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+
+    // The length is rounded up as well, so no other data shares the last cache line
+    return heap_caps_aligned_alloc(align, (size + align - 1) / align * align, caps);
+}
+
+bool sd_io_buf_is_aligned(const void *buf)
+{
+    bool internal = !esp_ptr_external_ram(buf);
+
+    if (internal && !esp_ptr_dma_capable(buf)) {
+        return false;
+    }
+
+    return ((uintptr_t)buf % sd_io_get_align(internal)) == 0;
+}
+
+int sd_io_open(const char *path)
+{
+    ESP_RETURN_ON_FALSE(path, -1, TAG, "Invalid argument");
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ESP_LOGD(TAG, "Open %s failed", path);
+    }
+
+    return fd;
+}
+
+ssize_t sd_io_read(int fd, void *buf, size_t len)
+{
+    bool aligned = sd_io_buf_is_aligned(buf);
+    int64_t start = esp_timer_get_time();
+    ssize_t n = read(fd, buf, len);
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    portENTER_CRITICAL(&sd_io_stats_lock);
+    sd_io_stats.read_num++;
+    sd_io_stats.read_us += elapsed;
+    if (n > 0) {
+        sd_io_stats.read_bytes += n;
+    }
+    if (!aligned) {
+        sd_io_stats.unaligned_num++;
+    }
+    portEXIT_CRITICAL(&sd_io_stats_lock);
+
+    return n;
+}
+
+ssize_t sd_io_read_at(int fd, off_t offset, void *buf, size_t len)
+{
+    if (lseek(fd, offset, SEEK_SET) != offset) {
+        return -1;
+    }
+
+    return sd_io_read(fd, buf, len);
+}
+
+void sd_io_get_stats(sd_io_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&sd_io_stats_lock);
+    *stats = sd_io_stats;
+    portEXIT_CRITICAL(&sd_io_stats_lock);
+    // Bytes per microsecond are MB/s
+    stats->read_kbps = stats->read_us ? (uint32_t)(stats->read_bytes * 1000 / stats->read_us) : 0;
+}
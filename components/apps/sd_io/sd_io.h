@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "sdmmc_cmd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_IO_MAX_FILES             (8)     /*!< Two music rings, the video, the thumbnails and what the apps open */
+#define SD_IO_ALLOC_UNIT_SIZE       (64 * 1024)     /*!< Cluster size if the card has to be formatted */
+
+/**
+ * @brief Read statistics of all the `sd_io` reads since boot
+ */
+typedef struct {
+    uint64_t read_bytes;        /*!< Bytes read */
+    uint64_t read_us;           /*!< Time spent in the reads */
+    uint32_t read_num;          /*!< Number of reads */
+    uint32_t unaligned_num;     /*!< Reads into buffers the card can't DMA into, copied by the driver a sector at a time */
+    uint32_t read_kbps;         /*!< Average throughput while reading, in KB/s */
+} sd_io_stats_t;
+
+/**
+ * @brief Mount the SD card at `BSP_SD_MOUNT_POINT`.
+ *
+ * With `CONFIG_SD_IO_HIGH_SPEED` the card is mounted on the 4-bit SDMMC bus at 40 MHz, with 64 KB clusters if it
+ * has to be formatted, and with the defaults of `bsp_sdcard_mount` if that fails.
+ *
+ * @return ESP_OK on success, or the error of `bsp_sdcard_mount`.
+ */
+esp_err_t sd_io_mount(void);
+
+/**
+ * @brief Initialize the card on the bus of `sd_io_mount`, without mounting its file system.
+ *
+ * For `usb_msc`, which mounts the card itself so it can hand it between the apps and the USB host.
+ *
+ * @param card Filled with the card information, must stay valid while the card is used.
+ *
+ * @return ESP_OK on success, or the error of the SDMMC host or card init.
+ */
+esp_err_t sd_io_card_init(sdmmc_card_t *card);
+
+/**
+ * @brief Allocate a buffer the card driver can DMA into, aligned to the cache line with a length rounded up to it.
+ *
+ * @param size Size in bytes.
+ * @param internal Allocate from internal RAM instead of PSRAM.
+ *
+ * @return The buffer, to be freed with `heap_caps_free`, or NULL.
+ */
+void *sd_io_buf_alloc(size_t size, bool internal);
+
+/**
+ * @brief Check if the card driver can DMA straight into a buffer.
+ */
+bool sd_io_buf_is_aligned(const void *buf);
+
+/**
+ * @brief Open a file for reading with `sd_io_read`, without stdio buffering.
+ *
+ * @param path Path of the file.
+ *
+ * @return The file descriptor, to be closed with `close`, or -1 on failure.
+ */
+int sd_io_open(const char *path);
+
+/**
+ * @brief Read from the current position of a file, counted in the statistics.
+ *
+ * Reads into a buffer from `sd_io_buf_alloc`, at an offset and of a length that are multiples of 512 bytes, go
+ * straight from the card into the buffer with one transfer.
+ *
+ * @param fd File descriptor.
+ * @param buf Buffer to fill.
+ * @param len Bytes to read.
+ *
+ * @return The number of bytes read, 0 at the end of the file, or -1 on failure.
+ */
+ssize_t sd_io_read(int fd, void *buf, size_t len);
+
+/**
+ * @brief Read from an offset of a file, see `sd_io_read`.
+ */
+ssize_t sd_io_read_at(int fd, off_t offset, void *buf, size_t len);
+
+/**
+ * @brief Get the read statistics.
+ *
+ * @param stats Filled with the statistics.
+ */
+void sd_io_get_stats(sd_io_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,198 @@
+#include "SerialBridge.hpp"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "task_config/task_config.h"
+#include <string.h>
+
+static const char* TAG = "SerialBridge";
+
+SerialBridge::SerialBridge() :
+    _uart(nullptr),
+    _usb(nullptr),
+    _monitor_enabled(false),
+    _discarded(0),
+    _running(false),
+    _stopping(false),
+    _task(nullptr),
+    _task_exit(nullptr)
+{
+    memset(_forwarded, 0, sizeof(_forwarded));
+}
+
+SerialBridge::~SerialBridge()
+{
+    stop();
+}
+
+bool SerialBridge::start(UartService* uart, TinyUsbCdcService* usb, bool monitor)
+{
+    if (_running || uart == nullptr || usb == nullptr) {
+        return false;
+    }
+    if (uart->isCaptureMode()) {
+        ESP_LOGW(TAG, "UART is in capture mode (RX only)");
+        return false;
+    }
+
+    // 显示缓冲第一次使用时分配，之后一直保留
+    if (monitor) {
+        for (int i = 0; i < DIRECTION_COUNT; i++) {
+            if (!_monitor[i].isValid() && !_monitor[i].init(MONITOR_SIZE, MALLOC_CAP_SPIRAM)) {
+                ESP_LOGE(TAG, "Failed to allocate monitor buffer");
+                return false;
+            }
+            _monitor[i].reset();
+        }
+    }
+
+    _task_exit = xSemaphoreCreateBinary();
+    if (_task_exit == nullptr) {
+        return false;
+    }
+
+    _uart = uart;
+    _usb = usb;
+    _monitor_enabled = monitor;
+    memset(_forwarded, 0, sizeof(_forwarded));
+    _discarded = 0;
+    _stopping = false;
+    _running = true;
+
+    // 低于UART接收任务，高于USB主机任务和UI
+    if (task_config_create(TASK_CONFIG_SERIAL_BRIDGE, bridgeTask, this, &_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create bridge task");
+        _running = false;
+        vSemaphoreDelete(_task_exit);
+        _task_exit = nullptr;
+        return false;
+    }
+
+    _uart->setRxNotify(_task);
+    _usb->setRxNotify(_task);
+    xTaskNotifyGive(_task);
+
+    ESP_LOGI(TAG, "Bridge started");
+    return true;
+}
+
+void SerialBridge::stop()
+{
+    if (!_running) {
+        return;
+    }
+
+    // 先摘下接收通知，任务退出后不会再被通知
+    _uart->setRxNotify(nullptr);
+    _usb->setRxNotify(nullptr);
+
+    _stopping = true;
+    xTaskNotifyGive(_task);
+    if (xSemaphoreTake(_task_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "Bridge task did not exit");
+        return;
+    }
+
+    vSemaphoreDelete(_task_exit);
+    _task_exit = nullptr;
+    _task = nullptr;
+    _running = false;
+
+    ESP_LOGI(TAG, "Bridge stopped: %lu bytes UART->USB, %lu bytes USB->UART, %lu discarded",
+             (unsigned long)_forwarded[UART_TO_USB], (unsigned long)_forwarded[USB_TO_UART],
+             (unsigned long)_discarded);
+}
+
+SerialBridge::Stats SerialBridge::getStats() const
+{
+    Stats stats = {
+        .forwarded = { _forwarded[UART_TO_USB], _forwarded[USB_TO_UART] },
+        .discarded = _discarded,
+    };
+    return stats;
+}
+
+size_t SerialBridge::forwardUartToUsb(bool* blocked)
+{
+    const uint8_t* data = nullptr;
+    size_t len = _uart->peek(&data);
+    if (len == 0) {
+        return 0;
+    }
+    if (len > MAX_CHUNK) {
+        len = MAX_CHUNK;
+    }
+
+    // 没有设备时丢弃，不让积压的旧数据在设备连接后才发出
+    size_t n;
+    if (_usb->isConnected()) {
+        n = _usb->write(data, len);
+        if (n < len) {
+            *blocked = true;
+        }
+    } else {
+        n = len;
+        _discarded += len;
+    }
+
+    if (_monitor_enabled && n > 0) {
+        _monitor[UART_TO_USB].write(data, n);
+    }
+    _uart->consume(n);
+    _forwarded[UART_TO_USB] += n;
+    return n;
+}
+
+size_t SerialBridge::forwardUsbToUart(bool* blocked)
+{
+    const uint8_t* data = nullptr;
+    size_t len = _usb->peek(&data);
+    if (len == 0) {
+        return 0;
+    }
+    if (len > MAX_CHUNK) {
+        len = MAX_CHUNK;
+    }
+
+    // 只写入驱动发送缓冲的剩余空间，不在UART驱动中阻塞，另一个方向不受影响
+    size_t n = _uart->txFree();
+    if (n < len) {
+        *blocked = true;
+    } else {
+        n = len;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    _uart->write(data, n);
+    if (_monitor_enabled) {
+        _monitor[USB_TO_UART].write(data, n);
+    }
+    _usb->consume(n);
+    _forwarded[USB_TO_UART] += n;
+    return n;
+}
+
+void SerialBridge::bridgeTask(void* arg)
+{
+    SerialBridge* self = static_cast<SerialBridge*>(arg);
+
+    while (!self->_stopping) {
+        bool blocked = false;
+        size_t moved = self->forwardUartToUsb(&blocked);
+        moved += self->forwardUsbToUart(&blocked);
+
+        if (moved > 0) {
+            continue;
+        }
+        if (blocked) {
+            // 对方发送缓冲满，等它发出一部分
+            vTaskDelay(1);
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_WAIT_MS));
+        }
+    }
+
+    xSemaphoreGive(self->_task_exit);
+    task_config_delete(TASK_CONFIG_SERIAL_BRIDGE, NULL);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "byte_ring/ByteRing.hpp"
+#include "uart_ttl/UartService.hpp"
+#include "uart_usb/TinyUsbCdcService.hpp"
+
+/**
+ * @class SerialBridge
+ * @brief UART与USB CDC设备之间的双向透传
+ *
+ * 桥接任务代替UI成为两个服务接收缓冲区的读取者，直接把peek得到的数据写入对方的发送缓冲，
+ * 按实际写入的字节数consume，中间不拷贝；对方缓冲满时数据留在接收缓冲区中（背压）。
+ * 服务放入接收数据后通知桥接任务，空闲时不轮询，也不经过LVGL定时器。
+ * 两个方向每轮最多转发MAX_CHUNK字节，轮流进行，一个方向繁忙时另一个方向不会饿死。
+ * USB设备未连接时UART收到的数据被丢弃。
+ * 可选的显示旁路把转发的数据另拷贝一份到每个方向的显示缓冲，UI跟不上时只丢显示的数据，不影响转发。
+ */
+class SerialBridge {
+public:
+    enum Direction {
+        UART_TO_USB = 0,
+        USB_TO_UART,
+        DIRECTION_COUNT,
+    };
+
+    static const size_t MONITOR_SIZE = 16384;      // 每个方向的显示缓冲大小，必须是2的幂
+    static const size_t MAX_CHUNK = 1024;          // 每个方向每轮最多转发的字节数
+
+    struct Stats {
+        uint32_t forwarded[DIRECTION_COUNT];        // 已转发的字节数
+        uint32_t discarded;                         // USB设备未连接时丢弃的UART数据
+    };
+
+    SerialBridge();
+    ~SerialBridge();
+
+    /**
+     * @brief 开始桥接，两个服务都必须已在接收，UART不能是抓取模式
+     * @param monitor true 同时把数据放入显示缓冲
+     * @return false 已在桥接或资源不足
+     */
+    bool start(UartService* uart, TinyUsbCdcService* usb, bool monitor);
+
+    /**
+     * @brief 停止桥接，之后接收缓冲区交还给UI读取
+     */
+    void stop();
+
+    bool isRunning() const { return _running; }
+
+    /**
+     * @brief 一个方向的显示缓冲，只能由UI读取
+     * @return 未开启显示旁路时为nullptr
+     */
+    ByteRing* getMonitor(Direction dir) { return (_running && _monitor_enabled) ? &_monitor[dir] : nullptr; }
+
+    Stats getStats() const;
+
+private:
+    static const uint32_t IDLE_WAIT_MS = 100;      // 空闲时的最长等待，用于检查停止标志
+    static const uint32_t STOP_WAIT_MS = 1000;
+
+    size_t forwardUartToUsb(bool* blocked);
+    size_t forwardUsbToUart(bool* blocked);
+    static void bridgeTask(void* arg);
+
+    UartService*       _uart;
+    TinyUsbCdcService* _usb;
+    ByteRing           _monitor[DIRECTION_COUNT];  // 桥接任务写入，UI读取
+    bool               _monitor_enabled;
+    uint32_t           _forwarded[DIRECTION_COUNT]; // 统计只由桥接任务修改
+    uint32_t           _discarded;
+    volatile bool      _running;
+    volatile bool      _stopping;
+    TaskHandle_t       _task;
+    SemaphoreHandle_t  _task_exit;
+};
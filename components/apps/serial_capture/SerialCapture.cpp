@@ -0,0 +1,278 @@
+#include "SerialCapture.hpp"
+#include "bsp/esp-bsp.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "task_config/task_config.h"
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+static const char* TAG = "SerialCapture";
+
+// 文件格式
+static_assert(sizeof(SerialCaptureChunk) == 6, "SerialCaptureChunk is part of the file format");
+static_assert(sizeof(SerialCaptureBlockHeader) == 16, "SerialCaptureBlockHeader is part of the file format");
+
+// 指定前缀的编号最大的记录文件，没有时返回false
+static bool latestFileIndex(const char* prefix, unsigned int* latest)
+{
+    bool found = false;
+    char pattern[16];
+    DIR* dir = opendir(BSP_SD_MOUNT_POINT);
+
+    if (dir == NULL) {
+        return false;
+    }
+
+    snprintf(pattern, sizeof(pattern), "%s_%%4u", prefix);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int index = 0;
+        if ((sscanf(entry->d_name, pattern, &index) == 1) && (!found || index > *latest)) {
+            *latest = index;
+            found = true;
+        }
+    }
+    closedir(dir);
+
+    return found;
+}
+
+SerialCapture::SerialCapture() :
+    _block(nullptr),
+    _fp(nullptr),
+    _flush_ms(0),
+    _sequence(0),
+    _dropped(0),
+    _bytes(0),
+    _lost(0),
+    _blocks(0),
+    _write_failed(false),
+    _capturing(false),
+    _stopping(false),
+    _writer_task(nullptr),
+    _writer_exit(nullptr)
+{
+    _path[0] = '\0';
+}
+
+SerialCapture::~SerialCapture()
+{
+    stop();
+}
+
+bool SerialCapture::start(const char* prefix, uint32_t flush_ms)
+{
+    if (_capturing) {
+        ESP_LOGW(TAG, "Already capturing to %s", _path);
+        return false;
+    }
+
+    // 暂存缓冲第一次记录时分配，之后一直保留
+    if (!_staging.isValid() && !_staging.init(STAGING_SIZE, MALLOC_CAP_SPIRAM)) {
+        ESP_LOGE(TAG, "Failed to allocate %u KB staging buffer", (unsigned int)(STAGING_SIZE / 1024));
+        return false;
+    }
+    _staging.reset();
+
+    // SD卡直接DMA读写数据块缓冲，不经过FATFS的中转
+    _block = (uint8_t*)heap_caps_aligned_alloc(64, BLOCK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (_block == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate block buffer");
+        return false;
+    }
+
+    unsigned int index = 0;
+    if (latestFileIndex(prefix, &index)) {
+        index++;
+    }
+    snprintf(_path, sizeof(_path), BSP_SD_MOUNT_POINT "/%.4s_%04u.BIN", prefix, index);
+    _fp = fopen(_path, "wb");
+    if (_fp == nullptr) {
+        ESP_LOGE(TAG, "Failed to create %s", _path);
+        goto err;
+    }
+    // 每次写入都是完整的数据块，不需要stdio缓冲
+    setvbuf(_fp, NULL, _IONBF, 0);
+
+    _writer_exit = xSemaphoreCreateBinary();
+    if (_writer_exit == nullptr) {
+        goto err;
+    }
+
+    _flush_ms = flush_ms;
+    _sequence = 0;
+    _dropped = 0;
+    _bytes = 0;
+    _lost = 0;
+    _blocks = 0;
+    _write_failed = false;
+    _stopping = false;
+    _capturing = true;
+
+    // 低于接收任务，文件系统的延迟不会影响接收
+    if (task_config_create(TASK_CONFIG_SERIAL_CAPTURE, writerTask, this, &_writer_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        _capturing = false;
+        goto err;
+    }
+
+    ESP_LOGI(TAG, "Capturing to %s", _path);
+    return true;
+
+err:
+    if (_writer_exit) {
+        vSemaphoreDelete(_writer_exit);
+        _writer_exit = nullptr;
+    }
+    if (_fp) {
+        fclose(_fp);
+        _fp = nullptr;
+    }
+    heap_caps_free(_block);
+    _block = nullptr;
+    return false;
+}
+
+void SerialCapture::stop()
+{
+    if (!_capturing) {
+        return;
+    }
+
+    // 此后的数据直接丢弃，写入任务写完暂存的数据后退出
+    _stopping = true;
+    xTaskNotifyGive(_writer_task);
+    if (xSemaphoreTake(_writer_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+        // 写入任务仍在使用缓冲，不能释放
+        ESP_LOGE(TAG, "Writer task did not exit");
+        return;
+    }
+
+    vSemaphoreDelete(_writer_exit);
+    _writer_exit = nullptr;
+    _writer_task = nullptr;
+    heap_caps_free(_block);
+    _block = nullptr;
+    _capturing = false;
+
+    Stats stats = getStats();
+    ESP_LOGI(TAG, "Capture stopped: %lu bytes in %lu blocks, %lu dropped", (unsigned long)stats.bytes,
+             (unsigned long)stats.blocks, (unsigned long)stats.dropped);
+}
+
+void SerialCapture::addData(const uint8_t* data, size_t len)
+{
+    if (!_capturing || _stopping || data == nullptr) {
+        return;
+    }
+
+    uint32_t time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    while (len > 0) {
+        size_t chunk_len = (len > MAX_CHUNK_LEN) ? MAX_CHUNK_LEN : len;
+        SerialCaptureChunk chunk = {
+            .time_ms = time_ms,
+            .len = (uint16_t)chunk_len,
+        };
+
+        // 记录整条写入或整条丢弃，文件中的记录流始终完整
+        if (_staging.capacity() - _staging.available() < sizeof(chunk) + chunk_len) {
+            _dropped = _dropped + len;
+            _staging.noteFull();
+            break;
+        }
+        _staging.write((const uint8_t*)&chunk, sizeof(chunk));
+        _staging.write(data, chunk_len);
+        data += chunk_len;
+        len -= chunk_len;
+    }
+
+    // 够一块时立即写入
+    TaskHandle_t writer_task = _writer_task;
+    if (writer_task && _staging.available() >= BLOCK_SIZE - sizeof(SerialCaptureBlockHeader)) {
+        xTaskNotifyGive(writer_task);
+    }
+}
+
+SerialCapture::Stats SerialCapture::getStats() const
+{
+    Stats stats = {
+        .bytes = _bytes,
+        .blocks = _blocks,
+        .dropped = _dropped + _lost,
+    };
+    return stats;
+}
+
+void SerialCapture::writeBlock(size_t len)
+{
+    SerialCaptureBlockHeader* header = (SerialCaptureBlockHeader*)_block;
+    uint8_t* payload = _block + sizeof(SerialCaptureBlockHeader);
+
+    _staging.read(payload, len);
+    header->magic = BLOCK_MAGIC;
+    header->sequence = _sequence;
+    header->len = len;
+    header->dropped = _dropped;
+    memset(payload + len, 0, BLOCK_SIZE - sizeof(SerialCaptureBlockHeader) - len);
+
+    bool success = !_write_failed && fwrite(_block, 1, BLOCK_SIZE, _fp) == BLOCK_SIZE;
+    if (success && (_sequence + 1) % FSYNC_BLOCKS == 0) {
+        success = fsync(fileno(_fp)) == 0;
+    }
+    if (!success && !_write_failed) {
+        ESP_LOGE(TAG, "Failed to write %s, capture stopped", _path);
+        _write_failed = true;
+    }
+
+    // 出错后继续取走暂存的数据，接收任务不会因此一直丢数据
+    if (success) {
+        _bytes += len;
+        _blocks++;
+    } else {
+        _lost += len;
+    }
+    _sequence++;
+}
+
+void SerialCapture::writerTask(void* arg)
+{
+    SerialCapture* self = static_cast<SerialCapture*>(arg);
+    const size_t payload_size = BLOCK_SIZE - sizeof(SerialCaptureBlockHeader);
+    int64_t last_write_us = esp_timer_get_time();
+
+    while (true) {
+        // 够一块时被通知，数据稀疏时等到超时把不满的块也写入
+        bool stopping = self->_stopping;
+        if (!stopping) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->_flush_ms));
+            stopping = self->_stopping;
+        }
+
+        while (self->_staging.available() >= payload_size) {
+            self->writeBlock(payload_size);
+            last_write_us = esp_timer_get_time();
+        }
+
+        size_t pending = self->_staging.available();
+        bool timeout = esp_timer_get_time() - last_write_us >= (int64_t)self->_flush_ms * 1000;
+        if (pending > 0 && (timeout || stopping)) {
+            self->writeBlock(pending);
+            if (!self->_write_failed) {
+                fsync(fileno(self->_fp));
+            }
+            last_write_us = esp_timer_get_time();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    fsync(fileno(self->_fp));
+    fclose(self->_fp);
+    self->_fp = nullptr;
+    xSemaphoreGive(self->_writer_exit);
+    task_config_delete(TASK_CONFIG_SERIAL_CAPTURE, NULL);
+}
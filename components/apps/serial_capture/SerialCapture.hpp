@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "byte_ring/ByteRing.hpp"
+
+/**
+ * @struct SerialCaptureChunk
+ * @brief 一次接收的数据前的记录头，小端
+ */
+struct __attribute__((packed)) SerialCaptureChunk {
+    uint32_t time_ms;           // 开机后的接收时间
+    uint16_t len;               // 后面的数据字节数
+};
+
+/**
+ * @struct SerialCaptureBlockHeader
+ * @brief 数据块头，每个数据块SerialCapture::BLOCK_SIZE字节
+ *
+ * 各块的有效数据按块号顺序拼接起来是连续的记录流（记录头+原始数据），记录可以跨块。
+ */
+struct __attribute__((packed)) SerialCaptureBlockHeader {
+    uint32_t magic;             // SerialCapture::BLOCK_MAGIC
+    uint32_t sequence;          // 文件内的块号，从0开始
+    uint32_t len;               // 有效数据字节数，定时刷新的块不满
+    uint32_t dropped;           // 到这一块为止丢弃的字节数
+};
+
+/**
+ * @class SerialCapture
+ * @brief 串口原始数据的SD卡记录
+ *
+ * 接收任务把每次收到的数据连同时间戳写入PSRAM中的暂存环形缓冲区，从不等待；
+ * 写入任务把暂存的数据组成对齐的32KB数据块写入BSP_SD_MOUNT_POINT下的XXX_nnnn.BIN，
+ * 与UI定时器无关，长时间无人值守的记录也能跟上线路速率。
+ */
+class SerialCapture {
+public:
+    static const size_t BLOCK_SIZE = 32 * 1024;            // 每次写入SD卡的大小
+    static const size_t STAGING_SIZE = 512 * 1024;         // 暂存缓冲区大小（PSRAM），必须是2的幂
+    static const uint32_t BLOCK_MAGIC = 0x50414353;        // "SCAP"
+    static const size_t MAX_CHUNK_LEN = 4096;              // 单条记录的最大数据长度
+
+    /**
+     * @brief 记录统计
+     */
+    struct Stats {
+        uint32_t bytes;             // 已写入文件的原始数据字节数
+        uint32_t blocks;            // 已写入的数据块
+        uint32_t dropped;           // 暂存缓冲满或写入出错时丢弃的字节数
+    };
+
+    SerialCapture();
+    ~SerialCapture();
+
+    /**
+     * @brief 创建新的记录文件并启动写入任务
+     * @param prefix 文件名前缀，不超过4个字符，如"TTL"
+     * @param flush_ms 不满的数据块最长等待多久写入
+     * @return true 已开始，false 已在记录、没有SD卡或内存不足
+     */
+    bool start(const char* prefix, uint32_t flush_ms);
+
+    /**
+     * @brief 写入剩余的数据并关闭文件
+     */
+    void stop();
+
+    bool isCapturing() const { return _capturing; }
+
+    /**
+     * @brief 记录一次接收的数据，不阻塞，只能由一个接收任务调用
+     */
+    void addData(const uint8_t* data, size_t len);
+
+    /**
+     * @brief 获取当前或上一次记录的统计
+     */
+    Stats getStats() const;
+
+    const char* getPath() const { return _path; }
+
+private:
+    static const uint32_t FSYNC_BLOCKS = 32;               // 每写入多少块同步一次文件系统（1MB）
+    static const uint32_t STOP_WAIT_MS = 3000;
+
+    void writeBlock(size_t len);
+    static void writerTask(void* arg);
+
+    ByteRing          _staging;         // 接收任务写入，写入任务读取；停止后保留，避免与迟到的写入竞争
+    uint8_t*          _block;           // 对齐的数据块缓冲
+    FILE*             _fp;
+    char              _path[48];
+    uint32_t          _flush_ms;
+    uint32_t          _sequence;
+    volatile uint32_t _dropped;         // 只由接收任务修改
+    uint32_t          _bytes;
+    uint32_t          _lost;            // 写入出错后丢弃的字节数，只由写入任务修改
+    uint32_t          _blocks;
+    bool              _write_failed;
+    volatile bool     _capturing;
+    volatile bool     _stopping;
+    TaskHandle_t      _writer_task;
+    SemaphoreHandle_t _writer_exit;
+};
@@ -0,0 +1,544 @@
+#include "SerialScript.hpp"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "task_config/task_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "SerialScript";
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static char* skipSpaces(char* p)
+{
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+// 解析十进制数，p移到数字后的第一个非空白字符
+static bool parseNumber(char** p, uint32_t* value)
+{
+    char* end = nullptr;
+    unsigned long v = strtoul(*p, &end, 10);
+    if (end == *p || (*end != '\0' && *end != ' ' && *end != '\t')) {
+        return false;
+    }
+    *value = (uint32_t)v;
+    *p = skipSpaces(end);
+    return true;
+}
+
+SerialScript::SerialScript() :
+    _step_count(0),
+    _text_len(0),
+    _loaded(false),
+    _write(nullptr),
+    _write_ctx(nullptr),
+    _matches(0),
+    _bytes_sent(0),
+    _state(STATE_IDLE),
+    _stopping(false),
+    _start_requested(false),
+    _exiting(false),
+    _task(nullptr),
+    _task_exit(nullptr)
+{
+    _message[0] = '\0';
+}
+
+SerialScript::~SerialScript()
+{
+    stop();
+
+    if (_task) {
+        _exiting = true;
+        xTaskNotifyGive(_task);
+        if (xSemaphoreTake(_task_exit, pdMS_TO_TICKS(STOP_WAIT_MS)) != pdTRUE) {
+            ESP_LOGE(TAG, "Script task did not exit");
+            return;
+        }
+        vSemaphoreDelete(_task_exit);
+    }
+}
+
+bool SerialScript::load(const char* path)
+{
+    if (isRunning()) {
+        snprintf(_message, sizeof(_message), "script is running");
+        return false;
+    }
+
+    _loaded = false;
+    _step_count = 0;
+    _text_len = 0;
+
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        snprintf(_message, sizeof(_message), "cannot open %s", path);
+        return false;
+    }
+
+    char line[MAX_LINE];
+    uint16_t line_no = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != nullptr) {
+        line_no++;
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(fp)) {
+            ok = loadError(line_no, "line too long");
+            break;
+        }
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        ok = parseLine(line, line_no);
+    }
+    fclose(fp);
+
+    if (!ok) {
+        return false;
+    }
+
+    // 配对loop和end；循环体必须有会等待的命令，否则会一直占用CPU
+    size_t loops[MAX_LOOP_DEPTH];
+    bool waits[MAX_LOOP_DEPTH];
+    size_t depth = 0;
+    for (size_t i = 0; i < _step_count; i++) {
+        Step& step = _steps[i];
+        if (step.op == OP_LOOP) {
+            if (depth == MAX_LOOP_DEPTH) {
+                return loadError(step.line, "loops nested too deep");
+            }
+            loops[depth] = i;
+            waits[depth] = false;
+            depth++;
+        } else if (step.op == OP_END) {
+            if (depth == 0) {
+                return loadError(step.line, "end without loop");
+            }
+            depth--;
+            if (!waits[depth]) {
+                return loadError(step.line, "loop has no send, expect or delay");
+            }
+            step.arg = loops[depth];
+            if (depth > 0) {
+                waits[depth - 1] = true;
+            }
+        } else if (step.op != OP_FLUSH && depth > 0) {
+            waits[depth - 1] = true;
+        }
+    }
+    if (depth > 0) {
+        return loadError(_steps[loops[depth - 1]].line, "loop without end");
+    }
+    if (_step_count == 0) {
+        return loadError(line_no, "no commands");
+    }
+
+    _loaded = true;
+    snprintf(_message, sizeof(_message), "%u commands", (unsigned int)_step_count);
+    ESP_LOGI(TAG, "Loaded %s: %u commands", path, (unsigned int)_step_count);
+    return true;
+}
+
+bool SerialScript::parseLine(char* line, uint16_t line_no)
+{
+    char* p = skipSpaces(line);
+    if (*p == '\0' || *p == '#') {
+        return true;
+    }
+
+    // 命令和参数之间用空白分隔，参数中的空白原样保留
+    char* cmd = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+        p++;
+    }
+    if (*p != '\0') {
+        *p++ = '\0';
+    }
+    char* args = skipSpaces(p);
+
+    Step step = {};
+    step.line = line_no;
+
+    if (strcmp(cmd, "send") == 0 || strcmp(cmd, "sendline") == 0) {
+        bool newline = (cmd[4] != '\0');
+        if (*args == '\0' && !newline) {
+            return loadError(line_no, "missing text");
+        }
+        step.op = OP_SEND;
+        if (!addText(args, true, newline, &step)) {
+            return loadError(line_no, "script too large");
+        }
+    } else if (strcmp(cmd, "expect") == 0 || strcmp(cmd, "expect_re") == 0) {
+        bool regex = (cmd[6] != '\0');
+        if (!parseNumber(&args, &step.arg)) {
+            return loadError(line_no, "missing timeout");
+        }
+        if (*args == '\0') {
+            return loadError(line_no, "missing pattern");
+        }
+        step.op = regex ? OP_EXPECT_RE : OP_EXPECT;
+        if (!addText(args, !regex, false, &step)) {
+            return loadError(line_no, "script too large");
+        }
+        // 加载时检查模式，运行时不会编译失败
+        bool valid = regex ? _matcher.setRegex(_text + step.text) : _matcher.setLiteral(_text + step.text, step.len);
+        if (!valid) {
+            return loadError(line_no, _matcher.getError());
+        }
+    } else if (strcmp(cmd, "delay") == 0) {
+        step.op = OP_DELAY;
+        if (!parseNumber(&args, &step.arg)) {
+            return loadError(line_no, "missing time");
+        }
+    } else if (strcmp(cmd, "loop") == 0) {
+        step.op = OP_LOOP;
+        if (!parseNumber(&args, &step.arg)) {
+            return loadError(line_no, "missing count");
+        }
+    } else if (strcmp(cmd, "end") == 0) {
+        step.op = OP_END;
+    } else if (strcmp(cmd, "flush") == 0) {
+        step.op = OP_FLUSH;
+    } else {
+        return loadError(line_no, "unknown command");
+    }
+
+    if (step.op == OP_END || step.op == OP_FLUSH || step.op == OP_DELAY || step.op == OP_LOOP) {
+        if (*args != '\0') {
+            return loadError(line_no, "unexpected argument");
+        }
+    }
+
+    return addStep(step);
+}
+
+bool SerialScript::addText(const char* src, bool escapes, bool newline, Step* step)
+{
+    // 文本以'\0'结尾，正则表达式直接从池中编译
+    size_t start = _text_len;
+    size_t end = _text_len;
+
+    while (*src != '\0') {
+        char c = *src++;
+        if (escapes && c == '\\' && *src != '\0') {
+            char e = *src++;
+            switch (e) {
+            case 'r': c = '\r'; break;
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case '0': c = '\0'; break;
+            case 'x': {
+                int h = hexValue(src[0]);
+                int l = (h >= 0) ? hexValue(src[1]) : -1;
+                if (l >= 0) {
+                    c = (char)(h << 4 | l);
+                    src += 2;
+                } else {
+                    c = 'x';
+                }
+                break;
+            }
+            default: c = e; break;
+            }
+        }
+        if (end + 1 >= TEXT_POOL_SIZE) {
+            return false;
+        }
+        _text[end++] = c;
+    }
+
+    if (newline) {
+        if (end + 3 >= TEXT_POOL_SIZE) {
+            return false;
+        }
+        _text[end++] = '\r';
+        _text[end++] = '\n';
+    }
+    _text[end] = '\0';
+
+    step->text = (uint16_t)start;
+    step->len = (uint16_t)(end - start);
+    _text_len = end + 1;
+    return true;
+}
+
+bool SerialScript::addStep(const Step& step)
+{
+    if (_step_count >= MAX_STEPS) {
+        return loadError(step.line, "too many commands");
+    }
+    _steps[_step_count++] = step;
+    return true;
+}
+
+bool SerialScript::loadError(uint16_t line_no, const char* error)
+{
+    snprintf(_message, sizeof(_message), "line %u: %s", line_no, error);
+    ESP_LOGW(TAG, "Script error: %s", _message);
+    _step_count = 0;
+    _text_len = 0;
+    return false;
+}
+
+bool SerialScript::start(SerialScriptWriteFn write, void* ctx)
+{
+    if (!_loaded || write == nullptr) {
+        snprintf(_message, sizeof(_message), "no script loaded");
+        return false;
+    }
+    if (isRunning()) {
+        return false;
+    }
+
+    if (!_rx.isValid() && !_rx.init(RX_BUFFER_SIZE, MALLOC_CAP_INTERNAL)) {
+        snprintf(_message, sizeof(_message), "out of memory");
+        return false;
+    }
+
+    // 任务第一次运行时创建，之后一直保留，接收旁路和stop不会通知到已删除的任务
+    if (_task == nullptr) {
+        _task_exit = xSemaphoreCreateBinary();
+        if (_task_exit == nullptr) {
+            snprintf(_message, sizeof(_message), "out of memory");
+            return false;
+        }
+        // 低于接收任务，高于UI和USB发送任务，响应不受界面刷新影响
+        if (task_config_create(TASK_CONFIG_SERIAL_SCRIPT, scriptTask, this, &_task) != pdPASS) {
+            vSemaphoreDelete(_task_exit);
+            _task_exit = nullptr;
+            _task = nullptr;
+            snprintf(_message, sizeof(_message), "cannot create task");
+            return false;
+        }
+    }
+
+    // 旁路只在运行状态写入，这里仍是空闲端
+    _rx.reset();
+    _write = write;
+    _write_ctx = ctx;
+    _matches = 0;
+    _bytes_sent = 0;
+    _message[0] = '\0';
+    _stopping = false;
+    _start_requested = true;
+    _state.store(STATE_RUNNING, std::memory_order_release);
+    xTaskNotifyGive(_task);
+
+    ESP_LOGI(TAG, "Script started");
+    return true;
+}
+
+void SerialScript::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    _stopping = true;
+    xTaskNotifyGive(_task);
+
+    uint32_t waited_ms = 0;
+    while (isRunning() && waited_ms < STOP_WAIT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        waited_ms += 10;
+    }
+    if (isRunning()) {
+        ESP_LOGE(TAG, "Script did not stop");
+    }
+}
+
+void SerialScript::onRxData(const uint8_t* data, size_t len)
+{
+    if (!isRunning()) {
+        return;
+    }
+    _rx.write(data, len);
+    xTaskNotifyGive(_task);
+}
+
+void SerialScript::run()
+{
+    struct {
+        size_t   step;
+        uint32_t remaining;             // 0为一直重复
+    } loops[MAX_LOOP_DEPTH];
+    size_t depth = 0;
+    size_t pc = 0;
+
+    while (pc < _step_count) {
+        const Step& step = _steps[pc];
+        const char* error = nullptr;
+
+        switch (step.op) {
+        case OP_SEND:
+            error = send(step);
+            break;
+        case OP_EXPECT:
+        case OP_EXPECT_RE:
+            error = expect(step);
+            break;
+        case OP_DELAY:
+            error = sleep(step.arg);
+            break;
+        case OP_FLUSH: {
+            const uint8_t* data = nullptr;
+            size_t len;
+            while ((len = _rx.readSpan(&data)) > 0) {
+                _rx.releaseRead(len);
+            }
+            break;
+        }
+        case OP_LOOP:
+            loops[depth].step = pc;
+            loops[depth].remaining = step.arg;
+            depth++;
+            break;
+        case OP_END:
+            if (loops[depth - 1].remaining == 0 || --loops[depth - 1].remaining > 0) {
+                pc = loops[depth - 1].step + 1;
+                continue;
+            }
+            depth--;
+            break;
+        }
+
+        if (error == nullptr && _stopping) {
+            error = "stopped";
+        }
+        if (error) {
+            finish(STATE_FAILED, &step, error);
+            return;
+        }
+        pc++;
+    }
+
+    finish(STATE_PASSED, nullptr, nullptr);
+}
+
+const char* SerialScript::send(const Step& step)
+{
+    const uint8_t* data = (const uint8_t*)_text + step.text;
+    size_t len = step.len;
+    TickType_t start = xTaskGetTickCount();
+
+    while (len > 0) {
+        if (_stopping) {
+            return "stopped";
+        }
+        size_t n = _write(_write_ctx, data, len);
+        data += n;
+        len -= n;
+        _bytes_sent += n;
+        if (n == 0) {
+            if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(SEND_TIMEOUT_MS)) {
+                return "send timeout";
+            }
+            vTaskDelay(1);
+        }
+    }
+    return nullptr;
+}
+
+const char* SerialScript::expect(const Step& step)
+{
+    if (step.op == OP_EXPECT_RE) {
+        _matcher.setRegex(_text + step.text);
+    } else {
+        _matcher.setLiteral(_text + step.text, step.len);
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(step.arg);
+
+    while (true) {
+        // 匹配到的位置之后的数据留在缓冲区中给下一条expect
+        const uint8_t* data = nullptr;
+        size_t len = _rx.readSpan(&data);
+        for (size_t i = 0; i < len; i++) {
+            if (_matcher.feed(data[i])) {
+                _rx.releaseRead(i + 1);
+                _matches++;
+                return nullptr;
+            }
+        }
+        _rx.releaseRead(len);
+
+        if (_stopping) {
+            return "stopped";
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return "expect timeout";
+        }
+        if (len == 0) {
+            ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+        }
+    }
+}
+
+const char* SerialScript::sleep(uint32_t ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+
+    // 接收通知也会唤醒，数据留给之后的expect
+    while (!_stopping) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= ticks) {
+            return nullptr;
+        }
+        ulTaskNotifyTake(pdTRUE, ticks - elapsed);
+    }
+    return "stopped";
+}
+
+void SerialScript::finish(State state, const Step* step, const char* error)
+{
+    if (state == STATE_PASSED) {
+        snprintf(_message, sizeof(_message), "%lu matches, %lu bytes sent",
+                 (unsigned long)_matches, (unsigned long)_bytes_sent);
+    } else if (step->op == OP_EXPECT || step->op == OP_EXPECT_RE) {
+        // 模式中的控制字符显示为'.'
+        char pattern[41];
+        size_t n = (step->len < sizeof(pattern) - 1) ? step->len : sizeof(pattern) - 1;
+        for (size_t i = 0; i < n; i++) {
+            char c = _text[step->text + i];
+            pattern[i] = (c >= 32 && c <= 126) ? c : '.';
+        }
+        pattern[n] = '\0';
+        snprintf(_message, sizeof(_message), "line %u: %s (%lu ms): %s", step->line, error,
+                 (unsigned long)step->arg, pattern);
+    } else {
+        snprintf(_message, sizeof(_message), "line %u: %s", step->line, error);
+    }
+
+    ESP_LOGI(TAG, "Script %s: %s", (state == STATE_PASSED) ? "passed" : "failed", _message);
+    _state.store(state, std::memory_order_release);
+}
+
+void SerialScript::scriptTask(void* arg)
+{
+    SerialScript* self = static_cast<SerialScript*>(arg);
+
+    while (!self->_exiting) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (self->_start_requested) {
+            self->_start_requested = false;
+            self->run();
+        }
+    }
+
+    xSemaphoreGive(self->_task_exit);
+    task_config_delete(TASK_CONFIG_SERIAL_SCRIPT, NULL);
+}
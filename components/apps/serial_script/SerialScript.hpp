@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "byte_ring/ByteRing.hpp"
+#include "serial_tap/SerialRxTap.hpp"
+#include "StreamMatcher.hpp"
+
+/**
+ * @brief 脚本的发送函数，返回实际接受的字节数，可以少于len（如发送队列满）
+ */
+typedef size_t (*SerialScriptWriteFn)(void* ctx, const uint8_t* data, size_t len);
+
+/**
+ * @class SerialScript
+ * @brief 串口收发脚本
+ *
+ * 脚本文件每行一条命令，#开头为注释：
+ *   send TEXT            发送TEXT，支持\r \n \t \\ \xHH转义
+ *   sendline TEXT        发送TEXT和\r\n
+ *   expect MS TEXT       在MS毫秒内等待收到TEXT（转义同send）
+ *   expect_re MS REGEX   在MS毫秒内等待匹配REGEX，语法见StreamMatcher
+ *   delay MS             等待MS毫秒
+ *   flush                丢弃已收到未匹配的数据
+ *   loop N ... end       重复N次，N为0时一直重复，最多嵌套MAX_LOOP_DEPTH层
+ *
+ * 接收数据经SerialRxTap从服务的接收路径拷贝到脚本自己的环形缓冲区，与UI读取无关；
+ * 脚本任务逐字节交给流式匹配器，匹配结束后剩余的数据留给下一条expect，已处理的数据不再扫描。
+ * 所有命令加载时解析到固定大小的成员数组中，运行时不分配内存。
+ */
+class SerialScript : public SerialRxTap {
+public:
+    static const size_t MAX_STEPS = 128;            // 最多命令数
+    static const size_t TEXT_POOL_SIZE = 4096;      // 所有命令的文本总长
+    static const size_t MAX_LINE = 256;             // 脚本文件单行最大长度
+    static const size_t MAX_LOOP_DEPTH = 4;
+    static const size_t RX_BUFFER_SIZE = 8192;      // 接收缓冲区大小，必须是2的幂
+    static const uint32_t SEND_TIMEOUT_MS = 2000;   // 发送队列一直满时的超时
+
+    enum State {
+        STATE_IDLE = 0,                 // 未运行过
+        STATE_RUNNING,
+        STATE_PASSED,                   // 所有命令都已完成
+        STATE_FAILED,                   // 超时、发送失败或被停止，getMessage()给出原因
+    };
+
+    SerialScript();
+    ~SerialScript();
+
+    /**
+     * @brief 加载并解析脚本文件
+     * @return false 无法打开或有语法错误，getMessage()给出行号和原因
+     */
+    bool load(const char* path);
+
+    /**
+     * @brief 启动脚本任务，之后把脚本设置为服务的接收旁路
+     * @param write 发送函数，在脚本任务中调用
+     * @param ctx 发送函数的参数，如服务对象
+     * @return false 未加载、正在运行或资源不足
+     */
+    bool start(SerialScriptWriteFn write, void* ctx);
+
+    /**
+     * @brief 停止正在运行的脚本并等待它结束，脚本状态为失败
+     */
+    void stop();
+
+    State getState() const { return _state.load(std::memory_order_acquire); }
+    bool isRunning() const { return getState() == STATE_RUNNING; }
+
+    /**
+     * @brief 结果说明，如"line 12: expect timeout (1000 ms): OK"，结束或加载失败后有效
+     */
+    const char* getMessage() const { return _message; }
+
+    uint32_t getMatches() const { return _matches; }
+    uint32_t getBytesSent() const { return _bytes_sent; }
+
+    /**
+     * @brief 接收旁路，在服务的接收任务中调用，缓冲满时丢弃
+     */
+    void onRxData(const uint8_t* data, size_t len) override;
+
+private:
+    static const uint32_t STOP_WAIT_MS = 1000;
+
+    enum Op : uint8_t {
+        OP_SEND,
+        OP_EXPECT,
+        OP_EXPECT_RE,
+        OP_DELAY,
+        OP_FLUSH,
+        OP_LOOP,
+        OP_END,
+    };
+
+    struct Step {
+        Op       op;
+        uint16_t line;          // 脚本文件中的行号
+        uint16_t text;          // 文本在_text中的偏移
+        uint16_t len;
+        uint32_t arg;           // 超时、延时、循环次数，OP_END为对应OP_LOOP的下标
+    };
+
+    bool parseLine(char* line, uint16_t line_no);
+    bool addText(const char* src, bool escapes, bool newline, Step* step);
+    bool addStep(const Step& step);
+    bool loadError(uint16_t line_no, const char* error);
+
+    // 以下在脚本任务中执行，返回nullptr为成功，否则为失败原因
+    void run();
+    const char* send(const Step& step);
+    const char* expect(const Step& step);
+    const char* sleep(uint32_t ms);
+    void finish(State state, const Step* step, const char* error);
+    static void scriptTask(void* arg);
+
+    Step              _steps[MAX_STEPS];
+    size_t            _step_count;
+    char              _text[TEXT_POOL_SIZE];
+    size_t            _text_len;
+    bool              _loaded;
+
+    StreamMatcher     _matcher;
+    ByteRing          _rx;              // 接收旁路写入，脚本任务读取
+    SerialScriptWriteFn _write;
+    void*             _write_ctx;
+    uint32_t          _matches;
+    uint32_t          _bytes_sent;
+    char              _message[128];
+
+    std::atomic<State> _state;
+    volatile bool     _stopping;
+    volatile bool     _start_requested;
+    volatile bool     _exiting;
+    TaskHandle_t      _task;            // 第一次start时创建，析构时退出
+    SemaphoreHandle_t _task_exit;
+};
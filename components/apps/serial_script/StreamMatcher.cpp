@@ -0,0 +1,518 @@
+#include "StreamMatcher.hpp"
+#include <string.h>
+#include <ctype.h>
+
+// \d \w \s及大写的取反形式
+static bool isClassEscape(char e)
+{
+    return e != '\0' && strchr("dwsDWS", e) != nullptr;
+}
+
+static bool inClass(char e, uint8_t c)
+{
+    switch (e) {
+    case 'd': return isdigit(c);
+    case 'w': return isalnum(c) || c == '_';
+    case 's': return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+    default:  return !inClass((char)tolower(e), c);
+    }
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+StreamMatcher::StreamMatcher() :
+    _is_regex(false),
+    _error(nullptr),
+    _literal_len(0),
+    _matched(0),
+    _insn_count(0),
+    _set_count(0),
+    _pattern(nullptr),
+    _current(0),
+    _generation(1),
+    _bol(true)
+{
+    _thread_count[0] = 0;
+    _thread_count[1] = 0;
+    memset(_marks, 0, sizeof(_marks));
+}
+
+bool StreamMatcher::setLiteral(const char* text, size_t len)
+{
+    _is_regex = false;
+    _error = nullptr;
+    _literal_len = 0;
+
+    if (len == 0) {
+        return fail("empty pattern");
+    }
+    if (len > MAX_LITERAL) {
+        return fail("pattern too long");
+    }
+
+    memcpy(_literal, text, len);
+    _literal_len = len;
+
+    _failure[0] = 0;
+    size_t k = 0;
+    for (size_t i = 1; i < len; i++) {
+        while (k > 0 && _literal[i] != _literal[k]) {
+            k = _failure[k - 1];
+        }
+        if (_literal[i] == _literal[k]) {
+            k++;
+        }
+        _failure[i] = (uint8_t)k;
+    }
+
+    reset();
+    return true;
+}
+
+bool StreamMatcher::setRegex(const char* pattern)
+{
+    _is_regex = true;
+    _error = nullptr;
+    _insn_count = 0;
+    _set_count = 0;
+    _pattern = pattern;
+
+    bool ok = parseAlt();
+    if (ok && *_pattern != '\0') {
+        ok = fail("unmatched )");
+    }
+    if (ok) {
+        ok = emit(OP_MATCH);
+    }
+    _pattern = nullptr;
+
+    if (!ok) {
+        _insn_count = 0;
+        return false;
+    }
+
+    reset();
+    return true;
+}
+
+void StreamMatcher::reset(void)
+{
+    _matched = 0;
+    _thread_count[0] = 0;
+    _thread_count[1] = 0;
+    _current = 0;
+    _bol = true;
+}
+
+bool StreamMatcher::feed(uint8_t c)
+{
+    if (!_is_regex) {
+        if (_literal_len == 0) {
+            return false;
+        }
+        while (_matched > 0 && c != _literal[_matched]) {
+            _matched = _failure[_matched - 1];
+        }
+        if (c == _literal[_matched]) {
+            _matched++;
+        }
+        if (_matched == _literal_len) {
+            _matched = _failure[_matched - 1];
+            return true;
+        }
+        return false;
+    }
+
+    if (_insn_count == 0) {
+        return false;
+    }
+
+    uint8_t* clist = _threads[_current];
+    uint8_t* nlist = _threads[_current ^ 1];
+    size_t* ccount = &_thread_count[_current];
+    size_t* ncount = &_thread_count[_current ^ 1];
+
+    // 不锚定：每个位置都可能开始一次匹配
+    addThread(clist, ccount, 0, _bol);
+
+    // 新一轮去重标记，回绕时清零
+    if (++_generation == 0) {
+        memset(_marks, 0, sizeof(_marks));
+        _generation = 1;
+    }
+
+    bool next_bol = (c == '\n');
+    bool matched = false;
+    *ncount = 0;
+
+    for (size_t i = 0; i < *ccount; i++) {
+        const Insn& insn = _insns[clist[i]];
+        bool ok = false;
+
+        switch (insn.op) {
+        case OP_CHAR:  ok = (c == insn.c); break;
+        case OP_ANY:   ok = (c != '\n'); break;
+        case OP_SET:   ok = setHas(insn.c, c); break;
+        case OP_MATCH: matched = true; break;
+        default:       break;
+        }
+
+        if (ok) {
+            addThread(nlist, ncount, clist[i] + 1, next_bol);
+        }
+    }
+
+    for (size_t i = 0; i < *ncount && !matched; i++) {
+        if (_insns[nlist[i]].op == OP_MATCH) {
+            matched = true;
+        }
+    }
+
+    _current ^= 1;
+    _bol = next_bol;
+    return matched;
+}
+
+void StreamMatcher::addThread(uint8_t* list, size_t* count, uint8_t pc, bool bol)
+{
+    // 每条指令最多入栈两个后继，且只展开一次
+    uint8_t stack[MAX_INSNS * 2 + 1];
+    size_t top = 0;
+
+    stack[top++] = pc;
+    while (top > 0) {
+        pc = stack[--top];
+        if (pc >= _insn_count || _marks[pc] == _generation) {
+            continue;
+        }
+        _marks[pc] = _generation;
+
+        const Insn& insn = _insns[pc];
+        switch (insn.op) {
+        case OP_JMP:
+            stack[top++] = insn.x;
+            break;
+        case OP_SPLIT:
+            stack[top++] = insn.y;
+            stack[top++] = insn.x;
+            break;
+        case OP_BOL:
+            if (bol) {
+                stack[top++] = pc + 1;
+            }
+            break;
+        default:
+            list[(*count)++] = pc;
+            break;
+        }
+    }
+}
+
+bool StreamMatcher::parseAlt(void)
+{
+    size_t start = _insn_count;
+
+    if (!parseConcat()) {
+        return false;
+    }
+
+    while (*_pattern == '|') {
+        _pattern++;
+
+        // start: SPLIT start+1, L2; e1; JMP L3; L2: e2; L3:
+        if (!insert(start, OP_SPLIT, start + 1, 0)) {
+            return false;
+        }
+        size_t jmp = _insn_count;
+        if (!emit(OP_JMP)) {
+            return false;
+        }
+        _insns[start].y = (uint8_t)_insn_count;
+        if (!parseConcat()) {
+            return false;
+        }
+        _insns[jmp].x = (uint8_t)_insn_count;
+    }
+
+    return true;
+}
+
+bool StreamMatcher::parseConcat(void)
+{
+    while (*_pattern != '\0' && *_pattern != '|' && *_pattern != ')') {
+        if (!parseRepeat()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamMatcher::parseRepeat(void)
+{
+    size_t start = _insn_count;
+
+    if (!parseAtom()) {
+        return false;
+    }
+
+    while (*_pattern == '*' || *_pattern == '+' || *_pattern == '?') {
+        char op = *_pattern++;
+
+        if (op == '+') {
+            // e; SPLIT start, next
+            if (!emit(OP_SPLIT, 0, start, _insn_count + 1)) {
+                return false;
+            }
+            continue;
+        }
+
+        // start: SPLIT start+1, L; e; [JMP start;] L:
+        if (!insert(start, OP_SPLIT, start + 1, 0)) {
+            return false;
+        }
+        if (op == '*' && !emit(OP_JMP, 0, start)) {
+            return false;
+        }
+        _insns[start].y = (uint8_t)_insn_count;
+    }
+
+    return true;
+}
+
+bool StreamMatcher::parseAtom(void)
+{
+    char c = *_pattern++;
+
+    switch (c) {
+    case '(':
+        if (!parseAlt()) {
+            return false;
+        }
+        if (*_pattern != ')') {
+            return fail("missing )");
+        }
+        _pattern++;
+        return true;
+
+    case '*':
+    case '+':
+    case '?':
+        return fail("nothing to repeat");
+
+    case '.':
+        return emit(OP_ANY);
+
+    case '[':
+        return parseSet();
+
+    case '^':
+        return emit(OP_BOL);
+
+    case '$': {
+        int set = newSet();
+        if (set < 0) {
+            return false;
+        }
+        setAdd(set, '\r');
+        setAdd(set, '\n');
+        return emit(OP_SET, set);
+    }
+
+    case '\\': {
+        uint8_t set_index;
+        uint8_t ch;
+        if (!parseEscape(&set_index, &ch)) {
+            return false;
+        }
+        return (set_index != 0xFF) ? emit(OP_SET, set_index) : emit(OP_CHAR, ch);
+    }
+
+    default:
+        return emit(OP_CHAR, (uint8_t)c);
+    }
+}
+
+bool StreamMatcher::parseSet(void)
+{
+    bool negate = false;
+    if (*_pattern == '^') {
+        negate = true;
+        _pattern++;
+    }
+
+    int set = newSet();
+    if (set < 0) {
+        return false;
+    }
+
+    bool first = true;
+    while (true) {
+        char c = *_pattern;
+        if (c == '\0') {
+            return fail("missing ]");
+        }
+        if (c == ']' && !first) {
+            _pattern++;
+            break;
+        }
+        first = false;
+
+        uint8_t lo;
+        if (c == '\\') {
+            _pattern++;
+            if (isClassEscape(*_pattern)) {
+                char e = *_pattern++;
+                for (int i = 0; i < 256; i++) {
+                    if (inClass(e, (uint8_t)i)) {
+                        setAdd(set, (uint8_t)i);
+                    }
+                }
+                continue;
+            }
+            uint8_t unused;
+            if (!parseEscape(&unused, &lo)) {
+                return false;
+            }
+        } else {
+            lo = (uint8_t)c;
+            _pattern++;
+        }
+
+        uint8_t hi = lo;
+        if (_pattern[0] == '-' && _pattern[1] != '\0' && _pattern[1] != ']') {
+            _pattern++;
+            if (*_pattern == '\\') {
+                uint8_t unused;
+                _pattern++;
+                if (!parseEscape(&unused, &hi) || unused != 0xFF) {
+                    return fail("bad range");
+                }
+            } else {
+                hi = (uint8_t)*_pattern++;
+            }
+            if (hi < lo) {
+                return fail("bad range");
+            }
+        }
+
+        for (int i = lo; i <= hi; i++) {
+            setAdd(set, (uint8_t)i);
+        }
+    }
+
+    if (negate) {
+        for (size_t i = 0; i < sizeof(_sets[set]); i++) {
+            _sets[set][i] = ~_sets[set][i];
+        }
+    }
+
+    return emit(OP_SET, set);
+}
+
+bool StreamMatcher::parseEscape(uint8_t* set_index, uint8_t* c)
+{
+    // _pattern指向'\'之后的字符
+    *set_index = 0xFF;
+    char e = *_pattern;
+
+    if (e == '\0') {
+        return fail("trailing \\");
+    }
+    _pattern++;
+
+    if (isClassEscape(e)) {
+        int set = newSet();
+        if (set < 0) {
+            return false;
+        }
+        for (int i = 0; i < 256; i++) {
+            if (inClass(e, (uint8_t)i)) {
+                setAdd(set, (uint8_t)i);
+            }
+        }
+        *set_index = (uint8_t)set;
+        return true;
+    }
+
+    switch (e) {
+    case 'r': *c = '\r'; break;
+    case 'n': *c = '\n'; break;
+    case 't': *c = '\t'; break;
+    case '0': *c = '\0'; break;
+    case 'x': {
+        int h = hexValue(_pattern[0]);
+        int l = (h >= 0) ? hexValue(_pattern[1]) : -1;
+        if (l < 0) {
+            return fail("bad \\x escape");
+        }
+        *c = (uint8_t)(h << 4 | l);
+        _pattern += 2;
+        break;
+    }
+    default:
+        *c = (uint8_t)e;
+        break;
+    }
+    return true;
+}
+
+bool StreamMatcher::emit(Op op, uint8_t c, uint8_t x, uint8_t y)
+{
+    if (_insn_count >= MAX_INSNS) {
+        return fail("pattern too complex");
+    }
+    _insns[_insn_count++] = { op, c, x, y };
+    return true;
+}
+
+bool StreamMatcher::insert(size_t pos, Op op, uint8_t x, uint8_t y)
+{
+    if (_insn_count >= MAX_INSNS) {
+        return fail("pattern too complex");
+    }
+
+    memmove(&_insns[pos + 1], &_insns[pos], (_insn_count - pos) * sizeof(Insn));
+    _insn_count++;
+
+    // 后移的指令内部的跳转都要加一；之前的指令跳到pos的表示跳到新插入的指令，保持不变
+    for (size_t i = 0; i < _insn_count; i++) {
+        Insn& insn = _insns[i];
+        if (insn.op != OP_SPLIT && insn.op != OP_JMP) {
+            continue;
+        }
+        size_t limit = (i > pos) ? pos : pos + 1;
+        if (insn.x >= limit) {
+            insn.x++;
+        }
+        if (insn.op == OP_SPLIT && insn.y >= limit) {
+            insn.y++;
+        }
+    }
+
+    _insns[pos] = { op, 0, x, y };
+    return true;
+}
+
+int StreamMatcher::newSet(void)
+{
+    if (_set_count >= MAX_SETS) {
+        fail("too many character sets");
+        return -1;
+    }
+    memset(_sets[_set_count], 0, sizeof(_sets[_set_count]));
+    return (int)_set_count++;
+}
+
+bool StreamMatcher::fail(const char* error)
+{
+    if (_error == nullptr) {
+        _error = error;
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class StreamMatcher
+ * @brief 逐字节输入的流式匹配器，每个字节只处理一次，不回看已接收的数据
+ *
+ * 字面量用KMP匹配；正则表达式编译成NFA指令后并行模拟所有状态（Pike VM），
+ * 支持 . [] [^] * + ? | () ^ $ 和 \d \w \s \D \W \S \r \n \t \xHH 转义。
+ * ^匹配行首，$匹配行尾的\r或\n。feed在第一个匹配结束的字节返回true。
+ * 所有缓冲都是固定大小的成员数组。
+ */
+class StreamMatcher {
+public:
+    static const size_t MAX_LITERAL = 128;      // 字面量最大长度
+    static const size_t MAX_INSNS = 96;         // 正则表达式编译后的最大指令数
+    static const size_t MAX_SETS = 24;          // 正则表达式中字符集（[]和\d等）的最大个数
+
+    StreamMatcher();
+
+    /**
+     * @brief 设置字面量
+     * @return false 为空或太长
+     */
+    bool setLiteral(const char* text, size_t len);
+
+    /**
+     * @brief 编译正则表达式
+     * @return false 语法错误或太复杂，getError()给出原因
+     */
+    bool setRegex(const char* pattern);
+
+    const char* getError(void) const { return _error; }
+
+    /**
+     * @brief 回到未匹配的状态，下一个字节视为行首
+     */
+    void reset(void);
+
+    /**
+     * @brief 输入一个字节
+     * @return true 匹配在这个字节结束
+     */
+    bool feed(uint8_t c);
+
+private:
+    enum Op : uint8_t {
+        OP_CHAR,        // 匹配一个字符
+        OP_ANY,         // 匹配除\n外的任意字符
+        OP_SET,         // 匹配字符集
+        OP_SPLIT,       // 分支到x和y
+        OP_JMP,         // 跳转到x
+        OP_BOL,         // 行首断言
+        OP_MATCH,
+    };
+
+    struct Insn {
+        Op       op;
+        uint8_t  c;     // OP_CHAR的字符，OP_SET的字符集下标
+        uint8_t  x;
+        uint8_t  y;
+    };
+
+    // 编译
+    bool parseAlt(void);
+    bool parseConcat(void);
+    bool parseRepeat(void);
+    bool parseAtom(void);
+    bool parseSet(void);
+    bool parseEscape(uint8_t* set_index, uint8_t* c);
+    bool emit(Op op, uint8_t c = 0, uint8_t x = 0, uint8_t y = 0);
+    bool insert(size_t pos, Op op, uint8_t x, uint8_t y);
+    int newSet(void);
+    bool fail(const char* error);
+
+    // 模拟
+    void addThread(uint8_t* list, size_t* count, uint8_t pc, bool bol);
+    bool setHas(uint8_t index, uint8_t c) const { return (_sets[index][c >> 3] >> (c & 7)) & 1; }
+    void setAdd(uint8_t index, uint8_t c) { _sets[index][c >> 3] |= (uint8_t)(1 << (c & 7)); }
+
+    bool        _is_regex;
+    const char* _error;
+
+    // 字面量
+    uint8_t     _literal[MAX_LITERAL];
+    uint8_t     _failure[MAX_LITERAL];  // KMP失配表
+    size_t      _literal_len;
+    size_t      _matched;               // 已匹配的前缀长度
+
+    // 正则表达式
+    Insn        _insns[MAX_INSNS];
+    size_t      _insn_count;
+    uint8_t     _sets[MAX_SETS][32];    // 256位字符集
+    size_t      _set_count;
+    const char* _pattern;               // 只在编译期间有效
+    uint8_t     _threads[2][MAX_INSNS]; // 当前和下一个字节的活动指令
+    size_t      _thread_count[2];
+    uint8_t     _current;
+    uint8_t     _marks[MAX_INSNS];      // 本轮已加入的指令，避免重复
+    uint8_t     _generation;
+    bool        _bol;                   // 下一个字节位于行首
+};
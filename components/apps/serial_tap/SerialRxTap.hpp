@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class SerialRxTap
+ * @brief 串口接收数据的旁路接口
+ *
+ * UartService和TinyUsbCdcService在接收任务（USB驱动回调）中把收到的每块数据交给它，
+ * 与UI读取接收缓冲区无关。onRxData在接收路径上执行，不能阻塞，只应拷贝数据并通知自己的任务。
+ */
+class SerialRxTap {
+public:
+    virtual ~SerialRxTap() {}
+
+    virtual void onRxData(const uint8_t* data, size_t len) = 0;
+};
@@ -5,8 +5,10 @@
  */
 
 #include <cmath>
+#include <algorithm>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_wifi.h"
@@ -16,34 +18,36 @@
 #include "esp_timer.h"
 #include "bsp/esp-bsp.h"
 #include "bsp_board_extra.h"
-#include "nvs.h"
+#include "settings_store/settings_store.h"
+#include "backlight/backlight.h"
+#include "task_config/task_config.h"
+#include "heap_stats/heap_stats.h"
+#include "ota_update/ota_update.h"
+#include "screen_mirror/screen_mirror.h"
 
 #include "ui/ui.h"
 #include "Setting.hpp"
 #include "app_sntp.h"
-#include "../../../main/global_screen_saver.hpp"
+#include "app_wifi_cache.h"
 
 #include "esp_brookesia_versions.h"
+#include "core/esp_brookesia_core_mem.h"
 
 #define ENABLE_DEBUG_LOG                (0)
 
-#define HOME_REFRESH_TASK_STACK_SIZE    (1024 * 4)
-#define HOME_REFRESH_TASK_PRIORITY      (1)
-#define HOME_REFRESH_TASK_PERIOD_MS     (2000)
+#define HOME_REFRESH_TIMER_PERIOD_MS    (2000)
 
-#define WIFI_SCAN_TASK_STACK_SIZE       (1024 * 6)
-#define WIFI_SCAN_TASK_PRIORITY         (1)
 #define WIFI_SCAN_TASK_PERIOD_MS        (5 * 1000)
+#define WIFI_SCAN_RESULT_AGE_MS         (3 * WIFI_SCAN_TASK_PERIOD_MS)  // An AP not seen for this long leaves the list
 
-#define WIFI_CONNECT_TASK_STACK_SIZE    (1024 * 4)
-#define WIFI_CONNECT_TASK_PRIORITY      (4)
-#define WIFI_CONNECT_TASK_STACK_CORE    (0)
 #define WIFI_CONNECT_UI_WAIT_TIME_MS    (1 * 1000)
 #define WIFI_CONNECT_UI_PANEL_SIZE      (1 * 1000)
 #define WIFI_CONNECT_RET_WAIT_TIME_MS   (10 * 1000)
+#define WIFI_FAST_CONNECT_WAIT_TIME_MS  (3 * 1000)      // Directed connect to the saved BSSID, before scanning for it
 
 #define SCREEN_BRIGHTNESS_MIN           (20)
 #define SCREEN_BRIGHTNESS_MAX           (BSP_LCD_BACKLIGHT_BRIGHTNESS_MAX)
+#define SCREEN_BRIGHTNESS_FADE_MS       (100)   // The slider events are coalesced into a few hardware fades
 
 #define SPEAKER_VOLUME_MIN              (0)
 #define SPEAKER_VOLUME_MAX              (100)
@@ -58,13 +62,6 @@
 // Static instance for global screen saver access
 AppSettings* AppSettings::_screen_saver_instance = nullptr;
 
-#define NVS_STORAGE_NAMESPACE           "storage"
-#define NVS_KEY_WIFI_ENABLE             "wifi_en"
-#define NVS_KEY_BLE_ENABLE              "ble_en"
-#define NVS_KEY_AUDIO_VOLUME            "volume"
-#define NVS_KEY_DISPLAY_BRIGHTNESS      "brightness"
-#define NVS_KEY_SCREEN_TIMEOUT          "scr_timeout"
-
 #define UI_MAIN_ITEM_LEFT_OFFSET        (20)
 #define UI_WIFI_LIST_UP_OFFSET          (20)
 #define UI_WIFI_LIST_UP_PAD             (20)
@@ -84,7 +81,8 @@ bool checkTouchActivity(void);
 
 
 
-#define SCAN_LIST_SIZE      25
+#define SCAN_LIST_SIZE      48      // APs kept from the scans, only the rows in view are LVGL objects
+#define WIFI_LIST_ROW_NUM_MAX   (16)
 
 static const char TAG[] = "EUI_Setting";
 static const char SAVER_TAG[] = "ScreenSaver";
@@ -93,17 +91,51 @@ TaskHandle_t wifi_scan_handle_task;
 
 static EventGroupHandle_t s_wifi_event_group;
 
-static char st_wifi_ssid[32];
-static char st_wifi_password[64];
+static char st_wifi_ssid[33];
+static char st_wifi_password[65];
+// AP of the last connection, written by the event handler before it sets WIFI_EVENT_CONNECTED
+static uint8_t st_wifi_bssid[6];
+static uint8_t st_wifi_channel;
 
 static uint8_t base_mac_addr[6] = {0};
 static char mac_str[18] = {0};
 
-static lv_obj_t* panel_wifi_btn[SCAN_LIST_SIZE];
-static lv_obj_t* label_wifi_ssid[SCAN_LIST_SIZE];
-static lv_obj_t* img_img_wifi_lock[SCAN_LIST_SIZE];
-static lv_obj_t* wifi_image[SCAN_LIST_SIZE];
-static lv_obj_t* wifi_connect[SCAN_LIST_SIZE];
+// Result of the last scans, merged by SSID. Written by the scan task, read by the LVGL task
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];       // Strongest AP of the SSID in the last scan
+    int8_t rssi;
+    uint8_t channel;
+    bool psk;
+    TickType_t last_seen;
+} wifi_scan_entry_t;
+
+static wifi_scan_entry_t wifi_scan_cache[SCAN_LIST_SIZE];
+static int wifi_scan_cache_num = 0;
+static SemaphoreHandle_t wifi_scan_cache_lock = NULL;
+
+// A recycled button of the list, the row `i` shows the entries whose index modulo the row count is `i`
+typedef struct {
+    lv_obj_t *btn;
+    lv_obj_t *ssid;
+    lv_obj_t *lock;
+    lv_obj_t *signal;
+    lv_obj_t *connect;
+    int index;              // Entry shown, -1 while hidden
+    // What the row shows, so an update only touches the rows whose AP changed
+    uint8_t bssid[6];
+    bool psk;
+    bool connected;
+    int level;
+} wifi_list_row_t;
+
+// Only used by the LVGL task
+static wifi_list_row_t wifi_list_rows[WIFI_LIST_ROW_NUM_MAX];
+static int wifi_list_row_num = 0;
+static lv_obj_t *wifi_list_spacer = NULL;  // Bottom of the last entry, gives the list its scroll height
+static lv_coord_t wifi_list_pitch = 0;
+static wifi_scan_entry_t wifi_list_entries[SCAN_LIST_SIZE];
+static int wifi_list_num = 0;
 
 static int brightness;
 
@@ -119,7 +151,9 @@ typedef enum {
     WIFI_EVENT_CONNECTED = BIT(0),
     WIFI_EVENT_INIT_DONE = BIT(1),
     WIFI_EVENT_UI_INIT_DONE = BIT(2),
-    WIFI_EVENT_SCANING = BIT(3)
+    WIFI_EVENT_SCANING = BIT(3),
+    WIFI_EVENT_SCAN_FINISHED = BIT(4),
+    WIFI_EVENT_CONNECT_FAILED = BIT(5),
 } wifi_event_id_t;
 
 LV_IMG_DECLARE(img_app_setting);
@@ -138,7 +172,8 @@ AppSettings::AppSettings():
     _screen_is_off(false),
     _saved_brightness(0),
     _screen_saver_timer(nullptr),
-    _screen_saver_timer_started(false)
+    _screen_saver_timer_started(false),
+    _memory_label_seq(0)
 {
 }
 
@@ -219,31 +254,24 @@ bool AppSettings::init(void)
     status_bar = home.getStatusBar();
     backstage = home.getRecentsScreen();
 
-    // Initialize NVS parameters
-    _nvs_param_map[NVS_KEY_WIFI_ENABLE] = false;
-    _nvs_param_map[NVS_KEY_BLE_ENABLE] = false;
-    _nvs_param_map[NVS_KEY_AUDIO_VOLUME] = bsp_extra_codec_volume_get();
-    _nvs_param_map[NVS_KEY_AUDIO_VOLUME] = max(min((int)_nvs_param_map[NVS_KEY_AUDIO_VOLUME], SPEAKER_VOLUME_MAX), SPEAKER_VOLUME_MIN);
-    // _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS] = bsp_display_brightness_get();
-    _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS] = brightness;
-    _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS] = max(min((int)_nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS], SCREEN_BRIGHTNESS_MAX), SCREEN_BRIGHTNESS_MIN);
-    _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT] = SCREEN_TIMEOUT_DEFAULT;
-    // Load NVS parameters if exist
-    loadNvsParam();
+    // Defaults of the settings not saved yet, the saved ones are already loaded by the settings store
+    settings_store_set_default(SETTINGS_KEY_AUDIO_VOLUME,
+                               max(min(bsp_extra_codec_volume_get(), SPEAKER_VOLUME_MAX), SPEAKER_VOLUME_MIN));
+    settings_store_set_default(SETTINGS_KEY_DISPLAY_BRIGHTNESS,
+                               max(min(brightness, SCREEN_BRIGHTNESS_MAX), SCREEN_BRIGHTNESS_MIN));
+    settings_store_set_default(SETTINGS_KEY_SCREEN_TIMEOUT, SCREEN_TIMEOUT_DEFAULT);
     // Update System parameters
-    bsp_extra_codec_volume_set(_nvs_param_map[NVS_KEY_AUDIO_VOLUME], (int *)&_nvs_param_map[NVS_KEY_AUDIO_VOLUME]);
-    bsp_display_brightness_set(_nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS]);
+    bsp_extra_codec_volume_set(settings_store_get(SETTINGS_KEY_AUDIO_VOLUME), NULL);
+    backlight_set(settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS), SCREEN_BRIGHTNESS_FADE_MS);
 
     // Initialize screen saver variables (for UI state tracking only)
     _screen_is_off = false;
-    _saved_brightness = _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS];
+    _saved_brightness = settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS);
 
-    xTaskCreate(euiRefresTask, "Home Refresh", HOME_REFRESH_TASK_STACK_SIZE, this, HOME_REFRESH_TASK_PRIORITY, NULL);
-    xTaskCreate(wifiScanTask, "WiFi Scan", WIFI_SCAN_TASK_STACK_SIZE, this, WIFI_SCAN_TASK_PRIORITY, NULL);
-    
-    // Set initial timeout for global screen saver
-    GlobalScreenSaver& screenSaver = GlobalScreenSaver::getInstance();
-    screenSaver.setTimeoutSeconds(_nvs_param_map[NVS_KEY_SCREEN_TIMEOUT]);
+    if (lv_timer_create(onHomeRefreshTimer, HOME_REFRESH_TIMER_PERIOD_MS, this) == NULL) {
+        ESP_LOGE(TAG, "Create home refresh timer failed");
+    }
+    task_config_create(TASK_CONFIG_WIFI_SCAN, wifiScanTask, this, NULL);
 
     return true;
 }
@@ -285,7 +313,7 @@ void AppSettings::extraUiInit(void)
     // Set up global screen saver instance  
     _screen_saver_instance = this;
     
-    ESP_LOGI(SAVER_TAG, "Screen saver initialized with %d second timeout", _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT]);
+    ESP_LOGI(SAVER_TAG, "Screen saver initialized with %d second timeout", settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT));
 
     /* WiFi */
     // Switch
@@ -300,39 +328,11 @@ void AppSettings::extraUiInit(void)
     lv_obj_set_style_pad_all(ui_PanelScreenSettingWiFiList, 0, 0);
     lv_obj_set_style_pad_top(ui_PanelScreenSettingWiFiList, UI_WIFI_LIST_UP_PAD, 0);
     lv_obj_set_style_pad_bottom(ui_PanelScreenSettingWiFiList, UI_WIFI_LIST_DOWN_PAD, 0);
-    for(int i = 0; i < SCAN_LIST_SIZE; i++) {
-        panel_wifi_btn[i] = lv_obj_create(ui_PanelScreenSettingWiFiList);
-        lv_obj_set_size(panel_wifi_btn[i], lv_pct(100), UI_WIFI_LIST_ITEM_H);
-        lv_obj_set_style_radius(panel_wifi_btn[i], 0, 0);
-        lv_obj_set_style_border_width(panel_wifi_btn[i], 0, 0);
-        lv_obj_set_style_text_font(panel_wifi_btn[i], UI_WIFI_LIST_ITEM_FONT, 0);
-        lv_obj_add_flag(panel_wifi_btn[i], LV_OBJ_FLAG_CLICKABLE);
-        lv_obj_clear_flag( panel_wifi_btn[i], LV_OBJ_FLAG_SCROLLABLE );
-        lv_obj_set_style_bg_color(panel_wifi_btn[i], lv_color_hex(0xCBCBCB), LV_PART_MAIN | LV_STATE_PRESSED );
-        lv_obj_set_style_bg_opa(panel_wifi_btn[i], 255, LV_PART_MAIN| LV_STATE_DEFAULT);
-        lv_obj_set_style_border_color(panel_wifi_btn[i], lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT );
-        lv_obj_set_style_border_opa(panel_wifi_btn[i], 255, LV_PART_MAIN| LV_STATE_DEFAULT);
-
-        label_wifi_ssid[i] = lv_label_create(panel_wifi_btn[i]);
-        lv_obj_set_align(label_wifi_ssid[i], LV_ALIGN_LEFT_MID);
-
-        img_img_wifi_lock[i] = lv_img_create(panel_wifi_btn[i]);
-        lv_obj_align(img_img_wifi_lock[i], LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_LOCK_RIGHT_OFFSET, 0);
-        lv_obj_add_flag(img_img_wifi_lock[i], LV_OBJ_FLAG_HIDDEN);
-
-        wifi_image[i] = lv_img_create(panel_wifi_btn[i]);
-        lv_obj_align(wifi_image[i], LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_SIGNAL_RIGHT_OFFSET, 0);
-
-        wifi_connect[i] = lv_label_create(panel_wifi_btn[i]);
-        lv_label_set_text(wifi_connect[i], LV_SYMBOL_OK);
-        lv_obj_align(wifi_connect[i], LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_CONNECT_RIGHT_OFFSET, 0);
-        lv_obj_add_flag(wifi_connect[i], LV_OBJ_FLAG_HIDDEN);
-
-        lv_obj_add_event_cb(panel_wifi_btn[i], onButtonWifiListClickedEventCallback, LV_EVENT_CLICKED, (void*)label_wifi_ssid[i]);
-        if(!(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING)) {
-            lv_obj_add_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN);
-            lv_obj_add_flag(ui_SpinnerScreenSettingWiFi, LV_OBJ_FLAG_HIDDEN);
-        }
+    createWifiListRows();
+    lv_obj_add_event_cb(ui_PanelScreenSettingWiFiList, onWifiListScrollEventCallback, LV_EVENT_SCROLL, this);
+    if(!(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING)) {
+        lv_obj_add_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(ui_SpinnerScreenSettingWiFi, LV_OBJ_FLAG_HIDDEN);
     }
     lv_obj_add_flag(ui_ButtonScreenSettingWiFiReturn, LV_OBJ_FLAG_HIDDEN);
     // Connect
@@ -447,89 +447,25 @@ void AppSettings::processWifiConnect(WifiConnectState_t state)
     }
 }
 
-bool AppSettings::loadNvsParam(void)
-{
-    esp_err_t err = ESP_OK;
-    nvs_handle_t nvs_handle;
-    err = nvs_open(NVS_STORAGE_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
-        return false;
-    }
-
-    for (auto& key_value : _nvs_param_map) {
-        err = nvs_get_i32(nvs_handle, key_value.first.c_str(), &key_value.second);
-        switch (err) {
-        case ESP_OK:
-            ESP_LOGI(TAG, "Load %s: %d", key_value.first.c_str(), key_value.second);
-            break;
-        case ESP_ERR_NVS_NOT_FOUND:
-            err = nvs_set_i32(nvs_handle, key_value.first.c_str(), key_value.second);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Error (%s) setting %s", esp_err_to_name(err), key_value.first.c_str());
-            }
-            ESP_LOGW(TAG, "The value of %s is not initialized yet, set it to default value: %d", key_value.first.c_str(),
-                     key_value.second);
-            break;
-        default:
-            break;
-        }
-    }
-
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) committing NVS changes", esp_err_to_name(err));
-        return false;
-    }
-    nvs_close(nvs_handle);
-
-    return true;
-}
-
-bool AppSettings::setNvsParam(std::string key, int value)
-{
-    esp_err_t err = ESP_OK;
-    nvs_handle_t nvs_handle;
-    err = nvs_open(NVS_STORAGE_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
-        return false;
-    }
-
-    err = nvs_set_i32(nvs_handle, key.c_str(), value);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) setting %s", esp_err_to_name(err), key.c_str());
-    }
-
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error (%s) committing NVS changes", esp_err_to_name(err));
-        return false;
-    }
-    nvs_close(nvs_handle);
-
-    return true;
-}
-
 void AppSettings::updateUiByNvsParam(void)
 {
-    if (_nvs_param_map[NVS_KEY_WIFI_ENABLE]) {
+    if (settings_store_get(SETTINGS_KEY_WIFI_ENABLE)) {
         lv_obj_add_state(ui_SwitchPanelScreenSettingWiFiSwitch, LV_STATE_CHECKED);
     } else {
         lv_obj_clear_state(ui_SwitchPanelScreenSettingWiFiSwitch, LV_STATE_CHECKED);
     }
 
-    if (_nvs_param_map[NVS_KEY_BLE_ENABLE]) {
+    if (settings_store_get(SETTINGS_KEY_BLE_ENABLE)) {
         lv_obj_add_state(ui_SwitchPanelScreenSettingBLESwitch, LV_STATE_CHECKED);
     } else {
         lv_obj_clear_state(ui_SwitchPanelScreenSettingBLESwitch, LV_STATE_CHECKED);
     }
 
-    lv_slider_set_value(ui_SliderPanelScreenSettingLightSwitch1, _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS], LV_ANIM_OFF);
-    lv_slider_set_value(ui_SliderPanelScreenSettingVolumeSwitch, _nvs_param_map[NVS_KEY_AUDIO_VOLUME], LV_ANIM_OFF);
+    lv_slider_set_value(ui_SliderPanelScreenSettingLightSwitch1, settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS), LV_ANIM_OFF);
+    lv_slider_set_value(ui_SliderPanelScreenSettingVolumeSwitch, settings_store_get(SETTINGS_KEY_AUDIO_VOLUME), LV_ANIM_OFF);
     
     // Update screen timeout dropdown
-    int32_t timeout = _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT];
+    int32_t timeout = settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT);
     uint16_t dropdown_index = 0;
     if (timeout == SCREEN_TIMEOUT_NEVER) dropdown_index = 0;
     else if (timeout == SCREEN_TIMEOUT_30S) dropdown_index = 1;
@@ -542,6 +478,8 @@ void AppSettings::updateUiByNvsParam(void)
 esp_err_t AppSettings::initWifi()
 {
     s_wifi_event_group = xEventGroupCreate();
+    wifi_scan_cache_lock = xSemaphoreCreateMutex();
+    assert(wifi_scan_cache_lock);
     xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_CONNECTED);
     xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_INIT_DONE);
     xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_SCANING);
@@ -562,6 +500,12 @@ esp_err_t AppSettings::initWifi()
                                                         &wifiEventHandler,
                                                         this,
                                                         &instance_any_id));
+    esp_event_handler_instance_t instance_got_ip;
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
+                                                        IP_EVENT_STA_GOT_IP,
+                                                        &wifiEventHandler,
+                                                        this,
+                                                        &instance_got_ip));
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
@@ -581,70 +525,262 @@ void AppSettings::stopWifiScan(void)
 {
     ESP_LOGI(TAG, "Stop Wi-Fi scan");
     xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_SCANING);
+    // A scan still running would delay a connection, its records are dropped by the scan task
+    esp_wifi_scan_stop();
     lv_obj_add_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(ui_SpinnerScreenSettingWiFi, LV_OBJ_FLAG_HIDDEN);
     deinitWifiListButton();
 }
 
-void AppSettings::scanWifiAndUpdateUi(void)
+AppSettings::WifiSignalStrengthLevel_t AppSettings::getWifiSignalStrengthLevel(int rssi)
 {
-    bool psk_flag = false;
+    if(rssi > -100 && rssi <= -80) {
+        return WIFI_SIGNAL_STRENGTH_WEAK;
+    } else if(rssi > -80 && rssi <= -60) {
+        return WIFI_SIGNAL_STRENGTH_MODERATE;
+    } else if(rssi > -60) {
+        return WIFI_SIGNAL_STRENGTH_GOOD;
+    }
 
-    uint16_t number = SCAN_LIST_SIZE;
-    wifi_ap_record_t ap_info[SCAN_LIST_SIZE];
-    uint16_t ap_count = 0;
-    memset(ap_info, 0, sizeof(ap_info));
+    return WIFI_SIGNAL_STRENGTH_NONE;
+}
 
-    esp_wifi_start();
-    esp_wifi_scan_start(NULL, true);
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&number, ap_info));
-#if ENABLE_DEBUG_LOG
-    ESP_LOGI(TAG, "Total APs scanned = %u", ap_count);
+bool AppSettings::startWifiScanAsync(void)
+{
+    wifi_scan_config_t scan_config = {};
+
+    // The scan runs in the Wi-Fi task, WIFI_EVENT_SCAN_DONE tells when the records are ready
+    scan_config.channel = CONFIG_SETTING_WIFI_SCAN_CHANNEL;
+#if CONFIG_SETTING_WIFI_SCAN_PASSIVE
+    scan_config.scan_type = WIFI_SCAN_TYPE_PASSIVE;
+    scan_config.scan_time.passive = CONFIG_SETTING_WIFI_SCAN_CHANNEL_MS;
+#else
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = CONFIG_SETTING_WIFI_SCAN_CHANNEL_MS / 2;
+    scan_config.scan_time.active.max = CONFIG_SETTING_WIFI_SCAN_CHANNEL_MS;
 #endif
 
-    bsp_display_lock(0);
-    if(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING) {
-        deinitWifiListButton();
+    xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_SCAN_FINISHED);
+    esp_wifi_start();
+    esp_err_t ret = esp_wifi_scan_start(&scan_config, false);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Start scan failed: %s", esp_err_to_name(ret));
+        return false;
     }
-    bsp_display_unlock();
 
-    for (int i = 0; (i < SCAN_LIST_SIZE) && (i < ap_count); i++) {
+    return true;
+}
+
+void AppSettings::updateWifiScanCache(void)
+{
+    uint16_t number = SCAN_LIST_SIZE;
+    TickType_t now = xTaskGetTickCount();
+    // Too large for the stack of the scan task with a long list, only allocated while merging
+    wifi_ap_record_t *ap_info = (wifi_ap_record_t *)calloc(SCAN_LIST_SIZE, sizeof(wifi_ap_record_t));
+
+    // Always fetch or clear the records, it frees the list kept by the driver
+    if (ap_info == NULL) {
+        ESP_LOGE(TAG, "Allocate scan records failed");
+        esp_wifi_clear_ap_list();
+        number = 0;
+    } else if (esp_wifi_scan_get_ap_records(&number, ap_info) != ESP_OK) {
+        number = 0;
+    }
 #if ENABLE_DEBUG_LOG
-        ESP_LOGI(TAG, "SSID \t\t%s", ap_info[i].ssid);
-        ESP_LOGI(TAG, "RSSI \t\t%d", ap_info[i].rssi);
-        ESP_LOGI(TAG, "Channel \t\t%d", ap_info[i].primary);
+    ESP_LOGI(TAG, "Total APs scanned = %u", number);
 #endif
 
-        if(ap_info[i].authmode != WIFI_AUTH_OPEN && ap_info[i].authmode != WIFI_AUTH_OWE) {
-            psk_flag = true;
+    xSemaphoreTake(wifi_scan_cache_lock, portMAX_DELAY);
+    // The records are sorted by RSSI, the first one of an SSID is its strongest AP
+    for (int i = 0; i < number; i++) {
+        const char *ssid = (const char *)ap_info[i].ssid;
+        if (ssid[0] == '\0') {
+            continue;
         }
-#if ENABLE_DEBUG_LOG
-        ESP_LOGI(TAG, "psk_flag: %d", psk_flag);
-#endif
 
-        if(ap_info[i].rssi > -100 && ap_info[i].rssi <= -80) {
-            _wifi_signal_strength_level = WIFI_SIGNAL_STRENGTH_WEAK;
-        } else if(ap_info[i].rssi > -80 && ap_info[i].rssi <= -60) {
-            _wifi_signal_strength_level = WIFI_SIGNAL_STRENGTH_MODERATE;
-        } else if(ap_info[i].rssi > -60) {
-            _wifi_signal_strength_level = WIFI_SIGNAL_STRENGTH_GOOD;
-        } else {
-            _wifi_signal_strength_level = WIFI_SIGNAL_STRENGTH_NONE;
+        wifi_scan_entry_t *entry = NULL;
+        for (int j = 0; j < wifi_scan_cache_num; j++) {
+            if (strcmp(wifi_scan_cache[j].ssid, ssid) == 0) {
+                entry = &wifi_scan_cache[j];
+                break;
+            }
         }
-#if ENABLE_DEBUG_LOG
-        ESP_LOGI(TAG, "signal_strength: %d", _wifi_signal_strength_level);
-#endif
+        if ((entry != NULL) && (entry->last_seen == now)) {
+            continue;
+        }
+        if ((entry == NULL) && (wifi_scan_cache_num < SCAN_LIST_SIZE)) {
+            entry = &wifi_scan_cache[wifi_scan_cache_num++];
+        }
+        if (entry == NULL) {
+            // Full, replace the AP seen the longest time ago
+            entry = &wifi_scan_cache[0];
+            for (int j = 1; j < wifi_scan_cache_num; j++) {
+                if ((TickType_t)(now - wifi_scan_cache[j].last_seen) > (TickType_t)(now - entry->last_seen)) {
+                    entry = &wifi_scan_cache[j];
+                }
+            }
+            if (entry->last_seen == now) {
+                continue;
+            }
+        }
+        strlcpy(entry->ssid, ssid, sizeof(entry->ssid));
+        memcpy(entry->bssid, ap_info[i].bssid, sizeof(entry->bssid));
+        entry->rssi = ap_info[i].rssi;
+        entry->channel = ap_info[i].primary;
+        entry->psk = (ap_info[i].authmode != WIFI_AUTH_OPEN) && (ap_info[i].authmode != WIFI_AUTH_OWE);
+        entry->last_seen = now;
+    }
+
+    // Drop the APs not seen lately and keep the strongest first
+    int num = 0;
+    for (int i = 0; i < wifi_scan_cache_num; i++) {
+        if ((now - wifi_scan_cache[i].last_seen) <= pdMS_TO_TICKS(WIFI_SCAN_RESULT_AGE_MS)) {
+            wifi_scan_cache[num++] = wifi_scan_cache[i];
+        }
+    }
+    wifi_scan_cache_num = num;
+    for (int i = 1; i < wifi_scan_cache_num; i++) {
+        wifi_scan_entry_t entry = wifi_scan_cache[i];
+        int j = i - 1;
+        for (; (j >= 0) && (wifi_scan_cache[j].rssi < entry.rssi); j--) {
+            wifi_scan_cache[j + 1] = wifi_scan_cache[j];
+        }
+        wifi_scan_cache[j + 1] = entry;
+    }
+    for (int i = 0; i < wifi_scan_cache_num; i++) {
+        if (strcmp(wifi_scan_cache[i].ssid, st_wifi_ssid) == 0) {
+            _wifi_signal_strength_level = getWifiSignalStrengthLevel(wifi_scan_cache[i].rssi);
+            break;
+        }
+    }
+    xSemaphoreGive(wifi_scan_cache_lock);
+    free(ap_info);
+}
+
+void AppSettings::onUiWifiScanUpdated(const void *data, void *user_data)
+{
+    AppSettings *app = (AppSettings *)user_data;
+
+    if (app->_is_ui_del || !(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING)) {
+        return;
+    }
+
+    xSemaphoreTake(wifi_scan_cache_lock, portMAX_DELAY);
+    wifi_list_num = wifi_scan_cache_num;
+    memcpy(wifi_list_entries, wifi_scan_cache, wifi_list_num * sizeof(wifi_list_entries[0]));
+    xSemaphoreGive(wifi_scan_cache_lock);
+
+    // The spacer ends where the last entry does, a shorter list scrolls back into range
+    lv_obj_set_y(wifi_list_spacer,
+                 (wifi_list_num > 0) ? (wifi_list_num - 1) * wifi_list_pitch + UI_WIFI_LIST_ITEM_H - 1 : 0);
+    lv_obj_readjust_scroll(ui_PanelScreenSettingWiFiList, LV_ANIM_OFF);
+    app->refreshWifiList();
+
+    if (lv_obj_has_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN)) {
+        lv_obj_clear_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(ui_SpinnerScreenSettingWiFi, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(ui_SwitchPanelScreenSettingWiFiSwitch, LV_OBJ_FLAG_CLICKABLE);
+        app->status_bar->setWifiIconState(0);
+    }
+}
 
-        bsp_display_lock(0);
-        if(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING) {
-            initWifiListButton(label_wifi_ssid[i], img_img_wifi_lock[i], wifi_image[i], wifi_connect[i],
-                                ap_info[i].ssid, psk_flag, _wifi_signal_strength_level);     
+void AppSettings::createWifiListRows(void)
+{
+    // Rows are placed by `refreshWifiList`, one pitch apart with the gap the flex layout had
+    lv_obj_set_layout(ui_PanelScreenSettingWiFiList, 0);
+    wifi_list_pitch = UI_WIFI_LIST_ITEM_H + lv_obj_get_style_pad_row(ui_PanelScreenSettingWiFiList, LV_PART_MAIN);
+    // Enough rows to cover the list while it scrolls, one more for each partly shown row at the edges
+    wifi_list_row_num = std::min<int>(LV_VER_RES * UI_WIFI_LIST_H_PERCENT / 100 / wifi_list_pitch + 2,
+                                      WIFI_LIST_ROW_NUM_MAX);
+    wifi_list_num = 0;
+
+    wifi_list_spacer = lv_obj_create(ui_PanelScreenSettingWiFiList);
+    lv_obj_remove_style_all(wifi_list_spacer);
+    lv_obj_set_size(wifi_list_spacer, 1, 1);
+    lv_obj_clear_flag(wifi_list_spacer, LV_OBJ_FLAG_CLICKABLE);
+
+    for(int i = 0; i < wifi_list_row_num; i++) {
+        wifi_list_row_t *row = &wifi_list_rows[i];
+
+        row->btn = lv_obj_create(ui_PanelScreenSettingWiFiList);
+        lv_obj_set_size(row->btn, lv_pct(100), UI_WIFI_LIST_ITEM_H);
+        lv_obj_set_style_radius(row->btn, 0, 0);
+        lv_obj_set_style_border_width(row->btn, 0, 0);
+        lv_obj_set_style_text_font(row->btn, UI_WIFI_LIST_ITEM_FONT, 0);
+        lv_obj_add_flag(row->btn, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_clear_flag( row->btn, LV_OBJ_FLAG_SCROLLABLE );
+        lv_obj_set_style_bg_color(row->btn, lv_color_hex(0xCBCBCB), LV_PART_MAIN | LV_STATE_PRESSED );
+        lv_obj_set_style_bg_opa(row->btn, 255, LV_PART_MAIN| LV_STATE_DEFAULT);
+        lv_obj_set_style_border_color(row->btn, lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT );
+        lv_obj_set_style_border_opa(row->btn, 255, LV_PART_MAIN| LV_STATE_DEFAULT);
+        lv_obj_add_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
+
+        row->ssid = lv_label_create(row->btn);
+        lv_obj_set_align(row->ssid, LV_ALIGN_LEFT_MID);
+
+        row->lock = lv_img_create(row->btn);
+        lv_obj_align(row->lock, LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_LOCK_RIGHT_OFFSET, 0);
+        lv_obj_add_flag(row->lock, LV_OBJ_FLAG_HIDDEN);
+
+        row->signal = lv_img_create(row->btn);
+        lv_obj_align(row->signal, LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_SIGNAL_RIGHT_OFFSET, 0);
+
+        row->connect = lv_label_create(row->btn);
+        lv_label_set_text(row->connect, LV_SYMBOL_OK);
+        lv_obj_align(row->connect, LV_ALIGN_RIGHT_MID, UI_WIFI_ICON_CONNECT_RIGHT_OFFSET, 0);
+        lv_obj_add_flag(row->connect, LV_OBJ_FLAG_HIDDEN);
+
+        row->index = -1;
+        lv_obj_add_event_cb(row->btn, onButtonWifiListClickedEventCallback, LV_EVENT_CLICKED, (void*)row->ssid);
+    }
+}
+
+void AppSettings::refreshWifiList(void)
+{
+    int first = std::max<int>(lv_obj_get_scroll_y(ui_PanelScreenSettingWiFiList), 0) / wifi_list_pitch;
+
+    for (int i = 0; i < wifi_list_row_num; i++) {
+        wifi_list_row_t *row = &wifi_list_rows[i];
+        // The window moves by one entry per pitch scrolled, so only the row leaving it gets a new entry
+        int index = first + (((i - first) % wifi_list_row_num) + wifi_list_row_num) % wifi_list_row_num;
+        if (index >= wifi_list_num) {
+            if (row->index >= 0) {
+                lv_obj_add_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
+                row->index = -1;
+            }
+            continue;
+        }
+
+        const wifi_scan_entry_t *entry = &wifi_list_entries[index];
+        bool connected = (strcmp(entry->ssid, st_wifi_ssid) == 0);
+        int level = getWifiSignalStrengthLevel(entry->rssi);
+        bool same = (row->index >= 0) && (memcmp(row->bssid, entry->bssid, sizeof(row->bssid)) == 0) &&
+                    (row->psk == entry->psk) && (row->connected == connected) && (row->level == level);
+        if (row->index != index) {
+            lv_obj_set_y(row->btn, index * wifi_list_pitch);
+        }
+        if (!same) {
+            initWifiListButton(row->ssid, row->lock, row->signal, row->connect, (uint8_t *)entry->ssid, entry->psk,
+                               (WifiSignalStrengthLevel_t)level);
+            memcpy(row->bssid, entry->bssid, sizeof(row->bssid));
+            row->psk = entry->psk;
+            row->connected = connected;
+            row->level = level;
+        }
+        if (row->index < 0) {
+            lv_obj_clear_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
         }
-        bsp_display_unlock();
+        row->index = index;
     }
 }
 
+void AppSettings::onWifiListScrollEventCallback(lv_event_t *e)
+{
+    AppSettings *app = (AppSettings *)lv_event_get_user_data(e);
+
+    app->refreshWifiList();
+}
+
 void AppSettings::initWifiListButton(lv_obj_t* lv_label_ssid, lv_obj_t* lv_img_wifi_lock, lv_obj_t* lv_wifi_img,
                                      lv_obj_t *lv_wifi_connect, uint8_t* ssid, bool psk, WifiSignalStrengthLevel_t signal_strength)
 {
@@ -652,11 +788,15 @@ void AppSettings::initWifiListButton(lv_obj_t* lv_label_ssid, lv_obj_t* lv_img_w
 
     if (strcmp((const char*)ssid, (const char*)st_wifi_ssid) == 0) {
         lv_obj_clear_flag(lv_wifi_connect, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(lv_wifi_connect, LV_OBJ_FLAG_HIDDEN);
     }
 
     if(psk) {
         lv_img_set_src(lv_img_wifi_lock, &img_wifi_lock);
         lv_obj_clear_flag(lv_img_wifi_lock, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(lv_img_wifi_lock, LV_OBJ_FLAG_HIDDEN);
     }
 
     if (signal_strength == WIFI_SIGNAL_STRENGTH_GOOD) {
@@ -672,90 +812,97 @@ void AppSettings::initWifiListButton(lv_obj_t* lv_label_ssid, lv_obj_t* lv_img_w
 
 void AppSettings::deinitWifiListButton(void)
 {
-    for (int i = 0; i < SCAN_LIST_SIZE; i++) {
-        lv_obj_add_flag(img_img_wifi_lock[i], LV_OBJ_FLAG_HIDDEN);
-        lv_obj_add_flag(wifi_connect[i], LV_OBJ_FLAG_HIDDEN);
+    for (int i = 0; i < wifi_list_row_num; i++) {
+        lv_obj_add_flag(wifi_list_rows[i].btn, LV_OBJ_FLAG_HIDDEN);
+        wifi_list_rows[i].index = -1;
     }
+    wifi_list_num = 0;
+    lv_obj_set_y(wifi_list_spacer, 0);
+    lv_obj_scroll_to_y(ui_PanelScreenSettingWiFiList, 0, LV_ANIM_OFF);
 }
 
-void AppSettings::euiRefresTask(void *arg)
+void AppSettings::onSntpSynced(void *user_data)
 {
-    AppSettings *app = (AppSettings *)arg;
-    time_t now;
-    struct tm timeinfo;
-    bool is_time_pm = false;
-    // char textBuf[50];
-    uint16_t free_sram_size_kb = 0;
-    uint16_t total_sram_size_kb = 0;
-    uint16_t free_psram_size_kb = 0;
-    uint16_t total_psram_size_kb = 0;
-
-    if (app == NULL) {
-        ESP_LOGE(TAG, "App instance is NULL");
-        goto err;
-    }
+    AppSettings *app = (AppSettings *)user_data;
 
-    while (1) {
-        /* Update status bar */
-        // time
-        time(&now);
-        localtime_r(&now, &timeinfo);
-        is_time_pm = (timeinfo.tm_hour >= 12);
+    // Called from the SNTP task, let the LVGL task read the new time
+    app->getPhone()->postToUi("clock", onUiClockSynced, nullptr, 0, app);
+}
 
-        bsp_display_lock(0);
-        if(!app->status_bar->setClock(timeinfo.tm_hour, timeinfo.tm_min, is_time_pm)) {
-            ESP_LOGE(TAG, "Set clock failed");
-        }
-        bsp_display_unlock();
+void AppSettings::onUiClockSynced(const void *data, void *user_data)
+{
+    AppSettings *app = (AppSettings *)user_data;
 
-        // Update WiFi icon state
-        if((xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_CONNECTED)) {
-            app_sntp_init();
+    if(!app->status_bar->refreshClock()) {
+        ESP_LOGE(TAG, "Refresh clock failed");
+    }
+}
 
-            bsp_display_lock(0);
-            if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_NONE) {
-                app->status_bar->setWifiIconState(0);
-            } else if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_WEAK) {
-                app->status_bar->setWifiIconState(1);
-            } else if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_MODERATE) {
-                app->status_bar->setWifiIconState(2);
-            } else if (app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_GOOD) {
-                app->status_bar->setWifiIconState(3);
-            }
-            bsp_display_unlock();
+void AppSettings::onHomeRefreshTimer(lv_timer_t *timer)
+{
+    AppSettings *app = (AppSettings *)timer->user_data;
+    int wifi_icon_state = -1;
+
+    // The status bar clock updates itself at each minute, only the WiFi icon and the memory are refreshed here
+    // Update WiFi icon state
+    if((s_wifi_event_group != NULL) && (xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_CONNECTED)) {
+        if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_NONE) {
+            wifi_icon_state = 0;
+        } else if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_WEAK) {
+            wifi_icon_state = 1;
+        } else if(app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_MODERATE) {
+            wifi_icon_state = 2;
+        } else if (app->_wifi_signal_strength_level == WIFI_SIGNAL_STRENGTH_GOOD) {
+            wifi_icon_state = 3;
         }
-
-        /* Updte Smart Gadget app */
-        // app->updateGadgetTime(timeinfo);
-
-        // Update memory in backstage
-        if(app->backstage->checkVisible()) {
-            free_sram_size_kb = heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024;
-            total_sram_size_kb = heap_caps_get_total_size(MALLOC_CAP_INTERNAL) / 1024;
-            free_psram_size_kb = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024;
-            total_psram_size_kb = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) / 1024;
-            ESP_LOGI(TAG, "Free sram size: %d KB, total sram size: %d KB, "
-                        "free psram size: %d KB, total psram size: %d KB",
-                        free_sram_size_kb, total_sram_size_kb, free_psram_size_kb, total_psram_size_kb);
-
-            bsp_display_lock(0);
-            if(!app->backstage->setMemoryLabel(free_sram_size_kb, total_sram_size_kb, free_psram_size_kb, total_psram_size_kb)) {
-                ESP_LOGE(TAG, "Update memory usage failed");
-            }
-            bsp_display_unlock();
+        if (wifi_icon_state >= 0) {
+            app->status_bar->setWifiIconState(wifi_icon_state);
         }
+    }
+
+    /* Updte Smart Gadget app */
+    // app->updateGadgetTime(timeinfo);
 
-        vTaskDelay(pdMS_TO_TICKS(HOME_REFRESH_TASK_PERIOD_MS));
+    // Update memory in backstage, only shown while the backstage is visible
+    if(!app->backstage->checkVisible()) {
+        return;
     }
 
-err:
-    vTaskDelete(NULL);
+    // The label keeps its text until the heaps moved by CONFIG_HEAP_STATS_CHANGE_KB
+    heap_stats_t stats;
+    if ((heap_stats_get(&stats) != ESP_OK) || (stats.seq == app->_memory_label_seq)) {
+        return;
+    }
+    app->_memory_label_seq = stats.seq;
+
+    int free_sram_kb = stats.regions[HEAP_STATS_REGION_INTERNAL].free / 1024;
+    int total_sram_kb = stats.regions[HEAP_STATS_REGION_INTERNAL].total / 1024;
+    int free_psram_kb = stats.regions[HEAP_STATS_REGION_PSRAM].free / 1024;
+    int total_psram_kb = stats.regions[HEAP_STATS_REGION_PSRAM].total / 1024;
+    ESP_LOGD(TAG, "Free sram size: %d KB, total sram size: %d KB, "
+                "free psram size: %d KB, total psram size: %d KB",
+                free_sram_kb, total_sram_kb, free_psram_kb, total_psram_kb);
+    // Split of the LVGL allocations between the internal RAM pool and PSRAM, when the pool is enabled
+    char lv_detail[80] = "";
+    esp_brookesia_core_mem_lv_stats_t lv_stats;
+    if (esp_brookesia_core_mem_get_lv_stats(&lv_stats)) {
+        snprintf(lv_detail, sizeof(lv_detail), "LVGL SRAM %u KB (peak %u, %u%% frag), PSRAM %u KB (peak %u)",
+                 (unsigned)(lv_stats.small.used / 1024), (unsigned)(lv_stats.small.peak / 1024),
+                 (unsigned)lv_stats.small.frag_pct, (unsigned)(lv_stats.large.used / 1024),
+                 (unsigned)(lv_stats.large.peak / 1024));
+    }
+    if(!app->backstage->setMemoryLabel(free_sram_kb, total_sram_kb, free_psram_kb, total_psram_kb, lv_detail)) {
+        ESP_LOGE(TAG, "Update memory usage failed");
+    }
 }
 
 void AppSettings::wifiScanTask(void *arg)
 {
     AppSettings *app = (AppSettings *)arg;
     esp_err_t ret = ESP_OK;
+    bool was_scanning = false;
+    bool scan_running = false;
+    TickType_t next_scan_tick = 0;
 
     if (app == NULL) {
         ESP_LOGE(TAG, "App instance is NULL");
@@ -775,6 +922,11 @@ void AppSettings::wifiScanTask(void *arg)
         ESP_LOGE(TAG, "wifi_init failed");
     }
 
+    // Join the last network right after boot, the scan list is not needed for it
+    if (settings_store_get(SETTINGS_KEY_WIFI_ENABLE) && !app->connectToCachedAp()) {
+        ESP_LOGI(TAG, "No fast connection");
+    }
+
     while (true) {
         if((xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_INIT_DONE) &&
            (xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_UI_INIT_DONE)){
@@ -783,16 +935,99 @@ void AppSettings::wifiScanTask(void *arg)
             xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_UI_INIT_DONE);
         }
 
-        if(xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING){
-            app->scanWifiAndUpdateUi();
-            vTaskDelay(pdMS_TO_TICKS(WIFI_SCAN_TASK_PERIOD_MS));
+        // Scan right away when the list is opened, then every WIFI_SCAN_TASK_PERIOD_MS after the last scan ended
+        bool scanning = (xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING) != 0;
+        if (scanning && !was_scanning) {
+            next_scan_tick = xTaskGetTickCount();
+        }
+        was_scanning = scanning;
+        if (scanning && !scan_running && ((int32_t)(xTaskGetTickCount() - next_scan_tick) >= 0)) {
+            scan_running = app->startWifiScanAsync();
+            if (!scan_running) {
+                next_scan_tick = xTaskGetTickCount() + pdMS_TO_TICKS(WIFI_SCAN_TASK_PERIOD_MS);
+            }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(100));
+        EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_EVENT_SCAN_FINISHED, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(100));
+        if (bits & WIFI_EVENT_SCAN_FINISHED) {
+            scan_running = false;
+            next_scan_tick = xTaskGetTickCount() + pdMS_TO_TICKS(WIFI_SCAN_TASK_PERIOD_MS);
+            app->updateWifiScanCache();
+            if (xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING) {
+                app->getPhone()->postToUi("wifi_scan", onUiWifiScanUpdated, nullptr, 0, app);
+            }
+        }
     }
 
 err:
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_WIFI_SCAN, NULL);
+}
+
+void AppSettings::saveConnectedAp(void)
+{
+    app_wifi_cache_ap_t ap = {};
+
+    strlcpy(ap.ssid, st_wifi_ssid, sizeof(ap.ssid));
+    strlcpy(ap.password, st_wifi_password, sizeof(ap.password));
+    memcpy(ap.bssid, st_wifi_bssid, sizeof(ap.bssid));
+    ap.channel = st_wifi_channel;
+    if (app_wifi_cache_save(&ap) != ESP_OK) {
+        ESP_LOGW(TAG, "Save AP for fast connection failed");
+    }
+}
+
+bool AppSettings::connectToCachedAp(void)
+{
+    app_wifi_cache_ap_t ap = {};
+    wifi_config_t wifi_config = {};
+
+    if (app_wifi_cache_load(&ap) != ESP_OK) {
+        return false;
+    }
+
+    // The driver keeps the PMK of an unchanged SSID and password in its own NVS, the 4-way handshake does not
+    // compute it again
+    memcpy(wifi_config.sta.ssid, ap.ssid, sizeof(wifi_config.sta.ssid));
+    memcpy(wifi_config.sta.password, ap.password, sizeof(wifi_config.sta.password));
+    // First try the saved BSSID on its channel without scanning, then scan all channels for the SSID
+    wifi_config.sta.bssid_set = true;
+    memcpy(wifi_config.sta.bssid, ap.bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.channel = ap.channel;
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        strlcpy(st_wifi_ssid, ap.ssid, sizeof(st_wifi_ssid));
+        strlcpy(st_wifi_password, ap.password, sizeof(st_wifi_password));
+        xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_CONNECT_FAILED);
+        if ((esp_wifi_set_config(WIFI_IF_STA, &wifi_config) != ESP_OK) || (esp_wifi_connect() != ESP_OK)) {
+            return false;
+        }
+
+        ESP_LOGI(TAG, "Connect to %s (%s)", ap.ssid, (attempt == 0) ? "saved channel" : "scan");
+        EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_EVENT_CONNECTED | WIFI_EVENT_CONNECT_FAILED,
+                                               pdFALSE, pdFALSE,
+                                               pdMS_TO_TICKS((attempt == 0) ? WIFI_FAST_CONNECT_WAIT_TIME_MS :
+                                                             WIFI_CONNECT_RET_WAIT_TIME_MS));
+        if (bits & WIFI_EVENT_CONNECTED) {
+            saveConnectedAp();
+            return true;
+        }
+
+        // The AP moved to another channel or was replaced. Let a timed out attempt report its disconnection now, so
+        // it is not taken for the result of the next one
+        if (!(bits & WIFI_EVENT_CONNECT_FAILED)) {
+            esp_wifi_disconnect();
+            xEventGroupWaitBits(s_wifi_event_group, WIFI_EVENT_CONNECT_FAILED, pdFALSE, pdFALSE, pdMS_TO_TICKS(500));
+        }
+        wifi_config.sta.bssid_set = false;
+        wifi_config.sta.channel = 0;
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    memset(st_wifi_ssid, 0, sizeof(st_wifi_ssid));
+
+    return false;
 }
 
 void AppSettings::wifiConnectTask(void *arg)
@@ -803,8 +1038,8 @@ void AppSettings::wifiConnectTask(void *arg)
     esp_wifi_disconnect();
     app->status_bar->setWifiIconState(0);
 
-    memcpy(st_wifi_ssid, lv_label_get_text(ui_LabelScreenSettingVerificationSSID), sizeof(wifi_config.sta.ssid));
-    memcpy(st_wifi_password, lv_textarea_get_text(ui_TextAreaScreenSettingVerificationPassword), sizeof(wifi_config.sta.ssid));
+    strlcpy(st_wifi_ssid, lv_label_get_text(ui_LabelScreenSettingVerificationSSID), sizeof(st_wifi_ssid));
+    strlcpy(st_wifi_password, lv_textarea_get_text(ui_TextAreaScreenSettingVerificationPassword), sizeof(st_wifi_password));
 
     memcpy(wifi_config.sta.ssid, st_wifi_ssid, sizeof(wifi_config.sta.ssid));
     memcpy(wifi_config.sta.password, st_wifi_password, sizeof(wifi_config.sta.password));
@@ -823,6 +1058,7 @@ void AppSettings::wifiConnectTask(void *arg)
 
     if (bits & WIFI_EVENT_CONNECTED) {
         ESP_LOGI(TAG, "Connected successfully");
+        saveConnectedAp();
 
         if (!app->_is_ui_del) {
             bsp_display_lock(0);
@@ -868,7 +1104,7 @@ void AppSettings::wifiConnectTask(void *arg)
     //     app->startWifiScan();
     // }
 
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_WIFI_CONNECT, NULL);
 }
 
 void AppSettings::wifiEventHandler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
@@ -876,26 +1112,34 @@ void AppSettings::wifiEventHandler(void* arg, esp_event_base_t event_base, int32
     AppSettings *app = (AppSettings *)arg;
 
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+        memcpy(st_wifi_bssid, event->bssid, sizeof(st_wifi_bssid));
+        st_wifi_channel = event->channel;
         xEventGroupSetBits(s_wifi_event_group, WIFI_EVENT_CONNECTED);
         ESP_LOGI(TAG, "connected to ap SSID:%s, password:%s.", st_wifi_ssid, st_wifi_password);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        // Synchronize the time once per connection
+        app_sntp_start(onSntpSynced, app);
+#if CONFIG_OTA_UPDATE
+        // Only the header is downloaded while the server has the running image
+        if (CONFIG_OTA_UPDATE_URL[0] != '\0') {
+            ota_update_start_http(CONFIG_OTA_UPDATE_URL);
+        }
+#endif
+#if CONFIG_SCREEN_MIRROR
+        // Keeps running across reconnections, the server follows the new address
+        screen_mirror_start();
+#endif
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         xEventGroupClearBits(s_wifi_event_group, WIFI_EVENT_CONNECTED);
+        xEventGroupSetBits(s_wifi_event_group, WIFI_EVENT_CONNECT_FAILED);
         ESP_LOGI(TAG, "disconnected from ap SSID:%s, password:%s.", st_wifi_ssid, st_wifi_password);
         memset(st_wifi_ssid, 0, sizeof(st_wifi_ssid));
 
         // app->back();
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
-        if(lv_obj_has_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN) &&
-           xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_SCANING) {
-            if (!app->_is_ui_del) {
-                bsp_display_lock(0);
-                lv_obj_clear_flag(ui_PanelScreenSettingWiFiList, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(ui_SpinnerScreenSettingWiFi, LV_OBJ_FLAG_HIDDEN);
-                lv_obj_add_flag(ui_SwitchPanelScreenSettingWiFiSwitch, LV_OBJ_FLAG_CLICKABLE);
-                app->status_bar->setWifiIconState(0);
-                bsp_display_unlock();
-            }
-        }
+        // The scan task fetches the records and updates the list from the LVGL task
+        xEventGroupSetBits(s_wifi_event_group, WIFI_EVENT_SCAN_FINISHED);
     }
 }
 
@@ -914,8 +1158,7 @@ void AppSettings::onKeyboardScreenSettingVerificationClickedEventCallback(lv_eve
 
         app->stopWifiScan();
 
-        xTaskCreatePinnedToCore(wifiConnectTask, "wifi Connect", WIFI_CONNECT_TASK_STACK_SIZE, app,
-                                WIFI_CONNECT_TASK_PRIORITY, NULL, WIFI_CONNECT_TASK_STACK_CORE);
+        task_config_create(TASK_CONFIG_WIFI_CONNECT, wifiConnectTask, app, NULL);
     }
 
 end:
@@ -940,7 +1183,7 @@ void AppSettings::onScreenLoadEventCallback( lv_event_t * e)
         app->stopWifiScan();
     }
 
-    if ((app->_screen_index == UI_WIFI_SCAN_INDEX) && (app->_nvs_param_map[NVS_KEY_WIFI_ENABLE] == true)) {
+    if ((app->_screen_index == UI_WIFI_SCAN_INDEX) && settings_store_get(SETTINGS_KEY_WIFI_ENABLE)) {
         app->startWifiScan();
     }
 
@@ -955,14 +1198,12 @@ void AppSettings::onSwitchPanelScreenSettingWiFiSwitchValueChangeEventCallback(
     ESP_BROOKESIA_CHECK_NULL_GOTO(app, end, "Invalid app pointer");
 
     if (state & LV_STATE_CHECKED) {
-        app->_nvs_param_map[NVS_KEY_WIFI_ENABLE] = true;
-        app->setNvsParam(NVS_KEY_WIFI_ENABLE, 1);
+        settings_store_set(SETTINGS_KEY_WIFI_ENABLE, 1);
         if (app->_screen_index == UI_WIFI_SCAN_INDEX) {
             app->startWifiScan();
         }
     } else {
-        app->_nvs_param_map[NVS_KEY_WIFI_ENABLE] = false;
-        app->setNvsParam(NVS_KEY_WIFI_ENABLE, 0);
+        settings_store_set(SETTINGS_KEY_WIFI_ENABLE, 0);
         if (app->_screen_index == UI_WIFI_SCAN_INDEX) {
             app->stopWifiScan();
             if (xEventGroupGetBits(s_wifi_event_group) & WIFI_EVENT_CONNECTED) {
@@ -1005,11 +1246,9 @@ void AppSettings::onSwitchPanelScreenSettingBLESwitchValueChangeEventCallback( l
     ESP_BROOKESIA_CHECK_NULL_GOTO(app, end, "Invalid app pointer");
 
     if (state & LV_STATE_CHECKED) {
-        app->_nvs_param_map[NVS_KEY_WIFI_ENABLE] = true;
-        app->setNvsParam(NVS_KEY_BLE_ENABLE, 1);
+        settings_store_set(SETTINGS_KEY_BLE_ENABLE, 1);
     } else {
-        app->_nvs_param_map[NVS_KEY_WIFI_ENABLE] = false;
-        app->setNvsParam(NVS_KEY_BLE_ENABLE, 0);
+        settings_store_set(SETTINGS_KEY_BLE_ENABLE, 0);
     }
 
 end:
@@ -1022,14 +1261,14 @@ void AppSettings::onSliderPanelVolumeSwitchValueChangeEventCallback( lv_event_t
     AppSettings *app = (AppSettings *)lv_event_get_user_data(e);
     ESP_BROOKESIA_CHECK_NULL_GOTO(app, end, "Invalid app pointer");
 
-    if (volume != app->_nvs_param_map[NVS_KEY_AUDIO_VOLUME]) {
+    if (volume != settings_store_get(SETTINGS_KEY_AUDIO_VOLUME)) {
         if ((bsp_extra_codec_volume_set(volume, NULL) != ESP_OK) && (bsp_extra_codec_volume_get() != volume)) {
             ESP_LOGE(TAG, "Set volume failed");
-            lv_slider_set_value(ui_SliderPanelScreenSettingVolumeSwitch, app->_nvs_param_map[NVS_KEY_AUDIO_VOLUME], LV_ANIM_OFF);
+            lv_slider_set_value(ui_SliderPanelScreenSettingVolumeSwitch, settings_store_get(SETTINGS_KEY_AUDIO_VOLUME), LV_ANIM_OFF);
             return;
         }
-        app->_nvs_param_map[NVS_KEY_AUDIO_VOLUME] = volume;
-        app->setNvsParam(NVS_KEY_AUDIO_VOLUME, volume);
+        // Written to NVS once the slider stops moving
+        settings_store_set(SETTINGS_KEY_AUDIO_VOLUME, volume);
     }
 
 end:
@@ -1042,15 +1281,14 @@ void AppSettings::onSliderPanelLightSwitchValueChangeEventCallback( lv_event_t *
     AppSettings *app = (AppSettings *)lv_event_get_user_data(e);
     ESP_BROOKESIA_CHECK_NULL_GOTO(app, end, "Invalid app pointer");
 
-    if (brightness != app->_nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS]) {
-        // if ((bsp_display_brightness_set(brightness) != ESP_OK) && (bsp_display_brightness_get() != brightness)) {
-        if (bsp_display_brightness_set(brightness) != ESP_OK) {
+    if (brightness != settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS)) {
+        if (backlight_set(brightness, SCREEN_BRIGHTNESS_FADE_MS) != ESP_OK) {
             ESP_LOGE(TAG, "Set brightness failed");
-            lv_slider_set_value(ui_SliderPanelScreenSettingLightSwitch1, app->_nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS], LV_ANIM_OFF);
+            lv_slider_set_value(ui_SliderPanelScreenSettingLightSwitch1, settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS), LV_ANIM_OFF);
             return;
         }
-        app->_nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS] = brightness;
-        app->setNvsParam(NVS_KEY_DISPLAY_BRIGHTNESS, brightness);
+        // Written to NVS once the slider stops moving
+        settings_store_set(SETTINGS_KEY_DISPLAY_BRIGHTNESS, brightness);
     }
 
 end:
@@ -1076,13 +1314,9 @@ void AppSettings::onScreenTimeoutDropdownValueChangeEventCallback( lv_event_t *
         default: timeout_value = SCREEN_TIMEOUT_DEFAULT; break;
     }
     
-    if (timeout_value != app->_nvs_param_map[NVS_KEY_SCREEN_TIMEOUT]) {
-        app->_nvs_param_map[NVS_KEY_SCREEN_TIMEOUT] = timeout_value;
-        app->setNvsParam(NVS_KEY_SCREEN_TIMEOUT, timeout_value);
-        
-        // Update global screen saver timeout
-        GlobalScreenSaver& screenSaver = GlobalScreenSaver::getInstance();
-        screenSaver.setTimeoutSeconds(timeout_value);
+    if (timeout_value != settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT)) {
+        // The global screen saver applies it from the change notification
+        settings_store_set(SETTINGS_KEY_SCREEN_TIMEOUT, timeout_value);
         
         ESP_LOGI(SAVER_TAG, "Screen timeout set to: %d seconds", timeout_value);
     }
@@ -1111,11 +1345,11 @@ void AppSettings::initScreenSaverTimer(void) {
     
     startScreenSaverTimer();
     
-    ESP_LOGI(SAVER_TAG, "Screen saver initialized with global touch events and %d second timeout", _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT]);
+    ESP_LOGI(SAVER_TAG, "Screen saver initialized with global touch events and %d second timeout", settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT));
 }
 
 void AppSettings::startScreenSaverTimer(void) {
-    int32_t timeout_seconds = _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT];
+    int32_t timeout_seconds = settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT);
     
     // If timeout is NEVER (0), don't start timer
     if (timeout_seconds <= 0) {
@@ -1152,7 +1386,7 @@ void AppSettings::resetScreenSaverTimer(void) {
     if (!_screen_is_off) {
         stopScreenSaverTimer();
         startScreenSaverTimer();
-        ESP_LOGI(SAVER_TAG, "Screen saver timer reset - %d seconds countdown restarted", _nvs_param_map[NVS_KEY_SCREEN_TIMEOUT]);
+        ESP_LOGI(SAVER_TAG, "Screen saver timer reset - %d seconds countdown restarted", settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT));
     }
 }
 
@@ -1199,8 +1433,8 @@ void AppSettings::globalActivityEventCallback(lv_event_t * e) {
 
 void AppSettings::turnOffScreen(void) {
     if (!_screen_is_off) {
-        _saved_brightness = _nvs_param_map[NVS_KEY_DISPLAY_BRIGHTNESS];
-        bsp_display_brightness_set(0);
+        _saved_brightness = settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS);
+        backlight_set(0, SCREEN_BRIGHTNESS_FADE_MS);
         _screen_is_off = true;
         ESP_LOGI(SAVER_TAG, "Screen turned off");
     }
@@ -1208,7 +1442,7 @@ void AppSettings::turnOffScreen(void) {
 
 void AppSettings::turnOnScreen(void) {
     if (_screen_is_off) {
-        bsp_display_brightness_set(_saved_brightness);
+        backlight_set(_saved_brightness, SCREEN_BRIGHTNESS_FADE_MS);
         _screen_is_off = false;
         ESP_LOGI(SAVER_TAG, "Screen turned on with brightness %d", _saved_brightness);
         
@@ -72,20 +72,27 @@ private:
     void initWifiListButton(lv_obj_t* lv_label_ssid, lv_obj_t* lv_img_wifi_lock, lv_obj_t* lv_wifi_img,
                               lv_obj_t *lv_wifi_connect, uint8_t* ssid, bool psk, WifiSignalStrengthLevel_t signal_strength);
     void deinitWifiListButton(void);
+    void createWifiListRows(void);
+    void refreshWifiList(void);     // Binds the rows in view to their entries of the last scan
     // NVS Parameters
-    bool loadNvsParam(void);
-    bool setNvsParam(std::string key, int value);
     void updateUiByNvsParam(void);
     // WiFi
     esp_err_t initWifi(void);
     void startWifiScan(void);
     void stopWifiScan(void);
-    void scanWifiAndUpdateUi(void);
+    static WifiSignalStrengthLevel_t getWifiSignalStrengthLevel(int rssi);
+    bool connectToCachedAp(void);
+    static void saveConnectedAp(void);
+    bool startWifiScanAsync(void);
+    void updateWifiScanCache(void);
+    static void onUiWifiScanUpdated(const void *data, void *user_data);
     // Smart Gadget
     // void updateGadgetTime(struct tm timeinfo);
 
     /* Task */
-    static void euiRefresTask(void *arg);
+    static void onHomeRefreshTimer(lv_timer_t *timer);
+    static void onSntpSynced(void *user_data);
+    static void onUiClockSynced(const void *data, void *user_data);
     static void wifiScanTask(void *arg);
     static void wifiConnectTask(void *arg);
     static void screenSaverTask(void *arg);
@@ -100,6 +107,7 @@ private:
     // WiFi
     static void onSwitchPanelScreenSettingWiFiSwitchValueChangeEventCallback( lv_event_t * e);
     static void onButtonWifiListClickedEventCallback(lv_event_t * e);
+    static void onWifiListScrollEventCallback(lv_event_t *e);
     static void onKeyboardScreenSettingVerificationClickedEventCallback(lv_event_t *e);
     // Bluetooth
     static void onSwitchPanelScreenSettingBLESwitchValueChangeEventCallback( lv_event_t * e);
@@ -125,7 +133,7 @@ private:
     int32_t _saved_brightness;
     esp_timer_handle_t _screen_saver_timer;
     bool _screen_saver_timer_started;
-    std::map<std::string, int32_t> _nvs_param_map;
     const ESP_Brookesia_StatusBar *status_bar; 
     const ESP_Brookesia_RecentsScreen *backstage;
+    uint32_t _memory_label_seq;     // `seq` of the heap stats shown by the backstage memory label
 };
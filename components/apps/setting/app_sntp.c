@@ -15,17 +15,60 @@
 #include "esp_attr.h"
 #include "esp_sleep.h"
 #include "esp_sntp.h"
+#include "esp_timer.h"
+#include "nvs.h"
 
 #define TIMEZONE        "CST-8"
 #define SERVER_NAME_0   "ntp.aliyun.com"
 #define SERVER_NAME_1   "time.asia.apple.com"
 #define SERVER_NAME_2   "pool.ntp.org"
 
+#define RESYNC_INTERVAL_S   (6 * 3600)      /* A time synchronized less than this ago is not synchronized again */
+#define TIME_VALID_MIN      (1700000000)    /* System time before this was never set */
+#define NVS_NAMESPACE       "sntp"
+#define NVS_KEY_LAST_SYNC   "last_sync"
+
 static const char *TAG = "sntp";
 
-static void obtain_time(void);
 static void initialize_sntp(void);
 
+static app_sntp_sync_cb_t s_sync_cb = NULL;
+static void *s_sync_cb_user_data = NULL;
+static esp_timer_handle_t s_stop_timer = NULL;
+
+static int64_t load_last_sync(void)
+{
+    nvs_handle_t handle;
+    int64_t last_sync = 0;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_i64(handle, NVS_KEY_LAST_SYNC, &last_sync);
+        nvs_close(handle);
+    }
+
+    return last_sync;
+}
+
+static void save_last_sync(int64_t last_sync)
+{
+    nvs_handle_t handle;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_i64(handle, NVS_KEY_LAST_SYNC, last_sync) == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+}
+
+static void stop_timer_cb(void *arg)
+{
+    // One synchronization per connection is enough, the RTC keeps the time in between
+    ESP_LOGI(TAG, "Stop SNTP");
+    esp_sntp_stop();
+}
+
 #ifdef CONFIG_SNTP_TIME_SYNC_METHOD_CUSTOM
 void sntp_sync_time(struct timeval *tv)
 {
@@ -39,88 +82,60 @@ static void time_sync_notification_cb(struct timeval *tv)
 {
     ESP_LOGI(TAG, "Notification of a time synchronization event, sec=%lu", tv->tv_sec);
     settimeofday(tv, NULL);
+    save_last_sync(tv->tv_sec);
+    // Not stopped from here, this runs in the lwIP task that esp_sntp_stop() waits for
+    if (s_stop_timer != NULL) {
+        esp_timer_start_once(s_stop_timer, 0);
+    }
+
+    if (s_sync_cb != NULL) {
+        s_sync_cb(s_sync_cb_user_data);
+    }
 }
 
-void app_sntp_init(void)
+void app_sntp_start(app_sntp_sync_cb_t sync_cb, void *user_data)
 {
     static bool sntp_initialized = false;
-    time_t now;
-    struct tm timeinfo;
 
-    if (sntp_initialized) {
-        return;
-    }
+    s_sync_cb = sync_cb;
+    s_sync_cb_user_data = user_data;
 
-    time(&now);
-    localtime_r(&now, &timeinfo);
-
-    // Set timezone to China Standard Time
-    setenv("TZ", "CST-8", 1);
-    tzset();
-    // Is time set? If not, tm_year will be (1970 - 1900).
-    if (timeinfo.tm_year < (2016 - 1900)) {
-        ESP_LOGI(TAG, "Time is not set yet. Connecting to WiFi and getting time over NTP.");
-        obtain_time();
-        // update 'now' variable with current time
-        time(&now);
-    }
-#ifdef CONFIG_SNTP_TIME_SYNC_METHOD_SMOOTH
-    else {
-        // add 500 ms error to the current system time.
-        // Only to demonstrate a work of adjusting method!
-        {
-            ESP_LOGI(TAG, "Add a error for test adjtime");
-            struct timeval tv_now;
-            gettimeofday(&tv_now, NULL);
-            int64_t cpu_time = (int64_t)tv_now.tv_sec * 1000000L + (int64_t)tv_now.tv_usec;
-            int64_t error_time = cpu_time + 500 * 1000L;
-            struct timeval tv_error = {.tv_sec = error_time / 1000000L, .tv_usec = error_time % 1000000L};
-            settimeofday(&tv_error, NULL);
-        }
+    if (!sntp_initialized) {
+        // Set timezone to China Standard Time
+        setenv("TZ", TIMEZONE, 1);
+        tzset();
 
-        ESP_LOGI(TAG, "Time was set, now just adjusting it. Use SMOOTH SYNC method.");
-        obtain_time();
-        // update 'now' variable with current time
-        time(&now);
+        const esp_timer_create_args_t timer_args = {
+            .callback = stop_timer_cb,
+            .name = "sntp_stop",
+        };
+        if (esp_timer_create(&timer_args, &s_stop_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "Create stop timer failed, SNTP keeps polling");
+        }
     }
-#endif
 
-    char strftime_buf[64];
-    localtime_r(&now, &timeinfo);
-    strftime(strftime_buf, sizeof(strftime_buf), "%c", &timeinfo);
-    ESP_LOGI(TAG, "The current date/time in Shanghai is: %s", strftime_buf);
-
-    if (sntp_get_sync_mode() == SNTP_SYNC_MODE_SMOOTH) {
-        struct timeval outdelta;
-        while (sntp_get_sync_status() == SNTP_SYNC_STATUS_IN_PROGRESS) {
-            adjtime(NULL, &outdelta);
-            ESP_LOGI(TAG, "Waiting for adjusting time ... outdelta = %li sec: %li ms: %li us",
-                     (long)outdelta.tv_sec,
-                     outdelta.tv_usec / 1000,
-                     outdelta.tv_usec % 1000);
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
+    // The system time survives a software reset, a recent synchronization is still good
+    time_t now = time(NULL);
+    int64_t last_sync = load_last_sync();
+    if ((now >= TIME_VALID_MIN) && (last_sync > 0) && (now >= last_sync) && ((now - last_sync) < RESYNC_INTERVAL_S)) {
+        ESP_LOGI(TAG, "Time synchronized %d s ago, skip", (int)(now - last_sync));
+        if (s_sync_cb != NULL) {
+            s_sync_cb(s_sync_cb_user_data);
         }
+        return;
     }
 
-    sntp_initialized = true;
-}
-
-static void obtain_time(void)
-{
-    initialize_sntp();
-
-    // wait for time to be set
-    time_t now = 0;
-    struct tm timeinfo = {0};
-    int retry = 0;
-    const int retry_count = 10;
-
-    while (sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++retry < retry_count) {
-        ESP_LOGI(TAG, "Waiting for system time to be set... (%d/%d)", retry, retry_count);
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
+    if (!sntp_initialized) {
+        initialize_sntp();
+        sntp_initialized = true;
+    } else if (esp_sntp_enabled()) {
+        // Synchronize once more for the new connection, the result comes through the notification
+        ESP_LOGI(TAG, "Restart SNTP");
+        esp_sntp_restart();
+    } else {
+        ESP_LOGI(TAG, "Start SNTP");
+        esp_sntp_init();
     }
-    time(&now);
-    localtime_r(&now, &timeinfo);
 }
 
 static void initialize_sntp(void)
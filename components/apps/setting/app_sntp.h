@@ -11,7 +11,17 @@
 extern "C" {
 #endif
 
-void app_sntp_init(void);
+typedef void (*app_sntp_sync_cb_t)(void *user_data);
+
+/**
+ * @brief Start a time synchronization, call it once each time the network is connected
+ *
+ * The first call sets the timezone. The SNTP service is started for one synchronization and stopped once the time is
+ * set, the time of the last synchronization is saved in NVS. As the system time survives a software reset, a
+ * synchronization less than 6 hours old is kept and `sync_cb` is called right away instead.
+ * It does not wait for the result, `sync_cb` is called from the SNTP task every time the system time is set.
+ */
+void app_sntp_start(app_sntp_sync_cb_t sync_cb, void *user_data);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "nvs.h"
+#include "app_wifi_cache.h"
+
+#define CACHE_NAMESPACE     "wifi_cache"
+#define CACHE_KEY           "last_ap"
+
+static const char *TAG = "wifi_cache";
+
+esp_err_t app_wifi_cache_load(app_wifi_cache_ap_t *ap)
+{
+    esp_err_t ret = ESP_OK;
+    nvs_handle_t handle = 0;
+    size_t size = sizeof(*ap);
+
+    ESP_RETURN_ON_FALSE(ap, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    ret = nvs_open(CACHE_NAMESPACE, NVS_READONLY, &handle);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "Open NVS failed");
+
+    ret = nvs_get_blob(handle, CACHE_KEY, ap, &size);
+    nvs_close(handle);
+    if ((ret == ESP_ERR_NVS_NOT_FOUND) || ((ret == ESP_OK) && ((size != sizeof(*ap)) || (ap->ssid[0] == '\0')))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "Read AP failed");
+
+    // Saved by an older layout or damaged, never use it unterminated
+    ap->ssid[sizeof(ap->ssid) - 1] = '\0';
+    ap->password[sizeof(ap->password) - 1] = '\0';
+
+    return ESP_OK;
+}
+
+esp_err_t app_wifi_cache_save(const app_wifi_cache_ap_t *ap)
+{
+    esp_err_t ret = ESP_OK;
+    nvs_handle_t handle = 0;
+    app_wifi_cache_ap_t saved = { 0 };
+
+    ESP_RETURN_ON_FALSE(ap && (ap->ssid[0] != '\0'), ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    // Reconnecting to the same AP is the usual case, it must not wear the flash
+    if ((app_wifi_cache_load(&saved) == ESP_OK) && (memcmp(&saved, ap, sizeof(saved)) == 0)) {
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle), TAG, "Open NVS failed");
+    ESP_GOTO_ON_ERROR(nvs_set_blob(handle, CACHE_KEY, ap, sizeof(*ap)), end, TAG, "Write AP failed");
+    ESP_GOTO_ON_ERROR(nvs_commit(handle), end, TAG, "Commit NVS failed");
+    ESP_LOGI(TAG, "Saved %s, channel %d", ap->ssid, ap->channel);
+
+end:
+    nvs_close(handle);
+
+    return ret;
+}
+
+void app_wifi_cache_clear(void)
+{
+    nvs_handle_t handle = 0;
+
+    if (nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_erase_key(handle, CACHE_KEY) == ESP_OK) {
+        nvs_commit(handle);
+    }
+    nvs_close(handle);
+}
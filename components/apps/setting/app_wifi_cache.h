@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#ifndef _APP_WIFI_CACHE_H_
+#define _APP_WIFI_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Last AP the station connected to
+ */
+typedef struct {
+    char ssid[33];
+    char password[65];
+    uint8_t bssid[6];
+    uint8_t channel;
+} app_wifi_cache_ap_t;
+
+/**
+ * @brief Load the last AP from NVS
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if nothing is saved, or an error code on failure.
+ */
+esp_err_t app_wifi_cache_load(app_wifi_cache_ap_t *ap);
+
+/**
+ * @brief Save the AP the station just connected to, NVS is only written if it changed
+ *
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t app_wifi_cache_save(const app_wifi_cache_ap_t *ap);
+
+/**
+ * @brief Forget the saved AP, e.g. after its password was refused
+ */
+void app_wifi_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_bit_defs.h"
+#include "nvs.h"
+#include "settings_store.h"
+
+#define STORE_NAMESPACE             "storage"
+#define STORE_CALLBACK_NUM          (4)
+
+typedef struct {
+    const char *name;
+    int32_t default_value;
+} store_key_desc_t;
+
+typedef struct {
+    settings_store_change_cb_t cb;
+    void *user_ctx;
+} store_callback_t;
+
+static const char *TAG = "settings_store";
+
+/* The NVS key names are the ones the Setting app always used, the saved values stay valid */
+static const store_key_desc_t store_keys[SETTINGS_KEY_MAX] = {
+    [SETTINGS_KEY_WIFI_ENABLE]          = { "wifi_en",      0 },
+    [SETTINGS_KEY_BLE_ENABLE]           = { "ble_en",       0 },
+    [SETTINGS_KEY_AUDIO_VOLUME]         = { "volume",       50 },
+    [SETTINGS_KEY_DISPLAY_BRIGHTNESS]   = { "brightness",   20 },
+    [SETTINGS_KEY_SCREEN_TIMEOUT]       = { "scr_timeout",  60 },
+    // Defaults are set by the camera app, which knows what its build needs
+    [SETTINGS_KEY_CAMERA_BUF_NUM]       = { "cam_buf_num",  0 },
+    [SETTINGS_KEY_CAMERA_BUF_MODE]      = { "cam_buf_mode", 0 },
+    [SETTINGS_KEY_DISPLAY_THEME]        = { "theme",        0 },
+    [SETTINGS_KEY_MUSIC_EQ_PRESET]      = { "eq_preset",    0 },
+    [SETTINGS_KEY_MUSIC_EQ_CUSTOM]      = { "eq_custom",    0 },
+};
+
+static int32_t store_values[SETTINGS_KEY_MAX];
+static uint32_t store_set_mask = 0;         /* Keys loaded from NVS or set since boot */
+static uint32_t store_dirty_mask = 0;       /* Keys changed since the last commit */
+static bool store_defaults_loaded = false;
+static store_callback_t store_callbacks[STORE_CALLBACK_NUM];
+static portMUX_TYPE store_spinlock = portMUX_INITIALIZER_UNLOCKED;     /* Guards everything above */
+static esp_timer_handle_t store_commit_timer = NULL;
+static SemaphoreHandle_t store_commit_lock = NULL;     /* Serializes the commits of the timer and of flush */
+
+/* Called with the spinlock held */
+static void store_load_defaults(void)
+{
+    if (store_defaults_loaded) {
+        return;
+    }
+    for (int i = 0; i < SETTINGS_KEY_MAX; i++) {
+        store_values[i] = store_keys[i].default_value;
+    }
+    store_defaults_loaded = true;
+}
+
+static esp_err_t store_commit(void)
+{
+    esp_err_t ret = ESP_OK;
+    nvs_handle_t handle = 0;
+    int32_t values[SETTINGS_KEY_MAX];
+    uint32_t dirty = 0;
+
+    xSemaphoreTake(store_commit_lock, portMAX_DELAY);
+
+    portENTER_CRITICAL(&store_spinlock);
+    dirty = store_dirty_mask;
+    store_dirty_mask = 0;
+    memcpy(values, store_values, sizeof(values));
+    portEXIT_CRITICAL(&store_spinlock);
+
+    if (dirty == 0) {
+        goto end;
+    }
+
+    ESP_GOTO_ON_ERROR(nvs_open(STORE_NAMESPACE, NVS_READWRITE, &handle), err, TAG, "Open NVS failed");
+    for (int i = 0; i < SETTINGS_KEY_MAX; i++) {
+        if (dirty & BIT(i)) {
+            ESP_GOTO_ON_ERROR(nvs_set_i32(handle, store_keys[i].name, values[i]), err, TAG, "Set %s failed",
+                              store_keys[i].name);
+        }
+    }
+    ESP_GOTO_ON_ERROR(nvs_commit(handle), err, TAG, "Commit NVS failed");
+    nvs_close(handle);
+    ESP_LOGD(TAG, "Committed 0x%" PRIx32, dirty);
+
+end:
+    xSemaphoreGive(store_commit_lock);
+
+    return ESP_OK;
+
+err:
+    if (handle) {
+        nvs_close(handle);
+    }
+    // Kept pending, written with the next change or flush
+    portENTER_CRITICAL(&store_spinlock);
+    store_dirty_mask |= dirty;
+    portEXIT_CRITICAL(&store_spinlock);
+    xSemaphoreGive(store_commit_lock);
+
+    return ret;
+}
+
+static void store_commit_timer_cb(void *arg)
+{
+    store_commit();
+}
+
+esp_err_t settings_store_init(void)
+{
+    esp_err_t ret = ESP_OK;
+    nvs_handle_t handle = 0;
+
+    ESP_RETURN_ON_FALSE(store_commit_timer == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+
+    store_commit_lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(store_commit_lock, ESP_ERR_NO_MEM, TAG, "Create lock failed");
+    const esp_timer_create_args_t timer_args = {
+        .callback = store_commit_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "settings_commit",
+    };
+    ESP_GOTO_ON_ERROR(esp_timer_create(&timer_args, &store_commit_timer), err, TAG, "Create timer failed");
+
+    portENTER_CRITICAL(&store_spinlock);
+    store_load_defaults();
+    portEXIT_CRITICAL(&store_spinlock);
+
+    if (nvs_open(STORE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        // The namespace is created by the first commit
+        ESP_LOGW(TAG, "No saved settings, use defaults");
+        return ESP_OK;
+    }
+    for (int i = 0; i < SETTINGS_KEY_MAX; i++) {
+        int32_t value = 0;
+        if (nvs_get_i32(handle, store_keys[i].name, &value) == ESP_OK) {
+            portENTER_CRITICAL(&store_spinlock);
+            store_values[i] = value;
+            store_set_mask |= BIT(i);
+            portEXIT_CRITICAL(&store_spinlock);
+            ESP_LOGI(TAG, "Load %s: %" PRId32, store_keys[i].name, value);
+        }
+    }
+    nvs_close(handle);
+
+    return ESP_OK;
+
+err:
+    vSemaphoreDelete(store_commit_lock);
+    store_commit_lock = NULL;
+
+    return ret;
+}
+
+int32_t settings_store_get(settings_key_t key)
+{
+    int32_t value = 0;
+
+    if ((unsigned)key >= SETTINGS_KEY_MAX) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&store_spinlock);
+    store_load_defaults();
+    value = store_values[key];
+    portEXIT_CRITICAL(&store_spinlock);
+
+    return value;
+}
+
+bool settings_store_is_set(settings_key_t key)
+{
+    bool is_set = false;
+
+    if ((unsigned)key >= SETTINGS_KEY_MAX) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&store_spinlock);
+    is_set = (store_set_mask & BIT(key)) != 0;
+    portEXIT_CRITICAL(&store_spinlock);
+
+    return is_set;
+}
+
+esp_err_t settings_store_set_default(settings_key_t key, int32_t value)
+{
+    ESP_RETURN_ON_FALSE((unsigned)key < SETTINGS_KEY_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid key");
+
+    portENTER_CRITICAL(&store_spinlock);
+    store_load_defaults();
+    if ((store_set_mask & BIT(key)) == 0) {
+        store_values[key] = value;
+    }
+    portEXIT_CRITICAL(&store_spinlock);
+
+    return ESP_OK;
+}
+
+esp_err_t settings_store_set(settings_key_t key, int32_t value)
+{
+    store_callback_t callbacks[STORE_CALLBACK_NUM];
+    bool changed = false;
+
+    ESP_RETURN_ON_FALSE((unsigned)key < SETTINGS_KEY_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid key");
+
+    portENTER_CRITICAL(&store_spinlock);
+    store_load_defaults();
+    changed = (store_values[key] != value) || ((store_set_mask & BIT(key)) == 0);
+    if (changed) {
+        store_values[key] = value;
+        store_set_mask |= BIT(key);
+        store_dirty_mask |= BIT(key);
+    }
+    memcpy(callbacks, store_callbacks, sizeof(callbacks));
+    portEXIT_CRITICAL(&store_spinlock);
+
+    if (!changed) {
+        return ESP_OK;
+    }
+
+    // Restart the delay, only the last of a burst of changes commits
+    if (store_commit_timer) {
+        esp_timer_stop(store_commit_timer);
+        esp_timer_start_once(store_commit_timer, SETTINGS_STORE_COMMIT_DELAY_MS * 1000);
+    }
+
+    for (int i = 0; i < STORE_CALLBACK_NUM; i++) {
+        if (callbacks[i].cb) {
+            callbacks[i].cb(key, value, callbacks[i].user_ctx);
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t settings_store_flush(void)
+{
+    ESP_RETURN_ON_FALSE(store_commit_timer, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    esp_timer_stop(store_commit_timer);
+
+    return store_commit();
+}
+
+esp_err_t settings_store_register_callback(settings_store_change_cb_t cb, void *user_ctx)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    ESP_RETURN_ON_FALSE(cb, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&store_spinlock);
+    for (int i = 0; i < STORE_CALLBACK_NUM; i++) {
+        if (store_callbacks[i].cb == NULL) {
+            store_callbacks[i].cb = cb;
+            store_callbacks[i].user_ctx = user_ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&store_spinlock);
+    ESP_RETURN_ON_ERROR(ret, TAG, "No free callback slot");
+
+    return ESP_OK;
+}
+
+void settings_store_unregister_callback(settings_store_change_cb_t cb, void *user_ctx)
+{
+    portENTER_CRITICAL(&store_spinlock);
+    for (int i = 0; i < STORE_CALLBACK_NUM; i++) {
+        if ((store_callbacks[i].cb == cb) && (store_callbacks[i].user_ctx == user_ctx)) {
+            store_callbacks[i].cb = NULL;
+            store_callbacks[i].user_ctx = NULL;
+        }
+    }
+    portEXIT_CRITICAL(&store_spinlock);
+}
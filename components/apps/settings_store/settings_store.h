@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SETTINGS_STORE_COMMIT_DELAY_MS  (500)   /* Changes are written to NVS this long after the last one */
+
+/**
+ * @brief Settings shared by the apps, saved as i32 in the "storage" NVS namespace
+ */
+typedef enum {
+    SETTINGS_KEY_WIFI_ENABLE = 0,       /*!< "wifi_en", 0 or 1 */
+    SETTINGS_KEY_BLE_ENABLE,            /*!< "ble_en", 0 or 1 */
+    SETTINGS_KEY_AUDIO_VOLUME,          /*!< "volume", 0 to 100 */
+    SETTINGS_KEY_DISPLAY_BRIGHTNESS,    /*!< "brightness", percent */
+    SETTINGS_KEY_SCREEN_TIMEOUT,        /*!< "scr_timeout", seconds, 0 for never */
+    SETTINGS_KEY_CAMERA_BUF_NUM,        /*!< "cam_buf_num", V4L2 buffers of the camera, read when the camera starts */
+    SETTINGS_KEY_CAMERA_BUF_MODE,       /*!< "cam_buf_mode", app_video_buf_mode_t, read when the camera starts */
+    SETTINGS_KEY_DISPLAY_THEME,         /*!< "theme", 0 for dark, 1 for light */
+    SETTINGS_KEY_MUSIC_EQ_PRESET,       /*!< "eq_preset", music_eq_preset_t */
+    SETTINGS_KEY_MUSIC_EQ_CUSTOM,       /*!< "eq_custom", custom EQ gains in dB, 5 bit two's complement per band */
+    SETTINGS_KEY_MAX,
+} settings_key_t;
+
+/**
+ * @brief Change callback, called from the task that set the value, must not block
+ *
+ * @param key       Key that changed
+ * @param value     New value
+ * @param user_ctx  Context given at registration
+ */
+typedef void (*settings_store_change_cb_t)(settings_key_t key, int32_t value, void *user_ctx);
+
+/**
+ * @brief Load all the settings from NVS into RAM, must be called after `nvs_flash_init`
+ *
+ * Keys missing in NVS keep their default value until they are set.
+ *
+ * @return ESP_OK on success, or an error code on failure. The defaults are used on failure.
+ */
+esp_err_t settings_store_init(void);
+
+/**
+ * @brief Get a setting from RAM, can be called from any task
+ *
+ * @param key Key of the setting
+ *
+ * @return The value, 0 for an invalid key
+ */
+int32_t settings_store_get(settings_key_t key);
+
+/**
+ * @brief Check if a setting was loaded from NVS or set since boot
+ *
+ * @param key Key of the setting
+ */
+bool settings_store_is_set(settings_key_t key);
+
+/**
+ * @brief Change the default of a setting, used while it is not set. Does not notify nor write NVS
+ *
+ * @param key   Key of the setting
+ * @param value Default value
+ *
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG for an invalid key
+ */
+esp_err_t settings_store_set_default(settings_key_t key, int32_t value);
+
+/**
+ * @brief Set a setting, can be called from any task
+ *
+ * The value is updated in RAM and the callbacks are called right away. Changes are written to NVS in one commit
+ * `SETTINGS_STORE_COMMIT_DELAY_MS` after the last one, so dragging a slider only writes the flash once.
+ *
+ * @param key   Key of the setting
+ * @param value New value
+ *
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG for an invalid key
+ */
+esp_err_t settings_store_set(settings_key_t key, int32_t value);
+
+/**
+ * @brief Write the pending changes to NVS now, e.g. before a restart
+ *
+ * @return ESP_OK on success, or an error code on failure. The changes stay pending on failure.
+ */
+esp_err_t settings_store_flush(void);
+
+/**
+ * @brief Register a change callback
+ *
+ * @param cb        Callback
+ * @param user_ctx  Context passed to `cb`
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all the slots are used, or ESP_ERR_INVALID_ARG
+ */
+esp_err_t settings_store_register_callback(settings_store_change_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Unregister a change callback registered with the same `cb` and `user_ctx`
+ */
+void settings_store_unregister_callback(settings_store_change_cb_t cb, void *user_ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include "bsp/esp-bsp.h"
+#if CONFIG_STORAGE_FS_LITTLEFS
+#include "esp_littlefs.h"
+#else
+#include "esp_spiffs.h"
+#endif
+#include "storage_fs.h"
+
+#if CONFIG_STORAGE_FS_LITTLEFS
+#define STORAGE_FS_NAME             "littlefs"
+#else
+#define STORAGE_FS_NAME             "spiffs"
+#endif
+
+static const char *TAG = "storage_fs";
+
+static bool storage_mounted = false;
+static uint32_t storage_mount_us = 0;
+
+esp_err_t storage_fs_mount(void)
+{
+    esp_err_t ret = ESP_OK;
+    int64_t start = esp_timer_get_time();
+
+    ESP_RETURN_ON_FALSE(!storage_mounted, ESP_ERR_INVALID_STATE, TAG, "Already mounted");
+
+#if CONFIG_STORAGE_FS_LITTLEFS
+    const esp_vfs_littlefs_conf_t conf = {
+        .base_path = CONFIG_BSP_SPIFFS_MOUNT_POINT,
+        .partition_label = CONFIG_BSP_SPIFFS_PARTITION_LABEL,
+        .format_if_mount_failed = false,
+        .dont_mount = false,
+    };
+    ret = esp_vfs_littlefs_register(&conf);
+#else
+    ret = bsp_spiffs_mount();
+#endif
+    ESP_RETURN_ON_ERROR(ret, TAG, "Mount %s failed", STORAGE_FS_NAME);
+    storage_mount_us = esp_timer_get_time() - start;
+    storage_mounted = true;
+
+    storage_fs_info_t info;
+    if (storage_fs_get_info(&info) == ESP_OK) {
+        ESP_LOGI(TAG, "Mounted %s in %u ms, %u of %u KB used", info.fs_name, (unsigned)(info.mount_us / 1000),
+                 (unsigned)(info.used_bytes / 1024), (unsigned)(info.total_bytes / 1024));
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t storage_fs_get_info(storage_fs_info_t *info)
+{
+    esp_err_t ret = ESP_OK;
+    size_t total = 0;
+    size_t used = 0;
+
+    ESP_RETURN_ON_FALSE(info, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(storage_mounted, ESP_ERR_INVALID_STATE, TAG, "Not mounted");
+
+#if CONFIG_STORAGE_FS_LITTLEFS
+    ret = esp_littlefs_info(CONFIG_BSP_SPIFFS_PARTITION_LABEL, &total, &used);
+#else
+    ret = esp_spiffs_info(CONFIG_BSP_SPIFFS_PARTITION_LABEL, &total, &used);
+#endif
+    ESP_RETURN_ON_ERROR(ret, TAG, "Get info failed");
+    info->fs_name = STORAGE_FS_NAME;
+    info->mount_us = storage_mount_us;
+    info->total_bytes = total;
+    info->used_bytes = used;
+
+    return ESP_OK;
+}
+
+esp_err_t storage_fs_bench_read(const char *path, size_t block_size, int count, uint32_t *ret_kbps)
+{
+    esp_err_t ret = ESP_OK;
+    struct stat st;
+    uint8_t *buf = NULL;
+    int64_t elapsed = 0;
+
+    ESP_RETURN_ON_FALSE(path && (block_size > 0) && (count > 0) && ret_kbps, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+
+    int fd = open(path, O_RDONLY);
+    ESP_RETURN_ON_FALSE(fd >= 0, ESP_ERR_NOT_FOUND, TAG, "Open %s failed", path);
+    ESP_GOTO_ON_FALSE((fstat(fd, &st) == 0) && (st.st_size >= (off_t)block_size), ESP_ERR_INVALID_SIZE, end, TAG,
+                      "%s is smaller than a block", path);
+    buf = heap_caps_malloc(block_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ESP_GOTO_ON_FALSE(buf, ESP_ERR_NO_MEM, end, TAG, "Allocate buffer failed");
+
+    uint32_t block_num = st.st_size / block_size;
+    for (int i = 0; i < count; i++) {
+        off_t offset = (off_t)(esp_random() % block_num) * block_size;
+        int64_t start = esp_timer_get_time();
+        bool ok = (lseek(fd, offset, SEEK_SET) == offset) && (read(fd, buf, block_size) == (ssize_t)block_size);
+        elapsed += esp_timer_get_time() - start;
+        ESP_GOTO_ON_FALSE(ok, ESP_FAIL, end, TAG, "Read %s at %ld failed", path, (long)offset);
+    }
+    // Bytes per microsecond are MB/s
+    *ret_kbps = elapsed ? (uint32_t)((uint64_t)block_size * count * 1000 / elapsed) : 0;
+    ESP_LOGI(TAG, "%d random %u byte reads of %s at %u KB/s", count, (unsigned)block_size, path,
+             (unsigned)*ret_kbps);
+
+end:
+    heap_caps_free(buf);
+    close(fd);
+
+    return ret;
+}
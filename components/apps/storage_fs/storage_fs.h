@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief State of the storage partition
+ */
+typedef struct {
+    const char *fs_name;        /*!< "spiffs" or "littlefs" */
+    uint32_t mount_us;          /*!< Time the mount took */
+    size_t total_bytes;         /*!< Size usable by files */
+    size_t used_bytes;          /*!< Size used by files and metadata */
+} storage_fs_info_t;
+
+/**
+ * @brief Mount the storage partition at `BSP_SPIFFS_MOUNT_POINT` with the file system of `CONFIG_STORAGE_FS`.
+ *
+ * The partition is never formatted, so a partition flashed with the other file system fails to mount instead of
+ * losing its assets.
+ *
+ * @return ESP_OK on success, or the error of the file system.
+ */
+esp_err_t storage_fs_mount(void);
+
+/**
+ * @brief Get the state of the mounted partition.
+ *
+ * @param info Filled with the state.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not mounted, or the error of the file system.
+ */
+esp_err_t storage_fs_get_info(storage_fs_info_t *info);
+
+/**
+ * @brief Measure random reads of a file.
+ *
+ * @param path Path of the file.
+ * @param block_size Size of each read.
+ * @param count Number of reads, at offsets aligned to `block_size`.
+ * @param ret_kbps Filled with the throughput in KB/s.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the file is smaller than a block, or ESP_FAIL on read errors.
+ */
+esp_err_t storage_fs_bench_read(const char *path, size_t block_size, int count, uint32_t *ret_kbps);
+
+#ifdef __cplusplus
+}
+#endif
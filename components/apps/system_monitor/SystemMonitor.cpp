@@ -0,0 +1,293 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "esp_log.h"
+#include "SystemMonitor.hpp"
+
+#define CHART_POINTS            (60)
+#define CHART_HEIGHT_PCT        (30)
+#define TASK_ROWS               (12)
+#define TABLE_FONT              &lv_font_montserrat_14
+#define TITLE_FONT              &lv_font_montserrat_16
+
+using namespace std;
+
+static const char *TAG = "SystemMonitor";
+
+SystemMonitor::SystemMonitor():
+    ESP_Brookesia_PhoneApp("System Monitor", nullptr, true),
+    _timer(nullptr),
+    _cpu_chart(nullptr),
+    _cpu_series{},
+    _heap_chart(nullptr),
+    _heap_table(nullptr),
+    _task_table(nullptr),
+    _summary_label(nullptr),
+    _heaps{
+        {"Internal", HEAP_STATS_REGION_INTERNAL, nullptr},
+        {"DMA", HEAP_STATS_REGION_DMA, nullptr},
+        {"PSRAM", HEAP_STATS_REGION_PSRAM, nullptr},
+    },
+    _prev_total(0)
+{
+}
+
+SystemMonitor::~SystemMonitor()
+{
+}
+
+lv_obj_t *SystemMonitor::createChart(lv_obj_t *parent, const char *title)
+{
+    lv_obj_t *box = lv_obj_create(parent);
+    lv_obj_set_size(box, LV_PCT(50), LV_PCT(100));
+    lv_obj_set_style_pad_all(box, 4, 0);
+    lv_obj_set_flex_flow(box, LV_FLEX_FLOW_COLUMN);
+    lv_obj_clear_flag(box, LV_OBJ_FLAG_SCROLLABLE);
+
+    lv_obj_t *label = lv_label_create(box);
+    lv_obj_set_style_text_font(label, TITLE_FONT, 0);
+    lv_label_set_text(label, title);
+
+    lv_obj_t *chart = lv_chart_create(box);
+    lv_obj_set_width(chart, LV_PCT(100));
+    lv_obj_set_flex_grow(chart, 1);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(chart, CHART_POINTS);
+    // New samples overwrite the oldest point, the rest of the chart is not moved
+    lv_chart_set_update_mode(chart, LV_CHART_UPDATE_MODE_CIRCULAR);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, 100);
+    lv_chart_set_div_line_count(chart, 5, 0);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);
+
+    return chart;
+}
+
+bool SystemMonitor::run(void)
+{
+    lv_area_t area = getVisualArea();
+    lv_coord_t width = area.x2 - area.x1;
+    lv_obj_t *screen = lv_scr_act();
+
+    lv_obj_set_flex_flow(screen, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_style_pad_all(screen, 6, 0);
+    lv_obj_set_style_pad_row(screen, 6, 0);
+
+    lv_obj_t *charts = lv_obj_create(screen);
+    lv_obj_remove_style_all(charts);
+    lv_obj_set_size(charts, LV_PCT(100), LV_PCT(CHART_HEIGHT_PCT));
+    lv_obj_set_flex_flow(charts, LV_FLEX_FLOW_ROW);
+    lv_obj_set_style_pad_column(charts, 6, 0);
+
+    _cpu_chart = createChart(charts, "CPU load (%)");
+    _cpu_series[0] = lv_chart_add_series(_cpu_chart, lv_palette_main(LV_PALETTE_RED), LV_CHART_AXIS_PRIMARY_Y);
+#if CONFIG_FREERTOS_NUMBER_OF_CORES > 1
+    _cpu_series[1] = lv_chart_add_series(_cpu_chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+#endif
+    _heap_chart = createChart(charts, "Free heap (%)");
+    _heaps[0].series = lv_chart_add_series(_heap_chart, lv_palette_main(LV_PALETTE_GREEN), LV_CHART_AXIS_PRIMARY_Y);
+    _heaps[1].series = lv_chart_add_series(_heap_chart, lv_palette_main(LV_PALETTE_ORANGE), LV_CHART_AXIS_PRIMARY_Y);
+    _heaps[2].series = lv_chart_add_series(_heap_chart, lv_palette_main(LV_PALETTE_PURPLE), LV_CHART_AXIS_PRIMARY_Y);
+
+    _summary_label = lv_label_create(screen);
+    lv_obj_set_style_text_font(_summary_label, TITLE_FONT, 0);
+    lv_label_set_text(_summary_label, "Sampling...");
+
+    _heap_table = lv_table_create(screen);
+    lv_obj_set_width(_heap_table, LV_PCT(100));
+    lv_obj_set_style_text_font(_heap_table, TABLE_FONT, LV_PART_ITEMS);
+    lv_obj_set_style_pad_ver(_heap_table, 4, LV_PART_ITEMS);
+    lv_table_set_col_cnt(_heap_table, 5);
+    lv_table_set_row_cnt(_heap_table, 1 + sizeof(_heaps) / sizeof(_heaps[0]));
+    const char *heap_titles[] = {"Heap", "Free KB", "Min free KB", "Largest KB", "Fragmentation"};
+    for (int i = 0; i < 5; i++) {
+        lv_table_set_col_width(_heap_table, i, (width - 20) / 5);
+        lv_table_set_cell_value(_heap_table, 0, i, heap_titles[i]);
+    }
+
+    _task_table = lv_table_create(screen);
+    lv_obj_set_width(_task_table, LV_PCT(100));
+    lv_obj_set_flex_grow(_task_table, 1);
+    lv_obj_set_style_text_font(_task_table, TABLE_FONT, LV_PART_ITEMS);
+    lv_obj_set_style_pad_ver(_task_table, 4, LV_PART_ITEMS);
+    lv_table_set_col_cnt(_task_table, 5);
+    lv_table_set_row_cnt(_task_table, 1);
+    const char *task_titles[] = {"Task", "Core", "Priority", "CPU", "Stack free"};
+    lv_table_set_col_width(_task_table, 0, (width - 20) * 2 / 6);
+    lv_table_set_cell_value(_task_table, 0, 0, task_titles[0]);
+    for (int i = 1; i < 5; i++) {
+        lv_table_set_col_width(_task_table, i, (width - 20) / 6);
+        lv_table_set_cell_value(_task_table, 0, i, task_titles[i]);
+    }
+
+    _prev_samples.clear();
+    _prev_total = 0;
+    _timer = lv_timer_create(sample_timer_cb, CONFIG_SYSTEM_MONITOR_PERIOD_MS, this);
+    sample();
+
+    return true;
+}
+
+bool SystemMonitor::back(void)
+{
+    notifyCoreClosed();
+
+    return true;
+}
+
+bool SystemMonitor::close(void)
+{
+    if (_timer) {
+        lv_timer_del(_timer);
+        _timer = nullptr;
+    }
+    // The screen is deleted by the core
+    _cpu_chart = nullptr;
+    _heap_chart = nullptr;
+    _heap_table = nullptr;
+    _task_table = nullptr;
+    _summary_label = nullptr;
+    vector<task_sample_t>().swap(_prev_samples);
+    vector<TaskStatus_t>().swap(_tasks);
+
+    return true;
+}
+
+bool SystemMonitor::pause(void)
+{
+    if (_timer) {
+        lv_timer_pause(_timer);
+    }
+
+    return true;
+}
+
+bool SystemMonitor::resume(void)
+{
+    if (_timer) {
+        lv_timer_resume(_timer);
+    }
+
+    return true;
+}
+
+void SystemMonitor::sample(void)
+{
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    // Room for tasks created while the array is filled
+    UBaseType_t task_num = uxTaskGetNumberOfTasks() + 4;
+
+    _tasks.resize(task_num);
+    task_num = uxTaskGetSystemState(_tasks.data(), task_num, &total);
+    if (task_num == 0) {
+        ESP_LOGW(TAG, "Get system state failed");
+        return;
+    }
+
+    bool has_prev = !_prev_samples.empty();
+    updateTasks(_tasks.data(), task_num, has_prev ? (uint32_t)(total - _prev_total) : 0);
+    _prev_total = total;
+    updateHeaps();
+}
+
+void SystemMonitor::updateTasks(const TaskStatus_t *tasks, int task_num, uint32_t total_delta)
+{
+    vector<task_sample_t> samples(task_num);
+    vector<uint32_t> deltas(task_num, 0);
+    vector<int> order(task_num);
+    char buf[32];
+
+    for (int i = 0; i < task_num; i++) {
+        samples[i] = {tasks[i].xHandle, (uint32_t)tasks[i].ulRunTimeCounter};
+        auto it = lower_bound(_prev_samples.begin(), _prev_samples.end(), tasks[i].xHandle,
+        [](const task_sample_t &s, TaskHandle_t h) {
+            return s.handle < h;
+        });
+        // New tasks count from 0, they ran at most for the period
+        if ((it != _prev_samples.end()) && (it->handle == tasks[i].xHandle)) {
+            deltas[i] = samples[i].run_time - it->run_time;
+        }
+        order[i] = i;
+    }
+    sort(samples.begin(), samples.end(), [](const task_sample_t &a, const task_sample_t &b) {
+        return a.handle < b.handle;
+    });
+    _prev_samples.swap(samples);
+    if (total_delta == 0) {
+        return;
+    }
+
+    // The load of a core is what its idle task didn't get
+    int loads[CONFIG_FREERTOS_NUMBER_OF_CORES] = {};
+    for (int core = 0; core < CONFIG_FREERTOS_NUMBER_OF_CORES; core++) {
+        TaskHandle_t idle = xTaskGetIdleTaskHandleForCore(core);
+        for (int i = 0; i < task_num; i++) {
+            if (tasks[i].xHandle == idle) {
+                loads[core] = 100 - (int)LV_MIN((uint64_t)deltas[i] * 100 / total_delta, 100);
+                break;
+            }
+        }
+        lv_chart_set_next_value(_cpu_chart, _cpu_series[core], loads[core]);
+    }
+
+#if CONFIG_FREERTOS_NUMBER_OF_CORES > 1
+    lv_label_set_text_fmt(_summary_label, "%d tasks, CPU0 %d%%, CPU1 %d%%", task_num, loads[0], loads[1]);
+#else
+    lv_label_set_text_fmt(_summary_label, "%d tasks, CPU %d%%", task_num, loads[0]);
+#endif
+
+    // Busiest tasks first
+    sort(order.begin(), order.end(), [&deltas](int a, int b) {
+        return deltas[a] > deltas[b];
+    });
+    int rows = LV_MIN(task_num, TASK_ROWS);
+    lv_table_set_row_cnt(_task_table, 1 + rows);
+    for (int row = 0; row < rows; row++) {
+        const TaskStatus_t &task = tasks[order[row]];
+        uint32_t permille = (uint64_t)deltas[order[row]] * 1000 / total_delta;
+
+        lv_table_set_cell_value(_task_table, row + 1, 0, task.pcTaskName);
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        if (task.xCoreID == tskNO_AFFINITY) {
+            lv_table_set_cell_value(_task_table, row + 1, 1, "-");
+        } else {
+            lv_table_set_cell_value_fmt(_task_table, row + 1, 1, "%d", (int)task.xCoreID);
+        }
+#else
+        lv_table_set_cell_value(_task_table, row + 1, 1, "?");
+#endif
+        lv_table_set_cell_value_fmt(_task_table, row + 1, 2, "%u", (unsigned)task.uxCurrentPriority);
+        snprintf(buf, sizeof(buf), "%u.%u%%", (unsigned)(permille / 10), (unsigned)(permille % 10));
+        lv_table_set_cell_value(_task_table, row + 1, 3, buf);
+        // Stack sizes are in bytes on ESP-IDF
+        lv_table_set_cell_value_fmt(_task_table, row + 1, 4, "%u", (unsigned)task.usStackHighWaterMark);
+    }
+}
+
+void SystemMonitor::updateHeaps(void)
+{
+    heap_stats_t stats;
+
+    if (heap_stats_get(&stats) != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < (int)(sizeof(_heaps) / sizeof(_heaps[0])); i++) {
+        const heap_stats_info_t &info = stats.regions[_heaps[i].region];
+        int free_pct = info.total ? (int)((uint64_t)info.free * 100 / info.total) : 0;
+        // Share of the free memory that can't be allocated in one block
+        int frag_pct = info.free ? 100 - (int)((uint64_t)info.largest_free_block * 100 / info.free) : 0;
+
+        lv_chart_set_next_value(_heap_chart, _heaps[i].series, free_pct);
+        lv_table_set_cell_value(_heap_table, i + 1, 0, _heaps[i].name);
+        lv_table_set_cell_value_fmt(_heap_table, i + 1, 1, "%u", (unsigned)(info.free / 1024));
+        lv_table_set_cell_value_fmt(_heap_table, i + 1, 2, "%u", (unsigned)(info.minimum_free / 1024));
+        lv_table_set_cell_value_fmt(_heap_table, i + 1, 3, "%u", (unsigned)(info.largest_free_block / 1024));
+        lv_table_set_cell_value_fmt(_heap_table, i + 1, 4, "%d%%", frag_pct);
+    }
+}
+
+void SystemMonitor::sample_timer_cb(lv_timer_t *t)
+{
+    SystemMonitor *app = (SystemMonitor *)t->user_data;
+
+    app->sample();
+}
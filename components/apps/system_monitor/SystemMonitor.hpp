@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lvgl.h"
+#include "esp_brookesia.hpp"
+#include "heap_stats/heap_stats.h"
+
+/**
+ * @brief Live view of the CPU load and stack of every task and of the heaps, sampled once per
+ *        CONFIG_SYSTEM_MONITOR_PERIOD_MS from the FreeRTOS run time counters while the app is shown
+ */
+class SystemMonitor: public ESP_Brookesia_PhoneApp
+{
+public:
+    SystemMonitor();
+    ~SystemMonitor();
+
+    bool run(void) override;
+    bool back(void) override;
+    bool close(void) override;
+    bool pause(void) override;
+    bool resume(void) override;
+
+private:
+    typedef struct {
+        TaskHandle_t handle;
+        uint32_t run_time;
+    } task_sample_t;
+
+    typedef struct {
+        const char *name;
+        heap_stats_region_t region;
+        lv_chart_series_t *series;
+    } heap_row_t;
+
+    lv_obj_t *createChart(lv_obj_t *parent, const char *title);
+    void sample(void);
+    void updateTasks(const TaskStatus_t *tasks, int task_num, uint32_t total_delta);
+    void updateHeaps(void);
+
+    static void sample_timer_cb(lv_timer_t *t);
+
+    lv_timer_t *_timer;
+    lv_obj_t *_cpu_chart;
+    lv_chart_series_t *_cpu_series[CONFIG_FREERTOS_NUMBER_OF_CORES];
+    lv_obj_t *_heap_chart;
+    lv_obj_t *_heap_table;
+    lv_obj_t *_task_table;
+    lv_obj_t *_summary_label;
+    heap_row_t _heaps[3];
+    // Run time counters of the previous sample, sorted by handle
+    std::vector<task_sample_t> _prev_samples;
+    std::vector<TaskStatus_t> _tasks;
+    uint32_t _prev_total;
+};
@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/idf_additions.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "task_config.h"
+
+#define TASK_CAPS_DEFAULT   (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)     /* What xTaskCreate allocates from */
+#define NO_AFFINITY         tskNO_AFFINITY
+
+/* Picks the column of the selected `CONFIG_TASK_PROFILE` */
+#if CONFIG_TASK_PROFILE_VISION
+#define PROFILE(dflt, vision, instr)    (vision)
+#elif CONFIG_TASK_PROFILE_INSTRUMENTATION
+#define PROFILE(dflt, vision, instr)    (instr)
+#else
+#define PROFILE(dflt, vision, instr)    (dflt)
+#endif
+
+#define TASK_ENTRY(id, task_name, stack, prio, core, mem_caps) \
+    [id] = { .name = task_name, .stack_size = stack, .priority = prio, .core_id = core, .caps = mem_caps }
+
+static const char *TAG = "task_config";
+
+/* Columns of PROFILE() are the default, vision and instrumentation profiles */
+static const task_config_t task_configs[TASK_CONFIG_NUM] = {
+    /*         Task, name, stack size, priority, core, memory caps of the stack */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_INIT,             "Camera Init",          4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_DETECT,           "Camera Detect",        8 * 1024,   PROFILE(5, 6, 3),
+               PROFILE(1, 1, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_STREAM,           "video stream task",    4 * 1024,   PROFILE(3, 5, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_STILL,            "video still task",     4 * 1024,   PROFILE(3, 4, 3),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_CAPTURE,          "Camera Capture",       4 * 1024,   PROFILE(3, 4, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_RECORDER_ENCODE,  "Recorder Encode",      4 * 1024,   PROFILE(4, 5, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_RECORDER_WRITE,   "Recorder Write",       4 * 1024,   PROFILE(3, 4, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_CAMERA_UVC_ENCODE,       "UVC Encode",           4 * 1024,   PROFILE(4, 5, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    /* Only waits for the host to take each frame, the endpoint copies run in the TinyUSB task */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_UVC_SEND,         "UVC Send",             3 * 1024,   PROFILE(4, 5, 3),
+               PROFILE(0, 0, 1), TASK_CAPS_DEFAULT),
+    /* TinyUSB device task of the webcam, only placed through its config */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_UVC_TINYUSB,      "UVC TinyUSB",          4 * 1024,   PROFILE(5, 5, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* The detect task calling into MSR is on core 1 */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_FACE_MNP,         "Face MNP",             6 * 1024,   PROFILE(4, 5, 2),
+               PROFILE(0, 0, 0), TASK_CAPS_DEFAULT),
+    /* Only stops and restarts the stream between time-lapse shots */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_TIMELAPSE,        "Camera Timelapse",     3 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Only polls the SD card and parses the tuning file, the stream task applies it */
+    TASK_ENTRY(TASK_CONFIG_CAMERA_ISP_TUNING,       "Camera ISP Tuning",    4 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_JPEG_DECODE,             "JPEG Decode",          3 * 1024,   PROFILE(4, 5, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_IMAGE_CACHE,             "Image Cache",          4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(1, 1, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_IMAGE_THUMB,             "Image Thumb",          4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(1, 1, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_IMAGE_TILES,             "Image Tiles",          4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(1, 1, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_VIDEO_PLAYER,            "video task",           8 * 1024,   PROFILE(4, 4, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_VIDEO_DECODE,            "video decode",         4 * 1024,   PROFILE(4, 4, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_VIDEO_DISPLAY,           "video display",        4 * 1024,   PROFILE(4, 4, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Same as the player task, so the next track starts right away */
+    TASK_ENTRY(TASK_CONFIG_MUSIC_QUEUE,             "Music Queue",          4 * 1024,   PROFILE(5, 5, 5),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Below the player and the UI, the ring covers the delays */
+    TASK_ENTRY(TASK_CONFIG_MUSIC_SOURCE,            "Music Source",         4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_MUSIC_SPECTRUM,          "Music Spectrum",       4 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_MEDIA_INDEX,             "Media Index",          4 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_WIFI_SCAN,               "WiFi Scan",            6 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_WIFI_CONNECT,            "wifi Connect",         4 * 1024,   PROFILE(4, 4, 4),
+               PROFILE(0, 0, 0), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_GAME_2048_AI,            "2048_ai",              4 * 1024,
+               CONFIG_GAME_2048_AI_TASK_PRIORITY, CONFIG_GAME_2048_AI_TASK_CORE, TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_UART_RX,                 "uart_rx_task",         4 * 1024,   PROFILE(10, 8, 12),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    /* Only starts the receive of the next block, above the normal receive task */
+    TASK_ENTRY(TASK_CONFIG_UART_CAPTURE,            "uart_capture",         3 * 1024,   PROFILE(12, 8, 13),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    /* Extra UART TTL ports, just below the first one and on the other core in the instrument profile */
+    TASK_ENTRY(TASK_CONFIG_UART_RX_PORT2,           "uart_rx_p2",           4 * 1024,   PROFILE(9, 7, 11),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_UART_RX_PORT3,           "uart_rx_p3",           4 * 1024,   PROFILE(9, 7, 11),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 1), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_USB_HOST,                "usb_host_task",        4 * 1024,   PROFILE(5, 5, 10),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_USB_CDC_TX,              "cdc_tx_task",          4 * 1024,   PROFILE(4, 3, 8),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_USB_CDC_SCAN,            "cdc_scan_task",        4 * 1024,   PROFILE(4, 3, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_USB_CDC_HEARTBEAT,       "cdc_heartbeat",        4 * 1024,   PROFILE(3, 3, 3),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_SERIAL_BRIDGE,           "SerialBridge",         4 * 1024,   PROFILE(9, 5, 11),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_SERIAL_CAPTURE,          "SerialCapture",        4 * 1024,   PROFILE(4, 3, 5),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_SERIAL_SCRIPT,           "SerialScript",         4 * 1024,   PROFILE(6, 4, 7),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_POWER_UPDATE,            "PowerUpdate",          4 * 1024,   PROFILE(5, 3, 6),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    /* Above the UI and the Modbus worker */
+    TASK_ENTRY(TASK_CONFIG_POWER_PROFILE,           "PowerProfile",         3 * 1024,   PROFILE(6, 4, 9),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    /* Below the Modbus worker, the file system delays do not hold up the polling */
+    TASK_ENTRY(TASK_CONFIG_POWER_LOG,               "PowerLog",             4 * 1024,   PROFILE(3, 3, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    TASK_ENTRY(TASK_CONFIG_MODBUS_WORKER,           "ModbusWorker",         4 * 1024,   PROFILE(5, 3, 8),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, 0), TASK_CAPS_DEFAULT),
+    /* Below the Modbus worker, the network and the spool file do not hold up the polling */
+    TASK_ENTRY(TASK_CONFIG_POWER_MQTT,              "PowerMqtt",            4 * 1024,   PROFILE(2, 2, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Task of the esp-mqtt client, only placed through its config */
+    TASK_ENTRY(TASK_CONFIG_POWER_MQTT_CLIENT,       "mqtt_task",            6 * 1024,   PROFILE(2, 2, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Below the Modbus worker, a slow WebSocket client does not hold up the polling */
+    TASK_ENTRY(TASK_CONFIG_POWER_HTTP,              "PowerHttpPush",        4 * 1024,   PROFILE(2, 2, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Server task of esp_http_server, only placed through its config; formats the JSON replies */
+    TASK_ENTRY(TASK_CONFIG_POWER_HTTPD,             "PowerHttpd",           6 * 1024,   PROFILE(2, 2, 4),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Below the UI in all profiles, the update only uses idle time; TLS needs the larger stack */
+    TASK_ENTRY(TASK_CONFIG_OTA_UPDATE,              "OTA Update",           8 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Below the UI, a slow viewer lowers the mirror frame rate instead of the local one */
+    TASK_ENTRY(TASK_CONFIG_SCREEN_MIRROR,           "Screen Mirror",        4 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Server task of esp_http_server, only placed through its config; receives the remote touches */
+    TASK_ENTRY(TASK_CONFIG_SCREEN_MIRROR_HTTPD,     "Mirror HTTPD",         4 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Hands the SD card between the apps and the USB host, waits for the apps to close their files */
+    TASK_ENTRY(TASK_CONFIG_USB_MSC,                 "usb_msc",              3 * 1024,   PROFILE(2, 2, 2),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* TinyUSB device task, only placed through its config; reads and writes the card for the host, the media
+     * apps are closed meanwhile */
+    TASK_ENTRY(TASK_CONFIG_USB_MSC_TINYUSB,         "TinyUSB",              4 * 1024,   PROFILE(5, 5, 5),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Above the UI, so the injected touches keep their timing while the measured apps load the CPU */
+    TASK_ENTRY(TASK_CONFIG_PERF_RUNNER,             "perf_runner",          4 * 1024,   PROFILE(6, 6, 6),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Wakes once per sample, a sector erase only delays the next sample */
+    TASK_ENTRY(TASK_CONFIG_PERF_LOG,                "perf_log",             3 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Above the LVGL task, so a stalled UI is still reported while it hangs */
+    TASK_ENTRY(TASK_CONFIG_LVGL_WATCHDOG,           "lvgl_watchdog",        3 * 1024,   PROFILE(15, 15, 15),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Blends the bottom band of the big LVGL blends, on the core the LVGL task is not pinned to
+     * (`LVGL_DRAW_OFFLOAD_LVGL_CORE`); below the detection in the vision profile, which then keeps most bands */
+    TASK_ENTRY(TASK_CONFIG_LVGL_DRAW_OFFLOAD,       "lvgl_draw",            3 * 1024,   PROFILE(5, 5, 5),
+               PROFILE(1, 1, 1), TASK_CAPS_DEFAULT),
+    /* Above the music player, the first block of an effect is written right after the touch */
+    TASK_ENTRY(TASK_CONFIG_UI_SOUND,                "ui_sound",             3 * 1024,   PROFILE(6, 6, 6),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+    /* Below the UI; renders the snapshots with the LVGL lock held, so its stack is sized like the LVGL one */
+    TASK_ENTRY(TASK_CONFIG_SCREEN_CAPTURE,          "screen_capture",       8 * 1024,   PROFILE(1, 1, 1),
+               PROFILE(NO_AFFINITY, NO_AFFINITY, NO_AFFINITY), TASK_CAPS_DEFAULT),
+};
+
+const task_config_t *task_config_get(task_config_id_t id)
+{
+    if ((id < 0) || (id >= TASK_CONFIG_NUM)) {
+        return NULL;
+    }
+
+    return &task_configs[id];
+}
+
+BaseType_t task_config_create(task_config_id_t id, TaskFunction_t func, void *arg, TaskHandle_t *handle)
+{
+    const task_config_t *config = task_config_get(id);
+
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Invalid task %d", (int)id);
+        return pdFAIL;
+    }
+
+    return task_config_create_on_core(id, func, arg, handle, config->core_id);
+}
+
+BaseType_t task_config_create_on_core(task_config_id_t id, TaskFunction_t func, void *arg, TaskHandle_t *handle,
+                                      BaseType_t core_id)
+{
+    const task_config_t *config = task_config_get(id);
+    BaseType_t ret = pdFAIL;
+
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Invalid task %d", (int)id);
+        return pdFAIL;
+    }
+
+    if (config->caps == TASK_CAPS_DEFAULT) {
+        ret = xTaskCreatePinnedToCore(func, config->name, config->stack_size, arg, config->priority, handle, core_id);
+    } else {
+        ret = xTaskCreatePinnedToCoreWithCaps(func, config->name, config->stack_size, arg, config->priority, handle,
+                                              core_id, config->caps);
+    }
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Create %s failed, %u bytes of stack, largest free block %u", config->name,
+                 (unsigned)config->stack_size, (unsigned)heap_caps_get_largest_free_block(config->caps));
+    }
+
+    return ret;
+}
+
+void task_config_delete(task_config_id_t id, TaskHandle_t task)
+{
+    const task_config_t *config = task_config_get(id);
+
+    if ((config == NULL) || (config->caps == TASK_CAPS_DEFAULT)) {
+        vTaskDelete(task);
+    } else {
+        vTaskDeleteWithCaps(task);
+    }
+}
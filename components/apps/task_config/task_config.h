@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Tasks of the apps, one entry each in the task table
+ */
+typedef enum {
+    TASK_CONFIG_CAMERA_INIT,
+    TASK_CONFIG_CAMERA_DETECT,
+    TASK_CONFIG_CAMERA_STREAM,
+    TASK_CONFIG_CAMERA_STILL,
+    TASK_CONFIG_CAMERA_CAPTURE,
+    TASK_CONFIG_CAMERA_RECORDER_ENCODE,
+    TASK_CONFIG_CAMERA_RECORDER_WRITE,
+    TASK_CONFIG_CAMERA_UVC_ENCODE,
+    TASK_CONFIG_CAMERA_UVC_SEND,
+    TASK_CONFIG_CAMERA_UVC_TINYUSB,
+    TASK_CONFIG_CAMERA_FACE_MNP,
+    TASK_CONFIG_CAMERA_TIMELAPSE,
+    TASK_CONFIG_CAMERA_ISP_TUNING,
+    TASK_CONFIG_JPEG_DECODE,
+    TASK_CONFIG_IMAGE_CACHE,
+    TASK_CONFIG_IMAGE_THUMB,
+    TASK_CONFIG_IMAGE_TILES,
+    TASK_CONFIG_VIDEO_PLAYER,
+    TASK_CONFIG_VIDEO_DECODE,
+    TASK_CONFIG_VIDEO_DISPLAY,
+    TASK_CONFIG_MUSIC_QUEUE,
+    TASK_CONFIG_MUSIC_SOURCE,
+    TASK_CONFIG_MUSIC_SPECTRUM,
+    TASK_CONFIG_MEDIA_INDEX,
+    TASK_CONFIG_WIFI_SCAN,
+    TASK_CONFIG_WIFI_CONNECT,
+    TASK_CONFIG_GAME_2048_AI,
+    TASK_CONFIG_UART_RX,
+    TASK_CONFIG_UART_CAPTURE,
+    TASK_CONFIG_UART_RX_PORT2,
+    TASK_CONFIG_UART_RX_PORT3,
+    TASK_CONFIG_USB_HOST,
+    TASK_CONFIG_USB_CDC_TX,
+    TASK_CONFIG_USB_CDC_SCAN,
+    TASK_CONFIG_USB_CDC_HEARTBEAT,
+    TASK_CONFIG_SERIAL_BRIDGE,
+    TASK_CONFIG_SERIAL_CAPTURE,
+    TASK_CONFIG_SERIAL_SCRIPT,
+    TASK_CONFIG_POWER_UPDATE,
+    TASK_CONFIG_POWER_PROFILE,
+    TASK_CONFIG_POWER_LOG,
+    TASK_CONFIG_MODBUS_WORKER,
+    TASK_CONFIG_POWER_MQTT,
+    TASK_CONFIG_POWER_MQTT_CLIENT,
+    TASK_CONFIG_POWER_HTTP,
+    TASK_CONFIG_POWER_HTTPD,
+    TASK_CONFIG_OTA_UPDATE,
+    TASK_CONFIG_SCREEN_MIRROR,
+    TASK_CONFIG_SCREEN_MIRROR_HTTPD,
+    TASK_CONFIG_USB_MSC,
+    TASK_CONFIG_USB_MSC_TINYUSB,
+    TASK_CONFIG_PERF_RUNNER,
+    TASK_CONFIG_PERF_LOG,
+    TASK_CONFIG_LVGL_WATCHDOG,
+    TASK_CONFIG_LVGL_DRAW_OFFLOAD,
+    TASK_CONFIG_UI_SOUND,
+    TASK_CONFIG_SCREEN_CAPTURE,
+    TASK_CONFIG_NUM,
+} task_config_id_t;
+
+/**
+ * @brief Placement of a task
+ */
+typedef struct {
+    const char  *name;          /*!< Task name */
+    uint32_t    stack_size;     /*!< Stack size in bytes */
+    UBaseType_t priority;       /*!< Priority in the selected `CONFIG_TASK_PROFILE` */
+    BaseType_t  core_id;        /*!< Core in the selected `CONFIG_TASK_PROFILE`, or `tskNO_AFFINITY` */
+    uint32_t    caps;           /*!< Memory caps of the stack and the TCB */
+} task_config_t;
+
+/**
+ * @brief Get the placement of a task in the selected profile
+ *
+ * @param id Task
+ *
+ * @return The entry of the task table, or NULL if `id` is invalid
+ */
+const task_config_t *task_config_get(task_config_id_t id);
+
+/**
+ * @brief Create a task with the name, stack, priority, core and memory caps of its entry
+ *
+ * @param id        Task
+ * @param func      Task function
+ * @param arg       Argument of `func`
+ * @param handle    Filled with the task handle, can be NULL
+ *
+ * @return pdPASS on success, otherwise the error of the creation
+ */
+BaseType_t task_config_create(task_config_id_t id, TaskFunction_t func, void *arg, TaskHandle_t *handle);
+
+/**
+ * @brief Same as `task_config_create`, pinned to `core_id` instead of the core of the entry
+ */
+BaseType_t task_config_create_on_core(task_config_id_t id, TaskFunction_t func, void *arg, TaskHandle_t *handle,
+                                      BaseType_t core_id);
+
+/**
+ * @brief Delete a task created by `task_config_create`, use it instead of `vTaskDelete`
+ *
+ * Stacks outside of the default internal RAM are allocated with the caps of the entry and have to be freed with
+ * `vTaskDeleteWithCaps`.
+ *
+ * @param id    Task
+ * @param task  Task handle, NULL for the calling task
+ */
+void task_config_delete(task_config_id_t id, TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,363 @@
+#include "TerminalView.hpp"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <string.h>
+
+#define ROW_EMPTY UINT32_MAX            // 标签没有显示任何行
+
+static const char *TAG = "TerminalView";
+
+TerminalView::TerminalView() :
+    _text(nullptr),
+    _lines(nullptr),
+    _text_capacity(0),
+    _write_pos(0),
+    _first_line(0),
+    _last_line(0),
+    _last_cr(false),
+    _view(nullptr),
+    _row_count(0),
+    _columns(MAX_COLUMNS),
+    _line_height(1),
+    _refresh_timer(nullptr),
+    _top_line(0),
+    _follow(true),
+    _dirty(false),
+    _drag_accum(0)
+{
+    memset(_rows, 0, sizeof(_rows));
+}
+
+TerminalView::~TerminalView()
+{
+    destroy();
+    if (_text) {
+        heap_caps_free(_text);
+        _text = nullptr;
+    }
+    if (_lines) {
+        heap_caps_free(_lines);
+        _lines = nullptr;
+    }
+}
+
+bool TerminalView::allocBuffers(void)
+{
+    if (_text && _lines) {
+        return true;
+    }
+
+    // 回滚缓冲较大，放在PSRAM中
+    _text = (char*)heap_caps_malloc(TEXT_CAPACITY, MALLOC_CAP_SPIRAM);
+    _lines = (uint32_t*)heap_caps_malloc(LINE_CAPACITY * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    if (!_text || !_lines) {
+        ESP_LOGE(TAG, "Failed to allocate scrollback buffers (%u bytes)",
+                 (unsigned int)(TEXT_CAPACITY + LINE_CAPACITY * sizeof(uint32_t)));
+        heap_caps_free(_text);
+        heap_caps_free(_lines);
+        _text = nullptr;
+        _lines = nullptr;
+        return false;
+    }
+    _text_capacity = TEXT_CAPACITY;
+    clear();
+
+    return true;
+}
+
+bool TerminalView::create(lv_obj_t* placeholder, const lv_font_t* font)
+{
+    if (_view) {
+        return true;
+    }
+    if (!placeholder || !font || !allocBuffers()) {
+        return false;
+    }
+
+    // 终端与占位控件同位置、同大小、同配色
+    lv_obj_update_layout(placeholder);
+    _view = lv_obj_create(lv_obj_get_parent(placeholder));
+    lv_obj_set_size(_view, lv_obj_get_width(placeholder), lv_obj_get_height(placeholder));
+    lv_obj_align_to(_view, placeholder, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_set_style_bg_color(_view, lv_obj_get_style_bg_color(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_bg_opa(_view, lv_obj_get_style_bg_opa(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_border_color(_view, lv_obj_get_style_border_color(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_border_width(_view, lv_obj_get_style_border_width(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_radius(_view, lv_obj_get_style_radius(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_text_color(_view, lv_obj_get_style_text_color(placeholder, LV_PART_MAIN), 0);
+    lv_obj_set_style_text_font(_view, font, 0);
+    lv_obj_set_style_pad_all(_view, 8, 0);
+    lv_obj_clear_flag(_view, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(placeholder, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_update_layout(_view);
+
+    // 按字体计算一屏的行数和每行的字符数
+    lv_coord_t content_width = lv_obj_get_content_width(_view);
+    lv_coord_t glyph_width = lv_font_get_glyph_width(font, '0', 0);
+    _line_height = lv_font_get_line_height(font);
+    if (_line_height < 1) {
+        _line_height = 1;
+    }
+    _row_count = lv_obj_get_content_height(_view) / _line_height;
+    if (_row_count > MAX_ROWS) {
+        _row_count = MAX_ROWS;
+    }
+    _columns = (glyph_width > 0) ? (size_t)(content_width / glyph_width) : MAX_COLUMNS;
+    if (_columns < 8) {
+        _columns = 8;
+    } else if (_columns > MAX_COLUMNS) {
+        _columns = MAX_COLUMNS;
+    }
+
+    for (size_t i = 0; i < _row_count; i++) {
+        _rows[i] = lv_label_create(_view);
+        lv_label_set_long_mode(_rows[i], LV_LABEL_LONG_CLIP);
+        lv_obj_set_width(_rows[i], content_width);
+        lv_obj_set_pos(_rows[i], 0, (lv_coord_t)(i * _line_height));
+        lv_label_set_text_static(_rows[i], "");
+        _row_lines[i] = ROW_EMPTY;
+        _row_lens[i] = 0;
+    }
+
+    lv_obj_add_event_cb(_view, onViewPressing, LV_EVENT_PRESSING, this);
+    lv_obj_add_event_cb(_view, onViewReleased, LV_EVENT_RELEASED, this);
+    _refresh_timer = lv_timer_create(refreshTimerCb, REFRESH_MS, this);
+
+    ESP_LOGI(TAG, "Terminal created: %u rows x %u columns, %u KB scrollback",
+             (unsigned int)_row_count, (unsigned int)_columns, (unsigned int)(_text_capacity / 1024));
+    render();
+
+    return true;
+}
+
+void TerminalView::destroy(void)
+{
+    if (_refresh_timer) {
+        lv_timer_del(_refresh_timer);
+        _refresh_timer = nullptr;
+    }
+    if (_view && lv_obj_is_valid(_view)) {
+        lv_obj_del(_view);
+    }
+    _view = nullptr;
+    memset(_rows, 0, sizeof(_rows));
+    _row_count = 0;
+    _drag_accum = 0;
+}
+
+void TerminalView::setVisible(bool visible)
+{
+    if (!_view) {
+        return;
+    }
+
+    if (visible) {
+        lv_obj_clear_flag(_view, LV_OBJ_FLAG_HIDDEN);
+        render();
+    } else {
+        lv_obj_add_flag(_view, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+void TerminalView::clear(void)
+{
+    if (!_text) {
+        return;
+    }
+
+    _write_pos = 0;
+    _first_line = 0;
+    _last_line = 0;
+    _lines[0] = 0;
+    _last_cr = false;
+    _top_line = 0;
+    _follow = true;
+    for (size_t i = 0; i < _row_count; i++) {
+        lv_label_set_text_static(_rows[i], "");
+        _row_lines[i] = ROW_EMPTY;
+        _row_lens[i] = 0;
+    }
+    _dirty = true;
+}
+
+void TerminalView::append(const char* text)
+{
+    if (text) {
+        append(text, strlen(text));
+    }
+}
+
+void TerminalView::append(const char* text, size_t len)
+{
+    if (!text || !_text) {
+        return;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        char c = text[i];
+
+        if (c == '\r') {
+            newLine();
+            _last_cr = true;
+            continue;
+        }
+        if (c == '\n') {
+            // \r\n只换一次行
+            if (!_last_cr) {
+                newLine();
+            }
+        } else if (c == '\t') {
+            putChar(' ');
+        } else if (c >= 32 && c <= 126) {
+            putChar(c);
+        }
+        // 其他控制字符和UTF-8字节被丢弃，避免乱码
+        _last_cr = false;
+    }
+    _dirty = true;
+}
+
+void TerminalView::putChar(char c)
+{
+    // 超长的行折成多行，每行都能在标签中完整显示
+    if (lineLength(_last_line) >= _columns) {
+        newLine();
+    }
+
+    // 文本缓冲满时丢弃最旧的行
+    while (_write_pos - _lines[_first_line % LINE_CAPACITY] >= _text_capacity && _first_line < _last_line) {
+        _first_line++;
+    }
+    _text[_write_pos % _text_capacity] = c;
+    _write_pos++;
+}
+
+void TerminalView::newLine(void)
+{
+    if (_last_line - _first_line + 1 >= LINE_CAPACITY) {
+        _first_line++;
+    }
+    _last_line++;
+    _lines[_last_line % LINE_CAPACITY] = _write_pos;
+}
+
+size_t TerminalView::lineLength(uint32_t line) const
+{
+    uint32_t end = (line == _last_line) ? _write_pos : _lines[(line + 1) % LINE_CAPACITY];
+    return end - _lines[line % LINE_CAPACITY];
+}
+
+size_t TerminalView::copyLine(uint32_t line, char* out) const
+{
+    size_t len = lineLength(line);
+    uint32_t start = _lines[line % LINE_CAPACITY];
+
+    for (size_t i = 0; i < len; i++) {
+        out[i] = _text[(start + i) % _text_capacity];
+    }
+    out[len] = '\0';
+
+    return len;
+}
+
+uint32_t TerminalView::bottomTop(void) const
+{
+    // 最后一行显示在最下面一行时的第一可见行
+    uint32_t line_count = _last_line - _first_line + 1;
+    return (line_count > _row_count) ? _last_line + 1 - _row_count : _first_line;
+}
+
+void TerminalView::scrollLines(int32_t lines)
+{
+    int64_t bottom = bottomTop();
+    int64_t top = (_follow ? bottom : (int64_t)_top_line) + lines;
+
+    if (top < (int64_t)_first_line) {
+        top = _first_line;
+    }
+    if (top >= bottom) {
+        top = bottom;
+    }
+    _top_line = (uint32_t)top;
+    _follow = (top == bottom);
+    render();
+}
+
+void TerminalView::render(void)
+{
+    if (!_view) {
+        return;
+    }
+
+    // 向上翻看时最旧的行可能已被丢弃
+    uint32_t bottom = bottomTop();
+    if (_follow || _top_line >= bottom) {
+        _top_line = bottom;
+        _follow = true;
+    } else if (_top_line < _first_line) {
+        _top_line = _first_line;
+    }
+
+    // 已显示的行内容不会变，只有正在写入的行会变长，按行号和长度判断是否需要更新
+    char buf[MAX_COLUMNS + 1];
+    for (size_t i = 0; i < _row_count; i++) {
+        uint32_t line = _top_line + i;
+
+        if (line > _last_line) {
+            if (_row_lines[i] != ROW_EMPTY) {
+                lv_label_set_text_static(_rows[i], "");
+                _row_lines[i] = ROW_EMPTY;
+                _row_lens[i] = 0;
+            }
+            continue;
+        }
+
+        size_t len = lineLength(line);
+        if (_row_lines[i] == line && _row_lens[i] == len) {
+            continue;
+        }
+        copyLine(line, buf);
+        lv_label_set_text(_rows[i], buf);
+        _row_lines[i] = line;
+        _row_lens[i] = (uint16_t)len;
+    }
+    _dirty = false;
+}
+
+void TerminalView::refreshTimerCb(lv_timer_t* timer)
+{
+    TerminalView* view = static_cast<TerminalView*>(timer->user_data);
+
+    if (view && view->_dirty && !lv_obj_has_flag(view->_view, LV_OBJ_FLAG_HIDDEN)) {
+        view->render();
+    }
+}
+
+void TerminalView::onViewPressing(lv_event_t* e)
+{
+    TerminalView* view = static_cast<TerminalView*>(lv_event_get_user_data(e));
+    lv_indev_t* indev = lv_indev_get_act();
+    lv_point_t vect;
+
+    if (!view || !indev) {
+        return;
+    }
+
+    // 向下拖动看更早的内容，累计够一行才滚动
+    lv_indev_get_vect(indev, &vect);
+    view->_drag_accum += vect.y;
+    int32_t lines = view->_drag_accum / view->_line_height;
+    if (lines != 0) {
+        view->_drag_accum -= lines * view->_line_height;
+        view->scrollLines(-lines);
+    }
+}
+
+void TerminalView::onViewReleased(lv_event_t* e)
+{
+    TerminalView* view = static_cast<TerminalView*>(lv_event_get_user_data(e));
+
+    if (view) {
+        view->_drag_accum = 0;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lvgl.h"
+
+/**
+ * @class TerminalView
+ * @brief 串口终端显示控件
+ *
+ * 文本保存在PSRAM中按行索引的环形缓冲区里，满了以后丢弃最旧的行；
+ * 界面上只有一屏的标签，滚动和追加时只更新可见行的文字，
+ * 显示的开销与回滚缓冲的大小无关。
+ * 所有方法都只能在LVGL上下文中调用。
+ */
+class TerminalView {
+public:
+    static const size_t TEXT_CAPACITY = 256 * 1024;    // 回滚文本缓冲（字节）
+    static const size_t LINE_CAPACITY = 16384;         // 回滚行数上限
+    static const size_t MAX_ROWS = 64;                 // 可见行标签数上限
+    static const size_t MAX_COLUMNS = 160;             // 每行字符数上限，超过自动折行
+    static const uint32_t REFRESH_MS = 30;             // 重绘检查间隔
+
+    TerminalView();
+    ~TerminalView();
+
+    /**
+     * @brief 在占位控件的位置创建终端，占位控件被隐藏
+     * @param placeholder SquareLine导出的文本区域，提供位置、大小和配色
+     * @param font 显示字体
+     * @return true 成功，false 内存不足
+     */
+    bool create(lv_obj_t* placeholder, const lv_font_t* font);
+
+    /**
+     * @brief 删除终端控件和重绘定时器，回滚文本保留
+     */
+    void destroy(void);
+
+    bool isCreated(void) const { return _view != nullptr; }
+
+    /**
+     * @brief 显示或隐藏终端，隐藏时继续接收文本但不重绘
+     */
+    void setVisible(bool visible);
+
+    /**
+     * @brief 追加文本，\r、\n和\r\n都作为换行，其他控制字符和非ASCII字符被丢弃
+     * @param text 文本，不要求以'\0'结尾
+     * @param len 字节数
+     */
+    void append(const char* text, size_t len);
+    void append(const char* text);
+
+    /**
+     * @brief 清空回滚文本并回到跟随末尾的状态
+     */
+    void clear(void);
+
+private:
+    bool allocBuffers(void);
+    void putChar(char c);
+    void newLine(void);
+    size_t lineLength(uint32_t line) const;
+    size_t copyLine(uint32_t line, char* out) const;
+    uint32_t bottomTop(void) const;
+    void scrollLines(int32_t lines);
+    void render(void);
+
+    static void refreshTimerCb(lv_timer_t* timer);
+    static void onViewPressing(lv_event_t* e);
+    static void onViewReleased(lv_event_t* e);
+
+    // 回滚缓冲，行号和字节位置都是单调递增的绝对值，取模得到环形缓冲中的下标
+    char*       _text;              // 文本环形缓冲
+    uint32_t*   _lines;             // 每行起始的字节位置
+    size_t      _text_capacity;
+    uint32_t    _write_pos;         // 下一个字节的位置
+    uint32_t    _first_line;        // 最旧的行
+    uint32_t    _last_line;         // 正在写入的行
+    bool        _last_cr;           // 上一个字符是\r，紧跟的\n不再换行
+
+    // 显示
+    lv_obj_t*   _view;
+    lv_obj_t*   _rows[MAX_ROWS];
+    uint32_t    _row_lines[MAX_ROWS];   // 标签当前显示的行
+    uint16_t    _row_lens[MAX_ROWS];    // 标签当前显示的长度
+    size_t      _row_count;
+    size_t      _columns;
+    lv_coord_t  _line_height;
+    lv_timer_t* _refresh_timer;
+    uint32_t    _top_line;          // 不跟随时第一可见行
+    bool        _follow;            // 跟随末尾
+    bool        _dirty;
+    lv_coord_t  _drag_accum;        // 拖动中还不够一行的距离
+};
@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "CalcExpr.hpp"
+
+#include "unity.h"
+
+#define CALC_DELTA              (1e-9)
+
+static double calc_eval(const char *src, double x = 0)
+{
+    CalcExpr expr;
+
+    TEST_ASSERT_TRUE_MESSAGE(expr.compile(src, true), src);
+    return expr.eval(x);
+}
+
+static void calc_assert_rejected(const char *src)
+{
+    CalcExpr expr;
+
+    TEST_ASSERT_FALSE_MESSAGE(expr.compile(src, true), src);
+    TEST_ASSERT_TRUE_MESSAGE(isnan(expr.eval()), src);
+}
+
+TEST_CASE("CalcExpr lexes numbers", "[calc_expr]")
+{
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 12.25, calc_eval("12.25"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 0.5, calc_eval(".5"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 1, calc_eval("1."));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 1.5, calc_eval("1.2+.3"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 0.3, calc_eval("0.1+0.2"));
+}
+
+TEST_CASE("CalcExpr rejects a second decimal point in a number", "[calc_expr]")
+{
+    /* Not 1.2 times .3 through implicit multiplication */
+    calc_assert_rejected("1.2.3");
+    calc_assert_rejected("1..2");
+    calc_assert_rejected("3.5.1+1");
+}
+
+TEST_CASE("CalcExpr applies precedence and associativity", "[calc_expr]")
+{
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 7, calc_eval("1+2x3"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 512, calc_eval("2^3^2"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, -4, calc_eval("-2^2"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 1, calc_eval("7mod3"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 6, calc_eval("3!"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 0.5, calc_eval("50%"));
+}
+
+TEST_CASE("CalcExpr multiplies adjacent operands", "[calc_expr]")
+{
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 2 * M_PI, calc_eval("2pi"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 9, calc_eval("3(1+2)"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 4, calc_eval("2sqrt(4)"));
+}
+
+TEST_CASE("CalcExpr evaluates functions and closes open parentheses", "[calc_expr]")
+{
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 1, calc_eval("sin(90"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 3, calc_eval("(1+2"));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 3, calc_eval("|-3|"));
+    TEST_ASSERT_TRUE(isinf(calc_eval("1/0")));
+}
+
+TEST_CASE("CalcExpr evaluates the variable", "[calc_expr]")
+{
+    CalcExpr expr;
+
+    TEST_ASSERT_TRUE(expr.compile("X^2+1", true));
+    TEST_ASSERT_TRUE(expr.hasVariable());
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 5, expr.eval(2));
+    TEST_ASSERT_DOUBLE_WITHIN(CALC_DELTA, 4, calc_eval("2X", 2));
+}
+
+TEST_CASE("CalcExpr rejects incomplete formulas", "[calc_expr]")
+{
+    calc_assert_rejected("");
+    calc_assert_rejected("1+");
+}
+
+extern "C" void app_main(void)
+{
+    /**
+     *   ___   _   _    ___
+     *  / __| /_\ | |  / __|
+     * | (__ / _ \| |_| (__
+     *  \___/_/ \_\____\___|
+    */
+
+    printf("\r\n");
+    printf("  ___   _   _    ___ \r\n");
+    printf(" / __| /_\\ | |  / __|\r\n");
+    printf("| (__ / _ \\| |_| (__ \r\n");
+    printf(" \\___/_/ \\_\\____\\___|\r\n");
+
+    unity_run_menu();
+}
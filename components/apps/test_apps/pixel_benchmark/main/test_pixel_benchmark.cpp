@@ -0,0 +1,231 @@
+/*
+ * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+
+#include "app_overlay.hpp"
+#include "app_soft_3a.h"
+#include "app_autofocus.h"
+#include "app_motion_gate.h"
+
+#include "unity.h"
+
+#define BENCH_RUNS              CONFIG_BENCHMARK_RUNS
+#define BENCH_WARMUP_RUNS       CONFIG_BENCHMARK_WARMUP_RUNS
+/* Frames are cache line aligned like the camera buffers */
+#define BENCH_ALIGN             (64)
+#define BENCH_COLOR             (0xF800)
+/* Same outline as the overlay of the Camera app */
+#define BENCH_BOX_THICKNESS     (3)
+#define BENCH_MOTION_THRESHOLD  (8)
+
+#if CONFIG_CAMERA_OVERLAY_PIE
+#define BENCH_OVERLAY_VARIANT   "pie"
+#else
+#define BENCH_OVERLAY_VARIANT   "scalar"
+#endif
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t caps;
+    const char *mem;
+} bench_size_t;
+
+typedef struct {
+    uint32_t min;
+    uint64_t sum;
+} bench_cycles_t;
+
+/* A thumbnail, the detector input, the display and the camera frame */
+static const bench_size_t bench_sizes[] = {
+    {64, 64, MALLOC_CAP_INTERNAL, "internal"},
+    {320, 240, MALLOC_CAP_SPIRAM, "psram"},
+    {1024, 600, MALLOC_CAP_SPIRAM, "psram"},
+    {1280, 720, MALLOC_CAP_SPIRAM, "psram"},
+};
+
+static uint16_t *bench_alloc_frame(const bench_size_t *size, uint32_t seed)
+{
+    uint32_t pixels = size->width * size->height;
+    uint16_t *frame = (uint16_t *)heap_caps_aligned_alloc(BENCH_ALIGN, pixels * sizeof(uint16_t),
+                                                          size->caps | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL_MESSAGE(frame, "frame allocation failed");
+
+    /* Noise, so the branches on the pixel values go both ways */
+    for (uint32_t i = 0; i < pixels; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        frame[i] = seed & 0xffff;
+    }
+
+    return frame;
+}
+
+template <typename F>
+static void bench_time(F run, bench_cycles_t *cycles)
+{
+    for (int i = 0; i < BENCH_WARMUP_RUNS; i++) {
+        run();
+    }
+
+    cycles->min = UINT32_MAX;
+    cycles->sum = 0;
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        run();
+        uint32_t elapsed = esp_cpu_get_cycle_count() - start;
+
+        cycles->min = std::min(cycles->min, elapsed);
+        cycles->sum += elapsed;
+    }
+}
+
+/* The per pixel cost is taken from the fastest run, the least disturbed by interrupts and other tasks */
+static void bench_report(const char *kernel, const char *variant, const bench_size_t *size, uint32_t pixels,
+                         const bench_cycles_t *cycles)
+{
+    printf("BENCHMARK_RESULT {\"kernel\":\"%s\",\"variant\":\"%s\",\"width\":%" PRIu32 ",\"height\":%" PRIu32
+           ",\"mem\":\"%s\",\"pixels\":%" PRIu32 ",\"runs\":%d,\"cycles_min\":%" PRIu32 ",\"cycles_avg\":%" PRIu32
+           ",\"cycles_per_pixel\":%.3f}\n",
+           kernel, variant, size->width, size->height, size->mem, pixels, BENCH_RUNS, cycles->min,
+           (uint32_t)(cycles->sum / BENCH_RUNS), pixels ? (float)cycles->min / pixels : 0.f);
+}
+
+TEST_CASE("Overlay fill benchmark", "[pixel][benchmark]")
+{
+    for (const bench_size_t &size : bench_sizes) {
+        int width = size.width;
+        int height = size.height;
+        uint16_t *frame = bench_alloc_frame(&size, 1);
+        bench_cycles_t cycles;
+
+        /* An outline as thick as half the frame covers every row once, as the top and the bottom edge */
+        bench_time([&]() {
+            app_overlay_draw_rect(frame, width, height, 0, 0, width - 1, height - 1, BENCH_COLOR, height / 2);
+        }, &cycles);
+        for (int i = 0; i < width * height; i++) {
+            TEST_ASSERT_EQUAL_HEX16(BENCH_COLOR, frame[i]);
+        }
+        bench_report("overlay_fill", BENCH_OVERLAY_VARIANT, &size, width * height, &cycles);
+        heap_caps_free(frame);
+    }
+}
+
+TEST_CASE("Overlay box benchmark", "[pixel][benchmark]")
+{
+    for (const bench_size_t &size : bench_sizes) {
+        int width = size.width;
+        int height = size.height;
+        uint16_t *frame = bench_alloc_frame(&size, 2);
+        uint16_t inside = BENCH_COLOR ^ 0xffff;
+        bench_cycles_t cycles;
+        /* A detection in the middle of the frame, the odd left edge leaves the spans unaligned */
+        int x1 = width / 4 + 1;
+        int y1 = height / 4;
+        int x2 = width * 3 / 4;
+        int y2 = height * 3 / 4;
+        int box_w = x2 - x1 + 1;
+        int box_h = y2 - y1 + 1;
+        int center = (y1 + box_h / 2) * width + x1 + box_w / 2;
+
+        frame[center] = inside;
+        bench_time([&]() {
+            app_overlay_draw_rect(frame, width, height, x1, y1, x2, y2, BENCH_COLOR, BENCH_BOX_THICKNESS);
+        }, &cycles);
+        TEST_ASSERT_EQUAL_HEX16(BENCH_COLOR, frame[y1 * width + x1]);
+        TEST_ASSERT_EQUAL_HEX16(BENCH_COLOR, frame[y2 * width + x2]);
+        TEST_ASSERT_EQUAL_HEX16(inside, frame[center]);
+        bench_report("overlay_box", BENCH_OVERLAY_VARIANT, &size,
+                     2 * BENCH_BOX_THICKNESS * (box_w + box_h - 2 * BENCH_BOX_THICKNESS), &cycles);
+        heap_caps_free(frame);
+    }
+}
+
+TEST_CASE("Soft 3A statistics benchmark", "[pixel][benchmark]")
+{
+    for (const bench_size_t &size : bench_sizes) {
+        uint16_t *frame = bench_alloc_frame(&size, 3);
+        app_soft_3a_stats_t stats;
+        bench_cycles_t cycles;
+
+        bench_time([&]() {
+            app_soft_3a_compute_stats(frame, size.width, size.height, &stats);
+        }, &cycles);
+        TEST_ASSERT_GREATER_THAN_UINT32(0, stats.samples);
+        /* Only the sampling grid is read */
+        bench_report("soft_3a_stats", "scalar", &size, stats.samples, &cycles);
+        heap_caps_free(frame);
+    }
+}
+
+TEST_CASE("Autofocus metric benchmark", "[pixel][benchmark]")
+{
+    for (const bench_size_t &size : bench_sizes) {
+        uint16_t *frame = bench_alloc_frame(&size, 4);
+        uint32_t metric = 0;
+        bench_cycles_t cycles;
+        /* Only the central area is read */
+        uint32_t area = (size.width * 5 / 8 - size.width * 3 / 8) * (size.height * 5 / 8 - size.height * 3 / 8);
+
+        bench_time([&]() {
+            metric = app_autofocus_compute_metric(frame, size.width, size.height);
+        }, &cycles);
+        TEST_ASSERT_GREATER_THAN_UINT32(0, metric);
+        bench_report("autofocus_metric", "scalar", &size, area, &cycles);
+        heap_caps_free(frame);
+    }
+}
+
+TEST_CASE("Motion gate benchmark", "[pixel][benchmark]")
+{
+    for (const bench_size_t &size : bench_sizes) {
+        uint16_t *frames[2] = {bench_alloc_frame(&size, 5), bench_alloc_frame(&size, 6)};
+        app_motion_gate_t gate;
+        app_motion_rect_t roi;
+        bench_cycles_t cycles;
+        bool moved = true;
+        int next = 0;
+
+        TEST_ESP_OK(app_motion_gate_init(&gate, size.width, size.height));
+        /* Two different frames in turn, every block moves and the whole plane is compared */
+        bench_time([&]() {
+            moved &= app_motion_gate_process(&gate, frames[next], size.width, size.height, false,
+                                             BENCH_MOTION_THRESHOLD, &roi);
+            next = !next;
+        }, &cycles);
+        TEST_ASSERT_TRUE(moved);
+        /* Luma is sampled on every second pixel of every second line */
+        bench_report("motion_gate", "scalar", &size, (size.width / 2) * (size.height / 2), &cycles);
+        app_motion_gate_deinit(&gate);
+        heap_caps_free(frames[0]);
+        heap_caps_free(frames[1]);
+    }
+}
+
+extern "C" void app_main(void)
+{
+    /**
+     *  ___ ___ _  _  ___ _  _
+     * | _ ) __| \| |/ __| || |
+     * | _ \ _|| .` | (__| __ |
+     * |___/___|_|\_|\___|_||_|
+    */
+
+    printf("\r\n");
+    printf(" ___ ___ _  _  ___ _  _ \r\n");
+    printf("| _ ) __| \\| |/ __| || |\r\n");
+    printf("| _ \\ _|| .` | (__| __ |\r\n");
+    printf("|___/___|_|\\_|\\___|_||_|\r\n");
+
+    unity_run_menu();
+}
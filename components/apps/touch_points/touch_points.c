@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_lcd_touch.h"
+#include "touch_points.h"
+
+#define TOUCH_POINTS_READ_MAX       (5)
+
+typedef bool (*touch_get_xy_t)(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength,
+                               uint8_t *point_num, uint8_t max_point_num);
+
+static const char *TAG = "touch_points";
+
+// Only used from the LVGL task, the driver is read from it too
+static esp_lcd_touch_handle_t touch = NULL;
+static touch_get_xy_t touch_get_xy = NULL;
+static uint32_t touch_hooks = 0;
+static uint16_t touch_x[TOUCH_POINTS_NUM];
+static uint16_t touch_y[TOUCH_POINTS_NUM];
+static uint8_t touch_num = 0;
+
+static bool touch_get_xy_hook(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength,
+                              uint8_t *point_num, uint8_t max_point_num)
+{
+    uint16_t xs[TOUCH_POINTS_READ_MAX];
+    uint16_t ys[TOUCH_POINTS_READ_MAX];
+    uint16_t ss[TOUCH_POINTS_READ_MAX];
+    uint8_t num = 0;
+
+    // The driver forgets the points once read, so the LVGL read is widened to the points of a pinch
+    bool pressed = touch_get_xy(tp, xs, ys, ss, &num, MIN(MAX(max_point_num, TOUCH_POINTS_NUM), TOUCH_POINTS_READ_MAX));
+    touch_num = pressed ? MIN(num, TOUCH_POINTS_NUM) : 0;
+    memcpy(touch_x, xs, sizeof(touch_x));
+    memcpy(touch_y, ys, sizeof(touch_y));
+
+    *point_num = MIN(num, max_point_num);
+    memcpy(x, xs, *point_num * sizeof(uint16_t));
+    memcpy(y, ys, *point_num * sizeof(uint16_t));
+    if (strength) {
+        memcpy(strength, ss, *point_num * sizeof(uint16_t));
+    }
+
+    return pressed;
+}
+
+esp_err_t touch_points_hook(lv_disp_t *disp)
+{
+    if (touch_hooks > 0) {
+        touch_hooks++;
+        return ESP_OK;
+    }
+
+    lv_indev_t *indev = lv_indev_get_next(NULL);
+    while ((indev != NULL) && ((lv_indev_get_type(indev) != LV_INDEV_TYPE_POINTER) || (indev->driver->disp != disp))) {
+        indev = lv_indev_get_next(indev);
+    }
+    // esp_lvgl_port keeps the touch handle first in the context of its pointer devices
+    ESP_RETURN_ON_FALSE(indev && indev->driver->user_data, ESP_ERR_NOT_FOUND, TAG, "No touch panel");
+    esp_lcd_touch_handle_t tp = *(esp_lcd_touch_handle_t *)indev->driver->user_data;
+    ESP_RETURN_ON_FALSE(tp && tp->get_xy, ESP_ERR_NOT_SUPPORTED, TAG, "Touch panel driver reports no points");
+
+    touch = tp;
+    touch_get_xy = tp->get_xy;
+    tp->get_xy = touch_get_xy_hook;
+    touch_num = 0;
+    touch_hooks = 1;
+
+    return ESP_OK;
+}
+
+void touch_points_unhook(void)
+{
+    if ((touch_hooks == 0) || (--touch_hooks > 0)) {
+        return;
+    }
+
+    touch->get_xy = touch_get_xy;
+    touch = NULL;
+    touch_get_xy = NULL;
+    touch_num = 0;
+}
+
+uint8_t touch_points_get(uint16_t *x, uint16_t *y)
+{
+    if (touch_hooks == 0) {
+        return 0;
+    }
+
+    memcpy(x, touch_x, touch_num * sizeof(uint16_t));
+    memcpy(y, touch_y, touch_num * sizeof(uint16_t));
+
+    return touch_num;
+}
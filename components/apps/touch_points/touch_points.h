@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TOUCH_POINTS_NUM        (2)     /* Points kept from each read, enough for a pinch */
+
+/**
+ * @brief Keep the touch points of the panel behind the pointer device of a display
+ *
+ * LVGL only tracks one point. The read of the touch panel driver is widened so the points of every read are kept,
+ * for gestures like a pinch. The pointer device still gets the same points. Hooks are counted, the driver is only
+ * restored by the last `touch_points_unhook`. Must be called from the LVGL task.
+ *
+ * @param disp  Display of the pointer device
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NOT_FOUND      The display has no touch panel
+ *      - ESP_ERR_NOT_SUPPORTED  The touch panel driver reports no points
+ */
+esp_err_t touch_points_hook(lv_disp_t *disp);
+
+/**
+ * @brief Give back a hook of `touch_points_hook`
+ */
+void touch_points_unhook(void);
+
+/**
+ * @brief Get the points of the last read of the touch panel
+ *
+ * Touch panel coordinates, the display isn't rotated. Must be called from the LVGL task, e.g. in a pressing event.
+ *
+ * @param x     Output X of the points, `TOUCH_POINTS_NUM` entries
+ * @param y     Output Y of the points, `TOUCH_POINTS_NUM` entries
+ *
+ * @return Number of points filled, 0 when not hooked or not pressed
+ */
+uint8_t touch_points_get(uint16_t *x, uint16_t *y);
+
+#ifdef __cplusplus
+}
+#endif
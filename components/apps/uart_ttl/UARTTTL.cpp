@@ -2,15 +2,17 @@
 #include "esp_log.h"
 #include "ui/ui.h"
 #include "assets/img_app_uart_ttl.h"
+#include "bsp/esp-bsp.h"
 #include <string.h>
 #include <stdio.h>
 
 // 常量定义
-#define MAX_UI_UPDATE_LEN 1024          // UI单次更新最大长度
-#define TEXT_AREA_MAX_LEN 12288         // 文本区域最大长度（12KB）- 与USB CDC保持一致
-#define TEXT_AREA_CLEAR_TRIGGER 10240   // 触发清空的长度（10KB）
-#define TEXT_AREA_KEEP_LEN 4096         // 清空后保留的长度（4KB）
+#define MAX_UI_READ_PER_TICK 8192       // 每次定时器回调最多读取的长度，921600波特率下也不会积压
+#define UI_UPDATE_PERIOD_MS  30         // 有数据时的UI更新周期，积压时加倍，空闲时为CONFIG_SERIAL_UI_IDLE_PERIOD_MS
 #define HEARTBEAT_INTERVAL_MS 2000      // 心跳包发送间隔（毫秒）
+#define SCRIPT_FILE BSP_SD_MOUNT_POINT "/SCRIPT.TXT"    // 长按START运行的脚本
+#define AUTOBAUD_POLL_MS     100        // 查询自动波特率检测结果的周期
+#define PORT_BAR_HEIGHT      40         // 端口切换栏高度，从文本区域上方让出
 
 static const char *TAG = "AppUARTTTL";
 static const char* NVS_NAMESPACE = "uart_ttl_app";
@@ -19,9 +21,25 @@ static const char* NVS_NAMESPACE = "uart_ttl_app";
 LV_IMG_DECLARE(img_app_uart_ttl);
 
 // 串口参数选项数组，必须与SquareLine中Dropdown的选项顺序严格一致
+// 最后三项是运行时追加的抓取模式波特率，其后是自动波特率选项，见setupSettingsScreenEvents
 const int baudrate_options[] = { 
-    4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 1500000 
+    4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 1500000,
+    2000000, 3000000, 4000000
 };
+#define BAUDRATE_SQUARELINE_COUNT 9     // SquareLine中Dropdown的选项数
+#define BAUDRATE_AUTO_INDEX (sizeof(baudrate_options)/sizeof(int))  // 自动波特率选项
+#if CONFIG_UART_TTL_EXTRA_PORTS
+// 附加端口，UART2由电源控制器的Modbus使用
+static const UartPort extra_port_table[CONFIG_UART_TTL_EXTRA_PORTS] = {
+    { .port = UART_NUM_3, .tx_pin = CONFIG_UART_TTL_PORT2_TX_PIN, .rx_pin = CONFIG_UART_TTL_PORT2_RX_PIN,
+      .rx_task = TASK_CONFIG_UART_RX_PORT2 },
+#if CONFIG_UART_TTL_EXTRA_PORTS > 1
+    { .port = UART_NUM_4, .tx_pin = CONFIG_UART_TTL_PORT3_TX_PIN, .rx_pin = CONFIG_UART_TTL_PORT3_RX_PIN,
+      .rx_task = TASK_CONFIG_UART_RX_PORT3 },
+#endif
+};
+#endif
+
 const uart_word_length_t databits_options[] = { 
     UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS 
 };
@@ -35,12 +53,26 @@ const uart_stop_bits_t stopbits_options[] = {
 UARTTTL::UARTTTL() :
     ESP_Brookesia_PhoneApp("UART TTL", &img_app_uart_ttl, true),
     _update_timer(nullptr),
+    _autobaud_timer(nullptr),
     _text_area_ttl(nullptr),
     _last_tx_timestamp(0),
-    _current_text_len(0),
     _heartbeat_enabled(true),  // 默认开启心跳包功能
-    _heartbeat_counter(0)      // 心跳包计数器初始化为0
+    _heartbeat_counter(0),     // 心跳包计数器初始化为0
+    _view_mode(VIEW_TEXT),
+    _script_active(false),
+    _bridge_direction(-1),
+    _bridge_usb_connected(false),
+    _autobaud_port(0),
+    _selected_port(0)
 {
+    _hex_dump.attach(&_terminal);
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        _extra_ports[i] = nullptr;
+    }
+    _port_bar = nullptr;
+    _port_map[UART_TTL_PORT_COUNT] = "";
+#endif
 }
 
 UARTTTL::~UARTTTL()
@@ -55,9 +87,25 @@ UARTTTL::~UARTTTL()
         lv_timer_del(_update_timer);
         _update_timer = nullptr;
     }
+    if (_autobaud_timer) {
+        lv_timer_del(_autobaud_timer);
+        _autobaud_timer = nullptr;
+    }
     
     // 确保UART服务完全停止
+    _uart_service.setRxTap(nullptr);
+    _script.stop();
+    _bridge.stop();
+    _usb_service.setCaptureSink(nullptr);
     _uart_service.stopReceiving();
+    stopCapture();
+    stopExtraPorts();
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        delete _extra_ports[i];
+        _extra_ports[i] = nullptr;
+    }
+#endif
     
     if (_nvs_handle != 0) {
         nvs_close(_nvs_handle);
@@ -80,42 +128,88 @@ bool UARTTTL::init(void)
     
     // 初始化UART服务
     _uart_service.begin(_current_config);
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        if (_extra_ports[i] == nullptr) {
+            _extra_ports[i] = new ExtraPort(extra_port_table[i]);
+        }
+        loadPortSettings(i + 1);
+        _extra_ports[i]->service.begin(_extra_ports[i]->config);
+    }
+#endif
     
     ESP_LOGI(TAG, "UART TTL application initialized successfully");
     return true;
 }
 
-void UARTTTL::loadSettings()
+// 端口的NVS键名，第一个端口沿用原来的键名
+static const char* portKey(char* key, size_t size, const char* name, uint32_t index)
 {
-    // 设置默认配置
-    _current_config.baud_rate = 115200;
-    _current_config.data_bits = UART_DATA_8_BITS;
-    _current_config.parity = UART_PARITY_DISABLE;
-    _current_config.stop_bits = UART_STOP_BITS_1;
-    _heartbeat_enabled = true;
-    
-    // 从NVS读取保存的配置
+    if (index == 0) {
+        return name;
+    }
+    snprintf(key, size, "%s_p%u", name, (unsigned int)(index + 1));
+    return key;
+}
+
+// 读取一个端口的串口参数，没有保存过时使用默认配置
+void UARTTTL::loadPortSettings(uint32_t index)
+{
+    UartConfig& config = portConfig(index);
+    config.baud_rate = 115200;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+
+    char key[16];
     uint32_t temp_val;
-    if(nvs_get_u32(_nvs_handle, "uart_baud", &temp_val) == ESP_OK) {
-        _current_config.baud_rate = temp_val;
+    if(nvs_get_u32(_nvs_handle, portKey(key, sizeof(key), "uart_baud", index), &temp_val) == ESP_OK) {
+        config.baud_rate = temp_val;
     }
-    if(nvs_get_u32(_nvs_handle, "uart_data", &temp_val) == ESP_OK) {
-        _current_config.data_bits = (uart_word_length_t)temp_val;
+    if(nvs_get_u32(_nvs_handle, portKey(key, sizeof(key), "uart_data", index), &temp_val) == ESP_OK) {
+        config.data_bits = (uart_word_length_t)temp_val;
     }
-    if(nvs_get_u32(_nvs_handle, "uart_par", &temp_val) == ESP_OK) {
-        _current_config.parity = (uart_parity_t)temp_val;
+    if(nvs_get_u32(_nvs_handle, portKey(key, sizeof(key), "uart_par", index), &temp_val) == ESP_OK) {
+        config.parity = (uart_parity_t)temp_val;
     }
-    if(nvs_get_u32(_nvs_handle, "uart_stop", &temp_val) == ESP_OK) {
-        _current_config.stop_bits = (uart_stop_bits_t)temp_val;
+    if(nvs_get_u32(_nvs_handle, portKey(key, sizeof(key), "uart_stop", index), &temp_val) == ESP_OK) {
+        config.stop_bits = (uart_stop_bits_t)temp_val;
     }
+    
+    // 高波特率使用DMA抓取模式，只有一个UHCI控制器，附加端口不用
+    config.dma_capture = (index == 0 && config.baud_rate >= UART_CAPTURE_MIN_BAUD);
+    
+    ESP_LOGI(TAG, "Port %u settings loaded: baud=%d, data=%d, parity=%d, stop=%d", (unsigned int)(index + 1),
+             config.baud_rate, config.data_bits, config.parity, config.stop_bits);
+}
+
+void UARTTTL::savePortSettings(uint32_t index)
+{
+    const UartConfig& config = portConfig(index);
+    char key[16];
+    nvs_set_u32(_nvs_handle, portKey(key, sizeof(key), "uart_baud", index), config.baud_rate);
+    nvs_set_u32(_nvs_handle, portKey(key, sizeof(key), "uart_data", index), config.data_bits);
+    nvs_set_u32(_nvs_handle, portKey(key, sizeof(key), "uart_par", index), config.parity);
+    nvs_set_u32(_nvs_handle, portKey(key, sizeof(key), "uart_stop", index), config.stop_bits);
+}
+
+void UARTTTL::loadSettings()
+{
+    // 设置默认配置
+    _heartbeat_enabled = true;
+    _view_mode = VIEW_TEXT;
+    
+    // 从NVS读取保存的配置，附加端口的配置在它们创建后读取
+    loadPortSettings(0);
+    uint32_t temp_val;
     if(nvs_get_u32(_nvs_handle, "heartbeat_en", &temp_val) == ESP_OK) {
         _heartbeat_enabled = (temp_val != 0);
     }
+    if(nvs_get_u32(_nvs_handle, "view_mode", &temp_val) == ESP_OK && temp_val < VIEW_MODE_COUNT) {
+        _view_mode = temp_val;
+    }
     
-    ESP_LOGI(TAG, "Settings loaded: baud=%d, data=%d, parity=%d, stop=%d, heartbeat=%s",
-             _current_config.baud_rate, _current_config.data_bits, 
-             _current_config.parity, _current_config.stop_bits,
-             _heartbeat_enabled ? "enabled" : "disabled");
+    ESP_LOGI(TAG, "Settings loaded: heartbeat=%s", _heartbeat_enabled ? "enabled" : "disabled");
 }
 
 void UARTTTL::saveSettings()
@@ -124,13 +218,12 @@ void UARTTTL::saveSettings()
              _current_config.baud_rate, _current_config.data_bits, 
              _current_config.parity, _current_config.stop_bits,
              _heartbeat_enabled ? "enabled" : "disabled");
-             
-    // 保存串口配置参数到NVS
-    nvs_set_u32(_nvs_handle, "uart_baud", _current_config.baud_rate);
-    nvs_set_u32(_nvs_handle, "uart_data", _current_config.data_bits);
-    nvs_set_u32(_nvs_handle, "uart_par", _current_config.parity);
-    nvs_set_u32(_nvs_handle, "uart_stop", _current_config.stop_bits);
+    
+    for (uint32_t i = 0; i < UART_TTL_PORT_COUNT; i++) {
+        savePortSettings(i);
+    }
     nvs_set_u32(_nvs_handle, "heartbeat_en", _heartbeat_enabled ? 1 : 0);
+    nvs_set_u32(_nvs_handle, "view_mode", _view_mode);
     
     // 提交更改到NVS
     esp_err_t err = nvs_commit(_nvs_handle);
@@ -145,14 +238,51 @@ bool UARTTTL::run(void)
     uart_ttl_ui_init();
     extraUiInit();
     
-    // 创建UI更新定时器（30ms刷新间隔）
-    _update_timer = lv_timer_create(uiUpdateTimerCb, 30, this);
+    // 创建UI更新定时器，周期由_pacer调整
+    _update_timer = lv_timer_create(uiUpdateTimerCb, UI_UPDATE_PERIOD_MS, this);
     lv_timer_pause(_update_timer);  // 初始状态暂停
 
+    // 自动波特率检测时才运行
+    _autobaud_timer = lv_timer_create(autoBaudTimerCb, AUTOBAUD_POLL_MS, this);
+    lv_timer_pause(_autobaud_timer);
+
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    // 文本区域上方让出端口切换栏的位置
+    lv_obj_set_height(_text_area_ttl, lv_obj_get_height(_text_area_ttl) - PORT_BAR_HEIGHT);
+    lv_obj_set_y(_text_area_ttl, lv_obj_get_y_aligned(_text_area_ttl) + PORT_BAR_HEIGHT / 2);
+#endif
+
+    // 用终端控件代替文本区域显示，回滚文本放在PSRAM中
+    if (!_terminal.create(_text_area_ttl, &lv_font_montserrat_12)) {
+        ESP_LOGE(TAG, "Failed to create terminal view");
+        return false;
+    }
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    // 附加端口的终端叠放在同一位置，只显示选中的端口
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        ExtraPort* port = _extra_ports[i];
+        if (!port->terminal.create(_text_area_ttl, &lv_font_montserrat_12)) {
+            ESP_LOGE(TAG, "Failed to create terminal view");
+            return false;
+        }
+
+        char msg[96];
+        snprintf(msg, sizeof(msg), "UART%d ready: TX=GPIO%d, RX=GPIO%d, text view only.\r\n",
+                 port->service.getPort().port, port->service.getPort().tx_pin, port->service.getPort().rx_pin);
+        port->terminal.clear();
+        port->terminal.append(msg);
+    }
+    createPortBar();
+#endif
+
     // 显示欢迎信息
-    const char* welcome_msg = "Welcome! Click START to begin.\r\n";
-    lv_textarea_set_text(_text_area_ttl, welcome_msg);
-    _current_text_len = strlen(welcome_msg);
+    _terminal.clear();
+    _terminal.append("Welcome! Click START to begin.\r\n"
+                     "Long press START to run " SCRIPT_FILE ".\r\n"
+                     "Long press STOP to bridge UART1 and a USB CDC device.\r\n"
+                     "Long press SETTING to switch between text and hex view.\r\n");
+    setViewMode(_view_mode);
+    selectPort(0);
     
     ESP_LOGI(TAG, "UART TTL application started");
     return true;
@@ -182,8 +312,10 @@ bool UARTTTL::close(void)
         vTaskDelay(pdMS_TO_TICKS(100));  // 等待当前定时器回调完成
     }
     
-    // 2. 停止UART服务
+    // 2. 停止脚本和UART服务
     ESP_LOGI(TAG, "Stopping UART service...");
+    stopBridge();
+    stopScript();
     _uart_service.stopReceiving();
     
     // 3. 等待UART服务完全停止
@@ -195,16 +327,27 @@ bool UARTTTL::close(void)
         lv_timer_del(_update_timer);
         _update_timer = nullptr;
     }
+    if (_autobaud_timer) {
+        lv_timer_del(_autobaud_timer);
+        _autobaud_timer = nullptr;
+    }
     
-    // 5. 重置状态变量
-    _current_text_len = 0;
-    
-    // 6. 清理TextArea内容，防止内存泄漏
-    if (_text_area_ttl && lv_obj_is_valid(_text_area_ttl)) {
-        lv_textarea_set_text(_text_area_ttl, "");
+    // 5. 删除终端控件，清空回滚文本
+    stopExtraPorts();
+    _terminal.destroy();
+    _terminal.clear();
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        _extra_ports[i]->terminal.destroy();
+        _extra_ports[i]->terminal.clear();
     }
+    if (_port_bar && lv_obj_is_valid(_port_bar)) {
+        lv_obj_del(_port_bar);
+    }
+    _port_bar = nullptr;
+#endif
     
-    // 7. 清空UI引用
+    // 6. 清空UI引用
     _text_area_ttl = nullptr;
     
     ESP_LOGI(TAG, "UART TTL app cleanup completed successfully");
@@ -223,6 +366,16 @@ bool UARTTTL::resume(void)
     return true;
 }
 
+bool UARTTTL::displayStateChanged(ESP_Brookesia_CoreDisplayState_t state)
+{
+    // 屏幕关闭后继续接收和记录，UI定时器只是很少唤醒，一次读空缓冲区
+    if (_update_timer) {
+        _pacer.setBackground(state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF);
+    }
+
+    return true;
+}
+
 void UARTTTL::extraUiInit(void)
 {
     // 获取UI控件指针
@@ -234,9 +387,13 @@ void UARTTTL::extraUiInit(void)
     _text_area_ttl = ui_TextAreaTTL;
     
     // 绑定按钮事件回调函数
-    lv_obj_add_event_cb(btn_start, onButtonStartClicked, LV_EVENT_CLICKED, this);
-    lv_obj_add_event_cb(btn_stop, onButtonStopClicked, LV_EVENT_CLICKED, this);
-    lv_obj_add_event_cb(btn_setting, onButtonSettingsClicked, LV_EVENT_CLICKED, this);
+    lv_obj_add_event_cb(btn_start, onButtonStartClicked, LV_EVENT_SHORT_CLICKED, this);
+    lv_obj_add_event_cb(btn_start, onButtonStartLongPressed, LV_EVENT_LONG_PRESSED, this);
+    lv_obj_add_event_cb(btn_stop, onButtonStopClicked, LV_EVENT_SHORT_CLICKED, this);
+    lv_obj_add_event_cb(btn_stop, onButtonStopLongPressed, LV_EVENT_LONG_PRESSED, this);
+    // 长按时LVGL仍会发送CLICKED，短按才启动、停止服务或打开设置
+    lv_obj_add_event_cb(btn_setting, onButtonSettingsClicked, LV_EVENT_SHORT_CLICKED, this);
+    lv_obj_add_event_cb(btn_setting, onButtonSettingsLongPressed, LV_EVENT_LONG_PRESSED, this);
     lv_obj_add_event_cb(btn_exit, onButtonExitClicked, LV_EVENT_CLICKED, this);
     lv_obj_add_event_cb(switch_heartbeat, onSwitchHeartbeatToggled, LV_EVENT_VALUE_CHANGED, this);
 
@@ -256,6 +413,14 @@ void UARTTTL::extraUiInit(void)
 
 void UARTTTL::setupSettingsScreenEvents()
 {
+    // 追加抓取模式的波特率选项
+    char option[16];
+    for (size_t i = BAUDRATE_SQUARELINE_COUNT; i < sizeof(baudrate_options)/sizeof(int); ++i) {
+        snprintf(option, sizeof(option), "%d", baudrate_options[i]);
+        lv_dropdown_add_option(ui_DropdownTTLSettingBaudrate, option, LV_DROPDOWN_POS_LAST);
+    }
+    lv_dropdown_add_option(ui_DropdownTTLSettingBaudrate, "Auto", LV_DROPDOWN_POS_LAST);
+
     // 绑定设置屏幕相关事件
     lv_obj_add_event_cb(ui_ScreenSettings, onScreenSettingsLoaded, LV_EVENT_SCREEN_LOADED, this);
     lv_obj_add_event_cb(ui_ButtonTTLSettingsApply, onButtonSettingsApplyClicked, LV_EVENT_CLICKED, this);
@@ -284,31 +449,40 @@ void UARTTTL::uiUpdateTimerCb(lv_timer_t *timer)
         return;
     }
 
-    // 处理接收到的UART数据
-    if (app->_uart_service.available() > 0)
-    {
-        char local_buf[MAX_UI_UPDATE_LEN + 1];
-        size_t total_read_len = 0;
-        
-        // 批量读取数据，避免频繁的小数据包读取
-        while(app->_uart_service.available() > 0 && total_read_len < MAX_UI_UPDATE_LEN) {
-            size_t len = app->_uart_service.read((uint8_t*)local_buf + total_read_len, 
-                                               MAX_UI_UPDATE_LEN - total_read_len);
-            if(len > 0) {
-                total_read_len += len;
-            } else {
-                break;
-            }
+    // 处理接收到的UART数据，直接把接收缓冲区中的数据追加到终端；
+    // 桥接时接收缓冲区由桥接任务读取，只显示转发的数据
+    size_t total_read_len = 0;
+    size_t budget = app->_pacer.budget();
+    if (app->_bridge.isRunning()) {
+        total_read_len = app->updateBridge();
+    } else {
+        app->skipBacklog();
+    }
+    while (!app->_bridge.isRunning() && total_read_len < budget) {
+        const uint8_t* data = nullptr;
+        size_t len = app->_uart_service.peek(&data);
+        if (len == 0) {
+            break;
         }
-        
-        if (total_read_len > 0) {
-            // 使用改进的文本处理方法
-            app->addTextToDisplayImproved(local_buf, total_read_len);
+        if (len > budget - total_read_len) {
+            len = budget - total_read_len;
         }
+        app->displayData(data, len);
+        app->_uart_service.consume(len);
+        total_read_len += len;
+    }
+    size_t extra_read_len = app->updateExtraPorts(budget);
+    app->_pacer.endTick((extra_read_len > total_read_len) ? extra_read_len : total_read_len);
+
+    // 一个周期没有新数据，输出不满的十六进制行或结束当前帧
+    if (total_read_len == 0 && app->_view_mode != VIEW_TEXT) {
+        app->_hex_dump.idle();
     }
     
-    // 处理心跳包发送（仅在开启心跳功能时）
-    if (app->_heartbeat_enabled && 
+    app->checkScript();
+
+    // 处理心跳包发送（仅在开启心跳功能时），脚本运行和桥接时暂停，以免混入它们的收发
+    if (app->_heartbeat_enabled && !app->_script_active && !app->_bridge.isRunning() &&
         lv_tick_elaps(app->_last_tx_timestamp) >= HEARTBEAT_INTERVAL_MS) {
         
         // 增加心跳包计数器
@@ -342,17 +516,22 @@ void UARTTTL::onButtonStartClicked(lv_event_t* e)
     
     // 启动UART接收服务
     app->_uart_service.startReceiving();
+    app->_hex_dump.reset();
     
     // 恢复UI更新定时器
-    lv_timer_resume(app->_update_timer);
+    app->resumeUpdates();
     
     // 重置心跳包时间戳和计数器
     app->_last_tx_timestamp = 0;
     app->_heartbeat_counter = 0;  // 重置心跳包计数器
 
     // 添加系统消息
-    const char* msg = "\r\n[System] Service started.\r\n";
+    const char* msg = app->_uart_service.isCaptureMode() ?
+        "\r\n[System] Service started in DMA capture mode (RX only).\r\n" :
+        "\r\n[System] Service started.\r\n";
     app->addTextToDisplay(msg);
+    app->startCapture();
+    app->startExtraPorts();
 
     // 更新按钮状态
     lv_obj_add_state(ui_ButtonTTLStart, LV_STATE_DISABLED);
@@ -361,12 +540,39 @@ void UARTTTL::onButtonStartClicked(lv_event_t* e)
     ESP_LOGI(TAG, "UART service started");
 }
 
+// 加载SD卡上的脚本，启动服务后运行
+void UARTTTL::onButtonStartLongPressed(lv_event_t *e)
+{
+    UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
+
+    if (lv_obj_has_state(ui_ButtonTTLStart, LV_STATE_DISABLED)) {
+        return;
+    }
+    if (app->_current_config.dma_capture) {
+        app->addTextToDisplay("\r\n[Script] Not available in DMA capture mode (RX only).\r\n");
+        return;
+    }
+    if (!app->_script.load(SCRIPT_FILE)) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "\r\n[Script] %s\r\n", app->_script.getMessage());
+        app->addTextToDisplay(msg);
+        return;
+    }
+
+    onButtonStartClicked(e);
+    app->startScript();
+}
+
 void UARTTTL::onButtonStopClicked(lv_event_t *e)
 {
     UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
     
-    // 停止UART接收服务
+    // 停止桥接、脚本和UART接收服务
+    app->stopBridge();
+    app->stopScript();
     app->_uart_service.stopReceiving();
+    app->stopCapture();
+    app->stopExtraPorts();
     
     // 暂停UI更新定时器
     lv_timer_pause(app->_update_timer);
@@ -382,12 +588,35 @@ void UARTTTL::onButtonStopClicked(lv_event_t *e)
     ESP_LOGI(TAG, "UART service stopped");
 }
 
+// 运行中长按STOP切换桥接模式
+void UARTTTL::onButtonStopLongPressed(lv_event_t *e)
+{
+    UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
+
+    if (lv_obj_has_state(ui_ButtonTTLStop, LV_STATE_DISABLED)) {
+        return;
+    }
+    if (app->_bridge.isRunning()) {
+        app->stopBridge();
+    } else {
+        app->startBridge();
+    }
+}
+
 void UARTTTL::onButtonSettingsClicked(lv_event_t *e)
 {
     ESP_LOGD(TAG, "Settings button clicked, switching to settings screen");
     lv_scr_load(ui_ScreenSettings);
 }
 
+void UARTTTL::onButtonSettingsLongPressed(lv_event_t *e)
+{
+    UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
+
+    app->setViewMode((app->_view_mode + 1) % VIEW_MODE_COUNT);
+    app->saveSettings();
+}
+
 void UARTTTL::onButtonExitClicked(lv_event_t *e)
 {
     UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
@@ -420,11 +649,12 @@ void UARTTTL::onSwitchHeartbeatToggled(lv_event_t *e)
 void UARTTTL::onScreenSettingsLoaded(lv_event_t *e)
 {
     UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
-    ESP_LOGD(TAG, "Settings screen loaded, updating dropdown values");
+    const UartConfig& config = app->portConfig(app->_selected_port);
+    ESP_LOGD(TAG, "Settings screen loaded, updating dropdown values of port %u", (unsigned int)app->_selected_port);
     
     // 根据当前配置设置波特率下拉框
     for(size_t i = 0; i < sizeof(baudrate_options)/sizeof(int); ++i) {
-        if(baudrate_options[i] == app->_current_config.baud_rate) {
+        if(baudrate_options[i] == config.baud_rate) {
             lv_dropdown_set_selected(ui_DropdownTTLSettingBaudrate, i);
             break;
         }
@@ -432,7 +662,7 @@ void UARTTTL::onScreenSettingsLoaded(lv_event_t *e)
     
     // 设置数据位下拉框
     for(size_t i = 0; i < sizeof(databits_options)/sizeof(uart_word_length_t); ++i) {
-        if(databits_options[i] == app->_current_config.data_bits) {
+        if(databits_options[i] == config.data_bits) {
             lv_dropdown_set_selected(ui_DropdownTTLSettingDatabits, i);
             break;
         }
@@ -440,7 +670,7 @@ void UARTTTL::onScreenSettingsLoaded(lv_event_t *e)
     
     // 设置校验位下拉框
     for(size_t i = 0; i < sizeof(parity_options)/sizeof(uart_parity_t); ++i) {
-        if(parity_options[i] == app->_current_config.parity) {
+        if(parity_options[i] == config.parity) {
             lv_dropdown_set_selected(ui_DropdownTTLSettingParity, i);
             break;
         }
@@ -448,7 +678,7 @@ void UARTTTL::onScreenSettingsLoaded(lv_event_t *e)
     
     // 设置停止位下拉框
     for(size_t i = 0; i < sizeof(stopbits_options)/sizeof(uart_stop_bits_t); ++i) {
-        if(stopbits_options[i] == app->_current_config.stop_bits) {
+        if(stopbits_options[i] == config.stop_bits) {
             lv_dropdown_set_selected(ui_DropdownTTLSettingStopbits, i);
             break;
         }
@@ -458,32 +688,44 @@ void UARTTTL::onScreenSettingsLoaded(lv_event_t *e)
 void UARTTTL::onButtonSettingsApplyClicked(lv_event_t *e)
 {
     UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
+    uint32_t index = app->_selected_port;
+    UartConfig& config = app->portConfig(index);
+    UartService& service = app->portService(index);
     
     // 从下拉框获取新的配置参数
     uint16_t idx = lv_dropdown_get_selected(ui_DropdownTTLSettingBaudrate);
-    app->_current_config.baud_rate = baudrate_options[idx];
+    bool auto_baud = (idx >= BAUDRATE_AUTO_INDEX);
+    if (!auto_baud) {
+        config.baud_rate = baudrate_options[idx];
+    } else if (config.baud_rate >= UART_CAPTURE_MIN_BAUD) {
+        // 自动波特率需要安装UART驱动，从普通模式的波特率开始
+        config.baud_rate = 115200;
+    }
     
     idx = lv_dropdown_get_selected(ui_DropdownTTLSettingDatabits);
-    app->_current_config.data_bits = databits_options[idx];
+    config.data_bits = databits_options[idx];
     
     idx = lv_dropdown_get_selected(ui_DropdownTTLSettingParity);
-    app->_current_config.parity = parity_options[idx];
+    config.parity = parity_options[idx];
 
     idx = lv_dropdown_get_selected(ui_DropdownTTLSettingStopbits);
-    app->_current_config.stop_bits = stopbits_options[idx];
+    config.stop_bits = stopbits_options[idx];
+
+    // 高波特率使用DMA抓取模式（只接收，心跳包不发送），附加端口不用
+    config.dma_capture = (index == 0 && config.baud_rate >= UART_CAPTURE_MIN_BAUD);
 
     // 保存配置到NVS
     app->saveSettings();
     
     // [修复问题1] 智能重配置UART服务
     ESP_LOGI(TAG, "Applying new UART configuration: %d %d%s%d", 
-             app->_current_config.baud_rate,
-             (app->_current_config.data_bits == UART_DATA_8_BITS) ? 8 : 
-             (app->_current_config.data_bits == UART_DATA_7_BITS) ? 7 : 
-             (app->_current_config.data_bits == UART_DATA_6_BITS) ? 6 : 5,
-             (app->_current_config.parity == UART_PARITY_DISABLE) ? "N" :
-             (app->_current_config.parity == UART_PARITY_EVEN) ? "E" : "O",
-             (app->_current_config.stop_bits == UART_STOP_BITS_1) ? 1 : 2);
+             config.baud_rate,
+             (config.data_bits == UART_DATA_8_BITS) ? 8 : 
+             (config.data_bits == UART_DATA_7_BITS) ? 7 : 
+             (config.data_bits == UART_DATA_6_BITS) ? 6 : 5,
+             (config.parity == UART_PARITY_DISABLE) ? "N" :
+             (config.parity == UART_PARITY_EVEN) ? "E" : "O",
+             (config.stop_bits == UART_STOP_BITS_1) ? 1 : 2);
     
     // 检查服务当前是否正在运行（通过按钮状态判断）
     bool was_running = lv_obj_has_state(ui_ButtonTTLStart, LV_STATE_DISABLED);
@@ -494,32 +736,37 @@ void UARTTTL::onButtonSettingsApplyClicked(lv_event_t *e)
         
         // 暂停定时器和接收
         lv_timer_pause(app->_update_timer);
-        app->_uart_service.stopReceiving();
+        service.stopReceiving();
         
         // 等待停止完成
         vTaskDelay(pdMS_TO_TICKS(100));
         
         // 重新配置UART服务
-        app->_uart_service.reconfigure(app->_current_config);
+        service.reconfigure(config);
         
         // 等待配置完成
         vTaskDelay(pdMS_TO_TICKS(50));
         
         // 重启服务
-        app->_uart_service.startReceiving();
-        lv_timer_resume(app->_update_timer);
+        service.startReceiving();
+        app->resumeUpdates();
         
         // 显示重配置消息
         const char* reconfig_msg = "\r\n[System] Configuration updated and service restarted.\r\n";
-        app->addTextToDisplay(reconfig_msg);
+        app->addTextToPort(index, reconfig_msg);
         
         ESP_LOGI(TAG, "Hot reconfiguration completed successfully");
     } else {
         // 如果没有运行，只需重配置即可
         ESP_LOGI(TAG, "Service is stopped, performing cold reconfiguration...");
-        app->_uart_service.reconfigure(app->_current_config);
+        service.reconfigure(config);
         ESP_LOGI(TAG, "Cold reconfiguration completed");
     }
+
+    // 检测出波特率后由autoBaudTimerCb保存
+    if (auto_baud) {
+        app->startAutoBaud(index);
+    }
     
     ESP_LOGI(TAG, "UART configuration applied and saved");
     
@@ -527,175 +774,528 @@ void UARTTTL::onButtonSettingsApplyClicked(lv_event_t *e)
     lv_scr_load(ui_ScreenTTL);
 }
 
+void UARTTTL::startAutoBaud(uint32_t index)
+{
+    // 一次只检测一个端口
+    if (portService(_autobaud_port).getAutoBaudState() == UART_AUTOBAUD_RUNNING ||
+        !portService(index).startAutoBaud()) {
+        addTextToPort(index, "\r\n[System] Auto baud is not available.\r\n");
+        return;
+    }
+    _autobaud_port = index;
+    addTextToPort(index, "\r\n[System] Detecting baud rate, keep the target sending...\r\n");
+    lv_timer_resume(_autobaud_timer);
+}
+
+void UARTTTL::autoBaudTimerCb(lv_timer_t *timer)
+{
+    UARTTTL* app = static_cast<UARTTTL*>(timer->user_data);
+    int rate = 0;
+    UartAutoBaudState state = app->portService(app->_autobaud_port).getAutoBaudState(&rate);
+    if (state == UART_AUTOBAUD_RUNNING) {
+        return;
+    }
+    lv_timer_pause(timer);
+
+    char msg[96];
+    if (state == UART_AUTOBAUD_DONE) {
+        // 波特率已由服务切换，只需更新配置
+        app->portConfig(app->_autobaud_port).baud_rate = rate;
+        app->saveSettings();
+        snprintf(msg, sizeof(msg), "\r\n[System] Baud rate detected: %d.\r\n", rate);
+    } else {
+        snprintf(msg, sizeof(msg), "\r\n[System] No baud rate detected, keeping %d.\r\n", rate);
+    }
+    app->addTextToPort(app->_autobaud_port, msg);
+}
+
 void UARTTTL::onButtonSettingsBackClicked(lv_event_t *e)
 {
     ESP_LOGD(TAG, "Settings back button clicked, returning to main screen");
     lv_scr_load(ui_ScreenTTL);
 }
 
-// [新增] 智能文本管理 - 添加文本到显示区域
+// 添加文本到终端
 void UARTTTL::addTextToDisplay(const char* text)
 {
-    if (!text || !_text_area_ttl) {
+    _terminal.append(text);
+}
+
+void UARTTTL::addTextToPort(uint32_t index, const char* text)
+{
+    portTerminal(index).append(text);
+}
+
+UartService& UARTTTL::portService(uint32_t index)
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    if (index > 0 && index < UART_TTL_PORT_COUNT) {
+        return _extra_ports[index - 1]->service;
+    }
+#endif
+    return _uart_service;
+}
+
+UartConfig& UARTTTL::portConfig(uint32_t index)
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    if (index > 0 && index < UART_TTL_PORT_COUNT) {
+        return _extra_ports[index - 1]->config;
+    }
+#endif
+    return _current_config;
+}
+
+TerminalView& UARTTTL::portTerminal(uint32_t index)
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    if (index > 0 && index < UART_TTL_PORT_COUNT) {
+        return _extra_ports[index - 1]->terminal;
+    }
+#endif
+    return _terminal;
+}
+
+// 附加端口的接收数据追加到各自的终端，隐藏的终端不重绘；返回读取最多的端口的字节数
+size_t UARTTTL::updateExtraPorts(size_t budget)
+{
+    size_t max_read = 0;
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        ExtraPort* port = _extra_ports[i];
+
+        // UI跟不上时丢掉最旧的数据，与第一个端口相同
+        size_t skip = _pacer.skipCount(port->service.available());
+        while (skip > 0) {
+            const uint8_t* data = nullptr;
+            size_t len = port->service.peek(&data);
+            if (len == 0) {
+                break;
+            }
+            if (len > skip) {
+                len = skip;
+            }
+            port->service.consume(len);
+            port->lag.add(len);
+            skip -= len;
+        }
+        uint32_t skipped = port->lag.take();
+        if (skipped > 0) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "\r\n[System] Display lagging, %lu bytes skipped%s.\r\n",
+                     (unsigned long)skipped, port->capture.isCapturing() ? " (recorded to SD card)" : "");
+            port->terminal.append(msg);
+        }
+
+        size_t total = 0;
+        while (total < budget) {
+            const uint8_t* data = nullptr;
+            size_t len = port->service.peek(&data);
+            if (len == 0) {
+                break;
+            }
+            if (len > budget - total) {
+                len = budget - total;
+            }
+            port->terminal.append((const char*)data, len);
+            port->service.consume(len);
+            total += len;
+        }
+        if (total > max_read) {
+            max_read = total;
+        }
+    }
+#endif
+    return max_read;
+}
+
+// 附加端口与第一个端口一起启动，各自记录到SD卡
+void UARTTTL::startExtraPorts()
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        ExtraPort* port = _extra_ports[i];
+        port->service.startReceiving();
+        port->lag.reset();
+        port->terminal.append("\r\n[System] Service started.\r\n");
+#if CONFIG_SERIAL_CAPTURE_SD
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "TTL%d", i + 2);
+        if (!port->capture.isCapturing() && port->capture.start(prefix, CONFIG_SERIAL_CAPTURE_SD_FLUSH_MS)) {
+            port->service.setCaptureSink(&port->capture);
+
+            char msg[80];
+            snprintf(msg, sizeof(msg), "[System] Recording to %s\r\n", port->capture.getPath());
+            port->terminal.append(msg);
+        }
+#endif
+    }
+#endif
+}
+
+void UARTTTL::stopExtraPorts()
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    for (int i = 0; i < CONFIG_UART_TTL_EXTRA_PORTS; i++) {
+        ExtraPort* port = _extra_ports[i];
+        if (port == nullptr || !port->service.isReceiving()) {
+            continue;
+        }
+        port->service.stopReceiving();
+        port->service.setCaptureSink(nullptr);
+        port->capture.stop();
+        port->terminal.append("\r\n[System] Service stopped.\r\n");
+    }
+#endif
+}
+
+// 在文本区域上方创建端口切换栏
+void UARTTTL::createPortBar()
+{
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    _port_bar = lv_btnmatrix_create(lv_obj_get_parent(_text_area_ttl));
+    lv_obj_set_size(_port_bar, lv_obj_get_width(_text_area_ttl), PORT_BAR_HEIGHT);
+    lv_obj_align_to(_port_bar, _text_area_ttl, LV_ALIGN_OUT_TOP_MID, 0, 0);
+    lv_obj_set_style_pad_all(_port_bar, 2, 0);
+    lv_obj_set_style_text_font(_port_bar, &lv_font_montserrat_12, 0);
+
+    for (uint32_t i = 0; i < UART_TTL_PORT_COUNT; i++) {
+        snprintf(_port_labels[i], sizeof(_port_labels[i]), "UART%d", portService(i).getPort().port);
+        _port_map[i] = _port_labels[i];
+    }
+    lv_btnmatrix_set_map(_port_bar, _port_map);
+    lv_btnmatrix_set_btn_ctrl_all(_port_bar, LV_BTNMATRIX_CTRL_CHECKABLE);
+    lv_btnmatrix_set_one_checked(_port_bar, true);
+    lv_obj_add_event_cb(_port_bar, onPortBarChanged, LV_EVENT_VALUE_CHANGED, this);
+#endif
+}
+
+// 切换显示和设置的端口，其他端口在后台继续接收和记录
+void UARTTTL::selectPort(uint32_t index)
+{
+    if (index >= UART_TTL_PORT_COUNT) {
         return;
     }
-    
-    size_t text_len = strlen(text);
-    
-    // 检查是否需要智能清理文本区域
-    if (_current_text_len + text_len > TEXT_AREA_CLEAR_TRIGGER) {
-        smartTextAreaClear();
+
+    _selected_port = index;
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    _terminal.setVisible(index == 0);
+    for (uint32_t i = 1; i < UART_TTL_PORT_COUNT; i++) {
+        _extra_ports[i - 1]->terminal.setVisible(i == index);
     }
-    
-    // 添加新文本
-    lv_textarea_add_text(_text_area_ttl, text);
-    _current_text_len += text_len;
-    
-    // 自动滚动到底部
-    lv_obj_scroll_to_y(_text_area_ttl, LV_COORD_MAX, LV_ANIM_OFF);
-    
-    ESP_LOGD(TAG, "Added %zu chars, total: %zu chars", text_len, _current_text_len);
+    if (_port_bar) {
+        lv_btnmatrix_set_btn_ctrl(_port_bar, index, LV_BTNMATRIX_CTRL_CHECKED);
+        lv_obj_move_foreground(_port_bar);
+    }
+#endif
 }
 
-// [新增] 改进的文本处理函数 - 处理数据截断和字符过滤问题
-void UARTTTL::addTextToDisplayImproved(const char* text, size_t actual_len)
+void UARTTTL::onPortBarChanged(lv_event_t *e)
 {
-    // [修复显示问题] 增强安全检查
-    if (!text || actual_len == 0) {
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    UARTTTL* app = static_cast<UARTTTL*>(lv_event_get_user_data(e));
+    uint16_t index = lv_btnmatrix_get_selected_btn(app->_port_bar);
+
+    if (index != LV_BTNMATRIX_BTN_NONE) {
+        app->selectPort(index);
+    }
+#endif
+}
+
+// 按当前显示方式显示接收的数据
+void UARTTTL::displayData(const uint8_t* data, size_t len)
+{
+    if (_view_mode == VIEW_TEXT) {
+        _terminal.append((const char*)data, len);
+    } else {
+        _hex_dump.feed(data, len);
+    }
+}
+
+// 切换显示方式，十六进制的偏移和未完成的帧重新开始
+void UARTTTL::setViewMode(uint32_t mode)
+{
+    static const char* const mode_names[VIEW_MODE_COUNT] = {
+        "text", "hex", "hex, Modbus RTU frames", "hex, SLIP frames"
+    };
+    FrameDecoder* decoders[VIEW_MODE_COUNT] = {
+        nullptr, nullptr, &_modbus_decoder, &_slip_decoder
+    };
+
+    // 先输出尚未显示的数据
+    if (_view_mode != VIEW_TEXT) {
+        _hex_dump.idle();
+    }
+    _view_mode = mode;
+    _hex_dump.setDecoder(decoders[mode]);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "\r\n[System] View: %s\r\n", mode_names[mode]);
+    addTextToDisplay(msg);
+    ESP_LOGI(TAG, "View mode %s", mode_names[mode]);
+}
+
+// 运行已加载的脚本，脚本作为接收旁路，与显示并行收到同样的数据
+void UARTTTL::startScript()
+{
+    if (!_script.start(scriptWrite, &_uart_service)) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "[Script] Failed to start: %s\r\n", _script.getMessage());
+        addTextToDisplay(msg);
         return;
     }
-    
-    // 检查UI对象是否有效
-    if (!_text_area_ttl || !lv_obj_is_valid(_text_area_ttl)) {
-        ESP_LOGW(TAG, "TextArea UI object is invalid, skipping text addition");
+    _uart_service.setRxTap(&_script);
+    _script_active = true;
+    addTextToDisplay("[Script] Running " SCRIPT_FILE "\r\n");
+}
+
+void UARTTTL::stopScript()
+{
+    if (_script_active) {
+        _script.stop();
+        checkScript();
+    }
+}
+
+// 脚本结束后摘下接收旁路并显示结果，在UI定时器中调用
+void UARTTTL::checkScript()
+{
+    if (!_script_active || _script.isRunning()) {
         return;
     }
-    
-    // 限制最大处理长度，防止内存问题
-    if (actual_len > MAX_UI_UPDATE_LEN) {
-        ESP_LOGW(TAG, "Text too long (%zu), truncating to %d", actual_len, MAX_UI_UPDATE_LEN);
-        actual_len = MAX_UI_UPDATE_LEN;
+    _uart_service.setRxTap(nullptr);
+    _script_active = false;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "\r\n[Script] %s: %s\r\n",
+             (_script.getState() == SerialScript::STATE_PASSED) ? "PASS" : "FAIL", _script.getMessage());
+    addTextToDisplay(msg);
+}
+
+// 脚本任务中调用，UART驱动的发送缓冲满时阻塞
+size_t UARTTTL::scriptWrite(void* ctx, const uint8_t* data, size_t len)
+{
+    static_cast<UartService*>(ctx)->write(data, len);
+    return len;
+}
+
+// UART配置换算成USB CDC的串口参数，桥接的两端使用相同的参数
+static TinyUsbCdcService::SerialConfig toCdcConfig(const UartConfig& config)
+{
+    TinyUsbCdcService::SerialConfig cdc_config = {
+        .baud_rate = (uint32_t)config.baud_rate,
+        .data_bits = (uint8_t)(5 + (config.data_bits - UART_DATA_5_BITS)),
+        .parity = (uint8_t)((config.parity == UART_PARITY_ODD) ? 1 : (config.parity == UART_PARITY_EVEN) ? 2 : 0),
+        .stop_bits = (uint8_t)((config.stop_bits == UART_STOP_BITS_1_5) ? 1 : (config.stop_bits == UART_STOP_BITS_2) ? 2 : 0),
+    };
+    return cdc_config;
+}
+
+// 桥接UART1与第一个找到的USB CDC设备，数据由桥接任务转发，UI只显示
+void UARTTTL::startBridge()
+{
+    if (_current_config.dma_capture) {
+        addTextToDisplay("\r\n[Bridge] Not available in DMA capture mode (RX only).\r\n");
+        return;
     }
-    
-    // 创建处理后的文本缓冲区，加强内存安全
-    char* processed_text = (char*)malloc(actual_len + 128);  // 更多额外空间
-    if (!processed_text) {
-        ESP_LOGE(TAG, "Failed to allocate memory for text processing (%zu bytes)", actual_len + 128);
+    if (_script_active) {
+        addTextToDisplay("\r\n[Bridge] Not available while a script is running.\r\n");
         return;
     }
-    
-    // 初始化缓冲区
-    memset(processed_text, 0, actual_len + 128);
-    
-    size_t processed_len = 0;
-    
-    // 逐字节处理，确保文本显示正确
-    for (size_t i = 0; i < actual_len; i++) {
-        char c = text[i];
-        
-        // 处理不可打印字符
-        if (c == '\0') {
-            break;  // 遇到null terminator停止
-        } else if (c == '\r') {
-            // Windows风格的回车符，转换为换行符
-            processed_text[processed_len++] = '\n';
-        } else if (c == '\n') {
-            // Unix风格的换行符，直接保留
-            processed_text[processed_len++] = '\n';
-        } else if (c >= 32 && c <= 126) {
-            // 可打印ASCII字符
-            processed_text[processed_len++] = c;
+    if (!_usb_service.begin()) {
+        addTextToDisplay("\r\n[Bridge] USB host unavailable.\r\n");
+        return;
+    }
+
+    _usb_service.setHeartbeatEnabled(false);
+    _usb_service.setCurrentConfig(toCdcConfig(_current_config));
+    _usb_service.startScan();
+    if (!_bridge.start(&_uart_service, &_usb_service, true)) {
+        _usb_service.stopScan();
+        addTextToDisplay("\r\n[Bridge] Failed to start.\r\n");
+        return;
+    }
+    _bridge_direction = -1;
+    _bridge_usb_connected = false;
+
+#if CONFIG_SERIAL_CAPTURE_SD
+    // UART收到的数据已在记录，USB设备发来的数据记录到另一个文件
+    if (_capture.isCapturing() && _bridge_capture.start("USB", CONFIG_SERIAL_CAPTURE_SD_FLUSH_MS)) {
+        _usb_service.setCaptureSink(&_bridge_capture);
+    }
+#endif
+
+    addTextToDisplay("\r\n[Bridge] UART1 <-> USB CDC started, waiting for a USB device...\r\n");
+}
+
+void UARTTTL::stopBridge()
+{
+    if (!_bridge.isRunning()) {
+        return;
+    }
+
+    uint32_t not_displayed = 0;
+    for (int dir = 0; dir < SerialBridge::DIRECTION_COUNT; dir++) {
+        ByteRing* monitor = _bridge.getMonitor((SerialBridge::Direction)dir);
+        if (monitor) {
+            not_displayed += monitor->getStats().dropped;
+        }
+    }
+
+    _bridge.stop();
+#if CONFIG_SERIAL_CAPTURE_SD
+    _usb_service.setCaptureSink(nullptr);
+    _bridge_capture.stop();
+#endif
+    _usb_service.stopScan();
+    _usb_service.forceDisconnectDevice();
+    if (_view_mode != VIEW_TEXT) {
+        _hex_dump.idle();
+    }
+
+    SerialBridge::Stats stats = _bridge.getStats();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "\r\n[Bridge] Stopped: %lu bytes UART->USB, %lu bytes USB->UART, "
+             "%lu discarded, %lu not displayed\r\n",
+             (unsigned long)stats.forwarded[SerialBridge::UART_TO_USB],
+             (unsigned long)stats.forwarded[SerialBridge::USB_TO_UART],
+             (unsigned long)stats.discarded, (unsigned long)not_displayed);
+    addTextToDisplay(msg);
+}
+
+// 显示桥接转发的数据，方向改变时先输出方向标签；返回显示的字节数
+size_t UARTTTL::updateBridge()
+{
+    static const char* const labels[SerialBridge::DIRECTION_COUNT] = {
+        "\r\n[Bridge] UART -> USB\r\n", "\r\n[Bridge] USB -> UART\r\n"
+    };
+
+    bool connected = _usb_service.isConnected();
+    if (connected != _bridge_usb_connected) {
+        _bridge_usb_connected = connected;
+        if (connected) {
+            _usb_service.configureDeviceSpecific();
+
+            char msg[128];
+            snprintf(msg, sizeof(msg), "\r\n[Bridge] USB device connected: %s (VID:0x%04X PID:0x%04X)\r\n",
+                     _usb_service.getDeviceTypeName(), _usb_service.getDeviceVid(), _usb_service.getDevicePid());
+            addTextToDisplay(msg);
         } else {
-            // 过滤掉所有其他字符（包括UTF-8），避免乱码
-            // 如果是控制字符或高位字符，跳过不添加
-            continue;
+            addTextToDisplay("\r\n[Bridge] USB device disconnected.\r\n");
         }
     }
-    
-    // 确保以换行符结束（如果原文本没有的话）
-    if (processed_len > 0 && processed_text[processed_len - 1] != '\n') {
-        processed_text[processed_len++] = '\n';
+
+    size_t budget = _pacer.budget();
+    size_t total = 0;
+    for (int dir = 0; dir < SerialBridge::DIRECTION_COUNT; dir++) {
+        ByteRing* monitor = _bridge.getMonitor((SerialBridge::Direction)dir);
+        while (monitor && total < budget) {
+            const uint8_t* data = nullptr;
+            size_t len = monitor->readSpan(&data);
+            if (len == 0) {
+                break;
+            }
+            if (len > budget - total) {
+                len = budget - total;
+            }
+            if (dir != _bridge_direction) {
+                if (_view_mode != VIEW_TEXT) {
+                    _hex_dump.idle();
+                    _hex_dump.reset();
+                }
+                addTextToDisplay(labels[dir]);
+                _bridge_direction = dir;
+            }
+            displayData(data, len);
+            monitor->releaseRead(len);
+            total += len;
+        }
     }
-    
-    processed_text[processed_len] = '\0';
-    
-    // 检查是否需要智能清理文本区域
-    if (_current_text_len + processed_len > TEXT_AREA_CLEAR_TRIGGER) {
-        smartTextAreaClear();
+    return total;
+}
+
+// 按当前接收模式设置刷新节奏，然后恢复UI更新定时器
+void UARTTTL::resumeUpdates()
+{
+    RxPacer::Config config = {
+        .period_ms = UI_UPDATE_PERIOD_MS,
+        .idle_period_ms = CONFIG_SERIAL_UI_IDLE_PERIOD_MS,
+        .burst_period_ms = UI_UPDATE_PERIOD_MS * 2,
+        .batch = MAX_UI_READ_PER_TICK,
+        .max_batch = CONFIG_SERIAL_UI_MAX_BATCH_KB * 1024,
+        // 抓取模式下积压到一半接收块时就跳过，接收块用完后DMA停止，SD卡记录也会丢数据
+        .skip_threshold = _uart_service.isCaptureMode() ?
+            (size_t)UART_CAPTURE_BLOCK_SIZE * UART_CAPTURE_BLOCK_COUNT / 2 : (size_t)RX_RING_BUFFER_SIZE * 3 / 4,
+    };
+    _pacer.begin(_update_timer, config);
+    _lag.reset();
+    lv_timer_resume(_update_timer);
+}
+
+// UI跟不上时丢掉接收缓冲区中最旧的数据，不显示，汇总后提示跳过的字节数
+void UARTTTL::skipBacklog()
+{
+    size_t skip = _pacer.skipCount(_uart_service.available());
+    if (skip > 0) {
+        while (skip > 0) {
+            const uint8_t* data = nullptr;
+            size_t len = _uart_service.peek(&data);
+            if (len == 0) {
+                break;
+            }
+            if (len > skip) {
+                len = skip;
+            }
+            _uart_service.consume(len);
+            _lag.add(len);
+            skip -= len;
+        }
+        // 跳过的位置不在帧边界上，解码从新数据重新开始
+        if (_view_mode != VIEW_TEXT) {
+            _hex_dump.reset();
+        }
+    }
+
+    uint32_t skipped = _lag.take();
+    if (skipped > 0) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "\r\n[System] Display lagging, %lu bytes skipped%s.\r\n",
+                 (unsigned long)skipped, _capture.isCapturing() ? " (recorded to SD card)" : "");
+        addTextToDisplay(msg);
     }
-    
-    // 添加处理后的文本
-    lv_textarea_add_text(_text_area_ttl, processed_text);
-    _current_text_len += processed_len;
-    
-    // 自动滚动到底部
-    lv_obj_scroll_to_y(_text_area_ttl, LV_COORD_MAX, LV_ANIM_OFF);
-    
-    ESP_LOGD(TAG, "Added %zu chars (processed from %zu), total: %zu chars", 
-             processed_len, actual_len, _current_text_len);
-    
-    free(processed_text);
 }
 
-// [新增] 智能清理文本区域 - 保留最新内容
-void UARTTTL::smartTextAreaClear(void)
+// 开始把接收数据记录到SD卡，未启用CONFIG_SERIAL_CAPTURE_SD时不做任何事
+void UARTTTL::startCapture()
 {
-    if (!_text_area_ttl) {
+#if CONFIG_SERIAL_CAPTURE_SD
+    if (_capture.isCapturing()) {
         return;
     }
-    
-    ESP_LOGI(TAG, "Text area approaching limit (%zu chars), performing smart cleanup...", _current_text_len);
-    
-    // 获取当前文本内容
-    const char* current_text = lv_textarea_get_text(_text_area_ttl);
-    if (!current_text) {
-        _current_text_len = 0;
+    if (!_capture.start("TTL", CONFIG_SERIAL_CAPTURE_SD_FLUSH_MS)) {
+        addTextToDisplay("[System] SD card recording unavailable.\r\n");
         return;
     }
-    
-    size_t current_len = strlen(current_text);
-    
-    if (current_len <= TEXT_AREA_KEEP_LEN) {
-        // 如果当前文本已经很短，直接返回
-        _current_text_len = current_len;
+    _uart_service.setCaptureSink(&_capture);
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "[System] Recording to %s\r\n", _capture.getPath());
+    addTextToDisplay(msg);
+#endif
+}
+
+// 停止记录，必须先摘下接收端的记录对象再关闭文件
+void UARTTTL::stopCapture()
+{
+#if CONFIG_SERIAL_CAPTURE_SD
+    if (!_capture.isCapturing()) {
         return;
     }
-    
-    // 计算要保留的起始位置（保留最后的TEXT_AREA_KEEP_LEN字符）
-    size_t keep_start = current_len - TEXT_AREA_KEEP_LEN;
-    
-    // 尝试从完整行开始保留（寻找换行符）
-    const char* line_start = current_text + keep_start;
-    const char* next_newline = strchr(line_start, '\n');
-    if (next_newline && (next_newline - current_text) < current_len - 100) {
-        // 找到换行符且不是太靠近末尾，从下一行开始
-        keep_start = (next_newline + 1) - current_text;
-    }
-    
-    // 添加清理提示信息
-    const char* cleanup_msg = "[System] Text buffer optimized - showing recent messages...\n";
-    
-    // 创建新的文本内容
-    char* new_content = (char*)malloc(strlen(cleanup_msg) + (current_len - keep_start) + 1);
-    if (new_content) {
-        strcpy(new_content, cleanup_msg);
-        strcat(new_content, current_text + keep_start);
-        
-        // 设置新内容
-        lv_textarea_set_text(_text_area_ttl, new_content);
-        _current_text_len = strlen(new_content);
-        
-        // 自动滚动到底部
-        lv_obj_scroll_to_y(_text_area_ttl, LV_COORD_MAX, LV_ANIM_OFF);
-        
-        ESP_LOGI(TAG, "Text cleanup completed: %zu -> %zu chars (saved %zu chars)", 
-                 current_len, _current_text_len, current_len - _current_text_len);
-        
-        free(new_content);
-    } else {
-        // 内存不足时的简单清理
-        ESP_LOGW(TAG, "Memory insufficient for smart cleanup, using simple clear");
-        lv_textarea_set_text(_text_area_ttl, cleanup_msg);
-        _current_text_len = strlen(cleanup_msg);
-    }
-}
\ No newline at end of file
+    _uart_service.setCaptureSink(nullptr);
+    _capture.stop();
+
+    SerialCapture::Stats stats = _capture.getStats();
+    ESP_LOGI(TAG, "Recorded %lu bytes to %s, %lu dropped", (unsigned long)stats.bytes,
+             _capture.getPath(), (unsigned long)stats.dropped);
+#endif
+}
@@ -3,10 +3,20 @@
 #include "esp_brookesia.hpp"
 #include "lvgl.h"
 #include "UartService.hpp"
+#include "terminal_view/TerminalView.hpp"
+#include "serial_capture/SerialCapture.hpp"
+#include "hex_dump/HexDump.hpp"
+#include "serial_script/SerialScript.hpp"
+#include "serial_bridge/SerialBridge.hpp"
+#include "uart_usb/TinyUsbCdcService.hpp"
+#include "rx_pacer/RxPacer.hpp"
 #include "nvs_flash.h"
+#include "sdkconfig.h"
 
 extern "C" void uart_ttl_ui_init(void);
 
+#define UART_TTL_PORT_COUNT (1 + CONFIG_UART_TTL_EXTRA_PORTS)  // 第一个端口之外是附加端口
+
 /**
  * @class UARTTTL
  * @brief UART TTL调试工具应用类
@@ -26,8 +36,18 @@ public:
     bool back(void) override;
     bool close(void) override;
     bool resume(void) override;
+    bool displayStateChanged(ESP_Brookesia_CoreDisplayState_t state) override;
 
 private:
+    // 接收数据的显示方式，长按设置按钮切换
+    enum ViewMode {
+        VIEW_TEXT = 0,                  // 文本
+        VIEW_HEX,                       // 十六进制
+        VIEW_HEX_MODBUS,                // 十六进制，按Modbus RTU分帧
+        VIEW_HEX_SLIP,                  // 十六进制，按SLIP分帧
+        VIEW_MODE_COUNT,
+    };
+
     // UI初始化相关方法
     void extraUiInit(void);
     void setupSettingsScreenEvents(void);
@@ -35,13 +55,17 @@ private:
     // 静态回调函数（用于LVGL事件处理）
     static void uiUpdateTimerCb(lv_timer_t *timer);
     static void onButtonStartClicked(lv_event_t *e);
+    static void onButtonStartLongPressed(lv_event_t *e);
     static void onButtonStopClicked(lv_event_t *e);
+    static void onButtonStopLongPressed(lv_event_t *e);
     static void onButtonExitClicked(lv_event_t *e);
     static void onButtonSettingsClicked(lv_event_t *e);
+    static void onButtonSettingsLongPressed(lv_event_t *e);
     static void onSwitchHeartbeatToggled(lv_event_t *e);
     static void onScreenSettingsLoaded(lv_event_t *e);
     static void onButtonSettingsApplyClicked(lv_event_t *e);
     static void onButtonSettingsBackClicked(lv_event_t *e);
+    static void autoBaudTimerCb(lv_timer_t *timer);
     
     // NVS存储操作方法
     void loadSettings();
@@ -49,17 +73,86 @@ private:
     
     // [新增] 文本处理方法
     void addTextToDisplay(const char* text);
-    void addTextToDisplayImproved(const char* text, size_t actual_len);
-    void smartTextAreaClear(void);
+    void setViewMode(uint32_t mode);
+
+    // SD卡原始数据记录
+    void startCapture();
+    void stopCapture();
+
+    // 收发脚本
+    void startScript();
+    void stopScript();
+    void checkScript();
+    static size_t scriptWrite(void* ctx, const uint8_t* data, size_t len);
+
+    // UART1与USB CDC设备桥接
+    void startBridge();
+    void stopBridge();
+    size_t updateBridge();
+    void displayData(const uint8_t* data, size_t len);
+
+    // 自动波特率检测
+    void startAutoBaud(uint32_t index);
+
+    // 多端口：第一个端口是_uart_service，附加端口只以文本显示和记录，
+    // 脚本、桥接、心跳和十六进制显示只在第一个端口上
+    UartService& portService(uint32_t index);
+    UartConfig& portConfig(uint32_t index);
+    TerminalView& portTerminal(uint32_t index);
+    void addTextToPort(uint32_t index, const char* text);
+    void loadPortSettings(uint32_t index);
+    void savePortSettings(uint32_t index);
+    size_t updateExtraPorts(size_t budget);
+    void startExtraPorts();
+    void stopExtraPorts();
+    void createPortBar();
+    void selectPort(uint32_t index);
+    static void onPortBarChanged(lv_event_t *e);
+
+    // 刷新节奏
+    void resumeUpdates();
+    void skipBacklog();
 
     // 成员变量
     UartService _uart_service;          // UART服务对象
     lv_timer_t* _update_timer;          // UI更新定时器
-    lv_obj_t*   _text_area_ttl;         // 文本显示区域控件指针
+    lv_timer_t* _autobaud_timer;        // 查询自动波特率检测结果
+    lv_obj_t*   _text_area_ttl;         // SquareLine文本区域，作为终端的占位控件
+    TerminalView _terminal;             // 接收数据显示终端
+    SerialCapture _capture;             // 接收数据SD卡记录
+    HexDump     _hex_dump;              // 十六进制显示
+    ModbusRtuDecoder _modbus_decoder;
+    SlipDecoder _slip_decoder;
+    SerialScript _script;               // 长按START运行的收发脚本
     uint32_t    _last_tx_timestamp;     // 上次发送心跳包的时间戳
-    size_t      _current_text_len;      // 当前文本区域的文本长度
     UartConfig  _current_config;        // 当前UART配置
     nvs_handle_t _nvs_handle;           // NVS存储句柄
     bool        _heartbeat_enabled;     // 心跳包发送开关状态
     uint32_t    _heartbeat_counter;     // 心跳包序号计数器
+    uint32_t    _view_mode;             // ViewMode
+    bool        _script_active;         // 脚本已启动，结果尚未显示
+    TinyUsbCdcService _usb_service;     // 桥接的USB CDC设备
+    SerialCapture _bridge_capture;      // 桥接时USB设备发来的数据的SD卡记录
+    SerialBridge _bridge;
+    int         _bridge_direction;      // 最后显示的桥接方向，-1为还没有显示
+    bool        _bridge_usb_connected;
+    RxPacer     _pacer;                 // UI更新定时器的周期和每次读取量
+    RxLagReport _lag;                   // UI跟不上时跳过的字节数
+    uint32_t    _autobaud_port;         // 正在检测波特率的端口
+    uint32_t    _selected_port;         // 显示和设置的端口
+#if CONFIG_UART_TTL_EXTRA_PORTS
+    // 附加端口，各自有UART驱动、接收任务、终端和SD卡记录
+    struct ExtraPort {
+        explicit ExtraPort(const UartPort& port) : service(port) {}
+        UartService   service;
+        UartConfig    config;
+        TerminalView  terminal;         // 隐藏时继续接收文本但不重绘
+        SerialCapture capture;
+        RxLagReport   lag;
+    };
+    ExtraPort*  _extra_ports[CONFIG_UART_TTL_EXTRA_PORTS];
+    lv_obj_t*   _port_bar;              // 端口切换栏
+    char        _port_labels[UART_TTL_PORT_COUNT][16];
+    const char* _port_map[UART_TTL_PORT_COUNT + 1];
+#endif
 };
\ No newline at end of file
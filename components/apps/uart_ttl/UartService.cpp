@@ -1,14 +1,58 @@
 #include "UartService.hpp"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "serial_capture/SerialCapture.hpp"
+#include "serial_tap/SerialRxTap.hpp"
+#include "task_config/task_config.h"
+#include "hal/uart_ll.h"
 #include <string.h>
 
+#define UART_CAPTURE_ALIGN      (128)        // 接收块按缓存行对齐，DMA写入后驱动按缓存行同步
+#define UART_AUTOBAUD_MAX_ERROR (50)         // 候选波特率可接受的最大错误率（千分比）
+
+// 自动波特率检测的候选波特率，不超过抓取模式的波特率
+static const int AUTOBAUD_RATES[] = {
+    1200, 2400, 4800, 9600, 14400, 19200, 38400, 57600, 74880, 115200,
+    230400, 250000, 460800, 500000, 921600, 1000000, 1500000
+};
+
 static const char* TAG = "UartService";
 
-UartService::UartService() : 
-    _rx_ring_buffer(nullptr), 
+// 默认端口：UART TTL应用的第一个端口，使用普通接收任务的配置
+static const UartPort DEFAULT_PORT = {
+    .port = UART_SERVICE_PORT,
+    .tx_pin = UART_SERVICE_TX_PIN,
+    .rx_pin = UART_SERVICE_RX_PIN,
+    .rx_task = TASK_CONFIG_UART_RX,
+};
+
+UartService::UartService() : UartService(DEFAULT_PORT)
+{
+}
+
+UartService::UartService(const UartPort& port) : 
+    _port(port),
     _rx_task_handle(nullptr), 
-    _is_running(false)
+    _is_running(false),
+    _capture_sink(nullptr),
+    _rx_tap(nullptr),
+    _rx_notify(nullptr),
+    _uart_queue(nullptr),
+    _baud_rate(0),
+    _autobaud_state(UART_AUTOBAUD_IDLE),
+    _capture_mode(false),
+    _uhci_ctrl(nullptr),
+    _capture_head(0),
+    _capture_tail(0),
+    _capture_armed(false),
+    _capture_offset(0),
+    _capture_stalled(false),
+    _tee_block(0),
+    _tee_offset(0)
 {
+    memset(_capture_blocks, 0, sizeof(_capture_blocks));
+    memset((void*)_capture_fill, 0, sizeof(_capture_fill));
+    memset(&_capture_stats, 0, sizeof(_capture_stats));
 }
 
 UartService::~UartService()
@@ -19,7 +63,7 @@ UartService::~UartService()
 void UartService::begin(const UartConfig& initial_config)
 {
     // 先尝试删除可能残留的UART驱动实例（增加健壮性）
-    uart_driver_delete(UART_SERVICE_PORT);
+    uart_driver_delete(_port.port);
     
     // 配置UART参数
     uart_config_t uart_config = {
@@ -31,31 +75,40 @@ void UartService::begin(const UartConfig& initial_config)
         .source_clk = UART_SCLK_DEFAULT,
     };
     
-    ESP_LOGI(TAG, "Initializing UART on port %d: TX=%d, RX=%d, Baud=%d", 
-             UART_SERVICE_PORT, UART_SERVICE_TX_PIN, UART_SERVICE_RX_PIN, uart_config.baud_rate);
+    ESP_LOGI(TAG, "Initializing UART on port %d: TX=%d, RX=%d, Baud=%d%s", 
+             _port.port, _port.tx_pin, _port.rx_pin, uart_config.baud_rate,
+             initial_config.dma_capture ? " (DMA capture)" : "");
+    
+    _is_running = false;
+    _baud_rate = initial_config.baud_rate;
+    _autobaud_state.store(UART_AUTOBAUD_IDLE);
+    if (initial_config.dma_capture) {
+        if (!beginCapture(uart_config)) {
+            ESP_LOGE(TAG, "Failed to start capture mode, halting service initialization");
+        }
+        return;
+    }
     
-    // 安装UART驱动
-    ESP_ERROR_CHECK(uart_driver_install(UART_SERVICE_PORT, UART_DRIVER_BUF_SIZE, 0, 0, NULL, 0));
-    ESP_ERROR_CHECK(uart_param_config(UART_SERVICE_PORT, &uart_config));
-    ESP_ERROR_CHECK(uart_set_pin(UART_SERVICE_PORT, UART_SERVICE_TX_PIN, UART_SERVICE_RX_PIN, 
+    // 安装UART驱动，事件队列只在自动波特率检测时读取，满了驱动就不再放入
+    ESP_ERROR_CHECK(uart_driver_install(_port.port, UART_DRIVER_BUF_SIZE, UART_DRIVER_TX_BUF_SIZE,
+                                        UART_EVENT_QUEUE_SIZE, &_uart_queue, 0));
+    ESP_ERROR_CHECK(uart_param_config(_port.port, &uart_config));
+    ESP_ERROR_CHECK(uart_set_pin(_port.port, _port.tx_pin, _port.rx_pin, 
                                   UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
 
     // 创建接收数据的环形缓冲区
-    _rx_ring_buffer = xRingbufferCreate(RX_RING_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
-    if (_rx_ring_buffer == nullptr) {
+    if (!_rx_ring.init(RX_RING_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) {
         ESP_LOGE(TAG, "Failed to create ring buffer, halting service initialization");
-        uart_driver_delete(UART_SERVICE_PORT);
+        uart_driver_delete(_port.port);
         return;
     }
 
     // 创建UART接收任务
-    _is_running = false;
-    BaseType_t result = xTaskCreate(uartRxTask, "uart_rx_task", 4096, this, 10, &_rx_task_handle);
+    BaseType_t result = task_config_create(_port.rx_task, uartRxTask, this, &_rx_task_handle);
     if (result != pdPASS || _rx_task_handle == nullptr) {
         ESP_LOGE(TAG, "Failed to create UART RX task!");
-        vRingbufferDelete(_rx_ring_buffer);
-        _rx_ring_buffer = nullptr;
-        uart_driver_delete(UART_SERVICE_PORT);
+        _rx_ring.deinit();
+        uart_driver_delete(_port.port);
         return;
     }
 
@@ -68,20 +121,27 @@ void UartService::end()
     // 停止接收
     _is_running = false;
     
+    // 抓取模式先删除UHCI控制器，之后不会再有接收中断通知抓取任务
+    bool capture_mode = _capture_mode;
+    if (capture_mode) {
+        endCapture();
+    }
+    
     // 删除接收任务
     if (_rx_task_handle) { 
-        vTaskDelete(_rx_task_handle); 
+        task_config_delete(_capture_mode ? TASK_CONFIG_UART_CAPTURE : _port.rx_task, _rx_task_handle); 
         _rx_task_handle = nullptr; 
     }
     
-    // 删除环形缓冲区
-    if (_rx_ring_buffer) { 
-        vRingbufferDelete(_rx_ring_buffer); 
-        _rx_ring_buffer = nullptr; 
+    if (!capture_mode) {
+        // 删除环形缓冲区
+        _rx_ring.deinit();
+        
+        // 卸载UART驱动，事件队列随驱动删除
+        uart_driver_delete(_port.port);
+        _uart_queue = nullptr;
     }
-    
-    // 卸载UART驱动
-    uart_driver_delete(UART_SERVICE_PORT);
+    _autobaud_state.store(UART_AUTOBAUD_IDLE);
     
     ESP_LOGI(TAG, "UART service shut down successfully");
 }
@@ -90,16 +150,8 @@ void UartService::reconfigure(const UartConfig& new_config)
 {
     ESP_LOGI(TAG, "Reconfiguring UART service with new parameters");
     
-    // 停止并彻底清理旧的服务
-    if (_rx_task_handle) { 
-        vTaskDelete(_rx_task_handle); 
-        _rx_task_handle = nullptr; 
-    }
-    if (_rx_ring_buffer) { 
-        vRingbufferDelete(_rx_ring_buffer); 
-        _rx_ring_buffer = nullptr; 
-    }
-    uart_driver_delete(UART_SERVICE_PORT);
+    // 停止并彻底清理旧的服务，普通模式和抓取模式之间也可以切换
+    end();
 
     // 使用新配置重新初始化服务
     begin(new_config);
@@ -109,6 +161,9 @@ void UartService::reconfigure(const UartConfig& new_config)
 void UartService::startReceiving()
 {
     _is_running = true;
+    if (_capture_mode && _rx_task_handle) {
+        xTaskNotifyGive(_rx_task_handle);  // 立即启动DMA接收
+    }
     ESP_LOGD(TAG, "UART receiving started");
 }
 
@@ -120,59 +175,469 @@ void UartService::stopReceiving()
 
 size_t UartService::read(uint8_t* buffer, size_t max_len)
 {
-    if (!_rx_ring_buffer || max_len == 0) {
-        return 0;
+    size_t copied = 0;
+    
+    while (copied < max_len) {
+        const uint8_t* data = nullptr;
+        size_t len = peek(&data);
+        if (len == 0) {
+            break;
+        }
+        if (len > max_len - copied) {
+            len = max_len - copied;
+        }
+        memcpy(buffer + copied, data, len);
+        consume(len);
+        copied += len;
+    }
+    return copied;
+}
+
+size_t UartService::peek(const uint8_t** data)
+{
+    if (!_capture_mode) {
+        return _rx_ring.readSpan(data);
     }
     
-    size_t item_size = 0;
-    uint8_t *item = (uint8_t*)xRingbufferReceive(_rx_ring_buffer, &item_size, (TickType_t)0);
-    if (item != nullptr) {
-        size_t copy_len = (max_len < item_size) ? max_len : item_size;
-        memcpy(buffer, item, copy_len);
-        vRingbufferReturnItem(_rx_ring_buffer, (void*)item);
-        return copy_len;
+    while (true) {
+        uint32_t tail = _capture_tail.load(std::memory_order_relaxed);
+        uint32_t head = _capture_head.load(std::memory_order_acquire);
+        
+        // 块还没开始接收时长度是上一轮的，不能读取
+        if (tail == head && !_capture_armed.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        
+        uint32_t index = tail % UART_CAPTURE_BLOCK_COUNT;
+        size_t fill = _capture_fill[index];
+        if (_capture_offset < fill) {
+            *data = _capture_blocks[index] + _capture_offset;
+            return fill - _capture_offset;
+        }
+        if (tail == head) {
+            return 0;  // 正在接收的块已读完
+        }
+        
+        // 接收完的块已读完，交还给DMA
+        _capture_offset = 0;
+        _capture_tail.store(tail + 1, std::memory_order_release);
+        xTaskNotifyGive(_rx_task_handle);
+    }
+}
+
+void UartService::consume(size_t len)
+{
+    if (!_capture_mode) {
+        _rx_ring.releaseRead(len);
+        return;
     }
-    return 0;
+    
+    // 读完的块在下一次peek时交还
+    _capture_offset += len;
 }
 
 size_t UartService::available()
 {
-    if (!_rx_ring_buffer) {
-        return 0;
+    if (!_capture_mode) {
+        return _rx_ring.available();
     }
     
-    size_t free_size = xRingbufferGetCurFreeSize(_rx_ring_buffer);
-    return RX_RING_BUFFER_SIZE - free_size;
+    uint32_t tail = _capture_tail.load(std::memory_order_relaxed);
+    uint32_t head = _capture_head.load(std::memory_order_acquire);
+    size_t total = 0;
+    for (uint32_t block = tail; block != head; block++) {
+        total += _capture_fill[block % UART_CAPTURE_BLOCK_COUNT];
+    }
+    if (_capture_armed.load(std::memory_order_acquire)) {
+        total += _capture_fill[head % UART_CAPTURE_BLOCK_COUNT];
+    }
+    return (total > _capture_offset) ? total - _capture_offset : 0;
 }
 
 void UartService::write(const uint8_t* data, size_t len)
 {
+    // 抓取模式没有安装UART驱动，只接收
+    if (_capture_mode) {
+        return;
+    }
     if (len > 0) {
-        uart_write_bytes(UART_SERVICE_PORT, (const char*)data, len);
+        uart_write_bytes(_port.port, (const char*)data, len);
     }
 }
 
-void UartService::uartRxTask(void* arg)
+size_t UartService::txFree()
+{
+    size_t free_size = 0;
+    if (!_capture_mode && uart_get_tx_buffer_free_size(_port.port, &free_size) != ESP_OK) {
+        free_size = 0;
+    }
+    return free_size;
+}
+
+bool UartService::startAutoBaud()
+{
+    if (_capture_mode || _rx_task_handle == nullptr || _uart_queue == nullptr) {
+        return false;
+    }
+    if (_autobaud_state.exchange(UART_AUTOBAUD_RUNNING) == UART_AUTOBAUD_RUNNING) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Auto baud detection requested");
+    return true;
+}
+
+UartAutoBaudState UartService::getAutoBaudState(int* rate) const
+{
+    UartAutoBaudState state = (UartAutoBaudState)_autobaud_state.load(std::memory_order_acquire);
+    if (rate) {
+        *rate = _baud_rate;
+    }
+    return state;
+}
+
+// 最接近的候选波特率，按比例比较
+static int nearestBaudRate(int rate)
+{
+    int best = AUTOBAUD_RATES[0];
+    float best_ratio = 0;
+    for (size_t i = 0; i < sizeof(AUTOBAUD_RATES) / sizeof(AUTOBAUD_RATES[0]); i++) {
+        float ratio = (rate > AUTOBAUD_RATES[i]) ? (float)rate / AUTOBAUD_RATES[i] : (float)AUTOBAUD_RATES[i] / rate;
+        if (i == 0 || ratio < best_ratio) {
+            best = AUTOBAUD_RATES[i];
+            best_ratio = ratio;
+        }
+    }
+    return best;
+}
+
+int UartService::measureBaudRate()
+{
+    uart_dev_t* hw = UART_LL_GET_HW(_port.port);
+    uint32_t sclk_freq = 0;
+    if (uart_get_sclk_freq(UART_SCLK_DEFAULT, &sclk_freq) != ESP_OK || sclk_freq == 0) {
+        return 0;
+    }
+
+    // 重新使能时计数清零，之后记录RX上最短的高低电平脉宽（时钟周期数）
+    uart_ll_set_autobaud_en(hw, false);
+    uart_ll_set_autobaud_en(hw, true);
+    TickType_t start = xTaskGetTickCount();
+    while (uart_ll_get_rxd_edge_cnt(hw) < UART_AUTOBAUD_MIN_EDGES &&
+           xTaskGetTickCount() - start < pdMS_TO_TICKS(UART_AUTOBAUD_MEASURE_MS)) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    uint32_t edges = uart_ll_get_rxd_edge_cnt(hw);
+    uint32_t low = uart_ll_get_low_pulse_cnt(hw);
+    uint32_t high = uart_ll_get_high_pulse_cnt(hw);
+    uart_ll_set_autobaud_en(hw, false);
+
+    if (edges < UART_AUTOBAUD_MIN_EDGES) {
+        ESP_LOGW(TAG, "Auto baud: only %u edges on RX, line idle", (unsigned int)edges);
+        return 0;
+    }
+
+    // 最短的脉冲是一位，数据中没有单独的0或1时是两位，由候选的二倍值覆盖
+    uint32_t bit_cycles = ((low < high) ? low : high) + 1;
+    int rate = (int)(sclk_freq / bit_cycles);
+    ESP_LOGI(TAG, "Auto baud: %u edges, low %u, high %u cycles, ~%d baud",
+             (unsigned int)edges, (unsigned int)low, (unsigned int)high, rate);
+    return rate;
+}
+
+int UartService::scoreBaudRate(int rate, uint8_t* scratch, size_t scratch_len)
+{
+    // 只修改波特率，驱动和缓冲区不变
+    if (uart_set_baudrate(_port.port, rate) != ESP_OK) {
+        return -1;
+    }
+    uart_flush_input(_port.port);
+    xQueueReset(_uart_queue);
+
+    size_t bytes = 0;
+    uint32_t errors = 0;
+    TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(UART_AUTOBAUD_LISTEN_MS)) {
+        int len = uart_read_bytes(_port.port, scratch, scratch_len, pdMS_TO_TICKS(20));
+        if (len > 0) {
+            bytes += len;
+        }
+        uart_event_t event;
+        while (xQueueReceive(_uart_queue, &event, 0) == pdTRUE) {
+            if (event.type == UART_FRAME_ERR || event.type == UART_PARITY_ERR || event.type == UART_BREAK) {
+                errors++;
+            }
+        }
+    }
+
+    // 错误率（千分比），收到的字节太少时不计分
+    int score = (bytes < UART_AUTOBAUD_MIN_BYTES) ? -1 : (int)(errors * 1000 / bytes);
+    ESP_LOGI(TAG, "Auto baud: %d baud, %u bytes, %u errors", rate, (unsigned int)bytes, (unsigned int)errors);
+    return score;
+}
+
+void UartService::runAutoBaud()
+{
+    uint8_t scratch[256];
+    int original = _baud_rate;
+    int best = 0;
+    int best_score = UART_AUTOBAUD_MAX_ERROR + 1;
+
+    int estimate = measureBaudRate();
+    if (estimate > 0) {
+        int candidates[3] = { nearestBaudRate(estimate), nearestBaudRate(estimate * 2), nearestBaudRate(estimate / 2) };
+        for (int i = 0; i < 3; i++) {
+            // 跳过重复的候选
+            if ((i > 0 && candidates[i] == candidates[0]) || (i > 1 && candidates[i] == candidates[1])) {
+                continue;
+            }
+            int score = scoreBaudRate(candidates[i], scratch, sizeof(scratch));
+            if (score >= 0 && score < best_score) {
+                best = candidates[i];
+                best_score = score;
+            }
+        }
+    }
+
+    // 没有可用的候选时恢复原波特率
+    int rate = best ? best : original;
+    uart_set_baudrate(_port.port, rate);
+    uart_flush_input(_port.port);
+    _baud_rate = rate;
+    if (best) {
+        ESP_LOGI(TAG, "Auto baud: using %d baud (%d/1000 errors)", best, best_score);
+    } else {
+        ESP_LOGW(TAG, "Auto baud: no rate found, keeping %d baud", original);
+    }
+    _autobaud_state.store(best ? UART_AUTOBAUD_DONE : UART_AUTOBAUD_FAILED, std::memory_order_release);
+}
+
+bool UartService::beginCapture(const uart_config_t& uart_config)
+{
+    // UHCI直接使用UART硬件，不安装UART驱动
+    ESP_ERROR_CHECK(uart_param_config(_port.port, &uart_config));
+    ESP_ERROR_CHECK(uart_set_pin(_port.port, _port.tx_pin, _port.rx_pin, 
+                                  UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+
+    // 接收块放在PSRAM中，DMA直接写入，UI直接读取
+    for (int i = 0; i < UART_CAPTURE_BLOCK_COUNT; i++) {
+        _capture_blocks[i] = (uint8_t*)heap_caps_aligned_calloc(UART_CAPTURE_ALIGN, 1, UART_CAPTURE_BLOCK_SIZE,
+                                                                MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA);
+        if (_capture_blocks[i] == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate capture block %d", i);
+            endCapture();
+            return false;
+        }
+    }
+
+    // 空闲时结束传输，不满一块的数据也能及时显示
+    uhci_controller_config_t uhci_config = {};
+    uhci_config.uart_port = _port.port;
+    uhci_config.tx_trans_queue_depth = 1;
+    uhci_config.max_transmit_size = UART_CAPTURE_ALIGN;
+    uhci_config.max_receive_internal_mem = 16 * 1024;   // 多个DMA节点轮流接收
+    uhci_config.dma_burst_size = 32;
+    uhci_config.rx_eof_flags.idle_eof = 1;
+    if (uhci_new_controller(&uhci_config, &_uhci_ctrl) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create UHCI controller");
+        _uhci_ctrl = nullptr;
+        endCapture();
+        return false;
+    }
+    uhci_event_callbacks_t callbacks = {};
+    callbacks.on_rx_trans_event = onCaptureRxEvent;
+    ESP_ERROR_CHECK(uhci_register_event_callbacks(_uhci_ctrl, &callbacks, this));
+
+    _capture_head.store(0);
+    _capture_tail.store(0);
+    _capture_armed.store(false);
+    _capture_offset = 0;
+    _capture_stalled = false;
+    _tee_block = 0;
+    _tee_offset = 0;
+    memset(&_capture_stats, 0, sizeof(_capture_stats));
+    _capture_mode = true;
+
+    // 抓取任务只负责启动下一块的接收，优先级高于普通接收任务
+    BaseType_t result = task_config_create(TASK_CONFIG_UART_CAPTURE, captureTask, this, &_rx_task_handle);
+    if (result != pdPASS || _rx_task_handle == nullptr) {
+        ESP_LOGE(TAG, "Failed to create UART capture task!");
+        _rx_task_handle = nullptr;
+        endCapture();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "UART capture mode ready: %d blocks x %d KB in PSRAM",
+             UART_CAPTURE_BLOCK_COUNT, UART_CAPTURE_BLOCK_SIZE / 1024);
+    return true;
+}
+
+void UartService::endCapture()
+{
+    if (_uhci_ctrl) {
+        uhci_del_controller(_uhci_ctrl);
+        _uhci_ctrl = nullptr;
+    }
+    for (int i = 0; i < UART_CAPTURE_BLOCK_COUNT; i++) {
+        if (_capture_blocks[i]) {
+            heap_caps_free(_capture_blocks[i]);
+            _capture_blocks[i] = nullptr;
+        }
+    }
+    _capture_armed.store(false);
+    _capture_mode = false;
+}
+
+bool UartService::onCaptureRxEvent(uhci_controller_handle_t uhci_ctrl, const uhci_rx_event_data_t *edata,
+                                   void *user_ctx)
+{
+    UartService* self = static_cast<UartService*>(user_ctx);
+    uint32_t head = self->_capture_head.load(std::memory_order_relaxed);
+    uint32_t index = head % UART_CAPTURE_BLOCK_COUNT;
+    const uint8_t* base = self->_capture_blocks[index];
+    BaseType_t task_woken = pdFALSE;
+
+    // 数据已由DMA写进接收块，这里只更新已接收的长度
+    if (edata->data >= base && edata->data + edata->recv_size <= base + UART_CAPTURE_BLOCK_SIZE) {
+        uint32_t end = (uint32_t)(edata->data - base) + edata->recv_size;
+        if (end > self->_capture_fill[index]) {
+            self->_capture_stats.received += end - self->_capture_fill[index];
+            self->_capture_fill[index] = end;
+        }
+    }
+
+    // 传输结束（块满或线路空闲），由抓取任务启动下一块
+    if (edata->flags.totally_received) {
+        self->_capture_armed.store(false, std::memory_order_release);
+        self->_capture_head.store(head + 1, std::memory_order_release);
+        vTaskNotifyGiveFromISR(self->_rx_task_handle, &task_woken);
+    }
+    return task_woken == pdTRUE;
+}
+
+void UartService::teeCapture()
+{
+    SerialCapture* sink = _capture_sink;
+    SerialRxTap* tap = _rx_tap;
+    uint32_t head = _capture_head.load(std::memory_order_acquire);
+
+    while (true) {
+        uint32_t index = _tee_block % UART_CAPTURE_BLOCK_COUNT;
+        bool done = _tee_block != head;
+        if (!done && !_capture_armed.load(std::memory_order_acquire)) {
+            break;
+        }
+        
+        size_t fill = _capture_fill[index];
+        if (fill > _tee_offset) {
+            if (sink) {
+                sink->addData(_capture_blocks[index] + _tee_offset, fill - _tee_offset);
+            }
+            if (tap) {
+                tap->onRxData(_capture_blocks[index] + _tee_offset, fill - _tee_offset);
+            }
+            _tee_offset = fill;
+        }
+        if (!done) {
+            break;
+        }
+        _tee_block++;
+        _tee_offset = 0;
+    }
+}
+
+void UartService::captureTask(void* arg)
 {
     UartService* self = static_cast<UartService*>(arg);
-    uint8_t* buffer = (uint8_t*)malloc(UART_DRIVER_BUF_SIZE);
-    
-    if (buffer == nullptr) {
-        ESP_LOGE(TAG, "RX task failed to allocate memory, task exiting");
-        vTaskDelete(NULL);
-        return;
+
+    ESP_LOGI(TAG, "UART capture task started");
+
+    while (true) {
+        // 传输结束或UI交还接收块时被唤醒，定时检查运行状态
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        
+        // 接收块只由这个任务重新启动接收，交给记录器之前不会被覆盖
+        self->teeCapture();
+        if (!self->_is_running || self->_capture_armed.load(std::memory_order_acquire)) {
+            continue;
+        }
+
+        uint32_t head = self->_capture_head.load(std::memory_order_relaxed);
+        uint32_t tail = self->_capture_tail.load(std::memory_order_acquire);
+        if (head - tail >= UART_CAPTURE_BLOCK_COUNT) {
+            // 没有空闲接收块时等待UI读取（背压），期间FIFO溢出的数据丢失
+            if (!self->_capture_stalled) {
+                self->_capture_stalled = true;
+                self->_capture_stats.full_events++;
+            }
+            continue;
+        }
+        self->_capture_stalled = false;
+
+        // 记录积压的最大值
+        uint32_t pending = 0;
+        for (uint32_t block = tail; block != head; block++) {
+            pending += self->_capture_fill[block % UART_CAPTURE_BLOCK_COUNT];
+        }
+        if (pending > self->_capture_stats.high_water) {
+            self->_capture_stats.high_water = pending;
+        }
+
+        uint32_t index = head % UART_CAPTURE_BLOCK_COUNT;
+        self->_capture_fill[index] = 0;
+        self->_capture_armed.store(true, std::memory_order_release);
+        if (uhci_receive(self->_uhci_ctrl, self->_capture_blocks[index], UART_CAPTURE_BLOCK_SIZE) != ESP_OK) {
+            self->_capture_armed.store(false, std::memory_order_release);
+            ESP_LOGW(TAG, "Failed to start DMA receive, retrying");
+            vTaskDelay(pdMS_TO_TICKS(10));
+            xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+        }
     }
+}
+
+void UartService::uartRxTask(void* arg)
+{
+    UartService* self = static_cast<UartService*>(arg);
+    bool stalled = false;
 
     ESP_LOGI(TAG, "UART RX task started");
 
     while (true) {
+        // 自动波特率检测期间收到的数据不放入环形缓冲区
+        if (self->_autobaud_state.load(std::memory_order_acquire) == UART_AUTOBAUD_RUNNING) {
+            self->runAutoBaud();
+            continue;
+        }
         if (self->_is_running) {
+            // 直接读进环形缓冲区的空闲区域
+            uint8_t* span = nullptr;
+            size_t span_len = self->_rx_ring.writeSpan(&span);
+            if (span_len == 0) {
+                // 缓冲满时暂停读取（背压），数据暂存在UART驱动缓冲区中，等UI取走数据
+                if (!stalled) {
+                    stalled = true;
+                    self->_rx_ring.noteFull();
+                }
+                vTaskDelay(pdMS_TO_TICKS(5));
+                continue;
+            }
+            stalled = false;
+            
             // 尝试读取UART数据（带超时）
-            int rx_len = uart_read_bytes(UART_SERVICE_PORT, buffer, UART_DRIVER_BUF_SIZE, pdMS_TO_TICKS(20));
+            int rx_len = uart_read_bytes(self->_port.port, span, span_len, pdMS_TO_TICKS(20));
             if (rx_len > 0) {
-                // 将数据送入环形缓冲区
-                if (xRingbufferSend(self->_rx_ring_buffer, buffer, rx_len, (TickType_t)0) != pdTRUE) {
-                    ESP_LOGW(TAG, "Ring buffer full, %d bytes dropped", rx_len);
+                SerialCapture* sink = self->_capture_sink;
+                if (sink) {
+                    sink->addData(span, rx_len);
+                }
+                SerialRxTap* tap = self->_rx_tap;
+                if (tap) {
+                    tap->onRxData(span, rx_len);
+                }
+                self->_rx_ring.commitWrite(rx_len);
+
+                TaskHandle_t notify = self->_rx_notify;
+                if (notify) {
+                    xTaskNotifyGive(notify);
                 }
             }
         } else {
@@ -180,8 +645,4 @@ void UartService::uartRxTask(void* arg)
             vTaskDelay(pdMS_TO_TICKS(200));
         }
     }
-    
-    // 清理资源（理论上不会执行到这里）
-    free(buffer);
-    ESP_LOGI(TAG, "UART RX task ended");
-}
\ No newline at end of file
+}
@@ -2,10 +2,16 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
 #include "driver/uart.h"
+#include "driver/uhci.h"
+#include "byte_ring/ByteRing.hpp"
+#include "task_config/task_config.h"
+#include <atomic>
 
-// 硬件配置定义
+class SerialCapture;
+class SerialRxTap;
+
+// 硬件配置定义，默认端口
 // 已更新为由您最终选择的、接线方便的备用引脚
 #define UART_SERVICE_PORT       (UART_NUM_1) // 使用UART1端口
 #define UART_SERVICE_TX_PIN     (29)         // TX引脚: GPIO29
@@ -13,7 +19,20 @@
 
 // 缓冲区配置定义
 #define UART_DRIVER_BUF_SIZE    (4096)       // UART驱动缓冲区大小
-#define RX_RING_BUFFER_SIZE     (4096)       // 接收环形缓冲区大小
+#define UART_DRIVER_TX_BUF_SIZE (4096)       // UART驱动发送缓冲区大小，write放入后立即返回
+#define RX_RING_BUFFER_SIZE     (16384)      // 接收环形缓冲区大小，必须是2的幂
+
+// 抓取模式配置定义
+#define UART_CAPTURE_BLOCK_SIZE  (64 * 1024)  // 每个DMA接收块的大小（PSRAM）
+#define UART_CAPTURE_BLOCK_COUNT (16)         // 接收块数量，共1MB，4Mbaud下可缓冲约2.6秒
+#define UART_CAPTURE_MIN_BAUD    (2000000)    // UI在此波特率及以上自动使用抓取模式
+
+// 自动波特率配置定义
+#define UART_AUTOBAUD_MEASURE_MS (500)        // 测量脉宽的最长时间
+#define UART_AUTOBAUD_MIN_EDGES  (32)         // 至少这么多个边沿才估算波特率
+#define UART_AUTOBAUD_LISTEN_MS  (200)        // 每个候选波特率的接收时间
+#define UART_AUTOBAUD_MIN_BYTES  (16)         // 候选波特率至少收到这么多字节才计分
+#define UART_EVENT_QUEUE_SIZE    (32)         // 驱动事件队列，自动波特率用它统计帧错误
 
 /**
  * @struct UartConfig
@@ -24,6 +43,29 @@ struct UartConfig {
     uart_word_length_t data_bits;     // 数据位长度
     uart_parity_t parity;             // 校验位类型
     uart_stop_bits_t stop_bits;       // 停止位数量
+    bool dma_capture;                 // 抓取模式：UHCI/GDMA直接写入PSRAM，只接收不发送
+};
+
+/**
+ * @struct UartPort
+ * @brief 服务使用的UART端口、引脚和接收任务
+ */
+struct UartPort {
+    uart_port_t port;                 // UART端口号，每个服务实例一个
+    int tx_pin;                       // TX引脚
+    int rx_pin;                       // RX引脚
+    task_config_id_t rx_task;         // 接收任务，优先级和核心见任务配置表
+};
+
+/**
+ * @enum UartAutoBaudState
+ * @brief 自动波特率检测的状态
+ */
+enum UartAutoBaudState {
+    UART_AUTOBAUD_IDLE = 0,           // 没有检测
+    UART_AUTOBAUD_RUNNING,            // 接收任务正在检测
+    UART_AUTOBAUD_DONE,               // 已切换到检测出的波特率
+    UART_AUTOBAUD_FAILED,             // 线路空闲或没有可用的波特率，恢复原波特率
 };
 
 /**
@@ -31,13 +73,21 @@ struct UartConfig {
  * @brief UART串口服务类
  * 
  * 提供UART初始化、数据收发、动态重配置等功能。
- * 使用FreeRTOS任务和环形缓冲区来处理异步数据接收。
+ * 使用FreeRTOS任务和无锁字节环形缓冲区来处理异步数据接收，
+ * 接收任务直接把UART数据读进环形缓冲区，UI直接处理环形缓冲区中的数据。
+ * 抓取模式下不安装UART驱动，UHCI通过GDMA把数据依次写入PSRAM中的接收块，
+ * 用于无丢失地抓取3~4Mbaud的设备日志，接收过程几乎不占CPU。
+ * 每个实例管理一个UART端口，有自己的驱动事件队列、接收环形缓冲区和接收任务，
+ * 多个实例可以同时接收不同端口上的目标。
  */
 class UartService {
 public:
-    UartService();
+    UartService();                    // 使用默认端口UART_SERVICE_PORT
+    explicit UartService(const UartPort& port);
     ~UartService();
 
+    const UartPort& getPort() const { return _port; }
+
     /**
      * @brief 初始化UART服务
      * @param initial_config 初始UART配置参数
@@ -66,6 +116,19 @@ public:
      * @return 实际读取的字节数
      */
     size_t read(uint8_t *buffer, size_t max_len);
+
+    /**
+     * @brief 获取接收缓冲区中可读的连续数据，不拷贝
+     * @param data 输出数据地址，在consume之前有效
+     * @return 连续数据的字节数，0表示没有数据
+     */
+    size_t peek(const uint8_t **data);
+
+    /**
+     * @brief 释放peek得到的已处理数据
+     * @param len 字节数
+     */
+    void consume(size_t len);
     
     /**
      * @brief 获取可读数据的字节数
@@ -80,20 +143,106 @@ public:
      */
     void write(const uint8_t *data, size_t len);
 
+    /**
+     * @brief 获取驱动发送缓冲区的剩余空间，不超过它的write不会阻塞
+     * @return 剩余字节数，抓取模式下为0
+     */
+    size_t txFree();
+
     /**
      * @brief 动态重新配置UART服务
      * @param new_config 包含新串口参数的结构体
      */
     void reconfigure(const UartConfig& new_config);
 
+    /**
+     * @brief 获取接收统计
+     * @details 普通模式下缓冲满时接收任务暂停读取，数据留在驱动缓冲区中；
+     *          抓取模式下没有空闲接收块时DMA停止，FIFO溢出的数据丢失
+     */
+    /**
+     * @brief 开始自动波特率检测，立即返回
+     * @details 接收任务先用UART的自动波特率寄存器测量RX上最短的高低电平脉宽，估算波特率；
+     *          再把最接近估算值、两倍和一半的标准波特率依次用uart_set_baudrate设置，
+     *          按接收字节中帧错误和校验错误的比例计分，不重新安装驱动。
+     *          检测期间收到的数据被丢弃，抓取模式下不可用
+     * @return 是否已开始检测
+     */
+    bool startAutoBaud();
+
+    /**
+     * @brief 获取自动波特率检测的状态
+     * @param rate 输出当前使用的波特率，检测完成后为检测出的波特率，可为nullptr
+     * @return UartAutoBaudState
+     */
+    UartAutoBaudState getAutoBaudState(int* rate = nullptr) const;
+
+    const ByteRing::Stats& getRxStats() const { return _capture_mode ? _capture_stats : _rx_ring.getStats(); }
+
+    bool isCaptureMode() const { return _capture_mode; }
+
+    bool isReceiving() const { return _is_running; }
+
+    /**
+     * @brief 设置原始数据记录，接收任务把收到的每块数据交给它，与UI读取无关
+     * @param sink 记录器，nullptr为不记录
+     */
+    void setCaptureSink(SerialCapture* sink) { _capture_sink = sink; }
+
+    /**
+     * @brief 设置接收旁路（如脚本引擎），接收任务把收到的每块数据交给它
+     * @param tap 旁路，nullptr为不使用
+     */
+    void setRxTap(SerialRxTap* tap) { _rx_tap = tap; }
+
+    /**
+     * @brief 设置接收通知，接收任务每次把数据放入接收缓冲区后通知该任务
+     * @param task 读取接收缓冲区的任务（如桥接任务），nullptr为不通知
+     */
+    void setRxNotify(TaskHandle_t task) { _rx_notify = task; }
+
 private:
+    bool beginCapture(const uart_config_t& uart_config);
+    void teeCapture();
+    void endCapture();
+    static void captureTask(void* arg);
+    static bool onCaptureRxEvent(uhci_controller_handle_t uhci_ctrl, const uhci_rx_event_data_t *edata,
+                                 void *user_ctx);
+
+
     /**
      * @brief UART接收任务静态函数
      * @param arg 任务参数（UartService实例指针）
      */
     static void uartRxTask(void* arg);
+
+    // 自动波特率检测，只在接收任务中调用
+    void runAutoBaud();
+    int measureBaudRate();
+    int scoreBaudRate(int rate, uint8_t* scratch, size_t scratch_len);
     
-    RingbufHandle_t _rx_ring_buffer;   // 接收数据环形缓冲区
+    const UartPort  _port;             // 端口、引脚和接收任务
+    ByteRing        _rx_ring;          // 接收数据环形缓冲区
     TaskHandle_t    _rx_task_handle;   // 接收任务句柄
     volatile bool   _is_running;       // 服务运行状态标志
+    SerialCapture* volatile _capture_sink;  // 原始数据记录
+    SerialRxTap* volatile   _rx_tap;        // 接收旁路
+    TaskHandle_t volatile   _rx_notify;     // 接收通知
+    QueueHandle_t           _uart_queue;    // 驱动事件队列
+    volatile int            _baud_rate;     // 当前波特率
+    std::atomic<int>        _autobaud_state;    // UartAutoBaudState
+
+    // 抓取模式，接收块按序号循环使用：DMA写入_capture_head，UI读取_capture_tail
+    bool                    _capture_mode;
+    uhci_controller_handle_t _uhci_ctrl;
+    uint8_t*                _capture_blocks[UART_CAPTURE_BLOCK_COUNT];
+    volatile uint32_t       _capture_fill[UART_CAPTURE_BLOCK_COUNT];  // 每块已接收的字节数
+    std::atomic<uint32_t>   _capture_head;      // 正在接收或下一个要接收的块
+    std::atomic<uint32_t>   _capture_tail;      // UI正在读取的块
+    std::atomic<bool>       _capture_armed;     // _capture_head块正在接收
+    size_t                  _capture_offset;    // UI在_capture_tail块中已读取的字节数
+    bool                    _capture_stalled;
+    uint32_t                _tee_block;         // 已交给记录器的位置，只由抓取任务修改
+    size_t                  _tee_offset;
+    ByteRing::Stats         _capture_stats;     // 只由接收中断和抓取任务修改
 };
\ No newline at end of file
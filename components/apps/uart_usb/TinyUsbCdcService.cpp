@@ -4,26 +4,47 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
+#include "esp_heap_caps.h"
+#include "serial_capture/SerialCapture.hpp"
+#include "serial_tap/SerialRxTap.hpp"
+#include "task_config/task_config.h"
+#include "pm_policy/pm_policy.h"
 #include "usb/usb_host.h"
 #include "usb/cdc_acm_host.h"
 
 static const char* TAG = "UsbCdcService";
 
 // 初始化静态成员变量
-RingbufHandle_t TinyUsbCdcService::_s_rx_ring_buffer = nullptr;
-volatile bool   TinyUsbCdcService::_s_is_device_connected = false;
-cdc_acm_dev_hdl_t TinyUsbCdcService::_s_cdc_device_handle = nullptr;
-uint16_t TinyUsbCdcService::_s_device_vid = 0;
-uint16_t TinyUsbCdcService::_s_device_pid = 0;
+TaskHandle_t       TinyUsbCdcService::_s_host_task_handle = nullptr;
+int                TinyUsbCdcService::_s_host_users = 0;
+SemaphoreHandle_t  TinyUsbCdcService::_s_open_mutex = nullptr;
+TinyUsbCdcService* TinyUsbCdcService::_s_services[USB_CDC_MAX_DEVICES] = {};
 
 TinyUsbCdcService::TinyUsbCdcService() : 
-    _host_task_handle(nullptr), 
     _scan_task_handle(nullptr), 
     _heartbeat_task_handle(nullptr), 
+    _tx_task_handle(nullptr),
     _scan_task_should_stop(false),
     _heartbeat_task_should_stop(false),
-    _current_device_type(DEVICE_TYPE_UNKNOWN) 
+    _tx_task_should_stop(false),
+    _tx_mutex(nullptr),
+    _tx_sent(0),
+    _tx_transfers(0),
+    _tx_errors(0),
+    _tx_discarded(0),
+    _capture_sink(nullptr),
+    _rx_tap(nullptr),
+    _rx_notify(nullptr),
+    _is_device_connected(false),
+    _cdc_device_handle(nullptr),
+    _registered(false),
+    _device_vid(0),
+    _device_pid(0),
+    _current_device_type(DEVICE_TYPE_UNKNOWN),
+    _last_vid(0),
+    _last_pid(0),
+    _last_interface(0),
+    _last_device_type(DEVICE_TYPE_UNKNOWN)
 {
     // 初始化默认配置
     _current_config.baud_rate = 115200;
@@ -36,17 +57,21 @@ TinyUsbCdcService::TinyUsbCdcService() :
 }
 TinyUsbCdcService::~TinyUsbCdcService() { end(); }
 
-bool TinyUsbCdcService::begin() {
-    ESP_LOGI(TAG, "Initializing USB Host Service...");
+// 第一个实例安装USB主机库和CDC驱动
+bool TinyUsbCdcService::acquireHost() {
+    if (_s_host_users > 0) {
+        _s_host_users++;
+        return true;
+    }
 
-    if (!_s_rx_ring_buffer) {
-        _s_rx_ring_buffer = xRingbufferCreate(RX_RING_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
-        if (!_s_rx_ring_buffer) { 
-            ESP_LOGE(TAG, "Failed to create ring buffer");
-            return false; 
+    if (_s_open_mutex == nullptr) {
+        _s_open_mutex = xSemaphoreCreateMutex();
+        if (_s_open_mutex == nullptr) {
+            ESP_LOGE(TAG, "Failed to create device open mutex");
+            return false;
         }
     }
-    
+
     const usb_host_config_t host_config = { .intr_flags = ESP_INTR_FLAG_LEVEL1 };
     if (usb_host_install(&host_config) != ESP_OK) {
         ESP_LOGE(TAG, "USB Host install failed");
@@ -57,7 +82,7 @@ bool TinyUsbCdcService::begin() {
         .driver_task_stack_size = 4096,
         .driver_task_priority = 5,
         .xCoreID = 0,
-        .new_dev_cb = NULL // 我们使用自己的扫描任务，不使用这个回调
+        .new_dev_cb = new_device_callback // 通知扫描任务打开新插入的设备
     };
     if (cdc_acm_host_install(&driver_config) != ESP_OK) {
         ESP_LOGE(TAG, "CDC ACM Host install failed");
@@ -65,18 +90,118 @@ bool TinyUsbCdcService::begin() {
         return false;
     }
 
-    if (xTaskCreate(host_lib_task, "usb_host_task", 4096, NULL, 5, &_host_task_handle) != pdPASS) {
+    if (task_config_create(TASK_CONFIG_USB_HOST, host_lib_task, NULL, &_s_host_task_handle) != pdPASS) {
         ESP_LOGE(TAG, "Failed to create host_lib_task");
+        _s_host_task_handle = nullptr;
+        cdc_acm_host_uninstall();
+        usb_host_uninstall();
+        return false;
+    }
+
+    _s_host_users = 1;
+    // 主机库安装期间保持全速且不进入浅睡眠，设备插入和传输都依赖USB中断
+    pm_policy_acquire(PM_POLICY_CLIENT_USB);
+    ESP_LOGI(TAG, "USB Host installed");
+    return true;
+}
+
+// 最后一个实例卸载USB主机库和CDC驱动，此时所有设备都已关闭
+void TinyUsbCdcService::releaseHost() {
+    if (_s_host_users == 0 || --_s_host_users > 0) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Uninstalling CDC ACM driver...");
+    esp_err_t ret = cdc_acm_host_uninstall();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "CDC ACM uninstall warning: %s", esp_err_to_name(ret));
+    }
+    
+    if (_s_host_task_handle) {
+        ESP_LOGI(TAG, "Deleting host library task...");
+        task_config_delete(TASK_CONFIG_USB_HOST, _s_host_task_handle);
+        _s_host_task_handle = nullptr;
+    }
+    
+    ESP_LOGI(TAG, "Uninstalling USB Host...");
+    ret = usb_host_uninstall();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "USB Host uninstall warning: %s", esp_err_to_name(ret));
+    }
+    pm_policy_release(PM_POLICY_CLIENT_USB);
+}
+
+// 调用者持有_s_open_mutex
+bool TinyUsbCdcService::isDeviceClaimed(uint16_t vid, uint16_t pid) {
+    for (int i = 0; i < USB_CDC_MAX_DEVICES; i++) {
+        TinyUsbCdcService* service = _s_services[i];
+        if (service && service->_device_vid == vid && service->_device_pid == pid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TinyUsbCdcService::begin() {
+    if (_registered) {
+        return true;
+    }
+    ESP_LOGI(TAG, "Initializing USB CDC port...");
+
+    if (!_rx_ring.isValid()) {
+        if (!_rx_ring.init(RX_RING_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) { 
+            ESP_LOGE(TAG, "Failed to create ring buffer");
+            return false; 
+        }
+    }
+    if (!_tx_ring.isValid()) {
+        if (!_tx_ring.init(TX_RING_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) {
+            ESP_LOGE(TAG, "Failed to create TX queue");
+            return false;
+        }
+    }
+    if (_tx_mutex == nullptr) {
+        _tx_mutex = xSemaphoreCreateMutex();
+        if (_tx_mutex == nullptr) {
+            ESP_LOGE(TAG, "Failed to create TX mutex");
+            return false;
+        }
+    }
+    
+    if (!acquireHost()) {
+        return false;
+    }
+
+    // 登记实例，扫描时据此跳过其他实例已打开的设备
+    xSemaphoreTake(_s_open_mutex, portMAX_DELAY);
+    for (int i = 0; i < USB_CDC_MAX_DEVICES && !_registered; i++) {
+        if (_s_services[i] == nullptr) {
+            _s_services[i] = this;
+            _registered = true;
+        }
+    }
+    xSemaphoreGive(_s_open_mutex);
+    if (!_registered) {
+        ESP_LOGE(TAG, "More than %d USB CDC ports", USB_CDC_MAX_DEVICES);
+        releaseHost();
+        return false;
+    }
+
+    // 高于心跳任务，低于USB主机任务
+    _tx_task_should_stop = false;
+    if (task_config_create(TASK_CONFIG_USB_CDC_TX, tx_task, this, &_tx_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        _tx_task_handle = nullptr;
         end();
         return false;
     }
     
-    ESP_LOGI(TAG, "USB Host Service initialized successfully");
+    ESP_LOGI(TAG, "USB CDC port initialized successfully");
     return true;
 }
 
 void TinyUsbCdcService::end() {
-    ESP_LOGI(TAG, "Starting USB Host Service cleanup...");
+    ESP_LOGI(TAG, "Starting USB CDC port cleanup...");
     
     // [修复蓝屏问题] 改善服务关闭顺序，防止竞争条件
     
@@ -86,49 +211,41 @@ void TinyUsbCdcService::end() {
     
     ESP_LOGI(TAG, "Stopping scan task...");
     stopScan();
+
+    ESP_LOGI(TAG, "Stopping TX task...");
+    stopTxTask();
     
     // 2. 等待任务完全停止
     vTaskDelay(pdMS_TO_TICKS(300));
     
     // 3. 关闭设备连接
-    if (_s_cdc_device_handle) {
-        ESP_LOGI(TAG, "Closing CDC device handle...");
-        cdc_acm_host_close(_s_cdc_device_handle);
-        _s_cdc_device_handle = nullptr;
-    }
+    forceDisconnectDevice();
     
-    // 4. 清理设备状态
-    _s_is_device_connected = false;
-    
-    // 5. 卸载CDC驱动
-    ESP_LOGI(TAG, "Uninstalling CDC ACM driver...");
-    esp_err_t ret = cdc_acm_host_uninstall();
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "CDC ACM uninstall warning: %s", esp_err_to_name(ret));
-    }
-    
-    // 6. 停止主机库任务
-    if (_host_task_handle) {
-        ESP_LOGI(TAG, "Deleting host library task...");
-        vTaskDelete(_host_task_handle);
-        _host_task_handle = nullptr;
-    }
-    
-    // 7. 卸载USB主机
-    ESP_LOGI(TAG, "Uninstalling USB Host...");
-    ret = usb_host_uninstall();
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "USB Host uninstall warning: %s", esp_err_to_name(ret));
+    // 4. 注销实例，最后一个实例卸载USB主机
+    if (_registered) {
+        xSemaphoreTake(_s_open_mutex, portMAX_DELAY);
+        for (int i = 0; i < USB_CDC_MAX_DEVICES; i++) {
+            if (_s_services[i] == this) {
+                _s_services[i] = nullptr;
+            }
+        }
+        xSemaphoreGive(_s_open_mutex);
+        _registered = false;
+        releaseHost();
     }
     
-    // 8. 最后清理ring buffer
-    if (_s_rx_ring_buffer) {
+    // 5. 最后清理缓冲区
+    if (_rx_ring.isValid()) {
         ESP_LOGI(TAG, "Deleting ring buffer...");
-        vRingbufferDelete(_s_rx_ring_buffer);
-        _s_rx_ring_buffer = nullptr;
+        _rx_ring.deinit();
+    }
+    _tx_ring.deinit();
+    if (_tx_mutex) {
+        vSemaphoreDelete(_tx_mutex);
+        _tx_mutex = nullptr;
     }
     
-    ESP_LOGI(TAG, "USB Host Service deinitialized successfully");
+    ESP_LOGI(TAG, "USB CDC port deinitialized successfully");
 }
 
 void TinyUsbCdcService::startScan() {
@@ -136,7 +253,7 @@ void TinyUsbCdcService::startScan() {
         ESP_LOGI(TAG, "Starting device scan task...");
         _scan_task_should_stop = false;  // 重置停止标志
         
-        BaseType_t result = xTaskCreate(device_scan_task, "cdc_scan_task", 4096, this, 4, &_scan_task_handle);
+        BaseType_t result = task_config_create(TASK_CONFIG_USB_CDC_SCAN, device_scan_task, this, &_scan_task_handle);
         if (result == pdPASS) {
             ESP_LOGI(TAG, "Device scan task created successfully");
         } else {
@@ -152,6 +269,7 @@ void TinyUsbCdcService::stopScan() {
     if (_scan_task_handle) {
         ESP_LOGI(TAG, "Stopping scan task...");
         _scan_task_should_stop = true;  // 设置停止标志
+        xTaskNotify(_scan_task_handle, 0, eSetValueWithOverwrite);  // 唤醒等待设备事件的任务
         
         // 等待任务自然退出，最多等待2秒 (增加等待时间)
         for (int i = 0; i < 200 && _scan_task_handle; i++) {
@@ -164,7 +282,7 @@ void TinyUsbCdcService::stopScan() {
         // 如果任务还没退出，强制删除
         if (_scan_task_handle) {
             ESP_LOGW(TAG, "Scan task did not exit gracefully, forcing deletion");
-            vTaskDelete(_scan_task_handle);
+            task_config_delete(TASK_CONFIG_USB_CDC_SCAN, _scan_task_handle);
             _scan_task_handle = nullptr;
             ESP_LOGW(TAG, "Forced to delete scan task");
         } else {
@@ -181,17 +299,17 @@ void TinyUsbCdcService::forceDisconnectDevice() {
     stopHeartbeat();
     
     // 如果有连接的设备，关闭它
-    if (_s_cdc_device_handle) {
-        ESP_LOGI(TAG, "Closing device handle (VID:0x%04X PID:0x%04X)...", _s_device_vid, _s_device_pid);
-        cdc_acm_host_close(_s_cdc_device_handle);
-        _s_cdc_device_handle = nullptr;
+    if (_cdc_device_handle) {
+        ESP_LOGI(TAG, "Closing device handle (VID:0x%04X PID:0x%04X)...", _device_vid, _device_pid);
+        cdc_acm_host_close(_cdc_device_handle);
+        _cdc_device_handle = nullptr;
         ESP_LOGI(TAG, "Device handle closed");
     }
     
     // 清理设备状态
-    _s_is_device_connected = false;
-    _s_device_vid = 0;
-    _s_device_pid = 0;
+    _is_device_connected = false;
+    _device_vid = 0;
+    _device_pid = 0;
     _current_device_type = DEVICE_TYPE_UNKNOWN;
     
     ESP_LOGI(TAG, "Device disconnection completed");
@@ -205,9 +323,9 @@ void TinyUsbCdcService::startHeartbeat() {
         return;
     }
     
-    if (_s_is_device_connected) {
+    if (_is_device_connected) {
         _heartbeat_task_should_stop = false;  // 重置停止标志
-        BaseType_t result = xTaskCreate(heartbeat_task, "cdc_heartbeat", 4096, this, 3, &_heartbeat_task_handle);
+        BaseType_t result = task_config_create(TASK_CONFIG_USB_CDC_HEARTBEAT, heartbeat_task, this, &_heartbeat_task_handle);
         if (result == pdPASS) {
             ESP_LOGI(TAG, "Heartbeat task started successfully (stack: 4096 bytes)");
         } else {
@@ -235,7 +353,7 @@ void TinyUsbCdcService::stopHeartbeat() {
         // 如果任务还没退出，强制删除
         if (_heartbeat_task_handle) {
             ESP_LOGW(TAG, "Heartbeat task did not exit gracefully, forcing deletion");
-            vTaskDelete(_heartbeat_task_handle);
+            task_config_delete(TASK_CONFIG_USB_CDC_HEARTBEAT, _heartbeat_task_handle);
             _heartbeat_task_handle = nullptr;
             ESP_LOGW(TAG, "Forced to delete heartbeat task");
         } else {
@@ -245,7 +363,7 @@ void TinyUsbCdcService::stopHeartbeat() {
 }
 
 void TinyUsbCdcService::configureSerialPort(uint32_t baud_rate) {
-    if (!_s_is_device_connected || !_s_cdc_device_handle) {
+    if (!_is_device_connected || !_cdc_device_handle) {
         ESP_LOGW(TAG, "No device connected for serial configuration");
         return;
     }
@@ -271,7 +389,7 @@ void TinyUsbCdcService::configureSerialPort(uint32_t baud_rate) {
     
     // 发送 SET_LINE_CODING 控制请求 (USB CDC 规范 6.3.10)
     esp_err_t ret = cdc_acm_host_send_custom_request(
-        _s_cdc_device_handle,
+        _cdc_device_handle,
         0x21,                        // bmRequestType: Host-to-device, Class, Interface
         0x20,                        // bRequest: SET_LINE_CODING
         0x00,                        // wValue: 0
@@ -286,7 +404,7 @@ void TinyUsbCdcService::configureSerialPort(uint32_t baud_rate) {
         // 对于某些设备，设置控制线状态有助于通信稳定
         if (_current_device_type == DEVICE_TYPE_CP210X || _current_device_type == DEVICE_TYPE_PL2303) {
             ret = cdc_acm_host_send_custom_request(
-                _s_cdc_device_handle,
+                _cdc_device_handle,
                 0x21,                // bmRequestType  
                 0x22,                // bRequest: SET_CONTROL_LINE_STATE
                 0x03,                // wValue: DTR=1, RTS=1 (for flow control)
@@ -309,7 +427,7 @@ void TinyUsbCdcService::configureSerialPort(uint32_t baud_rate) {
 
 // [新增] 完整的串口参数配置方法
 void TinyUsbCdcService::configureSerialPort(const SerialConfig& config) {
-    if (!_s_is_device_connected || !_s_cdc_device_handle) {
+    if (!_is_device_connected || !_cdc_device_handle) {
         ESP_LOGW(TAG, "No device connected for serial configuration");
         return;
     }
@@ -347,7 +465,7 @@ void TinyUsbCdcService::configureSerialPort(const SerialConfig& config) {
     
     // 发送 SET_LINE_CODING 控制请求 (USB CDC 规范 6.3.10)
     esp_err_t ret = cdc_acm_host_send_custom_request(
-        _s_cdc_device_handle,
+        _cdc_device_handle,
         0x21,                        // bmRequestType: Host-to-device, Class, Interface
         0x20,                        // bRequest: SET_LINE_CODING
         0x00,                        // wValue: 0
@@ -366,7 +484,7 @@ void TinyUsbCdcService::configureSerialPort(const SerialConfig& config) {
         // [新增] 验证配置是否真正应用 - 读取当前配置
         cdc_acm_line_coding_t verify_coding;
         esp_err_t verify_ret = cdc_acm_host_send_custom_request(
-            _s_cdc_device_handle,
+            _cdc_device_handle,
             0xA1,                        // bmRequestType: Device-to-host, Class, Interface
             0x21,                        // bRequest: GET_LINE_CODING
             0x00,                        // wValue: 0
@@ -393,7 +511,7 @@ void TinyUsbCdcService::configureSerialPort(const SerialConfig& config) {
         // 对于某些设备，设置控制线状态有助于通信稳定
         if (_current_device_type == DEVICE_TYPE_CP210X || _current_device_type == DEVICE_TYPE_PL2303) {
             ret = cdc_acm_host_send_custom_request(
-                _s_cdc_device_handle,
+                _cdc_device_handle,
                 0x21,                // bmRequestType  
                 0x22,                // bRequest: SET_CONTROL_LINE_STATE
                 0x03,                // wValue: DTR=1, RTS=1 (for flow control)
@@ -421,115 +539,165 @@ void TinyUsbCdcService::host_lib_task(void* arg) {
     }
 }
 
-// [新增] 自动扫描并连接设备的后台任务
+// 已知的USB转串口设备，没有新设备事件时（如驱动安装前已插入）按此表扫描
+static const uint16_t common_vid_pid[][2] = {
+    // CH340系列 (QinHeng Electronics) - 最常见的廉价USB转串口
+    {0x1A86, 0x7523}, // CH340 - 最常见
+    {0x1A86, 0x7522}, // CH340K, CH340E
+    {0x1A86, 0x7584}, // CH340B
+    {0x1A86, 0x5523}, // CH341A
+    
+    // FTDI系列 - 工业级标准
+    {0x0403, 0x6001}, // FT232R - 常见
+    {0x0403, 0x6010}, // FT2232H - 双通道
+    {0x0403, 0x6011}, // FT4232H - 四通道
+    {0x0403, 0x6014}, // FT232H - 高速
+    {0x0403, 0x6015}, // FT X-Series
+    
+    // Silicon Labs CP210x系列 - 支持标准CDC
+    {0x10C4, 0xEA60}, // CP210x - 最常见
+    {0x10C4, 0xEA70}, // CP210x变体
+    {0x10C4, 0xEA71}, // CP210x变体
+    
+    // Prolific PL2303系列 - 老牌厂商
+    {0x067B, 0x2303}, // PL2303 - 常见
+    {0x067B, 0x2304}, // PL2303HX
+    
+    // 其他常见厂商
+    {0x2341, 0x0043}, // Arduino Uno R3
+    {0x16C0, 0x0483}, // Teensyduino Serial
+    {0x239A, 0x800B}, // Adafruit Feather 32u4
+};
+
+// CDC驱动任务中调用：把新设备的VID/PID交给所有还没有设备的扫描任务，由它们竞争打开
+void TinyUsbCdcService::new_device_callback(usb_device_handle_t usb_dev) {
+    const usb_device_desc_t* desc = nullptr;
+    if (usb_host_get_device_descriptor(usb_dev, &desc) != ESP_OK || desc == nullptr) {
+        return;
+    }
+    ESP_LOGI(TAG, "New USB device VID:0x%04X PID:0x%04X", desc->idVendor, desc->idProduct);
+
+    // 不等待_s_open_mutex，扫描任务打开设备时持有它；实例在扫描任务退出之后才注销
+    uint32_t vid_pid = ((uint32_t)desc->idVendor << 16) | desc->idProduct;
+    for (int i = 0; i < USB_CDC_MAX_DEVICES; i++) {
+        TinyUsbCdcService* service = _s_services[i];
+        if (service && service->_scan_task_handle && !service->_is_device_connected) {
+            xTaskNotify(service->_scan_task_handle, vid_pid, eSetValueWithOverwrite);
+        }
+    }
+}
+
+// 打开一个设备，成功后按设备类型配置串口并启动心跳
+bool TinyUsbCdcService::openDevice(uint16_t vid, uint16_t pid, uint32_t timeout_ms) {
+    const cdc_acm_host_device_config_t dev_config = {
+        .connection_timeout_ms = timeout_ms,
+        .out_buffer_size = TX_TRANSFER_SIZE,
+        .in_buffer_size = 512,
+        .event_cb = device_event_callback,
+        .data_cb = data_received_callback,
+        .user_arg = this
+    };
+    bool reconnect = (vid == _last_vid && pid == _last_pid);
+    uint8_t interface_idx = reconnect ? _last_interface : 0;
+
+    // 多个实例的打开过程串行，其他实例已打开的VID/PID跳过
+    xSemaphoreTake(_s_open_mutex, portMAX_DELAY);
+    bool opened = !isDeviceClaimed(vid, pid) &&
+                  cdc_acm_host_open(vid, pid, interface_idx, &dev_config, &_cdc_device_handle) == ESP_OK;
+    if (opened) {
+        // 记录设备信息，其他实例据此跳过这个设备
+        _device_vid = vid;
+        _device_pid = pid;
+    }
+    xSemaphoreGive(_s_open_mutex);
+    if (!opened) {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Successfully opened CDC device VID:0x%04X PID:0x%04X%s", vid, pid,
+             reconnect ? " (reconnect)" : "");
+    _current_device_type = reconnect ? _last_device_type : detectDeviceType(vid, pid);
+    ESP_LOGI(TAG, "Device type detected: %s", getDeviceTypeName());
+    _is_device_connected = true;
+
+    if (reconnect) {
+        // 同一个设备重新连接（如目标复位），立即恢复上次的串口配置，不丢失复位后的输出
+        configureDeviceSpecific();
+    } else {
+        // 新设备等待稳定，但检查停止标志
+        ESP_LOGI(TAG, "Device connected successfully, waiting for stability...");
+        for (int j = 0; j < 20 && !_scan_task_should_stop; j++) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        _last_vid = vid;
+        _last_pid = pid;
+        _last_interface = interface_idx;
+        _last_device_type = _current_device_type;
+    }
+
+    if (!_scan_task_should_stop) {
+        // 根据心跳包启用状态决定是否启动心跳
+        if (_heartbeat_enabled) {
+            startHeartbeat();
+            ESP_LOGI(TAG, "Heartbeat started (enabled by switch)");
+        } else {
+            ESP_LOGI(TAG, "Heartbeat not started (disabled by switch)");
+        }
+    }
+    return true;
+}
+
+// 按已知设备表扫描，上次的设备最先尝试；已枚举的设备立即就能打开，不必等待
+bool TinyUsbCdcService::openKnownDevice() {
+    if (_last_vid != 0 && openDevice(_last_vid, _last_pid, USB_CDC_PROBE_TIMEOUT_MS)) {
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(common_vid_pid) / sizeof(common_vid_pid[0]) && !_scan_task_should_stop; i++) {
+        if (common_vid_pid[i][0] == _last_vid && common_vid_pid[i][1] == _last_pid) {
+            continue;
+        }
+        ESP_LOGD(TAG, "Trying to connect to VID:0x%04X PID:0x%04X", 
+                 common_vid_pid[i][0], common_vid_pid[i][1]);
+        if (openDevice(common_vid_pid[i][0], common_vid_pid[i][1], USB_CDC_PROBE_TIMEOUT_MS)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// [新增] 自动扫描并连接设备的后台任务，由新设备事件唤醒
 void TinyUsbCdcService::device_scan_task(void *arg) {
     TinyUsbCdcService* self = static_cast<TinyUsbCdcService*>(arg);
     ESP_LOGI(TAG, "Device scan task started.");
 
+    // 先扫描一次已经插入的设备
+    if (!self->_is_device_connected) {
+        self->openKnownDevice();
+    }
+
     while (!self->_scan_task_should_stop) {  // 检查停止标志
-        if (!_s_is_device_connected) {
-            // 尝试连接到常见的USB-to-Serial设备 (CH340, FT232, CP210x等)
-            const uint16_t common_vid_pid[][2] = {
-                // CH340系列 (QinHeng Electronics) - 最常见的廉价USB转串口
-                {0x1A86, 0x7523}, // CH340 - 最常见
-                {0x1A86, 0x7522}, // CH340K, CH340E
-                {0x1A86, 0x7584}, // CH340B
-                {0x1A86, 0x5523}, // CH341A
-                
-                // FTDI系列 - 工业级标准
-                {0x0403, 0x6001}, // FT232R - 常见
-                {0x0403, 0x6010}, // FT2232H - 双通道
-                {0x0403, 0x6011}, // FT4232H - 四通道
-                {0x0403, 0x6014}, // FT232H - 高速
-                {0x0403, 0x6015}, // FT X-Series
-                
-                // Silicon Labs CP210x系列 - 支持标准CDC
-                {0x10C4, 0xEA60}, // CP210x - 最常见
-                {0x10C4, 0xEA70}, // CP210x变体
-                {0x10C4, 0xEA71}, // CP210x变体
-                
-                // Prolific PL2303系列 - 老牌厂商
-                {0x067B, 0x2303}, // PL2303 - 常见
-                {0x067B, 0x2304}, // PL2303HX
-                
-                // 其他常见厂商
-                {0x2341, 0x0043}, // Arduino Uno R3
-                {0x16C0, 0x0483}, // Teensyduino Serial
-                {0x239A, 0x800B}, // Adafruit Feather 32u4
-            };
-            
-            bool connected = false;
-            for (int i = 0; i < sizeof(common_vid_pid) / sizeof(common_vid_pid[0]) && !self->_scan_task_should_stop; i++) {
-                ESP_LOGD(TAG, "Trying to connect to VID:0x%04X PID:0x%04X", 
-                         common_vid_pid[i][0], common_vid_pid[i][1]);
-                
-                const cdc_acm_host_device_config_t dev_config = {
-                    .connection_timeout_ms = 1000,  // 减少超时时间，从3秒减到1秒
-                    .out_buffer_size = 512,
-                    .in_buffer_size = 512,
-                    .event_cb = self->device_event_callback,
-                    .data_cb = self->data_received_callback,
-                    .user_arg = self
-                };
-
-                // 尝试打开设备
-                if (cdc_acm_host_open(common_vid_pid[i][0], common_vid_pid[i][1], 0, 
-                                     &dev_config, &self->_s_cdc_device_handle) == ESP_OK) {
-                    ESP_LOGI(TAG, "Successfully opened CDC device VID:0x%04X PID:0x%04X", 
-                             common_vid_pid[i][0], common_vid_pid[i][1]);
-                    
-                    // 记录设备信息并检测设备类型
-                    _s_device_vid = common_vid_pid[i][0];
-                    _s_device_pid = common_vid_pid[i][1];
-                    self->_current_device_type = self->detectDeviceType(_s_device_vid, _s_device_pid);
-                    
-                    ESP_LOGI(TAG, "Device type detected: %s", self->getDeviceTypeName());
-                    
-                    _s_is_device_connected = true;
-                    connected = true;
-                    
-                    // 等待设备稳定，但检查停止标志
-                    for (int j = 0; j < 10 && !self->_scan_task_should_stop; j++) {
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                    }
-                    
-                    if (self->_scan_task_should_stop) break;  // 如果要求停止，立即退出
-                    
-                    // 设备连接成功，等待设备稳定
-                    ESP_LOGI(TAG, "Device connected successfully, waiting for stability...");
-                    for (int j = 0; j < 10 && !self->_scan_task_should_stop; j++) {
-                        vTaskDelay(pdMS_TO_TICKS(100));
-                    }
-                    
-                    if (!self->_scan_task_should_stop) {
-                        // 根据心跳包启用状态决定是否启动心跳
-                        if (self->_heartbeat_enabled) {
-                            self->startHeartbeat();
-                            ESP_LOGI(TAG, "Heartbeat started (enabled by switch)");
-                        } else {
-                            ESP_LOGI(TAG, "Heartbeat not started (disabled by switch)");
-                        }
-                    }
-                    
-                    break;
-                }
-            }
-            
-            if (!connected) {
-                ESP_LOGD(TAG, "No CDC devices found, retrying...");
-            }
+        // 等待新设备事件，超时后再按设备表扫描一次
+        uint32_t vid_pid = 0;
+        bool notified = xTaskNotifyWait(0, UINT32_MAX, &vid_pid, pdMS_TO_TICKS(USB_CDC_RESCAN_MS)) == pdTRUE;
+        if (self->_scan_task_should_stop || self->_is_device_connected) {
+            continue;
         }
-        
-        // 分段延时，增加停止检查的频率
-        for (int i = 0; i < 20 && !self->_scan_task_should_stop; i++) {
-            vTaskDelay(pdMS_TO_TICKS(100)); // 总共2秒，但每100ms检查一次停止标志
+
+        bool connected = false;
+        if (notified && vid_pid != 0) {
+            connected = self->openDevice(vid_pid >> 16, vid_pid & 0xFFFF, USB_CDC_OPEN_TIMEOUT_MS);
+        } else if (!notified) {
+            connected = self->openKnownDevice();
+        }
+        if (!connected) {
+            ESP_LOGD(TAG, "No CDC devices found, waiting...");
         }
     }
     
     // 任务退出清理
     ESP_LOGI(TAG, "Device scan task exiting...");
     self->_scan_task_handle = nullptr;  // 清除任务句柄
-    vTaskDelete(NULL);  // 删除自己
+    task_config_delete(TASK_CONFIG_USB_CDC_SCAN, NULL);  // 删除自己
 }
 
 // [新增] 心跳任务 - 定期发送测试数据（优化版本）
@@ -545,28 +713,23 @@ void TinyUsbCdcService::heartbeat_task(void* arg) {
     if (!heartbeat_msg) {
         ESP_LOGE(TAG, "Failed to allocate heartbeat message buffer");
         self->_heartbeat_task_handle = nullptr;
-        vTaskDelete(NULL);
+        task_config_delete(TASK_CONFIG_USB_CDC_HEARTBEAT, NULL);
         return;
     }
     
     while (!self->_heartbeat_task_should_stop) {  // 检查停止标志
-        if (_s_is_device_connected && _s_cdc_device_handle) {
+        if (self->_is_device_connected && self->_cdc_device_handle) {
             // 构造心跳消息（使用预分配的缓冲区）
             int msg_len = snprintf(heartbeat_msg, 128, 
                     "ESP32P4 Heartbeat #%lu - Time: %lu ms\r\n", 
                     counter++, xTaskGetTickCount() * portTICK_PERIOD_MS);
             
             if (msg_len > 0 && msg_len < 128) {
-                // 发送心跳消息
-                esp_err_t ret = cdc_acm_host_data_tx_blocking(_s_cdc_device_handle, 
-                                                             (const uint8_t*)heartbeat_msg, 
-                                                             msg_len, 
-                                                             1000);
-                
-                if (ret == ESP_OK) {
-                    ESP_LOGD(TAG, "Heartbeat #%lu sent successfully", counter - 1);
+                // 放入发送队列，队列满时丢弃这一次心跳
+                if (self->txFree() < (size_t)msg_len) {
+                    ESP_LOGW(TAG, "TX queue full, heartbeat #%lu skipped", counter - 1);
                 } else {
-                    ESP_LOGW(TAG, "Failed to send heartbeat: %s", esp_err_to_name(ret));
+                    self->write((const uint8_t*)heartbeat_msg, msg_len);
                 }
             }
         } else {
@@ -583,45 +746,44 @@ void TinyUsbCdcService::heartbeat_task(void* arg) {
     free(heartbeat_msg);  // 释放内存
     ESP_LOGI(TAG, "Heartbeat task exiting...");
     self->_heartbeat_task_handle = nullptr;  // 清除任务句柄
-    vTaskDelete(NULL);  // 删除自己
+    task_config_delete(TASK_CONFIG_USB_CDC_HEARTBEAT, NULL);  // 删除自己
 }
 
 
 // 设备事件回调（增强版）
 void TinyUsbCdcService::device_event_callback(const cdc_acm_host_dev_event_data_t *event, void *user_ctx) {
     TinyUsbCdcService* self = static_cast<TinyUsbCdcService*>(user_ctx);
+    if (!self) {
+        return;
+    }
     
     switch (event->type) {
         case CDC_ACM_HOST_DEVICE_DISCONNECTED:
-            ESP_LOGI(TAG, "CDC device disconnected (VID:0x%04X PID:0x%04X)", _s_device_vid, _s_device_pid);
-            if (event->data.cdc_hdl == _s_cdc_device_handle) {
+            ESP_LOGI(TAG, "CDC device disconnected (VID:0x%04X PID:0x%04X)", self->_device_vid, self->_device_pid);
+            if (event->data.cdc_hdl == self->_cdc_device_handle) {
                 // 安全停止心跳任务
-                if (self) {
-                    ESP_LOGI(TAG, "Stopping heartbeat due to device disconnection...");
-                    self->stopHeartbeat();
-                }
+                ESP_LOGI(TAG, "Stopping heartbeat due to device disconnection...");
+                self->stopHeartbeat();
                 
                 // 关闭设备句柄
-                if (_s_cdc_device_handle) {
-                    cdc_acm_host_close(_s_cdc_device_handle);
+                if (self->_cdc_device_handle) {
+                    cdc_acm_host_close(self->_cdc_device_handle);
                 }
                 
-                // 清理设备状态
-                _s_cdc_device_handle = nullptr;
-                _s_is_device_connected = false;
-                _s_device_vid = 0;
-                _s_device_pid = 0;
+                // 清理设备状态，这个VID/PID可以被其他实例打开
+                self->_cdc_device_handle = nullptr;
+                self->_is_device_connected = false;
+                self->_device_vid = 0;
+                self->_device_pid = 0;
                 
                 ESP_LOGI(TAG, "Device cleanup completed");
             }
             break;
         case CDC_ACM_HOST_ERROR:
             ESP_LOGE(TAG, "CDC ACM error: %d (device may be unstable)", event->data.error);
-            if (self) {
-                ESP_LOGW(TAG, "Stopping heartbeat due to CDC error...");
-                self->stopHeartbeat();
-            }
-            _s_is_device_connected = false;
+            ESP_LOGW(TAG, "Stopping heartbeat due to CDC error...");
+            self->stopHeartbeat();
+            self->_is_device_connected = false;
             break;
         case CDC_ACM_HOST_SERIAL_STATE:
             ESP_LOGD(TAG, "CDC ACM serial state changed");
@@ -638,53 +800,152 @@ void TinyUsbCdcService::device_event_callback(const cdc_acm_host_dev_event_data_
 
 // 数据接收回调
 bool TinyUsbCdcService::data_received_callback(const uint8_t *data, size_t data_len, void *user_ctx) {
-    if (_s_rx_ring_buffer && data && data_len > 0) {
-        xRingbufferSend(_s_rx_ring_buffer, data, data_len, (TickType_t)0);
+    TinyUsbCdcService* self = static_cast<TinyUsbCdcService*>(user_ctx);
+
+    // 不能阻塞USB驱动任务，放不下的数据丢弃并计入统计
+    if (self && data && data_len > 0) {
+        SerialCapture* sink = self->_capture_sink;
+        if (sink) {
+            sink->addData(data, data_len);
+        }
+        SerialRxTap* tap = self->_rx_tap;
+        if (tap) {
+            tap->onRxData(data, data_len);
+        }
+        self->_rx_ring.write(data, data_len);
+
+        TaskHandle_t notify = self->_rx_notify;
+        if (notify) {
+            xTaskNotifyGive(notify);
+        }
     }
     return true;
 }
 
 size_t TinyUsbCdcService::read(uint8_t *buffer, size_t max_len) {
-    if (!_s_rx_ring_buffer || max_len == 0) return 0;
-    size_t item_size = 0;
-    uint8_t *item = (uint8_t*)xRingbufferReceive(_s_rx_ring_buffer, &item_size, (TickType_t)0);
-    if (item) {
-        size_t copy_len = (max_len < item_size) ? max_len : item_size;
-        memcpy(buffer, item, copy_len);
-        vRingbufferReturnItem(_s_rx_ring_buffer, (void*)item);
-        return copy_len;
-    }
-    return 0;
+    if (max_len == 0) return 0;
+    return _rx_ring.read(buffer, max_len);
+}
+
+size_t TinyUsbCdcService::peek(const uint8_t **data) {
+    return _rx_ring.readSpan(data);
+}
+
+void TinyUsbCdcService::consume(size_t len) {
+    _rx_ring.releaseRead(len);
 }
 
 size_t TinyUsbCdcService::available() {
-    if (!_s_rx_ring_buffer) return 0;
-    
-    UBaseType_t items_waiting = 0;
-    size_t free_bytes = 0, max_item_size = 0;
-    
-    // 获取ring buffer详细信息
-    vRingbufferGetInfo(_s_rx_ring_buffer, NULL, &free_bytes, NULL, NULL, &items_waiting);
-    
-    if (items_waiting == 0) {
+    return _rx_ring.available();
+}
+
+size_t TinyUsbCdcService::write(const uint8_t *data, size_t len) {
+    if (!_is_device_connected || !_cdc_device_handle || len == 0 || _tx_mutex == nullptr) {
         return 0;
     }
-    
-    // 估算可用数据大小（ring buffer总大小 - 空闲字节）
-    size_t estimated_data = RX_RING_BUFFER_SIZE - free_bytes;
-    
-    // 返回估算的可用字节数，但至少返回1表示有数据
-    return (estimated_data > 0) ? estimated_data : 1;
+
+    // 锁内只有内存拷贝，不会等待USB传输
+    xSemaphoreTake(_tx_mutex, portMAX_DELAY);
+    size_t queued = _tx_ring.write(data, len);
+    xSemaphoreGive(_tx_mutex);
+
+    if (queued > 0 && _tx_task_handle) {
+        xTaskNotifyGive(_tx_task_handle);
+    }
+    return queued;
 }
 
-void TinyUsbCdcService::write(const uint8_t *data, size_t len) {
-    if (_s_is_device_connected && _s_cdc_device_handle && len > 0) {
-        cdc_acm_host_data_tx_blocking(_s_cdc_device_handle, data, len, 100);
+size_t TinyUsbCdcService::txFree() {
+    return _tx_ring.capacity() - _tx_ring.available();
+}
+
+bool TinyUsbCdcService::flushTx(uint32_t timeout_ms) {
+    // 传输完成后才释放队列中的数据，队列为空即已全部发出
+    TickType_t start = xTaskGetTickCount();
+    while (_tx_ring.available() > 0) {
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeout_ms)) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+TinyUsbCdcService::TxStats TinyUsbCdcService::getTxStats() const {
+    const ByteRing::Stats& ring = _tx_ring.getStats();
+    TxStats stats = {
+        .queued = ring.received,
+        .rejected = ring.dropped,
+        .sent = _tx_sent,
+        .transfers = _tx_transfers,
+        .errors = _tx_errors,
+        .discarded = _tx_discarded,
+    };
+    return stats;
+}
+
+// 发送任务：队列中有多少数据就合并成一次传输（不超过TX_TRANSFER_SIZE），
+// 传输进行期间新写入的数据在下一次传输中一起发出
+void TinyUsbCdcService::tx_task(void* arg) {
+    TinyUsbCdcService* self = static_cast<TinyUsbCdcService*>(arg);
+    ESP_LOGI(TAG, "TX task started");
+
+    while (!self->_tx_task_should_stop) {
+        const uint8_t* data = nullptr;
+        size_t len = self->_tx_ring.readSpan(&data);
+        if (len == 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        cdc_acm_dev_hdl_t handle = self->_cdc_device_handle;
+        if (!self->_is_device_connected || !handle) {
+            // 设备已断开，未发送的数据不再有意义
+            self->_tx_ring.releaseRead(len);
+            self->_tx_discarded += len;
+            continue;
+        }
+
+        if (len > TX_TRANSFER_SIZE) {
+            len = TX_TRANSFER_SIZE;
+        }
+        esp_err_t ret = cdc_acm_host_data_tx_blocking(handle, data, len, TX_TRANSFER_TIMEOUT_MS);
+        if (ret == ESP_OK) {
+            self->_tx_sent += len;
+            self->_tx_transfers++;
+        } else {
+            // 丢弃这一块，避免设备不再接收时队列一直堵住
+            self->_tx_errors++;
+            ESP_LOGW(TAG, "TX transfer of %u bytes failed: %s", (unsigned int)len, esp_err_to_name(ret));
+        }
+        self->_tx_ring.releaseRead(len);
+    }
+
+    ESP_LOGI(TAG, "TX task exiting...");
+    self->_tx_task_handle = nullptr;
+    task_config_delete(TASK_CONFIG_USB_CDC_TX, NULL);
+}
+
+void TinyUsbCdcService::stopTxTask() {
+    if (_tx_task_handle) {
+        _tx_task_should_stop = true;
+        xTaskNotifyGive(_tx_task_handle);
+
+        // 最多等待一次传输超时
+        for (int i = 0; i < (TX_TRANSFER_TIMEOUT_MS / 10) + 50 && _tx_task_handle; i++) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+
+        if (_tx_task_handle) {
+            ESP_LOGW(TAG, "TX task did not exit gracefully, forcing deletion");
+            task_config_delete(TASK_CONFIG_USB_CDC_TX, _tx_task_handle);
+            _tx_task_handle = nullptr;
+        }
     }
 }
 
 bool TinyUsbCdcService::isConnected() { 
-    return _s_is_device_connected; 
+    return _is_device_connected; 
 }
 
 // [新增] 设备类型检测
@@ -799,7 +1060,7 @@ void TinyUsbCdcService::configureDeviceSpecific() {
 
 // CH340专用配置方法
 void TinyUsbCdcService::configureCH340SerialPort(uint32_t baud_rate) {
-    if (!_s_is_device_connected || !_s_cdc_device_handle) {
+    if (!_is_device_connected || !_cdc_device_handle) {
         ESP_LOGW(TAG, "No device connected for CH340 configuration");
         return;
     }
@@ -833,7 +1094,7 @@ void TinyUsbCdcService::configureCH340SerialPort(uint32_t baud_rate) {
     }
     
     esp_err_t ret = cdc_acm_host_send_custom_request(
-        _s_cdc_device_handle,
+        _cdc_device_handle,
         0x40,                // bmRequestType: Host-to-device, Vendor, Device
         0x9A,                // bRequest: CH340 set baud rate
         0x1312,              // wValue: 固定值
@@ -851,7 +1112,7 @@ void TinyUsbCdcService::configureCH340SerialPort(uint32_t baud_rate) {
     // 2. 设置数据格式 - 8N1
     // Request 0x9B: Set data format  
     ret = cdc_acm_host_send_custom_request(
-        _s_cdc_device_handle,
+        _cdc_device_handle,
         0x40,                // bmRequestType: Host-to-device, Vendor, Device
         0x9B,                // bRequest: CH340 set data format
         0x0008,              // wValue: 8 data bits, no parity, 1 stop bit
@@ -869,7 +1130,7 @@ void TinyUsbCdcService::configureCH340SerialPort(uint32_t baud_rate) {
     // 3. 启用DTR和RTS
     // Request 0xA4: Set control line state
     ret = cdc_acm_host_send_custom_request(
-        _s_cdc_device_handle,
+        _cdc_device_handle,
         0x40,                // bmRequestType: Host-to-device, Vendor, Device
         0xA4,                // bRequest: CH340 set control lines
         0xDF20,              // wValue: DTR=1, RTS=1
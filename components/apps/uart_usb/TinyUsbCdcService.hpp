@@ -2,13 +2,36 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "usb/usb_host.h"
 #include "usb/cdc_acm_host.h"
+#include "byte_ring/ByteRing.hpp"
 
-#define RX_RING_BUFFER_SIZE     (4096)
+class SerialCapture;
+class SerialRxTap;
 
+#define RX_RING_BUFFER_SIZE     (16384)      // 接收环形缓冲区大小，必须是2的幂
+#define TX_RING_BUFFER_SIZE     (16384)      // 发送队列大小，必须是2的幂
+#define TX_TRANSFER_SIZE        (4096)       // 单次USB传输的最大长度，是全速和高速最大包长的整数倍
+#define TX_TRANSFER_TIMEOUT_MS  (1000)       // 单次USB传输的超时时间
+#define USB_CDC_MAX_DEVICES     (4)          // 同时使用的CDC设备数（经USB集线器）
+#define USB_CDC_RESCAN_MS       (2000)       // 没有新设备事件时按已知VID/PID表重新扫描的周期
+#define USB_CDC_OPEN_TIMEOUT_MS (1000)       // 打开新设备事件中的设备时等待它就绪的最长时间
+#define USB_CDC_PROBE_TIMEOUT_MS (10)        // 按设备表扫描时每个VID/PID的等待时间
+
+/**
+ * @class TinyUsbCdcService
+ * @brief 一个USB CDC设备（串口）
+ *
+ * 每个实例扫描并打开一个设备，有自己的接收环形缓冲区、发送队列和记录对象，
+ * 多个实例可以同时使用集线器上的多个设备。USB主机库和CDC驱动由所有实例共用，
+ * 第一个实例begin时安装，最后一个实例end时卸载。
+ * 驱动按VID/PID打开设备，一个实例已打开的VID/PID其他实例不再尝试，
+ * 所以同型号的两个转换器只能使用其中一个。
+ * 扫描任务等待CDC驱动的新设备事件，直接打开插入的设备；重新插入上次的设备时
+ * 沿用记下的设备类型和串口配置，不再检测和等待，频繁复位的目标断开后立即恢复。
+ */
 class TinyUsbCdcService {
 public:
     TinyUsbCdcService();
@@ -17,9 +40,36 @@ public:
     bool begin();
     void end();
     size_t read(uint8_t *buffer, size_t max_len);
+    size_t peek(const uint8_t **data);      // 获取可读的连续数据，不拷贝，在consume之前有效
+    void consume(size_t len);               // 释放peek得到的已处理数据
     size_t available();
-    void write(const uint8_t *data, size_t len);
+    // 接收统计，USB回调不能等待，缓冲满时的数据计入dropped
+    const ByteRing::Stats& getRxStats() const { return _rx_ring.getStats(); }
+    // 原始数据记录，USB回调把收到的每块数据交给它，与UI读取无关；nullptr为不记录
+    void setCaptureSink(SerialCapture* sink) { _capture_sink = sink; }
+    // 接收旁路（如脚本引擎），同样在USB回调中调用；nullptr为不使用
+    void setRxTap(SerialRxTap* tap) { _rx_tap = tap; }
+    // 接收通知，每次数据放入接收缓冲区后通知读取它的任务（如桥接任务）；nullptr为不通知
+    void setRxNotify(TaskHandle_t task) { _rx_notify = task; }
+
+    // 发送统计
+    struct TxStats {
+        uint32_t queued;        // 放入发送队列的字节数
+        uint32_t rejected;      // 队列满未放入的字节数
+        uint32_t sent;          // 已发送的字节数
+        uint32_t transfers;     // USB传输次数
+        uint32_t errors;        // 失败的传输次数，其数据被丢弃
+        uint32_t discarded;     // 设备断开时丢弃的未发送字节数
+    };
+    // 不阻塞：数据放入发送队列，由发送任务合并成大块传输；
+    // 返回实际放入的字节数，小于len表示队列已满，调用者稍后重发剩余部分
+    size_t write(const uint8_t *data, size_t len);
+    size_t txFree();                        // 发送队列剩余空间，用于流控
+    bool flushTx(uint32_t timeout_ms);      // 等待队列中的数据全部发出
+    TxStats getTxStats() const;
     bool isConnected();
+    uint16_t getDeviceVid() const { return _device_vid; }
+    uint16_t getDevicePid() const { return _device_pid; }
 
     // [新增] UI层调用的公共方法
     void startScan();
@@ -67,35 +117,69 @@ public:
     void configureCH340SerialPort(uint32_t baud_rate = 115200);
 
 private:
+    // 共用的USB主机库和CDC驱动
+    static bool acquireHost();
+    static void releaseHost();
+    static bool isDeviceClaimed(uint16_t vid, uint16_t pid);
     static void host_lib_task(void* arg);
+    static void new_device_callback(usb_device_handle_t usb_dev);
     static void device_event_callback(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
     static bool data_received_callback(const uint8_t *data, size_t data_len, void *user_ctx);
     
     // [新增] 自动扫描任务
     static void device_scan_task(void* arg);
+    bool openDevice(uint16_t vid, uint16_t pid, uint32_t timeout_ms);
+    bool openKnownDevice();
     // [新增] 心跳任务
     static void heartbeat_task(void* arg);
+    // 发送任务，唯一调用cdc_acm_host_data_tx_blocking的地方
+    static void tx_task(void* arg);
+    void stopTxTask();
     
-    TaskHandle_t _host_task_handle;
     TaskHandle_t _scan_task_handle; // [新增] 扫描任务句柄
     TaskHandle_t _heartbeat_task_handle; // [新增] 心跳任务句柄
+    TaskHandle_t _tx_task_handle;       // 发送任务句柄
     
     // [新增] 任务控制标志 - 用于优雅停止任务
     volatile bool _scan_task_should_stop;
     volatile bool _heartbeat_task_should_stop;
+    volatile bool _tx_task_should_stop;
 
-    static RingbufHandle_t _s_rx_ring_buffer; 
-    static volatile bool   _s_is_device_connected;
-    static cdc_acm_dev_hdl_t _s_cdc_device_handle;
+    // 发送队列：write可能在UI和心跳任务中调用，生产者之间用互斥锁串行，发送任务是唯一的消费者
+    ByteRing          _tx_ring;
+    SemaphoreHandle_t _tx_mutex;
+    uint32_t          _tx_sent;         // 发送统计只由发送任务修改
+    uint32_t          _tx_transfers;
+    uint32_t          _tx_errors;
+    uint32_t          _tx_discarded;
+
+    ByteRing          _rx_ring;         // USB回调写入，UI读取
+    SerialCapture* volatile _capture_sink;
+    SerialRxTap* volatile _rx_tap;
+    TaskHandle_t volatile _rx_notify;
+    volatile bool     _is_device_connected;
+    cdc_acm_dev_hdl_t _cdc_device_handle;
+    bool              _registered;      // 已在_s_services中登记并持有USB主机
     
-    // [新增] 设备信息
-    static uint16_t _s_device_vid;
-    static uint16_t _s_device_pid;
+    // [新增] 设备信息，已打开设备的VID/PID，未连接时为0
+    uint16_t _device_vid;
+    uint16_t _device_pid;
     UsbDeviceType _current_device_type;
+
+    // 上次打开的设备，重新连接时跳过设备类型检测和稳定等待
+    uint16_t _last_vid;
+    uint16_t _last_pid;
+    uint8_t  _last_interface;
+    UsbDeviceType _last_device_type;
     
     // [新增] 保存当前串口配置
     SerialConfig _current_config;
     
     // [新增] 心跳包启用状态
     bool _heartbeat_enabled;
+
+    static TaskHandle_t       _s_host_task_handle;
+    static int                _s_host_users;        // 持有USB主机的实例数，只在UI任务中修改
+    static SemaphoreHandle_t  _s_open_mutex;        // 保护_s_services和设备打开过程
+    static TinyUsbCdcService* _s_services[USB_CDC_MAX_DEVICES];
 };
\ No newline at end of file
@@ -1,42 +1,51 @@
 #include "USB_CDC.hpp"
 #include "esp_log.h"
 #include "ui/ui.h"
+#include "bsp/esp-bsp.h"
 #include <string.h>
 
-#define MAX_UI_UPDATE_LEN 1024
-#define TEXT_AREA_MAX_LEN 12288         // 最大文本长度（12KB）- 增加容量
-#define TEXT_AREA_CLEAR_TRIGGER 10240   // 触发清空的长度（10KB）- 减少清理频率  
-#define TEXT_AREA_KEEP_LEN 4096         // 清空后保留的长度（4KB）- 保留更多历史
+#define MAX_UI_READ_PER_TICK 8192       // 每个端口每次定时器回调最多读取的长度
+#define UI_UPDATE_PERIOD_MS  50         // 有数据时的UI更新周期，积压时加倍，空闲时为CONFIG_SERIAL_UI_IDLE_PERIOD_MS
+#define PORT_BAR_HEIGHT      40         // 端口切换栏高度，从文本区域上方让出
+#define SCRIPT_FILE BSP_SD_MOUNT_POINT "/SCRIPT.TXT"    // 长按START运行的脚本
 
 static const char *TAG = "AppUSBCDC";
 
 USB_CDC::USB_CDC() : 
     ESP_Brookesia_PhoneApp("USB CDC", get_usb_app_icon(), false),
+    _selected_port(0),
     _update_timer(nullptr),
-    _last_conn_state(false),
-    _current_text_len(0),
-    _main_screen(nullptr)
+    _port_bar(nullptr),
+    _main_screen(nullptr),
+    _script_port(0),
+    _script_phase(SCRIPT_NONE)
 {
-    // 初始化默认串口设置
-    _current_settings.baud_rate = 115200;
-    _current_settings.data_bits = 8;
-    _current_settings.parity = 0;    // 0=None, 1=Odd, 2=Even
-    _current_settings.stop_bits = 0; // 0=1bit, 1=1.5bit, 2=2bit
-    
     // 初始化心跳包开关状态（默认开启）
     _heartbeat_enabled = true;
     
-    // 同步心跳包状态到TinyUsbCdcService
-    _usb_cdc_service.setHeartbeatEnabled(_heartbeat_enabled);
-    
-    // 同步配置到服务中
-    TinyUsbCdcService::SerialConfig config = {
-        .baud_rate = _current_settings.baud_rate,
-        .data_bits = _current_settings.data_bits,
-        .parity = _current_settings.parity,
-        .stop_bits = _current_settings.stop_bits
-    };
-    _usb_cdc_service.setCurrentConfig(config);
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        Port& port = _ports[i];
+
+        // 初始化默认串口设置
+        port.settings.baud_rate = 115200;
+        port.settings.data_bits = 8;
+        port.settings.parity = 0;    // 0=None, 1=Odd, 2=Even
+        port.settings.stop_bits = 0; // 0=1bit, 1=1.5bit, 2=2bit
+        port.last_conn_state = false;
+
+        // 同步心跳包状态到TinyUsbCdcService
+        port.service.setHeartbeatEnabled(_heartbeat_enabled);
+        
+        // 同步配置到服务中
+        TinyUsbCdcService::SerialConfig config = {
+            .baud_rate = port.settings.baud_rate,
+            .data_bits = port.settings.data_bits,
+            .parity = port.settings.parity,
+            .stop_bits = port.settings.stop_bits
+        };
+        port.service.setCurrentConfig(config);
+    }
+    _port_map[USB_CDC_PORT_COUNT] = "";
 }
 
 USB_CDC::~USB_CDC()
@@ -52,10 +61,17 @@ USB_CDC::~USB_CDC()
         _update_timer = nullptr;
     }
     
-    // 确保USB服务完全停止
-    _usb_cdc_service.stopHeartbeat();
-    _usb_cdc_service.stopScan();
-    _usb_cdc_service.forceDisconnectDevice();
+    // 确保USB服务完全停止，脚本先于端口析构，要先摘下接收旁路
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].service.setRxTap(nullptr);
+    }
+    _script.stop();
+    stopCapture();
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].service.stopHeartbeat();
+        _ports[i].service.stopScan();
+        _ports[i].service.forceDisconnectDevice();
+    }
     
     ESP_LOGI(TAG, "USB_CDC destructor completed.");
 }
@@ -63,10 +79,17 @@ USB_CDC::~USB_CDC()
 bool USB_CDC::init(void)
 {
     ESP_LOGI(TAG, "Initializing USB CDC Service for the first time.");
-    if (!_usb_cdc_service.begin()) {
+    if (!_ports[0].service.begin()) {
         ESP_LOGE(TAG, "Failed to initialize UsbCdcService. The app may not work.");
         return false;
     }
+
+    // 其余端口失败时只是少几个端口可用
+    for (uint32_t i = 1; i < USB_CDC_PORT_COUNT; i++) {
+        if (!_ports[i].service.begin()) {
+            ESP_LOGW(TAG, "Failed to initialize USB CDC port %u", (unsigned int)(i + 1));
+        }
+    }
     return true;
 }
 
@@ -78,39 +101,33 @@ bool USB_CDC::run(void)
     // 保存主界面引用
     _main_screen = lv_scr_act();
 
-    _update_timer = lv_timer_create(uiUpdateTimerCb, 50, this);  // 减少到50ms提高响应性
+    _update_timer = lv_timer_create(uiUpdateTimerCb, UI_UPDATE_PERIOD_MS, this);  // 周期由_pacer调整
     lv_timer_pause(_update_timer);
 
-    // 安全检查并配置UI对象
-    if (uic_TextAreaUSB) {
-        // 配置TextArea以更好地处理大量文本
-        lv_textarea_set_one_line(uic_TextAreaUSB, false);  // 允许多行
-        lv_obj_set_style_text_font(uic_TextAreaUSB, &lv_font_montserrat_12, 0);  // 使用较小字体节省空间
-        
-        // 设置文本区域为只读模式，避免意外编辑
-        lv_textarea_set_text_selection(uic_TextAreaUSB, false);
-        lv_obj_clear_flag(uic_TextAreaUSB, LV_OBJ_FLAG_CLICKABLE);
-        
-        // 启用滚动并配置滚动行为
-        lv_obj_set_scroll_snap_y(uic_TextAreaUSB, LV_SCROLL_SNAP_NONE);
-        // lv_obj_set_style_scroll_on_focus(uic_TextAreaUSB, false, 0); // 此函数在当前LVGL版本中不可用
-        
-        // 首先清空TextArea，确保没有残留数据
-        lv_textarea_set_text(uic_TextAreaUSB, "");
-        
-        const char* welcome_msg = "[USB] USB CDC Terminal Ready\n" 
-                                 "Click START to begin scanning for USB devices...\n"
-                                 "----------------------------------------\n";
-        lv_textarea_set_text(uic_TextAreaUSB, welcome_msg);
-        _current_text_len = strlen(welcome_msg);
-        
-        ESP_LOGI(TAG, "TextArea configured for optimal text display");
-    } else {
-        ESP_LOGE(TAG, "Failed to initialize TextArea UI object");
-        return false;
+    // 文本区域上方让出端口切换栏的位置
+    lv_obj_set_height(uic_TextAreaUSB, lv_obj_get_height(uic_TextAreaUSB) - PORT_BAR_HEIGHT);
+    lv_obj_set_y(uic_TextAreaUSB, lv_obj_get_y_aligned(uic_TextAreaUSB) + PORT_BAR_HEIGHT / 2);
+
+    // 每个端口一个终端控件，叠放在文本区域的位置，回滚文本放在PSRAM中
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        TerminalView& terminal = _ports[i].terminal;
+        if (!terminal.create(uic_TextAreaUSB, &lv_font_montserrat_12)) {
+            ESP_LOGE(TAG, "Failed to create terminal view");
+            return false;
+        }
+
+        char msg[160];
+        snprintf(msg, sizeof(msg), "[USB] USB CDC Terminal Ready (Port %u)\n"
+                 "Click START to begin scanning for USB devices...\n"
+                 "Long press START to run " SCRIPT_FILE " on the selected port.\n"
+                 "----------------------------------------\n", (unsigned int)(i + 1));
+        terminal.clear();
+        terminal.append(msg);
+        _ports[i].last_conn_state = false;
     }
-    
-    _last_conn_state = false;
+
+    createPortBar();
+    selectPort(0);
     
     return true;
 }
@@ -132,16 +149,22 @@ bool USB_CDC::close(void)
         vTaskDelay(pdMS_TO_TICKS(100));  // 等待当前定时器回调完成
     }
     
-    // 2. 停止USB服务（按正确顺序）
+    // 2. 停止脚本和USB服务（按正确顺序）
     ESP_LOGI(TAG, "Stopping USB services...");
-    _usb_cdc_service.stopHeartbeat();      // 先停止心跳
-    _usb_cdc_service.stopScan();           // 再停止扫描
+    stopScript();
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].service.stopHeartbeat();      // 先停止心跳
+        _ports[i].service.stopScan();           // 再停止扫描
+    }
     
     // 3. 等待USB服务完全停止
     vTaskDelay(pdMS_TO_TICKS(200));
     
     // 4. 强制断开设备连接
-    _usb_cdc_service.forceDisconnectDevice();
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].service.forceDisconnectDevice();
+    }
+    stopCapture();
     
     // 5. 最后安全删除定时器
     if (_update_timer) {
@@ -150,20 +173,32 @@ bool USB_CDC::close(void)
         _update_timer = nullptr;
     }
     
-    // 6. 重置所有状态变量
-    _last_conn_state = false;
-    _current_text_len = 0;
-    
-    // 7. 清理TextArea内容，防止内存泄漏
-    if (uic_TextAreaUSB && lv_obj_is_valid(uic_TextAreaUSB)) {
-        lv_textarea_set_text(uic_TextAreaUSB, "");
+    // 6. 重置所有状态变量，删除终端控件，清空回滚文本
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].last_conn_state = false;
+        _ports[i].terminal.destroy();
+        _ports[i].terminal.clear();
+    }
+    if (_port_bar && lv_obj_is_valid(_port_bar)) {
+        lv_obj_del(_port_bar);
     }
+    _port_bar = nullptr;
     
     ESP_LOGI(TAG, "USB CDC app cleanup completed successfully");
     
     return true;
 }
 
+bool USB_CDC::displayStateChanged(ESP_Brookesia_CoreDisplayState_t state)
+{
+    // 屏幕关闭后端口继续接收和记录，UI定时器只是很少唤醒，一次读空各端口的缓冲区
+    if (_update_timer) {
+        _pacer.setBackground(state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF);
+    }
+
+    return true;
+}
+
 void USB_CDC::extraUiInit(void)
 {
     lv_obj_t* btn_start = uic_ButtonUSBStart;
@@ -172,7 +207,9 @@ void USB_CDC::extraUiInit(void)
     lv_obj_t* btn_exit = uic_ButtonUSBExit;
     lv_obj_t* switch_heartbeat = uic_SwitchUSBHeartbeat;
 
-    lv_obj_add_event_cb(btn_start, onButtonStartClicked, LV_EVENT_CLICKED, this);
+    // 长按时LVGL仍会发送CLICKED，短按才启动服务
+    lv_obj_add_event_cb(btn_start, onButtonStartClicked, LV_EVENT_SHORT_CLICKED, this);
+    lv_obj_add_event_cb(btn_start, onButtonStartLongPressed, LV_EVENT_LONG_PRESSED, this);
     lv_obj_add_event_cb(btn_stop, onButtonStopClicked, LV_EVENT_CLICKED, this);
     lv_obj_add_event_cb(btn_setting, onButtonSettingsClicked, LV_EVENT_CLICKED, this);
     lv_obj_add_event_cb(btn_exit, onButtonExitClicked, LV_EVENT_CLICKED, this);
@@ -219,49 +256,57 @@ void USB_CDC::uiUpdateTimerCb(lv_timer_t *timer)
         return;
     }
     
-    bool is_connected = app->_usb_cdc_service.isConnected();
-    if (is_connected != app->_last_conn_state) {
-        app->_last_conn_state = is_connected;
-        if (is_connected) {
-            // 设备刚连接时，显示连接信息但不立即配置
-            // 配置由heartbeat任务或用户操作来处理，避免重复配置
-            char config_msg[128];
-            const char* parity_str[] = {"N", "O", "E"};  
-            const char* stop_str[] = {"1", "1.5", "2"};
-            snprintf(config_msg, sizeof(config_msg), 
-                    "\n[Status] USB Device Connected! Type: %s\n", 
-                    app->_usb_cdc_service.getDeviceTypeName());
+    bool bar_changed = false;
+    size_t budget = app->_pacer.budget();
+    size_t max_read = 0;
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        Port& port = app->_ports[i];
+
+        bool is_connected = port.service.isConnected();
+        if (is_connected != port.last_conn_state) {
+            port.last_conn_state = is_connected;
+            bar_changed = true;
+            if (is_connected) {
+                // 设备刚连接时，显示连接信息但不立即配置
+                // 配置由heartbeat任务或用户操作来处理，避免重复配置
+                char config_msg[128];
+                snprintf(config_msg, sizeof(config_msg), 
+                        "\n[Status] USB Device Connected! Type: %s (VID:0x%04X PID:0x%04X)\n", 
+                        port.service.getDeviceTypeName(),
+                        port.service.getDeviceVid(), port.service.getDevicePid());
+                
+                app->addTextToPort(i, config_msg);
+            } else {
+                const char* status_msg = "\n[Status] USB Device Disconnected.\n";
+                app->addTextToPort(i, status_msg);
+            }
+        }
+
+        // 直接把接收缓冲区中的数据追加到终端，未选中的端口也接收，切换后可以回看
+        app->skipBacklog(i);
+        size_t total_read = 0;
+        while (total_read < budget) {
+            const uint8_t* data = nullptr;
+            size_t len = port.service.peek(&data);
+            if (len == 0) break;
             
-            app->addTextToDisplay(config_msg);
-        } else {
-            const char* status_msg = "\n[Status] USB Device Disconnected.\n";
-            app->addTextToDisplay(status_msg);
+            if (len > budget - total_read) {
+                len = budget - total_read;
+            }
+            port.terminal.append((const char*)data, len);
+            port.service.consume(len);
+            total_read += len;
+        }
+        if (total_read > max_read) {
+            max_read = total_read;
         }
     }
+    app->_pacer.endTick(max_read);
 
-    uint8_t buffer[MAX_UI_UPDATE_LEN + 1];  // +1 为null terminator预留空间
-    size_t total_read = 0;
-    
-    // 改进数据读取策略：避免截断完整数据包
-    while (total_read < (MAX_UI_UPDATE_LEN - 1)) {  // 留1字节给null terminator
-        size_t available = app->_usb_cdc_service.available();
-        if (available == 0) break;
-        
-        // 增大单次读取大小，减少截断风险
-        size_t remaining = (MAX_UI_UPDATE_LEN - 1) - total_read;
-        size_t to_read = (remaining > 256) ? 256 : remaining;  // 从64提升到256字节
-        
-        size_t bytes_read = app->_usb_cdc_service.read(buffer + total_read, to_read);
-        if (bytes_read == 0) break;
-        total_read += bytes_read;
-    }
-    
-    if (total_read > 0) {
-        buffer[total_read] = '\0';  // 现在安全了，因为buffer大小是MAX_UI_UPDATE_LEN+1
-        
-        // 使用改进的文本处理方法
-        app->addTextToDisplayImproved((const char*)buffer, total_read);
+    if (bar_changed) {
+        app->updatePortBar();
     }
+    app->checkScript();
 }
 
 void USB_CDC::onButtonStartClicked(lv_event_t* e)
@@ -272,36 +317,69 @@ void USB_CDC::onButtonStartClicked(lv_event_t* e)
     const char* starting_msg = "\n[System] Starting USB CDC services...\n";
     app->addTextToDisplay(starting_msg);
     
-    // 检查设备是否已连接但心跳未运行，如果是则直接启动心跳
-    if (app->_usb_cdc_service.isConnected()) {
-        ESP_LOGI(TAG, "Device already connected, starting services...");
-        
-        // 根据心跳包开关状态决定是否启动心跳
-        if (app->_heartbeat_enabled) {
-            app->_usb_cdc_service.startHeartbeat();
-            ESP_LOGI(TAG, "Heartbeat started (enabled by switch)");
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        TinyUsbCdcService& service = app->_ports[i].service;
+
+        // 检查设备是否已连接但心跳未运行，如果是则直接启动心跳
+        if (service.isConnected()) {
+            ESP_LOGI(TAG, "Port %u: device already connected, starting services...", (unsigned int)(i + 1));
+            
+            // 根据心跳包开关状态决定是否启动心跳
+            if (app->_heartbeat_enabled) {
+                service.startHeartbeat();
+                ESP_LOGI(TAG, "Heartbeat started (enabled by switch)");
+            } else {
+                ESP_LOGI(TAG, "Heartbeat not started (disabled by switch)");
+            }
+            
+            const char* msg = "\n[System] Services started for connected device.\n";
+            app->addTextToPort(i, msg);
         } else {
-            ESP_LOGI(TAG, "Heartbeat not started (disabled by switch)");
+            // 设备未连接，开始扫描；各端口打开不同的设备
+            ESP_LOGI(TAG, "Port %u: no device connected, starting scan...", (unsigned int)(i + 1));
+            service.startScan();
+            const char* msg = "\n[System] Started scanning for USB devices.\nPlease insert a USB-to-Serial device.\n";
+            app->addTextToPort(i, msg);
         }
-        
-        const char* msg = "\n[System] Services started for connected device.\n";
-        app->addTextToDisplay(msg);
-    } else {
-        // 设备未连接，开始扫描
-        ESP_LOGI(TAG, "No device connected, starting scan...");
-        app->_usb_cdc_service.startScan();
-        const char* msg = "\n[System] Started scanning for USB devices.\nPlease insert a USB-to-Serial device.\n";
-        app->addTextToDisplay(msg);
     }
 
+    app->startCapture();
+
     // 恢复定时器
-    lv_timer_resume(app->_update_timer);
+    app->resumeUpdates();
 
     // 更新按钮状态
     lv_obj_add_state(uic_ButtonUSBStart, LV_STATE_DISABLED);
     lv_obj_clear_state(uic_ButtonUSBStop, LV_STATE_DISABLED);
 }
 
+// 加载SD卡上的脚本并启动服务，选中的端口连接设备后运行
+void USB_CDC::onButtonStartLongPressed(lv_event_t *e)
+{
+    USB_CDC* app = static_cast<USB_CDC*>(lv_event_get_user_data(e));
+    uint32_t index = app->_selected_port;
+
+    if (lv_obj_has_state(uic_ButtonUSBStart, LV_STATE_DISABLED)) {
+        return;
+    }
+    if (!app->_script.load(SCRIPT_FILE)) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "\n[Script] %s\n", app->_script.getMessage());
+        app->addTextToPort(index, msg);
+        return;
+    }
+
+    onButtonStartClicked(e);
+
+    // 心跳包会混入脚本的收发，脚本结束后恢复
+    TinyUsbCdcService& service = app->_ports[index].service;
+    service.setHeartbeatEnabled(false);
+    service.stopHeartbeat();
+    app->_script_port = index;
+    app->_script_phase = SCRIPT_WAITING;
+    app->addTextToPort(index, "[Script] Waiting for the device to run " SCRIPT_FILE "\n");
+}
+
 void USB_CDC::onButtonStopClicked(lv_event_t *e)
 {
     USB_CDC* app = static_cast<USB_CDC*>(lv_event_get_user_data(e));
@@ -309,23 +387,30 @@ void USB_CDC::onButtonStopClicked(lv_event_t *e)
     // 显示停止状态
     const char* stopping_msg = "\n[System] Stopping services and disconnecting device...\n";
     app->addTextToDisplay(stopping_msg);
+    app->stopScript();
     
-    // 停止扫描任务
-    app->_usb_cdc_service.stopScan();
-    
-    // 停止心跳任务
-    app->_usb_cdc_service.stopHeartbeat();
-    
-    // 强制断开USB设备连接
-    app->_usb_cdc_service.forceDisconnectDevice();
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        TinyUsbCdcService& service = app->_ports[i].service;
+
+        // 停止扫描任务
+        service.stopScan();
+        
+        // 停止心跳任务
+        service.stopHeartbeat();
+        
+        // 强制断开USB设备连接
+        service.forceDisconnectDevice();
+
+        // 更新UI状态
+        app->_ports[i].last_conn_state = false;  // 重置连接状态
+    }
+    app->stopCapture();
+    app->updatePortBar();
     
     // 暂停定时器
     lv_timer_pause(app->_update_timer);
-    
-    // 更新UI状态
-    app->_last_conn_state = false;  // 重置连接状态
 
-    const char* msg = "\n[System] All services stopped. Device disconnected.\n";
+    const char* msg = "\n[System] All services stopped. Devices disconnected.\n";
     app->addTextToDisplay(msg);
 
     lv_obj_clear_state(uic_ButtonUSBStart, LV_STATE_DISABLED);
@@ -347,15 +432,16 @@ void USB_CDC::onButtonExitClicked(lv_event_t* e)
 // [新增] 显示设置界面
 void USB_CDC::showSettingsScreen(void)
 {
-    // 初始化设置界面
+    // 初始化设置界面，显示选中端口的设置
     ui_ScreenUSBSettings_screen_init();
+    const SerialSettings& settings = _ports[_selected_port].settings;
     
     // 设置当前配置到UI控件
     // 波特率
     const uint32_t baud_rates[] = {4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 1500000};
     int baud_index = 5; // 默认115200
     for (int i = 0; i < 9; i++) {
-        if (baud_rates[i] == _current_settings.baud_rate) {
+        if (baud_rates[i] == settings.baud_rate) {
             baud_index = i;
             break;
         }
@@ -363,13 +449,13 @@ void USB_CDC::showSettingsScreen(void)
     lv_dropdown_set_selected(uic_DropdownUSBBaudrate, baud_index);
     
     // 数据位 (5,6,7,8 -> index 0,1,2,3)
-    lv_dropdown_set_selected(uic_DropdownUSBDatabits, _current_settings.data_bits - 5);
+    lv_dropdown_set_selected(uic_DropdownUSBDatabits, settings.data_bits - 5);
     
     // 校验位 (None,Odd,Even -> index 0,1,2)
-    lv_dropdown_set_selected(uic_DropdownUSBParity, _current_settings.parity);
+    lv_dropdown_set_selected(uic_DropdownUSBParity, settings.parity);
     
     // 停止位 (1,1.5,2 -> index 0,1,2)
-    lv_dropdown_set_selected(uic_DropdownUSBStopbits, _current_settings.stop_bits);
+    lv_dropdown_set_selected(uic_DropdownUSBStopbits, settings.stop_bits);
     
     // 设置按钮事件回调
     lv_obj_add_event_cb(uic_ButtonUSBSettingsApply, onButtonApplyClicked, LV_EVENT_CLICKED, this);
@@ -424,10 +510,14 @@ void USB_CDC::onButtonApplyClicked(lv_event_t *e)
         .stop_bits = (uint8_t)stop_index         // 0,1,2
     };
     
+    // 设置只应用到选中的端口
+    uint32_t index = app->_selected_port;
+    Port& port = app->_ports[index];
+
     // 检查设备连接状态
-    if (app->_usb_cdc_service.isConnected()) {
+    if (port.service.isConnected()) {
         ESP_LOGI(TAG, "Device is connected, applying configuration safely...");
-        ESP_LOGI(TAG, "Device type: %s", app->_usb_cdc_service.getDeviceTypeName());
+        ESP_LOGI(TAG, "Device type: %s", port.service.getDeviceTypeName());
         
         // 1. 暂停定时器，避免在配置过程中读取数据
         if (app->_update_timer) {
@@ -450,7 +540,7 @@ void USB_CDC::onButtonApplyClicked(lv_event_t *e)
         
         // 多次尝试配置以确保生效
         for (int attempt = 0; attempt < 3; attempt++) {
-            app->_usb_cdc_service.configureSerialPort(config);
+            port.service.configureSerialPort(config);
             vTaskDelay(pdMS_TO_TICKS(50));  // 等待配置生效
             
             ESP_LOGI(TAG, "Configuration attempt %d/3 completed", attempt + 1);
@@ -462,8 +552,8 @@ void USB_CDC::onButtonApplyClicked(lv_event_t *e)
         }
         
         // 5. 更新本地设置和服务设置
-        app->_current_settings = new_settings;
-        app->_usb_cdc_service.setCurrentConfig(config); // [重要] 保存配置到服务中
+        port.settings = new_settings;
+        port.service.setCurrentConfig(config); // [重要] 保存配置到服务中
         
         // 在主界面显示应用成功的消息
         char config_msg[128];
@@ -477,13 +567,13 @@ void USB_CDC::onButtonApplyClicked(lv_event_t *e)
                 (new_settings.stop_bits < 3) ? stop_str[new_settings.stop_bits] : "?");
         
         if (uic_TextAreaUSB) {
-            app->addTextToDisplay(config_msg);
+            app->addTextToPort(index, config_msg);
         }
     } else {
         ESP_LOGI(TAG, "No device connected, saving settings for next connection...");
         
         // 设备未连接时，只保存设置，下次连接时应用
-        app->_current_settings = new_settings;
+        port.settings = new_settings;
         
         // [重要] 同时保存到服务中，以便设备连接时使用
         TinyUsbCdcService::SerialConfig config = {
@@ -492,11 +582,11 @@ void USB_CDC::onButtonApplyClicked(lv_event_t *e)
             .parity = new_settings.parity,
             .stop_bits = new_settings.stop_bits
         };
-        app->_usb_cdc_service.setCurrentConfig(config);
+        port.service.setCurrentConfig(config);
         
         const char* msg = "\n[Settings] Configuration saved. Will be applied when device connects.\n";
         if (uic_TextAreaUSB) {
-            app->addTextToDisplay(msg);
+            app->addTextToPort(index, msg);
         }
     }
     
@@ -511,170 +601,192 @@ void USB_CDC::onButtonBackClicked(lv_event_t *e)
     app->hideSettingsScreen();
 }
 
-// [新增] 智能文本管理 - 添加文本到显示区域
+// 添加文本到所有端口的终端
 void USB_CDC::addTextToDisplay(const char* text)
 {
-    if (!text || !uic_TextAreaUSB) {
-        return;
-    }
-    
-    size_t text_len = strlen(text);
-    
-    // 检查是否需要智能清理文本区域
-    if (_current_text_len + text_len > TEXT_AREA_CLEAR_TRIGGER) {
-        smartTextAreaClear();
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].terminal.append(text);
     }
-    
-    // 添加新文本
-    lv_textarea_add_text(uic_TextAreaUSB, text);
-    _current_text_len += text_len;
-    
-    // 自动滚动到底部
-    lv_obj_scroll_to_y(uic_TextAreaUSB, LV_COORD_MAX, LV_ANIM_OFF);
-    
-    ESP_LOGD(TAG, "Added %zu chars, total: %zu chars", text_len, _current_text_len);
 }
 
-// [新增] 改进的文本处理函数 - 处理数据截断和换行符问题
-void USB_CDC::addTextToDisplayImproved(const char* text, size_t actual_len)
+// 添加文本到一个端口的终端
+void USB_CDC::addTextToPort(uint32_t index, const char* text)
 {
-    // [修复蓝屏问题] 增强安全检查
-    if (!text || actual_len == 0) {
-        return;
+    if (index < USB_CDC_PORT_COUNT) {
+        _ports[index].terminal.append(text);
     }
-    
-    // 检查UI对象是否有效
-    if (!uic_TextAreaUSB || !lv_obj_is_valid(uic_TextAreaUSB)) {
-        ESP_LOGW(TAG, "TextArea UI object is invalid, skipping text addition");
-        return;
+}
+
+// 开始把接收数据记录到SD卡，每个端口一个文件（CD1_nnnn.BIN...），
+// 未启用CONFIG_SERIAL_CAPTURE_SD时不做任何事
+void USB_CDC::startCapture()
+{
+#if CONFIG_SERIAL_CAPTURE_SD
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        Port& port = _ports[i];
+        if (port.capture.isCapturing()) {
+            continue;
+        }
+
+        char prefix[8];
+        snprintf(prefix, sizeof(prefix), "CD%u", (unsigned int)(i + 1));
+        if (!port.capture.start(prefix, CONFIG_SERIAL_CAPTURE_SD_FLUSH_MS)) {
+            addTextToPort(i, "[System] SD card recording unavailable.\n");
+            continue;
+        }
+        port.service.setCaptureSink(&port.capture);
+
+        char msg[80];
+        snprintf(msg, sizeof(msg), "[System] Recording to %s\n", port.capture.getPath());
+        addTextToPort(i, msg);
     }
-    
-    // 限制最大处理长度，防止内存问题
-    if (actual_len > MAX_UI_UPDATE_LEN) {
-        ESP_LOGW(TAG, "Text too long (%zu), truncating to %d", actual_len, MAX_UI_UPDATE_LEN);
-        actual_len = MAX_UI_UPDATE_LEN;
+#endif
+}
+
+// 停止记录，必须先摘下接收端的记录对象再关闭文件
+void USB_CDC::stopCapture()
+{
+#if CONFIG_SERIAL_CAPTURE_SD
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        Port& port = _ports[i];
+        if (!port.capture.isCapturing()) {
+            continue;
+        }
+        port.service.setCaptureSink(nullptr);
+        port.capture.stop();
+
+        SerialCapture::Stats stats = port.capture.getStats();
+        ESP_LOGI(TAG, "Recorded %lu bytes to %s, %lu dropped", (unsigned long)stats.bytes,
+                 port.capture.getPath(), (unsigned long)stats.dropped);
     }
-    
-    // 创建处理后的文本缓冲区，加强内存安全
-    char* processed_text = (char*)malloc(actual_len + 128);  // 更多额外空间
-    if (!processed_text) {
-        ESP_LOGE(TAG, "Failed to allocate memory for text processing (%zu bytes)", actual_len + 128);
+#endif
+}
+
+// 端口连接后运行已加载的脚本，脚本作为接收旁路，与显示并行收到同样的数据
+void USB_CDC::startScript(void)
+{
+    TinyUsbCdcService& service = _ports[_script_port].service;
+
+    if (!_script.start(scriptWrite, &service)) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "[Script] Failed to start: %s\n", _script.getMessage());
+        addTextToPort(_script_port, msg);
+        releaseScriptPort();
         return;
     }
-    
-    // 初始化缓冲区
-    memset(processed_text, 0, actual_len + 128);
-    
-    size_t processed_len = 0;
-    
-    // 逐字节处理，确保文本显示正确
-    for (size_t i = 0; i < actual_len; i++) {
-        char c = text[i];
-        
-        // 处理不可打印字符
-        if (c == '\0') {
-            break;  // 遇到null terminator停止
-        } else if (c == '\r') {
-            // Windows风格的回车符，转换为换行符
-            processed_text[processed_len++] = '\n';
-        } else if (c == '\n') {
-            // Unix风格的换行符，直接保留
-            processed_text[processed_len++] = '\n';
-        } else if (c >= 32 && c <= 126) {
-            // 可打印ASCII字符
-            processed_text[processed_len++] = c;
-        } else {
-            // 过滤掉所有其他字符（包括UTF-8），避免乱码
-            // 如果是控制字符或高位字符，跳过不添加
-            continue;
+    service.setRxTap(&_script);
+    _script_phase = SCRIPT_RUNNING;
+    addTextToPort(_script_port, "[Script] Running " SCRIPT_FILE "\n");
+}
+
+// 停止按钮和关闭应用时调用，等待中的脚本直接取消
+void USB_CDC::stopScript(void)
+{
+    if (_script_phase == SCRIPT_RUNNING) {
+        _script.stop();
+        checkScript();
+    } else if (_script_phase == SCRIPT_WAITING) {
+        addTextToPort(_script_port, "\n[Script] Cancelled.\n");
+        releaseScriptPort();
+    }
+}
+
+// 在UI定时器中调用：端口连接后启动脚本，脚本结束后显示结果
+void USB_CDC::checkScript(void)
+{
+    if (_script_phase == SCRIPT_WAITING) {
+        if (_ports[_script_port].last_conn_state) {
+            startScript();
         }
+        return;
     }
-    
-    // 确保以换行符结束（如果原文本没有的话）
-    if (processed_len > 0 && processed_text[processed_len - 1] != '\n') {
-        processed_text[processed_len++] = '\n';
+    if (_script_phase != SCRIPT_RUNNING || _script.isRunning()) {
+        return;
     }
-    
-    processed_text[processed_len] = '\0';
-    
-    // 检查是否需要智能清理文本区域
-    if (_current_text_len + processed_len > TEXT_AREA_CLEAR_TRIGGER) {
-        smartTextAreaClear();
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "\n[Script] %s: %s\n",
+             (_script.getState() == SerialScript::STATE_PASSED) ? "PASS" : "FAIL", _script.getMessage());
+    addTextToPort(_script_port, msg);
+    releaseScriptPort();
+}
+
+// 摘下接收旁路，恢复端口的心跳包
+void USB_CDC::releaseScriptPort(void)
+{
+    TinyUsbCdcService& service = _ports[_script_port].service;
+
+    service.setRxTap(nullptr);
+    service.setHeartbeatEnabled(_heartbeat_enabled);
+    if (_heartbeat_enabled && service.isConnected()) {
+        service.startHeartbeat();
     }
-    
-    // 添加处理后的文本
-    lv_textarea_add_text(uic_TextAreaUSB, processed_text);
-    _current_text_len += processed_len;
-    
-    // 自动滚动到底部
-    lv_obj_scroll_to_y(uic_TextAreaUSB, LV_COORD_MAX, LV_ANIM_OFF);
-    
-    ESP_LOGD(TAG, "Added %zu chars (processed from %zu), total: %zu chars", 
-             processed_len, actual_len, _current_text_len);
-    
-    free(processed_text);
+    _script_phase = SCRIPT_NONE;
+}
+
+// 脚本任务中调用，发送队列满时返回0，脚本稍后重发
+size_t USB_CDC::scriptWrite(void* ctx, const uint8_t* data, size_t len)
+{
+    return static_cast<TinyUsbCdcService*>(ctx)->write(data, len);
 }
 
-// [新增] 智能清理文本区域 - 保留最新内容
-void USB_CDC::smartTextAreaClear(void)
+// 在文本区域上方创建端口切换栏，已连接的端口显示USB图标
+void USB_CDC::createPortBar(void)
 {
-    if (!uic_TextAreaUSB) {
+    _port_bar = lv_btnmatrix_create(lv_obj_get_parent(uic_TextAreaUSB));
+    lv_obj_set_size(_port_bar, lv_obj_get_width(uic_TextAreaUSB), PORT_BAR_HEIGHT);
+    lv_obj_align_to(_port_bar, uic_TextAreaUSB, LV_ALIGN_OUT_TOP_MID, 0, 0);
+    lv_obj_set_style_pad_all(_port_bar, 2, 0);
+    lv_obj_set_style_text_font(_port_bar, &lv_font_montserrat_12, 0);
+
+    updatePortBar();
+    lv_btnmatrix_set_btn_ctrl_all(_port_bar, LV_BTNMATRIX_CTRL_CHECKABLE);
+    lv_btnmatrix_set_one_checked(_port_bar, true);
+    lv_obj_add_event_cb(_port_bar, onPortBarChanged, LV_EVENT_VALUE_CHANGED, this);
+}
+
+void USB_CDC::updatePortBar(void)
+{
+    if (!_port_bar) {
         return;
     }
-    
-    ESP_LOGI(TAG, "Text area approaching limit (%zu chars), performing smart cleanup...", _current_text_len);
-    
-    // 获取当前文本内容
-    const char* current_text = lv_textarea_get_text(uic_TextAreaUSB);
-    if (!current_text) {
-        _current_text_len = 0;
-        return;
+
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        snprintf(_port_labels[i], sizeof(_port_labels[i]), "Port %u%s", (unsigned int)(i + 1),
+                 _ports[i].last_conn_state ? " " LV_SYMBOL_USB : "");
+        _port_map[i] = _port_labels[i];
     }
-    
-    size_t current_len = strlen(current_text);
-    
-    if (current_len <= TEXT_AREA_KEEP_LEN) {
-        // 如果当前文本已经很短，直接返回
-        _current_text_len = current_len;
+
+    // 重设map会清除按钮状态
+    lv_btnmatrix_set_map(_port_bar, _port_map);
+    lv_btnmatrix_set_btn_ctrl_all(_port_bar, LV_BTNMATRIX_CTRL_CHECKABLE);
+    lv_btnmatrix_set_btn_ctrl(_port_bar, _selected_port, LV_BTNMATRIX_CTRL_CHECKED);
+}
+
+// 切换显示和设置的端口，其他端口在后台继续接收和记录
+void USB_CDC::selectPort(uint32_t index)
+{
+    if (index >= USB_CDC_PORT_COUNT) {
         return;
     }
-    
-    // 计算要保留的起始位置（保留最后的TEXT_AREA_KEEP_LEN字符）
-    size_t keep_start = current_len - TEXT_AREA_KEEP_LEN;
-    
-    // 尝试从完整行开始保留（寻找换行符）
-    const char* line_start = current_text + keep_start;
-    const char* next_newline = strchr(line_start, '\n');
-    if (next_newline && (next_newline - current_text) < current_len - 100) {
-        // 找到换行符且不是太靠近末尾，从下一行开始
-        keep_start = (next_newline + 1) - current_text;
+
+    _selected_port = index;
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].terminal.setVisible(i == index);
     }
-    
-    // 添加清理提示信息
-    const char* cleanup_msg = "[System] Text buffer optimized - showing recent messages...\n";
-    
-    // 创建新的文本内容
-    char* new_content = (char*)malloc(strlen(cleanup_msg) + (current_len - keep_start) + 1);
-    if (new_content) {
-        strcpy(new_content, cleanup_msg);
-        strcat(new_content, current_text + keep_start);
-        
-        // 设置新内容
-        lv_textarea_set_text(uic_TextAreaUSB, new_content);
-        _current_text_len = strlen(new_content);
-        
-        // 自动滚动到底部
-        lv_obj_scroll_to_y(uic_TextAreaUSB, LV_COORD_MAX, LV_ANIM_OFF);
-        
-        ESP_LOGI(TAG, "Text cleanup completed: %zu -> %zu chars (saved %zu chars)", 
-                 current_len, _current_text_len, current_len - _current_text_len);
-        
-        free(new_content);
-    } else {
-        // 内存不足时的简单清理
-        ESP_LOGW(TAG, "Memory insufficient for smart cleanup, using simple clear");
-        lv_textarea_set_text(uic_TextAreaUSB, cleanup_msg);
-        _current_text_len = strlen(cleanup_msg);
+    if (_port_bar) {
+        lv_btnmatrix_set_btn_ctrl(_port_bar, index, LV_BTNMATRIX_CTRL_CHECKED);
+        lv_obj_move_foreground(_port_bar);
+    }
+}
+
+void USB_CDC::onPortBarChanged(lv_event_t *e)
+{
+    USB_CDC* app = static_cast<USB_CDC*>(lv_event_get_user_data(e));
+    uint16_t index = lv_btnmatrix_get_selected_btn(app->_port_bar);
+
+    if (index != LV_BTNMATRIX_BTN_NONE) {
+        app->selectPort(index);
     }
 }
 
@@ -698,21 +810,77 @@ void USB_CDC::updateHeartbeatState(bool enabled)
 {
     _heartbeat_enabled = enabled;
     
-    // 同步状态到TinyUsbCdcService
-    _usb_cdc_service.setHeartbeatEnabled(enabled);
-    
-    // 如果设备已连接，立即应用心跳包状态
-    if (_usb_cdc_service.isConnected()) {
-        if (enabled) {
-            // 启动心跳包发送
-            _usb_cdc_service.startHeartbeat();
-            addTextToDisplay("\n[System] Heartbeat enabled.\n");
-        } else {
-            // 停止心跳包发送
-            _usb_cdc_service.stopHeartbeat();
-            addTextToDisplay("\n[System] Heartbeat disabled.\n");
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        TinyUsbCdcService& service = _ports[i].service;
+
+        // 脚本占用的端口在脚本结束后恢复
+        if (_script_phase != SCRIPT_NONE && i == _script_port) {
+            continue;
+        }
+
+        // 同步状态到TinyUsbCdcService
+        service.setHeartbeatEnabled(enabled);
+        
+        // 如果设备已连接，立即应用心跳包状态
+        if (service.isConnected()) {
+            if (enabled) {
+                // 启动心跳包发送
+                service.startHeartbeat();
+                addTextToPort(i, "\n[System] Heartbeat enabled.\n");
+            } else {
+                // 停止心跳包发送
+                service.stopHeartbeat();
+                addTextToPort(i, "\n[System] Heartbeat disabled.\n");
+            }
         }
     }
     
     ESP_LOGI(TAG, "Heartbeat state updated: %s", enabled ? "enabled" : "disabled");
-}
\ No newline at end of file
+}
+
+// 恢复UI更新定时器，从正常刷新节奏开始
+void USB_CDC::resumeUpdates(void)
+{
+    RxPacer::Config config = {
+        .period_ms = UI_UPDATE_PERIOD_MS,
+        .idle_period_ms = CONFIG_SERIAL_UI_IDLE_PERIOD_MS,
+        .burst_period_ms = UI_UPDATE_PERIOD_MS * 2,
+        .batch = MAX_UI_READ_PER_TICK,
+        .max_batch = CONFIG_SERIAL_UI_MAX_BATCH_KB * 1024,
+        // 接收缓冲区满时USB回调丢弃新数据，跳过旧数据让它尽快空出来
+        .skip_threshold = RX_RING_BUFFER_SIZE * 3 / 4,
+    };
+    _pacer.begin(_update_timer, config);
+    for (uint32_t i = 0; i < USB_CDC_PORT_COUNT; i++) {
+        _ports[i].lag.reset();
+    }
+    lv_timer_resume(_update_timer);
+}
+
+// UI跟不上时丢掉端口接收缓冲区中最旧的数据，不显示，汇总后提示跳过的字节数
+void USB_CDC::skipBacklog(uint32_t index)
+{
+    Port& port = _ports[index];
+
+    size_t skip = _pacer.skipCount(port.service.available());
+    while (skip > 0) {
+        const uint8_t* data = nullptr;
+        size_t len = port.service.peek(&data);
+        if (len == 0) break;
+
+        if (len > skip) {
+            len = skip;
+        }
+        port.service.consume(len);
+        port.lag.add(len);
+        skip -= len;
+    }
+
+    uint32_t skipped = port.lag.take();
+    if (skipped > 0) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "\n[System] Display lagging, %lu bytes skipped%s.\n",
+                 (unsigned long)skipped, port.capture.isCapturing() ? " (recorded to SD card)" : "");
+        addTextToPort(index, msg);
+    }
+}
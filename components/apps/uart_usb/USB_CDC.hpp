@@ -4,11 +4,17 @@
 #include "lvgl.h"
 #include "TinyUsbCdcService.hpp" // [修改点 1] 包含了新的头文件
 #include "ui/usb_icon.h" // [新增] USB图标支持
+#include "terminal_view/TerminalView.hpp"
+#include "serial_capture/SerialCapture.hpp"
+#include "serial_script/SerialScript.hpp"
+#include "rx_pacer/RxPacer.hpp"
 
 // (中文注释) 函数声明, 引用由SquareLine导出的UI初始化函数
 extern "C" void ui_usb_init(void);
 extern "C" void ui_usb_destroy(void);
 
+#define USB_CDC_PORT_COUNT  (3)         // 面板上的端口数，不超过USB_CDC_MAX_DEVICES
+
 class USB_CDC : public ESP_Brookesia_PhoneApp {
 public:
     USB_CDC();
@@ -18,12 +24,14 @@ public:
     bool run(void) override;
     bool back(void) override;
     bool close(void) override;
+    bool displayStateChanged(ESP_Brookesia_CoreDisplayState_t state) override;
 
 private:
     void extraUiInit(void);
 
     static void uiUpdateTimerCb(lv_timer_t *timer);
     static void onButtonStartClicked(lv_event_t *e);
+    static void onButtonStartLongPressed(lv_event_t *e);
     static void onButtonStopClicked(lv_event_t *e);
     static void onButtonExitClicked(lv_event_t *e);
     static void onButtonSettingsClicked(lv_event_t *e);
@@ -35,9 +43,29 @@ private:
     static void onButtonBackClicked(lv_event_t *e);
 
     // [新增] 文本管理方法
-    void addTextToDisplay(const char* text);
-    void addTextToDisplayImproved(const char* text, size_t actual_len);  // 改进版本
-    void smartTextAreaClear(void);
+    void addTextToDisplay(const char* text);            // 所有端口
+    void addTextToPort(uint32_t index, const char* text);
+
+    // SD卡原始数据记录，每个端口一个文件
+    void startCapture();
+    void stopCapture();
+
+    // 收发脚本，在长按START时选中的端口上运行
+    void startScript(void);
+    void stopScript(void);
+    void checkScript(void);
+    void releaseScriptPort(void);
+    static size_t scriptWrite(void* ctx, const uint8_t* data, size_t len);
+
+    // 刷新节奏，所有端口共用一个定时器
+    void resumeUpdates(void);
+    void skipBacklog(uint32_t index);
+
+    // 端口切换栏
+    void createPortBar(void);
+    void updatePortBar(void);
+    void selectPort(uint32_t index);
+    static void onPortBarChanged(lv_event_t *e);
     
     // [新增] 心跳包开关控制
     static void onSwitchHeartbeatChanged(lv_event_t *e);
@@ -50,15 +78,36 @@ private:
         uint8_t parity;         // 校验位
         uint8_t stop_bits;      // 停止位
     };
-    SerialSettings _current_settings;
     
-    // [新增] 心跳包开关状态
+    // [新增] 心跳包开关状态，所有端口共用
     bool _heartbeat_enabled;
 
+    // 一个USB CDC端口：设备、串口设置、显示终端和SD卡记录各自独立
+    struct Port {
+        TinyUsbCdcService service;
+        SerialSettings    settings;
+        TerminalView      terminal;     // 接收数据显示终端，只显示选中的端口
+        SerialCapture     capture;      // 接收数据SD卡记录
+        RxLagReport       lag;          // UI跟不上时跳过的字节数
+        bool              last_conn_state;
+    };
+
+    enum ScriptPhase {
+        SCRIPT_NONE = 0,
+        SCRIPT_WAITING,                 // 等待端口连接设备
+        SCRIPT_RUNNING,
+    };
+
     // -- (中文注释) 成员变量 --
-    TinyUsbCdcService _usb_cdc_service; // [修改点 2] 更改了成员变量的类型
+    Port          _ports[USB_CDC_PORT_COUNT];
+    uint32_t      _selected_port;       // 显示和设置的端口
     lv_timer_t*   _update_timer;
-    bool          _last_conn_state;
-    size_t        _current_text_len;
+    RxPacer       _pacer;               // UI更新定时器的周期和每个端口每次的读取量
+    lv_obj_t*     _port_bar;            // 端口切换栏
+    char          _port_labels[USB_CDC_PORT_COUNT][16];
+    const char*   _port_map[USB_CDC_PORT_COUNT + 1];
     lv_obj_t*     _main_screen;         // [新增] 保存主界面引用
+    SerialScript  _script;
+    uint32_t      _script_port;         // 运行脚本的端口
+    ScriptPhase   _script_phase;
 };
\ No newline at end of file
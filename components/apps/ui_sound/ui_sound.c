@@ -0,0 +1,296 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "ui_sound.h"
+
+#if CONFIG_UI_SOUND
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "driver/i2s_common.h"
+#include "bsp_board_extra.h"
+#include "settings_store/settings_store.h"
+#include "pm_policy/pm_policy.h"
+#include "task_config/task_config.h"
+
+#define SOUND_RATE                  (32000)     /* Rate the effects are rendered at */
+#define SOUND_VOICE_NUM             (4)
+#define SOUND_TONE_NUM              (2)
+#define SOUND_IDLE_MS               (40)        /* The codec is free once nothing else wrote to it for this long */
+#define SOUND_WRITE_TIMEOUT_MS      (100)
+#define SOUND_MAX_FRAME_SIZE        (8)         /* 32 bit stereo */
+
+typedef struct {
+    uint16_t ms;
+    uint16_t start_hz;
+    uint16_t end_hz;                            /* Linear sweep from `start_hz` */
+    uint16_t decay_ms;                          /* Time constant of the exponential decay */
+    uint8_t level_percent;
+} sound_tone_t;
+
+typedef struct {
+    const int16_t *pcm;
+    uint32_t len;
+    uint32_t pos;                               /* Position in `pcm`, 16.16 fixed point */
+} sound_voice_t;
+
+static const char *TAG = "ui_sound";
+
+static const sound_tone_t sound_tones[UI_SOUND_NUM][SOUND_TONE_NUM] = {
+    [UI_SOUND_CLICK]    = { { 6, 3200, 2400, 2, 45 } },
+    [UI_SOUND_KEY]      = { { 25, 1500, 1100, 6, 40 } },
+    [UI_SOUND_MOVE]     = { { 60, 380, 760, 25, 35 } },
+    [UI_SOUND_NOTIFY]   = { { 90, 880, 880, 40, 35 }, { 140, 1320, 1320, 50, 35 } },
+};
+
+static struct {
+    int16_t *pcm[UI_SOUND_NUM];
+    uint32_t len[UI_SOUND_NUM];
+    TaskHandle_t task;
+    /* Guarded by `lock`, set by `ui_sound_play()` */
+    portMUX_TYPE lock;
+    uint32_t pending;                           /* Bit mask of the effects to start */
+    /* Guarded by `mix_mutex`, a block being mixed by another writer is left alone */
+    SemaphoreHandle_t mix_mutex;
+    sound_voice_t voices[SOUND_VOICE_NUM];
+    /* Set in the codec tap */
+    atomic_int voice_num;
+    atomic_llong other_write_us;                /* Last write of another task, the music player */
+    atomic_int frame_size;
+} s_sound = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+    .frame_size = 4,                            /* 16 bit stereo of the BSP until the first write */
+};
+
+esp_err_t __real_i2s_new_channel(const i2s_chan_config_t *chan_cfg, i2s_chan_handle_t *ret_tx_handle,
+                                 i2s_chan_handle_t *ret_rx_handle);
+
+/* Wrapped at link time (see CMakeLists.txt). The BSP sizes the DMA for the music, a write then waits behind tens of
+ * milliseconds of queued audio; short buffers bound the delay of an effect mixed into the next block */
+esp_err_t __wrap_i2s_new_channel(const i2s_chan_config_t *chan_cfg, i2s_chan_handle_t *ret_tx_handle,
+                                 i2s_chan_handle_t *ret_rx_handle)
+{
+    if ((chan_cfg == NULL) || (ret_tx_handle == NULL)) {
+        return __real_i2s_new_channel(chan_cfg, ret_tx_handle, ret_rx_handle);
+    }
+
+    i2s_chan_config_t cfg = *chan_cfg;
+    cfg.dma_desc_num = CONFIG_UI_SOUND_I2S_DMA_DESC_NUM;
+    cfg.dma_frame_num = CONFIG_UI_SOUND_I2S_DMA_FRAME_NUM;
+    // Silence instead of the last buffer repeated once the writes stop
+    cfg.auto_clear = true;
+    ESP_LOGI(TAG, "I2S DMA %d x %d frames", (int)cfg.dma_desc_num, (int)cfg.dma_frame_num);
+
+    return __real_i2s_new_channel(&cfg, ret_tx_handle, ret_rx_handle);
+}
+
+static void sound_render(const sound_tone_t *tones, int16_t *pcm)
+{
+    float phase = 0;
+
+    for (int t = 0; (t < SOUND_TONE_NUM) && (tones[t].ms > 0); t++) {
+        const sound_tone_t *tone = &tones[t];
+        int len = tone->ms * SOUND_RATE / 1000;
+        int attack = SOUND_RATE / 2000;         /* 0.5 ms, the start of a tone does not click */
+        float level = tone->level_percent * 327.67f;
+        for (int i = 0; i < len; i++) {
+            float x = (float)i / len;
+            float hz = tone->start_hz + (tone->end_hz - tone->start_hz) * x;
+            float env = expf(-(float)i * 1000 / (tone->decay_ms * (float)SOUND_RATE));
+            env *= (i < attack) ? ((float)i / attack) : 1;
+            *pcm++ = (int16_t)(level * env * sinf(phase));
+            phase += 2 * M_PI * hz / SOUND_RATE;
+            phase = (phase > 2 * M_PI) ? (phase - 2 * M_PI) : phase;
+        }
+    }
+}
+
+static bool sound_busy(void)
+{
+    taskENTER_CRITICAL(&s_sound.lock);
+    bool pending = (s_sound.pending != 0);
+    taskEXIT_CRITICAL(&s_sound.lock);
+
+    return pending || (atomic_load(&s_sound.voice_num) > 0);
+}
+
+static bool sound_codec_free(void)
+{
+    return (esp_timer_get_time() - atomic_load(&s_sound.other_write_us)) > SOUND_IDLE_MS * 1000;
+}
+
+static void sound_start_voices(void)
+{
+    taskENTER_CRITICAL(&s_sound.lock);
+    uint32_t pending = s_sound.pending;
+    s_sound.pending = 0;
+    taskEXIT_CRITICAL(&s_sound.lock);
+
+    for (int s = 0; pending != 0; s++, pending >>= 1) {
+        if (!(pending & 1)) {
+            continue;
+        }
+        // A free voice, or the one closest to its end
+        sound_voice_t *voice = &s_sound.voices[0];
+        for (int v = 0; v < SOUND_VOICE_NUM; v++) {
+            if (s_sound.voices[v].pcm == NULL) {
+                voice = &s_sound.voices[v];
+                break;
+            }
+            uint64_t done = (uint64_t)(s_sound.voices[v].pos >> 16) * voice->len;
+            if (done > (uint64_t)(voice->pos >> 16) * s_sound.voices[v].len) {
+                voice = &s_sound.voices[v];
+            }
+        }
+        voice->pcm = s_sound.pcm[s];
+        voice->len = s_sound.len[s];
+        voice->pos = 0;
+    }
+}
+
+/* Writes silence through the codec tap, which mixes the effects into it, while the music player does not write */
+static void sound_task(void *arg)
+{
+    static uint8_t block[UI_SOUND_BLOCK_FRAMES * SOUND_MAX_FRAME_SIZE];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // The music writes carry the effects while it plays
+        if (!sound_busy() || !sound_codec_free()) {
+            continue;
+        }
+
+        // The player mutes the codec when it stops, and the mute clears its volume
+        pm_policy_acquire(PM_POLICY_CLIENT_AUDIO);
+        bsp_extra_codec_mute_set(false);
+        bsp_extra_codec_volume_set(settings_store_get(SETTINGS_KEY_AUDIO_VOLUME), NULL);
+
+        // Silence until the effects end, then a DMA ring more so their last samples are played out
+        int tail = CONFIG_UI_SOUND_I2S_DMA_DESC_NUM;
+        while ((tail > 0) && sound_codec_free()) {
+            size_t len = UI_SOUND_BLOCK_FRAMES * atomic_load(&s_sound.frame_size);
+            size_t written = 0;
+            memset(block, 0, len);
+            if (bsp_extra_i2s_write(block, len, &written, SOUND_WRITE_TIMEOUT_MS) != ESP_OK) {
+                ESP_LOGW(TAG, "Write failed");
+                break;
+            }
+            tail = sound_busy() ? CONFIG_UI_SOUND_I2S_DMA_DESC_NUM : (tail - 1);
+        }
+        pm_policy_release(PM_POLICY_CLIENT_AUDIO);
+    }
+}
+#endif
+
+esp_err_t ui_sound_init(void)
+{
+#if CONFIG_UI_SOUND
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(s_sound.task == NULL, ESP_OK, TAG, "Already started");
+
+    for (int s = 0; s < UI_SOUND_NUM; s++) {
+        uint32_t ms = sound_tones[s][0].ms + sound_tones[s][1].ms;
+        s_sound.len[s] = ms * SOUND_RATE / 1000;
+        s_sound.pcm[s] = heap_caps_malloc(s_sound.len[s] * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ESP_GOTO_ON_FALSE(s_sound.pcm[s], ESP_ERR_NO_MEM, err, TAG, "No memory for effect %d", s);
+        sound_render(sound_tones[s], s_sound.pcm[s]);
+    }
+    s_sound.mix_mutex = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(s_sound.mix_mutex, ESP_ERR_NO_MEM, err, TAG, "No memory");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_UI_SOUND, sound_task, NULL, &s_sound.task) == pdPASS,
+                      ESP_ERR_NO_MEM, err, TAG, "Create task failed");
+
+    return ESP_OK;
+
+err:
+    if (s_sound.mix_mutex) {
+        vSemaphoreDelete(s_sound.mix_mutex);
+        s_sound.mix_mutex = NULL;
+    }
+    for (int s = 0; s < UI_SOUND_NUM; s++) {
+        heap_caps_free(s_sound.pcm[s]);
+        s_sound.pcm[s] = NULL;
+    }
+    s_sound.task = NULL;
+
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void ui_sound_play(ui_sound_t sound)
+{
+#if CONFIG_UI_SOUND
+    if ((s_sound.task == NULL) || (sound >= UI_SOUND_NUM)) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&s_sound.lock);
+    s_sound.pending |= 1 << sound;
+    taskEXIT_CRITICAL(&s_sound.lock);
+    xTaskNotifyGive(s_sound.task);
+#endif
+}
+
+void ui_sound_mix(void *data, int len, uint8_t bits_per_sample, uint8_t channel, uint32_t sample_rate)
+{
+#if CONFIG_UI_SOUND
+    if ((s_sound.task == NULL) || (data == NULL) || (channel == 0) || (sample_rate == 0) ||
+            ((bits_per_sample != 16) && (bits_per_sample != 32))) {
+        return;
+    }
+
+    int frame_size = (bits_per_sample / 8) * channel;
+    if (xTaskGetCurrentTaskHandle() != s_sound.task) {
+        atomic_store(&s_sound.other_write_us, esp_timer_get_time());
+    }
+    atomic_store(&s_sound.frame_size, (frame_size <= SOUND_MAX_FRAME_SIZE) ? frame_size : SOUND_MAX_FRAME_SIZE);
+    if (!sound_busy() || (xSemaphoreTake(s_sound.mix_mutex, 0) != pdTRUE)) {
+        return;
+    }
+
+    sound_start_voices();
+    uint32_t step = ((uint64_t)SOUND_RATE << 16) / sample_rate;
+    int frames = len / frame_size;
+    int voice_num = 0;
+    for (int v = 0; v < SOUND_VOICE_NUM; v++) {
+        sound_voice_t *voice = &s_sound.voices[v];
+        if (voice->pcm == NULL) {
+            continue;
+        }
+        for (int i = 0; (i < frames) && ((voice->pos >> 16) < voice->len); i++, voice->pos += step) {
+            int32_t sample = voice->pcm[voice->pos >> 16];
+            for (int c = 0; c < channel; c++) {
+                if (bits_per_sample == 16) {
+                    int16_t *out = (int16_t *)data + i * channel + c;
+                    int32_t mixed = *out + sample;
+                    *out = (mixed > INT16_MAX) ? INT16_MAX : (mixed < INT16_MIN) ? INT16_MIN : (int16_t)mixed;
+                } else {
+                    int32_t *out = (int32_t *)data + i * channel + c;
+                    int64_t mixed = (int64_t)*out + ((int64_t)sample << 16);
+                    *out = (mixed > INT32_MAX) ? INT32_MAX : (mixed < INT32_MIN) ? INT32_MIN : (int32_t)mixed;
+                }
+            }
+        }
+        if ((voice->pos >> 16) >= voice->len) {
+            voice->pcm = NULL;
+        } else {
+            voice_num++;
+        }
+    }
+    atomic_store(&s_sound.voice_num, voice_num);
+    xSemaphoreGive(s_sound.mix_mutex);
+#endif
+}
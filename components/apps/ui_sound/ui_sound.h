@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sound effects of the UI, rendered into internal RAM by `ui_sound_init()`
+ */
+typedef enum {
+    UI_SOUND_CLICK = 0,             /*!< Button press */
+    UI_SOUND_KEY,                   /*!< Key of a keypad */
+    UI_SOUND_MOVE,                  /*!< Game move */
+    UI_SOUND_NOTIFY,                /*!< Two tone chime */
+    UI_SOUND_NUM,
+} ui_sound_t;
+
+#if CONFIG_UI_SOUND
+/**
+ * @brief Frames of the blocks written to the codec, the same as a DMA buffer of the I2S channel
+ */
+#define UI_SOUND_BLOCK_FRAMES       (CONFIG_UI_SOUND_I2S_DMA_FRAME_NUM)
+#endif
+
+/**
+ * @brief Render the effects and start the task that plays them while nothing else writes to the codec.
+ *
+ * Must be called once the codec is initialized.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NO_MEM         No internal RAM for the effects or the task
+ *      - ESP_ERR_NOT_SUPPORTED  `CONFIG_UI_SOUND` is disabled
+ */
+esp_err_t ui_sound_init(void);
+
+/**
+ * @brief Start an effect, mixed over the music if it plays. Can be called from any task, does not block.
+ *
+ * Up to 4 effects play at once, a new one replaces the oldest. Does nothing before `ui_sound_init()`.
+ *
+ * @param sound Effect to play
+ */
+void ui_sound_play(ui_sound_t sound);
+
+/**
+ * @brief Add the playing effects to a block of PCM data, called by the codec tap before the I2S write.
+ *
+ * @param data            PCM data, 16 or 32 bit, mono or interleaved stereo, mixed in place
+ * @param len             Length of `data` in bytes
+ * @param bits_per_sample Sample size of the codec
+ * @param channel         Channels of the codec
+ * @param sample_rate     Sample rate of the codec, the effects are resampled to it
+ */
+void ui_sound_mix(void *data, int len, uint8_t bits_per_sample, uint8_t channel, uint32_t sample_rate);
+
+#ifdef __cplusplus
+}
+#endif
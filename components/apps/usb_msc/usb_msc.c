@@ -0,0 +1,308 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "bsp/esp-bsp.h"
+#include "task_config/task_config.h"
+#include "pm_policy/pm_policy.h"
+#include "usb_msc.h"
+
+static const char *TAG = "usb_msc";
+
+#if CONFIG_USB_MSC
+#include "tinyusb.h"
+#include "tinyusb_msc.h"
+#include "driver/sdmmc_host.h"
+#include "sd_io/sd_io.h"
+
+#define MSC_LISTENER_NUM_MAX        (4)
+#define MSC_EP_OUT                  (0x01)
+#define MSC_EP_IN                   (0x81)
+#define MSC_EP_SIZE_FS              (64)
+#define MSC_EP_SIZE_HS              (512)
+#define MSC_CONFIG_TOTAL_LEN        (TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN)
+#define MSC_VID                     (0x303A)    /* Espressif */
+#define MSC_PID                     (0x4002)    /* Same as the TinyUSB MSC example of ESP-IDF */
+#if CONFIG_USB_MSC_PORT_HS
+#define MSC_PORT_NAME               "high speed"
+#else
+#define MSC_PORT_NAME               "full speed"
+#endif
+
+enum {
+    MSC_ITF_NUM = 0,
+    MSC_ITF_TOTAL,
+};
+
+enum {
+    MSC_STR_LANG = 0,
+    MSC_STR_MANUFACTURER,
+    MSC_STR_PRODUCT,
+    MSC_STR_SERIAL,
+    MSC_STR_INTERFACE,
+    MSC_STR_NUM,
+};
+
+typedef struct {
+    usb_msc_listener_t listener;
+    void *user_ctx;
+} msc_listener_t;
+
+static const tusb_desc_device_t msc_device_desc = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = TUSB_CLASS_UNSPECIFIED,
+    .bDeviceSubClass = 0,
+    .bDeviceProtocol = 0,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = MSC_VID,
+    .idProduct = MSC_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = MSC_STR_MANUFACTURER,
+    .iProduct = MSC_STR_PRODUCT,
+    .iSerialNumber = MSC_STR_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t msc_fs_config_desc[] = {
+    TUD_CONFIG_DESCRIPTOR(1, MSC_ITF_TOTAL, 0, MSC_CONFIG_TOTAL_LEN, 0, 100),
+    TUD_MSC_DESCRIPTOR(MSC_ITF_NUM, MSC_STR_INTERFACE, MSC_EP_OUT, MSC_EP_IN, MSC_EP_SIZE_FS),
+};
+
+#if CONFIG_USB_MSC_PORT_HS
+static const uint8_t msc_hs_config_desc[] = {
+    TUD_CONFIG_DESCRIPTOR(1, MSC_ITF_TOTAL, 0, MSC_CONFIG_TOTAL_LEN, 0, 100),
+    TUD_MSC_DESCRIPTOR(MSC_ITF_NUM, MSC_STR_INTERFACE, MSC_EP_OUT, MSC_EP_IN, MSC_EP_SIZE_HS),
+};
+
+static const tusb_desc_device_qualifier_t msc_qualifier_desc = {
+    .bLength = sizeof(tusb_desc_device_qualifier_t),
+    .bDescriptorType = TUSB_DESC_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = TUSB_CLASS_UNSPECIFIED,
+    .bDeviceSubClass = 0,
+    .bDeviceProtocol = 0,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .bNumConfigurations = 1,
+    .bReserved = 0,
+};
+#endif
+
+static const char *msc_string_desc[MSC_STR_NUM] = {
+    (const char[]) { 0x09, 0x04 },  /* English */
+    "Espressif",
+    "ESP32-P4 SD card",
+    "000001",
+    "SD card",
+};
+
+static struct {
+    sdmmc_card_t card;
+    tinyusb_msc_storage_handle_t storage;
+    TaskHandle_t task;
+    portMUX_TYPE lock;              /* Guards the fields below */
+    msc_listener_t listeners[MSC_LISTENER_NUM_MAX];
+    volatile bool attached;         /* Last state reported by TinyUSB */
+    volatile bool host_owns;        /* Last state handed over by the task */
+} s_msc = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static void msc_notify(usb_msc_event_t event)
+{
+    msc_listener_t listeners[MSC_LISTENER_NUM_MAX];
+
+    // Called without the lock, a listener may take a while to close its files
+    portENTER_CRITICAL(&s_msc.lock);
+    memcpy(listeners, s_msc.listeners, sizeof(listeners));
+    portEXIT_CRITICAL(&s_msc.lock);
+    for (int i = 0; i < MSC_LISTENER_NUM_MAX; i++) {
+        if (listeners[i].listener) {
+            listeners[i].listener(event, listeners[i].user_ctx);
+        }
+    }
+}
+
+static void msc_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // A quick replug may give both events at once, only the last state is handed over
+        while (s_msc.attached != s_msc.host_owns) {
+            if (s_msc.attached) {
+                s_msc.host_owns = true;
+                msc_notify(USB_MSC_EVENT_HOST_ATTACHED);
+                if (tinyusb_msc_set_storage_mount_point(s_msc.storage, TINYUSB_MSC_STORAGE_MOUNT_USB) != ESP_OK) {
+                    ESP_LOGE(TAG, "Hand the card to the host failed");
+                } else {
+                    ESP_LOGI(TAG, "Card used by the USB host");
+                }
+            } else {
+                if (tinyusb_msc_set_storage_mount_point(s_msc.storage, TINYUSB_MSC_STORAGE_MOUNT_APP) != ESP_OK) {
+                    ESP_LOGE(TAG, "Mount the card again failed");
+                } else {
+                    ESP_LOGI(TAG, "Card mounted at %s", BSP_SD_MOUNT_POINT);
+                }
+                s_msc.host_owns = false;
+                msc_notify(USB_MSC_EVENT_HOST_DETACHED);
+            }
+        }
+    }
+}
+
+static void msc_usb_event_cb(tinyusb_event_t *event, void *arg)
+{
+    // From the TinyUSB task, which also serves the host, the hand over runs in the usb_msc task
+    switch (event->id) {
+    case TINYUSB_EVENT_ATTACHED:
+        // The host polls the card at any time, the transfers can't wait for a wakeup
+        if (!s_msc.attached) {
+            pm_policy_acquire(PM_POLICY_CLIENT_USB);
+        }
+        s_msc.attached = true;
+        break;
+    case TINYUSB_EVENT_DETACHED:
+        if (s_msc.attached) {
+            pm_policy_release(PM_POLICY_CLIENT_USB);
+        }
+        s_msc.attached = false;
+        break;
+    default:
+        return;
+    }
+    xTaskNotifyGive(s_msc.task);
+}
+
+static void msc_storage_event_cb(tinyusb_msc_storage_handle_t handle, tinyusb_msc_event_t *event, void *arg)
+{
+    if (event->id == TINYUSB_MSC_EVENT_MOUNT_FAILED) {
+        ESP_LOGE(TAG, "Mount of the card file system failed");
+    }
+}
+
+esp_err_t usb_msc_mount(void)
+{
+    esp_err_t ret = ESP_OK;
+    const task_config_t *usb_task = task_config_get(TASK_CONFIG_USB_MSC_TINYUSB);
+    const tinyusb_msc_driver_config_t driver_config = {
+        // The card is only handed to the host by the usb_msc task, once the apps closed their files
+        .user_flags.auto_mount_off = 1,
+        .callback = msc_storage_event_cb,
+    };
+    const tinyusb_msc_storage_config_t storage_config = {
+        .medium.card = &s_msc.card,
+        .fat_fs = {
+            .base_path = BSP_SD_MOUNT_POINT,
+            .config = {
+                .format_if_mount_failed = false,
+                .max_files = SD_IO_MAX_FILES,
+                .allocation_unit_size = SD_IO_ALLOC_UNIT_SIZE,
+            },
+            .do_not_format = true,
+        },
+        .mount_point = TINYUSB_MSC_STORAGE_MOUNT_APP,
+    };
+    tinyusb_config_t usb_config = TINYUSB_DEFAULT_CONFIG();
+
+    ESP_RETURN_ON_FALSE(s_msc.task == NULL, ESP_ERR_INVALID_STATE, TAG, "Already mounted");
+
+    ESP_RETURN_ON_ERROR(sd_io_card_init(&s_msc.card), TAG, "Init card failed");
+    ESP_GOTO_ON_ERROR(tinyusb_msc_install_driver(&driver_config), err_card, TAG, "Install MSC driver failed");
+    ESP_GOTO_ON_ERROR(tinyusb_msc_new_storage_sdmmc(&storage_config, &s_msc.storage), err_driver, TAG,
+                      "Mount card failed");
+    ESP_GOTO_ON_FALSE(task_config_create(TASK_CONFIG_USB_MSC, msc_task, NULL, &s_msc.task) == pdPASS, ESP_ERR_NO_MEM,
+                      err_storage, TAG, "Create task failed");
+
+#if CONFIG_USB_MSC_PORT_HS
+    usb_config.port = TINYUSB_PORT_HIGH_SPEED_0;
+    usb_config.descriptor.high_speed_config = msc_hs_config_desc;
+    usb_config.descriptor.qualifier = &msc_qualifier_desc;
+#else
+    usb_config.port = TINYUSB_PORT_FULL_SPEED_0;
+#endif
+    usb_config.phy.self_powered = (CONFIG_USB_MSC_VBUS_MONITOR_GPIO >= 0);
+    usb_config.phy.vbus_monitor_io = CONFIG_USB_MSC_VBUS_MONITOR_GPIO;
+    usb_config.task.size = usb_task->stack_size;
+    usb_config.task.priority = usb_task->priority;
+    usb_config.task.xCoreID = usb_task->core_id;
+    usb_config.descriptor.device = &msc_device_desc;
+    usb_config.descriptor.full_speed_config = msc_fs_config_desc;
+    usb_config.descriptor.string = msc_string_desc;
+    usb_config.descriptor.string_count = MSC_STR_NUM;
+    usb_config.event_cb = msc_usb_event_cb;
+    ESP_GOTO_ON_ERROR(tinyusb_driver_install(&usb_config), err_task, TAG, "Install TinyUSB driver failed");
+
+    ESP_LOGI(TAG, "Card mounted at %s, exposed on the %s port", BSP_SD_MOUNT_POINT, MSC_PORT_NAME);
+
+    return ESP_OK;
+
+err_task:
+    task_config_delete(TASK_CONFIG_USB_MSC, s_msc.task);
+    s_msc.task = NULL;
+err_storage:
+    tinyusb_msc_delete_storage(s_msc.storage);
+    s_msc.storage = NULL;
+err_driver:
+    tinyusb_msc_uninstall_driver();
+err_card:
+    sdmmc_host_deinit();
+
+    return ret;
+}
+
+esp_err_t usb_msc_add_listener(usb_msc_listener_t listener, void *user_ctx)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    ESP_RETURN_ON_FALSE(listener, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    portENTER_CRITICAL(&s_msc.lock);
+    for (int i = 0; i < MSC_LISTENER_NUM_MAX; i++) {
+        if (s_msc.listeners[i].listener == NULL) {
+            s_msc.listeners[i].listener = listener;
+            s_msc.listeners[i].user_ctx = user_ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_msc.lock);
+
+    ESP_RETURN_ON_ERROR(ret, TAG, "No free listener slot");
+
+    return ESP_OK;
+}
+
+bool usb_msc_host_owns_card(void)
+{
+    return s_msc.host_owns;
+}
+
+#else
+
+esp_err_t usb_msc_mount(void)
+{
+    ESP_LOGD(TAG, "USB mass storage disabled");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t usb_msc_add_listener(usb_msc_listener_t listener, void *user_ctx)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+bool usb_msc_host_owns_card(void)
+{
+    return false;
+}
+
+#endif /* CONFIG_USB_MSC */
@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Owner changes of the SD card
+ */
+typedef enum {
+    USB_MSC_EVENT_HOST_ATTACHED,    /*!< A USB host is about to get the card, stop using the files under
+                                         `BSP_SD_MOUNT_POINT` before returning */
+    USB_MSC_EVENT_HOST_DETACHED,    /*!< The card is mounted again for the apps, its files may have changed */
+} usb_msc_event_t;
+
+/**
+ * @brief Listener of the owner changes, called from the `usb_msc` task without the LVGL lock
+ *
+ * @param event Owner change.
+ * @param user_ctx Context given to `usb_msc_add_listener`.
+ */
+typedef void (*usb_msc_listener_t)(usb_msc_event_t event, void *user_ctx);
+
+/**
+ * @brief Mount the SD card at `BSP_SD_MOUNT_POINT` and expose it as a USB mass storage device, in place of
+ *        `sd_io_mount`.
+ *
+ * The card is initialized on the bus of `sd_io_mount` and used by the apps as usual. When a USB host enumerates the
+ * device on the port chosen by `CONFIG_USB_MSC_PORT_HS` or `CONFIG_USB_MSC_PORT_FS`, the listeners are told to close
+ * their files, then the file system is unmounted and the host reads and writes the sectors of the card through the
+ * `CONFIG_TINYUSB_MSC_BUFSIZE` buffer. It reports no medium until then. Once the cable is unplugged, the card is
+ * mounted again and the listeners are told.
+ *
+ * @return ESP_OK on success, the errors of the card init, the TinyUSB driver or the mount, or
+ *         ESP_ERR_NOT_SUPPORTED if the mass storage is disabled.
+ */
+esp_err_t usb_msc_mount(void);
+
+/**
+ * @brief Add a listener of the owner changes.
+ *
+ * @param listener Listener.
+ * @param user_ctx Passed to the listener.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM if all the listener slots are taken, or
+ *         ESP_ERR_NOT_SUPPORTED if the mass storage is disabled.
+ */
+esp_err_t usb_msc_add_listener(usb_msc_listener_t listener, void *user_ctx);
+
+/**
+ * @brief Check if a USB host has the card, the files under `BSP_SD_MOUNT_POINT` can't be opened meanwhile.
+ *
+ * True from `USB_MSC_EVENT_HOST_ATTACHED` until `USB_MSC_EVENT_HOST_DETACHED`. Always false if the mass storage is
+ * disabled.
+ */
+bool usb_msc_host_owns_card(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -20,6 +20,23 @@
 #define APP_MAX_VIDEO_NUM           (15)
 #define APP_VIDEO_FRAME_BUF_SIZE    (720 * 1280 * BSP_LCD_BITS_PER_PIXEL / 8)
 #define APP_CACHE_BUF_SIZE          (64 * 1024)
+#if CONFIG_VIDEO_PLAYER_DIRECT_OUTPUT
+#define APP_VIDEO_DIRECT_OUTPUT     (1)
+#else
+#define APP_VIDEO_DIRECT_OUTPUT     (0)
+#endif
+#if CONFIG_VIDEO_PLAYER_FIT_FILL
+#define APP_VIDEO_FIT               PLAYER_FIT_FILL
+#elif CONFIG_VIDEO_PLAYER_FIT_NONE
+#define APP_VIDEO_FIT               PLAYER_FIT_NONE
+#else
+#define APP_VIDEO_FIT               PLAYER_FIT_LETTERBOX
+#endif
+#if CONFIG_VIDEO_PLAYER_AUTO_ROTATE
+#define APP_VIDEO_AUTO_ROTATE       (1)
+#else
+#define APP_VIDEO_AUTO_ROTATE       (0)
+#endif
 #define APP_BREAKING_NEWS_TEXT      "This example demonstrates the JPEG decoding capability of the ESP32-P4"
 
 using namespace std;
@@ -35,7 +52,9 @@ AppVideoPlayer::AppVideoPlayer():
     img_breaking_news(NULL),
     row_edit(NULL),
     lbl_breaking_news(NULL),
-    _file_iterator(NULL)
+    _file_iterator(NULL),
+    _media_index(NULL),
+    _is_running(false)
 {
     memset(_video_path, 0, sizeof(_video_path));
 }
@@ -46,6 +65,12 @@ AppVideoPlayer::~AppVideoPlayer()
 
 bool AppVideoPlayer::run(void)
 {
+    // The videos are listed again on every run, files copied by the USB host show up once it is unplugged
+    if (usb_msc_host_owns_card()) {
+        ESP_LOGW(TAG, "SD card is used by the USB host");
+        return false;
+    }
+    _is_running = true;
     app_show_ui();
 
     return true;
@@ -72,18 +97,44 @@ bool AppVideoPlayer::back(void)
 
 bool AppVideoPlayer::close(void)
 {
+    _is_running = false;
     bsp_display_unlock();
     esp_lvgl_simple_player_del();
     bsp_display_lock(100);
 
+    media_index_close(_media_index);
+    _media_index = NULL;
+
     return true;
 }
 
 bool AppVideoPlayer::init(void)
 {
+    // The audio tracks of the videos go through the shared audio player
+    if (bsp_extra_player_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Audio player init failed, videos play without sound");
+    }
+
+    esp_err_t ret = usb_msc_add_listener(onCardOwnerChanged, this);
+    if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+        ESP_LOGW(TAG, "usb_msc_add_listener failed, the card may be taken while playing");
+    }
+
     return true;
 }
 
+void AppVideoPlayer::onCardOwnerChanged(usb_msc_event_t event, void *user_ctx)
+{
+    AppVideoPlayer *app = (AppVideoPlayer *)user_ctx;
+
+    // Closing deletes the player, which closes the video and the BGM before the host gets the card
+    if ((event == USB_MSC_EVENT_HOST_ATTACHED) && app->_is_running) {
+        bsp_display_lock(0);
+        app->notifyCoreClosed();
+        bsp_display_unlock();
+    }
+}
+
 void AppVideoPlayer::app_show_ui(void)
 {
     uint8_t i = 0;
@@ -155,12 +206,30 @@ void AppVideoPlayer::app_show_ui(void)
         .cache_buff_in_psram = true,
         .screen_width = 800,
         .screen_height = 1280,
+        .fps = CONFIG_VIDEO_PLAYER_MJPEG_FPS,
+        .fit = APP_VIDEO_FIT,
         .flags = {
             .auto_height = true,
+            .direct_output = APP_VIDEO_DIRECT_OUTPUT,
+            .auto_rotate = APP_VIDEO_AUTO_ROTATE,
         },
     };
     esp_lvgl_simple_player_create(&player_cfg);
 
+    /* Loop over every video of the card, starting with the selected one */
+    _playlist_paths.clear();
+    _playlist.clear();
+    for (auto &it : _midea_info_vect) {
+        _playlist_paths.push_back(string(BSP_SD_MOUNT_POINT "/") + it.video_name);
+    }
+    for (auto &it : _playlist_paths) {
+        _playlist.push_back(it.c_str());
+    }
+    if (_playlist.size() > 1) {
+        esp_lvgl_simple_player_set_playlist(_playlist.data(), _playlist.size());
+        esp_lvgl_simple_player_repeat(true);
+    }
+
     /* Breaking news image */
     // img_breaking_news = lv_img_create(lv_scr_act());
     // lv_img_set_src(img_breaking_news, &breaking_news);
@@ -196,12 +265,34 @@ uint8_t AppVideoPlayer::searchMideaFiles(void)
                     break;
                 }
                 ESP_LOGI(TAG, "Found video file: %s", dir->d_name);
-                _midea_info_vect.push_back({string(dir->d_name)});
+                _midea_info_vect.push_back({string(dir->d_name), 0});
             }
         }
         closedir(d);  // Always close the directory
     }
 
+    // Sort the playlist with the index saved before, files not indexed yet are sorted by name
+    media_index_close(_media_index);
+    _media_index = NULL;
+    vector<const char *> names;
+    for (auto &it : _midea_info_vect) {
+        names.push_back(it.video_name.c_str());
+    }
+    vector<int> order(names.size());
+    if ((media_index_open(BSP_SD_MOUNT_POINT, names.data(), names.size(), &_media_index) == ESP_OK) &&
+            (media_index_sort(_media_index, order.data()) == ESP_OK)) {
+        vector<MideaInfo_t> sorted;
+        media_index_info_t info;
+        for (int index : order) {
+            sorted.push_back(_midea_info_vect[index]);
+            if (media_index_get(_media_index, index, &info)) {
+                sorted.back().duration_ms = info.duration_ms;
+                ESP_LOGI(TAG, "Video %s: %d s", sorted.back().video_name.c_str(), (int)(info.duration_ms / 1000));
+            }
+        }
+        _midea_info_vect.swap(sorted);
+    }
+
     // Select the video file based on 'sel_file'
     if (!_midea_info_vect.empty() && sel_file >= 0 && sel_file < _midea_info_vect.size()) {
         _video_name = _midea_info_vect[sel_file].video_name.c_str();
@@ -273,6 +364,7 @@ void AppVideoPlayer::file_changed(lv_event_t * e)
         }
         bsp_display_lock(100);
 
+        esp_lvgl_simple_player_set_playlist(NULL, 0);
         esp_lvgl_simple_player_change_file(video_path);
         esp_lvgl_simple_player_play();
     }
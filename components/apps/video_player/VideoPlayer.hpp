@@ -9,6 +9,8 @@
 #include "lvgl.h"
 #include "esp_brookesia.hpp"
 #include "file_iterator.h"
+#include "media_index/media_index.h"
+#include "usb_msc/usb_msc.h"
 
 class AppVideoPlayer: public ESP_Brookesia_PhoneApp {
 public:
@@ -26,6 +28,7 @@ public:
 private:
     typedef struct {
         std::string video_name;
+        uint32_t duration_ms;   // 0 if not indexed yet
         // std::string bgm_path;
     } MideaInfo_t;
 
@@ -40,12 +43,17 @@ private:
     static void edit_event_cb(lv_event_t * e);
     static void save_event_cb(lv_event_t * e);
     static void audio_player_callback(audio_player_cb_ctx_t *ctx);
+    static void onCardOwnerChanged(usb_msc_event_t event, void *user_ctx);
 
     char _video_path[64];
     const char *_video_name;
     std::vector<MideaInfo_t> _midea_info_vect;
+    std::vector<std::string> _playlist_paths;
+    std::vector<const char *> _playlist;
     lv_obj_t * img_breaking_news;
     lv_obj_t * row_edit;
     lv_obj_t * lbl_breaking_news;
     file_iterator_instance_t *_file_iterator;
+    media_index_handle_t _media_index;
+    bool _is_running;
 };
@@ -4,37 +4,84 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <math.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_heap_caps.h"
 #include "esp_cache.h"
 #include "esp_private/esp_cache_private.h"
 #include "esp_dma_utils.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/jpeg_decode.h"
+#include "driver/ppa.h"
 #include "media_src_storage.h"
+#include "media_frame_index.h"
+#include "media_audio_stream.h"
 #include "bsp/esp-bsp.h"
 #include "bsp_board_extra.h"
+#include "jpeg_dec_service/jpeg_dec_service.h"
+#include "sd_io/sd_io.h"
+#include "task_config/task_config.h"
 #include "esp_lvgl_simple_player.h"
 
 #define CACHE_BUF_ALIGN         (1024)
+#define PLAYER_IN_BUF_NUM       (3)     /* Compressed frames in flight between the reader and the decoder */
+#define PLAYER_OUT_BUF_NUM      (3)     /* Decoded frames: one shown, one queued, one being decoded */
+#define PLAYER_FRAME_EOS        (0xFF)  /* Frame index marking the end of the stream */
+#define PLAYER_STAGE_NUM        (2)     /* Decode and display stages */
+#define PLAYER_READ_WAIT_MS     (100)
+#define PLAYER_NO_SEEK          (-1)
+#define PLAYER_SCALE_STEP       (16)    /* PPA scale factors are multiples of 1/16 */
+#define PLAYER_AUDIO_BUFFER_MS  (500)   /* Audio read ahead of the player, covers the card stalling on a big frame */
 
 #define ALIGN_UP(num, align)    (((num) + ((align) - 1)) & ~((align) - 1))
 #define ALIGN_DOWN(num, align)    (((num) - ((align) + 1)) & ~((align) - 1))
 
 static const char *TAG = "esp_lvgl_player";
+static const uint16_t SOI = 0xd8ff; /* Start of image */
 static const uint16_t EOI = 0xd9ff; /* End of image */
 static TaskHandle_t player_task_handle = NULL;
 
+typedef struct {
+    const char          *path;
+    media_src_t         file;
+    bool                opened;
+    media_frame_index_t index;      /* Every frame is a single read of known length when available */
+    uint32_t            width;      /* Decoded width, aligned to 16 */
+    uint32_t            height;
+    uint32_t            frame_us;   /* 0 when frames are not paced */
+} player_source_t;
+
+typedef struct {
+    uint8_t     index;  /* Buffer index, PLAYER_FRAME_EOS to end the stream */
+    uint8_t     epoch;  /* Clock epoch the frame was read in */
+    int64_t     due_us; /* Presentation time, 0 to show at once */
+    uint32_t    size;   /* Valid bytes in the buffer */
+} player_frame_msg_t;
+
+/* A decoded frame with the PPA, both buffers are handed on from the completion interrupt */
+typedef struct {
+    player_frame_msg_t  decoded;
+    player_frame_msg_t  present;
+} player_present_job_t;
+
 typedef struct
 {
     bool is_init;
     const char              *video_path;
     const char              *bgm_path;
-    media_src_t             file;
-    uint64_t                filesize;
-    jpeg_decoder_handle_t   jpeg;
+
+    /* Playlist, `video_path` is played alone when it is empty */
+    const char  *const *playlist;
+    uint32_t    playlist_num;
+    uint32_t    playlist_pos;
+    player_source_t source;         /* File being read */
+    player_source_t next;           /* Following file, opened ahead so the reader moves on without a gap */
 
     uint32_t    screen_width;   /* Width of the video player object */
     uint32_t    screen_height;  /* Height of the video player object */
@@ -48,16 +95,55 @@ typedef struct
     bool            hide_status;
     bool            auto_width;
     bool            auto_height;
+    bool            direct_output;
 
     /* Buffers */
-    uint8_t     *in_buff;
+    uint8_t     *in_buff[PLAYER_IN_BUF_NUM];
     uint32_t    in_buff_size;
-    uint8_t     *out_buff;
+    uint8_t     *out_buff[PLAYER_OUT_BUF_NUM];
     uint32_t    out_buff_size;
     uint8_t     *cache_buff;
     uint32_t    cache_buff_size;
     bool        cache_buff_in_psram;
 
+    uint32_t    frame_pos;          /* Next frame to read */
+    int32_t     seek_frame;         /* Frame requested by `esp_lvgl_simple_player_seek`, PLAYER_NO_SEEK if none */
+
+    /* Presentation clock of the file being read, frame N is due at clock_start_us + N * source.frame_us */
+    uint32_t    fps;                /* Frame rate of raw MJPEG files from the configuration */
+    int64_t     clock_start_us;
+    uint8_t     clock_epoch;        /* Bumped on seek, frames of an older epoch are shown at once */
+    uint32_t    frames_late;
+
+    /* Audio track of the file being read, the clock follows the audio heard while there is some */
+    bool        audio_running;
+    uint32_t    audio_entry;        /* Next chunk to feed */
+    uint32_t    audio_entry_fed;    /* Bytes of that chunk already in the jitter buffer */
+    uint64_t    audio_pass_start;   /* Stream position of the first byte of the track of the file being read */
+
+    /* Pipeline between the reader, decode and display stages, carrying `player_frame_msg_t` */
+    QueueHandle_t   in_free_queue;
+    QueueHandle_t   decode_queue;
+    QueueHandle_t   out_free_queue;
+    QueueHandle_t   display_queue;
+    SemaphoreHandle_t stage_done_sem;
+
+    /* Direct output, frames are flushed to the panel without going through LVGL */
+    lv_disp_t           *disp;
+
+    /* Presentation, the PPA scales and turns decoded frames to the output when they don't match it */
+    player_fit_t        fit;
+    bool                auto_rotate;
+    uint32_t            output_width;       /* Panel with direct output, player object with the canvas */
+    uint32_t            output_height;
+    ppa_client_handle_t ppa_srm;            /* NULL when decoded frames are shown as they are */
+    ppa_srm_oper_config_t present_oper;     /* Geometry of the current video, the buffers are set per frame */
+    uint8_t             *present_buff[PLAYER_OUT_BUF_NUM];
+    uint32_t            present_buff_size;
+    QueueHandle_t       present_free_queue;
+    SemaphoreHandle_t   present_done_sem;   /* Given from the PPA interrupt for every frame it finished */
+    player_present_job_t present_jobs[PLAYER_OUT_BUF_NUM];
+
     /* LVGL objects */
     lv_obj_t    *main;
     lv_obj_t    *canvas;
@@ -235,17 +321,23 @@ static lv_obj_t * create_lvgl_objects(lv_obj_t * screen)
     return cont_col;
 }
 
-static esp_err_t get_video_size(uint32_t * width, uint32_t * height)
+static esp_err_t get_video_size(media_src_t *src, uint32_t * width, uint32_t * height)
 {
     esp_err_t err;
     jpeg_decode_picture_info_t header;
     assert(width && height);
 
-    int size = media_src_storage_read(&player_ctx.file, player_ctx.cache_buff, player_ctx.cache_buff_size);
+    int size = media_src_storage_read(src, player_ctx.cache_buff, player_ctx.cache_buff_size);
     if(size < 0)
         return ESP_ERR_INVALID_SIZE;
 
-    err = jpeg_decoder_get_info(player_ctx.cache_buff, size, &header);
+    /* Containers such as AVI put their headers in front of the first frame. */
+    uint8_t *soi = memmem(player_ctx.cache_buff, size, &SOI, 2);
+    if (soi == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    err = jpeg_decoder_get_info(soi, size - (soi - player_ctx.cache_buff), &header);
 
     ESP_LOGI(TAG, "header parsed, width is %" PRId32 ", height is %" PRId32 ", size is %d", header.width, header.height, size);
 
@@ -257,32 +349,34 @@ static esp_err_t get_video_size(uint32_t * width, uint32_t * height)
 
 static esp_err_t video_decoder_init(void)
 {
-    jpeg_decode_engine_cfg_t engine_cfg = {
-        .intr_priority = 0,
-        .timeout_ms = -1,
-    };
-    return jpeg_new_decoder_engine(&engine_cfg, &player_ctx.jpeg);
+    /* The engine is shared with the other apps */
+    return jpeg_dec_service_acquire();
 }
 
 static void video_decoder_deinit(void)
 {
-    if (player_ctx.jpeg) {
-        jpeg_del_decoder_engine(player_ctx.jpeg);
-    }
+    jpeg_dec_service_release();
 }
 
 static uint8_t * video_decoder_malloc(uint32_t size, bool inbuff, uint32_t * outsize)
 {
-    jpeg_decode_memory_alloc_cfg_t tx_mem_cfg = {
-        .buffer_direction = JPEG_DEC_ALLOC_INPUT_BUFFER,
-    };
-    jpeg_decode_memory_alloc_cfg_t rx_mem_cfg = {
-        .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
-    };
-    return (uint8_t *)jpeg_alloc_decoder_mem(size, (inbuff ? &tx_mem_cfg : &rx_mem_cfg), (size_t*)outsize);
+    size_t actual_size = 0;
+    uint8_t *buf = jpeg_dec_service_buf_get(inbuff ? JPEG_DEC_ALLOC_INPUT_BUFFER : JPEG_DEC_ALLOC_OUTPUT_BUFFER, size,
+                                            &actual_size);
+
+    if (buf && outsize) {
+        *outsize = actual_size;
+    }
+
+    return buf;
+}
+
+static void video_decoder_free(uint8_t *buf)
+{
+    jpeg_dec_service_buf_put(buf);
 }
 
-static int video_decoder_read_jpeg_image(uint32_t *file_seek_start, uint32_t *file_seek_offset)
+static int video_decoder_read_jpeg_image(uint8_t *in_buff, uint32_t *file_seek_start, uint32_t *file_seek_offset)
 {
     uint32_t read_size = 0;
     uint32_t jpeg_image_size = 0;
@@ -300,33 +394,51 @@ static int video_decoder_read_jpeg_image(uint32_t *file_seek_start, uint32_t *fi
     // }
 
     while (match == NULL) {
-        read_size = media_src_storage_read(&player_ctx.file, cache_buff, cache_buff_size) - seek_pos_offset;
+        read_size = media_src_storage_read(&player_ctx.source.file, cache_buff, cache_buff_size) - seek_pos_offset;
         if (read_size <= 0) {
             break;
         }
 
         cache_buff_offset = cache_buff + seek_pos_offset;
 
+        /* Skip container data in front of the frame, e.g. AVI chunk headers. */
+        if (jpeg_image_size == 0) {
+            uint8_t *soi = memmem(cache_buff_offset, read_size, &SOI, 2);
+            /* Keep the last byte when nothing is found, the marker may straddle two reads. */
+            uint32_t skip = soi ? (uint32_t)(soi - cache_buff_offset) : ((read_size > 1) ? (read_size - 1) : read_size);
+            if (soi == NULL) {
+                seek_pos_next = ALIGN_DOWN(seek_pos_cur + seek_pos_offset + skip, CACHE_BUF_ALIGN);
+                seek_pos_cur = seek_pos_cur + seek_pos_offset + skip;
+                seek_pos_offset = seek_pos_cur - seek_pos_next;
+                media_src_storage_seek(&player_ctx.source.file, seek_pos_next);
+                seek_pos_cur = seek_pos_next;
+                continue;
+            }
+            seek_pos_offset += skip;
+            cache_buff_offset += skip;
+            read_size -= skip;
+        }
+
         /* Search for EOI. */
         match = memmem(cache_buff_offset, read_size, &EOI, 2);
         if(match) {
             read_size = (uint32_t)((match + 2) - cache_buff_offset);
         }
 
-        memcpy(player_ctx.in_buff + jpeg_image_size, cache_buff_offset, read_size);
+        if (jpeg_image_size + read_size > player_ctx.in_buff_size) {
+            ESP_LOGE(TAG, "JPEG image size is bigger than input buffer size");
+            return -1;
+        }
+        memcpy(in_buff + jpeg_image_size, cache_buff_offset, read_size);
         jpeg_image_size += read_size;
 
         seek_pos_next = ALIGN_DOWN(seek_pos_cur + seek_pos_offset + read_size, CACHE_BUF_ALIGN);
         seek_pos_cur = seek_pos_cur + seek_pos_offset + read_size;
         seek_pos_offset = seek_pos_cur - seek_pos_next;
-        media_src_storage_seek(&player_ctx.file, seek_pos_next);
+        media_src_storage_seek(&player_ctx.source.file, seek_pos_next);
         seek_pos_cur = seek_pos_next;
 
     }
-    if (jpeg_image_size > player_ctx.in_buff_size) {
-        ESP_LOGE(TAG, "JPEG image size is bigger than input buffer size");
-        jpeg_image_size = -1;
-    }
     *file_seek_start = seek_pos_next;
     *file_seek_offset = seek_pos_offset;
 
@@ -338,7 +450,24 @@ static int video_decoder_read_jpeg_image(uint32_t *file_seek_start, uint32_t *fi
     return jpeg_image_size;
 }
 
-static int video_decoder_decode(uint32_t jpeg_image_size)
+static int video_decoder_read_indexed_frame(uint8_t *in_buff, uint32_t frame)
+{
+    const media_frame_entry_t *entry = &player_ctx.source.index.entries[frame];
+
+    if (entry->size > player_ctx.in_buff_size) {
+        ESP_LOGE(TAG, "JPEG image size is bigger than input buffer size");
+        return -1;
+    }
+    if ((media_src_storage_seek(&player_ctx.source.file, entry->offset) != 0) ||
+            (media_src_storage_read(&player_ctx.source.file, in_buff, entry->size) != entry->size)) {
+        ESP_LOGE(TAG, "Read frame %" PRIu32 " failed", frame);
+        return -1;
+    }
+
+    return entry->size;
+}
+
+static int video_decoder_decode(uint8_t *in_buff, uint32_t jpeg_image_size, uint8_t *out_buff)
 {
     esp_err_t err;
     uint32_t ret_size = 0;
@@ -351,8 +480,14 @@ static int video_decoder_decode(uint32_t jpeg_image_size)
 
     /* Decode JPEG */
     ret_size = player_ctx.out_buff_size;
-    err = jpeg_decoder_process(player_ctx.jpeg, &jpeg_decode_cfg, player_ctx.in_buff, jpeg_image_size_aligned,
-                               player_ctx.out_buff, player_ctx.out_buff_size, &ret_size);
+    jpeg_dec_service_job_t job = {
+        .in = in_buff,
+        .in_size = jpeg_image_size_aligned,
+        .out = out_buff,
+        .out_size = player_ctx.out_buff_size,
+        .cfg = jpeg_decode_cfg,
+    };
+    err = jpeg_dec_service_decode(&job, &ret_size);
     if(err != ESP_OK) {
         ESP_LOGE(TAG, "JPEG decode failed");
         return -1;
@@ -366,73 +501,739 @@ static int video_decoder_decode(uint32_t jpeg_image_size)
     return jpeg_image_size;
 }
 
-static void show_video_task(void *arg)
+/* Frame of the file being read that should be on screen now */
+static uint32_t video_clock_due_frame(void)
 {
-    esp_err_t ret = ESP_OK;
-    int processed = 0;
-    int all_size = 0;
-    int file_seek_pos = 0;
-    int file_seek_offset = 0;
-    int jpeg_image_size = 0;
+    int64_t elapsed_us = esp_timer_get_time() - player_ctx.clock_start_us;
+
+    return (elapsed_us > 0) ? (uint32_t)(elapsed_us / player_ctx.source.frame_us) : 0;
+}
+
+static void audio_track_close(void)
+{
+    if (player_ctx.audio_running) {
+        media_audio_stream_stop();
+        player_ctx.audio_running = false;
+    }
+}
 
-    /* Open video file */
-    ESP_LOGI(TAG, "Opening video file %s ...", player_ctx.video_path);
-    ESP_GOTO_ON_FALSE(media_src_storage_open(&player_ctx.file) == 0, ESP_ERR_NO_MEM, err, TAG, "Storage open failed");
-    ESP_GOTO_ON_FALSE(media_src_storage_connect(&player_ctx.file, player_ctx.video_path) == 0, ESP_ERR_NO_MEM, err, TAG, "Storage connect failed");
+/* Takes over the audio track of the file that just became the source, a BGM has precedence */
+static void audio_track_open(void)
+{
+    const media_frame_index_t *index = &player_ctx.source.index;
 
+    player_ctx.audio_entry = 0;
+    player_ctx.audio_entry_fed = 0;
     if (player_ctx.bgm_path != NULL) {
-        ESP_LOGI(TAG, "Opening bgm file %s ...", player_ctx.bgm_path);
+        return;
+    }
+    if (index->audio_num == 0) {
+        audio_track_close();
+        return;
+    }
+    /* Loops and files of the same format go on in the same stream, the buffered tail plays out first */
+    if (player_ctx.audio_running && media_audio_stream_is_format(&index->audio)) {
+        player_ctx.audio_pass_start = media_audio_stream_get_written();
+        return;
     }
 
-    /* Get file size */
-    ESP_GOTO_ON_FALSE(media_src_storage_get_size(&player_ctx.file, &player_ctx.filesize) == 0, ESP_ERR_NO_MEM, err, TAG, "Get file size failed");
+    audio_track_close();
+    if (media_audio_stream_start(&index->audio, PLAYER_AUDIO_BUFFER_MS) != ESP_OK) {
+        ESP_LOGW(TAG, "Play audio track failed, the video plays without sound");
+        return;
+    }
+    player_ctx.audio_running = true;
+    player_ctx.audio_pass_start = 0;
+}
 
-    /* Create input buffer */
-    player_ctx.in_buff = video_decoder_malloc(player_ctx.in_buff_size, true, &player_ctx.in_buff_size);
-    ESP_GOTO_ON_FALSE(player_ctx.in_buff, ESP_ERR_NO_MEM, err, TAG, "Allocation in_buff failed");
+/* Tops the jitter buffer up, the chunks are read through the split buffer which indexed files don't use */
+static void audio_track_feed(void)
+{
+    const media_frame_index_t *index = &player_ctx.source.index;
+    uint32_t free_size = player_ctx.audio_running ? media_audio_stream_get_free() : 0;
+
+    while ((free_size > 0) && (player_ctx.audio_entry < index->audio_num)) {
+        const media_audio_entry_t *entry = &index->audio_entries[player_ctx.audio_entry];
+        uint32_t len = MIN(MIN(entry->size - player_ctx.audio_entry_fed, free_size), player_ctx.cache_buff_size);
+
+        if ((media_src_storage_seek(&player_ctx.source.file, entry->offset + player_ctx.audio_entry_fed) != 0) ||
+                (media_src_storage_read(&player_ctx.source.file, player_ctx.cache_buff, len) != len)) {
+            ESP_LOGE(TAG, "Read audio chunk %" PRIu32 " failed. Skip chunk.", player_ctx.audio_entry);
+            player_ctx.audio_entry++;
+            player_ctx.audio_entry_fed = 0;
+            continue;
+        }
+        media_audio_stream_write(player_ctx.cache_buff, len);
+        free_size -= len;
+        player_ctx.audio_entry_fed += len;
+        if (player_ctx.audio_entry_fed == entry->size) {
+            player_ctx.audio_entry++;
+            player_ctx.audio_entry_fed = 0;
+        }
+    }
+}
 
-    /* Init video decoder */
-    ESP_GOTO_ON_ERROR(video_decoder_init(), err, TAG, "Initialize video decoder failed");
+/* Restarts the track at the head of the chunk playing at `time_us`, PCM chunks hold whole samples and MP3 resyncs */
+static void audio_track_seek(int64_t time_us)
+{
+    const media_frame_index_t *index = &player_ctx.source.index;
+    uint64_t duration_us = (uint64_t)index->frame_num * player_ctx.source.frame_us;
+    uint64_t pos = 0;
 
-    /* Get video output size */
-    uint32_t height = 0;
+    if (!player_ctx.audio_running || (index->audio_num == 0)) {
+        return;
+    }
+    if (index->audio.bytes_per_sec) {
+        pos = (uint64_t)time_us * index->audio.bytes_per_sec / 1000000;
+    } else if (duration_us) {
+        pos = (uint64_t)time_us * index->audio_size / duration_us;
+    }
+    player_ctx.audio_entry = media_frame_index_find_audio(index, pos);
+    player_ctx.audio_entry_fed = 0;
+    media_audio_stream_reset(player_ctx.audio_pass_start + ((player_ctx.audio_entry < index->audio_num) ?
+                             index->audio_entries[player_ctx.audio_entry].start : index->audio_size));
+}
+
+/* The audio heard sets the presentation clock, without it the clock runs on from where the audio left it */
+static void audio_track_follow(void)
+{
+    uint32_t bytes_per_sec = player_ctx.source.index.audio.bytes_per_sec;
+    uint64_t pos = 0;
+
+    if (!player_ctx.audio_running || !player_ctx.source.frame_us || !media_audio_stream_get_position(&pos) ||
+            (pos < player_ctx.audio_pass_start)) {
+        return;
+    }
+    player_ctx.clock_start_us = esp_timer_get_time() -
+                                (int64_t)((pos - player_ctx.audio_pass_start) * 1000000 / bytes_per_sec);
+}
+
+/* Frames on their way to the display are presented ones while the PPA stage is in use */
+static uint8_t *video_frame_buff(uint8_t index)
+{
+    return player_ctx.ppa_srm ? player_ctx.present_buff[index] : player_ctx.out_buff[index];
+}
+
+static void video_frame_release(const player_frame_msg_t *msg)
+{
+    xQueueSend(player_ctx.ppa_srm ? player_ctx.present_free_queue : player_ctx.out_free_queue, msg, portMAX_DELAY);
+}
+
+static bool video_present_done_cb(ppa_client_handle_t client, ppa_event_data_t *event_data, void *user_data)
+{
+    player_present_job_t *job = (player_present_job_t *)user_data;
+    BaseType_t task_woken = pdFALSE;
+
+    /* The queues hold every buffer, so the sends never fail */
+    xQueueSendFromISR(player_ctx.out_free_queue, &job->decoded, &task_woken);
+    xQueueSendFromISR(player_ctx.display_queue, &job->present, &task_woken);
+    xSemaphoreGiveFromISR(player_ctx.present_done_sem, &task_woken);
+
+    return task_woken == pdTRUE;
+}
+
+/* Starts the PPA on a decoded frame, the decoder goes on with the next one meanwhile */
+static void video_present_submit(const player_frame_msg_t *decoded, uint32_t *pending)
+{
+    player_frame_msg_t present;
+
+    xQueueReceive(player_ctx.present_free_queue, &present, portMAX_DELAY);
+    while (xSemaphoreTake(player_ctx.present_done_sem, 0) == pdTRUE) {
+        (*pending)--;
+    }
+
+    player_present_job_t *job = &player_ctx.present_jobs[present.index];
+    job->decoded = *decoded;
+    job->present = present;
+    job->present.epoch = decoded->epoch;
+    job->present.due_us = decoded->due_us;
+    job->present.size = player_ctx.present_buff_size;
+
+    ppa_srm_oper_config_t oper = player_ctx.present_oper;
+    oper.in.buffer = player_ctx.out_buff[decoded->index];
+    oper.out.buffer = player_ctx.present_buff[present.index];
+    oper.out.buffer_size = player_ctx.present_buff_size;
+    oper.user_data = job;
+    if (ppa_do_scale_rotate_mirror(player_ctx.ppa_srm, &oper) != ESP_OK) {
+        ESP_LOGE(TAG, "PPA scale failed. Skip frame.");
+        xQueueSend(player_ctx.out_free_queue, decoded, portMAX_DELAY);
+        xQueueSend(player_ctx.present_free_queue, &present, portMAX_DELAY);
+        return;
+    }
+    (*pending)++;
+}
+
+static void video_decode_task(void *arg)
+{
+    player_frame_msg_t msg;
+    player_frame_msg_t out;
+    uint32_t pending = 0;
+
+    while (1) {
+        xQueueReceive(player_ctx.decode_queue, &msg, portMAX_DELAY);
+        if (msg.index == PLAYER_FRAME_EOS) {
+            /* Frames still with the PPA reach the display before the end marker */
+            for (; pending > 0; pending--) {
+                xSemaphoreTake(player_ctx.present_done_sem, portMAX_DELAY);
+            }
+            xQueueSend(player_ctx.display_queue, &msg, portMAX_DELAY);
+            break;
+        }
+
+        xQueueReceive(player_ctx.out_free_queue, &out, portMAX_DELAY);
+        out.epoch = msg.epoch;
+        out.due_us = msg.due_us;
+        int processed = video_decoder_decode(player_ctx.in_buff[msg.index], msg.size, player_ctx.out_buff[out.index]);
+        /* The reader may refill the input buffer while this frame waits for the display */
+        xQueueSend(player_ctx.in_free_queue, &msg, portMAX_DELAY);
+
+        if (processed < 0) {
+            ESP_LOGE(TAG, "Decode JPEG image failed. Skip frame.");
+            xQueueSend(player_ctx.out_free_queue, &out, portMAX_DELAY);
+            continue;
+        }
+        out.size = processed;
+        if (player_ctx.ppa_srm) {
+            video_present_submit(&out, &pending);
+            continue;
+        }
+        xQueueSend(player_ctx.display_queue, &out, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(player_ctx.stage_done_sem);
+    task_config_delete(TASK_CONFIG_VIDEO_DECODE, NULL);
+}
+
+static esp_err_t video_direct_init(void)
+{
+    player_ctx.disp = lv_disp_get_default();
+    ESP_RETURN_ON_FALSE(player_ctx.disp && player_ctx.disp->driver->flush_cb, ESP_ERR_INVALID_STATE, TAG, "No display");
+    player_ctx.output_width = lv_disp_get_hor_res(player_ctx.disp);
+    player_ctx.output_height = lv_disp_get_ver_res(player_ctx.disp);
+
+    return ESP_OK;
+}
+
+static void video_direct_deinit(void)
+{
+    player_ctx.disp = NULL;
+}
+
+static void video_present_deinit(void)
+{
+    if (player_ctx.ppa_srm) {
+        ppa_unregister_client(player_ctx.ppa_srm);
+        player_ctx.ppa_srm = NULL;
+    }
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        if (player_ctx.present_buff[i]) {
+            video_decoder_free(player_ctx.present_buff[i]);
+            player_ctx.present_buff[i] = NULL;
+        }
+    }
+    player_ctx.present_buff_size = 0;
+}
+
+/* Sets the PPA stage up when the frames don't match the output, the pipeline must be drained */
+static esp_err_t video_present_init(void)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t in_w = player_ctx.video_width;
+    uint32_t in_h = player_ctx.video_height;
+    uint32_t out_w = player_ctx.output_width;
+    uint32_t out_h = player_ctx.output_height;
+    bool rotate = player_ctx.auto_rotate && (in_w != in_h) && (out_w != out_h) && ((in_w > in_h) != (out_w > out_h));
+    player_fit_t fit = ((player_ctx.fit == PLAYER_FIT_NONE) && player_ctx.disp) ? PLAYER_FIT_LETTERBOX : player_ctx.fit;
+    ppa_client_config_t srm_config = {
+        .oper_type = PPA_OPERATION_SRM,
+        .max_pending_trans_num = PLAYER_OUT_BUF_NUM,
+    };
+    ppa_event_callbacks_t cbs = {
+        .on_trans_done = video_present_done_cb,
+    };
+
+    if ((fit == PLAYER_FIT_NONE) || (!rotate && (in_w == out_w) && (in_h == out_h))) {
+        return ESP_OK;
+    }
+
+    /* Sizes as the frame lands on the output */
+    uint32_t turned_w = rotate ? in_h : in_w;
+    uint32_t turned_h = rotate ? in_w : in_h;
+    float scale_x = (float)out_w / turned_w;
+    float scale_y = (float)out_h / turned_h;
+    float scale = 0;
+    if (fit == PLAYER_FIT_FILL) {
+        scale = ceilf(MAX(scale_x, scale_y) * PLAYER_SCALE_STEP) / PLAYER_SCALE_STEP;
+    } else {
+        scale = floorf(MIN(scale_x, scale_y) * PLAYER_SCALE_STEP) / PLAYER_SCALE_STEP;
+    }
+    ESP_RETURN_ON_FALSE(scale > 0, ESP_ERR_NOT_SUPPORTED, TAG, "Video too large to scale");
+
+    /* Part of the frame that fits the output once scaled, all of it unless filling, taken from the center */
+    uint32_t shown_w = MIN(turned_w, (uint32_t)(out_w / scale));
+    uint32_t shown_h = MIN(turned_h, (uint32_t)(out_h / scale));
+    uint32_t block_w = rotate ? shown_h : shown_w;
+    uint32_t block_h = rotate ? shown_w : shown_h;
+    uint32_t scaled_w = MIN((uint32_t)(shown_w * scale), out_w);
+    uint32_t scaled_h = MIN((uint32_t)(shown_h * scale), out_h);
+
+    player_ctx.present_oper = (ppa_srm_oper_config_t) {
+        .in = {
+            .pic_w = in_w,
+            .pic_h = in_h,
+            .block_w = block_w,
+            .block_h = block_h,
+            .block_offset_x = (in_w - block_w) / 2,
+            .block_offset_y = (in_h - block_h) / 2,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .out = {
+            .pic_w = out_w,
+            .pic_h = out_h,
+            .block_offset_x = (out_w - scaled_w) / 2,
+            .block_offset_y = (out_h - scaled_h) / 2,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .rotation_angle = rotate ? PPA_SRM_ROTATION_ANGLE_90 : PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = scale,
+        .scale_y = scale,
+        .mode = PPA_TRANS_MODE_NON_BLOCKING,
+    };
+
+    ESP_RETURN_ON_ERROR(ppa_register_client(&srm_config, &player_ctx.ppa_srm), TAG, "Register PPA client failed");
+    ESP_GOTO_ON_ERROR(ppa_client_register_event_callbacks(player_ctx.ppa_srm, &cbs), err, TAG,
+                      "Register PPA callback failed");
+    /* The bars are never written by the PPA, they stay black */
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        player_ctx.present_buff_size = out_w * out_h * 2;
+        player_ctx.present_buff[i] = video_decoder_malloc(player_ctx.present_buff_size, false,
+                                                          &player_ctx.present_buff_size);
+        ESP_GOTO_ON_FALSE(player_ctx.present_buff[i], ESP_ERR_NO_MEM, err, TAG, "Allocation present_buff failed");
+        memset(player_ctx.present_buff[i], 0, player_ctx.present_buff_size);
+    }
+    ESP_LOGI(TAG, "Presenting %" PRIu32 "x%" PRIu32 " frames on %" PRIu32 "x%" PRIu32 ", scaled by %.3f%s", in_w, in_h,
+             out_w, out_h, scale, rotate ? " and rotated" : "");
+
+    return ESP_OK;
+
+err:
+    video_present_deinit();
+    return ret;
+}
+
+/* Must be called with the LVGL lock held, so LVGL can't flush at the same time */
+static void video_direct_present(uint8_t *frame)
+{
+    lv_disp_drv_t *drv = player_ctx.disp->driver;
+    lv_area_t area = {
+        .x1 = 0,
+        .y1 = 0,
+        .x2 = player_ctx.output_width - 1,
+        .y2 = player_ctx.output_height - 1,
+    };
+
+    /* The panel driver copies the whole frame into its framebuffer and reports back with lv_disp_flush_ready() */
+    drv->draw_buf->flushing = 1;
+    drv->draw_buf->flushing_last = 1;
+    drv->flush_cb(drv, &area, (lv_color_t *)frame);
+    while (drv->draw_buf->flushing) {
+        vTaskDelay(1);
+    }
+}
+
+static void video_display_task(void *arg)
+{
+    player_frame_msg_t msg;
+    player_frame_msg_t shown = {
+        .index = PLAYER_FRAME_EOS,
+    };
+    uint32_t width = player_ctx.ppa_srm ? player_ctx.output_width : player_ctx.video_width;
+    uint32_t height = player_ctx.ppa_srm ? player_ctx.output_height : player_ctx.video_height;
+
+    while (1) {
+        xQueueReceive(player_ctx.display_queue, &msg, portMAX_DELAY);
+        if (msg.index == PLAYER_FRAME_EOS) {
+            break;
+        }
+
+        /* Hold the frame until it is due, unless the clock jumped since it was read */
+        if (msg.due_us) {
+            int64_t wait_us = msg.due_us - esp_timer_get_time();
+            if ((msg.epoch == __atomic_load_n(&player_ctx.clock_epoch, __ATOMIC_RELAXED)) && (wait_us >= 1000)) {
+                vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+            }
+        }
+
+        /* LVGL only reads the canvas buffer while it holds the lock, so the previous buffer is free once swapped */
+        if (!bsp_display_lock(0)) {
+            video_frame_release(&msg);
+            continue;
+        }
+        if (player_ctx.disp) {
+            /* The panel keeps its own copy, the buffer is free as soon as the flush is done */
+            video_direct_present(video_frame_buff(msg.index));
+            bsp_display_unlock();
+            video_frame_release(&msg);
+            continue;
+        }
+        if (player_ctx.canvas) {
+            lv_canvas_set_buffer(player_ctx.canvas, video_frame_buff(msg.index), width, height, LV_IMG_CF_TRUE_COLOR);
+            lv_obj_invalidate(player_ctx.canvas);
+        }
+        bsp_display_unlock();
+
+        if (shown.index != PLAYER_FRAME_EOS) {
+            video_frame_release(&shown);
+        }
+        shown = msg;
+    }
+
+    xSemaphoreGive(player_ctx.stage_done_sem);
+    task_config_delete(TASK_CONFIG_VIDEO_DISPLAY, NULL);
+}
+
+static esp_err_t video_pipeline_create(void)
+{
+    player_frame_msg_t msg = {0};
+
+    player_ctx.in_free_queue = xQueueCreate(PLAYER_IN_BUF_NUM, sizeof(player_frame_msg_t));
+    player_ctx.decode_queue = xQueueCreate(PLAYER_IN_BUF_NUM + 1, sizeof(player_frame_msg_t));
+    player_ctx.out_free_queue = xQueueCreate(PLAYER_OUT_BUF_NUM, sizeof(player_frame_msg_t));
+    player_ctx.display_queue = xQueueCreate(PLAYER_OUT_BUF_NUM + 1, sizeof(player_frame_msg_t));
+    player_ctx.stage_done_sem = xSemaphoreCreateCounting(PLAYER_STAGE_NUM, 0);
+    ESP_RETURN_ON_FALSE(player_ctx.in_free_queue && player_ctx.decode_queue && player_ctx.out_free_queue &&
+                        player_ctx.display_queue && player_ctx.stage_done_sem, ESP_ERR_NO_MEM, TAG, "Create queues failed");
+    if (player_ctx.ppa_srm) {
+        player_ctx.present_free_queue = xQueueCreate(PLAYER_OUT_BUF_NUM, sizeof(player_frame_msg_t));
+        player_ctx.present_done_sem = xSemaphoreCreateCounting(PLAYER_OUT_BUF_NUM, 0);
+        ESP_RETURN_ON_FALSE(player_ctx.present_free_queue && player_ctx.present_done_sem, ESP_ERR_NO_MEM, TAG,
+                            "Create present queue failed");
+    }
+
+    for (msg.index = 0; msg.index < PLAYER_IN_BUF_NUM; msg.index++) {
+        xQueueSend(player_ctx.in_free_queue, &msg, 0);
+    }
+    for (msg.index = 0; msg.index < PLAYER_OUT_BUF_NUM; msg.index++) {
+        xQueueSend(player_ctx.out_free_queue, &msg, 0);
+        if (player_ctx.present_free_queue) {
+            xQueueSend(player_ctx.present_free_queue, &msg, 0);
+        }
+    }
+
+    ESP_RETURN_ON_FALSE(task_config_create(TASK_CONFIG_VIDEO_DECODE, video_decode_task, NULL, NULL) == pdPASS, ESP_ERR_NO_MEM, TAG, "Create decode task failed");
+    if (task_config_create(TASK_CONFIG_VIDEO_DISPLAY, video_display_task, NULL, NULL) != pdPASS) {
+        /* Let the decode stage exit on its own */
+        msg.index = PLAYER_FRAME_EOS;
+        xQueueSend(player_ctx.decode_queue, &msg, portMAX_DELAY);
+        xQueueReceive(player_ctx.display_queue, &msg, portMAX_DELAY);
+        xSemaphoreTake(player_ctx.stage_done_sem, portMAX_DELAY);
+        ESP_LOGE(TAG, "Create display task failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+static void video_pipeline_destroy(bool running)
+{
+    player_frame_msg_t msg = {
+        .index = PLAYER_FRAME_EOS,
+    };
+
+    /* The end marker flows behind the queued frames, so both stages drain before exiting */
+    if (running) {
+        xQueueSend(player_ctx.decode_queue, &msg, portMAX_DELAY);
+        for (int i = 0; i < PLAYER_STAGE_NUM; i++) {
+            xSemaphoreTake(player_ctx.stage_done_sem, portMAX_DELAY);
+        }
+    }
+
+    if (player_ctx.in_free_queue) {
+        vQueueDelete(player_ctx.in_free_queue);
+        player_ctx.in_free_queue = NULL;
+    }
+    if (player_ctx.decode_queue) {
+        vQueueDelete(player_ctx.decode_queue);
+        player_ctx.decode_queue = NULL;
+    }
+    if (player_ctx.out_free_queue) {
+        vQueueDelete(player_ctx.out_free_queue);
+        player_ctx.out_free_queue = NULL;
+    }
+    if (player_ctx.display_queue) {
+        vQueueDelete(player_ctx.display_queue);
+        player_ctx.display_queue = NULL;
+    }
+    if (player_ctx.stage_done_sem) {
+        vSemaphoreDelete(player_ctx.stage_done_sem);
+        player_ctx.stage_done_sem = NULL;
+    }
+    if (player_ctx.present_free_queue) {
+        vQueueDelete(player_ctx.present_free_queue);
+        player_ctx.present_free_queue = NULL;
+    }
+    if (player_ctx.present_done_sem) {
+        vSemaphoreDelete(player_ctx.present_done_sem);
+        player_ctx.present_done_sem = NULL;
+    }
+}
+
+static void video_source_close(player_source_t *source)
+{
+    if (source->opened) {
+        media_src_storage_disconnect(&source->file);
+        media_src_storage_close(&source->file);
+    }
+    media_frame_index_free(&source->index);
+    memset(source, 0, sizeof(player_source_t));
+}
+
+static esp_err_t video_source_open(player_source_t *source, const char *path)
+{
+    esp_err_t ret = ESP_OK;
     uint32_t width = 0;
-    ESP_GOTO_ON_ERROR(get_video_size(&width, &height), err, TAG, "Get video file size failed");
-    width = ALIGN_UP(width, 16);
+    uint32_t height = 0;
+
+    memset(source, 0, sizeof(player_source_t));
+    source->path = path;
+
+    ESP_LOGI(TAG, "Opening video file %s ...", path);
+    ESP_RETURN_ON_FALSE(media_src_storage_open(&source->file) == 0, ESP_ERR_NO_MEM, TAG, "Storage open failed");
+    source->opened = true;
+    ESP_GOTO_ON_FALSE(media_src_storage_connect(&source->file, path) == 0, ESP_ERR_NOT_FOUND, err, TAG, "Storage connect failed");
+
+    /* Without an index the frames are found by scanning for markers on every read */
+    if (media_frame_index_load(&source->index, &source->file, path, player_ctx.cache_buff,
+                               player_ctx.cache_buff_size) != ESP_OK) {
+        ESP_LOGW(TAG, "No frame index, seeking is disabled");
+    }
+    source->frame_us = source->index.us_per_frame ? source->index.us_per_frame :
+                       (player_ctx.fps ? (1000000 / player_ctx.fps) : 0);
+    ESP_LOGI(TAG, "Frame duration %" PRIu32 " us%s", source->frame_us, source->frame_us ? "" : ", not paced");
+
+    media_src_storage_seek(&source->file, 0);
+    ESP_GOTO_ON_ERROR(get_video_size(&source->file, &width, &height), err, TAG, "Get video file size failed");
+    source->width = ALIGN_UP(width, 16);
+    source->height = height;
+    media_src_storage_seek(&source->file, 0);
+
+    return ESP_OK;
+
+err:
+    video_source_close(source);
+    return ret;
+}
 
-    /* Create output buffer */
-    player_ctx.out_buff_size = width * height * 3;
-    player_ctx.out_buff = video_decoder_malloc(player_ctx.out_buff_size, false, &player_ctx.out_buff_size);
-    ESP_GOTO_ON_FALSE(player_ctx.out_buff, ESP_ERR_NO_MEM, err, TAG, "Allocation out_buff failed");
+static const char *video_playlist_path(uint32_t pos)
+{
+    return player_ctx.playlist_num ? player_ctx.playlist[pos] : player_ctx.video_path;
+}
+
+/* Opens the file after the one being read, a single file that loops is rewound instead */
+static void video_prepare_next(void)
+{
+    uint32_t num = player_ctx.playlist_num ? player_ctx.playlist_num : 1;
+    uint32_t pos = player_ctx.playlist_pos + 1;
+
+    if (player_ctx.next.path) {
+        return;
+    }
+    if (pos >= num) {
+        if (!player_ctx.loop) {
+            return;
+        }
+        pos = 0;
+    }
+    if (video_playlist_path(pos) == player_ctx.source.path) {
+        player_ctx.next.path = player_ctx.source.path;
+        return;
+    }
+    if (video_source_open(&player_ctx.next, video_playlist_path(pos)) != ESP_OK) {
+        ESP_LOGE(TAG, "Open next video %s failed", video_playlist_path(pos));
+    }
+}
+
+/* Output buffers only grow, files of the same size reuse them */
+static esp_err_t video_output_alloc(uint32_t width, uint32_t height)
+{
+    uint32_t out_buff_size = width * ALIGN_UP(height, 16) * 2;
+
+    player_ctx.video_width = width;
+    player_ctx.video_height = height;
+    if (player_ctx.out_buff[0] && (out_buff_size <= player_ctx.out_buff_size)) {
+        return ESP_OK;
+    }
+
+    /* The canvas may still point at the old buffers */
+    bsp_display_lock(0);
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        if (player_ctx.out_buff[i]) {
+            video_decoder_free(player_ctx.out_buff[i]);
+            player_ctx.out_buff[i] = NULL;
+        }
+    }
+    /* The smaller buffers are of no use to the pool anymore */
+    jpeg_dec_service_buf_trim();
+    /* The decoder writes whole MCU rows of RGB565 */
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        player_ctx.out_buff_size = out_buff_size;
+        player_ctx.out_buff[i] = video_decoder_malloc(out_buff_size, false, &player_ctx.out_buff_size);
+        if (player_ctx.out_buff[i] == NULL) {
+            break;
+        }
+        memset(player_ctx.out_buff[i], 0, player_ctx.out_buff_size);
+    }
+    if (player_ctx.canvas && player_ctx.out_buff[0]) {
+        lv_canvas_set_buffer(player_ctx.canvas, player_ctx.out_buff[0], width, height, LV_IMG_CF_TRUE_COLOR);
+    }
+    bsp_display_unlock();
+    ESP_RETURN_ON_FALSE(player_ctx.out_buff[PLAYER_OUT_BUF_NUM - 1], ESP_ERR_NO_MEM, TAG, "Allocation out_buff failed");
+
+    return ESP_OK;
+}
+
+/* Points the output at the buffers of the current video size, the pipeline must be drained */
+static esp_err_t video_output_setup(void)
+{
+    esp_err_t ret = ESP_OK;
+
+    /* The canvas may still point at the old presented frames */
+    bsp_display_lock(0);
+    video_present_deinit();
+    bsp_display_unlock();
+    video_direct_deinit();
+    if (player_ctx.direct_output && (video_direct_init() != ESP_OK)) {
+        ESP_LOGW(TAG, "Direct output unavailable, falling back to the canvas");
+        video_direct_deinit();
+    }
+    if (player_ctx.disp == NULL) {
+        player_ctx.output_width = player_ctx.screen_width;
+        player_ctx.output_height = player_ctx.screen_height;
+    }
+    /* The panel needs frames of its size, without the PPA only the canvas can show others */
+    if ((video_present_init() != ESP_OK) && player_ctx.disp &&
+            ((player_ctx.video_width != player_ctx.output_width) || (player_ctx.video_height != player_ctx.output_height))) {
+        ESP_LOGW(TAG, "Scaling unavailable, falling back to the canvas");
+        video_direct_deinit();
+        player_ctx.output_width = player_ctx.screen_width;
+        player_ctx.output_height = player_ctx.screen_height;
+        if (video_present_init() != ESP_OK) {
+            ESP_LOGW(TAG, "Frames are shown at their own size");
+        }
+    }
 
     bsp_display_lock(0);
 	/* Set buffer to LVGL canvas */
-    if (player_ctx.canvas && player_ctx.out_buff) {
-        lv_canvas_set_buffer(player_ctx.canvas, player_ctx.out_buff, width, height, LV_IMG_CF_TRUE_COLOR);
+    if (player_ctx.canvas && player_ctx.disp) {
+        /* LVGL must not redraw the canvas on top of the frames flushed to the panel */
+        lv_obj_add_flag(player_ctx.canvas, LV_OBJ_FLAG_HIDDEN);
+    } else if (player_ctx.canvas && player_ctx.ppa_srm) {
+        lv_canvas_set_buffer(player_ctx.canvas, player_ctx.present_buff[0], player_ctx.output_width,
+                             player_ctx.output_height, LV_IMG_CF_TRUE_COLOR);
+        lv_obj_invalidate(player_ctx.canvas);
+    } else if (player_ctx.canvas) {
+        lv_canvas_set_buffer(player_ctx.canvas, player_ctx.out_buff[0], player_ctx.video_width, player_ctx.video_height,
+                             LV_IMG_CF_TRUE_COLOR);
         lv_obj_invalidate(player_ctx.canvas);
     } else {
         ESP_LOGE(TAG, "Canvas or output buffer is NULL");
-        bsp_display_unlock();
-        goto err;
+        ret = ESP_ERR_INVALID_STATE;
     }
+    bsp_display_unlock();
 
-    // if (player_ctx.auto_width || player_ctx.auto_height) {
-    //     uint32_t h = (player_ctx.auto_height ? (height+120) : lv_obj_get_height(player_ctx.main));
-    //     uint32_t w = (player_ctx.auto_width ? width : lv_obj_get_width(player_ctx.main));
-    //     lv_obj_set_size(player_ctx.main, w, h-80);
-    // }
+    return ret;
+}
 
-    // lv_obj_clear_state(player_ctx.slider, LV_STATE_DISABLED);
-    // /* Enable/disable buttons */
-    // lv_obj_add_state(player_ctx.btn_play, LV_STATE_DISABLED);
-    // lv_obj_clear_state(player_ctx.btn_stop, LV_STATE_DISABLED);
-    // lv_obj_clear_state(player_ctx.btn_pause, LV_STATE_DISABLED);
-    // lv_obj_clear_state(player_ctx.btn_repeat, LV_STATE_DISABLED);
-    // /* Hide Stop button */
-    // lv_obj_add_flag(player_ctx.img_stop, LV_OBJ_FLAG_HIDDEN);
-    // /* Set slider range */
-    // lv_slider_set_range(player_ctx.slider, 0, 1000);
-    bsp_display_unlock();
+/* Moves the reader to the next file, returns false when the playlist is over */
+static bool video_switch_source(bool *pipeline_running)
+{
+    player_source_t *next = &player_ctx.next;
+    uint32_t num = player_ctx.playlist_num ? player_ctx.playlist_num : 1;
+    /* The next file starts right after the last frame of this one */
+    int64_t clock_start_us = player_ctx.source.frame_us ?
+                             player_ctx.clock_start_us + (int64_t)player_ctx.frame_pos * player_ctx.source.frame_us :
+                             esp_timer_get_time();
+
+    video_prepare_next();
+    if (next->path == NULL) {
+        return false;
+    }
+    player_ctx.playlist_pos = (player_ctx.playlist_pos + 1 < num) ? (player_ctx.playlist_pos + 1) : 0;
+    player_ctx.frame_pos = 0;
+    player_ctx.clock_start_us = clock_start_us;
+
+    if (next->path == player_ctx.source.path) {
+        ESP_LOGI(TAG, "Playing loop enabled. Play again...");
+        memset(next, 0, sizeof(player_source_t));
+        media_src_storage_seek(&player_ctx.source.file, 0);
+        audio_track_open();
+        return true;
+    }
+
+    /* A different size needs other buffers, only then the pipeline is drained */
+    bool resize = (next->width != player_ctx.source.width) || (next->height != player_ctx.source.height);
+    if (resize) {
+        video_pipeline_destroy(*pipeline_running);
+        *pipeline_running = false;
+    }
+
+    video_source_close(&player_ctx.source);
+    player_ctx.source = *next;
+    memset(next, 0, sizeof(player_source_t));
+    ESP_LOGI(TAG, "Playing %s", player_ctx.source.path);
+
+    if (resize) {
+        ESP_RETURN_ON_FALSE((video_output_alloc(player_ctx.source.width, player_ctx.source.height) == ESP_OK) &&
+                            (video_output_setup() == ESP_OK) && (video_pipeline_create() == ESP_OK), false, TAG,
+                            "Resize output failed");
+        *pipeline_running = true;
+        player_ctx.clock_start_us = esp_timer_get_time();
+    }
+    audio_track_open();
+    video_prepare_next();
+
+    return true;
+}
+
+static void show_video_task(void *arg)
+{
+    esp_err_t ret = ESP_OK;
+    bool pipeline_running = false;
+    bool decoder_ready = false;
+    int all_size = 0;
+    int file_seek_pos = 0;
+    int file_seek_offset = 0;
+    int jpeg_image_size = 0;
+    uint32_t in_buff_size = player_ctx.in_buff_size;
+    int64_t paused_at_us = 0;
+    player_frame_msg_t msg;
+
+    player_ctx.playlist_pos = 0;
+    player_ctx.frame_pos = 0;
+    player_ctx.seek_frame = PLAYER_NO_SEEK;
+    player_ctx.frames_late = 0;
+    ESP_GOTO_ON_ERROR(video_source_open(&player_ctx.source, video_playlist_path(0)), err, TAG, "Open video failed");
+
+    if (player_ctx.bgm_path != NULL) {
+        ESP_LOGI(TAG, "Opening bgm file %s ...", player_ctx.bgm_path);
+    }
+
+    /* Create input buffers, every one gets the size requested for a single frame */
+    for (int i = 0; i < PLAYER_IN_BUF_NUM; i++) {
+        player_ctx.in_buff[i] = video_decoder_malloc(in_buff_size, true, &player_ctx.in_buff_size);
+        ESP_GOTO_ON_FALSE(player_ctx.in_buff[i], ESP_ERR_NO_MEM, err, TAG, "Allocation in_buff failed");
+    }
+
+    /* Init video decoder, the engine and the buffers are kept for the whole playlist */
+    ESP_GOTO_ON_ERROR(video_decoder_init(), err, TAG, "Initialize video decoder failed");
+    decoder_ready = true;
+    ESP_GOTO_ON_ERROR(video_output_alloc(player_ctx.source.width, player_ctx.source.height), err, TAG,
+                      "Allocation output buffers failed");
+    ESP_GOTO_ON_ERROR(video_output_setup(), err, TAG, "Setup output failed");
+
+    /* Reading, decoding and displaying overlap, each stage owns the buffers it got from the previous one */
+    ESP_GOTO_ON_ERROR(video_pipeline_create(), err, TAG, "Create video pipeline failed");
+    pipeline_running = true;
 
     player_ctx.state = PLAYER_STATE_PLAYING;
 
@@ -441,62 +1242,103 @@ static void show_video_task(void *arg)
     if ((player_ctx.bgm_path != NULL) && bsp_extra_player_play_file(player_ctx.bgm_path) != ESP_OK) {
         ESP_LOGE(TAG, "Play bgm failed");
     }
-    media_src_storage_seek(&player_ctx.file, 0);
+    audio_track_open();
+    /* The BGM starts together with the clock, the audio player exposes no position to follow */
+    player_ctx.clock_start_us = esp_timer_get_time();
+    /* The head of the following file is ready before this one ends */
+    video_prepare_next();
 
     while (player_ctx.state != PLAYER_STATE_STOPPED) {
         if (player_ctx.state == PLAYER_STATE_PAUSED) {
-            // if (bsp_display_lock(10)) {
-            //     lv_obj_clear_flag(player_ctx.img_pause, LV_OBJ_FLAG_HIDDEN);
-            //     bsp_display_unlock();
-            // }
-            vTaskDelay(pdMS_TO_TICKS(500));
+            if (paused_at_us == 0) {
+                paused_at_us = esp_timer_get_time();
+            }
+            vTaskDelay(pdMS_TO_TICKS(PLAYER_READ_WAIT_MS));
             continue;
         }
+        if (paused_at_us) {
+            /* Paused time doesn't count, frames continue from where they stopped */
+            player_ctx.clock_start_us += esp_timer_get_time() - paused_at_us;
+            paused_at_us = 0;
+        }
+
+        /* Also while the decoder is behind, the audio must not run dry */
+        audio_track_feed();
 
-        jpeg_image_size = video_decoder_read_jpeg_image(&file_seek_pos, &file_seek_offset);
+        /* Bounded wait so a stop is noticed while the decoder is behind */
+        if (xQueueReceive(player_ctx.in_free_queue, &msg, pdMS_TO_TICKS(PLAYER_READ_WAIT_MS)) != pdTRUE) {
+            continue;
+        }
+
+        if (player_ctx.source.index.frame_num > 0) {
+            int32_t seek_frame = __atomic_exchange_n(&player_ctx.seek_frame, PLAYER_NO_SEEK, __ATOMIC_RELAXED);
+            if (seek_frame != PLAYER_NO_SEEK) {
+                player_ctx.frame_pos = seek_frame;
+                player_ctx.clock_start_us = esp_timer_get_time() - (int64_t)seek_frame * player_ctx.source.frame_us;
+                __atomic_add_fetch(&player_ctx.clock_epoch, 1, __ATOMIC_RELAXED);
+                audio_track_seek((int64_t)seek_frame * player_ctx.source.frame_us);
+            }
+            audio_track_follow();
+            /* Skip late frames before reading them */
+            if (player_ctx.source.frame_us) {
+                uint32_t due_frame = video_clock_due_frame();
+                if (due_frame > player_ctx.frame_pos) {
+                    due_frame = MIN(due_frame, player_ctx.source.index.frame_num);
+                    player_ctx.frames_late += due_frame - player_ctx.frame_pos;
+                    player_ctx.frame_pos = due_frame;
+                }
+            }
+            jpeg_image_size = (player_ctx.frame_pos < player_ctx.source.index.frame_num) ?
+                              video_decoder_read_indexed_frame(player_ctx.in_buff[msg.index], player_ctx.frame_pos) : 0;
+        } else {
+            jpeg_image_size = video_decoder_read_jpeg_image(player_ctx.in_buff[msg.index], &file_seek_pos, &file_seek_offset);
+        }
         if (jpeg_image_size < 0) {
             ESP_LOGE(TAG, "Read JPEG image failed. Skip frame.");
+            xQueueSend(player_ctx.in_free_queue, &msg, portMAX_DELAY);
             break;
         } else if (jpeg_image_size == 0) {
+            xQueueSend(player_ctx.in_free_queue, &msg, portMAX_DELAY);
             ESP_LOGI(TAG, "Playing finished.");
-            if (player_ctx.loop) {
-                ESP_LOGI(TAG, "Playing loop enabled. Play again...");
-                media_src_storage_seek(&player_ctx.file, 0);
-                file_seek_pos = 0;
-                file_seek_offset = 0;
-                all_size = 0;
-                continue;
-            } else {
+            file_seek_pos = 0;
+            file_seek_offset = 0;
+            all_size = 0;
+            if (!video_switch_source(&pipeline_running)) {
                 esp_lvgl_simple_player_stop();
-                continue;
             }
+            continue;
         }
 
-        /* Decode one frame */
-        processed = video_decoder_decode(jpeg_image_size);
-        if (processed < 0) {
-            ESP_LOGE(TAG, "Decode JPEG image failed. Skip frame.");
-            break;
-        } else {
-            all_size += processed;
-        }
-
-        if (bsp_display_lock(10)) {
-            /* Refresh video canvas object */
-            if (player_ctx.canvas) {
-                lv_obj_invalidate(player_ctx.canvas);
-            }
-            /* Set slider */
-            // lv_slider_set_value(player_ctx.slider, ((float)all_size/(float)player_ctx.filesize)*1000, LV_ANIM_ON);
-            bsp_display_unlock();
+        /* Without an index a late frame is still read, but never decoded */
+        uint32_t frame = player_ctx.frame_pos++;
+        if (player_ctx.source.frame_us && (video_clock_due_frame() > frame)) {
+            player_ctx.frames_late++;
+            xQueueSend(player_ctx.in_free_queue, &msg, portMAX_DELAY);
+            continue;
         }
+        msg.epoch = __atomic_load_n(&player_ctx.clock_epoch, __ATOMIC_RELAXED);
+        msg.due_us = player_ctx.source.frame_us ?
+                     (player_ctx.clock_start_us + (int64_t)frame * player_ctx.source.frame_us) : 0;
+        msg.size = jpeg_image_size;
+        xQueueSend(player_ctx.decode_queue, &msg, portMAX_DELAY);
+        all_size += jpeg_image_size;
     }
 
 err:
+    video_pipeline_destroy(pipeline_running);
+    if (player_ctx.frames_late) {
+        ESP_LOGI(TAG, "Dropped %" PRIu32 " late frames before decoding", player_ctx.frames_late);
+    }
+
     bsp_display_lock(0);
     /* Show black on screen */
-    if (player_ctx.out_buff && player_ctx.out_buff_size > 0) {
-        memset(player_ctx.out_buff, 0, player_ctx.out_buff_size);
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        if (player_ctx.out_buff[i] && player_ctx.out_buff_size > 0) {
+            memset(player_ctx.out_buff[i], 0, player_ctx.out_buff_size);
+        }
+        if (player_ctx.present_buff[i]) {
+            memset(player_ctx.present_buff[i], 0, player_ctx.present_buff_size);
+        }
     }
     if (player_ctx.auto_height && player_ctx.main) {
         lv_obj_set_height(player_ctx.main, 320);
@@ -504,8 +1346,14 @@ err:
     if (player_ctx.canvas) {
         lv_obj_invalidate(player_ctx.canvas);
     }
-    /* Set slider */
-    // lv_slider_set_value(player_ctx.slider, 0, LV_ANIM_ON);
+    if (player_ctx.disp) {
+        /* Hand the whole screen back to LVGL */
+        video_direct_deinit();
+        if (player_ctx.canvas) {
+            lv_obj_clear_flag(player_ctx.canvas, LV_OBJ_FLAG_HIDDEN);
+        }
+        lv_obj_invalidate(lv_scr_act());
+    }
     bsp_display_unlock();
 
     if (player_ctx.bgm_path != NULL) {
@@ -514,28 +1362,40 @@ err:
             ESP_LOGE(TAG, "Stop bgm failed");
         }
     }
+    audio_track_close();
 
     /* Close storage */
-    media_src_storage_disconnect(&player_ctx.file);
-    media_src_storage_close(&player_ctx.file);
+    video_source_close(&player_ctx.source);
+    video_source_close(&player_ctx.next);
 
-    /* Deinit video decoder */
-    video_decoder_deinit();
-
-    if (player_ctx.in_buff) {
-        heap_caps_free(player_ctx.in_buff);
-        player_ctx.in_buff = NULL;
+    for (int i = 0; i < PLAYER_IN_BUF_NUM; i++) {
+        if (player_ctx.in_buff[i]) {
+            video_decoder_free(player_ctx.in_buff[i]);
+            player_ctx.in_buff[i] = NULL;
+        }
+    }
+    player_ctx.in_buff_size = in_buff_size;
+    /* The canvas still points at a decoded frame, it must not be drawn once the buffers are gone */
+    bsp_display_lock(0);
+    for (int i = 0; i < PLAYER_OUT_BUF_NUM; i++) {
+        if (player_ctx.out_buff[i]) {
+            video_decoder_free(player_ctx.out_buff[i]);
+            player_ctx.out_buff[i] = NULL;
+        }
     }
-    if (player_ctx.out_buff) {
-        heap_caps_free(player_ctx.out_buff);
-        player_ctx.out_buff = NULL;
-        player_ctx.out_buff_size = 0;
+    player_ctx.out_buff_size = 0;
+    video_present_deinit();
+    bsp_display_unlock();
+
+    /* Deinit video decoder, once all the buffers are back in the pool */
+    if (decoder_ready) {
+        video_decoder_deinit();
     }
 
     ESP_LOGI(TAG, "Video player task finished.");
 
     /* Close task */
-    vTaskDelete(NULL);
+    task_config_delete(TASK_CONFIG_VIDEO_PLAYER, NULL);
 }
 
 lv_obj_t * esp_lvgl_simple_player_create(esp_lvgl_simple_player_cfg_t * params)
@@ -554,12 +1414,12 @@ lv_obj_t * esp_lvgl_simple_player_create(esp_lvgl_simple_player_cfg_t * params)
     player_ctx.video_path = params->video_path;
     player_ctx.bgm_path = params->bgm_path;
     player_ctx.in_buff_size = params->buff_size;
+    player_ctx.fps = params->fps;
 
     player_ctx.cache_buff_size = ALIGN_UP(params->cache_buff_size, CACHE_BUF_ALIGN);
     player_ctx.cache_buff_in_psram = params->cache_buff_in_psram;
-    /* Create split buffer */
-    uint32_t flag = player_ctx.cache_buff_in_psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL;
-    player_ctx.cache_buff = (uint8_t *)heap_caps_aligned_alloc(128, player_ctx.cache_buff_size, flag);
+    /* Create split buffer, the card driver transfers into it directly */
+    player_ctx.cache_buff = (uint8_t *)sd_io_buf_alloc(player_ctx.cache_buff_size, !player_ctx.cache_buff_in_psram);
     if (!player_ctx.cache_buff) {
         ESP_LOGE(TAG, "Malloc cache buffer failed");
         return NULL;
@@ -572,6 +1432,9 @@ lv_obj_t * esp_lvgl_simple_player_create(esp_lvgl_simple_player_cfg_t * params)
     player_ctx.hide_status = params->flags.hide_status;
     player_ctx.auto_width = params->flags.auto_width;
     player_ctx.auto_height = params->flags.auto_height;
+    player_ctx.direct_output = params->flags.direct_output;
+    player_ctx.auto_rotate = params->flags.auto_rotate;
+    player_ctx.fit = params->fit;
     player_ctx.is_init = true;
 
     /* Create LVGL objects */
@@ -617,6 +1480,20 @@ void esp_lvgl_simple_player_change_file(const char *video_file)
     ESP_LOGI(TAG, "Video file changed to %s", video_file);
 }
 
+esp_err_t esp_lvgl_simple_player_set_playlist(const char *const *video_files, uint32_t num)
+{
+    ESP_RETURN_ON_FALSE(player_ctx.is_init, ESP_ERR_INVALID_STATE, TAG, "Not init");
+    ESP_RETURN_ON_FALSE(player_ctx.state == PLAYER_STATE_STOPPED, ESP_ERR_INVALID_STATE, TAG,
+                        "Playlist can be changed only when video is stopped");
+    ESP_RETURN_ON_FALSE((num == 0) || video_files, ESP_ERR_INVALID_ARG, TAG, "Invalid playlist");
+
+    player_ctx.playlist = video_files;
+    player_ctx.playlist_num = num;
+    ESP_LOGI(TAG, "Playlist with %" PRIu32 " videos", num);
+
+    return ESP_OK;
+}
+
 void esp_lvgl_simple_player_play(void)
 {
     if (!player_ctx.is_init) {
@@ -627,7 +1504,7 @@ void esp_lvgl_simple_player_play(void)
     if (player_ctx.state == PLAYER_STATE_STOPPED) {
         ESP_LOGI(TAG, "Player starting playing.");
         /* Create video task */
-        xTaskCreate(show_video_task, "video task", 8 * 1024, NULL, 4, &player_task_handle);
+        task_config_create(TASK_CONFIG_VIDEO_PLAYER, show_video_task, NULL, &player_task_handle);
     } else if(player_ctx.state == PLAYER_STATE_PAUSED) {
         esp_lvgl_simple_player_resume();
     }
@@ -643,7 +1520,7 @@ void esp_lvgl_simple_player_pause(void)
     if (player_ctx.state == PLAYER_STATE_PLAYING) {
         ESP_LOGI(TAG, "Player paused.");
         player_ctx.state = PLAYER_STATE_PAUSED;
-        if (player_ctx.bgm_path != NULL) {
+        if ((player_ctx.bgm_path != NULL) || player_ctx.audio_running) {
             if (audio_player_pause() != ESP_OK) {
                 ESP_LOGE(TAG, "Pause bgm failed");
             }
@@ -677,6 +1554,8 @@ void esp_lvgl_simple_player_resume(void)
             } else if (audio_player_resume() != ESP_OK) {
                 ESP_LOGE(TAG, "Pause bgm failed");
             }
+        } else if (player_ctx.audio_running && (audio_player_resume() != ESP_OK)) {
+            ESP_LOGE(TAG, "Resume audio track failed");
         }
 
         // bsp_display_lock(0);
@@ -705,6 +1584,29 @@ void esp_lvgl_simple_player_stop(void)
     // bsp_display_unlock();
 }
 
+uint32_t esp_lvgl_simple_player_get_frame_num(void)
+{
+    return player_ctx.source.index.frame_num;
+}
+
+uint32_t esp_lvgl_simple_player_get_frame_pos(void)
+{
+    return player_ctx.frame_pos;
+}
+
+esp_err_t esp_lvgl_simple_player_seek(uint32_t frame)
+{
+    ESP_RETURN_ON_FALSE(player_ctx.is_init, ESP_ERR_INVALID_STATE, TAG, "Not init");
+    ESP_RETURN_ON_FALSE(player_ctx.state != PLAYER_STATE_STOPPED, ESP_ERR_INVALID_STATE, TAG, "Not playing");
+    ESP_RETURN_ON_FALSE(player_ctx.source.index.frame_num > 0, ESP_ERR_NOT_SUPPORTED, TAG, "Video has no frame index");
+    ESP_RETURN_ON_FALSE(frame < player_ctx.source.index.frame_num, ESP_ERR_INVALID_ARG, TAG, "Frame out of range");
+
+    /* Picked up by the reader before its next frame */
+    __atomic_store_n(&player_ctx.seek_frame, (int32_t)frame, __ATOMIC_RELAXED);
+
+    return ESP_OK;
+}
+
 void esp_lvgl_simple_player_repeat(bool repeat)
 {
     if (!player_ctx.is_init) {
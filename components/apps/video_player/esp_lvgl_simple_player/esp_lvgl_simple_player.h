@@ -21,18 +21,30 @@ typedef enum
     PLAYER_STATE_STOPPED,
 } player_state_t;
 
+/**
+ * @brief How frames that don't match the output are fitted to it
+ */
+typedef enum
+{
+    PLAYER_FIT_LETTERBOX,   /* Whole frame as large as possible, black bars around */
+    PLAYER_FIT_FILL,        /* Covers the whole output, the overflow is cropped */
+    PLAYER_FIT_NONE,        /* Frame size kept on the canvas, the direct output letterboxes */
+} player_fit_t;
+
 /**
  * @brief Player configuration structure
  */
 typedef struct {
     const char        *video_path;      /* File path to play */
-    const char        *bgm_path;        /* File path to play */
+    const char        *bgm_path;        /* File path to play, NULL to play the audio track of AVI files instead */
     lv_obj_t    *screen;    /* LVGL screen to put the player */
     uint32_t    buff_size;      /* Size of the buffer for one video frame */
     uint32_t    cache_buff_size;      /* Size of the buffer for one video frame */
     bool        cache_buff_in_psram;    /* Use PSRAM for split buffer */
     uint32_t    screen_width;   /* Width of the video player object */
     uint32_t    screen_height;  /* Height of the video player object */
+    uint32_t    fps;            /* Frame rate of raw MJPEG files, 0 to play as fast as possible. AVI files use their header */
+    player_fit_t fit;           /* Fit of the frames to the player object, or to the panel with direct output, done by the PPA */
     struct {
         unsigned int hide_controls: 1;  /* Hide control buttons */
         unsigned int hide_slider: 1;  /* Hide indication slider */
@@ -40,6 +52,8 @@ typedef struct {
 
         unsigned int auto_width: 1;  /* Set automatic width by video size */
         unsigned int auto_height: 1;  /* Set automatic height by video size */
+        unsigned int direct_output: 1;  /* Full screen: flush frames straight to the panel, scaled by the PPA if needed, bypassing LVGL */
+        unsigned int auto_rotate: 1;    /* Turn frames by 90 degrees when their orientation differs from the output */
     } flags;
 } esp_lvgl_simple_player_cfg_t;
 
@@ -68,6 +82,22 @@ void esp_lvgl_simple_player_hide_controls(bool hide);
  */
 void esp_lvgl_simple_player_change_file(const char *video_file);
 
+/**
+ * @brief Set a playlist, played in order instead of the single file
+ *
+ * The decoder and its buffers are kept across files and the next file is opened ahead, so files of the same size
+ * follow each other without a gap. With repeat enabled the playlist starts over after the last file.
+ *
+ * @param video_files   Paths to play, must stay valid while the playlist is set. NULL with 0 to clear it
+ * @param num           Number of paths
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Not init or not stopped
+ *      - ESP_ERR_INVALID_ARG    Invalid playlist
+ */
+esp_err_t esp_lvgl_simple_player_set_playlist(const char *const *video_files, uint32_t num);
+
 /**
  * @brief Play player
  */
@@ -85,6 +115,31 @@ void esp_lvgl_simple_player_resume(void);
  */
 void esp_lvgl_simple_player_stop(void);
 
+/**
+ * @brief Get the number of frames of the playing video
+ *
+ * @return Number of frames, 0 if the video has no frame index
+ */
+uint32_t esp_lvgl_simple_player_get_frame_num(void);
+
+/**
+ * @brief Get the next frame to be read
+ */
+uint32_t esp_lvgl_simple_player_get_frame_pos(void);
+
+/**
+ * @brief Jump to a frame of the playing video
+ *
+ * Takes effect on the next frame read, the frames already being decoded are still shown.
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_STATE  Player not playing
+ *      - ESP_ERR_NOT_SUPPORTED  Video has no frame index
+ *      - ESP_ERR_INVALID_ARG    Frame out of range
+ */
+esp_err_t esp_lvgl_simple_player_seek(uint32_t frame);
+
 /**
  * @brief Set repeat playing
  */
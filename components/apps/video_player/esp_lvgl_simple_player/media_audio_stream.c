@@ -0,0 +1,315 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* fopencookie */
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "audio_player.h"
+#include "media_audio_stream.h"
+
+#define STREAM_BUF_MIN_SIZE         (4 * 1024)
+#define STREAM_WAV_HEADER_SIZE      (44)
+#define STREAM_READ_WAIT_MS         (50)    /* A stop is noticed while the player waits for data */
+#define STREAM_CLOSE_WAIT_MS        (1000)
+#define STREAM_OUTPUT_LATENCY_MS    (30)    /* Decoded audio still in the I2S DMA buffers */
+#define STREAM_STALL_MS             (100)   /* Reads later than this past the audio they got mean the player stalled */
+#define STREAM_MP3_BYTES_PER_SEC    (16000) /* 128 kbit/s, sizes the buffer when the track doesn't tell its rate */
+
+typedef struct {
+    media_audio_format_t format;
+    FILE            *fp;
+    SemaphoreHandle_t lock;         /* Guards the ring and the positions, taken by the player task and the writer */
+    SemaphoreHandle_t data_sem;     /* Given on every write, the reader waits on it when the ring is empty */
+    SemaphoreHandle_t closed_sem;   /* Given once the audio player closed the stream */
+    uint8_t         *buf;
+    uint32_t        size;
+    uint32_t        rd;
+    uint32_t        fill;
+    uint8_t         header[STREAM_WAV_HEADER_SIZE];
+    uint32_t        header_len;
+    uint32_t        header_pos;
+    uint64_t        written;        /* Track position after the last byte in the ring */
+    uint64_t        played;         /* Track position after the last byte read by the player */
+    uint32_t        last_read;      /* Bytes of the last read, 0 until the first one after a reset */
+    int64_t         last_read_us;
+    bool            stopping;
+} media_audio_stream_t;
+
+static const char *TAG = "media_audio_stream";
+static media_audio_stream_t stream = {0};
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, v & 0xFFFF);
+    put_le16(p + 2, v >> 16);
+}
+
+/* The length of the track is unknown to the player, it plays until the stream ends */
+static void stream_build_wav_header(const media_audio_format_t *format)
+{
+    uint8_t *h = stream.header;
+    uint32_t data_size = UINT32_MAX - (STREAM_WAV_HEADER_SIZE - 8);
+
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, UINT32_MAX);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, 1);
+    put_le16(h + 22, format->channels);
+    put_le32(h + 24, format->sample_rate);
+    put_le32(h + 28, format->bytes_per_sec);
+    put_le16(h + 32, format->block_align);
+    put_le16(h + 34, format->bits_per_sample);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, data_size);
+    stream.header_len = STREAM_WAV_HEADER_SIZE;
+}
+
+static ssize_t stream_read(void *cookie, char *buf, size_t size)
+{
+    while (1) {
+        xSemaphoreTake(stream.lock, portMAX_DELAY);
+        if (stream.header_pos < stream.header_len) {
+            size_t len = MIN(size, stream.header_len - stream.header_pos);
+            memcpy(buf, stream.header + stream.header_pos, len);
+            stream.header_pos += len;
+            xSemaphoreGive(stream.lock);
+            return len;
+        }
+        if (stream.fill > 0) {
+            size_t len = MIN(size, stream.fill);
+            size_t first = MIN(len, stream.size - stream.rd);
+            memcpy(buf, stream.buf + stream.rd, first);
+            memcpy(buf + first, stream.buf, len - first);
+            stream.rd = (stream.rd + len) % stream.size;
+            stream.fill -= len;
+            stream.played += len;
+            stream.last_read = len;
+            stream.last_read_us = esp_timer_get_time();
+            xSemaphoreGive(stream.lock);
+            return len;
+        }
+        bool stopping = stream.stopping;
+        xSemaphoreGive(stream.lock);
+
+        /* End of stream for the player */
+        if (stopping) {
+            return 0;
+        }
+        xSemaphoreTake(stream.data_sem, pdMS_TO_TICKS(STREAM_READ_WAIT_MS));
+    }
+}
+
+static int stream_close(void *cookie)
+{
+    xSemaphoreGive(stream.closed_sem);
+
+    return 0;
+}
+
+static void stream_release(void)
+{
+    if (stream.buf) {
+        heap_caps_free(stream.buf);
+        stream.buf = NULL;
+    }
+    stream.fp = NULL;
+    stream.size = 0;
+}
+
+esp_err_t media_audio_stream_start(const media_audio_format_t *format, uint32_t buffer_ms)
+{
+    esp_err_t ret = ESP_OK;
+    cookie_io_functions_t io = {
+        .read = stream_read,
+        .close = stream_close,
+    };
+
+    ESP_RETURN_ON_FALSE(format && (format->codec != MEDIA_AUDIO_CODEC_NONE), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid format");
+    if (stream.lock == NULL) {
+        stream.lock = xSemaphoreCreateMutex();
+        stream.data_sem = xSemaphoreCreateBinary();
+        stream.closed_sem = xSemaphoreCreateBinary();
+        ESP_RETURN_ON_FALSE(stream.lock && stream.data_sem && stream.closed_sem, ESP_ERR_NO_MEM, TAG,
+                            "Create semaphores failed");
+    }
+    /* A stream the player didn't close in time is released once it did */
+    if (stream.fp) {
+        ESP_RETURN_ON_FALSE(xSemaphoreTake(stream.closed_sem, 0) == pdTRUE, ESP_ERR_INVALID_STATE, TAG,
+                            "Previous track still open");
+        stream_release();
+    }
+
+    uint32_t bytes_per_sec = format->bytes_per_sec;
+    uint32_t size = MAX((uint64_t)(bytes_per_sec ? bytes_per_sec : STREAM_MP3_BYTES_PER_SEC) * buffer_ms / 1000,
+                        STREAM_BUF_MIN_SIZE);
+
+    stream.buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    ESP_RETURN_ON_FALSE(stream.buf, ESP_ERR_NO_MEM, TAG, "Malloc %" PRIu32 " bytes buffer failed", size);
+    stream.size = size;
+    stream.format = *format;
+    stream.rd = 0;
+    stream.fill = 0;
+    stream.header_len = 0;
+    stream.header_pos = 0;
+    stream.written = 0;
+    stream.played = 0;
+    stream.last_read = 0;
+    stream.stopping = false;
+    if (format->codec == MEDIA_AUDIO_CODEC_PCM) {
+        stream_build_wav_header(format);
+    }
+    xSemaphoreTake(stream.closed_sem, 0);
+
+    stream.fp = fopencookie(NULL, "rb", io);
+    ESP_GOTO_ON_FALSE(stream.fp, ESP_ERR_NO_MEM, err, TAG, "Open stream failed");
+    /* Every read of the player reaches the ring, so the position is not off by a stdio buffer */
+    setvbuf(stream.fp, NULL, _IONBF, 0);
+
+    if (audio_player_play(stream.fp) != ESP_OK) {
+        fclose(stream.fp);
+        ESP_GOTO_ON_FALSE(false, ESP_FAIL, err, TAG, "Play audio track failed");
+    }
+    ESP_LOGI(TAG, "Playing audio track through %" PRIu32 " bytes buffer", size);
+
+    return ESP_OK;
+
+err:
+    stream_release();
+    return ret;
+}
+
+void media_audio_stream_stop(void)
+{
+    if ((stream.fp == NULL) || stream.stopping) {
+        return;
+    }
+
+    xSemaphoreTake(stream.lock, portMAX_DELAY);
+    stream.stopping = true;
+    xSemaphoreGive(stream.lock);
+    xSemaphoreGive(stream.data_sem);
+    /* Already closed when another app took the player over, its playback is left alone */
+    if (xSemaphoreTake(stream.closed_sem, 0) == pdTRUE) {
+        stream_release();
+        return;
+    }
+    if (audio_player_stop() != ESP_OK) {
+        ESP_LOGW(TAG, "Stop audio player failed");
+    }
+
+    /* The player task may still be reading, the buffer stays until it closed the stream */
+    if (xSemaphoreTake(stream.closed_sem, pdMS_TO_TICKS(STREAM_CLOSE_WAIT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Audio player kept the track open");
+        return;
+    }
+    stream_release();
+}
+
+bool media_audio_stream_is_format(const media_audio_format_t *format)
+{
+    return stream.fp && !stream.stopping && !memcmp(&stream.format, format, sizeof(media_audio_format_t));
+}
+
+uint32_t media_audio_stream_get_free(void)
+{
+    uint32_t free_size = 0;
+
+    if ((stream.fp == NULL) || stream.stopping) {
+        return 0;
+    }
+
+    xSemaphoreTake(stream.lock, portMAX_DELAY);
+    free_size = stream.size - stream.fill;
+    xSemaphoreGive(stream.lock);
+
+    return free_size;
+}
+
+uint32_t media_audio_stream_write(const void *data, uint32_t len)
+{
+    if ((stream.fp == NULL) || stream.stopping) {
+        return 0;
+    }
+
+    xSemaphoreTake(stream.lock, portMAX_DELAY);
+    len = MIN(len, stream.size - stream.fill);
+    uint32_t wr = (stream.rd + stream.fill) % stream.size;
+    uint32_t first = MIN(len, stream.size - wr);
+    memcpy(stream.buf + wr, data, first);
+    memcpy(stream.buf, (const uint8_t *)data + first, len - first);
+    stream.fill += len;
+    stream.written += len;
+    xSemaphoreGive(stream.lock);
+
+    if (len) {
+        xSemaphoreGive(stream.data_sem);
+    }
+
+    return len;
+}
+
+uint64_t media_audio_stream_get_written(void)
+{
+    return stream.written;
+}
+
+void media_audio_stream_reset(uint64_t pos)
+{
+    if (stream.fp == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(stream.lock, portMAX_DELAY);
+    stream.rd = 0;
+    stream.fill = 0;
+    stream.written = pos;
+    stream.played = pos;
+    stream.last_read = 0;
+    xSemaphoreGive(stream.lock);
+}
+
+bool media_audio_stream_get_position(uint64_t *pos)
+{
+    uint32_t bytes_per_sec = stream.format.bytes_per_sec;
+    bool valid = false;
+
+    if ((stream.fp == NULL) || (bytes_per_sec == 0)) {
+        return false;
+    }
+
+    xSemaphoreTake(stream.lock, portMAX_DELAY);
+    if ((stream.last_read > 0) && !stream.stopping) {
+        /* The player decodes a read and blocks on the output, so the previous reads are being heard */
+        int64_t elapsed_us = esp_timer_get_time() - stream.last_read_us;
+        int64_t read_us = (int64_t)stream.last_read * 1000000 / bytes_per_sec;
+        uint64_t latency = (uint64_t)bytes_per_sec * STREAM_OUTPUT_LATENCY_MS / 1000;
+        uint64_t heard = stream.played - stream.last_read + MIN(elapsed_us, read_us) * bytes_per_sec / 1000000;
+
+        valid = elapsed_us <= read_us + STREAM_STALL_MS * 1000;
+        *pos = (heard > latency) ? (heard - latency) : 0;
+    }
+    xSemaphoreGive(stream.lock);
+
+    return valid;
+}
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "media_frame_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start playing an audio track that is written chunk by chunk
+ *
+ * The audio player reads the track from a jitter buffer in PSRAM, PCM gets a WAV header in front so the player
+ * recognizes it. The bytes it has taken out of the buffer tell the playing position. The audio player is shared,
+ * whatever it was playing is stopped.
+ *
+ * @param format    Format of the track
+ * @param buffer_ms Duration of audio the buffer holds
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_INVALID_ARG    Invalid format
+ *      - ESP_ERR_INVALID_STATE  Already started, or the player still holds the previous track
+ *      - ESP_ERR_NO_MEM         Failed to allocate the buffer
+ *      - ESP_FAIL               The audio player refused the track
+ */
+esp_err_t media_audio_stream_start(const media_audio_format_t *format, uint32_t buffer_ms);
+
+/**
+ * @brief Stop the audio player and release the buffer
+ */
+void media_audio_stream_stop(void);
+
+/**
+ * @brief Check whether a track is being played with the given format
+ */
+bool media_audio_stream_is_format(const media_audio_format_t *format);
+
+/**
+ * @brief Get the free space of the jitter buffer in bytes
+ */
+uint32_t media_audio_stream_get_free(void);
+
+/**
+ * @brief Append track data to the jitter buffer, without blocking
+ *
+ * @return Bytes taken, less than `len` when the buffer is full
+ */
+uint32_t media_audio_stream_write(const void *data, uint32_t len);
+
+/**
+ * @brief Get the byte position right after the data written so far
+ */
+uint64_t media_audio_stream_get_written(void);
+
+/**
+ * @brief Drop the buffered data, e.g. on seek
+ *
+ * @param pos   Byte position of the next data written, the playing position jumps there
+ */
+void media_audio_stream_reset(uint64_t pos);
+
+/**
+ * @brief Get the byte position heard right now
+ *
+ * Follows the reads of the audio player between two of them, minus the output latency.
+ *
+ * @param pos   Output position
+ *
+ * @return false while nothing is playing, e.g. before the first read, after a reset, on underrun or while paused
+ */
+bool media_audio_stream_get_position(uint64_t *pos);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,431 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "media_frame_index.h"
+
+#define INDEX_FILE_MAGIC        (0x58494A4D)    /* "MJIX" */
+#define INDEX_FILE_VERSION      (1)
+#define INDEX_FILE_EXT          ".idx"
+#define INDEX_PATH_LEN_MAX      (128)
+#define INDEX_ENTRIES_INIT      (256)
+#define AVI_LIST_HEADER_SIZE    (12)
+#define AVI_IDX1_ENTRY_SIZE     (16)
+#define AVI_WAVEFORMAT_SIZE     (16)            /* WAVEFORMATEX up to wBitsPerSample */
+#define AVI_WAVE_FORMAT_PCM     (0x0001)
+#define AVI_WAVE_FORMAT_MP3     (0x0055)
+
+typedef struct {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    entry_size;
+    uint32_t    frame_num;
+    uint32_t    video_size;     /* Size of the indexed video, a different size invalidates the cache */
+} index_file_header_t;
+
+static const char *TAG = "media_frame_index";
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static esp_err_t index_append(media_frame_index_t *index, uint32_t *capacity, uint32_t offset, uint32_t size)
+{
+    if (index->frame_num == *capacity) {
+        uint32_t new_capacity = *capacity ? *capacity * 2 : INDEX_ENTRIES_INIT;
+        media_frame_entry_t *entries = heap_caps_realloc(index->entries, new_capacity * sizeof(media_frame_entry_t),
+                                                         MALLOC_CAP_SPIRAM);
+        ESP_RETURN_ON_FALSE(entries, ESP_ERR_NO_MEM, TAG, "Grow index to %" PRIu32 " frames failed", new_capacity);
+        index->entries = entries;
+        *capacity = new_capacity;
+    }
+    index->entries[index->frame_num].offset = offset;
+    index->entries[index->frame_num].size = size;
+    index->frame_num++;
+
+    return ESP_OK;
+}
+
+/* Keeps playing without sound when the audio entries can't be stored */
+static void audio_append(media_frame_index_t *index, uint32_t *capacity, uint32_t offset, uint32_t size)
+{
+    if (index->audio.codec == MEDIA_AUDIO_CODEC_NONE) {
+        return;
+    }
+    if (index->audio_num == *capacity) {
+        uint32_t new_capacity = *capacity ? *capacity * 2 : INDEX_ENTRIES_INIT;
+        media_audio_entry_t *entries = heap_caps_realloc(index->audio_entries,
+                                                         new_capacity * sizeof(media_audio_entry_t), MALLOC_CAP_SPIRAM);
+        if (entries == NULL) {
+            ESP_LOGW(TAG, "Grow audio index to %" PRIu32 " chunks failed, playing without sound", new_capacity);
+            heap_caps_free(index->audio_entries);
+            index->audio_entries = NULL;
+            index->audio_num = 0;
+            index->audio_size = 0;
+            index->audio.codec = MEDIA_AUDIO_CODEC_NONE;
+            return;
+        }
+        index->audio_entries = entries;
+        *capacity = new_capacity;
+    }
+    index->audio_entries[index->audio_num].offset = offset;
+    index->audio_entries[index->audio_num].size = size;
+    index->audio_entries[index->audio_num].start = index->audio_size;
+    index->audio_num++;
+    index->audio_size += size;
+}
+
+/* `strh` tells the stream type, `strf` of an audio stream is a WAVEFORMATEX */
+static bool index_parse_strl(const uint8_t *strl, uint32_t len, media_audio_format_t *audio)
+{
+    bool is_audio = false;
+
+    for (uint64_t pos = 0; pos + 8 <= len;) {
+        const uint8_t *chunk = strl + pos;
+        uint32_t size = get_le32(chunk + 4);
+        uint32_t avail = len - pos - 8;
+
+        if (!memcmp(chunk, "strh", 4) && (avail >= 4)) {
+            is_audio = !memcmp(chunk + 8, "auds", 4);
+        } else if (!memcmp(chunk, "strf", 4) && is_audio && (avail >= AVI_WAVEFORMAT_SIZE)) {
+            const uint8_t *format = chunk + 8;
+            uint16_t tag = get_le16(format);
+
+            audio->channels = get_le16(format + 2);
+            audio->sample_rate = get_le32(format + 4);
+            audio->bytes_per_sec = get_le32(format + 8);
+            audio->block_align = get_le16(format + 12);
+            audio->bits_per_sample = get_le16(format + 14);
+            if ((tag == AVI_WAVE_FORMAT_PCM) && audio->block_align && audio->bits_per_sample &&
+                    !(audio->bits_per_sample % 8)) {
+                audio->codec = MEDIA_AUDIO_CODEC_PCM;
+                /* Exact for PCM, muxers don't always fill it in */
+                audio->bytes_per_sec = audio->sample_rate * audio->block_align;
+            } else if (tag == AVI_WAVE_FORMAT_MP3) {
+                audio->codec = MEDIA_AUDIO_CODEC_MP3;
+                audio->bits_per_sample = 0;
+            } else {
+                ESP_LOGW(TAG, "Audio format 0x%04x not supported, playing without sound", tag);
+                audio->codec = MEDIA_AUDIO_CODEC_NONE;
+            }
+
+            return (audio->codec != MEDIA_AUDIO_CODEC_NONE) && audio->channels && audio->sample_rate;
+        }
+        pos += 8 + (uint64_t)size + (size & 1);
+    }
+
+    return false;
+}
+
+/* `avih` gives the frame duration, the first playable audio stream is picked from the `strl` lists */
+static void index_parse_hdrl(const uint8_t *hdrl, uint32_t len, uint32_t *us_per_frame, media_audio_format_t *audio,
+                             int *audio_stream)
+{
+    int stream = 0;
+
+    for (uint64_t pos = 0; pos + 8 <= len;) {
+        const uint8_t *chunk = hdrl + pos;
+        uint32_t size = get_le32(chunk + 4);
+        uint32_t avail = len - pos - 8;
+
+        if (!memcmp(chunk, "avih", 4) && (avail >= 4)) {
+            *us_per_frame = get_le32(chunk + 8);
+        } else if (!memcmp(chunk, "LIST", 4) && (avail >= 4) && !memcmp(chunk + 8, "strl", 4)) {
+            if ((*audio_stream < 0) && index_parse_strl(chunk + 12, MIN(size, avail) - 4, audio)) {
+                *audio_stream = stream;
+            }
+            stream++;
+        }
+        pos += 8 + (uint64_t)size + (size & 1);
+    }
+}
+
+static esp_err_t index_parse_avi(media_frame_index_t *index, media_src_t *src, uint64_t file_size,
+                                 uint8_t *work_buf, uint32_t work_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t capacity = 0;
+    uint32_t audio_capacity = 0;
+    uint32_t movi_pos = 0;
+    uint32_t idx1_pos = 0;
+    uint32_t idx1_size = 0;
+    uint64_t pos = AVI_LIST_HEADER_SIZE;
+    uint32_t us_per_frame = 0;
+    int audio_stream = -1;
+    bool relative = true;
+    bool first = true;
+
+    if ((media_src_storage_seek(src, 0) != 0) ||
+            (media_src_storage_read(src, work_buf, AVI_LIST_HEADER_SIZE) != AVI_LIST_HEADER_SIZE) ||
+            memcmp(work_buf, "RIFF", 4) || memcmp(work_buf + 8, "AVI ", 4)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    /* Walk the top level chunks, only `hdrl`, `movi` and `idx1` matter */
+    while ((pos + 8 <= file_size) && (idx1_pos == 0)) {
+        media_src_storage_seek(src, pos);
+        if (media_src_storage_read(src, work_buf, AVI_LIST_HEADER_SIZE) < 8) {
+            break;
+        }
+        uint32_t size = get_le32(work_buf + 4);
+        if (!memcmp(work_buf, "LIST", 4) && !memcmp(work_buf + 8, "hdrl", 4) && (size > 4)) {
+            /* The header list is a few KB, anything past the scratch buffer is left out */
+            int len = media_src_storage_read(src, work_buf, MIN(size - 4, work_size));
+            if (len > 0) {
+                index_parse_hdrl(work_buf, len, &us_per_frame, &index->audio, &audio_stream);
+            }
+        } else if (!memcmp(work_buf, "LIST", 4) && !memcmp(work_buf + 8, "movi", 4)) {
+            movi_pos = pos + 8;
+        } else if (!memcmp(work_buf, "idx1", 4)) {
+            idx1_pos = pos + 8;
+            idx1_size = size;
+        }
+        pos += 8 + (uint64_t)size + (size & 1);
+    }
+    ESP_GOTO_ON_FALSE(movi_pos && idx1_pos && (idx1_pos + (uint64_t)idx1_size <= file_size), ESP_ERR_NOT_FOUND, err,
+                      TAG, "AVI without usable idx1");
+
+    uint32_t chunk_size = (work_size / AVI_IDX1_ENTRY_SIZE) * AVI_IDX1_ENTRY_SIZE;
+    media_src_storage_seek(src, idx1_pos);
+    for (uint32_t done = 0; done + AVI_IDX1_ENTRY_SIZE <= idx1_size;) {
+        uint32_t len = idx1_size - done;
+        len = (len > chunk_size ? chunk_size : len) / AVI_IDX1_ENTRY_SIZE * AVI_IDX1_ENTRY_SIZE;
+        ESP_GOTO_ON_FALSE(media_src_storage_read(src, work_buf, len) == len, ESP_FAIL, err, TAG, "Read idx1 failed");
+        done += len;
+
+        for (uint8_t *entry = work_buf; entry < work_buf + len; entry += AVI_IDX1_ENTRY_SIZE) {
+            uint32_t offset = get_le32(entry + 8);
+            uint32_t size = get_le32(entry + 12);
+            /* Video chunks are `##dc` or `##db`, audio chunks `##wb` with the number of their stream */
+            bool is_video = (entry[2] == 'd') && ((entry[3] == 'c') || (entry[3] == 'b'));
+            bool is_audio = (audio_stream >= 0) && (entry[2] == 'w') && (entry[3] == 'b') &&
+                            ((entry[0] - '0') * 10 + (entry[1] - '0') == audio_stream);
+            /* Empty video chunks are dropped frames */
+            if (!(is_video || is_audio) || (size == 0)) {
+                continue;
+            }
+            /* Offsets are relative to the `movi` fourcc, a few muxers write file offsets instead */
+            if (first) {
+                relative = offset < movi_pos;
+                first = false;
+            }
+            uint64_t data = (relative ? movi_pos : 0) + (uint64_t)offset + 8;
+            if (data + size > file_size) {
+                continue;
+            }
+            if (is_audio) {
+                audio_append(index, &audio_capacity, data, size);
+                continue;
+            }
+            ESP_GOTO_ON_ERROR(index_append(index, &capacity, data, size), err, TAG, "Append frame failed");
+        }
+    }
+    ESP_GOTO_ON_FALSE(index->frame_num > 0, ESP_ERR_NOT_FOUND, err, TAG, "No video chunk in idx1");
+    index->us_per_frame = us_per_frame;
+    if (index->audio_num == 0) {
+        index->audio.codec = MEDIA_AUDIO_CODEC_NONE;
+    }
+
+    return ESP_OK;
+
+err:
+    media_frame_index_free(index);
+    return ret;
+}
+
+static esp_err_t index_scan_markers(media_frame_index_t *index, media_src_t *src, uint8_t *work_buf, uint32_t work_size)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t capacity = 0;
+    uint32_t pos = 0;
+    uint32_t frame_start = 0;
+    bool in_frame = false;
+    bool prev_ff = false;
+    int len = 0;
+
+    media_src_storage_seek(src, 0);
+    while ((len = media_src_storage_read(src, work_buf, work_size)) > 0) {
+        for (int i = 0; i < len; ) {
+            if (!prev_ff) {
+                uint8_t *ff = memchr(work_buf + i, 0xFF, len - i);
+                if (ff == NULL) {
+                    break;
+                }
+                i = ff - work_buf + 1;
+                prev_ff = true;
+                continue;
+            }
+
+            /* Markers may straddle two reads, `prev_ff` carries the first byte over */
+            uint8_t marker = work_buf[i];
+            uint32_t marker_pos = pos + i - 1;
+            prev_ff = (marker == 0xFF);
+            i++;
+            if (!in_frame && (marker == 0xD8)) {
+                frame_start = marker_pos;
+                in_frame = true;
+            } else if (in_frame && (marker == 0xD9)) {
+                ESP_GOTO_ON_ERROR(index_append(index, &capacity, frame_start, marker_pos + 2 - frame_start), err, TAG,
+                                  "Append frame failed");
+                in_frame = false;
+            }
+        }
+        pos += len;
+    }
+    ESP_GOTO_ON_FALSE(index->frame_num > 0, ESP_ERR_NOT_FOUND, err, TAG, "No JPEG frame found");
+
+    return ESP_OK;
+
+err:
+    media_frame_index_free(index);
+    return ret;
+}
+
+static void index_get_cache_path(const char *uri, char *path, size_t size)
+{
+    const char *name = strrchr(uri, '/');
+    const char *ext = strrchr(uri, '.');
+    int stem_len = (ext && (!name || ext > name)) ? (int)(ext - uri) : (int)strlen(uri);
+
+    snprintf(path, size, "%.*s" INDEX_FILE_EXT, stem_len, uri);
+}
+
+static esp_err_t index_load_cache(media_frame_index_t *index, const char *path, uint64_t file_size)
+{
+    esp_err_t ret = ESP_OK;
+    index_file_header_t header;
+    FILE *fp = fopen(path, "rb");
+
+    if (fp == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_GOTO_ON_FALSE((fread(&header, sizeof(header), 1, fp) == 1) && (header.magic == INDEX_FILE_MAGIC) &&
+                      (header.version == INDEX_FILE_VERSION) && (header.entry_size == sizeof(media_frame_entry_t)) &&
+                      (header.video_size == file_size) && (header.frame_num > 0), ESP_ERR_INVALID_VERSION, err, TAG,
+                      "Stale index %s", path);
+
+    index->entries = heap_caps_malloc(header.frame_num * sizeof(media_frame_entry_t), MALLOC_CAP_SPIRAM);
+    ESP_GOTO_ON_FALSE(index->entries, ESP_ERR_NO_MEM, err, TAG, "Malloc index failed");
+    ESP_GOTO_ON_FALSE(fread(index->entries, sizeof(media_frame_entry_t), header.frame_num, fp) == header.frame_num,
+                      ESP_ERR_INVALID_SIZE, err, TAG, "Truncated index %s", path);
+    index->frame_num = header.frame_num;
+    fclose(fp);
+
+    return ESP_OK;
+
+err:
+    fclose(fp);
+    media_frame_index_free(index);
+    return ret;
+}
+
+static void index_save_cache(const media_frame_index_t *index, const char *path, uint64_t file_size)
+{
+    index_file_header_t header = {
+        .magic = INDEX_FILE_MAGIC,
+        .version = INDEX_FILE_VERSION,
+        .entry_size = sizeof(media_frame_entry_t),
+        .frame_num = index->frame_num,
+        .video_size = file_size,
+    };
+    FILE *fp = fopen(path, "wb");
+
+    if (fp == NULL) {
+        ESP_LOGW(TAG, "Create %s failed, the video will be scanned again next time", path);
+        return;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+              (fwrite(index->entries, sizeof(media_frame_entry_t), index->frame_num, fp) == index->frame_num);
+    fclose(fp);
+    if (!ok) {
+        ESP_LOGW(TAG, "Write %s failed", path);
+        remove(path);
+    }
+}
+
+esp_err_t media_frame_index_load(media_frame_index_t *index, media_src_t *src, const char *uri,
+                                 uint8_t *work_buf, uint32_t work_size)
+{
+    char path[INDEX_PATH_LEN_MAX];
+    uint64_t file_size = 0;
+
+    ESP_RETURN_ON_FALSE(index && src && uri && work_buf && (work_size >= 1024), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    memset(index, 0, sizeof(*index));
+    ESP_RETURN_ON_FALSE(media_src_storage_get_size(src, &file_size) == 0, ESP_FAIL, TAG, "Get file size failed");
+    ESP_RETURN_ON_FALSE(file_size <= UINT32_MAX, ESP_ERR_NOT_SUPPORTED, TAG, "File too large to index");
+
+    if (index_parse_avi(index, src, file_size, work_buf, work_size) == ESP_OK) {
+        ESP_LOGI(TAG, "Indexed %" PRIu32 " frames from idx1", index->frame_num);
+        if (index->audio_num) {
+            ESP_LOGI(TAG, "Audio track: %s, %" PRIu32 " Hz, %d channels, %" PRIu32 " chunks",
+                     (index->audio.codec == MEDIA_AUDIO_CODEC_PCM) ? "PCM" : "MP3", index->audio.sample_rate,
+                     index->audio.channels, index->audio_num);
+        }
+        return ESP_OK;
+    }
+
+    index_get_cache_path(uri, path, sizeof(path));
+    if (index_load_cache(index, path, file_size) == ESP_OK) {
+        ESP_LOGI(TAG, "Loaded %" PRIu32 " frames from %s", index->frame_num, path);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Scanning %s for frames ...", uri);
+    ESP_RETURN_ON_ERROR(index_scan_markers(index, src, work_buf, work_size), TAG, "Scan frames failed");
+    ESP_LOGI(TAG, "Indexed %" PRIu32 " frames, caching to %s", index->frame_num, path);
+    index_save_cache(index, path, file_size);
+
+    return ESP_OK;
+}
+
+void media_frame_index_free(media_frame_index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    if (index->entries) {
+        heap_caps_free(index->entries);
+    }
+    if (index->audio_entries) {
+        heap_caps_free(index->audio_entries);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+uint32_t media_frame_index_find_audio(const media_frame_index_t *index, uint64_t pos)
+{
+    uint32_t low = 0;
+    uint32_t high = index->audio_num;
+
+    if (pos >= index->audio_size) {
+        return index->audio_num;
+    }
+    /* Last entry starting at or before `pos` */
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (index->audio_entries[mid].start <= pos) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
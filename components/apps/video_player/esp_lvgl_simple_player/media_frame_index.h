@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "media_src_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Location of one JPEG frame in a video file
+ */
+typedef struct {
+    uint32_t    offset;     /*!< File offset of the SOI marker */
+    uint32_t    size;       /*!< Frame size in bytes, EOI marker included */
+} media_frame_entry_t;
+
+/**
+ * @brief Codec of the audio track of a video file
+ */
+typedef enum {
+    MEDIA_AUDIO_CODEC_NONE = 0,     /*!< No audio track, or one that can't be played */
+    MEDIA_AUDIO_CODEC_PCM,          /*!< Interleaved little endian PCM */
+    MEDIA_AUDIO_CODEC_MP3,          /*!< MPEG-1/2 layer III */
+} media_audio_codec_t;
+
+/**
+ * @brief Format of the audio track, from the `strf` chunk of the AVI stream
+ */
+typedef struct {
+    media_audio_codec_t codec;
+    uint16_t            channels;
+    uint16_t            bits_per_sample;    /*!< 0 for MP3 */
+    uint32_t            sample_rate;
+    uint32_t            bytes_per_sec;      /*!< Exact for PCM, average for VBR MP3, 0 if unknown */
+    uint16_t            block_align;        /*!< Bytes per PCM sample frame */
+} media_audio_format_t;
+
+/**
+ * @brief Location of one audio chunk in a video file
+ */
+typedef struct {
+    uint32_t    offset;     /*!< File offset of the chunk data */
+    uint32_t    size;       /*!< Chunk size in bytes */
+    uint32_t    start;      /*!< Bytes of the track before this chunk */
+} media_audio_entry_t;
+
+/**
+ * @brief Frame index of a video file
+ */
+typedef struct {
+    media_frame_entry_t *entries;       /*!< Entries in display order, allocated in PSRAM */
+    uint32_t            frame_num;      /*!< Number of entries */
+    uint32_t            us_per_frame;   /*!< Frame duration from the container, 0 if unknown */
+    media_audio_format_t audio;         /*!< Format of the first audio track of an AVI file */
+    media_audio_entry_t *audio_entries; /*!< Chunks of that track in file order, allocated in PSRAM */
+    uint32_t            audio_num;      /*!< Number of audio entries, 0 without a playable track */
+    uint32_t            audio_size;     /*!< Bytes of the whole track */
+} media_frame_index_t;
+
+/**
+ * @brief Load the frame index of a video file
+ *
+ * AVI files are indexed from their `idx1` chunk, together with the chunks of their first audio stream if it is
+ * PCM or MP3. Raw MJPEG streams are scanned once for SOI/EOI markers and the
+ * result is cached on the storage next to the video (`<name>.idx`), so later loads only read the cache file.
+ *
+ * @param index     Index to fill, released with `media_frame_index_free`
+ * @param src       Connected source of the video, its position is left undefined
+ * @param uri       Path of the video, used to derive the cache file path
+ * @param work_buf  Scratch buffer for the scan
+ * @param work_size Size of the scratch buffer, at least 1 KB
+ *
+ * @return
+ *      - ESP_OK                 On success
+ *      - ESP_ERR_NOT_FOUND      No frame in the file
+ *      - ESP_ERR_NO_MEM         Failed to allocate the entries
+ *      - ESP_FAIL               Failed to read the video
+ */
+esp_err_t media_frame_index_load(media_frame_index_t *index, media_src_t *src, const char *uri,
+                                 uint8_t *work_buf, uint32_t work_size);
+
+/**
+ * @brief Release the entries of a frame index
+ */
+void media_frame_index_free(media_frame_index_t *index);
+
+/**
+ * @brief Find the audio chunk playing at a given byte of the track
+ *
+ * @param index     Index with an audio track
+ * @param pos       Byte of the track, see `media_audio_entry_t.start`
+ *
+ * @return Entry containing the byte, `audio_num` if the byte is past the end of the track
+ */
+uint32_t media_frame_index_find_audio(const media_frame_index_t *index, uint64_t pos);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,10 +3,12 @@
 #include <stdbool.h>
 #include <string.h>
 #include <sys/unistd.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "media_src_storage.h"
 #include "bsp/esp-bsp.h"
+#include "sd_io/sd_io.h"
 
 #define CACHE_SIZE (64 * 1024)
 
@@ -22,7 +24,7 @@ typedef struct {
     int      align_pos;
     int      buffer_pos;
 #endif
-    FILE*    fp;
+    int      fd;        /* Read without stdio buffering, -1 if not connected */
 } storage_src_t;
 
 #define ALIGN_TO(pos, align) (pos & (~((align)-1)))
@@ -69,7 +71,7 @@ static int cache_data(storage_src_t* m, void *data, int n) {
         m->readed = m->filled = 0;
     }
     if (m->filled == 0) {
-        int n = read(fileno(m->fp), m->align_buffer, CACHE_SIZE);
+        int n = sd_io_read(m->fd, m->align_buffer, CACHE_SIZE);
         if (n < 0) {
             return n;
         }
@@ -108,13 +110,14 @@ int media_src_storage_open(media_src_t *src)
         return -1;
     }
 #ifdef USE_ALIGN_CACHE
-    m->align_buffer = heap_caps_aligned_alloc(128, CACHE_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    m->align_buffer = sd_io_buf_alloc(CACHE_SIZE, true);
     if (m->align_buffer == NULL) {
         ESP_LOGE(TAG, "No memory");
         free(m);
         return -1;
     }
 #endif
+    m->fd = -1;
     src->sub_src = m;
     return 0;
 }
@@ -122,14 +125,14 @@ int media_src_storage_open(media_src_t *src)
 int media_src_storage_connect(media_src_t *src, const char *uri)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
-        fclose(m->fp);
-        m->fp = NULL;
+    if (m->fd >= 0) {
+        close(m->fd);
+        m->fd = -1;
     }
     media_src_storage_flush(m);
     ESP_LOGI(TAG, "Open file %s", uri);
-    m->fp = fopen(uri, "rb");
-    if (m->fp) {
+    m->fd = sd_io_open(uri);
+    if (m->fd >= 0) {
         return 0;
     }
     ESP_LOGE(TAG, "Fail to open file");
@@ -139,9 +142,13 @@ int media_src_storage_connect(media_src_t *src, const char *uri)
 int media_src_storage_disconnect(media_src_t *src)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
-        fclose(m->fp);
-        m->fp = NULL;
+    if (m->fd >= 0) {
+        sd_io_stats_t stats;
+        sd_io_get_stats(&stats);
+        ESP_LOGI(TAG, "SD card read %llu KB at %u.%03u MB/s, %u unaligned reads", stats.read_bytes / 1024,
+                 stats.read_kbps / 1000, stats.read_kbps % 1000, stats.unaligned_num);
+        close(m->fd);
+        m->fd = -1;
     }
     media_src_storage_flush(m);
     return 0;
@@ -150,12 +157,11 @@ int media_src_storage_disconnect(media_src_t *src)
 int media_src_storage_read(media_src_t *src, void *data, size_t len)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
+    if (m->fd >= 0) {
 #ifdef USE_ALIGN_CACHE
         return read_from_cache(m, data, len);
 #else
-        int n = read(fileno(m->fp), data, len);
-        return n;
+        return sd_io_read(m->fd, data, len);
 #endif
     }
     ESP_LOGE(TAG, "Fail to read file");
@@ -165,7 +171,7 @@ int media_src_storage_read(media_src_t *src, void *data, size_t len)
 int media_src_storage_seek(media_src_t *src, uint64_t position)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
+    if (m->fd >= 0) {
 #ifdef USE_ALIGN_CACHE
         if (m->filled && position >= m->buffer_pos && position <= m->buffer_pos + m->filled) {
             // Still in cached memory
@@ -180,7 +186,7 @@ int media_src_storage_seek(media_src_t *src, uint64_t position)
         m->buffer_pos = m->align_pos;
         position = m->align_pos;
 #endif
-        return fseek(m->fp, position, SEEK_SET);
+        return (lseek(m->fd, position, SEEK_SET) == (off_t)position) ? 0 : -1;
     }
     ESP_LOGE(TAG, "Fail to seek file");
     return -1;
@@ -189,8 +195,9 @@ int media_src_storage_seek(media_src_t *src, uint64_t position)
 int media_src_storage_get_position(media_src_t *src, uint64_t *position)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
-        *position = ftell(m->fp);
+    if (m->fd >= 0) {
+        off_t pos = lseek(m->fd, 0, SEEK_CUR);
+        *position = (pos < 0) ? 0 : pos;
         return 0;
     }
     ESP_LOGE(TAG, "Fail to get position");
@@ -200,12 +207,9 @@ int media_src_storage_get_position(media_src_t *src, uint64_t *position)
 int media_src_storage_get_size(media_src_t *src, uint64_t *size)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
-        uint32_t old = ftell(m->fp);
-        fseek(m->fp, 0, 2);
-        long end = ftell(m->fp);
-        fseek(m->fp, old, 0);
-        *size = (end <= 0 ? 0 : (uint32_t) end);
+    struct stat st;
+    if ((m->fd >= 0) && (fstat(m->fd, &st) == 0)) {
+        *size = st.st_size;
         return 0;
     }
     ESP_LOGE(TAG, "Fail to get size");
@@ -215,13 +219,13 @@ int media_src_storage_get_size(media_src_t *src, uint64_t *size)
 int media_src_storage_close(media_src_t *src)
 {
     storage_src_t* m = (storage_src_t*)src->sub_src;
-    if (m->fp) {
-        fclose((FILE *) m->fp);
-        m->fp = NULL;
+    if (m->fd >= 0) {
+        close(m->fd);
+        m->fd = -1;
     }
 #ifdef USE_ALIGN_CACHE
     if (m->align_buffer) {
-        free(m->align_buffer);
+        heap_caps_free(m->align_buffer);
     }
 #endif
     free(m);
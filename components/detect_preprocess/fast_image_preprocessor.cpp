@@ -0,0 +1,130 @@
+#include <math.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "dl_define.hpp"
+#include "fast_image_preprocessor.hpp"
+
+static const char *TAG = "fast_preprocess";
+
+FastImagePreprocessor::FastImagePreprocessor(dl::Model *model,
+                                             const std::vector<float> &mean,
+                                             const std::vector<float> &std,
+                                             uint32_t caps,
+                                             const std::string &input_name) :
+    m_input(nullptr),
+    m_width(0),
+    m_height(0),
+    m_supported(false),
+    m_rgb565_big_endian(caps & DL_IMAGE_CAP_RGB565_BIG_ENDIAN),
+    m_first((caps & DL_IMAGE_CAP_RGB_SWAP) ? 2 : 0),
+    m_last((caps & DL_IMAGE_CAP_RGB_SWAP) ? 0 : 2),
+    m_col_offset(nullptr),
+    m_resize_scale_x(1),
+    m_resize_scale_y(1),
+    m_top_left_x(0),
+    m_top_left_y(0)
+{
+    std::map<std::string, dl::TensorBase *> inputs = model->get_inputs();
+    auto it = input_name.empty() ? inputs.begin() : inputs.find(input_name);
+    if (it == inputs.end()) {
+        ESP_LOGE(TAG, "Input %s not found", input_name.c_str());
+        return;
+    }
+    m_input = it->second;
+
+    // NHWC
+    if ((m_input->dtype != dl::DATA_TYPE_INT8) || (m_input->shape.size() != 4) || (m_input->shape[3] != 3) ||
+            (mean.size() != 3) || (std.size() != 3)) {
+        ESP_LOGW(TAG, "Only 3 channel int8 inputs are supported");
+        return;
+    }
+    m_height = m_input->shape[1];
+    m_width = m_input->shape[2];
+    m_col_offset = (uint32_t *)heap_caps_malloc(m_width * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!m_col_offset) {
+        ESP_LOGE(TAG, "Allocate column table failed");
+        return;
+    }
+
+    build_lut(m_lut565[0], 5, m_first, mean, std);
+    build_lut(m_lut565[1], 6, 1, mean, std);
+    build_lut(m_lut565[2], 5, m_last, mean, std);
+    build_lut(m_lut888[0], 8, m_first, mean, std);
+    build_lut(m_lut888[1], 8, 1, mean, std);
+    build_lut(m_lut888[2], 8, m_last, mean, std);
+    m_supported = true;
+}
+
+FastImagePreprocessor::~FastImagePreprocessor()
+{
+    if (m_col_offset) {
+        heap_caps_free(m_col_offset);
+        m_col_offset = nullptr;
+    }
+}
+
+void FastImagePreprocessor::build_lut(
+    int8_t *lut, int bits, int channel, const std::vector<float> &mean, const std::vector<float> &std)
+{
+    float inv_std = 1.f / std[channel];
+
+    for (int i = 0; i < (1 << bits); i++) {
+        // Replicate the high bits into the low ones, so full scale maps to 255
+        int value = (i << (8 - bits)) | (i >> (2 * bits - 8));
+        long q = lroundf(ldexpf((value - mean[channel]) * inv_std, -m_input->exponent));
+        lut[i] = (int8_t)DL_CLIP(q, -128, 127);
+    }
+}
+
+bool FastImagePreprocessor::is_supported(const dl::image::img_t &img) const
+{
+    return m_supported &&
+        ((img.pix_type == dl::image::DL_IMAGE_PIX_TYPE_RGB565) || (img.pix_type == dl::image::DL_IMAGE_PIX_TYPE_RGB888));
+}
+
+void FastImagePreprocessor::preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area)
+{
+    int x1 = 0, y1 = 0, x2 = img.width, y2 = img.height;
+    if (crop_area.size() == 4) {
+        x1 = DL_CLIP(crop_area[0], 0, img.width - 1);
+        y1 = DL_CLIP(crop_area[1], 0, img.height - 1);
+        x2 = DL_CLIP(crop_area[2], x1 + 1, img.width);
+        y2 = DL_CLIP(crop_area[3], y1 + 1, img.height);
+    }
+    int src_w = x2 - x1;
+    int src_h = y2 - y1;
+    bool rgb565 = img.pix_type == dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+    int bpp = rgb565 ? 2 : 3;
+
+    m_resize_scale_x = (float)m_width / src_w;
+    m_resize_scale_y = (float)m_height / src_h;
+    m_top_left_x = x1;
+    m_top_left_y = y1;
+
+    // Integer source coordinates, no float math in the pixel loop
+    for (int x = 0; x < m_width; x++) {
+        m_col_offset[x] = (x1 + x * src_w / m_width) * bpp;
+    }
+
+    const uint8_t *src = (const uint8_t *)img.data;
+    int8_t *dst = (int8_t *)m_input->data;
+    for (int y = 0; y < m_height; y++) {
+        const uint8_t *row = src + (size_t)(y1 + y * src_h / m_height) * img.width * bpp;
+        if (rgb565) {
+            for (int x = 0; x < m_width; x++, dst += 3) {
+                const uint8_t *px = row + m_col_offset[x];
+                uint32_t v = m_rgb565_big_endian ? ((px[0] << 8) | px[1]) : (px[0] | (px[1] << 8));
+                dst[m_first] = m_lut565[0][v >> 11];
+                dst[1] = m_lut565[1][(v >> 5) & 0x3f];
+                dst[m_last] = m_lut565[2][v & 0x1f];
+            }
+        } else {
+            for (int x = 0; x < m_width; x++, dst += 3) {
+                const uint8_t *px = row + m_col_offset[x];
+                dst[m_first] = m_lut888[0][px[0]];
+                dst[1] = m_lut888[1][px[1]];
+                dst[m_last] = m_lut888[2][px[2]];
+            }
+        }
+    }
+}
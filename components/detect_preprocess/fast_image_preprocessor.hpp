@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "dl_model_base.hpp"
+#include "dl_image_define.hpp"
+
+/**
+ * @brief Drop-in replacement of dl::image::ImagePreprocessor for int8 models and RGB565 / RGB888 images.
+ *
+ * Crop, nearest neighbour resize, color conversion, normalization and quantization happen in a single pass
+ * over the model input. Normalization and quantization are folded into one lookup table per channel built
+ * from the input exponent, so each output value costs one table lookup instead of a float conversion.
+ */
+class FastImagePreprocessor {
+public:
+    /**
+     * @param model Model to fill the input of.
+     * @param mean Per channel mean, in model channel order.
+     * @param std Per channel standard deviation, in model channel order.
+     * @param caps DL_IMAGE_CAP_RGB_SWAP and DL_IMAGE_CAP_RGB565_BIG_ENDIAN, as for dl::image::ImagePreprocessor.
+     * @param input_name Input to fill, the first one if empty.
+     */
+    FastImagePreprocessor(dl::Model *model,
+                          const std::vector<float> &mean,
+                          const std::vector<float> &std,
+                          uint32_t caps = 0,
+                          const std::string &input_name = "");
+    ~FastImagePreprocessor();
+
+    /**
+     * @brief Whether `preprocess` handles this image, the caller falls back to dl::image::ImagePreprocessor otherwise.
+     */
+    bool is_supported(const dl::image::img_t &img) const;
+
+    /**
+     * @brief Fill the model input from an image.
+     *
+     * @param img RGB565 or RGB888 image.
+     * @param crop_area Optional x1, y1, x2, y2 region of `img`, clamped to the image.
+     */
+    void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area = {});
+
+    float get_resize_scale_x(bool inv = false) const { return inv ? 1.f / m_resize_scale_x : m_resize_scale_x; }
+    float get_resize_scale_y(bool inv = false) const { return inv ? 1.f / m_resize_scale_y : m_resize_scale_y; }
+    float get_top_left_x() const { return m_top_left_x; }
+    float get_top_left_y() const { return m_top_left_y; }
+
+private:
+    void build_lut(int8_t *lut, int bits, int channel, const std::vector<float> &mean, const std::vector<float> &std);
+
+    dl::TensorBase *m_input;
+    int m_width;
+    int m_height;
+    bool m_supported;
+    bool m_rgb565_big_endian;
+    // Output position of the first / last color of a pixel, swapped by DL_IMAGE_CAP_RGB_SWAP
+    int m_first;
+    int m_last;
+    // Quantized value of each RGB565 field and of each RGB888 byte, per output position
+    int8_t m_lut565[3][64];
+    int8_t m_lut888[3][256];
+    // Byte offset of the source column of each output column
+    uint32_t *m_col_offset;
+    float m_resize_scale_x;
+    float m_resize_scale_y;
+    float m_top_left_x;
+    float m_top_left_y;
+};
@@ -59,6 +59,46 @@
 #define ESP_BROOKESIA_LOG_ENABLE_DEBUG_PHONE_PHONE         (1)
 #endif
 
+/**
+ * Defer the output of debug, info and warning logs. 0: disable, 1: enable
+ *
+ * The log macros only store the address of their call site and their raw arguments in a ring of
+ * `ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM` records (power of 2), a task of priority
+ * `ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY` formats and prints them. The strings of `%s` arguments are copied into
+ * `ESP_BROOKESIA_LOG_DEFERRED_STR_LEN` bytes per record. Errors are printed at once.
+ *
+ */
+#define ESP_BROOKESIA_LOG_DEFERRED_ENABLE          (0)
+#define ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM      (64)
+#define ESP_BROOKESIA_LOG_DEFERRED_STR_LEN         (32)
+#define ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY   (1)
+
+/**
+ * Record the duration of the boot phases opened with `esp_brookesia_core_boot_profile_begin()`. 0: disable, 1: enable
+ *
+ * At most `ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM` spans are kept. The summary warns when the boot takes longer than
+ * `ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS` (0: no budget).
+ *
+ */
+#define ESP_BROOKESIA_BOOT_PROFILE_ENABLE      (0)
+#define ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM    (48)
+#define ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS   (0)
+
+/**
+ * Measure the rendering of the core display and show it in an overlay on the system layer. 0: disable, 1: enable
+ *
+ * Every `ESP_BROOKESIA_PERF_HUD_PERIOD_MS` the overlay shows the frame rate, the refresh and flush times, the drawn
+ * area and the `ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM` busiest LVGL timers. Pressing the top left corner of the screen
+ * for `ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS` (0: no gesture) shows or hides it.
+ *
+ */
+#define ESP_BROOKESIA_PERF_HUD_ENABLE           (0)
+#define ESP_BROOKESIA_PERF_HUD_SHOW_AT_START    (0)
+#define ESP_BROOKESIA_PERF_HUD_PERIOD_MS        (1000)
+#define ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM    (3)
+#define ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS  (2000)
+#define ESP_BROOKESIA_PERF_HUD_LOG              (0)
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////// Memory /////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -72,6 +112,93 @@
 #define ESP_BROOKESIA_MEMORY_MALLOC(x)     heap_caps_aligned_alloc(1, x, MALLOC_CAP_SPIRAM)
 #define ESP_BROOKESIA_MEMORY_FREE          free
 #endif
+/**
+ * Memory of the app snapshot pool. 0: same as above, 1: PSRAM, 2: internal RAM (uses `heap_caps_malloc()`)
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_APP_SNAPSHOT  (0)
+/**
+ * Allocate the LVGL objects created while an app records its resources from the memory preferred in its
+ * `ESP_Brookesia_CoreAppData_t`. Needs `lv_mem_alloc()` to be wrapped at link time (`-Wl,--wrap=lv_mem_alloc`), which
+ * the component does with ESP-IDF. 0: disable
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_APP_CAPS      (0)
+/**
+ * Internal RAM pool in KB for the LVGL allocations below `ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE` bytes, the bigger ones
+ * go to PSRAM. Needs `lv_mem_alloc()`, `lv_mem_free()` and `lv_mem_realloc()` to be wrapped at link time, which the
+ * component does with ESP-IDF. 0: disable
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_LV_POOL_KB    (0)
+#define ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE (256)
+/**
+ * Free heap in KB below which the core asks the running apps to trim memory, and closes paused apps if that doesn't
+ * release enough. 0: disable. The free heap is checked every `ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS` and before
+ * starting an app
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB  (0)
+#define ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS   (1000)
+/**
+ * Memory in KB for the launcher and recents screen icons pre-scaled to their stylesheet size, so they are drawn
+ * without zoom. The cache is in PSRAM if it is enabled. 0: disable, icons are zoomed when drawn
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB    (0)
+/**
+ * Render each app snapshot once at its size in the recents screen with the rounded corners baked in, so moving the
+ * snapshots draws plain images. Scaled by the PPA on chips that have one. 0: disable, snapshots are zoomed and
+ * clipped when drawn
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD    (0)
+/**
+ * Memory in KB of internal RAM for the glyphs of the default fonts, expanded to 8 bpp masks the first time they are
+ * drawn so text is blended from fast memory. 0: disable, glyphs are drawn from the font bitmaps
+ *
+ */
+#define ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB    (0)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////// App //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Idle time in ms of the touch screen after which the apps installed with lazy init are initialized in advance, one
+ * per check, the most started one first (see `ESP_Brookesia_CoreManager::setAppLaunchCount()`). 0: only initialize
+ * them on their first launch
+ *
+ */
+#define ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS  (0)
+
+/**
+ * Press time in ms on a launcher icon after which the app installed with lazy init is initialized before the press is
+ * released. 0: only initialize it on its launch
+ *
+ */
+#define ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS    (0)
+
+/**
+ * Largest state in bytes an app can keep across closes and restarts with `saveState()` and `restoreState()`, see
+ * `esp_brookesia_core_app_state_set_storage()` for the flash storage. 0: disable
+ *
+ */
+#define ESP_BROOKESIA_APP_STATE_SIZE_MAX    (0)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////// Gesture ////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * Number of the latest touch samples used to estimate the velocity of a gesture (least-squares fit), 2 ~ 16
+ *
+ */
+#define ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM  (6)
+/**
+ * Time in ms the touch point given to drag-following widgets is extrapolated ahead with the estimated velocity, to
+ * make up for the latency of the touch controller. 0: disable
+ *
+ */
+#define ESP_BROOKESIA_GESTURE_PREDICT_MS           (0)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////// Squareline ////////////////////////////////////////////////////////
@@ -5,6 +5,9 @@
  */
 #include "esp_timer.h"
 #include "lvgl_port_v8.h"
+#if LVGL_PORT_PPA_ROTATION
+#include "driver/ppa.h"
+#endif
 
 #define LVGL_PORT_ENABLE_ROTATION_OPTIMIZED     (1)
 #define LVGL_PORT_BUFFER_NUM_MAX       (2)
@@ -168,31 +171,37 @@ IRAM_ATTR static inline void rotate_copy_pixel(
     int max_width = 0;
     int start_y = 0;
     uint16_t *from_next = NULL;
+    bool is_full_screen = (x_start == 0) && (y_start == 0) && (x_end == w - 1) && (y_end == h - 1);
 #endif
 
     uint32_t time = esp_log_timestamp();
     switch (rotate) {
     case 90:
 #if (LV_COLOR_DEPTH == 16) && LVGL_PORT_ENABLE_ROTATION_OPTIMIZED
-        ROTATE_90_OPTIMIZED_16BPP(32, 256);
-#else
-        ROTATE_90_ALL_BPP();
+        // The optimized transpose always covers the whole screen
+        if (is_full_screen) {
+            ROTATE_90_OPTIMIZED_16BPP(32, 256);
+            break;
+        }
 #endif
+        ROTATE_90_ALL_BPP();
         break;
     case 180:
         ROTATE_180_ALL_BPP();
         break;
     case 270:
 #if (LV_COLOR_DEPTH == 16) && LVGL_PORT_ENABLE_ROTATION_OPTIMIZED
-        ROTATE_270_OPTIMIZED_16BPP(32, 256);
-#else
-        ROTATE_270_ALL_BPP();
+        if (is_full_screen) {
+            ROTATE_270_OPTIMIZED_16BPP(32, 256);
+            break;
+        }
 #endif
+        ROTATE_270_ALL_BPP();
         break;
     default:
         break;
     }
-    ESP_LOGI(TAG, "rotate: end, time used:%d", (int)(esp_log_timestamp() - time));
+    ESP_LOGD(TAG, "rotate: end, time used:%d", (int)(esp_log_timestamp() - time));
 }
 #endif /* LVGL_PORT_ROTATION_DEGREE */
 
@@ -205,7 +214,8 @@ typedef struct {
     lv_area_t inv_areas[LV_INV_BUF_SIZE];
 } lv_port_dirty_area_t;
 
-static lv_port_dirty_area_t dirty_area;
+/* Areas of the last frame, they are only present in the frame buffer that is on screen now */
+static lv_port_dirty_area_t last_dirty_area;
 
 static void flush_dirty_save(lv_port_dirty_area_t *dirty_area)
 {
@@ -217,59 +227,93 @@ static void flush_dirty_save(lv_port_dirty_area_t *dirty_area)
     }
 }
 
-typedef enum {
-    FLUSH_STATUS_PART,
-    FLUSH_STATUS_FULL
-} lv_port_flush_status_t;
+static inline void *flush_get_next_buf(ESP_PanelLcd *lcd)
+{
+    return get_next_frame_buffer(lcd);
+}
 
-typedef enum {
-    FLUSH_PROBE_PART_COPY,
-    FLUSH_PROBE_SKIP_COPY,
-    FLUSH_PROBE_FULL_COPY,
-} lv_port_flush_probe_t;
+#if LVGL_PORT_PPA_ROTATION
+static ppa_client_handle_t ppa_srm_handle = NULL;
 
 /**
- * @brief Probe dirty area to copy
- *
- * @note This function is used to avoid tearing effect, and only work with LVGL direct-mode.
+ * @brief Rotate one area with the PPA, the position of the area in the rotated frame follows `rotate_copy_pixel()`
  *
  */
-static lv_port_flush_probe_t flush_copy_probe(lv_disp_drv_t *drv)
+static bool ppa_rotate_copy_area(const void *src, void *dst, const lv_area_t *area, uint16_t w, uint16_t h)
 {
-    static lv_port_flush_status_t prev_status = FLUSH_STATUS_PART;
-    lv_port_flush_status_t cur_status;
-    lv_port_flush_probe_t probe_result;
-    lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing();
-
-    uint32_t flush_ver = 0;
-    uint32_t flush_hor = 0;
-    for (int i = 0; i < disp_refr->inv_p; i++) {
-        if (disp_refr->inv_area_joined[i] == 0) {
-            flush_ver = (disp_refr->inv_areas[i].y2 + 1 - disp_refr->inv_areas[i].y1);
-            flush_hor = (disp_refr->inv_areas[i].x2 + 1 - disp_refr->inv_areas[i].x1);
-            break;
-        }
-    }
-    /* Check if the current full screen refreshes */
-    cur_status = ((flush_ver == drv->ver_res) && (flush_hor == drv->hor_res)) ? (FLUSH_STATUS_FULL) : (FLUSH_STATUS_PART);
-
-    if (prev_status == FLUSH_STATUS_FULL) {
-        if ((cur_status == FLUSH_STATUS_PART)) {
-            probe_result = FLUSH_PROBE_FULL_COPY;
-        } else {
-            probe_result = FLUSH_PROBE_SKIP_COPY;
+    if (ppa_srm_handle == NULL) {
+        ppa_client_config_t client_config = {
+            .oper_type = PPA_OPERATION_SRM,
+            .max_pending_trans_num = 1,
+        };
+        if (ppa_register_client(&client_config, &ppa_srm_handle) != ESP_OK) {
+            ESP_LOGW(TAG, "Register PPA client failed, rotate with CPU");
+            return false;
         }
-    } else {
-        probe_result = FLUSH_PROBE_PART_COPY;
     }
-    prev_status = cur_status;
 
-    return probe_result;
+    uint32_t block_w = area->x2 - area->x1 + 1;
+    uint32_t block_h = area->y2 - area->y1 + 1;
+#if LVGL_PORT_ROTATION_DEGREE == 90
+    uint32_t out_w = h, out_h = w;
+    uint32_t out_x = area->y1, out_y = w - 1 - area->x2;
+    ppa_srm_rotation_angle_t angle = PPA_SRM_ROTATION_ANGLE_90;
+#elif LVGL_PORT_ROTATION_DEGREE == 180
+    uint32_t out_w = w, out_h = h;
+    uint32_t out_x = w - 1 - area->x2, out_y = h - 1 - area->y2;
+    ppa_srm_rotation_angle_t angle = PPA_SRM_ROTATION_ANGLE_180;
+#else
+    uint32_t out_w = h, out_h = w;
+    uint32_t out_x = h - 1 - area->y2, out_y = area->x1;
+    ppa_srm_rotation_angle_t angle = PPA_SRM_ROTATION_ANGLE_270;
+#endif
+    ppa_srm_oper_config_t srm_config = {};
+    srm_config.in.buffer = src;
+    srm_config.in.pic_w = w;
+    srm_config.in.pic_h = h;
+    srm_config.in.block_w = block_w;
+    srm_config.in.block_h = block_h;
+    srm_config.in.block_offset_x = area->x1;
+    srm_config.in.block_offset_y = area->y1;
+    srm_config.in.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.out.buffer = dst;
+    srm_config.out.buffer_size = (uint32_t)w * h * sizeof(lv_color_t);
+    srm_config.out.pic_w = out_w;
+    srm_config.out.pic_h = out_h;
+    srm_config.out.block_offset_x = out_x;
+    srm_config.out.block_offset_y = out_y;
+    srm_config.out.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+    srm_config.rotation_angle = angle;
+    srm_config.scale_x = 1;
+    srm_config.scale_y = 1;
+    srm_config.mode = PPA_TRANS_MODE_BLOCKING;
+
+    return ppa_do_scale_rotate_mirror(ppa_srm_handle, &srm_config) == ESP_OK;
 }
+#endif /* LVGL_PORT_PPA_ROTATION */
 
-static inline void *flush_get_next_buf(ESP_PanelLcd *lcd)
+static void rotate_copy_area(const void *src, void *dst, const lv_area_t *area)
 {
-    return get_next_frame_buffer(lcd);
+#if LVGL_PORT_PPA_ROTATION
+    if (ppa_rotate_copy_area(src, dst, area, LV_HOR_RES, LV_VER_RES)) {
+        return;
+    }
+#endif
+    rotate_copy_pixel(
+        (const uint8_t *)src, (uint8_t *)dst, area->x1, area->y1, area->x2, area->y2, LV_HOR_RES, LV_VER_RES,
+        LVGL_PORT_ROTATION_DEGREE
+    );
+}
+
+static bool flush_dirty_contains(const lv_port_dirty_area_t *dirty_area, const lv_area_t *area)
+{
+    for (int i = 0; i < dirty_area->inv_p; i++) {
+        if ((dirty_area->inv_area_joined[i] == 0) && _lv_area_is_in(area, &dirty_area->inv_areas[i], 0)) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /**
@@ -277,26 +321,27 @@ static inline void *flush_get_next_buf(ESP_PanelLcd *lcd)
  *
  * @note This function is used to avoid tearing effect, and only work with LVGL direct-mode.
  *
+ * @param skip Areas that are inside one of these are not copied, can be NULL
+ *
  */
-static void flush_dirty_copy(void *dst, void *src, lv_port_dirty_area_t *dirty_area)
+static void flush_dirty_copy(void *dst, void *src, const lv_port_dirty_area_t *dirty_area,
+                             const lv_port_dirty_area_t *skip)
 {
-    lv_coord_t x_start, x_end, y_start, y_end;
     for (int i = 0; i < dirty_area->inv_p; i++) {
         /* Refresh the unjoined areas*/
-        if (dirty_area->inv_area_joined[i] == 0) {
-            x_start = dirty_area->inv_areas[i].x1;
-            x_end = dirty_area->inv_areas[i].x2;
-            y_start = dirty_area->inv_areas[i].y1;
-            y_end = dirty_area->inv_areas[i].y2;
-
-            rotate_copy_pixel(
-                (uint8_t *)src, (uint8_t *)dst, x_start, y_start, x_end, y_end, LV_HOR_RES, LV_VER_RES,
-                LVGL_PORT_ROTATION_DEGREE
-            );
+        if ((dirty_area->inv_area_joined[i] == 0) &&
+                ((skip == NULL) || !flush_dirty_contains(skip, &dirty_area->inv_areas[i]))) {
+            rotate_copy_area(src, dst, &dirty_area->inv_areas[i]);
         }
     }
 }
 
+/**
+ * LVGL renders the whole frame unrotated in its own buffer (direct-mode). Only the changed areas are rotated into the
+ * frame buffer that is not on screen: the areas of this frame, and the areas of the last frame, which were only
+ * written to the other frame buffer. So a small change never costs a full screen rotation.
+ *
+ */
 static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
     ESP_PanelLcd *lcd = (ESP_PanelLcd *)drv->user_data;
@@ -304,70 +349,26 @@ static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     const int offsetx2 = area->x2;
     const int offsety1 = area->y1;
     const int offsety2 = area->y2;
+    lv_port_dirty_area_t cur_dirty_area;
     void *next_fb = NULL;
-    lv_port_flush_probe_t probe_result = FLUSH_PROBE_PART_COPY;
-    lv_disp_t *disp = lv_disp_get_default();
 
     /* Action after last area refresh */
     if (lv_disp_flush_is_last(drv)) {
-        /* Check if the `full_refresh` flag has been triggered */
-        if (drv->full_refresh) {
-            /* Reset flag */
-            drv->full_refresh = 0;
-
-            // Rotate and copy data from the whole screen LVGL's buffer to the next frame buffer
-            next_fb = flush_get_next_buf(lcd);
-            rotate_copy_pixel(
-                (uint8_t *)color_map, (uint8_t *)next_fb, offsetx1, offsety1, offsetx2, offsety2,
-                LV_HOR_RES, LV_VER_RES, LVGL_PORT_ROTATION_DEGREE
-            );
-
-            /* Switch the current LCD frame buffer to `next_fb` */
-            lcd->drawBitmap(offsetx1, offsety1, offsetx2 - offsetx1 + 1, offsety2 - offsety1 + 1, (const uint8_t *)next_fb);
-
-            /* Waiting for the current frame buffer to complete transmission */
-            ulTaskNotifyValueClear(NULL, ULONG_MAX);
-            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-            /* Synchronously update the dirty area for another frame buffer */
-            flush_dirty_copy(flush_get_next_buf(lcd), color_map, &dirty_area);
-            flush_get_next_buf(lcd);
-        } else {
-            /* Probe the copy method for the current dirty area */
-            probe_result = flush_copy_probe(drv);
-
-            if (probe_result == FLUSH_PROBE_FULL_COPY) {
-                /* Save current dirty area for next frame buffer */
-                flush_dirty_save(&dirty_area);
-
-                /* Set LVGL full-refresh flag and set flush ready in advance */
-                drv->full_refresh = 1;
-                disp->rendering_in_progress = false;
-                lv_disp_flush_ready(drv);
-
-                /* Force to refresh whole screen, and will invoke `flush_callback` recursively */
-                lv_refr_now(_lv_refr_get_disp_refreshing());
-            } else {
-                /* Update current dirty area for next frame buffer */
-                next_fb = flush_get_next_buf(lcd);
-                flush_dirty_save(&dirty_area);
-                flush_dirty_copy(next_fb, color_map, &dirty_area);
-
-                /* Switch the current LCD frame buffer to `next_fb` */
-                lcd->drawBitmap(offsetx1, offsety1, offsetx2 - offsetx1 + 1, offsety2 - offsety1 + 1, (const uint8_t *)next_fb);
-
-                /* Waiting for the current frame buffer to complete transmission */
-                ulTaskNotifyValueClear(NULL, ULONG_MAX);
-                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-                if (probe_result == FLUSH_PROBE_PART_COPY) {
-                    /* Synchronously update the dirty area for another frame buffer */
-                    flush_dirty_save(&dirty_area);
-                    flush_dirty_copy(flush_get_next_buf(lcd), color_map, &dirty_area);
-                    flush_get_next_buf(lcd);
-                }
-            }
-        }
+        flush_dirty_save(&cur_dirty_area);
+
+        /* Bring the back frame buffer up to date with the last frame, then add the areas of this one */
+        next_fb = flush_get_next_buf(lcd);
+        flush_dirty_copy(next_fb, color_map, &last_dirty_area, &cur_dirty_area);
+        flush_dirty_copy(next_fb, color_map, &cur_dirty_area, NULL);
+
+        /* Switch the current LCD frame buffer to `next_fb` */
+        lcd->drawBitmap(offsetx1, offsety1, offsetx2 - offsetx1 + 1, offsety2 - offsety1 + 1, (const uint8_t *)next_fb);
+
+        /* Waiting for the current frame buffer to complete transmission */
+        ulTaskNotifyValueClear(NULL, ULONG_MAX);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        last_dirty_area = cur_dirty_area;
     }
 
     lv_disp_flush_ready(drv);
@@ -8,6 +8,8 @@
 #include <Arduino.h>
 #include <ESP_Panel_Library.h>
 #include <lvgl.h>
+#include "esp_idf_version.h"
+#include "soc/soc_caps.h"
 
 // *INDENT-OFF*
 
@@ -129,6 +131,22 @@
 #endif
 #endif /* LVGL_PORT_AVOID_TEARING_MODE */
 
+/**
+ * With avoid tearing direct-mode and a rotation degree, only the dirty areas are rotated into the frame buffers. On SoCs
+ * with a PPA (ESP32-P4, ESP-IDF >= v5.3) and RGB565 colors they are rotated by the PPA instead of the CPU.
+ *
+ * Set to 0 to always rotate with the CPU.
+ *
+ */
+#ifndef LVGL_PORT_PPA_ROTATION
+    #if defined(LVGL_PORT_ROTATION_DEGREE) && (LVGL_PORT_ROTATION_DEGREE != 0) && (LV_COLOR_DEPTH == 16) && \
+        SOC_PPA_SUPPORTED && (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
+        #define LVGL_PORT_PPA_ROTATION          (1)
+    #else
+        #define LVGL_PORT_PPA_ROTATION          (0)
+    #endif
+#endif
+
 // *INDENT-OFF*
 
 #ifdef __cplusplus
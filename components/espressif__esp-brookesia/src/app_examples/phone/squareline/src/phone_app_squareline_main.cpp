@@ -9,18 +9,81 @@
 #include "phone_app_squareline_main.h"
 #include "phone_app_squareline.hpp"
 
+// Screens left are deleted once hidden while the free heap is below this
+#define SCREEN_RELEASE_FREE_HEAP_SIZE   (256 * 1024)
+
 static PhoneAppSquareline *phone_app_squareline = nullptr;
 
+static bool is_screen_child(lv_obj_t *obj, lv_obj_t *screen)
+{
+    while ((obj != nullptr) && (obj != screen)) {
+        obj = lv_obj_get_parent(obj);
+    }
+
+    return obj == screen;
+}
+
+static void release_screen(lv_obj_t **target)
+{
+    lv_obj_t *screen = *target;
+
+    // Animations with a custom callback are not bound to their object, so they are not deleted with the screen
+    lv_anim_t *anim = (lv_anim_t *)_lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
+    while (anim != nullptr) {
+        lv_anim_t *anim_next = (lv_anim_t *)_lv_ll_get_next(&LV_GC_ROOT(_lv_anim_ll), anim);
+        lv_anim_custom_exec_cb_t exec_cb = (lv_anim_custom_exec_cb_t)anim->exec_cb;
+        if ((anim->var == anim) && ((exec_cb == _ui_anim_callback_set_y) || (exec_cb == _ui_anim_callback_set_opacity) ||
+                                    (exec_cb == _ui_anim_callback_set_image_angle)) &&
+                is_screen_child(((ui_anim_user_data_t *)anim->user_data)->target, screen)) {
+            lv_anim_del(anim, anim->exec_cb);
+        }
+        anim = anim_next;
+    }
+
+    ESP_BROOKESIA_LOGD("Release screen(@0x%p)", screen);
+    *target = nullptr;
+    lv_obj_del(screen);
+}
+
+static void on_screen_unloaded_event_cb(lv_event_t *e)
+{
+    if (esp_brookesia_core_utils_get_free_heap_size() < SCREEN_RELEASE_FREE_HEAP_SIZE) {
+        release_screen((lv_obj_t **)lv_event_get_user_data(e));
+    }
+}
+
+static void on_splash_unloaded_event_cb(lv_event_t *e)
+{
+    // Never shown again
+    release_screen((lv_obj_t **)lv_event_get_user_data(e));
+}
+
 bool phone_app_squareline_main_init(PhoneAppSquareline *app)
 {
     ESP_BROOKESIA_CHECK_NULL_RETURN(app, false, "App is null");
     phone_app_squareline = app;
 
+    // Only the splash screen is created here, the others on their first navigation
     phone_app_squareline_ui_init();
+    lv_obj_add_event_cb(ui_SmartGadgetSplash, on_splash_unloaded_event_cb, LV_EVENT_SCREEN_UNLOADED,
+                        &ui_SmartGadgetSplash);
 
     return true;
 }
 
+void phone_app_squareline_screen_change(lv_obj_t **target, lv_scr_load_anim_t fademode, int spd, int delay,
+                                        void (*target_init)(void))
+{
+    if (*target == nullptr) {
+        // Recorded like the screens created in `run()`, so the core resizes them and deletes them with the app
+        assert(phone_app_squareline->startRecordResource());
+        target_init();
+        assert(phone_app_squareline->endRecordResource());
+        lv_obj_add_event_cb(*target, on_screen_unloaded_event_cb, LV_EVENT_SCREEN_UNLOADED, target);
+    }
+    lv_scr_load_anim(*target, fademode, spd, delay, false);
+}
+
 /**
  * The following functions are generated by Squareline and records resources before and after creating animations,
  * allowing for automatic cleanup of animation resources when the app exits. This prevents errors that may occur when
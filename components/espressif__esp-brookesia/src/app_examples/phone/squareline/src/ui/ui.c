@@ -6,10 +6,10 @@
 // esp-brookesia: changed
 #include "ui.h"
 
-// esp-brookesia: changed
-#if !defined(ESP_BROOKESIA_SQ1_4_1_LV8_3_11)
-    #define _ui_screen_change(target, fademode, spd, delay, target_init) lv_scr_load_anim(*target, fademode, spd, delay, false)
-#endif
+// esp-brookesia: changed, screens other than the splash are created on first navigation
+#undef _ui_screen_change
+#define _ui_screen_change(target, fademode, spd, delay, target_init) \
+    phone_app_squareline_screen_change(target, fademode, spd, delay, target_init)
 
 ///////////////////// VARIABLES ////////////////////
 void upanim_Animation(lv_obj_t * TargetObject, int delay);
@@ -296,12 +296,13 @@ void phone_app_squareline_ui_init(void)
     lv_disp_t * dispp = lv_disp_get_default();
     lv_theme_t * theme = lv_theme_basic_init(dispp);
     lv_disp_set_theme(dispp, theme);
+    // The screens of a previous run were deleted with the app
+    ui_SmartGadgetClock = NULL;
+    ui_SmartGadgetCall = NULL;
+    ui_SmartGadgetChat = NULL;
+    ui_SmartGadgetMusicPlayer = NULL;
+    ui_SmartGadgetWeather = NULL;
+    ui_SmartGadgetAlarm = NULL;
     ui_SmartGadgetSplash_screen_init();
-    ui_SmartGadgetClock_screen_init();
-    ui_SmartGadgetCall_screen_init();
-    ui_SmartGadgetChat_screen_init();
-    ui_SmartGadgetMusicPlayer_screen_init();
-    ui_SmartGadgetWeather_screen_init();
-    ui_SmartGadgetAlarm_screen_init();
     lv_disp_load_scr(ui_SmartGadgetSplash);
 }
@@ -150,6 +150,8 @@ LV_FONT_DECLARE(ui_font_Number);
 
 // esp-brookesia: changed
 void phone_app_squareline_ui_init(void);
+void phone_app_squareline_screen_change(lv_obj_t ** target, lv_scr_load_anim_t fademode, int spd, int delay,
+                                        void (*target_init)(void));
 
 #ifdef __cplusplus
 } /*extern "C"*/
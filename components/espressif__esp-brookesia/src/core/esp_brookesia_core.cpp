@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "esp_brookesia_versions.h"
+#include "esp_brookesia_core_boot_profile.h"
+#include "esp_brookesia_core_perf_hud.h"
+#include "esp_brookesia_core_log.h"
 #include "esp_brookesia_core.hpp"
 
 #if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE_CORE
@@ -11,8 +14,13 @@
 #define ESP_BROOKESIA_LOGD(...)
 #endif
 
+#define UI_QUEUE_DRAIN_PERIOD_MS    (10)
+#define UI_QUEUE_DRAIN_PERIOD_OFF_MS    (100)   /* Nothing is shown while the display is off */
+
 using namespace std;
 
+const uint8_t ESP_Brookesia_Core::_theme_update_event_param = 0;
+
 ESP_Brookesia_Core::ESP_Brookesia_Core(const ESP_Brookesia_CoreData_t &data, ESP_Brookesia_CoreHome &home, ESP_Brookesia_CoreManager &manager,
                                        lv_disp_t *display):
     _core_data(data),
@@ -26,6 +34,10 @@ ESP_Brookesia_Core::ESP_Brookesia_Core(const ESP_Brookesia_CoreData_t &data, ESP
     _data_update_event_code(_LV_EVENT_LAST),
     _navigate_event_code(_LV_EVENT_LAST),
     _app_event_code(_LV_EVENT_LAST),
+    _display_state_event_code(_LV_EVENT_LAST),
+    _ui_queue(),
+    _ui_queue_timer(nullptr),
+    _display_state(ESP_BROOKESIA_CORE_DISPLAY_STATE_ON),
     _lv_lock_callback(nullptr),
     _lv_unlock_callback(nullptr)
 {
@@ -98,6 +110,17 @@ bool ESP_Brookesia_Core::sendDataUpdateEvent(void *param) const
     return true;
 }
 
+bool ESP_Brookesia_Core::sendThemeUpdateEvent(void) const
+{
+    // Only the colors and images of the data changed, the widgets restyle their objects without relayout
+    return sendDataUpdateEvent((void *)&_theme_update_event_param);
+}
+
+bool ESP_Brookesia_Core::checkThemeUpdateEvent(lv_event_t *event)
+{
+    return (event != nullptr) && (lv_event_get_param(event) == (void *)&_theme_update_event_param);
+}
+
 bool ESP_Brookesia_Core::registerNavigateEventCallback(lv_event_cb_t callback, void *user_data) const
 {
     ESP_BROOKESIA_CHECK_NULL_RETURN(callback, false, "Invalid callback function");
@@ -160,6 +183,82 @@ bool ESP_Brookesia_Core::sendAppEvent(const ESP_Brookesia_CoreAppEventData_t *da
     return true;
 }
 
+bool ESP_Brookesia_Core::registerDisplayStateEventCallback(lv_event_cb_t callback, void *user_data) const
+{
+    ESP_BROOKESIA_CHECK_NULL_RETURN(callback, false, "Invalid callback function");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkCoreInitialized(), false, "Core is not initialized");
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(lv_obj_add_event_cb(_event_obj.get(), callback, _display_state_event_code, user_data),
+                                    false, "Add display state event callback failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_Core::unregisterDisplayStateEventCallback(lv_event_cb_t callback, void *user_data) const
+{
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkCoreInitialized(), false, "Core is not initialized");
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(lv_obj_remove_event_cb_with_user_data(_event_obj.get(), callback, user_data), false,
+                                     "Remove display state event callback failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_Core::setDisplayState(ESP_Brookesia_CoreDisplayState_t state)
+{
+    lv_disp_t *display = (_display != nullptr) ? _display : lv_disp_get_default();
+    lv_timer_t *anim_timer = lv_anim_get_timer();
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkCoreInitialized(), false, "Core is not initialized");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(state <= ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF, false, "Invalid display state");
+
+    if (state == _display_state) {
+        return true;
+    }
+    ESP_BROOKESIA_LOGI("Display %s", (state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) ? "off" : "on");
+    _display_state = state;
+
+    // Only rendering and animations stop, the input devices and the timers of the apps keep running. The apps stop
+    // their own visual work in `displayStateChanged()`.
+    if (state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) {
+        if ((display != nullptr) && (display->refr_timer != nullptr)) {
+            lv_timer_pause(display->refr_timer);
+        }
+        if (anim_timer != nullptr) {
+            lv_timer_pause(anim_timer);
+        }
+        lv_timer_set_period(_ui_queue_timer, UI_QUEUE_DRAIN_PERIOD_OFF_MS);
+    } else {
+        lv_timer_set_period(_ui_queue_timer, UI_QUEUE_DRAIN_PERIOD_MS);
+        if (anim_timer != nullptr) {
+            lv_timer_resume(anim_timer);
+        }
+        if ((display != nullptr) && (display->refr_timer != nullptr)) {
+            // What changed while the display was off is drawn in one go
+            lv_obj_invalidate(lv_disp_get_scr_act(display));
+            lv_obj_invalidate(lv_disp_get_layer_top(display));
+            lv_timer_resume(display->refr_timer);
+        }
+    }
+
+    _core_manager.processDisplayState(state);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(
+        lv_event_send(_event_obj.get(), _display_state_event_code, (void *)state) == LV_RES_OK, false,
+        "Send display state event failed"
+    );
+
+    return true;
+}
+
+bool ESP_Brookesia_Core::postToUi(const char *key, ESP_Brookesia_CoreUiQueue::Callback callback, const void *data,
+                                  size_t size, void *user_data)
+{
+    // Can be called from any task, so only the queue is touched here
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(_ui_queue.post(key, callback, data, size, user_data), false, "Post to UI failed");
+
+    return true;
+}
+
 void ESP_Brookesia_Core::registerLvLockCallback(ESP_Brookesia_LvLockCallback_t callback, int timeout)
 {
     _lv_lock_callback = callback;
@@ -200,6 +299,8 @@ bool ESP_Brookesia_Core::beginCore(void)
     lv_event_code_t data_update_event_code = _LV_EVENT_LAST;
     lv_event_code_t navigate_event_code = _LV_EVENT_LAST;
     lv_event_code_t app_event_code = _LV_EVENT_LAST;
+    lv_event_code_t display_state_event_code = _LV_EVENT_LAST;
+    int profile_span = esp_brookesia_core_boot_profile_begin("beginCore");
 
     ESP_BROOKESIA_LOGI("Library version: %d.%d.%d", ESP_BROOKESIA_VER_MAJOR, ESP_BROOKESIA_VER_MINOR, ESP_BROOKESIA_VER_PATCH);
     ESP_BROOKESIA_LOGD("Begin core(@0x%p)", this);
@@ -229,11 +330,22 @@ bool ESP_Brookesia_Core::beginCore(void)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(esp_brookesia_core_utils_check_event_code_valid(app_event_code), false,
                                      "Create app event code failed");
 
+    display_state_event_code = getFreeEventCode();
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(esp_brookesia_core_utils_check_event_code_valid(display_state_event_code), false,
+                                     "Create display state event code failed");
+
+    // Posts from other tasks are run by the LVGL timer handler
+    _ui_queue_timer = lv_timer_create(onUiQueueTimerCallback, UI_QUEUE_DRAIN_PERIOD_MS, this);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(_ui_queue_timer, false, "Create UI queue timer failed");
+
     // Save data
     _event_obj = event_obj;
     _data_update_event_code = data_update_event_code;
     _navigate_event_code = navigate_event_code;
     _app_event_code = app_event_code;
+    _display_state_event_code = display_state_event_code;
+    _display_state = ESP_BROOKESIA_CORE_DISPLAY_STATE_ON;
+    _ui_queue.setEnabled(true);
 
     // Initialize cores
     ESP_BROOKESIA_CHECK_FALSE_GOTO(_core_home.beginCore(), err, "Begin core home failed");
@@ -243,10 +355,23 @@ bool ESP_Brookesia_Core::beginCore(void)
 #if ESP_BROOKESIA_SQUARELINE_USE_INTERNAL_UI_COMP
     esp_brookesia_squareline_ui_comp_init();
 #endif /* ESP_BROOKESIA_SQUARELINE_USE_INTERNAL_UI_COMP */
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+    if (!esp_brookesia_core_log_begin()) {
+        ESP_BROOKESIA_LOGE("Begin deferred log failed");
+    }
+#endif
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    if (!esp_brookesia_core_perf_hud_begin(_display, _touch)) {
+        ESP_BROOKESIA_LOGE("Begin perf HUD failed");
+    }
+#endif
+
+    esp_brookesia_core_boot_profile_end(profile_span);
 
     return true;
 
 err:
+    esp_brookesia_core_boot_profile_end(profile_span);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(delCore(), false, "Delete core failed");
 
     return false;
@@ -262,6 +387,14 @@ bool ESP_Brookesia_Core::delCore(void)
         return true;
     }
 
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    esp_brookesia_core_perf_hud_end();
+#endif
+    _ui_queue.reset();
+    if (_ui_queue_timer != nullptr) {
+        lv_timer_del(_ui_queue_timer);
+        _ui_queue_timer = nullptr;
+    }
     _display = nullptr;
     _touch = nullptr;
     _free_event_code = _LV_EVENT_LAST;
@@ -269,6 +402,8 @@ bool ESP_Brookesia_Core::delCore(void)
     _data_update_event_code = _LV_EVENT_LAST;
     _navigate_event_code = _LV_EVENT_LAST;
     _app_event_code = _LV_EVENT_LAST;
+    _display_state_event_code = _LV_EVENT_LAST;
+    _display_state = ESP_BROOKESIA_CORE_DISPLAY_STATE_ON;
 
     if (!_core_home.delCore()) {
         ESP_BROOKESIA_LOGE("Delete core home failed");
@@ -312,6 +447,10 @@ void ESP_Brookesia_Core::onCoreDataUpdateEventCallback(lv_event_t *event)
     core = (ESP_Brookesia_Core *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(core, "Invalid core object");
 
+    if (checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(core->_core_home.updateThemeByNewData(), "Core home theme update failed");
+        return;
+    }
     ESP_BROOKESIA_CHECK_FALSE_EXIT(core->_core_home.updateByNewData(), "Core home update failed");
 }
 
@@ -346,3 +485,12 @@ void ESP_Brookesia_Core::onCoreNavigateEventCallback(lv_event_t *event)
         break;
     }
 }
+
+void ESP_Brookesia_Core::onUiQueueTimerCallback(lv_timer_t *timer)
+{
+    ESP_Brookesia_Core *core = (ESP_Brookesia_Core *)timer->user_data;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(core, "Invalid core");
+
+    core->_ui_queue.drain();
+}
@@ -10,6 +10,7 @@
 #include "esp_brookesia_core_home.hpp"
 #include "esp_brookesia_core_manager.hpp"
 #include "esp_brookesia_core_event.hpp"
+#include "esp_brookesia_core_ui_queue.hpp"
 #if ESP_BROOKESIA_SQUARELINE_USE_INTERNAL_UI_COMP
 #include "../squareline/ui_comp/ui_comp.h"
 #endif /* ESP_BROOKESIA_SQUARELINE_USE_INTERNAL_UI_COMP */
@@ -42,6 +43,8 @@ public:
     bool registerDateUpdateEventCallback(lv_event_cb_t callback, void *user_data) const;
     bool unregisterDateUpdateEventCallback(lv_event_cb_t callback, void *user_data) const;
     bool sendDataUpdateEvent(void *param = nullptr) const;
+    bool sendThemeUpdateEvent(void) const;
+    static bool checkThemeUpdateEvent(lv_event_t *event);
     lv_event_code_t getDataUpdateEventCode(void) const  { return _data_update_event_code; }
     // Navigate
     bool registerNavigateEventCallback(lv_event_cb_t callback, void *user_data) const;
@@ -53,6 +56,17 @@ public:
     bool unregisterAppEventCallback(lv_event_cb_t callback, void *user_data) const;
     bool sendAppEvent(const ESP_Brookesia_CoreAppEventData_t *data) const;
     lv_event_code_t getAppEventCode(void) const         { return _app_event_code; }
+    // Display state
+    bool registerDisplayStateEventCallback(lv_event_cb_t callback, void *user_data) const;
+    bool unregisterDisplayStateEventCallback(lv_event_cb_t callback, void *user_data) const;
+    lv_event_code_t getDisplayStateEventCode(void) const    { return _display_state_event_code; }
+    // Post from other tasks
+    bool postToUi(const char *key, ESP_Brookesia_CoreUiQueue::Callback callback, const void *data = nullptr,
+                  size_t size = 0, void *user_data = nullptr);
+
+    /* Display state */
+    bool setDisplayState(ESP_Brookesia_CoreDisplayState_t state);
+    ESP_Brookesia_CoreDisplayState_t getDisplayState(void) const   { return _display_state; }
 
     /* LVGL */
     void registerLvLockCallback(ESP_Brookesia_LvLockCallback_t callback, int timeout);
@@ -78,13 +92,20 @@ protected:
 private:
     static void onCoreDataUpdateEventCallback(lv_event_t *event);
     static void onCoreNavigateEventCallback(lv_event_t *event);
+    static void onUiQueueTimerCallback(lv_timer_t *timer);
 
     // Event
     uint32_t _free_event_code;
     ESP_Brookesia_LvObj_t _event_obj;
     lv_event_code_t _data_update_event_code;
+    static const uint8_t _theme_update_event_param; // Its address tags the data update events of a theme switch
     lv_event_code_t _navigate_event_code;
     lv_event_code_t _app_event_code;
+    lv_event_code_t _display_state_event_code;
+    ESP_Brookesia_CoreUiQueue _ui_queue;
+    lv_timer_t *_ui_queue_timer;
+    // Display state
+    ESP_Brookesia_CoreDisplayState_t _display_state;
 
     // LVGL
     int _lv_lock_timeout;
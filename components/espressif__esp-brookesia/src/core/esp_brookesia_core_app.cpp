@@ -12,6 +12,9 @@
 #include "misc/lv_gc.h"
 #endif
 #include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_boot_profile.h"
+#include "esp_brookesia_core_mem.h"
+#include "esp_brookesia_core_app_state.h"
 #include "esp_brookesia_core.hpp"
 #include "esp_brookesia_core_app.hpp"
 
@@ -36,6 +39,9 @@ ESP_Brookesia_CoreApp::ESP_Brookesia_CoreApp(const ESP_Brookesia_CoreAppData_t &
     _resource_anim_count(0),
     _resource_head_screen_index(0),
     _resource_screen_count(0),
+    _resource_heap_usage(0),
+    _resource_head_free_heap(0),
+    _resource_head_lv_caps(0),
     _last_screen(nullptr),
     _active_screen(nullptr),
     _resource_head_timer(nullptr),
@@ -55,6 +61,9 @@ ESP_Brookesia_CoreApp::ESP_Brookesia_CoreApp(const char *name, const void *launc
     _resource_anim_count(0),
     _resource_head_screen_index(0),
     _resource_screen_count(0),
+    _resource_heap_usage(0),
+    _resource_head_free_heap(0),
+    _resource_head_lv_caps(0),
     _last_screen(nullptr),
     _active_screen(nullptr),
     _resource_head_timer(nullptr),
@@ -96,6 +105,25 @@ void ESP_Brookesia_CoreApp::setLauncherIconImage(const ESP_Brookesia_StyleImage_
     _core_active_data.launcher_icon = icon_image;
 }
 
+bool ESP_Brookesia_CoreApp::setLazyInit(bool enable)
+{
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(!checkInitialized(), false, "Should be called before install");
+
+    _core_init_data.flags.enable_lazy_init = enable;
+
+    return true;
+}
+
+bool ESP_Brookesia_CoreApp::setMemoryPolicy(uint32_t caps, uint32_t quota_kb)
+{
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(!checkInitialized(), false, "Should be called before install");
+
+    _core_init_data.memory.caps = caps;
+    _core_init_data.memory.quota_kb = quota_kb;
+
+    return true;
+}
+
 bool ESP_Brookesia_CoreApp::startRecordResource(void)
 {
     lv_disp_t *disp = nullptr;
@@ -123,6 +151,9 @@ bool ESP_Brookesia_CoreApp::startRecordResource(void)
     _resource_head_screen_index = disp->screen_cnt - 1;
     _resource_head_timer = lv_timer_get_next(nullptr);
     _resource_head_anim = (lv_anim_t *)_lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
+    _resource_head_free_heap = esp_brookesia_core_utils_get_free_heap_size();
+    // The LVGL objects created from here on are allocated from the memory preferred by the app
+    _resource_head_lv_caps = esp_brookesia_core_mem_set_lv_caps(_core_active_data.memory.caps);
     _flags.is_resource_recording = true;
 
     return true;
@@ -145,6 +176,7 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
         ESP_BROOKESIA_LOGD("Recording resource is not started, please start first");
         return true;
     }
+    esp_brookesia_core_mem_set_lv_caps(_resource_head_lv_caps);
 
     disp = _core->getDisplayDevice();
     ESP_BROOKESIA_CHECK_NULL_RETURN(disp, false, "Invalid display");
@@ -155,10 +187,9 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
             (resource_loop_count++ <  RESOURCE_LOOP_COUNT_MAX); i++) {
         screen = (lv_obj_t *)disp->screens[i];
         // Record or update the record information of the screen
-        _resource_screens_class_parent_map[screen] = {screen->class_p, (lv_obj_t *)screen->parent};
-        if (find(_resource_screens.begin(), _resource_screens.end(), screen) == _resource_screens.end()) {
-            // Only record the newest timer
-            _resource_screens.push_back(screen);
+        if (_resource_screens_class_parent_map.insert_or_assign(
+                    screen, std::make_pair(screen->class_p, (lv_obj_t *)screen->parent)).second) {
+            // Only record the newest screen
             _resource_screen_count++;
             // Move screens to visual area when loaded only if needed
             if (_core_active_data.flags.enable_resize_visual_area) {
@@ -172,7 +203,6 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
         }
     }
     if ((_resource_head_screen_index >= (int)disp->screen_cnt) || (resource_loop_count >= RESOURCE_LOOP_COUNT_MAX)) {
-        _resource_screens.clear();
         _resource_screens_class_parent_map.clear();
         _resource_screen_count = 0;
         ret = false;
@@ -187,10 +217,9 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
     while ((timer_node != nullptr) && (timer_node != _resource_head_timer) &&
             (resource_loop_count++ < RESOURCE_LOOP_COUNT_MAX)) {
         // Record or update the record information of the timer
-        _resource_timers_cb_usr_map[timer_node] = {(lv_timer_cb_t)timer_node->timer_cb, timer_node->user_data};
-        if (find(_resource_timers.begin(), _resource_timers.end(), timer_node) == _resource_timers.end()) {
+        if (_resource_timers_cb_usr_map.insert_or_assign(
+                    timer_node, std::make_pair((lv_timer_cb_t)timer_node->timer_cb, timer_node->user_data)).second) {
             // Only record the newest timer
-            _resource_timers.push_back(timer_node);
             _resource_timer_count++;
         } else {
             ESP_BROOKESIA_LOGD("Timer(@0x%p) is already recorded", timer_node);
@@ -199,7 +228,6 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
     }
     if (((timer_node == nullptr) && (_resource_head_timer != nullptr)) ||
             (resource_loop_count >= RESOURCE_LOOP_COUNT_MAX)) {
-        _resource_timers.clear();
         _resource_timers_cb_usr_map.clear();
         _resource_timer_count = 0;
         ret = false;
@@ -212,10 +240,9 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
     anim_node = (lv_anim_t *)_lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
     while ((anim_node != nullptr) && (anim_node != _resource_head_anim)) {
         // Record or update the record information of the animation
-        _resource_anims_var_exec_map[anim_node] = {anim_node->var, anim_node->exec_cb};
-        if (find(_resource_anims.begin(), _resource_anims.end(), anim_node) == _resource_anims.end()) {
-            // Only record the newest timer
-            _resource_anims.push_back(anim_node);
+        if (_resource_anims_var_exec_map.insert_or_assign(
+                    anim_node, std::make_pair(anim_node->var, anim_node->exec_cb)).second) {
+            // Only record the newest animation
             _resource_anim_count++;
         } else {
             ESP_BROOKESIA_LOGD("Animation(@0x%p) is already recorded", anim_node);
@@ -223,7 +250,6 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
         anim_node = (lv_anim_t *)_lv_ll_get_next(&LV_GC_ROOT(_lv_anim_ll), anim_node);
     }
     if ((anim_node == nullptr) && (_resource_head_anim != nullptr)) {
-        _resource_anims.clear();
         _resource_anims_var_exec_map.clear();
         _resource_anim_count = 0;
         ESP_BROOKESIA_LOGE("record animation fail");
@@ -236,6 +262,11 @@ bool ESP_Brookesia_CoreApp::endRecordResource(void)
         disp->driver->hor_res = _display_style.w;
         disp->driver->ver_res = _display_style.h;
     }
+
+    // Heap
+    _resource_heap_usage += (int)_resource_head_free_heap - (int)esp_brookesia_core_utils_get_free_heap_size();
+    ESP_BROOKESIA_LOGD("record heap usage(%d)", _resource_heap_usage);
+
     _flags.is_resource_recording = false;
 
     return ret;
@@ -248,6 +279,8 @@ bool ESP_Brookesia_CoreApp::cleanRecordResource(void)
 
     bool ret = true;
     bool do_clean = false;
+    bool is_deleted = false;
+    uint32_t screen_count = 0;
     int resource_loop_count = 0;
     int resource_clean_count = 0;
     lv_disp_t *disp = nullptr;
@@ -261,28 +294,28 @@ bool ESP_Brookesia_CoreApp::cleanRecordResource(void)
     // Screen
     resource_loop_count = 0;
     resource_clean_count = 0;
-    for (int i = 0; (i < (int)disp->screen_cnt) && (resource_loop_count++ <  RESOURCE_LOOP_COUNT_MAX);) {
+    for (int i = 0; (i < (int)disp->screen_cnt) && !_resource_screens_class_parent_map.empty() &&
+            (resource_loop_count++ <  RESOURCE_LOOP_COUNT_MAX);) {
         do_clean = false;
+        is_deleted = false;
         screen_node = (lv_obj_t *)disp->screens[i];
-        auto screen_it = find(_resource_screens.begin(), _resource_screens.end(), screen_node);
-        if (screen_it != _resource_screens.end()) {
-            auto screen_map_it = _resource_screens_class_parent_map.find(screen_node);
-            if (screen_map_it == _resource_screens_class_parent_map.end()) {
-                ESP_BROOKESIA_LOGE("Screen class parent map not found");
+        auto screen_map_it = _resource_screens_class_parent_map.find(screen_node);
+        if (screen_map_it != _resource_screens_class_parent_map.end()) {
+            if ((screen_node->class_p == screen_map_it->second.first) &&
+                    (screen_node->parent == screen_map_it->second.second)) {
+                screen_count = disp->screen_cnt;
+                lv_obj_del(screen_node);
+                is_deleted = true;
+                // Start over only if the delete callbacks removed other screens as well
+                do_clean = (disp->screen_cnt + 1 != screen_count);
+                resource_clean_count++;
             } else {
-                if ((screen_node->class_p == screen_map_it->second.first) &&
-                        (screen_node->parent == screen_map_it->second.second)) {
-                    lv_obj_del(screen_node);
-                    do_clean = true;
-                    resource_clean_count++;
-                } else {
-                    ESP_BROOKESIA_LOGD("Screen(@0x%p) information is not matched, skip", screen_node);
-                }
-                _resource_screens.erase(screen_it);
-                _resource_screens_class_parent_map.erase(screen_map_it);
+                ESP_BROOKESIA_LOGD("Screen(@0x%p) information is not matched, skip", screen_node);
             }
+            _resource_screens_class_parent_map.erase(screen_map_it);
         }
-        i = do_clean ? 0 : i + 1;
+        // Otherwise the deleted screen is replaced by the next one at the same index
+        i = do_clean ? 0 : (is_deleted ? i : i + 1);
     }
     if (resource_loop_count >= RESOURCE_LOOP_COUNT_MAX) {
         ret = false;
@@ -295,28 +328,22 @@ bool ESP_Brookesia_CoreApp::cleanRecordResource(void)
     resource_loop_count = 0;
     resource_clean_count = 0;
     timer_node = lv_timer_get_next(nullptr);
-    while ((timer_node != nullptr) && (_resource_timers.size() > 0) &&
+    while ((timer_node != nullptr) && !_resource_timers_cb_usr_map.empty() &&
             (resource_loop_count++ < RESOURCE_LOOP_COUNT_MAX)) {
-        do_clean = false;
-        auto timer_it = find(_resource_timers.begin(), _resource_timers.end(), timer_node);
-        if (timer_it != _resource_timers.end()) {
-            auto timer_map_it = _resource_timers_cb_usr_map.find(timer_node);
-            if (timer_map_it == _resource_timers_cb_usr_map.end()) {
-                ESP_BROOKESIA_LOGE("Timer cb usr map not found");
-            } else  {
-                if ((timer_map_it->second.first == timer_node->timer_cb) &&
-                        (timer_map_it->second.second == timer_node->user_data)) {
-                    lv_timer_del(timer_node);
-                    do_clean = true;
-                    resource_clean_count++;
-                } else {
-                    ESP_BROOKESIA_LOGD("Timer(@0x%p) information is not matched, skip", timer_node);
-                }
-                _resource_timers.erase(timer_it);
-                _resource_timers_cb_usr_map.erase(timer_map_it);
+        // Deleting a timer only unlinks itself, so the next one stays valid
+        lv_timer_t *timer_next = lv_timer_get_next(timer_node);
+        auto timer_map_it = _resource_timers_cb_usr_map.find(timer_node);
+        if (timer_map_it != _resource_timers_cb_usr_map.end()) {
+            if ((timer_map_it->second.first == timer_node->timer_cb) &&
+                    (timer_map_it->second.second == timer_node->user_data)) {
+                lv_timer_del(timer_node);
+                resource_clean_count++;
+            } else {
+                ESP_BROOKESIA_LOGD("Timer(@0x%p) information is not matched, skip", timer_node);
             }
+            _resource_timers_cb_usr_map.erase(timer_map_it);
         }
-        timer_node = do_clean ? lv_timer_get_next(nullptr) : lv_timer_get_next(timer_node);
+        timer_node = timer_next;
     }
     if (resource_loop_count >= RESOURCE_LOOP_COUNT_MAX) {
         ret = false;
@@ -329,29 +356,24 @@ bool ESP_Brookesia_CoreApp::cleanRecordResource(void)
     resource_loop_count = 0;
     resource_clean_count = 0;
     anim_node = (lv_anim_t *)_lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
-    while ((anim_node != nullptr) && (_resource_anims.size() > 0) &&
+    while ((anim_node != nullptr) && !_resource_anims_var_exec_map.empty() &&
             (resource_loop_count++ < RESOURCE_LOOP_COUNT_MAX)) {
         do_clean = false;
-        auto anim_it = find(_resource_anims.begin(), _resource_anims.end(), anim_node);
-        if (anim_it != _resource_anims.end()) {
-            auto anim_map_it = _resource_anims_var_exec_map.find(anim_node);
-            if (anim_map_it == _resource_anims_var_exec_map.end()) {
-                ESP_BROOKESIA_LOGE("Animation var exec map not found");
-            } else  {
-                if ((anim_map_it->second.first == anim_node->var) &&
-                        (anim_map_it->second.second == anim_node->exec_cb)) {
-                    if (lv_anim_del(anim_node->var, anim_node->exec_cb)) {
-                        do_clean = true;
-                        resource_clean_count++;
-                    } else {
-                        ESP_BROOKESIA_LOGE("Delete animation failed");
-                    }
+        auto anim_map_it = _resource_anims_var_exec_map.find(anim_node);
+        if (anim_map_it != _resource_anims_var_exec_map.end()) {
+            if ((anim_map_it->second.first == anim_node->var) &&
+                    (anim_map_it->second.second == anim_node->exec_cb)) {
+                // This can delete other animations of the same variable, so start over afterwards
+                if (lv_anim_del(anim_node->var, anim_node->exec_cb)) {
+                    do_clean = true;
+                    resource_clean_count++;
                 } else {
-                    ESP_BROOKESIA_LOGD("Anim(@0x%p) information is not matched, skip", anim_node);
+                    ESP_BROOKESIA_LOGE("Delete animation failed");
                 }
-                _resource_anims.erase(anim_it);
-                _resource_anims_var_exec_map.erase(anim_map_it);
+            } else {
+                ESP_BROOKESIA_LOGD("Anim(@0x%p) information is not matched, skip", anim_node);
             }
+            _resource_anims_var_exec_map.erase(anim_map_it);
         }
         anim_node = do_clean ? (lv_anim_t *)_lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll)) :
                     (lv_anim_t *)_lv_ll_get_next(&LV_GC_ROOT(_lv_anim_ll), anim_node);
@@ -385,7 +407,11 @@ bool ESP_Brookesia_CoreApp::processInstall(ESP_Brookesia_Core *core, int id)
     _id = id;
 
     ESP_BROOKESIA_CHECK_FALSE_GOTO(beginExtra(), err, "Begin extra failed");
-    ESP_BROOKESIA_CHECK_FALSE_GOTO(init(), err, "Init failed");
+    if (_core_active_data.flags.enable_lazy_init) {
+        ESP_BROOKESIA_LOGD("Lazy init, init on first launch");
+    } else {
+        ESP_BROOKESIA_CHECK_FALSE_GOTO(processInit(), err, "Init failed");
+    }
 
     _status = ESP_BROOKESIA_CORE_APP_STATUS_CLOSED;
 
@@ -402,6 +428,9 @@ bool ESP_Brookesia_CoreApp::processUninstall(void)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
     ESP_BROOKESIA_LOGD("App(%s: %d) uninstall", getName(), _id);
 
+    // A lazy app that was never launched has nothing to deinit
+    bool do_deinit = _flags.is_init_done || !_core_active_data.flags.enable_lazy_init;
+
     _core = nullptr;
     _core_active_data = {};
     _status = ESP_BROOKESIA_CORE_APP_STATUS_UNINSTALLED;
@@ -421,12 +450,36 @@ bool ESP_Brookesia_CoreApp::processUninstall(void)
     // _temp_screen = nullptr;
     _resource_head_timer = nullptr;
     _resource_head_anim = nullptr;
-    _resource_screens.clear();
-    _resource_timers.clear();
-    _resource_anims.clear();
+    _resource_screens_class_parent_map.clear();
+    _resource_timers_cb_usr_map.clear();
+    _resource_anims_var_exec_map.clear();
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(delExtra(), false, "Begin extra failed");
-    ESP_BROOKESIA_CHECK_FALSE_RETURN(deinit(), false, "Deinit failed");
+    if (do_deinit) {
+        ESP_BROOKESIA_CHECK_FALSE_RETURN(deinit(), false, "Deinit failed");
+    }
+
+    return true;
+}
+
+bool ESP_Brookesia_CoreApp::processInit(void)
+{
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    if (_flags.is_init_done) {
+        return true;
+    }
+
+    ESP_BROOKESIA_LOGD("App(%s: %d) init", getName(), _id);
+
+    char profile_name[ESP_BROOKESIA_BOOT_PROFILE_NAME_LEN_MAX];
+    snprintf(profile_name, sizeof(profile_name), "init %s", getName());
+    int profile_span = esp_brookesia_core_boot_profile_begin(profile_name);
+    bool ret = init();
+    esp_brookesia_core_boot_profile_end(profile_span);
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(ret, false, "Init failed");
+    _flags.is_init_done = true;
 
     return true;
 }
@@ -454,6 +507,8 @@ bool ESP_Brookesia_CoreApp::processRun()
     if (!run()) {
         ESP_BROOKESIA_LOGE("Run app failed");
         ret = false;
+    } else if (!processRestoreState()) {
+        ESP_BROOKESIA_LOGE("Restore state failed, start from scratch");
     }
     ESP_BROOKESIA_CHECK_FALSE_RETURN(endRecordResource(), false, "Start record resource failed");
     if (!saveRecentScreen(true)) {
@@ -531,6 +586,10 @@ bool ESP_Brookesia_CoreApp::processClose(bool is_app_active)
     // Prevent recursive close
     _flags.is_closing = true;
 
+    // An app whose `run()` failed is still closed, its state is not worth keeping
+    if ((_status != ESP_BROOKESIA_CORE_APP_STATUS_CLOSED) && !processSaveState()) {
+        ESP_BROOKESIA_LOGE("Save state failed");
+    }
     ESP_BROOKESIA_LOGD("Do close");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(close(), err, "Close failed");
     // Check if the app is active, if not, clean the resource immediately.
@@ -564,6 +623,45 @@ err:
     return false;
 }
 
+bool ESP_Brookesia_CoreApp::processSaveState(void)
+{
+    vector<uint8_t> state;
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+    if (ESP_BROOKESIA_APP_STATE_SIZE_MAX == 0) {
+        return true;
+    }
+
+    ESP_BROOKESIA_LOGD("App(%s: %d) save state", getName(), _id);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(saveState(state), false, "Save state failed");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(esp_brookesia_core_app_state_put(getName(), state.data(), state.size()), false,
+                                     "Keep state failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_CoreApp::processRestoreState(void)
+{
+    size_t size = 0;
+    const uint8_t *data = nullptr;
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    data = static_cast<const uint8_t *>(esp_brookesia_core_app_state_get(getName(), &size));
+    if (data == nullptr) {
+        return true;
+    }
+
+    ESP_BROOKESIA_LOGD("App(%s: %d) restore state(%d)", getName(), _id, (int)size);
+    if (!restoreState(data, size)) {
+        // Drop it, or the app would fail the same way on every start
+        esp_brookesia_core_app_state_put(getName(), nullptr, 0);
+        return false;
+    }
+
+    return true;
+}
+
 bool ESP_Brookesia_CoreApp::setVisualArea(const lv_area_t &area)
 {
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
@@ -693,19 +791,19 @@ bool ESP_Brookesia_CoreApp::resetRecordResource(void)
 
     // Screen
     _resource_screen_count = 0;
-    _resource_screens.clear();
     _resource_screens_class_parent_map.clear();
 
     // Timer
     _resource_timer_count = 0;
-    _resource_timers.clear();
     _resource_timers_cb_usr_map.clear();
 
     // Animation
     _resource_anim_count = 0;
-    _resource_anims.clear();
     _resource_anims_var_exec_map.clear();
 
+    // Heap
+    _resource_heap_usage = 0;
+
     _flags.is_resource_recording = false;
 
     return true;
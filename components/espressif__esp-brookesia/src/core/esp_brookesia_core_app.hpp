@@ -5,9 +5,10 @@
  */
 #pragma once
 
-#include <list>
 #include <map>
+#include <unordered_map>
 #include <string>
+#include <vector>
 #include "lvgl.h"
 #include "esp_brookesia_core_type.h"
 
@@ -136,6 +137,58 @@ public:
         return _core;
     }
 
+    /**
+     * @brief Enable or disable lazy init, see the `enable_lazy_init` flag in `ESP_Brookesia_CoreAppData_t`.
+     *
+     * @note  This function should be called before the app is installed
+     *
+     * @param enable Flag to call `init()` on the first launch instead of when installed
+     *
+     * @return true if successful, otherwise false
+     *
+     */
+    bool setLazyInit(bool enable);
+
+    /**
+     * @brief Set the memory policy, see the `memory` field in `ESP_Brookesia_CoreAppData_t`.
+     *
+     * @note  This function should be called before the app is installed
+     *
+     * @param caps Heap caps (`MALLOC_CAP_*`) preferred by the LVGL objects and the snapshot of the app, 0 for the
+     *             default memory
+     * @param quota_kb Soft heap quota in KB, 0 for no quota
+     *
+     * @return true if successful, otherwise false
+     *
+     */
+    bool setMemoryPolicy(uint32_t caps, uint32_t quota_kb);
+
+    /**
+     * @brief Check if the app's `init()` function has been called
+     *
+     * @return true if the app is initialized, otherwise false
+     *
+     */
+    bool checkInitDone(void) const
+    {
+        return _flags.is_init_done;
+    }
+
+    /**
+     * @brief Get the heap used by the app. This is the heap taken between `startRecordResource()` and
+     *        `endRecordResource()` (including the `run()` and `resume()` functions) since the app was started, minus
+     *        the heap released by `trimMemory()`.
+     *
+     * @note  Allocations made outside these windows, such as by the app's own tasks, are not counted.
+     *
+     * @return size: the heap used in bytes, 0 if the platform can't report the free heap
+     *
+     */
+    int getHeapUsage(void) const
+    {
+        return _resource_heap_usage;
+    }
+
 protected:
     /**
      * @brief Called when the app starts running. This is the entry point for the app, where all UI resources should be
@@ -252,6 +305,93 @@ protected:
         return true;
     }
 
+    /**
+     * @brief Called when the running app number reaches the limit and the core chooses an app to close. Return the
+     *        memory that closing the app would release, so that the core closes the app which frees the most.
+     *
+     * @note  Apps with the same footprint are closed in least recently used order. The most recently used app is never
+     *        chosen.
+     *
+     * @return The number of bytes released by `close()`, the recorded heap usage by default
+     *
+     */
+    virtual size_t getMemoryFootprint(void) const
+    {
+        return (_resource_heap_usage > 0) ? _resource_heap_usage : 0;
+    }
+
+    /**
+     * @brief Called when the free heap drops below `ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB`. The app should release the
+     *        caches and other memory that it can rebuild later.
+     *
+     * @note  Paused apps are called first, least recently used first, then the active app. If the heap is still low,
+     *        the paused app chosen by the core is called with `ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_COMPLETE` and closed
+     *        if that doesn't release enough. The most recently used app is never closed.
+     *
+     * @param level The trim level, see `ESP_Brookesia_CoreAppTrimLevel_t`
+     *
+     * @return true if successful, otherwise false
+     *
+     */
+    virtual bool trimMemory(ESP_Brookesia_CoreAppTrimLevel_t level)
+    {
+        return true;
+    }
+
+    /**
+     * @brief Called when the display is turned off or on again with `ESP_Brookesia_Core::setDisplayState()`. While it
+     *        is off nothing is drawn and LVGL animations stand still, the app should stop the timers and the work that
+     *        only feed what is shown, and keep the rest (audio, communication) running.
+     *
+     * @note  All running apps are called, paused ones included.
+     *
+     * @param state The new display state, see `ESP_Brookesia_CoreDisplayState_t`
+     *
+     * @return true if successful, otherwise false
+     *
+     */
+    virtual bool displayStateChanged(ESP_Brookesia_CoreDisplayState_t state)
+    {
+        return true;
+    }
+
+    /**
+     * @brief Called when the app closes, before `close()`, and for the running apps when the display turns off. The
+     *        app should append the state it wants back on its next start to `state`, e.g. a game board or an input
+     *        history, not the UI itself. The core keeps it (in PSRAM if it is enabled) and writes it to flash when
+     *        the display turns off, so it also survives a restart.
+     *
+     * @note  The state is opaque to the core, the app should put a version in it if its layout may change. An empty
+     *        state drops the kept one. It must not exceed `ESP_BROOKESIA_APP_STATE_SIZE_MAX` bytes.
+     *
+     * @param state Empty buffer to fill
+     *
+     * @return true if successful, otherwise false and nothing is kept
+     *
+     */
+    virtual bool saveState(std::vector<uint8_t> &state)
+    {
+        return true;
+    }
+
+    /**
+     * @brief Called right after `run()` if a state was saved by `saveState()`, before anything is drawn. The app
+     *        should apply it to the UI just created. The state is only read from flash on the first start after a
+     *        restart.
+     *
+     * @note  The app must check the state, it may come from an older version of the app.
+     *
+     * @param data State
+     * @param size Size of the state in bytes
+     *
+     * @return true if successful, otherwise false and the state is dropped
+     *
+     */
+    virtual bool restoreState(const uint8_t *data, size_t size)
+    {
+        return true;
+    }
+
     /**
      * @brief Notify the core to close the app, and the core will eventually call the `close()` function.
      *
@@ -320,11 +460,14 @@ private:
     virtual bool beginExtra(void) { return true; }
     virtual bool delExtra(void)   { return true; }
     virtual bool processInstall(ESP_Brookesia_Core *core, int id);
+    bool processInit(void);
     virtual bool processUninstall(void);
     virtual bool processRun(void);
     virtual bool processResume(void);
     virtual bool processPause(void);
     virtual bool processClose(bool is_app_active);
+    bool processSaveState(void);
+    bool processRestoreState(void);
 
     bool setVisualArea(const lv_area_t &area);
     bool calibrateVisualArea(void);
@@ -355,6 +498,7 @@ private:
         uint8_t is_closing: 1;
         uint8_t is_screen_small: 1;
         uint8_t is_resource_recording: 1;
+        uint8_t is_init_done: 1;
     } _flags;
     struct {
         uint16_t w;
@@ -371,17 +515,17 @@ private:
     int _resource_anim_count;
     int _resource_head_screen_index;
     int _resource_screen_count;
+    int _resource_heap_usage;
+    size_t _resource_head_free_heap;
+    uint32_t _resource_head_lv_caps;
     lv_obj_t *_last_screen;
     lv_obj_t *_active_screen;
     // lv_obj_t *_temp_screen;
     lv_timer_t *_resource_head_timer;
     lv_anim_t *_resource_head_anim;
-    std::list <lv_obj_t *> _resource_screens;
-    std::list <lv_timer_t *> _resource_timers;
-    std::list <lv_anim_t *> _resource_anims;
-    // These maps are meant to store additional information about the recorded resources to prevent accidental cleanup
-    std::map<lv_obj_t *, std::pair<const lv_obj_class_t *, lv_obj_t *>> _resource_screens_class_parent_map;
-    std::map<lv_timer_t *, std::pair<lv_timer_cb_t, void *>> _resource_timers_cb_usr_map;
-    std::map<lv_anim_t *, std::pair<void *, lv_anim_exec_xcb_t>> _resource_anims_var_exec_map;
+    // The recorded resources. The maps also store additional information about them to prevent accidental cleanup
+    std::unordered_map<lv_obj_t *, std::pair<const lv_obj_class_t *, lv_obj_t *>> _resource_screens_class_parent_map;
+    std::unordered_map<lv_timer_t *, std::pair<lv_timer_cb_t, void *>> _resource_timers_cb_usr_map;
+    std::unordered_map<lv_anim_t *, std::pair<void *, lv_anim_exec_xcb_t>> _resource_anims_var_exec_map;
 };
 // *INDENT-OFF*
@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_app_state.h"
+#ifdef ESP_BROOKESIA_MEMORY_INCLUDE
+#include ESP_BROOKESIA_MEMORY_INCLUDE
+#endif
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#endif
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE_APP
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM)
+#define APP_STATE_MALLOC(size)      heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define APP_STATE_FREE(ptr)         heap_caps_free(ptr)
+#else
+#define APP_STATE_MALLOC(size)      ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define APP_STATE_FREE(ptr)         ESP_BROOKESIA_MEMORY_FREE(ptr)
+#endif
+
+typedef struct {
+    char name[ESP_BROOKESIA_APP_STATE_NAME_LEN_MAX];
+    uint8_t *data;
+    size_t size;
+    uint8_t is_used: 1;
+    uint8_t is_loaded: 1;           // The storage has been read, or the kept state replaces what it holds
+    uint8_t is_dirty: 1;            // Changed since the last flush
+} AppStateEntry_t;
+
+static AppStateEntry_t s_entries[ESP_BROOKESIA_APP_STATE_ENTRY_NUM];
+static esp_brookesia_core_app_state_storage_t s_storage;
+
+static AppStateEntry_t *find_entry(const char *name, bool create)
+{
+    AppStateEntry_t *free_slot = NULL;
+
+    if (strlen(name) >= ESP_BROOKESIA_APP_STATE_NAME_LEN_MAX) {
+        ESP_BROOKESIA_LOGW("App name(%s) is too long to keep its state", name);
+        return NULL;
+    }
+    for (int i = 0; i < ESP_BROOKESIA_APP_STATE_ENTRY_NUM; i++) {
+        AppStateEntry_t *entry = &s_entries[i];
+        if (!entry->is_used) {
+            free_slot = (free_slot == NULL) ? entry : free_slot;
+        } else if (strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    if (free_slot == NULL) {
+        ESP_BROOKESIA_LOGW("No room for the state of app(%s)", name);
+        return NULL;
+    }
+    strcpy(free_slot->name, name);
+    free_slot->is_used = true;
+
+    return free_slot;
+}
+
+static void set_data(AppStateEntry_t *entry, uint8_t *data, size_t size)
+{
+    if (entry->data != NULL) {
+        APP_STATE_FREE(entry->data);
+    }
+    entry->data = data;
+    entry->size = size;
+}
+
+static void load_entry(AppStateEntry_t *entry)
+{
+    int size = 0;
+    uint8_t *data = NULL;
+
+    entry->is_loaded = true;
+    if (s_storage.load == NULL) {
+        return;
+    }
+
+    size = s_storage.load(entry->name, NULL, 0, s_storage.user_ctx);
+    if (size <= 0) {
+        return;
+    }
+    if (size > ESP_BROOKESIA_APP_STATE_SIZE_MAX) {
+        ESP_BROOKESIA_LOGW("Saved state(%d) of app(%s) is too big, ignore it", size, entry->name);
+        return;
+    }
+    data = (uint8_t *)APP_STATE_MALLOC(size);
+    ESP_BROOKESIA_CHECK_NULL_EXIT(data, "Alloc state(%d) failed", size);
+    if (s_storage.load(entry->name, data, size, s_storage.user_ctx) != size) {
+        ESP_BROOKESIA_LOGE("Load state of app(%s) failed", entry->name);
+        APP_STATE_FREE(data);
+        return;
+    }
+    set_data(entry, data, size);
+    ESP_BROOKESIA_LOGD("Load state(%d) of app(%s)", size, entry->name);
+}
+
+void esp_brookesia_core_app_state_set_storage(const esp_brookesia_core_app_state_storage_t *storage)
+{
+    if (storage == NULL) {
+        memset(&s_storage, 0, sizeof(s_storage));
+    } else {
+        s_storage = *storage;
+    }
+}
+
+bool esp_brookesia_core_app_state_put(const char *name, const void *data, size_t size)
+{
+    AppStateEntry_t *entry = NULL;
+    uint8_t *copy = NULL;
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(name, false, "Invalid name");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((data != NULL) || (size == 0), false, "Invalid data");
+    if (ESP_BROOKESIA_APP_STATE_SIZE_MAX == 0) {
+        return true;
+    }
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(size <= ESP_BROOKESIA_APP_STATE_SIZE_MAX, false,
+                                     "State(%d) of app(%s) is too big", (int)size, name);
+
+    // Apps without a state never take a slot
+    entry = find_entry(name, size > 0);
+    if (entry == NULL) {
+        return (size == 0);
+    }
+    if ((entry->size == size) && ((size == 0) || (memcmp(entry->data, data, size) == 0))) {
+        return true;
+    }
+
+    if (size > 0) {
+        copy = (uint8_t *)APP_STATE_MALLOC(size);
+        ESP_BROOKESIA_CHECK_NULL_RETURN(copy, false, "Alloc state(%d) failed", (int)size);
+        memcpy(copy, data, size);
+    }
+    set_data(entry, copy, size);
+    entry->is_loaded = true;
+    entry->is_dirty = true;
+    ESP_BROOKESIA_LOGD("Keep state(%d) of app(%s)", (int)size, name);
+
+    return true;
+}
+
+const void *esp_brookesia_core_app_state_get(const char *name, size_t *size)
+{
+    AppStateEntry_t *entry = NULL;
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(name, NULL, "Invalid name");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(size, NULL, "Invalid size");
+
+    *size = 0;
+    if (ESP_BROOKESIA_APP_STATE_SIZE_MAX == 0) {
+        return NULL;
+    }
+    entry = find_entry(name, true);
+    if (entry == NULL) {
+        return NULL;
+    }
+    if (!entry->is_loaded) {
+        load_entry(entry);
+    }
+    *size = entry->size;
+
+    return entry->data;
+}
+
+bool esp_brookesia_core_app_state_flush(void)
+{
+    bool ret = true;
+
+    if (s_storage.save == NULL) {
+        return true;
+    }
+
+    for (int i = 0; i < ESP_BROOKESIA_APP_STATE_ENTRY_NUM; i++) {
+        AppStateEntry_t *entry = &s_entries[i];
+        if (!entry->is_used || !entry->is_dirty) {
+            continue;
+        }
+        if (!s_storage.save(entry->name, entry->data, entry->size, s_storage.user_ctx)) {
+            ESP_BROOKESIA_LOGE("Save state of app(%s) failed", entry->name);
+            ret = false;
+            continue;
+        }
+        entry->is_dirty = false;
+        ESP_BROOKESIA_LOGD("Save state(%d) of app(%s)", (int)entry->size, entry->name);
+    }
+
+    return ret;
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_APP_STATE_ENTRY_NUM       (32)
+#define ESP_BROOKESIA_APP_STATE_NAME_LEN_MAX    (32)
+
+/**
+ * @brief Flash storage of the app states, provided by the system since the core doesn't know where to keep them
+ *
+ */
+typedef struct {
+    /**
+     * @brief Read the state saved under `name`
+     *
+     * @param name Name of the app
+     * @param data Buffer of `size` bytes, or NULL to only get the size
+     * @param size Size of `data`
+     * @param user_ctx `user_ctx` of this structure
+     *
+     * @return Size of the state in bytes, 0 if there is none, -1 on error
+     *
+     */
+    int (*load)(const char *name, void *data, size_t size, void *user_ctx);
+    /**
+     * @brief Write the state of `name`, or erase it if `size` is 0
+     *
+     * @return true if successful, otherwise false
+     *
+     */
+    bool (*save)(const char *name, const void *data, size_t size, void *user_ctx);
+    void *user_ctx;
+} esp_brookesia_core_app_state_storage_t;
+
+/**
+ * @brief Set the flash storage of the app states. Without one, the states only survive until a restart. Must be
+ *        called before any app runs.
+ *
+ * @param storage Storage, copied, NULL to remove it
+ *
+ */
+void esp_brookesia_core_app_state_set_storage(const esp_brookesia_core_app_state_storage_t *storage);
+
+/**
+ * @brief Keep a copy of the state of an app (in PSRAM if it is enabled) until it is written by
+ *        `esp_brookesia_core_app_state_flush()`. A state equal to the kept one changes nothing. Must be called with
+ *        the LVGL lock held.
+ *
+ * @param name Name of the app
+ * @param data State
+ * @param size Size of the state, up to `ESP_BROOKESIA_APP_STATE_SIZE_MAX`, 0 to drop it
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_app_state_put(const char *name, const void *data, size_t size);
+
+/**
+ * @brief Get the state of an app. The first call for an app after a restart reads it from the storage, the following
+ *        ones return the kept copy. Must be called with the LVGL lock held.
+ *
+ * @param name Name of the app
+ * @param size Set to the size of the state, 0 if there is none
+ *
+ * @return State, valid until the next `esp_brookesia_core_app_state_put()` of the app, or NULL if there is none
+ *
+ */
+const void *esp_brookesia_core_app_state_get(const char *name, size_t *size);
+
+/**
+ * @brief Write the states changed since the last flush to the storage. Must be called with the LVGL lock held.
+ *
+ * @return true if successful or there is no storage, false if a state could not be written, it is written again by
+ *         the next flush
+ *
+ */
+bool esp_brookesia_core_app_state_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include "lvgl.h"
+#include "esp_brookesia_core_boot_profile.h"
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+typedef struct {
+    ESP_Brookesia_BootProfileSpan_t info;
+    const void *owner;
+    volatile bool is_valid;
+} BootProfileSlot_t;
+
+static BootProfileSlot_t s_slots[ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM];
+static int s_slot_num = 0;
+static volatile int64_t s_finish_us = -1;
+
+static int64_t get_time_us(void)
+{
+#if defined(ESP_PLATFORM)
+    return esp_timer_get_time();
+#else
+    return (int64_t)lv_tick_get() * 1000;
+#endif
+}
+
+static const void *get_owner(void)
+{
+#if defined(ESP_PLATFORM)
+    return xTaskGetCurrentTaskHandle();
+#else
+    return NULL;
+#endif
+}
+
+static int get_recorded_num(void)
+{
+    int num = __atomic_load_n(&s_slot_num, __ATOMIC_ACQUIRE);
+
+    return (num < ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM) ? num : ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM;
+}
+#endif /* ESP_BROOKESIA_BOOT_PROFILE_ENABLE */
+
+int esp_brookesia_core_boot_profile_begin(const char *name)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    if (s_finish_us >= 0) {
+        return -1;
+    }
+
+    int index = __atomic_fetch_add(&s_slot_num, 1, __ATOMIC_ACQ_REL);
+    if (index >= ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM) {
+        return -1;
+    }
+
+    BootProfileSlot_t *slot = &s_slots[index];
+    const void *owner = get_owner();
+    uint8_t depth = 0;
+
+    for (int i = 0; i < index; i++) {
+        if (s_slots[i].is_valid && (s_slots[i].owner == owner) && (s_slots[i].info.end_us < 0)) {
+            depth++;
+        }
+    }
+
+    snprintf(slot->info.name, sizeof(slot->info.name), "%s", (name != NULL) ? name : "");
+    slot->info.depth = depth;
+    slot->info.end_us = -1;
+    slot->owner = owner;
+    slot->info.start_us = get_time_us();
+    __atomic_store_n(&slot->is_valid, true, __ATOMIC_RELEASE);
+
+    return index;
+#else
+    (void)name;
+    return -1;
+#endif
+}
+
+void esp_brookesia_core_boot_profile_end(int span)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    if ((span < 0) || (span >= ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM) || !s_slots[span].is_valid) {
+        return;
+    }
+    s_slots[span].info.end_us = get_time_us();
+#else
+    (void)span;
+#endif
+}
+
+void esp_brookesia_core_boot_profile_finish(void)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    if (s_finish_us >= 0) {
+        return;
+    }
+    s_finish_us = get_time_us();
+    esp_brookesia_core_boot_profile_print();
+#endif
+}
+
+int64_t esp_brookesia_core_boot_profile_get_boot_time(void)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    return s_finish_us;
+#else
+    return -1;
+#endif
+}
+
+int esp_brookesia_core_boot_profile_get_span_num(void)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    return get_recorded_num();
+#else
+    return 0;
+#endif
+}
+
+bool esp_brookesia_core_boot_profile_get_span(int index, ESP_Brookesia_BootProfileSpan_t *span)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    if ((span == NULL) || (index < 0) || (index >= get_recorded_num()) || !s_slots[index].is_valid) {
+        return false;
+    }
+    *span = s_slots[index].info;
+
+    return true;
+#else
+    (void)index;
+    (void)span;
+    return false;
+#endif
+}
+
+void esp_brookesia_core_boot_profile_print(void)
+{
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    ESP_Brookesia_BootProfileSpan_t span = { 0 };
+    int num = get_recorded_num();
+
+    printf("Boot profile (%d spans):\n", num);
+    printf("  %10s %10s  %s\n", "Start(ms)", "Time(ms)", "Name");
+    for (int i = 0; i < num; i++) {
+        if (!esp_brookesia_core_boot_profile_get_span(i, &span)) {
+            continue;
+        }
+        if (span.end_us < 0) {
+            printf("  %10.3f %10s  %*s%s\n", span.start_us / 1000.0, "open", span.depth * 2, "", span.name);
+        } else {
+            printf("  %10.3f %10.3f  %*s%s\n", span.start_us / 1000.0, (span.end_us - span.start_us) / 1000.0,
+                   span.depth * 2, "", span.name);
+        }
+    }
+    if (__atomic_load_n(&s_slot_num, __ATOMIC_ACQUIRE) > ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM) {
+        printf("  (%d spans dropped, increase ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM)\n",
+               __atomic_load_n(&s_slot_num, __ATOMIC_ACQUIRE) - ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM);
+    }
+
+    if (s_finish_us < 0) {
+        return;
+    }
+    printf("  Boot time: %.3f ms", s_finish_us / 1000.0);
+    if (ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS > 0) {
+        printf(", budget: %d ms%s", ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS,
+               (s_finish_us > (int64_t)ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS * 1000) ? " (EXCEEDED)" : "");
+    }
+    printf("\n");
+#endif
+}
+
+size_t esp_brookesia_core_boot_profile_export_csv(char *buf, size_t size)
+{
+    size_t len = 0;
+
+#if ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    ESP_Brookesia_BootProfileSpan_t span = { 0 };
+    int num = get_recorded_num();
+    bool has_space = false;
+    int ret = 0;
+
+    for (int i = 0; i < num; i++) {
+        if (!esp_brookesia_core_boot_profile_get_span(i, &span)) {
+            continue;
+        }
+        has_space = (buf != NULL) && (len < size);
+        ret = snprintf(has_space ? buf + len : NULL, has_space ? size - len : 0, "%s,%d,%lld,%lld\n", span.name,
+                       span.depth, (long long)span.start_us,
+                       (long long)((span.end_us < 0) ? -1 : (span.end_us - span.start_us)));
+        if (ret > 0) {
+            len += ret;
+        }
+    }
+#endif
+    if ((buf != NULL) && (size > 0) && (len == 0)) {
+        buf[0] = '\0';
+    }
+
+    return len;
+}
@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_BOOT_PROFILE_NAME_LEN_MAX  (28)
+
+typedef struct {
+    char name[ESP_BROOKESIA_BOOT_PROFILE_NAME_LEN_MAX];
+    int64_t start_us;       /*!< Time since the start of `esp_timer` */
+    int64_t end_us;         /*!< -1 if the span is still open */
+    uint8_t depth;          /*!< Number of spans of the same task that were open when it began */
+} ESP_Brookesia_BootProfileSpan_t;
+
+/**
+ * @brief Open a span of the boot profile. Does nothing if `ESP_BROOKESIA_BOOT_PROFILE_ENABLE` is 0, if the profile is
+ *        finished or if `ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM` spans are already recorded. Can be called from any task.
+ *
+ * @param name Name of the span, it is copied and truncated to `ESP_BROOKESIA_BOOT_PROFILE_NAME_LEN_MAX - 1` chars
+ *
+ * @return Index of the span to pass to `esp_brookesia_core_boot_profile_end()`, or -1 if it is not recorded
+ *
+ */
+int esp_brookesia_core_boot_profile_begin(const char *name);
+
+/**
+ * @brief Close a span opened by `esp_brookesia_core_boot_profile_begin()`. Does nothing if the index is -1.
+ *
+ * @param span Index of the span
+ *
+ */
+void esp_brookesia_core_boot_profile_end(int span);
+
+/**
+ * @brief Mark the end of the boot, print the summary and stop recording new spans
+ *
+ */
+void esp_brookesia_core_boot_profile_finish(void);
+
+/**
+ * @brief Get the time from the start of `esp_timer` to `esp_brookesia_core_boot_profile_finish()`
+ *
+ * @return Time in us, or -1 if the profile is not finished
+ *
+ */
+int64_t esp_brookesia_core_boot_profile_get_boot_time(void);
+
+/**
+ * @brief Get the number of recorded spans
+ *
+ */
+int esp_brookesia_core_boot_profile_get_span_num(void);
+
+/**
+ * @brief Get a copy of a recorded span
+ *
+ * @param index Index of the span, in the order they began
+ * @param span Pointer to the copy
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_boot_profile_get_span(int index, ESP_Brookesia_BootProfileSpan_t *span);
+
+/**
+ * @brief Print the summary table of the recorded spans
+ *
+ */
+void esp_brookesia_core_boot_profile_print(void);
+
+/**
+ * @brief Export the recorded spans as CSV, one line per span: `name,depth,start_us,duration_us`. The duration of an
+ *        open span is -1.
+ *
+ * @param buf Buffer for the text, can be NULL to only get the length
+ * @param size Size of the buffer, the text is truncated and always null-terminated if `size` is not 0
+ *
+ * @return Length of the whole text without the terminating null, like `snprintf()`
+ *
+ */
+size_t esp_brookesia_core_boot_profile_export_csv(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
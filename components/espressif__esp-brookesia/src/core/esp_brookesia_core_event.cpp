@@ -10,7 +10,9 @@
 using namespace std;
 
 ESP_Brookesia_CoreEvent::ESP_Brookesia_CoreEvent():
-    _free_event_id(ID::CUSTOM)
+    _free_event_id(ID::CUSTOM),
+    _dispatch_depth(0),
+    _has_removed_handlers(false)
 {
 }
 
@@ -36,8 +38,19 @@ ESP_Brookesia_CoreEvent::ID operator++(ESP_Brookesia_CoreEvent::ID &id, int)
 void ESP_Brookesia_CoreEvent::reset(void)
 {
     _free_event_id = ID::CUSTOM;
-    _event_handlers.clear();
+    _pending_registers.clear();
     _available_event_ids.clear();
+    if (_dispatch_depth > 0) {
+        // Keep the slots for the running dispatch, they are removed when it finishes
+        for (auto &slot : _slots) {
+            for (size_t i = 0; i < slot.handlers.size(); i++) {
+                slot.handlers.at(i).handler = nullptr;
+            }
+        }
+        _has_removed_handlers = true;
+        return;
+    }
+    _slots.clear();
 }
 
 bool ESP_Brookesia_CoreEvent::registerEvent(void *object, Handler handler, ID id, void *user_data)
@@ -46,42 +59,46 @@ bool ESP_Brookesia_CoreEvent::registerEvent(void *object, Handler handler, ID id
                        handler, user_data);
     ESP_BROOKESIA_CHECK_NULL_RETURN(handler, false, "Invalid handler");
 
-    auto &handlers_for_object = _event_handlers[object];
-    handlers_for_object[id].emplace_back(handler, user_data);
+    if (_dispatch_depth > 0) {
+        // Inserting could move the slots being dispatched, the handler takes effect from the next event
+        _pending_registers.push_back({object, id, {handler, user_data}});
+        return true;
+    }
+    addHandler(object, id, {handler, user_data});
 
     return true;
 }
 
-bool ESP_Brookesia_CoreEvent::sendEvent(void *object, ID id, void *param) const
+bool ESP_Brookesia_CoreEvent::sendEvent(void *object, ID id, void *param)
 {
     ESP_BROOKESIA_LOGD("Send event for object(0x%p) ID(%d) param(0x%p)", object, static_cast<int>(id), param);
 
-    auto object_it = _event_handlers.find(object);
-    if (object_it == _event_handlers.end()) {
-        return true;
-    }
-
-    auto &handlers_for_object = object_it->second;
-    auto handler_it = handlers_for_object.find(id);
-    if (handler_it == handlers_for_object.end()) {
+    auto slot_it = findSlot(object, id);
+    if (slot_it == _slots.end()) {
         return true;
     }
 
     HandlerData data = {};
     bool ret = true;
-    for (auto &handler_data_pair : handler_it->second) {
-        auto &handler = handler_data_pair.first;
-        auto &user_data = handler_data_pair.second;
-        if (handler == nullptr) {
-            ESP_BROOKESIA_LOGE("Handler is nullptr");
+    HandlerList &handlers = slot_it->handlers;
+    size_t handlers_count = handlers.size();
+
+    _dispatch_depth++;
+    for (size_t i = 0; i < handlers_count; i++) {
+        // Read the entry each time, a previous handler may have unregistered it
+        const HandlerEntry entry = handlers.at(i);
+        if (entry.handler == nullptr) {
             continue;
         }
-        data = {id, object, param, user_data};
-        if (!handler(data)) {
+        data = {id, object, param, entry.user_data};
+        if (!entry.handler(data)) {
             ret = false;
             ESP_BROOKESIA_LOGE("Do handler failed");
         }
     }
+    if (--_dispatch_depth == 0) {
+        applyPendingChanges();
+    }
 
     return ret;
 }
@@ -90,110 +107,42 @@ void ESP_Brookesia_CoreEvent::unregisterEvent(void *object)
 {
     ESP_BROOKESIA_LOGD("Unregister event for object(0x%p)", object);
 
-    auto object_it = _event_handlers.find(object);
-    if (object_it == _event_handlers.end()) {
-        return;
-    }
-
-    // Save event IDs to be removed
     std::unordered_set<ID> event_ids;
-    for (auto &id_handlers_pair : object_it->second) {
-        event_ids.insert(id_handlers_pair.first);
-    }
-
-    // Remove handlers for the given object
-    size_t handlers_count = getEventHandlersCount();
-    _event_handlers.erase(object_it);
-    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)(handlers_count - getEventHandlersCount() ));
+    size_t removed_count = removeHandlers(object, false, ID::APP, true, nullptr, event_ids);
+    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)removed_count);
 
-    // Add removed event IDs to available event IDs
-    for (const auto &id : event_ids) {
-        if (!checkUsedEventID(id)) {
-            ESP_BROOKESIA_LOGD("Recycle event ID(%d)", static_cast<int>(id));
-            _available_event_ids.insert(id);
-        }
-    }
+    recycleEventIDs(event_ids);
 }
 
 void ESP_Brookesia_CoreEvent::unregisterEvent(void *object, ID id)
 {
     ESP_BROOKESIA_LOGD("Unregister event for object(0x%p) ID(%d)", object, static_cast<int>(id));
 
-    auto object_it = _event_handlers.find(object);
-    if (object_it == _event_handlers.end()) {
-        return;
-    }
-
-    auto &handlers_for_object = object_it->second;
-    size_t handlers_count = getEventHandlersCount();
-    if (handlers_for_object.erase(id) == 0) {
-        return;
-    }
-    if (handlers_for_object.empty()) {
-        _event_handlers.erase(object_it);
-    }
-    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)(handlers_count - getEventHandlersCount() ));
+    std::unordered_set<ID> event_ids;
+    size_t removed_count = removeHandlers(object, false, id, false, nullptr, event_ids);
+    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)removed_count);
 
-    // Add removed event IDs to available event IDs
-    if (!checkUsedEventID(id)) {
-        ESP_BROOKESIA_LOGD("Recycle event ID(%d)", static_cast<int>(id));
-        _available_event_ids.insert(id);
-    }
+    recycleEventIDs(event_ids);
 }
 
 void ESP_Brookesia_CoreEvent::unregisterEvent(void *object, Handler handler, ID id)
 {
     ESP_BROOKESIA_LOGD("Unregister event for object(0x%p) ID(%d) handler(0x%p)", object, static_cast<int>(id), handler);
 
-    auto object_it = _event_handlers.find(object);
-    if (object_it == _event_handlers.end()) {
-        return;
-    }
-
-    auto &handlers_for_object = object_it->second;
-    auto handler_it = handlers_for_object.find(id);
-    if (handler_it == handlers_for_object.end()) {
-        return;
-    }
-
-    auto &handlers = handler_it->second;
-    auto it = std::remove_if(handlers.begin(), handlers.end(),
-    [&](const std::pair<Handler, void *> &pair) {
-        return handler == pair.first;
-    });
-    if (it == handlers.end()) {
-        return;
-    }
-
-    size_t handlers_count = getEventHandlersCount();
-    handlers.erase(it, handlers.end());
-    if (handlers.empty()) {
-        handlers_for_object.erase(handler_it);
-    }
-    if (handlers_for_object.empty()) {
-        _event_handlers.erase(object_it);
-    }
-    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)(handlers_count - getEventHandlersCount() ));
+    std::unordered_set<ID> event_ids;
+    size_t removed_count = removeHandlers(object, false, id, false, handler, event_ids);
+    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)removed_count);
 
-    // Add removed event IDs to available event IDs
-    if (!checkUsedEventID(id)) {
-        _available_event_ids.insert(id);
-    }
+    recycleEventIDs(event_ids);
 }
 
 void ESP_Brookesia_CoreEvent::unregisterEvent(ID id)
 {
     ESP_BROOKESIA_LOGD("Unregister event for ID(%d)", static_cast<int>(id));
 
-    size_t handlers_count = getEventHandlersCount();
-    for (auto &object_handler_pair : _event_handlers) {
-        auto &handlers_for_object = object_handler_pair.second;
-        if (handlers_for_object.find(id) != handlers_for_object.end()) {
-            handlers_for_object.erase(id);
-        }
-    }
-    cleanEmptyHandlers();
-    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)(handlers_count - getEventHandlersCount() ));
+    std::unordered_set<ID> event_ids;
+    size_t removed_count = removeHandlers(nullptr, true, id, false, nullptr, event_ids);
+    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)removed_count);
 
     // Add removed event IDs to available event IDs
     ESP_BROOKESIA_LOGD("Recycle event ID(%d)", static_cast<int>(id));
@@ -204,85 +153,171 @@ void ESP_Brookesia_CoreEvent::unregisterEvent(Handler handler)
 {
     ESP_BROOKESIA_LOGD("Unregister event for handler(0x%p)", handler);
 
-    // Save event IDs to be removed
     std::unordered_set<ID> event_ids;
-    size_t handlers_count = getEventHandlersCount();
-    for (auto &object_handler_pair : _event_handlers) {
-        auto &handlers_for_object = object_handler_pair.second;
-        for (auto &id_handlers_pair : handlers_for_object) {
-            auto &handlers = id_handlers_pair.second;
-            auto it = std::remove_if(handlers.begin(), handlers.end(),
-            [&](const std::pair<Handler, void *> &pair) {
-                return handler == pair.first;
-            });
-            if (it != handlers.end()) {
-                event_ids.insert(id_handlers_pair.first);
-                handlers.erase(it, handlers.end());
-            }
+    size_t removed_count = removeHandlers(nullptr, true, ID::APP, true, handler, event_ids);
+    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)removed_count);
+
+    recycleEventIDs(event_ids);
+}
+
+ESP_Brookesia_CoreEvent::ID ESP_Brookesia_CoreEvent::getFreeEventID()
+{
+    if (!_available_event_ids.empty()) {
+        ID id = *_available_event_ids.begin();
+        _available_event_ids.erase(id);
+
+        return id;
+    }
+
+    return ++_free_event_id;
+}
+
+void ESP_Brookesia_CoreEvent::HandlerList::push(const HandlerEntry &entry)
+{
+    if (_size < HANDLER_INLINE_NUM) {
+        _inline[_size] = entry;
+    } else {
+        _overflow.push_back(entry);
+    }
+    _size++;
+}
+
+size_t ESP_Brookesia_CoreEvent::HandlerList::compact(void)
+{
+    size_t count = 0;
+
+    // Keep the order of the remaining handlers
+    for (size_t i = 0; i < _size; i++) {
+        if (at(i).handler != nullptr) {
+            at(count++) = at(i);
         }
     }
-    cleanEmptyHandlers();
-    ESP_BROOKESIA_LOGD("Remove %d event handlers", (int)(handlers_count - getEventHandlersCount() ));
+    _size = count;
+    if (_size <= HANDLER_INLINE_NUM) {
+        _overflow.clear();
+    } else {
+        _overflow.resize(_size - HANDLER_INLINE_NUM);
+    }
 
-    // Add removed event IDs to available event IDs
-    for (const auto &id : event_ids) {
-        if (!checkUsedEventID(id)) {
-            ESP_BROOKESIA_LOGD("Recycle event ID(%d)", static_cast<int>(id));
-            _available_event_ids.insert(id);
+    return _size;
+}
+
+std::vector<ESP_Brookesia_CoreEvent::Slot>::iterator ESP_Brookesia_CoreEvent::findSlot(void *object, ID id)
+{
+    auto slot_it = std::lower_bound(_slots.begin(), _slots.end(), std::make_pair(object, id),
+    [](const Slot & slot, const std::pair<void *, ID> &key) {
+        if (slot.object != key.first) {
+            return std::less<void *>()(slot.object, key.first);
         }
+        return slot.id < key.second;
+    });
+    if ((slot_it == _slots.end()) || (slot_it->object != object) || (slot_it->id != id)) {
+        return _slots.end();
     }
+
+    return slot_it;
 }
 
-bool ESP_Brookesia_CoreEvent::checkUsedEventID(ID id) const
+void ESP_Brookesia_CoreEvent::addHandler(void *object, ID id, const HandlerEntry &entry)
 {
-    for (auto &object_handler_pair : _event_handlers) {
-        auto &handlers_for_object = object_handler_pair.second;
-        if (handlers_for_object.find(id) != handlers_for_object.end()) {
-            return true;
+    auto slot_it = std::lower_bound(_slots.begin(), _slots.end(), std::make_pair(object, id),
+    [](const Slot & slot, const std::pair<void *, ID> &key) {
+        if (slot.object != key.first) {
+            return std::less<void *>()(slot.object, key.first);
         }
+        return slot.id < key.second;
+    });
+    if ((slot_it == _slots.end()) || (slot_it->object != object) || (slot_it->id != id)) {
+        slot_it = _slots.insert(slot_it, Slot{object, id, HandlerList()});
     }
-    return false;
+    slot_it->handlers.push(entry);
 }
 
-ESP_Brookesia_CoreEvent::ID ESP_Brookesia_CoreEvent::getFreeEventID()
+size_t ESP_Brookesia_CoreEvent::removeHandlers(void *object, bool any_object, ID id, bool any_id, Handler handler,
+        std::unordered_set<ID> &removed_ids)
 {
-    if (!_available_event_ids.empty()) {
-        ID id = *_available_event_ids.begin();
-        _available_event_ids.erase(id);
+    size_t count = 0;
 
-        return id;
+    for (auto &slot : _slots) {
+        if ((!any_object && (slot.object != object)) || (!any_id && (slot.id != id))) {
+            continue;
+        }
+        for (size_t i = 0; i < slot.handlers.size(); i++) {
+            HandlerEntry &entry = slot.handlers.at(i);
+            if ((entry.handler != nullptr) && ((handler == nullptr) || (entry.handler == handler))) {
+                entry.handler = nullptr;
+                removed_ids.insert(slot.id);
+                count++;
+            }
+        }
+    }
+    // Registrations waiting for the running dispatch to finish are removed as well
+    auto pending_it = std::remove_if(_pending_registers.begin(), _pending_registers.end(),
+    [&](const PendingRegister & pending) {
+        return (any_object || (pending.object == object)) && (any_id || (pending.id == id)) &&
+               ((handler == nullptr) || (pending.entry.handler == handler));
+    });
+    for (auto it = pending_it; it != _pending_registers.end(); it++) {
+        removed_ids.insert(it->id);
+        count++;
     }
+    _pending_registers.erase(pending_it, _pending_registers.end());
 
-    return ++_free_event_id;
+    if (count > 0) {
+        _has_removed_handlers = true;
+        if (_dispatch_depth == 0) {
+            applyPendingChanges();
+        }
+    }
+
+    return count;
 }
 
-size_t ESP_Brookesia_CoreEvent::getEventHandlersCount(void) const
+void ESP_Brookesia_CoreEvent::recycleEventIDs(const std::unordered_set<ID> &ids)
 {
-    size_t count = 0;
-    for (auto &object_handler_pair : _event_handlers) {
-        for (auto &id_handlers_pair : object_handler_pair.second) {
-            count += id_handlers_pair.second.size();
+    // Add removed event IDs to available event IDs
+    for (const auto &id : ids) {
+        if (!checkUsedEventID(id)) {
+            ESP_BROOKESIA_LOGD("Recycle event ID(%d)", static_cast<int>(id));
+            _available_event_ids.insert(id);
         }
     }
+}
 
-    return count;
+void ESP_Brookesia_CoreEvent::applyPendingChanges(void)
+{
+    if (_has_removed_handlers) {
+        _has_removed_handlers = false;
+        auto it = std::remove_if(_slots.begin(), _slots.end(), [](Slot & slot) {
+            return slot.handlers.compact() == 0;
+        });
+        _slots.erase(it, _slots.end());
+    }
+
+    std::vector<PendingRegister> pending_registers;
+    pending_registers.swap(_pending_registers);
+    for (auto &pending : pending_registers) {
+        addHandler(pending.object, pending.id, pending.entry);
+    }
 }
 
-void ESP_Brookesia_CoreEvent::cleanEmptyHandlers()
+bool ESP_Brookesia_CoreEvent::checkUsedEventID(ID id) const
 {
-    for (auto it = _event_handlers.begin(); it != _event_handlers.end(); ) {
-        auto &id_map = it->second;
-        for (auto id_it = id_map.begin(); id_it != id_map.end(); ) {
-            if (id_it->second.empty()) {
-                id_it = id_map.erase(id_it);
-            } else {
-                ++id_it;
+    for (auto &slot : _slots) {
+        if (slot.id != id) {
+            continue;
+        }
+        for (size_t i = 0; i < slot.handlers.size(); i++) {
+            if (slot.handlers.at(i).handler != nullptr) {
+                return true;
             }
         }
-        if (id_map.empty()) {
-            it = _event_handlers.erase(it);
-        } else {
-            ++it;
+    }
+    for (auto &pending : _pending_registers) {
+        if (pending.id == id) {
+            return true;
         }
     }
+
+    return false;
 }
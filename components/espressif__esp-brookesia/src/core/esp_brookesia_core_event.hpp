@@ -6,7 +6,6 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 #include <unordered_set>
 #include <functional>
 #include <memory>
@@ -32,7 +31,7 @@ public:
 
     void reset(void);
     bool registerEvent(void *object, Handler handler, ID id, void *user_data = nullptr);
-    bool sendEvent(void *object, ID id, void *param = nullptr) const;
+    bool sendEvent(void *object, ID id, void *param = nullptr);
     void unregisterEvent(void *object);
     void unregisterEvent(void *object, ID id);
     void unregisterEvent(void *object, Handler handler, ID id);
@@ -42,13 +41,56 @@ public:
     ID getFreeEventID();
 
 private:
-    using HandlerList = std::vector<std::pair<Handler, void *>>;
+    static constexpr size_t HANDLER_INLINE_NUM = 2;
 
+    struct HandlerEntry {
+        Handler handler;            // nullptr if unregistered during dispatch, removed afterwards
+        void *user_data;
+    };
+
+    // Handlers of one (object, ID), the first few are stored inline and don't allocate
+    class HandlerList {
+    public:
+        HandlerList(): _size(0) {}
+
+        size_t size(void) const                     { return _size; }
+        HandlerEntry &at(size_t index)              { return (index < HANDLER_INLINE_NUM) ? _inline[index] : _overflow[index - HANDLER_INLINE_NUM]; }
+        const HandlerEntry &at(size_t index) const  { return (index < HANDLER_INLINE_NUM) ? _inline[index] : _overflow[index - HANDLER_INLINE_NUM]; }
+        void push(const HandlerEntry &entry);
+        size_t compact(void);
+
+    private:
+        size_t _size;
+        HandlerEntry _inline[HANDLER_INLINE_NUM];
+        std::vector<HandlerEntry> _overflow;
+    };
+
+    struct Slot {
+        void *object;
+        ID id;
+        HandlerList handlers;
+    };
+
+    struct PendingRegister {
+        void *object;
+        ID id;
+        HandlerEntry entry;
+    };
+
+    std::vector<Slot>::iterator findSlot(void *object, ID id);
+    void addHandler(void *object, ID id, const HandlerEntry &entry);
+    size_t removeHandlers(void *object, bool any_object, ID id, bool any_id, Handler handler,
+                          std::unordered_set<ID> &removed_ids);
+    void recycleEventIDs(const std::unordered_set<ID> &ids);
+    void applyPendingChanges(void);
     bool checkUsedEventID(ID id) const;
-    size_t getEventHandlersCount(void) const;
-    void cleanEmptyHandlers();
 
     ID _free_event_id;
-    std::unordered_map<void *, std::unordered_map<ID, HandlerList>> _event_handlers;
+    // Sorted by (object, ID), so `sendEvent()` is a binary search without hashing or allocating
+    std::vector<Slot> _slots;
+    // The slot array is left untouched while handlers run, changes made by them are applied after the dispatch
+    int _dispatch_depth;
+    bool _has_removed_handlers;
+    std::vector<PendingRegister> _pending_registers;
     std::unordered_set<ID> _available_event_ids;
 };
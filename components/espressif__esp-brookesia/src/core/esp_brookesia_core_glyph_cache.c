@@ -0,0 +1,253 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_glyph_cache.h"
+#ifdef ESP_BROOKESIA_MEMORY_INCLUDE
+#include ESP_BROOKESIA_MEMORY_INCLUDE
+#endif
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#endif
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+#if defined(ESP_PLATFORM)
+#define GLYPH_CACHE_MALLOC(size)    heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define GLYPH_CACHE_FREE(ptr)       heap_caps_free(ptr)
+#else
+#define GLYPH_CACHE_MALLOC(size)    ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define GLYPH_CACHE_FREE(ptr)       ESP_BROOKESIA_MEMORY_FREE(ptr)
+#endif
+
+#define GLYPH_CACHE_BUCKET_NUM      (256)
+
+typedef struct {
+    lv_font_t font;             /*!< Font given to LVGL, must be the first member */
+    const lv_font_t *src;
+} GlyphCacheFont_t;
+
+typedef struct GlyphCacheEntry_t {
+    struct GlyphCacheEntry_t *hash_next;
+    struct GlyphCacheEntry_t *lru_prev;   /*!< More recently used entry */
+    struct GlyphCacheEntry_t *lru_next;
+    const GlyphCacheFont_t *font;
+    uint32_t letter;
+    size_t size;                /*!< Size of the allocation, bitmap included */
+    uint8_t bitmap[];
+} GlyphCacheEntry_t;
+
+static GlyphCacheFont_t s_fonts[ESP_BROOKESIA_GLYPH_CACHE_FONT_NUM_MAX];
+static int s_font_num = 0;
+static GlyphCacheEntry_t *s_buckets[GLYPH_CACHE_BUCKET_NUM];
+static GlyphCacheEntry_t *s_lru_head = NULL;
+static GlyphCacheEntry_t *s_lru_tail = NULL;
+static size_t s_used_size = 0;
+
+static inline GlyphCacheEntry_t **get_bucket(const GlyphCacheFont_t *font, uint32_t letter)
+{
+    return &s_buckets[(letter + (uint32_t)(font - s_fonts) * 97) % GLYPH_CACHE_BUCKET_NUM];
+}
+
+static void lru_unlink(GlyphCacheEntry_t *entry)
+{
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        s_lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        s_lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_head(GlyphCacheEntry_t *entry)
+{
+    entry->lru_next = s_lru_head;
+    if (s_lru_head != NULL) {
+        s_lru_head->lru_prev = entry;
+    } else {
+        s_lru_tail = entry;
+    }
+    s_lru_head = entry;
+}
+
+static GlyphCacheEntry_t *find_entry(const GlyphCacheFont_t *font, uint32_t letter)
+{
+    for (GlyphCacheEntry_t *entry = *get_bucket(font, letter); entry != NULL; entry = entry->hash_next) {
+        if ((entry->font == font) && (entry->letter == letter)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static void free_entry(GlyphCacheEntry_t *entry)
+{
+    GlyphCacheEntry_t **link = get_bucket(entry->font, entry->letter);
+
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    lru_unlink(entry);
+    s_used_size -= entry->size;
+    GLYPH_CACHE_FREE(entry);
+}
+
+static void expand_bitmap(const uint8_t *src, uint8_t *dst, uint32_t px_num, uint8_t bpp)
+{
+    if (bpp == 8) {
+        memcpy(dst, src, px_num);
+        return;
+    }
+
+    // Rows are not padded in the source, pixels never cross a byte since bpp is 1, 2 or 4. The scale gives the same
+    // opacity as the tables LVGL uses to draw them.
+    uint8_t mask = (1 << bpp) - 1;
+    uint8_t scale = 0xFF / mask;
+    uint32_t bit = 0;
+    for (uint32_t i = 0; i < px_num; i++, bit += bpp) {
+        dst[i] = ((src[bit >> 3] >> (8 - bpp - (bit & 7))) & mask) * scale;
+    }
+}
+
+static void add_entry(const GlyphCacheFont_t *font, uint32_t letter, const uint8_t *bitmap)
+{
+    const lv_font_t *src = font->src;
+    lv_font_glyph_dsc_t dsc = { 0 };
+    GlyphCacheEntry_t *entry = NULL;
+    GlyphCacheEntry_t **bucket = NULL;
+    uint32_t px_num = 0;
+    size_t size = 0;
+
+    if (!src->get_glyph_dsc(src, &dsc, letter, 0)) {
+        return;
+    }
+    if ((dsc.bpp != 1) && (dsc.bpp != 2) && (dsc.bpp != 4) && (dsc.bpp != 8)) {
+        return;
+    }
+    px_num = (uint32_t)dsc.box_w * dsc.box_h;
+    size = sizeof(GlyphCacheEntry_t) + px_num;
+    if ((px_num == 0) || (size > (size_t)ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB * 1024)) {
+        return;
+    }
+
+    while ((s_used_size + size > (size_t)ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB * 1024) && (s_lru_tail != NULL)) {
+        free_entry(s_lru_tail);
+    }
+    entry = (GlyphCacheEntry_t *)GLYPH_CACHE_MALLOC(size);
+    if (entry == NULL) {
+        ESP_BROOKESIA_LOGD("Alloc glyph(0x%x) failed", (int)letter);
+        return;
+    }
+    expand_bitmap(bitmap, entry->bitmap, px_num, dsc.bpp);
+
+    entry->font = font;
+    entry->letter = letter;
+    entry->size = size;
+    entry->lru_prev = NULL;
+    bucket = get_bucket(font, letter);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_head(entry);
+    s_used_size += size;
+}
+
+static bool get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out, uint32_t letter, uint32_t letter_next)
+{
+    const GlyphCacheFont_t *cache_font = (const GlyphCacheFont_t *)font;
+    const lv_font_t *src = cache_font->src;
+    GlyphCacheEntry_t *entry = NULL;
+
+    if (!src->get_glyph_dsc(src, dsc_out, letter, letter_next)) {
+        return false;
+    }
+
+    // Only glyphs that are already cached are reported as 8 bpp, LVGL gets the bitmap right after the description
+    // to draw a letter, and only `get_glyph_bitmap()` adds or frees entries, so the bitmap always matches the bpp.
+    entry = find_entry(cache_font, letter);
+    if (entry != NULL) {
+        dsc_out->bpp = 8;
+        if (entry != s_lru_head) {
+            lru_unlink(entry);
+            lru_push_head(entry);
+        }
+    }
+
+    return true;
+}
+
+static const uint8_t *get_glyph_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    const GlyphCacheFont_t *cache_font = (const GlyphCacheFont_t *)font;
+    const lv_font_t *src = cache_font->src;
+    const uint8_t *bitmap = NULL;
+    GlyphCacheEntry_t *entry = find_entry(cache_font, letter);
+
+    if (entry != NULL) {
+        return entry->bitmap;
+    }
+
+    // Draw this one from the source font, it will be drawn from the cache next time
+    bitmap = src->get_glyph_bitmap(src, letter);
+    if (bitmap != NULL) {
+        add_entry(cache_font, letter, bitmap);
+    }
+
+    return bitmap;
+}
+
+const lv_font_t *esp_brookesia_core_glyph_cache_get_font(const lv_font_t *font)
+{
+    GlyphCacheFont_t *cache_font = NULL;
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(font, NULL, "Invalid font");
+
+    if ((ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB == 0) || (font->get_glyph_dsc == get_glyph_dsc) ||
+            (font->subpx != LV_FONT_SUBPX_NONE)) {
+        return font;
+    }
+    for (int i = 0; i < s_font_num; i++) {
+        if (s_fonts[i].src == font) {
+            return &s_fonts[i].font;
+        }
+    }
+    if (s_font_num >= ESP_BROOKESIA_GLYPH_CACHE_FONT_NUM_MAX) {
+        ESP_BROOKESIA_LOGW("No room for more fonts, draw font(%p) without cache", font);
+        return font;
+    }
+
+    cache_font = &s_fonts[s_font_num++];
+    cache_font->src = font;
+    cache_font->font = *font;
+    cache_font->font.get_glyph_dsc = get_glyph_dsc;
+    cache_font->font.get_glyph_bitmap = get_glyph_bitmap;
+    ESP_BROOKESIA_LOGD("Cache glyphs of font(%p), line height(%d)", font, font->line_height);
+
+    return &cache_font->font;
+}
+
+void esp_brookesia_core_glyph_cache_clear(void)
+{
+    ESP_BROOKESIA_LOGD("Clear glyph cache, used(%d)", (int)s_used_size);
+    while (s_lru_tail != NULL) {
+        free_entry(s_lru_tail);
+    }
+}
+
+size_t esp_brookesia_core_glyph_cache_get_used_size(void)
+{
+    return s_used_size;
+}
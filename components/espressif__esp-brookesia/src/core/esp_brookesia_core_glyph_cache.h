@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_GLYPH_CACHE_FONT_NUM_MAX  (32)
+
+/**
+ * @brief Get a font that draws the glyphs of `font` from a cache of `ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB` in internal
+ *        RAM. Glyphs are expanded once to 8 bpp masks when they are first used, the least recently used ones are
+ *        freed first. The returned font has the same metrics and fallback as `font` and is never freed. Must be
+ *        called with the LVGL lock held.
+ *
+ * @param font Source font, it must stay valid as long as the returned font is used
+ *
+ * @return Font to use, `font` itself if the cache is disabled or no more fonts can be added
+ *
+ */
+const lv_font_t *esp_brookesia_core_glyph_cache_get_font(const lv_font_t *font);
+
+/**
+ * @brief Free all cached glyphs. The fonts got from `esp_brookesia_core_glyph_cache_get_font()` are still valid and
+ *        fill the cache again when drawn. Must be called with the LVGL lock held.
+ *
+ */
+void esp_brookesia_core_glyph_cache_clear(void);
+
+/**
+ * @brief Get the memory used by the cached glyphs
+ *
+ * @return Size in bytes
+ *
+ */
+size_t esp_brookesia_core_glyph_cache_get_used_size(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_glyph_cache.h"
 #include "esp_brookesia_core_home.hpp"
 #include "esp_brookesia_core_app.hpp"
 #include "esp_brookesia_core.hpp"
@@ -363,22 +364,40 @@ bool ESP_Brookesia_CoreHome::updateByNewData(void)
     lv_obj_set_size(_main_screen_obj.get(), screen_size.width, screen_size.height);
     lv_obj_set_size(_system_screen_obj.get(), screen_size.width, screen_size.height);
 
+    // Text
+    _default_size_font_map = _update_size_font_map;
+
+    // Container styles
+    for (size_t i = 0; i < _container_styles.size(); i++) {
+        lv_style_set_outline_width(&_container_styles[i], _core_data.container.styles[i].outline_width);
+    }
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_CoreHome::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update core home theme by new data");
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkCoreInitialized(), false, "Not initialized");
+
     // Background
     lv_obj_set_style_bg_color(_main_screen_obj.get(), lv_color_hex(_core_data.background.color.color), 0);
     lv_obj_set_style_bg_opa(_main_screen_obj.get(), _core_data.background.color.opacity, 0);
     if (_core_data.background.wallpaper_image_resource.resource != nullptr) {
         lv_obj_set_style_bg_img_src(_main_screen_obj.get(), _core_data.background.wallpaper_image_resource.resource, 0);
+    } else {
+        lv_obj_remove_local_style_prop(_main_screen_obj.get(), LV_STYLE_BG_IMG_SRC, 0);
     }
 
-    // Text
-    _default_size_font_map = _update_size_font_map;
-
-    // Container styles
+    // Container styles, shared by most objects, so they are changed in place and refreshed once
     for (size_t i = 0; i < _container_styles.size(); i++) {
-        lv_style_set_outline_width(&_container_styles[i], _core_data.container.styles[i].outline_width);
         lv_style_set_outline_color(&_container_styles[i],
                                    lv_color_hex(_core_data.container.styles[i].outline_color.color));
         lv_style_set_outline_opa(&_container_styles[i], _core_data.container.styles[i].outline_color.opacity);
+        lv_obj_report_style_change(&_container_styles[i]);
     }
 
     return true;
@@ -395,7 +414,8 @@ bool ESP_Brookesia_CoreHome::calibrateCoreData(ESP_Brookesia_CoreHomeData_t &dat
         ESP_BROOKESIA_CHECK_VALUE_RETURN(data.text.default_fonts[i].size_px, ESP_BROOKESIA_STYLE_FONT_SIZE_MIN,
                                          ESP_BROOKESIA_STYLE_FONT_SIZE_MAX, false, "Invalid default font(%d) size", i);
         ESP_BROOKESIA_CHECK_NULL_RETURN(data.text.default_fonts[i].font_resource, false, "Invalid default font(%d) dsc", i);
-        font_resource = (lv_font_t *)data.text.default_fonts[i].font_resource;
+        // Draw the default fonts through the glyph cache, it returns the font itself if the cache is disabled
+        font_resource = esp_brookesia_core_glyph_cache_get_font((const lv_font_t *)data.text.default_fonts[i].font_resource);
         // Save font for function ``
         _update_size_font_map[data.text.default_fonts[i].size_px] = font_resource;
         _update_height_font_map[font_resource->line_height] = font_resource;
@@ -407,6 +427,7 @@ bool ESP_Brookesia_CoreHome::calibrateCoreData(ESP_Brookesia_CoreHomeData_t &dat
             if (!esp_brookesia_core_utils_get_internal_font_by_size(i, &font_resource)) {
                 continue;
             }
+            font_resource = esp_brookesia_core_glyph_cache_get_font(font_resource);
             _update_size_font_map[i] = font_resource;
             if (_update_height_font_map.find(font_resource->line_height) == _update_height_font_map.end()) {
                 _update_height_font_map[font_resource->line_height] = font_resource;
@@ -59,6 +59,7 @@ private:
     bool beginCore(void);
     bool delCore(void);
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
     bool calibrateCoreData(ESP_Brookesia_CoreHomeData_t &data);
 
     const lv_font_t *getCoreUpdateFontBySize(uint8_t size) const;
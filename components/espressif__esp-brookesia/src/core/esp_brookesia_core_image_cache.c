@@ -0,0 +1,222 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_image_cache.h"
+#ifdef ESP_BROOKESIA_MEMORY_INCLUDE
+#include ESP_BROOKESIA_MEMORY_INCLUDE
+#endif
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#endif
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM)
+#define IMAGE_CACHE_MALLOC(size)    heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define IMAGE_CACHE_FREE(ptr)       heap_caps_free(ptr)
+#else
+#define IMAGE_CACHE_MALLOC(size)    ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define IMAGE_CACHE_FREE(ptr)       ESP_BROOKESIA_MEMORY_FREE(ptr)
+#endif
+
+typedef struct {
+    const lv_img_dsc_t *src;
+    lv_img_dsc_t image;
+    uint8_t *buffer;
+    uint32_t last_use;
+    uint16_t ref_count;
+} ImageCacheEntry_t;
+
+static ImageCacheEntry_t s_entries[ESP_BROOKESIA_IMAGE_CACHE_ENTRY_NUM];
+static size_t s_used_size = 0;
+static uint32_t s_use_count = 0;
+
+static void scale_image(const lv_img_dsc_t *src, uint8_t *dst, uint16_t dst_w, uint16_t dst_h)
+{
+    bool has_alpha = (src->header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA);
+    size_t px_size = has_alpha ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    uint32_t src_w = src->header.w;
+    uint32_t src_h = src->header.h;
+    lv_color_t color;
+
+    // Average the source pixels covered by each destination pixel, colors are weighted by their alpha so the
+    // transparent border doesn't darken the edges. Enlarging uses the nearest pixel.
+    for (uint32_t dy = 0; dy < dst_h; dy++) {
+        uint32_t sy_start = dy * src_h / dst_h;
+        uint32_t sy_end = LV_MAX(sy_start + 1, (dy + 1) * src_h / dst_h);
+        for (uint32_t dx = 0; dx < dst_w; dx++) {
+            uint32_t sx_start = dx * src_w / dst_w;
+            uint32_t sx_end = LV_MAX(sx_start + 1, (dx + 1) * src_w / dst_w);
+            uint32_t sum_r = 0;
+            uint32_t sum_g = 0;
+            uint32_t sum_b = 0;
+            uint32_t sum_a = 0;
+            uint32_t num = 0;
+
+            for (uint32_t sy = sy_start; sy < sy_end; sy++) {
+                const uint8_t *px = src->data + (sy * src_w + sx_start) * px_size;
+                for (uint32_t sx = sx_start; sx < sx_end; sx++, px += px_size) {
+                    uint32_t alpha = has_alpha ? px[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] : LV_OPA_COVER;
+                    memcpy(&color, px, sizeof(lv_color_t));
+                    sum_r += LV_COLOR_GET_R(color) * alpha;
+                    sum_g += LV_COLOR_GET_G(color) * alpha;
+                    sum_b += LV_COLOR_GET_B(color) * alpha;
+                    sum_a += alpha;
+                    num++;
+                }
+            }
+
+            color = lv_color_black();
+            if (sum_a > 0) {
+                LV_COLOR_SET_R(color, (sum_r + sum_a / 2) / sum_a);
+                LV_COLOR_SET_G(color, (sum_g + sum_a / 2) / sum_a);
+                LV_COLOR_SET_B(color, (sum_b + sum_a / 2) / sum_a);
+            }
+            memcpy(dst, &color, sizeof(lv_color_t));
+            if (has_alpha) {
+                dst[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] = (uint8_t)((sum_a + num / 2) / num);
+            }
+            dst += px_size;
+        }
+    }
+}
+
+static void free_entry(ImageCacheEntry_t *entry)
+{
+    // LVGL caches decoded images by source pointer, the address of this entry will be used by another image
+    lv_img_cache_invalidate_src(&entry->image);
+    IMAGE_CACHE_FREE(entry->buffer);
+    s_used_size -= entry->image.data_size;
+    memset(entry, 0, sizeof(ImageCacheEntry_t));
+}
+
+static bool reserve_size(size_t size)
+{
+    while (s_used_size + size > (size_t)ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB * 1024) {
+        ImageCacheEntry_t *oldest = NULL;
+        for (int i = 0; i < ESP_BROOKESIA_IMAGE_CACHE_ENTRY_NUM; i++) {
+            ImageCacheEntry_t *entry = &s_entries[i];
+            if ((entry->buffer != NULL) && (entry->ref_count == 0) &&
+                    ((oldest == NULL) || ((int32_t)(entry->last_use - oldest->last_use) < 0))) {
+                oldest = entry;
+            }
+        }
+        if (oldest == NULL) {
+            return false;
+        }
+        ESP_BROOKESIA_LOGD("Free scaled image(%dx%d)", oldest->image.header.w, oldest->image.header.h);
+        free_entry(oldest);
+    }
+
+    return true;
+}
+
+const lv_img_dsc_t *esp_brookesia_core_image_cache_get_fit(const lv_img_dsc_t *src, uint16_t max_w, uint16_t max_h)
+{
+    uint32_t dst_w = 0;
+    uint32_t dst_h = 0;
+    size_t px_size = 0;
+    size_t size = 0;
+    ImageCacheEntry_t *free_slot = NULL;
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(src, NULL, "Invalid source");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((src->header.w > 0) && (src->header.h > 0), NULL, "Invalid source size");
+    if ((max_w == 0) || (max_h == 0)) {
+        return NULL;
+    }
+
+    // Fit the box with the same aspect ratio
+    if ((uint32_t)max_w * src->header.h <= (uint32_t)max_h * src->header.w) {
+        dst_w = max_w;
+        dst_h = LV_MAX(1, ((uint32_t)max_w * src->header.h + src->header.w / 2) / src->header.w);
+    } else {
+        dst_h = max_h;
+        dst_w = LV_MAX(1, ((uint32_t)max_h * src->header.w + src->header.h / 2) / src->header.h);
+    }
+    if ((dst_w == src->header.w) && (dst_h == src->header.h)) {
+        return src;
+    }
+
+    switch (src->header.cf) {
+    case LV_IMG_CF_TRUE_COLOR:
+        px_size = sizeof(lv_color_t);
+        break;
+    case LV_IMG_CF_TRUE_COLOR_ALPHA:
+        px_size = LV_IMG_PX_SIZE_ALPHA_BYTE;
+        break;
+    default:
+        return NULL;
+    }
+    if ((ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB == 0) || (src->data == NULL) ||
+            (src->data_size < (uint32_t)src->header.w * src->header.h * px_size)) {
+        return NULL;
+    }
+
+    s_use_count++;
+    for (int i = 0; i < ESP_BROOKESIA_IMAGE_CACHE_ENTRY_NUM; i++) {
+        ImageCacheEntry_t *entry = &s_entries[i];
+        if (entry->buffer == NULL) {
+            free_slot = (free_slot == NULL) ? entry : free_slot;
+        } else if ((entry->src == src) && (entry->image.header.w == dst_w) && (entry->image.header.h == dst_h)) {
+            entry->ref_count++;
+            entry->last_use = s_use_count;
+            return &entry->image;
+        }
+    }
+
+    size = dst_w * dst_h * px_size;
+    if ((free_slot == NULL) || !reserve_size(size)) {
+        ESP_BROOKESIA_LOGD("No room for scaled image(%dx%d)", (int)dst_w, (int)dst_h);
+        return NULL;
+    }
+    free_slot->buffer = (uint8_t *)IMAGE_CACHE_MALLOC(size);
+    if (free_slot->buffer == NULL) {
+        ESP_BROOKESIA_LOGD("Alloc scaled image(%dx%d) failed", (int)dst_w, (int)dst_h);
+        return NULL;
+    }
+    scale_image(src, free_slot->buffer, dst_w, dst_h);
+
+    free_slot->src = src;
+    free_slot->image.header = src->header;
+    free_slot->image.header.w = dst_w;
+    free_slot->image.header.h = dst_h;
+    free_slot->image.data_size = size;
+    free_slot->image.data = free_slot->buffer;
+    free_slot->ref_count = 1;
+    free_slot->last_use = s_use_count;
+    s_used_size += size;
+    ESP_BROOKESIA_LOGD("Scale image(%dx%d -> %dx%d), cache used(%d)", src->header.w, src->header.h, (int)dst_w,
+                       (int)dst_h, (int)s_used_size);
+
+    return &free_slot->image;
+}
+
+void esp_brookesia_core_image_cache_release(const lv_img_dsc_t *image)
+{
+    if (image == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < ESP_BROOKESIA_IMAGE_CACHE_ENTRY_NUM; i++) {
+        ImageCacheEntry_t *entry = &s_entries[i];
+        if ((entry->buffer != NULL) && (&entry->image == image)) {
+            if (entry->ref_count > 0) {
+                entry->ref_count--;
+            }
+            return;
+        }
+    }
+}
+
+size_t esp_brookesia_core_image_cache_get_used_size(void)
+{
+    return s_used_size;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_IMAGE_CACHE_ENTRY_NUM  (48)
+
+/**
+ * @brief Get a copy of an image scaled to the largest size that fits in `max_w` x `max_h` with the same aspect
+ *        ratio, so it can be drawn without zoom. Scaled copies are shared and kept in a cache of
+ *        `ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB`, the least recently used unreferenced ones are freed first. Must be
+ *        called with the LVGL lock held.
+ *
+ * @param src Source image, only `LV_IMG_CF_TRUE_COLOR` and `LV_IMG_CF_TRUE_COLOR_ALPHA` variables are supported
+ * @param max_w Maximum width
+ * @param max_h Maximum height
+ *
+ * @return Image to draw (`src` itself if it already has that size), or NULL if it can't be scaled, then the caller
+ *         should zoom `src` instead. Release it with `esp_brookesia_core_image_cache_release()`.
+ *
+ */
+const lv_img_dsc_t *esp_brookesia_core_image_cache_get_fit(const lv_img_dsc_t *src, uint16_t max_w, uint16_t max_h);
+
+/**
+ * @brief Release an image got from `esp_brookesia_core_image_cache_get_fit()`. Does nothing for NULL or images that
+ *        are not in the cache.
+ *
+ * @param image Image to release
+ *
+ */
+void esp_brookesia_core_image_cache_release(const lv_img_dsc_t *image);
+
+/**
+ * @brief Get the memory used by the scaled images in the cache
+ *
+ * @return Size in bytes
+ *
+ */
+size_t esp_brookesia_core_image_cache_get_used_size(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,285 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_image_card.h"
+#ifdef ESP_BROOKESIA_MEMORY_INCLUDE
+#include ESP_BROOKESIA_MEMORY_INCLUDE
+#endif
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "soc/soc_caps.h"
+#endif
+
+#if defined(ESP_PLATFORM) && SOC_PPA_SUPPORTED && (LV_COLOR_DEPTH == 16) && !LV_COLOR_16_SWAP
+#define CARD_USE_PPA                (1)
+#include "esp_cache.h"
+#include "driver/ppa.h"
+#else
+#define CARD_USE_PPA                (0)
+#endif
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM)
+#define CARD_MALLOC(size)           heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define CARD_FREE(ptr)              heap_caps_free(ptr)
+#else
+#define CARD_MALLOC(size)           ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define CARD_FREE(ptr)              ESP_BROOKESIA_MEMORY_FREE(ptr)
+#endif
+
+#if CARD_USE_PPA
+// PPA scaling factors have a 1/16 precision
+#define CARD_PPA_SCALE_STEP         (16)
+// The PPA writes the scaled image through the cache, its buffer must cover whole cache lines
+#ifdef CONFIG_CACHE_L2_CACHE_LINE_SIZE
+#define CARD_PPA_ALIGN              (CONFIG_CACHE_L2_CACHE_LINE_SIZE)
+#else
+#define CARD_PPA_ALIGN              (128)
+#endif
+#ifdef CONFIG_SPIRAM
+#define CARD_PPA_CAPS               (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define CARD_PPA_CAPS               (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT)
+#endif
+
+static ppa_client_handle_t s_ppa = NULL;
+#endif
+
+static lv_color_t sample_pixel(const lv_img_dsc_t *src, uint32_t dx, uint32_t dy, uint32_t dst_w, uint32_t dst_h)
+{
+    uint32_t src_w = src->header.w;
+    uint32_t src_h = src->header.h;
+    uint32_t sy_start = dy * src_h / dst_h;
+    uint32_t sy_end = LV_MAX(sy_start + 1, (dy + 1) * src_h / dst_h);
+    uint32_t sx_start = dx * src_w / dst_w;
+    uint32_t sx_end = LV_MAX(sx_start + 1, (dx + 1) * src_w / dst_w);
+    uint32_t sum_r = 0;
+    uint32_t sum_g = 0;
+    uint32_t sum_b = 0;
+    uint32_t num = 0;
+    lv_color_t color;
+
+    // Average the source pixels covered by the destination pixel, enlarging uses the nearest pixel
+    for (uint32_t sy = sy_start; sy < sy_end; sy++) {
+        const lv_color_t *px = (const lv_color_t *)src->data + sy * src_w + sx_start;
+        for (uint32_t sx = sx_start; sx < sx_end; sx++, px++) {
+            sum_r += LV_COLOR_GET_R(*px);
+            sum_g += LV_COLOR_GET_G(*px);
+            sum_b += LV_COLOR_GET_B(*px);
+            num++;
+        }
+    }
+
+    color = lv_color_black();
+    LV_COLOR_SET_R(color, (sum_r + num / 2) / num);
+    LV_COLOR_SET_G(color, (sum_g + num / 2) / num);
+    LV_COLOR_SET_B(color, (sum_b + num / 2) / num);
+
+    return color;
+}
+
+static lv_opa_t corner_opa(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t radius)
+{
+    float center_x = 0;
+    float center_y = 0;
+    float coverage = 0;
+
+    if (x < radius) {
+        center_x = radius;
+    } else if (x >= w - radius) {
+        center_x = w - radius;
+    } else {
+        return LV_OPA_COVER;
+    }
+    if (y < radius) {
+        center_y = radius;
+    } else if (y >= h - radius) {
+        center_y = h - radius;
+    } else {
+        return LV_OPA_COVER;
+    }
+
+    // Coverage of the pixel by the corner circle, from the distance of its center to the edge
+    coverage = radius + 0.5f - hypotf(x + 0.5f - center_x, y + 0.5f - center_y);
+    if (coverage <= 0) {
+        return LV_OPA_TRANSP;
+    }
+    if (coverage >= 1) {
+        return LV_OPA_COVER;
+    }
+
+    return (lv_opa_t)(coverage * LV_OPA_COVER + 0.5f);
+}
+
+#if CARD_USE_PPA
+static lv_color_t *ppa_scale(const lv_img_dsc_t *src, uint32_t *width, uint32_t *height)
+{
+    float scale = LV_MIN((float)*width / src->header.w, (float)*height / src->header.h);
+    uint32_t out_w = 0;
+    uint32_t out_h = 0;
+    size_t size = 0;
+    void *buffer = NULL;
+    esp_err_t ret = ESP_OK;
+
+    scale = (float)((int)(scale * CARD_PPA_SCALE_STEP)) / CARD_PPA_SCALE_STEP;
+    out_w = (uint32_t)(src->header.w * scale);
+    out_h = (uint32_t)(src->header.h * scale);
+    if ((out_w == 0) || (out_h == 0)) {
+        return NULL;
+    }
+
+    if (s_ppa == NULL) {
+        ppa_client_config_t config = {
+            .oper_type = PPA_OPERATION_SRM,
+        };
+        ret = ppa_register_client(&config, &s_ppa);
+        ESP_BROOKESIA_CHECK_FALSE_RETURN(ret == ESP_OK, NULL, "Register PPA client failed(%d)", ret);
+    }
+
+    size = (out_w * out_h * sizeof(lv_color_t) + CARD_PPA_ALIGN - 1) & ~(CARD_PPA_ALIGN - 1);
+    buffer = heap_caps_aligned_calloc(CARD_PPA_ALIGN, 1, size, CARD_PPA_CAPS);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(buffer, NULL, "Alloc PPA buffer(%d) failed", (int)size);
+
+    // The CPU wrote the source, the PPA reads it from memory. The sync fails for images in flash, they are read as is
+    esp_cache_msync((void *)src->data, src->data_size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+
+    ppa_srm_oper_config_t srm_config = {
+        .in = {
+            .buffer = src->data,
+            .pic_w = src->header.w,
+            .pic_h = src->header.h,
+            .block_w = src->header.w,
+            .block_h = src->header.h,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .out = {
+            .buffer = buffer,
+            .buffer_size = size,
+            .pic_w = out_w,
+            .pic_h = out_h,
+            .srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+        },
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = scale,
+        .scale_y = scale,
+        .mode = PPA_TRANS_MODE_BLOCKING,
+    };
+    ret = ppa_do_scale_rotate_mirror(s_ppa, &srm_config);
+    if (ret != ESP_OK) {
+        ESP_BROOKESIA_LOGE("PPA scale failed(%d)", ret);
+        heap_caps_free(buffer);
+        return NULL;
+    }
+
+    *width = out_w;
+    *height = out_h;
+
+    return (lv_color_t *)buffer;
+}
+#endif
+
+lv_img_dsc_t *esp_brookesia_core_image_card_create(uint16_t width, uint16_t height)
+{
+    uint32_t size = (uint32_t)width * height * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    lv_img_dsc_t *card = NULL;
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((width > 0) && (height > 0), NULL, "Invalid card size");
+
+    // The pixels follow the descriptor in the same allocation
+    card = (lv_img_dsc_t *)CARD_MALLOC(sizeof(lv_img_dsc_t) + size);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(card, NULL, "Alloc card(%dx%d) failed", width, height);
+
+    memset(card, 0, sizeof(lv_img_dsc_t));
+    card->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    card->header.w = width;
+    card->header.h = height;
+    card->data_size = size;
+    card->data = (const uint8_t *)(card + 1);
+    memset((uint8_t *)card->data, 0, size);
+
+    return card;
+}
+
+bool esp_brookesia_core_image_card_render(lv_img_dsc_t *card, const lv_img_dsc_t *src, uint16_t radius)
+{
+    uint32_t card_w = 0;
+    uint32_t card_h = 0;
+    uint32_t scaled_w = 0;
+    uint32_t scaled_h = 0;
+    uint32_t offset_x = 0;
+    lv_color_t *scaled = NULL;
+    lv_color_t color;
+    uint8_t *dst = NULL;
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(card, false, "Invalid card");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(src, false, "Invalid source");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(card->header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA, false, "Invalid card format");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((src->header.cf == LV_IMG_CF_TRUE_COLOR) && (src->data != NULL) &&
+                                     (src->header.w > 0) && (src->header.h > 0) &&
+                                     (src->data_size >= (uint32_t)src->header.w * src->header.h * sizeof(lv_color_t)),
+                                     false, "Unsupported source");
+
+    card_w = card->header.w;
+    card_h = card->header.h;
+    radius = LV_MIN(radius, LV_MIN(card_w, card_h) / 2);
+
+    // Fit the card with the same aspect ratio, like the zoom of the image it replaces
+    if (card_w * src->header.h <= card_h * src->header.w) {
+        scaled_w = card_w;
+        scaled_h = LV_MIN(card_h, LV_MAX(1, (card_w * src->header.h + src->header.w / 2) / src->header.w));
+    } else {
+        scaled_h = card_h;
+        scaled_w = LV_MIN(card_w, LV_MAX(1, (card_h * src->header.w + src->header.h / 2) / src->header.h));
+    }
+#if CARD_USE_PPA
+    scaled = ppa_scale(src, &scaled_w, &scaled_h);
+#endif
+    offset_x = (card_w - scaled_w) / 2;
+    ESP_BROOKESIA_LOGD("Render card(%dx%d) from image(%dx%d) %s", (int)card_w, (int)card_h, src->header.w,
+                       src->header.h, (scaled != NULL) ? "by PPA" : "by CPU");
+
+    dst = (uint8_t *)card->data;
+    for (uint32_t y = 0; y < card_h; y++) {
+        for (uint32_t x = 0; x < card_w; x++, dst += LV_IMG_PX_SIZE_ALPHA_BYTE) {
+            if ((y >= scaled_h) || (x < offset_x) || (x >= offset_x + scaled_w)) {
+                memset(dst, 0, LV_IMG_PX_SIZE_ALPHA_BYTE);
+                continue;
+            }
+            if (scaled != NULL) {
+                color = scaled[y * scaled_w + x - offset_x];
+            } else {
+                color = sample_pixel(src, x - offset_x, y, scaled_w, scaled_h);
+            }
+            memcpy(dst, &color, sizeof(lv_color_t));
+            dst[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] = corner_opa(x, y, card_w, card_h, radius);
+        }
+    }
+#if CARD_USE_PPA
+    heap_caps_free(scaled);
+#endif
+
+    // LVGL caches decoded images by source pointer
+    lv_img_cache_invalidate_src(card);
+
+    return true;
+}
+
+void esp_brookesia_core_image_card_del(lv_img_dsc_t *card)
+{
+    if (card == NULL) {
+        return;
+    }
+
+    lv_img_cache_invalidate_src(card);
+    CARD_FREE(card);
+}
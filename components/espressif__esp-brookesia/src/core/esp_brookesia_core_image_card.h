@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a card, an `LV_IMG_CF_TRUE_COLOR_ALPHA` image filled by `esp_brookesia_core_image_card_render()`.
+ *        The card is in PSRAM if it is enabled.
+ *
+ * @param width Card width
+ * @param height Card height
+ *
+ * @return Card, or NULL if the allocation failed. Delete it with `esp_brookesia_core_image_card_del()`.
+ *
+ */
+lv_img_dsc_t *esp_brookesia_core_image_card_create(uint16_t width, uint16_t height);
+
+/**
+ * @brief Render an image into a card as the recents screen shows it: scaled to the largest size that fits the card
+ *        with the same aspect ratio, aligned to the top middle and clipped to the card with rounded corners. The
+ *        corners are antialiased in the alpha channel and the pixels not covered by the image are transparent, so
+ *        the card is drawn without zoom or corner clipping. The image is scaled by the PPA if the chip has one.
+ *        Must be called with the LVGL lock held.
+ *
+ * @param card Card to render into
+ * @param src Source image, only `LV_IMG_CF_TRUE_COLOR` variables are supported
+ * @param radius Corner radius
+ *
+ * @return true if the card was rendered
+ *
+ */
+bool esp_brookesia_core_image_card_render(lv_img_dsc_t *card, const lv_img_dsc_t *src, uint16_t radius);
+
+/**
+ * @brief Delete a card. Does nothing for NULL.
+ *
+ * @param card Card to delete
+ *
+ */
+void esp_brookesia_core_image_card_del(lv_img_dsc_t *card);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,370 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include "lvgl.h"
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_log.h"
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+#if (ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM & (ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM - 1)) != 0
+#error "`ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM` must be a power of 2"
+#endif
+
+#define RECORD_INDEX_MASK       (ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM - 1)
+#define LINE_LEN_MAX            (256)
+#define SPEC_LEN_MAX            (24)
+#define TASK_STACK_SIZE         (4 * 1024)
+#define TASK_IDLE_DELAY_MS      (20)
+
+typedef struct {
+    uint32_t seq;               /*!< Position the slot can be written at, or that position + 1 once written, minus
+                                     the index of the slot so that zeroed slots are free for the first lap */
+    ESP_Brookesia_CoreLogSite_t *site;
+    uint32_t time_ms;
+    uint8_t arg_num;
+    uintptr_t args[ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX];
+    char str[ESP_BROOKESIA_LOG_DEFERRED_STR_LEN];
+} CoreLogRecord_t;
+
+static CoreLogRecord_t s_records[ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM];
+static uint32_t s_write_pos = 0;
+static uint32_t s_read_pos = 0;
+static uint32_t s_dropped_num = 0;
+static int s_reader_lock = 0;
+#if defined(ESP_PLATFORM)
+static TaskHandle_t s_task = NULL;
+#endif
+
+static uint32_t get_seq(uint32_t pos)
+{
+    return __atomic_load_n(&s_records[pos & RECORD_INDEX_MASK].seq, __ATOMIC_ACQUIRE) + (pos & RECORD_INDEX_MASK);
+}
+
+static void set_seq(uint32_t pos, uint32_t seq)
+{
+    __atomic_store_n(&s_records[pos & RECORD_INDEX_MASK].seq, seq - (pos & RECORD_INDEX_MASK), __ATOMIC_RELEASE);
+}
+
+static uint32_t get_time_ms(void)
+{
+    return lv_tick_get();
+}
+
+/* Skip the flags, width, precision and length of a conversion, return the conversion char */
+static const char *parse_spec(const char *p, int *star_num)
+{
+    *star_num = 0;
+    while (*p && strchr("-+ #0123456789.*hljztL", *p)) {
+        if (*p == '*') {
+            (*star_num)++;
+        }
+        p++;
+    }
+
+    return p;
+}
+
+static int16_t parse_str_arg_mask(const char *format)
+{
+    int16_t mask = 0;
+    int arg_index = 0;
+    int star_num = 0;
+
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        if (*(p + 1) == '%') {
+            p++;
+            continue;
+        }
+        p = parse_spec(p + 1, &star_num);
+        arg_index += star_num;
+        if (*p == '\0') {
+            break;
+        }
+        if ((*p == 's') && (arg_index < ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX)) {
+            mask |= 1 << arg_index;
+        }
+        arg_index++;
+    }
+
+    return mask;
+}
+
+static void format_record(const CoreLogRecord_t *record, char *buf, size_t size)
+{
+    const char *format = record->site->format;
+    char spec[SPEC_LEN_MAX];
+    size_t len = 0;
+    int arg_index = 0;
+    int star_num = 0;
+
+    // Each conversion is formatted on its own, with the argument cast back to the type it expects
+    for (const char *p = format; *p && (len + 1 < size);) {
+        if ((*p != '%') || (*(p + 1) == '%')) {
+            buf[len++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
+
+        const char *end = parse_spec(p + 1, &star_num);
+        if (*end == '\0') {
+            break;
+        }
+        size_t spec_len = 0;
+        for (const char *q = p; (q <= end) && (spec_len + 12 < sizeof(spec)); q++) {
+            if ((*q == '*') && (arg_index < record->arg_num)) {
+                spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", (int)record->args[arg_index++]);
+            } else if (*q != '*') {
+                spec[spec_len++] = *q;
+            }
+        }
+        spec[spec_len] = '\0';
+        p = end + 1;
+
+        int ret = 0;
+        if (arg_index >= record->arg_num) {
+            ret = snprintf(buf + len, size - len, "<?>");
+        } else {
+            uintptr_t arg = record->args[arg_index++];
+            switch (*end) {
+            case 's':
+                ret = snprintf(buf + len, size - len, spec, (const char *)arg);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                uint32_t bits = (uint32_t)arg;
+                float value = 0;
+                memcpy(&value, &bits, sizeof(value));
+                ret = snprintf(buf + len, size - len, spec, (double)value);
+                break;
+            }
+            case 'p':
+                ret = snprintf(buf + len, size - len, spec, (void *)arg);
+                break;
+            default:
+                if (strstr(spec, "ll") || strchr(spec, 'j')) {
+                    ret = snprintf(buf + len, size - len, spec, (unsigned long long)arg);
+                } else {
+                    ret = snprintf(buf + len, size - len, spec, (unsigned long)arg);
+                }
+                break;
+            }
+        }
+        if (ret < 0) {
+            break;
+        }
+        len += ((size_t)ret < size - len) ? (size_t)ret : size - len - 1;
+    }
+    buf[len] = '\0';
+}
+
+static void print_record(const CoreLogRecord_t *record, const char *msg)
+{
+    const ESP_Brookesia_CoreLogSite_t *site = record->site;
+    const char *file = esp_brookesia_core_utils_path_to_file_name(site->file);
+
+#if ESP_BROOKESIA_LOG_STYLE == ESP_BROOKESIA_LOG_STYLE_STD
+    const char *level_str[] = {"[DEBUG]", "[INFO] ", "[WARN] ", "[ERROR]"};
+    printf("%s[%s:%d](%s)<%u>: %s\n", level_str[site->level], file, site->line, site->func,
+           (unsigned)record->time_ms, msg);
+#elif ESP_BROOKESIA_LOG_STYLE == ESP_BROOKESIA_LOG_STYLE_ESP
+    const esp_log_level_t level_esp[] = {ESP_LOG_DEBUG, ESP_LOG_INFO, ESP_LOG_WARN, ESP_LOG_ERROR};
+    // The time of the write, the one printed by ESP log is the time of the drain
+    ESP_LOG_LEVEL_LOCAL(level_esp[site->level], ESP_BROOKESIA_TAG, "[%s:%d](%s)<%u>%s", file, site->line, site->func,
+                        (unsigned)record->time_ms, msg);
+#elif ESP_BROOKESIA_LOG_STYLE == ESP_BROOKESIA_LOG_STYLE_LVGL
+    LV_UNUSED(file);
+    switch (site->level) {
+    case ESP_BROOKESIA_LOG_LEVEL_DEBUG:
+        LV_LOG_TRACE("%s", msg);
+        break;
+    case ESP_BROOKESIA_LOG_LEVEL_INFO:
+        LV_LOG_INFO("%s", msg);
+        break;
+    case ESP_BROOKESIA_LOG_LEVEL_WARN:
+        LV_LOG_WARN("%s", msg);
+        break;
+    default:
+        LV_LOG_ERROR("%s", msg);
+        break;
+    }
+#endif
+}
+
+/* Single reader, `s_reader_lock` keeps `flush()` and the task apart */
+static bool read_record(CoreLogRecord_t *record)
+{
+    CoreLogRecord_t *slot = &s_records[s_read_pos & RECORD_INDEX_MASK];
+
+    if (get_seq(s_read_pos) != s_read_pos + 1) {
+        return false;
+    }
+    memcpy(record, slot, sizeof(CoreLogRecord_t));
+    // Strings are referenced by offsets into the slot
+    for (int i = 0; i < record->arg_num; i++) {
+        if (record->site->str_arg_mask & (1 << i)) {
+            record->args[i] = (uintptr_t)&record->str[record->args[i]];
+        }
+    }
+    set_seq(s_read_pos, s_read_pos + ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM);
+    s_read_pos++;
+
+    return true;
+}
+
+static int drain(void)
+{
+    static char line[LINE_LEN_MAX];
+    static uint32_t reported_dropped_num = 0;
+    CoreLogRecord_t record;
+    int num = 0;
+
+    if (__atomic_exchange_n(&s_reader_lock, 1, __ATOMIC_ACQUIRE) != 0) {
+        return 0;
+    }
+    while (read_record(&record)) {
+        format_record(&record, line, sizeof(line));
+        print_record(&record, line);
+        num++;
+    }
+    uint32_t dropped_num = __atomic_load_n(&s_dropped_num, __ATOMIC_RELAXED);
+    if (dropped_num != reported_dropped_num) {
+        printf("[WARN] [esp-brookesia] %u deferred logs dropped, ring full\n",
+               (unsigned)(dropped_num - reported_dropped_num));
+        reported_dropped_num = dropped_num;
+    }
+    __atomic_store_n(&s_reader_lock, 0, __ATOMIC_RELEASE);
+
+    return num;
+}
+
+#if defined(ESP_PLATFORM)
+static void log_task(void *arg)
+{
+    while (1) {
+        // Woken by the writers, the delay only bounds the wait if a notification is missed
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TASK_IDLE_DELAY_MS * 50));
+        while (drain() > 0) {
+            vTaskDelay(pdMS_TO_TICKS(TASK_IDLE_DELAY_MS));
+        }
+    }
+}
+#endif
+#endif /* ESP_BROOKESIA_LOG_DEFERRED_ENABLE */
+
+void esp_brookesia_core_log_write(ESP_Brookesia_CoreLogSite_t *site, const uintptr_t *args, int arg_num)
+{
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+    int16_t str_arg_mask = __atomic_load_n(&site->str_arg_mask, __ATOMIC_RELAXED);
+    if (str_arg_mask < 0) {
+        // Concurrent writers parse the same format to the same value
+        str_arg_mask = parse_str_arg_mask(site->format);
+        __atomic_store_n(&site->str_arg_mask, str_arg_mask, __ATOMIC_RELAXED);
+    }
+    if (arg_num > ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX) {
+        arg_num = ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX;
+    }
+
+    // Bounded multi-producer queue: claim a position whose slot has been read, then publish it with `seq`
+    CoreLogRecord_t *slot = NULL;
+    uint32_t pos = __atomic_load_n(&s_write_pos, __ATOMIC_RELAXED);
+    while (1) {
+        slot = &s_records[pos & RECORD_INDEX_MASK];
+        int32_t diff = (int32_t)(get_seq(pos) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&s_write_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&s_dropped_num, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&s_write_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    size_t str_len = 0;
+    slot->site = site;
+    slot->time_ms = get_time_ms();
+    slot->arg_num = arg_num;
+    for (int i = 0; i < arg_num; i++) {
+        if (!(str_arg_mask & (1 << i))) {
+            slot->args[i] = args[i];
+            continue;
+        }
+        // Copy the string, the caller's buffer may be gone when the log is printed
+        const char *str = (const char *)args[i];
+        if (str_len >= sizeof(slot->str)) {
+            // No room left, points to the end of the previous string
+            slot->args[i] = sizeof(slot->str) - 1;
+            continue;
+        }
+        size_t len = str ? strnlen(str, sizeof(slot->str) - str_len - 1) : 0;
+        if (len > 0) {
+            memcpy(&slot->str[str_len], str, len);
+        }
+        slot->str[str_len + len] = '\0';
+        slot->args[i] = str_len;
+        str_len += len + 1;
+    }
+    set_seq(pos, pos + 1);
+
+#if defined(ESP_PLATFORM)
+    TaskHandle_t task = __atomic_load_n(&s_task, __ATOMIC_ACQUIRE);
+    if ((task != NULL) && (xPortInIsrContext() == pdFALSE)) {
+        xTaskNotifyGive(task);
+    }
+#endif
+#else
+    (void)site;
+    (void)args;
+    (void)arg_num;
+#endif /* ESP_BROOKESIA_LOG_DEFERRED_ENABLE */
+}
+
+bool esp_brookesia_core_log_begin(void)
+{
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE && defined(ESP_PLATFORM)
+    if (s_task != NULL) {
+        return true;
+    }
+
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(log_task, "brookesia_log", TASK_STACK_SIZE, NULL, ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY,
+                    &task) != pdPASS) {
+        printf("[ERROR][esp-brookesia] Create deferred log task failed\n");
+        return false;
+    }
+    __atomic_store_n(&s_task, task, __ATOMIC_RELEASE);
+    xTaskNotifyGive(task);
+#endif
+
+    return true;
+}
+
+int esp_brookesia_core_log_flush(void)
+{
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+    return drain();
+#else
+    return 0;
+#endif
+}
+
+uint32_t esp_brookesia_core_log_get_dropped_num(void)
+{
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+    return __atomic_load_n(&s_dropped_num, __ATOMIC_RELAXED);
+#else
+    return 0;
+#endif
+}
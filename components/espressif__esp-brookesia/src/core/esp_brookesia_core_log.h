@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX  (12)
+
+/**
+ * Call site of a deferred log. It is a static variable of the site, its address is the ID of the log in the ring.
+ *
+ */
+typedef struct {
+    const char *format;
+    const char *file;
+    const char *func;
+    int line;
+    uint8_t level;
+    int16_t str_arg_mask;       /*!< Bit of each `%s` argument, -1 until the first write parses `format` */
+} ESP_Brookesia_CoreLogSite_t;
+
+/**
+ * @brief Store a log in the deferred ring. Never blocks and can be called from any task or ISR, the log is dropped
+ *        if the ring is full.
+ *
+ * Arguments are stored as raw words. The strings of `%s` arguments are copied and truncated to
+ * `ESP_BROOKESIA_LOG_DEFERRED_STR_LEN - 1` chars in all, `float` and `double` arguments are stored as `float` when
+ * written from C++ and are not supported from C, 64-bit arguments are truncated.
+ *
+ * @param site Call site of the log
+ * @param args Arguments of `format`
+ * @param arg_num Number of arguments, at most `ESP_BROOKESIA_CORE_LOG_ARG_NUM_MAX`
+ *
+ */
+void esp_brookesia_core_log_write(ESP_Brookesia_CoreLogSite_t *site, const uintptr_t *args, int arg_num);
+
+/**
+ * @brief Start the task printing the deferred logs. Logs written before are kept in the ring and printed once it
+ *        runs. Does nothing without FreeRTOS, call `esp_brookesia_core_log_flush()` instead.
+ *
+ * @return true if success or already started, otherwise false
+ *
+ */
+bool esp_brookesia_core_log_begin(void);
+
+/**
+ * @brief Print the logs in the ring from the calling task, e.g. before a restart
+ *
+ * @return Number of printed logs
+ *
+ */
+int esp_brookesia_core_log_flush(void);
+
+/**
+ * @brief Get the number of logs dropped because the ring was full, since the start
+ *
+ */
+uint32_t esp_brookesia_core_log_get_dropped_num(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+static inline uintptr_t esp_brookesia_core_log_arg(float value)
+{
+    uint32_t bits = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits;
+}
+
+static inline uintptr_t esp_brookesia_core_log_arg(double value)
+{
+    return esp_brookesia_core_log_arg((float)value);
+}
+
+template <typename T>
+static inline uintptr_t esp_brookesia_core_log_arg(T value)
+{
+    return (uintptr_t)value;
+}
+
+#define _CORE_LOG_ARG(x)    esp_brookesia_core_log_arg(x)
+#else
+#define _CORE_LOG_ARG(x)    ((uintptr_t)(x))
+#endif
+
+#define _CORE_LOG_ARG_NUM(...) _CORE_LOG_ARG_NUM_(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _CORE_LOG_ARG_NUM_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+#define _CORE_LOG_CAT(a, b)     _CORE_LOG_CAT_(a, b)
+#define _CORE_LOG_CAT_(a, b)    a##b
+
+#define _CORE_LOG_ARGS_0()
+#define _CORE_LOG_ARGS_1(a)         , _CORE_LOG_ARG(a)
+#define _CORE_LOG_ARGS_2(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_1(__VA_ARGS__)
+#define _CORE_LOG_ARGS_3(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_2(__VA_ARGS__)
+#define _CORE_LOG_ARGS_4(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_3(__VA_ARGS__)
+#define _CORE_LOG_ARGS_5(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_4(__VA_ARGS__)
+#define _CORE_LOG_ARGS_6(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_5(__VA_ARGS__)
+#define _CORE_LOG_ARGS_7(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_6(__VA_ARGS__)
+#define _CORE_LOG_ARGS_8(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_7(__VA_ARGS__)
+#define _CORE_LOG_ARGS_9(a, ...)    , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_8(__VA_ARGS__)
+#define _CORE_LOG_ARGS_10(a, ...)   , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_9(__VA_ARGS__)
+#define _CORE_LOG_ARGS_11(a, ...)   , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_10(__VA_ARGS__)
+#define _CORE_LOG_ARGS_12(a, ...)   , _CORE_LOG_ARG(a) _CORE_LOG_ARGS_11(__VA_ARGS__)
+#define _CORE_LOG_ARGS(...)     _CORE_LOG_CAT(_CORE_LOG_ARGS_, _CORE_LOG_ARG_NUM(__VA_ARGS__))(__VA_ARGS__)
+
+/**
+ * @brief Store a log in the deferred ring, only the ID of the call site and the raw arguments are copied. See
+ *        `esp_brookesia_core_log_write()` for the supported arguments.
+ *
+ */
+#define ESP_BROOKESIA_CORE_LOG_DEFER(level, format, ...) do {                                       \
+        static ESP_Brookesia_CoreLogSite_t _site = {format, __FILE__, __func__, __LINE__, level, -1}; \
+        const uintptr_t _args[] = {0 _CORE_LOG_ARGS(__VA_ARGS__)};                                   \
+        esp_brookesia_core_log_write(&_site, _args + 1, _CORE_LOG_ARG_NUM(__VA_ARGS__));             \
+    } while(0)
@@ -4,9 +4,13 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <cmath>
+#include <cstring>
+#include "esp_timer.h"
 #include "esp_brookesia_core_manager.hpp"
 #include "esp_brookesia_core.hpp"
 #include "esp_brookesia_conf_internal.h"
+#include "esp_brookesia_core_boot_profile.h"
+#include "esp_brookesia_core_app_state.h"
 #ifdef ESP_BROOKESIA_MEMORY_INCLUDE
 #include ESP_BROOKESIA_MEMORY_INCLUDE
 #endif
@@ -16,6 +20,25 @@
 #define ESP_BROOKESIA_LOGD(...)
 #endif
 
+#define SNAPSHOT_STRIP_HEIGHT       (32)
+#define SNAPSHOT_POOL_SLOT_NUM_MAX  (32)
+#define LAZY_INIT_CHECK_PERIOD_MS   (1000)
+
+#include "esp_heap_caps.h"
+
+#if ESP_BROOKESIA_MEMORY_APP_SNAPSHOT == 0
+#define SNAPSHOT_POOL_MALLOC(size)  ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define SNAPSHOT_POOL_FREE(ptr)     ESP_BROOKESIA_MEMORY_FREE(ptr)
+#else
+#if ESP_BROOKESIA_MEMORY_APP_SNAPSHOT == 1
+#define SNAPSHOT_POOL_CAPS          (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define SNAPSHOT_POOL_CAPS          (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+#define SNAPSHOT_POOL_MALLOC(size)  heap_caps_malloc(size, SNAPSHOT_POOL_CAPS)
+#define SNAPSHOT_POOL_FREE(ptr)     heap_caps_free(ptr)
+#endif
+
 using namespace std;
 
 ESP_Brookesia_CoreManager::ESP_Brookesia_CoreManager(ESP_Brookesia_Core &core, const ESP_Brookesia_CoreManagerData_t &data):
@@ -23,6 +46,11 @@ ESP_Brookesia_CoreManager::ESP_Brookesia_CoreManager(ESP_Brookesia_Core &core, c
     _core_data(data),
     _app_free_id(0),
     _active_app(nullptr),
+    _app_snapshot_fit_size{},
+    _app_snapshot_pool{},
+    _app_snapshot_time_us(-1),
+    _memory_check_timer(nullptr),
+    _lazy_init_timer(nullptr),
     _navigate_type(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_MAX)
 {
 }
@@ -41,6 +69,8 @@ int ESP_Brookesia_CoreManager::installApp(ESP_Brookesia_CoreApp *app)
     bool home_process_app_installed = false;
     lv_area_t app_visual_area = {};
     ESP_Brookesia_CoreHome &home = _core._core_home;
+    char profile_name[ESP_BROOKESIA_BOOT_PROFILE_NAME_LEN_MAX];
+    int profile_span = -1;
 
     ESP_BROOKESIA_CHECK_NULL_RETURN(app, -1, "Invalid app");
 
@@ -51,6 +81,9 @@ int ESP_Brookesia_CoreManager::installApp(ESP_Brookesia_CoreApp *app)
         ESP_BROOKESIA_CHECK_FALSE_RETURN(it->second != app, -1, "Already installed");
     }
 
+    snprintf(profile_name, sizeof(profile_name), "install %s", app->getName());
+    profile_span = esp_brookesia_core_boot_profile_begin(profile_name);
+
     // Initialize app
     ESP_BROOKESIA_CHECK_FALSE_GOTO(app_installed = app->processInstall(&_core, _app_free_id), err, "App install failed");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(home.getAppVisualArea(app, app_visual_area), err, "Home get app visual area failed");
@@ -68,9 +101,12 @@ int ESP_Brookesia_CoreManager::installApp(ESP_Brookesia_CoreApp *app)
     // Update free app id
     _app_free_id++;
 
+    esp_brookesia_core_boot_profile_end(profile_span);
+
     return app->getId();
 
 err:
+    esp_brookesia_core_boot_profile_end(profile_span);
     if (home_process_app_installed && !home.processAppUninstall(app)) {
         ESP_BROOKESIA_LOGE("Home process app uninstall failed");
     }
@@ -117,6 +153,7 @@ int ESP_Brookesia_CoreManager::uninstallApp(ESP_Brookesia_CoreApp *app)
 
     // Remove app from installed_app_map
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_id_installed_app_map.erase(app_id) > 0, false, "Remove app failed");
+    _id_app_launch_count_map.erase(app_id);
 
     return ret;
 }
@@ -145,6 +182,8 @@ bool ESP_Brookesia_CoreManager::startApp(int id)
     ESP_Brookesia_CoreApp *app = NULL;
     ESP_Brookesia_CoreApp *app_old = NULL;
 
+    _id_app_launch_count_map[id]++;
+
     // Check if the app is already running
     auto find_ret = _id_running_app_map.find(id);
     if (find_ret != _id_running_app_map.end()) {
@@ -161,19 +200,23 @@ bool ESP_Brookesia_CoreManager::startApp(int id)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(find_ret != _id_installed_app_map.end(), false, "Can't find app in installed app map");
     app = find_ret->second;
 
+    // Lazy apps are initialized on their first launch, before any other app is closed for them
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(app->processInit(), false, "Init app failed");
+
     // Check if the running app num is at the limit
     if ((_core_data.app.max_running_num != 0) && (int)_id_running_app_map.size() >= _core_data.app.max_running_num) {
-        for (auto it = _id_running_app_map.begin(); it != _id_running_app_map.end(); it++) {
-            app_old = it->second;
-        }
+        app_old = selectAppToClose();
         ESP_BROOKESIA_CHECK_NULL_RETURN(app_old, false, "Get old app failed");
 
-        ESP_BROOKESIA_LOGW("Running app num(%d) is already at the limit, will close the oldest app(%d)",
+        ESP_BROOKESIA_LOGW("Running app num(%d) is already at the limit, will close app(%d)",
                            (int)_id_running_app_map.size(), app_old->_id);
 
         ESP_BROOKESIA_CHECK_FALSE_RETURN(processAppClose(app_old), false, "Close app failed");
     }
 
+    // Make room for the new app before it allocates
+    processMemoryPressure();
+
     // Start app
     ESP_BROOKESIA_CHECK_FALSE_RETURN(processAppRun(app), false, "Start app failed");
 
@@ -209,6 +252,8 @@ bool ESP_Brookesia_CoreManager::processAppRun(ESP_Brookesia_CoreApp *app)
 
     // Update active app
     _active_app = app;
+    updateAppRecency(app, true);
+    checkAppMemoryQuota(app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_RUNNING);
 
     return true;
 
@@ -248,6 +293,8 @@ bool ESP_Brookesia_CoreManager::processAppResume(ESP_Brookesia_CoreApp *app)
 
     // Update active app
     _active_app = app;
+    updateAppRecency(app, true);
+    checkAppMemoryQuota(app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_RUNNING);
 
     return true;
 }
@@ -262,9 +309,11 @@ bool ESP_Brookesia_CoreManager::processAppPause(ESP_Brookesia_CoreApp *app)
     // Process app
     ESP_BROOKESIA_CHECK_FALSE_RETURN(app->processPause(), false, "App process pause failed");
     if (_core_data.flags.enable_app_save_snapshot) {
+        int64_t snapshot_start_us = esp_timer_get_time();
         if (!saveAppSnapshot(app)) {
             ESP_BROOKESIA_LOGE("Save app snapshot failed");
         }
+        _app_snapshot_time_us = esp_timer_get_time() - snapshot_start_us;
     }
 
     // Process home,
@@ -272,6 +321,7 @@ bool ESP_Brookesia_CoreManager::processAppPause(ESP_Brookesia_CoreApp *app)
 
     // Process extra
     ESP_BROOKESIA_CHECK_FALSE_GOTO(processAppPauseExtra(app), err, "Process app pause extra failed");
+    checkAppMemoryQuota(app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_BACKGROUND);
 
     return true;
 
@@ -303,6 +353,7 @@ bool ESP_Brookesia_CoreManager::processAppClose(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(processAppCloseExtra(app), false, "Process app pause extra failed");
 
     // Remove app from running map and update active app
+    updateAppRecency(app, false);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_id_running_app_map.erase(app->_id) > 0, false, "Remove app from running map failed");
     if (_active_app == app) {
         _active_app = nullptr;
@@ -317,8 +368,11 @@ bool ESP_Brookesia_CoreManager::saveAppSnapshot(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(false, false, "`LV_USE_SNAPSHOT` is not enabled");
 #else
     bool resize_app_screen = false;
-    uint8_t *snapshot_buffer = nullptr;
+    bool scaled = false;
     uint32_t snapshot_buffer_size = 0;
+    uint32_t scratch_size = 0;
+    uint16_t snapshot_width = 0;
+    uint16_t snapshot_height = 0;
     lv_res_t ret = LV_RES_INV;
     lv_area_t app_screen_area = {};
     shared_ptr<ESP_Brookesia_AppSnapshot_t> snapshot = nullptr;
@@ -343,29 +397,39 @@ bool ESP_Brookesia_CoreManager::saveAppSnapshot(ESP_Brookesia_CoreApp *app)
     auto it = _id_app_snapshot_map.find(app->_id);
     snapshot = (it != _id_app_snapshot_map.end()) ? it->second : nullptr;
 
-    // Malloc snapshot buffer if no buffer or buffer size changed
-    snapshot_buffer_size = lv_snapshot_buf_size_needed(app->_active_screen, LV_IMG_CF_TRUE_COLOR);
+    // Use the size shown in the recents screen if it is smaller than the screen
+    getAppSnapshotSize(snapshot_width, snapshot_height);
+    scaled = (snapshot_width != _core.getCoreData().screen_size.width) ||
+             (snapshot_height != _core.getCoreData().screen_size.height);
+    if (scaled) {
+        snapshot_buffer_size = (uint32_t)snapshot_width * snapshot_height * sizeof(lv_color_t);
+        scratch_size = (uint32_t)_core.getCoreData().screen_size.width * SNAPSHOT_STRIP_HEIGHT * sizeof(lv_color_t) +
+                       (uint32_t)snapshot_width * 4 * sizeof(uint32_t);
+    } else {
+        snapshot_buffer_size = lv_snapshot_buf_size_needed(app->_active_screen, LV_IMG_CF_TRUE_COLOR);
+    }
+
+    // Get a snapshot buffer from the pool if no buffer or buffer size changed
     if (snapshot == nullptr) {
         snapshot = make_shared<ESP_Brookesia_AppSnapshot_t>();
         ESP_BROOKESIA_CHECK_NULL_GOTO(snapshot, err, "Make snapshot object failed");
-
-        snapshot_buffer = (uint8_t *)ESP_BROOKESIA_MEMORY_MALLOC(snapshot_buffer_size);
-        ESP_BROOKESIA_CHECK_NULL_GOTO(snapshot_buffer, err, "Alloc snapshot buffer(%d) fail", (int)snapshot_buffer_size);
-
-        snapshot->image_buffer = snapshot_buffer;
-    } else if (snapshot_buffer_size != snapshot->image_resource.data_size) {
-        ESP_BROOKESIA_MEMORY_FREE(snapshot->image_buffer);
-        snapshot->image_buffer = nullptr;
-
-        snapshot_buffer = (uint8_t *)ESP_BROOKESIA_MEMORY_MALLOC(snapshot_buffer_size);
-        ESP_BROOKESIA_CHECK_NULL_GOTO(snapshot_buffer, err, "Realloc snapshot buffer(%d) fail", (int)snapshot_buffer_size);
-
-        snapshot->image_buffer = snapshot_buffer;
+        snapshot->pool_slot = -1;
+    }
+    if ((snapshot->image_buffer == nullptr) || (snapshot_buffer_size != snapshot->image_buffer_size)) {
+        freeAppSnapshotBuffer(*snapshot);
+        ESP_BROOKESIA_CHECK_FALSE_GOTO(allocAppSnapshotBuffer(*snapshot, snapshot_buffer_size, scratch_size,
+                                       app->getCoreActiveData().memory.caps), err,
+                                       "Alloc snapshot buffer(%d) fail", (int)snapshot_buffer_size);
     }
 
     // And take snapshot for recent screen
-    ret = lv_snapshot_take_to_buf(app->_active_screen, LV_IMG_CF_TRUE_COLOR, &snapshot->image_resource,
-                                  snapshot->image_buffer, snapshot_buffer_size);
+    if (scaled) {
+        ret = takeAppSnapshotScaled(app->_active_screen, *snapshot, snapshot_width, snapshot_height) ? LV_RES_OK :
+              LV_RES_INV;
+    } else {
+        ret = lv_snapshot_take_to_buf(app->_active_screen, LV_IMG_CF_TRUE_COLOR, &snapshot->image_resource,
+                                      snapshot->image_buffer, snapshot_buffer_size);
+    }
     ESP_BROOKESIA_CHECK_FALSE_GOTO(ret == LV_RES_OK, err, "Take snapshot fail");
 
     _id_app_snapshot_map[app->_id] = snapshot;
@@ -376,7 +440,11 @@ bool ESP_Brookesia_CoreManager::saveAppSnapshot(ESP_Brookesia_CoreApp *app)
     return true;
 
 err:
-    ESP_BROOKESIA_MEMORY_FREE(snapshot_buffer);
+    // Drop the snapshot, the recents screen shows the app icon instead
+    if (snapshot != nullptr) {
+        freeAppSnapshotBuffer(*snapshot);
+        _id_app_snapshot_map.erase(app->_id);
+    }
     if (resize_app_screen) {
         app->_active_screen->coords = app_screen_area;
     }
@@ -396,12 +464,473 @@ bool ESP_Brookesia_CoreManager::releaseAppSnapshot(ESP_Brookesia_CoreApp *app)
     }
 
     ESP_BROOKESIA_CHECK_NULL_RETURN(it->second, false, "Invalid snapshot object");
-    ESP_BROOKESIA_MEMORY_FREE(it->second->image_buffer);
+    freeAppSnapshotBuffer(*it->second);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_id_app_snapshot_map.erase(app->_id) > 0, false, "Free snapshot failed");
 
     return true;
 }
 
+void ESP_Brookesia_CoreManager::setAppSnapshotFitSize(uint16_t width, uint16_t height)
+{
+    ESP_BROOKESIA_LOGD("Set app snapshot fit size(%dx%d)", width, height);
+    _app_snapshot_fit_size.width = width;
+    _app_snapshot_fit_size.height = height;
+}
+
+void ESP_Brookesia_CoreManager::getAppSnapshotSize(uint16_t &width, uint16_t &height) const
+{
+    uint16_t fit_width = _app_snapshot_fit_size.width;
+    uint16_t fit_height = _app_snapshot_fit_size.height;
+    uint32_t screen_width = _core.getCoreData().screen_size.width;
+    uint32_t screen_height = _core.getCoreData().screen_size.height;
+
+    width = screen_width;
+    height = screen_height;
+    if (!_core_data.flags.enable_app_snapshot_downscale || (fit_width == 0) || (fit_height == 0) ||
+            ((fit_width >= screen_width) && (fit_height >= screen_height))) {
+        return;
+    }
+
+    // Keep the aspect ratio and match the limiting side, so the snapshot is shown without zoom
+    if ((uint32_t)fit_width * screen_height <= (uint32_t)fit_height * screen_width) {
+        width = fit_width;
+        height = (screen_height * fit_width + screen_width - 1) / screen_width;
+    } else {
+        width = (screen_width * fit_height + screen_height - 1) / screen_height;
+        height = fit_height;
+    }
+}
+
+bool ESP_Brookesia_CoreManager::takeAppSnapshotScaled(lv_obj_t *screen, ESP_Brookesia_AppSnapshot_t &snapshot,
+        uint16_t width, uint16_t height)
+{
+    bool ret = false;
+    lv_area_t screen_area = screen->coords;
+    lv_coord_t src_width = lv_area_get_width(&screen_area);
+    lv_coord_t src_height = lv_area_get_height(&screen_area);
+    lv_coord_t strip_height = LV_MIN(src_height, SNAPSHOT_STRIP_HEIGHT);
+    lv_color_t *dest = (lv_color_t *)snapshot.image_buffer;
+    lv_color_t *strip = nullptr;
+    uint32_t strip_size = (uint32_t)src_width * strip_height * sizeof(lv_color_t);
+    uint32_t *sum = nullptr;
+    uint32_t sum_size = (uint32_t)width * 4 * sizeof(uint32_t);
+    bool scratch_in_pool = false;
+    int sum_row = 0;
+    lv_disp_t *disp = lv_obj_get_disp(screen);
+    lv_disp_t *refr_ori = nullptr;
+    lv_draw_ctx_t *draw_ctx = nullptr;
+    lv_disp_drv_t driver;
+    lv_disp_t fake_disp;
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((width <= src_width) && (height <= src_height), false, "Invalid snapshot size");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(snapshot.image_buffer_size >= (uint32_t)width * height * sizeof(lv_color_t), false,
+                                     "Snapshot buffer too small");
+
+    // Each pixel of the snapshot is the average of the screen pixels it covers, summed as R, G, B and count
+    auto write_row = [&](int row) {
+        uint32_t *pixel_sum = sum;
+        lv_color_t *pixel = dest + (uint32_t)row * width;
+        for (int x = 0; x < width; x++, pixel_sum += 4) {
+            lv_color_t color = lv_color_black();
+            if (pixel_sum[3] > 0) {
+                LV_COLOR_SET_R(color, pixel_sum[0] / pixel_sum[3]);
+                LV_COLOR_SET_G(color, pixel_sum[1] / pixel_sum[3]);
+                LV_COLOR_SET_B(color, pixel_sum[2] / pixel_sum[3]);
+            }
+            pixel[x] = color;
+        }
+        lv_memset_00(sum, sum_size);
+    };
+
+    // Use the scratch buffer after the pool slots if the snapshot is from the pool
+    if ((snapshot.pool_slot >= 0) && (_app_snapshot_pool.scratch_size >= strip_size + sum_size)) {
+        strip = (lv_color_t *)(_app_snapshot_pool.buffer +
+                               (uint32_t)_app_snapshot_pool.slot_num * _app_snapshot_pool.slot_size);
+        sum = (uint32_t *)((uint8_t *)strip + strip_size);
+        scratch_in_pool = true;
+    } else {
+        strip = (lv_color_t *)ESP_BROOKESIA_MEMORY_MALLOC(strip_size);
+        ESP_BROOKESIA_CHECK_NULL_GOTO(strip, end, "Alloc snapshot strip buffer failed");
+        sum = (uint32_t *)ESP_BROOKESIA_MEMORY_MALLOC(sum_size);
+        ESP_BROOKESIA_CHECK_NULL_GOTO(sum, end, "Alloc snapshot sum buffer failed");
+    }
+    lv_memset_00(sum, sum_size);
+    draw_ctx = (lv_draw_ctx_t *)lv_mem_alloc(disp->driver->draw_ctx_size);
+    ESP_BROOKESIA_CHECK_NULL_GOTO(draw_ctx, end, "Alloc draw context failed");
+
+    // Same as `lv_snapshot_take_to_buf()`, but the screen is drawn strip by strip into a small buffer and each strip
+    // is scaled down right away, so no buffer of the screen size is needed
+    lv_disp_drv_init(&driver);
+    driver.hor_res = lv_disp_get_hor_res(disp);
+    driver.ver_res = lv_disp_get_ver_res(disp);
+    lv_memset_00(&fake_disp, sizeof(lv_disp_t));
+    fake_disp.driver = &driver;
+    disp->driver->draw_ctx_init(&driver, draw_ctx);
+    driver.draw_ctx = draw_ctx;
+
+    refr_ori = _lv_refr_get_disp_refreshing();
+    _lv_refr_set_disp_refreshing(&fake_disp);
+    for (lv_coord_t y = 0; y < src_height; y += strip_height) {
+        lv_area_t strip_area = {
+            .x1 = screen_area.x1,
+            .y1 = (lv_coord_t)(screen_area.y1 + y),
+            .x2 = screen_area.x2,
+            .y2 = (lv_coord_t)LV_MIN(screen_area.y1 + y + strip_height - 1, screen_area.y2),
+        };
+        lv_memset_00(strip, strip_size);
+        draw_ctx->buf = strip;
+        draw_ctx->buf_area = &strip_area;
+        draw_ctx->clip_area = &strip_area;
+        lv_obj_redraw(draw_ctx, screen);
+
+        for (lv_coord_t strip_y = 0; strip_y < lv_area_get_height(&strip_area); strip_y++) {
+            int row = (uint32_t)(y + strip_y) * height / src_height;
+            if (row != sum_row) {
+                write_row(sum_row);
+                sum_row = row;
+            }
+
+            // Screen column x belongs to snapshot column x * width / src_width
+            const lv_color_t *src = strip + (uint32_t)strip_y * src_width;
+            uint32_t *pixel_sum = sum;
+            uint32_t step = 0;
+            for (lv_coord_t x = 0; x < src_width; x++) {
+                pixel_sum[0] += LV_COLOR_GET_R(src[x]);
+                pixel_sum[1] += LV_COLOR_GET_G(src[x]);
+                pixel_sum[2] += LV_COLOR_GET_B(src[x]);
+                pixel_sum[3]++;
+                step += width;
+                if (step >= (uint32_t)src_width) {
+                    step -= src_width;
+                    pixel_sum += 4;
+                }
+            }
+        }
+    }
+    write_row(sum_row);
+    _lv_refr_set_disp_refreshing(refr_ori);
+    disp->driver->draw_ctx_deinit(&driver, draw_ctx);
+
+    lv_memset_00(&snapshot.image_resource, sizeof(lv_img_dsc_t));
+    snapshot.image_resource.header.cf = LV_IMG_CF_TRUE_COLOR;
+    snapshot.image_resource.header.w = width;
+    snapshot.image_resource.header.h = height;
+    snapshot.image_resource.data_size = (uint32_t)width * height * sizeof(lv_color_t);
+    snapshot.image_resource.data = snapshot.image_buffer;
+    ret = true;
+
+end:
+    if (draw_ctx != nullptr) {
+        lv_mem_free(draw_ctx);
+    }
+    if (!scratch_in_pool) {
+        ESP_BROOKESIA_MEMORY_FREE(sum);
+        ESP_BROOKESIA_MEMORY_FREE(strip);
+    }
+
+    return ret;
+}
+
+bool ESP_Brookesia_CoreManager::allocAppSnapshotBuffer(ESP_Brookesia_AppSnapshot_t &snapshot, uint32_t size,
+        uint32_t scratch_size, uint32_t caps)
+{
+    uint32_t slot_size = (size + 7) & ~7UL;
+    uint8_t slot_num = LV_MIN(_core_data.app.max_running_num, SNAPSHOT_POOL_SLOT_NUM_MAX);
+
+    // The memory preferred by the app first, then the pool and the general allocator
+    if (caps != 0) {
+        snapshot.image_buffer = (uint8_t *)heap_caps_malloc(size, caps);
+        if (snapshot.image_buffer != nullptr) {
+            snapshot.image_buffer_size = size;
+            snapshot.pool_slot = -1;
+            snapshot.is_caps_buffer = true;
+            return true;
+        }
+        ESP_BROOKESIA_LOGD("No room for the snapshot in the app memory(0x%x)", (unsigned int)caps);
+    }
+
+    // The pool can only be rebuilt with a new size when no slot is used, e.g. after all apps are closed
+    if ((_app_snapshot_pool.buffer != nullptr) && (_app_snapshot_pool.used_slots == 0) &&
+            ((_app_snapshot_pool.slot_size != slot_size) || (_app_snapshot_pool.scratch_size != scratch_size))) {
+        delAppSnapshotPool();
+    }
+    // There is one slot for each running app, so no pool if the number of running apps is not limited
+    if ((_app_snapshot_pool.buffer == nullptr) && (slot_num > 0)) {
+        _app_snapshot_pool.buffer = (uint8_t *)SNAPSHOT_POOL_MALLOC((uint32_t)slot_num * slot_size + scratch_size);
+        if (_app_snapshot_pool.buffer != nullptr) {
+            ESP_BROOKESIA_LOGD("Alloc snapshot pool(%d x %d + %d)", (int)slot_num, (int)slot_size, (int)scratch_size);
+            _app_snapshot_pool.slot_size = slot_size;
+            _app_snapshot_pool.scratch_size = scratch_size;
+            _app_snapshot_pool.slot_num = slot_num;
+            _app_snapshot_pool.used_slots = 0;
+        } else {
+            ESP_BROOKESIA_LOGW("Alloc snapshot pool(%d x %d + %d) fail", (int)slot_num, (int)slot_size,
+                               (int)scratch_size);
+        }
+    }
+
+    if ((_app_snapshot_pool.buffer != nullptr) && (_app_snapshot_pool.slot_size == slot_size)) {
+        for (int i = 0; i < _app_snapshot_pool.slot_num; i++) {
+            if (!(_app_snapshot_pool.used_slots & (1UL << i))) {
+                _app_snapshot_pool.used_slots |= (1UL << i);
+                snapshot.image_buffer = _app_snapshot_pool.buffer + (uint32_t)i * slot_size;
+                snapshot.image_buffer_size = size;
+                snapshot.pool_slot = i;
+                return true;
+            }
+        }
+    }
+
+    ESP_BROOKESIA_LOGD("No snapshot pool slot, use general allocator");
+    snapshot.image_buffer = (uint8_t *)ESP_BROOKESIA_MEMORY_MALLOC(size);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(snapshot.image_buffer, false, "Alloc snapshot buffer(%d) fail", (int)size);
+    snapshot.image_buffer_size = size;
+    snapshot.pool_slot = -1;
+
+    return true;
+}
+
+void ESP_Brookesia_CoreManager::freeAppSnapshotBuffer(ESP_Brookesia_AppSnapshot_t &snapshot)
+{
+    if (snapshot.pool_slot >= 0) {
+        _app_snapshot_pool.used_slots &= ~(1UL << snapshot.pool_slot);
+    } else if (snapshot.is_caps_buffer) {
+        heap_caps_free(snapshot.image_buffer);
+    } else if (snapshot.image_buffer != nullptr) {
+        ESP_BROOKESIA_MEMORY_FREE(snapshot.image_buffer);
+    }
+    snapshot.image_buffer = nullptr;
+    snapshot.image_buffer_size = 0;
+    snapshot.pool_slot = -1;
+    snapshot.is_caps_buffer = false;
+}
+
+void ESP_Brookesia_CoreManager::delAppSnapshotPool(void)
+{
+    if (_app_snapshot_pool.buffer == nullptr) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("Free snapshot pool");
+    SNAPSHOT_POOL_FREE(_app_snapshot_pool.buffer);
+    _app_snapshot_pool = {};
+}
+
+ESP_Brookesia_CoreApp *ESP_Brookesia_CoreManager::selectAppToClose(void)
+{
+    ESP_Brookesia_CoreApp *app = nullptr;
+    size_t app_footprint = 0;
+    int candidate_num = (int)_running_app_recency.size() - 1;
+
+    if (candidate_num <= 0) {
+        return _running_app_recency.empty() ? nullptr : _running_app_recency.front();
+    }
+
+    // Keep the most recently used app. Of the others, close the one with the largest memory footprint, or the least
+    // recently used one if the footprints are the same
+    for (int i = 0; i < candidate_num; i++) {
+        size_t footprint = _running_app_recency[i]->getMemoryFootprint();
+        if ((app == nullptr) || (footprint > app_footprint)) {
+            app = _running_app_recency[i];
+            app_footprint = footprint;
+        }
+    }
+
+    return app;
+}
+
+void ESP_Brookesia_CoreManager::updateAppRecency(ESP_Brookesia_CoreApp *app, bool is_running)
+{
+    for (auto it = _running_app_recency.begin(); it != _running_app_recency.end(); it++) {
+        if (*it == app) {
+            _running_app_recency.erase(it);
+            break;
+        }
+    }
+    if (is_running) {
+        _running_app_recency.push_back(app);
+    }
+}
+
+bool ESP_Brookesia_CoreManager::checkMemoryLow(void) const
+{
+    size_t free_size = 0;
+
+    if (ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB == 0) {
+        return false;
+    }
+
+    // 0 means the platform can't report the free heap
+    free_size = esp_brookesia_core_utils_get_free_heap_size();
+
+    return (free_size != 0) && (free_size < (size_t)ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB * 1024);
+}
+
+bool ESP_Brookesia_CoreManager::trimAppMemory(ESP_Brookesia_CoreApp *app, ESP_Brookesia_CoreAppTrimLevel_t level)
+{
+    size_t free_size = esp_brookesia_core_utils_get_free_heap_size();
+    bool ret = app->trimMemory(level);
+    int released = (int)esp_brookesia_core_utils_get_free_heap_size() - (int)free_size;
+
+    ESP_BROOKESIA_LOGD("App(%d) trim memory(level: %d), released(%d)", app->_id, level, released);
+    // The released heap is no longer used by the app
+    app->_resource_heap_usage -= released;
+
+    return ret;
+}
+
+void ESP_Brookesia_CoreManager::checkAppMemoryQuota(ESP_Brookesia_CoreApp *app,
+        ESP_Brookesia_CoreAppTrimLevel_t level)
+{
+    uint32_t quota_kb = app->getCoreActiveData().memory.quota_kb;
+
+    if ((quota_kb == 0) || (app->getHeapUsage() <= (int)quota_kb * 1024)) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGW("App(%d) uses %d KB, above its quota of %d KB, trim it", app->_id, app->getHeapUsage() / 1024,
+                       (int)quota_kb);
+    if (!trimAppMemory(app, level)) {
+        ESP_BROOKESIA_LOGE("App(%d) trim memory failed", app->_id);
+    }
+}
+
+void ESP_Brookesia_CoreManager::processMemoryPressure(void)
+{
+    ESP_Brookesia_CoreApp *app = nullptr;
+    vector<ESP_Brookesia_CoreApp *> apps;
+
+    if (!checkMemoryLow()) {
+        return;
+    }
+    ESP_BROOKESIA_LOGW("Free heap(%d) is below %d KB, trim apps", (int)esp_brookesia_core_utils_get_free_heap_size(),
+                       ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB);
+
+    // Paused apps first, least recently used first. Copy the list since apps may close themselves
+    apps = _running_app_recency;
+    for (auto running_app : apps) {
+        if ((running_app != _active_app) && (_id_running_app_map.find(running_app->_id) != _id_running_app_map.end())) {
+            if (!trimAppMemory(running_app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_BACKGROUND)) {
+                ESP_BROOKESIA_LOGE("App(%d) trim memory failed", running_app->_id);
+            }
+            if (!checkMemoryLow()) {
+                return;
+            }
+        }
+    }
+    if (_active_app != nullptr) {
+        if (!trimAppMemory(_active_app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_RUNNING)) {
+            ESP_BROOKESIA_LOGE("App(%d) trim memory failed", _active_app->_id);
+        }
+        if (!checkMemoryLow()) {
+            return;
+        }
+    }
+
+    // Then close paused apps, the most recently used one is kept
+    while ((_running_app_recency.size() > 1) && checkMemoryLow()) {
+        app = selectAppToClose();
+        if ((app == nullptr) || (app == _active_app)) {
+            break;
+        }
+        if (!trimAppMemory(app, ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_COMPLETE)) {
+            ESP_BROOKESIA_LOGE("App(%d) trim memory failed", app->_id);
+        }
+        if (!checkMemoryLow()) {
+            break;
+        }
+        ESP_BROOKESIA_LOGW("Free heap is still low, close app(%d)", app->_id);
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(processAppClose(app), "Close app failed");
+    }
+}
+
+void ESP_Brookesia_CoreManager::processDisplayState(ESP_Brookesia_CoreDisplayState_t state)
+{
+    vector<ESP_Brookesia_CoreApp *> apps;
+
+    // Copy the list since apps may close themselves
+    apps = _running_app_recency;
+    for (auto running_app : apps) {
+        if (_id_running_app_map.find(running_app->_id) == _id_running_app_map.end()) {
+            continue;
+        }
+        ESP_BROOKESIA_LOGD("App(%d) display state(%d)", running_app->_id, state);
+        if (!running_app->displayStateChanged(state)) {
+            ESP_BROOKESIA_LOGE("App(%d) display state change failed", running_app->_id);
+        }
+    }
+    // The user is away, a good time to write the flash, and the device may be turned off before the apps close
+    if ((state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) && !flushAppStates()) {
+        ESP_BROOKESIA_LOGE("Flush app states failed");
+    }
+}
+
+bool ESP_Brookesia_CoreManager::flushAppStates(void)
+{
+    bool ret = true;
+
+    for (auto &id_app : _id_running_app_map) {
+        if (!id_app.second->processSaveState()) {
+            ESP_BROOKESIA_LOGE("App(%d) save state failed", id_app.first);
+            ret = false;
+        }
+    }
+    if (!esp_brookesia_core_app_state_flush()) {
+        ret = false;
+    }
+
+    return ret;
+}
+
+void ESP_Brookesia_CoreManager::onMemoryCheckTimerCallback(lv_timer_t *timer)
+{
+    ESP_Brookesia_CoreManager *manager = (ESP_Brookesia_CoreManager *)timer->user_data;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(manager, "Invalid manager");
+
+    manager->processMemoryPressure();
+}
+
+void ESP_Brookesia_CoreManager::onLazyInitTimerCallback(lv_timer_t *timer)
+{
+    ESP_Brookesia_CoreManager *manager = (ESP_Brookesia_CoreManager *)timer->user_data;
+    lv_disp_t *disp = nullptr;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(manager, "Invalid manager");
+
+    // `init()` runs in the LVGL task and can take a while, so wait until the user leaves the screen alone
+    disp = manager->_core.getDisplayDevice();
+    if ((disp != nullptr) && (lv_disp_get_inactive_time(disp) < ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS)) {
+        return;
+    }
+
+    // One app per check, the most started one first, then the first installed one
+    ESP_Brookesia_CoreApp *target_app = nullptr;
+    uint32_t target_count = 0;
+    for (auto &app : manager->_id_installed_app_map) {
+        if (app.second->checkInitDone()) {
+            continue;
+        }
+        uint32_t count = manager->getAppLaunchCount(app.first);
+        if ((target_app == nullptr) || (count > target_count) ||
+                ((count == target_count) && (app.first < target_app->_id))) {
+            target_app = app.second;
+            target_count = count;
+        }
+    }
+    if (target_app != nullptr) {
+        ESP_BROOKESIA_LOGD("Init app(%d) in advance, started %d times", target_app->_id, (int)target_count);
+        if (!target_app->processInit()) {
+            ESP_BROOKESIA_LOGE("Init app(%d) failed", target_app->_id);
+        }
+        return;
+    }
+
+    // All apps are initialized
+    lv_timer_del(manager->_lazy_init_timer);
+    manager->_lazy_init_timer = nullptr;
+}
+
 void ESP_Brookesia_CoreManager::resetActiveApp(void)
 {
     ESP_BROOKESIA_LOGD("Reset active app");
@@ -444,6 +973,36 @@ ESP_Brookesia_CoreApp *ESP_Brookesia_CoreManager::getInstalledApp(int id)
     return nullptr;
 }
 
+uint32_t ESP_Brookesia_CoreManager::getAppLaunchCount(int id) const
+{
+    auto it = _id_app_launch_count_map.find(id);
+
+    return (it != _id_app_launch_count_map.end()) ? it->second : 0;
+}
+
+bool ESP_Brookesia_CoreManager::setAppLaunchCount(int id, uint32_t count)
+{
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(_id_installed_app_map.count(id) > 0, false, "App(%d) is not installed", id);
+
+    _id_app_launch_count_map[id] = count;
+
+    return true;
+}
+
+ESP_Brookesia_CoreApp *ESP_Brookesia_CoreManager::getInstalledAppByName(const char *name)
+{
+    ESP_BROOKESIA_CHECK_NULL_RETURN(name, nullptr, "Invalid name");
+
+    for (auto &id_app : _id_installed_app_map) {
+        if (strcmp(id_app.second->getName(), name) == 0) {
+            return id_app.second;
+        }
+    }
+
+    ESP_BROOKESIA_LOGE("App(%s) not found in installed app list", name);
+    return nullptr;
+}
+
 ESP_Brookesia_CoreApp *ESP_Brookesia_CoreManager::getRunningAppByIdenx(uint8_t index)
 {
     if (index >= _id_running_app_map.size()) {
@@ -483,6 +1042,14 @@ bool ESP_Brookesia_CoreManager::beginCore(void)
                                      "Register app event failed");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(_core.registerNavigateEventCallback(onNavigationEventCallback, this), err,
                                    "Register navigation event failed");
+    if (ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB != 0) {
+        _memory_check_timer = lv_timer_create(onMemoryCheckTimerCallback, ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS, this);
+        ESP_BROOKESIA_CHECK_NULL_GOTO(_memory_check_timer, err, "Create memory check timer failed");
+    }
+    if (ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS != 0) {
+        _lazy_init_timer = lv_timer_create(onLazyInitTimerCallback, LAZY_INIT_CHECK_PERIOD_MS, this);
+        ESP_BROOKESIA_CHECK_NULL_GOTO(_lazy_init_timer, err, "Create lazy init timer failed");
+    }
 
     return true;
 
@@ -506,6 +1073,14 @@ bool ESP_Brookesia_CoreManager::delCore(void)
         }
     }
 
+    if (_memory_check_timer != nullptr) {
+        lv_timer_del(_memory_check_timer);
+        _memory_check_timer = nullptr;
+    }
+    if (_lazy_init_timer != nullptr) {
+        lv_timer_del(_lazy_init_timer);
+        _lazy_init_timer = nullptr;
+    }
     _app_free_id = 0;
     _active_app = nullptr;
     for (auto app : id_installed_app_map) {
@@ -516,7 +1091,15 @@ bool ESP_Brookesia_CoreManager::delCore(void)
     }
     _id_installed_app_map.clear();
     _id_running_app_map.clear();
+    _id_app_launch_count_map.clear();
+    _running_app_recency.clear();
+    for (auto &snapshot : _id_app_snapshot_map) {
+        if (snapshot.second != nullptr) {
+            freeAppSnapshotBuffer(*snapshot.second);
+        }
+    }
     _id_app_snapshot_map.clear();
+    delAppSnapshotPool();
 
     return ret;
 }
@@ -549,6 +1132,12 @@ void ESP_Brookesia_CoreManager::onAppEventCallback(lv_event_t *event)
         ESP_BROOKESIA_CHECK_NULL_EXIT(app, "Invalid app");
         ESP_BROOKESIA_CHECK_FALSE_EXIT(manager->processAppClose(app), "Close app failed");
         break;
+    case ESP_BROOKESIA_CORE_APP_EVENT_TYPE_PREWARM:
+        ESP_BROOKESIA_LOGD("Prewarm app(%d)", id);
+        app = manager->getInstalledApp(id);
+        ESP_BROOKESIA_CHECK_NULL_EXIT(app, "Invalid app");
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(app->processInit(), "Init app failed");
+        break;
     default:
         break;
     }
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <unordered_map>
+#include <vector>
 #include "esp_brookesia_core_app.hpp"
 #include "esp_brookesia_core_home.hpp"
 #include "esp_brookesia_core_type.h"
@@ -32,10 +33,19 @@ public:
     int getRunningAppIndexByApp(ESP_Brookesia_CoreApp *app);
     int getRunningAppIndexById(int id);
     ESP_Brookesia_CoreApp *getInstalledApp(int id);
+    ESP_Brookesia_CoreApp *getInstalledAppByName(const char *name);
     ESP_Brookesia_CoreApp *getRunningAppByIdenx(uint8_t index);
     ESP_Brookesia_CoreApp *getRunningAppById(int id);
     ESP_Brookesia_CoreApp *getActiveApp(void) const { return _active_app; }
     const lv_img_dsc_t *getAppSnapshot(int id);
+    bool checkAppSnapshotExist(int id) const        { return _id_app_snapshot_map.count(id) > 0; }
+    // Time of the last `saveAppSnapshot()` when an app was paused, -1 if none was taken
+    int64_t getLastAppSnapshotTimeUs(void) const    { return _app_snapshot_time_us; }
+    // Number of times the app was started, the idle pre-init initializes the most started lazy apps first
+    uint32_t getAppLaunchCount(int id) const;
+    bool setAppLaunchCount(int id, uint32_t count);
+    // Keep the states of the running apps and write all the kept states to flash, done when the display turns off
+    bool flushAppStates(void);
     // *INDENT-OFF*
 
 protected:
@@ -44,6 +54,7 @@ protected:
     virtual bool processAppPauseExtra(ESP_Brookesia_CoreApp *app)  { return true; }
     virtual bool processAppCloseExtra(ESP_Brookesia_CoreApp *app)  { return true; }
     virtual bool processNavigationEvent(ESP_Brookesia_CoreNavigateType_t type) { return true; };
+    virtual ESP_Brookesia_CoreApp *selectAppToClose(void);
 
     bool processAppRun(ESP_Brookesia_CoreApp *app);
     bool processAppResume(ESP_Brookesia_CoreApp *app);
@@ -51,7 +62,12 @@ protected:
     bool processAppClose(ESP_Brookesia_CoreApp *app);
     bool saveAppSnapshot(ESP_Brookesia_CoreApp *app);
     bool releaseAppSnapshot(ESP_Brookesia_CoreApp *app);
+    void setAppSnapshotFitSize(uint16_t width, uint16_t height);
     void resetActiveApp(void);
+    void updateAppRecency(ESP_Brookesia_CoreApp *app, bool is_running);
+    bool checkMemoryLow(void) const;
+    void processMemoryPressure(void);
+    void processDisplayState(ESP_Brookesia_CoreDisplayState_t state);
 
     ESP_Brookesia_Core &_core;
     const ESP_Brookesia_CoreManagerData_t &_core_data;
@@ -63,18 +79,50 @@ private:
 
     static void onAppEventCallback(lv_event_t *event);
     static void onNavigationEventCallback(lv_event_t *event);
+    static void onMemoryCheckTimerCallback(lv_timer_t *timer);
+    static void onLazyInitTimerCallback(lv_timer_t *timer);
 
     typedef struct {
         uint8_t *image_buffer;
+        uint32_t image_buffer_size;
+        int pool_slot;                  // -1 if the buffer is not from the pool
+        bool is_caps_buffer;            // Allocated with the heap caps preferred by the app
         lv_img_dsc_t image_resource;
     } ESP_Brookesia_AppSnapshot_t;
 
+    void getAppSnapshotSize(uint16_t &width, uint16_t &height) const;
+    bool takeAppSnapshotScaled(lv_obj_t *screen, ESP_Brookesia_AppSnapshot_t &snapshot, uint16_t width, uint16_t height);
+    bool allocAppSnapshotBuffer(ESP_Brookesia_AppSnapshot_t &snapshot, uint32_t size, uint32_t scratch_size,
+                                uint32_t caps);
+    void freeAppSnapshotBuffer(ESP_Brookesia_AppSnapshot_t &snapshot);
+    void delAppSnapshotPool(void);
+    bool trimAppMemory(ESP_Brookesia_CoreApp *app, ESP_Brookesia_CoreAppTrimLevel_t level);
+    void checkAppMemoryQuota(ESP_Brookesia_CoreApp *app, ESP_Brookesia_CoreAppTrimLevel_t level);
+
     // App
     mutable uint32_t _app_free_id;
     ESP_Brookesia_CoreApp *_active_app;
     std::unordered_map <int, ESP_Brookesia_CoreApp *> _id_installed_app_map;
     std::unordered_map <int, ESP_Brookesia_CoreApp *> _id_running_app_map;
+    std::vector<ESP_Brookesia_CoreApp *> _running_app_recency;     // Least recently used first
     std::unordered_map <int, std::shared_ptr<ESP_Brookesia_AppSnapshot_t>> _id_app_snapshot_map;
+    std::unordered_map <int, uint32_t> _id_app_launch_count_map;
+    struct {
+        uint16_t width;
+        uint16_t height;
+    } _app_snapshot_fit_size;
+    // Snapshot buffers, one slot per running app, followed by the scratch buffer for scaling
+    struct {
+        uint8_t *buffer;
+        uint32_t slot_size;
+        uint32_t scratch_size;
+        uint8_t slot_num;
+        uint32_t used_slots;
+    } _app_snapshot_pool;
+    int64_t _app_snapshot_time_us;
+    // Memory
+    lv_timer_t *_memory_check_timer;
+    lv_timer_t *_lazy_init_timer;
     // Navigation
     ESP_Brookesia_CoreNavigateType_t _navigate_type;
 };
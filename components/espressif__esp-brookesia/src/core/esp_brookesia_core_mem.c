@@ -0,0 +1,265 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_brookesia_core_mem.h"
+#if ESP_BROOKESIA_MEMORY_APP_CAPS || ESP_BROOKESIA_MEMORY_LV_POOL_KB
+#include "esp_heap_caps.h"
+#endif
+#if ESP_BROOKESIA_MEMORY_LV_POOL_KB
+#include "freertos/FreeRTOS.h"
+#include "multi_heap.h"
+#endif
+
+#if ESP_BROOKESIA_MEMORY_APP_CAPS || ESP_BROOKESIA_MEMORY_LV_POOL_KB
+void *__real_lv_mem_alloc(size_t size);
+#endif
+
+#if ESP_BROOKESIA_MEMORY_APP_CAPS
+// Only changed and read with the LVGL lock held
+static uint32_t lv_caps = 0;
+
+uint32_t esp_brookesia_core_mem_set_lv_caps(uint32_t caps)
+{
+    uint32_t prev_caps = lv_caps;
+
+    lv_caps = caps;
+
+    return prev_caps;
+}
+#else
+#define lv_caps     (0)
+
+uint32_t esp_brookesia_core_mem_set_lv_caps(uint32_t caps)
+{
+    (void)caps;
+
+    return 0;
+}
+#endif
+
+#if ESP_BROOKESIA_MEMORY_LV_POOL_KB
+#define LV_POOL_SIZE        (ESP_BROOKESIA_MEMORY_LV_POOL_KB * 1024)
+#define LV_LARGE_CAPS       (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+
+// Taken by `multi_heap` for the pool, and around the counters
+static portMUX_TYPE lv_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct {
+    multi_heap_handle_t heap;
+    const uint8_t *start;
+    const uint8_t *end;
+    bool init_failed;
+    void *zero_mem;
+    // Guarded by `lv_pool_lock`
+    size_t small_used;
+    size_t small_peak;
+    size_t large_used;
+    size_t large_peak;
+    uint32_t small_fallbacks;
+} lv_pool;
+
+// `lv_mem_alloc()`, `lv_mem_free()` and `lv_mem_realloc()` are wrapped at link time, the calls made inside
+// `lv_mem.c` are not, so its own buffers (`lv_mem_buf_get()`) stay in the default heap and are never counted.
+// LVGL returns its own marker for empty allocations, which must never be freed
+static void *lv_pool_zero_mem(void)
+{
+    if (lv_pool.zero_mem == NULL) {
+        lv_pool.zero_mem = __real_lv_mem_alloc(0);
+    }
+
+    return lv_pool.zero_mem;
+}
+
+// The first allocation is made by `lv_init()`, before any other task can use LVGL
+static bool lv_pool_init(void)
+{
+    if (lv_pool.heap != NULL) {
+        return true;
+    }
+    if (lv_pool.init_failed) {
+        return false;
+    }
+
+    uint8_t *buf = heap_caps_malloc(LV_POOL_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    multi_heap_handle_t heap = (buf != NULL) ? multi_heap_register(buf, LV_POOL_SIZE) : NULL;
+    if (heap == NULL) {
+        heap_caps_free(buf);
+        lv_pool.init_failed = true;
+        return false;
+    }
+    multi_heap_set_lock(heap, &lv_pool_lock);
+    lv_pool.start = buf;
+    lv_pool.end = buf + LV_POOL_SIZE;
+    lv_pool.heap = heap;
+
+    return true;
+}
+
+static bool lv_pool_contains(const void *ptr)
+{
+    return (lv_pool.heap != NULL) && ((const uint8_t *)ptr >= lv_pool.start) && ((const uint8_t *)ptr < lv_pool.end);
+}
+
+static void lv_pool_count(size_t *used, size_t *peak, size_t add, size_t sub)
+{
+    portENTER_CRITICAL(&lv_pool_lock);
+    // Blocks freed here may come from `lv_mem.c` itself, which is not counted
+    *used = (*used > sub) ? (*used - sub) : 0;
+    *used += add;
+    if (*used > *peak) {
+        *peak = *used;
+    }
+    portEXIT_CRITICAL(&lv_pool_lock);
+}
+
+static void *lv_large_alloc(size_t size)
+{
+    void *ptr = heap_caps_malloc_prefer(size, 2, (lv_caps != 0) ? lv_caps : LV_LARGE_CAPS, MALLOC_CAP_DEFAULT);
+
+    if (ptr != NULL) {
+        lv_pool_count(&lv_pool.large_used, &lv_pool.large_peak, heap_caps_get_allocated_size(ptr), 0);
+    }
+
+    return ptr;
+}
+
+static void lv_pool_count_fallback(void)
+{
+    portENTER_CRITICAL(&lv_pool_lock);
+    lv_pool.small_fallbacks++;
+    portEXIT_CRITICAL(&lv_pool_lock);
+}
+
+void *__wrap_lv_mem_alloc(size_t size)
+{
+    if (size == 0) {
+        return lv_pool_zero_mem();
+    }
+
+    // Small allocations of an app preferring other memory than internal RAM follow its caps
+    if ((size < ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE) && ((lv_caps == 0) || (lv_caps & MALLOC_CAP_INTERNAL)) &&
+            lv_pool_init()) {
+        void *ptr = multi_heap_malloc(lv_pool.heap, size);
+        if (ptr != NULL) {
+            lv_pool_count(&lv_pool.small_used, &lv_pool.small_peak, multi_heap_get_allocated_size(lv_pool.heap, ptr), 0);
+            return ptr;
+        }
+        lv_pool_count_fallback();
+    }
+
+    return lv_large_alloc(size);
+}
+
+void __wrap_lv_mem_free(void *data)
+{
+    if ((data == NULL) || (data == lv_pool_zero_mem())) {
+        return;
+    }
+
+    if (lv_pool_contains(data)) {
+        lv_pool_count(&lv_pool.small_used, &lv_pool.small_peak, 0, multi_heap_get_allocated_size(lv_pool.heap, data));
+        multi_heap_free(lv_pool.heap, data);
+    } else {
+        lv_pool_count(&lv_pool.large_used, &lv_pool.large_peak, 0, heap_caps_get_allocated_size(data));
+        heap_caps_free(data);
+    }
+}
+
+void *__wrap_lv_mem_realloc(void *data, size_t new_size)
+{
+    if (new_size == 0) {
+        __wrap_lv_mem_free(data);
+        return lv_pool_zero_mem();
+    }
+    if ((data == NULL) || (data == lv_pool_zero_mem())) {
+        return __wrap_lv_mem_alloc(new_size);
+    }
+
+    if (!lv_pool_contains(data)) {
+        size_t old_size = heap_caps_get_allocated_size(data);
+        void *ptr = realloc(data, new_size);
+        if (ptr != NULL) {
+            lv_pool_count(&lv_pool.large_used, &lv_pool.large_peak, heap_caps_get_allocated_size(ptr), old_size);
+        }
+        return ptr;
+    }
+
+    size_t old_size = multi_heap_get_allocated_size(lv_pool.heap, data);
+    if (new_size < ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE) {
+        void *ptr = multi_heap_realloc(lv_pool.heap, data, new_size);
+        if (ptr != NULL) {
+            lv_pool_count(&lv_pool.small_used, &lv_pool.small_peak, multi_heap_get_allocated_size(lv_pool.heap, ptr),
+                          old_size);
+            return ptr;
+        }
+        lv_pool_count_fallback();
+    }
+
+    // Grown past the small size, or the pool is full: move it out of the pool
+    void *ptr = lv_large_alloc(new_size);
+    if (ptr == NULL) {
+        return NULL;
+    }
+    memcpy(ptr, data, (old_size < new_size) ? old_size : new_size);
+    __wrap_lv_mem_free(data);
+
+    return ptr;
+}
+
+static void lv_pool_fill_free(esp_brookesia_core_mem_lv_tier_t *tier, size_t free_size, size_t largest_free)
+{
+    tier->free = free_size;
+    tier->largest_free = largest_free;
+    tier->frag_pct = (free_size > 0) ? (100 - (uint8_t)((uint64_t)largest_free * 100 / free_size)) : 0;
+}
+
+bool esp_brookesia_core_mem_get_lv_stats(esp_brookesia_core_mem_lv_stats_t *stats)
+{
+    if ((stats == NULL) || (lv_pool.heap == NULL)) {
+        return false;
+    }
+
+    multi_heap_info_t info = {0};
+    multi_heap_get_info(lv_pool.heap, &info);
+
+    portENTER_CRITICAL(&lv_pool_lock);
+    stats->small.used = lv_pool.small_used;
+    stats->small.peak = lv_pool.small_peak;
+    stats->large.used = lv_pool.large_used;
+    stats->large.peak = lv_pool.large_peak;
+    stats->small_fallbacks = lv_pool.small_fallbacks;
+    portEXIT_CRITICAL(&lv_pool_lock);
+
+    lv_pool_fill_free(&stats->small, info.total_free_bytes, info.largest_free_block);
+    // Without PSRAM the large tier is the default heap
+    uint32_t large_caps = (heap_caps_get_total_size(LV_LARGE_CAPS) > 0) ? LV_LARGE_CAPS : MALLOC_CAP_DEFAULT;
+    lv_pool_fill_free(&stats->large, heap_caps_get_free_size(large_caps), heap_caps_get_largest_free_block(large_caps));
+
+    return true;
+}
+#else
+#if ESP_BROOKESIA_MEMORY_APP_CAPS
+// `lv_mem_alloc()` is wrapped at link time (`-Wl,--wrap=lv_mem_alloc`), `lv_mem_free()` and `lv_mem_realloc()` use
+// `free()` and `realloc()` which handle any heap
+void *__wrap_lv_mem_alloc(size_t size)
+{
+    // LVGL returns its own marker for empty allocations
+    if ((lv_caps == 0) || (size == 0)) {
+        return __real_lv_mem_alloc(size);
+    }
+
+    return heap_caps_malloc_prefer(size, 2, lv_caps, MALLOC_CAP_DEFAULT);
+}
+#endif
+
+bool esp_brookesia_core_mem_get_lv_stats(esp_brookesia_core_mem_lv_stats_t *stats)
+{
+    (void)stats;
+
+    return false;
+}
+#endif
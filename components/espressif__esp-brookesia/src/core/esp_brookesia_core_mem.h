@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set the heap caps preferred by the LVGL allocations (`lv_mem_alloc()`), used by the core while an app
+ *        records its resources. An allocation that doesn't fit in the preferred memory falls back to the default
+ *        heap. Does nothing if `ESP_BROOKESIA_MEMORY_APP_CAPS` is disabled. Must be called with the LVGL lock held.
+ *
+ * @param caps `MALLOC_CAP_*` of `esp_heap_caps.h`, 0 for the default allocator of LVGL
+ *
+ * @return The previous caps
+ *
+ */
+uint32_t esp_brookesia_core_mem_set_lv_caps(uint32_t caps);
+
+/**
+ * @brief Usage of one tier of the LVGL allocations
+ *
+ */
+typedef struct {
+    size_t used;            /*!< Bytes allocated by LVGL in the tier, with the allocator overhead */
+    size_t peak;            /*!< Highest `used` since boot */
+    size_t free;            /*!< Free bytes of the memory of the tier */
+    size_t largest_free;    /*!< Largest free block of the memory of the tier */
+    uint8_t frag_pct;       /*!< Fragmentation of the free memory, 0 when it is a single block */
+} esp_brookesia_core_mem_lv_tier_t;
+
+/**
+ * @brief Usage of the LVGL allocations, when `ESP_BROOKESIA_MEMORY_LV_POOL_KB` is not 0
+ *
+ */
+typedef struct {
+    esp_brookesia_core_mem_lv_tier_t small; /*!< Internal RAM pool, allocations below
+                                                 `ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE` */
+    esp_brookesia_core_mem_lv_tier_t large; /*!< Bigger allocations and pool fallbacks, in PSRAM if enabled */
+    uint32_t small_fallbacks;               /*!< Small allocations that didn't fit in the pool */
+} esp_brookesia_core_mem_lv_stats_t;
+
+/**
+ * @brief Get the usage of the LVGL allocations split between the internal RAM pool of the small ones and the heap
+ *        of the others.
+ *
+ * @param stats Output usage
+ *
+ * @return true if the pool is enabled and set up by the first allocation, false otherwise
+ *
+ */
+bool esp_brookesia_core_mem_get_lv_stats(esp_brookesia_core_mem_lv_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,457 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_touch_hook.h"
+#include "esp_brookesia_core_perf_hud.h"
+#if defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#endif
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+#define HUD_TEXT_LEN_MAX            (256)
+#define HUD_TOGGLE_AREA_DIV         (8)
+
+typedef struct {
+    lv_timer_t *timer;
+    lv_timer_cb_t cb;
+    uint32_t busy_us;
+    uint32_t call_num;
+    uint32_t scan_id;
+} PerfHudTimer_t;
+
+static struct {
+    bool is_begun;
+    bool is_visible;
+    lv_disp_t *disp;
+    lv_indev_t *touch;
+    lv_timer_t *report_timer;
+    lv_obj_t *label;
+    void (*flush_cb)(struct _lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p);
+    void (*monitor_cb)(struct _lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px);
+    // Current period
+    int64_t period_start_us;
+    uint32_t scan_id;
+    bool is_refreshing;
+    uint32_t refresh_px;
+    uint32_t refresh_flush_us;
+    uint32_t frame_num;
+    uint64_t render_sum_us;
+    uint32_t render_max_us;
+    uint64_t flush_sum_us;
+    uint64_t area_sum_px;
+    // Toggle gesture
+    uint32_t press_tick;
+    bool is_press_in_corner;
+    bool is_toggled_by_press;
+    ESP_Brookesia_PerfHudStats_t stats;
+} s_hud;
+
+static PerfHudTimer_t s_timers[ESP_BROOKESIA_PERF_HUD_TIMER_NUM_MAX];
+
+static int64_t get_time_us(void)
+{
+#if defined(ESP_PLATFORM)
+    return esp_timer_get_time();
+#else
+    return (int64_t)lv_tick_get() * 1000;
+#endif
+}
+
+static PerfHudTimer_t *find_timer(const lv_timer_t *timer)
+{
+    for (int i = 0; i < ESP_BROOKESIA_PERF_HUD_TIMER_NUM_MAX; i++) {
+        if (s_timers[i].timer == timer) {
+            return &s_timers[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void on_timer(lv_timer_t *timer)
+{
+    PerfHudTimer_t *slot = find_timer(timer);
+    bool is_refresh = false;
+    int64_t start_us = 0;
+    uint32_t busy_us = 0;
+
+    if ((slot == NULL) || (slot->cb == NULL)) {
+        return;
+    }
+
+    is_refresh = (s_hud.disp != NULL) && (timer == s_hud.disp->refr_timer);
+    if (is_refresh) {
+        s_hud.is_refreshing = true;
+        s_hud.refresh_px = 0;
+        s_hud.refresh_flush_us = 0;
+    }
+
+    // The callback may delete its own timer, only the slot is used afterwards
+    start_us = get_time_us();
+    slot->cb(timer);
+    busy_us = (uint32_t)(get_time_us() - start_us);
+    slot->busy_us += busy_us;
+    slot->call_num++;
+
+    if (is_refresh) {
+        s_hud.is_refreshing = false;
+        if (s_hud.refresh_px > 0) {
+            s_hud.frame_num++;
+            s_hud.render_sum_us += busy_us;
+            s_hud.render_max_us = LV_MAX(s_hud.render_max_us, busy_us);
+            s_hud.flush_sum_us += s_hud.refresh_flush_us;
+            s_hud.area_sum_px += s_hud.refresh_px;
+        }
+    }
+}
+
+static void on_flush(struct _lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
+{
+    int64_t start_us = get_time_us();
+
+    s_hud.flush_cb(disp_drv, area, color_p);
+    s_hud.refresh_flush_us += (uint32_t)(get_time_us() - start_us);
+}
+
+static void on_monitor(struct _lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px)
+{
+    if (s_hud.is_refreshing) {
+        s_hud.refresh_px += px;
+    }
+    if (s_hud.monitor_cb != NULL) {
+        s_hud.monitor_cb(disp_drv, time, px);
+    }
+}
+
+static bool is_read_timer(const lv_timer_t *timer)
+{
+    lv_indev_t *indev = lv_indev_get_next(NULL);
+
+    while (indev != NULL) {
+        if ((indev->driver != NULL) && (indev->driver->read_timer == timer)) {
+            return true;
+        }
+        indev = lv_indev_get_next(indev);
+    }
+
+    return false;
+}
+
+static void scan_timers(void)
+{
+    lv_timer_t *timer = lv_timer_get_next(NULL);
+    PerfHudTimer_t *slot = NULL;
+
+    s_hud.scan_id++;
+    while (timer != NULL) {
+        if ((timer == s_hud.report_timer) || is_read_timer(timer)) {
+            goto next;
+        }
+
+        slot = find_timer(timer);
+        if (timer->timer_cb != on_timer) {
+            // A new timer, or a timer whose callback was changed, possibly a new timer at the address of a deleted one
+            if (slot == NULL) {
+                slot = find_timer(NULL);
+                if (slot == NULL) {
+                    goto next;
+                }
+            }
+            slot->timer = timer;
+            slot->cb = timer->timer_cb;
+            slot->busy_us = 0;
+            slot->call_num = 0;
+            timer->timer_cb = on_timer;
+        }
+        if (slot != NULL) {
+            slot->scan_id = s_hud.scan_id;
+        }
+next:
+        timer = lv_timer_get_next(timer);
+    }
+
+    // Forget the deleted timers
+    for (int i = 0; i < ESP_BROOKESIA_PERF_HUD_TIMER_NUM_MAX; i++) {
+        if ((s_timers[i].timer != NULL) && (s_timers[i].scan_id != s_hud.scan_id)) {
+            memset(&s_timers[i], 0, sizeof(s_timers[i]));
+        }
+    }
+}
+
+static void update_stats(void)
+{
+    ESP_Brookesia_PerfHudStats_t *stats = &s_hud.stats;
+    int64_t now_us = get_time_us();
+    uint32_t period_us = (uint32_t)LV_MAX(now_us - s_hud.period_start_us, 1);
+    uint32_t screen_px = (uint32_t)lv_disp_get_hor_res(s_hud.disp) * lv_disp_get_ver_res(s_hud.disp);
+    uint64_t busy_us = 0;
+    int num = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->period_ms = period_us / 1000;
+    stats->frame_num = s_hud.frame_num;
+    if (s_hud.frame_num > 0) {
+        stats->render_avg_us = s_hud.render_sum_us / s_hud.frame_num;
+        stats->render_max_us = s_hud.render_max_us;
+        stats->flush_avg_us = s_hud.flush_sum_us / s_hud.frame_num;
+        stats->area_avg_px = s_hud.area_sum_px / s_hud.frame_num;
+        stats->area_avg_percent = (screen_px > 0) ? LV_MIN(stats->area_avg_px * 100ULL / screen_px, 100) : 0;
+    }
+
+    // Insertion sort of the busiest timers
+    for (int i = 0; i < ESP_BROOKESIA_PERF_HUD_TIMER_NUM_MAX; i++) {
+        PerfHudTimer_t *slot = &s_timers[i];
+        if ((slot->timer == NULL) || (slot->call_num == 0)) {
+            continue;
+        }
+        busy_us += slot->busy_us;
+
+        int pos = num;
+        while ((pos > 0) && (stats->top_timers[pos - 1].busy_us < slot->busy_us)) {
+            if (pos < ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM) {
+                stats->top_timers[pos] = stats->top_timers[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM) {
+            stats->top_timers[pos].cb = slot->cb;
+            stats->top_timers[pos].timer = slot->timer;
+            stats->top_timers[pos].busy_us = slot->busy_us;
+            stats->top_timers[pos].call_num = slot->call_num;
+            num = LV_MIN(num + 1, ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM);
+        }
+        slot->busy_us = 0;
+        slot->call_num = 0;
+    }
+    stats->top_timer_num = num;
+    stats->lv_busy_us = (uint32_t)busy_us;
+    stats->lv_busy_percent = LV_MIN(busy_us * 100 / period_us, 100);
+
+    s_hud.period_start_us = now_us;
+    s_hud.frame_num = 0;
+    s_hud.render_sum_us = 0;
+    s_hud.render_max_us = 0;
+    s_hud.flush_sum_us = 0;
+    s_hud.area_sum_px = 0;
+}
+
+static const char *get_timer_name(const ESP_Brookesia_PerfHudTimerStat_t *timer, char *buf, size_t size)
+{
+    if ((s_hud.disp != NULL) && (timer->timer == s_hud.disp->refr_timer)) {
+        return "refresh";
+    }
+    snprintf(buf, size, "%p", (void *)timer->cb);
+
+    return buf;
+}
+
+static void update_label(void)
+{
+    const ESP_Brookesia_PerfHudStats_t *stats = &s_hud.stats;
+    uint32_t period_ms = LV_MAX(stats->period_ms, 1);
+    char text[HUD_TEXT_LEN_MAX];
+    char name[16];
+    int len = 0;
+
+    len += snprintf(text + len, sizeof(text) - len, "FPS %d  render %d.%d/%d.%d ms\nflush %d.%d ms  area %d%%\n"
+                    "LVGL busy %d%%", (int)(stats->frame_num * 1000 / period_ms),
+                    (int)(stats->render_avg_us / 1000), (int)(stats->render_avg_us / 100 % 10),
+                    (int)(stats->render_max_us / 1000), (int)(stats->render_max_us / 100 % 10),
+                    (int)(stats->flush_avg_us / 1000), (int)(stats->flush_avg_us / 100 % 10),
+                    stats->area_avg_percent, stats->lv_busy_percent);
+    for (int i = 0; (i < stats->top_timer_num) && (len < (int)sizeof(text)); i++) {
+        len += snprintf(text + len, sizeof(text) - len, "\n%s %d%%",
+                        get_timer_name(&stats->top_timers[i], name, sizeof(name)),
+                        (int)(stats->top_timers[i].busy_us / 10 / period_ms));
+    }
+    lv_label_set_text(s_hud.label, text);
+}
+
+static void on_report_timer(lv_timer_t *timer)
+{
+    update_stats();
+    scan_timers();
+
+    if (s_hud.is_visible) {
+        update_label();
+    }
+#if ESP_BROOKESIA_PERF_HUD_LOG
+    const ESP_Brookesia_PerfHudStats_t *stats = &s_hud.stats;
+    char name[16];
+
+    ESP_BROOKESIA_LOGI("Frames: %d in %d ms, render: %d/%d us, flush: %d us, area: %d px (%d%%), LVGL busy: %d%%",
+                       stats->frame_num, (int)stats->period_ms, (int)stats->render_avg_us, (int)stats->render_max_us,
+                       (int)stats->flush_avg_us, (int)stats->area_avg_px, stats->area_avg_percent,
+                       stats->lv_busy_percent);
+    for (int i = 0; i < stats->top_timer_num; i++) {
+        ESP_BROOKESIA_LOGI("  Timer %s: %d us in %d calls", get_timer_name(&stats->top_timers[i], name, sizeof(name)),
+                           (int)stats->top_timers[i].busy_us, (int)stats->top_timers[i].call_num);
+    }
+#endif
+}
+
+static void on_touch_sample(const ESP_Brookesia_TouchSample_t *sample, void *user_data)
+{
+    lv_coord_t corner_w = lv_disp_get_hor_res(s_hud.disp) / HUD_TOGGLE_AREA_DIV;
+    lv_coord_t corner_h = lv_disp_get_ver_res(s_hud.disp) / HUD_TOGGLE_AREA_DIV;
+    bool in_corner = (sample->point.x < corner_w) && (sample->point.y < corner_h);
+
+    if (sample->state != LV_INDEV_STATE_PRESSED) {
+        s_hud.press_tick = 0;
+        s_hud.is_press_in_corner = false;
+        s_hud.is_toggled_by_press = false;
+        return;
+    }
+
+    if (s_hud.press_tick == 0) {
+        s_hud.press_tick = LV_MAX(lv_tick_get(), 1);
+        s_hud.is_press_in_corner = in_corner;
+        return;
+    }
+    s_hud.is_press_in_corner = s_hud.is_press_in_corner && in_corner;
+    if (s_hud.is_press_in_corner && !s_hud.is_toggled_by_press &&
+            (lv_tick_elaps(s_hud.press_tick) >= ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS)) {
+        s_hud.is_toggled_by_press = true;
+        esp_brookesia_core_perf_hud_set_visible(!s_hud.is_visible);
+    }
+}
+#endif /* ESP_BROOKESIA_PERF_HUD_ENABLE */
+
+bool esp_brookesia_core_perf_hud_begin(lv_disp_t *disp, lv_indev_t *touch)
+{
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    lv_obj_t *label = NULL;
+
+    ESP_BROOKESIA_LOGD("Begin perf HUD(%p, %p)", disp, touch);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(!s_hud.is_begun, false, "Already begun");
+    disp = (disp != NULL) ? disp : lv_disp_get_default();
+    ESP_BROOKESIA_CHECK_NULL_RETURN(disp, false, "Invalid display");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(disp->driver, false, "Invalid display driver");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(disp->driver->flush_cb, false, "Invalid flush callback");
+
+    label = lv_label_create(lv_disp_get_layer_sys(disp));
+    ESP_BROOKESIA_CHECK_NULL_RETURN(label, false, "Create label failed");
+    lv_obj_clear_flag(label, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_style_bg_color(label, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(label, LV_OPA_70, 0);
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(label, 4, 0);
+    lv_obj_align(label, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_label_set_text(label, "");
+
+    memset(&s_hud, 0, sizeof(s_hud));
+    memset(s_timers, 0, sizeof(s_timers));
+    s_hud.report_timer = lv_timer_create(on_report_timer, ESP_BROOKESIA_PERF_HUD_PERIOD_MS, NULL);
+    if (s_hud.report_timer == NULL) {
+        ESP_BROOKESIA_LOGE("Create report timer failed");
+        lv_obj_del(label);
+        return false;
+    }
+    s_hud.disp = disp;
+    s_hud.label = label;
+    s_hud.flush_cb = disp->driver->flush_cb;
+    s_hud.monitor_cb = disp->driver->monitor_cb;
+    disp->driver->flush_cb = on_flush;
+    disp->driver->monitor_cb = on_monitor;
+    s_hud.period_start_us = get_time_us();
+    scan_timers();
+
+    if ((touch != NULL) && (ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS > 0) &&
+            esp_brookesia_core_touch_hook_add(touch, on_touch_sample, NULL)) {
+        s_hud.touch = touch;
+    }
+    s_hud.is_begun = true;
+    esp_brookesia_core_perf_hud_set_visible(ESP_BROOKESIA_PERF_HUD_SHOW_AT_START);
+
+    return true;
+#else
+    return true;
+#endif
+}
+
+void esp_brookesia_core_perf_hud_end(void)
+{
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    lv_timer_t *timer = NULL;
+
+    if (!s_hud.is_begun) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("End perf HUD");
+    if (s_hud.touch != NULL) {
+        esp_brookesia_core_touch_hook_remove(s_hud.touch, on_touch_sample, NULL);
+    }
+
+    timer = lv_timer_get_next(NULL);
+    while (timer != NULL) {
+        PerfHudTimer_t *slot = (timer->timer_cb == on_timer) ? find_timer(timer) : NULL;
+        if (slot != NULL) {
+            timer->timer_cb = slot->cb;
+        }
+        timer = lv_timer_get_next(timer);
+    }
+    if (s_hud.disp->driver->flush_cb == on_flush) {
+        s_hud.disp->driver->flush_cb = s_hud.flush_cb;
+    }
+    if (s_hud.disp->driver->monitor_cb == on_monitor) {
+        s_hud.disp->driver->monitor_cb = s_hud.monitor_cb;
+    }
+    lv_timer_del(s_hud.report_timer);
+    lv_obj_del(s_hud.label);
+
+    memset(&s_hud, 0, sizeof(s_hud));
+    memset(s_timers, 0, sizeof(s_timers));
+#endif
+}
+
+void esp_brookesia_core_perf_hud_set_visible(bool visible)
+{
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    if (!s_hud.is_begun) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("Set perf HUD %s", visible ? "visible" : "hidden");
+    s_hud.is_visible = visible;
+    if (visible) {
+        update_label();
+        lv_obj_clear_flag(s_hud.label, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(s_hud.label, LV_OBJ_FLAG_HIDDEN);
+    }
+#endif
+}
+
+bool esp_brookesia_core_perf_hud_is_visible(void)
+{
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    return s_hud.is_visible;
+#else
+    return false;
+#endif
+}
+
+bool esp_brookesia_core_perf_hud_get_stats(ESP_Brookesia_PerfHudStats_t *stats)
+{
+    ESP_BROOKESIA_CHECK_NULL_RETURN(stats, false, "Invalid stats");
+
+#if ESP_BROOKESIA_PERF_HUD_ENABLE
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(s_hud.is_begun, false, "Not begun");
+    *stats = s_hud.stats;
+
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "esp_brookesia_conf_internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_PERF_HUD_TIMER_NUM_MAX    (64)
+
+typedef struct {
+    lv_timer_cb_t cb;           /*!< Callback of the timer, identifies it together with `timer` */
+    const lv_timer_t *timer;
+    uint32_t busy_us;           /*!< Time spent in the callback during the period */
+    uint32_t call_num;
+} ESP_Brookesia_PerfHudTimerStat_t;
+
+typedef struct {
+    uint32_t period_ms;         /*!< Length of the measured period */
+    uint16_t frame_num;         /*!< Number of refreshes that drew something */
+    uint32_t render_avg_us;     /*!< Average duration of a refresh, flush included */
+    uint32_t render_max_us;
+    uint32_t flush_avg_us;      /*!< Average time per refresh spent in `flush_cb` */
+    uint32_t area_avg_px;       /*!< Average number of pixels drawn per refresh */
+    uint8_t area_avg_percent;   /*!< Same as `area_avg_px`, in percent of the screen */
+    uint32_t lv_busy_us;        /*!< Time spent in the callbacks of all measured LVGL timers */
+    uint8_t lv_busy_percent;    /*!< Same as `lv_busy_us`, in percent of the period */
+    uint8_t top_timer_num;
+    ESP_Brookesia_PerfHudTimerStat_t top_timers[ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM];
+} ESP_Brookesia_PerfHudStats_t;
+
+/**
+ * @brief Start measuring the rendering of a display and create the HUD overlay on its system layer. Must be called
+ *        with the LVGL lock held. Does nothing if `ESP_BROOKESIA_PERF_HUD_ENABLE` is 0.
+ *
+ * The `flush_cb` and `monitor_cb` of the display driver are chained, and the callbacks of the LVGL timers are
+ * wrapped to measure them, new timers are picked up at every period. The read timers of input devices are not
+ * wrapped, so they can be wrapped by `esp_brookesia_core_touch_hook_add()`. Code that saves and calls the callback
+ * of another timer itself should not run while the HUD is started.
+ *
+ * @param disp Display to measure, NULL for the default one
+ * @param touch Touch device for the toggle gesture (press and hold the top left corner), can be NULL
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_perf_hud_begin(lv_disp_t *disp, lv_indev_t *touch);
+
+/**
+ * @brief Stop measuring, restore the callbacks and delete the overlay. Must be called with the LVGL lock held.
+ *
+ */
+void esp_brookesia_core_perf_hud_end(void);
+
+/**
+ * @brief Show or hide the overlay. The measurements go on while it is hidden. Must be called with the LVGL lock held.
+ *
+ * @param visible true to show it
+ *
+ */
+void esp_brookesia_core_perf_hud_set_visible(bool visible);
+
+/**
+ * @brief Check if the overlay is shown
+ *
+ */
+bool esp_brookesia_core_perf_hud_is_visible(void);
+
+/**
+ * @brief Get the statistics of the last finished period. Must be called with the LVGL lock held.
+ *
+ * @param stats Pointer to the copy
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_perf_hud_get_stats(ESP_Brookesia_PerfHudStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_touch_hook.h"
+
+typedef struct {
+    lv_indev_t *indev;
+    ESP_Brookesia_TouchHookCallback_t cb;
+    void *user_data;
+} TouchHookListener_t;
+
+typedef struct {
+    lv_indev_t *indev;
+    lv_timer_cb_t read_cb;
+} TouchHookDevice_t;
+
+static TouchHookListener_t s_listeners[ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM];
+static TouchHookDevice_t s_devices[ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM];
+
+static TouchHookDevice_t *find_device(const lv_indev_t *indev)
+{
+    for (int i = 0; i < ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM; i++) {
+        if (s_devices[i].indev == indev) {
+            return &s_devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int get_listener_num(const lv_indev_t *indev)
+{
+    int num = 0;
+
+    for (int i = 0; i < ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM; i++) {
+        num += (s_listeners[i].indev == indev) ? 1 : 0;
+    }
+
+    return num;
+}
+
+static void on_read_timer(lv_timer_t *timer)
+{
+    lv_indev_t *indev = (lv_indev_t *)timer->user_data;
+    TouchHookDevice_t *device = find_device(indev);
+    ESP_Brookesia_TouchSample_t sample = {
+        .indev = indev,
+    };
+
+    if ((device == NULL) || (device->read_cb == NULL)) {
+        lv_indev_read_timer_cb(timer);
+        return;
+    }
+
+    // Let LVGL read and process the sample first, so listeners see the same state and point as the widgets
+    device->read_cb(timer);
+
+    sample.state = indev->proc.state;
+    lv_indev_get_point(indev, &sample.point);
+    for (int i = 0; i < ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM; i++) {
+        if ((s_listeners[i].indev == indev) && (s_listeners[i].cb != NULL)) {
+            s_listeners[i].cb(&sample, s_listeners[i].user_data);
+        }
+    }
+}
+
+bool esp_brookesia_core_touch_hook_add(lv_indev_t *indev, ESP_Brookesia_TouchHookCallback_t cb, void *user_data)
+{
+    TouchHookListener_t *listener = NULL;
+    TouchHookDevice_t *device = NULL;
+    lv_timer_t *read_timer = NULL;
+
+    ESP_BROOKESIA_LOGD("Add touch hook(%p, %p)", indev, user_data);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(indev, false, "Invalid indev");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(cb, false, "Invalid callback");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(lv_indev_get_type(indev) == LV_INDEV_TYPE_POINTER, false, "Not a pointer device");
+    read_timer = (indev->driver != NULL) ? indev->driver->read_timer : NULL;
+    ESP_BROOKESIA_CHECK_NULL_RETURN(read_timer, false, "Invalid read timer");
+
+    for (int i = 0; i < ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM; i++) {
+        if (s_listeners[i].indev == NULL) {
+            listener = &s_listeners[i];
+            break;
+        }
+    }
+    ESP_BROOKESIA_CHECK_NULL_RETURN(listener, false, "No free listener");
+
+    device = find_device(indev);
+    if (device == NULL) {
+        device = find_device(NULL);
+        ESP_BROOKESIA_CHECK_NULL_RETURN(device, false, "No free device");
+        device->indev = indev;
+        device->read_cb = read_timer->timer_cb;
+        read_timer->timer_cb = on_read_timer;
+    }
+
+    listener->indev = indev;
+    listener->cb = cb;
+    listener->user_data = user_data;
+
+    return true;
+}
+
+bool esp_brookesia_core_touch_hook_remove(lv_indev_t *indev, ESP_Brookesia_TouchHookCallback_t cb, void *user_data)
+{
+    TouchHookListener_t *listener = NULL;
+    TouchHookDevice_t *device = NULL;
+    lv_timer_t *read_timer = NULL;
+
+    ESP_BROOKESIA_LOGD("Remove touch hook(%p, %p)", indev, user_data);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(indev, false, "Invalid indev");
+
+    for (int i = 0; i < ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM; i++) {
+        if ((s_listeners[i].indev == indev) && (s_listeners[i].cb == cb) && (s_listeners[i].user_data == user_data)) {
+            listener = &s_listeners[i];
+            break;
+        }
+    }
+    ESP_BROOKESIA_CHECK_NULL_RETURN(listener, false, "Listener not found");
+    listener->indev = NULL;
+    listener->cb = NULL;
+    listener->user_data = NULL;
+
+    if (get_listener_num(indev) > 0) {
+        return true;
+    }
+
+    // Give the read timer back to LVGL once nobody listens anymore
+    device = find_device(indev);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(device, false, "Device not found");
+    read_timer = (indev->driver != NULL) ? indev->driver->read_timer : NULL;
+    if ((read_timer != NULL) && (read_timer->timer_cb == on_read_timer)) {
+        read_timer->timer_cb = device->read_cb;
+    }
+    device->indev = NULL;
+    device->read_cb = NULL;
+
+    return true;
+}
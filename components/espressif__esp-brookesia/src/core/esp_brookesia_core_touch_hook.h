@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_BROOKESIA_TOUCH_HOOK_LISTENER_NUM  (4)
+
+typedef struct {
+    lv_indev_t *indev;
+    lv_indev_state_t state;
+    lv_point_t point;       /*!< Point after the display rotation, the last pressed point if released */
+} ESP_Brookesia_TouchSample_t;
+
+/**
+ * @brief Called in the LVGL task right after each read of the input device, once LVGL has processed the sample.
+ *        Listeners must not add or remove hooks from this callback.
+ *
+ */
+typedef void (*ESP_Brookesia_TouchHookCallback_t)(const ESP_Brookesia_TouchSample_t *sample, void *user_data);
+
+/**
+ * @brief Get each sample of a pointer input device as it is read. The read timer of the device is wrapped by the first
+ *        listener and restored when the last one is removed. Must be called with the LVGL lock held.
+ *
+ * @param indev Input device, must be a pointer device
+ * @param cb Callback of the listener
+ * @param user_data User data passed to the callback
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_touch_hook_add(lv_indev_t *indev, ESP_Brookesia_TouchHookCallback_t cb, void *user_data);
+
+/**
+ * @brief Remove a listener added by `esp_brookesia_core_touch_hook_add()`. Must be called with the LVGL lock held.
+ *
+ * @param indev Input device
+ * @param cb Callback of the listener
+ * @param user_data User data of the listener
+ *
+ * @return true if successful, otherwise false
+ *
+ */
+bool esp_brookesia_core_touch_hook_remove(lv_indev_t *indev, ESP_Brookesia_TouchHookCallback_t cb, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -60,6 +60,8 @@ typedef struct {
     } app;
     struct {
         uint8_t enable_app_save_snapshot: 1;
+        uint8_t enable_app_snapshot_downscale: 1;   /*!< If this flag is enabled, the snapshot is rendered at the size
+                                                         set by `setAppSnapshotFitSize()` instead of the screen size */
     } flags;
 } ESP_Brookesia_CoreManagerData_t;
 
@@ -92,7 +94,22 @@ typedef struct {
                                                      status bar. Otherwise, the app's screens will be displayed in full screen,
                                                      but some areas might be not visible. The app can call the `getVisualArea()`
                                                      function to retrieve the final visual area */
+        uint8_t enable_lazy_init: 1;            /*!< If this flag is enabled, the core only registers the app when it
+                                                     is installed, and calls the app's `init()` function on its first
+                                                     launch (or earlier when idle, see
+                                                     `ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS`) */
     } flags;                                    /*!< Core app data flags */
+    struct {
+        uint32_t caps;                          /*!< Heap caps (`MALLOC_CAP_*`) preferred by the LVGL objects created
+                                                     while the app records its resources and by its snapshot, such as
+                                                     `MALLOC_CAP_INTERNAL` for latency sensitive apps or
+                                                     `MALLOC_CAP_SPIRAM` for bulk ones. Allocations that don't fit
+                                                     use the default memory. 0: default memory. The LVGL objects need
+                                                     `ESP_BROOKESIA_MEMORY_APP_CAPS` */
+        uint32_t quota_kb;                      /*!< Soft heap quota in KB. If the recorded heap usage of the app is
+                                                     above it after the app runs, resumes or pauses, the core asks the
+                                                     app to trim memory. 0: no quota */
+    } memory;                                   /*!< Core app memory policy */
 } ESP_Brookesia_CoreAppData_t;
 
 /**
@@ -129,9 +146,16 @@ typedef enum {
     ESP_BROOKESIA_CORE_APP_EVENT_TYPE_START = 0,
     ESP_BROOKESIA_CORE_APP_EVENT_TYPE_STOP,
     ESP_BROOKESIA_CORE_APP_EVENT_TYPE_OPERATION,
+    ESP_BROOKESIA_CORE_APP_EVENT_TYPE_PREWARM,      // Initialize a lazily initialized app before it is started
     ESP_BROOKESIA_CORE_APP_EVENT_TYPE_MAX,
 } ESP_Brookesia_CoreAppEventType_t;
 
+typedef enum {
+    ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_RUNNING = 0,  /*!< The app is active and the free heap is low */
+    ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_BACKGROUND,   /*!< The app is paused and the free heap is low */
+    ESP_BROOKESIA_CORE_APP_TRIM_LEVEL_COMPLETE,     /*!< The app is paused and will be closed if the heap stays low */
+} ESP_Brookesia_CoreAppTrimLevel_t;
+
 typedef struct {
     int id;
     ESP_Brookesia_CoreAppEventType_t type;
@@ -155,6 +179,11 @@ typedef enum {
     ESP_BROOKESIA_CORE_NAVIGATE_TYPE_MAX,
 } ESP_Brookesia_CoreNavigateType_t;
 
+typedef enum {
+    ESP_BROOKESIA_CORE_DISPLAY_STATE_ON = 0,
+    ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF,       /*!< Nothing is drawn, LVGL animations stand still */
+} ESP_Brookesia_CoreDisplayState_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_brookesia_core_utils.h"
+#include "esp_brookesia_core_ui_queue.hpp"
+
+#if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_CORE_CORE
+#undef ESP_BROOKESIA_LOGD
+#define ESP_BROOKESIA_LOGD(...)
+#endif
+
+using namespace std;
+
+static uint32_t hashKey(const char *key)
+{
+    // FNV-1a, 0 is reserved for free slots
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash = (hash ^ (uint8_t)*key++) * 16777619u;
+    }
+
+    return (hash == 0) ? 1 : hash;
+}
+
+ESP_Brookesia_CoreUiQueue::ESP_Brookesia_CoreUiQueue():
+    _enabled(false),
+    _has_pending(false)
+{
+}
+
+bool ESP_Brookesia_CoreUiQueue::post(const char *key, Callback callback, const void *data, size_t size, void *user_data)
+{
+    Slot *slot = nullptr;
+    uint32_t sequence = 0;
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(_enabled.load(memory_order_acquire), false, "UI queue is not enabled");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((key != nullptr) && (callback != nullptr), false, "Invalid key or callback");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((size <= DATA_SIZE_MAX) && ((size == 0) || (data != nullptr)), false,
+                                     "Invalid data(size: %d, max: %d)", (int)size, (int)DATA_SIZE_MAX);
+
+    slot = claimSlot(hashKey(key));
+    ESP_BROOKESIA_CHECK_NULL_RETURN(slot, false, "No free slot for key(%s)", key);
+
+    // Another task is writing the same key right now, keep its value instead of waiting for it
+    if (slot->writing.exchange(true, memory_order_acquire)) {
+        ESP_BROOKESIA_LOGD("Key(%s) is being posted by another task, skip", key);
+        return true;
+    }
+    sequence = slot->sequence.load(memory_order_relaxed);
+    slot->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->callback = callback;
+    slot->user_data = user_data;
+    slot->size = size;
+    if (size > 0) {
+        memcpy(slot->data, data, size);
+    }
+    slot->sequence.store(sequence + 2, memory_order_release);
+    slot->writing.store(false, memory_order_release);
+
+    slot->pending.store(true, memory_order_release);
+    _has_pending.store(true, memory_order_release);
+
+    return true;
+}
+
+size_t ESP_Brookesia_CoreUiQueue::drain(void)
+{
+    size_t count = 0;
+    uint32_t sequence = 0;
+    Callback callback = nullptr;
+    void *user_data = nullptr;
+    uint8_t data[DATA_SIZE_MAX];
+
+    if (!_has_pending.exchange(false, memory_order_acquire)) {
+        return 0;
+    }
+
+    for (auto &slot : _slots) {
+        if ((slot.key.load(memory_order_acquire) == 0) || !slot.pending.exchange(false, memory_order_acquire)) {
+            continue;
+        }
+
+        // Copy the data out first, the callback runs without touching the slot
+        sequence = slot.sequence.load(memory_order_acquire);
+        callback = slot.callback;
+        user_data = slot.user_data;
+        memcpy(data, slot.data, slot.size);
+        atomic_thread_fence(memory_order_acquire);
+        if ((sequence & 1) || (slot.sequence.load(memory_order_relaxed) != sequence)) {
+            // A post is writing this slot, it marks the slot pending again when done
+            continue;
+        }
+
+        callback(data, user_data);
+        count++;
+    }
+
+    return count;
+}
+
+void ESP_Brookesia_CoreUiQueue::reset(void)
+{
+    setEnabled(false);
+    _has_pending.store(false, memory_order_relaxed);
+    for (auto &slot : _slots) {
+        slot.key.store(0, memory_order_relaxed);
+        slot.pending.store(false, memory_order_relaxed);
+        slot.callback = nullptr;
+        slot.user_data = nullptr;
+        slot.size = 0;
+    }
+}
+
+ESP_Brookesia_CoreUiQueue::Slot *ESP_Brookesia_CoreUiQueue::claimSlot(uint32_t key)
+{
+    uint32_t expected = 0;
+
+    // Open addressing, slots are only freed by `reset()`
+    for (size_t i = 0; i < SLOT_NUM; i++) {
+        Slot &slot = _slots[(key + i) % SLOT_NUM];
+        expected = slot.key.load(memory_order_acquire);
+        if (expected == key) {
+            return &slot;
+        }
+        if ((expected == 0) && (slot.key.compare_exchange_strong(expected, key, memory_order_acq_rel) ||
+                                (expected == key))) {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,52 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Keyed posts from any task to the LVGL task. A post only copies its data into the slot of its key, the LVGL
+ *        task runs the callbacks of all the keys posted since the last drain in one go. Posting the same key again
+ *        before the drain replaces the previous data, so only the latest value of the key is shown.
+ *
+ * @note  Posting never blocks and never takes the LVGL lock. If two tasks post the same key at the same moment, one of
+ *        the two values is kept.
+ *
+ */
+class ESP_Brookesia_CoreUiQueue {
+public:
+    using Callback = void (*)(const void *data, void *user_data);
+
+    static constexpr size_t SLOT_NUM = 32;
+    static constexpr size_t DATA_SIZE_MAX = 24;
+
+    ESP_Brookesia_CoreUiQueue();
+
+    bool post(const char *key, Callback callback, const void *data, size_t size, void *user_data);
+    size_t drain(void);
+    void setEnabled(bool enabled)   { _enabled.store(enabled, std::memory_order_release); }
+    void reset(void);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> key{0};           // Hash of the key, 0 if the slot is free
+        std::atomic<uint32_t> sequence{0};      // Odd while the data is being written
+        std::atomic<bool> writing{false};
+        std::atomic<bool> pending{false};
+        Callback callback = nullptr;
+        void *user_data = nullptr;
+        size_t size = 0;
+        uint8_t data[DATA_SIZE_MAX] = {};
+    };
+
+    Slot *claimSlot(uint32_t key);
+
+    std::atomic<bool> _enabled;
+    std::atomic<bool> _has_pending;
+    Slot _slots[SLOT_NUM];
+};
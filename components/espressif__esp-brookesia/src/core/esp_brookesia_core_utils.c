@@ -8,6 +8,9 @@
 #include <time.h>
 #include "esp_brookesia_conf_internal.h"
 #include "esp_brookesia_core_utils.h"
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#endif
 
 const char *esp_brookesia_core_utils_path_to_file_name(const char *path)
 {
@@ -211,3 +214,12 @@ lv_anim_path_cb_t esp_brookesia_core_utils_get_anim_path_cb(ESP_Brookesia_LvAnim
 
     return NULL;
 }
+
+size_t esp_brookesia_core_utils_get_free_heap_size(void)
+{
+#if defined(ESP_PLATFORM)
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#else
+    return 0;
+#endif
+}
@@ -9,6 +9,9 @@
 #include "lvgl.h"
 #include "esp_brookesia_conf_internal.h"
 #include "esp_brookesia_core_type.h"
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+#include "esp_brookesia_core_log.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,8 +59,27 @@ extern "C" {
         else { }                                                                    \
     } while(0)
 
+#if ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+/* Errors are printed at once, other logs by the deferred log task */
+#define LOG_LEVEL_OUTPUT(level, format, ...) do {                                                       \
+        if (level < ESP_BROOKESIA_LOG_LEVEL_ERROR) { ESP_BROOKESIA_CORE_LOG_DEFER(level, format, ##__VA_ARGS__); } \
+        else { LOG_LEVEL(level, format, ##__VA_ARGS__); }                                                \
+    } while(0)
+#else
+#define LOG_LEVEL_OUTPUT(level, format, ...) LOG_LEVEL(level, format, ##__VA_ARGS__)
+#endif
+
+/**
+ * Level of the logs of a file, define it before including any header of the library to filter the file more or less
+ * than `ESP_BROOKESIA_LOG_LEVEL`. The level of each log is a constant, so the filtered ones are removed at compile time.
+ *
+ */
+#ifndef ESP_BROOKESIA_LOG_LOCAL_LEVEL
+#define ESP_BROOKESIA_LOG_LOCAL_LEVEL   ESP_BROOKESIA_LOG_LEVEL
+#endif
+
 #define LOG_LEVEL_LOCAL(level, format, ...) do {                                \
-        if (level >= ESP_BROOKESIA_LOG_LEVEL) LOG_LEVEL(level, format, ##__VA_ARGS__); \
+        if (level >= ESP_BROOKESIA_LOG_LOCAL_LEVEL) LOG_LEVEL_OUTPUT(level, format, ##__VA_ARGS__); \
     } while(0)
 
 #define ESP_BROOKESIA_LOGD(format, ...) LOG_LEVEL_LOCAL(ESP_BROOKESIA_LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
@@ -245,6 +267,8 @@ lv_indev_t *esp_brookesia_core_utils_get_input_dev(const lv_disp_t *display, lv_
 
 lv_anim_path_cb_t esp_brookesia_core_utils_get_anim_path_cb(ESP_Brookesia_LvAnimationPathType_t type);
 
+size_t esp_brookesia_core_utils_get_free_heap_size(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <cstring>
 #include <memory>
 #include <string>
 #include <list>
@@ -14,7 +15,7 @@
 #include "esp_brookesia_core_type.h"
 
 template <typename T>
-using ESP_Brookesia_NameStylesheetMap_t = std::unordered_map<std::string, std::shared_ptr<T>>;
+using ESP_Brookesia_NameStylesheetMap_t = std::unordered_map<std::string, std::shared_ptr<const T>>;
 
 template <typename T>
 using ESP_Brookesia_ResolutionNameStylesheetMap_t = std::map<uint32_t, ESP_Brookesia_NameStylesheetMap_t<T>>;
@@ -73,7 +74,29 @@ protected:
     bool del(void);
 
 private:
+    static constexpr size_t COMPILED_STYLESHEET_NUM_MAX = 4;
+
+    using CompiledStylesheet_t = struct {
+        uint32_t resolution;
+        std::shared_ptr<const T> source;
+        std::shared_ptr<const T> compiled;
+    };
+
+    /**
+     * @brief Get the stylesheet calibrated for the screen size, only calibrate it if the same stylesheet was not
+     *        calibrated for this resolution before
+     *
+     * @param calibrate_size The calibrated screen size
+     * @param stylesheet The stylesheet with the original (percentage) values
+     *
+     * @return calibrated stylesheet, or nullptr if failed
+     *
+     */
+    std::shared_ptr<const T> compileStylesheet(const ESP_Brookesia_StyleSize_t &calibrate_size, const T &stylesheet);
+
     ESP_Brookesia_ResolutionNameStylesheetMap_t<T> _resolution_name_stylesheet_map;
+    // Most recently used first
+    std::list<CompiledStylesheet_t> _compiled_stylesheets;
 
     uint32_t getResolution(const ESP_Brookesia_StyleSize_t &screen_size)
     {
@@ -102,15 +125,15 @@ bool ESP_Brookesia_StyleSheetTemplate<T>::addStylesheet(const char *name, const
 {
     uint32_t resolution = 0;
     ESP_Brookesia_StyleSize_t calibrate_size = screen_size;
-    std::shared_ptr<T> calibration_stylesheet = std::make_shared<T>(stylesheet);
+    std::shared_ptr<const T> calibration_stylesheet = nullptr;
 
     ESP_BROOKESIA_CHECK_NULL_RETURN(name, false, "Invalid name");
-    ESP_BROOKESIA_CHECK_NULL_RETURN(calibration_stylesheet, false, "Create stylesheet failed");
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(calibrateScreenSize(calibrate_size), false, "Invalid screen size");
     ESP_BROOKESIA_LOGD("Add stylesheet(%s - %dx%d)", name, calibrate_size.width, calibrate_size.height);
 
-    ESP_BROOKESIA_CHECK_FALSE_RETURN(calibrateStylesheet(calibrate_size, *calibration_stylesheet), false, "Invalid stylesheet");
+    calibration_stylesheet = compileStylesheet(calibrate_size, stylesheet);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(calibration_stylesheet, false, "Invalid stylesheet");
 
     // Check if the resolution is already exist
     resolution = getResolution(calibrate_size);
@@ -142,11 +165,8 @@ bool ESP_Brookesia_StyleSheetTemplate<T>::activateStylesheet(const ESP_Brookesia
     ESP_BROOKESIA_CHECK_FALSE_RETURN(calibrateScreenSize(calibrate_size), false, "Invalid screen size");
     ESP_BROOKESIA_LOGD("Activate stylesheet(%dx%d)", calibrate_size.width, calibrate_size.height);
 
-    std::shared_ptr<T> calibration_stylesheet = std::make_shared<T>(stylesheet);
-    ESP_BROOKESIA_CHECK_NULL_RETURN(calibration_stylesheet, false, "Create stylesheet failed");
-    ESP_BROOKESIA_CHECK_FALSE_RETURN(
-        calibrateStylesheet(calibrate_size, *calibration_stylesheet), false, "Invalid stylesheet"
-    );
+    std::shared_ptr<const T> calibration_stylesheet = compileStylesheet(calibrate_size, stylesheet);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(calibration_stylesheet, false, "Invalid stylesheet");
 
     _active_stylesheet = *calibration_stylesheet;
 
@@ -250,7 +270,7 @@ const T *ESP_Brookesia_StyleSheetTemplate<T>::getStylesheet(const ESP_Brookesia_
         return nullptr;
     }
 
-    auto name_map = it_resolution_map->second;
+    auto &name_map = it_resolution_map->second;
     if (name_map.empty()) {
         return nullptr;
     }
@@ -263,6 +283,41 @@ bool ESP_Brookesia_StyleSheetTemplate<T>::del(void)
 {
     _active_stylesheet = {};
     _resolution_name_stylesheet_map.clear();
+    _compiled_stylesheets.clear();
 
     return true;
 }
+
+template <typename T>
+std::shared_ptr<const T> ESP_Brookesia_StyleSheetTemplate<T>::compileStylesheet(
+    const ESP_Brookesia_StyleSize_t &calibrate_size, const T &stylesheet
+)
+{
+    uint32_t resolution = getResolution(calibrate_size);
+
+    // Stylesheets are plain structs, equal bytes mean equal values (a different padding only costs a calibration)
+    for (auto it = _compiled_stylesheets.begin(); it != _compiled_stylesheets.end(); it++) {
+        if ((it->resolution == resolution) && (memcmp(it->source.get(), &stylesheet, sizeof(T)) == 0)) {
+            ESP_BROOKESIA_LOGD("Use compiled stylesheet(%dx%d)", calibrate_size.width, calibrate_size.height);
+            _compiled_stylesheets.splice(_compiled_stylesheets.begin(), _compiled_stylesheets, it);
+            return _compiled_stylesheets.front().compiled;
+        }
+    }
+
+    std::shared_ptr<T> source = std::make_shared<T>(stylesheet);
+    std::shared_ptr<T> compiled = std::make_shared<T>(stylesheet);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN((source != nullptr) && (compiled != nullptr), nullptr, "Create stylesheet failed");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(calibrateStylesheet(calibrate_size, *compiled), nullptr, "Calibrate stylesheet failed");
+
+    _compiled_stylesheets.push_front({
+        .resolution = resolution,
+        .source = source,
+        .compiled = compiled,
+    });
+    // Stylesheets added by name stay referenced by the name map after they leave the cache
+    while (_compiled_stylesheets.size() > COMPILED_STYLESHEET_NUM_MAX) {
+        _compiled_stylesheets.pop_back();
+    }
+
+    return compiled;
+}
@@ -15,6 +15,12 @@
 
 /* Core */
 #include "core/esp_brookesia_core_utils.h"
+#include "core/esp_brookesia_core_boot_profile.h"
+#include "core/esp_brookesia_core_touch_hook.h"
+#include "core/esp_brookesia_core_image_cache.h"
+#include "core/esp_brookesia_core_glyph_cache.h"
+#include "core/esp_brookesia_core_perf_hud.h"
+#include "core/esp_brookesia_core_app_state.h"
 #include "core/esp_brookesia_style_type.h"
 #include "core/esp_brookesia_core_type.h"
 #include "core/esp_brookesia_lv_type.h"
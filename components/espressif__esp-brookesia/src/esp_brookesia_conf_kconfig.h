@@ -165,6 +165,113 @@
     #endif
 #endif
 
+/* Deferred logs */
+#ifndef ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+    #ifdef CONFIG_ESP_BROOKESIA_LOG_DEFERRED_ENABLE
+        #define ESP_BROOKESIA_LOG_DEFERRED_ENABLE          (CONFIG_ESP_BROOKESIA_LOG_DEFERRED_ENABLE)
+    #else
+        #define ESP_BROOKESIA_LOG_DEFERRED_ENABLE          (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM
+    #ifdef CONFIG_ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM
+        #define ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM      (CONFIG_ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM)
+    #else
+        #define ESP_BROOKESIA_LOG_DEFERRED_RECORD_NUM      (64)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_LOG_DEFERRED_STR_LEN
+    #ifdef CONFIG_ESP_BROOKESIA_LOG_DEFERRED_STR_LEN
+        #define ESP_BROOKESIA_LOG_DEFERRED_STR_LEN         (CONFIG_ESP_BROOKESIA_LOG_DEFERRED_STR_LEN)
+    #else
+        #define ESP_BROOKESIA_LOG_DEFERRED_STR_LEN         (32)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY
+    #ifdef CONFIG_ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY
+        #define ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY   (CONFIG_ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY)
+    #else
+        #define ESP_BROOKESIA_LOG_DEFERRED_TASK_PRIORITY   (1)
+    #endif
+#endif
+
+/* Boot profile */
+#ifndef ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+    #ifdef CONFIG_ESP_BROOKESIA_BOOT_PROFILE_ENABLE
+        #define ESP_BROOKESIA_BOOT_PROFILE_ENABLE      (CONFIG_ESP_BROOKESIA_BOOT_PROFILE_ENABLE)
+    #else
+        #define ESP_BROOKESIA_BOOT_PROFILE_ENABLE      (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM
+    #ifdef CONFIG_ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM
+        #define ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM    (CONFIG_ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM)
+    #else
+        #define ESP_BROOKESIA_BOOT_PROFILE_SPAN_NUM    (48)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS
+    #ifdef CONFIG_ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS
+        #define ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS   (CONFIG_ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS)
+    #else
+        #define ESP_BROOKESIA_BOOT_PROFILE_BUDGET_MS   (0)
+    #endif
+#endif
+
+/* Performance HUD */
+#ifndef ESP_BROOKESIA_PERF_HUD_ENABLE
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_ENABLE
+        #define ESP_BROOKESIA_PERF_HUD_ENABLE            (CONFIG_ESP_BROOKESIA_PERF_HUD_ENABLE)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_ENABLE            (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_PERF_HUD_SHOW_AT_START
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_SHOW_AT_START
+        #define ESP_BROOKESIA_PERF_HUD_SHOW_AT_START     (CONFIG_ESP_BROOKESIA_PERF_HUD_SHOW_AT_START)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_SHOW_AT_START     (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_PERF_HUD_PERIOD_MS
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_PERIOD_MS
+        #define ESP_BROOKESIA_PERF_HUD_PERIOD_MS         (CONFIG_ESP_BROOKESIA_PERF_HUD_PERIOD_MS)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_PERIOD_MS         (1000)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM
+        #define ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM     (CONFIG_ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_TOP_TIMER_NUM     (3)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS
+        #define ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS   (CONFIG_ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_TOGGLE_PRESS_MS   (2000)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_PERF_HUD_LOG
+    #ifdef CONFIG_ESP_BROOKESIA_PERF_HUD_LOG
+        #define ESP_BROOKESIA_PERF_HUD_LOG               (CONFIG_ESP_BROOKESIA_PERF_HUD_LOG)
+    #else
+        #define ESP_BROOKESIA_PERF_HUD_LOG               (0)
+    #endif
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////// Memory /////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -207,6 +314,122 @@
     #endif
 #endif /* ESP_BROOKESIA_MEMORY_USE_CUSTOM */
 
+#ifndef ESP_BROOKESIA_MEMORY_APP_CAPS
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_APP_CAPS
+        #define ESP_BROOKESIA_MEMORY_APP_CAPS   (CONFIG_ESP_BROOKESIA_MEMORY_APP_CAPS)
+    #else
+        #define ESP_BROOKESIA_MEMORY_APP_CAPS   (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_APP_SNAPSHOT
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_APP_SNAPSHOT
+        #define ESP_BROOKESIA_MEMORY_APP_SNAPSHOT   (CONFIG_ESP_BROOKESIA_MEMORY_APP_SNAPSHOT)
+    #else
+        #define ESP_BROOKESIA_MEMORY_APP_SNAPSHOT   (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_LV_POOL_KB
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_LV_POOL_KB
+        #define ESP_BROOKESIA_MEMORY_LV_POOL_KB     (CONFIG_ESP_BROOKESIA_MEMORY_LV_POOL_KB)
+    #else
+        #define ESP_BROOKESIA_MEMORY_LV_POOL_KB     (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE
+        #define ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE  (CONFIG_ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE)
+    #else
+        #define ESP_BROOKESIA_MEMORY_LV_SMALL_SIZE  (256)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB
+        #define ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB   (CONFIG_ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB)
+    #else
+        #define ESP_BROOKESIA_MEMORY_LOW_THRESHOLD_KB   (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS
+        #define ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS    (CONFIG_ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS)
+    #else
+        #define ESP_BROOKESIA_MEMORY_CHECK_PERIOD_MS    (1000)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB
+        #define ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB     (CONFIG_ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB)
+    #else
+        #define ESP_BROOKESIA_MEMORY_IMAGE_CACHE_KB     (0)
+    #endif
+#endif
+#ifndef ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD
+        #define ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD    (CONFIG_ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD)
+    #else
+        #define ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD    (0)
+    #endif
+#endif
+#ifndef ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB
+    #ifdef CONFIG_ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB
+        #define ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB     (CONFIG_ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB)
+    #else
+        #define ESP_BROOKESIA_MEMORY_GLYPH_CACHE_KB     (0)
+    #endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////// App //////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS
+    #ifdef CONFIG_ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS
+        #define ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS  (CONFIG_ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS)
+    #else
+        #define ESP_BROOKESIA_APP_LAZY_INIT_PREWARM_MS  (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS
+    #ifdef CONFIG_ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS
+        #define ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS  (CONFIG_ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS)
+    #else
+        #define ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS  (0)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_APP_STATE_SIZE_MAX
+    #ifdef CONFIG_ESP_BROOKESIA_APP_STATE_SIZE_MAX
+        #define ESP_BROOKESIA_APP_STATE_SIZE_MAX  (CONFIG_ESP_BROOKESIA_APP_STATE_SIZE_MAX)
+    #else
+        #define ESP_BROOKESIA_APP_STATE_SIZE_MAX  (0)
+    #endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////// Gesture ////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM
+    #ifdef CONFIG_ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM
+        #define ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM  (CONFIG_ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM)
+    #else
+        #define ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM  (6)
+    #endif
+#endif
+
+#ifndef ESP_BROOKESIA_GESTURE_PREDICT_MS
+    #ifdef CONFIG_ESP_BROOKESIA_GESTURE_PREDICT_MS
+        #define ESP_BROOKESIA_GESTURE_PREDICT_MS  (CONFIG_ESP_BROOKESIA_GESTURE_PREDICT_MS)
+    #else
+        #define ESP_BROOKESIA_GESTURE_PREDICT_MS  (0)
+    #endif
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////// Squareline ////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
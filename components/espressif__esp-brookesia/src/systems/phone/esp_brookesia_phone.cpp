@@ -141,6 +141,39 @@ bool ESP_Brookesia_Phone::activateStylesheet(const ESP_Brookesia_PhoneStylesheet
     return true;
 }
 
+bool ESP_Brookesia_Phone::switchTheme(const ESP_Brookesia_PhoneStylesheet_t &stylesheet)
+{
+    const ESP_Brookesia_PhoneStylesheet_t *target = nullptr;
+    const ESP_Brookesia_StyleSize_t &active_size = getStylesheet()->core.screen_size;
+
+    ESP_BROOKESIA_LOGD("Switch phone(0x%p) theme", this);
+
+    target = getStylesheet(stylesheet.core.name, stylesheet.core.screen_size);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(target, false, "Stylesheet(%s) is not added", stylesheet.core.name);
+
+    // The widgets keep their layout, so a stylesheet of another screen size needs the full update
+    if (!checkCoreInitialized() || (target->core.screen_size.width != active_size.width) ||
+            (target->core.screen_size.height != active_size.height)) {
+        ESP_BROOKESIA_LOGW("Screen size changed, activate the stylesheet instead");
+        return activateStylesheet(stylesheet);
+    }
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(
+        ESP_Brookesia_PhoneStylesheet::activateStylesheet(stylesheet.core.name, stylesheet.core.screen_size),
+        false, "Failed to activate phone stylesheet"
+    );
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(sendThemeUpdateEvent(), false, "Send theme update event failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_Phone::switchTheme(const ESP_Brookesia_PhoneStylesheet_t *stylesheet)
+{
+    ESP_BROOKESIA_CHECK_NULL_RETURN(stylesheet, false, "Invalid stylesheet");
+
+    return switchTheme(*stylesheet);
+}
+
 bool ESP_Brookesia_Phone::calibrateStylesheet(const ESP_Brookesia_StyleSize_t &screen_size, ESP_Brookesia_PhoneStylesheet_t &stylesheet)
 {
     ESP_BROOKESIA_LOGD("Calibrate phone(0x%p) stylesheet", this);
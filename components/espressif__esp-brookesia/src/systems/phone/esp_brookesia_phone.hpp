@@ -33,6 +33,9 @@ public:
     bool addStylesheet(const ESP_Brookesia_PhoneStylesheet_t *stylesheet);
     bool activateStylesheet(const ESP_Brookesia_PhoneStylesheet_t &stylesheet);
     bool activateStylesheet(const ESP_Brookesia_PhoneStylesheet_t *stylesheet);
+    // Only restyles the colors and images, the stylesheet must have the same layout as the active one
+    bool switchTheme(const ESP_Brookesia_PhoneStylesheet_t &stylesheet);
+    bool switchTheme(const ESP_Brookesia_PhoneStylesheet_t *stylesheet);
 
     bool calibrateScreenSize(ESP_Brookesia_StyleSize_t &size) override;
 
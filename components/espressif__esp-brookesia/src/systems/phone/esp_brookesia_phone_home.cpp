@@ -11,6 +11,8 @@
 #define ESP_BROOKESIA_LOGD(...)
 #endif
 
+#define APP_RESUME_TRANSITION_TIME_MS   (150)
+
 using namespace std;
 
 ESP_Brookesia_PhoneHome::ESP_Brookesia_PhoneHome(ESP_Brookesia_Core &core, const ESP_Brookesia_PhoneHomeData_t &data):
@@ -19,7 +21,10 @@ ESP_Brookesia_PhoneHome::ESP_Brookesia_PhoneHome(ESP_Brookesia_Core &core, const
     _app_launcher(core, data.app_launcher.data),
     _status_bar(nullptr),
     _navigation_bar(nullptr),
-    _recents_screen(nullptr)
+    _recents_screen(nullptr),
+    _app_resume_image(nullptr),
+    _app_resume_anim(nullptr),
+    _app_resume_id(-1)
 {
 }
 
@@ -38,10 +43,30 @@ bool ESP_Brookesia_PhoneHome::begin(void)
     shared_ptr<ESP_Brookesia_StatusBar> status_bar = nullptr;
     shared_ptr<ESP_Brookesia_NavigationBar> navigation_bar = nullptr;
     shared_ptr<ESP_Brookesia_RecentsScreen> recents_screen = nullptr;
+    ESP_Brookesia_LvObj_t app_resume_image = nullptr;
+    ESP_Brookesia_LvAnim_t app_resume_anim = nullptr;
 
     ESP_BROOKESIA_LOGD("Begin(@0x%p)", this);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(!checkInitialized(), false, "Already initialized");
 
+    // App resume transition, created first to stay below the other widgets of the system screen
+    if (_core.getCoreData().manager.flags.enable_app_save_snapshot) {
+        app_resume_image = ESP_BROOKESIA_LV_OBJ(img, system_screen_obj);
+        ESP_BROOKESIA_CHECK_NULL_RETURN(app_resume_image, false, "Create app resume image failed");
+        lv_obj_add_flag(app_resume_image.get(), LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(app_resume_image.get(), LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_align(app_resume_image.get(), LV_ALIGN_TOP_LEFT, 0, 0);
+        app_resume_anim = ESP_BROOKESIA_LV_ANIM();
+        ESP_BROOKESIA_CHECK_NULL_RETURN(app_resume_anim, false, "Create app resume anim failed");
+        lv_anim_set_var(app_resume_anim.get(), this);
+        lv_anim_set_values(app_resume_anim.get(), LV_OPA_COVER, LV_OPA_TRANSP);
+        lv_anim_set_time(app_resume_anim.get(), APP_RESUME_TRANSITION_TIME_MS);
+        lv_anim_set_path_cb(app_resume_anim.get(), lv_anim_path_ease_out);
+        lv_anim_set_early_apply(app_resume_anim.get(), true);
+        lv_anim_set_exec_cb(app_resume_anim.get(), onAppResumeTransitionAnimationExecuteCallback);
+        lv_anim_set_ready_cb(app_resume_anim.get(), onAppResumeTransitionAnimationReadyCallback);
+    }
+
     // Recents Screen
     if (_data.flags.enable_recents_screen) {
         recents_screen = std::make_shared<ESP_Brookesia_RecentsScreen>(_core, _data.recents_screen.data);
@@ -74,6 +99,8 @@ bool ESP_Brookesia_PhoneHome::begin(void)
     _status_bar = status_bar;
     _navigation_bar = navigation_bar;
     _recents_screen = recents_screen;
+    _app_resume_image = app_resume_image;
+    _app_resume_anim = app_resume_anim;
 
     return true;
 }
@@ -95,6 +122,10 @@ bool ESP_Brookesia_PhoneHome::del(void)
     if (_recents_screen) {
         _recents_screen.reset();
     }
+    _app_resume_anim.reset();
+    _app_resume_image.reset();
+    _app_resume_id = -1;
+    _id_app_visual_map.clear();
     if (!_app_launcher.del()) {
         ESP_BROOKESIA_LOGE("Delete app launcher failed");
     }
@@ -134,6 +165,8 @@ bool ESP_Brookesia_PhoneHome::processAppUninstall(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_LOGD("Process when app(%d) uninstall", phone_app->getId());
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
+    _id_app_visual_map.erase(phone_app->getId());
+
     // Process app launcher
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_app_launcher.removeIcon(phone_app->getId()), false, "Remove launcher icon failed");
 
@@ -149,6 +182,9 @@ bool ESP_Brookesia_PhoneHome::processAppRun(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
     const ESP_Brookesia_PhoneAppData_t &app_data = phone_app->getActiveData();
+    const ESP_Brookesia_PhoneHomeAppVisual_t *app_visual = getAppVisual(phone_app);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(app_visual, false, "Get app visual failed");
+
     // Process status bar
     if (_status_bar == nullptr) {
         ESP_BROOKESIA_LOGD("No status_bar");
@@ -168,19 +204,13 @@ bool ESP_Brookesia_PhoneHome::processAppRun(ESP_Brookesia_CoreApp *app)
                 false, "Add status icon failed"
             );
         }
-        // Change visibility
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_status_bar->setVisualMode(app_data.status_bar_visual_mode), false,
-                                         "Status bar set visual mode failed");
     }
 
-    // Process navigation bar
-    if (_navigation_bar == nullptr) {
-        ESP_BROOKESIA_LOGD("No navigation_bar");
-    } else {
-        // Change visibility
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_navigation_bar->setVisualMode(app_data.navigation_bar_visual_mode), false,
-                                         "Navigation bar set visual mode failed");
-    }
+    // Change visibility of the bars
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(
+        setBarsVisualMode(app_visual->status_bar_visual_mode, app_visual->navigation_bar_visual_mode), false,
+        "Set bars visual mode failed"
+    );
 
     // Process recents_screen
     if (_recents_screen == nullptr) {
@@ -204,25 +234,20 @@ bool ESP_Brookesia_PhoneHome::processAppResume(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_LOGD("Process when app(%d) resume", phone_app->getId());
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
-    const ESP_Brookesia_PhoneAppData_t &app_data = phone_app->getActiveData();
-    // Process status bar
-    if (_status_bar == nullptr) {
-        ESP_BROOKESIA_LOGD("No status_bar");
-    } else {
-        // Change visibility
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_status_bar->setVisualMode(app_data.status_bar_visual_mode), false,
-                                         "Status bar set visual mode failed");
-    }
+    const ESP_Brookesia_PhoneHomeAppVisual_t *app_visual = getAppVisual(phone_app);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(app_visual, false, "Get app visual failed");
 
-    // Process navigation bar
-    if (_navigation_bar == nullptr) {
-        ESP_BROOKESIA_LOGD("No navigation_bar");
-    } else {
-        // Change visibility
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_navigation_bar->setVisualMode(app_data.navigation_bar_visual_mode), false,
-                                         "Navigation bar set visual mode failed");
+    // Cover the app screen with its snapshot while it is loaded and resumed
+    if (!startAppResumeTransition(phone_app)) {
+        ESP_BROOKESIA_LOGW("Start app resume transition failed");
     }
 
+    // Change visibility of the bars
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(
+        setBarsVisualMode(app_visual->status_bar_visual_mode, app_visual->navigation_bar_visual_mode), false,
+        "Set bars visual mode failed"
+    );
+
     return true;
 }
 
@@ -234,6 +259,11 @@ bool ESP_Brookesia_PhoneHome::processAppClose(ESP_Brookesia_CoreApp *app)
     ESP_BROOKESIA_LOGD("Process when app(%d) close", phone_app->getId());
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
+    // The snapshot shown by the transition is released with the app
+    if (_app_resume_id == phone_app->getId()) {
+        stopAppResumeTransition();
+    }
+
     // Process status bar
     if (_status_bar == nullptr) {
         ESP_BROOKESIA_LOGD("No status_bar");
@@ -262,21 +292,9 @@ bool ESP_Brookesia_PhoneHome::processMainScreenLoad(void)
     ESP_BROOKESIA_LOGD("Process when load home");
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
-    // Process status bar
-    if (_status_bar == nullptr) {
-        ESP_BROOKESIA_LOGD("No status_bar");
-    } else {
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_status_bar->setVisualMode(_data.status_bar.visual_mode), false,
-                                         "Status bar set visual mode failed");
-    }
-
-    // Process navigation bar
-    if (_navigation_bar == nullptr) {
-        ESP_BROOKESIA_LOGD("No navigation_bar");
-    } else {
-        ESP_BROOKESIA_CHECK_FALSE_RETURN(_navigation_bar->setVisualMode(_data.navigation_bar.visual_mode), false,
-                                         "Navigation bar set visual mode failed");
-    }
+    stopAppResumeTransition();
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(setBarsVisualMode(_data.status_bar.visual_mode, _data.navigation_bar.visual_mode),
+                                     false, "Set bars visual mode failed");
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(lv_obj_is_valid(main_screen), false, "Invalid main screen");
     lv_scr_load(main_screen);
@@ -285,10 +303,27 @@ bool ESP_Brookesia_PhoneHome::processMainScreenLoad(void)
 }
 
 bool ESP_Brookesia_PhoneHome::getAppVisualArea(ESP_Brookesia_CoreApp *app, lv_area_t &app_visual_area) const
+{
+    const ESP_Brookesia_PhoneHomeAppVisual_t *app_visual = getAppVisual(app);
+
+    ESP_BROOKESIA_CHECK_NULL_RETURN(app_visual, false, "Get app visual failed");
+
+    app_visual_area = app_visual->visual_area;
+
+    return true;
+}
+
+const ESP_Brookesia_PhoneHome::ESP_Brookesia_PhoneHomeAppVisual_t *ESP_Brookesia_PhoneHome::getAppVisual(
+    ESP_Brookesia_CoreApp *app) const
 {
     ESP_Brookesia_PhoneApp *phone_app = static_cast<ESP_Brookesia_PhoneApp *>(app);
 
-    ESP_BROOKESIA_CHECK_NULL_RETURN(phone_app, false, "Invalid phone app");
+    ESP_BROOKESIA_CHECK_NULL_RETURN(phone_app, nullptr, "Invalid phone app");
+
+    auto it = _id_app_visual_map.find(phone_app->getId());
+    if (it != _id_app_visual_map.end()) {
+        return &it->second;
+    }
 
     lv_area_t visual_area = {
         .x1 = 0,
@@ -310,17 +345,102 @@ bool ESP_Brookesia_PhoneHome::getAppVisualArea(ESP_Brookesia_CoreApp *app, lv_ar
         visual_area.y2 -= _data.navigation_bar.data.main.size.height;
     }
 
-    app_visual_area = visual_area;
+    ESP_Brookesia_PhoneHomeAppVisual_t &app_visual = _id_app_visual_map[phone_app->getId()];
+    app_visual.visual_area = visual_area;
+    app_visual.status_bar_visual_mode = app_data.status_bar_visual_mode;
+    app_visual.navigation_bar_visual_mode = app_data.navigation_bar_visual_mode;
+
+    return &app_visual;
+}
+
+bool ESP_Brookesia_PhoneHome::setBarsVisualMode(ESP_Brookesia_StatusBarVisualMode_t status_bar_mode,
+        ESP_Brookesia_NavigationBarVisualMode_t navigation_bar_mode)
+{
+    // Process status bar
+    if (_status_bar == nullptr) {
+        ESP_BROOKESIA_LOGD("No status_bar");
+    } else {
+        ESP_BROOKESIA_CHECK_FALSE_RETURN(_status_bar->setVisualMode(status_bar_mode), false,
+                                         "Status bar set visual mode failed");
+    }
+
+    // Process navigation bar
+    if (_navigation_bar == nullptr) {
+        ESP_BROOKESIA_LOGD("No navigation_bar");
+    } else {
+        ESP_BROOKESIA_CHECK_FALSE_RETURN(_navigation_bar->setVisualMode(navigation_bar_mode), false,
+                                         "Navigation bar set visual mode failed");
+    }
 
     return true;
 }
 
+bool ESP_Brookesia_PhoneHome::startAppResumeTransition(ESP_Brookesia_CoreApp *app)
+{
+    ESP_Brookesia_CoreManager &manager = _core.getCoreManager();
+    const lv_img_dsc_t *snapshot = nullptr;
+
+    stopAppResumeTransition();
+    if ((_app_resume_image == nullptr) || !manager.checkAppSnapshotExist(app->getId())) {
+        return true;
+    }
+
+    // Only a full screen snapshot is shown, zooming a downscaled one would cost more than drawing the app
+    snapshot = manager.getAppSnapshot(app->getId());
+    ESP_BROOKESIA_CHECK_NULL_RETURN(snapshot, false, "Get app snapshot failed");
+    if ((snapshot->header.w != _core.getCoreData().screen_size.width) ||
+            (snapshot->header.h != _core.getCoreData().screen_size.height)) {
+        return true;
+    }
+
+    ESP_BROOKESIA_LOGD("Start app(%d) resume transition", app->getId());
+    lv_img_set_src(_app_resume_image.get(), snapshot);
+    lv_obj_clear_flag(_app_resume_image.get(), LV_OBJ_FLAG_HIDDEN);
+    lv_anim_start(_app_resume_anim.get());
+    _app_resume_id = app->getId();
+
+    return true;
+}
+
+void ESP_Brookesia_PhoneHome::stopAppResumeTransition(void)
+{
+    if ((_app_resume_image == nullptr) || (_app_resume_id < 0)) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("Stop app(%d) resume transition", _app_resume_id);
+    lv_anim_del(this, onAppResumeTransitionAnimationExecuteCallback);
+    lv_obj_add_flag(_app_resume_image.get(), LV_OBJ_FLAG_HIDDEN);
+    lv_img_set_src(_app_resume_image.get(), nullptr);
+    _app_resume_id = -1;
+}
+
+void ESP_Brookesia_PhoneHome::onAppResumeTransitionAnimationExecuteCallback(void *var, int32_t value)
+{
+    ESP_Brookesia_PhoneHome *home = (ESP_Brookesia_PhoneHome *)var;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(home, "Invalid home");
+
+    lv_obj_set_style_img_opa(home->_app_resume_image.get(), (lv_opa_t)value, 0);
+}
+
+void ESP_Brookesia_PhoneHome::onAppResumeTransitionAnimationReadyCallback(lv_anim_t *anim)
+{
+    ESP_Brookesia_PhoneHome *home = (ESP_Brookesia_PhoneHome *)anim->var;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(home, "Invalid home");
+
+    home->stopAppResumeTransition();
+}
+
 bool ESP_Brookesia_PhoneHome::processRecentsScreenShow(void)
 {
     ESP_BROOKESIA_LOGD("Process when show recents_screen");
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
     ESP_BROOKESIA_CHECK_NULL_RETURN(_recents_screen, false, "No recents_screen");
 
+    stopAppResumeTransition();
+
     // Process status bar
     if (_status_bar == nullptr) {
         ESP_BROOKESIA_LOGD("No status_bar");
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include "core/esp_brookesia_core.hpp"
 #include "widgets/status_bar/esp_brookesia_status_bar.hpp"
 #include "widgets/navigation_bar/esp_brookesia_navigation_bar.hpp"
@@ -44,6 +45,21 @@ private:
 
     bool processRecentsScreenShow(void);
 
+    typedef struct {
+        lv_area_t visual_area;
+        ESP_Brookesia_StatusBarVisualMode_t status_bar_visual_mode;
+        ESP_Brookesia_NavigationBarVisualMode_t navigation_bar_visual_mode;
+    } ESP_Brookesia_PhoneHomeAppVisual_t;
+
+    const ESP_Brookesia_PhoneHomeAppVisual_t *getAppVisual(ESP_Brookesia_CoreApp *app) const;
+    bool setBarsVisualMode(ESP_Brookesia_StatusBarVisualMode_t status_bar_mode,
+                           ESP_Brookesia_NavigationBarVisualMode_t navigation_bar_mode);
+    bool startAppResumeTransition(ESP_Brookesia_CoreApp *app);
+    void stopAppResumeTransition(void);
+
+    static void onAppResumeTransitionAnimationExecuteCallback(void *var, int32_t value);
+    static void onAppResumeTransitionAnimationReadyCallback(lv_anim_t *anim);
+
     // Core
     const ESP_Brookesia_PhoneHomeData_t &_data;
     // Widgets
@@ -51,5 +67,11 @@ private:
     std::shared_ptr<ESP_Brookesia_StatusBar> _status_bar;
     std::shared_ptr<ESP_Brookesia_NavigationBar> _navigation_bar;
     std::shared_ptr<ESP_Brookesia_RecentsScreen> _recents_screen;
+    // Visual area and bar modes of every installed app, computed once
+    mutable std::unordered_map<int, ESP_Brookesia_PhoneHomeAppVisual_t> _id_app_visual_map;
+    // Resume transition, the snapshot of the resumed app shown above its screen and faded out
+    ESP_Brookesia_LvObj_t _app_resume_image;
+    ESP_Brookesia_LvAnim_t _app_resume_anim;
+    int _app_resume_id;
 };
 // *INDENT-OFF*
@@ -132,6 +132,10 @@ bool ESP_Brookesia_PhoneManager::begin(void)
         _recents_screen_drag_tan_threshold = tan(data.recents_screen.drag_snapshot_angle_threshold * M_PI / 180);
         lv_obj_add_event_cb(recents_screen->getEventObject(), onRecentsScreenSnapshotDeletedEventCallback,
                             recents_screen->getSnapshotDeletedEventCode(), this);
+        // App snapshots are only shown in the recents screen, no need to keep them larger than its snapshot image
+        const ESP_Brookesia_StyleSize_t &snapshot_image_size =
+            home.getData().recents_screen.data.snapshot_table.snapshot.image.main_size;
+        setAppSnapshotFitSize(snapshot_image_size.width, snapshot_image_size.height);
         // Register gesture event
         if (gesture != nullptr) {
             ESP_BROOKESIA_LOGD("Enable recents_screen gesture");
@@ -756,21 +760,21 @@ void ESP_Brookesia_PhoneManager::onGestureMaskIndicatorPressingEventCallback(lv_
     case ESP_BROOKESIA_GESTURE_AREA_LEFT_EDGE:
         if (manager->_flags.enable_gesture_show_left_right_indicator_bar) {
             gesture_indicator_bar_type = ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_LEFT;
-            gesture_indicator_offset = gesture_info->stop_x - gesture_info->start_x;
+            gesture_indicator_offset = gesture_info->predict_x - gesture_info->start_x;
         }
         is_gesture_mask_enabled = manager->_flags.enable_gesture_show_mask_left_right_edge;
         break;
     case ESP_BROOKESIA_GESTURE_AREA_RIGHT_EDGE:
         if (manager->_flags.enable_gesture_show_left_right_indicator_bar) {
             gesture_indicator_bar_type = ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_RIGHT;
-            gesture_indicator_offset = gesture_info->start_x - gesture_info->stop_x;
+            gesture_indicator_offset = gesture_info->start_x - gesture_info->predict_x;
         }
         is_gesture_mask_enabled = manager->_flags.enable_gesture_show_mask_left_right_edge;
         break;
     case ESP_BROOKESIA_GESTURE_AREA_BOTTOM_EDGE:
         if (manager->_flags.enable_gesture_show_bottom_indicator_bar) {
             gesture_indicator_bar_type = ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_BOTTOM;
-            gesture_indicator_offset = gesture_info->start_y - gesture_info->stop_y;
+            gesture_indicator_offset = gesture_info->start_y - gesture_info->predict_y;
         }
         is_gesture_mask_enabled = manager->_flags.enable_gesture_show_mask_bottom_edge;
         break;
@@ -1026,8 +1030,9 @@ void ESP_Brookesia_PhoneManager::onRecentsScreenGesturePressingEventCallback(lv_
     }
 
     app_y_current = recents_screen->getSnapshotCurrentY(drag_app_id);
-    distance_x = gesture_info->stop_x - manager->_recents_screen_last_point.x;
-    distance_y = gesture_info->stop_y - manager->_recents_screen_last_point.y;
+    // Follow the predicted point, it is the latest one unless `ESP_BROOKESIA_GESTURE_PREDICT_MS` is set
+    distance_x = gesture_info->predict_x - manager->_recents_screen_last_point.x;
+    distance_y = gesture_info->predict_y - manager->_recents_screen_last_point.y;
     // If the vertical distance is less than the step, return
     if (abs(distance_y) < data->recents_screen.drag_snapshot_y_step) {
         return;
@@ -1050,7 +1055,7 @@ void ESP_Brookesia_PhoneManager::onRecentsScreenGesturePressingEventCallback(lv_
     }
 
     manager->_recents_screen_last_point = (lv_point_t) {
-        (lv_coord_t)gesture_info->stop_x, (lv_coord_t)gesture_info->stop_y
+        (lv_coord_t)gesture_info->predict_x, (lv_coord_t)gesture_info->predict_y
     };
 }
 
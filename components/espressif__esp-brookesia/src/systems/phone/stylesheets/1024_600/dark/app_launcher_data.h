@@ -49,6 +49,7 @@ extern "C" {
         .icon = ESP_BROOKESIA_PHONE_1024_600_DARK_APP_LAUNCHER_ICON_DATA(),        \
         .flags = {                                                          \
             .enable_table_scroll_anim = 0,                                  \
+            .enable_page_cache = 0,                                         \
         },                                                                  \
     }
 
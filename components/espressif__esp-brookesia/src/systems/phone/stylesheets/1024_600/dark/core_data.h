@@ -65,6 +65,7 @@ extern "C" {
         },                                             \
         .flags = {                                     \
             .enable_app_save_snapshot = 1,             \
+            .enable_app_snapshot_downscale = 1,        \
         },                                             \
     }
 
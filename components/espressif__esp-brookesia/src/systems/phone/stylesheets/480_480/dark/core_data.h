@@ -67,6 +67,7 @@ LV_IMG_DECLARE(esp_brookesia_image_middle_wallpaper_image_dark);
         },                                            \
         .flags = {                                    \
             .enable_app_save_snapshot = 1,            \
+            .enable_app_snapshot_downscale = 1,       \
         },                                            \
     }
 
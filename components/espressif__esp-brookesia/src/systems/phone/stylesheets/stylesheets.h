@@ -13,6 +13,7 @@
 #include "720_1280/dark/stylesheet.h"
 #include "800_480/dark/stylesheet.h"
 #include "480_800/dark/stylesheet.h"
+#include "480_800/light/stylesheet.h"
 #include "800_1280/dark/stylesheet.h"
 #include "1024_600/dark/stylesheet.h"
 #include "1280_800/dark/stylesheet.h"
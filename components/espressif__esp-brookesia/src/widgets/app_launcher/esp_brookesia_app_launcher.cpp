@@ -7,6 +7,13 @@
 #include <memory>
 #include "core/esp_brookesia_core.hpp"
 #include "esp_brookesia_app_launcher.hpp"
+#ifdef ESP_BROOKESIA_MEMORY_INCLUDE
+#include ESP_BROOKESIA_MEMORY_INCLUDE
+#endif
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#endif
 
 #if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_WIDGETS_APP_LAUNCHER
 #undef ESP_BROOKESIA_LOGD
@@ -16,6 +23,14 @@
 #define ESP_BROOKESIA_APP_LAUNCHER_SPOT_INACTIVE_STATE     LV_STATE_DEFAULT
 #define ESP_BROOKESIA_APP_LAUNCHER_SPOT_ACTIVE_STATE       LV_STATE_USER_1
 
+#if defined(ESP_PLATFORM) && defined(CONFIG_SPIRAM)
+#define PAGE_CACHE_MALLOC(size)     heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define PAGE_CACHE_FREE(ptr)        heap_caps_free(ptr)
+#else
+#define PAGE_CACHE_MALLOC(size)     ESP_BROOKESIA_MEMORY_MALLOC(size)
+#define PAGE_CACHE_FREE(ptr)        ESP_BROOKESIA_MEMORY_FREE(ptr)
+#endif
+
 using namespace std;
 
 ESP_Brookesia_AppLauncher::ESP_Brookesia_AppLauncher(ESP_Brookesia_Core &core, const ESP_Brookesia_AppLauncherData_t &data):
@@ -25,10 +40,14 @@ ESP_Brookesia_AppLauncher::ESP_Brookesia_AppLauncher(ESP_Brookesia_Core &core, c
     _table_page_icon_count_max(0),
     _table_page_pad_row(0),
     _table_page_pad_column(0),
+    _is_page_cache_shown(false),
     _main_obj(nullptr),
     _table_obj(nullptr),
     _indicator_obj(nullptr)
 {
+    lv_style_init(&_spot_active_style);
+    lv_style_init(&_spot_inactive_style);
+    lv_style_init(&_icon_label_style);
 }
 
 ESP_Brookesia_AppLauncher::~ESP_Brookesia_AppLauncher()
@@ -80,6 +99,7 @@ bool ESP_Brookesia_AppLauncher::begin(lv_obj_t *parent)
     lv_obj_set_scroll_snap_x(table_obj.get(), LV_SCROLL_SNAP_CENTER);
     lv_obj_clear_flag(table_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_add_event_cb(table_obj.get(), onPageTouchEventCallback, LV_EVENT_RELEASED, this);
+    lv_obj_add_event_cb(table_obj.get(), onTableScrollEndEventCallback, LV_EVENT_SCROLL_END, this);
     // Indicator
     lv_obj_add_style(indicator_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
     lv_obj_set_flex_flow(indicator_obj.get(), LV_FLEX_FLOW_ROW);
@@ -129,6 +149,10 @@ bool ESP_Brookesia_AppLauncher::del(void)
     _indicator_obj.reset();
     _mix_objs.clear();
     _id_mix_icon_map.clear();
+    _is_page_cache_shown = false;
+    lv_style_reset(&_spot_active_style);
+    lv_style_reset(&_spot_inactive_style);
+    lv_style_reset(&_icon_label_style);
 
     return ret;
 }
@@ -164,7 +188,7 @@ bool ESP_Brookesia_AppLauncher::addIcon(uint8_t page_index, const ESP_Brookesia_
     }
     mix_icon.current_page_index = page_index;
 
-    mix_icon.icon = make_shared<ESP_Brookesia_AppLauncherIcon>(_core, info, _data.icon);
+    mix_icon.icon = make_shared<ESP_Brookesia_AppLauncherIcon>(_core, info, _data.icon, &_icon_label_style);
     ESP_BROOKESIA_CHECK_NULL_RETURN(mix_icon.icon, false, "Create icon failed");
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(mix_icon.icon->begin(_mix_objs[page_index].page_obj.get()), false,
@@ -174,6 +198,7 @@ bool ESP_Brookesia_AppLauncher::addIcon(uint8_t page_index, const ESP_Brookesia_
     ESP_BROOKESIA_CHECK_FALSE_RETURN(res.second, false, "Insert icon failed");
 
     _mix_objs[page_index].page_icon_count++;
+    invalidatePageCache(page_index);
 
     return true;
 }
@@ -193,6 +218,7 @@ bool ESP_Brookesia_AppLauncher::removeIcon(int id)
 
     _mix_objs[current_page_index].page_icon_count--;
     _id_mix_icon_map.erase(id);
+    invalidatePageCache(current_page_index);
 
     if ((_mix_objs[current_page_index].page_icon_count == 0) && (_mix_objs.size() > _data.table.default_num)) {
         ESP_BROOKESIA_CHECK_FALSE_RETURN(destoryMixObject(current_page_index, _mix_objs), false, "Destroy mix object failed");
@@ -217,8 +243,10 @@ bool ESP_Brookesia_AppLauncher::changeIconTable(int id, uint8_t new_table_index)
 
     if (res->second.current_page_index < (int)_mix_objs.size()) {
         _mix_objs[res->second.current_page_index].page_icon_count--;
+        invalidatePageCache(res->second.current_page_index);
     }
     _mix_objs[new_table_index].page_icon_count++;
+    invalidatePageCache(new_table_index);
     res->second.current_page_index = new_table_index;
 
     return true;
@@ -234,11 +262,25 @@ bool ESP_Brookesia_AppLauncher::scrollToPage(uint8_t index)
         return true;
     }
 
+    // Only the animated scroll redraws the pages for many frames, so only it is drawn from the cache
+    bool use_page_cache = _data.flags.enable_table_scroll_anim && _data.flags.enable_page_cache &&
+                          (_table_current_page_index >= 0);
+    if (use_page_cache && !beginPageCache(_table_current_page_index, index)) {
+        ESP_BROOKESIA_LOGW("Begin page cache failed, draw pages directly");
+        endPageCache();
+        use_page_cache = false;
+    }
+
     lv_obj_add_flag(_table_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
     lv_obj_scroll_to_view_recursive(_mix_objs[index].page_obj.get(), _data.flags.enable_table_scroll_anim ?
                                     LV_ANIM_ON : LV_ANIM_OFF);
     lv_obj_clear_flag(_table_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
 
+    // No animation is started if the page is already in view, so no scroll end event will come
+    if (use_page_cache && (lv_anim_get(_table_obj.get(), nullptr) == nullptr)) {
+        endPageCache();
+    }
+
     _table_current_page_index = index;
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(updateActiveSpot(), false, "Update active spot failed");
@@ -380,6 +422,8 @@ bool ESP_Brookesia_AppLauncher::createMixObject(ESP_Brookesia_LvObj_t &table_obj
     ESP_Brookesia_LvObj_t page_main_obj = nullptr;
     ESP_Brookesia_LvObj_t page_obj = nullptr;
     ESP_Brookesia_LvObj_t spot_obj = nullptr;
+    ESP_Brookesia_LvObj_t cache_obj = nullptr;
+    shared_ptr<ESP_Brookesia_AppLauncherPageCache_t> page_cache = nullptr;
 
     ESP_BROOKESIA_LOGD("Create mix object");
     ESP_BROOKESIA_CHECK_NULL_RETURN(table_obj.get(), false, "Invalid table object");
@@ -391,6 +435,10 @@ bool ESP_Brookesia_AppLauncher::createMixObject(ESP_Brookesia_LvObj_t &table_obj
     ESP_BROOKESIA_CHECK_NULL_RETURN(page_obj, false, "Create page_obj failed");
     spot_obj = ESP_BROOKESIA_LV_OBJ(obj, indicator_obj.get());
     ESP_BROOKESIA_CHECK_NULL_RETURN(spot_obj, false, "Create spot_obj failed");
+    cache_obj = ESP_BROOKESIA_LV_OBJ(img, page_main_obj.get());
+    ESP_BROOKESIA_CHECK_NULL_RETURN(cache_obj, false, "Create cache_obj failed");
+    page_cache = make_shared<ESP_Brookesia_AppLauncherPageCache_t>();
+    ESP_BROOKESIA_CHECK_NULL_RETURN(page_cache, false, "Create page cache failed");
 
     lv_obj_add_style(page_main_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
     lv_obj_add_flag(page_main_obj.get(), LV_OBJ_FLAG_EVENT_BUBBLE);
@@ -403,9 +451,14 @@ bool ESP_Brookesia_AppLauncher::createMixObject(ESP_Brookesia_LvObj_t &table_obj
     lv_obj_add_flag(page_obj.get(), LV_OBJ_FLAG_EVENT_BUBBLE);
 
     lv_obj_add_style(spot_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(spot_obj.get(), &_spot_inactive_style, ESP_BROOKESIA_APP_LAUNCHER_SPOT_INACTIVE_STATE);
+    lv_obj_add_style(spot_obj.get(), &_spot_active_style, ESP_BROOKESIA_APP_LAUNCHER_SPOT_ACTIVE_STATE);
     lv_obj_set_style_radius(spot_obj.get(), LV_RADIUS_CIRCLE, 0);
 
-    mix_objs.push_back({0, page_main_obj, page_obj, spot_obj});
+    lv_obj_center(cache_obj.get());
+    lv_obj_add_flag(cache_obj.get(), LV_OBJ_FLAG_HIDDEN);
+
+    mix_objs.push_back({0, page_main_obj, page_obj, spot_obj, page_cache, cache_obj});
 
     return true;
 }
@@ -440,14 +493,8 @@ bool ESP_Brookesia_AppLauncher::updateMixByNewData(uint8_t index, vector<ESP_Bro
     lv_obj_set_size(page_obj.get(), _data.table.size.width, _data.table.size.height);
     // Indicator
     lv_obj_set_size(spot_obj.get(), _data.indicator.spot_inactive_size.width, _data.indicator.spot_inactive_size.height);
-    lv_obj_set_style_bg_color(spot_obj.get(), lv_color_hex(_data.indicator.spot_active_background_color.color),
-                              ESP_BROOKESIA_APP_LAUNCHER_SPOT_ACTIVE_STATE);
-    lv_obj_set_style_bg_opa(spot_obj.get(), _data.indicator.spot_active_background_color.opacity,
-                            ESP_BROOKESIA_APP_LAUNCHER_SPOT_ACTIVE_STATE);
-    lv_obj_set_style_bg_color(spot_obj.get(), lv_color_hex(_data.indicator.spot_inactive_background_color.color),
-                              ESP_BROOKESIA_APP_LAUNCHER_SPOT_INACTIVE_STATE);
-    lv_obj_set_style_bg_opa(spot_obj.get(), _data.indicator.spot_inactive_background_color.opacity,
-                            ESP_BROOKESIA_APP_LAUNCHER_SPOT_INACTIVE_STATE);
+    // Cache
+    mix_objs[index].page_cache->is_dirty = true;
 
     return true;
 }
@@ -620,10 +667,123 @@ bool ESP_Brookesia_AppLauncher::updateByNewData(void)
 next:
         ESP_BROOKESIA_CHECK_FALSE_RETURN(id_icon.second.icon->updateByNewData(), false, "Update icon style failed");
     }
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
 
     return true;
 }
 
+bool ESP_Brookesia_AppLauncher::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    // The spots and labels of every page share these styles, so they are changed in place and refreshed once
+    lv_style_set_bg_color(&_spot_active_style, lv_color_hex(_data.indicator.spot_active_background_color.color));
+    lv_style_set_bg_opa(&_spot_active_style, _data.indicator.spot_active_background_color.opacity);
+    lv_obj_report_style_change(&_spot_active_style);
+    lv_style_set_bg_color(&_spot_inactive_style, lv_color_hex(_data.indicator.spot_inactive_background_color.color));
+    lv_style_set_bg_opa(&_spot_inactive_style, _data.indicator.spot_inactive_background_color.opacity);
+    lv_obj_report_style_change(&_spot_inactive_style);
+    lv_style_set_text_color(&_icon_label_style, lv_color_hex(_data.icon.label.text_color.color));
+    lv_style_set_text_opa(&_icon_label_style, _data.icon.label.text_color.opacity);
+    lv_obj_report_style_change(&_icon_label_style);
+    // The page caches hold the old colors
+    for (size_t i = 0; i < _mix_objs.size(); i++) {
+        invalidatePageCache(i);
+    }
+
+    return true;
+}
+
+void ESP_Brookesia_AppLauncher::invalidatePageCache(uint8_t page_index)
+{
+    if (page_index >= _mix_objs.size()) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("Invalidate page(%d) cache", page_index);
+    _mix_objs[page_index].page_cache->is_dirty = true;
+}
+
+bool ESP_Brookesia_AppLauncher::updatePageCache(uint8_t page_index)
+{
+    ESP_BROOKESIA_LOGD("Update page(%d) cache", page_index);
+    ESP_BROOKESIA_CHECK_VALUE_RETURN(page_index, 0, (int)_mix_objs.size() - 1, false, "Table page index out of range");
+
+#if LV_USE_SNAPSHOT
+    ESP_Brookesia_AppLauncherMixObject_t &mix_obj = _mix_objs[page_index];
+    ESP_Brookesia_AppLauncherPageCache_t &cache = *mix_obj.page_cache;
+
+    if (!cache.is_dirty) {
+        return true;
+    }
+
+    // The page may be hidden because its cache is shown, the snapshot needs it visible and laid out
+    lv_obj_clear_flag(mix_obj.page_obj.get(), LV_OBJ_FLAG_HIDDEN);
+    lv_obj_update_layout(mix_obj.page_obj.get());
+
+    uint32_t size = lv_snapshot_buf_size_needed(mix_obj.page_obj.get(), LV_IMG_CF_TRUE_COLOR_ALPHA);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(size > 0, false, "Invalid page size");
+    if (size != cache.buffer_size) {
+        if (cache.buffer != nullptr) {
+            lv_img_cache_invalidate_src(&cache.image);
+            PAGE_CACHE_FREE(cache.buffer);
+            cache.buffer_size = 0;
+        }
+        cache.buffer = (uint8_t *)PAGE_CACHE_MALLOC(size);
+        ESP_BROOKESIA_CHECK_NULL_RETURN(cache.buffer, false, "Alloc page cache(%d) failed", (int)size);
+        cache.buffer_size = size;
+    }
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(
+        lv_snapshot_take_to_buf(mix_obj.page_obj.get(), LV_IMG_CF_TRUE_COLOR_ALPHA, &cache.image, cache.buffer,
+                                cache.buffer_size) == LV_RES_OK, false, "Take page snapshot failed"
+    );
+    lv_img_cache_invalidate_src(&cache.image);
+    lv_img_set_src(mix_obj.cache_obj.get(), &cache.image);
+    cache.is_dirty = false;
+
+    return true;
+#else
+    ESP_BROOKESIA_LOGW("Page cache needs `LV_USE_SNAPSHOT`");
+
+    return false;
+#endif
+}
+
+bool ESP_Brookesia_AppLauncher::beginPageCache(uint8_t from_index, uint8_t to_index)
+{
+    ESP_BROOKESIA_LOGD("Begin page cache: %d->%d", from_index, to_index);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    // Every page passed by the scroll is shown, the others stay as they are
+    uint8_t start = min(from_index, to_index);
+    uint8_t end = max(from_index, to_index);
+    for (uint8_t i = start; i <= end; i++) {
+        ESP_BROOKESIA_CHECK_FALSE_RETURN(updatePageCache(i), false, "Update page(%d) cache failed", i);
+    }
+    for (uint8_t i = start; i <= end; i++) {
+        lv_obj_clear_flag(_mix_objs[i].cache_obj.get(), LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(_mix_objs[i].page_obj.get(), LV_OBJ_FLAG_HIDDEN);
+    }
+    _is_page_cache_shown = true;
+
+    return true;
+}
+
+void ESP_Brookesia_AppLauncher::endPageCache(void)
+{
+    if (!_is_page_cache_shown) {
+        return;
+    }
+
+    ESP_BROOKESIA_LOGD("End page cache");
+    for (auto &mix_obj : _mix_objs) {
+        lv_obj_add_flag(mix_obj.cache_obj.get(), LV_OBJ_FLAG_HIDDEN);
+        lv_obj_clear_flag(mix_obj.page_obj.get(), LV_OBJ_FLAG_HIDDEN);
+    }
+    _is_page_cache_shown = false;
+}
+
 void ESP_Brookesia_AppLauncher::onDataUpdateEventCallback(lv_event_t *event)
 {
     ESP_Brookesia_AppLauncher *app_launcher = nullptr;
@@ -634,6 +794,10 @@ void ESP_Brookesia_AppLauncher::onDataUpdateEventCallback(lv_event_t *event)
     app_launcher = (ESP_Brookesia_AppLauncher *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(app_launcher, "Invalid app launcher object");
 
+    if (ESP_Brookesia_Core::checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(app_launcher->updateThemeByNewData(), "Update theme failed");
+        return;
+    }
     ESP_BROOKESIA_CHECK_FALSE_EXIT(app_launcher->updateByNewData(), "Update object style failed");
 }
 
@@ -653,3 +817,33 @@ void ESP_Brookesia_AppLauncher::onPageTouchEventCallback(lv_event_t *event)
         app_launcher->toggleCurrentPageIconClickable(true), "Toggle current page icon clickable failed"
     );
 }
+
+void ESP_Brookesia_AppLauncher::onTableScrollEndEventCallback(lv_event_t *event)
+{
+    ESP_Brookesia_AppLauncher *app_launcher = nullptr;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(event, "Invalid event object");
+
+    app_launcher = (ESP_Brookesia_AppLauncher *)lv_event_get_user_data(event);
+    ESP_BROOKESIA_CHECK_NULL_EXIT(app_launcher, "Invalid app launcher object");
+
+    ESP_BROOKESIA_LOGD("On table scroll end event callback");
+
+    app_launcher->endPageCache();
+}
+
+ESP_Brookesia_AppLauncher::ESP_Brookesia_AppLauncherPageCache_t::ESP_Brookesia_AppLauncherPageCache_t():
+    image{},
+    buffer(nullptr),
+    buffer_size(0),
+    is_dirty(true)
+{
+}
+
+ESP_Brookesia_AppLauncher::ESP_Brookesia_AppLauncherPageCache_t::~ESP_Brookesia_AppLauncherPageCache_t()
+{
+    if (buffer != nullptr) {
+        lv_img_cache_invalidate_src(&image);
+        PAGE_CACHE_FREE(buffer);
+    }
+}
@@ -36,11 +36,22 @@ public:
                               ESP_Brookesia_AppLauncherData_t &data);
 
 private:
+    struct ESP_Brookesia_AppLauncherPageCache_t {
+        ESP_Brookesia_AppLauncherPageCache_t();
+        ~ESP_Brookesia_AppLauncherPageCache_t();
+
+        lv_img_dsc_t image;
+        uint8_t *buffer;
+        uint32_t buffer_size;
+        bool is_dirty;
+    };
     typedef struct {
         uint8_t page_icon_count;
         ESP_Brookesia_LvObj_t page_main_obj;
         ESP_Brookesia_LvObj_t page_obj;
         ESP_Brookesia_LvObj_t spot_obj;
+        std::shared_ptr<ESP_Brookesia_AppLauncherPageCache_t> page_cache;
+        ESP_Brookesia_LvObj_t cache_obj;
     } ESP_Brookesia_AppLauncherMixObject_t;
     typedef struct {
         uint8_t current_page_index;
@@ -56,9 +67,15 @@ private:
     bool toggleCurrentPageIconClickable(bool clickable);
     bool updateActiveSpot(void);
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
+    void invalidatePageCache(uint8_t page_index);
+    bool updatePageCache(uint8_t page_index);
+    bool beginPageCache(uint8_t from_index, uint8_t to_index);
+    void endPageCache(void);
 
     static void onDataUpdateEventCallback(lv_event_t *event);
     static void onPageTouchEventCallback(lv_event_t *event);
+    static void onTableScrollEndEventCallback(lv_event_t *event);
 
     // Core
     ESP_Brookesia_Core &_core;
@@ -68,10 +85,15 @@ private:
     uint8_t _table_page_icon_count_max;
     uint16_t _table_page_pad_row;
     uint16_t _table_page_pad_column;
+    bool _is_page_cache_shown;
     ESP_Brookesia_LvObj_t _main_obj;
     ESP_Brookesia_LvObj_t _table_obj;
     ESP_Brookesia_LvObj_t _indicator_obj;
     std::vector <ESP_Brookesia_AppLauncherMixObject_t> _mix_objs;
+    // Colors shared by all pages and icons, changed in place by a theme switch
+    lv_style_t _spot_active_style;
+    lv_style_t _spot_inactive_style;
+    lv_style_t _icon_label_style;
     std::map <int, ESP_Brookesia_AppLauncherMixIcon_t> _id_mix_icon_map;
 };
 // *INDENT-OFF*
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "esp_brookesia_app_launcher_icon.hpp"
+#include "core/esp_brookesia_core_image_cache.h"
 
 #if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_WIDGETS_APP_LAUNCHER
 #undef ESP_BROOKESIA_LOGD
@@ -13,13 +14,17 @@
 using namespace std;
 
 ESP_Brookesia_AppLauncherIcon::ESP_Brookesia_AppLauncherIcon(ESP_Brookesia_Core &core, const ESP_Brookesia_AppLauncherIconInfo_t &info,
-        const ESP_Brookesia_AppLauncherIconData_t &data):
+        const ESP_Brookesia_AppLauncherIconData_t &data, lv_style_t *label_style):
     _core(core),
     _info(info),
     _data(data),
+    _label_style(label_style),
     _flags{},
     _image_default_zoom(LV_IMG_ZOOM_NONE),
     _image_press_zoom(LV_IMG_ZOOM_NONE),
+    _image_default_scaled(nullptr),
+    _image_press_scaled(nullptr),
+    _prewarm_timer(nullptr),
     _main_obj(nullptr),
     _icon_main_obj(nullptr),
     _icon_image_obj(nullptr),
@@ -89,6 +94,9 @@ bool ESP_Brookesia_AppLauncherIcon::begin(lv_obj_t *parent)
     lv_obj_add_event_cb(icon_image_obj.get(), onIconTouchEventCallback, LV_EVENT_CLICKED, this);
     // Name
     lv_obj_add_style(name_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    if (_label_style != nullptr) {
+        lv_obj_add_style(name_label.get(), _label_style, 0);
+    }
     lv_label_set_text_static(name_label.get(), _info.name);
 
     /* Save objects */
@@ -120,6 +128,8 @@ bool ESP_Brookesia_AppLauncherIcon::del(void)
     _icon_main_obj.reset();
     _icon_image_obj.reset();
     _name_label.reset();
+    releaseScaledImages();
+    stopPrewarmTimer();
 
     return true;
 }
@@ -154,8 +164,10 @@ bool ESP_Brookesia_AppLauncherIcon::updateByNewData(void)
     lv_obj_set_size(_icon_main_obj.get(), _data.image.default_size.width, _data.image.default_size.height);
     // Label
     lv_obj_set_style_text_font(_name_label.get(), (lv_font_t *)_data.label.text_font.font_resource, 0);
-    lv_obj_set_style_text_color(_name_label.get(), lv_color_hex(_data.label.text_color.color), 0);
-    lv_obj_set_style_text_opa(_name_label.get(), _data.label.text_color.opacity, 0);
+    if (_label_style == nullptr) {
+        lv_obj_set_style_text_color(_name_label.get(), lv_color_hex(_data.label.text_color.color), 0);
+        lv_obj_set_style_text_opa(_name_label.get(), _data.label.text_color.opacity, 0);
+    }
     // Image
     // Calculate the multiple of the size between the target and the image.
     h_factor = (float)(_data.image.default_size.width) / ((lv_img_dsc_t *)_info.image.resource)->header.h;
@@ -164,12 +176,9 @@ bool ESP_Brookesia_AppLauncherIcon::updateByNewData(void)
     // So you don’t have to consider the size of the source image.
     if (h_factor < w_factor) {
         _image_default_zoom = (int)(h_factor * LV_IMG_ZOOM_NONE);
-        lv_img_set_zoom(_icon_image_obj.get(), _image_default_zoom);
     } else {
         _image_default_zoom = (int)(w_factor * LV_IMG_ZOOM_NONE);
-        lv_img_set_zoom(_icon_image_obj.get(), _image_default_zoom);
     }
-    lv_obj_refr_size(_icon_image_obj.get());
     // Calculate the multiple of the size between the target and the image.
     h_factor = (float)(_data.image.press_size.width) / ((lv_img_dsc_t *)_info.image.resource)->header.h;
     w_factor = (float)(_data.image.press_size.height) / ((lv_img_dsc_t *)_info.image.resource)->header.w;
@@ -180,10 +189,39 @@ bool ESP_Brookesia_AppLauncherIcon::updateByNewData(void)
     } else {
         _image_press_zoom = (int)(w_factor * LV_IMG_ZOOM_NONE);
     }
+    // Draw copies scaled to both sizes if the image cache has room for them, otherwise zoom the image
+    releaseScaledImages();
+    _image_default_scaled = esp_brookesia_core_image_cache_get_fit(
+                                (const lv_img_dsc_t *)_info.image.resource, _data.image.default_size.width,
+                                _data.image.default_size.height
+                            );
+    _image_press_scaled = esp_brookesia_core_image_cache_get_fit(
+                              (const lv_img_dsc_t *)_info.image.resource, _data.image.press_size.width,
+                              _data.image.press_size.height
+                          );
+    if ((_image_default_scaled == nullptr) || (_image_press_scaled == nullptr)) {
+        releaseScaledImages();
+    }
+    if (_image_default_scaled != nullptr) {
+        lv_img_set_src(_icon_image_obj.get(), _image_default_scaled);
+        lv_img_set_zoom(_icon_image_obj.get(), LV_IMG_ZOOM_NONE);
+    } else {
+        lv_img_set_src(_icon_image_obj.get(), _info.image.resource);
+        lv_img_set_zoom(_icon_image_obj.get(), _image_default_zoom);
+    }
+    lv_obj_refr_size(_icon_image_obj.get());
 
     return true;
 }
 
+void ESP_Brookesia_AppLauncherIcon::releaseScaledImages(void)
+{
+    esp_brookesia_core_image_cache_release(_image_default_scaled);
+    esp_brookesia_core_image_cache_release(_image_press_scaled);
+    _image_default_scaled = nullptr;
+    _image_press_scaled = nullptr;
+}
+
 void ESP_Brookesia_AppLauncherIcon::onIconTouchEventCallback(lv_event_t *event)
 {
     ESP_Brookesia_AppLauncherIcon *icon = nullptr;
@@ -205,6 +243,7 @@ void ESP_Brookesia_AppLauncherIcon::onIconTouchEventCallback(lv_event_t *event)
     switch (event_code) {
     case LV_EVENT_CLICKED:
         ESP_BROOKESIA_LOGD("Clicked");
+        icon->stopPrewarmTimer();
         if (icon->_flags.is_pressed_losted || icon->_flags.is_click_disable) {
             break;
         }
@@ -217,9 +256,20 @@ void ESP_Brookesia_AppLauncherIcon::onIconTouchEventCallback(lv_event_t *event)
             break;
         }
         // Zoom out icon
-        lv_img_set_zoom(icon_image_obj, icon->_image_press_zoom);
+        if (icon->_image_press_scaled != nullptr) {
+            lv_img_set_src(icon_image_obj, icon->_image_press_scaled);
+        } else {
+            lv_img_set_zoom(icon_image_obj, icon->_image_press_zoom);
+        }
         lv_obj_refr_size(icon_image_obj);
         icon->_flags.is_pressed_losted = false;
+        // Give the press a moment to turn into a scroll before the app is initialized
+        if ((ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS != 0) && (icon->_prewarm_timer == nullptr)) {
+            icon->_prewarm_timer = lv_timer_create(onPrewarmTimerCallback, ESP_BROOKESIA_APP_PRESS_PREWARM_DELAY_MS, icon);
+            if (icon->_prewarm_timer != nullptr) {
+                lv_timer_set_repeat_count(icon->_prewarm_timer, 1);
+            }
+        }
         break;
     case LV_EVENT_PRESS_LOST:
         ESP_BROOKESIA_LOGD("Press lost");
@@ -227,8 +277,14 @@ void ESP_Brookesia_AppLauncherIcon::onIconTouchEventCallback(lv_event_t *event)
         [[fallthrough]];
     case LV_EVENT_RELEASED:
         ESP_BROOKESIA_LOGD("Released");
+        // A drag cancels the pre-warm, a click starts the app, which initializes it anyway
+        icon->stopPrewarmTimer();
         // Zoom in icon
-        lv_img_set_zoom(icon_image_obj, icon->_image_default_zoom);
+        if (icon->_image_default_scaled != nullptr) {
+            lv_img_set_src(icon_image_obj, icon->_image_default_scaled);
+        } else {
+            lv_img_set_zoom(icon_image_obj, icon->_image_default_zoom);
+        }
         lv_obj_refr_size(icon_image_obj);
         break;
     default:
@@ -236,3 +292,27 @@ void ESP_Brookesia_AppLauncherIcon::onIconTouchEventCallback(lv_event_t *event)
         break;
     }
 }
+
+void ESP_Brookesia_AppLauncherIcon::stopPrewarmTimer(void)
+{
+    if (_prewarm_timer != nullptr) {
+        lv_timer_del(_prewarm_timer);
+        _prewarm_timer = nullptr;
+    }
+}
+
+void ESP_Brookesia_AppLauncherIcon::onPrewarmTimerCallback(lv_timer_t *timer)
+{
+    ESP_Brookesia_AppLauncherIcon *icon = (ESP_Brookesia_AppLauncherIcon *)timer->user_data;
+    ESP_Brookesia_CoreAppEventData_t app_event_data = {
+        .type = ESP_BROOKESIA_CORE_APP_EVENT_TYPE_PREWARM,
+    };
+
+    ESP_BROOKESIA_LOGD("Prewarm timer callback");
+    ESP_BROOKESIA_CHECK_NULL_EXIT(icon, "Invalid icon");
+
+    // The timer only runs once, LVGL deletes it after this callback
+    icon->_prewarm_timer = nullptr;
+    app_event_data.id = icon->_info.id;
+    ESP_BROOKESIA_CHECK_FALSE_EXIT(icon->_core.sendAppEvent(&app_event_data), "Send app event failed");
+}
@@ -14,7 +14,8 @@
 // *INDENT-OFF*
 class ESP_Brookesia_AppLauncherIcon {
 public:
-    ESP_Brookesia_AppLauncherIcon(ESP_Brookesia_Core &core, const ESP_Brookesia_AppLauncherIconInfo_t &info, const ESP_Brookesia_AppLauncherIconData_t &data);
+    ESP_Brookesia_AppLauncherIcon(ESP_Brookesia_Core &core, const ESP_Brookesia_AppLauncherIconInfo_t &info, const ESP_Brookesia_AppLauncherIconData_t &data,
+                                  lv_style_t *label_style = nullptr);
     ~ESP_Brookesia_AppLauncherIcon();
 
     bool begin(lv_obj_t *parent);
@@ -26,11 +27,16 @@ public:
     bool updateByNewData(void);
 
 private:
+    void releaseScaledImages(void);
+    void stopPrewarmTimer(void);
+
     static void onIconTouchEventCallback(lv_event_t *event);
+    static void onPrewarmTimerCallback(lv_timer_t *timer);
 
     ESP_Brookesia_Core &_core;
     ESP_Brookesia_AppLauncherIconInfo_t _info;
     const ESP_Brookesia_AppLauncherIconData_t &_data;
+    lv_style_t *_label_style;   // Text color shared by the labels of all icons, owned by the launcher
 
     struct {
         uint8_t is_pressed_losted: 1;
@@ -38,6 +44,10 @@ private:
     } _flags;
     uint16_t _image_default_zoom;
     uint16_t _image_press_zoom;
+    const lv_img_dsc_t *_image_default_scaled;
+    const lv_img_dsc_t *_image_press_scaled;
+    // Started on press, the app is initialized in advance if the press is still held when it expires
+    lv_timer_t *_prewarm_timer;
     ESP_Brookesia_LvObj_t _main_obj;
     ESP_Brookesia_LvObj_t _icon_main_obj;
     ESP_Brookesia_LvObj_t _icon_image_obj;
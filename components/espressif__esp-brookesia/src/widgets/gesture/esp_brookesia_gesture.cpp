@@ -3,7 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include <limits>
+#include <algorithm>
 #include <cmath>
 #include "esp_brookesia_gesture.hpp"
 
@@ -14,6 +14,8 @@
 
 using namespace std;
 
+#define DIRECTION_TAN_SHIFT  (10)
+
 #define ESP_BROOKESIA_GESTURE_INFO_INIT()                \
     {                                             \
         .direction = ESP_BROOKESIA_GESTURE_DIR_NONE,     \
@@ -24,7 +26,12 @@ using namespace std;
         .stop_x = -1,                             \
         .stop_y = -1,                             \
         .duration_ms = 0,                         \
+        .speed_px_per_ms = 0,                     \
         .distance_px = 0,                         \
+        .speed_x_px_per_s = 0,                    \
+        .speed_y_px_per_s = 0,                    \
+        .predict_x = -1,                          \
+        .predict_y = -1,                          \
         .flags = {                                \
             .slow_speed = 0,                      \
             .short_duration = 0,                  \
@@ -40,6 +47,7 @@ ESP_Brookesia_Gesture::ESP_Brookesia_Gesture(ESP_Brookesia_Core &core_in, const
     _indicator_bar_min_lengths{},
     _indicator_bar_max_lengths{},
     _touch_start_tick(0),
+    _history(),
     _detect_timer(nullptr),
     _event_mask_obj(nullptr),
     _indicator_bars{},
@@ -78,6 +86,8 @@ bool ESP_Brookesia_Gesture::begin(lv_obj_t *parent)
     /* Create objects */
     detect_timer = ESP_BROOKESIA_LV_TIMER(onTouchDetectTimerCallback, data.detect_period_ms, this);
     ESP_BROOKESIA_CHECK_NULL_RETURN(detect_timer, false, "Create detect timer failed");
+    // The timer only runs while touched, it is resumed by the first pressed sample of the touch hook
+    lv_timer_pause(detect_timer.get());
     event_mask_obj = ESP_BROOKESIA_LV_OBJ(obj, parent);
     ESP_BROOKESIA_CHECK_NULL_RETURN(event_mask_obj, false, "Create event & mask object failed");
     press_event_code = core.getFreeEventCode();
@@ -135,6 +145,11 @@ bool ESP_Brookesia_Gesture::begin(lv_obj_t *parent)
     // Update the object style
     ESP_BROOKESIA_CHECK_FALSE_GOTO(updateByNewData(), err, "Update failed");
 
+    ESP_BROOKESIA_CHECK_FALSE_GOTO(
+        esp_brookesia_core_touch_hook_add(_touch_device, onTouchSampleCallback, this), err, "Add touch hook failed"
+    );
+    _flags.is_touch_hooked = true;
+
     return true;
 
 err:
@@ -147,6 +162,12 @@ bool ESP_Brookesia_Gesture::del(void)
 {
     ESP_BROOKESIA_LOGD("Delete(0x%p)", this);
 
+    if (_flags.is_touch_hooked) {
+        if (!esp_brookesia_core_touch_hook_remove(_touch_device, onTouchSampleCallback, this)) {
+            ESP_BROOKESIA_LOGE("Remove touch hook failed");
+        }
+        _flags.is_touch_hooked = false;
+    }
     _direction_tan_threshold = 0;
     _touch_start_tick = 0;
     _detect_timer.reset();
@@ -436,13 +457,8 @@ bool ESP_Brookesia_Gesture::updateByNewData(void)
         lv_obj_set_size(_indicator_bars[i].get(), bar_data.main.size_max.width, bar_data.main.size_max.height);
         lv_obj_set_style_radius(_indicator_bars[i].get(), bar_data.main.radius, 0);
         lv_obj_set_style_pad_all(_indicator_bars[i].get(), bar_data.main.layout_pad_all, 0);
-        lv_obj_set_style_bg_color(_indicator_bars[i].get(), lv_color_hex(bar_data.main.color.color), 0);
-        lv_obj_set_style_bg_opa(_indicator_bars[i].get(), bar_data.main.color.opacity, 0);
         // Indicator
         lv_obj_set_style_radius(_indicator_bars[i].get(), bar_data.indicator.radius, LV_PART_INDICATOR);
-        lv_obj_set_style_bg_color(_indicator_bars[i].get(), lv_color_hex(bar_data.indicator.color.color),
-                                  LV_PART_INDICATOR);
-        lv_obj_set_style_bg_opa(_indicator_bars[i].get(), bar_data.indicator.color.opacity, LV_PART_INDICATOR);
         lv_anim_set_path_cb(_indicator_bar_scale_back_anims[i].get(),
                             esp_brookesia_core_utils_get_anim_path_cb(bar_data.animation.scale_back_path_type));
         lv_anim_set_time(_indicator_bar_scale_back_anims[i].get(), bar_data.animation.scale_back_time_ms);
@@ -475,7 +491,27 @@ bool ESP_Brookesia_Gesture::updateByNewData(void)
         lv_obj_align(_indicator_bars[i].get(), align, align_x_offset, align_y_offset);
     }
     // Data
-    _direction_tan_threshold = tan((int)data.threshold.direction_angle * M_PI / 180);
+    _direction_tan_threshold = (int32_t)(tan((int)data.threshold.direction_angle * M_PI / 180) *
+                                         (1 << DIRECTION_TAN_SHIFT));
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_Gesture::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    for (int i = 0; i < ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_MAX; i++) {
+        const ESP_Brookesia_GestureIndicatorBarData_t &bar_data = data.indicator_bars[i];
+        lv_obj_set_style_bg_color(_indicator_bars[i].get(), lv_color_hex(bar_data.main.color.color), 0);
+        lv_obj_set_style_bg_opa(_indicator_bars[i].get(), bar_data.main.color.opacity, 0);
+        lv_obj_set_style_bg_color(_indicator_bars[i].get(), lv_color_hex(bar_data.indicator.color.color),
+                                  LV_PART_INDICATOR);
+        lv_obj_set_style_bg_opa(_indicator_bars[i].get(), bar_data.indicator.color.opacity, LV_PART_INDICATOR);
+    }
 
     return true;
 }
@@ -490,6 +526,10 @@ void ESP_Brookesia_Gesture::onDataUpdateEventCallback(lv_event_t *event)
     gesture = (ESP_Brookesia_Gesture *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(gesture, "Invalid gesture object");
 
+    if (ESP_Brookesia_Core::checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(gesture->updateThemeByNewData(), "Update gesture theme failed");
+        return;
+    }
     ESP_BROOKESIA_CHECK_FALSE_EXIT(gesture->updateByNewData(), "Update gesture object style failed");
 }
 
@@ -498,7 +538,8 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
     bool touched = false;
     int distance_x = 0;
     int distance_y = 0;
-    float distance_tan = numeric_limits<float>::infinity();
+    int32_t speed_x = 0;
+    int32_t speed_y = 0;
     lv_event_code_t event_code = LV_EVENT_ALL;
 
     ESP_Brookesia_Gesture *gesture = (ESP_Brookesia_Gesture *)t->user_data;
@@ -507,7 +548,7 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
     const ESP_Brookesia_GestureData_t &data = gesture->data;
     const uint16_t &display_w = gesture->core.getCoreData().screen_size.width;
     const uint16_t &display_h = gesture->core.getCoreData().screen_size.height;
-    const float &distance_tan_threshold = gesture->_direction_tan_threshold;
+    const int32_t &distance_tan_threshold = gesture->_direction_tan_threshold;
     ESP_Brookesia_GestureInfo_t &info = gesture->_info;
 
     // Check if touched and save the last touch point
@@ -520,8 +561,9 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
     info.stop_area |= (info.stop_x < data.threshold.horizontal_edge) ? ESP_BROOKESIA_GESTURE_AREA_LEFT_EDGE : 0;
     info.stop_area |= ((display_w - info.stop_x) < data.threshold.horizontal_edge) ? ESP_BROOKESIA_GESTURE_AREA_RIGHT_EDGE : 0;
 
-    // If not touched before and now, just ignore and return
+    // If not touched before and now, just ignore and wait for the next pressed sample
     if (!gesture->checkGestureStart() && !touched) {
+        lv_timer_pause(t);
         return;
     }
 
@@ -531,6 +573,8 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
         gesture->_touch_start_tick = lv_tick_get();
         info.start_x = info.stop_x;
         info.start_y = info.stop_y;
+        info.predict_x = info.stop_x;
+        info.predict_y = info.stop_y;
 
         // Process the start area
         info.start_area = ESP_BROOKESIA_GESTURE_AREA_CENTER;
@@ -550,6 +594,21 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
     info.duration_ms = lv_tick_elaps(gesture->_touch_start_tick);
     info.flags.short_duration = (info.duration_ms < data.threshold.duration_short_ms);
 
+    // Process the speed from the latest samples, and the point to follow while dragging
+    gesture->_history.getVelocity(speed_x, speed_y);
+    info.speed_x_px_per_s = (speed_x * 1000) >> ESP_Brookesia_GestureHistory::VELOCITY_SHIFT;
+    info.speed_y_px_per_s = (speed_y * 1000) >> ESP_Brookesia_GestureHistory::VELOCITY_SHIFT;
+    info.speed_px_per_ms = (float)ESP_Brookesia_GestureHistory::sqrt(
+                               (uint32_t)(speed_x * speed_x) + (uint32_t)(speed_y * speed_y)
+                           ) / (1 << ESP_Brookesia_GestureHistory::VELOCITY_SHIFT);
+    info.flags.slow_speed = (info.speed_px_per_ms < data.threshold.speed_slow_px_per_ms);
+    info.predict_x = info.stop_x;
+    info.predict_y = info.stop_y;
+    if (touched && gesture->_history.predict(ESP_BROOKESIA_GESTURE_PREDICT_MS, info.predict_x, info.predict_y)) {
+        info.predict_x = min(max(info.predict_x, 0), display_w - 1);
+        info.predict_y = min(max(info.predict_y, 0), display_h - 1);
+    }
+
     // Set the event code according to the touch status
     if (touched) {
         event_code = gesture->_pressing_event_code;
@@ -567,19 +626,13 @@ void ESP_Brookesia_Gesture::onTouchDetectTimerCallback(struct _lv_timer_t *t)
         goto event_process;
     }
 
-    // Process the distance and speed
-    info.distance_px = (float)sqrt(distance_x * distance_x + distance_y * distance_y);
-    info.speed_px_per_ms = (info.duration_ms > 0) ? (info.distance_px / info.duration_ms) :
-                           numeric_limits<float>::infinity();
-    info.flags.slow_speed = (info.speed_px_per_ms < data.threshold.speed_slow_px_per_ms);
+    // Process the distance
+    info.distance_px = (float)ESP_Brookesia_GestureHistory::sqrt(distance_x * distance_x + distance_y * distance_y);
 
     /* Process the direction */
-    // Calculate the tan value of the gesture
-    distance_tan = (distance_x == 0) ? numeric_limits<float>::infinity() : (float)distance_y / distance_x;
-    // Check if the tan absolute value is large enoughd
+    // Check if the absolute tan value of the gesture (|y| / |x|) is large enough, without dividing
     // if so, it means the gesture is up or down, otherwise, it's left or right
-    if ((distance_tan == numeric_limits<float>::infinity()) || (distance_tan > distance_tan_threshold) ||
-            (distance_tan < -distance_tan_threshold)) {
+    if ((abs(distance_y) << DIRECTION_TAN_SHIFT) > abs(distance_x) * distance_tan_threshold) {
         // Check the distance in y axis
         if (distance_y > data.threshold.direction_vertical) {
             info.direction = ESP_BROOKESIA_GESTURE_DIR_DOWN;
@@ -600,8 +653,8 @@ event_process:
         ESP_BROOKESIA_LOGD(
             "\n\tpoint(%d,%d->%d,%d), area(%d->%d), dir(%d), distance(%.2f), angle(%d), duration(%dms), speed(%.2f),"
             "event(%d)", info.start_x, info.start_y, info.stop_x, info.stop_y, info.start_area, info.stop_area,
-            (int)info.direction, info.distance_px, (int)(atan(distance_tan) * -180 / M_PI), (int)info.duration_ms,
-            info.speed_px_per_ms, (int)event_code
+            (int)info.direction, info.distance_px, (int)(atan2(-distance_y, distance_x) * 180 / M_PI),
+            (int)info.duration_ms, info.speed_px_per_ms, (int)event_code
         );
     }
 
@@ -609,6 +662,33 @@ event_process:
     lv_event_send(gesture->_event_mask_obj.get(), event_code, (void *)&gesture->_event_data);
     if (event_code == gesture->_release_event_code) {
         gesture->resetGestureInfo();
+        lv_timer_pause(t);
+    }
+}
+
+void ESP_Brookesia_Gesture::onTouchSampleCallback(const ESP_Brookesia_TouchSample_t *sample, void *user_data)
+{
+    ESP_Brookesia_Gesture *gesture = (ESP_Brookesia_Gesture *)user_data;
+    ESP_BROOKESIA_CHECK_NULL_EXIT(gesture, "Invalid gesture");
+    ESP_BROOKESIA_CHECK_NULL_EXIT(sample, "Invalid sample");
+
+    lv_timer_t *timer = gesture->_detect_timer.get();
+    bool touched = (sample->state == LV_INDEV_STATE_PR);
+
+    if (touched) {
+        if (!gesture->checkGestureStart()) {
+            gesture->_history.reset();
+        }
+        gesture->_history.push(sample->point.x, sample->point.y, lv_tick_get());
+    }
+
+    // Press and release are handled on the sample that brings them, pressing events keep the period of the timer
+    if (touched && !gesture->checkGestureStart()) {
+        lv_timer_resume(timer);
+        lv_timer_reset(timer);
+        onTouchDetectTimerCallback(timer);
+    } else if (!touched && gesture->checkGestureStart()) {
+        onTouchDetectTimerCallback(timer);
     }
 }
 
@@ -8,7 +8,9 @@
 #include "lvgl.h"
 #include "core/esp_brookesia_core_type.h"
 #include "core/esp_brookesia_core.hpp"
+#include "core/esp_brookesia_core_touch_hook.h"
 #include "esp_brookesia_gesture_type.h"
+#include "esp_brookesia_gesture_history.hpp"
 
 // *INDENT-OFF*
 class ESP_Brookesia_Gesture {
@@ -51,9 +53,11 @@ private:
     };
     void resetGestureInfo(void);
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
 
     static void onDataUpdateEventCallback(lv_event_t *event);
     static void onTouchDetectTimerCallback(struct _lv_timer_t *t);
+    static void onTouchSampleCallback(const ESP_Brookesia_TouchSample_t *sample, void *user_data);
     static void onIndicatorBarScaleBackAnimationExecuteCallback(void *var, int32_t value);
     static void onIndicatorBarScaleBackAnimationReadyCallback(lv_anim_t *anim);
 
@@ -61,12 +65,14 @@ private:
     lv_indev_t *_touch_device;
 
     struct {
+        uint8_t is_touch_hooked: 1;
         std::array<bool, ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_MAX>  is_indicator_bar_scale_back_anim_running;
     } _flags;
-    float _direction_tan_threshold;
+    int32_t _direction_tan_threshold;
     std::array<int, ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_MAX>  _indicator_bar_min_lengths;
     std::array<int, ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_MAX>  _indicator_bar_max_lengths;
     uint32_t _touch_start_tick;
+    ESP_Brookesia_GestureHistory _history;
     ESP_Brookesia_LvTimer_t _detect_timer;
     ESP_Brookesia_LvObj_t _event_mask_obj;
     std::array<ESP_Brookesia_LvObj_t, ESP_BROOKESIA_GESTURE_INDICATOR_BAR_TYPE_MAX>  _indicator_bars;
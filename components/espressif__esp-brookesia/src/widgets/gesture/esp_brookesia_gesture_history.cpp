@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "esp_brookesia_gesture_history.hpp"
+
+static_assert((ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM >= 2) &&
+              (ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM <= ESP_Brookesia_GestureHistory::SAMPLE_NUM_MAX),
+              "Invalid ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM");
+
+ESP_Brookesia_GestureHistory::ESP_Brookesia_GestureHistory(void):
+    _samples{},
+    _head(0),
+    _num(0)
+{
+}
+
+void ESP_Brookesia_GestureHistory::reset(void)
+{
+    _head = 0;
+    _num = 0;
+}
+
+void ESP_Brookesia_GestureHistory::push(int x, int y, uint32_t tick_ms)
+{
+    // Several reads in the same tick carry no timing, keep the latest one only
+    if ((_num == 0) || (getSample(0).tick_ms != tick_ms)) {
+        _head = (_head + 1) % ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM;
+        if (_num < ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM) {
+            _num++;
+        }
+    }
+    _samples[_head] = {
+        .x = (int16_t)x,
+        .y = (int16_t)y,
+        .tick_ms = tick_ms,
+    };
+}
+
+bool ESP_Brookesia_GestureHistory::getVelocity(int32_t &vx, int32_t &vy) const
+{
+    int64_t sum_t = 0;
+    int64_t sum_tt = 0;
+    int64_t sum_x = 0;
+    int64_t sum_y = 0;
+    int64_t sum_tx = 0;
+    int64_t sum_ty = 0;
+    int64_t denominator = 0;
+    int n = 0;
+
+    vx = 0;
+    vy = 0;
+    if (_num < 2) {
+        return false;
+    }
+
+    // Times and positions are relative to the latest sample to keep the sums small
+    const Sample &latest = getSample(0);
+    for (int i = 0; i < _num; i++) {
+        const Sample &sample = getSample(i);
+        int32_t t = -(int32_t)(latest.tick_ms - sample.tick_ms);
+        if ((uint32_t)(-t) > WINDOW_MS) {
+            break;
+        }
+        int32_t x = sample.x - latest.x;
+        int32_t y = sample.y - latest.y;
+
+        sum_t += t;
+        sum_tt += t * t;
+        sum_x += x;
+        sum_y += y;
+        sum_tx += t * x;
+        sum_ty += t * y;
+        n++;
+    }
+
+    denominator = n * sum_tt - sum_t * sum_t;
+    if ((n < 2) || (denominator == 0)) {
+        return false;
+    }
+    vx = (int32_t)(((n * sum_tx - sum_t * sum_x) * (1 << VELOCITY_SHIFT)) / denominator);
+    vy = (int32_t)(((n * sum_ty - sum_t * sum_y) * (1 << VELOCITY_SHIFT)) / denominator);
+
+    return true;
+}
+
+bool ESP_Brookesia_GestureHistory::predict(uint32_t ahead_ms, int &x, int &y) const
+{
+    int32_t vx = 0;
+    int32_t vy = 0;
+
+    if (_num == 0) {
+        return false;
+    }
+
+    const Sample &latest = getSample(0);
+    x = latest.x;
+    y = latest.y;
+    if ((ahead_ms > 0) && getVelocity(vx, vy)) {
+        x += (int)((vx * (int32_t)ahead_ms) >> VELOCITY_SHIFT);
+        y += (int)((vy * (int32_t)ahead_ms) >> VELOCITY_SHIFT);
+    }
+
+    return true;
+}
+
+uint32_t ESP_Brookesia_GestureHistory::sqrt(uint32_t value)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return result;
+}
+
+const ESP_Brookesia_GestureHistory::Sample &ESP_Brookesia_GestureHistory::getSample(int age) const
+{
+    return _samples[(_head - age + ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM) % ESP_BROOKESIA_GESTURE_VELOCITY_SAMPLE_NUM];
+}
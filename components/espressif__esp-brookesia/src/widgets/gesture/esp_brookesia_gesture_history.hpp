@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include "esp_brookesia_conf_internal.h"
+
+// *INDENT-OFF*
+/**
+ * @brief Ring of the latest touch samples of a gesture. The velocity is the least-squares slope of the samples, it
+ *        follows the end of a fling instead of averaging it with the start, and only uses integer math.
+ *
+ */
+class ESP_Brookesia_GestureHistory {
+public:
+    static constexpr int SAMPLE_NUM_MAX = 16;
+    static constexpr int VELOCITY_SHIFT = 8;        // Velocities are in px/ms with 8 fractional bits
+    static constexpr uint32_t WINDOW_MS = 100;      // Samples older than this are ignored by the estimation
+
+    ESP_Brookesia_GestureHistory(void);
+
+    void reset(void);
+    void push(int x, int y, uint32_t tick_ms);
+
+    /**
+     * @brief Estimate the velocity from the latest samples
+     *
+     * @param vx Velocity in x, in px/ms << VELOCITY_SHIFT
+     * @param vy Velocity in y, in px/ms << VELOCITY_SHIFT
+     *
+     * @return true if successful, otherwise false (less than two samples in the window)
+     *
+     */
+    bool getVelocity(int32_t &vx, int32_t &vy) const;
+
+    /**
+     * @brief Extrapolate the latest sample with the estimated velocity
+     *
+     * @param ahead_ms Time to extrapolate
+     * @param x Predicted x, the latest x if the velocity is unknown
+     * @param y Predicted y, the latest y if the velocity is unknown
+     *
+     * @return true if successful, otherwise false (no sample)
+     *
+     */
+    bool predict(uint32_t ahead_ms, int &x, int &y) const;
+
+    int getSampleNum(void) const        { return _num; }
+
+    static uint32_t sqrt(uint32_t value);
+
+private:
+    struct Sample {
+        int16_t x;
+        int16_t y;
+        uint32_t tick_ms;
+    };
+
+    const Sample &getSample(int age) const;
+
+    std::array<Sample, SAMPLE_NUM_MAX> _samples;
+    int _head;
+    int _num;
+};
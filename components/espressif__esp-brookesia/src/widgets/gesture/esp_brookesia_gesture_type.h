@@ -80,8 +80,12 @@ typedef struct {
     int stop_x;
     int stop_y;
     uint32_t duration_ms;
-    float speed_px_per_ms;
+    float speed_px_per_ms;          /*!< Speed estimated from the latest touch samples */
     float distance_px;
+    int speed_x_px_per_s;           /*!< Signed speed in x estimated from the latest touch samples */
+    int speed_y_px_per_s;           /*!< Signed speed in y estimated from the latest touch samples */
+    int predict_x;                  /*!< `stop_x` extrapolated by `ESP_BROOKESIA_GESTURE_PREDICT_MS`, for dragging */
+    int predict_y;                  /*!< `stop_y` extrapolated by `ESP_BROOKESIA_GESTURE_PREDICT_MS`, for dragging */
     struct {
         uint8_t slow_speed: 1;
         uint8_t short_duration: 1;
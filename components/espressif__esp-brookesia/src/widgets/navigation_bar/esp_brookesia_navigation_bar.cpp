@@ -24,9 +24,11 @@ ESP_Brookesia_NavigationBar::ESP_Brookesia_NavigationBar(const ESP_Brookesia_Cor
     _visual_flex_show_anim(nullptr),
     _visual_flex_hide_anim(nullptr),
     _visual_flex_hide_timer(nullptr),
+    _visual_flex_offset(0),
     _visual_mode(ESP_BROOKESIA_NAVIGATION_BAR_VISUAL_MODE_SHOW_FIXED),
     _main_obj(nullptr)
 {
+    lv_style_init(&_button_pressed_style);
 }
 
 ESP_Brookesia_NavigationBar::~ESP_Brookesia_NavigationBar()
@@ -92,6 +94,7 @@ bool ESP_Brookesia_NavigationBar::begin(lv_obj_t *parent)
     // Button
     for (int i = 0; i < ESP_BROOKESIA_NAVIGATION_BAR_DATA_BUTTON_NUM; i++) {
         lv_obj_add_style(button_objs[i].get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+        lv_obj_add_style(button_objs[i].get(), &_button_pressed_style, LV_STATE_PRESSED);
         lv_obj_set_style_bg_opa(button_objs[i].get(), LV_OPA_TRANSP, 0);
         lv_obj_add_flag(button_objs[i].get(), LV_OBJ_FLAG_CLICKABLE);
         lv_obj_clear_flag(button_objs[i].get(), LV_OBJ_FLAG_SCROLLABLE | LV_OBJ_FLAG_PRESS_LOCK);
@@ -111,6 +114,8 @@ bool ESP_Brookesia_NavigationBar::begin(lv_obj_t *parent)
         lv_img_set_size_mode(icon_image_objs[i].get(), LV_IMG_SIZE_MODE_REAL);
         lv_obj_clear_flag(icon_image_objs[i].get(), LV_OBJ_FLAG_CLICKABLE);
     }
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
+
     /* Visual flex */
     // Show animation
     lv_anim_init(visual_flex_show_anim.get());
@@ -169,6 +174,7 @@ bool ESP_Brookesia_NavigationBar::del(void)
     _visual_flex_show_anim.reset();
     _visual_flex_hide_anim.reset();
     _visual_flex_hide_timer.reset();
+    lv_style_reset(&_button_pressed_style);
 
     return ret;
 }
@@ -197,6 +203,12 @@ bool ESP_Brookesia_NavigationBar::setVisualMode(ESP_Brookesia_NavigationBarVisua
     // ESP_BROOKESIA_LOGD("Target: Hide(%d) Show Fixed(%d) Show Flex(%d)", is_target_hide, is_target_show_fixed,
     // is_target_show_flex);
 
+    // Nothing to stop or realign when a fixed mode is already applied, the flex mode restarts its hide animation
+    if ((mode == _visual_mode) && (mode != ESP_BROOKESIA_NAVIGATION_BAR_VISUAL_MODE_SHOW_FLEX) &&
+            (checkVisible() == (mode == ESP_BROOKESIA_NAVIGATION_BAR_VISUAL_MODE_SHOW_FIXED))) {
+        return true;
+    }
+
     if (mode == ESP_BROOKESIA_NAVIGATION_BAR_VISUAL_MODE_SHOW_FIXED) {
         ESP_BROOKESIA_LOGD("Force to show");
         ESP_BROOKESIA_CHECK_FALSE_RETURN(stopFlexHideTimer(), false, "Stop flex hide timer failed");
@@ -272,6 +284,10 @@ int ESP_Brookesia_NavigationBar::getCurrentOffset(void) const
 {
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), 0, "Not initialized");
 
+    if (_flags.is_visual_flex_show_anim_running || _flags.is_visual_flex_hide_anim_running) {
+        return _visual_flex_offset;
+    }
+
     lv_obj_update_layout(_main_obj.get());
     lv_obj_refr_pos(_main_obj.get());
 
@@ -348,25 +364,16 @@ bool ESP_Brookesia_NavigationBar::updateByNewData(void)
 
     // Main
     lv_obj_set_size(_main_obj.get(), _data.main.size.width, _data.main.size.height);
-    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
-    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
 
     for (int i = 0; i < ESP_BROOKESIA_NAVIGATION_BAR_DATA_BUTTON_NUM; i++) {
         // Button
         lv_obj_set_size(_button_objs[i].get(), _data.main.size.width / ESP_BROOKESIA_NAVIGATION_BAR_DATA_BUTTON_NUM,
                         _data.main.size.height);
-        lv_obj_set_style_bg_color(_button_objs[i].get(), lv_color_hex(_data.button.active_background_color.color),
-                                  LV_STATE_PRESSED);
-        lv_obj_set_style_bg_opa(_button_objs[i].get(), _data.button.active_background_color.opacity, LV_STATE_PRESSED);
         // Icon main
         lv_obj_set_size(_icon_main_objs[i].get(), _data.button.icon_size.width, _data.button.icon_size.height);
         // Icon image
         icon_image_resource = (lv_img_dsc_t *)_data.button.icon_images[i].resource;
         lv_img_set_src(_icon_image_objs[i].get(), icon_image_resource);
-        lv_obj_set_style_img_recolor(_icon_image_objs[i].get(),
-                                     lv_color_hex(_data.button.icon_images[i].recolor.color), 0);
-        lv_obj_set_style_img_recolor_opa(_icon_image_objs[i].get(),
-                                         _data.button.icon_images[i].recolor.opacity, 0);
         // Calculate the multiple of the size between the target and the image.
         h_factor = (float)(_data.button.icon_size.height) / icon_image_resource->header.h;
         w_factor = (float)(_data.button.icon_size.width) / icon_image_resource->header.w;
@@ -412,7 +419,8 @@ bool ESP_Brookesia_NavigationBar::startFlexShowAnimation(bool enable_auto_hide)
     _flags.enable_visual_flex_auto_hide = enable_auto_hide;
     lv_obj_clear_flag(_main_obj.get(), LV_OBJ_FLAG_HIDDEN);
     lv_obj_move_foreground(_main_obj.get());
-    lv_anim_set_values(_visual_flex_show_anim.get(), getCurrentOffset(), 0);
+    _visual_flex_offset = getCurrentOffset();
+    lv_anim_set_values(_visual_flex_show_anim.get(), _visual_flex_offset, 0);
     ESP_BROOKESIA_CHECK_NULL_RETURN(lv_anim_start(_visual_flex_show_anim.get()), false, "Start animation failed");
     _flags.is_visual_flex_show_anim_running = true;
 
@@ -431,6 +439,7 @@ bool ESP_Brookesia_NavigationBar::stopFlexShowAnimation(void)
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(lv_anim_del(_visual_flex_show_anim->var, nullptr), false, "Delete animation failed");
     _flags.is_visual_flex_show_anim_running = false;
+    commitFlexOffset();
 
     return true;
 }
@@ -445,7 +454,8 @@ bool ESP_Brookesia_NavigationBar::startFlexHideAnimation(void)
         return true;
     }
 
-    lv_anim_set_values(_visual_flex_hide_anim.get(), getCurrentOffset(), _data.main.size.height);
+    _visual_flex_offset = getCurrentOffset();
+    lv_anim_set_values(_visual_flex_hide_anim.get(), _visual_flex_offset, _data.main.size.height);
     ESP_BROOKESIA_CHECK_NULL_RETURN(lv_anim_start(_visual_flex_hide_anim.get()), false, "Start animation failed");
     _flags.is_visual_flex_hide_anim_running = true;
 
@@ -464,6 +474,7 @@ bool ESP_Brookesia_NavigationBar::stopFlexHideAnimation(void)
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(lv_anim_del(_visual_flex_hide_anim->var, nullptr), false, "Delete animation failed");
     _flags.is_visual_flex_hide_anim_running = false;
+    commitFlexOffset();
 
     return true;
 }
@@ -502,6 +513,12 @@ bool ESP_Brookesia_NavigationBar::stopFlexHideTimer(void)
     return true;
 }
 
+void ESP_Brookesia_NavigationBar::commitFlexOffset(void)
+{
+    // Align the bar where the animation left it, so the next layout keeps it there
+    lv_obj_align(_main_obj.get(), LV_ALIGN_BOTTOM_MID, 0, _visual_flex_offset);
+}
+
 bool ESP_Brookesia_NavigationBar::resetFlexHideTimer(void)
 {
     ESP_BROOKESIA_LOGD("Reset flex hide timer");
@@ -517,6 +534,29 @@ bool ESP_Brookesia_NavigationBar::resetFlexHideTimer(void)
     return true;
 }
 
+bool ESP_Brookesia_NavigationBar::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    // Main
+    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
+    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
+    // Button, the style is shared, so it is changed in place and refreshed once
+    lv_style_set_bg_color(&_button_pressed_style, lv_color_hex(_data.button.active_background_color.color));
+    lv_style_set_bg_opa(&_button_pressed_style, _data.button.active_background_color.opacity);
+    lv_obj_report_style_change(&_button_pressed_style);
+    // Icon image
+    for (int i = 0; i < ESP_BROOKESIA_NAVIGATION_BAR_DATA_BUTTON_NUM; i++) {
+        lv_obj_set_style_img_recolor(_icon_image_objs[i].get(),
+                                     lv_color_hex(_data.button.icon_images[i].recolor.color), 0);
+        lv_obj_set_style_img_recolor_opa(_icon_image_objs[i].get(),
+                                         _data.button.icon_images[i].recolor.opacity, 0);
+    }
+
+    return true;
+}
+
 void ESP_Brookesia_NavigationBar::onDataUpdateEventCallback(lv_event_t *event)
 {
     ESP_Brookesia_NavigationBar *navigation_bar = nullptr;
@@ -527,6 +567,10 @@ void ESP_Brookesia_NavigationBar::onDataUpdateEventCallback(lv_event_t *event)
     navigation_bar = (ESP_Brookesia_NavigationBar *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(navigation_bar, "Invalid navigation bar object");
 
+    if (ESP_Brookesia_Core::checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(navigation_bar->updateThemeByNewData(), "Update theme failed");
+        return;
+    }
     ESP_BROOKESIA_CHECK_FALSE_EXIT(navigation_bar->updateByNewData(), "Update failed");
 }
 
@@ -588,10 +632,23 @@ void ESP_Brookesia_NavigationBar::onIconTouchEventCallback(lv_event_t *event)
 
 void ESP_Brookesia_NavigationBar::onVisualFlexAnimationExecuteCallback(void *var, int32_t value)
 {
+    lv_obj_t *main_obj = nullptr;
+    lv_obj_t *parent = nullptr;
     ESP_Brookesia_NavigationBar *navigation_bar = static_cast<ESP_Brookesia_NavigationBar *>(var);
     ESP_BROOKESIA_CHECK_NULL_EXIT(navigation_bar, "Invalid var");
 
-    lv_obj_align(navigation_bar->_main_obj.get(), LV_ALIGN_BOTTOM_MID, 0, value);
+    if (value == navigation_bar->_visual_flex_offset) {
+        return;
+    }
+    navigation_bar->_visual_flex_offset = value;
+
+    // Move the coordinates directly instead of aligning, so no layout runs and only the old and new areas of the
+    // bar are invalidated. The alignment is applied once the animation stops
+    main_obj = navigation_bar->_main_obj.get();
+    parent = lv_obj_get_parent(main_obj);
+    ESP_BROOKESIA_CHECK_NULL_EXIT(parent, "Invalid parent");
+    lv_obj_move_to(main_obj, lv_obj_get_x(main_obj),
+                   lv_obj_get_content_height(parent) - lv_obj_get_height(main_obj) + value);
 }
 
 void ESP_Brookesia_NavigationBar::onVisualFlexShowAnimationReadyCallback(lv_anim_t *anim)
@@ -600,6 +657,7 @@ void ESP_Brookesia_NavigationBar::onVisualFlexShowAnimationReadyCallback(lv_anim
     ESP_BROOKESIA_CHECK_NULL_EXIT(navigation_bar, "Invalid var");
 
     ESP_BROOKESIA_LOGD("Flex show animation ready");
+    navigation_bar->commitFlexOffset();
     if (navigation_bar->_flags.enable_visual_flex_auto_hide) {
         ESP_BROOKESIA_CHECK_FALSE_EXIT(navigation_bar->startFlexHideTimer(), "Navigation bar start flex hide timer failed");
     }
@@ -613,6 +671,7 @@ void ESP_Brookesia_NavigationBar::onVisualFlexHideAnimationReadyCallback(lv_anim
 
     ESP_BROOKESIA_LOGD("Flex hide animation ready");
     navigation_bar->_flags.is_visual_flex_hide_anim_running = false;
+    navigation_bar->commitFlexOffset();
     lv_obj_add_flag(navigation_bar->_main_obj.get(), LV_OBJ_FLAG_HIDDEN);
 }
 
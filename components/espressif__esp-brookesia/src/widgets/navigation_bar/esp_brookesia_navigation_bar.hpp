@@ -37,6 +37,7 @@ public:
 
 private:
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
     bool startFlexShowAnimation(bool enable_auto_hide);
     bool stopFlexShowAnimation(void);
     bool startFlexHideAnimation(void);
@@ -44,6 +45,7 @@ private:
     bool startFlexHideTimer(void);
     bool stopFlexHideTimer(void);
     bool resetFlexHideTimer(void);
+    void commitFlexOffset(void);
 
     static void onDataUpdateEventCallback(lv_event_t *event);
     static void onIconTouchEventCallback(lv_event_t *event);
@@ -65,10 +67,13 @@ private:
     ESP_Brookesia_LvAnim_t _visual_flex_show_anim;
     ESP_Brookesia_LvAnim_t _visual_flex_hide_anim;
     ESP_Brookesia_LvTimer_t _visual_flex_hide_timer;
+    // Offset drawn by the flex animations, they move the bar without its alignment until they stop
+    int _visual_flex_offset;
     ESP_Brookesia_NavigationBarVisualMode_t _visual_mode;
     ESP_Brookesia_LvObj_t _main_obj;
     std::vector<ESP_Brookesia_LvObj_t> _button_objs;
     std::vector<ESP_Brookesia_LvObj_t> _icon_main_objs;
     std::vector<ESP_Brookesia_LvObj_t> _icon_image_objs;
+    lv_style_t _button_pressed_style;   // Shared by the buttons
 };
 // *INDENT-OFF*
@@ -13,6 +13,7 @@
 #endif
 
 #define MEMORY_LABEL_TEXT_FORMAT        "%d + %d %s of %d + %d %s available"
+#define MEMORY_LABEL_DETAIL_FORMAT      MEMORY_LABEL_TEXT_FORMAT " | %s"
 #define MEMORY_LABEL_TEXT_UNIT          "KB"
 
 using namespace std;
@@ -30,6 +31,7 @@ ESP_Brookesia_RecentsScreen::ESP_Brookesia_RecentsScreen(ESP_Brookesia_Core &cor
     _trash_obj(nullptr),
     _trash_icon(nullptr)
 {
+    lv_style_init(&_snapshot_title_style);
 }
 
 ESP_Brookesia_RecentsScreen::~ESP_Brookesia_RecentsScreen()
@@ -158,6 +160,7 @@ bool ESP_Brookesia_RecentsScreen::del(void)
     _trash_obj.reset();
     _trash_icon.reset();
     _id_snapshot_map.clear();
+    lv_style_reset(&_snapshot_title_style);
 
     return ret;
 }
@@ -183,7 +186,8 @@ bool ESP_Brookesia_RecentsScreen::addSnapshot(const ESP_Brookesia_RecentsScreenS
     ESP_BROOKESIA_LOGD("Add snapshot(%d)", conf.id);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
 
-    snapshot = make_shared<ESP_Brookesia_RecentsScreenSnapshot>(_core, conf, _data.snapshot_table.snapshot);
+    snapshot = make_shared<ESP_Brookesia_RecentsScreenSnapshot>(_core, conf, _data.snapshot_table.snapshot,
+                                                         &_snapshot_title_style);
     ESP_BROOKESIA_CHECK_NULL_RETURN(snapshot, false, "Create snapshot failed");
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(snapshot->begin(_snapshot_table.get()), false, "Begin snapshot failed");
@@ -278,14 +282,21 @@ bool ESP_Brookesia_RecentsScreen::updateSnapshotImage(int id)
     return true;
 }
 
-bool ESP_Brookesia_RecentsScreen::setMemoryLabel(int internal_free, int internal_total, int external_free, int external_total) const
+bool ESP_Brookesia_RecentsScreen::setMemoryLabel(int internal_free, int internal_total, int external_free, int external_total,
+                                                 const char *detail) const
 {
     ESP_BROOKESIA_LOGD("Set memory label");
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_memory_label != nullptr, false, "Memory label is disabled");
 
-    lv_label_set_text_fmt(_memory_label.get(), MEMORY_LABEL_TEXT_FORMAT,
-                          internal_free, external_free, _data.memory.label_unit_text,
-                          internal_total, external_total, _data.memory.label_unit_text);
+    if ((detail == nullptr) || (detail[0] == '\0')) {
+        lv_label_set_text_fmt(_memory_label.get(), MEMORY_LABEL_TEXT_FORMAT,
+                              internal_free, external_free, _data.memory.label_unit_text,
+                              internal_total, external_total, _data.memory.label_unit_text);
+    } else {
+        lv_label_set_text_fmt(_memory_label.get(), MEMORY_LABEL_DETAIL_FORMAT,
+                              internal_free, external_free, _data.memory.label_unit_text,
+                              internal_total, external_total, _data.memory.label_unit_text, detail);
+    }
 
     return true;
 }
@@ -526,16 +537,12 @@ bool ESP_Brookesia_RecentsScreen::updateByNewData(void)
     lv_obj_set_style_pad_row(_main_obj.get(), _data.main.layout_row_pad, 0);
     lv_obj_set_style_pad_top(_main_obj.get(), _data.main.layout_top_pad, 0);
     lv_obj_set_style_pad_bottom(_main_obj.get(), _data.main.layout_bottom_pad, 0);
-    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
-    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
     lv_obj_align(_main_obj.get(), LV_ALIGN_TOP_MID, 0, _data.main.y_start);
 
     // Label
     if (_data.flags.enable_memory) {
         lv_obj_set_size(_memory_obj.get(), _data.memory.main_size.width, _data.memory.main_size.height);
         lv_obj_align(_memory_label.get(), LV_ALIGN_RIGHT_MID, -_data.memory.main_layout_x_right_offset, 0);
-        lv_obj_set_style_text_color(_memory_label.get(), lv_color_hex(_data.memory.label_text_color.color), 0);
-        lv_obj_set_style_text_opa(_memory_label.get(), _data.memory.label_text_color.opacity, 0);
         lv_obj_set_style_text_font(_memory_label.get(), (lv_font_t *)_data.memory.label_text_font.font_resource, 0);
     }
 
@@ -546,8 +553,6 @@ bool ESP_Brookesia_RecentsScreen::updateByNewData(void)
     // Trash
     lv_obj_set_size(_trash_obj.get(), _data.trash_icon.default_size.width, _data.trash_icon.default_size.height);
     lv_img_set_src(_trash_icon.get(), _data.trash_icon.image.resource);
-    lv_obj_set_style_img_recolor(_trash_icon.get(), lv_color_hex(_data.trash_icon.image.recolor.color), 0);
-    lv_obj_set_style_img_recolor_opa(_trash_icon.get(), _data.trash_icon.image.recolor.opacity, 0);
     h_factor = (float)(_data.trash_icon.default_size.height) /
                ((lv_img_dsc_t *)_data.trash_icon.image.resource)->header.h;
     w_factor = (float)(_data.trash_icon.default_size.width) /
@@ -576,6 +581,32 @@ bool ESP_Brookesia_RecentsScreen::updateByNewData(void)
         ESP_BROOKESIA_CHECK_FALSE_RETURN(it.second->updateByNewData(), false, "Update snapshot object style failed");
     }
 
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_RecentsScreen::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Not initialized");
+
+    // Main
+    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
+    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
+    // Label
+    if (_data.flags.enable_memory) {
+        lv_obj_set_style_text_color(_memory_label.get(), lv_color_hex(_data.memory.label_text_color.color), 0);
+        lv_obj_set_style_text_opa(_memory_label.get(), _data.memory.label_text_color.opacity, 0);
+    }
+    // Trash
+    lv_obj_set_style_img_recolor(_trash_icon.get(), lv_color_hex(_data.trash_icon.image.recolor.color), 0);
+    lv_obj_set_style_img_recolor_opa(_trash_icon.get(), _data.trash_icon.image.recolor.opacity, 0);
+    // Snapshot, the titles share the style, so it is changed in place and refreshed once
+    lv_style_set_text_color(&_snapshot_title_style, lv_color_hex(_data.snapshot_table.snapshot.title.text_color.color));
+    lv_style_set_text_opa(&_snapshot_title_style, _data.snapshot_table.snapshot.title.text_color.opacity);
+    lv_obj_report_style_change(&_snapshot_title_style);
+
     return true;
 }
 
@@ -589,6 +620,10 @@ void ESP_Brookesia_RecentsScreen::onDataUpdateEventCallback(lv_event_t *event)
     recents_screen = (ESP_Brookesia_RecentsScreen *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(recents_screen, "Invalid app snapshot_table object");
 
+    if (ESP_Brookesia_Core::checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(recents_screen->updateThemeByNewData(), "Update theme failed");
+        return;
+    }
     ESP_BROOKESIA_CHECK_FALSE_EXIT(recents_screen->updateByNewData(), "Update object style failed");
 }
 
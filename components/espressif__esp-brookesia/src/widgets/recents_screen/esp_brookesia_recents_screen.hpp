@@ -27,7 +27,8 @@ public:
     bool scrollToSnapshotByIndex(uint8_t index);
     bool moveSnapshotY(int id, int y);
     bool updateSnapshotImage(int id);
-    bool setMemoryLabel(int internal_free, int internal_total, int external_free, int external_total) const;
+    bool setMemoryLabel(int internal_free, int internal_total, int external_free, int external_total,
+                        const char *detail = nullptr) const;
 
     bool checkInitialized(void) const   { return _main_obj != nullptr; }
     bool checkSnapshotExist(int id) const;
@@ -47,6 +48,7 @@ public:
 
 private:
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
 
     static void onDataUpdateEventCallback(lv_event_t *event);
     static void onTrashTouchEventCallback(lv_event_t *event);
@@ -65,5 +67,6 @@ private:
     ESP_Brookesia_LvObj_t _trash_obj;
     ESP_Brookesia_LvObj_t _trash_icon;
     std::unordered_map<int, std::shared_ptr<ESP_Brookesia_RecentsScreenSnapshot>> _id_snapshot_map;
+    lv_style_t _snapshot_title_style;   // Shared by the snapshot titles
 };
 // *INDENT-OFF*
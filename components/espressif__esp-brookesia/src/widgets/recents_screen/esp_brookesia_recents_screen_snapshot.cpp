@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "esp_brookesia_recents_screen_snapshot.hpp"
+#include "core/esp_brookesia_core_image_cache.h"
+#include "core/esp_brookesia_core_image_card.h"
 
 using namespace std;
 
@@ -14,18 +16,21 @@ using namespace std;
 
 ESP_Brookesia_RecentsScreenSnapshot::ESP_Brookesia_RecentsScreenSnapshot(const ESP_Brookesia_Core &core,
         const ESP_Brookesia_RecentsScreenSnapshotConf_t &conf,
-        const ESP_Brookesia_RecentsScreenSnapshotData_t &data):
+        const ESP_Brookesia_RecentsScreenSnapshotData_t &data, lv_style_t *title_style):
     _core(core),
     _conf(conf),
     _data(data),
+    _title_style(title_style),
     _origin_y(0),
     _main_obj(nullptr),
     _drag_obj(nullptr),
     _title_obj(nullptr),
     _title_icon(nullptr),
+    _title_icon_scaled(nullptr),
     _title_label(nullptr),
     _snapshot_obj(nullptr),
-    _snapshot_image(nullptr)
+    _snapshot_image(nullptr),
+    _snapshot_card(nullptr)
 {
 }
 
@@ -91,12 +96,14 @@ bool ESP_Brookesia_RecentsScreenSnapshot::begin(lv_obj_t *parent)
     lv_img_set_src(title_icon.get(), _conf.icon_image_resource);
     // Tile label
     lv_obj_add_style(title_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    if (_title_style != nullptr) {
+        lv_obj_add_style(title_label.get(), _title_style, 0);
+    }
     lv_label_set_text_static(title_label.get(), _conf.name);
     // Snapshot
     lv_obj_add_style(snapshot_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
     lv_obj_align(snapshot_obj.get(), LV_ALIGN_BOTTOM_MID, 0, 0);
     lv_obj_clear_flag(snapshot_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
-    lv_obj_set_style_clip_corner(snapshot_obj.get(), true, 0);
     // Snapshot image
     lv_obj_add_style(snapshot_image.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
     lv_obj_center(snapshot_image.get());
@@ -138,9 +145,13 @@ bool ESP_Brookesia_RecentsScreenSnapshot::del(void)
     _drag_obj.reset();
     _title_obj.reset();
     _title_icon.reset();
+    esp_brookesia_core_image_cache_release(_title_icon_scaled);
+    _title_icon_scaled = nullptr;
     _title_label.reset();
     _snapshot_obj.reset();
     _snapshot_image.reset();
+    esp_brookesia_core_image_card_del(_snapshot_card);
+    _snapshot_card = nullptr;
 
     return true;
 }
@@ -171,23 +182,46 @@ bool ESP_Brookesia_RecentsScreenSnapshot::updateByNewData(void)
     // Title
     lv_obj_set_size(_title_obj.get(), _data.title.main_size.width, _data.title.main_size.height);
     lv_obj_set_style_pad_column(_title_obj.get(), _data.title.main_layout_column_pad, 0);
-    // Title icon
-    h_factor = (float)(_data.title.icon_size.height) / ((const lv_img_dsc_t *)_conf.icon_image_resource)->header.h;
-    w_factor = (float)(_data.title.icon_size.width) / ((const lv_img_dsc_t *)_conf.icon_image_resource)->header.w;
-    if (h_factor < w_factor) {
-        lv_img_set_zoom(_title_icon.get(), (int)(h_factor * LV_IMG_ZOOM_NONE));
+    // Title icon, draw a copy scaled to the size if the image cache has room for it, otherwise zoom the image
+    esp_brookesia_core_image_cache_release(_title_icon_scaled);
+    _title_icon_scaled = esp_brookesia_core_image_cache_get_fit(
+                             (const lv_img_dsc_t *)_conf.icon_image_resource, _data.title.icon_size.width,
+                             _data.title.icon_size.height
+                         );
+    if (_title_icon_scaled != nullptr) {
+        lv_img_set_src(_title_icon.get(), _title_icon_scaled);
+        lv_img_set_zoom(_title_icon.get(), LV_IMG_ZOOM_NONE);
     } else {
-        lv_img_set_zoom(_title_icon.get(), (int)(w_factor * LV_IMG_ZOOM_NONE));
+        h_factor = (float)(_data.title.icon_size.height) / ((const lv_img_dsc_t *)_conf.icon_image_resource)->header.h;
+        w_factor = (float)(_data.title.icon_size.width) / ((const lv_img_dsc_t *)_conf.icon_image_resource)->header.w;
+        lv_img_set_src(_title_icon.get(), _conf.icon_image_resource);
+        if (h_factor < w_factor) {
+            lv_img_set_zoom(_title_icon.get(), (int)(h_factor * LV_IMG_ZOOM_NONE));
+        } else {
+            lv_img_set_zoom(_title_icon.get(), (int)(w_factor * LV_IMG_ZOOM_NONE));
+        }
     }
     lv_obj_refr_size(_title_icon.get());
     // Title label
     lv_obj_set_style_text_font(_title_label.get(), (lv_font_t *)_data.title.text_font.font_resource, 0);
-    lv_obj_set_style_text_color(_title_label.get(), lv_color_hex(_data.title.text_color.color), 0);
-    lv_obj_set_style_text_opa(_title_label.get(), _data.title.text_color.opacity, 0);
+    if (_title_style == nullptr) {
+        lv_obj_set_style_text_color(_title_label.get(), lv_color_hex(_data.title.text_color.color), 0);
+        lv_obj_set_style_text_opa(_title_label.get(), _data.title.text_color.opacity, 0);
+    }
     // Snapshot
     lv_obj_set_size(_snapshot_obj.get(), _data.image.main_size.width, _data.image.main_size.height);
     lv_obj_set_style_radius(_snapshot_obj.get(), _data.image.radius, 0);
-    // Snapshot image
+    // Snapshot image, draw the pre-rendered card if there is room for it, otherwise zoom and clip the snapshot
+    if ((_conf.snapshot_image_resource != _conf.icon_image_resource) && ESP_BROOKESIA_MEMORY_RECENTS_SCREEN_CARD &&
+            updateSnapshotCard()) {
+        lv_obj_set_style_clip_corner(_snapshot_obj.get(), false, 0);
+        lv_img_set_zoom(_snapshot_image.get(), LV_IMG_ZOOM_NONE);
+        lv_obj_align(_snapshot_image.get(), LV_ALIGN_TOP_MID, 0, 0);
+        lv_img_set_src(_snapshot_image.get(), _snapshot_card);
+
+        return true;
+    }
+    lv_obj_set_style_clip_corner(_snapshot_obj.get(), true, 0);
     if (_conf.snapshot_image_resource != _conf.icon_image_resource) {
         h_factor = (float)(_data.image.main_size.height) / ((const lv_img_dsc_t *)_conf.snapshot_image_resource)->header.h;
         w_factor = (float)(_data.image.main_size.width) / ((const lv_img_dsc_t *)_conf.snapshot_image_resource)->header.w;
@@ -206,3 +240,28 @@ bool ESP_Brookesia_RecentsScreenSnapshot::updateByNewData(void)
 
     return true;
 }
+
+bool ESP_Brookesia_RecentsScreenSnapshot::updateSnapshotCard(void)
+{
+    uint16_t width = _data.image.main_size.width;
+    uint16_t height = _data.image.main_size.height;
+
+    if ((_snapshot_card != nullptr) && ((_snapshot_card->header.w != width) || (_snapshot_card->header.h != height))) {
+        esp_brookesia_core_image_card_del(_snapshot_card);
+        _snapshot_card = nullptr;
+    }
+    if (_snapshot_card == nullptr) {
+        _snapshot_card = esp_brookesia_core_image_card_create(width, height);
+        ESP_BROOKESIA_CHECK_NULL_RETURN(_snapshot_card, false, "Create snapshot card failed");
+    }
+
+    if (!esp_brookesia_core_image_card_render(_snapshot_card, (const lv_img_dsc_t *)_conf.snapshot_image_resource,
+            _data.image.radius)) {
+        ESP_BROOKESIA_LOGE("Render snapshot card failed");
+        esp_brookesia_core_image_card_del(_snapshot_card);
+        _snapshot_card = nullptr;
+        return false;
+    }
+
+    return true;
+}
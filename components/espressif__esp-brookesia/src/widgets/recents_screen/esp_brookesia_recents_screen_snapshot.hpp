@@ -13,7 +13,7 @@
 class ESP_Brookesia_RecentsScreenSnapshot {
 public:
     ESP_Brookesia_RecentsScreenSnapshot(const ESP_Brookesia_Core &core, const ESP_Brookesia_RecentsScreenSnapshotConf_t &conf,
-                                 const ESP_Brookesia_RecentsScreenSnapshotData_t &data);
+                                 const ESP_Brookesia_RecentsScreenSnapshotData_t &data, lv_style_t *title_style = nullptr);
     ~ESP_Brookesia_RecentsScreenSnapshot();
 
     bool begin(lv_obj_t *parent);
@@ -28,17 +28,22 @@ public:
     bool updateByNewData(void);
 
 private:
+    bool updateSnapshotCard(void);
+
     const ESP_Brookesia_Core &_core;
     const ESP_Brookesia_RecentsScreenSnapshotConf_t &_conf;
     const ESP_Brookesia_RecentsScreenSnapshotData_t &_data;
+    lv_style_t *_title_style;   // Text color shared by the titles of all snapshots, owned by the recents screen
 
     int _origin_y;
     ESP_Brookesia_LvObj_t _main_obj;
     ESP_Brookesia_LvObj_t _drag_obj;
     ESP_Brookesia_LvObj_t _title_obj;
     ESP_Brookesia_LvObj_t _title_icon;
+    const lv_img_dsc_t *_title_icon_scaled;
     ESP_Brookesia_LvObj_t _title_label;
     ESP_Brookesia_LvObj_t _snapshot_obj;
     ESP_Brookesia_LvObj_t _snapshot_image;
+    lv_img_dsc_t *_snapshot_card;   // Snapshot pre-rendered at the image size with the corners baked in
 };
 // *INDENT-OFF*
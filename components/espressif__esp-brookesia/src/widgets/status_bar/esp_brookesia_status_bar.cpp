@@ -5,6 +5,8 @@
  */
 #include <limits>
 #include <memory>
+#include <time.h>
+#include <sys/time.h>
 #include "core/esp_brookesia_core.hpp"
 #include "esp_brookesia_status_bar.hpp"
 
@@ -13,6 +15,9 @@
 #define ESP_BROOKESIA_LOGD(...)
 #endif
 
+// Wake up a little after the minute boundary, so the new minute is always read
+#define CLOCK_MINUTE_MARGIN_MS      (20)
+
 using namespace std;
 
 ESP_Brookesia_StatusBar::ESP_Brookesia_StatusBar(const ESP_Brookesia_Core &core, const ESP_Brookesia_StatusBarData_t &data, int battery_id,
@@ -23,18 +28,22 @@ ESP_Brookesia_StatusBar::ESP_Brookesia_StatusBar(const ESP_Brookesia_Core &core,
     _battery_id(battery_id),
     _is_battery_initialed(false),
     _battery_state(-1),
+    _battery_percent(-1),
     _is_battery_lable_out_of_area(false),
     _battery_label(nullptr),
     _wifi_id(wifi_id),
     _clock_hour(-1),
     _clock_min(-1),
+    _clock_is_pm(-1),
     _is_clock_out_of_area(false),
     _clock_obj(nullptr),
     _clock_hour_label(nullptr),
     _clock_dot_label(nullptr),
     _clock_min_label(nullptr),
-    _clock_period_label(nullptr)
+    _clock_period_label(nullptr),
+    _clock_timer(nullptr)
 {
+    lv_style_init(&_text_style);
 }
 
 ESP_Brookesia_StatusBar::~ESP_Brookesia_StatusBar()
@@ -55,6 +64,7 @@ bool ESP_Brookesia_StatusBar::begin(lv_obj_t *parent)
     ESP_BROOKESIA_CHECK_FALSE_GOTO(beginWifi(), err, "Begin wifi failed");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(beginBattery(), err, "Begin battery failed");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(beginClock(), err, "Begin clock failed");
+    ESP_BROOKESIA_CHECK_FALSE_GOTO(updateThemeByNewData(), err, "Update theme failed");
 
     ESP_BROOKESIA_CHECK_FALSE_RETURN(_core.registerDateUpdateEventCallback(onDataUpdateEventCallback, this), false,
                                      "Register data update event callback failed");
@@ -96,6 +106,7 @@ bool ESP_Brookesia_StatusBar::del(void)
     }
 
     _id_icon_map.clear();
+    lv_style_reset(&_text_style);
 
     return ret;
 }
@@ -105,6 +116,11 @@ bool ESP_Brookesia_StatusBar::setVisualMode(ESP_Brookesia_StatusBarVisualMode_t
     ESP_BROOKESIA_LOGD("Set Visual Mode(%d)", mode);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkMainInitialized(), false, "Not initialized");
 
+    // Changing the hidden flag invalidates the bar and its layout even if it is already set
+    if (lv_obj_has_flag(_main_obj.get(), LV_OBJ_FLAG_HIDDEN) == (mode == ESP_BROOKESIA_STATUS_BAR_VISUAL_MODE_HIDE)) {
+        return true;
+    }
+
     switch (mode) {
     case ESP_BROOKESIA_STATUS_BAR_VISUAL_MODE_HIDE:
         lv_obj_add_flag(_main_obj.get(), LV_OBJ_FLAG_HIDDEN);
@@ -293,6 +309,7 @@ bool ESP_Brookesia_StatusBar::beginMain(lv_obj_t *parent)
     /* Setup objects style */
     // Main
     lv_obj_add_style(main_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(main_obj.get(), &_text_style, 0);
     lv_obj_set_align(main_obj.get(), LV_ALIGN_TOP_MID);
     lv_obj_set_style_bg_opa(main_obj.get(), LV_OPA_COVER, 0);
     lv_obj_clear_flag(main_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
@@ -339,10 +356,6 @@ bool ESP_Brookesia_StatusBar::updateMainByNewData(void)
 
     lv_obj_set_size(_main_obj.get(), _data.main.size.width, _data.main.size.height);
     lv_obj_set_style_text_font(_main_obj.get(), (lv_font_t *)_data.main.text_font.font_resource, 0);
-    lv_obj_set_style_text_color(_main_obj.get(), lv_color_hex(_data.main.text_color.color), 0);
-    lv_obj_set_style_text_opa(_main_obj.get(), _data.main.text_color.opacity, 0);
-    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
-    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
 
     lv_flex_align_t main_align = LV_FLEX_ALIGN_START;
     for (size_t i = 0; i < _area_objs.size(); i++) {
@@ -370,6 +383,28 @@ bool ESP_Brookesia_StatusBar::updateMainByNewData(void)
     return true;
 }
 
+bool ESP_Brookesia_StatusBar::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkMainInitialized(), false, "Not initialized");
+
+    // Text, the labels share the style, so it is changed in place and refreshed once
+    lv_style_set_text_color(&_text_style, lv_color_hex(_data.main.text_color.color));
+    lv_style_set_text_opa(&_text_style, _data.main.text_color.opacity);
+    lv_obj_report_style_change(&_text_style);
+    // Background
+    lv_obj_set_style_bg_color(_main_obj.get(), lv_color_hex(_data.main.background_color.color), 0);
+    lv_obj_set_style_bg_opa(_main_obj.get(), _data.main.background_color.opacity, 0);
+    // Icon
+    for (auto &icon : _id_icon_map) {
+        if (!icon.second->updateThemeByNewData()) {
+            ESP_BROOKESIA_LOGE("Update icon(%d) theme failed", icon.first);
+        }
+    }
+
+    return true;
+}
+
 bool ESP_Brookesia_StatusBar::delMain(void)
 {
     ESP_BROOKESIA_LOGD("Delete main(0x%p)", this);
@@ -396,7 +431,9 @@ bool ESP_Brookesia_StatusBar::beginBattery(void)
         ESP_BROOKESIA_CHECK_NULL_RETURN(battery_label, false, "Create battery label failed");
 
         lv_obj_add_style(battery_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+        lv_obj_add_style(battery_label.get(), &_text_style, 0);
         _battery_label = battery_label;
+        _battery_percent = -1;
     }
     if (_data.flags.enable_battery_icon) {
         ESP_BROOKESIA_CHECK_FALSE_RETURN(addIcon(_data.battery.icon_data, _data.battery.area_index, _battery_id), false,
@@ -431,9 +468,6 @@ bool ESP_Brookesia_StatusBar::updateBatteryByNewData(void)
             _is_battery_lable_out_of_area = true;
             lv_obj_add_flag(_battery_label.get(), LV_OBJ_FLAG_HIDDEN);
             ESP_BROOKESIA_LOGE("Battery label out of area, hide it");
-        } else {
-            lv_obj_set_style_text_color(_battery_label.get(), lv_color_hex(_data.main.text_color.color), 0);
-            lv_obj_set_style_text_opa(_battery_label.get(), _data.main.text_color.opacity, 0);
         }
     }
 
@@ -462,8 +496,10 @@ bool ESP_Brookesia_StatusBar::setBatteryPercent(bool charge_flag, int percent) c
     ESP_BROOKESIA_LOGD("Set battery percent(0x%p: %d%%)", this, percent);
 
     percent = max(min(percent, 100), 1);
-    if (_data.flags.enable_battery_label && (_battery_label != nullptr)) {
+    // Reformatting the label invalidates it, so skip it while the percent is unchanged
+    if (_data.flags.enable_battery_label && (_battery_label != nullptr) && (percent != _battery_percent)) {
         lv_label_set_text_fmt(_battery_label.get(), "%d%%", percent);
+        _battery_percent = percent;
     }
 
     if (_data.flags.enable_battery_icon) {
@@ -566,19 +602,23 @@ bool ESP_Brookesia_StatusBar::beginClock(void)
     clock_hour_label = ESP_BROOKESIA_LV_OBJ(label, clock_obj.get());
     ESP_BROOKESIA_CHECK_NULL_RETURN(clock_hour_label, false, "Alloc clock hour label failed");
     lv_obj_add_style(clock_hour_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(clock_hour_label.get(), &_text_style, 0);
 
     clock_dot_label = ESP_BROOKESIA_LV_OBJ(label, clock_obj.get());
     ESP_BROOKESIA_CHECK_NULL_RETURN(clock_dot_label, false, "Alloc clock dot label failed");
     lv_obj_add_style(clock_dot_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(clock_dot_label.get(), &_text_style, 0);
     lv_label_set_text(clock_dot_label.get(), ":");
 
     clock_min_label = ESP_BROOKESIA_LV_OBJ(label, clock_obj.get());
     ESP_BROOKESIA_CHECK_NULL_RETURN(clock_min_label, false, "Alloc clock min label failed");
     lv_obj_add_style(clock_min_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(clock_min_label.get(), &_text_style, 0);
 
     clock_period_label = ESP_BROOKESIA_LV_OBJ(label, clock_obj.get());
     ESP_BROOKESIA_CHECK_NULL_RETURN(clock_period_label, false, "Alloc clock period label failed");
     lv_obj_add_style(clock_period_label.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_add_style(clock_period_label.get(), &_text_style, 0);
 
     // Setup objects style
     lv_obj_add_style(clock_obj.get(), _core.getCoreHome().getCoreContainerStyle(), 0);
@@ -597,6 +637,11 @@ bool ESP_Brookesia_StatusBar::beginClock(void)
     ESP_BROOKESIA_CHECK_FALSE_GOTO(updateClockByNewData(), err, "Update clock style failed");
     ESP_BROOKESIA_CHECK_FALSE_GOTO(setClock(0, 0, false), err, "Set clock failed");
 
+    // The clock follows the system time by itself, the timer is rescheduled to the next minute on every update
+    _clock_timer = ESP_BROOKESIA_LV_TIMER(onClockTimerCallback, 60 * 1000, this);
+    ESP_BROOKESIA_CHECK_NULL_GOTO(_clock_timer, err, "Create clock timer failed");
+    ESP_BROOKESIA_CHECK_FALSE_GOTO(refreshClock(), err, "Refresh clock failed");
+
     return true;
 
 err:
@@ -618,15 +663,6 @@ bool ESP_Brookesia_StatusBar::updateClockByNewData(void)
         _is_clock_out_of_area = true;
         lv_obj_add_flag(_clock_obj.get(), LV_OBJ_FLAG_HIDDEN);
         ESP_BROOKESIA_LOGE("Clock out of area, hide it");
-    } else {
-        lv_obj_set_style_text_color(_clock_hour_label.get(), lv_color_hex(_data.main.text_color.color), 0);
-        lv_obj_set_style_text_opa(_clock_hour_label.get(), _data.main.text_color.opacity, 0);
-        lv_obj_set_style_text_color(_clock_min_label.get(), lv_color_hex(_data.main.text_color.color), 0);
-        lv_obj_set_style_text_opa(_clock_min_label.get(), _data.main.text_color.opacity, 0);
-        lv_obj_set_style_text_color(_clock_dot_label.get(), lv_color_hex(_data.main.text_color.color), 0);
-        lv_obj_set_style_text_opa(_clock_dot_label.get(), _data.main.text_color.opacity, 0);
-        lv_obj_set_style_text_color(_clock_period_label.get(), lv_color_hex(_data.main.text_color.color), 0);
-        lv_obj_set_style_text_opa(_clock_period_label.get(), _data.main.text_color.opacity, 0);
     }
 
     return true;
@@ -640,6 +676,7 @@ bool ESP_Brookesia_StatusBar::delClock(void)
         return true;
     }
 
+    _clock_timer.reset();
     _clock_obj.reset();
     _clock_hour_label.reset();
     _clock_dot_label.reset();
@@ -685,7 +722,36 @@ bool ESP_Brookesia_StatusBar::setClock(int hour, int minute, bool is_pm) const
         _clock_min = minute;
         lv_label_set_text_fmt(_clock_min_label.get(), "%02d", minute);
     }
-    lv_label_set_text(_clock_period_label.get(), is_pm ? " PM " : " AM ");
+    if (_clock_is_pm != (int)is_pm) {
+        _clock_is_pm = is_pm;
+        lv_label_set_text(_clock_period_label.get(), is_pm ? " PM " : " AM ");
+    }
+
+    return true;
+}
+
+bool ESP_Brookesia_StatusBar::refreshClock(void) const
+{
+    struct timeval now = {};
+    struct tm timeinfo = {};
+    time_t now_sec = 0;
+    int32_t next_update_ms = 0;
+
+    ESP_BROOKESIA_LOGD("Refresh clock(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkClockInitialized(), false, "Not initialized");
+
+    gettimeofday(&now, nullptr);
+    now_sec = now.tv_sec;
+    localtime_r(&now_sec, &timeinfo);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(setClock(timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_hour >= 12), false,
+                                     "Set clock failed");
+
+    if (_clock_timer != nullptr) {
+        next_update_ms = (60 - timeinfo.tm_sec) * 1000 - now.tv_usec / 1000;
+        next_update_ms = max(next_update_ms, (int32_t)0) + CLOCK_MINUTE_MARGIN_MS;
+        lv_timer_set_period(_clock_timer.get(), next_update_ms);
+        lv_timer_reset(_clock_timer.get());
+    }
 
     return true;
 }
@@ -700,6 +766,11 @@ void ESP_Brookesia_StatusBar::onDataUpdateEventCallback(lv_event_t *event)
     status_bar = (ESP_Brookesia_StatusBar *)lv_event_get_user_data(event);
     ESP_BROOKESIA_CHECK_NULL_EXIT(status_bar, "Invalid status bar object");
 
+    if (ESP_Brookesia_Core::checkThemeUpdateEvent(event)) {
+        ESP_BROOKESIA_CHECK_FALSE_EXIT(status_bar->updateThemeByNewData(), "Update theme failed");
+        return;
+    }
+
     // Main
     ESP_BROOKESIA_CHECK_FALSE_EXIT(status_bar->updateMainByNewData(), "Update main object style failed");
     for (auto &icon : status_bar->_id_icon_map) {
@@ -715,4 +786,18 @@ void ESP_Brookesia_StatusBar::onDataUpdateEventCallback(lv_event_t *event)
     if (status_bar->checkClockInitialized() && !status_bar->updateClockByNewData()) {
         ESP_BROOKESIA_LOGE("Update clock object style failed");
     }
+    // Theme
+    ESP_BROOKESIA_CHECK_FALSE_EXIT(status_bar->updateThemeByNewData(), "Update theme failed");
+}
+
+void ESP_Brookesia_StatusBar::onClockTimerCallback(lv_timer_t *timer)
+{
+    ESP_Brookesia_StatusBar *status_bar = nullptr;
+
+    ESP_BROOKESIA_CHECK_NULL_EXIT(timer, "Invalid timer");
+
+    status_bar = (ESP_Brookesia_StatusBar *)timer->user_data;
+    ESP_BROOKESIA_CHECK_NULL_EXIT(status_bar, "Invalid status bar");
+
+    ESP_BROOKESIA_CHECK_FALSE_EXIT(status_bar->refreshClock(), "Refresh clock failed");
 }
@@ -50,6 +50,7 @@ public:
     // Clock
     bool setClockFormat(ClockFormat format) const;
     bool setClock(int hour, int min, bool is_pm) const;
+    bool refreshClock(void) const;
 
     bool checkVisible(void) const;
 
@@ -63,6 +64,7 @@ private:
     bool updateMainByNewData(void);
     bool delMain(void);
     bool checkMainInitialized(void) const    { return (_main_obj != nullptr); }
+    bool updateThemeByNewData(void);
 
     bool beginBattery(void);
     bool updateBatteryByNewData(void);
@@ -76,8 +78,8 @@ private:
     bool delClock(void);
     bool checkClockInitialized(void) const   { return (_clock_obj != nullptr); }
 
-
     static void onDataUpdateEventCallback(lv_event_t *event);
+    static void onClockTimerCallback(lv_timer_t *timer);
 
     // Core
     const ESP_Brookesia_Core &_core;
@@ -85,11 +87,13 @@ private:
     // Main
     ESP_Brookesia_LvObj_t _main_obj;
     std::vector<ESP_Brookesia_LvObj_t> _area_objs;
+    lv_style_t _text_style;     // Shared by the main object and the labels
     std::map <int, std::shared_ptr<ESP_Brookesia_StatusBarIcon>> _id_icon_map;
     // Battery
     int _battery_id;
     bool _is_battery_initialed;
     mutable int _battery_state;
+    mutable int _battery_percent;   // Shown by the label, -1 before the first update
     bool _is_battery_lable_out_of_area;
     ESP_Brookesia_LvObj_t _battery_label;
     // Wifi
@@ -97,11 +101,13 @@ private:
     // Clock
     mutable int _clock_hour;
     mutable int _clock_min;
+    mutable int _clock_is_pm;
     bool _is_clock_out_of_area;
     ESP_Brookesia_LvObj_t _clock_obj;
     ESP_Brookesia_LvObj_t _clock_hour_label;
     ESP_Brookesia_LvObj_t _clock_dot_label;
     ESP_Brookesia_LvObj_t _clock_min_label;
     ESP_Brookesia_LvObj_t _clock_period_label;
+    ESP_Brookesia_LvTimer_t _clock_timer;
 };
 // *INDENT-OFF*
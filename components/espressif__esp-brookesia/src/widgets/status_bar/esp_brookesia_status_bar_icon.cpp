@@ -4,7 +4,10 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <memory>
+#include <string.h>
 #include "core/esp_brookesia_core.hpp"
+#include "core/esp_brookesia_core_image_cache.h"
+#include "core/esp_brookesia_core_image_card.h"
 #include "esp_brookesia_status_bar_icon.hpp"
 
 #if !ESP_BROOKESIA_LOG_ENABLE_DEBUG_WIDGETS_STATUS_BAR
@@ -12,13 +15,18 @@
 #define ESP_BROOKESIA_LOGD(...)
 #endif
 
+// Width field of `lv_img_header_t` is 11 bits
+#define ATLAS_WIDTH_MAX     (2047)
+
 using namespace std;
 
 ESP_Brookesia_StatusBarIcon::ESP_Brookesia_StatusBarIcon(const ESP_Brookesia_StatusBarIconData_t &data):
     _data(data),
     _is_out_of_parent(false),
     _current_state(0),
-    _main_obj(nullptr)
+    _main_obj(nullptr),
+    _image_obj(nullptr),
+    _atlas(nullptr)
 {
 }
 
@@ -34,40 +42,32 @@ bool ESP_Brookesia_StatusBarIcon::begin(const ESP_Brookesia_Core &core, lv_obj_t
 {
     ESP_Brookesia_LvObj_t main_obj = nullptr;
     ESP_Brookesia_LvObj_t image_obj = nullptr;
-    vector<ESP_Brookesia_LvObj_t> image_objs;
 
     ESP_BROOKESIA_LOGD("Begin(@0x%p)", this);
     ESP_BROOKESIA_CHECK_NULL_RETURN(parent, false, "Invalid parent");
     ESP_BROOKESIA_CHECK_FALSE_RETURN(!checkInitialized(), false, "Icon is already initialized");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(_data.icon.image_num > 0, false, "Invalid image number");
 
     /* Create objects */
     // Main
     main_obj = ESP_BROOKESIA_LV_OBJ(obj, parent);
     ESP_BROOKESIA_CHECK_NULL_RETURN(main_obj, false, "Create main object failed");
-    // Image
-    for (int i = 0; i < _data.icon.image_num; i++) {
-        image_obj = ESP_BROOKESIA_LV_OBJ(img, main_obj.get());
-        ESP_BROOKESIA_CHECK_NULL_RETURN(image_obj, false, "Create icon image[%d] failed", i);
-        image_objs.push_back(image_obj);
-    }
+    // Image, one for all the states
+    image_obj = ESP_BROOKESIA_LV_OBJ(img, main_obj.get());
+    ESP_BROOKESIA_CHECK_NULL_RETURN(image_obj, false, "Create icon image failed");
 
     /* Setup objects style */
     // Main
     lv_obj_add_style(main_obj.get(), core.getCoreHome().getCoreContainerStyle(), 0);
     lv_obj_clear_flag(main_obj.get(), LV_OBJ_FLAG_SCROLLABLE);
     // Image
-    for (auto &image_obj_tmp : image_objs) {
-        lv_obj_add_style(image_obj_tmp.get(), core.getCoreHome().getCoreContainerStyle(), 0);
-        lv_obj_align(image_obj_tmp.get(), LV_ALIGN_CENTER, 0, 0);
-        lv_obj_set_size(image_obj_tmp.get(), LV_SIZE_CONTENT, LV_SIZE_CONTENT);
-        lv_img_set_size_mode(image_obj_tmp.get(), LV_IMG_SIZE_MODE_REAL);
-        lv_obj_add_flag(image_obj_tmp.get(), LV_OBJ_FLAG_HIDDEN);
-    }
-    lv_obj_clear_flag(image_objs[0].get(), LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_style(image_obj.get(), core.getCoreHome().getCoreContainerStyle(), 0);
+    lv_obj_align(image_obj.get(), LV_ALIGN_CENTER, 0, 0);
+    lv_img_set_size_mode(image_obj.get(), LV_IMG_SIZE_MODE_REAL);
 
     // Save objects
     _main_obj = main_obj;
-    _image_objs = image_objs;
+    _image_obj = image_obj;
 
     // Update style
     ESP_BROOKESIA_CHECK_FALSE_GOTO(updateByNewData(), err, "Update failed");
@@ -89,18 +89,17 @@ bool ESP_Brookesia_StatusBarIcon::del(void)
     }
 
     _main_obj.reset();
-    _image_objs.clear();
+    _image_obj.reset();
+    esp_brookesia_core_image_card_del(_atlas);
+    _atlas = nullptr;
 
     return true;
 }
 
 bool ESP_Brookesia_StatusBarIcon::setCurrentState(int state)
 {
-    uint8_t image_resource_num = _image_objs.size();
-    lv_obj_t *img_obj = nullptr;
-
     ESP_BROOKESIA_LOGD("Set state(%d)", state);
-    ESP_BROOKESIA_CHECK_FALSE_RETURN(state < image_resource_num, false, "Invalid state(%d)", state);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(state < _data.icon.image_num, false, "Invalid state(%d)", state);
     ESP_BROOKESIA_CHECK_NULL_RETURN(_main_obj, false, "Invalid main object");
 
     if (state == _current_state) {
@@ -109,34 +108,22 @@ bool ESP_Brookesia_StatusBarIcon::setCurrentState(int state)
 
     if (state < 0) {
         lv_obj_add_flag(_main_obj.get(), LV_OBJ_FLAG_HIDDEN);
-        goto end;
-    } else if (_current_state < 0) {
+        _current_state = state;
+        return true;
+    } else if ((_current_state < 0) && !_is_out_of_parent) {
         lv_obj_clear_flag(_main_obj.get(), LV_OBJ_FLAG_HIDDEN);
     }
-
-    for (int i = 0; i < image_resource_num; i++) {
-        img_obj = _image_objs[i].get();
-        if (i == state) {
-            lv_obj_clear_flag(img_obj, LV_OBJ_FLAG_HIDDEN);
-        } else {
-            lv_obj_add_flag(img_obj, LV_OBJ_FLAG_HIDDEN);
-        }
-    }
-
-end:
     _current_state = state;
 
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateImage(), false, "Update image failed");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateImageRecolor(), false, "Update image recolor failed");
+
     return true;
 }
 
 bool ESP_Brookesia_StatusBarIcon::updateByNewData(void)
 {
-    int image_resource_num = _image_objs.size();
-    float h_factor = 0;
-    float w_factor = 0;
-    const lv_img_dsc_t *img_dsc = nullptr;
     ESP_Brookesia_LvObj_t main_obj = _main_obj;
-    ESP_Brookesia_LvObj_t image_obj = nullptr;
 
     ESP_BROOKESIA_LOGD("Update(0x%p)", this);
     ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Icon is not initialized");
@@ -153,25 +140,137 @@ bool ESP_Brookesia_StatusBarIcon::updateByNewData(void)
         ESP_BROOKESIA_LOGW("Icon out of area, hide it");
     }
 
-    // Update the size of the image object
-    for (int i = 0; i < image_resource_num; i++) {
-        img_dsc = (const lv_img_dsc_t *)_data.icon.images[i].resource;
-        image_obj = _image_objs[i];
-        lv_img_set_src(image_obj.get(), img_dsc);
-        lv_obj_set_style_img_recolor(image_obj.get(), lv_color_hex(_data.icon.images[i].recolor.color), 0);
-        lv_obj_set_style_img_recolor_opa(image_obj.get(), _data.icon.images[i].recolor.opacity, 0);
-        // Calculate the multiple of the size between the target and the image.
-        h_factor = (float)(_data.size.height) / img_dsc->header.h;
-        w_factor = (float)(_data.size.width) / img_dsc->header.w;
-        // Scale the image to a suitable size.
-        // So you don’t have to consider the size of the source image.
-        if (h_factor < w_factor) {
-            lv_img_set_zoom(image_obj.get(), (int)(h_factor * LV_IMG_ZOOM_NONE));
-        } else {
-            lv_img_set_zoom(image_obj.get(), (int)(w_factor * LV_IMG_ZOOM_NONE));
+    // Rebuild the atlas for the new size, the image object zooms the state images if it can't be built
+    if (!updateAtlas()) {
+        ESP_BROOKESIA_LOGD("No atlas, zoom the state images");
+    }
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateImage(), false, "Update image failed");
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateThemeByNewData(), false, "Update theme failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_StatusBarIcon::updateThemeByNewData(void)
+{
+    ESP_BROOKESIA_LOGD("Update theme(0x%p)", this);
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(checkInitialized(), false, "Icon is not initialized");
+
+    ESP_BROOKESIA_CHECK_FALSE_RETURN(updateImageRecolor(), false, "Update image recolor failed");
+
+    return true;
+}
+
+bool ESP_Brookesia_StatusBarIcon::updateAtlas(void)
+{
+    int cell_w = _data.size.width;
+    int cell_h = _data.size.height;
+    int image_num = _data.icon.image_num;
+    int dst_x = 0;
+    int dst_y = 0;
+    bool has_alpha = false;
+    const uint8_t *src_px = nullptr;
+    uint8_t *dst_px = nullptr;
+    const lv_img_dsc_t *src_dsc = nullptr;
+    const lv_img_dsc_t *fit_dsc = nullptr;
+    lv_img_dsc_t *atlas = nullptr;
+
+    if ((_atlas != nullptr) && (_atlas->header.w == cell_w * image_num) && (_atlas->header.h == cell_h)) {
+        return true;
+    }
+    // The image object may still draw the old atlas
+    if (_atlas != nullptr) {
+        lv_img_set_src(_image_obj.get(), nullptr);
+        esp_brookesia_core_image_card_del(_atlas);
+        _atlas = nullptr;
+    }
+    if ((cell_w <= 0) || (cell_h <= 0) || (cell_w * image_num > ATLAS_WIDTH_MAX)) {
+        return false;
+    }
+
+    atlas = esp_brookesia_core_image_card_create(cell_w * image_num, cell_h);
+    ESP_BROOKESIA_CHECK_NULL_RETURN(atlas, false, "Create atlas failed");
+
+    // Scale every state image to fit its cell and copy it to the middle of the cell, the rest stays transparent
+    for (int i = 0; i < image_num; i++) {
+        src_dsc = (const lv_img_dsc_t *)_data.icon.images[i].resource;
+        fit_dsc = esp_brookesia_core_image_cache_get_fit(src_dsc, cell_w, cell_h);
+        if (fit_dsc == nullptr) {
+            esp_brookesia_core_image_card_del(atlas);
+            return false;
+        }
+
+        has_alpha = (fit_dsc->header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA);
+        dst_x = i * cell_w + (cell_w - (int)fit_dsc->header.w) / 2;
+        dst_y = (cell_h - (int)fit_dsc->header.h) / 2;
+        for (int y = 0; y < (int)fit_dsc->header.h; y++) {
+            src_px = fit_dsc->data + y * fit_dsc->header.w * (has_alpha ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t));
+            dst_px = (uint8_t *)atlas->data + ((dst_y + y) * atlas->header.w + dst_x) * LV_IMG_PX_SIZE_ALPHA_BYTE;
+            if (has_alpha) {
+                memcpy(dst_px, src_px, fit_dsc->header.w * LV_IMG_PX_SIZE_ALPHA_BYTE);
+                continue;
+            }
+            for (int x = 0; x < (int)fit_dsc->header.w; x++) {
+                memcpy(dst_px, src_px, sizeof(lv_color_t));
+                dst_px[sizeof(lv_color_t)] = LV_OPA_COVER;
+                src_px += sizeof(lv_color_t);
+                dst_px += LV_IMG_PX_SIZE_ALPHA_BYTE;
+            }
         }
-        lv_obj_refr_size(image_obj.get());
+        esp_brookesia_core_image_cache_release(fit_dsc);
     }
+    _atlas = atlas;
+
+    return true;
+}
+
+bool ESP_Brookesia_StatusBarIcon::updateImage(void)
+{
+    int state = (_current_state < 0) ? 0 : _current_state;
+    float h_factor = 0;
+    float w_factor = 0;
+    const lv_img_dsc_t *img_dsc = nullptr;
+    lv_obj_t *image_obj = _image_obj.get();
+
+    if (_atlas != nullptr) {
+        // The object is one cell, so it only shows the cell of the state at the offset
+        if (lv_img_get_src(image_obj) != _atlas) {
+            lv_img_set_src(image_obj, _atlas);
+            lv_img_set_zoom(image_obj, LV_IMG_ZOOM_NONE);
+            lv_obj_set_size(image_obj, _data.size.width, _data.size.height);
+        }
+        lv_img_set_offset_x(image_obj, -state * _data.size.width);
+
+        return true;
+    }
+
+    img_dsc = (const lv_img_dsc_t *)_data.icon.images[state].resource;
+    ESP_BROOKESIA_CHECK_NULL_RETURN(img_dsc, false, "Invalid image(%d)", state);
+    lv_obj_set_size(image_obj, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
+    lv_img_set_offset_x(image_obj, 0);
+    lv_img_set_src(image_obj, img_dsc);
+    // Calculate the multiple of the size between the target and the image.
+    h_factor = (float)(_data.size.height) / img_dsc->header.h;
+    w_factor = (float)(_data.size.width) / img_dsc->header.w;
+    // Scale the image to a suitable size.
+    // So you don’t have to consider the size of the source image.
+    if (h_factor < w_factor) {
+        lv_img_set_zoom(image_obj, (int)(h_factor * LV_IMG_ZOOM_NONE));
+    } else {
+        lv_img_set_zoom(image_obj, (int)(w_factor * LV_IMG_ZOOM_NONE));
+    }
+    lv_obj_refr_size(image_obj);
+
+    return true;
+}
+
+bool ESP_Brookesia_StatusBarIcon::updateImageRecolor(void)
+{
+    int state = (_current_state < 0) ? 0 : _current_state;
+
+    // The states share the image object, so the recolor of the state is applied to it, the local properties already
+    // exist and are changed in place
+    lv_obj_set_style_img_recolor(_image_obj.get(), lv_color_hex(_data.icon.images[state].recolor.color), 0);
+    lv_obj_set_style_img_recolor_opa(_image_obj.get(), _data.icon.images[state].recolor.opacity, 0);
 
     return true;
 }
@@ -5,8 +5,6 @@
  */
 #pragma once
 
-#include <vector>
-#include <map>
 #include "lvgl.h"
 #include "core/esp_brookesia_core.hpp"
 #include "esp_brookesia_status_bar_type.h"
@@ -24,13 +22,21 @@ public:
     bool checkInitialized(void) const { return (_main_obj != nullptr); }
 
     bool updateByNewData(void);
+    bool updateThemeByNewData(void);
 
 private:
+    bool updateAtlas(void);
+    bool updateImage(void);
+    bool updateImageRecolor(void);
+
     const ESP_Brookesia_StatusBarIconData_t &_data;
 
     bool _is_out_of_parent;
     int _current_state;
     ESP_Brookesia_LvObj_t _main_obj;
-    std::vector<ESP_Brookesia_LvObj_t> _image_objs;
+    ESP_Brookesia_LvObj_t _image_obj;
+    // All the state images scaled to the icon size side by side, the image object shows the cell of the state. If
+    // there is no room for it, the image object zooms the image of the state instead
+    lv_img_dsc_t *_atlas;
 };
 // *INDENT-OFF*
@@ -0,0 +1,266 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <inttypes.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "unity.h"
+#include "unity_test_runner.h"
+#include "lvgl.h"
+#include "esp_brookesia.hpp"
+#include "test_esp_brookesia_stylesheet.h"
+
+#define BENCH_CYCLE_TIMES                   (5)
+#define BENCH_DRAW_BUF_LINES                (40)
+// Bytes an app may keep per cycle once the first cycle warmed the caches up
+#define BENCH_LEAK_THRESHOLD                (64)
+
+static const char *TAG = "test_esp_brookesia_bench";
+
+/**
+ * @brief A synthetic app whose cost only depends on the number of widgets it creates
+ *
+ */
+class TestBenchApp: public ESP_Brookesia_PhoneApp {
+public:
+    TestBenchApp(const char *name, int widget_num):
+        ESP_Brookesia_PhoneApp(name, &esp_brookesia_image_large_app_launcher_default_112_112, true),
+        _widget_num(widget_num)
+    {
+    }
+
+protected:
+    bool run(void) override
+    {
+        lv_obj_t *screen = lv_scr_act();
+
+        lv_obj_set_flex_flow(screen, LV_FLEX_FLOW_ROW_WRAP);
+        for (int i = 0; i < _widget_num; i++) {
+            lv_obj_t *button = lv_btn_create(screen);
+            ESP_BROOKESIA_CHECK_NULL_RETURN(button, false, "Create button(%d) failed", i);
+            lv_obj_t *label = lv_label_create(button);
+            ESP_BROOKESIA_CHECK_NULL_RETURN(label, false, "Create label(%d) failed", i);
+            lv_label_set_text_fmt(label, "%d", i);
+        }
+
+        return true;
+    }
+
+    bool back(void) override
+    {
+        return notifyCoreClosed();
+    }
+
+private:
+    int _widget_num;
+};
+
+typedef struct {
+    int64_t launch_us;          /*!< Start event until `run()` returned */
+    int64_t first_frame_us;     /*!< Start event until the first frame of the app is rendered */
+    int64_t home_us;            /*!< Home event until the home screen is rendered, the snapshot included */
+    int64_t snapshot_us;        /*!< `saveAppSnapshot()` of the home event */
+    int64_t recents_us;         /*!< Recents screen event until it is rendered */
+    int64_t resume_us;          /*!< Recents screen hidden and the app resumed until it is rendered */
+    int64_t close_us;           /*!< Stop event until the home screen is rendered */
+    int peak_bytes;             /*!< Memory used at the peak of the cycle, compared to its start */
+    int delta_bytes;            /*!< Memory not given back at the end of the cycle */
+} test_bench_cycle_t;
+
+static lv_disp_draw_buf_t bench_draw_buf;
+static lv_color_t *bench_draw_buf_data = nullptr;
+
+static void bench_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    // Nothing to send, only the rendering of the framework is measured
+    lv_disp_flush_ready(drv);
+}
+
+static lv_disp_t *bench_lvgl_init(void)
+{
+    static lv_disp_drv_t disp_drv;
+    uint32_t buf_pixels = TEST_LVGL_RESOLUTION_WIDTH * BENCH_DRAW_BUF_LINES;
+
+    ESP_LOGI(TAG, "Initialize LVGL library");
+    lv_init();
+
+    bench_draw_buf_data = (lv_color_t *)heap_caps_malloc(buf_pixels * sizeof(lv_color_t), MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL_MESSAGE(bench_draw_buf_data, "Failed to allocate draw buffer");
+    lv_disp_draw_buf_init(&bench_draw_buf, bench_draw_buf_data, nullptr, buf_pixels);
+
+    ESP_LOGI(TAG, "Register display driver to LVGL(%dx%d)", TEST_LVGL_RESOLUTION_WIDTH, TEST_LVGL_RESOLUTION_HEIGHT);
+    lv_disp_drv_init(&disp_drv);
+    disp_drv.hor_res = TEST_LVGL_RESOLUTION_WIDTH;
+    disp_drv.ver_res = TEST_LVGL_RESOLUTION_HEIGHT;
+    disp_drv.flush_cb = bench_flush_cb;
+    disp_drv.draw_buf = &bench_draw_buf;
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv);
+    TEST_ASSERT_NOT_NULL_MESSAGE(disp, "Failed to register display driver to LVGL");
+
+    return disp;
+}
+
+static void bench_lvgl_deinit(void)
+{
+    ESP_LOGI(TAG, "Deinitialize LVGL library");
+    lv_deinit();
+    heap_caps_free(bench_draw_buf_data);
+    bench_draw_buf_data = nullptr;
+}
+
+// Heap and LVGL pool together, the objects of the apps live in the pool unless `LV_MEM_CUSTOM` is set
+static int bench_get_used_memory(void)
+{
+    int used = heap_caps_get_total_size(MALLOC_CAP_8BIT) - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#if !LV_MEM_CUSTOM
+    lv_mem_monitor_t monitor;
+    lv_mem_monitor(&monitor);
+    used += monitor.total_size - monitor.free_size;
+#endif
+    return used;
+}
+
+static int64_t bench_render(lv_disp_t *disp, int64_t start_us)
+{
+    lv_refr_now(disp);
+    return esp_timer_get_time() - start_us;
+}
+
+static void bench_run_cycle(ESP_Brookesia_Phone *phone, lv_disp_t *disp, int app_id, test_bench_cycle_t &cycle)
+{
+    ESP_Brookesia_CoreManager &manager = phone->getCoreManager();
+    ESP_Brookesia_CoreAppEventData_t app_event = {
+        .id = app_id,
+        .type = ESP_BROOKESIA_CORE_APP_EVENT_TYPE_START,
+        .data = nullptr,
+    };
+    int start_used = bench_get_used_memory();
+    int64_t start_us = 0;
+
+    start_us = esp_timer_get_time();
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendAppEvent(&app_event), "Failed to start app");
+    cycle.launch_us = esp_timer_get_time() - start_us;
+    cycle.first_frame_us = bench_render(disp, start_us);
+    TEST_ASSERT_NOT_NULL_MESSAGE(manager.getRunningAppById(app_id), "App is not running");
+    cycle.peak_bytes = bench_get_used_memory() - start_used;
+
+    start_us = esp_timer_get_time();
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_HOME), "Failed to go home");
+    cycle.home_us = bench_render(disp, start_us);
+    cycle.snapshot_us = manager.getLastAppSnapshotTimeUs();
+    cycle.peak_bytes = std::max(cycle.peak_bytes, bench_get_used_memory() - start_used);
+
+    start_us = esp_timer_get_time();
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_RECENTS_SCREEN),
+                             "Failed to show recents screen");
+    cycle.recents_us = bench_render(disp, start_us);
+    cycle.peak_bytes = std::max(cycle.peak_bytes, bench_get_used_memory() - start_used);
+
+    // As a tap on the snapshot, the recents screen is hidden before the app is started again
+    start_us = esp_timer_get_time();
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_BACK),
+                             "Failed to hide recents screen");
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendAppEvent(&app_event), "Failed to resume app");
+    cycle.resume_us = bench_render(disp, start_us);
+    TEST_ASSERT_TRUE_MESSAGE(manager.getActiveApp() == manager.getRunningAppById(app_id), "App is not resumed");
+    cycle.peak_bytes = std::max(cycle.peak_bytes, bench_get_used_memory() - start_used);
+
+    app_event.type = ESP_BROOKESIA_CORE_APP_EVENT_TYPE_STOP;
+    start_us = esp_timer_get_time();
+    TEST_ASSERT_TRUE_MESSAGE(phone->sendAppEvent(&app_event), "Failed to close app");
+    cycle.close_us = bench_render(disp, start_us);
+    TEST_ASSERT_NULL_MESSAGE(manager.getRunningAppById(app_id), "App is still running");
+
+    cycle.delta_bytes = bench_get_used_memory() - start_used;
+}
+
+static void bench_print_summary(const char *name, const test_bench_cycle_t *cycles, int num)
+{
+    test_bench_cycle_t avg = {};
+    test_bench_cycle_t max = {};
+
+    // The first cycle fills the caches of the framework, it is left out of the averages
+    for (int i = 1; i < num; i++) {
+        avg.first_frame_us += cycles[i].first_frame_us;
+        avg.snapshot_us += cycles[i].snapshot_us;
+        avg.resume_us += cycles[i].resume_us;
+        avg.close_us += cycles[i].close_us;
+        max.first_frame_us = std::max(max.first_frame_us, cycles[i].first_frame_us);
+        max.snapshot_us = std::max(max.snapshot_us, cycles[i].snapshot_us);
+        max.resume_us = std::max(max.resume_us, cycles[i].resume_us);
+        max.close_us = std::max(max.close_us, cycles[i].close_us);
+        max.peak_bytes = std::max(max.peak_bytes, cycles[i].peak_bytes);
+    }
+    ESP_LOGI(TAG, "%s: first frame %" PRId64 "/%" PRId64 " us, snapshot %" PRId64 "/%" PRId64 " us, resume %" PRId64
+             "/%" PRId64 " us, close %" PRId64 "/%" PRId64 " us (avg/max), peak %d bytes", name,
+             avg.first_frame_us / (num - 1), max.first_frame_us, avg.snapshot_us / (num - 1), max.snapshot_us,
+             avg.resume_us / (num - 1), max.resume_us, avg.close_us / (num - 1), max.close_us, max.peak_bytes);
+}
+
+TEST_CASE("test esp-brookesia app switch benchmark", "[esp-brookesia][phone][benchmark]")
+{
+    static_assert(BENCH_CYCLE_TIMES >= 2, "The first cycle is only a warm up");
+    const struct {
+        const char *name;
+        int widget_num;
+    } bench_apps[] = {
+        { "Bench Empty", 0 },
+        { "Bench Light", 16 },
+        { "Bench Heavy", 48 },
+    };
+    test_bench_cycle_t cycles[BENCH_CYCLE_TIMES] = {};
+    lv_disp_t *disp = bench_lvgl_init();
+    ESP_Brookesia_Phone *phone = new ESP_Brookesia_Phone(disp);
+    TEST_ASSERT_NOT_NULL_MESSAGE(phone, "Failed to create phone");
+
+#ifdef TEST_ESP_BROOKESIA_PHONE_DARK_STYLESHEET
+    ESP_Brookesia_PhoneStylesheet_t *phone_stylesheet =
+        new ESP_Brookesia_PhoneStylesheet_t TEST_ESP_BROOKESIA_PHONE_DARK_STYLESHEET();
+    TEST_ASSERT_TRUE_MESSAGE(phone->addStylesheet(phone_stylesheet), "Failed to add phone stylesheet");
+    TEST_ASSERT_TRUE_MESSAGE(phone->activateStylesheet(phone_stylesheet), "Failed to active phone stylesheet");
+    delete phone_stylesheet;
+#endif
+    TEST_ASSERT_TRUE_MESSAGE(phone->begin(), "Failed to begin phone");
+    bench_render(disp, 0);
+
+    // One line per cycle, for the CI to collect
+    printf("BENCH_HEADER,resolution,app,cycle,launch_us,first_frame_us,home_us,snapshot_us,recents_us,resume_us,"
+           "close_us,peak_bytes,delta_bytes\n");
+    for (auto &bench_app : bench_apps) {
+        TestBenchApp *app = new TestBenchApp(bench_app.name, bench_app.widget_num);
+        TEST_ASSERT_NOT_NULL_MESSAGE(app, "Failed to create app");
+        int app_id = phone->installApp(app);
+        TEST_ASSERT_TRUE_MESSAGE(app_id >= 0, "Failed to install app");
+
+        int warm_used = 0;
+        for (int i = 0; i < BENCH_CYCLE_TIMES; i++) {
+            test_bench_cycle_t &cycle = cycles[i];
+            bench_run_cycle(phone, disp, app_id, cycle);
+            printf("BENCH,%dx%d,%s,%d,%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64
+                   ",%d,%d\n", TEST_LVGL_RESOLUTION_WIDTH, TEST_LVGL_RESOLUTION_HEIGHT, bench_app.name, i,
+                   cycle.launch_us, cycle.first_frame_us, cycle.home_us, cycle.snapshot_us, cycle.recents_us,
+                   cycle.resume_us, cycle.close_us, cycle.peak_bytes, cycle.delta_bytes);
+            if (i == 0) {
+                warm_used = bench_get_used_memory();
+            }
+        }
+        bench_print_summary(bench_app.name, cycles, BENCH_CYCLE_TIMES);
+
+        int leak_per_cycle = (bench_get_used_memory() - warm_used) / (BENCH_CYCLE_TIMES - 1);
+        ESP_LOGI(TAG, "%s: %d bytes kept per cycle", bench_app.name, leak_per_cycle);
+        TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(BENCH_LEAK_THRESHOLD, leak_per_cycle, "App switch cycles leak memory");
+
+        TEST_ASSERT_TRUE_MESSAGE(phone->uninstallApp(app_id), "Failed to uninstall app");
+        delete app;
+    }
+
+    ESP_LOGI(TAG, "Phone delete");
+    delete phone;
+    bench_lvgl_deinit();
+}
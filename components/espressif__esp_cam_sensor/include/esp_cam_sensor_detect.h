@@ -6,12 +6,60 @@
 
 #pragma once
 
+#include "esp_err.h"
 #include "esp_cam_sensor_types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Sensor expected on a camera interface, usually the one detected on the previous boot.
+ */
+typedef struct {
+    esp_cam_sensor_port_t port;                  /*!< Camera interface the sensor is connected to */
+    uint16_t sccb_addr;                          /*!< SCCB address of the sensor */
+    uint16_t pid;                                /*!< Product ID of the sensor, 0 if unknown */
+} esp_cam_sensor_detect_hint_t;
+
+/**
+ * @brief Probe only the sensor of the hint on its interface.
+ *
+ * Detect functions of the same interface at another SCCB address return NULL without touching the bus,
+ * so a board with a known sensor skips the I2C timeouts of every other compiled-in driver. If the hinted
+ * sensor is not found, clear the hint and run the detection again.
+ *
+ * @param hint Expected sensor, NULL to probe every sensor again.
+ */
+void esp_cam_sensor_detect_set_hint(const esp_cam_sensor_detect_hint_t *hint);
+
+/**
+ * @brief Get the sensor found by the latest successful detect function.
+ *
+ * @param[out] result Interface, SCCB address and product ID of the sensor
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ *      - ESP_ERR_NOT_FOUND: No sensor has been detected
+ */
+esp_err_t esp_cam_sensor_detect_get_result(esp_cam_sensor_detect_hint_t *result);
+
+/**
+ * @brief Run a detect function unless the hint excludes it, and record the sensor it finds.
+ *
+ * Used by ESP_CAM_SENSOR_DETECT_FN, not meant to be called directly.
+ *
+ * @param detect Detect function of the driver
+ * @param port Camera interface of the detect function
+ * @param sccb_addr SCCB address of the detect function
+ * @param config Sensor configuration passed by the application
+ *
+ * @return The detected device, or NULL
+ */
+esp_cam_sensor_device_t *esp_cam_sensor_detect_with_hint(esp_cam_sensor_device_t *(*detect)(void *), esp_cam_sensor_port_t port,
+        uint16_t sccb_addr, void *config);
+
 /**
  * @brief Define a camera detect function which can be executed automatically, in application layer.
  *
@@ -31,8 +79,12 @@ extern "C" {
  */
 #define ESP_CAM_SENSOR_DETECT_FN(f, i, j, ...) \
     static esp_cam_sensor_device_t * __VA_ARGS__ __esp_cam_sensor_detect_fn_##f(void *config); \
+    static esp_cam_sensor_device_t *__esp_cam_sensor_detect_hinted_fn_##f(void *config) \
+    { \
+        return esp_cam_sensor_detect_with_hint(__esp_cam_sensor_detect_fn_##f, (i), (j), config); \
+    } \
     static __attribute__((used)) _SECTION_ATTR_IMPL(".esp_cam_sensor_detect_fn", __COUNTER__) \
-        esp_cam_sensor_detect_fn_t esp_cam_sensor_detect_fn_##f = { .detect = ( __esp_cam_sensor_detect_fn_##f), .port = (i), .sccb_addr = (j) }; \
+        esp_cam_sensor_detect_fn_t esp_cam_sensor_detect_fn_##f = { .detect = ( __esp_cam_sensor_detect_hinted_fn_##f), .port = (i), .sccb_addr = (j) }; \
     static esp_cam_sensor_device_t *__esp_cam_sensor_detect_fn_##f(void *config)
 
 /**
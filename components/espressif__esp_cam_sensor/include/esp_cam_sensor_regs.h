@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_sccb_intf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register table entry with a 16-bit address and an 8-bit value, same layout as the `*_reginfo_t` of the sensors
+ */
+typedef struct {
+    uint16_t reg;
+    uint8_t val;
+} esp_cam_sensor_reg_a16v8_t;
+
+#define ESP_CAM_SENSOR_REGS_CACHE_SIZE  (512)   /*!< Registers a cache holds, a power of two larger than the tables */
+
+/**
+ * @brief Shadow of the registers written to a sensor, so bitfield updates don't read them back over SCCB
+ */
+typedef struct {
+    struct {
+        uint16_t reg;
+        uint8_t val;
+        uint8_t valid;
+    } entries[ESP_CAM_SENSOR_REGS_CACHE_SIZE];
+} esp_cam_sensor_regs_cache_t;
+
+/**
+ * @brief Description of the register tables of a sensor
+ */
+typedef struct {
+    uint16_t end_reg;               /*!< Address marking the end of a table */
+    uint16_t delay_reg;             /*!< Address of the entries waiting `val` milliseconds */
+    uint16_t reset_reg;             /*!< Software reset register, 0 if the tables never reset the sensor */
+    bool auto_increment;            /*!< The sensor increments the register address after each byte written */
+} esp_cam_sensor_regs_cfg_t;
+
+/**
+ * @brief Write a register table to a sensor with 16-bit register addresses.
+ *
+ * @note When the sensor auto-increments the register address and `CONFIG_CAMERA_SENSOR_SCCB_PAIR_WRITE` is enabled,
+ *       two entries with consecutive addresses are written in one transaction.
+ *
+ * @param[in] sccb_handle SCCB handle of the sensor.
+ * @param[in] regs Register table, terminated by an entry at `cfg->end_reg`.
+ * @param[in] cfg Description of the register tables of the sensor.
+ * @param[in] cache Shadow updated with the written values, NULL if the sensor has none.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Error in the passed arguments.
+ *      - Others: Error code of the SCCB transaction that failed.
+ */
+esp_err_t esp_cam_sensor_write_regs_a16v8(esp_sccb_io_handle_t sccb_handle, const esp_cam_sensor_reg_a16v8_t *regs,
+                                          const esp_cam_sensor_regs_cfg_t *cfg, esp_cam_sensor_regs_cache_t *cache);
+
+/**
+ * @brief Switch a sensor from one register table to another by only writing the entries that change its registers.
+ *
+ * The registers are assumed to hold the values `cur` left, the entries of `target` are written in order, skipping
+ * the ones that write the value the register already has. The caller stops the stream around the switch.
+ *
+ * @param[in] sccb_handle SCCB handle of the sensor.
+ * @param[in] cur Register table the sensor was loaded with.
+ * @param[in] target Register table to switch to.
+ * @param[in] cfg Description of the register tables of the sensor.
+ * @param[in] cache Shadow updated with the written values, NULL if the sensor has none.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Error in the passed arguments.
+ *      - ESP_ERR_NOT_SUPPORTED: The delta would not leave the registers as writing `target` does: a table resets the
+ *                               sensor or has delays, or `cur` writes a register `target` doesn't. Nothing is written,
+ *                               the caller writes `target` with `esp_cam_sensor_write_regs_a16v8`.
+ *      - Others: Error code of the SCCB transaction that failed.
+ */
+esp_err_t esp_cam_sensor_write_regs_delta_a16v8(esp_sccb_io_handle_t sccb_handle, const esp_cam_sensor_reg_a16v8_t *cur,
+                                                const esp_cam_sensor_reg_a16v8_t *target,
+                                                const esp_cam_sensor_regs_cfg_t *cfg, esp_cam_sensor_regs_cache_t *cache);
+
+/**
+ * @brief Forget all the registers of a shadow, after the sensor was reset or powered off.
+ *
+ * @param[in] cache Shadow to clear.
+ */
+void esp_cam_sensor_regs_cache_clear(esp_cam_sensor_regs_cache_t *cache);
+
+/**
+ * @brief Read a register from the shadow, or over SCCB the first time and keep it.
+ *
+ * @note Only for the registers the sensor doesn't change by itself, like flip or test pattern controls.
+ *
+ * @param[in] sccb_handle SCCB handle of the sensor.
+ * @param[in] cache Shadow of the sensor.
+ * @param[in] reg Register address.
+ * @param[out] val Register value.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Error in the passed arguments.
+ *      - Others: Error code of the SCCB read.
+ */
+esp_err_t esp_cam_sensor_read_reg_cached_a16v8(esp_sccb_io_handle_t sccb_handle, esp_cam_sensor_regs_cache_t *cache,
+                                               uint16_t reg, uint8_t *val);
+
+/**
+ * @brief Write a register over SCCB and update the shadow.
+ *
+ * @param[in] sccb_handle SCCB handle of the sensor.
+ * @param[in] cache Shadow of the sensor.
+ * @param[in] reg Register address.
+ * @param[in] val Register value.
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Error in the passed arguments.
+ *      - Others: Error code of the SCCB write, the register is dropped from the shadow.
+ */
+esp_err_t esp_cam_sensor_write_reg_cached_a16v8(esp_sccb_io_handle_t sccb_handle, esp_cam_sensor_regs_cache_t *cache,
+                                                uint16_t reg, uint8_t val);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@
  #include "esp_log.h"
  
  #include "esp_cam_sensor.h"
+ #include "esp_cam_sensor_regs.h"
  #include "esp_cam_sensor_detect.h"
  #include "ov02c10_settings.h"
  #include "ov02c10.h"
@@ -33,6 +34,8 @@ typedef struct {
 
 struct ov02c10_cam {
     ov02c10_para_t ov02c10_para;
+    const esp_cam_sensor_format_t *regs_format; // format the registers were loaded with, NULL after a reset
+    esp_cam_sensor_regs_cache_t regs_cache;     // registers written since the last reset
 };
 
 #define OV02C10_VTS_MAX          0x46c // Max exposure is VTS-15
@@ -1052,52 +1055,57 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
      return esp_sccb_transmit_receive_reg_a16v8(sccb_handle, reg, read_buf);
  }
  
- static esp_err_t ov02c10_write(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uint8_t data)
+ /* Every write goes through the shadow, so the read-modify-writes never read the registers back */
+ static esp_err_t ov02c10_write(esp_cam_sensor_device_t *dev, uint16_t reg, uint8_t data)
  {
-     return esp_sccb_transmit_reg_a16v8(sccb_handle, reg, data);
+     struct ov02c10_cam *cam = (struct ov02c10_cam *)dev->priv;
+
+     return esp_cam_sensor_write_reg_cached_a16v8(dev->sccb_handle, &cam->regs_cache, reg, data);
  }
  
- /* write a array of registers */
- static esp_err_t ov02c10_write_array(esp_sccb_io_handle_t sccb_handle, const ov02c10_reginfo_t *regarray)
+ static const esp_cam_sensor_regs_cfg_t ov02c10_regs_cfg = {
+     .end_reg = OV02C10_REG_END,
+     .delay_reg = OV02C10_REG_DELAY,
+     .reset_reg = 0x0103,
+     .auto_increment = true,
+ };
+
+ /* write a array of registers, consecutive ones are paired in one transaction */
+ static esp_err_t ov02c10_write_array(esp_cam_sensor_device_t *dev, const ov02c10_reginfo_t *regarray)
  {
-     int i = 0;
-     esp_err_t ret = ESP_OK;
-     while ((ret == ESP_OK) && regarray[i].reg != OV02C10_REG_END) {
-         if (regarray[i].reg != OV02C10_REG_DELAY) {
-             ret = ov02c10_write(sccb_handle, regarray[i].reg, regarray[i].val);
-         } else {
-             delay_ms(regarray[i].val);
-         }
-         i++;
-     }
-     ESP_LOGD(TAG, "count=%d", i);
-     return ret;
+     struct ov02c10_cam *cam = (struct ov02c10_cam *)dev->priv;
+
+     return esp_cam_sensor_write_regs_a16v8(dev->sccb_handle, (const esp_cam_sensor_reg_a16v8_t *)regarray, &ov02c10_regs_cfg,
+                                            &cam->regs_cache);
  }
  
- static esp_err_t ov02c10_set_reg_bits(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uint8_t offset, uint8_t length, uint8_t value)
+ static esp_err_t ov02c10_set_reg_bits(esp_cam_sensor_device_t *dev, uint16_t reg, uint8_t offset, uint8_t length, uint8_t value)
  {
+     struct ov02c10_cam *cam = (struct ov02c10_cam *)dev->priv;
      esp_err_t ret = ESP_OK;
      uint8_t reg_data = 0;
  
-     ret = ov02c10_read(sccb_handle, reg, &reg_data);
+     ret = esp_cam_sensor_read_reg_cached_a16v8(dev->sccb_handle, &cam->regs_cache, reg, &reg_data);
      if (ret != ESP_OK) {
          return ret;
      }
      uint8_t mask = ((1 << length) - 1) << offset;
      value = (reg_data & ~mask) | ((value << offset) & mask);
-     ret = ov02c10_write(sccb_handle, reg, value);
+     ret = ov02c10_write(dev, reg, value);
      return ret;
  }
  
  static esp_err_t ov02c10_set_test_pattern(esp_cam_sensor_device_t *dev, int enable)
  {
      ESP_LOGI(TAG,"test color = %d",enable);
-     return ov02c10_set_reg_bits(dev->sccb_handle, 0x4503, 7, 1, enable ? 0x01 : 0x00);
+     return ov02c10_set_reg_bits(dev, 0x4503, 7, 1, enable ? 0x01 : 0x00);
  }
  
  static esp_err_t ov02c10_hw_reset(esp_cam_sensor_device_t *dev)
  {
      if (dev->reset_pin >= 0) {
+         ((struct ov02c10_cam *)dev->priv)->regs_format = NULL;
+         esp_cam_sensor_regs_cache_clear(&((struct ov02c10_cam *)dev->priv)->regs_cache);
          gpio_set_level(dev->reset_pin, 0);
          delay_ms(10);
          gpio_set_level(dev->reset_pin, 1);
@@ -1108,7 +1116,9 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
  
  static esp_err_t ov02c10_soft_reset(esp_cam_sensor_device_t *dev)
  {
-     esp_err_t ret = ov02c10_set_reg_bits(dev->sccb_handle, 0x0103, 0, 1, 0x01);
+     ((struct ov02c10_cam *)dev->priv)->regs_format = NULL;
+     esp_err_t ret = ov02c10_set_reg_bits(dev, 0x0103, 0, 1, 0x01);
+     esp_cam_sensor_regs_cache_clear(&((struct ov02c10_cam *)dev->priv)->regs_cache);
      delay_ms(5);
      return ret;
  }
@@ -1141,21 +1151,21 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
          val |= OV02C10_MIPI_CTRL00_CLOCK_LANE_GATE | OV02C10_MIPI_CTRL00_CLOCK_LANE_DISABLE;
      }
  
-     ret = ov02c10_write(dev->sccb_handle, 0x4800, CONFIG_CAMERA_OV02C10_CSI_LINESYNC_ENABLE ? 0x64 : 0x00);
+     ret = ov02c10_write(dev, 0x4800, CONFIG_CAMERA_OV02C10_CSI_LINESYNC_ENABLE ? 0x64 : 0x00);
      ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "write pad out failed");
  
  #if CONFIG_CAMERA_OV02C10_ISP_AF_ENABLE
-     ret = ov02c10_write(dev->sccb_handle, 0x3002, enable ? 0x01 : 0x00);
+     ret = ov02c10_write(dev, 0x3002, enable ? 0x01 : 0x00);
      ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "write pad out failed");
  
-     ret = ov02c10_write(dev->sccb_handle, 0x3010, enable ? 0x01 : 0x00);
+     ret = ov02c10_write(dev, 0x3010, enable ? 0x01 : 0x00);
      ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "write pad out failed");
  
-     ret = ov02c10_write(dev->sccb_handle, 0x300D, enable ? 0x01 : 0x00);
+     ret = ov02c10_write(dev, 0x300D, enable ? 0x01 : 0x00);
      ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "write pad out failed");
  #endif
  
-     ret = ov02c10_write(dev->sccb_handle, 0x0100, enable ? 0x01 : 0x00);
+     ret = ov02c10_write(dev, 0x0100, enable ? 0x01 : 0x00);
      ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "write pad out failed");
  
      dev->stream_status = enable;
@@ -1166,12 +1176,12 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
  
  static esp_err_t ov02c10_set_mirror(esp_cam_sensor_device_t *dev, int enable)
  {
-     return ov02c10_set_reg_bits(dev->sccb_handle, 0x3821, 1, 1, enable ? 0x01 : 0x00);
+     return ov02c10_set_reg_bits(dev, 0x3821, 1, 1, enable ? 0x01 : 0x00);
  }
  
  static esp_err_t ov02c10_set_vflip(esp_cam_sensor_device_t *dev, int enable)
  {
-     return ov02c10_set_reg_bits(dev->sccb_handle, 0x3820, 1, 1, enable ? 0x01 : 0x00);
+     return ov02c10_set_reg_bits(dev, 0x3820, 1, 1, enable ? 0x01 : 0x00);
  }
  
 //  static esp_err_t ov02c10_set_AE_target(esp_cam_sensor_device_t *dev, int target)
@@ -1189,12 +1199,12 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
  
 //      fast_low = AE_low >> 1;
  
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a0f, AE_high);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a10, AE_low);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a1b, AE_high);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a1e, AE_low);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a11, fast_high);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a1f, fast_low);
+//      ret |= ov02c10_write(dev, 0x3a0f, AE_high);
+//      ret |= ov02c10_write(dev, 0x3a10, AE_low);
+//      ret |= ov02c10_write(dev, 0x3a1b, AE_high);
+//      ret |= ov02c10_write(dev, 0x3a1e, AE_low);
+//      ret |= ov02c10_write(dev, 0x3a11, fast_high);
+//      ret |= ov02c10_write(dev, 0x3a1f, fast_low);
  
 //      return ret;
 //  }
@@ -1208,16 +1218,16 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
 
     ESP_LOGI(TAG, "set exposure 0x%" PRIx32, value_buf);
     /* 4 least significant bits of expsoure are fractional part */
-    // ret = ov02c10_write(dev->sccb_handle,
+    // ret = ov02c10_write(dev,
     //                    OV02C10_REG_SHUTTER_TIME_H,
     //                    OV02C10_FETCH_EXP_H(value_buf));
 
     ESP_LOGI(TAG,"OV02C10_FETCH_EXP_M(value_buf) = 0x%"PRIx32,OV02C10_FETCH_EXP_M(value_buf));
-    ret = ov02c10_write(dev->sccb_handle,
+    ret = ov02c10_write(dev,
                         OV02C10_REG_SHUTTER_TIME_M,
                         OV02C10_FETCH_EXP_M(value_buf));
     ESP_LOGI(TAG,"OV02C10_FETCH_EXP_M(value_buf) = 0x%"PRIx32,OV02C10_FETCH_EXP_L(value_buf));
-    ret |= ov02c10_write(dev->sccb_handle,
+    ret |= ov02c10_write(dev,
                         OV02C10_REG_SHUTTER_TIME_L,
                         OV02C10_FETCH_EXP_L(value_buf));
     if (ret == ESP_OK) {
@@ -1232,13 +1242,13 @@ static const ov02c10_gain_t ov02c10_gain_map[] = {
     struct ov02c10_cam *cam_ov02c10 = (struct ov02c10_cam *)dev->priv;
 
     // ESP_LOGI(TAG, "dgain_fine %" PRIx8 ", dgain_coarse %" PRIx8 ", again_coarse %" PRIx8, ov02c10_gain_map[u32_val].dgain_fine, ov02c10_gain_map[u32_val].dgain_coarse, ov02c10_gain_map[u32_val].analog_gain);
-    ret = ov02c10_write(dev->sccb_handle,
+    ret = ov02c10_write(dev,
                        OV02C10_REG_DIG_FINE_GAIN_H,
                        ov02c10_gain_map[u32_val].dgain_fine);
-    ret |= ov02c10_write(dev->sccb_handle,
+    ret |= ov02c10_write(dev,
                         OV02C10_REG_DIG_COARSE_GAIN,
                         ov02c10_gain_map[u32_val].dgain_coarse);
-    ret |= ov02c10_write(dev->sccb_handle,
+    ret |= ov02c10_write(dev,
                         OV02C10_REG_ANG_COARSE_GAIN,
                         ov02c10_gain_map[u32_val].analog_gain);
     if (ret == ESP_OK) {
@@ -1410,11 +1420,11 @@ static esp_err_t ov02c10_set_para_value(esp_cam_sensor_device_t *dev, uint32_t i
     case ESP_CAM_SENSOR_GROUP_EXP_GAIN: {
         esp_cam_sensor_gh_exp_gain_t *value = (esp_cam_sensor_gh_exp_gain_t *)arg;
         uint32_t ori_exp = EXPOSURE_V4L2_TO_OV02C10(value->exposure_us, dev->cur_format);
-        ret = ov02c10_write(dev->sccb_handle, OV02C10_REG_GROUP_HOLD, OV02C10_GROUP_HOLD_START);
+        ret = ov02c10_write(dev, OV02C10_REG_GROUP_HOLD, OV02C10_GROUP_HOLD_START);
         ret |= ov02c10_set_exp_val(dev, ori_exp);
         ret |= ov02c10_set_total_gain_val(dev, value->gain_index);
-        ret |= ov02c10_write(dev->sccb_handle, OV02C10_REG_GROUP_HOLD_DELAY, OV02C10_GROUP_HOLD_DELAY_FRAMES);
-        ret |= ov02c10_write(dev->sccb_handle, OV02C10_REG_GROUP_HOLD, OV02C10_GROUP_HOLD_END);
+        ret |= ov02c10_write(dev, OV02C10_REG_GROUP_HOLD_DELAY, OV02C10_GROUP_HOLD_DELAY_FRAMES);
+        ret |= ov02c10_write(dev, OV02C10_REG_GROUP_HOLD, OV02C10_GROUP_HOLD_END);
         break;
     }
     case ESP_CAM_SENSOR_VFLIP: {
@@ -1568,19 +1578,19 @@ static esp_err_t ov02c10_set_para_value(esp_cam_sensor_device_t *dev, uint32_t i
 //      /* calculate banding filter */
 //      /* 60Hz */
 //      band_step60 = prev_sysclk * 100 / prev_HTS * 100 / 120;
-//      ret = ov02c10_write(dev->sccb_handle, 0x3a0a, (uint8_t)(band_step60 >> 8));
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a0b, (uint8_t)(band_step60 & 0xff));
+//      ret = ov02c10_write(dev, 0x3a0a, (uint8_t)(band_step60 >> 8));
+//      ret |= ov02c10_write(dev, 0x3a0b, (uint8_t)(band_step60 & 0xff));
  
 //      max_band60 = (int)((prev_VTS - 4) / band_step60);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a0d, (uint8_t)max_band60);
+//      ret |= ov02c10_write(dev, 0x3a0d, (uint8_t)max_band60);
  
 //      /* 50Hz */
 //      band_step50 = prev_sysclk * 100 / prev_HTS;
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a08, (uint8_t)(band_step50 >> 8));
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a09, (uint8_t)(band_step50 & 0xff));
+//      ret |= ov02c10_write(dev, 0x3a08, (uint8_t)(band_step50 >> 8));
+//      ret |= ov02c10_write(dev, 0x3a09, (uint8_t)(band_step50 & 0xff));
  
 //      max_band50 = (int)((prev_VTS - 4) / band_step50);
-//      ret |= ov02c10_write(dev->sccb_handle, 0x3a0e, (uint8_t)max_band50);
+//      ret |= ov02c10_write(dev, 0x3a0e, (uint8_t)max_band50);
 //      return ret;
 //  }
  
@@ -1595,18 +1605,43 @@ static esp_err_t ov02c10_set_para_value(esp_cam_sensor_device_t *dev, uint32_t i
         format = &ov02c10_format_info[CONFIG_CAMERA_OV02C10_MIPI_IF_FORMAT_INDEX_DAFAULT];
     }
 
-    ret = ov02c10_write_array(dev->sccb_handle, (ov02c10_reginfo_t *)format->regs);
+    bool delta = false;
+    if (cam_ov02c10->regs_format != NULL) {
+        // Only the registers the two formats set differently are written, without the reset of a full load
+        int stream = dev->stream_status;
+        ret = stream ? ov02c10_set_stream(dev, 0) : ESP_OK;
+        if (ret == ESP_OK) {
+            ret = esp_cam_sensor_write_regs_delta_a16v8(dev->sccb_handle,
+                                                        (const esp_cam_sensor_reg_a16v8_t *)cam_ov02c10->regs_format->regs,
+                                                        (const esp_cam_sensor_reg_a16v8_t *)format->regs, &ov02c10_regs_cfg,
+                                                        &cam_ov02c10->regs_cache);
+        }
+        delta = (ret != ESP_ERR_NOT_SUPPORTED);
+        if ((ret == ESP_OK) && stream) {
+            ret = ov02c10_set_stream(dev, 1);
+        }
+    }
+    if (!delta) {
+        ret = ov02c10_write_array(dev, (ov02c10_reginfo_t *)format->regs);
+    }
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Set format regs fail");
+        cam_ov02c10->regs_format = NULL;
         return ESP_CAM_SENSOR_ERR_FAILED_SET_FORMAT;
     }
 
     dev->cur_format = format;
+    cam_ov02c10->regs_format = format;
     // init para
     cam_ov02c10->ov02c10_para.exposure_val = dev->cur_format->isp_info->isp_v1_info.exp_def;
     cam_ov02c10->ov02c10_para.gain_index = dev->cur_format->isp_info->isp_v1_info.gain_def;
     cam_ov02c10->ov02c10_para.exposure_max = dev->cur_format->isp_info->isp_v1_info.vts - OV02C10_EXP_MAX_OFFSET;
+    if (delta) {
+        // The delta skips the exposure and gain registers both formats set alike, they may have been changed since
+        ret = ov02c10_set_exp_val(dev, cam_ov02c10->ov02c10_para.exposure_val);
+        ret |= ov02c10_set_total_gain_val(dev, cam_ov02c10->ov02c10_para.gain_index);
+    }
 
     return ret;
  }
@@ -1642,7 +1677,7 @@ static esp_err_t ov02c10_set_para_value(esp_cam_sensor_device_t *dev, uint32_t i
          break;
      case ESP_CAM_SENSOR_IOC_S_REG:
          sensor_reg = (esp_cam_sensor_reg_val_t *)arg;
-         ret = ov02c10_write(dev->sccb_handle, sensor_reg->regaddr, sensor_reg->value);
+         ret = ov02c10_write(dev, sensor_reg->regaddr, sensor_reg->value);
          break;
      case ESP_CAM_SENSOR_IOC_S_STREAM:
          // ret = ov02c10_set_test_pattern(dev, *(int *)arg);
@@ -1712,6 +1747,9 @@ static esp_err_t ov02c10_set_para_value(esp_cam_sensor_device_t *dev, uint32_t i
  {
      esp_err_t ret = ESP_OK;
  
+     ((struct ov02c10_cam *)dev->priv)->regs_format = NULL;
+     esp_cam_sensor_regs_cache_clear(&((struct ov02c10_cam *)dev->priv)->regs_cache);
+
      if (dev->xclk_pin >= 0) {
          OV02C10_DISABLE_OUT_CLOCK(dev->xclk_pin);
      }
@@ -12,6 +12,7 @@
 #include "esp_log.h"
 
 #include "esp_cam_sensor.h"
+#include "esp_cam_sensor_regs.h"
 #include "esp_cam_sensor_detect.h"
 #include "ov5647_settings.h"
 #include "ov5647.h"
@@ -184,21 +185,16 @@ static esp_err_t ov5647_write(esp_sccb_io_handle_t sccb_handle, uint16_t reg, ui
     return esp_sccb_transmit_reg_a16v8(sccb_handle, reg, data);
 }
 
-/* write a array of registers */
+/* write a array of registers, consecutive ones are paired in one transaction */
 static esp_err_t ov5647_write_array(esp_sccb_io_handle_t sccb_handle, const ov5647_reginfo_t *regarray)
 {
-    int i = 0;
-    esp_err_t ret = ESP_OK;
-    while ((ret == ESP_OK) && regarray[i].reg != OV5647_REG_END) {
-        if (regarray[i].reg != OV5647_REG_DELAY) {
-            ret = ov5647_write(sccb_handle, regarray[i].reg, regarray[i].val);
-        } else {
-            delay_ms(regarray[i].val);
-        }
-        i++;
-    }
-    ESP_LOGD(TAG, "count=%d", i);
-    return ret;
+    static const esp_cam_sensor_regs_cfg_t regs_cfg = {
+        .end_reg = OV5647_REG_END,
+        .delay_reg = OV5647_REG_DELAY,
+        .auto_increment = true,
+    };
+
+    return esp_cam_sensor_write_regs_a16v8(sccb_handle, (const esp_cam_sensor_reg_a16v8_t *)regarray, &regs_cfg, NULL);
 }
 
 static esp_err_t ov5647_set_reg_bits(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uint8_t offset, uint8_t length, uint8_t value)
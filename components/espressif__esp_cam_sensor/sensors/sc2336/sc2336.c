@@ -13,6 +13,7 @@
 #include "esp_log.h"
 
 #include "esp_cam_sensor.h"
+#include "esp_cam_sensor_regs.h"
 #include "esp_cam_sensor_detect.h"
 #include "sc2336_settings.h"
 #include "sc2336.h"
@@ -40,6 +41,7 @@ typedef struct {
 
 struct sc2336_cam {
     sc2336_para_t sc2336_para;
+    esp_cam_sensor_regs_cache_t regs_cache;     // registers written since the last reset
 };
 
 #define SC2336_IO_MUX_LOCK(mux)
@@ -1350,50 +1352,54 @@ static esp_err_t sc2336_read(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uin
     return esp_sccb_transmit_receive_reg_a16v8(sccb_handle, reg, read_buf);
 }
 
-static esp_err_t sc2336_write(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uint8_t data)
+/* Every write goes through the shadow, so the read-modify-writes never read the registers back */
+static esp_err_t sc2336_write(esp_cam_sensor_device_t *dev, uint16_t reg, uint8_t data)
 {
-    return esp_sccb_transmit_reg_a16v8(sccb_handle, reg, data);
+    struct sc2336_cam *cam = (struct sc2336_cam *)dev->priv;
+
+    return esp_cam_sensor_write_reg_cached_a16v8(dev->sccb_handle, &cam->regs_cache, reg, data);
 }
 
-/* write a array of registers  */
-static esp_err_t sc2336_write_array(esp_sccb_io_handle_t sccb_handle, sc2336_reginfo_t *regarray)
+/* write a array of registers, consecutive ones are paired in one transaction */
+static esp_err_t sc2336_write_array(esp_cam_sensor_device_t *dev, sc2336_reginfo_t *regarray)
 {
-    int i = 0;
-    esp_err_t ret = ESP_OK;
-    while ((ret == ESP_OK) && regarray[i].reg != SC2336_REG_END) {
-        if (regarray[i].reg != SC2336_REG_DELAY) {
-            ret = sc2336_write(sccb_handle, regarray[i].reg, regarray[i].val);
-        } else {
-            delay_ms(regarray[i].val);
-        }
-        i++;
-    }
-    return ret;
+    static const esp_cam_sensor_regs_cfg_t regs_cfg = {
+        .end_reg = SC2336_REG_END,
+        .delay_reg = SC2336_REG_DELAY,
+        .reset_reg = 0x0103,
+        .auto_increment = true,
+    };
+    struct sc2336_cam *cam = (struct sc2336_cam *)dev->priv;
+
+    return esp_cam_sensor_write_regs_a16v8(dev->sccb_handle, (const esp_cam_sensor_reg_a16v8_t *)regarray, &regs_cfg,
+                                           &cam->regs_cache);
 }
 
-static esp_err_t sc2336_set_reg_bits(esp_sccb_io_handle_t sccb_handle, uint16_t reg, uint8_t offset, uint8_t length, uint8_t value)
+static esp_err_t sc2336_set_reg_bits(esp_cam_sensor_device_t *dev, uint16_t reg, uint8_t offset, uint8_t length, uint8_t value)
 {
+    struct sc2336_cam *cam = (struct sc2336_cam *)dev->priv;
     esp_err_t ret = ESP_OK;
     uint8_t reg_data = 0;
 
-    ret = sc2336_read(sccb_handle, reg, &reg_data);
+    ret = esp_cam_sensor_read_reg_cached_a16v8(dev->sccb_handle, &cam->regs_cache, reg, &reg_data);
     if (ret != ESP_OK) {
         return ret;
     }
     uint8_t mask = ((1 << length) - 1) << offset;
     value = (reg_data & ~mask) | ((value << offset) & mask);
-    ret = sc2336_write(sccb_handle, reg, value);
+    ret = sc2336_write(dev, reg, value);
     return ret;
 }
 
 static esp_err_t sc2336_set_test_pattern(esp_cam_sensor_device_t *dev, int enable)
 {
-    return sc2336_set_reg_bits(dev->sccb_handle, 0x4501, 3, 1, enable ? 0x01 : 0x00);
+    return sc2336_set_reg_bits(dev, 0x4501, 3, 1, enable ? 0x01 : 0x00);
 }
 
 static esp_err_t sc2336_hw_reset(esp_cam_sensor_device_t *dev)
 {
     if (dev->reset_pin >= 0) {
+        esp_cam_sensor_regs_cache_clear(&((struct sc2336_cam *)dev->priv)->regs_cache);
         gpio_set_level(dev->reset_pin, 0);
         delay_ms(10);
         gpio_set_level(dev->reset_pin, 1);
@@ -1404,7 +1410,8 @@ static esp_err_t sc2336_hw_reset(esp_cam_sensor_device_t *dev)
 
 static esp_err_t sc2336_soft_reset(esp_cam_sensor_device_t *dev)
 {
-    esp_err_t ret = sc2336_set_reg_bits(dev->sccb_handle, 0x0103, 0, 1, 0x01);
+    esp_err_t ret = sc2336_set_reg_bits(dev, 0x0103, 0, 1, 0x01);
+    esp_cam_sensor_regs_cache_clear(&((struct sc2336_cam *)dev->priv)->regs_cache);
     delay_ms(5);
     return ret;
 }
@@ -1430,7 +1437,7 @@ static esp_err_t sc2336_get_sensor_id(esp_cam_sensor_device_t *dev, esp_cam_sens
 static esp_err_t sc2336_set_stream(esp_cam_sensor_device_t *dev, int enable)
 {
     esp_err_t ret = ESP_FAIL;
-    ret = sc2336_write(dev->sccb_handle, SC2336_REG_SLEEP_MODE, enable ? 0x01 : 0x00);
+    ret = sc2336_write(dev, SC2336_REG_SLEEP_MODE, enable ? 0x01 : 0x00);
 
     dev->stream_status = enable;
     ESP_LOGD(TAG, "Stream=%d", enable);
@@ -1439,12 +1446,12 @@ static esp_err_t sc2336_set_stream(esp_cam_sensor_device_t *dev, int enable)
 
 static esp_err_t sc2336_set_mirror(esp_cam_sensor_device_t *dev, int enable)
 {
-    return sc2336_set_reg_bits(dev->sccb_handle, 0x3221, 1, 2,  enable ? 0x03 : 0x00);
+    return sc2336_set_reg_bits(dev, 0x3221, 1, 2,  enable ? 0x03 : 0x00);
 }
 
 static esp_err_t sc2336_set_vflip(esp_cam_sensor_device_t *dev, int enable)
 {
-    return sc2336_set_reg_bits(dev->sccb_handle, 0x3221, 5, 2, enable ? 0x03 : 0x00);
+    return sc2336_set_reg_bits(dev, 0x3221, 5, 2, enable ? 0x03 : 0x00);
 }
 
 static esp_err_t sc2336_set_exp_val(esp_cam_sensor_device_t *dev, uint32_t u32_val)
@@ -1456,13 +1463,13 @@ static esp_err_t sc2336_set_exp_val(esp_cam_sensor_device_t *dev, uint32_t u32_v
 
     ESP_LOGD(TAG, "set exposure 0x%" PRIx32, value_buf);
     /* 4 least significant bits of expsoure are fractional part */
-    ret = sc2336_write(dev->sccb_handle,
+    ret = sc2336_write(dev,
                        SC2336_REG_SHUTTER_TIME_H,
                        SC2336_FETCH_EXP_H(value_buf));
-    ret |= sc2336_write(dev->sccb_handle,
+    ret |= sc2336_write(dev,
                         SC2336_REG_SHUTTER_TIME_M,
                         SC2336_FETCH_EXP_M(value_buf));
-    ret |= sc2336_write(dev->sccb_handle,
+    ret |= sc2336_write(dev,
                         SC2336_REG_SHUTTER_TIME_L,
                         SC2336_FETCH_EXP_L(value_buf));
     if (ret == ESP_OK) {
@@ -1477,13 +1484,13 @@ static esp_err_t sc2336_set_total_gain_val(esp_cam_sensor_device_t *dev, uint32_
     struct sc2336_cam *cam_sc2336 = (struct sc2336_cam *)dev->priv;
 
     ESP_LOGD(TAG, "dgain_fine %" PRIx8 ", dgain_coarse %" PRIx8 ", again_coarse %" PRIx8, sc2336_gain_map[u32_val].dgain_fine, sc2336_gain_map[u32_val].dgain_coarse, sc2336_gain_map[u32_val].analog_gain);
-    ret = sc2336_write(dev->sccb_handle,
+    ret = sc2336_write(dev,
                        SC2336_REG_DIG_FINE_GAIN,
                        sc2336_gain_map[u32_val].dgain_fine);
-    ret |= sc2336_write(dev->sccb_handle,
+    ret |= sc2336_write(dev,
                         SC2336_REG_DIG_COARSE_GAIN,
                         sc2336_gain_map[u32_val].dgain_coarse);
-    ret |= sc2336_write(dev->sccb_handle,
+    ret |= sc2336_write(dev,
                         SC2336_REG_ANG_GAIN,
                         sc2336_gain_map[u32_val].analog_gain);
     if (ret == ESP_OK) {
@@ -1582,11 +1589,11 @@ static esp_err_t sc2336_set_para_value(esp_cam_sensor_device_t *dev, uint32_t id
     case ESP_CAM_SENSOR_GROUP_EXP_GAIN: {
         esp_cam_sensor_gh_exp_gain_t *value = (esp_cam_sensor_gh_exp_gain_t *)arg;
         uint32_t ori_exp = EXPOSURE_V4L2_TO_SC2336(value->exposure_us, dev->cur_format);
-        ret = sc2336_write(dev->sccb_handle, SC2336_REG_GROUP_HOLD, SC2336_GROUP_HOLD_START);
+        ret = sc2336_write(dev, SC2336_REG_GROUP_HOLD, SC2336_GROUP_HOLD_START);
         ret |= sc2336_set_exp_val(dev, ori_exp);
         ret |= sc2336_set_total_gain_val(dev, value->gain_index);
-        ret |= sc2336_write(dev->sccb_handle, SC2336_REG_GROUP_HOLD_DELAY, SC2336_GROUP_HOLD_DELAY_FRAMES);
-        ret |= sc2336_write(dev->sccb_handle, SC2336_REG_GROUP_HOLD, SC2336_GROUP_HOLD_END);
+        ret |= sc2336_write(dev, SC2336_REG_GROUP_HOLD_DELAY, SC2336_GROUP_HOLD_DELAY_FRAMES);
+        ret |= sc2336_write(dev, SC2336_REG_GROUP_HOLD, SC2336_GROUP_HOLD_END);
         break;
     }
     case ESP_CAM_SENSOR_VFLIP: {
@@ -1657,7 +1664,7 @@ static esp_err_t sc2336_set_format(esp_cam_sensor_device_t *dev, const esp_cam_s
 #endif
     }
 
-    ret = sc2336_write_array(dev->sccb_handle, (sc2336_reginfo_t *)format->regs);
+    ret = sc2336_write_array(dev, (sc2336_reginfo_t *)format->regs);
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Set format regs fail");
@@ -1703,7 +1710,7 @@ static esp_err_t sc2336_priv_ioctl(esp_cam_sensor_device_t *dev, uint32_t cmd, v
         break;
     case ESP_CAM_SENSOR_IOC_S_REG:
         sensor_reg = (esp_cam_sensor_reg_val_t *)arg;
-        ret = sc2336_write(dev->sccb_handle, sensor_reg->regaddr, sensor_reg->value);
+        ret = sc2336_write(dev, sensor_reg->regaddr, sensor_reg->value);
         break;
     case ESP_CAM_SENSOR_IOC_S_STREAM:
         ret = sc2336_set_stream(dev, *(int *)arg);
@@ -1769,6 +1776,7 @@ static esp_err_t sc2336_power_off(esp_cam_sensor_device_t *dev)
 {
     esp_err_t ret = ESP_OK;
 
+    esp_cam_sensor_regs_cache_clear(&((struct sc2336_cam *)dev->priv)->regs_cache);
     if (dev->xclk_pin >= 0) {
         SC2336_DISABLE_OUT_XCLK(dev->xclk_pin);
     }
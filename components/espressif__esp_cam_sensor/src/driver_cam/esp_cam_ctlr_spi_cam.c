@@ -251,6 +251,29 @@ static esp_err_t spi_cam_deinit_intf(esp_cam_ctlr_spi_cam_t *ctlr)
     return ESP_OK;
 }
 
+/**
+ * @brief Check the sync code of a line header
+ *
+ * @param ctlr ESP CAM controller handle
+ * @param src Line header pointer
+ *
+ * @return
+ *      - true if the sync code matches
+ *      - false if not
+ */
+static inline bool spi_cam_check_line_header(esp_cam_ctlr_spi_cam_t *ctlr, const uint8_t *src)
+{
+    if (ctlr->line_check_mask) {
+        uint32_t word;
+
+        /* One unaligned load and compare instead of a memcmp call per line */
+        memcpy(&word, src, sizeof(word));
+        return (word & ctlr->line_check_mask) == ctlr->line_check_word;
+    }
+
+    return memcmp(src, ctlr->frame_info->line_header_check, ctlr->frame_info->line_header_check_size) == 0;
+}
+
 /**
  * @brief Decode frame, remove frame header and line header, then copy the image data to the destination buffer
  *
@@ -268,6 +291,10 @@ static esp_err_t spi_cam_deinit_intf(esp_cam_ctlr_spi_cam_t *ctlr)
 static esp_err_t spi_cam_decode(esp_cam_ctlr_spi_cam_t *ctlr, uint8_t *src, uint8_t *dst, uint32_t *decoded_size)
 {
     bool decode_check_dis = ctlr->decode_check_dis;
+    /* In place every line moves down by the headers before it, the regions overlap */
+    bool in_place = (dst <= src) && (src < dst + ctlr->bf_size_in_bytes);
+    uint32_t line_header_size = ctlr->frame_info->line_header_size;
+    uint32_t line_data_size = ctlr->frame_info->line_size - line_header_size;
 
     if (!decode_check_dis && (memcmp(src, ctlr->frame_info->frame_header_check, ctlr->frame_info->frame_header_check_size) != 0)) {
         ESP_LOGD(TAG, "invalid frame header: %x %x %x %x", src[0], src[1], src[2], src[3]);
@@ -275,16 +302,30 @@ static esp_err_t spi_cam_decode(esp_cam_ctlr_spi_cam_t *ctlr, uint8_t *src, uint
     }
     src += ctlr->frame_info->frame_header_size;
 
-    int line_data_size = ctlr->frame_info->line_size - ctlr->frame_info->line_header_size;
+    if (line_header_size == 0) {
+        /* Lines are back to back, the whole image moves in one copy */
+        if (in_place) {
+            memmove(dst, src, ctlr->bf_size_in_bytes);
+        } else {
+            memcpy(dst, src, ctlr->bf_size_in_bytes);
+        }
+        *decoded_size = ctlr->bf_size_in_bytes;
+
+        return ESP_OK;
+    }
 
     for (uint32_t i = 0; i < ctlr->fb_lines; i++) {
-        if (!decode_check_dis && (memcmp(src, ctlr->frame_info->line_header_check, ctlr->frame_info->line_header_check_size) != 0)) {
+        if (!decode_check_dis && !spi_cam_check_line_header(ctlr, src)) {
             ESP_LOGD(TAG, "invalid line header");
             return ESP_FAIL;
         }
-        src += ctlr->frame_info->line_header_size;
+        src += line_header_size;
 
-        memcpy(dst, src, line_data_size);
+        if (in_place) {
+            memmove(dst, src, line_data_size);
+        } else {
+            memcpy(dst, src, line_data_size);
+        }
 
         src += line_data_size;
         dst += line_data_size;
@@ -639,6 +680,13 @@ esp_err_t esp_cam_new_spi_ctlr(const esp_cam_ctlr_spi_config_t *config, esp_cam_
     ctlr->bf_size_in_bytes = config->frame_info->frame_size - config->frame_info->frame_header_size - config->frame_info->line_header_size * config->v_res;
     ctlr->drop_frame_count = config->frame_info->drop_frame_count;
 
+    if ((config->frame_info->line_header_check_size > 0) &&
+            (config->frame_info->line_header_check_size <= sizeof(uint32_t)) &&
+            (config->frame_info->line_size >= sizeof(uint32_t))) {
+        memcpy(&ctlr->line_check_word, config->frame_info->line_header_check, config->frame_info->line_header_check_size);
+        memset(&ctlr->line_check_mask, 0xff, config->frame_info->line_header_check_size);
+    }
+
 #if CAM_CTLR_SPI_HAS_BACKUP_BUFFER
     ctlr->bk_buffer_dis = config->bk_buffer_dis;
 #endif
@@ -76,6 +76,8 @@ typedef struct esp_cam_ctlr_spi_cam {
     uint32_t fb_lines;                                  /*!< Input vertical resolution, i.e. the number of lines in a frame */
     uint32_t fb_size_in_bytes;                          /*!< SPI sensor frame buffer size with frame header and line header */
     uint32_t bf_size_in_bytes;                          /*!< SPI sensor backup buffer size without frame header and line header, this is used when auto_decode_dis=0 */
+    uint32_t line_check_word;                           /*!< Line header sync code loaded as a word, compared at once when line_check_mask is not 0 */
+    uint32_t line_check_mask;                           /*!< Bytes of line_check_word holding the sync code, 0 if the sync code is longer than a word */
 
     struct {
 #if CAM_CTLR_SPI_HAS_BACKUP_BUFFER
@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_cam_sensor_detect.h"
+
+/*
+ * Detect functions are only called by the detection loop of the video initialization, from one task.
+ */
+static bool s_hint_valid;
+static esp_cam_sensor_detect_hint_t s_hint;
+static bool s_result_valid;
+static esp_cam_sensor_detect_hint_t s_result;
+
+static const char *TAG = "cam_detect";
+
+void esp_cam_sensor_detect_set_hint(const esp_cam_sensor_detect_hint_t *hint)
+{
+    if (hint) {
+        s_hint = *hint;
+        s_hint_valid = true;
+    } else {
+        s_hint_valid = false;
+    }
+    s_result_valid = false;
+}
+
+esp_err_t esp_cam_sensor_detect_get_result(esp_cam_sensor_detect_hint_t *result)
+{
+    ESP_RETURN_ON_FALSE(result, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    if (!s_result_valid) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *result = s_result;
+
+    return ESP_OK;
+}
+
+esp_cam_sensor_device_t *esp_cam_sensor_detect_with_hint(esp_cam_sensor_device_t *(*detect)(void *), esp_cam_sensor_port_t port,
+        uint16_t sccb_addr, void *config)
+{
+    esp_cam_sensor_device_t *dev;
+
+    if (s_hint_valid && (s_hint.port == port) && (s_hint.sccb_addr != sccb_addr)) {
+        ESP_LOGD(TAG, "skip 0x%x, expecting 0x%x", sccb_addr, s_hint.sccb_addr);
+        return NULL;
+    }
+
+    dev = detect(config);
+    if (dev) {
+        s_result.port = port;
+        s_result.sccb_addr = sccb_addr;
+        s_result.pid = dev->id.pid;
+        s_result_valid = true;
+    }
+
+    return dev;
+}
@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_cam_sensor_regs.h"
+
+#define delay_ms(ms)  vTaskDelay((ms > portTICK_PERIOD_MS ? ms / portTICK_PERIOD_MS : 1))
+
+static const char *TAG = "cam_sensor_regs";
+
+static inline bool regs_is_marker(uint16_t reg, const esp_cam_sensor_regs_cfg_t *cfg)
+{
+    return (reg == cfg->end_reg) || (reg == cfg->delay_reg);
+}
+
+/* The entry at `i` and the next one can be written in one transaction */
+static inline bool regs_is_pair(const esp_cam_sensor_reg_a16v8_t *regs, size_t i, const esp_cam_sensor_regs_cfg_t *cfg)
+{
+#if CONFIG_CAMERA_SENSOR_SCCB_PAIR_WRITE
+    return cfg->auto_increment && !regs_is_marker(regs[i + 1].reg, cfg) && (regs[i + 1].reg == (uint16_t)(regs[i].reg + 1));
+#else
+    return false;
+#endif
+}
+
+/* Hash of a register address to its first slot in a cache */
+static inline size_t regs_cache_slot(uint16_t reg)
+{
+    return ((uint32_t)reg * 2654435761u) >> 16 & (ESP_CAM_SENSOR_REGS_CACHE_SIZE - 1);
+}
+
+/* Slot holding `reg`, or the free slot it goes to, -1 if it isn't there and the cache is full */
+static int regs_cache_find(const esp_cam_sensor_regs_cache_t *cache, uint16_t reg)
+{
+    size_t slot = regs_cache_slot(reg);
+
+    for (size_t n = 0; n < ESP_CAM_SENSOR_REGS_CACHE_SIZE; n++) {
+        if (!cache->entries[slot].valid || (cache->entries[slot].reg == reg)) {
+            return slot;
+        }
+        slot = (slot + 1) & (ESP_CAM_SENSOR_REGS_CACHE_SIZE - 1);
+    }
+
+    return -1;
+}
+
+static void regs_cache_update(esp_cam_sensor_regs_cache_t *cache, uint16_t reg, uint8_t val)
+{
+    int slot = cache ? regs_cache_find(cache, reg) : -1;
+
+    if (slot >= 0) {
+        cache->entries[slot].reg = reg;
+        cache->entries[slot].val = val;
+        cache->entries[slot].valid = 1;
+    }
+}
+
+/* Open addressing, a register can't be removed without moving the ones probed after it, so all are dropped */
+static void regs_cache_drop(esp_cam_sensor_regs_cache_t *cache, uint16_t reg)
+{
+    int slot = cache ? regs_cache_find(cache, reg) : -1;
+
+    if ((slot >= 0) && cache->entries[slot].valid) {
+        esp_cam_sensor_regs_cache_clear(cache);
+    }
+}
+
+/* Write the entry at `i`, with the next one if `pair` */
+static esp_err_t regs_write_entry(esp_sccb_io_handle_t sccb_handle, const esp_cam_sensor_reg_a16v8_t *regs, size_t i,
+                                  bool pair, const esp_cam_sensor_regs_cfg_t *cfg, esp_cam_sensor_regs_cache_t *cache)
+{
+    esp_err_t ret = ESP_OK;
+    uint16_t reg = regs[i].reg;
+
+    if (pair) {
+        // The SCCB interface has no longer writes, a 16-bit value is sent MSB first: the first byte
+        // goes to `reg` and the second one to `reg + 1`
+        ret = esp_sccb_transmit_reg_a16v16(sccb_handle, reg, ((uint16_t)regs[i].val << 8) | regs[i + 1].val);
+    } else {
+        ret = esp_sccb_transmit_reg_a16v8(sccb_handle, reg, regs[i].val);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "write reg 0x%04x failed", reg);
+        // The registers may or may not have been written
+        regs_cache_drop(cache, reg);
+        if (pair) {
+            regs_cache_drop(cache, regs[i + 1].reg);
+        }
+        return ret;
+    }
+
+    if (cache && cfg->reset_reg && (reg == cfg->reset_reg)) {
+        // Everything written before is back to its default, the reset register clears itself
+        esp_cam_sensor_regs_cache_clear(cache);
+    } else {
+        regs_cache_update(cache, reg, regs[i].val);
+    }
+    if (pair) {
+        regs_cache_update(cache, regs[i + 1].reg, regs[i + 1].val);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_cam_sensor_write_regs_a16v8(esp_sccb_io_handle_t sccb_handle, const esp_cam_sensor_reg_a16v8_t *regs,
+                                          const esp_cam_sensor_regs_cfg_t *cfg, esp_cam_sensor_regs_cache_t *cache)
+{
+    esp_err_t ret = ESP_OK;
+    size_t i = 0;
+    size_t xfer_num = 0;
+
+    ESP_RETURN_ON_FALSE(sccb_handle && regs && cfg, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    while (regs[i].reg != cfg->end_reg) {
+        if (regs[i].reg == cfg->delay_reg) {
+            delay_ms(regs[i].val);
+            i++;
+            continue;
+        }
+
+        bool pair = regs_is_pair(regs, i, cfg);
+        ret = regs_write_entry(sccb_handle, regs, i, pair, cfg, cache);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        i += pair ? 2 : 1;
+        xfer_num++;
+    }
+    ESP_LOGD(TAG, "count=%d, xfer=%d", (int)i, (int)xfer_num);
+
+    return ESP_OK;
+}
+
+/* Index of the last entry writing `reg` among the `num` first ones, -1 if none */
+static int regs_find_last(const esp_cam_sensor_reg_a16v8_t *regs, size_t num, uint16_t reg,
+                          const esp_cam_sensor_regs_cfg_t *cfg)
+{
+    int found = -1;
+
+    for (size_t i = 0; (i < num) && (regs[i].reg != cfg->end_reg); i++) {
+        if (regs[i].reg == reg) {
+            found = i;
+        }
+    }
+
+    return found;
+}
+
+static bool regs_delta_is_supported(const esp_cam_sensor_reg_a16v8_t *cur, const esp_cam_sensor_reg_a16v8_t *target,
+                                    const esp_cam_sensor_regs_cfg_t *cfg)
+{
+    for (size_t i = 0; target[i].reg != cfg->end_reg; i++) {
+        if ((target[i].reg == cfg->delay_reg) || (cfg->reset_reg && (target[i].reg == cfg->reset_reg))) {
+            return false;
+        }
+    }
+    for (size_t i = 0; cur[i].reg != cfg->end_reg; i++) {
+        if ((cur[i].reg == cfg->delay_reg) || (cfg->reset_reg && (cur[i].reg == cfg->reset_reg)) ||
+                (regs_find_last(target, SIZE_MAX, cur[i].reg, cfg) < 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* The register of `target[i]` holds its last value in `target` before `i`, or else its last value in `cur` */
+static bool regs_delta_need_write(const esp_cam_sensor_reg_a16v8_t *cur, const esp_cam_sensor_reg_a16v8_t *target,
+                                  size_t i, const esp_cam_sensor_regs_cfg_t *cfg)
+{
+    int prev = regs_find_last(target, i, target[i].reg, cfg);
+
+    if (prev >= 0) {
+        return target[prev].val != target[i].val;
+    }
+    prev = regs_find_last(cur, SIZE_MAX, target[i].reg, cfg);
+
+    return (prev < 0) || (cur[prev].val != target[i].val);
+}
+
+esp_err_t esp_cam_sensor_write_regs_delta_a16v8(esp_sccb_io_handle_t sccb_handle, const esp_cam_sensor_reg_a16v8_t *cur,
+                                                const esp_cam_sensor_reg_a16v8_t *target,
+                                                const esp_cam_sensor_regs_cfg_t *cfg, esp_cam_sensor_regs_cache_t *cache)
+{
+    esp_err_t ret = ESP_OK;
+    size_t i = 0;
+    size_t xfer_num = 0;
+
+    ESP_RETURN_ON_FALSE(sccb_handle && cur && target && cfg, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (!regs_delta_is_supported(cur, target, cfg)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    while (target[i].reg != cfg->end_reg) {
+        if (!regs_delta_need_write(cur, target, i, cfg)) {
+            i++;
+            continue;
+        }
+
+        bool pair = regs_is_pair(target, i, cfg) && regs_delta_need_write(cur, target, i + 1, cfg);
+        ret = regs_write_entry(sccb_handle, target, i, pair, cfg, cache);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        i += pair ? 2 : 1;
+        xfer_num++;
+    }
+    ESP_LOGD(TAG, "count=%d, delta xfer=%d", (int)i, (int)xfer_num);
+
+    return ESP_OK;
+}
+
+void esp_cam_sensor_regs_cache_clear(esp_cam_sensor_regs_cache_t *cache)
+{
+    if (cache) {
+        memset(cache, 0, sizeof(esp_cam_sensor_regs_cache_t));
+    }
+}
+
+esp_err_t esp_cam_sensor_read_reg_cached_a16v8(esp_sccb_io_handle_t sccb_handle, esp_cam_sensor_regs_cache_t *cache,
+                                               uint16_t reg, uint8_t *val)
+{
+    ESP_RETURN_ON_FALSE(sccb_handle && cache && val, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    int slot = regs_cache_find(cache, reg);
+    if ((slot >= 0) && cache->entries[slot].valid) {
+        *val = cache->entries[slot].val;
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(esp_sccb_transmit_receive_reg_a16v8(sccb_handle, reg, val), TAG, "read reg 0x%04x failed", reg);
+    regs_cache_update(cache, reg, *val);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_cam_sensor_write_reg_cached_a16v8(esp_sccb_io_handle_t sccb_handle, esp_cam_sensor_regs_cache_t *cache,
+                                                uint16_t reg, uint8_t val)
+{
+    esp_err_t ret = ESP_OK;
+
+    ESP_RETURN_ON_FALSE(sccb_handle && cache, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    ret = esp_sccb_transmit_reg_a16v8(sccb_handle, reg, val);
+    if (ret != ESP_OK) {
+        // The register may or may not have been written
+        regs_cache_drop(cache, reg);
+        return ret;
+    }
+    regs_cache_update(cache, reg, val);
+
+    return ESP_OK;
+}
@@ -0,0 +1,318 @@
+/*
+ * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/time.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "linux/videodev2.h"
+#include "esp_video_init.h"
+#include "esp_video_device.h"
+
+#include "unity.h"
+#include "unity_test_utils.h"
+
+/* SCCB */
+#define SCCB0_SCL             CONFIG_SCCB0_SCL
+#define SCCB0_SDA             CONFIG_SCCB0_SDA
+#define SCCB0_FREQ_HZ         CONFIG_SCCB0_FREQUENCY
+#define SCCB0_PORT_NUM        I2C_NUM_0
+
+#define BENCH_DEV_PATH        ESP_VIDEO_MIPI_CSI_DEVICE_NAME
+#define BENCH_BUF_NUM         CONFIG_BENCHMARK_BUFFER_COUNT
+#define BENCH_DURATION_US     (CONFIG_BENCHMARK_DURATION_MS * 1000LL)
+#define BENCH_FMT_MAX         (8)
+/* Driver timestamps further away than this are not taken from the same clock */
+#define BENCH_LATENCY_MAX_US  (1000 * 1000)
+
+typedef struct {
+    uint32_t frames;
+    int64_t first_us;
+    int64_t last_us;
+    int64_t min_interval_us;
+    uint32_t latency_count;
+    int64_t latency_sum_us;
+    int64_t latency_max_us;
+    int64_t *intervals_us;
+    uint32_t intervals_max;
+} bench_stats_t;
+
+typedef struct {
+    configRUN_TIME_COUNTER_TYPE idle[portNUM_PROCESSORS];
+    configRUN_TIME_COUNTER_TYPE total;
+} bench_cpu_sample_t;
+
+static const char *TAG = "capture.bench";
+
+static void bench_cpu_sample(bench_cpu_sample_t *sample)
+{
+    UBaseType_t num = uxTaskGetNumberOfTasks();
+    TaskStatus_t *tasks = calloc(num, sizeof(TaskStatus_t));
+
+    memset(sample, 0, sizeof(*sample));
+    TEST_ASSERT_NOT_NULL(tasks);
+    num = uxTaskGetSystemState(tasks, num, &sample->total);
+    for (UBaseType_t i = 0; i < num; i++) {
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            if (tasks[i].xHandle == xTaskGetIdleTaskHandleForCore(core)) {
+                sample->idle[core] = tasks[i].ulRunTimeCounter;
+            }
+        }
+    }
+    free(tasks);
+}
+
+static uint32_t bench_cpu_load(const bench_cpu_sample_t *begin, const bench_cpu_sample_t *end, int core)
+{
+    configRUN_TIME_COUNTER_TYPE total = end->total - begin->total;
+    configRUN_TIME_COUNTER_TYPE idle = end->idle[core] - begin->idle[core];
+
+    if ((total == 0) || (idle > total)) {
+        return 0;
+    }
+
+    return 100 - (uint32_t)((uint64_t)idle * 100 / total);
+}
+
+/* Stands in for the frame operation callback of the application, it only records when the frame got there */
+static void bench_frame_cb(bench_stats_t *stats, const struct v4l2_buffer *buf)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    if (stats->frames > 0) {
+        int64_t interval_us = now_us - stats->last_us;
+
+        if (stats->frames - 1 < stats->intervals_max) {
+            stats->intervals_us[stats->frames - 1] = interval_us;
+        }
+        if ((stats->min_interval_us == 0) || (interval_us < stats->min_interval_us)) {
+            stats->min_interval_us = interval_us;
+        }
+    } else {
+        stats->first_us = now_us;
+    }
+    stats->last_us = now_us;
+    stats->frames++;
+
+    if (buf->timestamp.tv_sec || buf->timestamp.tv_usec) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        int64_t latency_us = ((int64_t)tv.tv_sec - buf->timestamp.tv_sec) * 1000000LL + (tv.tv_usec - buf->timestamp.tv_usec);
+
+        if ((latency_us >= 0) && (latency_us < BENCH_LATENCY_MAX_US)) {
+            stats->latency_count++;
+            stats->latency_sum_us += latency_us;
+            if (latency_us > stats->latency_max_us) {
+                stats->latency_max_us = latency_us;
+            }
+        }
+    }
+}
+
+static uint32_t bench_dropped_frames(const bench_stats_t *stats)
+{
+    uint32_t dropped = 0;
+    int64_t period_us = stats->min_interval_us;
+
+    if ((stats->frames < 2) || (period_us <= 0)) {
+        return 0;
+    }
+    uint32_t recorded = MIN(stats->frames - 1, stats->intervals_max);
+
+    /* Jitter moves a frame by less than half a period, anything longer hides missing frames */
+    for (uint32_t i = 0; i < recorded; i++) {
+        dropped += (uint32_t)((stats->intervals_us[i] + period_us / 2) / period_us) - 1;
+    }
+
+    return dropped;
+}
+
+static int bench_open(int64_t *init_us)
+{
+    esp_video_init_csi_config_t csi_config[] = {
+        {
+            .sccb_config = {
+                .init_sccb = true,
+                .i2c_config = {
+                    .port      = SCCB0_PORT_NUM,
+                    .scl_pin   = SCCB0_SCL,
+                    .sda_pin   = SCCB0_SDA,
+                },
+                .freq      = SCCB0_FREQ_HZ,
+            },
+            .reset_pin = CONFIG_CAM_SENSOR_RESET_PIN,
+            .pwdn_pin  = CONFIG_CAM_SENSOR_PWDN_PIN,
+        },
+    };
+    esp_video_init_config_t cam_config = {
+        .csi = csi_config,
+    };
+    int64_t begin_us = esp_timer_get_time();
+
+    TEST_ESP_OK(esp_video_init(&cam_config));
+    int fd = open(BENCH_DEV_PATH, O_RDONLY);
+    *init_us = esp_timer_get_time() - begin_us;
+    TEST_ASSERT_MESSAGE(fd >= 0, "no sensor detected");
+
+    return fd;
+}
+
+static void bench_setup_bufs(int fd, uint8_t **bufs)
+{
+    struct v4l2_requestbuffers req = {
+        .count = BENCH_BUF_NUM,
+        .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .memory = V4L2_MEMORY_MMAP,
+    };
+
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_REQBUFS, &req));
+    for (int i = 0; i < BENCH_BUF_NUM; i++) {
+        struct v4l2_buffer buf = {
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .memory = V4L2_MEMORY_MMAP,
+            .index = i,
+        };
+
+        TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_QUERYBUF, &buf));
+        bufs[i] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        TEST_ASSERT_NOT_NULL(bufs[i]);
+        TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_QBUF, &buf));
+    }
+}
+
+static void bench_run_format(int fd, uint32_t pixelformat, const struct v4l2_capability *cap, int64_t init_us)
+{
+    const int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    struct v4l2_format format = {
+        .type = type,
+    };
+    struct v4l2_buffer buf;
+    uint8_t *bufs[BENCH_BUF_NUM] = { 0 };
+    bench_stats_t stats = { 0 };
+    bench_cpu_sample_t cpu_begin;
+    bench_cpu_sample_t cpu_end;
+    char fourcc[5] = { 0 };
+
+    memcpy(fourcc, &pixelformat, 4);
+
+    int64_t switch_begin_us = esp_timer_get_time();
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_G_FMT, &format));
+    format.fmt.pix.pixelformat = pixelformat;
+    if (ioctl(fd, VIDIOC_S_FMT, &format) != 0) {
+        ESP_LOGW(TAG, "%s not accepted, skipped", fourcc);
+        return;
+    }
+    bench_setup_bufs(fd, bufs);
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_STREAMON, &type));
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = type;
+    buf.memory = V4L2_MEMORY_MMAP;
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_DQBUF, &buf));
+    int64_t switch_us = esp_timer_get_time() - switch_begin_us;
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_QBUF, &buf));
+
+    /* Every interval is kept so drops can be counted against the shortest one after the run */
+    stats.intervals_max = CONFIG_BENCHMARK_DURATION_MS / 5;
+    stats.intervals_us = calloc(stats.intervals_max, sizeof(int64_t));
+    TEST_ASSERT_NOT_NULL(stats.intervals_us);
+
+    bench_cpu_sample(&cpu_begin);
+    int64_t begin_us = esp_timer_get_time();
+    while (esp_timer_get_time() - begin_us < BENCH_DURATION_US) {
+        memset(&buf, 0, sizeof(buf));
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_DQBUF, &buf));
+        bench_frame_cb(&stats, &buf);
+        TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_QBUF, &buf));
+    }
+    bench_cpu_sample(&cpu_end);
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_STREAMOFF, &type));
+
+    int64_t elapsed_us = stats.last_us - stats.first_us;
+    uint32_t fps_x100 = (elapsed_us > 0) ? (uint32_t)((int64_t)(stats.frames - 1) * 100000000LL / elapsed_us) : 0;
+    char latency_avg[16] = "null";
+    char latency_max[16] = "null";
+    if (stats.latency_count) {
+        snprintf(latency_avg, sizeof(latency_avg), "%" PRId64, stats.latency_sum_us / stats.latency_count);
+        snprintf(latency_max, sizeof(latency_max), "%" PRId64, stats.latency_max_us);
+    }
+
+    /* One line per format, picked up by scripts comparing sensors and runs */
+    printf("BENCHMARK_RESULT {\"sensor\":\"%s\",\"card\":\"%s\",\"fmt\":\"%s\",\"width\":%" PRIu32 ",\"height\":%" PRIu32
+           ",\"buffers\":%d,\"init_us\":%" PRId64 ",\"switch_us\":%" PRId64 ",\"frames\":%" PRIu32 ",\"fps\":%" PRIu32 ".%02" PRIu32
+           ",\"latency_avg_us\":%s,\"latency_max_us\":%s,\"cpu_load\":[", (const char *)cap->driver, (const char *)cap->card,
+           fourcc, format.fmt.pix.width, format.fmt.pix.height, BENCH_BUF_NUM, init_us, switch_us, stats.frames,
+           fps_x100 / 100, fps_x100 % 100, latency_avg, latency_max);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        printf("%s%" PRIu32, core ? "," : "", bench_cpu_load(&cpu_begin, &cpu_end, core));
+    }
+    printf("],\"dropped\":%" PRIu32 "}\n", bench_dropped_frames(&stats));
+
+    free(stats.intervals_us);
+}
+
+TEST_CASE("Camera capture benchmark", "[video][benchmark]")
+{
+    struct v4l2_capability cap;
+    uint32_t formats[BENCH_FMT_MAX];
+    int format_num = 0;
+    int64_t init_us = 0;
+
+    int fd = bench_open(&init_us);
+
+    memset(&cap, 0, sizeof(cap));
+    TEST_ASSERT_EQUAL(0, ioctl(fd, VIDIOC_QUERYCAP, &cap));
+
+    for (int i = 0; i < BENCH_FMT_MAX; i++) {
+        struct v4l2_fmtdesc desc = {
+            .index = i,
+            .type = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        };
+
+        if (ioctl(fd, VIDIOC_ENUM_FMT, &desc) != 0) {
+            break;
+        }
+        formats[format_num++] = desc.pixelformat;
+    }
+    TEST_ASSERT_MESSAGE(format_num > 0, "no format supported");
+
+    for (int i = 0; i < format_num; i++) {
+        /* Initialization is only paid once, later formats report 0 */
+        bench_run_format(fd, formats[i], &cap, i ? 0 : init_us);
+    }
+
+    close(fd);
+}
+
+void app_main(void)
+{
+    /**
+     *  ___ ___ _  _  ___ _  _
+     * | _ ) __| \| |/ __| || |
+     * | _ \ _|| .` | (__| __ |
+     * |___/___|_|\_|\___|_||_|
+    */
+
+    printf("\r\n");
+    printf(" ___ ___ _  _  ___ _  _ \r\n");
+    printf("| _ ) __| \\| |/ __| || |\r\n");
+    printf("| _ \\ _|| .` | (__| __ |\r\n");
+    printf("|___/___|_|\\_|\\___|_||_|\r\n");
+
+    unity_run_menu();
+}
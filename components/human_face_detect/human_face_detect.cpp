@@ -6,16 +6,40 @@ static const char *path = (const char *)human_face_detect_espdl;
 #elif CONFIG_HUMAN_FACE_DETECT_MODEL_IN_FLASH_PARTITION
 static const char *path = "human_face_det";
 #endif
+#define MODEL_INTERNAL_SIZE (CONFIG_HUMAN_FACE_DETECT_MODEL_INTERNAL_RAM_KB * 1024)
+#if CONFIG_HUMAN_FACE_DETECT_MODEL_PARAM_COPY
+#define MODEL_PARAM_COPY (true)
+#else
+#define MODEL_PARAM_COPY (false)
+#endif
 namespace human_face_detect {
 
-MSR::MSR(const char *model_name)
+static FastImagePreprocessor *new_fast_preprocessor(dl::Model *model)
+{
+    // Same normalization and byte order as the generic preprocessor of the stages
+#if CONFIG_IDF_TARGET_ESP32P4
+    return new FastImagePreprocessor(
+        model, {0, 0, 0}, {1, 1, 1}, DL_IMAGE_CAP_RGB_SWAP | DL_IMAGE_CAP_RGB565_BIG_ENDIAN);
+#else
+    return new FastImagePreprocessor(model, {0, 0, 0}, {1, 1, 1}, DL_IMAGE_CAP_RGB_SWAP);
+#endif
+}
+
+MSR::MSR(const char *model_name, bool fast_preprocess) : m_fast_preprocessor(nullptr)
 {
 #if !CONFIG_HUMAN_FACE_DETECT_MODEL_IN_SDCARD
-    m_model = new dl::Model(
-        path, model_name, static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION));
+    m_model = new dl::Model(path,
+                            model_name,
+                            static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION),
+                            MODEL_INTERNAL_SIZE,
+                            dl::MEMORY_MANAGER_GREEDY,
+                            nullptr,
+                            MODEL_PARAM_COPY);
 #else
     m_model =
-        new dl::Model(model_name, static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION));
+        new dl::Model(model_name,
+                      static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION),
+                      MODEL_INTERNAL_SIZE);
 #endif
 #if CONFIG_IDF_TARGET_ESP32P4
     m_image_preprocessor = new dl::image::ImagePreprocessor(
@@ -23,18 +47,54 @@ MSR::MSR(const char *model_name)
 #else
     m_image_preprocessor = new dl::image::ImagePreprocessor(m_model, {0, 0, 0}, {1, 1, 1}, DL_IMAGE_CAP_RGB_SWAP);
 #endif
+    if (fast_preprocess) {
+        m_fast_preprocessor = new_fast_preprocessor(m_model);
+    }
     m_postprocessor = new dl::detect::MSRPostprocessor(
         m_model, 0.5, 0.5, 10, {{8, 8, 9, 9, {{16, 16}, {32, 32}}}, {16, 16, 9, 9, {{64, 64}, {128, 128}}}});
 }
 
-MNP::MNP(const char *model_name)
+MSR::~MSR()
+{
+    if (m_fast_preprocessor) {
+        delete m_fast_preprocessor;
+        m_fast_preprocessor = nullptr;
+    }
+}
+
+std::list<dl::detect::result_t> &MSR::run(const dl::image::img_t &img)
+{
+    if (!m_fast_preprocessor || !m_fast_preprocessor->is_supported(img)) {
+        return DetectImpl::run(img);
+    }
+
+    m_fast_preprocessor->preprocess(img);
+    m_model->run();
+    m_postprocessor->clear_result();
+    m_postprocessor->set_resize_scale_x(m_fast_preprocessor->get_resize_scale_x());
+    m_postprocessor->set_resize_scale_y(m_fast_preprocessor->get_resize_scale_y());
+    m_postprocessor->set_top_left_x(m_fast_preprocessor->get_top_left_x());
+    m_postprocessor->set_top_left_y(m_fast_preprocessor->get_top_left_y());
+    m_postprocessor->postprocess();
+    m_postprocessor->nms();
+    return m_postprocessor->get_result(img.width, img.height);
+}
+
+MNP::MNP(const char *model_name, bool fast_preprocess) : m_fast_preprocessor(nullptr)
 {
 #if !CONFIG_HUMAN_FACE_DETECT_MODEL_IN_SDCARD
-    m_model = new dl::Model(
-        path, model_name, static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION));
+    m_model = new dl::Model(path,
+                            model_name,
+                            static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION),
+                            MODEL_INTERNAL_SIZE,
+                            dl::MEMORY_MANAGER_GREEDY,
+                            nullptr,
+                            MODEL_PARAM_COPY);
 #else
     m_model =
-        new dl::Model(model_name, static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION));
+        new dl::Model(model_name,
+                      static_cast<fbs::model_location_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION),
+                      MODEL_INTERNAL_SIZE);
 #endif
 #if CONFIG_IDF_TARGET_ESP32P4
     m_image_preprocessor = new dl::image::ImagePreprocessor(
@@ -42,6 +102,9 @@ MNP::MNP(const char *model_name)
 #else
     m_image_preprocessor = new dl::image::ImagePreprocessor(m_model, {0, 0, 0}, {1, 1, 1}, DL_IMAGE_CAP_RGB_SWAP);
 #endif
+    if (fast_preprocess) {
+        m_fast_preprocessor = new_fast_preprocessor(m_model);
+    }
     m_postprocessor = new dl::detect::MNPPostprocessor(m_model, 0.5, 0.5, 10, {{1, 1, 0, 0, {{48, 48}}}});
 }
 
@@ -55,16 +118,41 @@ MNP::~MNP()
         delete m_image_preprocessor;
         m_image_preprocessor = nullptr;
     }
+    if (m_fast_preprocessor) {
+        delete m_fast_preprocessor;
+        m_fast_preprocessor = nullptr;
+    }
     if (m_postprocessor) {
         delete m_postprocessor;
         m_postprocessor = nullptr;
     }
 };
 
+bool MNP::is_refined(const std::vector<int> &box) const
+{
+#if CONFIG_HUMAN_FACE_DETECT_MNP_SKIP_IOU > 0
+    int area = (box[2] - box[0]) * (box[3] - box[1]);
+    for (const auto &refined : m_refined_boxes) {
+        int inter_w = DL_MIN(box[2], refined[2]) - DL_MAX(box[0], refined[0]);
+        int inter_h = DL_MIN(box[3], refined[3]) - DL_MAX(box[1], refined[1]);
+        if ((inter_w <= 0) || (inter_h <= 0)) {
+            continue;
+        }
+        int inter = inter_w * inter_h;
+        int uni = area + (refined[2] - refined[0]) * (refined[3] - refined[1]) - inter;
+        if (inter * 100 > CONFIG_HUMAN_FACE_DETECT_MNP_SKIP_IOU * uni) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
 std::list<dl::detect::result_t> &MNP::run(const dl::image::img_t &img, std::list<dl::detect::result_t> &candidates)
 {
-    dl::tool::Latency latency[3] = {dl::tool::Latency(10), dl::tool::Latency(10), dl::tool::Latency(10)};
+    bool fast = m_fast_preprocessor && m_fast_preprocessor->is_supported(img);
     m_postprocessor->clear_result();
+    m_refined_boxes.clear();
     for (auto &candidate : candidates) {
         int center_x = (candidate.box[0] + candidate.box[2]) >> 1;
         int center_y = (candidate.box[1] + candidate.box[3]) >> 1;
@@ -75,29 +163,54 @@ std::list<dl::detect::result_t> &MNP::run(const dl::image::img_t &img, std::list
         candidate.box[3] = candidate.box[1] + side;
         candidate.limit_box(img.width, img.height);
 
-        latency[0].start();
-        m_image_preprocessor->preprocess(img, candidate.box);
-        latency[0].end();
+        // Candidates are sorted by score, the better proposal of a face has already been refined
+        if (is_refined(candidate.box)) {
+            continue;
+        }
+        m_refined_boxes.push_back(candidate.box);
 
-        latency[1].start();
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+        m_latency[0].start();
+#endif
+        if (fast) {
+            m_fast_preprocessor->preprocess(img, candidate.box);
+        } else {
+            m_image_preprocessor->preprocess(img, candidate.box);
+        }
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+        m_latency[0].end();
+        m_latency[1].start();
+#endif
         m_model->run();
-        latency[1].end();
-
-        latency[2].start();
-        m_postprocessor->set_resize_scale_x(m_image_preprocessor->get_resize_scale_x());
-        m_postprocessor->set_resize_scale_y(m_image_preprocessor->get_resize_scale_y());
-        m_postprocessor->set_top_left_x(m_image_preprocessor->get_top_left_x());
-        m_postprocessor->set_top_left_y(m_image_preprocessor->get_top_left_y());
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+        m_latency[1].end();
+        m_latency[2].start();
+#endif
+        if (fast) {
+            m_postprocessor->set_resize_scale_x(m_fast_preprocessor->get_resize_scale_x());
+            m_postprocessor->set_resize_scale_y(m_fast_preprocessor->get_resize_scale_y());
+            m_postprocessor->set_top_left_x(m_fast_preprocessor->get_top_left_x());
+            m_postprocessor->set_top_left_y(m_fast_preprocessor->get_top_left_y());
+        } else {
+            m_postprocessor->set_resize_scale_x(m_image_preprocessor->get_resize_scale_x());
+            m_postprocessor->set_resize_scale_y(m_image_preprocessor->get_resize_scale_y());
+            m_postprocessor->set_top_left_x(m_image_preprocessor->get_top_left_x());
+            m_postprocessor->set_top_left_y(m_image_preprocessor->get_top_left_y());
+        }
         m_postprocessor->postprocess();
-        latency[2].end();
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+        m_latency[2].end();
+#endif
     }
     m_postprocessor->nms();
     std::list<dl::detect::result_t> &result = m_postprocessor->get_result(img.width, img.height);
-    if (candidates.size() > 0) {
-        latency[0].print("detect", "preprocess");
-        latency[1].print("detect", "forward");
-        latency[2].print("detect", "postprocess");
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+    if (!m_refined_boxes.empty()) {
+        m_latency[0].print("detect", "preprocess");
+        m_latency[1].print("detect", "forward");
+        m_latency[2].print("detect", "postprocess");
     }
+#endif
     return result;
 }
 
@@ -121,21 +234,21 @@ std::list<dl::detect::result_t> &MSRMNP::run(const dl::image::img_t &img)
 
 } // namespace human_face_detect
 
-HumanFaceDetect::HumanFaceDetect(const char *sdcard_model_dir, model_type_t model_type)
+HumanFaceDetect::HumanFaceDetect(const char *sdcard_model_dir, model_type_t model_type, bool fast_preprocess)
 {
     switch (model_type) {
     case model_type_t::MSRMNP_S8_V1: {
 #if CONFIG_HUMAN_FACE_DETECT_MSRMNP_S8_V1
 #if !CONFIG_HUMAN_FACE_DETECT_MODEL_IN_SDCARD
-        m_model =
-            new human_face_detect::MSRMNP("human_face_detect_msr_s8_v1.espdl", "human_face_detect_mnp_s8_v1.espdl");
+        m_model = new human_face_detect::MSRMNP(
+            "human_face_detect_msr_s8_v1.espdl", "human_face_detect_mnp_s8_v1.espdl", fast_preprocess);
 #else
         if (sdcard_model_dir) {
             char msr_dir[128];
             snprintf(msr_dir, sizeof(msr_dir), "%s/human_face_detect_msr_s8_v1.espdl", sdcard_model_dir);
             char mnp_dir[128];
             snprintf(mnp_dir, sizeof(mnp_dir), "%s/human_face_detect_mnp_s8_v1.espdl", sdcard_model_dir);
-            m_model = new human_face_detect::MSRMNP(msr_dir, mnp_dir);
+            m_model = new human_face_detect::MSRMNP(msr_dir, mnp_dir, fast_preprocess);
         } else {
             ESP_LOGE("human_face_detect", "please pass sdcard mount point as parameter.");
         }
@@ -3,20 +3,40 @@
 #include "dl_detect_base.hpp"
 #include "dl_detect_mnp_postprocessor.hpp"
 #include "dl_detect_msr_postprocessor.hpp"
+#include "fast_image_preprocessor.hpp"
+
+#if CONFIG_HUMAN_FACE_DETECT_FAST_PREPROCESS
+#define HUMAN_FACE_DETECT_FAST_PREPROCESS_DEFAULT (true)
+#else
+#define HUMAN_FACE_DETECT_FAST_PREPROCESS_DEFAULT (false)
+#endif
+
 namespace human_face_detect {
 class MSR : public dl::detect::DetectImpl {
+protected:
+    FastImagePreprocessor *m_fast_preprocessor;
+
 public:
-    MSR(const char *model_name);
+    MSR(const char *model_name, bool fast_preprocess);
+    ~MSR();
+    std::list<dl::detect::result_t> &run(const dl::image::img_t &img) override;
 };
 
 class MNP {
 private:
     dl::Model *m_model;
     dl::image::ImagePreprocessor *m_image_preprocessor;
+    FastImagePreprocessor *m_fast_preprocessor;
     dl::detect::MNPPostprocessor *m_postprocessor;
+#if CONFIG_HUMAN_FACE_DETECT_LATENCY_LOG
+    dl::tool::Latency m_latency[3] = {dl::tool::Latency(10), dl::tool::Latency(10), dl::tool::Latency(10)};
+#endif
+    std::vector<std::vector<int>> m_refined_boxes;
+
+    bool is_refined(const std::vector<int> &box) const;
 
 public:
-    MNP(const char *model_name);
+    MNP(const char *model_name, bool fast_preprocess);
     ~MNP();
     std::list<dl::detect::result_t> &run(const dl::image::img_t &img, std::list<dl::detect::result_t> &candidates);
 };
@@ -27,10 +47,16 @@ private:
     MNP *m_mnp;
 
 public:
-    MSRMNP(const char *msr_model_name, const char *mnp_model_name) :
-        m_msr(new MSR(msr_model_name)), m_mnp(new MNP(mnp_model_name)) {};
+    MSRMNP(const char *msr_model_name, const char *mnp_model_name, bool fast_preprocess) :
+        m_msr(new MSR(msr_model_name, fast_preprocess)), m_mnp(new MNP(mnp_model_name, fast_preprocess)) {};
     ~MSRMNP();
     std::list<dl::detect::result_t> &run(const dl::image::img_t &img) override;
+    // The stages own separate models and may run on different tasks, each result list is reused by its next run
+    std::list<dl::detect::result_t> &run_msr(const dl::image::img_t &img) { return m_msr->run(img); }
+    std::list<dl::detect::result_t> &run_mnp(const dl::image::img_t &img, std::list<dl::detect::result_t> &candidates)
+    {
+        return m_mnp->run(img, candidates);
+    }
 };
 
 } // namespace human_face_detect
@@ -39,5 +65,7 @@ class HumanFaceDetect : public dl::detect::DetectWrapper {
 public:
     typedef enum { MSRMNP_S8_V1 } model_type_t;
     HumanFaceDetect(const char *sdcard_model_dir = nullptr,
-                    model_type_t model_type = static_cast<model_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_TYPE));
+                    model_type_t model_type = static_cast<model_type_t>(CONFIG_HUMAN_FACE_DETECT_MODEL_TYPE),
+                    bool fast_preprocess = HUMAN_FACE_DETECT_FAST_PREPROCESS_DEFAULT);
+    human_face_detect::MSRMNP *get_msrmnp() { return static_cast<human_face_detect::MSRMNP *>(m_model); }
 };
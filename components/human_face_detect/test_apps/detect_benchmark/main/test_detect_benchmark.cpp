@@ -0,0 +1,426 @@
+/*
+ * SPDX-FileCopyrightText: 2024-2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include "driver/jpeg_decode.h"
+#include "bsp/esp-bsp.h"
+
+#include "human_face_detect.hpp"
+#include "pedestrian_detect.hpp"
+
+#include "unity.h"
+
+#define BENCH_DATASET_DIR       CONFIG_BENCHMARK_DATASET_DIR
+#define BENCH_LABEL_FILE        "labels.txt"
+#define BENCH_IOU_THRESHOLD     (CONFIG_BENCHMARK_IOU_THRESHOLD / 100.0f)
+#define BENCH_WARMUP_RUNS       CONFIG_BENCHMARK_WARMUP_RUNS
+#define BENCH_PATH_LEN          (256)
+#define BENCH_JPEG_TIMEOUT_MS   (200)
+/* The decoder writes whole MCUs */
+#define BENCH_JPEG_ALIGN        (16)
+#define BENCH_STAGE_MAX         (4)
+
+#define BENCH_ALIGN_UP(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
+
+typedef std::array<int, 4> bench_box_t;
+
+typedef struct {
+    std::string file;
+    std::vector<bench_box_t> labels;
+} bench_image_t;
+
+typedef struct {
+    float score;
+    bool true_positive;
+} bench_detection_t;
+
+typedef struct {
+    const char *name;
+    int64_t sum_us;
+    int64_t max_us;
+} bench_stage_t;
+
+typedef struct {
+    size_t internal;
+    size_t psram;
+} bench_mem_t;
+
+/* Runs a DetectImpl model stage by stage, in the same order as DetectImpl::run */
+template <typename T> class BenchStages : public T {
+public:
+    using T::T;
+
+    std::list<dl::detect::result_t> &run(const dl::image::img_t &img, int64_t us[3])
+    {
+        int64_t start_us = esp_timer_get_time();
+        float scale_x, scale_y, left_x, left_y;
+        /* Same choice as the model's own run, the fused path if it was selected and takes the image */
+        if (this->m_fast_preprocessor && this->m_fast_preprocessor->is_supported(img)) {
+            this->m_fast_preprocessor->preprocess(img);
+            scale_x = this->m_fast_preprocessor->get_resize_scale_x();
+            scale_y = this->m_fast_preprocessor->get_resize_scale_y();
+            left_x = this->m_fast_preprocessor->get_top_left_x();
+            left_y = this->m_fast_preprocessor->get_top_left_y();
+        } else {
+            this->m_image_preprocessor->preprocess(img);
+            scale_x = this->m_image_preprocessor->get_resize_scale_x();
+            scale_y = this->m_image_preprocessor->get_resize_scale_y();
+            left_x = this->m_image_preprocessor->get_top_left_x();
+            left_y = this->m_image_preprocessor->get_top_left_y();
+        }
+        int64_t preprocess_us = esp_timer_get_time();
+        this->m_model->run();
+        int64_t forward_us = esp_timer_get_time();
+        this->m_postprocessor->clear_result();
+        this->m_postprocessor->set_resize_scale_x(scale_x);
+        this->m_postprocessor->set_resize_scale_y(scale_y);
+        this->m_postprocessor->set_top_left_x(left_x);
+        this->m_postprocessor->set_top_left_y(left_y);
+        this->m_postprocessor->postprocess();
+        this->m_postprocessor->nms();
+        std::list<dl::detect::result_t> &result = this->m_postprocessor->get_result(img.width, img.height);
+
+        us[0] = preprocess_us - start_us;
+        us[1] = forward_us - preprocess_us;
+        us[2] = esp_timer_get_time() - forward_us;
+        return result;
+    }
+};
+
+static const char *TAG = "detect.bench";
+
+static jpeg_decoder_handle_t bench_jpeg = NULL;
+
+static std::vector<bench_image_t> bench_load_labels(const char *set)
+{
+    char path[BENCH_PATH_LEN];
+    char line[BENCH_PATH_LEN];
+    std::vector<bench_image_t> images;
+
+    snprintf(path, sizeof(path), "%s/%s/%s", BENCH_DATASET_DIR, set, BENCH_LABEL_FILE);
+    FILE *f = fopen(path, "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, "labels not found");
+
+    /* One object per line as `<image> <x1> <y1> <x2> <y2>`, a bare `<image>` has no objects */
+    while (fgets(line, sizeof(line), f)) {
+        char file[128];
+        bench_box_t box;
+        int fields = sscanf(line, "%127s %d %d %d %d", file, &box[0], &box[1], &box[2], &box[3]);
+
+        if ((fields < 1) || (file[0] == '#')) {
+            continue;
+        }
+        if (images.empty() || (images.back().file != file)) {
+            images.push_back({file, {}});
+        }
+        if (fields == 5) {
+            images.back().labels.push_back(box);
+        }
+    }
+    fclose(f);
+
+    return images;
+}
+
+static uint8_t *bench_decode(const char *set, const char *file, dl::image::img_t *img)
+{
+    char path[BENCH_PATH_LEN];
+    size_t in_size = 0;
+    size_t out_size = 0;
+    uint32_t decoded = 0;
+    jpeg_decode_picture_info_t info;
+    jpeg_decode_memory_alloc_cfg_t in_cfg = {
+        .buffer_direction = JPEG_DEC_ALLOC_INPUT_BUFFER,
+    };
+    jpeg_decode_memory_alloc_cfg_t out_cfg = {
+        .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
+    };
+    /* Same byte order as the PPA RGB888 output the Camera app feeds the models */
+    jpeg_decode_cfg_t decode_cfg = {
+        .output_format = JPEG_DECODE_OUT_FORMAT_RGB888,
+        .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+        .conv_std = JPEG_YUV_RGB_CONV_STD_BT601,
+    };
+
+    snprintf(path, sizeof(path), "%s/%s/%s", BENCH_DATASET_DIR, set, file);
+    FILE *f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL_MESSAGE(f, "image not found");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *in = (uint8_t *)jpeg_alloc_decoder_mem(size, &in_cfg, &in_size);
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_EQUAL(size, fread(in, 1, size, f));
+    fclose(f);
+
+    TEST_ESP_OK(jpeg_decoder_get_info(in, size, &info));
+    uint32_t width = BENCH_ALIGN_UP(info.width, BENCH_JPEG_ALIGN);
+    uint32_t height = BENCH_ALIGN_UP(info.height, BENCH_JPEG_ALIGN);
+    uint8_t *out = (uint8_t *)jpeg_alloc_decoder_mem(width * height * 3, &out_cfg, &out_size);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ESP_OK(jpeg_decoder_process(bench_jpeg, &decode_cfg, in, size, out, out_size, &decoded));
+    free(in);
+
+    img->data = out;
+    img->width = width;
+    img->height = height;
+    img->pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
+    return out;
+}
+
+static float bench_iou(const std::vector<int> &a, const bench_box_t &b)
+{
+    int inter_w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    int inter_h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+
+    if ((inter_w <= 0) || (inter_h <= 0)) {
+        return 0;
+    }
+    float inter = (float)inter_w * inter_h;
+    float uni = (float)(a[2] - a[0]) * (a[3] - a[1]) + (float)(b[2] - b[0]) * (b[3] - b[1]) - inter;
+
+    return inter / uni;
+}
+
+/* Greedy matching in score order, every label can be claimed by a single detection */
+static void bench_match(const std::list<dl::detect::result_t> &results, const std::vector<bench_box_t> &labels,
+                        std::vector<bench_detection_t> &detections)
+{
+    std::vector<const dl::detect::result_t *> sorted;
+    std::vector<bool> claimed(labels.size(), false);
+
+    for (const auto &res : results) {
+        sorted.push_back(&res);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) { return a->score > b->score; });
+
+    for (const auto *res : sorted) {
+        int best = -1;
+        float best_iou = BENCH_IOU_THRESHOLD;
+
+        for (size_t i = 0; i < labels.size(); i++) {
+            float iou = bench_iou(res->box, labels[i]);
+            if (!claimed[i] && (iou >= best_iou)) {
+                best = i;
+                best_iou = iou;
+            }
+        }
+        if (best >= 0) {
+            claimed[best] = true;
+        }
+        detections.push_back({res->score, best >= 0});
+    }
+}
+
+/* Area under the interpolated precision / recall curve */
+static float bench_average_precision(std::vector<bench_detection_t> &detections, uint32_t label_num)
+{
+    std::vector<float> precision;
+    std::vector<float> recall;
+    uint32_t tp = 0;
+    float ap = 0;
+
+    if (label_num == 0) {
+        return 0;
+    }
+    std::sort(detections.begin(), detections.end(), [](const auto &a, const auto &b) { return a.score > b.score; });
+    for (size_t i = 0; i < detections.size(); i++) {
+        tp += detections[i].true_positive;
+        precision.push_back((float)tp / (i + 1));
+        recall.push_back((float)tp / label_num);
+    }
+    for (int i = (int)precision.size() - 2; i >= 0; i--) {
+        precision[i] = std::max(precision[i], precision[i + 1]);
+    }
+    for (size_t i = 0; i < precision.size(); i++) {
+        ap += (recall[i] - (i ? recall[i - 1] : 0)) * precision[i];
+    }
+
+    return ap;
+}
+
+static bench_mem_t bench_free(void)
+{
+    return {heap_caps_get_free_size(MALLOC_CAP_INTERNAL), heap_caps_get_free_size(MALLOC_CAP_SPIRAM)};
+}
+
+static const char *bench_location(int location)
+{
+    switch (location) {
+    case 0:
+        return "flash_rodata";
+    case 1:
+        return "flash_partition";
+    default:
+        return "sdcard";
+    }
+}
+
+static std::string bench_model_path(const char *name, int location)
+{
+#if CONFIG_HUMAN_FACE_DETECT_MODEL_IN_SDCARD || CONFIG_PEDESTRIAN_DETECT_MODEL_IN_SDCARD
+    if (location == 2) {
+        return std::string(CONFIG_BENCHMARK_MODEL_DIR "/") + name;
+    }
+#endif
+    return name;
+}
+
+static void bench_report(const char *model, int location, size_t image_num, int64_t load_us, const bench_stage_t *stages,
+                         int stage_num, const bench_mem_t &load, const bench_mem_t &peak, float ap)
+{
+    int64_t total_us = 0;
+
+    printf("BENCHMARK_RESULT {\"model\":\"%s\",\"location\":\"%s\",\"images\":%u,\"load_us\":%" PRId64 ",\"stages\":{",
+           model, bench_location(location), (unsigned)image_num, load_us);
+    for (int i = 0; i < stage_num; i++) {
+        int64_t avg_us = image_num ? stages[i].sum_us / (int64_t)image_num : 0;
+        total_us += avg_us;
+        printf("%s\"%s\":{\"avg_us\":%" PRId64 ",\"max_us\":%" PRId64 "}", i ? "," : "", stages[i].name, avg_us,
+               stages[i].max_us);
+    }
+    printf("},\"total_avg_us\":%" PRId64 ",\"mem_load_kb\":{\"internal\":%u,\"psram\":%u},"
+           "\"mem_peak_kb\":{\"internal\":%u,\"psram\":%u},\"ap%d\":%.4f}\n",
+           total_us, (unsigned)(load.internal / 1024), (unsigned)(load.psram / 1024), (unsigned)(peak.internal / 1024),
+           (unsigned)(peak.psram / 1024), CONFIG_BENCHMARK_IOU_THRESHOLD, ap);
+}
+
+static void bench_stage_add(bench_stage_t *stage, int64_t us)
+{
+    stage->sum_us += us;
+    stage->max_us = std::max(stage->max_us, us);
+}
+
+/* `run` fills the stage times of one image and returns its results */
+template <typename F>
+static void bench_run_set(const char *set, const char *model, int location, int64_t load_us, const bench_mem_t &before,
+                          bench_stage_t *stages, int stage_num, F run)
+{
+    std::vector<bench_image_t> images = bench_load_labels(set);
+    std::vector<bench_detection_t> detections;
+    uint32_t label_num = 0;
+    bench_mem_t loaded = bench_free();
+
+    TEST_ASSERT_MESSAGE(!images.empty(), "empty data set");
+    ESP_LOGI(TAG, "%s: %u images", set, (unsigned)images.size());
+
+    heap_caps_monitor_local_minimum_free_size_start();
+    for (size_t i = 0; i < images.size(); i++) {
+        dl::image::img_t img;
+        int64_t us[BENCH_STAGE_MAX] = {};
+        uint8_t *buf = bench_decode(set, images[i].file.c_str(), &img);
+
+        for (int j = 0; (i == 0) && (j < BENCH_WARMUP_RUNS); j++) {
+            run(img, us);
+        }
+        std::list<dl::detect::result_t> &results = run(img, us);
+        for (int j = 0; j < stage_num; j++) {
+            bench_stage_add(&stages[j], us[j]);
+        }
+        bench_match(results, images[i].labels, detections);
+        label_num += images[i].labels.size();
+        free(buf);
+    }
+    bench_mem_t peak = {
+        before.internal - heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+        before.psram - heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM),
+    };
+    heap_caps_monitor_local_minimum_free_size_stop();
+
+    bench_mem_t load = {before.internal - loaded.internal, before.psram - loaded.psram};
+    bench_report(model, location, images.size(), load_us, stages, stage_num, load, peak,
+                 bench_average_precision(detections, label_num));
+}
+
+TEST_CASE("Human face detect benchmark", "[dl][benchmark]")
+{
+    const int location = CONFIG_HUMAN_FACE_DETECT_MODEL_LOCATION;
+    bench_stage_t stages[] = {
+        {"msr_preprocess", 0, 0},
+        {"msr_forward", 0, 0},
+        {"msr_postprocess", 0, 0},
+        {"mnp", 0, 0},
+    };
+
+    bench_mem_t before = bench_free();
+    int64_t start_us = esp_timer_get_time();
+    auto *msr = new BenchStages<human_face_detect::MSR>(
+        bench_model_path("human_face_detect_msr_s8_v1.espdl", location).c_str(), HUMAN_FACE_DETECT_FAST_PREPROCESS_DEFAULT);
+    auto *mnp = new human_face_detect::MNP(bench_model_path("human_face_detect_mnp_s8_v1.espdl", location).c_str(),
+                                           HUMAN_FACE_DETECT_FAST_PREPROCESS_DEFAULT);
+    int64_t load_us = esp_timer_get_time() - start_us;
+
+    /* The MNP internals are private, it is timed as a whole */
+    bench_run_set("face", "human_face_detect_msrmnp_s8_v1", location, load_us, before, stages, 4,
+    [&](const dl::image::img_t &img, int64_t *us) -> std::list<dl::detect::result_t> & {
+        std::list<dl::detect::result_t> &candidates = msr->run(img, us);
+        int64_t mnp_start_us = esp_timer_get_time();
+        std::list<dl::detect::result_t> &results = mnp->run(img, candidates);
+        us[3] = esp_timer_get_time() - mnp_start_us;
+        return results;
+    });
+
+    delete mnp;
+    delete msr;
+}
+
+TEST_CASE("Pedestrian detect benchmark", "[dl][benchmark]")
+{
+    const int location = CONFIG_PEDESTRIAN_DETECT_MODEL_LOCATION;
+    bench_stage_t stages[] = {
+        {"preprocess", 0, 0},
+        {"forward", 0, 0},
+        {"postprocess", 0, 0},
+    };
+
+    bench_mem_t before = bench_free();
+    int64_t start_us = esp_timer_get_time();
+    auto *pico = new BenchStages<pedestrian_detect::Pico>(
+        bench_model_path("pedestrian_detect_pico_s8_v1.espdl", location).c_str(), PEDESTRIAN_DETECT_FAST_PREPROCESS_DEFAULT);
+    int64_t load_us = esp_timer_get_time() - start_us;
+
+    bench_run_set("pedestrian", "pedestrian_detect_pico_s8_v1", location, load_us, before, stages, 3,
+    [&](const dl::image::img_t &img, int64_t *us) -> std::list<dl::detect::result_t> & {
+        return pico->run(img, us);
+    });
+
+    delete pico;
+}
+
+extern "C" void app_main(void)
+{
+    /**
+     *  ___ ___ _  _  ___ _  _
+     * | _ ) __| \| |/ __| || |
+     * | _ \ _|| .` | (__| __ |
+     * |___/___|_|\_|\___|_||_|
+    */
+
+    printf("\r\n");
+    printf(" ___ ___ _  _  ___ _  _ \r\n");
+    printf("| _ ) __| \\| |/ __| || |\r\n");
+    printf("| _ \\ _|| .` | (__| __ |\r\n");
+    printf("|___/___|_|\\_|\\___|_||_|\r\n");
+
+    jpeg_decode_engine_cfg_t decode_eng_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = BENCH_JPEG_TIMEOUT_MS,
+    };
+    ESP_ERROR_CHECK(bsp_sdcard_mount());
+    ESP_ERROR_CHECK(jpeg_new_decoder_engine(&decode_eng_cfg, &bench_jpeg));
+
+    unity_run_menu();
+}
@@ -6,16 +6,29 @@ static const char *path = (const char *)pedestrian_detect_espdl;
 #elif CONFIG_PEDESTRIAN_DETECT_MODEL_IN_FLASH_PARTITION
 static const char *path = "pedestrian_det";
 #endif
+#define MODEL_INTERNAL_SIZE (CONFIG_PEDESTRIAN_DETECT_MODEL_INTERNAL_RAM_KB * 1024)
+#if CONFIG_PEDESTRIAN_DETECT_MODEL_PARAM_COPY
+#define MODEL_PARAM_COPY (true)
+#else
+#define MODEL_PARAM_COPY (false)
+#endif
 namespace pedestrian_detect {
 
-Pico::Pico(const char *model_name)
+Pico::Pico(const char *model_name, bool fast_preprocess) : m_fast_preprocessor(nullptr)
 {
 #if !CONFIG_PEDESTRIAN_DETECT_MODEL_IN_SDCARD
-    m_model = new dl::Model(
-        path, model_name, static_cast<fbs::model_location_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_LOCATION));
+    m_model = new dl::Model(path,
+                            model_name,
+                            static_cast<fbs::model_location_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_LOCATION),
+                            MODEL_INTERNAL_SIZE,
+                            dl::MEMORY_MANAGER_GREEDY,
+                            nullptr,
+                            MODEL_PARAM_COPY);
 #else
     m_model =
-        new dl::Model(model_name, static_cast<fbs::model_location_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_LOCATION));
+        new dl::Model(model_name,
+                      static_cast<fbs::model_location_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_LOCATION),
+                      MODEL_INTERNAL_SIZE);
 #endif
 #if CONFIG_IDF_TARGET_ESP32P4
     m_image_preprocessor =
@@ -23,24 +36,57 @@ Pico::Pico(const char *model_name)
 #else
     m_image_preprocessor = new dl::image::ImagePreprocessor(m_model, {0, 0, 0}, {1, 1, 1});
 #endif
+    if (fast_preprocess) {
+#if CONFIG_IDF_TARGET_ESP32P4
+        m_fast_preprocessor = new FastImagePreprocessor(m_model, {0, 0, 0}, {1, 1, 1}, DL_IMAGE_CAP_RGB565_BIG_ENDIAN);
+#else
+        m_fast_preprocessor = new FastImagePreprocessor(m_model, {0, 0, 0}, {1, 1, 1});
+#endif
+    }
     m_postprocessor =
         new dl::detect::PicoPostprocessor(m_model, 0.5, 0.5, 10, {{8, 8, 4, 4}, {16, 16, 8, 8}, {32, 32, 16, 16}});
 }
 
+Pico::~Pico()
+{
+    if (m_fast_preprocessor) {
+        delete m_fast_preprocessor;
+        m_fast_preprocessor = nullptr;
+    }
+}
+
+std::list<dl::detect::result_t> &Pico::run(const dl::image::img_t &img)
+{
+    if (!m_fast_preprocessor || !m_fast_preprocessor->is_supported(img)) {
+        return DetectImpl::run(img);
+    }
+
+    m_fast_preprocessor->preprocess(img);
+    m_model->run();
+    m_postprocessor->clear_result();
+    m_postprocessor->set_resize_scale_x(m_fast_preprocessor->get_resize_scale_x());
+    m_postprocessor->set_resize_scale_y(m_fast_preprocessor->get_resize_scale_y());
+    m_postprocessor->set_top_left_x(m_fast_preprocessor->get_top_left_x());
+    m_postprocessor->set_top_left_y(m_fast_preprocessor->get_top_left_y());
+    m_postprocessor->postprocess();
+    m_postprocessor->nms();
+    return m_postprocessor->get_result(img.width, img.height);
+}
+
 } // namespace pedestrian_detect
 
-PedestrianDetect::PedestrianDetect(const char *sdcard_model_dir, model_type_t model_type)
+PedestrianDetect::PedestrianDetect(const char *sdcard_model_dir, model_type_t model_type, bool fast_preprocess)
 {
     switch (model_type) {
     case model_type_t::PICO_S8_V1:
 #if CONFIG_PEDESTRIAN_DETECT_PICO_S8_V1
 #if !CONFIG_PEDESTRIAN_DETECT_MODEL_IN_SDCARD
-        m_model = new pedestrian_detect::Pico("pedestrian_detect_pico_s8_v1.espdl");
+        m_model = new pedestrian_detect::Pico("pedestrian_detect_pico_s8_v1.espdl", fast_preprocess);
 #else
         if (sdcard_model_dir) {
             char pico_dir[128];
             snprintf(pico_dir, sizeof(pico_dir), "%s/pedestrian_detect_pico_s8_v1.espdl", sdcard_model_dir);
-            m_model = new pedestrian_detect::Pico(pico_dir);
+            m_model = new pedestrian_detect::Pico(pico_dir, fast_preprocess);
         } else {
             ESP_LOGE("human_face_detect", "please pass sdcard mount point as parameter.");
         }
@@ -2,11 +2,23 @@
 
 #include "dl_detect_base.hpp"
 #include "dl_detect_pico_postprocessor.hpp"
+#include "fast_image_preprocessor.hpp"
+
+#if CONFIG_PEDESTRIAN_DETECT_FAST_PREPROCESS
+#define PEDESTRIAN_DETECT_FAST_PREPROCESS_DEFAULT (true)
+#else
+#define PEDESTRIAN_DETECT_FAST_PREPROCESS_DEFAULT (false)
+#endif
 
 namespace pedestrian_detect {
 class Pico : public dl::detect::DetectImpl {
+protected:
+    FastImagePreprocessor *m_fast_preprocessor;
+
 public:
-    Pico(const char *model_name);
+    Pico(const char *model_name, bool fast_preprocess);
+    ~Pico();
+    std::list<dl::detect::result_t> &run(const dl::image::img_t &img) override;
 };
 } // namespace pedestrian_detect
 
@@ -14,5 +26,6 @@ class PedestrianDetect : public dl::detect::DetectWrapper {
 public:
     typedef enum { PICO_S8_V1 } model_type_t;
     PedestrianDetect(const char *sdcard_model_dir = nullptr,
-                     model_type_t model_type = static_cast<model_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_TYPE));
+                     model_type_t model_type = static_cast<model_type_t>(CONFIG_PEDESTRIAN_DETECT_MODEL_TYPE),
+                     bool fast_preprocess = PEDESTRIAN_DETECT_FAST_PREPROCESS_DEFAULT);
 };
@@ -0,0 +1,90 @@
+#include "boot_tasks.hpp"
+#include "esp_log.h"
+#include "esp_brookesia.h"
+
+#define BOOT_TASK_STACK_SIZE    (6 * 1024)
+#define BOOT_TASK_PRIORITY      (3)     // Below the LVGL task, so the home screen keeps rendering
+
+static const char *TAG = "BootTasks";
+
+BootTasks::BootTasks() :
+    _steps(),
+    _step_num(0),
+    _all_bits(0),
+    _done(xEventGroupCreate()) {
+}
+
+BootTasks::~BootTasks() {
+    if (_done != nullptr) {
+        vEventGroupDelete(_done);
+    }
+}
+
+EventBits_t BootTasks::add(const char *name, StepFunc func, void *arg, EventBits_t deps, BaseType_t core) {
+    if (_step_num >= STEP_NUM_MAX || func == nullptr || (deps & ~_all_bits) != 0) {
+        ESP_LOGE(TAG, "Invalid step %s", name);
+        return 0;
+    }
+
+    EventBits_t bit = (EventBits_t)1 << _step_num;
+    _steps[_step_num] = {
+        .owner = this,
+        .name = name,
+        .func = func,
+        .arg = arg,
+        .deps = deps,
+        .bit = bit,
+        .core = core,
+    };
+    _step_num++;
+    _all_bits |= bit;
+
+    return bit;
+}
+
+bool BootTasks::start() {
+    if (_done == nullptr) {
+        return false;
+    }
+
+#if CONFIG_EXAMPLE_BOOT_PARALLEL
+    for (int i = 0; i < _step_num; i++) {
+        if (xTaskCreatePinnedToCore(stepTask, _steps[i].name, BOOT_TASK_STACK_SIZE, &_steps[i], BOOT_TASK_PRIORITY,
+                                    nullptr, _steps[i].core) != pdPASS) {
+            // Run it here instead, the steps after it still get their dependency
+            ESP_LOGW(TAG, "Failed to create task of %s, run it inline", _steps[i].name);
+            wait(_steps[i].deps);
+            runStep(&_steps[i]);
+        }
+    }
+#else
+    // Dependencies always refer to earlier steps, so the order they were added in is a valid order
+    for (int i = 0; i < _step_num; i++) {
+        runStep(&_steps[i]);
+    }
+#endif
+
+    return true;
+}
+
+void BootTasks::wait(EventBits_t bits) {
+    if (bits == 0 || _done == nullptr) {
+        return;
+    }
+    xEventGroupWaitBits(_done, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+void BootTasks::runStep(Step *step) {
+    int span = esp_brookesia_core_boot_profile_begin(step->name);
+    step->func(step->arg);
+    esp_brookesia_core_boot_profile_end(span);
+    xEventGroupSetBits(step->owner->_done, step->bit);
+}
+
+void BootTasks::stepTask(void *arg) {
+    Step *step = static_cast<Step *>(arg);
+
+    step->owner->wait(step->deps);
+    runStep(step);
+    vTaskDelete(nullptr);
+}
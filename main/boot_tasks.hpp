@@ -0,0 +1,63 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+/**
+ * @class BootTasks
+ * @brief Runs independent boot steps on their own tasks, a step starts once the steps it depends on are done
+ *
+ * With CONFIG_EXAMPLE_BOOT_PARALLEL disabled, start() runs the steps one after another on the calling task in
+ * dependency order instead. Every step is recorded in the boot profile under its name.
+ */
+class BootTasks {
+public:
+    typedef void (*StepFunc)(void *arg);
+
+    static const int STEP_NUM_MAX = 8;
+
+    BootTasks();
+    ~BootTasks();
+
+    /**
+     * @brief Add a step, must be called before start()
+     *
+     * @param deps Bits of the steps that must be done first, 0 for none
+     * @param core Core of the step task, tskNO_AFFINITY to let the scheduler choose
+     *
+     * @return Bit of the step, 0 on failure
+     */
+    EventBits_t add(const char *name, StepFunc func, void *arg, EventBits_t deps, BaseType_t core);
+
+    bool start();
+
+    /**
+     * @brief Block until the given steps are done
+     */
+    void wait(EventBits_t bits);
+
+    /**
+     * @brief Block until all steps are done, the object must not be destroyed before
+     */
+    void waitAll() { wait(_all_bits); }
+
+private:
+    struct Step {
+        BootTasks *owner;
+        const char *name;
+        StepFunc func;
+        void *arg;
+        EventBits_t deps;
+        EventBits_t bit;
+        BaseType_t core;
+    };
+
+    static void stepTask(void *arg);
+    static void runStep(Step *step);
+
+    Step _steps[STEP_NUM_MAX];
+    int _step_num;
+    EventBits_t _all_bits;
+    EventGroupHandle_t _done;
+};
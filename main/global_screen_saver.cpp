@@ -1,7 +1,21 @@
 #include "global_screen_saver.hpp"
 #include "esp_log.h"
-#include "nvs_flash.h"
-#include "nvs.h"
+#include "settings_store/settings_store.h"
+#include "backlight/backlight.h"
+#include "pm_policy/pm_policy.h"
+#include "panel_power/panel_power.h"
+
+#define SCREEN_SAVER_CHECK_MIN_MS       (100)
+#define SCREEN_SAVER_CHECK_MAX_MS       (5 * 1000)  // Longest wait of the check, a new timeout is seen after it
+#define SCREEN_SAVER_DIM_LEAD_MS        (10 * 1000) // Dimmed this long before the timeout, at most half of it
+#define SCREEN_SAVER_DIM_BRIGHTNESS     (5)
+#define SCREEN_SAVER_SLEEP_DELAY_MS     (30 * 1000) // Light sleep allowed this long after the screen is off
+#define SCREEN_SAVER_FADE_ON_MS         (150)
+#define SCREEN_SAVER_FADE_DIM_MS        (500)
+#define SCREEN_SAVER_FADE_OFF_MS        (300)
+#define SCREEN_SAVER_READ_IDLE_MS       (2 * 1000)  // Touch read at its full rate this long after the last press
+#define SCREEN_SAVER_READ_IDLE_PERIOD   (60)        // Touch read period while idle, delay of the first touch
+#define SCREEN_SAVER_READ_OFF_PERIOD    (200)       // Touch read period while the screen is off, only waits for a wake
 
 static const char *TAG = "GlobalScreenSaver";
 
@@ -11,83 +25,64 @@ GlobalScreenSaver& GlobalScreenSaver::getInstance() {
 }
 
 GlobalScreenSaver::~GlobalScreenSaver() {
-    if (_screen_saver_timer != nullptr) {
-        esp_timer_delete(_screen_saver_timer);
-        _screen_saver_timer = nullptr;
+    if (_check_timer != nullptr) {
+        lv_timer_del(_check_timer);
+        _check_timer = nullptr;
+    }
+    if (_lock != nullptr) {
+        vSemaphoreDelete(_lock);
+        _lock = nullptr;
     }
 }
 
-void GlobalScreenSaver::init() {
+void GlobalScreenSaver::init(ESP_Brookesia_Core *core) {
     if (_is_initialized) {
         return;
     }
-    
-    // Create high-precision timer
-    esp_timer_create_args_t timer_config = {
-        .callback = screenSaverTimerCallback,
-        .arg = this,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "screen_saver_timer",
-        .skip_unhandled_events = false
-    };
-    
-    esp_err_t ret = esp_timer_create(&timer_config, &_screen_saver_timer);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create screen saver timer: %s", esp_err_to_name(ret));
+    _core = core;
+
+    _lock = xSemaphoreCreateMutex();
+    if (_lock == nullptr) {
+        ESP_LOGE(TAG, "Failed to create lock");
         return;
     }
-    
-    // Load timeout from NVS (使用独立的屏保命名空间)
-    nvs_handle_t nvs_handle;
-    ret = nvs_open("screen_saver", NVS_READONLY, &nvs_handle);
-    if (ret == ESP_OK) {
-        size_t required_size = 0;
-        ret = nvs_get_blob(nvs_handle, "timeout", NULL, &required_size);
-        if (ret == ESP_OK && required_size == sizeof(int)) {
-            nvs_get_blob(nvs_handle, "timeout", &_timeout_seconds, &required_size);
-            ESP_LOGI(TAG, "Loaded screen saver timeout: %d seconds", _timeout_seconds);
-        }
-        nvs_close(nvs_handle);
+
+    // The panel scans its frame buffer out until the sleep stage, the app and touch activity raise the CPU clock
+    pm_policy_acquire(PM_POLICY_CLIENT_DISPLAY);
+
+    // The stages are checked by a timer of the LVGL task armed for the next one, so an idle UI has no wakeup of its own
+    _check_timer = lv_timer_create(checkTimerCallback, SCREEN_SAVER_CHECK_MAX_MS, this);
+    if (_check_timer == nullptr) {
+        ESP_LOGE(TAG, "Failed to create screen saver timer");
+        return;
     }
-    
-    // Create a high-frequency timer to monitor touch input device directly
+
+    // The timeout is the one of the Setting app, follow its changes
+    int timeout_seconds = settings_store_get(SETTINGS_KEY_SCREEN_TIMEOUT);
+    _timeout_seconds = (timeout_seconds > 0) ? timeout_seconds : 30;
+    if (settings_store_register_callback(settingsChangeCallback, this) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to follow the settings changes");
+    }
+
+    // Get every sample of the touch device from its read timer instead of polling it
     // This ensures touch detection works even when screen is off or UI is changed
-    lv_timer_create([](lv_timer_t * timer) {
-        static lv_indev_state_t last_state = LV_INDEV_STATE_RELEASED;
-        static bool first_run = true;
-        
-        GlobalScreenSaver* instance = &GlobalScreenSaver::getInstance();
-        
-        lv_indev_t *indev = lv_indev_get_next(NULL);
-        while (indev != NULL) {
-            if (lv_indev_get_type(indev) == LV_INDEV_TYPE_POINTER) {
-                lv_indev_state_t current_state = indev->proc.state;
-                
-                // Detect touch press events
-                if (current_state == LV_INDEV_STATE_PRESSED && last_state == LV_INDEV_STATE_RELEASED) {
-                    ESP_LOGI(TAG, "Direct touch input detected - waking up");
-                    instance->onUserActivity();
-                }
-                
-                last_state = current_state;
-                break;
-            }
-            indev = lv_indev_get_next(indev);
-        }
-        
-        if (first_run) {
-            ESP_LOGI(TAG, "Direct touch monitoring timer started");
-            first_run = false;
-        }
-    }, 20, nullptr);  // Check every 20ms for very fast response
-    
-    ESP_LOGI(TAG, "High-frequency touch monitoring initialized");
-    
-    // Start the timer
-    startTimer();
-    
+    lv_indev_t *indev = lv_indev_get_next(NULL);
+    while (indev != NULL && lv_indev_get_type(indev) != LV_INDEV_TYPE_POINTER) {
+        indev = lv_indev_get_next(indev);
+    }
+    if (indev != NULL && esp_brookesia_core_touch_hook_add(indev, touchSampleCallback, this)) {
+        ESP_LOGI(TAG, "Touch monitoring hooked");
+        _read_timer = indev->driver->read_timer;
+        _read_period_ms = (_read_timer != nullptr) ? _read_timer->period : 0;
+    } else {
+        ESP_LOGE(TAG, "Failed to hook touch input device");
+    }
+
+    _last_activity_us = esp_timer_get_time();
+    lv_timer_set_period(_check_timer, getCheckDelayMs());
+
     _is_initialized = true;
-    ESP_LOGI(TAG, "GlobalScreenSaver initialized with %d seconds timeout", _timeout_seconds);
+    ESP_LOGI(TAG, "GlobalScreenSaver initialized with %d seconds timeout", _timeout_seconds.load());
 }
 
 void GlobalScreenSaver::setTimeoutSeconds(int timeout_seconds) {
@@ -95,144 +90,234 @@ void GlobalScreenSaver::setTimeoutSeconds(int timeout_seconds) {
         ESP_LOGW(TAG, "Invalid timeout: %d, using default 30 seconds", timeout_seconds);
         timeout_seconds = 30;
     }
-    
+
+    // Taken into account by the next check, at most `SCREEN_SAVER_CHECK_MAX_MS` later, the inactivity is counted from
+    // the last touch
     _timeout_seconds = timeout_seconds;
-    
-    // Save to NVS (使用独立的屏保命名空间)
-    nvs_handle_t nvs_handle;
-    esp_err_t ret = nvs_open("screen_saver", NVS_READWRITE, &nvs_handle);
-    if (ret == ESP_OK) {
-        ret = nvs_set_blob(nvs_handle, "timeout", &_timeout_seconds, sizeof(_timeout_seconds));
-        if (ret == ESP_OK) {
-            nvs_commit(nvs_handle);
-            ESP_LOGI(TAG, "Saved screen saver timeout: %d seconds", _timeout_seconds);
-        }
-        nvs_close(nvs_handle);
-    }
-    
-    // Restart timer with new timeout
-    if (_is_initialized && !_screen_is_off) {
-        startTimer();
-    }
+    ESP_LOGI(TAG, "Screen saver timeout: %d seconds", timeout_seconds);
 }
 
 void GlobalScreenSaver::onUserActivity() {
-    if (!_is_initialized) {
+    // Called for every pressed sample, only a timestamp unless the screen has to be woken up
+    _last_activity_us.store(esp_timer_get_time(), std::memory_order_relaxed);
+    if (!_is_initialized || (_stage.load() == STAGE_ACTIVE)) {
         return;
     }
-    
-    ESP_LOGI(TAG, "User activity detected");
-    
-    // If screen is off, turn it on
-    if (_screen_is_off) {
-        turnOnScreen();
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_stage.load() != STAGE_ACTIVE) {
+        enterStage(STAGE_ACTIVE);
     }
-    
-    // Restart timer
-    startTimer();
+    xSemaphoreGive(_lock);
 }
 
 void GlobalScreenSaver::turnOffScreen() {
-    if (_screen_is_off) {
+    if (!_is_initialized) {
         return;
     }
-    
-    ESP_LOGI(TAG, "Turning off screen");
-    // Note: We don't save brightness here anymore, we'll read it fresh when turning on
-    bsp_display_brightness_set(0);  // Turn off by setting brightness to 0
-    _screen_is_off = true;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_stage.load() < STAGE_OFF) {
+        enterStage(STAGE_OFF);
+    }
+    xSemaphoreGive(_lock);
 }
 
 void GlobalScreenSaver::turnOnScreen() {
-    if (!_screen_is_off) {
-        return;
-    }
-    
-    ESP_LOGI(TAG, "Turning on screen");
-    // Always read the latest brightness setting from NVS when turning on
-    int latest_brightness = getCurrentBrightness();
-    ESP_LOGI(TAG, "Restoring to latest brightness: %d%%", latest_brightness);
-    bsp_display_brightness_set(latest_brightness);
-    _screen_is_off = false;
-    
-    // Restart timer after turning on screen
-    startTimer();
+    onUserActivity();
 }
 
-void GlobalScreenSaver::screenSaverTimerCallback(void* arg) {
-    GlobalScreenSaver* instance = static_cast<GlobalScreenSaver*>(arg);
-    if (instance != nullptr) {
-        ESP_LOGI(TAG, "Screen saver timer expired, turning off screen");
-        instance->turnOffScreen();
+void GlobalScreenSaver::checkInactivity() {
+    int64_t idle_ms = (esp_timer_get_time() - _last_activity_us.load(std::memory_order_relaxed)) / 1000;
+    int64_t timeout_ms = (int64_t)_timeout_seconds.load() * 1000;
+    int64_t dim_lead_ms = (timeout_ms / 2 < SCREEN_SAVER_DIM_LEAD_MS) ? timeout_ms / 2 : SCREEN_SAVER_DIM_LEAD_MS;
+    Stage target = STAGE_ACTIVE;
+
+    if (idle_ms >= timeout_ms + SCREEN_SAVER_SLEEP_DELAY_MS) {
+        target = STAGE_SLEEP;
+    } else if (idle_ms >= timeout_ms) {
+        target = STAGE_OFF;
+    } else if (idle_ms >= timeout_ms - dim_lead_ms) {
+        target = STAGE_DIMMED;
+    }
+
+    // Only moves forward here, going back to active is done by the touches
+    if (target <= _stage.load()) {
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (target > _stage.load()) {
+        enterStage(target);
     }
+    xSemaphoreGive(_lock);
 }
 
-void GlobalScreenSaver::globalTouchEventCallback(lv_event_t* e) {
-    lv_event_code_t code = lv_event_get_code(e);
-    GlobalScreenSaver* instance = static_cast<GlobalScreenSaver*>(lv_event_get_user_data(e));
-    
-    if (instance != nullptr && (code == LV_EVENT_PRESSED || code == LV_EVENT_CLICKED || code == LV_EVENT_RELEASED)) {
-        ESP_LOGI(TAG, "Touch event detected: %d", code);
-        instance->onUserActivity();
+uint32_t GlobalScreenSaver::getCheckDelayMs() {
+    int64_t idle_ms = (esp_timer_get_time() - _last_activity_us.load(std::memory_order_relaxed)) / 1000;
+    int64_t timeout_ms = (int64_t)_timeout_seconds.load() * 1000;
+    int64_t dim_lead_ms = (timeout_ms / 2 < SCREEN_SAVER_DIM_LEAD_MS) ? timeout_ms / 2 : SCREEN_SAVER_DIM_LEAD_MS;
+    // Idle time at which the stage after each one starts: dimmed, off, sleep
+    const int64_t next_stage_ms[STAGE_SLEEP] = {
+        timeout_ms - dim_lead_ms,
+        timeout_ms,
+        timeout_ms + SCREEN_SAVER_SLEEP_DELAY_MS,
+    };
+    Stage stage = _stage.load();
+
+    if (stage >= STAGE_SLEEP) {
+        return 0;
     }
+    int64_t delay_ms = next_stage_ms[stage] - idle_ms;
+    return (delay_ms < SCREEN_SAVER_CHECK_MIN_MS) ? SCREEN_SAVER_CHECK_MIN_MS :
+           (delay_ms > SCREEN_SAVER_CHECK_MAX_MS) ? SCREEN_SAVER_CHECK_MAX_MS : (uint32_t)delay_ms;
 }
 
-void GlobalScreenSaver::startTimer() {
-    if (_screen_saver_timer == nullptr) {
-        ESP_LOGE(TAG, "Timer not initialized");
+void GlobalScreenSaver::updateReadPeriod(const ESP_Brookesia_TouchSample_t* sample) {
+    if ((_read_timer == nullptr) || (_read_period_ms == 0)) {
         return;
     }
-    
-    // Stop existing timer first
-    stopTimer();
-    
-    // Start timer with configured timeout
-    uint64_t timeout_us = (uint64_t)_timeout_seconds * 1000000ULL;  // Convert to microseconds
-    esp_err_t ret = esp_timer_start_once(_screen_saver_timer, timeout_us);
-    
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Screen saver timer started for %d seconds", _timeout_seconds);
+
+    // Full rate while pressed, while a scroll is thrown, and for a while after, the throw and the gestures are
+    // processed by the reads
+    uint32_t period = _read_period_ms;
+    int64_t idle_ms = (esp_timer_get_time() - _last_activity_us.load(std::memory_order_relaxed)) / 1000;
+    bool interacting = false;
+    if (_stage.load() >= STAGE_OFF) {
+        period = SCREEN_SAVER_READ_OFF_PERIOD;
+    } else if ((sample->state != LV_INDEV_STATE_PRESSED) && (lv_indev_get_scroll_obj(sample->indev) == nullptr) &&
+               (idle_ms >= SCREEN_SAVER_READ_IDLE_MS)) {
+        period = (_read_period_ms > SCREEN_SAVER_READ_IDLE_PERIOD) ? _read_period_ms : SCREEN_SAVER_READ_IDLE_PERIOD;
     } else {
-        ESP_LOGE(TAG, "Failed to start screen saver timer: %s", esp_err_to_name(ret));
+        interacting = true;
+    }
+    if (_read_timer->period != period) {
+        lv_timer_set_period(_read_timer, period);
     }
-}
 
-void GlobalScreenSaver::stopTimer() {
-    if (_screen_saver_timer != nullptr) {
-        esp_timer_stop(_screen_saver_timer);
+    // The CPU stays at full speed as long as the touches are read at full rate, the gesture and scroll handling
+    // doesn't wait for the clock to go up
+    if (interacting != _touch_boost) {
+        _touch_boost = interacting;
+        if (interacting) {
+            pm_policy_acquire(PM_POLICY_CLIENT_TOUCH);
+        } else {
+            pm_policy_release(PM_POLICY_CLIENT_TOUCH);
+        }
     }
 }
 
-int GlobalScreenSaver::getCurrentBrightness() {
-    const int32_t SCREEN_BRIGHTNESS_DEFAULT = 20;  // 默认亮度
-    int32_t brightness = SCREEN_BRIGHTNESS_DEFAULT;
-    
-    // 从NVS读取用户设置的亮度值 (使用与Settings相同的命名空间和数据类型)
-    nvs_handle_t nvs_handle;
-    esp_err_t ret = nvs_open("storage", NVS_READONLY, &nvs_handle);
-    if (ret == ESP_OK) {
-        ret = nvs_get_i32(nvs_handle, "brightness", &brightness);
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "Loaded brightness from NVS: %d", (int)brightness);
-        } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
-            ESP_LOGW(TAG, "No brightness setting in NVS, using default: %d", (int)SCREEN_BRIGHTNESS_DEFAULT);
-            brightness = SCREEN_BRIGHTNESS_DEFAULT;
-        } else {
-            ESP_LOGW(TAG, "Failed to read brightness from NVS (error: %s), using default: %d", 
-                     esp_err_to_name(ret), (int)SCREEN_BRIGHTNESS_DEFAULT);
-            brightness = SCREEN_BRIGHTNESS_DEFAULT;
+void GlobalScreenSaver::enterStage(Stage stage) {
+    Stage old_stage = _stage.load();
+
+    if (old_stage == STAGE_SLEEP) {
+        pm_policy_acquire(PM_POLICY_CLIENT_DISPLAY);
+        // From the touches of the LVGL task, runs at once and arms itself for the next stage
+        lv_timer_resume(_check_timer);
+        lv_timer_ready(_check_timer);
+    }
+
+    if ((old_stage >= STAGE_OFF) && (stage < STAGE_OFF)) {
+        ESP_LOGI(TAG, "Turning on screen");
+        // Before the backlight and the refresh of the whole screen, out of its sleep mode it takes a while
+        setPanelPower(PANEL_POWER_ON);
+        postDisplayState(ESP_BROOKESIA_CORE_DISPLAY_STATE_ON);
+    }
+
+    switch (stage) {
+    case STAGE_ACTIVE:
+        // Always read the latest brightness setting when turning on
+        backlight_set(getCurrentBrightness(), SCREEN_SAVER_FADE_ON_MS);
+        break;
+    case STAGE_DIMMED: {
+        int brightness = getCurrentBrightness();
+        ESP_LOGI(TAG, "Dimming screen");
+        backlight_set((brightness < SCREEN_SAVER_DIM_BRIGHTNESS) ? brightness : SCREEN_SAVER_DIM_BRIGHTNESS,
+                      SCREEN_SAVER_FADE_DIM_MS);
+        break;
+    }
+    case STAGE_OFF:
+    case STAGE_SLEEP:
+        if (old_stage < STAGE_OFF) {
+            ESP_LOGI(TAG, "Turning off screen");
+            backlight_set(0, SCREEN_SAVER_FADE_OFF_MS);  // Turn off by fading the brightness to 0
+            // Stop rendering and app visual timers from the LVGL task, audio and background services keep running
+            postDisplayState(ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF);
+            setPanelPower(PANEL_POWER_OFF);
         }
-        nvs_close(nvs_handle);
-    } else {
-        ESP_LOGW(TAG, "Failed to open NVS for brightness, using default: %d", (int)SCREEN_BRIGHTNESS_DEFAULT);
-        brightness = SCREEN_BRIGHTNESS_DEFAULT;
+        break;
+    default:
+        break;
     }
-    
+
+    if (stage == STAGE_SLEEP) {
+        // Nothing left to check until the next touch
+        lv_timer_pause(_check_timer);
+        setPanelPower(PANEL_POWER_SLEEP);
+        // Light sleep allowed unless the camera, audio or USB keep the chip awake, the touch read timer wakes it
+        pm_policy_release(PM_POLICY_CLIENT_DISPLAY);
+        ESP_LOGI(TAG, "Light sleep allowed");
+    }
+    _stage = stage;
+}
+
+void GlobalScreenSaver::postDisplayState(ESP_Brookesia_CoreDisplayState_t state) {
+    if ((_core == nullptr) || !_core->postToUi("display_state", displayStateUiCallback, &state, sizeof(state), this)) {
+        ESP_LOGW(TAG, "Failed to post display %s", (state == ESP_BROOKESIA_CORE_DISPLAY_STATE_OFF) ? "off" : "on");
+    }
+}
+
+void GlobalScreenSaver::setPanelPower(panel_power_state_t state) {
+    esp_err_t ret = panel_power_set(state);
+
+    // Without the panel sleep only the backlight goes off, as before
+    if ((ret != ESP_OK) && (ret != ESP_ERR_NOT_SUPPORTED)) {
+        ESP_LOGW(TAG, "Failed to set panel power %d: %s", state, esp_err_to_name(ret));
+    }
+}
+
+void GlobalScreenSaver::checkTimerCallback(lv_timer_t* timer) {
+    GlobalScreenSaver* instance = static_cast<GlobalScreenSaver*>(timer->user_data);
+
+    instance->checkInactivity();
+    uint32_t delay_ms = instance->getCheckDelayMs();
+    if (delay_ms > 0) {
+        lv_timer_set_period(timer, delay_ms);
+    }
+}
+
+void GlobalScreenSaver::displayStateUiCallback(const void* data, void* user_data) {
+    GlobalScreenSaver* instance = static_cast<GlobalScreenSaver*>(user_data);
+    ESP_Brookesia_CoreDisplayState_t state = *static_cast<const ESP_Brookesia_CoreDisplayState_t*>(data);
+
+    if (!instance->_core->setDisplayState(state)) {
+        ESP_LOGE(TAG, "Failed to set display state: %d", state);
+    }
+}
+
+void GlobalScreenSaver::settingsChangeCallback(settings_key_t key, int32_t value, void* user_data) {
+    if (key == SETTINGS_KEY_SCREEN_TIMEOUT) {
+        static_cast<GlobalScreenSaver*>(user_data)->setTimeoutSeconds(value);
+    }
+}
+
+void GlobalScreenSaver::touchSampleCallback(const ESP_Brookesia_TouchSample_t* sample, void* user_data) {
+    GlobalScreenSaver* instance = static_cast<GlobalScreenSaver*>(user_data);
+
+    if (sample->state == LV_INDEV_STATE_PRESSED) {
+        instance->onUserActivity();
+    }
+    instance->updateReadPeriod(sample);
+}
+
+int GlobalScreenSaver::getCurrentBrightness() {
+    // 用户设置的亮度值，设置存储在内存中缓存，不再读NVS
+    int32_t brightness = settings_store_get(SETTINGS_KEY_DISPLAY_BRIGHTNESS);
+
     // 确保亮度值在合理范围内
     const int32_t SCREEN_BRIGHTNESS_MIN = 20;
     const int32_t SCREEN_BRIGHTNESS_MAX = 100;
-    brightness = (brightness < SCREEN_BRIGHTNESS_MIN) ? SCREEN_BRIGHTNESS_MIN : 
+    brightness = (brightness < SCREEN_BRIGHTNESS_MIN) ? SCREEN_BRIGHTNESS_MIN :
                  (brightness > SCREEN_BRIGHTNESS_MAX) ? SCREEN_BRIGHTNESS_MAX : brightness;
-    
+
     return (int)brightness;
-}
\ No newline at end of file
+}
@@ -1,34 +1,62 @@
 #pragma once
 
+#include <atomic>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "esp_timer.h"
 #include "lvgl.h"
 #include "bsp/display.h"
+#include "core/esp_brookesia_core_touch_hook.h"
+#include "core/esp_brookesia_core.hpp"
+#include "settings_store/settings_store.h"
+#include "panel_power/panel_power.h"
 
 class GlobalScreenSaver {
 public:
+    // The screen goes through these stages while there is no activity, any touch goes back to ACTIVE
+    enum Stage {
+        STAGE_ACTIVE = 0,
+        STAGE_DIMMED,       // Backlight lowered before the timeout
+        STAGE_OFF,          // Backlight and panel off, rendering stopped
+        STAGE_SLEEP,        // Off for a while, panel in sleep mode, automatic light sleep allowed
+    };
+
     static GlobalScreenSaver& getInstance();
-    
-    void init();
+
+    void init(ESP_Brookesia_Core *core);
     void setTimeoutSeconds(int timeout_seconds);
     void onUserActivity();
     void turnOffScreen();
     void turnOnScreen();
-    
-    bool isScreenOff() const { return _screen_is_off; }
-    
+
+    bool isScreenOff() const { return _stage.load() >= STAGE_OFF; }
+
 private:
     GlobalScreenSaver() = default;
     ~GlobalScreenSaver();
-    
-    static void screenSaverTimerCallback(void* arg);
-    static void globalTouchEventCallback(lv_event_t* e);
-    
-    void startTimer();
-    void stopTimer();
-    int getCurrentBrightness();  // 从NVS获取当前亮度设置
-    
-    esp_timer_handle_t _screen_saver_timer = nullptr;
-    int _timeout_seconds = 30;  // 默认30秒
-    bool _screen_is_off = false;
+
+    static void checkTimerCallback(lv_timer_t* timer);
+    static void touchSampleCallback(const ESP_Brookesia_TouchSample_t* sample, void* user_data);
+    static void displayStateUiCallback(const void* data, void* user_data);
+    static void settingsChangeCallback(settings_key_t key, int32_t value, void* user_data);
+
+    void checkInactivity();
+    uint32_t getCheckDelayMs();     // Until the next stage, 0 if there is none
+    void updateReadPeriod(const ESP_Brookesia_TouchSample_t* sample);
+    void enterStage(Stage stage);   // Called with _lock held
+    void postDisplayState(ESP_Brookesia_CoreDisplayState_t state);
+    void setPanelPower(panel_power_state_t state);
+    int getCurrentBrightness();  // 从设置存储获取当前亮度设置
+
+    ESP_Brookesia_Core* _core = nullptr;
+    lv_timer_t *_check_timer = nullptr;         // Runs in the LVGL task, armed for the next stage
+    lv_timer_t *_read_timer = nullptr;          // Read timer of the touch device, slowed down while idle
+    uint32_t _read_period_ms = 0;               // Period of `_read_timer` while the screen is used
+    bool _touch_boost = false;                  // `PM_POLICY_CLIENT_TOUCH` held, only used by the LVGL task
+    SemaphoreHandle_t _lock = nullptr;          // Serializes the stage changes of the check timer and of the touches
+    std::atomic<int64_t> _last_activity_us{0};
+    std::atomic<int> _timeout_seconds{30};  // 默认30秒
+    std::atomic<Stage> _stage{STAGE_ACTIVE};
     bool _is_initialized = false;
-};
\ No newline at end of file
+};
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
@@ -16,64 +17,434 @@
 #include "app_examples/phone/squareline/src/phone_app_squareline.hpp"
 #include "apps.h"
 #include "global_screen_saver.hpp"
+#include "settings_store/settings_store.h"
+#include "backlight/backlight.h"
+#include "asset_pack/asset_pack.h"
+#include "sd_io/sd_io.h"
+#include "storage_fs/storage_fs.h"
+#include "media_arena/media_arena.h"
+#include "ota_update/ota_update.h"
+#include "screen_mirror/screen_mirror.h"
+#include "screen_capture/screen_capture.h"
+#include "usb_msc/usb_msc.h"
+#include "perf_runner/perf_runner.h"
+#include "perf_log/perf_log.h"
+#include "lvgl_watchdog/lvgl_watchdog.h"
+#include "lvgl_draw_offload/lvgl_draw_offload.h"
+#include "pm_policy/pm_policy.h"
+#include "ui_sound/ui_sound.h"
+#include "boot_tasks.hpp"
 
 static const char *TAG = "main";
 
+static esp_err_t sdcard_ret = ESP_FAIL;
+
+static void boot_mount_sdcard(void *arg)
+{
+#if CONFIG_USB_MSC
+    // Mounted by the mass storage, which hands the card to a computer plugged into the USB port
+    sdcard_ret = usb_msc_mount();
+    if (sdcard_ret != ESP_OK) {
+        ESP_LOGW(TAG, "USB mass storage failed, the card is only mounted for the apps");
+        sdcard_ret = sd_io_mount();
+    }
+#else
+    sdcard_ret = sd_io_mount();
+#endif
+    if (sdcard_ret == ESP_OK) {
+        ESP_LOGI(TAG, "SD card mount successfully");
+    }
+}
+
+static void boot_init_codec(void *arg)
+{
+    ESP_ERROR_CHECK(bsp_extra_codec_init());
+#if CONFIG_UI_SOUND
+    if (ui_sound_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start the UI sounds");
+    }
+#endif
+}
+
+static void boot_probe_camera(void *arg)
+{
+    Camera::probeSensor();
+}
+
+static const ESP_Brookesia_PhoneStylesheet_t *phone_themes[2] = {};
+
+static void phone_theme_ui_callback(const void *data, void *user_data)
+{
+    ESP_Brookesia_Phone *phone = static_cast<ESP_Brookesia_Phone *>(user_data);
+    int32_t theme = *static_cast<const int32_t *>(data);
+
+    if (!phone->switchTheme(phone_themes[(theme == 1) ? 1 : 0])) {
+        ESP_LOGE(TAG, "Failed to switch to theme %d", (int)theme);
+    }
+}
+
+static void phone_theme_settings_callback(settings_key_t key, int32_t value, void *user_ctx)
+{
+    // Called from the task of the setter, the theme is switched by the LVGL task
+    if ((key == SETTINGS_KEY_DISPLAY_THEME) &&
+            !static_cast<ESP_Brookesia_Phone *>(user_ctx)->postToUi("theme", phone_theme_ui_callback, &value,
+                    sizeof(value), user_ctx)) {
+        ESP_LOGW(TAG, "Failed to post the theme switch");
+    }
+}
+
+// Launch counts of the apps, by app name, so the idle pre-init starts with the most used apps after a restart
+#define APP_USAGE_NVS_NAMESPACE "app_usage"
+
+static void app_usage_restore(ESP_Brookesia_Phone *phone)
+{
+    nvs_handle_t handle = 0;
+    nvs_iterator_t it = NULL;
+    nvs_entry_info_t info = {};
+    uint32_t count = 0;
+
+    if (nvs_open(APP_USAGE_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        // Nothing saved yet
+        return;
+    }
+    esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, APP_USAGE_NVS_NAMESPACE, NVS_TYPE_U32, &it);
+    while (err == ESP_OK) {
+        nvs_entry_info(it, &info);
+        ESP_Brookesia_CoreApp *app = phone->getCoreManager().getInstalledAppByName(info.key);
+        if ((app != nullptr) && (nvs_get_u32(handle, info.key, &count) == ESP_OK)) {
+            phone->getCoreManager().setAppLaunchCount(app->getId(), count);
+        }
+        err = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    nvs_close(handle);
+}
+
+static void app_usage_event_callback(lv_event_t *event)
+{
+    ESP_Brookesia_Phone *phone = static_cast<ESP_Brookesia_Phone *>(lv_event_get_user_data(event));
+    ESP_Brookesia_CoreAppEventData_t *data = static_cast<ESP_Brookesia_CoreAppEventData_t *>(lv_event_get_param(event));
+    nvs_handle_t handle = 0;
+    uint32_t count = 0;
+
+    if ((data == nullptr) || (data->type != ESP_BROOKESIA_CORE_APP_EVENT_TYPE_START)) {
+        return;
+    }
+    ESP_Brookesia_CoreApp *app = phone->getCoreManager().getInstalledApp(data->id);
+    // The name is the NVS key, longer names are not counted
+    if ((app == nullptr) || (strlen(app->getName()) >= NVS_KEY_NAME_MAX_SIZE) ||
+            (nvs_open(APP_USAGE_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)) {
+        return;
+    }
+    nvs_get_u32(handle, app->getName(), &count);
+    if ((nvs_set_u32(handle, app->getName(), count + 1) != ESP_OK) || (nvs_commit(handle) != ESP_OK)) {
+        ESP_LOGW(TAG, "Failed to save the launch count of %s", app->getName());
+    }
+    nvs_close(handle);
+}
+
+// States the apps keep across restarts, by app name, written by the core when the display turns off
+#define APP_STATE_NVS_NAMESPACE "app_state"
+
+static int app_state_load(const char *name, void *data, size_t size, void *user_ctx)
+{
+    nvs_handle_t handle = 0;
+    size_t length = size;
+
+    // The name is the NVS key, apps with longer names only keep their state until a restart
+    if ((strlen(name) >= NVS_KEY_NAME_MAX_SIZE) ||
+            (nvs_open(APP_STATE_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)) {
+        return 0;
+    }
+    esp_err_t err = nvs_get_blob(handle, name, data, &length);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return 0;
+    }
+
+    return (err == ESP_OK) ? (int)length : -1;
+}
+
+static bool app_state_save(const char *name, const void *data, size_t size, void *user_ctx)
+{
+    nvs_handle_t handle = 0;
+    esp_err_t err = ESP_OK;
+
+    if (strlen(name) >= NVS_KEY_NAME_MAX_SIZE) {
+        return true;
+    }
+    ESP_RETURN_ON_FALSE(nvs_open(APP_STATE_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK, false, TAG,
+                        "Failed to open the app states");
+    if (size == 0) {
+        err = nvs_erase_key(handle, name);
+        err = (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_OK : err;
+    } else {
+        err = nvs_set_blob(handle, name, data, size);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save the state of %s: %s", name, esp_err_to_name(err));
+    }
+
+    return (err == ESP_OK);
+}
+
+#if CONFIG_LVGL_WATCHDOG
+// Names the app in the foreground in the stall reports
+static void watchdog_app_event_callback(lv_event_t *event)
+{
+    ESP_Brookesia_Phone *phone = static_cast<ESP_Brookesia_Phone *>(lv_event_get_user_data(event));
+    ESP_Brookesia_CoreAppEventData_t *data = static_cast<ESP_Brookesia_CoreAppEventData_t *>(lv_event_get_param(event));
+
+    if (data == nullptr) {
+        return;
+    }
+    if (data->type == ESP_BROOKESIA_CORE_APP_EVENT_TYPE_START) {
+        ESP_Brookesia_CoreApp *app = phone->getCoreManager().getInstalledApp(data->id);
+        lvgl_watchdog_set_app(data->id, (app != nullptr) ? app->getName() : nullptr);
+    } else if (data->type == ESP_BROOKESIA_CORE_APP_EVENT_TYPE_STOP) {
+        lvgl_watchdog_set_app(-1, "home");
+    }
+}
+#endif
+
+#if CONFIG_PERF_RUNNER
+static bool perf_launch_app(const char *app_name, void *user_ctx)
+{
+    ESP_Brookesia_Phone *phone = static_cast<ESP_Brookesia_Phone *>(user_ctx);
+    ESP_Brookesia_CoreApp *app = phone->getCoreManager().getInstalledAppByName(app_name);
+    if (app == nullptr) {
+        return false;
+    }
+
+    ESP_Brookesia_CoreAppEventData_t event = {
+        .id = app->getId(),
+        .type = ESP_BROOKESIA_CORE_APP_EVENT_TYPE_START,
+        .data = nullptr,
+    };
+    return phone->sendAppEvent(&event);
+}
+
+static bool perf_navigate(perf_runner_navigate_t navigate, void *user_ctx)
+{
+    ESP_Brookesia_Phone *phone = static_cast<ESP_Brookesia_Phone *>(user_ctx);
+
+    switch (navigate) {
+    case PERF_RUNNER_NAVIGATE_HOME:
+        return phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_HOME);
+    case PERF_RUNNER_NAVIGATE_BACK:
+        return phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_BACK);
+    case PERF_RUNNER_NAVIGATE_RECENTS:
+        return phone->sendNavigateEvent(ESP_BROOKESIA_CORE_NAVIGATE_TYPE_RECENTS_SCREEN);
+    default:
+        return false;
+    }
+}
+#endif
+
 extern "C" void app_main(void)
 {
+    // Boot phases are only recorded when ESP_BROOKESIA_BOOT_PROFILE_ENABLE is set
+    int boot_span = esp_brookesia_core_boot_profile_begin("nvs_flash_init");
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
+    // Settings are read from RAM from now on, changes are committed in batches
+    if (settings_store_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to load the settings, using defaults");
+    }
+    esp_brookesia_core_boot_profile_end(boot_span);
+
+#if CONFIG_PERF_LOG
+    // First thing after NVS, so a boot that hangs later still has its reset reason recorded
+    if (perf_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open the performance log");
+    }
+#endif
+
+    boot_span = esp_brookesia_core_boot_profile_begin("storage_fs_mount");
+    ESP_ERROR_CHECK(storage_fs_mount());
+    esp_brookesia_core_boot_profile_end(boot_span);
+#if CONFIG_STORAGE_FS_BENCH_READ
+    uint32_t storage_kbps = 0;
+    storage_fs_bench_read(BSP_SPIFFS_MOUNT_POINT "/assets.pak", 4096, 64, &storage_kbps);
+#endif
+
+    // Before anything else takes PSRAM, so the large media buffers never depend on the fragmentation
+    boot_span = esp_brookesia_core_boot_profile_begin("media_arena_init");
+    if (media_arena_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to reserve the whole media arena, large buffers may come from the heap");
+    }
+    esp_brookesia_core_boot_profile_end(boot_span);
 
-    ESP_ERROR_CHECK(bsp_spiffs_mount());
-    ESP_LOGI(TAG, "SPIFFS mount successfully");
+#if CONFIG_PM_POLICY
+    // Before the drivers and the apps that hold its locks, the CPU stays at full speed when it fails
+    if (pm_policy_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set up the power management, the CPU runs at full speed");
+    }
+#endif
+
+    // The codec, the touch panel and the camera sensor share this bus, create it before they race for it
+    ESP_ERROR_CHECK(bsp_i2c_init());
 
+    // Storage, codec and camera don't need the display, bring them up while the UI is created.
+    // Wi-Fi is started by the Settings app from its own task. Static, so the early exits below can't free it
+    // under the running tasks.
+    static BootTasks boot_tasks;
 // #if CONFIG_EXAMPLE_ENABLE_SD_CARD
-    esp_err_t ret = bsp_sdcard_mount();
-    if(ret == ESP_OK)
-        ESP_LOGI(TAG, "SD card mount successfully");
+    boot_tasks.add("sd_io_mount", boot_mount_sdcard, nullptr, 0, 1);
 // #endif
-
-    ESP_ERROR_CHECK(bsp_extra_codec_init());
+    boot_tasks.add("bsp_extra_codec_init", boot_init_codec, nullptr, 0, 1);
+    boot_tasks.add("camera probe", boot_probe_camera, nullptr, 0, tskNO_AFFINITY);
+    assert(boot_tasks.start() && "Failed to start boot tasks");
 
     bsp_display_cfg_t cfg = {
         .lvgl_port_cfg = ESP_LVGL_PORT_INIT_CONFIG(),
-        .buffer_size = BSP_LCD_H_RES * 80,
+#if CONFIG_EXAMPLE_DISPLAY_PROFILE_DIRECT
+        // With BSP_DISPLAY_LVGL_AVOID_TEAR the port takes the DPI frame buffers from the panel, no draw buffer is allocated
+        .buffer_size = BSP_LCD_H_RES * BSP_LCD_V_RES,
+        .double_buffer = (CONFIG_BSP_LCD_DPI_BUFFER_NUMS > 1),
+        .flags = {
+            .buff_dma = false,
+            .buff_spiram = true,
+            .sw_rotate = false,
+        }
+#elif CONFIG_EXAMPLE_DISPLAY_PROFILE_PARTIAL_INTERNAL
+        .buffer_size = BSP_LCD_H_RES * CONFIG_EXAMPLE_DISPLAY_BAND_LINES,
+        .double_buffer = true,
+        .flags = {
+            .buff_dma = true,
+            .buff_spiram = false,
+            .sw_rotate = false,
+        }
+#else
+        .buffer_size = BSP_LCD_H_RES * CONFIG_EXAMPLE_DISPLAY_BAND_LINES,
         .double_buffer = false,
         .flags = {
             .buff_dma = false,
             .buff_spiram = true,
             .sw_rotate = false,
         }
+#endif
     };
-    bsp_display_start_with_config(&cfg);
+#if CONFIG_LVGL_DRAW_OFFLOAD
+    // The big blends are split with a task on the other core
+    cfg.lvgl_port_cfg.task_affinity = LVGL_DRAW_OFFLOAD_LVGL_CORE;
+#endif
+    boot_span = esp_brookesia_core_boot_profile_begin("bsp_display_start");
+    lv_disp_t *disp = bsp_display_start_with_config(&cfg);
     bsp_display_backlight_on();
+    // Brightness changes fade with the LEDC hardware from now on
+    if (backlight_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to init the backlight fade, brightness changes are steps");
+    }
+    esp_brookesia_core_boot_profile_end(boot_span);
 
     bsp_display_lock(0);
 
+#if CONFIG_PERF_LOG
+    perf_log_attach_display(disp);
+#endif
+
+#if CONFIG_PM_POLICY
+    // The CPU goes to full speed for each refresh, the frequency scales down while the UI is idle
+    pm_policy_attach_display(disp);
+#endif
+
+#if CONFIG_LVGL_WATCHDOG
+    if (lvgl_watchdog_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start the LVGL watchdog");
+    }
+    lvgl_watchdog_set_app(-1, "home");
+#endif
+
+#if CONFIG_LVGL_DRAW_OFFLOAD
+    if (lvgl_draw_offload_init(disp) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start the draw offload, LVGL renders on one core");
+    }
+#endif
+
+#if CONFIG_SCREEN_MIRROR
+    // Only hooks the flush and the touch panel, the server is started by Settings once Wi-Fi is up
+    if (screen_mirror_init(disp) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to hook the display, the screen can't be mirrored");
+    }
+#endif
+
+#if CONFIG_SCREEN_CAPTURE
+    // Screenshots and recordings for QA, from the two finger hold or the `screenshot` step of the perf script
+    if (screen_capture_init(disp) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to hook the display, the screen can't be captured");
+    }
+#endif
+
+    // Images moved out of the firmware are decoded from the storage partition when shown
+    if (asset_pack_init(BSP_SPIFFS_MOUNT_POINT "/assets.pak") != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to open the asset pack, packed images won't show");
+    }
+
     ESP_Brookesia_Phone *phone = new ESP_Brookesia_Phone();
     assert(phone != nullptr && "Failed to create phone");
 
     ESP_Brookesia_PhoneStylesheet_t *phone_stylesheet = new ESP_Brookesia_PhoneStylesheet_t ESP_BROOKESIA_PHONE_480_800_DARK_STYLESHEET();
     ESP_BROOKESIA_CHECK_NULL_EXIT(phone_stylesheet, "Create phone stylesheet failed");
     ESP_BROOKESIA_CHECK_FALSE_EXIT(phone->addStylesheet(*phone_stylesheet), "Add phone stylesheet failed");
-    ESP_BROOKESIA_CHECK_FALSE_EXIT(phone->activateStylesheet(*phone_stylesheet), "Activate phone stylesheet failed");
+    ESP_Brookesia_PhoneStylesheet_t *phone_light_stylesheet =
+        new ESP_Brookesia_PhoneStylesheet_t ESP_BROOKESIA_PHONE_480_800_LIGHT_STYLESHEET();
+    ESP_BROOKESIA_CHECK_NULL_EXIT(phone_light_stylesheet, "Create phone light stylesheet failed");
+    ESP_BROOKESIA_CHECK_FALSE_EXIT(phone->addStylesheet(*phone_light_stylesheet), "Add phone light stylesheet failed");
+    // Both themes share the layout, changing the setting later recolors the UI in place
+    phone_themes[0] = phone_stylesheet;
+    phone_themes[1] = phone_light_stylesheet;
+    ESP_BROOKESIA_CHECK_FALSE_EXIT(
+        phone->activateStylesheet(phone_themes[(settings_store_get(SETTINGS_KEY_DISPLAY_THEME) == 1) ? 1 : 0]),
+        "Activate phone stylesheet failed"
+    );
 
+    boot_span = esp_brookesia_core_boot_profile_begin("phone begin");
     assert(phone->begin() && "Failed to begin phone");
+    esp_brookesia_core_boot_profile_end(boot_span);
+    if (settings_store_register_callback(phone_theme_settings_callback, phone) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to follow the theme setting");
+    }
+
+    // Let LVGL draw the home screen while the apps wait for the boot tasks
+    bsp_display_unlock();
+    boot_span = esp_brookesia_core_boot_profile_begin("wait boot tasks");
+    boot_tasks.waitAll();
+    esp_brookesia_core_boot_profile_end(boot_span);
+    bsp_display_lock(0);
+
+#if CONFIG_OTA_UPDATE
+    // Written in the background, the new image boots on the next restart
+    if ((sdcard_ret == ESP_OK) && (CONFIG_OTA_UPDATE_SD_PATH[0] != '\0') &&
+            (ota_update_start_file(CONFIG_OTA_UPDATE_SD_PATH) == ESP_OK)) {
+        ESP_LOGI(TAG, "Installing %s", CONFIG_OTA_UPDATE_SD_PATH);
+    }
+#endif
+
+    // Each installApp() records its own span inside this one
+    int install_span = esp_brookesia_core_boot_profile_begin("install apps");
 
     PhoneAppSquareline *smart_gadget = new PhoneAppSquareline();
     assert(smart_gadget != nullptr && "Failed to create phone app squareline");
+    assert(smart_gadget->setLazyInit(true) && "Failed to set phone app squareline lazy init");
     assert((phone->installApp(smart_gadget) >= 0) && "Failed to install phone app squareline");
 
     Calculator *calculator = new Calculator();
     assert(calculator != nullptr && "Failed to create calculator");
+    assert(calculator->setLazyInit(true) && "Failed to set calculator lazy init");
     assert((phone->installApp(calculator) >= 0) && "Failed to begin calculator");
 
     MusicPlayer *music_player = new MusicPlayer();
     assert(music_player != nullptr && "Failed to create music_player");
+    assert(music_player->setLazyInit(true) && "Failed to set music_player lazy init");
     assert((phone->installApp(music_player) >= 0) && "Failed to begin music_player");
 
     AppSettings *app_settings = new AppSettings();
@@ -82,14 +453,17 @@ extern "C" void app_main(void)
     
     // Initialize global screen saver
     GlobalScreenSaver& screenSaver = GlobalScreenSaver::getInstance();
-    screenSaver.init();
+    screenSaver.init(phone);
 
     Game2048 *game_2048 = new Game2048();
     assert(game_2048 != nullptr && "Failed to create game_2048");
+    assert(game_2048->setLazyInit(true) && "Failed to set game_2048 lazy init");
     assert((phone->installApp(game_2048) >= 0) && "Failed to begin game_2048");
 
     Camera *camera = new Camera(1288, 728);
     assert(camera != nullptr && "Failed to create camera");
+    // The preview overlays are redrawn every frame, keep their objects in internal RAM
+    assert(camera->setMemoryPolicy(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, 0) && "Failed to set camera memory policy");
     assert((phone->installApp(camera) >= 0) && "Failed to begin camera");
     if(camera->get_camera_ctlr_handle() < 0)
     {
@@ -100,12 +474,24 @@ extern "C" void app_main(void)
 
     AppImageDisplay *image = new AppImageDisplay();
     assert(image != nullptr && "Failed to create image");
+    assert(image->setLazyInit(true) && "Failed to set image lazy init");
+    assert(image->setMemoryPolicy(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, 0) && "Failed to set image memory policy");
     assert((phone->installApp(image) >= 0) && "Failed to begin image");
 
     PowerController *power_controller = new PowerController();
     assert(power_controller != nullptr && "Failed to create power_controller");
     assert((phone->installApp(power_controller) >= 0) && "Failed to begin power_controller");
 
+    SystemMonitor *system_monitor = new SystemMonitor();
+    assert(system_monitor != nullptr && "Failed to create system_monitor");
+    assert(system_monitor->setLazyInit(true) && "Failed to set system_monitor lazy init");
+    assert((phone->installApp(system_monitor) >= 0) && "Failed to install system_monitor");
+
+    Diagnostics *diagnostics = new Diagnostics();
+    assert(diagnostics != nullptr && "Failed to create diagnostics");
+    assert(diagnostics->setLazyInit(true) && "Failed to set diagnostics lazy init");
+    assert((phone->installApp(diagnostics) >= 0) && "Failed to install diagnostics");
+
 
 
 
@@ -122,23 +508,51 @@ extern "C" void app_main(void)
                          free_sram_size_kb, total_sram_size_kb, free_psram_size_kb, total_psram_size_kb);
 
 // #if CONFIG_EXAMPLE_ENABLE_SD_CARD
-    if(ret == ESP_OK)
+    if(sdcard_ret == ESP_OK)
     {
         ESP_LOGW(TAG, "Using Video Player example requires inserting the SD card in advance and saving an MJPEG format video on the SD card");
         AppVideoPlayer *app_video_player = new AppVideoPlayer();
         assert(app_video_player != nullptr && "Failed to create app_video_player");
+        assert(app_video_player->setLazyInit(true) && "Failed to set app_video_player lazy init");
+        assert(app_video_player->setMemoryPolicy(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, 0) &&
+               "Failed to set app_video_player memory policy");
         assert((phone->installApp(app_video_player) >= 0) && "Failed to begin app_video_player");
     }
 
 
     UARTTTL *uart_ttl_app = new UARTTTL();
     assert(uart_ttl_app != nullptr && "Failed to create UART TTL app");
+    assert(uart_ttl_app->setLazyInit(true) && "Failed to set UART TTL app lazy init");
     assert((phone->installApp(uart_ttl_app) >= 0) && "Failed to install UART TTL app");
 
 
     USB_CDC *usb_cdc_app = new USB_CDC();
     assert(usb_cdc_app != nullptr && "Failed to create USB CDC app");
+    assert(usb_cdc_app->setLazyInit(true) && "Failed to set USB CDC app lazy init");
     assert((phone->installApp(usb_cdc_app) >= 0) && "Failed to install USB CDC app");
+    esp_brookesia_core_boot_profile_end(install_span);
+
+    app_usage_restore(phone);
+    // Only set, each state is read on the first start of its app
+    esp_brookesia_core_app_state_storage_t app_state_storage = {
+        .load = app_state_load,
+        .save = app_state_save,
+        .user_ctx = nullptr,
+    };
+    esp_brookesia_core_app_state_set_storage(&app_state_storage);
+    if (!phone->registerAppEventCallback(app_usage_event_callback, phone)) {
+        ESP_LOGW(TAG, "Failed to register the app usage callback");
+    }
+#if CONFIG_LVGL_WATCHDOG
+    if (!phone->registerAppEventCallback(watchdog_app_event_callback, phone)) {
+        ESP_LOGW(TAG, "Failed to register the watchdog app callback");
+    }
+#endif
+
+    // The phone and all apps are up, an image booted for the first time after an update is kept
+    if (ota_update_confirm() != ESP_OK) {
+        ESP_LOGW(TAG, "Confirm the running image failed");
+    }
 
     free_sram_size_kb = heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024;
     total_sram_size_kb = heap_caps_get_total_size(MALLOC_CAP_INTERNAL) / 1024;
@@ -153,4 +567,23 @@ extern "C" void app_main(void)
 // #endif
     ESP_LOGI(TAG,"setup done");
     bsp_display_unlock();
+
+    // Print the boot profile, it can be exported later with esp_brookesia_core_boot_profile_export_csv()
+    esp_brookesia_core_boot_profile_finish();
+
+#if CONFIG_PERF_RUNNER
+    // Reports to pytest_phone_perf.py over the console
+    perf_runner_config_t perf_config = {
+        .disp = disp,
+        .boot_time_us = esp_brookesia_core_boot_profile_get_boot_time(),
+        .launch = perf_launch_app,
+        .navigate = perf_navigate,
+        .user_ctx = phone,
+    };
+    bsp_display_lock(0);
+    if (perf_runner_start(&perf_config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the performance runner");
+    }
+    bsp_display_unlock();
+#endif
 }
@@ -0,0 +1,102 @@
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+import json
+import os
+from typing import Any, Dict, List
+
+import pytest
+from pytest_embedded import Dut
+
+# Printed by components/apps/perf_runner once the script of spiffs/perf_script.txt is done
+REPORT_PREFIX = 'PERF_REPORT '
+REPORT_VERSION = 1
+REPORT_TIMEOUT_S = 180
+THRESHOLDS_PATH = os.path.join(os.path.dirname(__file__), 'perf_thresholds.json')
+# Printed by components/apps/pc_profile at the profile_stop step of spiffs/profile_script.txt
+PC_PROFILE_PREFIX = 'PC_PROFILE '
+PC_PROFILE_LOG = 'pc_profile.log'
+
+
+def _check(checks: List[Dict[str, Any]], metric: str, value: Any, limit: Any, is_max: bool) -> None:
+    passed = value is not None and (value <= limit if is_max else value >= limit)
+    checks.append({'metric': metric, 'value': value, 'limit': limit, 'kind': 'max' if is_max else 'min',
+                   'passed': passed})
+
+
+def _check_limits(checks: List[Dict[str, Any]], prefix: str, values: Dict[str, Any], limits: Dict[str, Any]) -> None:
+    # A limit is named after the metric plus _min or _max, `frame_ms_p99_max` for values['frame_ms']['p99']
+    for name, limit in limits.items():
+        key, kind = name.rsplit('_', 1)
+        value = values.get(key)
+        if value is None and '_' in key:
+            group, field = key.rsplit('_', 1)
+            value = values.get(group, {}).get(field)
+        _check(checks, f'{prefix}.{key}', value, limit, kind == 'max')
+
+
+def evaluate(report: Dict[str, Any], thresholds: Dict[str, Any]) -> List[Dict[str, Any]]:
+    checks: List[Dict[str, Any]] = []
+
+    _check(checks, 'boot_ms', report['boot_ms'], thresholds['boot_ms_max'], True)
+    _check(checks, 'errors', report['errors'], thresholds.get('errors_max', 0), True)
+    _check_limits(checks, 'heap', report['heap'], thresholds.get('heap', {}))
+
+    section_limits = thresholds.get('sections', {})
+    for section in report['sections']:
+        limits = dict(section_limits.get('*', {}), **section_limits.get(section['name'], {}))
+        _check_limits(checks, f'sections.{section["name"]}', section, limits)
+
+    launch_limits = thresholds.get('launches', {})
+    for launch in report['launches']:
+        limits = dict(launch_limits.get('*', {}), **launch_limits.get(launch['app'], {}))
+        _check(checks, f'launches.{launch["app"]}.ok', int(launch['ok']), 1, False)
+        # A launch that drew nothing is reported with -1
+        values = dict(launch, first_frame_ms=launch['first_frame_ms'] if launch['first_frame_ms'] >= 0 else None)
+        _check_limits(checks, f'launches.{launch["app"]}', values, limits)
+
+    return checks
+
+
+@pytest.mark.target('esp32p4')
+@pytest.mark.env('esp32_p4_function_ev_board')
+@pytest.mark.parametrize('config', ['perf'], indirect=True)
+def test_phone_perf(dut: Dut) -> None:
+    match = dut.expect(REPORT_PREFIX.encode() + rb'(\{.*\})\r?\n', timeout=REPORT_TIMEOUT_S)
+    report = json.loads(match.group(1).decode())
+    assert report['version'] == REPORT_VERSION, f'Report version {report["version"]} is not supported'
+
+    with open(THRESHOLDS_PATH) as f:
+        thresholds = json.load(f)
+    checks = evaluate(report, thresholds)
+    failed = [check for check in checks if not check['passed']]
+
+    # The scorecard of the build, kept with the other logs of the run
+    scorecard = {'report': report, 'checks': checks, 'passed': not failed}
+    with open(os.path.join(dut.logdir, 'perf_report.json'), 'w') as f:
+        json.dump(scorecard, f, indent=2)
+
+    for check in checks:
+        print(f'{"PASS" if check["passed"] else "FAIL"} {check["metric"]}: {check["value"]} '
+              f'({check["kind"]} {check["limit"]})')
+    assert not failed, f'{len(failed)} performance check(s) failed'
+
+
+@pytest.mark.target('esp32p4')
+@pytest.mark.env('esp32_p4_function_ev_board')
+@pytest.mark.parametrize('config', ['profile'], indirect=True)
+def test_phone_pc_profile(dut: Dut) -> None:
+    # The samples are kept for components/apps/pc_profile/gen_iram_lf.py, the summary line ends the dump
+    lines = []
+    while True:
+        match = dut.expect(PC_PROFILE_PREFIX.encode() + rb'([^\r\n]*)\r?\n', timeout=REPORT_TIMEOUT_S)
+        body = match.group(1).decode()
+        lines.append(PC_PROFILE_PREFIX + body)
+        if body.startswith('{'):
+            break
+    summary = json.loads(lines[-1][len(PC_PROFILE_PREFIX):])
+
+    with open(os.path.join(dut.logdir, PC_PROFILE_LOG), 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    print(f'{summary["samples"]} samples, {summary["dropped"]} dropped, {len(lines) - 1} distinct PCs in '
+          f'{os.path.join(dut.logdir, PC_PROFILE_LOG)}')
+    assert summary['samples'] > 0, 'No PC sampled'
@@ -0,0 +1,5 @@
+CONFIG_PERF_RUNNER=y
+CONFIG_PERF_RUNNER_SCRIPT="profile_script.txt"
+CONFIG_PC_PROFILE=y
+# Listed functions must run from flash to be sampled there again
+CONFIG_PC_PROFILE_IRAM_PLACEMENT=n